@@ -0,0 +1,131 @@
+#pragma once
+
+/**
+ * @file bench_support.hpp
+ * @brief Inputs shared by the cppress-bench families
+ *
+ * Corpora and sample documents are read from the source tree, so every run
+ * measures the same bytes. Request and response objects can only be built
+ * by http_server; capture_exchange() gets one pair from a real loopback
+ * request, which the benchmarks then reuse without sending anything.
+ * Built with -DCPPRESS_ALLOC_ACCOUNTING=ON, allocation_counter adds the
+ * heap allocations and copies of an iteration to the results.
+ */
+
+#include <chrono>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <benchmark/benchmark.h>
+
+#include "http/includes.hpp"
+#include "shared/includes/alloc_accounting.hpp"
+#include "sockets/includes.hpp"
+
+namespace cppress::bench {
+
+/// @brief Path of a file in the source tree
+inline std::string source_path(const std::string& relative) {
+    return std::string(CPPRESS_SOURCE_DIR) + "/" + relative;
+}
+
+/**
+ * @brief Whole file, byte for byte
+ * @throws std::runtime_error if it cannot be read
+ */
+inline std::string read_file(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        throw std::runtime_error("Cannot read benchmark input: " + path);
+    std::ostringstream content;
+    content << file.rdbuf();
+    return content.str();
+}
+
+/// A request and its unsent response, as a handler receives them
+struct exchange {
+    std::unique_ptr<http::http_request> request;
+    std::unique_ptr<http::http_response> response;
+};
+
+/**
+ * @brief Sends one request to a loopback http_server and keeps what it dispatches
+ * @param raw_request Complete request head, and body if any
+ * @param listen_port Free local port for the duration of the call
+ * @throws std::runtime_error if no request arrives within five seconds
+ *
+ * The server is gone when this returns; the response must not be sent.
+ */
+inline exchange capture_exchange(const std::string& raw_request, int listen_port = 9979) {
+    sockets::initialize_socket_library();
+    http::http_server server(listen_port, "127.0.0.1");
+    std::promise<void> listening;
+    std::promise<exchange> captured;
+    server.set_listen_success_callback([&listening]() { listening.set_value(); });
+    server.set_request_callback([&captured](http::http_request& req, http::http_response& res) {
+        exchange pair;
+        pair.request = std::make_unique<http::http_request>(std::move(req));
+        pair.response = std::make_unique<http::http_response>(std::move(res));
+        captured.set_value(std::move(pair));
+    });
+
+    std::thread loop([&server]() { server.listen(); });
+    auto result = captured.get_future();
+    bool arrived = false;
+    if (listening.get_future().wait_for(std::chrono::seconds(5)) == std::future_status::ready) {
+        sockets::connection client;
+        client.connect(sockets::socket_address(sockets::port(listen_port),
+                                               sockets::ip_address("127.0.0.1")));
+        client.write(sockets::data_buffer(raw_request));
+        arrived = result.wait_for(std::chrono::seconds(5)) == std::future_status::ready;
+    }
+    server.shutdown();
+    loop.join();
+    if (!arrived)
+        throw std::runtime_error("No request reached the capture server");
+    return result.get();
+}
+
+/**
+ * @class allocation_counter
+ * @brief Allocations and copies of a timed loop, as counters per iteration
+ *
+ * Made before the loop, report() after it adds allocs, alloc_bytes,
+ * copies and copied_bytes, summed over every phase and thread; in a build
+ * without CPPRESS_ALLOC_ACCOUNTING it adds nothing.
+ */
+class allocation_counter {
+public:
+    allocation_counter() : before(shared::allocation_snapshot()) {}
+
+    void report(benchmark::State& state) const {
+        if (!shared::alloc_accounting)
+            return;
+        const shared::allocation_report after = shared::allocation_snapshot();
+        shared::phase_usage total;
+        for (std::size_t p = 0; p < shared::REQUEST_PHASES; ++p) {
+            total.allocations += after.phases[p].allocations - before.phases[p].allocations;
+            total.allocated_bytes +=
+                after.phases[p].allocated_bytes - before.phases[p].allocated_bytes;
+            total.copies += after.phases[p].copies - before.phases[p].copies;
+            total.copied_bytes += after.phases[p].copied_bytes - before.phases[p].copied_bytes;
+        }
+        const auto per_iteration = [](std::uint64_t n) {
+            return benchmark::Counter(static_cast<double>(n), benchmark::Counter::kAvgIterations);
+        };
+        state.counters["allocs"] = per_iteration(total.allocations);
+        state.counters["alloc_bytes"] = per_iteration(total.allocated_bytes);
+        state.counters["copies"] = per_iteration(total.copies);
+        state.counters["copied_bytes"] = per_iteration(total.copied_bytes);
+    }
+
+private:
+    shared::allocation_report before;
+};
+
+}  // namespace cppress::bench
@@ -0,0 +1,30 @@
+/**
+ * @file html_bench.cpp
+ * @brief HTML template parsing over the sample sections in libs/html
+ *
+ * html::parse() may modify its input, so each iteration parses a fresh
+ * copy; the copy is part of the measured time and small next to the parse.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+
+#include "bench_support.hpp"
+#include "html/includes.hpp"
+
+using namespace cppress;
+
+namespace {
+void parse_document(benchmark::State& state, const std::string& file) {
+    const std::string text = bench::read_file(bench::source_path("libs/html/" + file));
+    for (auto _ : state) {
+        std::string copy = text;
+        auto elements = html::parse(copy);
+        benchmark::DoNotOptimize(elements);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * text.size()));
+}
+BENCHMARK_CAPTURE(parse_document, a_tmp, std::string("a-tmp.html"));
+BENCHMARK_CAPTURE(parse_document, b_tmp, std::string("b-tmp.html"));
+}  // namespace
@@ -0,0 +1,90 @@
+/**
+ * @file http_bench.cpp
+ * @brief Request parsing over captured corpora, response serialization
+ *
+ * Each file of benchmark/corpus is one read as a client sent it: a browser
+ * navigation, an API call with a JSON body, a chunked upload, pipelined
+ * asset requests. A benchmark per file parses it from the first byte to
+ * the last request, so bytes/s and requests/s are directly comparable
+ * between releases.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <string>
+
+#include "bench_support.hpp"
+
+using namespace cppress;
+
+namespace {
+const char* const corpora[] = {"curl_get", "browser_get", "api_post_json", "chunked_upload",
+                               "pipelined_gets"};
+
+void parse_corpus(benchmark::State& state, const std::string& name) {
+    const std::string raw = bench::read_file(bench::source_path("benchmark/corpus/" + name + ".http"));
+    const sockets::data_buffer data(raw);
+    http::http_request_parser parser;
+    auto conn = std::make_shared<sockets::connection>();
+
+    std::size_t requests = 0;
+    for (auto _ : state) {
+        auto result = parser.parse(conn, data);
+        for (;;) {
+            if (!result.is_complete) {
+                state.SkipWithError(("incomplete request in corpus " + name).c_str());
+                return;
+            }
+            ++requests;
+            benchmark::DoNotOptimize(result);
+            if (!result.has_next)
+                break;
+            result = parser.parse_next(conn);
+        }
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * raw.size()));
+    state.counters["requests"] =
+        benchmark::Counter(static_cast<double>(requests), benchmark::Counter::kIsRate);
+}
+
+const bool corpora_registered = []() {
+    for (const char* name : corpora)
+        benchmark::RegisterBenchmark(("http_request_parser::parse/" + std::string(name)).c_str(),
+                                     parse_corpus, std::string(name));
+    return true;
+}();
+
+/// A JSON reply as handlers build it: status, five headers, small body
+http::http_response& json_reply() {
+    static bench::exchange pair = bench::capture_exchange(
+        "GET /api/v1/orders/48213 HTTP/1.1\r\nHost: api.example.com\r\n\r\n");
+    static bool filled = false;
+    if (!filled) {
+        auto& res = *pair.response;
+        res.set_status(200, "OK");
+        res.add_header("Content-Type", "application/json; charset=utf-8");
+        res.add_header("Cache-Control", "no-store");
+        res.add_header("X-Request-Id", "7d0f3c52-9a1b-4f3e-8e2d-1c6b5a4f3e2d");
+        res.add_header("Vary", "Accept-Encoding");
+        res.add_header("Connection", "keep-alive");
+        res.set_body("{\"id\":48213,\"status\":\"shipped\",\"total\":\"47.30\",\"currency\":\"EUR\"}");
+        filled = true;
+    }
+    return *pair.response;
+}
+
+void BM_http_response_to_string(benchmark::State& state) {
+    const auto& res = json_reply();
+    std::size_t bytes = 0;
+    bench::allocation_counter allocations;
+    for (auto _ : state) {
+        auto text = res.to_string();
+        bytes += text.size();
+        benchmark::DoNotOptimize(text);
+    }
+    allocations.report(state);
+    state.SetBytesProcessed(static_cast<int64_t>(bytes));
+}
+BENCHMARK(BM_http_response_to_string);
+}  // namespace
@@ -0,0 +1,64 @@
+/**
+ * @file json_bench.cpp
+ * @brief JSON parsing and serialization over libs/sockets/5mb.json
+ *
+ * The sample is an array of person records; json::parse() only accepts an
+ * object at the root, so it is measured on the same records wrapped in one.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+
+#include "bench_support.hpp"
+#include "json/includes.hpp"
+
+using namespace cppress;
+
+namespace {
+const std::string& sample() {
+    static const std::string text = bench::read_file(bench::source_path("libs/sockets/5mb.json"));
+    return text;
+}
+
+const std::string& sample_object() {
+    static const std::string text = "{\"people\": " + sample() + "}";
+    return text;
+}
+
+void BM_json_parse(benchmark::State& state) {
+    const auto& text = sample_object();
+    for (auto _ : state) {
+        auto root = json::parse(text);
+        benchmark::DoNotOptimize(root);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * text.size()));
+}
+BENCHMARK(BM_json_parse)->Unit(benchmark::kMicrosecond);
+
+void BM_json_value(benchmark::State& state) {
+    const auto& text = sample();
+    for (auto _ : state) {
+        auto value = json::json_value(text);
+        benchmark::DoNotOptimize(value);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * text.size()));
+}
+BENCHMARK(BM_json_value)->Unit(benchmark::kMicrosecond);
+
+void BM_json_stringify(benchmark::State& state) {
+    auto value = json::json_value(sample());
+    if (!value) {
+        state.SkipWithError("libs/sockets/5mb.json did not parse");
+        return;
+    }
+    std::size_t bytes = 0;
+    for (auto _ : state) {
+        auto text = value->stringify();
+        bytes += text.size();
+        benchmark::DoNotOptimize(text);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(bytes));
+}
+BENCHMARK(BM_json_stringify)->Unit(benchmark::kMicrosecond);
+}  // namespace
@@ -0,0 +1,121 @@
+#pragma once
+
+/**
+ * @file latency_histogram.hpp
+ * @brief HdrHistogram-style latency recording, three significant digits
+ *
+ * Values are counted in log-linear buckets: each power of two is split
+ * into 1024 linear steps, so any recorded value is reproduced within
+ * 0.1% while the whole range, 1 ns to an hour, fits in a fixed array.
+ * The layout and percentile rules follow HdrHistogram, so results compare
+ * with wrk2 and other tools built on it.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace cppress::load {
+
+class latency_histogram {
+public:
+    /// Largest value tracked, larger ones are counted as this
+    static constexpr std::uint64_t highest = 3'600'000'000'000ULL;  // one hour in ns
+
+    latency_histogram() : counts(counts_length, 0) {}
+
+    /// @brief Count one value, in nanoseconds
+    void record(std::uint64_t value) noexcept {
+        value = std::min(value, highest);
+        ++counts[index_of(value)];
+        ++total;
+        sum += static_cast<double>(value);
+        max_value = std::max(max_value, value);
+    }
+
+    /**
+     * @brief Count a value and the samples a stalled closed loop failed to take
+     * @param value Measured latency
+     * @param expected_interval Time between requests the load meant to keep
+     *
+     * While one request stalls, the requests that would have been issued
+     * every expected_interval are not sent at all; they are added with the
+     * latency they would have seen, as HdrHistogram's
+     * recordValueWithExpectedInterval does.
+     */
+    void record_corrected(std::uint64_t value, std::uint64_t expected_interval) noexcept {
+        record(value);
+        if (expected_interval == 0 || value <= expected_interval)
+            return;
+        for (std::uint64_t missing = value - expected_interval; missing >= expected_interval;
+             missing -= expected_interval)
+            record(missing);
+    }
+
+    /// @brief Add the counts of another histogram
+    void merge(const latency_histogram& other) noexcept {
+        for (std::size_t i = 0; i < counts.size(); ++i)
+            counts[i] += other.counts[i];
+        total += other.total;
+        sum += other.sum;
+        max_value = std::max(max_value, other.max_value);
+    }
+
+    std::uint64_t count() const noexcept { return total; }
+
+    std::uint64_t max() const noexcept { return max_value; }
+
+    double mean() const noexcept { return total ? sum / static_cast<double>(total) : 0.0; }
+
+    /**
+     * @brief Smallest value that percentile percent of the samples do not exceed
+     * @param percentile 0 to 100
+     * @return The highest value equivalent to the bucket reached, 0 when empty
+     */
+    std::uint64_t value_at_percentile(double percentile) const noexcept {
+        if (total == 0)
+            return 0;
+        percentile = std::min(std::max(percentile, 0.0), 100.0);
+        auto wanted = static_cast<std::uint64_t>(
+            std::ceil(percentile / 100.0 * static_cast<double>(total)));
+        wanted = std::max<std::uint64_t>(wanted, 1);
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < counts.size(); ++i) {
+            seen += counts[i];
+            if (seen >= wanted)
+                return std::min(highest_equivalent(i), max_value);
+        }
+        return max_value;
+    }
+
+private:
+    static constexpr int sub_bucket_magnitude = 11;  // 2048 sub-buckets: 3 digits
+    static constexpr std::uint64_t sub_bucket_count = 1ULL << sub_bucket_magnitude;
+    static constexpr std::uint64_t sub_bucket_half = sub_bucket_count / 2;
+    static constexpr int bucket_count = 32;  // 2048 << 31 covers highest
+    static constexpr std::size_t counts_length = (bucket_count + 1) * sub_bucket_half;
+
+    std::vector<std::uint64_t> counts;
+    std::uint64_t total = 0;
+    double sum = 0;
+    std::uint64_t max_value = 0;
+
+    static std::size_t index_of(std::uint64_t value) noexcept {
+        int bucket = 63 - __builtin_clzll(value | (sub_bucket_count - 1)) - sub_bucket_magnitude + 1;
+        auto sub_bucket = static_cast<std::size_t>(value >> bucket);
+        return (static_cast<std::size_t>(bucket) << (sub_bucket_magnitude - 1)) + sub_bucket;
+    }
+
+    static std::uint64_t highest_equivalent(std::size_t index) noexcept {
+        int bucket = static_cast<int>(index >> (sub_bucket_magnitude - 1)) - 1;
+        std::uint64_t sub_bucket = (index & (sub_bucket_half - 1)) + sub_bucket_half;
+        if (bucket < 0) {
+            sub_bucket -= sub_bucket_half;
+            bucket = 0;
+        }
+        return (sub_bucket << bucket) + (1ULL << bucket) - 1;
+    }
+};
+
+}  // namespace cppress::load
@@ -0,0 +1,419 @@
+#include "load_generator.hpp"
+
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <deque>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <thread>
+
+#include "response_framer.hpp"
+#include "sockets/includes.hpp"
+
+namespace cppress::load {
+
+void load_results::merge(const load_results& other) {
+    corrected.merge(other.corrected);
+    measured.merge(other.measured);
+    responses += other.responses;
+    bytes_read += other.bytes_read;
+    for (int i = 0; i < 6; ++i)
+        status[i] += other.status[i];
+    connect_errors += other.connect_errors;
+    read_errors += other.read_errors;
+    write_errors += other.write_errors;
+    protocol_errors += other.protocol_errors;
+    unfinished += other.unfinished;
+}
+
+namespace {
+std::uint64_t now_ns() {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                          std::chrono::steady_clock::now().time_since_epoch())
+                                          .count());
+}
+
+struct in_flight {
+    std::uint64_t due;
+    std::uint64_t sent;
+    bool head;
+};
+
+struct client {
+    sockets::connection conn;
+    bool open = false;
+    std::uint64_t retry_at = 0;
+
+    std::string out;
+    std::size_t out_offset = 0;
+    bool watching_writes = false;
+
+    /// Requests written or queued, oldest first; the framer reads the front's response
+    std::deque<in_flight> pending;
+    response_framer framer;
+
+    /// Position in the request sequence
+    std::size_t next_template = 0;
+
+    /// Open loop: when the next request is due
+    std::uint64_t next_due = 0;
+};
+
+/**
+ * @brief One thread's share of the connections, driven by its own epoll loop
+ */
+class worker {
+public:
+    worker(const load_options& options, const std::vector<std::size_t>& sequence)
+        : options(options),
+          sequence(sequence),
+          address(sockets::port(options.port), sockets::ip_address(options.host)),
+          depth(options.keep_alive ? std::max(1u, options.pipeline) : 1u) {
+        epoll_fd = ::epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd < 0)
+            throw std::runtime_error("epoll_create1 failed");
+    }
+
+    ~worker() { ::close(epoll_fd); }
+
+    worker(const worker&) = delete;
+    worker& operator=(const worker&) = delete;
+
+    /// @brief Adds a connection and opens it
+    bool add_client(std::size_t index) {
+        auto c = std::make_unique<client>();
+        c->next_template = (index * 7919) % sequence.size();
+        bool opened = open(*c, 0);
+        clients.push_back(std::move(c));
+        return opened;
+    }
+
+    /**
+     * @brief Drives the load until end
+     * @param start When the warm-up begins
+     * @param window_start When measuring begins
+     * @param end When measuring, and the run, end
+     */
+    void run(std::uint64_t start, std::uint64_t window_start, std::uint64_t end) {
+        this->window_start = window_start;
+        this->window_end = end;
+        if (options.rate > 0) {
+            interval = static_cast<std::uint64_t>(1e9 * static_cast<double>(options.connections) /
+                                                  options.rate);
+            // staggered, so the connections do not fire together
+            for (std::size_t i = 0; i < clients.size(); ++i)
+                clients[i]->next_due = start + interval * i / std::max<std::size_t>(1, clients.size());
+        }
+
+        epoll_event events[256];
+        bool measuring = false;
+        std::uint64_t warm_responses = 0;
+        for (;;) {
+            std::uint64_t now = now_ns();
+            if (now >= end)
+                break;
+            if (!measuring && now >= window_start) {
+                measuring = true;
+                warm_responses = responses_seen;
+                if (options.rate <= 0 && warm_responses > 0) {
+                    // closed loop: the pace each slot kept while warming up is
+                    // the interval a stalled request keeps others from using
+                    expected_interval = static_cast<std::uint64_t>(
+                        static_cast<double>(window_start - start) *
+                        static_cast<double>(clients.size() * depth) /
+                        static_cast<double>(warm_responses));
+                }
+            }
+
+            std::uint64_t next_wake = now + 10'000'000;
+            for (auto& c : clients)
+                next_wake = std::min(next_wake, service(*c, now));
+
+            now = now_ns();
+            int timeout = next_wake > now ? static_cast<int>((next_wake - now) / 1'000'000) : 0;
+            int ready = ::epoll_wait(epoll_fd, events, 256, timeout);
+            now = now_ns();
+            for (int i = 0; i < ready; ++i) {
+                auto* c = static_cast<client*>(events[i].data.ptr);
+                if (!c->open)
+                    continue;
+                if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+                    read_from(*c, now);
+                if (c->open && (events[i].events & EPOLLOUT))
+                    flush(*c);
+            }
+        }
+
+        for (auto& c : clients)
+            for (const auto& request : c->pending)
+                if (request.due >= window_start && request.due < window_end)
+                    ++results.unfinished;
+    }
+
+    load_results results;
+
+private:
+    const load_options& options;
+    const std::vector<std::size_t>& sequence;
+    sockets::socket_address address;
+    const unsigned depth;
+    int epoll_fd = -1;
+    std::vector<std::unique_ptr<client>> clients;
+
+    std::uint64_t interval = 0;           // open loop, per connection
+    std::uint64_t expected_interval = 0;  // closed loop correction
+    std::uint64_t window_start = 0;
+    std::uint64_t window_end = 0;
+    std::uint64_t responses_seen = 0;
+
+    bool in_window(std::uint64_t time) const noexcept {
+        return time >= window_start && time < window_end;
+    }
+
+    bool open(client& c, std::uint64_t now) {
+        try {
+            // a fresh object: a closed connection does not track a new descriptor
+            c.conn = sockets::connection();
+            c.conn.connect(address);
+        } catch (const std::exception&) {
+            ++results.connect_errors;
+            c.retry_at = now + 10'000'000;
+            return false;
+        }
+        int fd = c.conn.native_handle();
+        ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+        int one = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.ptr = &c;
+        ::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event);
+        c.open = true;
+        c.watching_writes = false;
+        c.out.clear();
+        c.out_offset = 0;
+        c.framer.reset();
+        return true;
+    }
+
+    /// Closes the connection; requests still pending on it are lost
+    void close(client& c, std::uint64_t* lost_errors) {
+        ::epoll_ctl(epoll_fd, EPOLL_CTL_DEL, c.conn.native_handle(), nullptr);
+        c.conn.close();
+        c.open = false;
+        if (lost_errors && !c.pending.empty())
+            ++*lost_errors;
+        c.pending.clear();
+    }
+
+    /**
+     * @brief Reopens, issues what is due and writes it
+     * @return When this connection next needs attention
+     */
+    std::uint64_t service(client& c, std::uint64_t now) {
+        if (!c.open) {
+            if (now < c.retry_at || !open(c, now))
+                return c.retry_at;
+        }
+        if (options.rate <= 0) {
+            while (c.pending.size() < depth)
+                issue(c, now, now);
+        } else {
+            while (c.next_due <= now && c.pending.size() < depth) {
+                issue(c, c.next_due, now);
+                c.next_due += interval;
+            }
+        }
+        if (c.out_offset < c.out.size())
+            flush(c);
+        if (options.rate > 0 && c.pending.size() < depth)
+            return c.next_due;
+        return now + 10'000'000;
+    }
+
+    void issue(client& c, std::uint64_t due, std::uint64_t now) {
+        const auto& request = options.mix[sequence[c.next_template]];
+        c.next_template = (c.next_template + 1) % sequence.size();
+        if (c.out_offset == c.out.size()) {
+            c.out.clear();
+            c.out_offset = 0;
+        }
+        c.out += request.bytes;
+        if (c.pending.empty())
+            c.framer.reset(request.head);
+        c.pending.push_back(in_flight{due, now, request.head});
+    }
+
+    void flush(client& c) {
+        while (c.out_offset < c.out.size()) {
+            ssize_t n = ::send(c.conn.native_handle(), c.out.data() + c.out_offset,
+                               c.out.size() - c.out_offset, MSG_NOSIGNAL);
+            if (n > 0) {
+                c.out_offset += static_cast<std::size_t>(n);
+                continue;
+            }
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                watch_writes(c, true);
+                return;
+            }
+            ++results.write_errors;
+            close(c, nullptr);
+            return;
+        }
+        watch_writes(c, false);
+    }
+
+    void watch_writes(client& c, bool enable) {
+        if (c.watching_writes == enable)
+            return;
+        epoll_event event{};
+        event.events = enable ? EPOLLIN | EPOLLOUT : EPOLLIN;
+        event.data.ptr = &c;
+        ::epoll_ctl(epoll_fd, EPOLL_CTL_MOD, c.conn.native_handle(), &event);
+        c.watching_writes = enable;
+    }
+
+    void read_from(client& c, std::uint64_t now) {
+        char buffer[64 * 1024];
+        for (;;) {
+            ssize_t n = ::recv(c.conn.native_handle(), buffer, sizeof(buffer), 0);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                return;
+            if (n <= 0) {
+                // the server closed: ends a body delimited by the close, else loses requests
+                c.framer.finish();
+                if (!c.pending.empty() && c.framer.complete()) {
+                    complete(c, now);
+                    return;
+                }
+                close(c, n < 0 ? &results.read_errors : (c.pending.empty() ? nullptr
+                                                                            : &results.read_errors));
+                return;
+            }
+            if (in_window(now))
+                results.bytes_read += static_cast<std::uint64_t>(n);
+
+            std::size_t used = 0;
+            const auto size = static_cast<std::size_t>(n);
+            while (used < size) {
+                if (c.pending.empty()) {
+                    ++results.protocol_errors;  // bytes nobody asked for
+                    close(c, nullptr);
+                    return;
+                }
+                used += c.framer.feed(buffer + used, size - used);
+                if (c.framer.failed()) {
+                    ++results.protocol_errors;
+                    close(c, nullptr);
+                    return;
+                }
+                if (c.framer.complete() && !complete(c, now))
+                    return;
+            }
+        }
+    }
+
+    /**
+     * @brief Accounts for the response at the front
+     * @return false if the connection was closed after it
+     */
+    bool complete(client& c, std::uint64_t now) {
+        in_flight request = c.pending.front();
+        c.pending.pop_front();
+        ++responses_seen;
+
+        if (in_window(request.due)) {
+            ++results.responses;
+            int status_class = c.framer.status() / 100;
+            if (status_class >= 1 && status_class <= 5)
+                ++results.status[status_class];
+            results.measured.record(now - request.sent);
+            results.corrected.record_corrected(now - request.due, expected_interval);
+        }
+
+        bool closes = c.framer.closes() || !options.keep_alive;
+        if (closes) {
+            close(c, &results.read_errors);  // pipelined requests behind it are lost
+            return false;
+        }
+        if (!c.pending.empty())
+            c.framer.reset(c.pending.front().head);
+        else
+            c.framer.reset();
+        return true;
+    }
+};
+
+/// Template indices in a fixed shuffled order that honors the weights
+std::vector<std::size_t> mix_sequence(const std::vector<request_template>& mix) {
+    std::vector<std::size_t> sequence;
+    for (std::size_t i = 0; i < mix.size(); ++i)
+        sequence.insert(sequence.end(), std::max(1u, mix[i].weight), i);
+    std::mt19937 shuffle(12345);  // same order on every run
+    std::shuffle(sequence.begin(), sequence.end(), shuffle);
+    return sequence;
+}
+}  // namespace
+
+/**
+ * Implementation Notes:
+ * - Connections are opened before the clock starts, so connect time is not
+ *   part of the warm-up
+ * - Each worker records into its own histograms; they are merged once at
+ *   the end, so the hot path takes no locks
+ */
+load_results run_load(const load_options& options) {
+    if (options.mix.empty())
+        throw std::invalid_argument("The request mix is empty");
+    if (options.connections == 0)
+        throw std::invalid_argument("At least one connection is needed");
+
+    sockets::initialize_socket_library();
+    const auto sequence = mix_sequence(options.mix);
+    const unsigned thread_count = std::max(1u, std::min(options.threads, options.connections));
+
+    std::vector<std::unique_ptr<worker>> workers;
+    for (unsigned t = 0; t < thread_count; ++t)
+        workers.push_back(std::make_unique<worker>(options, sequence));
+    std::size_t opened = 0;
+    for (unsigned i = 0; i < options.connections; ++i)
+        opened += workers[i % thread_count]->add_client(i) ? 1 : 0;
+    if (opened == 0)
+        throw std::runtime_error("Cannot connect to " + options.host + ":" +
+                                 std::to_string(options.port));
+
+    const std::uint64_t start = now_ns();
+    const std::uint64_t window_start =
+        start + static_cast<std::uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(options.warmup).count());
+    const std::uint64_t end =
+        window_start + static_cast<std::uint64_t>(
+                           std::chrono::duration_cast<std::chrono::nanoseconds>(options.duration)
+                               .count());
+
+    std::vector<std::thread> threads;
+    for (auto& w : workers)
+        threads.emplace_back([&w, start, window_start, end]() { w->run(start, window_start, end); });
+    for (auto& t : threads)
+        t.join();
+
+    load_results total;
+    total.seconds = std::chrono::duration<double>(options.duration).count();
+    for (auto& w : workers)
+        total.merge(w->results);
+    return total;
+}
+
+}  // namespace cppress::load
@@ -0,0 +1,100 @@
+#pragma once
+
+/**
+ * @file load_generator.hpp
+ * @brief Closed- and open-loop HTTP/1.1 load against one server
+ *
+ * Each thread runs its own epoll loop over its share of the connections,
+ * so the generator scales with cores instead of becoming the bottleneck.
+ *
+ * Closed loop (rate == 0): every connection keeps pipeline requests in
+ * flight and sends the next one as soon as a response arrives. This finds
+ * the throughput limit. Latency is taken from the moment a request is sent.
+ *
+ * Open loop (rate > 0): requests follow a fixed schedule whatever the
+ * server does. A request that cannot be sent on time because its
+ * connection is still busy is sent late, but its latency is counted from
+ * when it was due. That is the coordinated-omission correction: a stall
+ * shows up in the tail as it would for real users, not as one slow sample.
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "latency_histogram.hpp"
+
+namespace cppress::load {
+
+/// One kind of request of the mix
+struct request_template {
+    /// Complete request bytes, head and body
+    std::string bytes;
+
+    /// HEAD responses have no body
+    bool head = false;
+
+    /// Share of the mix, relative to the other templates
+    unsigned weight = 1;
+};
+
+struct load_options {
+    std::string host = "127.0.0.1";
+    int port = 8080;
+
+    unsigned threads = 1;
+    unsigned connections = 64;
+
+    /// Requests in flight per connection, pipelined when above one
+    unsigned pipeline = 1;
+
+    /// Reuse connections; otherwise each request gets its own
+    bool keep_alive = true;
+
+    /// Requests per second over all connections, 0 for closed loop
+    double rate = 0;
+
+    std::chrono::seconds warmup{2};
+    std::chrono::seconds duration{10};
+
+    std::vector<request_template> mix;
+};
+
+struct load_results {
+    /// Latency from when each request was due; equals measured in closed loop
+    latency_histogram corrected;
+
+    /// Latency from when each request was written
+    latency_histogram measured;
+
+    /// Length of the measured window
+    double seconds = 0;
+
+    std::uint64_t responses = 0;
+    std::uint64_t bytes_read = 0;
+
+    /// Responses by status class: index 1 for 1xx to 5 for 5xx
+    std::uint64_t status[6] = {};
+
+    std::uint64_t connect_errors = 0;
+    std::uint64_t read_errors = 0;
+    std::uint64_t write_errors = 0;
+
+    /// Malformed responses
+    std::uint64_t protocol_errors = 0;
+
+    /// Requests due in the window that were still unanswered at its end
+    std::uint64_t unfinished = 0;
+
+    void merge(const load_results& other);
+};
+
+/**
+ * @brief Runs the warm-up and the measured window
+ * @throws std::invalid_argument for an empty mix or zero connections
+ * @throws std::runtime_error if no connection can be opened at all
+ */
+load_results run_load(const load_options& options);
+
+}  // namespace cppress::load
@@ -0,0 +1,278 @@
+/**
+ * @file main.cpp
+ * @brief cppress-load: HTTP/1.1 load generator and latency profiler
+ *
+ * Usage: cppress-load [options] http://host:port[/path]
+ *
+ *   -c, --connections N   open connections (64)
+ *   -t, --threads N       generator threads (half the cores)
+ *   -d, --duration S      measured seconds (10)
+ *   -w, --warmup S        seconds before measuring (2)
+ *   -R, --rate N          requests/s over all connections: open loop;
+ *                         0 runs closed loop (0)
+ *   -p, --pipeline N      requests in flight per connection (1)
+ *   -k, --no-keepalive    one request per connection
+ *   -H, --header "N: v"   added to every request, repeatable
+ *   -r, --request SPEC    "[weight:]METHOD PATH[ @body-file]", repeatable;
+ *                         the mix is sent in a fixed shuffled order
+ *   -j, --json FILE       also write the results as JSON
+ *
+ * Examples:
+ *   cppress-load -c 256 -t 4 -p 8 http://127.0.0.1:8080/
+ *   cppress-load -R 50000 -r "9:GET /api/items" -r "1:POST /api/items @item.json" \
+ *                http://127.0.0.1:8080
+ */
+
+#include <getopt.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "load_generator.hpp"
+
+using namespace cppress::load;
+
+namespace {
+void usage() {
+    std::fprintf(stderr,
+                 "Usage: cppress-load [-c conns] [-t threads] [-d secs] [-w secs] [-R rate] "
+                 "[-p depth] [-k] [-H header]... [-r spec]... [-j file] http://host:port[/path]\n");
+}
+
+std::string read_body(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        throw std::runtime_error("Cannot read request body: " + path);
+    std::ostringstream content;
+    content << file.rdbuf();
+    return content.str();
+}
+
+/// "http://host:port/path" into its parts; the path defaults to "/"
+void parse_url(const std::string& url, load_options& options, std::string& path) {
+    std::string rest = url;
+    if (rest.rfind("http://", 0) == 0)
+        rest = rest.substr(7);
+    else if (rest.find("://") != std::string::npos)
+        throw std::invalid_argument("Only http:// URLs are supported: " + url);
+    std::size_t slash = rest.find('/');
+    path = slash == std::string::npos ? "/" : rest.substr(slash);
+    std::string authority = rest.substr(0, slash);
+    std::size_t colon = authority.rfind(':');
+    options.host = authority.substr(0, colon);
+    options.port = colon == std::string::npos ? 80 : std::atoi(authority.c_str() + colon + 1);
+    if (options.host == "localhost")
+        options.host = "127.0.0.1";
+}
+
+request_template build_request(const std::string& spec, const load_options& options,
+                               const std::vector<std::string>& headers) {
+    request_template request;
+    std::string rest = spec;
+    std::size_t colon = rest.find(':');
+    std::size_t space = rest.find(' ');
+    if (colon != std::string::npos && colon < space) {
+        request.weight = static_cast<unsigned>(std::max(1, std::atoi(rest.substr(0, colon).c_str())));
+        rest = rest.substr(colon + 1);
+    }
+    std::istringstream words(rest);
+    std::string method, target, body_ref;
+    words >> method >> target >> body_ref;
+    if (method.empty() || target.empty())
+        throw std::invalid_argument("Bad request spec: " + spec);
+    std::string body;
+    if (!body_ref.empty() && body_ref[0] == '@')
+        body = read_body(body_ref.substr(1));
+
+    std::string bytes = method + " " + target + " HTTP/1.1\r\nHost: " + options.host + ":" +
+                        std::to_string(options.port) + "\r\n";
+    if (!options.keep_alive)
+        bytes += "Connection: close\r\n";
+    for (const auto& header : headers)
+        bytes += header + "\r\n";
+    if (!body.empty() || method == "POST" || method == "PUT" || method == "PATCH")
+        bytes += "Content-Length: " + std::to_string(body.size()) + "\r\n";
+    bytes += "\r\n" + body;
+
+    request.bytes = std::move(bytes);
+    request.head = method == "HEAD";
+    return request;
+}
+
+std::string format_ns(std::uint64_t ns) {
+    char text[32];
+    if (ns < 1'000)
+        std::snprintf(text, sizeof(text), "%lluns", static_cast<unsigned long long>(ns));
+    else if (ns < 1'000'000)
+        std::snprintf(text, sizeof(text), "%.2fus", static_cast<double>(ns) / 1e3);
+    else if (ns < 1'000'000'000)
+        std::snprintf(text, sizeof(text), "%.2fms", static_cast<double>(ns) / 1e6);
+    else
+        std::snprintf(text, sizeof(text), "%.2fs", static_cast<double>(ns) / 1e9);
+    return text;
+}
+
+const double percentiles[] = {50, 90, 99, 99.9, 99.99};
+
+void print_latency(const char* label, const latency_histogram& h) {
+    std::printf("  %-10s", label);
+    for (double p : percentiles)
+        std::printf(" %10s", format_ns(h.value_at_percentile(p)).c_str());
+    std::printf(" %10s %10s\n", format_ns(h.max()).c_str(),
+                format_ns(static_cast<std::uint64_t>(h.mean())).c_str());
+}
+
+void print_report(const load_options& options, const load_results& r) {
+    std::printf("%u threads, %u connections, pipeline %u, %s, %s, %llds (+%llds warm-up)\n",
+                options.threads, options.connections, options.pipeline,
+                options.keep_alive ? "keep-alive" : "close", options.rate > 0 ? "open loop" : "closed loop",
+                static_cast<long long>(options.duration.count()),
+                static_cast<long long>(options.warmup.count()));
+    if (options.rate > 0)
+        std::printf("  target     %.1f req/s\n", options.rate);
+    std::printf("  requests   %llu  %.1f req/s\n", static_cast<unsigned long long>(r.responses),
+                static_cast<double>(r.responses) / r.seconds);
+    std::printf("  transfer   %.2f MB  %.2f MB/s\n", static_cast<double>(r.bytes_read) / 1e6,
+                static_cast<double>(r.bytes_read) / 1e6 / r.seconds);
+    std::printf("  status     1xx %llu  2xx %llu  3xx %llu  4xx %llu  5xx %llu\n",
+                static_cast<unsigned long long>(r.status[1]),
+                static_cast<unsigned long long>(r.status[2]),
+                static_cast<unsigned long long>(r.status[3]),
+                static_cast<unsigned long long>(r.status[4]),
+                static_cast<unsigned long long>(r.status[5]));
+    std::printf("  errors     connect %llu  read %llu  write %llu  protocol %llu  unfinished %llu\n",
+                static_cast<unsigned long long>(r.connect_errors),
+                static_cast<unsigned long long>(r.read_errors),
+                static_cast<unsigned long long>(r.write_errors),
+                static_cast<unsigned long long>(r.protocol_errors),
+                static_cast<unsigned long long>(r.unfinished));
+    std::printf("  latency    %10s %10s %10s %10s %10s %10s %10s\n", "p50", "p90", "p99", "p99.9",
+                "p99.99", "max", "mean");
+    print_latency("corrected", r.corrected);
+    print_latency("measured", r.measured);
+}
+
+void write_histogram_json(std::ostream& out, const latency_histogram& h) {
+    out << "{\"count\":" << h.count() << ",\"mean_ns\":" << static_cast<std::uint64_t>(h.mean())
+        << ",\"max_ns\":" << h.max() << ",\"percentiles_ns\":{";
+    const char* separator = "";
+    for (double p : percentiles) {
+        out << separator << "\"" << p << "\":" << h.value_at_percentile(p);
+        separator = ",";
+    }
+    out << "}}";
+}
+
+void write_json(const std::string& path, const load_options& options, const load_results& r) {
+    std::ofstream out(path);
+    if (!out)
+        throw std::runtime_error("Cannot write " + path);
+    out << "{\"options\":{\"host\":\"" << options.host << "\",\"port\":" << options.port
+        << ",\"threads\":" << options.threads << ",\"connections\":" << options.connections
+        << ",\"pipeline\":" << options.pipeline
+        << ",\"keep_alive\":" << (options.keep_alive ? "true" : "false")
+        << ",\"rate\":" << options.rate << ",\"warmup_s\":" << options.warmup.count()
+        << ",\"duration_s\":" << options.duration.count() << "},";
+    out << "\"seconds\":" << r.seconds << ",\"responses\":" << r.responses
+        << ",\"requests_per_second\":" << static_cast<double>(r.responses) / r.seconds
+        << ",\"bytes_read\":" << r.bytes_read << ",\"status\":{\"1xx\":" << r.status[1]
+        << ",\"2xx\":" << r.status[2] << ",\"3xx\":" << r.status[3] << ",\"4xx\":" << r.status[4]
+        << ",\"5xx\":" << r.status[5] << "},\"errors\":{\"connect\":" << r.connect_errors
+        << ",\"read\":" << r.read_errors << ",\"write\":" << r.write_errors
+        << ",\"protocol\":" << r.protocol_errors << ",\"unfinished\":" << r.unfinished << "},";
+    out << "\"latency_corrected\":";
+    write_histogram_json(out, r.corrected);
+    out << ",\"latency_measured\":";
+    write_histogram_json(out, r.measured);
+    out << "}\n";
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+    load_options options;
+    options.threads = std::max(1u, std::thread::hardware_concurrency() / 2);
+    std::vector<std::string> specs, headers;
+    std::string json_path;
+
+    const option long_options[] = {{"connections", required_argument, nullptr, 'c'},
+                                   {"threads", required_argument, nullptr, 't'},
+                                   {"duration", required_argument, nullptr, 'd'},
+                                   {"warmup", required_argument, nullptr, 'w'},
+                                   {"rate", required_argument, nullptr, 'R'},
+                                   {"pipeline", required_argument, nullptr, 'p'},
+                                   {"no-keepalive", no_argument, nullptr, 'k'},
+                                   {"header", required_argument, nullptr, 'H'},
+                                   {"request", required_argument, nullptr, 'r'},
+                                   {"json", required_argument, nullptr, 'j'},
+                                   {"help", no_argument, nullptr, 'h'},
+                                   {nullptr, 0, nullptr, 0}};
+    int opt;
+    while ((opt = getopt_long(argc, argv, "c:t:d:w:R:p:kH:r:j:h", long_options, nullptr)) != -1) {
+        switch (opt) {
+            case 'c':
+                options.connections = static_cast<unsigned>(std::atoi(optarg));
+                break;
+            case 't':
+                options.threads = static_cast<unsigned>(std::max(1, std::atoi(optarg)));
+                break;
+            case 'd':
+                options.duration = std::chrono::seconds(std::max(1, std::atoi(optarg)));
+                break;
+            case 'w':
+                options.warmup = std::chrono::seconds(std::max(0, std::atoi(optarg)));
+                break;
+            case 'R':
+                options.rate = std::atof(optarg);
+                break;
+            case 'p':
+                options.pipeline = static_cast<unsigned>(std::max(1, std::atoi(optarg)));
+                break;
+            case 'k':
+                options.keep_alive = false;
+                break;
+            case 'H':
+                headers.emplace_back(optarg);
+                break;
+            case 'r':
+                specs.emplace_back(optarg);
+                break;
+            case 'j':
+                json_path = optarg;
+                break;
+            default:
+                usage();
+                return opt == 'h' ? 0 : 2;
+        }
+    }
+    if (optind != argc - 1) {
+        usage();
+        return 2;
+    }
+
+    try {
+        std::string path;
+        parse_url(argv[optind], options, path);
+        if (specs.empty())
+            specs.push_back("GET " + path);
+        for (const auto& spec : specs)
+            options.mix.push_back(build_request(spec, options, headers));
+        options.threads = std::min(options.threads, std::max(1u, options.connections));
+
+        std::printf("cppress-load %s\n", argv[optind]);
+        load_results results = run_load(options);
+        print_report(options, results);
+        if (!json_path.empty())
+            write_json(json_path, options, results);
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "cppress-load: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,191 @@
+#include "response_framer.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+
+namespace cppress::load {
+
+namespace {
+bool equals_ignore_case(std::string_view a, std::string_view b) noexcept {
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+               return (x | 0x20) == (y | 0x20);
+           });
+}
+
+bool contains_token(std::string_view value, std::string_view token) noexcept {
+    for (std::size_t i = 0; i + token.size() <= value.size(); ++i)
+        if (equals_ignore_case(value.substr(i, token.size()), token))
+            return true;
+    return false;
+}
+
+std::string_view trim(std::string_view s) noexcept {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t'))
+        s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t' || s.back() == '\r'))
+        s.remove_suffix(1);
+    return s;
+}
+}  // namespace
+
+void response_framer::reset(bool head_request) noexcept {
+    state_ = state::head;
+    line_.clear();
+    left_ = 0;
+    status_ = 0;
+    closes_ = false;
+    head_request_ = head_request;
+}
+
+void response_framer::finish() noexcept {
+    if (state_ == state::until_close)
+        state_ = state::done;
+    else if (state_ != state::done)
+        state_ = state::failed;
+}
+
+std::size_t response_framer::feed(const char* data, std::size_t size) {
+    std::size_t used = 0;
+    while (used < size && state_ != state::done && state_ != state::failed) {
+        const char* at = data + used;
+        std::size_t available = size - used;
+        switch (state_) {
+            case state::head:
+                used += feed_head(at, available);
+                break;
+            case state::body:
+            case state::chunk_data: {
+                std::size_t take = std::min(left_, available);
+                left_ -= take;
+                used += take;
+                if (left_ == 0)
+                    state_ = state_ == state::body ? state::done : state::chunk_size;
+                break;
+            }
+            case state::chunk_size:
+            case state::trailers:
+                used += feed_line(at, available);
+                break;
+            case state::until_close:
+                used = size;
+                break;
+            default:
+                break;
+        }
+    }
+    return used;
+}
+
+/**
+ * Implementation Notes:
+ * - A head that arrives whole is parsed where it lies; only one split
+ *   across reads is collected in line_
+ */
+std::size_t response_framer::feed_head(const char* data, std::size_t size) {
+    constexpr std::size_t max_head = 64 * 1024;
+    if (line_.empty()) {
+        std::string_view view(data, size);
+        std::size_t end = view.find("\r\n\r\n");
+        if (end != std::string_view::npos) {
+            if (!parse_head(view.substr(0, end + 2)))
+                state_ = state::failed;
+            return end + 4;
+        }
+    }
+    std::size_t before = line_.size();
+    line_.append(data, std::min(size, max_head + 4));
+    std::size_t end = line_.find("\r\n\r\n", before < 3 ? 0 : before - 3);
+    if (end == std::string::npos) {
+        if (line_.size() > max_head)
+            state_ = state::failed;
+        return std::min(size, max_head + 4);
+    }
+    std::string head = line_.substr(0, end + 2);
+    line_.clear();
+    if (!parse_head(head))
+        state_ = state::failed;
+    return end + 4 - before;
+}
+
+/// Parses the status line and the framing headers of a head without its final CRLF
+bool response_framer::parse_head(std::string_view head) {
+    if (head.size() < 12 || head.substr(0, 7) != "HTTP/1.")
+        return false;
+    status_ = std::atoi(std::string(head.substr(9, 3)).c_str());
+    if (status_ < 100)
+        return false;
+    closes_ = head[7] == '0';  // HTTP/1.0 closes unless told otherwise
+
+    bool chunked = false, has_length = false;
+    std::size_t length = 0;
+    std::size_t pos = head.find("\r\n") + 2;
+    while (pos < head.size()) {
+        std::size_t eol = head.find("\r\n", pos);
+        std::string_view field = head.substr(pos, eol - pos);
+        pos = eol + 2;
+        std::size_t colon = field.find(':');
+        if (colon == std::string_view::npos)
+            continue;
+        std::string_view name = field.substr(0, colon);
+        std::string_view value = trim(field.substr(colon + 1));
+        if (equals_ignore_case(name, "Content-Length")) {
+            has_length = true;
+            length = std::strtoull(std::string(value).c_str(), nullptr, 10);
+        } else if (equals_ignore_case(name, "Transfer-Encoding")) {
+            chunked = contains_token(value, "chunked");
+        } else if (equals_ignore_case(name, "Connection")) {
+            if (contains_token(value, "close"))
+                closes_ = true;
+            else if (contains_token(value, "keep-alive"))
+                closes_ = false;
+        }
+    }
+
+    if (head_request_ || status_ < 200 || status_ == 204 || status_ == 304)
+        state_ = state::done;
+    else if (chunked)
+        state_ = state::chunk_size;
+    else if (has_length) {
+        left_ = length;
+        state_ = length ? state::body : state::done;
+    } else {
+        closes_ = true;
+        state_ = state::until_close;
+    }
+    return true;
+}
+
+/// Collects a chunk-size or trailer line and acts on it once complete
+std::size_t response_framer::feed_line(const char* data, std::size_t size) {
+    const char* newline = static_cast<const char*>(std::memchr(data, '\n', size));
+    std::size_t used = newline ? static_cast<std::size_t>(newline - data) + 1 : size;
+    line_.append(data, used);
+    if (!newline) {
+        if (line_.size() > 4096)
+            state_ = state::failed;
+        return used;
+    }
+    std::string_view line = trim(std::string_view(line_).substr(0, line_.size() - 1));
+    if (state_ == state::trailers) {
+        if (line.empty())
+            state_ = state::done;
+    } else {
+        char* end = nullptr;
+        std::string digits(line.substr(0, line.find(';')));
+        unsigned long long chunk = std::strtoull(digits.c_str(), &end, 16);
+        if (digits.empty() || end == digits.c_str())
+            state_ = state::failed;
+        else if (chunk == 0)
+            state_ = state::trailers;
+        else {
+            left_ = static_cast<std::size_t>(chunk) + 2;  // data and its CRLF
+            state_ = state::chunk_data;
+        }
+    }
+    line_.clear();
+    return used;
+}
+
+}  // namespace cppress::load
@@ -0,0 +1,63 @@
+#pragma once
+
+/**
+ * @file response_framer.hpp
+ * @brief Finds where HTTP/1.1 responses end in a stream of reads
+ *
+ * The load generator only needs the status and the boundaries of each
+ * response, so bodies are counted and skipped, never stored. Handles
+ * Content-Length, chunked bodies with trailers, bodiless statuses and
+ * bodies delimited by the connection closing.
+ */
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace cppress::load {
+
+class response_framer {
+public:
+    /**
+     * @brief Consume bytes of the current response
+     * @return Bytes used; fewer than size only when the response ended or failed
+     */
+    std::size_t feed(const char* data, std::size_t size);
+
+    /// @brief The connection closed; ends a body delimited by it
+    void finish() noexcept;
+
+    /// @brief The current response is complete
+    bool complete() const noexcept { return state_ == state::done; }
+
+    /// @brief The bytes are not an HTTP/1.x response
+    bool failed() const noexcept { return state_ == state::failed; }
+
+    /// @brief Status code of the current response, 0 before its status line
+    int status() const noexcept { return status_; }
+
+    /// @brief The server closes the connection after this response
+    bool closes() const noexcept { return closes_; }
+
+    /**
+     * @brief Start on the next response
+     * @param head_request The request it answers was a HEAD, so it has no body
+     */
+    void reset(bool head_request = false) noexcept;
+
+private:
+    enum class state { head, body, chunk_size, chunk_data, trailers, until_close, done, failed };
+
+    state state_ = state::head;
+    std::string line_;  // head or chunk-size line collected so far
+    std::size_t left_ = 0;
+    int status_ = 0;
+    bool closes_ = false;
+    bool head_request_ = false;
+
+    std::size_t feed_head(const char* data, std::size_t size);
+    std::size_t feed_line(const char* data, std::size_t size);
+    bool parse_head(std::string_view head);
+};
+
+}  // namespace cppress::load
@@ -0,0 +1,86 @@
+/**
+ * @file web_bench.cpp
+ * @brief Route matching cost as the route table grows
+ *
+ * Routes are matched in registration order, so a request for the last
+ * route of 10, 100 or 1000 shows how dispatch scales with the table. The
+ * request and response come from one loopback capture and are reused; the
+ * handler returns without sending.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <string>
+
+#include "bench_support.hpp"
+#include "web/includes.hpp"
+
+using namespace cppress;
+
+namespace {
+struct routed_pair {
+    std::shared_ptr<web::request> request;
+    std::shared_ptr<web::response> response;
+};
+
+routed_pair& item_request() {
+    static routed_pair pair = []() {
+        auto captured = bench::capture_exchange(
+            "GET /api/v1/items/42?fields=name,price HTTP/1.1\r\nHost: api.example.com\r\n\r\n");
+        routed_pair made;
+        made.request = std::make_shared<web::request>(std::move(*captured.request));
+        made.response = std::make_shared<web::response>(std::move(*captured.response));
+        return made;
+    }();
+    return pair;
+}
+
+/// n - 1 routes that miss, then the one the request is for
+std::shared_ptr<web::router<>> router_with(std::int64_t n) {
+    auto router = std::make_shared<web::router<>>();
+    auto handler = [](const std::shared_ptr<web::request>&,
+                      const std::shared_ptr<web::response>&) {
+        return web::exit_code::EXIT;
+    };
+    for (std::int64_t i = 0; i + 1 < n; ++i)
+        router->get("/api/v1/resource" + std::to_string(i) + "/:id", {handler});
+    router->get("/api/v1/items/:id", {handler});
+    return router;
+}
+
+void BM_router_handle_request(benchmark::State& state) {
+    auto router = router_with(state.range(0));
+    auto& pair = item_request();
+    bench::allocation_counter allocations;
+    for (auto _ : state) {
+        bool handled = router->handle_request(pair.request, pair.response);
+        benchmark::DoNotOptimize(handled);
+    }
+    allocations.report(state);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_router_handle_request)->Arg(10)->Arg(100)->Arg(1000);
+
+void BM_match_path(benchmark::State& state) {
+    const std::int64_t n = state.range(0);
+    std::vector<std::string> expressions;
+    for (std::int64_t i = 0; i + 1 < n; ++i)
+        expressions.push_back("/api/v1/resource" + std::to_string(i) + "/:id");
+    expressions.push_back("/api/v1/items/:id");
+    const std::string path = "/api/v1/items/42";
+
+    bench::allocation_counter allocations;
+    for (auto _ : state) {
+        for (const auto& expression : expressions) {
+            auto match = web::match_path(expression, path);
+            benchmark::DoNotOptimize(match);
+            if (match.first)
+                break;
+        }
+    }
+    allocations.report(state);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_match_path)->Arg(10)->Arg(100)->Arg(1000);
+}  // namespace
@@ -20,6 +20,19 @@
  * - self_closing_element: Self-closing/void elements (img, br, hr, etc.)
  * - doctype_element: DOCTYPE declarations
  * - document: Complete HTML documents with DOCTYPE
+ * - html_tokenizer: a single forward pass over HTML source, yielding tags, text and
+ *   attributes as views of it, for code that inspects markup without a tree
+ * - html_template: a tree compiled once into literal runs and {{slot}} references,
+ *   rendered in one pass with escaped values
+ * - html_dom: a parsed page held in one arena: nodes in contiguous arrays, children as
+ *   ranges, attributes as flat name/value views and tag names interned; read-only,
+ *   released at once, and copied into elements with to_elements()
+ * - selector: a CSS selector list (tag, #id, .class, [attr], descendant and child),
+ *   matched by document::query_selector_all() against an id/class/tag index
+ * - fragment_cache: rendered components kept for a time to live, rendered once when
+ *   requested together, and spliced into pages and streamed responses by reference
+ * - html_writer: where render() writes a tree in one walk, into a string or a sink
+ *   fed in chunks such as a streamed response
  *
  * @section namespaces Namespaces
  * - cppress: Main namespace containing all HTML types
@@ -86,5 +99,12 @@
 #include "includes/document.hpp"
 #include "includes/document_parser.hpp"
 #include "includes/element.hpp"
+#include "includes/fragment_cache.hpp"
 #include "includes/helpers.hpp"
+#include "includes/html_dom.hpp"
+#include "includes/html_escape.hpp"
+#include "includes/html_template.hpp"
+#include "includes/html_tokenizer.hpp"
+#include "includes/html_writer.hpp"
+#include "includes/selector.hpp"
 #include "includes/self_closing_element.hpp"
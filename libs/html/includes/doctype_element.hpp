@@ -24,7 +24,7 @@ namespace cppress::html {
  * - Custom DOCTYPE declarations for specialized document types
  *
  * @note DOCTYPE elements should typically be the first element in an HTML document
- * @note This class overrides the to_string() method to produce DOCTYPE-specific output
+ * @note This class overrides the render() method to produce DOCTYPE-specific output
  * @note DOCTYPE elements don't support child elements or standard HTML attributes
  */
 class doctype_element : public element {
@@ -39,7 +39,7 @@ public:
      *
      * The constructor internally uses the base element constructor with
      * "!DOCTYPE" as the tag name and the provided doctype as text content,
-     * but the actual rendering is handled by the overridden to_string() method.
+     * but the actual rendering is handled by the overridden render() method.
      *
      * Examples:
      * - doctype_element("html") creates `<!DOCTYPE html>`
@@ -49,10 +49,10 @@ public:
     doctype_element(const std::string& doctype) : element("!DOCTYPE", doctype) {}
 
     /**
-     * @brief Convert the DOCTYPE element to its string representation.
-     * @return String containing the properly formatted DOCTYPE declaration
+     * @brief Write the DOCTYPE declaration into a writer.
+     * @param out Writer to append the markup to
      *
-     * Overrides the base element's to_string() method to produce the correct
+     * Overrides the base element's render() method to produce the correct
      * DOCTYPE syntax. Instead of generating standard HTML tags, this method
      * formats the output as `<!DOCTYPE content>` where content is the
      * document type string provided during construction.
@@ -64,6 +64,8 @@ public:
      * @note This method ignores any attributes or child elements since
      *       DOCTYPE declarations don't support these features
      */
-    std::string to_string() const override { return "<!DOCTYPE " + get_text_content() + ">"; }
+    void render(html_writer& out) const override {
+        out.raw("<!DOCTYPE ").raw(text_content).raw('>');
+    }
 };
 }  // namespace cppress
\ No newline at end of file
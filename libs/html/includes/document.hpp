@@ -1,8 +1,11 @@
 #pragma once
 #include <memory>
 #include <string>
+#include <string_view>
+#include <vector>
 
 #include "element.hpp"
+#include "selector.hpp"
 
 namespace cppress::html {
 
@@ -18,6 +21,7 @@ namespace cppress::html {
  * - Root element access and manipulation
  * - STL-like container operations for root children
  * - String serialization for complete HTML output
+ * - CSS selector queries, answered from an index of the tree
  *
  * @note The document automatically creates an <html> root element
  * @note All child elements are added to the root element
@@ -27,6 +31,12 @@ private:
     std::shared_ptr<element> root;
     std::string doctype;
 
+    /// Built by the first query after a change, shared by copies of the document
+    mutable std::shared_ptr<const selector_index> query_index;
+
+    /// The index of the current tree, building it if needed
+    std::shared_ptr<const selector_index> current_index() const;
+
 public:
     // STL-like type aliases
     using value_type = std::shared_ptr<element>;
@@ -58,6 +68,12 @@ public:
      */
     std::string to_string() const;
 
+    /**
+     * @brief Writes the DOCTYPE and the root element into a writer.
+     * @param out Writer to append the markup to: a string, or a sink fed in chunks
+     */
+    void render(html_writer& out) const;
+
     /**
      * @brief Adds a child element to the document's root element.
      * @param elem Shared pointer to the element to add.
@@ -182,6 +198,45 @@ public:
      * @return A const reference to the child element.
      */
     const value_type& operator[](size_type index) const;
+
+    /**
+     * @brief Finds the elements matching a CSS selector list.
+     * @param selectors E.g. "script[src]", "#main .card > a[href^='/assets/']", "link, meta"
+     * @return The matching elements, root included, in document order
+     * @throws std::runtime_error if selectors cannot be parsed
+     *
+     * Answered from a selector_index of the tree: id, class and tag
+     * postings give the candidates for the rightmost compound, and only
+     * they are matched, right to left through their ancestors. The index
+     * is built by the first query and kept for the next ones, so a lookup
+     * by id or a rare class costs about the size of its result.
+     *
+     * @note The index is dropped by add_child(), push_back() and clear();
+     *       after changing the tree through element pointers, call
+     *       invalidate_index() before the next query
+     */
+    std::vector<std::shared_ptr<element>> query_selector_all(std::string_view selectors) const;
+
+    /// @brief As query_selector_all(std::string_view), with a selector parsed beforehand
+    std::vector<std::shared_ptr<element>> query_selector_all(const selector& query) const;
+
+    /**
+     * @brief Finds the first element matching a CSS selector list.
+     * @return The first match in document order, nullptr if there is none
+     * @throws std::runtime_error if selectors cannot be parsed
+     */
+    std::shared_ptr<element> query_selector(std::string_view selectors) const;
+
+    /// @brief As query_selector(std::string_view), with a selector parsed beforehand
+    std::shared_ptr<element> query_selector(const selector& query) const;
+
+    /**
+     * @brief Drops the selector index, to be rebuilt by the next query.
+     *
+     * Needed after elements of the tree were added, removed or had their
+     * id or class changed other than through this document.
+     */
+    void invalidate_index() noexcept;
 };
 
 }  // namespace cppress
\ No newline at end of file
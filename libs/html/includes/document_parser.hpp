@@ -2,6 +2,7 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "element.hpp"
@@ -10,7 +11,7 @@
 namespace cppress::html {
 /**
  * @brief Parse HTML string into a collection of element objects.
- * @param html Reference to HTML string to parse (may be modified during parsing)
+ * @param html HTML source, read in place in one forward pass
  * @return Vector of shared pointers to parsed element objects
  *
  * Converts a raw HTML string into a structured collection of element objects
@@ -24,6 +25,8 @@ namespace cppress::html {
  * - Nested element structures and hierarchies
  * - HTML attributes with proper value extraction
  * - Text content between elements
+ * - Comments, skipped; tag names, lower-cased; a DOCTYPE, returned first
+ * - Raw text content of script, style, textarea and title elements
  * - Malformed HTML with reasonable error recovery
  *
  * The function returns a vector of top-level elements, where each element
@@ -38,11 +41,17 @@ namespace cppress::html {
  * // Returns vector with one div element containing p, br, and p children
  * ```
  *
- * @note The input HTML string may be modified during parsing for optimization
+ * @note Line feeds are dropped from text and attribute values
+ * @note A closing tag matching no open element is ignored
+ * @throws std::runtime_error on an unterminated comment or tag, or a closing
+ *         tag that does not match the element it closes
  * @note The parser automatically detects and creates appropriate element types
  *       (regular elements vs. self-closing elements)
  * @note Returns empty vector if the HTML string is empty or contains no valid elements
  */
+std::vector<std::shared_ptr<element>> parse(std::string_view html);
+
+/// @brief Parse HTML held in a string, which is left unchanged; see parse(std::string_view)
 std::vector<std::shared_ptr<element>> parse(std::string& html);
 
 /**
@@ -87,7 +96,7 @@ std::string substitute_params(const std::string& text,
                               const std::map<std::string, std::string>& params);
 
 /**
- * @brief Internal optimized parsing function for HTML string segments.
+ * @brief Internal parsing function for HTML string segments.
  * @param html HTML string to parse
  * @param start Starting position within the HTML string
  * @param end Ending position within the HTML string
@@ -106,7 +115,8 @@ std::string substitute_params(const std::string& text,
  *
  * The function returns a pair where:
  * - First element: Vector of parsed element objects from the specified segment
- * - Second element: Final position reached during parsing (useful for continuation)
+ * - Second element: Final position reached during parsing: the '<' of a closing
+ *   tag matching no element opened in the segment, or end (useful for continuation)
  *
  * This internal function enables advanced parsing scenarios such as:
  * - Streaming HTML processing for large documents
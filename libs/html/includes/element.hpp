@@ -3,8 +3,11 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "html_writer.hpp"
+
 namespace cppress::html {
 
 /**
@@ -51,6 +54,9 @@ protected:
     /// Child elements forming the hierarchical structure
     std::vector<std::shared_ptr<element>> children;
 
+    /// Writes the attributes as they appear in an opening tag
+    void render_attributes(html_writer& out) const;
+
 public:
     // STL-like type aliases for children container
     using value_type = std::shared_ptr<element>;
@@ -175,6 +181,19 @@ public:
      */
     virtual void set_text_content(const std::string& text_content);
 
+    /**
+     * @brief Set text content from a plain value, escaped where it lands.
+     * @param value Text such as user input, which set_text_content() would write as markup
+     * @param context How to escape it; escape_context::text for the content of
+     *        most elements
+     *
+     * Example usage:
+     * ```cpp
+     * comment->set_text_content(form["body"], escape_context::text);
+     * ```
+     */
+    void set_text_content(std::string_view value, escape_context context);
+
     /**
      * @brief Recursively set parameters on this element and all descendants.
      * @param params Map of parameter name-value pairs to apply
@@ -244,15 +263,15 @@ public:
      * @brief Get all child elements of this element.
      * @return Vector of shared pointers to child elements
      *
-     * Returns a vector containing shared pointers to all child elements
+     * Returns the vector holding shared pointers to all child elements
      * that have been added to this element. The order of elements in
      * the vector reflects the order they were added and the order they
      * will appear in the rendered HTML output.
      *
-     * @note Returns a copy of the children vector, so modifications
-     *       to the returned vector do not affect the element's children.
+     * @note Returns a reference to the children, valid until they are changed;
+     *       copy it to keep a snapshot.
      */
-    virtual std::vector<std::shared_ptr<element>> get_children() const;
+    virtual const std::vector<std::shared_ptr<element>>& get_children() const;
 
     /**
      * @brief Convert this element and its hierarchy to HTML string representation.
@@ -272,9 +291,25 @@ public:
      * This is the primary method for converting the programmatic element
      * structure into actual HTML that can be written to files or sent
      * to web browsers.
+     *
+     * @note The markup of render(), collected into one string
      */
     virtual std::string to_string() const;
 
+    /**
+     * @brief Write this element and its hierarchy into a writer.
+     * @param out Writer to append the markup to: a string, or a sink fed in chunks
+     *
+     * Walks the tree once, each element appending its own markup to the
+     * writer's one buffer, so rendering costs the size of the output
+     * rather than that size again at every level, and a page streamed
+     * through a sink starts leaving before it is fully rendered.
+     *
+     * @note Specialized element types override this to change their markup;
+     *       to_string() follows it
+     */
+    virtual void render(html_writer& out) const;
+
     /**
      * @brief Get the HTML tag name of this element.
      * @return String containing the tag name
@@ -289,14 +324,14 @@ public:
      * @brief Get all attributes of this element.
      * @return Map containing all attribute name-value pairs
      *
-     * Returns a copy of the complete attribute map for this element.
+     * Returns the complete attribute map for this element.
      * The map contains all HTML attributes that will be included in
      * the element's opening tag when rendered to HTML.
      *
-     * @note Returns a copy of the attributes map, so modifications
-     *       to the returned map do not affect the element's attributes.
+     * @note Returns a reference to the attributes, valid until they are
+     *       changed; copy it to keep a snapshot.
      */
-    std::map<std::string, std::string> get_attributes() const;
+    const std::map<std::string, std::string>& get_attributes() const;
 
     // STL-like methods for children management
 
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "html_writer.hpp"
+
+namespace cppress::html {
+
+/**
+ * @class fragment_cache
+ * @brief Rendered markup of components, kept for a while and shared by the pages using them.
+ *
+ * Pages built from mostly static parts (navigation, footer, product
+ * cards) around a few dynamic slots render each part once per time to
+ * live instead of once per request. A fragment is an immutable, shared
+ * buffer: html_writer::fragment() and html_template::render() splice it
+ * into a page, and into a streamed response by reference, without copying
+ * its bytes.
+ *
+ * Entries behave like those of the web library's response cache: a key
+ * being rendered is rendered once, the other callers asking for it wait
+ * for that result; past its time to live an entry is still returned
+ * during the stale window, while the first caller to see it stale renders
+ * it again; the least recently used entries are dropped past the byte
+ * budget. invalidate() and clear() drop entries at once, e.g. when the
+ * data behind them changes.
+ *
+ * Thread-safe; renderers run outside the lock.
+ *
+ * Example usage:
+ * ```cpp
+ * static fragment_cache fragments;
+ * const html_fragment nav = fragments.cache_fragment(
+ *     "nav:" + locale, std::chrono::minutes(5),
+ *     [&](html_writer& out) { make_nav(locale)->render(out); });
+ * page_template.render(out, values, {nav});
+ * ```
+ */
+class fragment_cache {
+public:
+    /// Renders a fragment's markup
+    using renderer = std::function<void(html_writer& out)>;
+
+    /**
+     * @param max_bytes Bytes of markup held; the least recently used fragments are dropped past it
+     */
+    explicit fragment_cache(std::size_t max_bytes = 4 * 1024 * 1024);
+
+    fragment_cache(const fragment_cache&) = delete;
+    fragment_cache& operator=(const fragment_cache&) = delete;
+
+    /**
+     * @brief The fragment for a key, rendered if it is missing or stale.
+     * @param key Names the fragment and what it depends on, e.g. "nav:en"
+     * @param ttl How long the fragment is returned as it is; 0 renders it every time
+     * @param render Writes the fragment; called on this thread at most once per call
+     * @param stale_while_revalidate How much longer it is returned to other
+     *        callers while one renders it again
+     * @return The markup, shared with the cache and every other caller
+     * @throws Whatever render throws; callers waiting on the key then render it themselves
+     */
+    html_fragment cache_fragment(
+        const std::string& key, std::chrono::milliseconds ttl, const renderer& render,
+        std::chrono::milliseconds stale_while_revalidate = std::chrono::milliseconds(0));
+
+    /// @brief The fragment for a key if it is held and fresh, nullptr otherwise
+    html_fragment find(const std::string& key);
+
+    /**
+     * @brief Drop a key's fragment.
+     *
+     * A render of the key in progress still returns its markup to its
+     * caller, but does not keep it: it may predate the change.
+     */
+    void invalidate(const std::string& key);
+
+    /// @brief Drop every fragment, and what renders in progress produce, as invalidate()
+    void clear();
+
+    /// @brief Bytes of markup currently held
+    std::size_t size() const;
+
+private:
+    struct slot {
+        html_fragment value;
+        std::chrono::steady_clock::time_point fresh_until;
+        std::chrono::steady_clock::time_point stale_until;
+        std::list<std::string>::iterator recent;
+    };
+
+    void store(const std::string& key, html_fragment value, std::chrono::milliseconds ttl,
+               std::chrono::milliseconds stale_while_revalidate);
+
+    void erase(std::unordered_map<std::string, slot>::iterator it);
+
+    std::size_t max_bytes;
+
+    mutable std::mutex mutex;
+    /// Signalled when a key stops being rendered
+    std::condition_variable rendered;
+    std::unordered_map<std::string, slot> entries;
+    /// Keys, most recently used first
+    std::list<std::string> recent;
+    std::size_t bytes = 0;
+
+    /// Keys being rendered, each with whether it was invalidated meanwhile
+    std::unordered_map<std::string, bool> pending;
+};
+}  // namespace cppress::html
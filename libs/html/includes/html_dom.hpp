@@ -0,0 +1,211 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "element.hpp"
+#include "html_tokenizer.hpp"
+#include "html_writer.hpp"
+
+namespace cppress::html {
+
+/**
+ * @brief Kind of an html_node.
+ */
+enum class html_node_type : std::uint8_t {
+    /// An element with content and a closing tag
+    element,
+    /// A void element (br, img, input, ...): attributes only
+    void_element,
+    /// A run of text between tags
+    text
+};
+
+/**
+ * @class html_node
+ * @brief One node of an html_dom: an element or a run of text.
+ *
+ * An element's tag is lower-case and interned: the common HTML names are
+ * views of one static table, others of one copy per document, so two
+ * nodes with the same tag hold the same pointer. Its attributes are a
+ * flat range of (name, value) views, in source order, and its children a
+ * range of nodes laid out next to each other in the document.
+ *
+ * Text and attribute values are views of the source where it can be used
+ * as is, and of a copy in the document's arena where line feeds were
+ * dropped or text split by comments was joined, as parse() does.
+ *
+ * Nodes are trivially copyable and valid as long as their document.
+ */
+class html_node {
+public:
+    /// @brief The kind of node
+    html_node_type type() const noexcept { return kind; }
+
+    bool is_element() const noexcept { return kind != html_node_type::text; }
+    bool is_text() const noexcept { return kind == html_node_type::text; }
+
+    /// @brief Lower-case tag name of an element; empty for text
+    std::string_view tag() const noexcept {
+        return is_element() ? std::string_view(chars, length) : std::string_view();
+    }
+
+    /// @brief The text of a text node; empty for an element
+    std::string_view text() const noexcept {
+        return is_text() ? std::string_view(chars, length) : std::string_view();
+    }
+
+    /// @brief Child nodes, in document order
+    std::size_t size() const noexcept { return child_count; }
+    bool empty() const noexcept { return child_count == 0; }
+    const html_node* begin() const noexcept { return children; }
+    const html_node* end() const noexcept { return children + child_count; }
+
+    /**
+     * @brief Child node.
+     * @throws std::out_of_range if index is past the last child
+     */
+    const html_node& operator[](std::size_t index) const;
+
+    /// @brief Attributes of an element, in source order, each name once
+    std::size_t attributes_size() const noexcept { return attribute_count; }
+    const html_attribute* attributes_begin() const noexcept { return attrs; }
+    const html_attribute* attributes_end() const noexcept { return attrs + attribute_count; }
+
+    /**
+     * @brief Value of an attribute.
+     * @param name Name as written in the source
+     * @return The value, empty if the attribute is absent or has none
+     */
+    std::string_view attribute(std::string_view name) const noexcept;
+
+    /// @brief Whether the element has the attribute, with or without a value
+    bool has_attribute(std::string_view name) const noexcept;
+
+    /// @brief Concatenated text of the node and everything below it
+    std::string inner_text() const;
+
+    /**
+     * @brief Write the node and its subtree into a writer, as element::render() would.
+     * @param out Writer to append the markup to
+     */
+    void render(html_writer& out) const;
+
+    /**
+     * @brief Copy the node into the element hierarchy.
+     * @return A new tree, as parse() would have built it
+     */
+    std::shared_ptr<element> to_element() const;
+
+private:
+    friend class html_dom_builder;
+
+    html_node_type kind = html_node_type::text;
+    std::uint16_t attribute_count = 0;
+    /// Size of the tag or text
+    std::uint32_t length = 0;
+    const char* chars = nullptr;
+    const html_attribute* attrs = nullptr;
+    const html_node* children = nullptr;
+    std::uint32_t child_count = 0;
+};
+
+/**
+ * @class html_dom
+ * @brief A parsed HTML document held as html_node values in one arena.
+ *
+ * The counterpart of json_document for HTML: the source is read once by
+ * html_tokenizer, then nodes and attributes are laid out in arrays sized
+ * exactly, with the text copies they need, all in one monotonic arena.
+ * Walking the tree reads contiguous memory, without reference counts or
+ * virtual calls, and destroying the document is one arena release, with
+ * no recursion however deep the tree.
+ *
+ * Read-only and parsed as parse() parses: comments skipped, tag names
+ * lower-cased, line feeds dropped, whitespace-only text left out and a
+ * stray closing tag ignored. to_elements() copies it into the element
+ * hierarchy for code built on that API.
+ *
+ * @code
+ * auto dom = cppress::html::html_dom::parse(body);
+ * for (const auto& node : dom)
+ *     for (const auto& child : node)
+ *         if (child.tag() == "a")
+ *             links.push_back(std::string(child.attribute("href")));
+ * @endcode
+ */
+class html_dom {
+public:
+    /**
+     * @brief Parse HTML.
+     * @param html The source, copied into the document
+     * @throws std::runtime_error as parse() does, on an unterminated comment
+     *         or tag, or a closing tag that does not match its element
+     */
+    static html_dom parse(std::string_view html);
+
+    /// @brief Parse HTML, taking over the source instead of copying it
+    static html_dom parse(std::string&& html);
+
+    /// @brief Parse HTML from a C string; see parse(std::string_view)
+    static html_dom parse(const char* html) { return parse(std::string_view(html)); }
+
+    /**
+     * @brief Parse HTML in place.
+     * @param html The source; it must outlive the document, whose views point into it
+     */
+    static html_dom view(std::string_view html);
+
+    html_dom(html_dom&&) noexcept = default;
+    html_dom& operator=(html_dom&&) noexcept = default;
+
+    /// @brief Text of the first DOCTYPE, e.g. "html"; empty if there is none
+    std::string_view doctype() const noexcept { return doctype_text; }
+
+    /// @brief Top-level nodes, in document order
+    std::size_t size() const noexcept { return top_count; }
+    bool empty() const noexcept { return top_count == 0; }
+    const html_node* begin() const noexcept { return top; }
+    const html_node* end() const noexcept { return top + top_count; }
+
+    /**
+     * @brief Top-level node.
+     * @throws std::out_of_range if index is past the last one
+     */
+    const html_node& operator[](std::size_t index) const;
+
+    /// @brief Nodes in the whole document
+    std::size_t node_count() const noexcept { return total; }
+
+    /// @brief Write the DOCTYPE, if any, and the nodes into a writer
+    void render(html_writer& out) const;
+
+    /**
+     * @brief Copy the document into the element hierarchy.
+     * @return What parse() returns: the top-level elements, led by the DOCTYPE if any
+     */
+    std::vector<std::shared_ptr<element>> to_elements() const;
+
+private:
+    friend class html_dom_builder;
+
+    html_dom() = default;
+
+    /// Parses html into the arena
+    void build(std::string_view html);
+
+    /// Source given to parse(std::string&&); behind a pointer so a move keeps its address
+    std::unique_ptr<std::string> owned;
+
+    std::unique_ptr<std::pmr::monotonic_buffer_resource> arena;
+    const html_node* top = nullptr;
+    std::size_t top_count = 0;
+    std::size_t total = 0;
+    std::string_view doctype_text;
+};
+}  // namespace cppress::html
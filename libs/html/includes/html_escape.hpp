@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace cppress::html {
+
+/**
+ * @brief Where an escaped value lands, which decides what is replaced.
+ */
+enum class escape_context : std::uint8_t {
+    /// Text content: &, < and > become entities
+    text,
+    /// A quoted attribute value: also " and '
+    attribute,
+    /// A part of a URL, e.g. a path segment or a query value: every byte
+    /// but letters, digits and -._~ is percent-encoded
+    url
+};
+
+/**
+ * @brief Append a value escaped for its context.
+ * @param out String to append to
+ * @param value Value to escape, e.g. user input filling a template slot
+ * @param context Where the value lands
+ *
+ * Runs with nothing to escape are found 16 or 32 bytes at a time (see
+ * escape_scan) and appended with one copy each, so a clean value, the
+ * usual case, costs a scan and a memcpy.
+ */
+void escape_to(std::string& out, std::string_view value,
+               escape_context context = escape_context::text);
+
+/// @brief A value escaped for its context, as a new string; see escape_to()
+std::string escape(std::string_view value, escape_context context = escape_context::text);
+
+/**
+ * @brief Vectorized search for the bytes escape_to() replaces.
+ *
+ * The fastest implementation the CPU supports is picked once at startup:
+ * AVX2 or SSE2 on x86-64, NEON on AArch64, a table-driven scalar loop
+ * otherwise. Every implementation returns the same offsets.
+ */
+namespace escape_scan {
+
+/// Instruction set a scan implementation relies on
+enum class level { scalar, sse2, avx2, neon };
+
+/**
+ * @brief First byte in [from, n) to replace in the context, n if there is none.
+ */
+std::size_t special_end(const char* p, std::size_t from, std::size_t n,
+                        escape_context context) noexcept;
+
+/// @brief Implementation the scan currently uses
+level active() noexcept;
+
+/// @brief Best implementation supported by this CPU
+level best() noexcept;
+
+/**
+ * @brief Switches the scan to another implementation
+ * @param l Level to use, ignored unless this CPU supports it
+ * @return true if the level is now active
+ *
+ * Meant for benchmarks and tests comparing implementations; not
+ * thread-safe against concurrent scans.
+ */
+bool use(level l) noexcept;
+}  // namespace escape_scan
+}  // namespace cppress::html
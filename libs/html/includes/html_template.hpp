@@ -0,0 +1,247 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "document.hpp"
+#include "element.hpp"
+#include "html_writer.hpp"
+
+namespace cppress::html {
+
+/**
+ * @brief A page compiled once into literal runs and {{slot}} references.
+ *
+ * Rendering a parsed tree the usual way copies it (element::copy()), walks
+ * it with set_params_recursive(), which scans each string once per
+ * parameter, and serializes it again with to_string(). compile() does the
+ * walk and the serialization once: the markup becomes a flat list of ops,
+ * each either a run of literal bytes or a slot, and each slot name gets an
+ * index when the template is compiled. render() then appends the literal
+ * runs and the values to one output buffer in a single pass, without
+ * copying the tree.
+ *
+ * Slots are found where set_params() substitutes them, in text content
+ * and attribute values, and the output matches to_string() after
+ * set_params_recursive(), except that values are escaped for the place
+ * they land (see escape_context): &, < and > in text, and also " and ' in
+ * attribute values. In a URL attribute (href, src, action, formaction,
+ * cite, poster) a slot past the start of the value is a part of the URL
+ * and is percent-encoded, so "/u/{{id}}?q={{q}}" cannot be steered to
+ * another path or query; a slot at the start fills in the whole URL and
+ * is escaped like other attribute values. A placeholder with no value is
+ * left as written, like substitute_params() leaves it.
+ *
+ * Each text run or attribute value with slots in it is a field, and the
+ * template knows which fields each slot feeds: template_instance uses that
+ * to render again only what changed.
+ *
+ * A compiled template is immutable and can be shared across threads.
+ *
+ * Example usage:
+ * ```cpp
+ * std::string page = "<h1>{{title}}</h1><a href=\"/u/{{id}}\">{{name}}</a>";
+ * static const auto tpl = html_template::compile(parse(page));
+ * std::string out;
+ * tpl.render(out, {{"title", "Users"}, {"id", "7"}, {"name", "Ann & Bob"}});
+ * ```
+ */
+class html_template {
+public:
+    /// Index returned by slot() for a name the template does not use
+    static constexpr std::size_t NO_SLOT = static_cast<std::size_t>(-1);
+
+    /// field::node of a field outside any element, e.g. in the doctype
+    static constexpr std::size_t NO_NODE = static_cast<std::size_t>(-1);
+
+    /**
+     * @brief A text run or attribute value with slots in it: the unit a patch replaces.
+     */
+    struct field {
+        /// Element holding it, by position among the elements in document order, as
+        /// querySelectorAll("*") lists them; NO_NODE outside any element
+        std::size_t node;
+        /// Attribute whose value it is, empty for a text run; an element may hold several runs
+        std::string attribute;
+        /// Slots it renders, by index, each once
+        std::vector<std::size_t> slots;
+    };
+
+    /**
+     * @brief A field's new markup, escaped as the page holds it.
+     */
+    struct patch {
+        std::size_t field;
+        std::string value;
+    };
+
+    /**
+     * @brief Compile elements, as parse() returns them, rendered one after the other.
+     */
+    static html_template compile(const std::vector<std::shared_ptr<element>>& elements);
+
+    /// @brief Compile an element and its descendants
+    static html_template compile(const element& root);
+
+    /// @brief Compile a whole document, doctype included
+    static html_template compile(const document& doc);
+
+    /**
+     * @brief Append the page to out, with values by slot index.
+     * @param values One value per slot, in the order of slots(); slots past
+     *        its end, or given a default-constructed view, are left as their
+     *        placeholders
+     */
+    void render(std::string& out, const std::vector<std::string_view>& values) const;
+
+    /**
+     * @brief Append the page to out, with values by slot name.
+     * @param params Values by name, as set_params() takes them
+     */
+    void render(std::string& out, const std::map<std::string, std::string>& params) const;
+
+    /**
+     * @brief Write the page into a writer, splicing rendered fragments into their slots.
+     * @param values As render(std::string&, const std::vector<std::string_view>&),
+     *        for the slots without a fragment
+     * @param fragments Markup by slot index, e.g. from a fragment_cache; nullptr
+     *        for none. In text it is written as is, and handed over by reference
+     *        when out has a fragment sink (see html_writer::fragment()); in an
+     *        attribute value it is escaped like a value
+     */
+    void render(html_writer& out, const std::vector<std::string_view>& values,
+                const std::vector<html_fragment>& fragments = {}) const;
+
+    /// @brief The page with values by slot name, as a new string
+    std::string render(const std::map<std::string, std::string>& params) const;
+
+    /// @brief Slot names; a name's position is its index
+    const std::vector<std::string>& slots() const noexcept { return names; }
+
+    /// @brief Index of a slot name, NO_SLOT if the template has no such slot
+    std::size_t slot(std::string_view name) const noexcept;
+
+    /// @brief Bytes of literal markup, what a render appends before the values
+    std::size_t literal_size() const noexcept { return literals.size(); }
+
+    /// @brief Fields in document order; a field's position is its index
+    const std::vector<field>& fields() const noexcept { return field_list; }
+
+    /// @brief Indexes of the fields a slot feeds, empty for NO_SLOT or an unknown slot
+    const std::vector<std::size_t>& fields_of(std::size_t slot) const noexcept;
+
+    /**
+     * @brief Append one field's markup, with values as render() takes them.
+     */
+    void render_field(std::string& out, std::size_t field,
+                      const std::vector<std::string_view>& values) const;
+
+    /**
+     * @brief The compiled template as bytes, to keep in a startup snapshot.
+     *
+     * deserialize() turns them back into the same template without parsing
+     * or compiling the page again (see shared::startup_snapshot).
+     */
+    std::string serialize() const;
+
+    /**
+     * @brief A template serialize() wrote.
+     * @throws std::runtime_error if the bytes are cut short or refer past the template
+     */
+    static html_template deserialize(std::string_view bytes);
+
+private:
+    friend class html_template_compiler;
+    friend class template_instance;
+
+    /// Appends ops [first, last) with values by slot index
+    void append(std::string& out, std::size_t first, std::size_t last,
+                const std::vector<std::string_view>& values) const;
+
+    /// A run of literals, or a slot when slot is not NO_SLOT
+    struct op {
+        std::uint32_t offset;
+        std::uint32_t length;
+        std::size_t slot;
+        /// Where a slot's value lands, which decides its escaping
+        escape_context where;
+    };
+
+    std::vector<op> ops;
+
+    /// Every literal run, back to back
+    std::string literals;
+
+    std::vector<std::string> names;
+
+    std::vector<field> field_list;
+
+    /// Ops [first, last) of each field
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> field_ops;
+
+    /// Fields of each slot
+    std::vector<std::vector<std::size_t>> slot_fields;
+};
+
+/**
+ * @brief A page rendered from a template, kept to be brought up to date by patches.
+ *
+ * Pages updated live (server-driven UIs, dashboards) change a few values
+ * between renders. An instance remembers the values and the markup of each
+ * field: update() compares the new values with the old ones, renders only
+ * the fields fed by slots that changed, and returns those fields as
+ * patches, a few bytes to send where the page would be. Clients that apply
+ * patches get them; html() is the whole page for the others, joined from
+ * the literal runs and the fields without rendering them again.
+ *
+ * Not thread-safe: one instance serves one client, or is guarded by its
+ * owner. The template must outlive it.
+ *
+ * Example usage:
+ * ```cpp
+ * template_instance view(dashboard, {"3", "ok"});
+ * send(view.html());
+ * for (;;)
+ *     for (const auto& p : view.update({std::to_string(jobs()), status()}))
+ *         push_patch(p.field, p.value);
+ * ```
+ */
+class template_instance {
+public:
+    /**
+     * @param tpl Template to render
+     * @param values Values by slot index, as html_template::render() takes them
+     */
+    template_instance(const html_template& tpl, const std::vector<std::string_view>& values);
+
+    /**
+     * @brief Take new values, and return the fields whose markup changed.
+     * @param values All values by slot index, changed or not, as the constructor takes them
+     * @return Patches in field order; empty when nothing changed
+     */
+    std::vector<html_template::patch> update(const std::vector<std::string_view>& values);
+
+    /// @brief The whole page with the current values
+    const std::string& html();
+
+    /// @brief Current markup of a field
+    const std::string& field_value(std::size_t field) const { return markup.at(field); }
+
+private:
+    /// Values as render() takes them, nullptr views for those not given
+    std::vector<std::string_view> views() const;
+
+    const html_template* tpl;
+    std::vector<std::optional<std::string>> values;
+    std::vector<std::string> markup;
+    std::string page;
+    bool page_stale = true;
+};
+}  // namespace cppress::html
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace cppress::html {
+
+/**
+ * @brief Kind of token read by html_tokenizer.
+ */
+enum class html_token : std::uint8_t {
+    /// A run of text, or the raw content of a script, style, textarea or title
+    text,
+    /// An opening tag, with its name and attributes
+    start_tag,
+    /// A closing tag, with its name (empty for "</>")
+    end_tag,
+    /// A <!DOCTYPE ...> declaration, text() holding what follows the keyword
+    doctype,
+    /// The input is exhausted
+    end
+};
+
+/**
+ * @brief One attribute of a start tag, as written in the source.
+ */
+struct html_attribute {
+    std::string_view name;
+    /// Without its quotes; empty for an attribute with no value
+    std::string_view value;
+};
+
+/**
+ * @brief Forward, single-pass tokenizer over HTML source.
+ *
+ * Each call to next() reads one token and leaves the reader on the byte
+ * after it; names, text and attribute values are views of the source, so
+ * reading makes no copy and no allocation beyond the reused attribute
+ * list. Comments, processing instructions and declarations other than
+ * DOCTYPE are skipped where they are met.
+ *
+ * As in HTML, a '<' starts markup only before a letter, '/', '!' or '?';
+ * otherwise it is text. Attribute values may be double-quoted,
+ * single-quoted or bare, and a '>' inside quotes does not end the tag.
+ * The content of script, style, textarea and title elements is one text
+ * token, up to the matching closing tag.
+ *
+ * Names are returned as written; compare them with equals_ignore_case().
+ *
+ * Example usage:
+ * ```cpp
+ * html_tokenizer tokens(body);
+ * for (html_token t = tokens.next(); t != html_token::end; t = tokens.next())
+ *     if (t == html_token::start_tag && html_tokenizer::equals_ignore_case(tokens.name(), "a"))
+ *         check_links(tokens.attributes());
+ * ```
+ */
+class html_tokenizer {
+public:
+    /// @param html The source, which must outlive the tokenizer and its tokens
+    explicit html_tokenizer(std::string_view html) noexcept : html(html) {}
+
+    /**
+     * @brief Read the next token.
+     * @return Its kind; html_token::end once the input is exhausted
+     * @throws std::runtime_error on a comment without "-->" or a tag without '>'
+     */
+    html_token next();
+
+    /// @brief Tag name of a start or end tag
+    std::string_view name() const noexcept { return tag_name; }
+
+    /// @brief Text of a text or doctype token
+    std::string_view text() const noexcept { return content; }
+
+    /// @brief Attributes of a start tag, in source order
+    const std::vector<html_attribute>& attributes() const noexcept { return attrs; }
+
+    /// @brief Whether a start tag ended with "/>"
+    bool self_closing() const noexcept { return closed; }
+
+    /// @brief Offset of the current token's first byte in the source
+    std::size_t position() const noexcept { return start; }
+
+    /// @brief ASCII case-insensitive comparison, as HTML compares names
+    static bool equals_ignore_case(std::string_view a, std::string_view b) noexcept;
+
+private:
+    html_token read_text();
+    html_token read_start_tag();
+    html_token read_end_tag();
+    html_token read_doctype();
+
+    /// Skips a construct whose terminator is searched from from, throwing what if it is missing
+    void skip_past(std::size_t from, std::string_view terminator, const char* what);
+
+    std::string_view html;
+    std::size_t pos = 0;
+    std::size_t start = 0;
+
+    std::string_view tag_name;
+    std::string_view content;
+    std::vector<html_attribute> attrs;
+    bool closed = false;
+
+    /// Element whose content is read as raw text next, empty if none
+    std::string_view raw_text_end;
+};
+}  // namespace cppress::html
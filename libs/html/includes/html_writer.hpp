@@ -0,0 +1,145 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "html_escape.hpp"
+
+namespace cppress::html {
+
+/**
+ * @brief Receives the markup of an html_writer in chunks, each handed over by move.
+ */
+using html_sink = std::function<void(std::string&& chunk)>;
+
+/**
+ * @brief Rendered markup shared as is, e.g. by a fragment_cache and every page using it.
+ */
+using html_fragment = std::shared_ptr<const std::string>;
+
+/**
+ * @brief Receives the fragments an html_writer splices in, by reference, between its chunks.
+ */
+using html_fragment_sink = std::function<void(const html_fragment& fragment)>;
+
+/**
+ * @brief Where element::render() writes: a string, or a sink fed in chunks.
+ *
+ * Markup is appended to one buffer: the caller's string, or the writer's
+ * own, handed to a sink whenever it fills up to the chunk size (e.g. the
+ * chunks of a streamed response), so the first bytes of a large page can
+ * leave while the rest is rendered and the page is never held whole.
+ *
+ * Example usage:
+ * ```cpp
+ * std::string page;
+ * html_writer out(page);
+ * doc.render(out);
+ * ```
+ */
+class html_writer {
+public:
+    /// Default size of the chunks handed to a sink
+    static constexpr std::size_t DEFAULT_CHUNK_SIZE = 16 * 1024;
+
+    /// Fragments from this size up are handed over by reference; smaller ones are cheaper copied
+    static constexpr std::size_t MIN_SPLICE_SIZE = 512;
+
+    /**
+     * @brief Write into a string.
+     * @param out String the markup is appended to; must outlive the writer
+     */
+    explicit html_writer(std::string& out) noexcept : out(&out) {}
+
+    /**
+     * @brief Write through a sink.
+     * @param sink Receives the markup in chunks of about chunk_size bytes
+     * @param chunk_size Bytes buffered before they are handed to the sink
+     * @note Call flush() after the last element to hand over the rest
+     */
+    explicit html_writer(html_sink sink, std::size_t chunk_size = DEFAULT_CHUNK_SIZE);
+
+    /**
+     * @brief Write through a sink, handing fragments over by reference.
+     * @param sink Receives the markup in chunks of about chunk_size bytes
+     * @param fragments Receives the fragments passed to fragment(), in order
+     *        with the chunks; they are not copied into them
+     * @param chunk_size Bytes buffered before they are handed to the sink
+     */
+    html_writer(html_sink sink, html_fragment_sink fragments,
+                std::size_t chunk_size = DEFAULT_CHUNK_SIZE);
+
+    html_writer(const html_writer&) = delete;
+    html_writer& operator=(const html_writer&) = delete;
+
+    /// @brief Markup written as is
+    html_writer& raw(std::string_view markup) {
+        out->append(markup);
+        return filled();
+    }
+
+    html_writer& raw(char c) {
+        out->push_back(c);
+        return filled();
+    }
+
+    /// @brief Text content, with &, < and > escaped
+    html_writer& text(std::string_view value) { return escaped(value, escape_context::text); }
+
+    /// @brief An attribute, ` name="value"`, with the value escaped
+    html_writer& attribute(std::string_view name, std::string_view value);
+
+    /// @brief The value of an attribute whose quotes are written with raw(), escaped
+    html_writer& attribute_value(std::string_view value) {
+        return escaped(value, escape_context::attribute);
+    }
+
+    /// @brief A value escaped for its context, see html::escape_to()
+    html_writer& escaped(std::string_view value, escape_context context) {
+        html::escape_to(*out, value, context);
+        return filled();
+    }
+
+    /**
+     * @brief Markup rendered beforehand, written as is.
+     * @param markup Fragment to splice in; nothing is written for nullptr
+     *
+     * With a fragment sink, the chunk buffered so far is flushed and the
+     * fragment handed over by reference: its bytes are not copied. Smaller
+     * than MIN_SPLICE_SIZE, or without a fragment sink, it is copied like
+     * raw() would.
+     */
+    html_writer& fragment(const html_fragment& markup);
+
+    /// @brief Make room for n more bytes
+    void reserve(std::size_t n) { out->reserve(out->size() + n); }
+
+    /// @brief Hand the buffered markup to the sink; nothing to do when writing into a string
+    void flush();
+
+    /**
+     * @brief Append a value with the characters special where it lands replaced
+     *        by entities: &, < and >, and " and ' in an attribute value.
+     */
+    static void escape_to(std::string& out, std::string_view value, bool attribute) {
+        html::escape_to(out, value, attribute ? escape_context::attribute : escape_context::text);
+    }
+
+private:
+    html_writer& filled() {
+        if (sink && out->size() >= chunk_size)
+            flush();
+        return *this;
+    }
+
+    /// Markup goes here: the caller's string or buffer
+    std::string* out;
+    std::string buffer;
+    html_sink sink;
+    html_fragment_sink fragments;
+    std::size_t chunk_size = 0;
+};
+}  // namespace cppress::html
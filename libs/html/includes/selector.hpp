@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "element.hpp"
+
+namespace cppress::html {
+
+/**
+ * @brief A CSS selector list, parsed once to be matched against element trees.
+ *
+ * Supported: type selectors and `*`, `#id`, `.class`, attribute selectors
+ * (`[name]`, and `=`, `~=`, `^=`, `$=`, `*=` with a bare or quoted value),
+ * the descendant (space) and child (`>`) combinators, and lists joined
+ * by commas. Type selectors match tag names in any case.
+ *
+ * Example usage:
+ * ```cpp
+ * const selector scripts = selector::parse("head > script[src], link[rel=stylesheet]");
+ * for (const auto& elem : doc.query_selector_all(scripts))
+ *     elem->set_attribute("nonce", nonce);
+ * ```
+ */
+class selector {
+public:
+    /**
+     * @brief Parse a selector list.
+     * @param text Selectors, e.g. "ul.menu > li a[href^='/']"
+     * @throws std::runtime_error if text is empty or uses unsupported syntax
+     */
+    static selector parse(std::string_view text);
+
+private:
+    friend class selector_index;
+    friend class selector_reader;
+
+    struct attribute_test {
+        std::string name;
+        /// 0 for presence, else the operator's first character ('=', '~', '^', '$', '*')
+        char op = 0;
+        std::string value;
+    };
+
+    /// Tests on one element, and how it relates to the compound on its left
+    struct compound {
+        /// Lower-case tag name, empty for any
+        std::string tag;
+        std::string id;
+        std::vector<std::string> classes;
+        std::vector<attribute_test> attributes;
+        /// ' ' for a descendant, '>' for a child of the compound on the left; 0 for the first
+        char combinator = 0;
+    };
+
+    /// One chain of compounds per selector of the list, left to right
+    std::vector<std::vector<compound>> chains;
+};
+
+/**
+ * @brief The elements of a tree, in document order, indexed by id, class and tag.
+ *
+ * Built once in one walk of the tree, with each element's parent, so a
+ * selector is matched right to left: candidates for its rightmost compound
+ * come from the smallest index that applies, and only those are checked,
+ * walking up through their ancestors for the compounds to the left. A
+ * query then costs about the number of candidates, not the size of the
+ * tree.
+ *
+ * The index is a snapshot: elements added, removed or given other ids or
+ * classes afterwards are not seen until it is built again.
+ */
+class selector_index {
+public:
+    /// @param root Tree to index, root included
+    explicit selector_index(const std::shared_ptr<element>& root);
+
+    /**
+     * @brief Elements matching any selector of the list, in document order.
+     * @param limit Stop after this many
+     */
+    std::vector<std::shared_ptr<element>> select(const selector& query,
+                                                 std::size_t limit = SIZE_MAX) const;
+
+    /// @brief Elements indexed
+    std::size_t size() const noexcept { return entries.size(); }
+
+private:
+    static constexpr std::uint32_t NONE = UINT32_MAX;
+
+    struct entry {
+        std::shared_ptr<element> node;
+        std::uint32_t parent;
+    };
+
+    using postings = std::map<std::string, std::vector<std::uint32_t>, std::less<>>;
+
+    /// Indexes of the elements that may match the compound, or nullptr for all of them
+    const std::vector<std::uint32_t>* candidates(const selector::compound& last) const;
+
+    bool matches(const selector::compound& test, std::uint32_t at) const;
+
+    /// Whether chain[0..last] matches with chain[last] on entry at
+    bool matches(const std::vector<selector::compound>& chain, std::size_t last,
+                 std::uint32_t at) const;
+
+    std::vector<entry> entries;
+    postings ids;
+    postings classes;
+    postings tags;
+
+    /// Shared empty result for a name no element has
+    std::vector<std::uint32_t> none;
+};
+}  // namespace cppress::html
@@ -91,10 +91,10 @@ public:
     virtual void add_child(std::shared_ptr<element> child) override;
 
     /**
-     * @brief Convert the self-closing element to its string representation.
-     * @return String containing the properly formatted self-closing element
+     * @brief Write the self-closing element into a writer.
+     * @param out Writer to append the markup to
      *
-     * Overrides the base element's to_string() method to produce the correct
+     * Overrides the base element's render() method to produce the correct
      * self-closing syntax. The output format follows HTML5 standards for
      * void elements, typically rendering as `<tag attributes>` without a
      * closing tag, or `<tag attributes />` in XHTML-style formatting.
@@ -108,7 +108,7 @@ public:
      * - `<img src="image.jpg" alt="Description">` for images
      * - `<input type="text" name="username">` for form inputs
      */
-    virtual std::string to_string() const override;
+    virtual void render(html_writer& out) const override;
 
     /**
      * @brief Override to return empty children collection.
@@ -122,7 +122,7 @@ public:
      * @note This method will always return an empty vector regardless
      *       of any previous attempts to add children
      */
-    virtual std::vector<std::shared_ptr<element>> get_children() const override;
+    virtual const std::vector<std::shared_ptr<element>>& get_children() const override;
 
     /**
      * @brief Override to return empty text content.
@@ -155,5 +155,6 @@ public:
      *       implementation strategy chosen for error handling
      */
     virtual void set_text_content(const std::string& text_content) override;
+    using element::set_text_content;
 };
 }  // namespace cppress
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "../includes/document.hpp"
 
+#include <atomic>
 #include <stdexcept>
 
 namespace cppress::html {
@@ -9,14 +10,21 @@ document::document(const std::string& doctype) : doctype(doctype) {
 }
 
 std::string document::to_string() const {
-    std::string result = "<!DOCTYPE " + doctype + ">";
-    result += root->to_string();
+    std::string result;
+    html_writer out(result);
+    render(out);
     return result;
 }
 
+void document::render(html_writer& out) const {
+    out.raw("<!DOCTYPE ").raw(doctype).raw('>');
+    root->render(out);
+}
+
 void document::add_child(std::shared_ptr<element> elem) {
     if (elem) {
         root->add_child(elem);
+        invalidate_index();
     }
 }
 
@@ -46,6 +54,7 @@ bool document::empty() const noexcept {
 
 void document::clear() noexcept {
     root->clear();
+    invalidate_index();
 }
 
 document::iterator document::begin() noexcept {
@@ -88,4 +97,40 @@ const document::value_type& document::operator[](size_type index) const {
     return (*root)[index];
 }
 
+/**
+ * Implementation Notes:
+ * - Loaded and stored atomically, so concurrent queries are safe; two
+ *   racing to build it each build one, and one is kept
+ */
+std::shared_ptr<const selector_index> document::current_index() const {
+    std::shared_ptr<const selector_index> current = std::atomic_load(&query_index);
+    if (!current) {
+        current = std::make_shared<const selector_index>(root);
+        std::atomic_store(&query_index, current);
+    }
+    return current;
+}
+
+std::vector<std::shared_ptr<element>> document::query_selector_all(
+    std::string_view selectors) const {
+    return query_selector_all(selector::parse(selectors));
+}
+
+std::vector<std::shared_ptr<element>> document::query_selector_all(const selector& query) const {
+    return current_index()->select(query);
+}
+
+std::shared_ptr<element> document::query_selector(std::string_view selectors) const {
+    return query_selector(selector::parse(selectors));
+}
+
+std::shared_ptr<element> document::query_selector(const selector& query) const {
+    auto found = current_index()->select(query, 1);
+    return found.empty() ? nullptr : std::move(found.front());
+}
+
+void document::invalidate_index() noexcept {
+    std::atomic_store(&query_index, std::shared_ptr<const selector_index>());
+}
+
 }  // namespace cppress::html
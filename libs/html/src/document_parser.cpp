@@ -1,461 +1,191 @@
-
-
 #include "../includes/document_parser.hpp"
 
-#include <algorithm>
-#include <cctype>
-#include <chrono>
-#include <iostream>
-#include <map>
+#include <functional>
 #include <set>
-#include <sstream>
-#include <stack>
 #include <stdexcept>
-#include <thread>
+#include <string_view>
 
 #include "../includes/doctype_element.hpp"
 #include "../includes/element.hpp"
+#include "../includes/html_tokenizer.hpp"
 #include "../includes/self_closing_element.hpp"
-namespace cppress::html {
-/**
- * @brief Check if HTML string contains a DOCTYPE declaration.
- * @param html HTML string to check
- * @return true if DOCTYPE is found, false otherwise
- */
-bool has_doctype(const std::string& html) {
-    return html.find("<!doctype") != std::string::npos;
-}
-
-/**
- * @brief Extract and remove DOCTYPE declaration from HTML string.
- * @param html HTML string (modified by removing the DOCTYPE)
- * @return Extracted DOCTYPE string, or empty string if not found
- *
- * Finds the DOCTYPE declaration, extracts it, and removes it from the
- * original HTML string to prepare for further parsing.
- */
-std::string extract_doctype(std::string& html) {
-    size_t start = html.find("<!doctype");
-    if (start == std::string::npos)
-        return "";
-
-    size_t end = html.find('>', start);
-    if (end == std::string::npos)
-        return "";
-    // remove it form the html itself
-    auto doctype = html.substr(start, end - start + 1);
-    html.erase(start, end - start + 1);
-    return doctype;
-}
-
-/**
- * @brief Convert all HTML tag names to lowercase for consistent parsing.
- * @param html HTML string to modify (tags are converted to lowercase)
- *
- * Normalizes HTML by converting tag names to lowercase while preserving
- * attribute values, classes, and other content. This ensures consistent
- * parsing regardless of the original case used in the HTML.
- */
-void transform_tags_to_lower_case(std::string& html) {
-    size_t pos = 0;
-    while ((pos = html.find('<', pos)) != std::string::npos) {
-        size_t end_pos = html.find('>', pos);
-        if (end_pos == std::string::npos)
-            break;
 
-        // do not decapitalize the attribute names, classes, and so on,
-        size_t __end_pos = html.find(' ', pos + 1);
-        if (__end_pos == std::string::npos)
-            __end_pos = end_pos;
-        __end_pos = std::min(__end_pos, end_pos);
-
-        std::string tag = html.substr(pos + 1, __end_pos - pos - 1);
-        std::transform(tag.begin(), tag.end(), tag.begin(), ::tolower);
-        html.replace(pos + 1, __end_pos - pos - 1, tag);
-        pos = end_pos + 1;
-    }
-}
-
-/**
- * @brief Remove leading and trailing whitespace from a string.
- * @param str String to trim
- * @return Trimmed string with whitespace removed from both ends
- */
-std::string trim(std::string& str) {
-    size_t start = str.find_first_not_of(" \t\n\r");
-    if (start == std::string::npos)
-        return "";
-    size_t end = str.find_last_not_of(" \t\n\r");
-    return str.substr(start, end - start + 1);
-}
+namespace cppress::html {
 
+namespace {
 /**
- * @brief Remove all line break characters from HTML string.
- * @param html HTML string to modify (line breaks are removed)
- *
- * Removes all '\n' characters to create a single-line HTML string,
- * which simplifies parsing by eliminating line-based formatting.
- */
-void remove_all_line_breaks(std::string& html) {
-    html.erase(std::remove(html.begin(), html.end(), '\n'), html.end());
-}
-/**
- * @brief Parse HTML attribute string into key-value pairs.
- * @param attr_string String containing HTML attributes to parse
- * @return Map of attribute names to their values
- *
- *  Parser that handles various attribute formats:
- * - Simple attributes: class="value" id="test"
- * - Boolean attributes: disabled checked
- * - Quoted values with spaces and special characters
- * - Proper handling of equals signs and quote escaping
- */
-std::map<std::string, std::string> parse_attributes(std::string& attr_string) {
-    std::map<std::string, std::string> attributes;
-
-    if (attr_string.empty())
-        return attributes;
-    attr_string = trim(attr_string);
-    std::string current = "";
-    bool did_open_an_attribute = false;
-
-    std::string current_key = "";
-    for (int i = 0; i < static_cast<int>(attr_string.size()); i++) {
-        char c = attr_string[i];
-        if (c == '=' && !did_open_an_attribute) {
-            current_key = trim(current);
-            current = "";
-        } else {
-            current += c;
-        }
-        if (c == '"') {
-            if (did_open_an_attribute) {
-                did_open_an_attribute = false;
-                current.erase(current.begin());
-                current.pop_back();
-                attributes[current_key] = current;
-                current = "";
-                current_key = "";
-            } else {
-                did_open_an_attribute = true;
+ * @brief Check if a lower-case tag name is a self-closing HTML element.
+ * @param tag Tag name to check
+ * @return true for the HTML5 void elements, which have no content and no closing tag
+ */
+bool is_self_closing_tag(std::string_view tag) {
+    static const std::set<std::string, std::less<>> self_closing_tags = {
+        "area", "base", "br",   "col",   "embed",  "hr",    "img",
+        "input", "link", "meta", "param", "source", "track", "wbr"};
+    return self_closing_tags.find(tag) != self_closing_tags.end();
+}
+
+std::string to_lower_case(std::string_view name) {
+    std::string lower(name);
+    for (char& c : lower)
+        if (c >= 'A' && c <= 'Z')
+            c = static_cast<char>(c - 'A' + 'a');
+    return lower;
+}
+
+/// Appends text without its line feeds, which the parser has always dropped
+void append_without_line_breaks(std::string& out, std::string_view text) {
+    std::size_t pos = 0;
+    for (std::size_t feed; (feed = text.find('\n', pos)) != std::string_view::npos;
+         pos = feed + 1)
+        out.append(text, pos, feed - pos);
+    out.append(text, pos);
+}
+
+/**
+ * @brief Builds the element tree from html_tokenizer's tokens in one pass.
+ *
+ * Open elements are kept on an explicit stack, so deep nesting costs no
+ * recursion. Text runs split only by comments are joined, as if the
+ * comments had not been there; a run of whitespace alone is dropped.
+ */
+class tree_builder {
+public:
+    /**
+     * @param html Source to build from
+     * @param stop_at_stray_close Whether a closing tag matching no open element
+     *        ends the build, or is ignored
+     */
+    tree_builder(std::string_view html, bool stop_at_stray_close)
+        : html(html), stop_at_stray_close(stop_at_stray_close) {}
+
+    /// @return The top-level elements, and the offset where the build stopped
+    std::pair<std::vector<std::shared_ptr<element>>, std::size_t> build() {
+        html_tokenizer tokens(html);
+        for (;;) {
+            const html_token token = tokens.next();
+            if (token != html_token::text)
+                flush_text();
+            switch (token) {
+                case html_token::text:
+                    append_without_line_breaks(text, tokens.text());
+                    break;
+                case html_token::start_tag:
+                    open(tokens);
+                    break;
+                case html_token::end_tag:
+                    if (open_elements.empty()) {
+                        if (stop_at_stray_close)
+                            return {std::move(result), tokens.position()};
+                        break;
+                    }
+                    close(tokens.name());
+                    break;
+                case html_token::doctype:
+                    // the first one leads the result, wherever it was
+                    if (!has_doctype) {
+                        has_doctype = true;
+                        const std::string doctype(tokens.text());
+                        result.insert(result.begin(), std::make_shared<doctype_element>(doctype));
+                    }
+                    break;
+                case html_token::end:
+                    return {std::move(result), html.size()};
             }
-        } else if (!did_open_an_attribute && (c == ' ' || c == '\t' || c == '\n')) {
-            current_key = trim(current);
-            current = "";
-            if (!current_key.empty())
-                attributes[current_key] = "";
-            current_key = "";
         }
     }
 
-    if (current.size()) {
-        current_key = trim(current);
-        if (!current_key.empty()) {
-            attributes[current_key] = "";
-        }
+private:
+    void attach(std::shared_ptr<element> elem) {
+        if (open_elements.empty())
+            result.push_back(std::move(elem));
+        else
+            open_elements.back().first->add_child(std::move(elem));
     }
 
-    attributes.erase("");
-    attributes.erase("/");
-    attributes.erase(" ");
-
-    return attributes;
-}
+    void flush_text() {
+        if (text.find_first_not_of(" \t\n\r") != std::string::npos)
+            attach(std::make_shared<element>("", text));
+        text.clear();
+    }
 
-/**
- * @brief Get the set of HTML tag names that are self-closing.
- * @return Set containing all standard HTML self-closing tag names
- *
- * Returns a predefined set of HTML5 void elements that don't require
- * closing tags and cannot contain child content.
- */
-std::set<std::string> get_self_closing_tags() {
-    return {"area",  "base", "br",   "col",   "embed",  "hr",    "img",
-            "input", "link", "meta", "param", "source", "track", "wbr"};
-}
+    void open(const html_tokenizer& tokens) {
+        std::string tag = to_lower_case(tokens.name());
+        std::map<std::string, std::string> attributes;
+        for (const html_attribute& attr : tokens.attributes()) {
+            std::string& value = attributes[std::string(attr.name)];
+            value.clear();
+            append_without_line_breaks(value, attr.value);
+        }
 
-/**
- * @brief Check if a given tag name is a self-closing HTML element.
- * @param tag Tag name to check
- * @return true if the tag is self-closing, false otherwise
- */
-bool is_self_closing_tag(std::string& tag) {
-    static std::set<std::string> self_closing_tags = get_self_closing_tags();
-    std::string lower_tag = tag;
-    std::transform(lower_tag.begin(), lower_tag.end(), lower_tag.begin(), ::tolower);
-    return self_closing_tags.find(lower_tag) != self_closing_tags.end();
-}
-/**
- * @brief Check if a tag string represents a closing tag.
- * @param tag Tag string to check
- * @return true if it's a closing tag (starts with /), false otherwise
- */
-bool is_closing_tag(std::string& tag) {
-    return tag.size() > 1 && tag[0] == '/' && tag[1] != '/';
-}
-/**
- * @brief Separate tag name from its attributes in a tag content string.
- * @param tag_content Full tag content (e.g., "div class='container' id='main'")
- * @return Pair containing tag name and attributes string
- */
-std::pair<std::string, std::string> extract_tag_and_attributes(std::string& tag_content) {
-    size_t space_pos = tag_content.find(' ');
-    if (space_pos == std::string::npos) {
-        return {tag_content, ""};
+        if (is_self_closing_tag(tag)) {
+            attach(std::make_shared<self_closing_element>(tag, attributes));
+            return;
+        }
+        auto elem = std::make_shared<element>(tag, attributes);
+        element* raw = elem.get();
+        attach(std::move(elem));
+        open_elements.emplace_back(raw, std::move(tag));
     }
 
-    std::string tag_name = tag_content.substr(0, space_pos);
-    std::string attributes = tag_content.substr(space_pos + 1);
-    return {tag_name, attributes};
-}
-/**
- * @brief Remove all HTML comments from the HTML string.
- * @param html HTML string to modify (comments are removed)
- *
- * Finds and removes all HTML comments (<!-- comment -->) from the string.
- * Throws runtime_error if a comment is malformed (missing closing tag).
- */
-void remove_all_comments(std::string& html) {
-    size_t pos = 0;
-    while ((pos = html.find("<!--", pos)) != std::string::npos) {
-        size_t end_pos = html.find("-->", pos + 4);
-        if (end_pos == std::string::npos)
-            throw std::runtime_error("Malformed comment: no closing tag found");
-        html.erase(pos, end_pos - pos + 3);
-    }
-}
-/**
- * @brief Read the content of an HTML tag starting at a given position.
- * @param html HTML string to read from
- * @param pos Reference to current position (updated to closing '>')
- * @return Tag content between < and >
- *
- * Extracts tag content and updates the position to the closing '>'.
- * Throws runtime_error if no closing '>' is found.
- */
-std::string read_tag(const std::string& html, size_t& pos) {
-    size_t start = pos + 1;
-    size_t end = html.find('>', start);
-    if (end == std::string::npos) {
-        throw std::runtime_error("Malformed HTML: no closing '>' found");
+    /// Closes the innermost element; "</>" closes whatever it is
+    void close(std::string_view name) {
+        const std::string& tag = open_elements.back().second;
+        if (!name.empty() && !html_tokenizer::equals_ignore_case(name, tag))
+            throw std::runtime_error("Unmatched closing tag: expected </" + tag + "> but found </" +
+                                     to_lower_case(name) + ">");
+        open_elements.pop_back();
     }
 
-    std::string tag = html.substr(start, end - start);
-    pos = end;  // Update position to the closing '>'
-    return tag;
-}
-/**
- * @brief Extract just the tag name from a tag string that may include attributes.
- * @param tag_with_atrs Tag string potentially containing attributes
- * @return Clean tag name without attributes
- *
- * Separates the tag name from any attributes by finding the first whitespace.
- */
-std::string fix_tag(std::string& tag_with_atrs) {
-    std::string tag_name;
-    for (size_t i = 0; i < tag_with_atrs.size(); ++i) {
-        if (tag_with_atrs[i] == ' ' || tag_with_atrs[i] == '\t' || tag_with_atrs[i] == '\n') {
-            tag_name = tag_with_atrs.substr(0, i);
-            return tag_name;
-        }
-    }
+    std::string_view html;
+    bool stop_at_stray_close;
+    bool has_doctype = false;
+    std::vector<std::shared_ptr<element>> result;
 
-    return tag_with_atrs;
-}
+    /// Elements open from the outermost in, with their tag
+    std::vector<std::pair<element*, std::string>> open_elements;
 
-/**
- * @brief Main recursive HTML parsing wrapper function.
- * @param html HTML string to parse
- * @return Vector of parsed element objects
- * @note Optimized to run in O(n) time complexity using single-pass parsing.
- *
- * Entry point for the recursive HTML parser. Delegates to the optimized
- * parsing algorithm that processes the entire HTML string in linear time.
- */
-std::vector<std::shared_ptr<element>> solve_recursive(std::string& html) {
-    return parse_html_optimized(html, 0, html.length()).first;
-}
+    /// Text read since the last tag
+    std::string text;
+};
+}  // namespace
 
 /**
- * @brief Optimized O(n) HTML parser using single-pass algorithm.
+ * @brief Parse an HTML segment, stopping at a closing tag it did not open.
  * @param html The HTML string to parse
  * @param start Starting position in the HTML string
  * @param end Ending position in the HTML string
- * @return A pair containing the parsed elements and the position after parsing
- *
- * Recursive parser that processes HTML in linear time using a single-pass
- * algorithm. This is the core parsing engine that handles:
- *
- * - Text content extraction between tags
- * - Opening and closing tag matching
- * - Self-closing element detection
- * - Attribute parsing and validation
- * - Nested element hierarchy construction
- * - Error detection for malformed HTML
- *
- * The algorithm works by:
- * 1. Scanning for the next '<' character
- * 2. Extracting and analyzing tag content
- * 3. Determining if it's opening, closing, or self-closing
- * 4. For opening tags, recursively parsing children until matching closing tag
- * 5. Building element hierarchy with proper parent-child relationships
+ * @return A pair containing the parsed elements and where parsing stopped:
+ *         the '<' of a stray closing tag, or end
  *
- * Returns both the parsed elements and the final parsing position to enable
- * efficient continuation of parsing at higher recursion levels.
+ * Implementation Notes:
+ * - Tokens are read once with html_tokenizer and the tree is built on an
+ *   explicit stack, in linear time and without recursion
  */
 std::pair<std::vector<std::shared_ptr<element>>, size_t> parse_html_optimized(
     const std::string& html, size_t start, size_t end) {
-    std::vector<std::shared_ptr<element>> result;
-    size_t pos = start;
-
-    while (pos < end) {
-        // Find next tag opening
-        size_t tag_start = html.find('<', pos);
-
-        // If no more tags, handle remaining text
-        if (tag_start == std::string::npos || tag_start >= end) {
-            if (pos < end) {
-                std::string text_content = html.substr(pos, end - pos);
-                if (!text_content.empty() &&
-                    text_content.find_first_not_of(" \t\n\r") != std::string::npos) {
-                    auto text_element = std::make_shared<element>("", text_content);
-                    result.push_back(text_element);
-                }
-            }
-            break;
-        }
-
-        // Handle text content before the tag
-        if (tag_start > pos) {
-            std::string text_content = html.substr(pos, tag_start - pos);
-            if (!text_content.empty() &&
-                text_content.find_first_not_of(" \t\n\r") != std::string::npos) {
-                auto text_element = std::make_shared<element>("", text_content);
-                result.push_back(text_element);
-            }
-        }
-
-        // Find tag closing
-        size_t tag_end = html.find('>', tag_start);
-        if (tag_end == std::string::npos || tag_end >= end) {
-            throw std::runtime_error("Malformed HTML: no closing '>' found");
-        }
-
-        // Extract tag content
-        std::string tag_content = html.substr(tag_start + 1, tag_end - tag_start - 1);
-
-        // Skip empty tags
-        if (tag_content.empty()) {
-            pos = tag_end + 1;
-            continue;
-        }
-
-        // Check if it's a closing tag
-        if (tag_content[0] == '/') {
-            // This is a closing tag, return to parent level
-            return {result, tag_start};
-        }
-
-        // Parse tag name and attributes
-        auto [tag_name, attributes] = extract_tag_and_attributes(tag_content);
-        tag_name = trim(tag_name);
-        attributes = trim(attributes);
-        auto parsed_attributes = parse_attributes(attributes);
-
-        // Handle self-closing tags
-        if (is_self_closing_tag(tag_name)) {
-            auto elm = std::make_shared<self_closing_element>(tag_name, parsed_attributes);
-            result.push_back(elm);
-            pos = tag_end + 1;
-            continue;
-        }
-
-        // Handle regular opening tags
-        auto opening_element = std::make_shared<element>(tag_name, parsed_attributes);
-
-        // Recursively parse children
-        auto [children, closing_pos] = parse_html_optimized(html, tag_end + 1, end);
-
-        // Add children to the element
-        for (const auto& child : children) {
-            opening_element->add_child(child);
-        }
-
-        result.push_back(opening_element);
-
-        // Find the actual closing tag position
-        if (closing_pos < end) {
-            size_t closing_tag_end = html.find('>', closing_pos);
-            if (closing_tag_end == std::string::npos) {
-                throw std::runtime_error("Malformed HTML: no closing '>' found for closing tag");
-            }
-
-            // Verify this is the correct closing tag
-            std::string closing_tag_content =
-                html.substr(closing_pos + 1, closing_tag_end - closing_pos - 1);
-            if (closing_tag_content.length() > 1 && closing_tag_content[0] == '/') {
-                std::string closing_tag_name = closing_tag_content.substr(1);
-                closing_tag_name = trim(closing_tag_name);
-
-                if (closing_tag_name != tag_name) {
-                    throw std::runtime_error("Unmatched closing tag: expected </" + tag_name +
-                                             "> but found </" + closing_tag_name + ">");
-                }
-            }
-
-            pos = closing_tag_end + 1;
-        } else {
-            // No closing tag found, treat as self-closing or end of input
-            pos = end;
-        }
-    }
-
-    return {result, end};
+    const std::string_view segment = std::string_view(html).substr(start, end - start);
+    auto [elements, stop] = tree_builder(segment, true).build();
+    return {std::move(elements), start + stop};
 }
 
 /**
- * @brief Main entry point for parsing HTML strings into element objects.
- * @param html HTML string to parse (modified during processing)
- * @return Vector of parsed element objects including DOCTYPE if present
- *
- * High-level HTML parsing function that performs complete document processing:
- *
- * Preprocessing steps:
- * 1. Remove HTML comments to avoid parsing interference
- * 2. Normalize tag names to lowercase for consistent handling
- * 3. Remove line breaks for simplified parsing
- * 4. Extract and handle DOCTYPE declaration separately
+ * @brief Main entry point for parsing HTML into element objects.
+ * @param html HTML source, read in place
+ * @return Vector of parsed element objects, led by the DOCTYPE if present
  *
- * Main parsing:
- * 5. Parse the remaining HTML content into element hierarchy
- * 6. Combine DOCTYPE (if present) with parsed elements
- *
- * This function handles complete HTML documents and returns a vector
- * where the first element may be a DOCTYPE declaration followed by
- * the document's element structure.
+ * Implementation Notes:
+ * - One forward pass: comments are skipped, tag names lower-cased, line
+ *   feeds dropped and the DOCTYPE taken as the tokens are read, instead of
+ *   rewriting the whole string once for each before parsing it
+ * - A closing tag that matches no open element is ignored
  */
-std::vector<std::shared_ptr<element>> parse(std::string& html) {
-    remove_all_comments(html);
-    transform_tags_to_lower_case(html);
-    remove_all_line_breaks(html);
-    std::string doctype;
-    if (has_doctype(html)) {
-        doctype = extract_doctype(html);
-    }
-    std::vector<std::shared_ptr<element>> result;
-
-    if (!doctype.empty()) {
-        doctype.pop_back();
-        doctype.erase(doctype.begin(), doctype.begin() + 10);  // Remove "<!doctype "
-        std::shared_ptr<element> doctype_element_ptr = std::make_shared<doctype_element>(doctype);
-        result.insert(result.begin(), doctype_element_ptr);
-    }
-
-    auto solved = solve_recursive(html);
-
-    result.insert(result.end(), solved.begin(), solved.end());
+std::vector<std::shared_ptr<element>> parse(std::string_view html) {
+    return tree_builder(html, false).build().first;
+}
 
-    return result;
+std::vector<std::shared_ptr<element>> parse(std::string& html) {
+    return parse(std::string_view(html));
 }
 
 /**
@@ -32,11 +32,15 @@ std::string element::get_tag() const {
     return tag;
 }
 
+void element::set_text_content(std::string_view value, escape_context context) {
+    set_text_content(escape(value, context));
+}
+
 std::string element::get_text_content() const {
     return text_content;
 }
 
-std::map<std::string, std::string> element::get_attributes() const {
+const std::map<std::string, std::string>& element::get_attributes() const {
     return attributes;
 }
 
@@ -48,27 +52,37 @@ std::string element::get_attribute(const std::string& key) const {
     return "";
 }
 
-std::vector<std::shared_ptr<element>> element::get_children() const {
+const std::vector<std::shared_ptr<element>>& element::get_children() const {
     return children;
 }
 
 std::string element::to_string() const {
-    std::string result = tag.empty() ? "" : ("<" + tag);
+    std::string result;
+    html_writer out(result);
+    render(out);
+    return result;
+}
 
-    if (!tag.empty())
-        for (const auto& attr : attributes) {
-            if (attr.second.empty()) {
-                result += " " + attr.first;
-            } else {
-                result += " " + attr.first + "=\"" + attr.second + "\"";
-            }
-        }
-    result += (tag.empty() ? "" : ">") + text_content;
+void element::render(html_writer& out) const {
+    if (!tag.empty()) {
+        out.raw('<').raw(tag);
+        render_attributes(out);
+        out.raw('>');
+    }
+    out.raw(text_content);
     for (const auto& child : children) {
-        result += child->to_string();
+        child->render(out);
+    }
+    if (!tag.empty())
+        out.raw("</").raw(tag).raw('>');
+}
+
+void element::render_attributes(html_writer& out) const {
+    for (const auto& attr : attributes) {
+        out.raw(' ').raw(attr.first);
+        if (!attr.second.empty())
+            out.raw("=\"").raw(attr.second).raw('"');
     }
-    result += tag.empty() ? "" : ("</" + tag + ">");
-    return result;
 }
 
 void element::set_params_recursive(const std::map<std::string, std::string>& params) {
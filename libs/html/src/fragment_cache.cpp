@@ -0,0 +1,138 @@
+#include "../includes/fragment_cache.hpp"
+
+#include <utility>
+
+namespace cppress::html {
+
+namespace {
+/// Bytes a fragment is charged: its markup, and a share for the key and bookkeeping
+std::size_t footprint(const std::string& key, const html_fragment& value) {
+    return value->size() + key.size() + 128;
+}
+}  // namespace
+
+fragment_cache::fragment_cache(std::size_t max_bytes) : max_bytes(max_bytes) {}
+
+/**
+ * Implementation Notes:
+ * - An expired entry is dropped on lookup and the key is a miss
+ * - A stale entry is returned; only the first caller to see it stale is
+ *   left to render it, the key then counts as being rendered
+ * - Waiters loop back to the lookup when the key is done: they find the
+ *   new entry, or render the key themselves if none was kept
+ */
+html_fragment fragment_cache::cache_fragment(const std::string& key,
+                                             std::chrono::milliseconds ttl,
+                                             const renderer& render,
+                                             std::chrono::milliseconds stale_while_revalidate) {
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            const auto now = std::chrono::steady_clock::now();
+            auto it = entries.find(key);
+            if (it != entries.end()) {
+                if (now < it->second.fresh_until) {
+                    recent.splice(recent.begin(), recent, it->second.recent);
+                    return it->second.value;
+                }
+                if (now < it->second.stale_until) {
+                    recent.splice(recent.begin(), recent, it->second.recent);
+                    if (!pending.emplace(key, false).second)
+                        return it->second.value;
+                    break;
+                }
+                erase(it);
+            }
+            if (pending.emplace(key, false).second)
+                break;
+            rendered.wait(lock);
+        }
+    }
+
+    html_fragment result;
+    try {
+        std::string markup;
+        html_writer out(markup);
+        render(out);
+        result = std::make_shared<const std::string>(std::move(markup));
+    } catch (...) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending.erase(key);
+        }
+        rendered.notify_all();
+        throw;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto waiting = pending.find(key);
+        const bool invalidated = waiting != pending.end() && waiting->second;
+        if (waiting != pending.end())
+            pending.erase(waiting);
+        if (!invalidated)
+            store(key, result, ttl, stale_while_revalidate);
+    }
+    rendered.notify_all();
+    return result;
+}
+
+html_fragment fragment_cache::find(const std::string& key) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(key);
+    if (it == entries.end() || std::chrono::steady_clock::now() >= it->second.fresh_until)
+        return nullptr;
+    recent.splice(recent.begin(), recent, it->second.recent);
+    return it->second.value;
+}
+
+void fragment_cache::invalidate(const std::string& key) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(key);
+    if (it != entries.end())
+        erase(it);
+    auto waiting = pending.find(key);
+    if (waiting != pending.end())
+        waiting->second = true;
+}
+
+void fragment_cache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+    recent.clear();
+    bytes = 0;
+    for (auto& waiting : pending)
+        waiting.second = true;
+}
+
+std::size_t fragment_cache::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return bytes;
+}
+
+void fragment_cache::store(const std::string& key, html_fragment value,
+                           std::chrono::milliseconds ttl,
+                           std::chrono::milliseconds stale_while_revalidate) {
+    if (ttl.count() <= 0)
+        return;
+    auto it = entries.find(key);
+    if (it != entries.end())
+        erase(it);
+    const std::size_t charge = footprint(key, value);
+    if (charge > max_bytes)
+        return;
+    while (bytes + charge > max_bytes && !recent.empty())
+        erase(entries.find(recent.back()));
+    const auto now = std::chrono::steady_clock::now();
+    recent.push_front(key);
+    entries.emplace(key, slot{std::move(value), now + ttl, now + ttl + stale_while_revalidate,
+                              recent.begin()});
+    bytes += charge;
+}
+
+void fragment_cache::erase(std::unordered_map<std::string, slot>::iterator it) {
+    bytes -= footprint(it->first, it->second.value);
+    recent.erase(it->second.recent);
+    entries.erase(it);
+}
+}  // namespace cppress::html
@@ -0,0 +1,430 @@
+#include "../includes/html_dom.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <new>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "../includes/doctype_element.hpp"
+#include "../includes/self_closing_element.hpp"
+
+namespace cppress::html {
+
+namespace {
+struct known_tag {
+    std::string_view name;
+    bool is_void;
+};
+
+/// Common HTML tag names, sorted, each with whether it is a void element
+constexpr known_tag KNOWN_TAGS[] = {
+    {"a", false},        {"abbr", false},     {"address", false},  {"area", true},
+    {"article", false},  {"aside", false},    {"audio", false},    {"b", false},
+    {"base", true},      {"blockquote", false}, {"body", false},   {"br", true},
+    {"button", false},   {"canvas", false},   {"caption", false},  {"code", false},
+    {"col", true},       {"colgroup", false}, {"dd", false},       {"details", false},
+    {"div", false},      {"dl", false},       {"dt", false},       {"em", false},
+    {"embed", true},     {"fieldset", false}, {"figcaption", false}, {"figure", false},
+    {"footer", false},   {"form", false},     {"h1", false},       {"h2", false},
+    {"h3", false},       {"h4", false},       {"h5", false},       {"h6", false},
+    {"head", false},     {"header", false},   {"hr", true},        {"html", false},
+    {"i", false},        {"iframe", false},   {"img", true},       {"input", true},
+    {"label", false},    {"legend", false},   {"li", false},       {"link", true},
+    {"main", false},     {"meta", true},      {"nav", false},      {"noscript", false},
+    {"ol", false},       {"optgroup", false}, {"option", false},   {"p", false},
+    {"param", true},     {"pre", false},      {"script", false},   {"section", false},
+    {"select", false},   {"small", false},    {"source", true},    {"span", false},
+    {"strong", false},   {"style", false},    {"sub", false},      {"summary", false},
+    {"sup", false},      {"svg", false},      {"table", false},    {"tbody", false},
+    {"td", false},       {"template", false}, {"textarea", false}, {"tfoot", false},
+    {"th", false},       {"thead", false},    {"time", false},     {"title", false},
+    {"tr", false},       {"track", true},     {"u", false},        {"ul", false},
+    {"video", false},    {"wbr", true}};
+
+const known_tag* find_known_tag(std::string_view lower) {
+    const known_tag* end = std::end(KNOWN_TAGS);
+    const known_tag* it = std::lower_bound(
+        std::begin(KNOWN_TAGS), end, lower,
+        [](const known_tag& tag, std::string_view name) { return tag.name < name; });
+    return it != end && it->name == lower ? it : nullptr;
+}
+
+bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+}  // namespace
+
+/**
+ * @brief Builds an html_dom from html_tokenizer's tokens.
+ *
+ * Two stages. The tokens are staged in document order, each node linked
+ * to its first child and next sibling, on an explicit stack of open
+ * elements as parse() builds; then the nodes are copied breadth first
+ * into one array in the arena, which places every node's children next
+ * to each other, and the attributes into another.
+ */
+class html_dom_builder {
+public:
+    html_dom_builder(std::string_view html, std::pmr::memory_resource* arena)
+        : html(html), arena(arena) {}
+
+    void build(html_dom& dom) {
+        html_tokenizer tokens(html);
+        for (;;) {
+            const html_token token = tokens.next();
+            if (token != html_token::text)
+                flush_text();
+            switch (token) {
+                case html_token::text:
+                    add_text(tokens.text());
+                    break;
+                case html_token::start_tag:
+                    open(tokens);
+                    break;
+                case html_token::end_tag:
+                    if (!open_elements.empty())
+                        close(tokens.name());
+                    break;
+                case html_token::doctype:
+                    // the first one is kept, wherever it was
+                    if (!dom.doctype_text.data())
+                        dom.doctype_text = tokens.text();
+                    break;
+                case html_token::end:
+                    lay_out(dom);
+                    return;
+            }
+        }
+    }
+
+private:
+    static constexpr std::uint32_t NONE = std::numeric_limits<std::uint32_t>::max();
+
+    struct staged {
+        html_node_type kind;
+        std::string_view chars;
+        std::uint32_t first_attribute = 0;
+        std::uint32_t attribute_count = 0;
+        std::uint32_t first_child = NONE;
+        std::uint32_t last_child = NONE;
+        std::uint32_t next_sibling = NONE;
+    };
+
+    /// Stages a node as the last child of the innermost open element, or at the top
+    std::uint32_t attach(staged node) {
+        if (nodes.size() >= NONE)
+            throw std::length_error("Too many HTML nodes");
+        const auto index = static_cast<std::uint32_t>(nodes.size());
+        nodes.push_back(node);
+        staged* parent = open_elements.empty() ? nullptr : &nodes[open_elements.back()];
+        std::uint32_t& first = parent ? parent->first_child : first_top;
+        std::uint32_t& last = parent ? parent->last_child : last_top;
+        if (last == NONE)
+            first = index;
+        else
+            nodes[last].next_sibling = index;
+        last = index;
+        return index;
+    }
+
+    /**
+     * Implementation Notes:
+     * - The first run is kept as a view; a second one, past a comment,
+     *   starts the joined copy in scratch
+     */
+    void add_text(std::string_view run) {
+        if (runs++ == 0) {
+            pending = run;
+            return;
+        }
+        if (runs == 2) {
+            scratch.clear();
+            append_without_line_breaks(scratch, pending);
+        }
+        append_without_line_breaks(scratch, run);
+    }
+
+    /// Stages the text read since the last tag, unless it is only whitespace
+    void flush_text() {
+        if (runs == 0)
+            return;
+        const bool joined = runs > 1;
+        runs = 0;
+        const std::string_view text = joined ? std::string_view(scratch) : pending;
+        if (std::all_of(text.begin(), text.end(), is_space))
+            return;
+        if (!joined && text.find('\n') == std::string_view::npos) {
+            attach({html_node_type::text, text});
+            return;
+        }
+        if (!joined) {
+            scratch.clear();
+            append_without_line_breaks(scratch, pending);
+        }
+        attach({html_node_type::text, store(scratch)});
+    }
+
+    void open(const html_tokenizer& tokens) {
+        const auto [tag, is_void] = intern(tokens.name());
+        const auto first = static_cast<std::uint32_t>(attributes.size());
+        for (const html_attribute& attr : tokens.attributes()) {
+            std::string_view value = attr.value;
+            if (value.find('\n') != std::string_view::npos) {
+                scratch.clear();
+                append_without_line_breaks(scratch, value);
+                value = store(scratch);
+            }
+            // a repeated name keeps its first place and its last value
+            auto it = std::find_if(
+                attributes.begin() + first, attributes.end(),
+                [&attr](const html_attribute& other) { return other.name == attr.name; });
+            if (it != attributes.end())
+                it->value = value;
+            else
+                attributes.push_back({attr.name, value});
+        }
+        const std::size_t count = attributes.size() - first;
+        if (count > std::numeric_limits<std::uint16_t>::max())
+            throw std::length_error("Too many HTML attributes");
+
+        const std::uint32_t index =
+            attach({is_void ? html_node_type::void_element : html_node_type::element, tag, first,
+                    static_cast<std::uint32_t>(count)});
+        if (!is_void)
+            open_elements.push_back(index);
+    }
+
+    /// Closes the innermost element; "</>" closes whatever it is
+    void close(std::string_view name) {
+        const std::string_view tag = nodes[open_elements.back()].chars;
+        if (!name.empty() && !html_tokenizer::equals_ignore_case(name, tag)) {
+            std::string found(name);
+            for (char& c : found)
+                c = lower(c);
+            throw std::runtime_error("Unmatched closing tag: expected </" + std::string(tag) +
+                                     "> but found </" + found + ">");
+        }
+        open_elements.pop_back();
+    }
+
+    /**
+     * @return The lower-case name, from the static table or copied once per
+     *         document, and whether it is a void element
+     */
+    std::pair<std::string_view, bool> intern(std::string_view name) {
+        lowered.assign(name);
+        for (char& c : lowered)
+            c = lower(c);
+        if (const known_tag* known = find_known_tag(lowered))
+            return {known->name, known->is_void};
+        auto it = tags.find(lowered);
+        if (it == tags.end()) {
+            const std::string_view copy = store(lowered);
+            it = tags.emplace(copy, copy).first;
+        }
+        return {it->second, false};
+    }
+
+    /**
+     * Implementation Notes:
+     * - Breadth first: when a node is copied its children are appended to
+     *   the order together, so they land next to each other
+     */
+    void lay_out(html_dom& dom) {
+        const std::size_t count = nodes.size();
+        auto* out = static_cast<html_node*>(
+            arena->allocate((count ? count : 1) * sizeof(html_node), alignof(html_node)));
+        auto* attrs = static_cast<html_attribute*>(arena->allocate(
+            (attributes.empty() ? 1 : attributes.size()) * sizeof(html_attribute),
+            alignof(html_attribute)));
+        std::copy(attributes.begin(), attributes.end(), attrs);
+
+        std::vector<std::uint32_t> order;
+        order.reserve(count);
+        for (std::uint32_t s = first_top; s != NONE; s = nodes[s].next_sibling)
+            order.push_back(s);
+        dom.top = out;
+        dom.top_count = order.size();
+
+        for (std::size_t i = 0; i < order.size(); ++i) {
+            const staged& from = nodes[order[i]];
+            html_node* to = new (out + i) html_node();
+            to->kind = from.kind;
+            to->chars = from.chars.data();
+            to->length = static_cast<std::uint32_t>(from.chars.size());
+            to->attrs = attrs + from.first_attribute;
+            to->attribute_count = static_cast<std::uint16_t>(from.attribute_count);
+            to->children = out + order.size();
+            for (std::uint32_t c = from.first_child; c != NONE; c = nodes[c].next_sibling)
+                order.push_back(c);
+            to->child_count = static_cast<std::uint32_t>(out + order.size() - to->children);
+        }
+        dom.total = count;
+    }
+
+    std::string_view store(std::string_view text) {
+        if (text.size() > std::numeric_limits<std::uint32_t>::max())
+            throw std::length_error("HTML text too large");
+        auto* chars = static_cast<char*>(arena->allocate(text.size() ? text.size() : 1, 1));
+        std::memcpy(chars, text.data(), text.size());
+        return std::string_view(chars, text.size());
+    }
+
+    static char lower(char c) {
+        return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+    }
+
+    /// Appends text without its line feeds, as parse() does
+    static void append_without_line_breaks(std::string& out, std::string_view text) {
+        std::size_t pos = 0;
+        for (std::size_t feed; (feed = text.find('\n', pos)) != std::string_view::npos;
+             pos = feed + 1)
+            out.append(text, pos, feed - pos);
+        out.append(text, pos);
+    }
+
+    std::string_view html;
+    std::pmr::memory_resource* arena;
+
+    std::vector<staged> nodes;
+    std::vector<html_attribute> attributes;
+    std::uint32_t first_top = NONE;
+    std::uint32_t last_top = NONE;
+
+    /// Elements open from the outermost in
+    std::vector<std::uint32_t> open_elements;
+
+    /// Text runs read since the last tag, the first one and how many
+    std::string_view pending;
+    std::size_t runs = 0;
+
+    /// Joined or rewritten text, and the lower-cased tag being interned
+    std::string scratch;
+    std::string lowered;
+
+    /// Tags outside KNOWN_TAGS, by their copy in the arena
+    std::unordered_map<std::string_view, std::string_view> tags;
+};
+
+html_dom html_dom::parse(std::string_view html) {
+    html_dom dom;
+    dom.arena = std::make_unique<std::pmr::monotonic_buffer_resource>(html.size() * 3 + 256);
+    auto* copy = static_cast<char*>(dom.arena->allocate(html.size() ? html.size() : 1, 1));
+    std::memcpy(copy, html.data(), html.size());
+    dom.build(std::string_view(copy, html.size()));
+    return dom;
+}
+
+html_dom html_dom::parse(std::string&& html) {
+    html_dom dom;
+    dom.owned = std::make_unique<std::string>(std::move(html));
+    dom.arena = std::make_unique<std::pmr::monotonic_buffer_resource>(dom.owned->size() * 2 + 256);
+    dom.build(*dom.owned);
+    return dom;
+}
+
+html_dom html_dom::view(std::string_view html) {
+    html_dom dom;
+    dom.arena = std::make_unique<std::pmr::monotonic_buffer_resource>(html.size() * 2 + 256);
+    dom.build(html);
+    return dom;
+}
+
+/**
+ * Implementation Notes:
+ * - The arena's first block holds, for typical pages, every node and
+ *   copy; the staging vectors are released when the builder returns
+ */
+void html_dom::build(std::string_view html) {
+    html_dom_builder builder(html, arena.get());
+    builder.build(*this);
+}
+
+const html_node& html_dom::operator[](std::size_t index) const {
+    if (index >= top_count)
+        throw std::out_of_range("html_dom index out of range");
+    return top[index];
+}
+
+void html_dom::render(html_writer& out) const {
+    if (doctype_text.data())
+        out.raw("<!DOCTYPE ").raw(doctype_text).raw('>');
+    for (const html_node& node : *this)
+        node.render(out);
+}
+
+std::vector<std::shared_ptr<element>> html_dom::to_elements() const {
+    std::vector<std::shared_ptr<element>> elements;
+    elements.reserve(top_count + 1);
+    if (doctype_text.data())
+        elements.push_back(std::make_shared<doctype_element>(std::string(doctype_text)));
+    for (const html_node& node : *this)
+        elements.push_back(node.to_element());
+    return elements;
+}
+
+const html_node& html_node::operator[](std::size_t index) const {
+    if (index >= child_count)
+        throw std::out_of_range("html_node index out of range");
+    return children[index];
+}
+
+std::string_view html_node::attribute(std::string_view name) const noexcept {
+    for (const html_attribute* it = attributes_begin(); it != attributes_end(); ++it)
+        if (it->name == name)
+            return it->value;
+    return std::string_view();
+}
+
+bool html_node::has_attribute(std::string_view name) const noexcept {
+    return std::any_of(attributes_begin(), attributes_end(),
+                       [name](const html_attribute& attr) { return attr.name == name; });
+}
+
+std::string html_node::inner_text() const {
+    if (is_text())
+        return std::string(text());
+    std::string result;
+    for (const html_node& child : *this)
+        result += child.inner_text();
+    return result;
+}
+
+void html_node::render(html_writer& out) const {
+    if (is_text()) {
+        out.raw(text());
+        return;
+    }
+    out.raw('<').raw(tag());
+    for (const html_attribute* it = attributes_begin(); it != attributes_end(); ++it) {
+        out.raw(' ').raw(it->name);
+        if (!it->value.empty())
+            out.raw("=\"").raw(it->value).raw('"');
+    }
+    if (kind == html_node_type::void_element) {
+        out.raw(" />");
+        return;
+    }
+    out.raw('>');
+    for (const html_node& child : *this)
+        child.render(out);
+    out.raw("</").raw(tag()).raw('>');
+}
+
+std::shared_ptr<element> html_node::to_element() const {
+    if (is_text())
+        return std::make_shared<element>("", std::string(text()));
+    std::map<std::string, std::string> attributes;
+    for (const html_attribute* it = attributes_begin(); it != attributes_end(); ++it)
+        attributes.emplace(it->name, it->value);
+    if (kind == html_node_type::void_element)
+        return std::make_shared<self_closing_element>(std::string(tag()), attributes);
+    auto elem = std::make_shared<element>(std::string(tag()), attributes);
+    for (const html_node& child : *this)
+        elem->add_child(child.to_element());
+    return elem;
+}
+}  // namespace cppress::html
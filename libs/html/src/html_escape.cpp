@@ -0,0 +1,336 @@
+#include "../includes/html_escape.hpp"
+
+#include <array>
+#include <cstdint>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define CPPRESS_SCAN_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define CPPRESS_SCAN_NEON 1
+#endif
+
+namespace cppress::html {
+
+namespace escape_scan {
+namespace {
+/// Byte classes, one bit per context
+enum : std::uint8_t { TEXT_SPECIAL = 1, ATTRIBUTE_SPECIAL = 2, URL_SPECIAL = 4 };
+
+constexpr std::array<std::uint8_t, 256> make_classes() {
+    std::array<std::uint8_t, 256> t{};
+    for (int c = 0; c < 256; ++c) {
+        const bool unreserved = (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') ||
+                                (c >= 'A' && c <= 'Z') || c == '-' || c == '.' || c == '_' ||
+                                c == '~';
+        std::uint8_t bits = 0;
+        if (c == '&' || c == '<' || c == '>')
+            bits |= TEXT_SPECIAL | ATTRIBUTE_SPECIAL;
+        if (c == '"' || c == '\'')
+            bits |= ATTRIBUTE_SPECIAL;
+        if (!unreserved)
+            bits |= URL_SPECIAL;
+        t[static_cast<std::size_t>(c)] = bits;
+    }
+    return t;
+}
+
+constexpr std::array<std::uint8_t, 256> classes = make_classes();
+
+inline std::size_t scalar_scan(const char* p, std::size_t from, std::size_t n,
+                               std::uint8_t kind) noexcept {
+    while (from < n && (classes[static_cast<unsigned char>(p[from])] & kind) == 0)
+        ++from;
+    return from;
+}
+
+std::size_t text_scalar(const char* p, std::size_t from, std::size_t n) noexcept {
+    return scalar_scan(p, from, n, TEXT_SPECIAL);
+}
+
+std::size_t attribute_scalar(const char* p, std::size_t from, std::size_t n) noexcept {
+    return scalar_scan(p, from, n, ATTRIBUTE_SPECIAL);
+}
+
+std::size_t url_scalar(const char* p, std::size_t from, std::size_t n) noexcept {
+    return scalar_scan(p, from, n, URL_SPECIAL);
+}
+
+#if CPPRESS_SCAN_X86
+__attribute__((target("sse2"))) inline __m128i sse2_eq(__m128i b, char c) noexcept {
+    return _mm_cmpeq_epi8(b, _mm_set1_epi8(c));
+}
+
+/// Unsigned lo <= b <= hi, as min(b - lo, hi - lo) == b - lo
+__attribute__((target("sse2"))) inline __m128i sse2_in(__m128i b, char lo, char hi) noexcept {
+    const __m128i d = _mm_sub_epi8(b, _mm_set1_epi8(lo));
+    return _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(static_cast<char>(hi - lo))), d);
+}
+
+/**
+ * The special bytes of a context as a bit mask, one bit per byte of b.
+ * Markup contexts compare against each special byte; the URL context
+ * tests the unreserved ranges and inverts the result.
+ */
+template <std::uint8_t Kind>
+__attribute__((target("sse2"))) inline std::uint32_t sse2_mask(__m128i b) noexcept {
+    if constexpr (Kind == URL_SPECIAL) {
+        const __m128i lower = _mm_or_si128(b, _mm_set1_epi8(0x20));
+        __m128i ok = _mm_or_si128(sse2_in(b, '0', '9'), sse2_in(lower, 'a', 'z'));
+        ok = _mm_or_si128(ok, _mm_or_si128(sse2_eq(b, '-'), sse2_eq(b, '.')));
+        ok = _mm_or_si128(ok, _mm_or_si128(sse2_eq(b, '_'), sse2_eq(b, '~')));
+        return static_cast<std::uint32_t>(_mm_movemask_epi8(ok)) ^ 0xffffu;
+    } else {
+        __m128i m = _mm_or_si128(sse2_eq(b, '&'), _mm_or_si128(sse2_eq(b, '<'), sse2_eq(b, '>')));
+        if constexpr (Kind == ATTRIBUTE_SPECIAL)
+            m = _mm_or_si128(m, _mm_or_si128(sse2_eq(b, '"'), sse2_eq(b, '\'')));
+        return static_cast<std::uint32_t>(_mm_movemask_epi8(m));
+    }
+}
+
+template <std::uint8_t Kind>
+__attribute__((target("sse2"))) std::size_t sse2_scan(const char* p, std::size_t from,
+                                                      std::size_t n) noexcept {
+    while (n - from >= 16) {
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + from));
+        if (const std::uint32_t m = sse2_mask<Kind>(b))
+            return from + static_cast<std::size_t>(__builtin_ctz(m));
+        from += 16;
+    }
+    return scalar_scan(p, from, n, Kind);
+}
+
+__attribute__((target("avx2"))) inline __m256i avx2_eq(__m256i b, char c) noexcept {
+    return _mm256_cmpeq_epi8(b, _mm256_set1_epi8(c));
+}
+
+__attribute__((target("avx2"))) inline __m256i avx2_in(__m256i b, char lo, char hi) noexcept {
+    const __m256i d = _mm256_sub_epi8(b, _mm256_set1_epi8(lo));
+    return _mm256_cmpeq_epi8(_mm256_min_epu8(d, _mm256_set1_epi8(static_cast<char>(hi - lo))), d);
+}
+
+/// As sse2_mask(), 32 bytes per step
+template <std::uint8_t Kind>
+__attribute__((target("avx2"))) inline std::uint32_t avx2_mask(__m256i b) noexcept {
+    if constexpr (Kind == URL_SPECIAL) {
+        const __m256i lower = _mm256_or_si256(b, _mm256_set1_epi8(0x20));
+        __m256i ok = _mm256_or_si256(avx2_in(b, '0', '9'), avx2_in(lower, 'a', 'z'));
+        ok = _mm256_or_si256(ok, _mm256_or_si256(avx2_eq(b, '-'), avx2_eq(b, '.')));
+        ok = _mm256_or_si256(ok, _mm256_or_si256(avx2_eq(b, '_'), avx2_eq(b, '~')));
+        return ~static_cast<std::uint32_t>(_mm256_movemask_epi8(ok));
+    } else {
+        __m256i m = _mm256_or_si256(avx2_eq(b, '&'),
+                                    _mm256_or_si256(avx2_eq(b, '<'), avx2_eq(b, '>')));
+        if constexpr (Kind == ATTRIBUTE_SPECIAL)
+            m = _mm256_or_si256(m, _mm256_or_si256(avx2_eq(b, '"'), avx2_eq(b, '\'')));
+        return static_cast<std::uint32_t>(_mm256_movemask_epi8(m));
+    }
+}
+
+template <std::uint8_t Kind>
+__attribute__((target("avx2"))) std::size_t avx2_scan(const char* p, std::size_t from,
+                                                      std::size_t n) noexcept {
+    while (n - from >= 32) {
+        const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + from));
+        if (const std::uint32_t m = avx2_mask<Kind>(b))
+            return from + static_cast<std::size_t>(__builtin_ctz(m));
+        from += 32;
+    }
+    return sse2_scan<Kind>(p, from, n);
+}
+
+std::size_t text_sse2(const char* p, std::size_t from, std::size_t n) noexcept {
+    return sse2_scan<TEXT_SPECIAL>(p, from, n);
+}
+
+std::size_t attribute_sse2(const char* p, std::size_t from, std::size_t n) noexcept {
+    return sse2_scan<ATTRIBUTE_SPECIAL>(p, from, n);
+}
+
+std::size_t url_sse2(const char* p, std::size_t from, std::size_t n) noexcept {
+    return sse2_scan<URL_SPECIAL>(p, from, n);
+}
+
+std::size_t text_avx2(const char* p, std::size_t from, std::size_t n) noexcept {
+    return avx2_scan<TEXT_SPECIAL>(p, from, n);
+}
+
+std::size_t attribute_avx2(const char* p, std::size_t from, std::size_t n) noexcept {
+    return avx2_scan<ATTRIBUTE_SPECIAL>(p, from, n);
+}
+
+std::size_t url_avx2(const char* p, std::size_t from, std::size_t n) noexcept {
+    return avx2_scan<URL_SPECIAL>(p, from, n);
+}
+#endif
+
+#if CPPRESS_SCAN_NEON
+/// 16 bytes per step; a non-zero lane means a candidate, located by the scalar loop
+template <std::uint8_t Kind>
+std::size_t neon_scan(const char* p, std::size_t from, std::size_t n) noexcept {
+    while (n - from >= 16) {
+        const uint8x16_t b = vld1q_u8(reinterpret_cast<const std::uint8_t*>(p + from));
+        const auto eq = [b](char c) {
+            return vceqq_u8(b, vdupq_n_u8(static_cast<std::uint8_t>(c)));
+        };
+        uint8x16_t m;
+        if constexpr (Kind == URL_SPECIAL) {
+            const uint8x16_t lower = vorrq_u8(b, vdupq_n_u8(0x20));
+            uint8x16_t ok = vandq_u8(vcgeq_u8(b, vdupq_n_u8('0')), vcleq_u8(b, vdupq_n_u8('9')));
+            ok = vorrq_u8(ok, vandq_u8(vcgeq_u8(lower, vdupq_n_u8('a')),
+                                       vcleq_u8(lower, vdupq_n_u8('z'))));
+            ok = vorrq_u8(ok, vorrq_u8(vorrq_u8(eq('-'), eq('.')), vorrq_u8(eq('_'), eq('~'))));
+            m = vmvnq_u8(ok);
+        } else {
+            m = vorrq_u8(eq('&'), vorrq_u8(eq('<'), eq('>')));
+            if constexpr (Kind == ATTRIBUTE_SPECIAL)
+                m = vorrq_u8(m, vorrq_u8(eq('"'), eq('\'')));
+        }
+        if (vmaxvq_u8(m) != 0)
+            return scalar_scan(p, from, from + 16, Kind);
+        from += 16;
+    }
+    return scalar_scan(p, from, n, Kind);
+}
+
+std::size_t text_neon(const char* p, std::size_t from, std::size_t n) noexcept {
+    return neon_scan<TEXT_SPECIAL>(p, from, n);
+}
+
+std::size_t attribute_neon(const char* p, std::size_t from, std::size_t n) noexcept {
+    return neon_scan<ATTRIBUTE_SPECIAL>(p, from, n);
+}
+
+std::size_t url_neon(const char* p, std::size_t from, std::size_t n) noexcept {
+    return neon_scan<URL_SPECIAL>(p, from, n);
+}
+#endif
+
+using scan_fn = std::size_t (*)(const char*, std::size_t, std::size_t) noexcept;
+
+struct implementation {
+    level which;
+    /// Indexed by escape_context
+    scan_fn scans[3];
+};
+
+implementation pick(level l) noexcept {
+    switch (l) {
+#if CPPRESS_SCAN_X86
+        case level::avx2:
+            return {level::avx2, {text_avx2, attribute_avx2, url_avx2}};
+        case level::sse2:
+            return {level::sse2, {text_sse2, attribute_sse2, url_sse2}};
+#endif
+#if CPPRESS_SCAN_NEON
+        case level::neon:
+            return {level::neon, {text_neon, attribute_neon, url_neon}};
+#endif
+        default:
+            return {level::scalar, {text_scalar, attribute_scalar, url_scalar}};
+    }
+}
+
+level detect() noexcept {
+#if CPPRESS_SCAN_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return level::avx2;
+    if (__builtin_cpu_supports("sse2"))
+        return level::sse2;
+    return level::scalar;
+#elif CPPRESS_SCAN_NEON
+    return level::neon;
+#else
+    return level::scalar;
+#endif
+}
+
+const level detected = detect();
+implementation current = pick(detected);
+
+bool supported(level l) noexcept {
+    switch (l) {
+        case level::scalar:
+            return true;
+        case level::sse2:
+            return detected == level::sse2 || detected == level::avx2;
+        case level::avx2:
+        case level::neon:
+            return detected == l;
+    }
+    return false;
+}
+}  // namespace
+
+std::size_t special_end(const char* p, std::size_t from, std::size_t n,
+                        escape_context context) noexcept {
+    return current.scans[static_cast<std::size_t>(context)](p, from, n);
+}
+
+level active() noexcept { return current.which; }
+
+level best() noexcept { return detected; }
+
+bool use(level l) noexcept {
+    if (!supported(l))
+        return false;
+    current = pick(l);
+    return true;
+}
+}  // namespace escape_scan
+
+/**
+ * Implementation Notes:
+ * - Room for the value as it is is reserved up front; only escaped bytes
+ *   grow the string further
+ * - ' becomes &#39;, which unlike &apos; every HTML version reads
+ * - The URL context percent-encodes UTF-8 byte by byte, as
+ *   encodeURIComponent does
+ */
+void escape_to(std::string& out, std::string_view value, escape_context context) {
+    static constexpr char HEX[] = "0123456789ABCDEF";
+    out.reserve(out.size() + value.size());
+    const char* p = value.data();
+    const std::size_t n = value.size();
+    std::size_t pos = 0;
+    for (;;) {
+        const std::size_t special = escape_scan::special_end(p, pos, n, context);
+        out.append(p + pos, special - pos);
+        if (special == n)
+            return;
+        const char c = p[special];
+        if (context == escape_context::url) {
+            const auto byte = static_cast<unsigned char>(c);
+            const char encoded[3] = {'%', HEX[byte >> 4], HEX[byte & 0xf]};
+            out.append(encoded, 3);
+        } else {
+            switch (c) {
+                case '&':
+                    out += "&amp;";
+                    break;
+                case '<':
+                    out += "&lt;";
+                    break;
+                case '>':
+                    out += "&gt;";
+                    break;
+                case '"':
+                    out += "&quot;";
+                    break;
+                default:
+                    out += "&#39;";
+                    break;
+            }
+        }
+        pos = special + 1;
+    }
+}
+
+std::string escape(std::string_view value, escape_context context) {
+    std::string out;
+    escape_to(out, value, context);
+    return out;
+}
+}  // namespace cppress::html
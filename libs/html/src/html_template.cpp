@@ -0,0 +1,488 @@
+#include "../includes/html_template.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <typeinfo>
+
+#include "../includes/doctype_element.hpp"
+#include "../includes/html_tokenizer.hpp"
+#include "../includes/html_writer.hpp"
+#include "../includes/self_closing_element.hpp"
+#include "startup_snapshot.hpp"
+
+namespace cppress::html {
+
+namespace {
+/// Whether an attribute's value is a URL
+bool is_url_attribute(std::string_view name) {
+    for (const std::string_view url : {"href", "src", "action", "formaction", "cite", "poster"})
+        if (html_tokenizer::equals_ignore_case(name, url))
+            return true;
+    return false;
+}
+}  // namespace
+
+/**
+ * @brief Serializes an element tree into an html_template's ops.
+ *
+ * Walks the tree the way to_string() does, writing markup to a pending
+ * literal run, and the text content and attribute values the way
+ * set_params() substitutes them: each {{name}} closes the run and becomes
+ * a slot op.
+ */
+class html_template_compiler {
+public:
+    void node(const element& node) {
+        if (const auto* doctype = dynamic_cast<const doctype_element*>(&node)) {
+            literal("<!DOCTYPE ");
+            value(doctype->get_text_content(), escape_context::text);
+            literal(">");
+            return;
+        }
+        const std::string tag = node.get_tag();
+        const std::size_t parent = current;
+        if (!tag.empty())
+            current = elements++;
+
+        if (dynamic_cast<const self_closing_element*>(&node)) {
+            literal("<" + tag);
+            attributes(node);
+            literal(" />");
+        } else if (typeid(node) != typeid(element)) {
+            // a subclass with its own render(): its output, slots found as in text
+            value(node.to_string(), escape_context::text);
+        } else {
+            if (!tag.empty()) {
+                literal("<" + tag);
+                attributes(node);
+                literal(">");
+            }
+            value(node.get_text_content(), escape_context::text);
+            for (const auto& child : node)
+                this->node(*child);
+            if (!tag.empty())
+                literal("</" + tag + ">");
+        }
+        current = parent;
+    }
+
+    void literal(std::string_view text) {
+        out.literals += text;
+        pending += text.size();
+    }
+
+    html_template finish() {
+        flush();
+        if (out.literals.size() > std::numeric_limits<std::uint32_t>::max() ||
+            out.ops.size() > std::numeric_limits<std::uint32_t>::max())
+            throw std::length_error("Template too large");
+        out.slot_fields.resize(out.names.size());
+        return std::move(out);
+    }
+
+private:
+    void attributes(const element& node) {
+        for (auto it = node.attributes_begin(); it != node.attributes_end(); ++it) {
+            literal(" " + it->first);
+            if (it->second.empty())
+                continue;
+            literal("=\"");
+            value(it->second, escape_context::attribute, is_url_attribute(it->first), it->first);
+            literal("\"");
+        }
+    }
+
+    /**
+     * Implementation Notes:
+     * - Placeholders are matched as substitute_params() matches them: in
+     *   "{{{a}}}" the slot is "a", in "{{a{{b}}" it is "b"
+     * - In a URL, slots past the first byte are URL parts
+     * - A value that may hold slots gets ops of its own, so it can be a field
+     */
+    void value(std::string_view text, escape_context where, bool url = false,
+               std::string_view attribute = {}) {
+        const bool may_hold_slots = text.find("{{") != std::string_view::npos;
+        if (may_hold_slots)
+            flush();
+        const std::size_t first = out.ops.size();
+        std::size_t pos = 0;
+        for (;;) {
+            std::size_t open = text.find("{{", pos);
+            if (open == std::string_view::npos)
+                break;
+            while (open + 2 < text.size() && text[open + 2] == '{')
+                ++open;
+            const std::size_t close = text.find("}}", open + 2);
+            if (close == std::string_view::npos)
+                break;
+            const std::string_view name = text.substr(open + 2, close - open - 2);
+            const std::size_t nested = name.find("{{");
+            if (nested != std::string_view::npos) {
+                literal(text.substr(pos, open + 2 + nested - pos));
+                pos = open + 2 + nested;
+                continue;
+            }
+            literal(text.substr(pos, open - pos));
+            slot(name, url && open > 0 ? escape_context::url : where);
+            pos = close + 2;
+        }
+        literal(text.substr(pos));
+        if (may_hold_slots) {
+            flush();
+            field(first, attribute);
+        }
+    }
+
+    /// Records ops from first on as a field, if a slot is among them
+    void field(std::size_t first, std::string_view attribute) {
+        html_template::field added{current, std::string(attribute), {}};
+        for (std::size_t i = first; i < out.ops.size(); ++i) {
+            const std::size_t slot = out.ops[i].slot;
+            if (slot != html_template::NO_SLOT &&
+                std::find(added.slots.begin(), added.slots.end(), slot) == added.slots.end())
+                added.slots.push_back(slot);
+        }
+        if (added.slots.empty())
+            return;
+        if (out.slot_fields.size() < out.names.size())
+            out.slot_fields.resize(out.names.size());
+        for (const std::size_t slot : added.slots)
+            out.slot_fields[slot].push_back(out.field_list.size());
+        out.field_ops.emplace_back(static_cast<std::uint32_t>(first),
+                                   static_cast<std::uint32_t>(out.ops.size()));
+        out.field_list.push_back(std::move(added));
+    }
+
+    void slot(std::string_view name, escape_context where) {
+        flush();
+        auto it = index.find(name);
+        if (it == index.end()) {
+            it = index.emplace(std::string(name), out.names.size()).first;
+            out.names.emplace_back(name);
+        }
+        out.ops.push_back({0, 0, it->second, where});
+    }
+
+    void flush() {
+        if (!pending)
+            return;
+        const std::size_t offset = out.literals.size() - pending;
+        out.ops.push_back({static_cast<std::uint32_t>(offset), static_cast<std::uint32_t>(pending),
+                           html_template::NO_SLOT, escape_context::text});
+        pending = 0;
+    }
+
+    html_template out;
+
+    /// Bytes at the end of out.literals not in an op yet
+    std::size_t pending = 0;
+
+    /// Elements numbered so far, and the one being compiled
+    std::size_t elements = 0;
+    std::size_t current = html_template::NO_NODE;
+
+    std::map<std::string, std::size_t, std::less<>> index;
+};
+
+html_template html_template::compile(const std::vector<std::shared_ptr<element>>& elements) {
+    html_template_compiler compiler;
+    for (const auto& elem : elements)
+        if (elem)
+            compiler.node(*elem);
+    return compiler.finish();
+}
+
+html_template html_template::compile(const element& root) {
+    html_template_compiler compiler;
+    compiler.node(root);
+    return compiler.finish();
+}
+
+/**
+ * Implementation Notes:
+ * - The doctype is not a slot: document::to_string() writes it as set
+ */
+html_template html_template::compile(const document& doc) {
+    html_template_compiler compiler;
+    compiler.literal("<!DOCTYPE " + doc.get_doctype() + ">");
+    compiler.node(*doc.get_root());
+    return compiler.finish();
+}
+
+/**
+ * Implementation Notes:
+ * - The output grows once, by the literals and the raw values; only
+ *   escaped characters can make it grow again
+ */
+void html_template::render(std::string& out, const std::vector<std::string_view>& values) const {
+    std::size_t size = out.size() + literals.size();
+    for (const std::string_view value : values)
+        size += value.size();
+    out.reserve(size);
+    append(out, 0, ops.size(), values);
+}
+
+void html_template::append(std::string& out, std::size_t first, std::size_t last,
+                           const std::vector<std::string_view>& values) const {
+    for (std::size_t i = first; i < last; ++i) {
+        const op& step = ops[i];
+        if (step.slot == NO_SLOT) {
+            out.append(literals, step.offset, step.length);
+        } else if (step.slot < values.size() && values[step.slot].data()) {
+            escape_to(out, values[step.slot], step.where);
+        } else {
+            out += "{{";
+            out += names[step.slot];
+            out += "}}";
+        }
+    }
+}
+
+/**
+ * Implementation Notes:
+ * - Literal runs and values go through the writer's buffer; only
+ *   fragments can skip it
+ */
+void html_template::render(html_writer& out, const std::vector<std::string_view>& values,
+                           const std::vector<html_fragment>& fragments) const {
+    const std::string_view all = literals;
+    for (const op& step : ops) {
+        if (step.slot == NO_SLOT) {
+            out.raw(all.substr(step.offset, step.length));
+            continue;
+        }
+        std::string_view value;
+        if (step.slot < fragments.size() && fragments[step.slot]) {
+            if (step.where == escape_context::text) {
+                out.fragment(fragments[step.slot]);
+                continue;
+            }
+            value = *fragments[step.slot];
+        } else if (step.slot < values.size() && values[step.slot].data()) {
+            value = values[step.slot];
+        } else {
+            out.raw("{{").raw(names[step.slot]).raw("}}");
+            continue;
+        }
+        out.escaped(value, step.where);
+    }
+}
+
+void html_template::render(std::string& out,
+                           const std::map<std::string, std::string>& params) const {
+    std::vector<std::string_view> values(names.size());
+    for (std::size_t i = 0; i < names.size(); ++i) {
+        const auto it = params.find(names[i]);
+        if (it != params.end())
+            values[i] = std::string_view(it->second.data(), it->second.size());
+    }
+    render(out, values);
+}
+
+std::string html_template::render(const std::map<std::string, std::string>& params) const {
+    std::string out;
+    render(out, params);
+    return out;
+}
+
+std::size_t html_template::slot(std::string_view name) const noexcept {
+    for (std::size_t i = 0; i < names.size(); ++i)
+        if (names[i] == name)
+            return i;
+    return NO_SLOT;
+}
+const std::vector<std::size_t>& html_template::fields_of(std::size_t slot) const noexcept {
+    static const std::vector<std::size_t> none;
+    return slot < slot_fields.size() ? slot_fields[slot] : none;
+}
+
+void html_template::render_field(std::string& out, std::size_t field,
+                                 const std::vector<std::string_view>& values) const {
+    const auto [first, last] = field_ops.at(field);
+    append(out, first, last, values);
+}
+
+/**
+ * Implementation Notes:
+ * - Everything compile() derived is written, the slot-to-field lists
+ *   included, so deserialize() only copies and checks
+ */
+std::string html_template::serialize() const {
+    shared::snapshot_encoder out;
+    out.string(literals);
+    out.u64(ops.size());
+    for (const auto& o : ops) {
+        out.u32(o.offset);
+        out.u32(o.length);
+        out.u64(o.slot);
+        out.u32(static_cast<std::uint32_t>(o.where));
+    }
+    out.u64(names.size());
+    for (const auto& name : names)
+        out.string(name);
+    out.u64(field_list.size());
+    for (std::size_t f = 0; f < field_list.size(); ++f) {
+        out.u64(field_list[f].node);
+        out.string(field_list[f].attribute);
+        out.u64(field_list[f].slots.size());
+        for (const std::size_t slot : field_list[f].slots)
+            out.u64(slot);
+        out.u32(field_ops[f].first);
+        out.u32(field_ops[f].second);
+    }
+    for (const auto& fields : slot_fields) {
+        out.u64(fields.size());
+        for (const std::size_t field : fields)
+            out.u64(field);
+    }
+    return out.take();
+}
+
+/**
+ * Implementation Notes:
+ * - Every offset and index is checked against what it refers to, so a
+ *   template that loads renders within its own ops and literals
+ */
+html_template html_template::deserialize(std::string_view bytes) {
+    shared::snapshot_decoder in(bytes);
+    html_template tpl;
+    tpl.literals = std::string(in.string());
+    tpl.ops.resize(in.count(4 + 4 + 8 + 4));
+    for (auto& o : tpl.ops) {
+        o.offset = in.u32();
+        o.length = in.u32();
+        o.slot = static_cast<std::size_t>(in.u64());
+        const std::uint32_t where = in.u32();
+        if (where > static_cast<std::uint32_t>(escape_context::url))
+            throw std::runtime_error("Bad escape context in template snapshot");
+        o.where = static_cast<escape_context>(where);
+        if (std::size_t(o.offset) + o.length > tpl.literals.size())
+            throw std::runtime_error("Template snapshot op past its literals");
+    }
+    tpl.names.resize(in.count(8));
+    for (auto& name : tpl.names)
+        name = std::string(in.string());
+    for (const auto& o : tpl.ops)
+        if (o.slot != NO_SLOT && o.slot >= tpl.names.size())
+            throw std::runtime_error("Template snapshot op refers to an unknown slot");
+
+    const std::size_t fields = in.count(8 + 8 + 8 + 4 + 4);
+    tpl.field_list.resize(fields);
+    tpl.field_ops.resize(fields);
+    for (std::size_t f = 0; f < fields; ++f) {
+        auto& field = tpl.field_list[f];
+        field.node = static_cast<std::size_t>(in.u64());
+        field.attribute = std::string(in.string());
+        field.slots.resize(in.count(8));
+        for (auto& slot : field.slots)
+            if ((slot = static_cast<std::size_t>(in.u64())) >= tpl.names.size())
+                throw std::runtime_error("Template snapshot field refers to an unknown slot");
+        auto& [first, last] = tpl.field_ops[f];
+        first = in.u32();
+        last = in.u32();
+        if (first > last || last > tpl.ops.size())
+            throw std::runtime_error("Template snapshot field past its ops");
+    }
+    tpl.slot_fields.resize(tpl.names.size());
+    for (auto& list : tpl.slot_fields) {
+        list.resize(in.count(8));
+        for (auto& field : list)
+            if ((field = static_cast<std::size_t>(in.u64())) >= fields)
+                throw std::runtime_error("Template snapshot slot refers to an unknown field");
+    }
+    if (!in.done())
+        throw std::runtime_error("Trailing bytes in template snapshot");
+    return tpl;
+}
+
+template_instance::template_instance(const html_template& tpl,
+                                     const std::vector<std::string_view>& values)
+    : tpl(&tpl), values(tpl.names.size()), markup(tpl.field_list.size()) {
+    for (std::size_t i = 0; i < this->values.size() && i < values.size(); ++i)
+        if (values[i].data())
+            this->values[i].emplace(values[i]);
+    const std::vector<std::string_view> current = views();
+    for (std::size_t f = 0; f < markup.size(); ++f)
+        tpl.render_field(markup[f], f, current);
+}
+
+/**
+ * Implementation Notes:
+ * - Only the fields of slots whose value changed are rendered; a field
+ *   whose markup comes out the same is not a patch
+ */
+std::vector<html_template::patch> template_instance::update(
+    const std::vector<std::string_view>& values) {
+    std::vector<bool> dirty(markup.size());
+    bool changed = false;
+    for (std::size_t i = 0; i < this->values.size(); ++i) {
+        std::optional<std::string>& held = this->values[i];
+        const bool given = i < values.size() && values[i].data();
+        if (given ? held && *held == values[i] : !held)
+            continue;
+        if (given)
+            held.emplace(values[i]);
+        else
+            held.reset();
+        for (const std::size_t f : tpl->fields_of(i))
+            dirty[f] = true;
+        changed = true;
+    }
+
+    std::vector<html_template::patch> patches;
+    if (!changed)
+        return patches;
+    const std::vector<std::string_view> current = views();
+    std::string rendered;
+    for (std::size_t f = 0; f < markup.size(); ++f) {
+        if (!dirty[f])
+            continue;
+        rendered.clear();
+        tpl->render_field(rendered, f, current);
+        if (rendered == markup[f])
+            continue;
+        markup[f] = rendered;
+        patches.push_back({f, rendered});
+        page_stale = true;
+    }
+    return patches;
+}
+
+/**
+ * Implementation Notes:
+ * - Joined from the literal ops between fields and the fields' markup, and
+ *   kept until the next update() changes a field
+ */
+const std::string& template_instance::html() {
+    if (!page_stale)
+        return page;
+    std::size_t size = tpl->literals.size();
+    for (const std::string& m : markup)
+        size += m.size();
+    page.clear();
+    page.reserve(size);
+
+    std::size_t f = 0;
+    for (std::size_t i = 0; i < tpl->ops.size();) {
+        if (f < tpl->field_ops.size() && tpl->field_ops[f].first == i) {
+            page += markup[f];
+            i = tpl->field_ops[f++].second;
+            continue;
+        }
+        const html_template::op& step = tpl->ops[i++];
+        page.append(tpl->literals, step.offset, step.length);
+    }
+    page_stale = false;
+    return page;
+}
+
+std::vector<std::string_view> template_instance::views() const {
+    std::vector<std::string_view> result(values.size());
+    for (std::size_t i = 0; i < values.size(); ++i)
+        if (values[i])
+            result[i] = *values[i];
+    return result;
+}
+}  // namespace cppress::html
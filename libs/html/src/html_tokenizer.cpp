@@ -0,0 +1,218 @@
+#include "../includes/html_tokenizer.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace cppress::html {
+
+namespace {
+bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f';
+}
+
+bool is_alpha(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+char to_lower(char c) {
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+/// Whether the '<' at pos opens markup rather than being text
+bool opens_markup(std::string_view html, std::size_t pos) {
+    if (pos + 1 >= html.size())
+        return false;
+    const char c = html[pos + 1];
+    return is_alpha(c) || c == '/' || c == '!' || c == '?';
+}
+
+/// Elements whose content is text up to their closing tag
+bool is_raw_text_element(std::string_view name) {
+    for (const std::string_view raw : {"script", "style", "textarea", "title"})
+        if (html_tokenizer::equals_ignore_case(name, raw))
+            return true;
+    return false;
+}
+}  // namespace
+
+bool html_tokenizer::equals_ignore_case(std::string_view a, std::string_view b) noexcept {
+    if (a.size() != b.size())
+        return false;
+    for (std::size_t i = 0; i < a.size(); ++i)
+        if (to_lower(a[i]) != to_lower(b[i]))
+            return false;
+    return true;
+}
+
+/**
+ * Implementation Notes:
+ * - Skipped constructs loop here instead of returning, so a caller sees
+ *   only text, tags and the doctype
+ */
+html_token html_tokenizer::next() {
+    for (;;) {
+        start = pos;
+        if (!raw_text_end.empty()) {
+            // the content runs to "</name" followed by a space, '/' or '>'
+            std::size_t close = pos;
+            while ((close = html.find("</", close)) != std::string_view::npos) {
+                const std::size_t after = close + 2 + raw_text_end.size();
+                if (equals_ignore_case(html.substr(close + 2, raw_text_end.size()), raw_text_end) &&
+                    (after >= html.size() || is_space(html[after]) || html[after] == '/' ||
+                     html[after] == '>'))
+                    break;
+                close += 2;
+            }
+            raw_text_end = std::string_view();
+            if (close == std::string_view::npos)
+                close = html.size();
+            if (close > pos) {
+                content = html.substr(pos, close - pos);
+                pos = close;
+                return html_token::text;
+            }
+        }
+        if (pos >= html.size())
+            return html_token::end;
+        if (html[pos] != '<' || !opens_markup(html, pos))
+            return read_text();
+
+        switch (html[pos + 1]) {
+            case '/':
+                return read_end_tag();
+            case '!':
+                if (html.compare(pos, 4, "<!--") == 0) {
+                    skip_past(pos + 4, "-->", "Malformed comment: no closing tag found");
+                    continue;
+                }
+                if (equals_ignore_case(html.substr(pos + 2, 7), "doctype"))
+                    return read_doctype();
+                skip_past(pos + 2, ">", "Malformed HTML: no closing '>' found");
+                continue;
+            case '?':
+                skip_past(pos + 2, ">", "Malformed HTML: no closing '>' found");
+                continue;
+            default:
+                return read_start_tag();
+        }
+    }
+}
+
+/**
+ * Implementation Notes:
+ * - memchr() finds each '<'; one that opens no markup is part of the text
+ */
+html_token html_tokenizer::read_text() {
+    std::size_t end = pos;
+    for (;;) {
+        const void* hit = std::memchr(html.data() + end, '<', html.size() - end);
+        if (!hit) {
+            end = html.size();
+            break;
+        }
+        end = static_cast<std::size_t>(static_cast<const char*>(hit) - html.data());
+        if (end > pos && opens_markup(html, end))
+            break;
+        ++end;
+    }
+    content = html.substr(pos, end - pos);
+    pos = end;
+    return html_token::text;
+}
+
+html_token html_tokenizer::read_start_tag() {
+    const std::size_t name_start = ++pos;
+    while (pos < html.size() && !is_space(html[pos]) && html[pos] != '/' && html[pos] != '>')
+        ++pos;
+    tag_name = html.substr(name_start, pos - name_start);
+    attrs.clear();
+    closed = false;
+
+    for (;;) {
+        while (pos < html.size() && (is_space(html[pos]) || html[pos] == '/')) {
+            closed = html[pos] == '/';
+            ++pos;
+        }
+        if (pos >= html.size())
+            throw std::runtime_error("Malformed HTML: no closing '>' found");
+        if (html[pos] == '>') {
+            ++pos;
+            break;
+        }
+        closed = false;
+
+        const std::size_t attr_start = pos++;
+        while (pos < html.size() && !is_space(html[pos]) && html[pos] != '/' &&
+               html[pos] != '>' && html[pos] != '=')
+            ++pos;
+        html_attribute attr{html.substr(attr_start, pos - attr_start), std::string_view()};
+        std::size_t after = pos;
+        while (after < html.size() && is_space(html[after]))
+            ++after;
+        if (after < html.size() && html[after] == '=') {
+            pos = after + 1;
+            while (pos < html.size() && is_space(html[pos]))
+                ++pos;
+            if (pos < html.size() && (html[pos] == '"' || html[pos] == '\'')) {
+                const std::size_t close = html.find(html[pos], pos + 1);
+                if (close == std::string_view::npos)
+                    throw std::runtime_error("Malformed HTML: unterminated attribute value");
+                attr.value = html.substr(pos + 1, close - pos - 1);
+                pos = close + 1;
+            } else {
+                const std::size_t value_start = pos;
+                while (pos < html.size() && !is_space(html[pos]) && html[pos] != '>')
+                    ++pos;
+                attr.value = html.substr(value_start, pos - value_start);
+            }
+        }
+        attrs.push_back(attr);
+    }
+
+    if (!closed && is_raw_text_element(tag_name))
+        raw_text_end = tag_name;
+    return html_token::start_tag;
+}
+
+/**
+ * Implementation Notes:
+ * - Spaces after "</" and anything after the name are passed over, as
+ *   browsers do
+ */
+html_token html_tokenizer::read_end_tag() {
+    pos += 2;
+    while (pos < html.size() && is_space(html[pos]))
+        ++pos;
+    const std::size_t name_start = pos;
+    while (pos < html.size() && !is_space(html[pos]) && html[pos] != '>')
+        ++pos;
+    tag_name = html.substr(name_start, pos - name_start);
+    const std::size_t close = html.find('>', pos);
+    if (close == std::string_view::npos)
+        throw std::runtime_error("Malformed HTML: no closing '>' found");
+    pos = close + 1;
+    return html_token::end_tag;
+}
+
+html_token html_tokenizer::read_doctype() {
+    std::size_t first = pos + 9;
+    const std::size_t close = html.find('>', first);
+    if (close == std::string_view::npos)
+        throw std::runtime_error("Malformed HTML: no closing '>' found");
+    std::size_t last = close;
+    while (first < last && is_space(html[first]))
+        ++first;
+    while (last > first && is_space(html[last - 1]))
+        --last;
+    content = html.substr(first, last - first);
+    pos = close + 1;
+    return html_token::doctype;
+}
+
+void html_tokenizer::skip_past(std::size_t from, std::string_view terminator, const char* what) {
+    const std::size_t end = html.find(terminator, from);
+    if (end == std::string_view::npos)
+        throw std::runtime_error(what);
+    pos = end + terminator.size();
+}
+}  // namespace cppress::html
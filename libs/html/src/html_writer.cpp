@@ -0,0 +1,43 @@
+#include "../includes/html_writer.hpp"
+
+namespace cppress::html {
+
+html_writer::html_writer(html_sink sink, std::size_t chunk_size)
+    : out(&buffer), sink(std::move(sink)), chunk_size(chunk_size ? chunk_size : 1) {
+    // room for the text node that crosses the chunk size
+    buffer.reserve(2 * this->chunk_size);
+}
+
+html_writer::html_writer(html_sink sink, html_fragment_sink fragments, std::size_t chunk_size)
+    : html_writer(std::move(sink), chunk_size) {
+    this->fragments = std::move(fragments);
+}
+
+html_writer& html_writer::fragment(const html_fragment& markup) {
+    if (!markup)
+        return *this;
+    if (!fragments || !sink || markup->size() < MIN_SPLICE_SIZE)
+        return raw(*markup);
+    flush();
+    fragments(markup);
+    return *this;
+}
+
+html_writer& html_writer::attribute(std::string_view name, std::string_view value) {
+    out->push_back(' ');
+    out->append(name);
+    out->append("=\"");
+    html::escape_to(*out, value, escape_context::attribute);
+    out->push_back('"');
+    return filled();
+}
+
+void html_writer::flush() {
+    if (!sink || buffer.empty())
+        return;
+    sink(std::move(buffer));
+    buffer = std::string();
+    buffer.reserve(2 * chunk_size);
+}
+
+}  // namespace cppress::html
@@ -0,0 +1,367 @@
+#include "../includes/selector.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+#include "../includes/html_tokenizer.hpp"
+
+namespace cppress::html {
+
+namespace {
+bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f';
+}
+
+bool is_name_char(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+           c == '-' || c == '_' || static_cast<unsigned char>(c) >= 0x80;
+}
+
+std::string to_lower_case(std::string_view name) {
+    std::string lower(name);
+    for (char& c : lower)
+        if (c >= 'A' && c <= 'Z')
+            c = static_cast<char>(c - 'A' + 'a');
+    return lower;
+}
+
+/// Whether list, split at whitespace, holds word
+bool has_word(std::string_view list, std::string_view word) {
+    if (word.empty())
+        return false;
+    std::size_t pos = 0;
+    while ((pos = list.find(word, pos)) != std::string_view::npos) {
+        const std::size_t end = pos + word.size();
+        if ((pos == 0 || is_space(list[pos - 1])) && (end == list.size() || is_space(list[end])))
+            return true;
+        pos = end;
+    }
+    return false;
+}
+
+/// Calls each for every whitespace-separated word of list
+template <typename Each>
+void for_each_word(std::string_view list, Each&& each) {
+    std::size_t pos = 0;
+    for (;;) {
+        while (pos < list.size() && is_space(list[pos]))
+            ++pos;
+        if (pos >= list.size())
+            return;
+        const std::size_t start = pos;
+        while (pos < list.size() && !is_space(list[pos]))
+            ++pos;
+        each(list.substr(start, pos - start));
+    }
+}
+}  // namespace
+
+/**
+ * @brief Reads a selector list into a selector's chains, left to right.
+ */
+class selector_reader {
+public:
+    explicit selector_reader(std::string_view text) : text(text) {}
+
+    void read(std::vector<std::vector<selector::compound>>& chains) {
+        for (;;) {
+            chains.emplace_back();
+            read_chain(chains.back());
+            skip_spaces();
+            if (pos >= text.size())
+                return;
+            if (text[pos] != ',')
+                fail();
+            ++pos;
+        }
+    }
+
+private:
+    void read_chain(std::vector<selector::compound>& chain) {
+        skip_spaces();
+        char combinator = 0;
+        for (;;) {
+            chain.emplace_back();
+            read_compound(chain.back());
+            chain.back().combinator = combinator;
+
+            const std::size_t before = pos;
+            skip_spaces();
+            if (pos >= text.size() || text[pos] == ',')
+                return;
+            if (text[pos] == '>') {
+                ++pos;
+                skip_spaces();
+                combinator = '>';
+            } else if (pos > before) {
+                combinator = ' ';
+            } else {
+                fail();
+            }
+        }
+    }
+
+    void read_compound(selector::compound& compound) {
+        bool any = false;
+        if (pos < text.size() && text[pos] == '*') {
+            ++pos;
+            any = true;
+        } else if (pos < text.size() && is_name_char(text[pos])) {
+            compound.tag = to_lower_case(read_name());
+            any = true;
+        }
+        while (pos < text.size()) {
+            const char c = text[pos];
+            if (c == '#') {
+                ++pos;
+                compound.id = std::string(read_name());
+            } else if (c == '.') {
+                ++pos;
+                compound.classes.emplace_back(read_name());
+            } else if (c == '[') {
+                ++pos;
+                compound.attributes.push_back(read_attribute());
+            } else {
+                break;
+            }
+            any = true;
+        }
+        if (!any)
+            fail();
+    }
+
+    /// Reads an attribute selector after its '['
+    selector::attribute_test read_attribute() {
+        selector::attribute_test test;
+        skip_spaces();
+        test.name = std::string(read_name());
+        skip_spaces();
+        if (pos < text.size() && text[pos] != ']') {
+            const char op = text[pos];
+            if (op == '=') {
+                ++pos;
+            } else if ((op == '~' || op == '^' || op == '$' || op == '*') &&
+                       pos + 1 < text.size() && text[pos + 1] == '=') {
+                pos += 2;
+            } else {
+                fail();
+            }
+            test.op = op;
+            skip_spaces();
+            if (pos < text.size() && (text[pos] == '"' || text[pos] == '\'')) {
+                const std::size_t close = text.find(text[pos], pos + 1);
+                if (close == std::string_view::npos)
+                    fail();
+                test.value = std::string(text.substr(pos + 1, close - pos - 1));
+                pos = close + 1;
+            } else {
+                test.value = std::string(read_name());
+            }
+            skip_spaces();
+        }
+        if (pos >= text.size() || text[pos] != ']')
+            fail();
+        ++pos;
+        return test;
+    }
+
+    std::string_view read_name() {
+        const std::size_t start = pos;
+        while (pos < text.size() && is_name_char(text[pos]))
+            ++pos;
+        if (pos == start)
+            fail();
+        return text.substr(start, pos - start);
+    }
+
+    void skip_spaces() {
+        while (pos < text.size() && is_space(text[pos]))
+            ++pos;
+    }
+
+    [[noreturn]] void fail() const {
+        throw std::runtime_error("Invalid selector at offset " + std::to_string(pos) + ": " +
+                                 std::string(text));
+    }
+
+    std::string_view text;
+    std::size_t pos = 0;
+};
+
+selector selector::parse(std::string_view text) {
+    selector result;
+    selector_reader(text).read(result.chains);
+    return result;
+}
+
+/**
+ * Implementation Notes:
+ * - Depth first on an explicit stack, so entries are in document order and
+ *   each index's lists come out sorted
+ * - Text nodes (elements without a tag) are left out
+ */
+selector_index::selector_index(const std::shared_ptr<element>& root) {
+    std::vector<std::pair<const std::shared_ptr<element>*, std::uint32_t>> pending;
+    if (root)
+        pending.emplace_back(&root, NONE);
+    while (!pending.empty()) {
+        const auto [node, parent] = pending.back();
+        pending.pop_back();
+        const element& elem = **node;
+        const std::string tag = elem.get_tag();
+        if (tag.empty())
+            continue;
+        if (entries.size() >= NONE)
+            throw std::length_error("Too many elements to index");
+
+        const auto at = static_cast<std::uint32_t>(entries.size());
+        entries.push_back({*node, parent});
+        tags[to_lower_case(tag)].push_back(at);
+        const auto& attributes = elem.get_attributes();
+        if (const auto id = attributes.find("id"); id != attributes.end() && !id->second.empty())
+            ids[id->second].push_back(at);
+        if (const auto cls = attributes.find("class"); cls != attributes.end()) {
+            for_each_word(cls->second, [this, at](std::string_view word) {
+                auto& list = classes[std::string(word)];
+                // "a a" names the class once
+                if (list.empty() || list.back() != at)
+                    list.push_back(at);
+            });
+        }
+
+        const auto& children = elem.get_children();
+        for (auto it = children.rbegin(); it != children.rend(); ++it)
+            if (*it)
+                pending.emplace_back(&*it, at);
+    }
+}
+
+const std::vector<std::uint32_t>* selector_index::candidates(
+    const selector::compound& last) const {
+    const auto lookup = [this](const postings& index, std::string_view key) {
+        const auto it = index.find(key);
+        return it == index.end() ? &none : &it->second;
+    };
+    if (!last.id.empty())
+        return lookup(ids, last.id);
+    const std::vector<std::uint32_t>* best = nullptr;
+    for (const std::string& name : last.classes) {
+        const auto* list = lookup(classes, name);
+        if (!best || list->size() < best->size())
+            best = list;
+    }
+    if (!last.tag.empty()) {
+        const auto* list = lookup(tags, last.tag);
+        if (!best || list->size() < best->size())
+            best = list;
+    }
+    return best;
+}
+
+bool selector_index::matches(const selector::compound& test, std::uint32_t at) const {
+    const element& elem = *entries[at].node;
+    if (!test.tag.empty() && !html_tokenizer::equals_ignore_case(elem.get_tag(), test.tag))
+        return false;
+    const auto& attributes = elem.get_attributes();
+    const auto value_of = [&attributes](const std::string& name) -> const std::string* {
+        const auto it = attributes.find(name);
+        return it == attributes.end() ? nullptr : &it->second;
+    };
+    if (!test.id.empty()) {
+        const std::string* id = value_of("id");
+        if (!id || *id != test.id)
+            return false;
+    }
+    if (!test.classes.empty()) {
+        const std::string* cls = value_of("class");
+        if (!cls)
+            return false;
+        for (const std::string& name : test.classes)
+            if (!has_word(*cls, name))
+                return false;
+    }
+    for (const auto& attr : test.attributes) {
+        const std::string* value = value_of(attr.name);
+        if (!value)
+            return false;
+        const std::string_view v = *value;
+        const std::string_view want = attr.value;
+        switch (attr.op) {
+            case 0:
+                break;
+            case '=':
+                if (v != want)
+                    return false;
+                break;
+            case '~':
+                if (!has_word(v, want))
+                    return false;
+                break;
+            case '^':
+                if (want.empty() || v.substr(0, want.size()) != want)
+                    return false;
+                break;
+            case '$':
+                if (want.empty() || v.size() < want.size() ||
+                    v.substr(v.size() - want.size()) != want)
+                    return false;
+                break;
+            default:
+                if (want.empty() || v.find(want) == std::string_view::npos)
+                    return false;
+                break;
+        }
+    }
+    return true;
+}
+
+bool selector_index::matches(const std::vector<selector::compound>& chain, std::size_t last,
+                             std::uint32_t at) const {
+    if (!matches(chain[last], at))
+        return false;
+    if (last == 0)
+        return true;
+    std::uint32_t parent = entries[at].parent;
+    if (chain[last].combinator == '>')
+        return parent != NONE && matches(chain, last - 1, parent);
+    for (; parent != NONE; parent = entries[parent].parent)
+        if (matches(chain, last - 1, parent))
+            return true;
+    return false;
+}
+
+/**
+ * Implementation Notes:
+ * - Each chain is matched right to left over its candidates, which are in
+ *   document order; the results of a list are merged in that order
+ */
+std::vector<std::shared_ptr<element>> selector_index::select(const selector& query,
+                                                             std::size_t limit) const {
+    std::vector<std::uint32_t> found;
+    for (const auto& chain : query.chains) {
+        const std::vector<std::uint32_t>* list = candidates(chain.back());
+        const std::size_t count = list ? list->size() : entries.size();
+        std::size_t matched = 0;
+        for (std::size_t i = 0; i < count && matched < limit; ++i) {
+            const std::uint32_t at = list ? (*list)[i] : static_cast<std::uint32_t>(i);
+            if (matches(chain, chain.size() - 1, at)) {
+                found.push_back(at);
+                ++matched;
+            }
+        }
+    }
+    if (query.chains.size() > 1) {
+        std::sort(found.begin(), found.end());
+        found.erase(std::unique(found.begin(), found.end()), found.end());
+    }
+    if (found.size() > limit)
+        found.resize(limit);
+
+    std::vector<std::shared_ptr<element>> result;
+    result.reserve(found.size());
+    for (const std::uint32_t at : found)
+        result.push_back(entries[at].node);
+    return result;
+}
+}  // namespace cppress::html
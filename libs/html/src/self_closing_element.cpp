@@ -8,22 +8,15 @@ self_closing_element::self_closing_element(const std::string& tag,
                                            const std::map<std::string, std::string>& attributes)
     : element(tag, attributes) {}
 
-std::string self_closing_element::to_string() const {
-    std::string result = "<" + get_tag();
-    for (const auto& attr : get_attributes()) {
-        if (attr.second.empty()) {
-            result += " " + attr.first;
-        } else {
-            result += " " + attr.first + "=\"" + attr.second + "\"";
-        }
-    }
-    result += " />";
-    return result;
+void self_closing_element::render(html_writer& out) const {
+    out.raw('<').raw(tag);
+    render_attributes(out);
+    out.raw(" />");
 }
 
-std::vector<std::shared_ptr<element>> self_closing_element::get_children() const {
-    // throw std::runtime_error("Self-closing elements cannot have children");
-    return {};  // Return an empty vector since self-closing elements have no children
+const std::vector<std::shared_ptr<element>>& self_closing_element::get_children() const {
+    static const std::vector<std::shared_ptr<element>> none;
+    return none;  // self-closing elements have no children
 }
 
 std::string self_closing_element::get_text_content() const {
@@ -1,5 +1,10 @@
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+
 #include "../includes.hpp"
 
 using namespace cppress::html;
@@ -818,3 +823,509 @@ TEST(SubstituteParams, ManyParameters) {
     }
     EXPECT_EQ(result.find("{{"), std::string::npos);
 }
+
+TEST(HtmlTemplate, RendersLikeSetParamsWithEscapedValues) {
+    std::string page =
+        "<div class=\"card {{kind}}\"><h1>{{title}}</h1><p>By {{author}}, {{{title}}}</p>"
+        "<img src=\"/a/{{id}}.png\" alt=\"\"><a href=\"/u/{{id}}\">{{missing}}</a></div>";
+    const auto elements = parse(page);
+    const auto compiled = html_template::compile(elements);
+    ASSERT_EQ(compiled.slots().size(), 5u);
+    EXPECT_EQ(compiled.slot("title"), 1u);
+    EXPECT_EQ(compiled.slot("nope"), html_template::NO_SLOT);
+
+    const std::map<std::string, std::string> params = {
+        {"kind", "wide"}, {"title", "Hello"}, {"author", "Ann"}, {"id", "7"}};
+    // element::copy() slices self-closing children, so the tree is parsed again
+    std::string again = page;
+    std::string expected;
+    for (const auto& elem : parse(again)) {
+        elem->set_params_recursive(params);
+        expected += elem->to_string();
+    }
+    EXPECT_EQ(compiled.render(params), expected);
+    EXPECT_NE(expected.find("{{missing}}"), std::string::npos);
+
+    // values are escaped for where they land
+    const std::string escaped = compiled.render(
+        {{"kind", "\"><script>"}, {"title", "a & b"}, {"author", "<i>"}, {"id", "1"}});
+    EXPECT_NE(escaped.find("class=\"card &quot;&gt;&lt;script&gt;\""), std::string::npos);
+    EXPECT_NE(escaped.find("<h1>a &amp; b</h1>"), std::string::npos);
+    EXPECT_NE(escaped.find("By &lt;i&gt;,"), std::string::npos);
+
+    // by index, appended to what the buffer holds
+    std::string out = "x";
+    compiled.render(out, std::vector<std::string_view>{"k", "t"});
+    EXPECT_EQ(out.rfind("x<div class=\"card k\"><h1>t</h1><p>By {{author}}", 0), 0u);
+}
+
+TEST(HtmlTemplate, CompilesDocumentsAndSelfClosingElements) {
+    document doc("html");
+    auto body = make_element("body", "{{greeting}}");
+    body->add_child(make_self_closing(
+        "input", std::map<std::string, std::string>{{"type", "text"}, {"value", "{{query}}"}}));
+    body->add_child(std::make_shared<doctype_element>("{{kind}}"));
+    doc.add_child(body);
+    const auto compiled = html_template::compile(doc);
+
+    const std::map<std::string, std::string> params = {
+        {"greeting", "Hi"}, {"query", "shoes"}, {"kind", "html"}};
+    body->set_params_recursive(params);
+    EXPECT_EQ(compiled.render(params), doc.to_string());
+}
+
+TEST(HtmlTokenizer, ReadsTokensAsViewsOfTheSource) {
+    const std::string source =
+        "<!-- skipped --><A Href='/x?a=1&b=2' title=\"a > b\" hidden data-n=7 />"
+        "1 < 2<?xml skipped?><script>if (a<b) x('</div>');</SCRIPT ></a>";
+    html_tokenizer tokens(source);
+
+    ASSERT_EQ(tokens.next(), html_token::start_tag);
+    EXPECT_EQ(tokens.name(), "A");
+    EXPECT_EQ(tokens.position(), 16u);
+    ASSERT_EQ(tokens.attributes().size(), 4u);
+    EXPECT_EQ(tokens.attributes()[0].name, "Href");
+    EXPECT_EQ(tokens.attributes()[0].value, "/x?a=1&b=2");
+    EXPECT_EQ(tokens.attributes()[1].value, "a > b");
+    EXPECT_TRUE(tokens.attributes()[2].value.empty());
+    EXPECT_EQ(tokens.attributes()[3].value, "7");
+    EXPECT_TRUE(tokens.self_closing());
+    EXPECT_GE(tokens.name().data(), source.data());
+    EXPECT_LT(tokens.name().data(), source.data() + source.size());
+
+    ASSERT_EQ(tokens.next(), html_token::text);
+    EXPECT_EQ(tokens.text(), "1 < 2");
+    ASSERT_EQ(tokens.next(), html_token::start_tag);
+    ASSERT_EQ(tokens.next(), html_token::text);
+    EXPECT_EQ(tokens.text(), "if (a<b) x('</div>');");
+    ASSERT_EQ(tokens.next(), html_token::end_tag);
+    EXPECT_TRUE(html_tokenizer::equals_ignore_case(tokens.name(), "script"));
+    ASSERT_EQ(tokens.next(), html_token::end_tag);
+    EXPECT_EQ(tokens.next(), html_token::end);
+
+    html_tokenizer unterminated("<p>a<!-- b");
+    unterminated.next();
+    unterminated.next();
+    EXPECT_THROW(unterminated.next(), std::runtime_error);
+}
+
+TEST(HtmlParser, ParsesInOnePassLikeTheOldPipeline) {
+    const auto elements = parse(
+        "<DIV Class=\"box\">he<!-- c -->llo\n world<BR><Img SRC=a.png alt='x'></Div>"
+        "</span><!doctype html>");
+    ASSERT_EQ(elements.size(), 2u);
+    EXPECT_EQ(elements[0]->to_string(), "<!DOCTYPE html>");
+    EXPECT_EQ(elements[1]->to_string(),
+              "<div Class=\"box\">hello world<br /><img SRC=\"a.png\" alt=\"x\" /></div>");
+
+    EXPECT_THROW(parse("<div><p></div>"), std::runtime_error);
+    EXPECT_THROW(parse("<div"), std::runtime_error);
+
+    // nesting is followed on a stack, not by recursion
+    std::string deep;
+    for (int i = 0; i < 5000; ++i)
+        deep += "<b>";
+    const auto nested = parse(deep);
+    ASSERT_EQ(nested.size(), 1u);
+    EXPECT_EQ(nested[0]->size(), 1u);
+
+    // a segment stops at the closing tag of its parent
+    const std::string segment = "<p>a</p>b</li><i></i>";
+    const auto [children, stop] = parse_html_optimized(segment, 0, segment.size());
+    EXPECT_EQ(children.size(), 2u);
+    EXPECT_EQ(stop, segment.find("</li>"));
+}
+
+TEST(HtmlWriter, RendersTheTreeIntoAStringOrChunks) {
+    document doc;
+    auto body = make_element("body");
+    body->add_child(make_heading(1, "Title"));
+    auto input = std::make_shared<self_closing_element>("input");
+    input->set_attribute("type", "text");
+    input->set_attribute("disabled", "");
+    body->add_child(input);
+    for (int i = 0; i < 300; ++i)
+        body->add_child(make_paragraph("paragraph " + std::to_string(i)));
+    doc.add_child(body);
+
+    std::string page;
+    html_writer into_string(page);
+    doc.render(into_string);
+    EXPECT_EQ(page, doc.to_string());
+    EXPECT_EQ(page.rfind("<!DOCTYPE html><html><body><h1>Title</h1>"
+                         "<input disabled type=\"text\" />",
+                         0),
+              0u);
+
+    std::vector<std::string> chunks;
+    html_writer into_chunks([&chunks](std::string&& chunk) { chunks.push_back(std::move(chunk)); },
+                            256);
+    doc.render(into_chunks);
+    into_chunks.flush();
+    EXPECT_GT(chunks.size(), 10u);
+    std::string joined;
+    for (const auto& chunk : chunks) {
+        EXPECT_LT(chunk.size(), 512u);
+        joined += chunk;
+    }
+    EXPECT_EQ(joined, page);
+
+    std::string escaped;
+    html_writer out(escaped);
+    out.raw("<p").attribute("title", "a \"b\" & <c>").raw('>').text("1 < 2 & \"3\"").raw("</p>");
+    EXPECT_EQ(escaped, "<p title=\"a &quot;b&quot; &amp; &lt;c&gt;\">1 &lt; 2 &amp; \"3\"</p>");
+}
+
+TEST(HtmlDom, HoldsTheTreeInOneArenaAsParseReadsIt) {
+    const std::string page =
+        "<!DOCTYPE html><HTML><body class=\"main\" id=x class=late>"
+        "<p>one<!-- c -->\n two</p><IMG src=a.png><my-widget data-v=1></my-widget>"
+        "<ul><li>a</li><li>b</li></ul></body></HTML>";
+    const auto dom = html_dom::parse(page);
+    EXPECT_EQ(dom.doctype(), "html");
+    ASSERT_EQ(dom.size(), 1u);
+    EXPECT_EQ(dom.node_count(), 11u);
+
+    const html_node& body = dom[0][0];
+    EXPECT_EQ(body.tag(), "body");
+    ASSERT_EQ(body.attributes_size(), 2u);
+    EXPECT_EQ(body.attributes_begin()->name, "class");
+    EXPECT_EQ(body.attribute("class"), "late");
+    EXPECT_EQ(body.attribute("id"), "x");
+    EXPECT_FALSE(body.has_attribute("style"));
+
+    // children are contiguous ranges, laid out breadth first
+    ASSERT_EQ(body.size(), 4u);
+    EXPECT_EQ(&body[1], &body[0] + 1);
+    EXPECT_EQ(body[0][0].text(), "one two");
+    EXPECT_EQ(body[1].type(), html_node_type::void_element);
+    EXPECT_EQ(body[2].tag(), "my-widget");
+    EXPECT_EQ(body[3].inner_text(), "ab");
+    EXPECT_THROW(body[4], std::out_of_range);
+
+    // tag names are interned: one copy of each
+    EXPECT_EQ(body[3][0].tag().data(), body[3][1].tag().data());
+    const auto other = html_dom::parse("<li><my-widget></my-widget></li>");
+    EXPECT_EQ(other[0].tag().data(), body[3][0].tag().data());
+
+    // the facade and the renderer agree with parse()
+    std::string parsed;
+    for (const auto& elem : parse(page))
+        parsed += elem->to_string();
+    std::string copied;
+    for (const auto& elem : dom.to_elements())
+        copied += elem->to_string();
+    EXPECT_EQ(copied, parsed);
+    std::string rendered;
+    html_writer out(rendered);
+    dom.render(out);
+    EXPECT_EQ(rendered,
+              "<!DOCTYPE html><html><body class=\"late\" id=\"x\"><p>one two</p>"
+              "<img src=\"a.png\" /><my-widget data-v=\"1\"></my-widget>"
+              "<ul><li>a</li><li>b</li></ul></body></html>");
+
+    // in place, and deep trees are released without recursion
+    const std::string text = "<b>in place</b>";
+    const auto viewed = html_dom::view(text);
+    EXPECT_EQ(viewed[0][0].text().data(), text.data() + 3);
+    std::string deep;
+    for (int i = 0; i < 100000; ++i)
+        deep += "<b>";
+    EXPECT_EQ(html_dom::parse(std::move(deep)).node_count(), 100000u);
+
+    EXPECT_THROW(html_dom::parse("<div><p></div>"), std::runtime_error);
+}
+
+TEST(HtmlSelector, QueriesTheDocumentThroughItsIndex) {
+    document doc;
+    const auto parsed = parse(
+        "<head><script src=\"/app.js\"></script><script>inline()</script>"
+        "<link rel=\"stylesheet preload\" href=\"/assets/site.css\"></head>"
+        "<body><div id=\"main\" class=\"page wide\"><ul class=\"menu\">"
+        "<li><a href=\"/assets/a\">a</a></li><li class=\"active\"><a href=\"https://x\">b</a></li>"
+        "</ul><p><a class=\"menu\" href=\"/c\">c</a></p></div></body>");
+    for (const auto& elem : parsed)
+        doc.add_child(elem);
+
+    const auto tags = [](const std::vector<std::shared_ptr<element>>& found) {
+        std::string joined;
+        for (const auto& elem : found)
+            joined += elem->get_tag() + (elem->get_attribute("href").empty()
+                                             ? std::string(" ")
+                                             : "=" + elem->get_attribute("href") + " ");
+        return joined;
+    };
+    EXPECT_EQ(doc.query_selector_all("script[src]").size(), 1u);
+    EXPECT_EQ(doc.query_selector_all("SCRIPT").size(), 2u);
+    EXPECT_EQ(tags(doc.query_selector_all("#main a")), "a=/assets/a a=https://x a=/c ");
+    EXPECT_EQ(tags(doc.query_selector_all(".menu > li > a")), "a=/assets/a a=https://x ");
+    EXPECT_EQ(tags(doc.query_selector_all("ul.menu li.active a")), "a=https://x ");
+    EXPECT_EQ(tags(doc.query_selector_all("[href^='/assets/']")),
+              "link=/assets/site.css a=/assets/a ");
+    EXPECT_EQ(doc.query_selector_all("link[rel~=stylesheet]").size(), 1u);
+    EXPECT_EQ(doc.query_selector_all("a[href$=\"x\"], div.page.wide, body > div").size(), 2u);
+    EXPECT_EQ(doc.query_selector_all("html > body #main").size(), 1u);
+    EXPECT_TRUE(doc.query_selector_all("head > a, #missing, .none").empty());
+    EXPECT_EQ(doc.query_selector("a")->get_attribute("href"), "/assets/a");
+    EXPECT_EQ(doc.query_selector("table"), nullptr);
+
+    // the index is rebuilt after a change
+    const selector paragraphs = selector::parse("body p");
+    EXPECT_EQ(doc.query_selector_all(paragraphs).size(), 1u);
+    doc.query_selector("#main")->add_child(make_paragraph("more"));
+    EXPECT_EQ(doc.query_selector_all(paragraphs).size(), 1u);
+    doc.invalidate_index();
+    EXPECT_EQ(doc.query_selector_all(paragraphs).size(), 2u);
+
+    EXPECT_THROW(doc.query_selector_all(""), std::runtime_error);
+    EXPECT_THROW(doc.query_selector_all("a >"), std::runtime_error);
+    EXPECT_THROW(doc.query_selector_all("a[href"), std::runtime_error);
+    EXPECT_THROW(doc.query_selector_all("a:hover"), std::runtime_error);
+}
+
+TEST(HtmlFragmentCache, RendersOnceAndSplicesByReference) {
+    fragment_cache cache(4096);
+    std::atomic<int> renders{0};
+    const auto slow_nav = [&renders](html_writer& out) {
+        ++renders;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        out.raw("<nav>").text("Home & Shop").raw("</nav>");
+    };
+
+    // concurrent callers for a key wait for the one render
+    std::vector<std::thread> callers;
+    std::vector<html_fragment> got(4);
+    for (int i = 0; i < 4; ++i)
+        callers.emplace_back([&, i]() {
+            got[i] = cache.cache_fragment("nav", std::chrono::seconds(10), slow_nav);
+        });
+    for (auto& caller : callers)
+        caller.join();
+    EXPECT_EQ(renders.load(), 1);
+    EXPECT_EQ(*got[0], "<nav>Home &amp; Shop</nav>");
+    for (const auto& fragment : got)
+        EXPECT_EQ(fragment.get(), got[0].get());
+    EXPECT_EQ(cache.find("nav").get(), got[0].get());
+
+    // invalidated, expired or not kept: rendered again
+    cache.invalidate("nav");
+    EXPECT_EQ(cache.find("nav"), nullptr);
+    cache.cache_fragment("nav", std::chrono::milliseconds(20), slow_nav,
+                         std::chrono::seconds(10));
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    EXPECT_EQ(cache.find("nav"), nullptr);
+    // stale: still returned, and the caller seeing it stale renders it again
+    cache.cache_fragment("nav", std::chrono::seconds(10), slow_nav);
+    EXPECT_EQ(renders.load(), 3);
+    cache.cache_fragment("once", std::chrono::milliseconds(0), slow_nav);
+    cache.cache_fragment("once", std::chrono::milliseconds(0), slow_nav);
+    EXPECT_EQ(renders.load(), 5);
+    EXPECT_THROW(cache.cache_fragment("bad", std::chrono::seconds(1),
+                                      [](html_writer&) { throw std::runtime_error("no"); }),
+                 std::runtime_error);
+    EXPECT_EQ(cache.cache_fragment("bad", std::chrono::seconds(1),
+                                   [](html_writer& out) { out.raw("ok"); })->size(),
+              2u);
+
+    // the least recently used are dropped past the budget
+    for (int i = 0; i < 10; ++i)
+        cache.cache_fragment("card" + std::to_string(i), std::chrono::seconds(10),
+                             [](html_writer& out) { out.raw(std::string(1000, 'x')); });
+    EXPECT_LE(cache.size(), 4096u);
+    EXPECT_EQ(cache.find("card0"), nullptr);
+    EXPECT_NE(cache.find("card9"), nullptr);
+
+    // a compiled template splices fragments into a streamed output by reference
+    const auto page = html_template::compile(
+        parse("<body><header>{{nav}}</header><p title=\"{{nav}}\">{{user}}</p></body>"));
+    const html_fragment card = cache.find("card9");
+    std::vector<std::string> chunks;
+    std::vector<const std::string*> spliced;
+    html_writer out([&chunks](std::string&& chunk) { chunks.push_back(std::move(chunk)); },
+                    [&spliced](const html_fragment& f) { spliced.push_back(f.get()); });
+    std::vector<std::string_view> values(page.slots().size());
+    values[page.slot("user")] = "<ann>";
+    std::vector<html_fragment> fragments(page.slots().size());
+    fragments[page.slot("nav")] = card;
+    page.render(out, values, fragments);
+    out.flush();
+    ASSERT_EQ(spliced.size(), 1u);
+    EXPECT_EQ(spliced[0], card.get());
+    ASSERT_EQ(chunks.size(), 2u);
+    EXPECT_EQ(chunks[0], "<body><header>");
+    const std::string tail = "xx\">&lt;ann&gt;</p></body>";
+    EXPECT_EQ(chunks[1].substr(chunks[1].size() - tail.size()), tail);
+
+    std::string whole;
+    html_writer into_string(whole);
+    page.render(into_string, values, fragments);
+    EXPECT_EQ(whole, chunks[0] + *card + chunks[1]);
+}
+
+namespace {
+/// Restores the fastest escape scan when a test switched it
+struct escape_level_guard {
+    ~escape_level_guard() { escape_scan::use(escape_scan::best()); }
+};
+
+std::string escape_by_byte(std::string_view value, escape_context context) {
+    std::string out;
+    for (const char c : value) {
+        const auto byte = static_cast<unsigned char>(c);
+        const bool unreserved = std::isalnum(byte) || c == '-' || c == '.' || c == '_' || c == '~';
+        if (context == escape_context::url && !unreserved) {
+            char encoded[4];
+            std::snprintf(encoded, sizeof(encoded), "%%%02X", byte);
+            out += encoded;
+        } else if (c == '&' && context != escape_context::url) {
+            out += "&amp;";
+        } else if (c == '<' && context != escape_context::url) {
+            out += "&lt;";
+        } else if (c == '>' && context != escape_context::url) {
+            out += "&gt;";
+        } else if (c == '"' && context == escape_context::attribute) {
+            out += "&quot;";
+        } else if (c == '\'' && context == escape_context::attribute) {
+            out += "&#39;";
+        } else {
+            out += c;
+        }
+    }
+    return out;
+}
+}  // namespace
+
+TEST(HtmlEscape, EveryLevelEscapesTheSameBytesForEachContext) {
+    escape_level_guard guard;
+    EXPECT_EQ(escape("a < b & \"c\" 'd'"), "a &lt; b &amp; \"c\" 'd'");
+    EXPECT_EQ(escape("a < b & \"c\" 'd'", escape_context::attribute),
+              "a &lt; b &amp; &quot;c&quot; &#39;d&#39;");
+    EXPECT_EQ(escape("a b/ç?x=1&y", escape_context::url), "a%20b%2F%C3%A7%3Fx%3D1%26y");
+    EXPECT_EQ(escape("Az09-._~", escape_context::url), "Az09-._~");
+
+    std::mt19937 rng(7);
+    // mostly clean runs, long enough for whole vectors, with sparse special bytes
+    std::vector<std::string> inputs;
+    for (int round = 0; round < 300; ++round) {
+        std::string s(1 + rng() % 150, 'x');
+        for (auto& ch : s)
+            ch = static_cast<char>('a' + rng() % 26);
+        for (int k = 0; k < 3; ++k)
+            s[rng() % s.size()] = static_cast<char>(rng() % 256);
+        inputs.push_back(s);
+    }
+
+    for (const auto l : {escape_scan::level::scalar, escape_scan::level::sse2,
+                         escape_scan::level::avx2, escape_scan::level::neon}) {
+        if (!escape_scan::use(l))
+            continue;
+        EXPECT_EQ(escape_scan::active(), l);
+        for (const auto context :
+             {escape_context::text, escape_context::attribute, escape_context::url})
+            for (const std::string& s : inputs)
+                ASSERT_EQ(escape(s, context), escape_by_byte(s, context))
+                    << "level " << static_cast<int>(l) << " context "
+                    << static_cast<int>(context) << " input " << s;
+    }
+    EXPECT_TRUE(escape_scan::use(escape_scan::level::scalar));
+}
+
+TEST(HtmlEscape, TemplateSlotsAndTextContentAreEscapedWhereTheyLand) {
+    const auto page = html_template::compile(parse(
+        "<a href=\"{{base}}/u/{{name}}?q={{q}}\" title=\"{{q}}\">{{q}}</a>"));
+    const std::string out =
+        page.render({{"base", "https://x.org"}, {"name", "../admin"}, {"q", "a&b \"c\""}});
+    EXPECT_EQ(out,
+              "<a href=\"https://x.org/u/..%2Fadmin?q=a%26b%20%22c%22\" "
+              "title=\"a&amp;b &quot;c&quot;\">a&amp;b \"c\"</a>");
+
+    std::string streamed;
+    html_writer writer(streamed);
+    std::vector<std::string_view> values(page.slots().size());
+    values[page.slot("base")] = "/";
+    values[page.slot("name")] = "a b";
+    values[page.slot("q")] = "<";
+    page.render(writer, values);
+    EXPECT_EQ(streamed, "<a href=\"//u/a%20b?q=%3C\" title=\"&lt;\">&lt;</a>");
+
+    auto comment = std::make_shared<element>("p");
+    comment->set_text_content(std::string_view("<script>x</script>"), escape_context::text);
+    EXPECT_EQ(comment->to_string(), "<p>&lt;script&gt;x&lt;/script&gt;</p>");
+    auto br = std::make_shared<self_closing_element>("br");
+    br->set_text_content(std::string_view("<"), escape_context::text);
+    EXPECT_EQ(br->get_text_content(), "");
+}
+
+TEST(HtmlTemplateInstance, PatchesOnlyTheFieldsOfChangedSlots) {
+    const auto page = html_template::compile(
+        parse("<ul><li class=\"{{state}}\">Jobs: {{jobs}}</li><li>{{state}} since "
+              "{{since}}</li><li>static</li></ul>"));
+    ASSERT_EQ(page.fields().size(), 3u);
+    EXPECT_EQ(page.fields()[0].node, 1u);
+    EXPECT_EQ(page.fields()[0].attribute, "class");
+    EXPECT_EQ(page.fields()[1].attribute, "");
+    EXPECT_EQ(page.fields()[2].node, 2u);
+    EXPECT_EQ(page.fields()[2].slots.size(), 2u);
+    EXPECT_EQ(page.fields_of(page.slot("state")), (std::vector<std::size_t>{0, 2}));
+    EXPECT_TRUE(page.fields_of(html_template::NO_SLOT).empty());
+
+    const std::size_t jobs = page.slot("jobs");
+    const std::size_t state = page.slot("state");
+    const std::size_t since = page.slot("since");
+    std::vector<std::string_view> values(page.slots().size());
+    values[jobs] = "3";
+    values[state] = "ok";
+    values[since] = "9:00";
+    template_instance view(page, values);
+    EXPECT_EQ(view.html(), page.render({{"jobs", "3"}, {"state", "ok"}, {"since", "9:00"}}));
+
+    EXPECT_TRUE(view.update(values).empty());
+
+    values[jobs] = "4 & more";
+    auto patches = view.update(values);
+    ASSERT_EQ(patches.size(), 1u);
+    EXPECT_EQ(patches[0].field, 1u);
+    EXPECT_EQ(patches[0].value, "Jobs: 4 &amp; more");
+
+    values[state] = "\"late\"";
+    patches = view.update(values);
+    ASSERT_EQ(patches.size(), 2u);
+    EXPECT_EQ(patches[0].value, "&quot;late&quot;");
+    EXPECT_EQ(patches[1].value, "\"late\" since 9:00");
+    EXPECT_EQ(view.field_value(2), patches[1].value);
+    EXPECT_EQ(view.html(), page.render({{"jobs", "4 & more"}, {"state", "\"late\""},
+                                        {"since", "9:00"}}));
+
+    // a slot left without a value is its placeholder again
+    values[since] = std::string_view();
+    patches = view.update(values);
+    ASSERT_EQ(patches.size(), 1u);
+    EXPECT_EQ(patches[0].value, "\"late\" since {{since}}");
+}
+
+TEST(HtmlTemplate, SerializedTemplateRendersTheSameAndDamageIsRefused) {
+    const auto page = html_template::compile(
+        parse("<a href=\"/u/{{id}}\" title=\"{{name}}\">{{name}}</a><p>{{count}} new</p>"));
+    const std::string bytes = page.serialize();
+    const auto loaded = html_template::deserialize(bytes);
+
+    EXPECT_EQ(loaded.slots(), page.slots());
+    EXPECT_EQ(loaded.literal_size(), page.literal_size());
+    ASSERT_EQ(loaded.fields().size(), page.fields().size());
+    for (std::size_t f = 0; f < page.fields().size(); ++f) {
+        EXPECT_EQ(loaded.fields()[f].node, page.fields()[f].node);
+        EXPECT_EQ(loaded.fields()[f].attribute, page.fields()[f].attribute);
+        EXPECT_EQ(loaded.fields()[f].slots, page.fields()[f].slots);
+    }
+    EXPECT_EQ(loaded.fields_of(loaded.slot("name")), page.fields_of(page.slot("name")));
+    const std::map<std::string, std::string> params = {
+        {"id", "a b/c"}, {"name", "<Ann & \"Bob\">"}, {"count", "3"}};
+    EXPECT_EQ(loaded.render(params), page.render(params));
+
+    EXPECT_THROW(html_template::deserialize(bytes.substr(0, bytes.size() - 1)),
+                 std::runtime_error);
+    EXPECT_THROW(html_template::deserialize(bytes + "x"), std::runtime_error);
+    std::string past_literals = bytes;
+    past_literals[0] = 1;  // literals shorter than the ops reach
+    EXPECT_THROW(html_template::deserialize(past_literals), std::runtime_error);
+}
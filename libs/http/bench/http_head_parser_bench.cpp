@@ -0,0 +1,111 @@
+/**
+ * @file http_head_parser_bench.cpp
+ * @brief Request head parsing throughput per scan implementation
+ *
+ * Parses a browser-like GET (about 1.5 KB of headers: cookies, user agent,
+ * accept lists) in a loop, once per scan level the CPU supports, and once
+ * with the getline/istringstream approach the parser replaced.
+ *
+ * Usage: http-parser-bench [iterations]
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <sstream>
+#include <string>
+
+#include "http/includes/http_head_parser.hpp"
+#include "http/includes/http_scan.hpp"
+
+using namespace cppress::http;
+
+namespace {
+std::string browser_request() {
+    return "GET /dashboard/reports?range=last-30-days&sort=desc HTTP/1.1\r\n"
+           "Host: app.example.com\r\n"
+           "Connection: keep-alive\r\n"
+           "sec-ch-ua: \"Chromium\";v=\"124\", \"Google Chrome\";v=\"124\", "
+           "\"Not-A.Brand\";v=\"99\"\r\n"
+           "sec-ch-ua-mobile: ?0\r\n"
+           "sec-ch-ua-platform: \"Linux\"\r\n"
+           "Upgrade-Insecure-Requests: 1\r\n"
+           "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) "
+           "Chrome/124.0.0.0 Safari/537.36\r\n"
+           "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,"
+           "image/webp,image/apng,*/*;q=0.8,application/signed-exchange;v=b3;q=0.7\r\n"
+           "Sec-Fetch-Site: same-origin\r\n"
+           "Sec-Fetch-Mode: navigate\r\n"
+           "Sec-Fetch-User: ?1\r\n"
+           "Sec-Fetch-Dest: document\r\n"
+           "Referer: https://app.example.com/dashboard\r\n"
+           "Accept-Encoding: gzip, deflate, br, zstd\r\n"
+           "Accept-Language: en-US,en;q=0.9,de;q=0.8,fr;q=0.7\r\n"
+           "Cookie: session=eyJhbGciOiJIUzI1NiIsInR5cCI6IkpXVCJ9.eyJzdWIiOiIxMjM0NTY3ODkwIiwibmFtZ"
+           "SI6IkpvaG4gRG9lIiwiaWF0IjoxNTE2MjM5MDIyfQ.SflKxwRJSMeKKF2QT4fwpMeJf36POk6yJV_adQssw5c; "
+           "_ga=GA1.2.1234567890.1700000000; _gid=GA1.2.987654321.1700000000; "
+           "theme=dark; locale=en-US; csrftoken=4f9c2b7e8a1d3c5e6f7a8b9c0d1e2f3a4b5c6d7e8f9a0b1c; "
+           "preferences=%7B%22sidebar%22%3A%22collapsed%22%2C%22density%22%3A%22compact%22%7D\r\n"
+           "If-None-Match: W/\"5e3-1a2b3c4d5e6f\"\r\n"
+           "If-Modified-Since: Tue, 14 May 2024 09:30:00 GMT\r\n"
+           "\r\n";
+}
+
+/// The parser this replaced: getline per line, >> for the request line, substr per field
+std::size_t legacy_parse(const std::string& request) {
+    std::istringstream stream(request);
+    std::string line, method, uri, version;
+    std::getline(stream, line);
+    std::istringstream(line) >> method >> uri >> version;
+    std::multimap<std::string, std::string> headers;
+    while (std::getline(stream, line)) {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (line.empty())
+            break;
+        auto colon = line.find(':');
+        if (colon == std::string::npos)
+            continue;
+        std::string value = line.substr(colon + 1);
+        auto start = value.find_first_not_of(" \t");
+        if (start != std::string::npos)
+            value = value.substr(start);
+        headers.emplace(line.substr(0, colon), value);
+    }
+    return headers.size();
+}
+
+template <typename Fn>
+void report(const char* label, std::size_t bytes, long iterations, Fn&& fn) {
+    std::size_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < iterations; ++i)
+        sink += fn();
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double ns = elapsed * 1e9 / static_cast<double>(iterations);
+    double gbps = static_cast<double>(bytes) * static_cast<double>(iterations) / elapsed / 1e9;
+    std::printf("%-10s %9.1f ns/request %7.2f GB/s  (%zu)\n", label, ns, gbps,
+                sink / static_cast<std::size_t>(iterations));
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+    long iterations = argc > 1 ? std::atol(argv[1]) : 500000;
+    const std::string request = browser_request();
+    std::printf("request head: %zu bytes, %ld iterations\n", request.size(), iterations);
+
+    report("getline", request.size(), iterations / 10, [&]() { return legacy_parse(request); });
+
+    for (auto l : {scan::level::scalar, scan::level::sse42, scan::level::avx2, scan::level::neon}) {
+        if (!scan::use(l))
+            continue;
+        report(scan::name(l), request.size(), iterations, [&]() {
+            http_head_parser head;
+            head.parse(request, 64 * 1024);
+            return head.header_count();
+        });
+    }
+    scan::use(scan::best());
+    return 0;
+}
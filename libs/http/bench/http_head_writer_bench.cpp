@@ -0,0 +1,68 @@
+/**
+ * @file http_head_writer_bench.cpp
+ * @brief Response head serialization cost
+ *
+ * Serializes the head of a small JSON reply (status line, Date, five
+ * headers) in a loop, once with write_http_head and once with the
+ * ostringstream/strftime approach http_response used before.
+ *
+ * Usage: http-writer-bench [iterations]
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <map>
+#include <sstream>
+#include <string>
+
+#include "http/includes/http_head_writer.hpp"
+
+using namespace cppress::http;
+
+namespace {
+/// The serializer this replaced: strftime per response, stream insertion per field
+std::size_t legacy_head(const std::multimap<std::string, std::string>& headers) {
+    std::time_t now = std::time(nullptr);
+    std::tm tm{};
+    gmtime_r(&now, &tm);
+    char date[64];
+    std::strftime(date, sizeof(date), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    std::ostringstream head;
+    head << "HTTP/1.1" << ' ' << 200 << ' ' << "OK" << "\r\n";
+    head << "DATE: " << date << "\r\n";
+    for (const auto& [name, value] : headers)
+        head << name << ": " << value << "\r\n";
+    head << "\r\n";
+    return head.str().size();
+}
+
+template <typename Fn>
+void report(const char* label, long iterations, Fn&& fn) {
+    std::size_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < iterations; ++i)
+        sink += fn();
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double ns = elapsed * 1e9 / static_cast<double>(iterations);
+    std::printf("%-14s %8.1f ns/head  (%zu bytes)\n", label, ns,
+                sink / static_cast<std::size_t>(iterations));
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+    long iterations = argc > 1 ? std::atol(argv[1]) : 1000000;
+    const std::multimap<std::string, std::string> headers = {
+        {"CONNECTION", "keep-alive"},
+        {"CONTENT-LENGTH", "27"},
+        {"CONTENT-TYPE", "application/json"},
+        {"CACHE-CONTROL", "no-store"},
+        {"SERVER", "cppress"},
+    };
+    std::printf("%ld iterations\n", iterations);
+    report("ostringstream", iterations, [&]() { return legacy_head(headers); });
+    report("head writer", iterations,
+           [&]() { return write_http_head("HTTP/1.1", 200, "OK", headers).size(); });
+    return 0;
+}
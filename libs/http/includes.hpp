@@ -13,7 +13,7 @@
  * 1. **Protocol Layer** (http_message_handler):
  *    - Handles HTTP/1.1 parsing according to RFC 2616/7230
  *    - Manages partial request handling for streaming data
- *    - Supports Content-Length based body parsing
+ *    - Supports Content-Length and chunked body parsing
  *    - Validates request format and headers
  *    - Thread-safe internal state management
  *
@@ -36,6 +36,10 @@
  * **What This Module Provides:**
  * - ✅ HTTP/1.1 request parsing (GET, POST, PUT, DELETE, etc.)
  * - ✅ Content-Length based body handling
+ * - ✅ Chunked request bodies, with extensions and trailers
+ * - ✅ Streamed request bodies, or bodies spilled to an anonymous file
+ * - ✅ Streaming multipart/form-data parsing, parts sent to memory, files or callbacks
+ * - ✅ Keep-alive and pipelining, responses in request order
  * - ✅ Header parsing with case-insensitive access
  * - ✅ Configurable maximum header/body sizes
  * - ✅ Connection timeout management
@@ -43,16 +47,17 @@
  * - ✅ Thread-safe request handling (when using thread pool)
  * - ✅ Callback-driven architecture for clean separation of concerns
  * - ✅ HTTP status code and header constants
- * - ✅ Automatic "Connection: close" handling
  * - ✅ Support for custom headers and trailers
+ * - ✅ gzip/br/zstd response compression negotiated from Accept-Encoding
+ * - ✅ HTTP/2 (prior knowledge or h2c upgrade) with HPACK, multiplexing and flow control
+ * - ✅ Range requests (206, multipart/byteranges, If-Range) served with sendfile
+ * - ✅ Conditional GET: ETag / Last-Modified answered with 304 Not Modified
+ * - ✅ Server-Sent Events, broadcast channels sharing one encoded buffer per event
+ * - ✅ WebSocket upgrade (RFC 6455) with permessage-deflate, ping/pong and close timeouts
  *
  * **What This Module Does NOT Provide:**
- * - ❌ HTTP/2 or HTTP/3 protocol support
- * - ❌ Chunked transfer encoding (planned for future)
- * - ❌ Automatic compression (gzip, brotli, etc.)
- * - ❌ Keep-alive / persistent connections (planned for future)
- * - ❌ Range requests / partial content
- * - ❌ Multipart form-data parsing (use external parser)
+ * - ❌ HTTP/3, HTTP/2 server push and priorities
+ * - ❌ Decoding of compressed request bodies
  * - ❌ SSL/TLS support (add using reverse proxy)
  *
  * @section usage Basic Usage
@@ -105,7 +110,7 @@
  *
  * @section threading Thread Safety
  *
- * - The http_message_handler uses internal mutexes for thread safety
+ * - Request parsing takes no lock; each connection is parsed by the event loop owning it
  * - Multiple requests can be handled concurrently using a thread pool
  * - Request/response objects are move-only and not thread-safe themselves
  * - Callbacks should avoid blocking operations (offload to thread pool)
@@ -124,17 +129,15 @@
  *
  * The http_request_parser maintains state for incomplete requests:
  * - Requests arriving in multiple TCP segments are buffered internally
- * - State stored per-connection using connection identifier as key
- * - Idle connections automatically cleaned up after MAX_IDLE_TIME_SECONDS
+ * - State stored per-connection in a table indexed by file descriptor
+ * - Idle, header-read and body-read deadlines run on the event loop's timer wheel
+ *   (MAX_IDLE_TIME_SECONDS, MAX_HEADER_READ_TIME_SECONDS, MAX_BODY_READ_TIME_SECONDS)
  * - Content-Length is validated against MAX_BODY_SIZE before buffering
  * - Headers normalized to uppercase for case-insensitive matching
  * - Malformed requests result in connection closure (no 400 response sent)
  *
  * @section limitations Known Limitations
  *
- * - Current implementation uses "Connection: close" for all responses
- * - No pipeline support (one request per connection)
- * - Chunked encoding not yet implemented
  * - No built-in support for 100-continue
  * - Limited to HTTP/1.1 protocol
  *
@@ -151,7 +154,12 @@
 
 #pragma once
 
+#include "includes/http_body.hpp"
+#include "includes/http_conditional.hpp"
 #include "includes/http_consts.hpp"
+#include "includes/http_event_stream.hpp"
+#include "includes/http_multipart.hpp"
+#include "includes/http_range.hpp"
 #include "includes/http_request.hpp"
 #include "includes/http_response.hpp"
 #include "includes/http_server.hpp"
\ No newline at end of file
@@ -0,0 +1,265 @@
+/**
+ * @file http2_connection.hpp
+ * @brief Server side of one HTTP/2 connection (RFC 9113)
+ *
+ * The connection turns frames read from the socket into complete requests
+ * and the output of http_response back into frames. Responses are written
+ * in the HTTP/1.1 form http_response already produces (status line,
+ * headers, then a Content-Length or chunked body); each stream translates
+ * it into HEADERS, DATA and trailing HEADERS frames, so handlers written
+ * for HTTP/1.1 answer HTTP/2 streams unchanged.
+ *
+ * Streams are multiplexed: a slow response holds back only its own stream.
+ * Flow control is honoured in both directions, and the peer's DATA is
+ * credited back as it arrives. Server push and priorities are not used.
+ *
+ * @note This is an internal implementation detail used by http_server
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "http2_hpack.hpp"
+#include "http_chunked_decoder.hpp"
+#include "http_headers.hpp"
+
+namespace cppress::http {
+
+/// The client connection preface, sent before its first frame
+constexpr std::string_view HTTP2_PREFACE = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+
+/// @brief Frame types of RFC 9113 section 6
+enum class http2_frame_type : std::uint8_t {
+    data = 0x0,
+    headers = 0x1,
+    priority = 0x2,
+    rst_stream = 0x3,
+    settings = 0x4,
+    push_promise = 0x5,
+    ping = 0x6,
+    goaway = 0x7,
+    window_update = 0x8,
+    continuation = 0x9
+};
+
+/// @brief Error codes of RST_STREAM and GOAWAY
+enum class http2_error : std::uint32_t {
+    no_error = 0x0,
+    protocol_error = 0x1,
+    internal_error = 0x2,
+    flow_control_error = 0x3,
+    settings_timeout = 0x4,
+    stream_closed = 0x5,
+    frame_size_error = 0x6,
+    refused_stream = 0x7,
+    cancel = 0x8,
+    compression_error = 0x9,
+    connect_error = 0xa,
+    enhance_your_calm = 0xb,
+    inadequate_security = 0xc,
+    http_1_1_required = 0xd
+};
+
+/**
+ * @struct http2_request
+ * @brief A request whose stream has ended, ready for dispatch
+ */
+struct http2_request {
+    std::uint32_t stream_id = 0;
+    std::string method;
+    /// :path, the request target
+    std::string uri;
+    /// Regular fields, with Host from :authority when absent and trailers appended
+    http_headers headers;
+    std::string body;
+};
+
+/**
+ * @class http2_connection
+ * @brief Frame-level state of one HTTP/2 connection
+ *
+ * receive() runs on the event loop thread; write() and close_stream() may
+ * be called from any thread. Output is passed to the send function under
+ * the connection's lock, so frames keep their order.
+ */
+class http2_connection {
+public:
+    /// Queues bytes on the connection
+    using send_function = std::function<void(std::vector<std::string>&&)>;
+
+    /// Closes the connection once queued bytes are written
+    using close_function = std::function<void()>;
+
+    /**
+     * @brief Construct the connection
+     * @param send Writes to the socket
+     * @param close Closes the socket after a GOAWAY for a connection error
+     */
+    http2_connection(send_function send, close_function close);
+
+    /**
+     * @brief Sends the server preface, for a client with prior knowledge (or ALPN h2)
+     */
+    void start();
+
+    /**
+     * @brief Sends the server preface after a 101 for an h2c upgrade
+     * @param http2_settings Value of the request's HTTP2-Settings header
+     * @return false if the header is not valid base64url SETTINGS; nothing is sent then
+     *
+     * Stream 1 is the upgraded request: half-closed on the client side,
+     * its response is written like any other.
+     */
+    bool start_upgraded(std::string_view http2_settings);
+
+    /**
+     * @brief Feeds bytes read from the connection
+     * @param data Bytes in arrival order, starting with the client preface
+     * @param requests Requests whose streams ended are appended here
+     * @return false once the connection failed; it is then closed after a GOAWAY
+     */
+    bool receive(std::string_view data, std::vector<http2_request>& requests);
+
+    /**
+     * @brief Writes response output to a stream
+     * @param stream_id Stream of the request being answered
+     * @param parts Bytes as produced by http_response
+     * @param last true if the response is complete after these bytes
+     *
+     * Output for a stream that was reset is dropped.
+     */
+    void write(std::uint32_t stream_id, std::vector<std::string>&& parts, bool last);
+
+    /**
+     * @brief The handler is done with a stream
+     *
+     * A stream whose response was never started is reset with CANCEL; a
+     * started one finishes normally.
+     */
+    void close_stream(std::uint32_t stream_id);
+
+    /// @brief Streams open in either direction
+    std::size_t stream_count() const;
+
+private:
+    /// Progress of translating http_response output into frames
+    enum class response_phase { head, body, chunked, done };
+
+    struct stream {
+        // request side
+        bool request_complete = false;
+        std::string method;
+        std::string uri;
+        http_headers headers;
+        std::string body;
+        /// content-length of the request, or -1
+        long long expected_length = -1;
+        /// DATA bytes received but not yet credited back
+        std::uint32_t unacknowledged = 0;
+
+        // response side
+        response_phase phase = response_phase::head;
+        /// Head or chunk bytes not translated yet
+        std::string raw;
+        http_chunked_decoder chunked;
+        /// Body bytes waiting for flow-control window, from out_offset on
+        std::string out;
+        std::size_t out_offset = 0;
+        /// END_STREAM goes out once out is drained
+        bool end_pending = false;
+        /// Trailer fields, sent as the final HEADERS instead of an END_STREAM DATA
+        std::vector<hpack_field> trailers;
+        bool response_started = false;
+        bool response_complete = false;
+        std::int64_t send_window = 0;
+    };
+
+    /// Settings of RFC 9113 section 6.5.2 we track for the peer
+    struct peer_settings {
+        std::uint32_t initial_window_size = 65535;
+        std::uint32_t max_frame_size = 16384;
+    };
+
+    send_function send_;
+    close_function close_;
+
+    /// Guards everything below
+    mutable std::mutex mutex_;
+
+    /// Unparsed input: the preface, or the start of the next frame
+    std::string in_;
+    bool preface_received_ = false;
+    bool settings_received_ = false;
+    bool failed_ = false;
+
+    /// Frames produced by the current call, sent once at its end
+    std::vector<std::string> pending_output_;
+
+    hpack_decoder decoder_;
+    hpack_encoder encoder_;
+    peer_settings peer_;
+
+    std::map<std::uint32_t, stream> streams_;
+
+    /// Highest client stream id seen; lower unknown ids are closed streams
+    std::uint32_t last_stream_id_ = 0;
+
+    /// Stream whose header block continues in CONTINUATION frames, 0 if none
+    std::uint32_t continuation_stream_ = 0;
+    std::uint8_t continuation_flags_ = 0;
+    std::string header_block_;
+
+    std::int64_t connection_send_window_ = 65535;
+    std::uint32_t connection_unacknowledged_ = 0;
+
+    /// @brief Processes the frames in in_, false on a connection error
+    bool process_frames(std::vector<http2_request>& requests);
+
+    bool on_frame(std::uint8_t type, std::uint8_t flags, std::uint32_t stream_id,
+                  std::string_view payload, std::vector<http2_request>& requests);
+    bool on_data(std::uint8_t flags, std::uint32_t stream_id, std::string_view payload,
+                 std::vector<http2_request>& requests);
+    bool on_headers(std::uint8_t flags, std::uint32_t stream_id, std::string_view payload,
+                    std::vector<http2_request>& requests);
+    bool on_header_block(std::uint32_t stream_id, std::uint8_t flags,
+                         std::vector<http2_request>& requests);
+    bool on_settings(std::uint8_t flags, std::uint32_t stream_id, std::string_view payload);
+    bool apply_settings(std::string_view payload);
+    bool on_window_update(std::uint32_t stream_id, std::string_view payload);
+
+    /// Moves a finished request out of its stream into requests
+    void complete_request(std::uint32_t stream_id, stream& s,
+                          std::vector<http2_request>& requests);
+
+    /// Translates response bytes of a stream, queueing frames
+    void translate(std::uint32_t stream_id, stream& s, std::string_view bytes, bool last);
+
+    /// Sends as much queued DATA as the windows allow
+    void flush_stream(std::uint32_t stream_id, stream& s);
+    void flush_all();
+
+    /// Drops a stream once both sides are done with it
+    void release_if_done(std::map<std::uint32_t, stream>::iterator it);
+
+    void queue_frame(http2_frame_type type, std::uint8_t flags, std::uint32_t stream_id,
+                     std::string_view payload);
+    void queue_header_block(std::uint32_t stream_id, const std::string& block, bool end_stream);
+    void queue_window_update(std::uint32_t stream_id, std::uint32_t increment);
+    void reset_stream(std::uint32_t stream_id, http2_error error);
+
+    /// Sends GOAWAY and closes; always returns false
+    bool fail(http2_error error);
+
+    /// Passes pending_output_ to send_
+    void flush_output();
+};
+
+}  // namespace cppress::http
@@ -0,0 +1,160 @@
+/**
+ * @file http2_hpack.hpp
+ * @brief HPACK header compression for HTTP/2 (RFC 7541)
+ *
+ * The static table is one shared constant; each direction of a connection
+ * has its own dynamic table, held by its hpack_decoder or hpack_encoder.
+ * Huffman coding uses the canonical code of RFC 7541 Appendix B.
+ *
+ * @note This is an internal implementation detail used by http2_connection
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace cppress::http {
+
+/// One decoded or to-be-encoded header field, names in lower case
+struct hpack_field {
+    std::string name;
+    std::string value;
+};
+
+/// Default SETTINGS_HEADER_TABLE_SIZE of both peers
+constexpr std::size_t HPACK_DEFAULT_TABLE_SIZE = 4096;
+
+/**
+ * @class hpack_table
+ * @brief The static table followed by one dynamic table
+ *
+ * Indices are 1-based: 1..61 address the static table, 62 and up the
+ * dynamic table, newest entry first.
+ */
+class hpack_table {
+public:
+    /// Entries of the static table
+    static constexpr std::size_t STATIC_SIZE = 61;
+
+    explicit hpack_table(std::size_t max_size = HPACK_DEFAULT_TABLE_SIZE) : max_size_(max_size) {}
+
+    /// @brief Entry at index, nullptr if there is none
+    const hpack_field* at(std::size_t index) const noexcept;
+
+    /// @brief Inserts an entry, evicting the oldest ones to make room
+    void add(std::string_view name, std::string_view value);
+
+    /// @brief Changes the size limit, evicting as needed
+    void resize(std::size_t max_size);
+
+    /**
+     * @brief Best index for a field
+     * @param value_matched Set to true if the entry has the value as well
+     * @return Index of a full match, else of a name match, else 0
+     */
+    std::size_t find(std::string_view name, std::string_view value,
+                     bool& value_matched) const noexcept;
+
+    /// @brief Size of the dynamic table as RFC 7541 counts it (32 bytes per entry overhead)
+    std::size_t size() const noexcept { return size_; }
+
+    /// @brief Current size limit
+    std::size_t max_size() const noexcept { return max_size_; }
+
+private:
+    std::deque<hpack_field> dynamic_;
+    std::size_t size_ = 0;
+    std::size_t max_size_;
+
+    void evict(std::size_t needed);
+};
+
+/**
+ * @class hpack_decoder
+ * @brief Decodes the header blocks of one connection's requests
+ */
+class hpack_decoder {
+public:
+    /// @param max_table_size Our SETTINGS_HEADER_TABLE_SIZE, the most the peer may use
+    explicit hpack_decoder(std::size_t max_table_size = HPACK_DEFAULT_TABLE_SIZE)
+        : table_(max_table_size), limit_(max_table_size) {}
+
+    /**
+     * @brief Decodes one complete header block
+     * @param block HEADERS and CONTINUATION payloads, concatenated
+     * @param fields Decoded fields are appended here
+     * @param max_list_size Limit on the decoded fields, counted like SETTINGS_MAX_HEADER_LIST_SIZE
+     * @return false on a malformed block or an oversized list; the connection
+     *         must then fail with COMPRESSION_ERROR as the table is out of sync
+     */
+    bool decode(std::string_view block, std::vector<hpack_field>& fields,
+                std::size_t max_list_size);
+
+private:
+    hpack_table table_;
+    std::size_t limit_;
+};
+
+/**
+ * @class hpack_encoder
+ * @brief Encodes the header blocks of one connection's responses
+ *
+ * Fields with a static or dynamic table match are indexed; others are
+ * added to the dynamic table unless they are unlikely to repeat
+ * (content-length, date, etag, set-cookie, ...). Strings are Huffman
+ * coded when that is shorter.
+ */
+class hpack_encoder {
+public:
+    /**
+     * @brief Applies the peer's SETTINGS_HEADER_TABLE_SIZE
+     *
+     * The encoder never uses more than HPACK_DEFAULT_TABLE_SIZE; a smaller
+     * limit is signalled at the start of the next block.
+     */
+    void set_max_table_size(std::size_t max_size);
+
+    /// @brief Appends the encoding of one field to out
+    void encode(std::string_view name, std::string_view value, std::string& out);
+
+    /// @brief Call before the first field of each block
+    void begin_block(std::string& out);
+
+private:
+    hpack_table table_;
+    bool size_update_pending_ = false;
+};
+
+/**
+ * @brief Appends an HPACK integer
+ * @param prefix_bits Bits of the first byte the integer may use (1-8)
+ * @param first_byte_flags Bits above the prefix, e.g. 0x80 for an indexed field
+ */
+void hpack_encode_integer(std::uint64_t value, int prefix_bits, std::uint8_t first_byte_flags,
+                          std::string& out);
+
+/**
+ * @brief Reads an HPACK integer
+ * @param pos Position of its first byte, moved past the integer
+ * @return false if the input ends early or the value overflows
+ */
+bool hpack_decode_integer(std::string_view in, std::size_t& pos, int prefix_bits,
+                          std::uint64_t& value) noexcept;
+
+/// @brief Appends the Huffman coding of in
+void huffman_encode(std::string_view in, std::string& out);
+
+/// @brief Bytes huffman_encode() would append
+std::size_t huffman_encoded_size(std::string_view in) noexcept;
+
+/**
+ * @brief Appends the Huffman decoding of in
+ * @return false on an EOS symbol, or padding that is longer than 7 bits or not all ones
+ */
+bool huffman_decode(std::string_view in, std::string& out);
+}  // namespace cppress::http
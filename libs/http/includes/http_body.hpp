@@ -0,0 +1,125 @@
+/**
+ * @file http_body.hpp
+ * @brief Streamed and spilled request bodies
+ *
+ * By default a request body is buffered in memory, up to
+ * config::MAX_BODY_SIZE, before the request is dispatched. Two opt-in
+ * alternatives keep large uploads off the heap:
+ *
+ * - Streaming: a body stream selector, installed with
+ *   http_server::set_body_stream_selector(), sees each request head and may
+ *   return an http_body_stream; the body is then handed to it piece by piece
+ *   as it is read and decoded, and the request is dispatched with an empty
+ *   body once the last piece is in.
+ * - Spilling: with config::BODY_SPILL_THRESHOLD set, a body larger than the
+ *   threshold is written to an anonymous file (memfd, or an unlinked
+ *   temporary file) as it arrives; http_request::get_body_spool() exposes it.
+ * - Multipart: with a multipart sink selector installed, a multipart/form-data
+ *   body is streamed through a multipart_parser and each part goes to its
+ *   own sink (see http_multipart.hpp).
+ *
+ * Streamed and spilled bodies are bounded by config::MAX_STREAMED_BODY_SIZE.
+ *
+ * @example Streaming uploads of one route to disk
+ * @code
+ * server.set_body_stream_selector([](const http_parse_result& head) -> http_body_stream {
+ *     if (head.uri != "/upload")
+ *         return nullptr;  // buffer as usual
+ *     auto file = std::make_shared<std::ofstream>("upload.bin", std::ios::binary);
+ *     return [file](std::string_view piece, bool last) {
+ *         file->write(piece.data(), piece.size());
+ *         if (last)
+ *             file->close();
+ *     };
+ * });
+ * @endcode
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+
+#include "http_parse_result.hpp"
+
+namespace cppress::http {
+
+/**
+ * @brief Receives a streamed request body
+ *
+ * Called on the event loop thread with each piece as it is decoded, in
+ * order; the view is only valid during the call. The final call has
+ * last == true (its piece may be empty). A body that turns out malformed
+ * or too large is abandoned without a final call.
+ */
+using http_body_stream = std::function<void(std::string_view piece, bool last)>;
+
+/**
+ * @brief Chooses, once a request head is complete, how its body is received
+ *
+ * Gets the method, URI, version and headers of a request with a body (the
+ * result is not complete yet) and returns the stream to receive the body,
+ * or nullptr to buffer it. Runs on the event loop thread.
+ */
+using http_body_stream_selector = std::function<http_body_stream(const http_parse_result& head)>;
+
+/**
+ * @class http_body_spool
+ * @brief Request body kept in an anonymous file instead of memory
+ *
+ * Backed by memfd_create where available, otherwise by a temporary file
+ * unlinked right after it is created; either way the storage disappears
+ * with the last descriptor. Written by the parser, read by the handler.
+ */
+class http_body_spool {
+    /// Descriptor of the anonymous file
+    int fd_ = -1;
+
+    /// Bytes written so far
+    std::size_t size_ = 0;
+
+public:
+    /**
+     * @brief Create an empty spool
+     * @throws std::runtime_error if no anonymous file can be created
+     */
+    http_body_spool();
+
+    http_body_spool(const http_body_spool&) = delete;
+    http_body_spool& operator=(const http_body_spool&) = delete;
+
+    /// @brief Closes the file, releasing its storage
+    ~http_body_spool();
+
+    /**
+     * @brief Append body bytes
+     * @param data Bytes to write
+     * @param size Number of bytes
+     * @throws std::runtime_error if the write fails (e.g. the disk is full)
+     */
+    void append(const char* data, std::size_t size);
+
+    /// @brief Body size in bytes
+    std::size_t size() const noexcept { return size_; }
+
+    /**
+     * @brief Descriptor of the file, for sendfile(), mmap() or splice()
+     * @note Owned by the spool; read it with pread() so the offset is not shared
+     */
+    int fd() const noexcept { return fd_; }
+
+    /**
+     * @brief Read part of the body
+     * @param offset First byte
+     * @param length Maximum number of bytes, clamped to the end of the body
+     * @throws std::runtime_error if the read fails
+     */
+    std::string read(std::size_t offset, std::size_t length) const;
+
+    /// @brief The whole body in memory, defeats the purpose for large bodies
+    std::string to_string() const { return read(0, size_); }
+};
+
+}  // namespace cppress::http
@@ -0,0 +1,117 @@
+/**
+ * @file http_chunked_decoder.hpp
+ * @brief Incremental decoder for chunked Transfer-Encoding request bodies
+ *
+ * Decodes a chunked body as it arrives, one read at a time, without
+ * buffering it: each call hands back the next run of body bytes as a span
+ * of the caller's input, so the caller decides whether to copy, keep a
+ * slice or stream it. Only the chunk size line and trailer section are
+ * remembered across reads, the former as a few integers, the latter as
+ * its raw bytes (bounded by the caller's limit).
+ *
+ * Accepted syntax (RFC 9112 section 7.1):
+ * - chunk-size in hex, optionally followed by whitespace and chunk
+ *   extensions (";name=value"), which are skipped
+ * - Lines end in CRLF or a bare LF, as in request heads
+ * - Trailer fields after the last chunk, header syntax; lines without a
+ *   colon are ignored
+ *
+ * @note This is an internal implementation detail used by http_request_parser
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "http_head_parser.hpp"
+
+namespace cppress::http {
+
+/**
+ * @class http_chunked_decoder
+ * @brief State machine over the chunked body of one request
+ *
+ * Unlike http_head_parser each call takes only the new bytes: the decoder
+ * keeps its position in the chunk stream, not in a buffer.
+ *
+ * @code
+ * std::size_t pos = 0;
+ * http_span run;
+ * while (decoder.next(read, pos, run, limit) == http_chunked_decoder::status::data)
+ *     consume(run.in(read));
+ * @endcode
+ */
+class http_chunked_decoder {
+public:
+    enum class status {
+        /// run holds the next body bytes, call again
+        data,
+        /// input is used up, call again with the next read
+        need_more,
+        /// the last chunk and trailers are done, pos is the first byte after the body
+        complete,
+        /// the body is malformed or too large, see error()
+        error
+    };
+
+    enum class error_code { none, bad_chunk_size, bad_chunk_end, too_large };
+
+    /**
+     * @brief Decodes from input[pos] until body bytes, the end of the body, or the end of input
+     * @param input Bytes of the current read
+     * @param pos Position in input, advanced past what was decoded
+     * @param run Set to the body bytes found, when status::data is returned
+     * @param max_trailer_size Limit on the trailer section in bytes
+     * @return What stopped the decoding
+     */
+    status next(std::string_view input, std::size_t& pos, http_span& run,
+                std::size_t max_trailer_size);
+
+    /// @brief Why decoding failed, error_code::none unless next() returned status::error
+    error_code error() const noexcept { return error_; }
+
+    /**
+     * @brief Trailer fields, valid once next() returned status::complete
+     * @return Name and trimmed value of each field, in order
+     */
+    std::vector<std::pair<std::string, std::string>> trailers() const;
+
+    /// @brief Prepares the decoder for another body
+    void reset() noexcept;
+
+private:
+    enum class phase {
+        size,           ///< hex digits of the chunk size
+        size_line,      ///< extensions and line end after the size
+        chunk_data,     ///< remaining_ bytes of chunk data
+        chunk_cr,       ///< CR (or bare LF) ending the chunk data
+        chunk_lf,       ///< LF after that CR
+        trailer,        ///< trailer section, collected in trailer_bytes_
+        done,
+        failed
+    };
+
+    phase phase_ = phase::size;
+    error_code error_ = error_code::none;
+
+    /// Size of the chunk being read, then the bytes of it still to come
+    std::uint64_t remaining_ = 0;
+
+    /// Hex digits seen in the current size line
+    std::size_t digits_ = 0;
+
+    /// A ';' was seen on the size line, the rest of it is extensions
+    bool in_extension_ = false;
+
+    /// Raw trailer section, every line including the final empty one
+    std::string trailer_bytes_;
+
+    status fail(error_code code) noexcept;
+};
+
+}  // namespace cppress::http
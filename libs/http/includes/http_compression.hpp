@@ -0,0 +1,117 @@
+/**
+ * @file http_compression.hpp
+ * @brief Content-Encoding negotiation and response body compressors
+ *
+ * gzip (zlib), br (brotli) and zstd are each compiled in when CMake finds
+ * the library; CPPRESS_HAS_ZLIB, CPPRESS_HAS_BROTLI and CPPRESS_HAS_ZSTD
+ * are defined to 1 for the ones that were. A coding that is not compiled
+ * in is never negotiated for on-the-fly compression, but can still be
+ * named, e.g. to serve a precompressed file.
+ *
+ * @code
+ * auto coding = negotiate_content_coding(req.get_header_fields());
+ * res.set_compression(coding);  // applied by send() or begin_stream()
+ * @endcode
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "http_headers.hpp"
+
+namespace cppress::http {
+
+/**
+ * @enum content_coding
+ * @brief Content codings the server can compress with, in no particular order
+ */
+enum class content_coding { identity, gzip, br, zstd };
+
+/// Level that means "the coding's own default" (gzip 6, br 5, zstd 3)
+constexpr int DEFAULT_COMPRESSION_LEVEL = -1;
+
+/// @brief Token of a coding in Content-Encoding, e.g. "br"; empty for identity
+std::string_view content_coding_name(content_coding coding) noexcept;
+
+/// @brief File name suffix of a precompressed variant, e.g. ".gz"; empty for identity
+std::string_view content_coding_suffix(content_coding coding) noexcept;
+
+/// @brief true if on-the-fly compression with this coding was compiled in
+bool content_coding_available(content_coding coding) noexcept;
+
+/**
+ * @brief Quality the client gave a coding in Accept-Encoding
+ * @param accept_encoding Value of an Accept-Encoding header, e.g. "gzip, br;q=0.8"
+ * @return q in [0, 1]: the coding's own entry, else "*", else 0 (identity: 1)
+ */
+double accept_encoding_quality(std::string_view accept_encoding, content_coding coding) noexcept;
+
+/**
+ * @brief Picks the coding to answer with
+ * @param headers Request headers; several Accept-Encoding fields count as one list
+ * @param candidates Codings to consider, most preferred first
+ * @return The candidate with the highest non-zero quality, ties going to the
+ *         earlier one; identity if the client accepts none of them
+ */
+content_coding negotiate_content_coding(const http_headers& headers,
+                                        std::initializer_list<content_coding> candidates);
+
+/// @brief negotiate_content_coding() over the compiled-in codings, br first
+content_coding negotiate_content_coding(const http_headers& headers);
+
+/**
+ * @brief true for media types worth compressing
+ *
+ * Any text type, JSON, JavaScript, XML and their +json / +xml subtypes, SVG and
+ * WebAssembly; images, video, archives and fonts in compressed formats are not.
+ */
+bool compressible_content_type(std::string_view content_type) noexcept;
+
+/**
+ * @class http_compressor
+ * @brief Streaming encoder for one response body
+ */
+class http_compressor {
+public:
+    /// What compress() does after consuming its input
+    enum class flush_mode {
+        /// Buffer as the encoder likes, output may be empty
+        none,
+        /// Emit everything consumed so far, e.g. one event of a stream
+        flush,
+        /// End the encoded stream
+        finish
+    };
+
+    /**
+     * @brief Creates an encoder
+     * @param coding Coding to produce
+     * @param level Encoder level, DEFAULT_COMPRESSION_LEVEL for the coding's default
+     * @return nullptr for identity or a coding that was not compiled in
+     * @throws std::runtime_error if the encoder cannot be initialised
+     */
+    static std::unique_ptr<http_compressor> create(content_coding coding,
+                                                   int level = DEFAULT_COMPRESSION_LEVEL);
+
+    virtual ~http_compressor() = default;
+
+    /**
+     * @brief Encodes the next part of the body
+     * @return The encoded bytes this call produced
+     * @throws std::runtime_error on an encoder error
+     */
+    virtual std::string compress(std::string_view input, flush_mode mode) = 0;
+};
+
+/**
+ * @brief Encodes a whole body in one call
+ * @throws std::invalid_argument if the coding is not available
+ */
+std::string compress_body(content_coding coding, std::string_view body,
+                          int level = DEFAULT_COMPRESSION_LEVEL);
+}  // namespace cppress::http
@@ -0,0 +1,77 @@
+/**
+ * @file http_conditional.hpp
+ * @brief Conditional GET: validators and 304 Not Modified (RFC 9110 section 13)
+ *
+ * A representation is identified by its ETag and Last-Modified headers. A
+ * client that holds a copy revalidates it with If-None-Match or
+ * If-Modified-Since; when the copy is still current the server answers 304
+ * without a body.
+ *
+ * @code
+ * std::string etag, last_modified;
+ * if (file_validators("public/app.js", etag, last_modified)) {
+ *     res.add_header("ETag", etag);
+ *     res.add_header("Last-Modified", last_modified);
+ * }
+ * res.send();  // a 304 with no body when the request's validators match
+ * @endcode
+ *
+ * http_response applies not_modified() on its own: a GET or HEAD answered
+ * with 200 and a matching ETag or Last-Modified goes out as 304.
+ */
+
+#pragma once
+
+#include <ctime>
+#include <string>
+#include <string_view>
+
+namespace cppress::http {
+
+/**
+ * @brief Format a time as an HTTP-date, e.g. "Sun, 06 Nov 1994 08:49:37 GMT"
+ * @param time Seconds since the epoch
+ */
+std::string format_http_date(std::time_t time);
+
+/**
+ * @brief Parse an HTTP-date
+ * @param value IMF-fixdate, or the obsolete RFC 850 or asctime form
+ * @param time Set to seconds since the epoch on success
+ * @return false if value is not a date
+ */
+bool parse_http_date(std::string_view value, std::time_t& time) noexcept;
+
+/**
+ * @brief Whether an If-None-Match list names a representation
+ * @param if_none_match Value of If-None-Match: "*" or a list of entity tags
+ * @param etag ETag of the representation, empty if it has none
+ *
+ * Uses the weak comparison: W/"v1" matches "v1". "*" matches any
+ * representation that has an ETag.
+ */
+bool etag_list_matches(std::string_view if_none_match, std::string_view etag) noexcept;
+
+/**
+ * @brief Whether a GET or HEAD can be answered with 304 Not Modified
+ * @param if_none_match Value of the request's If-None-Match, empty if none
+ * @param if_modified_since Value of the request's If-Modified-Since, empty if none
+ * @param etag ETag of the representation, empty if it has none
+ * @param last_modified Last-Modified of the representation, empty if it has none
+ *
+ * If-None-Match takes precedence; If-Modified-Since is only looked at
+ * without it, and an unparsable date is ignored.
+ */
+bool not_modified(std::string_view if_none_match, std::string_view if_modified_since,
+                  std::string_view etag, std::string_view last_modified) noexcept;
+
+/**
+ * @brief Validators of a file, from one stat call and no reads
+ * @param path File to describe
+ * @param etag Set to a weak tag built from size and modification time
+ * @param last_modified Set to the modification time as an HTTP-date
+ * @return false if path is not a regular file; the outputs are left alone then
+ */
+bool file_validators(const std::string& path, std::string& etag, std::string& last_modified);
+
+}  // namespace cppress::http
@@ -27,7 +27,10 @@
 
 #include <algorithm>
 #include <chrono>
+#include <cstdint>
 #include <string>
+
+#include "sockets/includes/socket_options.hpp"
 namespace cppress::http {
 
 /**
@@ -46,9 +49,33 @@ extern size_t MAX_HEADER_SIZE;
 /// Maximum size of HTTP request body (default: system-dependent)
 extern size_t MAX_BODY_SIZE;
 
-/// Maximum idle time before connection cleanup (default: system-dependent)
+/// Bodies larger than this are written to an anonymous file instead of memory (0: never)
+extern size_t BODY_SPILL_THRESHOLD;
+
+/// Maximum size of a streamed or spilled request body, replaces MAX_BODY_SIZE for those
+extern size_t MAX_STREAMED_BODY_SIZE;
+
+/// Maximum idle time between requests before the connection is closed
 extern std::chrono::seconds MAX_IDLE_TIME_SECONDS;
 
+/// Maximum time from accept until the first request's headers have arrived
+extern std::chrono::seconds MAX_HEADER_READ_TIME_SECONDS;
+
+/// Maximum silence between two reads of a request body
+extern std::chrono::seconds MAX_BODY_READ_TIME_SECONDS;
+
+/// Queued response bytes above which a connection stops being read (0 disables)
+extern size_t WRITE_HIGH_WATERMARK;
+
+/// Queued response bytes at or below which a paused connection is read again
+extern size_t WRITE_LOW_WATERMARK;
+
+/// Open connections at which the server stops accepting (0 for no cap)
+extern size_t MAX_CONNECTIONS;
+
+/// Responses written in batches of at least this many bytes use MSG_ZEROCOPY (0 disables)
+extern size_t ZEROCOPY_THRESHOLD;
+
 /// Server socket listen backlog size (default: system-dependent)
 extern int BACKLOG_SIZE;
 
@@ -57,6 +84,64 @@ extern int MAX_FILE_DESCRIPTORS;
 
 /// Timeout for epoll/select operations in milliseconds (default: system-dependent)
 extern int TIMEOUT_MILLISECONDS;
+
+/// Number of event loops (reactors) the server runs, each with its own SO_REUSEPORT listener
+extern std::size_t REACTOR_COUNT;
+
+/// Requests the web server lets wait for a worker; past it new ones are answered 503
+extern std::size_t REQUEST_QUEUE_LIMIT;
+
+/// Longest a request may wait for a worker before it is answered 503 unhandled
+extern std::chrono::milliseconds REQUEST_QUEUE_TIMEOUT;
+
+/// Retry-After sent with those 503 responses
+extern std::chrono::seconds REQUEST_RETRY_AFTER_SECONDS;
+
+/// Pin each reactor thread to one CPU core (Linux only)
+extern bool PIN_REACTORS;
+
+/// Place reactors and workers by NUMA node and cache domain (see shared::cpu_topology);
+/// takes precedence over PIN_REACTORS
+extern bool NUMA_PLACEMENT;
+
+/// Drive the reactors with io_uring instead of epoll when the kernel supports it
+extern bool USE_IO_URING;
+
+/// Options of the listener and accepted sockets (default: socket_options::low_latency())
+extern cppress::sockets::socket_options SOCKET_OPTIONS;
+
+/// Serve HTTP/2 to clients with prior knowledge and to h2c upgrade requests
+extern bool HTTP2_ENABLED;
+
+/// Streams one HTTP/2 connection may have open at once (SETTINGS_MAX_CONCURRENT_STREAMS)
+extern std::uint32_t HTTP2_MAX_CONCURRENT_STREAMS;
+
+/// Flow-control window granted to each HTTP/2 stream and to the connection (at least 65535)
+extern std::uint32_t HTTP2_INITIAL_WINDOW_SIZE;
+
+/// Ranges one Range header may ask for; longer lists are ignored and the whole file is sent
+extern std::size_t MAX_RANGES;
+
+/// Parts one multipart body may have; a body with more fails to parse
+extern std::size_t MAX_MULTIPART_PARTS;
+
+/// Largest WebSocket message, after reassembly and decompression; larger ones close with 1009
+extern std::size_t WEBSOCKET_MAX_MESSAGE_SIZE;
+
+/// Quiet time after which a WebSocket connection is pinged
+extern std::chrono::seconds WEBSOCKET_PING_INTERVAL_SECONDS;
+
+/// Time a ping has to be answered before the WebSocket connection is closed
+extern std::chrono::seconds WEBSOCKET_PONG_TIMEOUT_SECONDS;
+
+/// Time the client has to answer the server's close frame before the socket is closed
+extern std::chrono::seconds WEBSOCKET_CLOSE_TIMEOUT_SECONDS;
+
+/// Accept permessage-deflate offers (needs zlib)
+extern bool WEBSOCKET_DEFLATE;
+
+/// Events in a row an sse_channel skips for a congested subscriber before ending its stream
+extern std::size_t SSE_MAX_LAGGED_EVENTS;
 }  // namespace config
 
 /**
@@ -0,0 +1,200 @@
+/**
+ * @file http_event_stream.hpp
+ * @brief Server-Sent Events responses and broadcast channels
+ *
+ * http_response::begin_event_stream() turns a response into a
+ * text/event-stream and returns its sse_subscriber, which outlives the
+ * request callback and may be written from any thread.
+ *
+ * An sse_channel fans one event out to many subscribers: the event is
+ * encoded once, chunk framing included, into an immutable reference-counted
+ * buffer, and that same buffer is queued on every subscriber's connection.
+ * Publishing to N subscribers costs one encoding and N reference counts,
+ * not N formatted copies.
+ *
+ * A subscriber whose connection is above the write high watermark (see
+ * config::WRITE_HIGH_WATERMARK) is skipped and its lag counted; once it
+ * misses more than config::SSE_MAX_LAGGED_EVENTS events in a row its
+ * stream is ended. The browser reconnects with Last-Event-ID and can be
+ * caught up from there.
+ *
+ * @code
+ * cppress::http::sse_channel prices;
+ *
+ * server.set_request_callback([&prices](http_request& req, http_response& res) {
+ *     if (req.get_uri() == "/prices")
+ *         prices.subscribe(res.begin_event_stream());
+ * });
+ *
+ * // any thread
+ * prices.publish({"42", "tick", "{\"EURUSD\":1.0841}"});
+ * @endcode
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "sockets/includes/output_chain.hpp"
+
+namespace cppress::http {
+
+/**
+ * @struct sse_event
+ * @brief One Server-Sent Event; empty fields are left out
+ */
+struct sse_event {
+    /// Sent as id:, comes back as Last-Event-ID when the client reconnects
+    std::string id;
+
+    /// Sent as event:, the type the client's listener is registered for
+    std::string event;
+
+    /// Payload; every line becomes a data: field
+    std::string data;
+
+    /// Reconnection delay asked of the client, 0 to leave it out
+    std::chrono::milliseconds retry{0};
+};
+
+/// @brief State of the connection an event stream writes to
+enum class output_state {
+    /// Output is draining
+    writable,
+    /// Queued output is above the write high watermark
+    congested,
+    /// The connection is gone
+    closed
+};
+
+/**
+ * @brief Encodes an event as text/event-stream, without chunk framing
+ */
+std::string format_sse_event(const sse_event& event);
+
+/**
+ * @brief Encodes an event as one complete chunk of a chunked event stream
+ * @return Immutable buffer that may be queued on any number of connections
+ */
+cppress::sockets::data_buffer encode_sse_event(const sse_event& event);
+
+/**
+ * @class sse_subscriber
+ * @brief The writing end of one event stream response
+ *
+ * Usually obtained from http_response::begin_event_stream(). Every member
+ * may be called from any thread.
+ */
+class sse_subscriber {
+public:
+    /// Writes response bytes, last is true when the response is complete
+    using send_function =
+        std::function<void(std::vector<cppress::sockets::output_segment>&&, bool last)>;
+
+    /// Reports the state of the connection
+    using state_function = std::function<output_state()>;
+
+    /**
+     * @brief Construct the writing end of a stream whose head was sent
+     * @param send Writes to the response
+     * @param state State of the connection, may be empty (then always writable)
+     * @param owner Keeps what send and state point to alive
+     */
+    sse_subscriber(send_function send, state_function state, std::shared_ptr<void> owner);
+
+    sse_subscriber(const sse_subscriber&) = delete;
+    sse_subscriber& operator=(const sse_subscriber&) = delete;
+
+    /**
+     * @brief Send one event
+     * @return false if the stream is closed
+     */
+    bool send(const sse_event& event);
+
+    /**
+     * @brief Send an event encoded with encode_sse_event(); the buffer is shared, not copied
+     * @return false if the stream is closed
+     */
+    bool send(const cppress::sockets::data_buffer& chunk);
+
+    /**
+     * @brief Send a comment line, which clients ignore; keeps proxies from timing out
+     * @return false if the stream is closed
+     */
+    bool comment(const std::string& text = "");
+
+    /// @brief End the stream; the client sees the response complete
+    void close();
+
+    /// @brief true after close() or once the connection is gone
+    bool is_closed() const;
+
+    /// @brief State of the connection, closed after close()
+    output_state state() const;
+
+    /// @brief Events a channel skipped for this subscriber because it was congested
+    std::uint64_t lag() const { return lag_.load(std::memory_order_relaxed); }
+
+private:
+    friend class sse_channel;
+
+    send_function send_;
+    state_function state_;
+    std::shared_ptr<void> owner_;
+
+    /// Guards closed_ and orders output with close()
+    mutable std::mutex mutex_;
+    bool closed_ = false;
+
+    std::atomic<std::uint64_t> lag_{0};
+
+    /// Events skipped in a row, reset by every delivery; touched under the channel's lock
+    std::size_t skipped_in_a_row_ = 0;
+};
+
+/**
+ * @class sse_channel
+ * @brief Broadcasts events to a set of event stream subscribers
+ *
+ * Thread-safe; publish() may run concurrently with subscribe().
+ */
+class sse_channel {
+public:
+    /**
+     * @brief Add a subscriber
+     * @param subscriber Usually the result of http_response::begin_event_stream()
+     */
+    void subscribe(std::shared_ptr<sse_subscriber> subscriber);
+
+    /**
+     * @brief Encode an event once and queue it on every subscriber
+     * @return Subscribers the event was queued on
+     *
+     * Closed subscribers are removed. Congested ones are skipped, and ended
+     * once they skipped more than config::SSE_MAX_LAGGED_EVENTS in a row.
+     */
+    std::size_t publish(const sse_event& event);
+
+    /// @brief Number of subscribers, closed ones included until the next publish()
+    std::size_t size() const;
+
+    /// @brief Subscribers ended for lagging, since construction
+    std::uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+    /// @brief End every subscriber's stream
+    void close_all();
+
+private:
+    mutable std::mutex mutex_;
+    std::vector<std::shared_ptr<sse_subscriber>> subscribers_;
+    std::atomic<std::uint64_t> dropped_{0};
+};
+
+}  // namespace cppress::http
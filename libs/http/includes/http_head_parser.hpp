@@ -0,0 +1,144 @@
+/**
+ * @file http_head_parser.hpp
+ * @brief Resumable byte-level parser for the request line and headers
+ *
+ * The head of a request (request line, header fields, blank line) is
+ * scanned in place: fields are recorded as offsets into the caller's
+ * buffer, nothing is copied or allocated while parsing a head of up to
+ * INLINE_FIELDS header fields. When a head arrives in several reads the
+ * caller appends each read to one contiguous buffer and calls parse()
+ * again; scanning resumes where it stopped instead of starting over.
+ *
+ * Accepted syntax, matching what the server always took:
+ * - Lines end in CRLF or a bare LF
+ * - Empty lines before the request line are skipped
+ * - Request line tokens are separated by one or more spaces or tabs
+ * - Header lines without a colon are ignored
+ * - Optional whitespace around field values is trimmed
+ *
+ * @note This is an internal implementation detail used by http_request_parser
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace cppress::http {
+
+/**
+ * @struct http_span
+ * @brief Byte range of a parsed element inside the parser's input
+ */
+struct http_span {
+    std::size_t offset = 0;
+    std::size_t length = 0;
+
+    /// @brief The bytes of this span inside input
+    std::string_view in(std::string_view input) const noexcept {
+        return input.substr(offset, length);
+    }
+};
+
+/**
+ * @struct http_header_field
+ * @brief Name and trimmed value of one header field
+ */
+struct http_header_field {
+    http_span name;
+    http_span value;
+};
+
+/**
+ * @class http_head_parser
+ * @brief State machine over the head of one HTTP/1.x request
+ *
+ * Every call to parse() must pass the same bytes as the previous call,
+ * possibly followed by more; offsets stay valid for that buffer.
+ */
+class http_head_parser {
+public:
+    /// Header fields stored without allocating
+    static constexpr std::size_t INLINE_FIELDS = 32;
+
+    enum class status {
+        /// The head is not complete, parse again with more bytes
+        need_more,
+        /// The blank line ending the head was seen, consumed() is the head size
+        complete,
+        /// The head is malformed or too large, see error()
+        error
+    };
+
+    enum class error_code { none, bad_request_line, bad_header, too_large };
+
+    /**
+     * @brief Scans input from where the previous call stopped
+     * @param input Bytes of the request so far, starting at its first byte
+     * @param max_head_size Largest head accepted, larger ones fail with too_large
+     * @return Parsing status
+     */
+    status parse(std::string_view input, std::size_t max_head_size);
+
+    /// @brief Bytes of input examined; once complete, the offset of the body
+    std::size_t consumed() const noexcept { return pos_; }
+
+    /// @brief Why parsing failed
+    error_code error() const noexcept { return error_; }
+
+    http_span method() const noexcept { return method_; }
+    http_span uri() const noexcept { return uri_; }
+    http_span version() const noexcept { return version_; }
+
+    /// @brief Number of header fields parsed so far
+    std::size_t header_count() const noexcept { return count_; }
+
+    /// @brief Header field i, i below header_count(), in arrival order
+    const http_header_field& header(std::size_t i) const noexcept {
+        return i < INLINE_FIELDS ? inline_[i] : overflow_[i - INLINE_FIELDS];
+    }
+
+    /// @brief Forgets everything, ready for the next request
+    void reset() noexcept;
+
+private:
+    enum class phase : std::uint8_t {
+        leading_eol,
+        method,
+        after_method,
+        uri,
+        after_uri,
+        version,
+        request_line_end,
+        field_start,
+        field_name,
+        field_ws,
+        field_value,
+        field_skip,
+        final_lf,
+        done,
+        failed
+    };
+
+    phase phase_ = phase::leading_eol;
+    error_code error_ = error_code::none;
+    std::size_t pos_ = 0;
+    std::size_t mark_ = 0;
+
+    http_span method_;
+    http_span uri_;
+    http_span version_;
+    http_span name_;
+
+    std::array<http_header_field, INLINE_FIELDS> inline_{};
+    std::vector<http_header_field> overflow_;
+    std::size_t count_ = 0;
+
+    status fail(error_code code) noexcept;
+    void add_field(http_span name, http_span value);
+};
+
+}  // namespace cppress::http
@@ -0,0 +1,62 @@
+/**
+ * @file http_head_writer.hpp
+ * @brief Serialization of response heads with one allocation
+ *
+ * The head of a response (status line, Date, header fields, blank line) is
+ * written into a single string whose size is computed up front, which is
+ * then moved into the connection's output chain as one segment. The
+ * status lines of common codes are pre-encoded, the Date line is formatted
+ * at most once per second per thread, and header names are written as
+ * stored: http_response upper-cases them when they are added, resolving
+ * well-known names from a compile-time table.
+ *
+ * @note This is an internal implementation detail used by http_response
+ */
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <string_view>
+
+namespace cppress::http {
+
+/**
+ * @brief Pre-encoded "HTTP/1.1 <code> <reason>\r\n" of a status
+ * @param code Status code
+ * @param reason Reason phrase the response uses
+ * @return The line, empty if the code is not in the table or the reason differs
+ */
+std::string_view http_status_line(int code, std::string_view reason) noexcept;
+
+/**
+ * @brief Reason phrase of a status code, from the same table as http_status_line()
+ * @param code Status code
+ * @return The phrase, e.g. "Not Found", empty if the code is not in the table
+ */
+std::string_view http_reason_phrase(int code) noexcept;
+
+/**
+ * @brief "Date: <IMF-fixdate>\r\n" for the current second
+ * @return View of a per-thread cache, valid until the next call on this thread
+ */
+std::string_view http_date_line();
+
+/**
+ * @brief Upper-cased form of a well-known header name
+ * @param name Header name in any case
+ * @return Static upper-case spelling, empty if the name is not in the table
+ */
+std::string_view http_well_known_header(std::string_view name) noexcept;
+
+/**
+ * @brief Writes a response head
+ * @param version HTTP version, e.g. "HTTP/1.1"
+ * @param code Status code
+ * @param reason Reason phrase
+ * @param headers Header fields, names already upper-cased
+ * @return Status line, Date line, fields and the blank line, in one reservation
+ */
+std::string write_http_head(std::string_view version, int code, std::string_view reason,
+                            const std::multimap<std::string, std::string>& headers);
+}  // namespace cppress::http
@@ -0,0 +1,217 @@
+/**
+ * @file http_headers.hpp
+ * @brief Flat storage for the header fields of a request
+ *
+ * Names and values are kept as received, back to back in one string; each
+ * field is a pair of offsets into it, and up to INLINE_FIELDS fields are
+ * stored without a separate allocation. Names the server and most handlers
+ * look up (Content-Length, Connection, Host, Cookie, ...) are resolved to a
+ * header_id once, when the field is added, so finding the first one is an
+ * array index. Any other name is found by a case-insensitive comparison.
+ *
+ * @code
+ * http_headers headers;
+ * headers.add("Host", "example.com");
+ * headers.add("X-Trace", "abc");
+ * headers.get(header_id::host);   // "example.com"
+ * headers.get("x-trace");         // "abc"
+ * for (const auto& [name, value] : headers) { ... }
+ * @endcode
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace cppress::http {
+
+/**
+ * @enum header_id
+ * @brief Request header names resolved when a field is parsed
+ */
+enum class header_id : std::uint8_t {
+    other,  ///< Any name not listed below
+    accept,
+    accept_encoding,
+    accept_language,
+    authorization,
+    cache_control,
+    connection,
+    content_length,
+    content_type,
+    cookie,
+    expect,
+    host,
+    if_modified_since,
+    if_none_match,
+    origin,
+    range,
+    referer,
+    traceparent,
+    transfer_encoding,
+    upgrade,
+    user_agent,
+};
+
+/// Number of header_id values, other included
+constexpr std::size_t HEADER_ID_COUNT = static_cast<std::size_t>(header_id::user_agent) + 1;
+
+/**
+ * @brief Id of a header name, compared case-insensitively
+ * @return header_id::other for names not in the table
+ */
+header_id http_header_id(std::string_view name) noexcept;
+
+/// @brief Canonical spelling of a known name, e.g. "Content-Length"; empty for other
+std::string_view http_header_name(header_id id) noexcept;
+
+/**
+ * @struct http_header
+ * @brief One header field, viewing the storage of the http_headers it came from
+ */
+struct http_header {
+    std::string_view name;
+    std::string_view value;
+};
+
+/**
+ * @class http_headers
+ * @brief Header fields in arrival order, duplicates kept
+ *
+ * Views returned by lookups and iteration stay valid until the container
+ * is modified, moved from or destroyed.
+ */
+class http_headers {
+public:
+    /// Header fields stored without allocating
+    static constexpr std::size_t INLINE_FIELDS = 16;
+
+    /// Forward iterator over the fields, yielding http_header by value
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = http_header;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = http_header;
+
+        const_iterator(const http_headers* headers, std::size_t index) noexcept
+            : headers_(headers), index_(index) {}
+
+        http_header operator*() const noexcept { return (*headers_)[index_]; }
+        const_iterator& operator++() noexcept {
+            ++index_;
+            return *this;
+        }
+        const_iterator operator++(int) noexcept {
+            const_iterator old = *this;
+            ++index_;
+            return old;
+        }
+        bool operator==(const const_iterator& other) const noexcept {
+            return index_ == other.index_;
+        }
+        bool operator!=(const const_iterator& other) const noexcept {
+            return index_ != other.index_;
+        }
+
+    private:
+        const http_headers* headers_;
+        std::size_t index_;
+    };
+
+    http_headers() noexcept { first_.fill(NONE); }
+
+    /**
+     * @brief Appends a field, resolving the id of its name
+     * @throws std::length_error if the fields outgrow 4 GiB of text
+     */
+    void add(std::string_view name, std::string_view value);
+
+    /// @brief Reserves room for bytes of names and values, e.g. the size of a head
+    void reserve(std::size_t bytes) { text_.reserve(bytes); }
+
+    /// @brief Removes every field
+    void clear() noexcept;
+
+    /// @brief Number of fields, duplicates included
+    std::size_t size() const noexcept { return count_; }
+
+    /// @brief true if there are no fields
+    bool empty() const noexcept { return count_ == 0; }
+
+    /// @brief Field i in arrival order, i < size()
+    http_header operator[](std::size_t i) const noexcept;
+
+    /// @brief Id of field i, i < size()
+    header_id id(std::size_t i) const noexcept { return field(i).id; }
+
+    const_iterator begin() const noexcept { return const_iterator(this, 0); }
+    const_iterator end() const noexcept { return const_iterator(this, count_); }
+
+    /// @brief true if a field with this id is present
+    bool contains(header_id id) const noexcept { return first_[index_of(id)] != NONE; }
+
+    /// @brief true if a field with this name is present
+    bool contains(std::string_view name) const noexcept;
+
+    /// @brief Value of the first field with this id, empty if none
+    std::string_view get(header_id id) const noexcept;
+
+    /// @brief Value of the first field with this name, empty if none
+    std::string_view get(std::string_view name) const noexcept;
+
+    /// @brief Number of fields with this id
+    std::size_t count(header_id id) const noexcept;
+
+    /// @brief Number of fields with this name
+    std::size_t count(std::string_view name) const noexcept;
+
+    /**
+     * @brief Calls fn(value) for every field with this id, in arrival order
+     */
+    template <typename Fn>
+    void for_each(header_id id, Fn&& fn) const {
+        std::size_t first = first_[index_of(id)];
+        if (first == NONE)
+            return;
+        for (std::size_t i = first; i < count_; ++i)
+            if (field(i).id == id)
+                fn((*this)[i].value);
+    }
+
+    /// @brief Copies of the values of every field with this name
+    std::vector<std::string> values(std::string_view name) const;
+
+private:
+    /// Offsets into text_, the name is followed by its value
+    struct entry {
+        header_id id;
+        std::uint32_t name_offset;
+        std::uint32_t name_length;
+        std::uint32_t value_length;
+    };
+
+    static constexpr std::uint32_t NONE = UINT32_MAX;
+
+    static std::size_t index_of(header_id id) noexcept { return static_cast<std::size_t>(id); }
+
+    const entry& field(std::size_t i) const noexcept {
+        return i < INLINE_FIELDS ? inline_[i] : overflow_[i - INLINE_FIELDS];
+    }
+
+    std::string text_;
+    std::array<entry, INLINE_FIELDS> inline_{};
+    std::vector<entry> overflow_;
+    std::size_t count_ = 0;
+
+    /// Index of the first field of each id, NONE if absent
+    std::array<std::uint32_t, HEADER_ID_COUNT> first_;
+};
+}  // namespace cppress::http
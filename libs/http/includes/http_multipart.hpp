@@ -0,0 +1,219 @@
+/**
+ * @file http_multipart.hpp
+ * @brief Streaming multipart/form-data parser (RFC 7578, RFC 2046 section 5.1)
+ *
+ * multipart_parser takes the body in pieces of any size and finds the
+ * boundaries as they arrive, without holding the body. Each part's
+ * headers are parsed, then its content is handed to a sink while it is
+ * still arriving: kept in memory by default, or written to a file or any
+ * callback chosen per part by a sink selector.
+ *
+ * With http_server::set_multipart_sink_selector() the server feeds every
+ * multipart/form-data body to a parser as it is read, and the request
+ * reaches the handler with the parts already received:
+ *
+ * @code
+ * server.set_multipart_sink_selector([](const multipart_part& part) -> multipart_sink {
+ *     if (part.filename.empty())
+ *         return nullptr;  // form fields stay in memory
+ *     return multipart_file_sink("/var/uploads/" + sanitize(part.filename));
+ * });
+ * server.set_request_callback([](http_request& req, http_response& res) {
+ *     auto form = req.get_multipart();
+ *     if (!form || !form->complete())
+ *         ...  // 400
+ *     for (const auto& part : form->parts())
+ *         ...  // part.name, part.filename, part.content for fields
+ * });
+ * @endcode
+ *
+ * A buffered or spilled body can be parsed the same way by feeding it to
+ * a multipart_parser from the handler.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "http_headers.hpp"
+
+namespace cppress::http {
+
+/**
+ * @struct multipart_part
+ * @brief One part of a multipart body
+ */
+struct multipart_part {
+    /// Headers of the part, usually Content-Disposition and Content-Type
+    http_headers headers;
+
+    /// name parameter of Content-Disposition, the form field
+    std::string name;
+
+    /// filename parameter of Content-Disposition, empty for plain fields
+    std::string filename;
+
+    /// Content-Type of the part, text/plain when it has none
+    std::string content_type = "text/plain";
+
+    /// Content of a part no sink took; empty for parts given to a sink
+    std::string content;
+
+    /// Content bytes received so far
+    std::uint64_t size = 0;
+
+    /// The delimiter after the content was seen
+    bool complete = false;
+};
+
+/**
+ * @brief Receives the content of one part
+ *
+ * Called with each piece as it is found, in order; the view is only valid
+ * during the call. The final call has last == true and an empty piece. A
+ * body that turns out malformed is abandoned without a final call.
+ */
+using multipart_sink = std::function<void(std::string_view piece, bool last)>;
+
+/**
+ * @brief Chooses the sink of a part once its headers are in
+ *
+ * Returns nullptr to keep the content in multipart_part::content.
+ */
+using multipart_sink_selector = std::function<multipart_sink(const multipart_part& part)>;
+
+/**
+ * @brief Sink that writes a part to a file
+ * @param path File to create, truncated if it exists
+ * @throws std::runtime_error if the file cannot be created
+ *
+ * The file is closed after the final piece.
+ */
+multipart_sink multipart_file_sink(const std::string& path);
+
+/**
+ * @brief Boundary parameter of a multipart Content-Type
+ * @param content_type Value such as "multipart/form-data; boundary=----x"
+ * @param boundary Set to the boundary, quotes removed
+ * @return false unless the type is multipart/ and the boundary is 1 to 70 characters
+ */
+bool multipart_boundary(std::string_view content_type, std::string& boundary);
+
+/**
+ * @class multipart_parser
+ * @brief Incremental parser of one multipart body
+ *
+ * Part headers are bounded by config::MAX_HEADER_SIZE, the number of
+ * parts by config::MAX_MULTIPART_PARTS and the content kept in memory by
+ * config::MAX_BODY_SIZE; exceeding one fails the body. So does an
+ * exception thrown by a selector or sink.
+ *
+ * Not thread-safe: feed it from one thread, read the parts once complete()
+ * or failed().
+ */
+class multipart_parser {
+public:
+    /**
+     * @brief Construct a parser for one body
+     * @param boundary Boundary from the Content-Type, see multipart_boundary()
+     * @param selector Chooses each part's sink, nullptr to keep every part in memory
+     */
+    explicit multipart_parser(std::string_view boundary,
+                              multipart_sink_selector selector = nullptr);
+
+    // the boundary searcher points into the parser
+    multipart_parser(const multipart_parser&) = delete;
+    multipart_parser& operator=(const multipart_parser&) = delete;
+
+    /**
+     * @brief Feed the next bytes of the body
+     * @return false once the body is malformed; later calls do nothing
+     *
+     * Bytes after the closing delimiter, the epilogue, are ignored.
+     */
+    bool feed(std::string_view data);
+
+    /**
+     * @brief The body has ended
+     * @return complete(); a body cut before its closing delimiter fails
+     */
+    bool finish();
+
+    /// @brief The closing delimiter was seen
+    bool complete() const noexcept { return state_ == state::done; }
+
+    /// @brief The body is malformed, too large, or a sink failed
+    bool failed() const noexcept { return state_ == state::failed; }
+
+    /// @brief Parts seen so far, in body order
+    const std::vector<multipart_part>& parts() const noexcept { return parts_; }
+
+    /**
+     * @brief First part of a field
+     * @return nullptr if no part has that name
+     */
+    const multipart_part* find(std::string_view name) const noexcept;
+
+private:
+    enum class state { preamble, delimiter, headers, content, done, failed };
+
+    /// "\r\n--" + boundary; the body is read as if it began with "\r\n"
+    std::string delimiter_;
+
+    std::boyer_moore_horspool_searcher<const char*> searcher_;
+
+    multipart_sink_selector selector_;
+
+    state state_ = state::preamble;
+
+    /// Tail of the last piece that may start a delimiter
+    std::string carry_;
+
+    /// Bytes after a delimiter, or of a part's header block, not parsed yet
+    std::string head_;
+
+    std::vector<multipart_part> parts_;
+
+    /// Sink of the current part, empty if it is kept in memory
+    multipart_sink sink_;
+
+    /// Bytes kept in memory over all parts
+    std::size_t memory_size_ = 0;
+
+    /**
+     * @brief Consume bytes in the current state
+     * @return Bytes used; less than data.size() only when the state changed
+     */
+    std::size_t consume(std::string_view data);
+
+    /// Consumes preamble or content up to the next delimiter
+    std::size_t consume_until_delimiter(std::string_view data);
+
+    /// Consumes what follows a delimiter: "--" or optional padding and CRLF
+    std::size_t consume_after_delimiter(std::string_view data);
+
+    /// Consumes the header block of a part
+    std::size_t consume_headers(std::string_view data);
+
+    /// Ends the part or preamble before a delimiter and expects what follows it
+    bool at_delimiter();
+
+    /// Parses a header block into a new part and chooses its sink
+    bool begin_part(std::string_view block);
+
+    /// Passes content of the current part to its sink or to memory
+    bool emit(std::string_view piece);
+
+    /// Ends the current part, if any, with its final sink call
+    bool end_part();
+
+    /// Marks the body failed; always returns false
+    bool fail();
+};
+
+}  // namespace cppress::http
@@ -14,11 +14,17 @@
 
 #pragma once
 
-#include <map>
+#include <memory>
 #include <string>
+#include <utility>
+
+#include "http_headers.hpp"
 
 namespace cppress::http {
 
+class http_body_spool;
+class multipart_parser;
+
 /**
  * @struct http_parse_result
  * @brief Result of HTTP message parsing operation
@@ -34,6 +40,16 @@ struct http_parse_result {
     /// true if complete request received and parsed successfully
     bool is_complete;
 
+    /// false while the request line and headers have not all arrived
+    bool headers_complete = true;
+
+    /// More bytes followed this complete request, parse_next() parses them
+    bool has_next = false;
+
+    /// The client sent Expect: 100-continue and waits for an answer before its body,
+    /// set on the first incomplete result only
+    bool expects_continue = false;
+
     /// HTTP method (GET, POST, PUT, DELETE, etc.)
     std::string method;
 
@@ -43,12 +59,19 @@ struct http_parse_result {
     /// HTTP version (typically "HTTP/1.1")
     std::string http_version;
 
-    /// Request headers (multimap allows duplicate header names)
-    std::multimap<std::string, std::string> headers;
+    /// Request headers, in arrival order with duplicates kept
+    http_headers headers;
 
-    /// Complete request body (empty for GET/HEAD requests)
+    /// Complete request body (empty for GET/HEAD requests, spilled and streamed bodies)
     std::string body;
 
+    /// File holding the body when it was spilled, see config::BODY_SPILL_THRESHOLD
+    std::shared_ptr<http_body_spool> body_spool;
+
+    /// Parts of a multipart body parsed as it arrived,
+    /// see http_server::set_multipart_sink_selector()
+    std::shared_ptr<multipart_parser> multipart;
+
     /**
      * @brief Construct a parse result
      * @param complete Whether parsing is complete
@@ -59,15 +82,13 @@ struct http_parse_result {
      * @param body Request body
      */
     http_parse_result(bool complete, const std::string& method, const std::string& uri,
-                      const std::string& version,
-                      const std::multimap<std::string, std::string>& headers,
-                      const std::string& body)
+                      const std::string& version, http_headers headers, std::string body)
         : is_complete(complete),
           method(method),
           uri(uri),
           http_version(version),
-          headers(headers),
-          body(body) {}
+          headers(std::move(headers)),
+          body(std::move(body)) {}
 
     /**
      * @brief Check if parsing is incomplete
@@ -86,7 +107,7 @@ struct http_parse_result {
         result += "Version: " + http_version + "\n";
         result += "Headers:\n";
         for (const auto& header : headers) {
-            result += "  " + header.first + ": " + header.second + "\n";
+            result += "  " + std::string(header.name) + ": " + std::string(header.value) + "\n";
         }
         result += "Body: " + body + "\n";
         return result;
@@ -17,9 +17,18 @@
 #pragma once
 
 #include <chrono>
-#include <map>
+#include <memory>
 #include <string>
 
+#include <vector>
+
+#include "http_body.hpp"
+#include "http_chunked_decoder.hpp"
+#include "http_head_parser.hpp"
+#include "http_headers.hpp"
+#include "http_multipart.hpp"
+#include "sockets/includes.hpp"
+
 namespace cppress::http {
 
 /**
@@ -28,33 +37,51 @@ namespace cppress::http {
  */
 enum class parse_strategy {
     CONTENT_LENGTH,    ///< Body size specified via Content-Length header
-    CHUNKED_ENCODING,  ///< Chunked transfer encoding (not yet implemented)
+    CHUNKED_ENCODING,  ///< Chunked transfer encoding, decoded as it arrives
     NONE               ///< No recognized body encoding detected
 };
 
 /**
  * @struct http_parse_state
- * @brief Temporary storage for incomplete HTTP request parsing state
+ * @brief Parsing state of one connection
  *
- * Stored in http_request_parser::pending_requests_ map, keyed by
- * connection identifier. Accumulates headers and body data across multiple
- * read operations until the complete request is received.
+ * Stored in http_request_parser's per-descriptor table and reused for
+ * every request of a persistent connection. Accumulates headers and body
+ * data across multiple read operations until the complete request is
+ * received. A head cut by the end of a read keeps its bytes and its head
+ * parser, which resumes where it stopped. Bytes that followed a complete
+ * request in the same read (pipelined requests) wait in backlog.
  *
- * The last_activity timestamp enables automatic cleanup of stale
- * connections that have been idle beyond MAX_IDLE_TIME_SECONDS.
+ * Stale states are not swept: the server's body-read deadline closes the
+ * connection, which discards its state.
  */
 struct http_parse_state {
-    /// Unique identifier for client connection (remote address string)
-    std::string connection_id;
+    /// Connection the state belongs to, a reused descriptor starts afresh
+    const cppress::sockets::connection* owner = nullptr;
 
     /// File descriptor of the socket
-    int socket_fd;
+    int socket_fd = -1;
+
+    /// The head is still incomplete, head and head_bytes hold it
+    bool reading_head = false;
+
+    /// The head is complete and the body is still arriving
+    bool reading_body = false;
+
+    /// Head parser of a request whose head spans several reads
+    http_head_parser head;
+
+    /// Bytes of the incomplete head received so far
+    std::string head_bytes;
+
+    /// Bytes received after the last complete request, parsed by parse_next()
+    cppress::sockets::data_buffer backlog;
 
     /// Parsing strategy based on request headers
-    parse_strategy strategy;
+    parse_strategy strategy = parse_strategy::NONE;
 
     /// Expected total body size (when strategy == CONTENT_LENGTH)
-    std::size_t expected_body_length;
+    std::size_t expected_body_length = 0;
 
     /// HTTP method (GET, POST, PUT, DELETE, etc.)
     std::string method;
@@ -65,34 +92,33 @@ struct http_parse_state {
     /// HTTP version (typically "HTTP/1.1")
     std::string http_version;
 
-    /// Request headers (multimap allows duplicate header names)
-    std::multimap<std::string, std::string> headers;
+    /// Request headers, trailer fields of a chunked body join them
+    http_headers headers;
 
     /// Accumulated request body (filled incrementally)
     std::string accumulated_body;
 
+    /// Decoder of a chunked body (when strategy == CHUNKED_ENCODING)
+    http_chunked_decoder chunked;
+
+    /// Decoded runs of a chunked body, slices of the reads they arrived in;
+    /// joined once, with one allocation, when the last chunk is in
+    std::vector<cppress::sockets::data_buffer> body_runs;
+
+    /// Body bytes received so far, wherever they went
+    std::size_t body_size = 0;
+
+    /// Receiver of a streamed body, chosen by the body stream selector
+    http_body_stream stream;
+
+    /// File a body above config::BODY_SPILL_THRESHOLD is written to
+    std::shared_ptr<http_body_spool> spool;
+
+    /// Parser the streamed body feeds when it is multipart
+    std::shared_ptr<multipart_parser> multipart;
+
     /// Timestamp of last data received for this connection
     std::chrono::steady_clock::time_point last_activity;
-
-    /// Default constructor
-    http_parse_state() = default;
-
-    /**
-     * @brief Construct with connection ID and parsing strategy
-     * @param conn_id Client identifier
-     * @param strat Body parsing strategy
-     */
-    http_parse_state(const std::string& conn_id, parse_strategy strat)
-        : connection_id(conn_id), strategy(strat) {}
-
-    /**
-     * @brief Comparison operator for map storage
-     * @param other Another http_parse_state instance
-     * @return true if this connection_id < other.connection_id
-     */
-    bool operator<(const http_parse_state& other) const {
-        return connection_id < other.connection_id;
-    }
 };
 
 }  // namespace cppress::http
@@ -0,0 +1,75 @@
+/**
+ * @file http_range.hpp
+ * @brief Range request parsing and If-Range validation (RFC 9110 section 14)
+ *
+ * Only the bytes unit is understood. A Range header that does not parse,
+ * or asks for more than config::MAX_RANGES ranges, is ignored and the full
+ * representation is sent, as the RFC allows.
+ *
+ * @code
+ * std::vector<byte_range> ranges;
+ * switch (parse_range_header(req.get_header_fields().get(header_id::range), size, ranges)) {
+ *     case range_result::partial:        // 206 with ranges
+ *     case range_result::unsatisfiable:  // 416, Content-Range names only the size
+ *     case range_result::full:           // 200 with the whole body
+ * }
+ * @endcode
+ *
+ * http_response::send_file() does all of this for a file.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace cppress::http {
+
+/**
+ * @struct byte_range
+ * @brief Satisfiable byte range, both ends inclusive
+ */
+struct byte_range {
+    std::uint64_t first = 0;
+    std::uint64_t last = 0;
+
+    /// @brief Number of bytes in the range
+    std::uint64_t size() const noexcept { return last - first + 1; }
+};
+
+/// @brief How a request's Range header applies to a representation
+enum class range_result {
+    /// No usable Range header: send everything
+    full,
+    /// One or more satisfiable ranges: 206 Partial Content
+    partial,
+    /// A valid header of which no range overlaps the representation: 416
+    unsatisfiable
+};
+
+/**
+ * @brief Resolve a Range header against a representation
+ * @param value Value of the Range header, empty if there is none
+ * @param size Length of the representation
+ * @param ranges Set to the ranges to send, sorted and with overlapping or
+ *        adjacent ones merged, when partial is returned
+ */
+range_result parse_range_header(std::string_view value, std::uint64_t size,
+                                std::vector<byte_range>& ranges);
+
+/**
+ * @brief Whether an If-Range precondition allows a partial response
+ * @param if_range Value of the If-Range header, empty if there is none
+ * @param etag ETag of the representation, empty if it has none
+ * @param last_modified Last-Modified of the representation, empty if it has none
+ * @return true without If-Range, or if it names the current representation:
+ *         a strong ETag match, or the exact Last-Modified date
+ */
+bool if_range_matches(std::string_view if_range, std::string_view etag,
+                      std::string_view last_modified) noexcept;
+
+/// @brief Content-Range value of a partial response, e.g. "bytes 0-499/1234"
+std::string content_range(const byte_range& range, std::uint64_t size);
+}  // namespace cppress::http
@@ -12,7 +12,7 @@
  * Key features:
  * - Immutable request data (read-only access via getters)
  * - Automatic connection cleanup on destruction
- * - Case-insensitive header access (headers normalized to uppercase internally)
+ * - Case-insensitive header access, well-known names resolved once at parse time
  * - Support for multiple values per header name
  * - Safe destroy() method with confirmation parameter
  *
@@ -39,10 +39,15 @@
 
 #pragma once
 
+#include <chrono>
 #include <functional>
-#include <map>
+#include <memory>
+#include <string_view>
 
+#include "http_body.hpp"
 #include "http_consts.hpp"
+#include "http_headers.hpp"
+#include "http_multipart.hpp"
 
 namespace cppress::http {
 /**
@@ -67,16 +72,35 @@ private:
     /// HTTP version (e.g., "HTTP/1.1")
     std::string version;
 
-    /// HTTP headers (multimap allows multiple values per header name)
-    std::multimap<std::string, std::string> headers;
+    /// HTTP headers, as received, duplicates kept
+    http_headers headers;
 
     /// Request body content
     std::string body;
 
+    /// File holding a body that was spilled to disk, body is empty then
+    std::shared_ptr<const http_body_spool> body_spool;
+
+    /// Parts of a multipart body parsed as it arrived, body is empty then
+    std::shared_ptr<const multipart_parser> multipart;
+
     /// Function to close the connection when needed (closes the current client only, it shall know
     /// what to close)
     std::function<void()> close_connection;
 
+    /// Keeps alive what close_connection points to; it captures a plain pointer
+    /// so that it fits std::function's inline storage
+    std::shared_ptr<void> connection_owner;
+
+    /// When the read that completed the request came in, see get_received_at()
+    std::chrono::steady_clock::time_point received_at{};
+
+    /// IP address of the client's end of the connection, see get_remote_address()
+    std::string remote_address;
+
+    /// The connection the request came on, see connection_id()
+    const void* connection = nullptr;
+
     /**
      * @brief Private constructor for internal use by http_server.
      * @param method HTTP method
@@ -90,8 +114,7 @@ private:
      * class to ensure proper request object creation and lifecycle management.
      */
     http_request(const std::string& method, const std::string& uri, const std::string& version,
-                 const std::multimap<std::string, std::string>& headers, const std::string& body,
-                 std::function<void()> close_connection);
+                 http_headers headers, std::string body, std::function<void()> close_connection);
 
 public:
     // Copy operations - DELETED for resource safety
@@ -154,6 +177,9 @@ public:
      */
     std::string get_uri() const;
 
+    /// @brief The request URI without copying; valid as long as the request
+    std::string_view get_uri_view() const { return uri; }
+
     /**
      * @brief Get the HTTP version.
      */
@@ -166,14 +192,69 @@ public:
 
     /**
      * @brief Get all headers as name-value pairs.
+     * @note Names are upper-cased, as they always were; get_header_fields() has them as sent
      */
     std::vector<std::pair<std::string, std::string>> get_headers() const;
 
+    /**
+     * @brief Value of the first header with this name, without copying
+     * @return Empty if the header is absent; valid as long as the request
+     */
+    std::string_view get_header_value(std::string_view name) const { return headers.get(name); }
+
+    /// @brief Value of the first header with this id, an array index
+    std::string_view get_header_value(header_id id) const { return headers.get(id); }
+
+    /// @brief The header fields, for lookups and iteration that do not copy
+    const http_headers& get_header_fields() const { return headers; }
+
     /**
      * @brief Get the request body.
+     * @note A spilled body is read back from its file, prefer get_body_spool() for those
      */
     std::string get_body() const;
 
+    /**
+     * @brief The request body, without copying
+     * @return Empty if the body was spilled to a file; valid as long as the request
+     */
+    std::string_view get_body_view() const { return body_spool ? std::string_view() : body; }
+
+    /**
+     * @brief File holding the body, if it was spilled
+     * @return nullptr unless the body exceeded config::BODY_SPILL_THRESHOLD
+     */
+    std::shared_ptr<const http_body_spool> get_body_spool() const { return body_spool; }
+
+    /**
+     * @brief When the read that completed the request came in
+     * @return Unset (the clock's epoch) unless the server timestamps requests,
+     *         see http_server::timestamp_requests
+     */
+    std::chrono::steady_clock::time_point get_received_at() const { return received_at; }
+
+    /**
+     * @brief IP address of the client's end of the connection
+     * @return The peer as accepted, not what a proxy's X-Forwarded-For claims; empty if
+     *         the request did not come from a connection
+     */
+    const std::string& get_remote_address() const { return remote_address; }
+
+    /**
+     * @brief Identity of the connection the request came on
+     * @return The same value for every request of one connection while it is open, a
+     *         value a later connection may reuse once it closed; nullptr if the request
+     *         did not come from a connection
+     */
+    const void* connection_id() const noexcept { return connection; }
+
+    /**
+     * @brief Multipart body parsed while it was read
+     * @return nullptr unless http_server::set_multipart_sink_selector() is set and the
+     *         body is multipart; check complete() before trusting the parts
+     */
+    std::shared_ptr<const multipart_parser> get_multipart() const { return multipart; }
+
     /// Default destructor
     ~http_request() = default;
 };
@@ -6,8 +6,10 @@
  * It handles incremental parsing of HTTP requests that may arrive across multiple
  * TCP segments, maintaining state for each active connection.
  *
- * The parser supports Content-Length based body parsing and automatically manages
- * cleanup of idle connections. All parsing is thread-safe through internal mutex.
+ * The parser supports Content-Length and chunked bodies, persistent connections
+ * and pipelining: bytes following a complete request are kept and parsed as
+ * the next request. It drops the state of closed connections. Connections
+ * are parsed concurrently without a lock, each by the event loop owning it.
  *
  * @note This is an internal implementation detail. Most users should interact with
  *       http_server, http_request, and http_response instead.
@@ -17,29 +19,36 @@
  * - Parse and validate HTTP headers
  * - Handle partial requests spanning multiple reads
  * - Enforce size limits (MAX_HEADER_SIZE, MAX_BODY_SIZE)
- * - Clean up idle connection state
+ * - Extract every pipelined request of a read, one at a time
+ * - Discard the state of closed connections
  * - Validate Content-Length against body size
+ * - Decode chunked bodies incrementally, trailers included
  *
  * @example Internal usage by http_server
  * @code
  * http_request_parser parser;
  * auto result = parser.parse(connection, data_buffer);
- * if (result.is_complete) {
+ * while (result.is_complete) {
  *     // Create http_request and http_response objects
  *     // Invoke user callback
+ *     if (!result.has_next)
+ *         break;
+ *     result = parser.parse_next(connection);
  * }
  * @endcode
  */
 
 #pragma once
 
+#include <atomic>
 #include <functional>
-#include <map>
 #include <memory>
-#include <mutex>
-#include <sstream>
+#include <string_view>
+#include <vector>
 
+#include "http_body.hpp"
 #include "http_consts.hpp"
+#include "http_head_parser.hpp"
 #include "http_parse_result.hpp"
 #include "http_parse_state.hpp"
 #include "sockets/includes.hpp"
@@ -48,23 +57,48 @@ namespace cppress::http {
 
 /**
  * @class http_request_parser
- * @brief Thread-safe HTTP message parser with stateful request handling
+ * @brief Lock-free HTTP message parser with stateful request handling
  *
  * Manages parsing of HTTP requests that may arrive in fragments across multiple
- * TCP read operations. Maintains per-connection state using connection identifiers
- * as keys, allowing concurrent handling of multiple connections.
+ * TCP read operations. Keeps one parse state per connection in a table indexed
+ * by file descriptor, so finding it costs an index instead of formatting and
+ * hashing the peer address, allowing concurrent handling of multiple connections.
+ * The table takes no lock: its pages never move and are installed with a
+ * compare-and-swap, and a slot is only touched by the event loop that owns
+ * the descriptor, so every reactor of a multi-reactor server parses
+ * independently.
  *
- * The parser enforces configured size limits and automatically cleans up state
- * for idle connections based on MAX_IDLE_TIME_SECONDS.
+ * The parser enforces configured size limits. Timeouts are enforced by the
+ * server's timer wheel, which calls discard() for connections it closes.
  */
 class http_request_parser {
-    /// Map of connection IDs to incomplete request data
-    std::map<std::string, http_parse_state> pending_requests_;
+    /// log2 of the slots per page of the state table
+    static constexpr std::size_t state_page_bits = 10;
 
-    /// Mutex for thread-safe access to pending_requests_
-    std::mutex parser_mutex_;
+    /// Pages of the state table, enough for descriptors below 4M
+    static constexpr std::size_t state_page_count = 4096;
+
+    /// A page: one slot per descriptor, the state allocated on first use
+    using state_page = std::unique_ptr<http_parse_state>[];
+
+    /// Parse state per connection, indexed by file descriptor + 1 (slot 0 holds
+    /// connections without a descriptor), in pages allocated as descriptors
+    /// reach them
+    std::unique_ptr<std::atomic<std::unique_ptr<http_parse_state>*>[]> pages_;
+
+    /// Decides which bodies are streamed, empty to buffer every body
+    http_body_stream_selector body_stream_selector_;
+
+    /// Sink selector of multipart bodies, empty to leave them to the other receivers
+    multipart_sink_selector multipart_sink_selector_;
 
 public:
+    http_request_parser();
+    ~http_request_parser();
+
+    http_request_parser(const http_request_parser&) = delete;
+    http_request_parser& operator=(const http_request_parser&) = delete;
+
     /**
      * @brief Main entry point for parsing incoming HTTP data
      * @param conn Client connection that sent the data
@@ -73,110 +107,156 @@ public:
      *
      * Determines if this is a new request or continuation of existing request,
      * then delegates to appropriate handler (begin_parsing or continue_parsing).
+     * When the request is complete and more bytes followed it, has_next is set
+     * and parse_next() extracts the next request.
      */
     http_parse_result parse(std::shared_ptr<cppress::sockets::connection> conn,
                             const cppress::sockets::data_buffer& data);
 
+    /**
+     * @brief Parse the next pipelined request of a connection
+     * @param conn Client connection whose last result had has_next set
+     * @return http_parse_result for the bytes that followed the previous request
+     *
+     * The buffered bytes are parsed like a new read: the request may be
+     * complete, or incomplete and resumed by the next parse().
+     */
+    http_parse_result parse_next(std::shared_ptr<cppress::sockets::connection> conn);
+
+    /**
+     * @brief Drops the parse state of a connection, if any
+     * @param conn Connection that was closed
+     *
+     * Called by the server when a connection closes so that its partial
+     * request and pipelined bytes do not outlive it.
+     */
+    void discard(std::shared_ptr<cppress::sockets::connection> conn);
+
+    /**
+     * @brief true while a connection has part of a request or pipelined bytes buffered
+     * @param conn Connection to check, from the event loop thread that owns it
+     */
+    bool in_request(const cppress::sockets::connection& conn);
+
+    /**
+     * @brief Install the selector that decides which request bodies are streamed
+     * @param selector Called with each head that announces a body, nullptr to buffer all
+     * @note Set before the server starts; see http_body.hpp
+     */
+    void set_body_stream_selector(http_body_stream_selector selector);
+
+    /**
+     * @brief Parse multipart bodies as they arrive
+     * @param selector Chooses each part's sink; nullptr turns multipart parsing off
+     * @note Set before the server starts; see http_multipart.hpp
+     */
+    void set_multipart_sink_selector(multipart_sink_selector selector);
+
+private:
+    /**
+     * @brief Parse state of a connection, created or reset on first use
+     * @param conn Connection to look up
+     * @return State owned by the table, stable until discard()
+     * @throws std::runtime_error for a descriptor beyond the table
+     */
+    http_parse_state& state_for(const cppress::sockets::connection& conn);
+
+    /**
+     * @brief Slot of a descriptor
+     * @param create Allocate the page holding it if needed
+     * @return nullptr beyond the table, or when the page is missing and create is false
+     */
+    std::unique_ptr<http_parse_state>* slot_for(int fd, bool create);
+
     /**
      * @brief Continue parsing an incomplete request
      * @param state Existing parsing state for this connection
      * @param data Additional data received from socket
      * @return http_parse_result indicating if request is now complete
      *
-     * Appends new data to existing body buffer and checks if expected
-     * Content-Length has been reached.
+     * Resumes an incomplete head, or appends new data to existing body
+     * buffer and checks if expected Content-Length has been reached.
      */
     http_parse_result continue_parsing(http_parse_state& state,
                                        const cppress::sockets::data_buffer& data);
 
     /**
      * @brief Start parsing a new HTTP request
-     * @param connection_id Unique identifier for this connection
+     * @param state Parsing state of the connection, idle
      * @param data Raw HTTP request data
-     * @param socket_fd File descriptor of the socket
      * @return http_parse_result with parsed request components
      *
-     * Parses request line and headers, then determines parsing strategy
+     * Scans request line and headers in place, then determines parsing strategy
      * based on Content-Length or chunked encoding (if supported).
-     * If body is incomplete, stores state in pending_requests_.
+     * If the head or the body is incomplete, keeps it in state.
      */
-    http_parse_result begin_parsing(const std::string& connection_id,
-                                    const cppress::sockets::data_buffer& data, int socket_fd);
+    http_parse_result begin_parsing(http_parse_state& state,
+                                    const cppress::sockets::data_buffer& data);
 
     /**
-     * @brief Remove idle connections that exceed timeout
-     * @param max_idle_time Maximum time connection can be idle
-     * @param close_connection Callback to close timed-out connections
-     *
-     * Iterates through pending_requests_ and closes any connections
-     * that have been idle longer than max_idle_time. Should be called
-     * periodically by the server (e.g., during idle loop).
-     */
-    void cleanup_idle_connections(std::chrono::seconds max_idle_time,
-                                  std::function<void(int)> close_connection);
-
-private:
-    /**
-     * @brief Parse the HTTP request line (first line of request)
-     * @param request_stream Input stream containing HTTP request
-     * @param method Output: HTTP method (GET, POST, etc.)
-     * @param uri Output: Request URI
-     * @param version Output: HTTP version
-     * @return Pair of (success, error_message)
+     * @brief Turns a complete or failed head into a result
+     * @param state Parsing state of the connection
+     * @param head Parser that scanned the head
+     * @param input Buffer the head was scanned from, followed by the body bytes received so far
+     * @return http_parse_result with parsed request components
      *
-     * Validates format: "METHOD URI VERSION\r\n"
-     * Returns false if format is invalid.
+     * Applies the body strategy from Content-Length / Transfer-Encoding; a
+     * body still on its way is kept in state, bytes past the request go to
+     * the backlog.
      */
-    std::pair<bool, std::string> parse_request_line(std::istringstream& request_stream,
-                                                    std::string& method, std::string& uri,
-                                                    std::string& version);
+    http_parse_result finish_head(http_parse_state& state, const http_head_parser& head,
+                                  const cppress::sockets::data_buffer& input);
 
     /**
-     * @brief Parse HTTP headers from request stream
-     * @param request_stream Input stream positioned after request line
-     * @param uri Request URI (unused, kept for future validation)
-     * @param version HTTP version (unused, kept for future validation)
-     * @return Pair of (success, headers_multimap)
-     *
-     * Parses headers until blank line (CRLF CRLF) is encountered.
-     * Header names are normalized to uppercase for case-insensitive access.
-     * Validates total header size against MAX_HEADER_SIZE.
+     * @brief Check if Transfer-Encoding ends with the chunked coding
+     * @param headers Parsed request headers
+     * @return true if chunked is the final coding, listed once; a request with
+     *         any other Transfer-Encoding is refused with BAD_TRANSFER_ENCODING
      */
-    std::pair<bool, std::multimap<std::string, std::string>> parse_headers(
-        std::istringstream& request_stream, const std::string& uri, const std::string& version);
+    bool has_chunked_encoding(const http_headers& headers);
 
     /**
-     * @brief Check if Transfer-Encoding contains "chunked"
-     * @param range Iterator pair for Transfer-Encoding header values
-     * @return true if chunked encoding is specified
-     *
-     * Helper function to detect chunked transfer encoding in headers.
+     * @brief Check if an HTTP/1.1 client waits for 100 Continue before sending its body
+     * @param headers Parsed request headers
+     * @param version Request HTTP version
+     * @return true if Expect holds "100-continue"
      */
-    bool has_chunked_encoding(
-        const std::pair<std::multimap<std::string, std::string>::iterator,
-                        std::multimap<std::string, std::string>::iterator>& range);
+    bool expects_continue(const http_headers& headers, const std::string& version);
 
     /**
      * @brief Handle request with Content-Length body
-     * @param connection_id Connection identifier
-     * @param request_stream Stream positioned at start of body
+     * @param state Parsing state of the connection
+     * @param input Buffer holding the head and the body bytes received so far
+     * @param body_offset Offset of the first body byte in input
      * @param method HTTP method
      * @param uri Request URI
      * @param version HTTP version
-     * @param headers Parsed request headers
+     * @param headers Parsed request headers, moved into state
      * @param content_length Expected body size in bytes
-     * @param socket_fd Socket file descriptor
      * @return http_parse_result with completion status
      *
-     * Reads available body data from stream. If complete body is available,
-     * returns is_complete=true. Otherwise stores state and returns is_complete=false.
+     * Takes the body bytes received so far. If complete body is available,
+     * returns is_complete=true and keeps any bytes after it as the next
+     * request. Otherwise stores state and returns is_complete=false.
      * Validates content_length against MAX_BODY_SIZE before buffering.
      */
     http_parse_result parse_content_length_body(
-        const std::string& connection_id, std::istringstream& request_stream,
-        const std::string& method, const std::string& uri, const std::string& version,
-        const std::multimap<std::string, std::string>& headers, size_t content_length,
-        int socket_fd);
+        http_parse_state& state, const cppress::sockets::data_buffer& input,
+        std::size_t body_offset, const std::string& method, const std::string& uri,
+        const std::string& version, http_headers headers, size_t content_length);
+
+    /**
+     * @brief Decode the next part of a chunked body
+     * @param state Parsing state of the connection, reading a chunked body
+     * @param data Bytes that follow the head, or the next read
+     * @return http_parse_result, complete once the last chunk and trailers are in
+     *
+     * Decoded runs are kept as slices of data, not copied, until the body
+     * is complete. Trailer fields join the request headers; bytes after the
+     * body are kept as the next request.
+     */
+    http_parse_result decode_chunked_body(http_parse_state& state,
+                                          const cppress::sockets::data_buffer& data);
 
     /**
      * @brief Continue accumulating body for Content-Length request
@@ -184,11 +264,47 @@ private:
      * @param data New data chunk received
      * @return http_parse_result indicating if body is now complete
      *
-     * Appends data to existing body and checks if expected
-     * Content-Length has been reached.
+     * Appends data to existing body up to the expected Content-Length;
+     * the rest of the chunk is kept as the next request.
      */
     http_parse_result accumulate_body_data(http_parse_state& state,
                                            const cppress::sockets::data_buffer& data);
+
+    /**
+     * @brief Decide where the body of the request in state goes
+     * @param state Parsing state with the head filled in
+     * @param expected_length Announced Content-Length, 0 for chunked bodies
+     *
+     * Asks the body stream selector first; otherwise a body announced above
+     * config::BODY_SPILL_THRESHOLD gets a spool right away.
+     */
+    void select_body_receiver(http_parse_state& state, std::size_t expected_length);
+
+    /**
+     * @brief Hand one run of body bytes to the stream, the spool, or memory
+     * @param state Parsing state reading a body
+     * @param run Body bytes, a slice of the read they arrived in
+     * @return false if the body is now over its limit
+     *
+     * Moves a buffered body into a spool when it crosses the spill threshold.
+     */
+    bool take_body(http_parse_state& state, const cppress::sockets::data_buffer& run);
+
+    /**
+     * @brief Build the result of a request whose body is complete
+     * @param state Parsing state, left idle
+     * @param rest Bytes after the body, kept for parse_next()
+     */
+    http_parse_result finish_body(http_parse_state& state, cppress::sockets::data_buffer rest);
+
+    /**
+     * @brief Keeps the bytes after a complete request for parse_next()
+     * @param state Parsing state of the connection
+     * @param rest Bytes that followed the request, possibly empty
+     * @param result Result of the complete request, has_next is set on it
+     */
+    static void keep_rest(http_parse_state& state, cppress::sockets::data_buffer rest,
+                          http_parse_result& result);
 };
 
 }  // namespace cppress::http
@@ -14,6 +14,13 @@
  * - Default 200 OK status with HTTP/1.1
  * - Support for standard and custom headers
  * - Trailer support (headers sent after body)
+ * - Streaming with chunked Transfer-Encoding: begin_stream(), write_chunk(),
+ *   end_stream()
+ * - Server-Sent Events with begin_event_stream(), see http_event_stream.hpp
+ * - Files and byte ranges of them (206, multipart/byteranges, If-Range) with
+ *   send_file(), written from the page cache with sendfile
+ * - Conditional GET: a 200 whose ETag or Last-Modified matches the request's
+ *   If-None-Match or If-Modified-Since is sent as 304 Not Modified
  * - Automatic Content-Length calculation
  * - Header name normalization (case-insensitive)
  * - Validation before sending
@@ -42,6 +49,21 @@
  * res.send();
  * res.end();
  * @endcode
+ * @example Streaming Response
+ * @code
+ * res.add_header("Content-Type", "text/csv");
+ * res.begin_stream();           // status line and headers go out now
+ * for (auto& row : report)
+ *     res.write_chunk(to_csv(row));
+ * res.add_trailer("X-Row-Count", std::to_string(report.size()));
+ * res.end_stream();             // last chunk and trailers
+ * @endcode
+ * @example File Response
+ * @code
+ * res.add_header("Content-Type", "video/mp4");
+ * res.add_header("ETag", "\"v42\"");
+ * res.send_file(cppress::sockets::file_region::open("media/intro.mp4"), req.get_header_fields());
+ * @endcode
  * @note All Headers are sent in UPPERCASE format
  * @note Always call send() before end() to transmit the response
  * @note After calling end(), the response object should not be used further
@@ -56,8 +78,14 @@
 
 #include <functional>
 #include <map>
+#include <memory>
+#include <string>
+#include <vector>
 
+#include "http_compression.hpp"
 #include "http_consts.hpp"
+#include "http_event_stream.hpp"
+#include "sockets/includes/output_chain.hpp"
 namespace cppress::http {
 /**
  * @brief Represents an HTTP response with move-only semantics.
@@ -100,8 +128,75 @@ private:
     /// what to close)
     std::function<void()> close_connection;
 
-    /// Function to send a message to the client
-    std::function<void(const std::string&)> send_message;
+    /// Function to send a message to the client; the segments are written back to back
+    /// (usually in one writev call) without being concatenated. `last` is true when the
+    /// response is complete after them
+    std::function<void(std::vector<std::string>&&, bool last)> send_message;
+
+    /// Like send_message, for output that includes file regions; when unset the
+    /// regions are read into memory and passed to send_message
+    std::function<void(std::vector<cppress::sockets::output_segment>&&, bool last)> send_segments;
+
+    /// Keeps alive what the three functions above point to; they capture plain
+    /// pointers so that they fit std::function's inline storage
+    std::shared_ptr<void> connection_owner;
+
+    /// Reports backpressure and closure of the connection to event streams, may be empty
+    std::function<output_state()> connection_state;
+
+    /// begin_stream() was called and end_stream() not yet
+    bool streaming = false;
+
+    /// Coding requested with set_compression(), identity if none
+    content_coding coding = content_coding::identity;
+
+    /// Encoder level for coding
+    int compression_level = DEFAULT_COMPRESSION_LEVEL;
+
+    /// Bodies smaller than this are sent as they are
+    std::size_t compression_min_size = 0;
+
+    /// Encoder of a compressed streamed response
+    std::unique_ptr<http_compressor> compressor;
+
+    /// If-None-Match and If-Modified-Since of a GET or HEAD request, empty otherwise
+    std::string if_none_match;
+    std::string if_modified_since;
+
+    /// Keeps the request's conditional headers when the method is GET or HEAD
+    void capture_preconditions(const std::string& method, const http_headers& request_headers);
+
+    /**
+     * @brief Turns a 200 into a bodiless 304 when is_not_modified()
+     * @return true if the response became a 304
+     */
+    bool apply_not_modified();
+
+    /**
+     * @brief Whether the body about to be sent should be encoded with coding
+     * @param body_size Size of the body, ignored for streamed responses
+     */
+    bool should_compress(bool stream, std::size_t body_size) const;
+
+    /// Sets Content-Encoding and Vary, and weakens a strong ETag
+    void mark_compressed();
+
+    /// Writes segments through send_segments, or send_message without it
+    void send_output(std::vector<cppress::sockets::output_segment>&& segments, bool last);
+
+    /**
+     * @brief Serialize the status line and headers, including the blank line.
+     * @return The response head, without the body
+     */
+    std::string head_to_string() const;
+
+    /**
+     * @brief Stored (upper-case) form of a header name
+     * @param name Header name in any case
+     * @return The well-known spelling from a static table, or the name upper-cased
+     */
+    static std::string header_name(const std::string& name);
+
     /**
      * @brief Validate the response before sending.
      * @return true if response is valid, false otherwise
@@ -116,19 +211,34 @@ private:
      * @param version HTTP version
      * @param headers Initial headers
      * @param close_connection Function to close the associated connection
+     * @param send_message Function that writes response bytes
+     * @param send_segments Function that writes file regions as well, may be empty
      *
      * This constructor is private and can only be called by the http_server
      * class to ensure proper response object creation and lifecycle management.
      */
-    http_response(const std::string& version,
-                  const std::multimap<std::string, std::string>& headers,
-                  std::function<void()> close_connection,
-                  std::function<void(const std::string&)> send_message);
+    http_response(
+        const std::string& version, const std::multimap<std::string, std::string>& headers,
+        std::function<void()> close_connection,
+        std::function<void(std::vector<std::string>&&, bool)> send_message,
+        std::function<void(std::vector<cppress::sockets::output_segment>&&, bool)> send_segments =
+            nullptr);
 
 public:
     /// Allow http_server to access private constructor
     friend class http_server;
 
+    /**
+     * @brief A response written to a function instead of a connection.
+     * @param sink Receives the serialized bytes as they are sent, last set on the final write
+     * @param on_end Called when the response is ended
+     *
+     * For running handlers without a client, e.g. to fill a cache with
+     * their output. The bytes are those an HTTP/1.1 client would get.
+     */
+    static http_response detached(std::function<void(std::vector<std::string>&&, bool)> sink,
+                                  std::function<void()> on_end);
+
     // Copy operations - DELETED for resource safety
     /**
      * @brief Copy constructor - DELETED.
@@ -242,15 +352,81 @@ public:
      * @brief Send the HTTP response.
      *
      * This function sends the constructed HTTP response back to the client
-     * over the established socket connection.
+     * over the established socket connection. A 200 for which
+     * is_not_modified() holds is sent as 304 Not Modified without its body.
      */
     void send();
 
+    /**
+     * @brief Whether the request already holds the representation described so far
+     * @return true for a GET or HEAD whose If-None-Match names the ETag
+     *         header, or, without If-None-Match, whose If-Modified-Since is not
+     *         older than the Last-Modified header (see not_modified())
+     *
+     * Lets a handler skip producing a body: set the validators, and if this
+     * is true call send() right away.
+     */
+    bool is_not_modified() const;
+
+    /**
+     * @brief Send a file, or the byte ranges of it the request asked for.
+     * @param file Region to send, usually file_region::open(path)
+     * @param request_headers Headers of the request; Range and If-Range are honoured
+     *
+     * With a 200 status and a satisfiable Range the response becomes 206
+     * Partial Content, one range with Content-Range, several as
+     * multipart/byteranges parts typed with the Content-Type set so far. An
+     * unsatisfiable Range gets 416. If-Range is compared with the ETag and
+     * Last-Modified headers already added; a mismatch sends the whole file.
+     * Accept-Ranges and Content-Length are set, the body set with
+     * set_body() is ignored and no compression is applied. Over HTTP/1.1
+     * the file bytes go out with sendfile and are never copied. When
+     * is_not_modified() holds a 304 is sent and the file is not touched.
+     */
+    void send_file(const cppress::sockets::file_region& file, const http_headers& request_headers);
+
+    /**
+     * @brief Send the response with a body held in a shared buffer.
+     * @param body Bytes of the body; queued by reference, never copied
+     *
+     * For bodies many responses share, like cached static files. Content-Length
+     * is set, the body set with set_body() is ignored and no compression is
+     * applied. When is_not_modified() holds a 304 is sent instead.
+     */
+    void send_buffer(const cppress::sockets::data_buffer& body);
+
+    /**
+     * @brief Send the response with a body built for it alone.
+     * @param body Bytes of the body, moved in and queued without a copy
+     *
+     * For bodies serialized per response, like JSON. Content-Length is set
+     * and the body set with set_body() is replaced. When set_compression()
+     * applies, the body is compressed as send() does; when is_not_modified()
+     * holds a 304 is sent instead.
+     */
+    void send_body(std::string&& body);
+
+    /**
+     * @brief Send a complete response serialized ahead of time.
+     * @param message Status line, headers, blank line and body; queued by reference
+     *
+     * For canned answers built once and sent many times, like the 503 of
+     * an overloaded server. Status, headers and body set on this object are
+     * ignored, and nothing is checked or compressed.
+     */
+    void send_serialized(const cppress::sockets::data_buffer& message);
+
+    /**
+     * @brief Send a complete response serialized ahead of time, in pieces.
+     * @param parts Written back to back, each queued by reference
+     */
+    void send_serialized(std::vector<cppress::sockets::data_buffer>&& parts);
+
     /**
      * @brief Clear all values for a specific header.
      * @param name Header name
      */
-    void clear_header_values(const std::string& name) { headers.erase(name); }
+    void clear_header_values(const std::string& name) { headers.erase(header_name(name)); }
 
     /**
      * @brief Send the HTTP trailers.
@@ -261,6 +437,76 @@ public:
 
     void send_trailers();
 
+    /**
+     * @brief Start a streamed response with chunked Transfer-Encoding.
+     *
+     * Sends the status line and headers right away, with Transfer-Encoding:
+     * chunked instead of Content-Length, and a Trailer header naming the
+     * trailers added so far. The body set with set_body(), if any, is ignored.
+     *
+     * @throws std::runtime_error if the response is already streaming
+     */
+    void begin_stream();
+
+    /**
+     * @brief Send one chunk of a streamed response.
+     * @param data Chunk bytes, moved into the connection's output queue
+     *
+     * Empty chunks are skipped: a zero-size chunk would end the body.
+     * @throws std::runtime_error unless begin_stream() was called
+     */
+    void write_chunk(std::string data);
+
+    /**
+     * @brief Send one chunk of a streamed response, sharing its bytes.
+     * @param data Chunk bytes, e.g. a cached fragment; queued by reference,
+     *        only copied when the chunk is compressed or the connection
+     *        cannot queue buffers (HTTP/2)
+     * @throws std::runtime_error unless begin_stream() was called
+     */
+    void write_chunk(cppress::sockets::data_buffer data);
+
+    /**
+     * @brief Finish a streamed response.
+     * @param extra_trailers Trailers to send besides those added with add_trailer()
+     *
+     * Sends the last chunk and the trailer section; the response is then
+     * complete and a pipelined response queued behind it may follow.
+     * @throws std::runtime_error unless begin_stream() was called
+     */
+    void end_stream(const std::multimap<std::string, std::string>& extra_trailers = {});
+
+    /// @brief true between begin_stream() and end_stream()
+    bool is_streaming() const { return streaming; }
+
+    /**
+     * @brief Start a text/event-stream response and hand it to a subscriber
+     * @return The stream's writing end, usable from any thread after the callback returns
+     *
+     * Sends the head right away with Content-Type: text/event-stream and
+     * Cache-Control: no-cache, uncompressed so that events can be shared
+     * between connections (see sse_channel). The response object itself
+     * should not be used afterwards.
+     * @throws std::runtime_error if the response is already streaming
+     */
+    std::shared_ptr<sse_subscriber> begin_event_stream();
+
+    /**
+     * @brief Compress the body with a content coding when it is sent
+     * @param coding Coding, usually from negotiate_content_coding(); identity turns it off
+     * @param level Encoder level, DEFAULT_COMPRESSION_LEVEL for the coding's default
+     * @param min_size Bodies smaller than this are sent as they are (streams always qualify)
+     *
+     * send() and begin_stream() then encode the body, or each chunk, unless
+     * the coding is not compiled in, a Content-Encoding is already set, the
+     * Content-Type is not compressible (see compressible_content_type()), or
+     * the status has no body (1xx, 204, 304). Content-Length is rewritten to
+     * the encoded size; streamed chunks are flushed so that every
+     * write_chunk() reaches the client on its own.
+     */
+    void set_compression(content_coding coding, int level = DEFAULT_COMPRESSION_LEVEL,
+                         std::size_t min_size = 0);
+
     /// Default destructor
     ~http_response() = default;
 };
@@ -0,0 +1,155 @@
+/**
+ * @file http_response_sequencer.hpp
+ * @brief Keeps the responses of a pipelined connection in request order
+ *
+ * HTTP/1.1 pipelining lets a client send several requests without waiting
+ * for responses, and requires the responses in the same order. Handlers
+ * may run on worker threads and finish out of order, so the server gives
+ * each request a slot and writes through this sequencer: the oldest
+ * unfinished response streams straight to the connection, later ones are
+ * buffered until every response before them is complete.
+ *
+ * @note This is an internal implementation detail used by http_server
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "sockets/includes/output_chain.hpp"
+
+namespace cppress::http {
+
+/**
+ * @class http_response_sequencer
+ * @brief Orders the output of one connection's responses
+ *
+ * Slots are opened on the event loop thread in request order; write() and
+ * close() may be called from any thread.
+ */
+class http_response_sequencer {
+public:
+    /// Queues memory and file segments on the connection
+    using send_function = std::function<void(std::vector<cppress::sockets::output_segment>&&)>;
+
+    /// Closes the connection once queued bytes are written
+    using close_function = std::function<void()>;
+
+    /**
+     * @brief Construct a sequencer for one connection
+     * @param send Writes to the connection
+     * @param close Closes the connection
+     */
+    http_response_sequencer(send_function send, close_function close);
+
+    /**
+     * @brief Reserve the slot of the next request
+     * @return Slot to pass to write() and close()
+     */
+    std::uint64_t open();
+
+    /**
+     * @brief Write a response, or part of a streamed one
+     * @param slot Slot of the request being answered
+     * @param parts Response bytes
+     * @param last true if the response is complete after these bytes
+     *
+     * Bytes of a slot already complete (e.g. trailers after send()) are
+     * passed through.
+     */
+    void write(std::uint64_t slot, std::vector<std::string>&& parts, bool last);
+
+    /**
+     * @brief Write a response whose output includes file regions
+     * @param slot Slot of the request being answered
+     * @param segments Memory and file segments, sent in order
+     * @param last true if the response is complete after these segments
+     */
+    void write(std::uint64_t slot, std::vector<cppress::sockets::output_segment>&& segments,
+               bool last);
+
+    /**
+     * @brief Close the connection after a response
+     * @param slot Slot of the request whose response ends the connection
+     *
+     * Responses of later slots are dropped: the client sees the close
+     * right after this response. A streamed response in progress is
+     * finished first.
+     */
+    void close(std::uint64_t slot);
+
+    /**
+     * @brief true if every slot opened so far is completely written
+     *
+     * The connection can then change protocol (e.g. to WebSocket) without
+     * interleaving with a response still in progress.
+     */
+    bool idle();
+
+    /**
+     * @brief Record whether the connection's queued output is above the write high watermark
+     * @note Called by the server from on_backpressure()
+     */
+    void set_congested(bool congested) { congested_.store(congested, std::memory_order_relaxed); }
+
+    /// @brief true while the connection's queued output is above the write high watermark
+    bool congested() const { return congested_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief The connection closed; later writes are dropped
+     * @note Unlike close(), does not call the close function
+     */
+    void disconnect();
+
+    /// @brief true once the connection was closed or disconnect() was called
+    bool is_closed();
+
+private:
+    /// Output of a response that is waiting for earlier ones
+    struct pending_response {
+        std::vector<cppress::sockets::output_segment> parts;
+        bool complete = false;
+        bool close = false;
+    };
+
+    send_function send_;
+    close_function close_;
+
+    /// Guards everything below; held while sending so that output keeps its order
+    std::mutex mutex_;
+
+    /// Slot the next request gets
+    std::uint64_t next_slot_ = 0;
+
+    /// Oldest slot whose response is not complete, its output goes straight out
+    std::uint64_t front_ = 0;
+
+    /// The front response is streamed and partly written
+    bool front_open_ = false;
+
+    /// close() came for the front response while it was streaming
+    bool close_front_ = false;
+
+    /// Written or closing responses of slots after front_
+    std::map<std::uint64_t, pending_response> waiting_;
+
+    /// The connection was closed, nothing more is written
+    bool closed_ = false;
+
+    /// Set from the event loop, read by writers deciding whether to skip output
+    std::atomic<bool> congested_{false};
+
+    /// Sends the waiting responses that are now at the front
+    void drain_locked();
+
+    /// Closes the connection and drops whatever is waiting
+    void close_locked();
+};
+
+}  // namespace cppress::http
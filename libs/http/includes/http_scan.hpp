@@ -0,0 +1,63 @@
+/**
+ * @file http_scan.hpp
+ * @brief Vectorized delimiter scans used by http_head_parser
+ *
+ * Each scan returns the offset of the first byte in [from, n) that ends a
+ * run of one kind of HTTP syntax element, n if the run reaches the end.
+ * The fastest implementation the CPU supports is picked once at startup:
+ * AVX2 or SSE4.2 on x86-64, NEON on AArch64, a table-driven scalar loop
+ * otherwise. Every implementation returns the same offsets.
+ *
+ * @note This is an internal implementation detail used by http_head_parser
+ */
+
+#pragma once
+
+#include <cstddef>
+
+namespace cppress::http::scan {
+
+/// Instruction set a scan implementation relies on
+enum class level { scalar, sse42, avx2, neon };
+
+/**
+ * @brief First byte that is not a token character (RFC 9110 tchar)
+ *
+ * Ends methods and header field names.
+ */
+std::size_t token_end(const char* p, std::size_t from, std::size_t n) noexcept;
+
+/**
+ * @brief First space or control character (0x00-0x20, 0x7f)
+ *
+ * Ends the request target and the HTTP version.
+ */
+std::size_t target_end(const char* p, std::size_t from, std::size_t n) noexcept;
+
+/**
+ * @brief First control character other than horizontal tab
+ *
+ * Ends header field values: normally the CR or LF of the line ending, any
+ * other hit is an invalid byte.
+ */
+std::size_t value_end(const char* p, std::size_t from, std::size_t n) noexcept;
+
+/// @brief Implementation the scans currently use
+level active() noexcept;
+
+/// @brief Best implementation supported by this CPU
+level best() noexcept;
+
+/**
+ * @brief Switches the scans to another implementation
+ * @param l Level to use, ignored unless this CPU supports it
+ * @return true if the level is now active
+ *
+ * Meant for benchmarks and tests comparing implementations; not
+ * thread-safe against concurrent scans.
+ */
+bool use(level l) noexcept;
+
+/// @brief Name of a level, e.g. "avx2"
+const char* name(level l) noexcept;
+}  // namespace cppress::http::scan
@@ -20,12 +20,15 @@
  * Key features:
  * - Full HTTP/1.1 parsing (RFC 2616/7230 compliant)
  * - Support for all standard HTTP methods (GET, POST, PUT, DELETE, etc.)
- * - Content-Length based body handling
+ * - Content-Length and chunked bodies, optionally streamed or spilled to disk
+ * - Persistent connections and pipelining, responses are written in request order
+ * - HTTP/2 with prior knowledge or h2c upgrade, streams multiplexed on one connection
+ * - WebSocket upgrade, frames parsed on the event loop with permessage-deflate
  * - Configurable size limits and timeouts
  * - Multiple concurrent connections via epoll (Linux) or select (cross-platform)
  * - Thread-safe request handling (when used with thread pool)
  * - Automatic connection lifecycle management
- * - Idle connection cleanup
+ * - Idle, header-read and body-read deadlines on the event loop's timer wheel
  * - Comprehensive callback system for all server events
  *
  * How to use:
@@ -54,7 +57,6 @@
  * server.listen();  // Blocks here
  * @endcode
  *
- * @note The server currently uses "Connection: close" for all responses
  * @note Request/response objects are move-only and callback-scoped
  * @note For production use, consider running behind a reverse proxy (nginx)
  *       for SSL/TLS, load balancing, and static file serving
@@ -64,13 +66,21 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
+#include "http2_connection.hpp"
 #include "http_consts.hpp"
 #include "http_request.hpp"
 #include "http_request_parser.hpp"
 #include "http_response.hpp"
+#include "http_response_sequencer.hpp"
 #include "sockets/includes.hpp"
+#include "websocket_connection.hpp"
 
 namespace cppress::http {
 /**
@@ -88,7 +98,8 @@ namespace cppress::http {
  *
  * 2-   Extend the http_server and override virtual methods to customize behavior.
  *
- * @note Currently implements HTTP/1.1 with "Connection: close" semantics
+ * @note Connections stay open until a response calls end(); pipelined requests
+ *       are answered in the order they arrived
  * @note Supports GET, POST, and other HTTP methods through generic parsing
  * @note Thread-safe through underlying tcp_server implementation
  * @note Move-only design prevents accidental copying of server resources
@@ -101,9 +112,136 @@ private:
     /// Timeout for client connections in milliseconds
     int timeout_milliseconds;
 
-    /// Shared pointer to the server socket
+    /// Shared pointer to the server socket (listener of reactor 0)
     std::shared_ptr<cppress::sockets::socket> server_socket;
 
+    /// SO_REUSEPORT listeners of the remaining reactors in multi-reactor mode
+    std::vector<std::shared_ptr<cppress::sockets::socket>> reactor_sockets;
+
+    /// Connections paused by write backpressure, with the input read before the
+    /// pause took effect; replayed in order when the connection resumes
+    std::unordered_map<const cppress::sockets::connection*,
+                       std::vector<cppress::sockets::data_buffer>>
+        paused_;
+
+    /// Guards paused_, shared by every reactor thread
+    std::mutex paused_mutex_;
+
+    /// Number of entries in paused_, lets unpaused traffic skip the lock
+    std::atomic<std::size_t> paused_count_{0};
+
+    /// Response ordering of each connection that has received a request
+    std::unordered_map<const cppress::sockets::connection*,
+                       std::shared_ptr<http_response_sequencer>>
+        sequencers_;
+
+    /// Guards sequencers_, shared by every reactor thread
+    std::mutex sequencers_mutex_;
+
+    /// HTTP/2 state of connections that switched to it
+    std::unordered_map<const cppress::sockets::connection*, std::shared_ptr<http2_connection>>
+        sessions_;
+
+    /// Guards sessions_, shared by every reactor thread
+    std::mutex sessions_mutex_;
+
+    /// WebSocket state of connections that were upgraded
+    std::unordered_map<const cppress::sockets::connection*,
+                       std::shared_ptr<websocket_connection>>
+        websockets_;
+
+    /// Guards websockets_, shared by every reactor thread
+    std::mutex websockets_mutex_;
+
+    /// Picks the handler of WebSocket handshakes, upgrades are refused while unset
+    websocket_selector websocket_selector_;
+
+    /// @brief WebSocket state of a connection, nullptr if it was not upgraded
+    std::shared_ptr<websocket_connection> websocket_for(const cppress::sockets::connection* conn);
+
+    /**
+     * @brief Answer a WebSocket handshake with 101 and hand the connection to its handler
+     * @param conn Connection the request arrived on
+     * @param result The handshake request
+     * @return true if the connection switched protocols
+     */
+    bool upgrade_to_websocket(const std::shared_ptr<cppress::sockets::connection>& conn,
+                              http_parse_result& result);
+
+    /// @brief HTTP/2 session of a connection, nullptr if it speaks HTTP/1.1
+    std::shared_ptr<http2_connection> session_for(const cppress::sockets::connection* conn);
+
+    /**
+     * @brief Create the HTTP/2 session of a connection
+     * @note The session holds the connection weakly, like the response sequencer
+     */
+    std::shared_ptr<http2_connection> make_session(
+        const std::shared_ptr<cppress::sockets::connection>& conn);
+
+    /**
+     * @brief Feed bytes to a connection's HTTP/2 session and dispatch the requests that completed
+     * @param conn Connection the bytes arrived on
+     * @param session Its session
+     * @param data Bytes read from the connection
+     */
+    void receive_http2(const std::shared_ptr<cppress::sockets::connection>& conn,
+                       const std::shared_ptr<http2_connection>& session, std::string_view data);
+
+    /**
+     * @brief Hand one HTTP/2 stream's request to the application
+     * @note The response is written in HTTP/1.1 form and framed by the session
+     */
+    void dispatch_http2(const std::shared_ptr<cppress::sockets::connection>& conn,
+                        const std::shared_ptr<http2_connection>& session, http2_request& request);
+
+    /**
+     * @brief Answer an h2c upgrade request with 101 and continue in HTTP/2
+     * @param conn Connection the request arrived on
+     * @param result The upgrade request, dispatched as stream 1
+     * @return true if the connection switched protocols
+     */
+    bool upgrade_to_http2(const std::shared_ptr<cppress::sockets::connection>& conn,
+                          http_parse_result& result);
+
+    /**
+     * @brief Hand one parse result to the application
+     * @param conn Connection the request arrived on
+     * @param result Result of http_request_parser::parse() or parse_next(), its headers and
+     *        body are moved into the request
+     * @param read_at When the read holding the request came in, unset if not timestamped
+     * @return true if a complete request was dispatched
+     */
+    bool dispatch_request(const std::shared_ptr<cppress::sockets::connection>& conn,
+                          http_parse_result& result,
+                          std::chrono::steady_clock::time_point read_at);
+
+    /**
+     * @brief Answer Expect: 100-continue before the body is read
+     * @param conn Connection the request arrived on
+     * @param result First incomplete result of the request, its headers are moved out
+     * @return true if the client was told to continue, false if the request was refused
+     *         and the connection is closing
+     */
+    bool answer_expectation(const std::shared_ptr<cppress::sockets::connection>& conn,
+                            http_parse_result& result);
+
+    /**
+     * @brief Answer a request that could not be parsed with a BAD_REQUEST request
+     * @param conn Connection the request arrived on
+     * @note Stops reading from the connection
+     */
+    void reject_request(const std::shared_ptr<cppress::sockets::connection>& conn);
+
+    /**
+     * @brief Response ordering of a connection, created on its first request
+     * @param conn Connection to look up
+     */
+    std::shared_ptr<http_response_sequencer> sequencer_for(
+        const std::shared_ptr<cppress::sockets::connection>& conn);
+
+    /// @brief true once a connection dispatched an HTTP/1.1 request
+    bool has_sequencer(const cppress::sockets::connection* conn);
+
     /// Callback for handling HTTP requests and generating responses
     std::function<void(http_request&, http_response&)> request_callback;
 
@@ -127,11 +265,18 @@ private:
 
     /// Callback triggered when HTTP headers are received
     std::function<void(std::shared_ptr<cppress::sockets::connection>,
-                       const std::multimap<std::string, std::string>&, const std::string&,
+                       const http_headers&, const std::string&,
                        const std::string&, const std::string&, const std::string&)>
         headers_received_callback;
 
+    /// Callback deciding on requests sent with Expect: 100-continue
+    std::function<bool(http_request&, http_response&)> expect_continue_callback;
+
 protected:
+    /// Stamp HTTP/1.1 requests with the time of the read that completed them, see
+    /// http_request::get_received_at(); costs a clock read per read when set
+    bool timestamp_requests = false;
+
     /**
      * @brief Parse HTTP request and invoke user callback.
      * @param conn Client connection that sent the request
@@ -140,7 +285,8 @@ protected:
      * @throws std::runtime_error for Content-Length validation errors
      * @note Automatically closes connection on empty messages
      * @note Handles HTTP/1.1 request parsing including headers and body
-     * @note calles on_request_received() for further processing
+     * @note calles on_request_received() once per request, for each pipelined
+     *       request of the read in turn
      */
     void on_message_received(std::shared_ptr<cppress::sockets::connection> conn,
                              const cppress::sockets::data_buffer& message) override;
@@ -185,6 +331,35 @@ protected:
      */
     virtual void on_waiting_for_activity() override;
 
+    /**
+     * @brief Stop or resume dispatching a connection's requests
+     * @param conn Connection whose queued responses crossed a write watermark
+     * @param paused true when reading paused, false when it resumed
+     * @note Requests read while paused are held back and dispatched on resume
+     */
+    virtual void on_backpressure(std::shared_ptr<cppress::sockets::connection> conn,
+                                 bool paused) override;
+
+    /**
+     * @brief Handle a connection deadline
+     * @param conn Connection whose deadline expired
+     * @param which Deadline that expired
+     * @note The body deadline of a WebSocket connection times its ping/pong and
+     *       closing handshake; every other deadline closes the connection
+     */
+    virtual void on_deadline_expired(std::shared_ptr<cppress::sockets::connection> conn,
+                                     cppress::sockets::connection_deadline which) override;
+
+    /**
+     * @brief Whether drain() may close a connection now
+     * @param conn Connection still open while draining
+     * @return true between requests: nothing buffered, every response written and no
+     *         HTTP/2 stream open. Connections that have not sent a request yet are left
+     *         to the header deadline, WebSocket connections to the drain timeout
+     * @note While draining, responses to the requests that arrive close their connection
+     */
+    bool connection_idle(const std::shared_ptr<cppress::sockets::connection>& conn) override;
+
     /**
      * @brief Handle HTTP request processing.
      * @param request Parsed HTTP request object
@@ -193,6 +368,14 @@ protected:
      */
     virtual void on_request_received(http_request& request, http_response& response);
 
+    /**
+     * @brief Speak HTTP/2 on a connection from its first byte
+     * @param conn A connection that has not sent anything yet
+     * @note For connections that negotiated h2 out of band, e.g. through TLS ALPN;
+     *       clients with prior knowledge and h2c upgrades are detected on their own
+     */
+    void start_http2(const std::shared_ptr<cppress::sockets::connection>& conn);
+
     /**
      * @brief Handle HTTP headers received from the client.
      * @note this function is called when HTTP headers are received, it can be used to process
@@ -205,24 +388,39 @@ protected:
      * @param body Request body (if any)
      */
     virtual void on_headers_received(std::shared_ptr<cppress::sockets::connection> conn,
-                                     const std::multimap<std::string, std::string>& headers,
-                                     const std::string& method, const std::string& uri,
-                                     const std::string& version, const std::string& body) {
+                                     const http_headers& headers, const std::string& method,
+                                     const std::string& uri, const std::string& version,
+                                     const std::string& body) {
         if (headers_received_callback) {
             headers_received_callback(conn, headers, method, uri, version, body);
         }
     };
 
+    /**
+     * @brief Decide on a request that waits for 100 Continue before sending its body
+     * @param request The request line and headers, its body is empty
+     * @param response Final response to refuse the request with
+     * @return true to send 100 Continue and read the body; false after sending a final
+     *         response, usually a 4xx, in which case the body is never read and the
+     *         connection is closed
+     * @note Runs on the reactor thread, keep it to header checks
+     * @note Calls the expect continue callback if set, otherwise accepts
+     */
+    virtual bool on_expect_continue(http_request& request, http_response& response);
+
 public:
     /**
      * @brief Construct HTTP server bound to specified socket address.
      * @param addr Socket address (IP and port) to bind server to
      * @param timeout_milliseconds Timeout duration in milliseconds for epoll calls
+     * @param reactor_count Number of event loops, each with its own SO_REUSEPORT listener
      * @throws socket_exception for socket creation, binding, or listening errors
      * @note Inherits all TCP server functionality and error handling
+     * @note With reactor_count > 1 callbacks run concurrently on the reactor threads
      */
     explicit http_server(const cppress::sockets::socket_address& addr,
-                         int timeout_milliseconds = config::TIMEOUT_MILLISECONDS);
+                         int timeout_milliseconds = config::TIMEOUT_MILLISECONDS,
+                         std::size_t reactor_count = config::REACTOR_COUNT);
 
     /**
      * @brief Construct HTTP server with IP address and port.
@@ -233,11 +431,12 @@ public:
      * @note Defaults to IPv4 address family
      */
     explicit http_server(int port, const std::string& ip = "0.0.0.0",
-                         int timeout_milliseconds = config::TIMEOUT_MILLISECONDS)
+                         int timeout_milliseconds = config::TIMEOUT_MILLISECONDS,
+                         std::size_t reactor_count = config::REACTOR_COUNT)
         : http_server(cppress::sockets::socket_address(
                           cppress::sockets::port(port), cppress::sockets::ip_address(ip),
                           cppress::sockets::family(cppress::sockets::IPV4)),
-                      timeout_milliseconds) {}
+                      timeout_milliseconds, reactor_count) {}
 
     // Copy and move operations - DELETED for resource safety
     http_server(const http_server&) = delete;
@@ -310,18 +509,57 @@ public:
      * @brief Set the headers received callback object
      *
      * @param callback that is able to recive:
-     *      std::shared_ptr<cppress::sockets::sconnection> conn, const std::multimap<std::string,
-     * std::string> & headers, const std::string & method, const std::string & uri, const
-     * std::string & version, const std::string & body
+     *      std::shared_ptr<cppress::sockets::sconnection> conn, const http_headers & headers,
+     * const std::string & method, const std::string & uri, const std::string & version,
+     * const std::string & body
      */
     void set_headers_received_callback(
         std::function<void(std::shared_ptr<cppress::sockets::connection>,
-                           const std::multimap<std::string, std::string>&, const std::string&,
+                           const http_headers&, const std::string&,
                            const std::string&, const std::string&, const std::string&)>
             callback) {
         headers_received_callback = (callback);
     }
 
+    /**
+     * @brief Decide on requests sent with Expect: 100-continue before their body is read
+     * @param callback Returns true to let the client send the body, or sends a final
+     *        response and returns false to refuse it
+     */
+    void set_expect_continue_callback(std::function<bool(http_request&, http_response&)> callback) {
+        expect_continue_callback = std::move(callback);
+    }
+
+    /**
+     * @brief Accept WebSocket upgrades
+     * @param selector Sees each valid handshake and returns the endpoint's handler,
+     *        or nullptr to dispatch the request as plain HTTP
+     * @note Must be set before calling listen(); see websocket_connection.hpp
+     */
+    void set_websocket_selector(websocket_selector selector) {
+        websocket_selector_ = std::move(selector);
+    }
+
+    /**
+     * @brief Stream selected request bodies instead of buffering them
+     * @param selector Sees each request head that announces a body and returns the
+     *        stream to receive it, or nullptr to buffer it as usual
+     * @note Must be set before calling listen(); see http_body.hpp
+     */
+    void set_body_stream_selector(http_body_stream_selector selector) {
+        parser_.set_body_stream_selector(std::move(selector));
+    }
+
+    /**
+     * @brief Parse multipart bodies while they are read
+     * @param selector Chooses the sink of each part, returning nullptr to keep it in memory
+     * @note Must be set before calling listen(); bodies the body stream selector
+     *       takes are left to it. See http_multipart.hpp
+     */
+    void set_multipart_sink_selector(multipart_sink_selector selector) {
+        parser_.set_multipart_sink_selector(std::move(selector));
+    }
+
     /**
      * @brief Start listening for incoming HTTP requests.
      * @note just calls the epoll_server::listen() method.
@@ -0,0 +1,351 @@
+/**
+ * @file websocket_connection.hpp
+ * @brief Server side of one WebSocket connection (RFC 6455, RFC 7692)
+ *
+ * http_server hands a connection over once it answered the Upgrade with
+ * 101 Switching Protocols (see http_server::set_websocket_selector()).
+ * From then on the bytes read are fed to receive(), which parses frames
+ * incrementally straight from the receive buffers: a frame cut by the end
+ * of a read resumes with the next one, and the client's masking is undone
+ * while the payload is copied into the message, one pass over the bytes.
+ *
+ * Outgoing frames are never masked. Their header (2 to 10 bytes) is a
+ * segment of its own in front of the payload in the connection's output
+ * chain, so the payload is queued as it is, without a framing copy.
+ * permessage-deflate is used when the client offers it and zlib is
+ * compiled in.
+ *
+ * Ping/pong and the closing handshake are timed by the connection's body
+ * deadline on the reactor's timer wheel, see on_timer().
+ *
+ * @code
+ * auto chat = std::make_shared<websocket_handler>();
+ * chat->on_message = [](const std::shared_ptr<websocket_connection>& ws,
+ *                       websocket_message&& message) {
+ *     ws->send_text("echo: " + message.data);
+ * };
+ * server.set_websocket_selector([chat](const http_parse_result& head) {
+ *     return head.uri == "/chat" ? chat : nullptr;
+ * });
+ * @endcode
+ *
+ * @note This is an internal implementation detail used by http_server
+ */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "http_headers.hpp"
+#include "http_parse_result.hpp"
+#include "sockets/includes/data_buffer.hpp"
+
+namespace cppress::http {
+
+/// GUID appended to Sec-WebSocket-Key before hashing it into Sec-WebSocket-Accept
+constexpr std::string_view WEBSOCKET_GUID = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+/// @brief Opcodes of RFC 6455 section 5.2
+enum class websocket_opcode : std::uint8_t {
+    continuation = 0x0,
+    text = 0x1,
+    binary = 0x2,
+    close = 0x8,
+    ping = 0x9,
+    pong = 0xa
+};
+
+/// @brief Status codes of close frames, RFC 6455 section 7.4.1
+namespace websocket_close {
+constexpr std::uint16_t normal = 1000;
+constexpr std::uint16_t going_away = 1001;
+constexpr std::uint16_t protocol_error = 1002;
+constexpr std::uint16_t unsupported_data = 1003;
+/// Not sent: the close frame had no status code
+constexpr std::uint16_t no_status = 1005;
+/// Not sent: the connection ended without a closing handshake
+constexpr std::uint16_t abnormal = 1006;
+constexpr std::uint16_t invalid_payload = 1007;
+constexpr std::uint16_t policy_violation = 1008;
+constexpr std::uint16_t message_too_big = 1009;
+constexpr std::uint16_t internal_error = 1011;
+}  // namespace websocket_close
+
+/**
+ * @struct websocket_message
+ * @brief A complete, unfragmented and decompressed data message
+ */
+struct websocket_message {
+    /// text or binary
+    websocket_opcode opcode = websocket_opcode::text;
+    std::string data;
+
+    bool is_text() const { return opcode == websocket_opcode::text; }
+};
+
+class websocket_connection;
+
+/**
+ * @struct websocket_handler
+ * @brief Callbacks of the WebSocket connections of one endpoint
+ *
+ * Run on the event loop thread of the connection, they must not block;
+ * hand long work to a worker and answer with send_text() / send_binary(),
+ * which may be called from any thread.
+ */
+struct websocket_handler {
+    /// The 101 was sent, the connection may be written to
+    std::function<void(const std::shared_ptr<websocket_connection>&)> on_open;
+
+    /// A text or binary message arrived
+    std::function<void(const std::shared_ptr<websocket_connection>&, websocket_message&&)>
+        on_message;
+
+    /// The connection is gone; code is websocket_close::abnormal without a closing handshake
+    std::function<void(const std::shared_ptr<websocket_connection>&, std::uint16_t code,
+                       const std::string& reason)>
+        on_close;
+};
+
+/**
+ * @brief Chooses the handler of an Upgrade: websocket request
+ *
+ * Gets the request line and headers of a valid handshake and returns the
+ * endpoint's handler, or nullptr to dispatch the request as plain HTTP
+ * (which can then answer 404, 401, ...). Runs on the event loop thread.
+ */
+using websocket_selector =
+    std::function<std::shared_ptr<websocket_handler>(const http_parse_result& head)>;
+
+/**
+ * @struct websocket_deflate_options
+ * @brief permessage-deflate parameters agreed with the client
+ */
+struct websocket_deflate_options {
+    bool enabled = false;
+
+    /// Reset the compressor after each message the server sends
+    bool server_no_context_takeover = false;
+
+    /// The client resets its compressor after each message, so can the decompressor
+    bool client_no_context_takeover = false;
+
+    /// LZ77 window of the server's compressor, 9 to 15
+    int server_max_window_bits = 15;
+};
+
+/**
+ * @brief Sec-WebSocket-Accept for a Sec-WebSocket-Key
+ * @return base64 of the SHA-1 of the key followed by WEBSOCKET_GUID
+ */
+std::string websocket_accept_key(std::string_view key);
+
+/**
+ * @brief Reads a client's permessage-deflate offers
+ * @param headers Request headers; every Sec-WebSocket-Extensions field counts
+ * @param[out] response Value of the Sec-WebSocket-Extensions response header,
+ *             empty if no offer was accepted
+ * @return The accepted parameters, enabled false if there are none or zlib is
+ *         not compiled in
+ */
+websocket_deflate_options negotiate_websocket_deflate(const http_headers& headers,
+                                                      std::string& response);
+
+/**
+ * @brief XORs bytes with a masking key, as frames from clients are masked
+ * @param dst Output, may equal src
+ * @param src Input
+ * @param size Number of bytes
+ * @param key The frame's 4-byte masking key
+ * @param offset Position of src[0] in the frame payload, selects the key byte it starts with
+ *
+ * 16 or 32 bytes per step with SSE2/AVX2 on x86-64 and NEON on AArch64, 8
+ * bytes at a time otherwise. Masking is its own inverse.
+ */
+void websocket_mask(char* dst, const char* src, std::size_t size,
+                    const std::array<std::uint8_t, 4>& key, std::size_t offset = 0) noexcept;
+
+/**
+ * @brief Header of an unmasked frame, as the server sends them
+ * @param opcode Frame opcode
+ * @param payload_size Payload length
+ * @param fin Last frame of the message
+ * @param compressed Sets RSV1, for permessage-deflate
+ */
+std::string websocket_frame_header(websocket_opcode opcode, std::size_t payload_size,
+                                   bool fin = true, bool compressed = false);
+
+/**
+ * @class websocket_connection
+ * @brief Frame-level state of one WebSocket connection
+ *
+ * receive() and on_timer() run on the event loop thread; the send and
+ * close functions may be called from any thread. Output is passed to the
+ * send function under the connection's lock, so frames keep their order.
+ */
+class websocket_connection : public std::enable_shared_from_this<websocket_connection> {
+public:
+    /// Queues buffers on the connection, in order and without copying them
+    using send_function = std::function<void(std::vector<cppress::sockets::data_buffer>&&)>;
+
+    /// Closes the connection once queued bytes are written
+    using close_function = std::function<void()>;
+
+    /// (Re-)arms the connection's timer, on_timer() runs when it expires
+    using arm_function = std::function<void(std::chrono::milliseconds)>;
+
+    /**
+     * @brief Construct the connection
+     * @param handler Callbacks of the endpoint
+     * @param deflate Result of negotiate_websocket_deflate()
+     * @param send Writes to the socket
+     * @param close Closes the socket
+     * @param arm Sets the timer of the heartbeat and the closing handshake
+     */
+    websocket_connection(std::shared_ptr<websocket_handler> handler,
+                         websocket_deflate_options deflate, send_function send,
+                         close_function close, arm_function arm);
+
+    websocket_connection(const websocket_connection&) = delete;
+    websocket_connection& operator=(const websocket_connection&) = delete;
+    ~websocket_connection();
+
+    /**
+     * @brief Starts the heartbeat and calls on_open
+     */
+    void open();
+
+    /**
+     * @brief Feeds bytes read from the connection
+     * @param data Bytes in arrival order
+     * @return false once the connection failed or the closing handshake is
+     *         done; the connection is then being closed
+     *
+     * Complete messages are passed to on_message before it returns.
+     */
+    bool receive(std::string_view data);
+
+    /**
+     * @brief The connection's timer expired
+     * @return Delay until the next expiry, zero to close the connection now
+     *
+     * Sends a ping after config::WEBSOCKET_PING_INTERVAL_SECONDS of no pong,
+     * gives up when its pong does not come within
+     * config::WEBSOCKET_PONG_TIMEOUT_SECONDS, and when the client does not
+     * answer a close frame within config::WEBSOCKET_CLOSE_TIMEOUT_SECONDS.
+     */
+    std::chrono::milliseconds on_timer();
+
+    /**
+     * @brief The socket closed, calls on_close once
+     */
+    void closed();
+
+    /// @brief Sends a text message, which must be UTF-8
+    void send_text(std::string text);
+
+    /// @brief Sends a binary message
+    void send_binary(std::string data);
+
+    /**
+     * @brief Sends a message whose payload is already in a buffer, e.g. one shared by many
+     *        connections; it is queued without being copied unless it is compressed
+     */
+    void send(websocket_opcode opcode, cppress::sockets::data_buffer payload);
+
+    /// @brief Sends a ping; the timer is not affected
+    void ping(std::string payload = "");
+
+    /**
+     * @brief Starts the closing handshake
+     * @param code Status code sent to the client
+     * @param reason Short UTF-8 text, cut to fit a control frame
+     */
+    void close(std::uint16_t code = websocket_close::normal, const std::string& reason = "");
+
+    /// @brief true once a close frame was sent or the connection failed
+    bool is_closing() const;
+
+    /// @brief true if permessage-deflate is in use
+    bool compressed() const { return deflate_options_.enabled; }
+
+private:
+    /// Frame being read
+    struct frame_state {
+        /// Bytes of the header read so far; its size is known after two bytes
+        std::array<std::uint8_t, 14> head{};
+        std::size_t head_size = 0;
+        bool reading_head = true;
+
+        bool fin = false;
+        bool rsv1 = false;
+        websocket_opcode opcode = websocket_opcode::continuation;
+        std::array<std::uint8_t, 4> key{};
+        std::uint64_t length = 0;
+        std::uint64_t received = 0;
+    };
+
+    struct deflate_state;
+
+    std::shared_ptr<websocket_handler> handler_;
+    websocket_deflate_options deflate_options_;
+    send_function send_;
+    close_function close_;
+    arm_function arm_;
+
+    frame_state frame_;
+
+    /// Data message being assembled from its frames
+    std::string message_;
+    websocket_opcode message_opcode_ = websocket_opcode::text;
+    bool message_compressed_ = false;
+    bool in_message_ = false;
+
+    /// Payload of the control frame being read
+    std::string control_;
+
+    /// A close frame arrived or the client broke the protocol, nothing more is read
+    bool finished_ = false;
+
+    /// Guards the output and the state below; not held while calling the handler
+    mutable std::mutex mutex_;
+    std::unique_ptr<deflate_state> deflate_;
+    bool close_sent_ = false;
+    bool awaiting_pong_ = false;
+    bool failed_ = false;
+
+    /// on_close was called
+    bool close_reported_ = false;
+    std::uint16_t close_code_ = websocket_close::abnormal;
+    std::string close_reason_;
+
+    /// Header and payload, compressed first if the extension is on
+    void send_frame(websocket_opcode opcode, cppress::sockets::data_buffer payload,
+                    bool compress);
+
+    /// Parses the frame header once its bytes are in; false on a protocol error
+    bool begin_frame();
+
+    /// A frame's payload is complete; false once the connection is closing
+    bool finish_frame();
+
+    /// A close frame arrived
+    void receive_close();
+
+    /// Sends a close frame for a protocol error and closes the connection
+    void fail(std::uint16_t code, const std::string& reason);
+
+    /// Calls on_close, once
+    void report_close();
+};
+
+}  // namespace cppress::http
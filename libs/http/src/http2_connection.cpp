@@ -0,0 +1,826 @@
+#include "../includes/http2_connection.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "../includes/http_consts.hpp"
+
+namespace cppress::http {
+
+namespace {
+constexpr std::uint8_t FLAG_END_STREAM = 0x1;
+constexpr std::uint8_t FLAG_ACK = 0x1;
+constexpr std::uint8_t FLAG_END_HEADERS = 0x4;
+constexpr std::uint8_t FLAG_PADDED = 0x8;
+constexpr std::uint8_t FLAG_PRIORITY = 0x20;
+
+constexpr std::size_t FRAME_HEADER_SIZE = 9;
+
+/// SETTINGS_MAX_FRAME_SIZE we accept, the protocol default
+constexpr std::uint32_t MAX_FRAME_SIZE = 16384;
+
+constexpr std::int64_t MAX_WINDOW = 0x7fffffff;
+
+constexpr std::uint16_t SETTINGS_HEADER_TABLE_SIZE = 0x1;
+constexpr std::uint16_t SETTINGS_ENABLE_PUSH = 0x2;
+constexpr std::uint16_t SETTINGS_MAX_CONCURRENT_STREAMS = 0x3;
+constexpr std::uint16_t SETTINGS_INITIAL_WINDOW_SIZE = 0x4;
+constexpr std::uint16_t SETTINGS_MAX_FRAME_SIZE = 0x5;
+constexpr std::uint16_t SETTINGS_MAX_HEADER_LIST_SIZE = 0x6;
+
+std::uint32_t read_u32(std::string_view bytes) noexcept {
+    return (static_cast<std::uint32_t>(static_cast<std::uint8_t>(bytes[0])) << 24) |
+           (static_cast<std::uint32_t>(static_cast<std::uint8_t>(bytes[1])) << 16) |
+           (static_cast<std::uint32_t>(static_cast<std::uint8_t>(bytes[2])) << 8) |
+           static_cast<std::uint32_t>(static_cast<std::uint8_t>(bytes[3]));
+}
+
+void append_u32(std::string& out, std::uint32_t value) {
+    out.push_back(static_cast<char>(value >> 24));
+    out.push_back(static_cast<char>(value >> 16));
+    out.push_back(static_cast<char>(value >> 8));
+    out.push_back(static_cast<char>(value));
+}
+
+void append_setting(std::string& out, std::uint16_t id, std::uint32_t value) {
+    out.push_back(static_cast<char>(id >> 8));
+    out.push_back(static_cast<char>(id));
+    append_u32(out, value);
+}
+
+/// Window we grant per stream and for the connection
+std::uint32_t local_window() noexcept {
+    return std::clamp<std::uint32_t>(config::HTTP2_INITIAL_WINDOW_SIZE, 65535,
+                                     static_cast<std::uint32_t>(MAX_WINDOW));
+}
+
+/// Header fields HTTP/2 forbids, RFC 9113 section 8.2.2
+bool connection_specific(std::string_view name) noexcept {
+    return name == "connection" || name == "keep-alive" || name == "proxy-connection" ||
+           name == "transfer-encoding" || name == "upgrade";
+}
+
+std::string lower_case(std::string_view in) {
+    std::string out(in);
+    for (char& ch : out)
+        if (ch >= 'A' && ch <= 'Z')
+            ch = static_cast<char>(ch - 'A' + 'a');
+    return out;
+}
+
+std::string_view trim(std::string_view s) noexcept {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t'))
+        s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t' || s.back() == '\r'))
+        s.remove_suffix(1);
+    return s;
+}
+
+/// Decodes base64url (or base64), padding optional; false on any other character
+bool decode_base64url(std::string_view in, std::string& out) {
+    std::uint32_t bits = 0;
+    int count = 0;
+    for (char ch : in) {
+        int value;
+        if (ch >= 'A' && ch <= 'Z')
+            value = ch - 'A';
+        else if (ch >= 'a' && ch <= 'z')
+            value = ch - 'a' + 26;
+        else if (ch >= '0' && ch <= '9')
+            value = ch - '0' + 52;
+        else if (ch == '-' || ch == '+')
+            value = 62;
+        else if (ch == '_' || ch == '/')
+            value = 63;
+        else if (ch == '=')
+            break;
+        else
+            return false;
+        bits = (bits << 6) | static_cast<std::uint32_t>(value);
+        count += 6;
+        if (count >= 8) {
+            count -= 8;
+            out.push_back(static_cast<char>(bits >> count));
+        }
+    }
+    return true;
+}
+
+/// Status and fields of an HTTP/1.1 response head written by http_response
+struct response_head {
+    int status = 0;
+    bool chunked = false;
+    std::vector<hpack_field> fields;
+};
+
+bool parse_response_head(std::string_view head, response_head& parsed) {
+    std::size_t line_end = head.find("\r\n");
+    std::string_view status_line = head.substr(0, line_end);
+    std::size_t space = status_line.find(' ');
+    if (space == std::string_view::npos || status_line.size() < space + 4)
+        return false;
+    parsed.status = std::atoi(std::string(status_line.substr(space + 1, 3)).c_str());
+    if (parsed.status < 100 || parsed.status > 999)
+        return false;
+
+    while (line_end != std::string_view::npos) {
+        std::size_t start = line_end + 2;
+        line_end = head.find("\r\n", start);
+        std::string_view line = head.substr(start, line_end - start);
+        if (line.empty())
+            break;
+        std::size_t colon = line.find(':');
+        if (colon == std::string_view::npos)
+            continue;
+        std::string name = lower_case(trim(line.substr(0, colon)));
+        std::string_view value = trim(line.substr(colon + 1));
+        if (name == "transfer-encoding") {
+            parsed.chunked = lower_case(value).find("chunked") != std::string::npos;
+            continue;
+        }
+        if (connection_specific(name))
+            continue;
+        parsed.fields.push_back({std::move(name), std::string(value)});
+    }
+    return true;
+}
+}  // namespace
+
+http2_connection::http2_connection(send_function send, close_function close)
+    : send_(std::move(send)), close_(std::move(close)) {}
+
+/**
+ * Implementation Notes:
+ * - SETTINGS announce our stream window; the connection window, which only
+ *   WINDOW_UPDATE can change, is raised to the same size
+ */
+void http2_connection::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::string settings;
+    append_setting(settings, SETTINGS_MAX_CONCURRENT_STREAMS,
+                   config::HTTP2_MAX_CONCURRENT_STREAMS);
+    append_setting(settings, SETTINGS_INITIAL_WINDOW_SIZE, local_window());
+    append_setting(settings, SETTINGS_MAX_HEADER_LIST_SIZE,
+                   static_cast<std::uint32_t>(config::MAX_HEADER_SIZE));
+    append_setting(settings, SETTINGS_ENABLE_PUSH, 0);
+    queue_frame(http2_frame_type::settings, 0, 0, settings);
+    if (local_window() > 65535)
+        queue_window_update(0, local_window() - 65535);
+    flush_output();
+}
+
+bool http2_connection::start_upgraded(std::string_view http2_settings) {
+    std::string payload;
+    if (!decode_base64url(http2_settings, payload) || payload.size() % 6 != 0)
+        return false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!apply_settings(payload))
+            return false;
+        // the upgraded request is stream 1, already complete on the client side
+        stream& s = streams_[1];
+        s.request_complete = true;
+        s.send_window = peer_.initial_window_size;
+        last_stream_id_ = 1;
+    }
+    start();
+    return true;
+}
+
+bool http2_connection::receive(std::string_view data, std::vector<http2_request>& requests) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (failed_)
+        return false;
+    in_.append(data);
+    bool ok = process_frames(requests);
+    flush_output();
+    if (!ok)
+        close_();
+    return ok;
+}
+
+void http2_connection::write(std::uint32_t stream_id, std::vector<std::string>&& parts,
+                             bool last) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (failed_)
+        return;
+    auto it = streams_.find(stream_id);
+    if (it == streams_.end())
+        return;  // reset by either side
+    if (parts.empty() && last)
+        translate(stream_id, it->second, {}, true);
+    for (std::size_t i = 0; i < parts.size(); ++i) {
+        translate(stream_id, it->second, parts[i], last && i + 1 == parts.size());
+        it = streams_.find(stream_id);
+        if (it == streams_.end())
+            break;  // reset on malformed output
+    }
+    if (it != streams_.end())
+        release_if_done(it);
+    flush_output();
+}
+
+void http2_connection::close_stream(std::uint32_t stream_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (failed_)
+        return;
+    auto it = streams_.find(stream_id);
+    if (it == streams_.end() || it->second.response_started)
+        return;
+    reset_stream(stream_id, http2_error::cancel);
+    flush_output();
+}
+
+std::size_t http2_connection::stream_count() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return streams_.size();
+}
+
+bool http2_connection::process_frames(std::vector<http2_request>& requests) {
+    if (!preface_received_) {
+        std::size_t n = std::min(in_.size(), HTTP2_PREFACE.size());
+        if (std::string_view(in_).substr(0, n) != HTTP2_PREFACE.substr(0, n))
+            return fail(http2_error::protocol_error);
+        if (n < HTTP2_PREFACE.size())
+            return true;
+        in_.erase(0, HTTP2_PREFACE.size());
+        preface_received_ = true;
+    }
+
+    std::size_t pos = 0;
+    bool ok = true;
+    while (ok && in_.size() - pos >= FRAME_HEADER_SIZE) {
+        std::string_view header = std::string_view(in_).substr(pos, FRAME_HEADER_SIZE);
+        std::uint32_t length = read_u32(header) >> 8;
+        if (length > MAX_FRAME_SIZE) {
+            ok = fail(http2_error::frame_size_error);
+            break;
+        }
+        if (in_.size() - pos - FRAME_HEADER_SIZE < length)
+            break;
+        auto type = static_cast<std::uint8_t>(header[3]);
+        auto flags = static_cast<std::uint8_t>(header[4]);
+        std::uint32_t stream_id = read_u32(header.substr(5)) & 0x7fffffff;
+        std::string_view payload = std::string_view(in_).substr(pos + FRAME_HEADER_SIZE, length);
+        pos += FRAME_HEADER_SIZE + length;
+
+        if (!settings_received_ && type != static_cast<std::uint8_t>(http2_frame_type::settings))
+            ok = fail(http2_error::protocol_error);
+        else
+            ok = on_frame(type, flags, stream_id, payload, requests);
+    }
+    in_.erase(0, pos);
+    return ok;
+}
+
+bool http2_connection::on_frame(std::uint8_t type, std::uint8_t flags, std::uint32_t stream_id,
+                                std::string_view payload, std::vector<http2_request>& requests) {
+    if (continuation_stream_ != 0 &&
+        (type != static_cast<std::uint8_t>(http2_frame_type::continuation) ||
+         stream_id != continuation_stream_))
+        return fail(http2_error::protocol_error);
+
+    switch (static_cast<http2_frame_type>(type)) {
+        case http2_frame_type::data:
+            return on_data(flags, stream_id, payload, requests);
+
+        case http2_frame_type::headers:
+            return on_headers(flags, stream_id, payload, requests);
+
+        case http2_frame_type::priority:
+            if (stream_id == 0)
+                return fail(http2_error::protocol_error);
+            if (payload.size() != 5)
+                reset_stream(stream_id, http2_error::frame_size_error);
+            return true;
+
+        case http2_frame_type::rst_stream:
+            if (stream_id == 0 || stream_id > last_stream_id_)
+                return fail(http2_error::protocol_error);
+            if (payload.size() != 4)
+                return fail(http2_error::frame_size_error);
+            streams_.erase(stream_id);
+            return true;
+
+        case http2_frame_type::settings:
+            return on_settings(flags, stream_id, payload);
+
+        case http2_frame_type::push_promise:
+            return fail(http2_error::protocol_error);
+
+        case http2_frame_type::ping:
+            if (stream_id != 0)
+                return fail(http2_error::protocol_error);
+            if (payload.size() != 8)
+                return fail(http2_error::frame_size_error);
+            if (!(flags & FLAG_ACK))
+                queue_frame(http2_frame_type::ping, FLAG_ACK, 0, payload);
+            return true;
+
+        case http2_frame_type::goaway:
+            // the client stops opening streams; those in flight are still answered
+            return stream_id == 0 ? true : fail(http2_error::protocol_error);
+
+        case http2_frame_type::window_update:
+            return on_window_update(stream_id, payload);
+
+        case http2_frame_type::continuation:
+            if (continuation_stream_ == 0)
+                return fail(http2_error::protocol_error);
+            header_block_.append(payload);
+            if (header_block_.size() > config::MAX_HEADER_SIZE)
+                return fail(http2_error::enhance_your_calm);
+            if (!(flags & FLAG_END_HEADERS))
+                return true;
+            continuation_stream_ = 0;
+            return on_header_block(stream_id, continuation_flags_, requests);
+    }
+    return true;  // unknown frame types are ignored
+}
+
+/**
+ * Implementation Notes:
+ * - The whole payload, padding included, counts against both windows and
+ *   is credited back once half a window has been received, also for
+ *   frames of streams that are gone
+ */
+bool http2_connection::on_data(std::uint8_t flags, std::uint32_t stream_id,
+                               std::string_view payload, std::vector<http2_request>& requests) {
+    if (stream_id == 0)
+        return fail(http2_error::protocol_error);
+    auto length = static_cast<std::uint32_t>(payload.size());
+    std::string_view data = payload;
+    if (flags & FLAG_PADDED) {
+        if (payload.empty() || static_cast<std::uint8_t>(payload[0]) >= payload.size())
+            return fail(http2_error::protocol_error);
+        data = payload.substr(1, payload.size() - 1 - static_cast<std::uint8_t>(payload[0]));
+    }
+
+    connection_unacknowledged_ += length;
+    if (connection_unacknowledged_ > local_window())
+        return fail(http2_error::flow_control_error);
+    if (connection_unacknowledged_ >= local_window() / 2) {
+        queue_window_update(0, connection_unacknowledged_);
+        connection_unacknowledged_ = 0;
+    }
+
+    auto it = streams_.find(stream_id);
+    if (it == streams_.end() || it->second.request_complete) {
+        if (it == streams_.end() && stream_id > last_stream_id_)
+            return fail(http2_error::protocol_error);  // idle stream
+        reset_stream(stream_id, http2_error::stream_closed);
+        return true;
+    }
+
+    stream& s = it->second;
+    s.unacknowledged += length;
+    if (s.unacknowledged > local_window())
+        return fail(http2_error::flow_control_error);
+    s.body.append(data);
+    if (s.body.size() > config::MAX_BODY_SIZE) {
+        reset_stream(stream_id, http2_error::cancel);
+        return true;
+    }
+
+    if (flags & FLAG_END_STREAM) {
+        complete_request(stream_id, s, requests);
+    } else if (s.unacknowledged >= local_window() / 2) {
+        queue_window_update(stream_id, s.unacknowledged);
+        s.unacknowledged = 0;
+    }
+    return true;
+}
+
+bool http2_connection::on_headers(std::uint8_t flags, std::uint32_t stream_id,
+                                  std::string_view payload, std::vector<http2_request>& requests) {
+    if (stream_id == 0 || stream_id % 2 == 0)
+        return fail(http2_error::protocol_error);
+    if (flags & FLAG_PADDED) {
+        if (payload.empty() || static_cast<std::uint8_t>(payload[0]) >= payload.size())
+            return fail(http2_error::protocol_error);
+        payload = payload.substr(1, payload.size() - 1 - static_cast<std::uint8_t>(payload[0]));
+    }
+    if (flags & FLAG_PRIORITY) {
+        if (payload.size() < 5)
+            return fail(http2_error::frame_size_error);
+        payload.remove_prefix(5);
+    }
+    header_block_.assign(payload);
+    if (flags & FLAG_END_HEADERS)
+        return on_header_block(stream_id, flags, requests);
+    continuation_stream_ = stream_id;
+    continuation_flags_ = flags;
+    return true;
+}
+
+/**
+ * Implementation Notes:
+ * - Every block is decoded, even for a stream about to be refused, so the
+ *   HPACK table stays in step with the client's
+ * - A malformed request resets its stream only; a block that does not
+ *   decode fails the connection
+ */
+bool http2_connection::on_header_block(std::uint32_t stream_id, std::uint8_t flags,
+                                       std::vector<http2_request>& requests) {
+    std::vector<hpack_field> fields;
+    bool decoded = decoder_.decode(header_block_, fields, config::MAX_HEADER_SIZE);
+    header_block_.clear();
+    if (!decoded)
+        return fail(http2_error::compression_error);
+    bool end_stream = (flags & FLAG_END_STREAM) != 0;
+
+    auto it = streams_.find(stream_id);
+    if (it != streams_.end()) {
+        // a second block on an open stream is its trailer section
+        stream& s = it->second;
+        if (s.request_complete) {
+            reset_stream(stream_id, http2_error::stream_closed);
+            return true;
+        }
+        if (!end_stream) {
+            reset_stream(stream_id, http2_error::protocol_error);
+            return true;
+        }
+        for (const auto& field : fields) {
+            if (field.name.empty() || field.name[0] == ':') {
+                reset_stream(stream_id, http2_error::protocol_error);
+                return true;
+            }
+            s.headers.add(field.name, field.value);
+        }
+        complete_request(stream_id, s, requests);
+        return true;
+    }
+
+    if (stream_id <= last_stream_id_)
+        return fail(http2_error::stream_closed);
+    last_stream_id_ = stream_id;
+    if (streams_.size() >= config::HTTP2_MAX_CONCURRENT_STREAMS) {
+        reset_stream(stream_id, http2_error::refused_stream);
+        return true;
+    }
+
+    stream s;
+    s.send_window = peer_.initial_window_size;
+    std::string authority, cookie;
+    bool regular_seen = false, malformed = false;
+    for (auto& field : fields) {
+        const std::string& name = field.name;
+        if (name.empty() ||
+            std::any_of(name.begin(), name.end(), [](char ch) { return ch >= 'A' && ch <= 'Z'; })) {
+            malformed = true;
+        } else if (name[0] == ':') {
+            std::string* target = name == ":method"      ? &s.method
+                                  : name == ":path"      ? &s.uri
+                                  : name == ":authority" ? &authority
+                                                         : nullptr;
+            if (regular_seen || (name != ":scheme" && !target) || (target && !target->empty()))
+                malformed = true;
+            else if (target)
+                *target = std::move(field.value);
+        } else {
+            regular_seen = true;
+            if (connection_specific(name) || (name == "te" && field.value != "trailers")) {
+                malformed = true;
+            } else if (name == "cookie") {
+                // split cookies are joined back into one field
+                cookie += (cookie.empty() ? "" : "; ") + field.value;
+            } else {
+                if (name == "content-length")
+                    s.expected_length = std::atoll(field.value.c_str());
+                s.headers.add(name, field.value);
+            }
+        }
+    }
+    if (malformed || s.method.empty() || s.uri.empty()) {
+        reset_stream(stream_id, http2_error::protocol_error);
+        return true;
+    }
+    if (!cookie.empty())
+        s.headers.add("cookie", cookie);
+    if (!authority.empty() && !s.headers.contains(header_id::host))
+        s.headers.add("host", authority);
+
+    stream& added = streams_.emplace(stream_id, std::move(s)).first->second;
+    if (end_stream)
+        complete_request(stream_id, added, requests);
+    return true;
+}
+
+bool http2_connection::on_settings(std::uint8_t flags, std::uint32_t stream_id,
+                                   std::string_view payload) {
+    if (stream_id != 0)
+        return fail(http2_error::protocol_error);
+    if (flags & FLAG_ACK)
+        return payload.empty() ? true : fail(http2_error::frame_size_error);
+    if (payload.size() % 6 != 0)
+        return fail(http2_error::frame_size_error);
+    if (!apply_settings(payload))
+        return false;
+    settings_received_ = true;
+    queue_frame(http2_frame_type::settings, FLAG_ACK, 0, {});
+    flush_all();
+    return true;
+}
+
+bool http2_connection::apply_settings(std::string_view payload) {
+    for (std::size_t i = 0; i + 6 <= payload.size(); i += 6) {
+        auto id = static_cast<std::uint16_t>((static_cast<std::uint8_t>(payload[i]) << 8) |
+                                             static_cast<std::uint8_t>(payload[i + 1]));
+        std::uint32_t value = read_u32(payload.substr(i + 2));
+        switch (id) {
+            case SETTINGS_HEADER_TABLE_SIZE:
+                encoder_.set_max_table_size(value);
+                break;
+            case SETTINGS_ENABLE_PUSH:
+                if (value > 1)
+                    return fail(http2_error::protocol_error);
+                break;
+            case SETTINGS_INITIAL_WINDOW_SIZE: {
+                if (value > MAX_WINDOW)
+                    return fail(http2_error::flow_control_error);
+                // the change applies to the windows of every open stream
+                std::int64_t delta = static_cast<std::int64_t>(value) - peer_.initial_window_size;
+                for (auto& entry : streams_) {
+                    entry.second.send_window += delta;
+                    if (entry.second.send_window > MAX_WINDOW)
+                        return fail(http2_error::flow_control_error);
+                }
+                peer_.initial_window_size = value;
+                break;
+            }
+            case SETTINGS_MAX_FRAME_SIZE:
+                if (value < 16384 || value > 16777215)
+                    return fail(http2_error::protocol_error);
+                peer_.max_frame_size = value;
+                break;
+            default:
+                break;  // MAX_CONCURRENT_STREAMS binds pushes, which are not sent
+        }
+    }
+    return true;
+}
+
+bool http2_connection::on_window_update(std::uint32_t stream_id, std::string_view payload) {
+    if (payload.size() != 4)
+        return fail(http2_error::frame_size_error);
+    std::uint32_t increment = read_u32(payload) & 0x7fffffff;
+    if (stream_id == 0) {
+        if (increment == 0)
+            return fail(http2_error::protocol_error);
+        connection_send_window_ += increment;
+        if (connection_send_window_ > MAX_WINDOW)
+            return fail(http2_error::flow_control_error);
+        flush_all();
+        return true;
+    }
+    if (stream_id > last_stream_id_)
+        return fail(http2_error::protocol_error);
+    auto it = streams_.find(stream_id);
+    if (it == streams_.end())
+        return true;
+    if (increment == 0) {
+        reset_stream(stream_id, http2_error::protocol_error);
+        return true;
+    }
+    it->second.send_window += increment;
+    if (it->second.send_window > MAX_WINDOW) {
+        reset_stream(stream_id, http2_error::flow_control_error);
+        return true;
+    }
+    flush_stream(stream_id, it->second);
+    release_if_done(it);
+    return true;
+}
+
+void http2_connection::complete_request(std::uint32_t stream_id, stream& s,
+                                        std::vector<http2_request>& requests) {
+    if (s.expected_length >= 0 && static_cast<std::size_t>(s.expected_length) != s.body.size()) {
+        reset_stream(stream_id, http2_error::protocol_error);
+        return;
+    }
+    s.request_complete = true;
+    http2_request request;
+    request.stream_id = stream_id;
+    request.method = std::move(s.method);
+    request.uri = std::move(s.uri);
+    request.headers = std::move(s.headers);
+    request.body = std::move(s.body);
+    requests.push_back(std::move(request));
+}
+
+/**
+ * Implementation Notes:
+ * - The head is collected until its blank line; 1xx heads go out as
+ *   informational HEADERS and the next head follows
+ * - A chunked body is decoded back into plain DATA, its trailers become
+ *   the final HEADERS; any other body is passed through as it is
+ * - Bytes after the response is complete (e.g. send_trailers()) are ignored
+ */
+void http2_connection::translate(std::uint32_t stream_id, stream& s, std::string_view bytes,
+                                 bool last) {
+    s.response_started = true;
+    while (s.phase == response_phase::head) {
+        s.raw.append(bytes);
+        bytes = {};
+        std::size_t end = s.raw.find("\r\n\r\n");
+        if (end == std::string::npos) {
+            if (last)
+                reset_stream(stream_id, http2_error::internal_error);
+            return;
+        }
+        response_head head;
+        if (!parse_response_head(std::string_view(s.raw).substr(0, end + 2), head)) {
+            reset_stream(stream_id, http2_error::internal_error);
+            return;
+        }
+        std::string rest = s.raw.substr(end + 4);
+        s.raw.clear();
+
+        bool informational = head.status < 200 && head.status != 101;
+        bool end_stream = !informational && last && rest.empty() && !head.chunked;
+        std::string block;
+        encoder_.begin_block(block);
+        encoder_.encode(":status", std::to_string(head.status), block);
+        for (const auto& field : head.fields)
+            encoder_.encode(field.name, field.value, block);
+        queue_header_block(stream_id, block, end_stream);
+        if (end_stream) {
+            s.phase = response_phase::done;
+            s.response_complete = true;
+            return;
+        }
+        if (informational) {
+            s.raw = std::move(rest);
+            continue;
+        }
+        s.phase = head.chunked ? response_phase::chunked : response_phase::body;
+        if (head.chunked)
+            s.raw = std::move(rest);  // decoded below
+        else
+            s.out.append(rest);
+    }
+
+    if (s.phase == response_phase::body) {
+        s.out.append(bytes);
+        if (last) {
+            s.end_pending = true;
+            s.phase = response_phase::done;
+        }
+    } else if (s.phase == response_phase::chunked) {
+        std::string pending;
+        if (!s.raw.empty()) {
+            pending = std::move(s.raw);
+            s.raw.clear();
+            pending.append(bytes);
+            bytes = pending;
+        }
+        std::size_t pos = 0;
+        http_span run;
+        for (;;) {
+            auto status = s.chunked.next(bytes, pos, run, config::MAX_HEADER_SIZE);
+            if (status == http_chunked_decoder::status::data) {
+                s.out.append(run.in(bytes));
+                continue;
+            }
+            if (status == http_chunked_decoder::status::error) {
+                reset_stream(stream_id, http2_error::internal_error);
+                return;
+            }
+            if (status == http_chunked_decoder::status::complete) {
+                for (const auto& field : s.chunked.trailers()) {
+                    std::string name = lower_case(field.first);
+                    if (!connection_specific(name))
+                        s.trailers.push_back({std::move(name), field.second});
+                }
+                s.end_pending = true;
+                s.phase = response_phase::done;
+            }
+            break;
+        }
+        if (last && s.phase != response_phase::done) {
+            s.end_pending = true;
+            s.phase = response_phase::done;
+        }
+    }
+    flush_stream(stream_id, s);
+}
+
+void http2_connection::flush_stream(std::uint32_t stream_id, stream& s) {
+    while (s.out_offset < s.out.size()) {
+        std::int64_t room = std::min<std::int64_t>(
+            {s.send_window, connection_send_window_, peer_.max_frame_size,
+             static_cast<std::int64_t>(s.out.size() - s.out_offset)});
+        if (room <= 0) {
+            if (s.out_offset >= 64 * 1024) {
+                s.out.erase(0, s.out_offset);
+                s.out_offset = 0;
+            }
+            return;  // resumed by a WINDOW_UPDATE
+        }
+        auto n = static_cast<std::size_t>(room);
+        bool end = s.end_pending && s.trailers.empty() && s.out_offset + n == s.out.size();
+        queue_frame(http2_frame_type::data, end ? FLAG_END_STREAM : 0, stream_id,
+                    std::string_view(s.out).substr(s.out_offset, n));
+        s.send_window -= room;
+        connection_send_window_ -= room;
+        s.out_offset += n;
+        if (end) {
+            s.end_pending = false;
+            s.response_complete = true;
+        }
+    }
+    s.out.clear();
+    s.out_offset = 0;
+
+    if (!s.end_pending)
+        return;
+    if (!s.trailers.empty()) {
+        std::string block;
+        encoder_.begin_block(block);
+        for (const auto& field : s.trailers)
+            encoder_.encode(field.name, field.value, block);
+        s.trailers.clear();
+        queue_header_block(stream_id, block, true);
+    } else {
+        queue_frame(http2_frame_type::data, FLAG_END_STREAM, stream_id, {});
+    }
+    s.end_pending = false;
+    s.response_complete = true;
+}
+
+void http2_connection::flush_all() {
+    for (auto it = streams_.begin(); it != streams_.end();) {
+        auto current = it++;
+        flush_stream(current->first, current->second);
+        release_if_done(current);
+    }
+}
+
+void http2_connection::release_if_done(std::map<std::uint32_t, stream>::iterator it) {
+    if (it->second.request_complete && it->second.response_complete)
+        streams_.erase(it);
+}
+
+void http2_connection::queue_frame(http2_frame_type type, std::uint8_t flags,
+                                   std::uint32_t stream_id, std::string_view payload) {
+    std::string frame;
+    frame.reserve(FRAME_HEADER_SIZE + payload.size());
+    append_u32(frame, static_cast<std::uint32_t>(payload.size()) << 8);
+    frame.pop_back();  // the length is 24 bits
+    frame.push_back(static_cast<char>(type));
+    frame.push_back(static_cast<char>(flags));
+    append_u32(frame, stream_id);
+    frame.append(payload);
+    pending_output_.push_back(std::move(frame));
+}
+
+void http2_connection::queue_header_block(std::uint32_t stream_id, const std::string& block,
+                                          bool end_stream) {
+    std::size_t pos = 0;
+    bool first = true;
+    do {
+        std::size_t n = std::min<std::size_t>(peer_.max_frame_size, block.size() - pos);
+        bool last = pos + n == block.size();
+        std::uint8_t flags = (last ? FLAG_END_HEADERS : 0) |
+                             (first && end_stream ? FLAG_END_STREAM : 0);
+        queue_frame(first ? http2_frame_type::headers : http2_frame_type::continuation, flags,
+                    stream_id, std::string_view(block).substr(pos, n));
+        pos += n;
+        first = false;
+    } while (pos < block.size());
+}
+
+void http2_connection::queue_window_update(std::uint32_t stream_id, std::uint32_t increment) {
+    std::string payload;
+    append_u32(payload, increment);
+    queue_frame(http2_frame_type::window_update, 0, stream_id, payload);
+}
+
+void http2_connection::reset_stream(std::uint32_t stream_id, http2_error error) {
+    std::string payload;
+    append_u32(payload, static_cast<std::uint32_t>(error));
+    queue_frame(http2_frame_type::rst_stream, 0, stream_id, payload);
+    streams_.erase(stream_id);
+}
+
+bool http2_connection::fail(http2_error error) {
+    if (!failed_) {
+        failed_ = true;
+        std::string payload;
+        append_u32(payload, last_stream_id_);
+        append_u32(payload, static_cast<std::uint32_t>(error));
+        queue_frame(http2_frame_type::goaway, 0, 0, payload);
+    }
+    return false;
+}
+
+void http2_connection::flush_output() {
+    if (pending_output_.empty())
+        return;
+    std::vector<std::string> output;
+    output.swap(pending_output_);
+    send_(std::move(output));
+}
+
+}  // namespace cppress::http
@@ -0,0 +1,452 @@
+#include "../includes/http2_hpack.hpp"
+
+#include <array>
+
+namespace cppress::http {
+
+namespace {
+/// RFC 7541 Appendix A
+const hpack_field STATIC_TABLE[hpack_table::STATIC_SIZE] = {
+    {":authority", ""},
+    {":method", "GET"},
+    {":method", "POST"},
+    {":path", "/"},
+    {":path", "/index.html"},
+    {":scheme", "http"},
+    {":scheme", "https"},
+    {":status", "200"},
+    {":status", "204"},
+    {":status", "206"},
+    {":status", "304"},
+    {":status", "400"},
+    {":status", "404"},
+    {":status", "500"},
+    {"accept-charset", ""},
+    {"accept-encoding", "gzip, deflate"},
+    {"accept-language", ""},
+    {"accept-ranges", ""},
+    {"accept", ""},
+    {"access-control-allow-origin", ""},
+    {"age", ""},
+    {"allow", ""},
+    {"authorization", ""},
+    {"cache-control", ""},
+    {"content-disposition", ""},
+    {"content-encoding", ""},
+    {"content-language", ""},
+    {"content-length", ""},
+    {"content-location", ""},
+    {"content-range", ""},
+    {"content-type", ""},
+    {"cookie", ""},
+    {"date", ""},
+    {"etag", ""},
+    {"expect", ""},
+    {"expires", ""},
+    {"from", ""},
+    {"host", ""},
+    {"if-match", ""},
+    {"if-modified-since", ""},
+    {"if-none-match", ""},
+    {"if-range", ""},
+    {"if-unmodified-since", ""},
+    {"last-modified", ""},
+    {"link", ""},
+    {"location", ""},
+    {"max-forwards", ""},
+    {"proxy-authenticate", ""},
+    {"proxy-authorization", ""},
+    {"range", ""},
+    {"referer", ""},
+    {"refresh", ""},
+    {"retry-after", ""},
+    {"server", ""},
+    {"set-cookie", ""},
+    {"strict-transport-security", ""},
+    {"transfer-encoding", ""},
+    {"user-agent", ""},
+    {"vary", ""},
+    {"via", ""},
+    {"www-authenticate", ""},
+};
+
+/// RFC 7541 Appendix B, symbol 256 is EOS
+constexpr std::uint32_t HUFFMAN_CODES[257] = {
+    0x1ff8, 0x7fffd8, 0xfffffe2, 0xfffffe3, 0xfffffe4, 0xfffffe5,
+    0xfffffe6, 0xfffffe7, 0xfffffe8, 0xffffea, 0x3ffffffc, 0xfffffe9,
+    0xfffffea, 0x3ffffffd, 0xfffffeb, 0xfffffec, 0xfffffed, 0xfffffee,
+    0xfffffef, 0xffffff0, 0xffffff1, 0xffffff2, 0x3ffffffe, 0xffffff3,
+    0xffffff4, 0xffffff5, 0xffffff6, 0xffffff7, 0xffffff8, 0xffffff9,
+    0xffffffa, 0xffffffb, 0x14, 0x3f8, 0x3f9, 0xffa,
+    0x1ff9, 0x15, 0xf8, 0x7fa, 0x3fa, 0x3fb,
+    0xf9, 0x7fb, 0xfa, 0x16, 0x17, 0x18,
+    0x0, 0x1, 0x2, 0x19, 0x1a, 0x1b,
+    0x1c, 0x1d, 0x1e, 0x1f, 0x5c, 0xfb,
+    0x7ffc, 0x20, 0xffb, 0x3fc, 0x1ffa, 0x21,
+    0x5d, 0x5e, 0x5f, 0x60, 0x61, 0x62,
+    0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+    0x69, 0x6a, 0x6b, 0x6c, 0x6d, 0x6e,
+    0x6f, 0x70, 0x71, 0x72, 0xfc, 0x73,
+    0xfd, 0x1ffb, 0x7fff0, 0x1ffc, 0x3ffc, 0x22,
+    0x7ffd, 0x3, 0x23, 0x4, 0x24, 0x5,
+    0x25, 0x26, 0x27, 0x6, 0x74, 0x75,
+    0x28, 0x29, 0x2a, 0x7, 0x2b, 0x76,
+    0x2c, 0x8, 0x9, 0x2d, 0x77, 0x78,
+    0x79, 0x7a, 0x7b, 0x7ffe, 0x7fc, 0x3ffd,
+    0x1ffd, 0xffffffc, 0xfffe6, 0x3fffd2, 0xfffe7, 0xfffe8,
+    0x3fffd3, 0x3fffd4, 0x3fffd5, 0x7fffd9, 0x3fffd6, 0x7fffda,
+    0x7fffdb, 0x7fffdc, 0x7fffdd, 0x7fffde, 0xffffeb, 0x7fffdf,
+    0xffffec, 0xffffed, 0x3fffd7, 0x7fffe0, 0xffffee, 0x7fffe1,
+    0x7fffe2, 0x7fffe3, 0x7fffe4, 0x1fffdc, 0x3fffd8, 0x7fffe5,
+    0x3fffd9, 0x7fffe6, 0x7fffe7, 0xffffef, 0x3fffda, 0x1fffdd,
+    0xfffe9, 0x3fffdb, 0x3fffdc, 0x7fffe8, 0x7fffe9, 0x1fffde,
+    0x7fffea, 0x3fffdd, 0x3fffde, 0xfffff0, 0x1fffdf, 0x3fffdf,
+    0x7fffeb, 0x7fffec, 0x1fffe0, 0x1fffe1, 0x3fffe0, 0x1fffe2,
+    0x7fffed, 0x3fffe1, 0x7fffee, 0x7fffef, 0xfffea, 0x3fffe2,
+    0x3fffe3, 0x3fffe4, 0x7ffff0, 0x3fffe5, 0x3fffe6, 0x7ffff1,
+    0x3ffffe0, 0x3ffffe1, 0xfffeb, 0x7fff1, 0x3fffe7, 0x7ffff2,
+    0x3fffe8, 0x1ffffec, 0x3ffffe2, 0x3ffffe3, 0x3ffffe4, 0x7ffffde,
+    0x7ffffdf, 0x3ffffe5, 0xfffff1, 0x1ffffed, 0x7fff2, 0x1fffe3,
+    0x3ffffe6, 0x7ffffe0, 0x7ffffe1, 0x3ffffe7, 0x7ffffe2, 0xfffff2,
+    0x1fffe4, 0x1fffe5, 0x3ffffe8, 0x3ffffe9, 0xffffffd, 0x7ffffe3,
+    0x7ffffe4, 0x7ffffe5, 0xfffec, 0xfffff3, 0xfffed, 0x1fffe6,
+    0x3fffe9, 0x1fffe7, 0x1fffe8, 0x7ffff3, 0x3fffea, 0x3fffeb,
+    0x1ffffee, 0x1ffffef, 0xfffff4, 0xfffff5, 0x3ffffea, 0x7ffff4,
+    0x3ffffeb, 0x7ffffe6, 0x3ffffec, 0x3ffffed, 0x7ffffe7, 0x7ffffe8,
+    0x7ffffe9, 0x7ffffea, 0x7ffffeb, 0xffffffe, 0x7ffffec, 0x7ffffed,
+    0x7ffffee, 0x7ffffef, 0x7fffff0, 0x3ffffee, 0x3fffffff,
+};
+constexpr std::uint8_t HUFFMAN_LENGTHS[257] = {
+    13, 23, 28, 28, 28, 28, 28, 28, 28, 24, 30, 28, 28, 30, 28, 28,
+    28, 28, 28, 28, 28, 28, 30, 28, 28, 28, 28, 28, 28, 28, 28, 28,
+    6, 10, 10, 12, 13, 6, 8, 11, 10, 10, 8, 11, 8, 6, 6, 6,
+    5, 5, 5, 6, 6, 6, 6, 6, 6, 6, 7, 8, 15, 6, 12, 10,
+    13, 6, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+    7, 7, 7, 7, 7, 7, 7, 7, 8, 7, 8, 13, 19, 13, 14, 6,
+    15, 5, 6, 5, 6, 5, 6, 6, 6, 5, 7, 7, 6, 6, 6, 5,
+    6, 7, 6, 5, 5, 6, 7, 7, 7, 7, 7, 15, 11, 14, 13, 28,
+    20, 22, 20, 20, 22, 22, 22, 23, 22, 23, 23, 23, 23, 23, 24, 23,
+    24, 24, 22, 23, 24, 23, 23, 23, 23, 21, 22, 23, 22, 23, 23, 24,
+    22, 21, 20, 22, 22, 23, 23, 21, 23, 22, 22, 24, 21, 22, 23, 23,
+    21, 21, 22, 21, 23, 22, 23, 23, 20, 22, 22, 22, 23, 22, 22, 23,
+    26, 26, 20, 19, 22, 23, 22, 25, 26, 26, 26, 27, 27, 26, 24, 25,
+    19, 21, 26, 27, 27, 26, 27, 24, 21, 21, 26, 26, 28, 27, 27, 27,
+    20, 24, 20, 21, 22, 21, 21, 23, 22, 22, 25, 25, 24, 24, 26, 23,
+    26, 27, 26, 26, 27, 27, 27, 27, 27, 28, 27, 27, 27, 27, 27, 26,
+    30,
+};
+
+/// Longest Huffman code
+constexpr int HUFFMAN_MAX_LENGTH = 30;
+
+/**
+ * Canonical decoding tables: the codes of one length are consecutive, so a
+ * code of length n is symbol sorted[offset[n] + code - first[n]] when
+ * code - first[n] < count[n]
+ */
+struct huffman_decoding {
+    std::array<std::uint32_t, HUFFMAN_MAX_LENGTH + 1> first{};
+    std::array<std::uint16_t, HUFFMAN_MAX_LENGTH + 1> count{};
+    std::array<std::uint16_t, HUFFMAN_MAX_LENGTH + 1> offset{};
+    std::array<std::uint16_t, 257> sorted{};
+
+    huffman_decoding() {
+        std::size_t n = 0;
+        for (int length = 1; length <= HUFFMAN_MAX_LENGTH; ++length) {
+            offset[length] = static_cast<std::uint16_t>(n);
+            for (std::uint16_t symbol = 0; symbol < 257; ++symbol) {
+                if (HUFFMAN_LENGTHS[symbol] != length)
+                    continue;
+                if (count[length] == 0)
+                    first[length] = HUFFMAN_CODES[symbol];
+                ++count[length];
+                sorted[n++] = symbol;
+            }
+        }
+    }
+};
+
+const huffman_decoding& decoding() {
+    static const huffman_decoding tables;
+    return tables;
+}
+
+constexpr std::size_t entry_size(std::string_view name, std::string_view value) noexcept {
+    return name.size() + value.size() + 32;
+}
+
+/// Reads a string literal at pos
+bool decode_string(std::string_view in, std::size_t& pos, std::string& out) {
+    if (pos >= in.size())
+        return false;
+    bool huffman = (static_cast<std::uint8_t>(in[pos]) & 0x80) != 0;
+    std::uint64_t length;
+    if (!hpack_decode_integer(in, pos, 7, length) || length > in.size() - pos)
+        return false;
+    std::string_view bytes = in.substr(pos, static_cast<std::size_t>(length));
+    pos += static_cast<std::size_t>(length);
+    out.clear();
+    if (huffman)
+        return huffman_decode(bytes, out);
+    out.assign(bytes);
+    return true;
+}
+
+void encode_string(std::string_view in, std::string& out) {
+    std::size_t huffman_size = huffman_encoded_size(in);
+    if (huffman_size < in.size()) {
+        hpack_encode_integer(huffman_size, 7, 0x80, out);
+        huffman_encode(in, out);
+    } else {
+        hpack_encode_integer(in.size(), 7, 0, out);
+        out.append(in);
+    }
+}
+
+/// Values that change on nearly every response, not worth a table entry
+bool worth_indexing(std::string_view name) noexcept {
+    for (std::string_view volatile_name :
+         {"content-length", "date", "etag", "last-modified", "expires", "age", "set-cookie",
+          "location", ":path"})
+        if (name == volatile_name)
+            return false;
+    return true;
+}
+}  // namespace
+
+const hpack_field* hpack_table::at(std::size_t index) const noexcept {
+    if (index == 0)
+        return nullptr;
+    if (index <= STATIC_SIZE)
+        return &STATIC_TABLE[index - 1];
+    index -= STATIC_SIZE + 1;
+    return index < dynamic_.size() ? &dynamic_[index] : nullptr;
+}
+
+void hpack_table::evict(std::size_t needed) {
+    while (!dynamic_.empty() && size_ + needed > max_size_) {
+        size_ -= entry_size(dynamic_.back().name, dynamic_.back().value);
+        dynamic_.pop_back();
+    }
+}
+
+void hpack_table::add(std::string_view name, std::string_view value) {
+    std::size_t needed = entry_size(name, value);
+    if (needed > max_size_) {
+        // an entry larger than the table empties it and is not added
+        dynamic_.clear();
+        size_ = 0;
+        return;
+    }
+    evict(needed);
+    dynamic_.push_front({std::string(name), std::string(value)});
+    size_ += needed;
+}
+
+void hpack_table::resize(std::size_t max_size) {
+    max_size_ = max_size;
+    evict(0);
+}
+
+std::size_t hpack_table::find(std::string_view name, std::string_view value,
+                              bool& value_matched) const noexcept {
+    std::size_t name_match = 0;
+    value_matched = false;
+    for (std::size_t i = 0; i < STATIC_SIZE; ++i) {
+        if (STATIC_TABLE[i].name != name)
+            continue;
+        if (STATIC_TABLE[i].value == value) {
+            value_matched = true;
+            return i + 1;
+        }
+        if (name_match == 0)
+            name_match = i + 1;
+    }
+    for (std::size_t i = 0; i < dynamic_.size(); ++i) {
+        if (dynamic_[i].name != name)
+            continue;
+        if (dynamic_[i].value == value) {
+            value_matched = true;
+            return STATIC_SIZE + 1 + i;
+        }
+        if (name_match == 0)
+            name_match = STATIC_SIZE + 1 + i;
+    }
+    return name_match;
+}
+
+/**
+ * Implementation Notes:
+ * - Table size updates are accepted only before the first field, and
+ *   never above the size we advertised
+ * - The list size is checked as fields are decoded, so an oversized block
+ *   stops early instead of building the whole list
+ */
+bool hpack_decoder::decode(std::string_view block, std::vector<hpack_field>& fields,
+                           std::size_t max_list_size) {
+    std::size_t pos = 0, list_size = 0;
+    bool any_field = false;
+    while (pos < block.size()) {
+        auto byte = static_cast<std::uint8_t>(block[pos]);
+        std::uint64_t index;
+
+        if (byte & 0x80) {  // indexed field
+            if (!hpack_decode_integer(block, pos, 7, index))
+                return false;
+            const hpack_field* field = table_.at(static_cast<std::size_t>(index));
+            if (!field)
+                return false;
+            fields.push_back(*field);
+        } else if ((byte & 0xe0) == 0x20) {  // dynamic table size update
+            if (any_field || !hpack_decode_integer(block, pos, 5, index) || index > limit_)
+                return false;
+            table_.resize(static_cast<std::size_t>(index));
+            continue;
+        } else {  // literal, with incremental indexing (01), without (0000) or never (0001)
+            bool indexing = (byte & 0xc0) == 0x40;
+            if (!hpack_decode_integer(block, pos, indexing ? 6 : 4, index))
+                return false;
+            hpack_field field;
+            if (index == 0) {
+                if (!decode_string(block, pos, field.name))
+                    return false;
+            } else {
+                const hpack_field* named = table_.at(static_cast<std::size_t>(index));
+                if (!named)
+                    return false;
+                field.name = named->name;
+            }
+            if (!decode_string(block, pos, field.value))
+                return false;
+            if (indexing)
+                table_.add(field.name, field.value);
+            fields.push_back(std::move(field));
+        }
+
+        any_field = true;
+        list_size += entry_size(fields.back().name, fields.back().value);
+        if (list_size > max_list_size)
+            return false;
+    }
+    return true;
+}
+
+void hpack_encoder::set_max_table_size(std::size_t max_size) {
+    if (max_size > HPACK_DEFAULT_TABLE_SIZE)
+        max_size = HPACK_DEFAULT_TABLE_SIZE;
+    if (max_size == table_.max_size())
+        return;
+    table_.resize(max_size);
+    size_update_pending_ = true;
+}
+
+void hpack_encoder::begin_block(std::string& out) {
+    if (!size_update_pending_)
+        return;
+    hpack_encode_integer(table_.max_size(), 5, 0x20, out);
+    size_update_pending_ = false;
+}
+
+void hpack_encoder::encode(std::string_view name, std::string_view value, std::string& out) {
+    bool value_matched;
+    std::size_t index = table_.find(name, value, value_matched);
+    if (value_matched) {
+        hpack_encode_integer(index, 7, 0x80, out);
+        return;
+    }
+    bool indexing = worth_indexing(name);
+    hpack_encode_integer(index, indexing ? 6 : 4, indexing ? 0x40 : 0x00, out);
+    if (index == 0)
+        encode_string(name, out);
+    encode_string(value, out);
+    if (indexing)
+        table_.add(name, value);
+}
+
+void hpack_encode_integer(std::uint64_t value, int prefix_bits, std::uint8_t first_byte_flags,
+                          std::string& out) {
+    std::uint64_t max_prefix = (1u << prefix_bits) - 1;
+    if (value < max_prefix) {
+        out.push_back(static_cast<char>(first_byte_flags | value));
+        return;
+    }
+    out.push_back(static_cast<char>(first_byte_flags | max_prefix));
+    value -= max_prefix;
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+bool hpack_decode_integer(std::string_view in, std::size_t& pos, int prefix_bits,
+                          std::uint64_t& value) noexcept {
+    if (pos >= in.size())
+        return false;
+    std::uint64_t max_prefix = (1u << prefix_bits) - 1;
+    value = static_cast<std::uint8_t>(in[pos++]) & max_prefix;
+    if (value < max_prefix)
+        return true;
+    for (int shift = 0; pos < in.size(); shift += 7) {
+        if (shift > 28)
+            return false;  // nothing in a header block needs more than 32 bits
+        auto byte = static_cast<std::uint8_t>(in[pos++]);
+        value += static_cast<std::uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+            return true;
+    }
+    return false;
+}
+
+void huffman_encode(std::string_view in, std::string& out) {
+    std::uint64_t bits = 0;
+    int pending = 0;
+    for (char ch : in) {
+        auto symbol = static_cast<std::uint8_t>(ch);
+        bits = (bits << HUFFMAN_LENGTHS[symbol]) | HUFFMAN_CODES[symbol];
+        pending += HUFFMAN_LENGTHS[symbol];
+        while (pending >= 8) {
+            pending -= 8;
+            out.push_back(static_cast<char>(bits >> pending));
+        }
+    }
+    if (pending > 0) {
+        // pad with the most significant bits of EOS, all ones
+        bits = (bits << (8 - pending)) | ((1u << (8 - pending)) - 1);
+        out.push_back(static_cast<char>(bits));
+    }
+}
+
+std::size_t huffman_encoded_size(std::string_view in) noexcept {
+    std::size_t bits = 0;
+    for (char ch : in)
+        bits += HUFFMAN_LENGTHS[static_cast<std::uint8_t>(ch)];
+    return (bits + 7) / 8;
+}
+
+bool huffman_decode(std::string_view in, std::string& out) {
+    const huffman_decoding& tables = decoding();
+    std::uint32_t code = 0;
+    int length = 0;
+    for (char ch : in) {
+        auto byte = static_cast<std::uint8_t>(ch);
+        for (int bit = 7; bit >= 0; --bit) {
+            code = (code << 1) | ((byte >> bit) & 1);
+            ++length;
+            if (code - tables.first[length] < tables.count[length]) {
+                std::uint16_t symbol = tables.sorted[tables.offset[length] + code -
+                                                     tables.first[length]];
+                if (symbol == 256)
+                    return false;
+                out.push_back(static_cast<char>(symbol));
+                code = 0;
+                length = 0;
+            } else if (length == HUFFMAN_MAX_LENGTH) {
+                return false;
+            }
+        }
+    }
+    // what is left must be padding: at most 7 bits, all ones
+    return length <= 7 && code == (1u << length) - 1;
+}
+}  // namespace cppress::http
@@ -0,0 +1,78 @@
+#include "../includes/http_body.hpp"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace cppress::http {
+
+namespace {
+int open_anonymous_file() {
+#if defined(__linux__) && defined(MFD_CLOEXEC)
+    int fd = ::memfd_create("cppress-body", MFD_CLOEXEC);
+    if (fd >= 0)
+        return fd;
+#endif
+    const char* dir = ::getenv("TMPDIR");
+    std::string path = std::string(dir && *dir ? dir : "/tmp") + "/cppress-body-XXXXXX";
+    int fd_tmp = ::mkstemp(path.data());
+    if (fd_tmp >= 0) {
+        ::unlink(path.c_str());
+        ::fcntl(fd_tmp, F_SETFD, FD_CLOEXEC);
+    }
+    return fd_tmp;
+}
+}  // namespace
+
+http_body_spool::http_body_spool() : fd_(open_anonymous_file()) {
+    if (fd_ < 0)
+        throw std::runtime_error("Failed to create body spool file: " +
+                                 std::string(std::strerror(errno)));
+}
+
+http_body_spool::~http_body_spool() {
+    if (fd_ >= 0)
+        ::close(fd_);
+}
+
+void http_body_spool::append(const char* data, std::size_t size) {
+    while (size > 0) {
+        ssize_t n = ::pwrite(fd_, data, size, static_cast<off_t>(size_));
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            throw std::runtime_error("Failed to write body spool: " +
+                                     std::string(std::strerror(errno)));
+        }
+        data += n;
+        size -= static_cast<std::size_t>(n);
+        size_ += static_cast<std::size_t>(n);
+    }
+}
+
+std::string http_body_spool::read(std::size_t offset, std::size_t length) const {
+    if (offset >= size_)
+        return {};
+    length = std::min(length, size_ - offset);
+    std::string out(length, '\0');
+    std::size_t done = 0;
+    while (done < length) {
+        ssize_t n = ::pread(fd_, out.data() + done, length - done,
+                            static_cast<off_t>(offset + done));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            throw std::runtime_error("Failed to read body spool: " +
+                                     std::string(n < 0 ? std::strerror(errno) : "short file"));
+        done += static_cast<std::size_t>(n);
+    }
+    return out;
+}
+
+}  // namespace cppress::http
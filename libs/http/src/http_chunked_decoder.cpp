@@ -0,0 +1,175 @@
+#include "../includes/http_chunked_decoder.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace cppress::http {
+
+namespace {
+/// Value of a hex digit, -1 for anything else
+inline int hex_value(char ch) noexcept {
+    if (ch >= '0' && ch <= '9')
+        return ch - '0';
+    if (ch >= 'a' && ch <= 'f')
+        return ch - 'a' + 10;
+    if (ch >= 'A' && ch <= 'F')
+        return ch - 'A' + 10;
+    return -1;
+}
+
+inline bool is_ws(char ch) noexcept { return ch == ' ' || ch == '\t'; }
+
+/// Chunk sizes above this many hex digits cannot be a body we would accept
+constexpr std::size_t MAX_SIZE_DIGITS = 15;
+
+/// The section ends with an empty line: LF LF, or LF CR LF
+bool trailer_ended(const std::string& bytes) noexcept {
+    std::size_t n = bytes.size();
+    if (n == 1 && bytes[0] == '\n')
+        return true;
+    if (n == 2 && bytes[0] == '\r' && bytes[1] == '\n')
+        return true;
+    if (n >= 2 && bytes[n - 1] == '\n' && bytes[n - 2] == '\n')
+        return true;
+    return n >= 3 && bytes[n - 1] == '\n' && bytes[n - 2] == '\r' && bytes[n - 3] == '\n';
+}
+}  // namespace
+
+/**
+ * Implementation Notes:
+ * - Chunk data is returned as one run per call, the rest of the input if
+ *   the chunk continues past it
+ * - The trailer section is copied byte by byte up to its empty line; it is
+ *   rare and small, and parsing it only at the end keeps the state small
+ */
+http_chunked_decoder::status http_chunked_decoder::next(std::string_view input, std::size_t& pos,
+                                                        http_span& run,
+                                                        std::size_t max_trailer_size) {
+    if (phase_ == phase::failed)
+        return status::error;
+    const char* p = input.data();
+    const std::size_t n = input.size();
+
+    while (pos < n && phase_ != phase::done) {
+        const char ch = p[pos];
+        switch (phase_) {
+            case phase::size: {
+                int digit = hex_value(ch);
+                if (digit < 0) {
+                    if (digits_ == 0)
+                        return fail(error_code::bad_chunk_size);
+                    phase_ = phase::size_line;
+                    break;
+                }
+                if (++digits_ > MAX_SIZE_DIGITS)
+                    return fail(error_code::too_large);
+                remaining_ = remaining_ * 16 + static_cast<std::uint64_t>(digit);
+                ++pos;
+                break;
+            }
+
+            case phase::size_line: {
+                // whitespace and extensions up to the LF
+                const void* lf = std::memchr(p + pos, '\n', n - pos);
+                std::size_t end =
+                    lf ? static_cast<std::size_t>(static_cast<const char*>(lf) - p) : n;
+                for (std::size_t i = pos; i < end && !in_extension_; ++i) {
+                    if (p[i] == ';')
+                        in_extension_ = true;  // extension text is not inspected
+                    else if (!is_ws(p[i]) && !(p[i] == '\r' && i + 1 == end))
+                        return fail(error_code::bad_chunk_size);
+                }
+                if (end == n) {
+                    pos = n;
+                    break;
+                }
+                pos = end + 1;
+                digits_ = 0;
+                in_extension_ = false;
+                phase_ = remaining_ == 0 ? phase::trailer : phase::chunk_data;
+                break;
+            }
+
+            case phase::chunk_data: {
+                std::size_t take = static_cast<std::size_t>(
+                    std::min<std::uint64_t>(remaining_, static_cast<std::uint64_t>(n - pos)));
+                run = {pos, take};
+                pos += take;
+                remaining_ -= take;
+                if (remaining_ == 0)
+                    phase_ = phase::chunk_cr;
+                return status::data;
+            }
+
+            case phase::chunk_cr:
+                ++pos;
+                if (ch == '\r')
+                    phase_ = phase::chunk_lf;
+                else if (ch == '\n')
+                    phase_ = phase::size;
+                else
+                    return fail(error_code::bad_chunk_end);
+                break;
+
+            case phase::chunk_lf:
+                ++pos;
+                if (ch != '\n')
+                    return fail(error_code::bad_chunk_end);
+                phase_ = phase::size;
+                break;
+
+            case phase::trailer:
+                trailer_bytes_.push_back(ch);
+                ++pos;
+                if (trailer_bytes_.size() > max_trailer_size)
+                    return fail(error_code::too_large);
+                if (ch == '\n' && trailer_ended(trailer_bytes_))
+                    phase_ = phase::done;
+                break;
+
+            case phase::done:
+            case phase::failed:
+                break;
+        }
+    }
+    return phase_ == phase::done ? status::complete : status::need_more;
+}
+
+std::vector<std::pair<std::string, std::string>> http_chunked_decoder::trailers() const {
+    std::vector<std::pair<std::string, std::string>> fields;
+    std::string_view bytes(trailer_bytes_);
+    while (!bytes.empty()) {
+        std::size_t lf = bytes.find('\n');
+        std::string_view line = bytes.substr(0, lf);
+        bytes.remove_prefix(lf == std::string_view::npos ? bytes.size() : lf + 1);
+        if (!line.empty() && line.back() == '\r')
+            line.remove_suffix(1);
+        std::size_t colon = line.find(':');
+        if (colon == std::string_view::npos)
+            continue;
+        std::string_view value = line.substr(colon + 1);
+        while (!value.empty() && is_ws(value.front()))
+            value.remove_prefix(1);
+        while (!value.empty() && is_ws(value.back()))
+            value.remove_suffix(1);
+        fields.emplace_back(std::string(line.substr(0, colon)), std::string(value));
+    }
+    return fields;
+}
+
+void http_chunked_decoder::reset() noexcept {
+    phase_ = phase::size;
+    error_ = error_code::none;
+    remaining_ = 0;
+    digits_ = 0;
+    in_extension_ = false;
+    trailer_bytes_.clear();
+}
+
+http_chunked_decoder::status http_chunked_decoder::fail(error_code code) noexcept {
+    phase_ = phase::failed;
+    error_ = code;
+    return status::error;
+}
+
+}  // namespace cppress::http
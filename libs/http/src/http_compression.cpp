@@ -0,0 +1,341 @@
+#include "../includes/http_compression.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <stdexcept>
+
+#ifndef CPPRESS_HAS_ZLIB
+#define CPPRESS_HAS_ZLIB 0
+#endif
+#ifndef CPPRESS_HAS_BROTLI
+#define CPPRESS_HAS_BROTLI 0
+#endif
+#ifndef CPPRESS_HAS_ZSTD
+#define CPPRESS_HAS_ZSTD 0
+#endif
+
+#if CPPRESS_HAS_ZLIB
+#include <zlib.h>
+#endif
+#if CPPRESS_HAS_BROTLI
+#include <brotli/encode.h>
+#endif
+#if CPPRESS_HAS_ZSTD
+#include <zstd.h>
+#endif
+
+namespace cppress::http {
+
+namespace {
+/// Output is produced in blocks of this size
+constexpr std::size_t OUTPUT_BLOCK = 16 * 1024;
+
+inline char lower(char ch) noexcept { return (ch >= 'A' && ch <= 'Z') ? ch - 'A' + 'a' : ch; }
+
+bool iequals(std::string_view a, std::string_view b) noexcept {
+    if (a.size() != b.size())
+        return false;
+    for (std::size_t i = 0; i < a.size(); ++i)
+        if (lower(a[i]) != lower(b[i]))
+            return false;
+    return true;
+}
+
+std::string_view trim(std::string_view s) noexcept {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t'))
+        s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t'))
+        s.remove_suffix(1);
+    return s;
+}
+
+/// q of one list element's parameters, e.g. ";q=0.5"; 1 when absent
+double quality_of(std::string_view params) noexcept {
+    while (!params.empty()) {
+        std::size_t semicolon = params.find(';');
+        std::string_view param = trim(params.substr(0, semicolon));
+        params = semicolon == std::string_view::npos ? std::string_view()
+                                                     : params.substr(semicolon + 1);
+        if (param.size() > 2 && lower(param[0]) == 'q' && param[1] == '=') {
+            std::string q(param.substr(2));
+            char* end = nullptr;
+            double value = std::strtod(q.c_str(), &end);
+            if (end == q.c_str() || value < 0)
+                return 0;
+            return value > 1 ? 1 : value;
+        }
+    }
+    return 1;
+}
+
+bool names(content_coding coding, std::string_view token) noexcept {
+    if (iequals(token, content_coding_name(coding)))
+        return true;
+    return coding == content_coding::gzip && iequals(token, "x-gzip");
+}
+
+/// Highest-q coding of [first, last), ties to the earlier; identity if none is accepted
+content_coding pick_coding(const http_headers& headers, const content_coding* first,
+                           const content_coding* last) {
+    std::string joined;
+    headers.for_each(header_id::accept_encoding, [&joined](std::string_view value) {
+        if (!joined.empty())
+            joined += ',';
+        joined.append(value);
+    });
+    if (joined.empty())
+        return content_coding::identity;  // no preference stated: send the plain body
+
+    content_coding best = content_coding::identity;
+    double best_q = 0;
+    for (; first != last; ++first) {
+        double q = accept_encoding_quality(joined, *first);
+        if (q > best_q) {
+            best = *first;
+            best_q = q;
+        }
+    }
+    return best;
+}
+
+#if CPPRESS_HAS_ZLIB
+class gzip_compressor : public http_compressor {
+public:
+    explicit gzip_compressor(int level) {
+        // 15 bits of window plus 16 selects the gzip wrapper
+        if (deflateInit2(&stream_, level < 0 ? 6 : level, Z_DEFLATED, 15 + 16, 8,
+                         Z_DEFAULT_STRATEGY) != Z_OK)
+            throw std::runtime_error("gzip: deflateInit2 failed");
+    }
+    ~gzip_compressor() override { deflateEnd(&stream_); }
+
+    std::string compress(std::string_view input, flush_mode mode) override {
+        int flush = mode == flush_mode::finish  ? Z_FINISH
+                    : mode == flush_mode::flush ? Z_SYNC_FLUSH
+                                                : Z_NO_FLUSH;
+        std::string out;
+        stream_.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+        stream_.avail_in = static_cast<uInt>(input.size());
+        do {
+            std::size_t used = out.size();
+            out.resize(used + OUTPUT_BLOCK);
+            stream_.next_out = reinterpret_cast<Bytef*>(&out[used]);
+            stream_.avail_out = static_cast<uInt>(OUTPUT_BLOCK);
+            int rc = deflate(&stream_, flush);
+            if (rc == Z_STREAM_ERROR)
+                throw std::runtime_error("gzip: deflate failed");
+            out.resize(used + OUTPUT_BLOCK - stream_.avail_out);
+        } while (stream_.avail_out == 0);
+        return out;
+    }
+
+private:
+    z_stream stream_{};
+};
+#endif
+
+#if CPPRESS_HAS_BROTLI
+class brotli_compressor : public http_compressor {
+public:
+    explicit brotli_compressor(int level)
+        : state_(BrotliEncoderCreateInstance(nullptr, nullptr, nullptr)) {
+        if (!state_)
+            throw std::runtime_error("br: BrotliEncoderCreateInstance failed");
+        BrotliEncoderSetParameter(state_, BROTLI_PARAM_QUALITY,
+                                  static_cast<std::uint32_t>(level < 0 ? 5 : level));
+        BrotliEncoderSetParameter(state_, BROTLI_PARAM_LGWIN, 22);
+    }
+    ~brotli_compressor() override { BrotliEncoderDestroyInstance(state_); }
+
+    std::string compress(std::string_view input, flush_mode mode) override {
+        BrotliEncoderOperation op = mode == flush_mode::finish  ? BROTLI_OPERATION_FINISH
+                                    : mode == flush_mode::flush ? BROTLI_OPERATION_FLUSH
+                                                                : BROTLI_OPERATION_PROCESS;
+        std::string out;
+        std::size_t available_in = input.size();
+        const auto* next_in = reinterpret_cast<const std::uint8_t*>(input.data());
+        for (;;) {
+            std::size_t used = out.size();
+            out.resize(used + OUTPUT_BLOCK);
+            std::size_t available_out = OUTPUT_BLOCK;
+            auto* next_out = reinterpret_cast<std::uint8_t*>(&out[used]);
+            if (!BrotliEncoderCompressStream(state_, op, &available_in, &next_in,
+                                             &available_out, &next_out, nullptr))
+                throw std::runtime_error("br: BrotliEncoderCompressStream failed");
+            out.resize(used + OUTPUT_BLOCK - available_out);
+            if (available_in == 0 && !BrotliEncoderHasMoreOutput(state_))
+                return out;
+        }
+    }
+
+private:
+    BrotliEncoderState* state_;
+};
+#endif
+
+#if CPPRESS_HAS_ZSTD
+class zstd_compressor : public http_compressor {
+public:
+    explicit zstd_compressor(int level) : context_(ZSTD_createCCtx()) {
+        if (!context_)
+            throw std::runtime_error("zstd: ZSTD_createCCtx failed");
+        ZSTD_CCtx_setParameter(context_, ZSTD_c_compressionLevel, level < 0 ? 3 : level);
+    }
+    ~zstd_compressor() override { ZSTD_freeCCtx(context_); }
+
+    std::string compress(std::string_view input, flush_mode mode) override {
+        ZSTD_EndDirective directive = mode == flush_mode::finish  ? ZSTD_e_end
+                                      : mode == flush_mode::flush ? ZSTD_e_flush
+                                                                  : ZSTD_e_continue;
+        std::string out;
+        ZSTD_inBuffer in{input.data(), input.size(), 0};
+        for (;;) {
+            std::size_t used = out.size();
+            out.resize(used + OUTPUT_BLOCK);
+            ZSTD_outBuffer buffer{&out[used], OUTPUT_BLOCK, 0};
+            std::size_t remaining = ZSTD_compressStream2(context_, &buffer, &in, directive);
+            if (ZSTD_isError(remaining))
+                throw std::runtime_error(std::string("zstd: ") + ZSTD_getErrorName(remaining));
+            out.resize(used + buffer.pos);
+            // continue: done once the input is consumed; flush/end: once nothing is left
+            if (directive == ZSTD_e_continue ? in.pos == in.size : remaining == 0)
+                return out;
+        }
+    }
+
+private:
+    ZSTD_CCtx* context_;
+};
+#endif
+}  // namespace
+
+std::string_view content_coding_name(content_coding coding) noexcept {
+    switch (coding) {
+        case content_coding::gzip:
+            return "gzip";
+        case content_coding::br:
+            return "br";
+        case content_coding::zstd:
+            return "zstd";
+        case content_coding::identity:
+            break;
+    }
+    return {};
+}
+
+std::string_view content_coding_suffix(content_coding coding) noexcept {
+    switch (coding) {
+        case content_coding::gzip:
+            return ".gz";
+        case content_coding::br:
+            return ".br";
+        case content_coding::zstd:
+            return ".zst";
+        case content_coding::identity:
+            break;
+    }
+    return {};
+}
+
+bool content_coding_available(content_coding coding) noexcept {
+    switch (coding) {
+        case content_coding::gzip:
+            return CPPRESS_HAS_ZLIB;
+        case content_coding::br:
+            return CPPRESS_HAS_BROTLI;
+        case content_coding::zstd:
+            return CPPRESS_HAS_ZSTD;
+        case content_coding::identity:
+            break;
+    }
+    return true;
+}
+
+/**
+ * Implementation Notes:
+ * - Elements are "coding;q=x" separated by commas; a coding's own entry
+ *   wins over "*" wherever it appears
+ * - identity is acceptable unless it, or "*" without an identity entry,
+ *   has q=0
+ */
+double accept_encoding_quality(std::string_view accept_encoding, content_coding coding) noexcept {
+    double own = -1, any = -1;
+    while (!accept_encoding.empty()) {
+        std::size_t comma = accept_encoding.find(',');
+        std::string_view element = accept_encoding.substr(0, comma);
+        accept_encoding = comma == std::string_view::npos ? std::string_view()
+                                                          : accept_encoding.substr(comma + 1);
+        std::size_t semicolon = element.find(';');
+        std::string_view token = trim(element.substr(0, semicolon));
+        double q =
+            semicolon == std::string_view::npos ? 1 : quality_of(element.substr(semicolon + 1));
+        if (coding == content_coding::identity ? iequals(token, "identity") : names(coding, token))
+            own = q > own ? q : own;
+        else if (token == "*")
+            any = q;
+    }
+    if (own >= 0)
+        return own;
+    if (any >= 0)
+        return any;
+    return coding == content_coding::identity ? 1 : 0;
+}
+
+content_coding negotiate_content_coding(const http_headers& headers,
+                                        std::initializer_list<content_coding> candidates) {
+    return pick_coding(headers, candidates.begin(), candidates.end());
+}
+
+content_coding negotiate_content_coding(const http_headers& headers) {
+    content_coding available[3];
+    std::size_t n = 0;
+    for (auto coding : {content_coding::br, content_coding::zstd, content_coding::gzip})
+        if (content_coding_available(coding))
+            available[n++] = coding;
+    return pick_coding(headers, available, available + n);
+}
+
+bool compressible_content_type(std::string_view content_type) noexcept {
+    std::string_view type = trim(content_type.substr(0, content_type.find(';')));
+    auto starts = [&type](std::string_view prefix) {
+        return type.size() >= prefix.size() && iequals(type.substr(0, prefix.size()), prefix);
+    };
+    auto ends = [&type](std::string_view suffix) {
+        return type.size() >= suffix.size() &&
+               iequals(type.substr(type.size() - suffix.size()), suffix);
+    };
+    if (starts("text/") || ends("+json") || ends("+xml"))
+        return true;
+    for (std::string_view known : {"application/json", "application/javascript",
+                                   "application/xml", "application/wasm", "font/ttf", "font/otf"})
+        if (iequals(type, known))
+            return true;
+    return false;
+}
+
+std::unique_ptr<http_compressor> http_compressor::create(content_coding coding, int level) {
+    switch (coding) {
+#if CPPRESS_HAS_ZLIB
+        case content_coding::gzip:
+            return std::make_unique<gzip_compressor>(level);
+#endif
+#if CPPRESS_HAS_BROTLI
+        case content_coding::br:
+            return std::make_unique<brotli_compressor>(level);
+#endif
+#if CPPRESS_HAS_ZSTD
+        case content_coding::zstd:
+            return std::make_unique<zstd_compressor>(level);
+#endif
+        default:
+            return nullptr;
+    }
+}
+
+std::string compress_body(content_coding coding, std::string_view body, int level) {
+    auto compressor = http_compressor::create(coding, level);
+    if (!compressor)
+        throw std::invalid_argument("compress_body: coding not available");
+    return compressor->compress(body, http_compressor::flush_mode::finish);
+}
+}  // namespace cppress::http
@@ -0,0 +1,189 @@
+#include "../includes/http_conditional.hpp"
+
+#include <sys/stat.h>
+
+#include <cstdio>
+
+namespace cppress::http {
+
+namespace {
+constexpr std::string_view months[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                       "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+
+std::string_view trim(std::string_view s) noexcept {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t'))
+        s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t'))
+        s.remove_suffix(1);
+    return s;
+}
+
+/// Splits off the next space-separated word of s
+std::string_view next_word(std::string_view& s) noexcept {
+    s = trim(s);
+    std::size_t end = s.find(' ');
+    std::string_view word = s.substr(0, end);
+    s = end == std::string_view::npos ? std::string_view() : s.substr(end);
+    return word;
+}
+
+bool parse_digits(std::string_view digits, int& value) noexcept {
+    if (digits.empty() || digits.size() > 4)
+        return false;
+    value = 0;
+    for (char ch : digits) {
+        if (ch < '0' || ch > '9')
+            return false;
+        value = value * 10 + (ch - '0');
+    }
+    return true;
+}
+
+bool parse_month(std::string_view name, int& month) noexcept {
+    for (int i = 0; i < 12; ++i)
+        if (months[i] == name) {
+            month = i + 1;
+            return true;
+        }
+    return false;
+}
+
+/// "08:49:37"
+bool parse_clock(std::string_view text, int& hour, int& minute, int& second) noexcept {
+    return text.size() == 8 && text[2] == ':' && text[5] == ':' &&
+           parse_digits(text.substr(0, 2), hour) && parse_digits(text.substr(3, 2), minute) &&
+           parse_digits(text.substr(6, 2), second) && hour < 24 && minute < 60 && second < 61;
+}
+
+/// Days since 1970-01-01 of a proleptic Gregorian date
+long long days_from_civil(int year, int month, int day) noexcept {
+    year -= month <= 2;
+    const long long era = (year >= 0 ? year : year - 399) / 400;
+    const long long year_of_era = year - era * 400;
+    const long long day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    const long long day_of_era =
+        year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + day_of_era - 719468;
+}
+
+/// Entity tag without its W/ prefix, empty if tag is not one
+std::string_view opaque_tag(std::string_view tag) noexcept {
+    tag = trim(tag);
+    if (tag.substr(0, 2) == "W/")
+        tag.remove_prefix(2);
+    if (tag.size() < 2 || tag.front() != '"' || tag.back() != '"')
+        return {};
+    return tag;
+}
+}  // namespace
+
+std::string format_http_date(std::time_t time) {
+    std::tm tm{};
+    gmtime_r(&time, &tm);
+    char text[32];
+    std::size_t length = std::strftime(text, sizeof(text), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    return std::string(text, length);
+}
+
+/**
+ * Implementation Notes:
+ * - Month names are compared exactly and the weekday is not checked, so
+ *   the result does not depend on the C locale
+ * - The date is converted by arithmetic instead of timegm, which is not
+ *   portable; two-digit RFC 850 years are read as 1970-2069
+ */
+bool parse_http_date(std::string_view value, std::time_t& time) noexcept {
+    std::string_view rest = trim(value);
+    std::string_view weekday = next_word(rest);
+    int year = 0, month = 0, day = 0, hour = 0, minute = 0, second = 0;
+
+    if (!weekday.empty() && weekday.back() == ',') {
+        std::string_view date = next_word(rest);
+        if (date.find('-') != std::string_view::npos) {
+            // RFC 850: Sunday, 06-Nov-94 08:49:37 GMT
+            if (date.size() != 9 || date[2] != '-' || date[6] != '-' ||
+                !parse_digits(date.substr(0, 2), day) || !parse_month(date.substr(3, 3), month) ||
+                !parse_digits(date.substr(7, 2), year))
+                return false;
+            year += year < 70 ? 2000 : 1900;
+        } else {
+            // IMF-fixdate: Sun, 06 Nov 1994 08:49:37 GMT
+            std::string_view month_name = next_word(rest);
+            std::string_view year_text = next_word(rest);
+            if (date.size() != 2 || !parse_digits(date, day) || !parse_month(month_name, month) ||
+                year_text.size() != 4 || !parse_digits(year_text, year))
+                return false;
+        }
+        if (!parse_clock(next_word(rest), hour, minute, second) || next_word(rest) != "GMT")
+            return false;
+    } else {
+        // asctime: Sun Nov  6 08:49:37 1994
+        std::string_view month_name = next_word(rest);
+        std::string_view day_text = next_word(rest);
+        std::string_view clock = next_word(rest);
+        std::string_view year_text = next_word(rest);
+        if (!parse_month(month_name, month) || day_text.size() > 2 ||
+            !parse_digits(day_text, day) || !parse_clock(clock, hour, minute, second) ||
+            year_text.size() != 4 || !parse_digits(year_text, year))
+            return false;
+    }
+    if (!trim(rest).empty() || day < 1 || day > 31)
+        return false;
+
+    time = static_cast<std::time_t>(days_from_civil(year, month, day) * 86400 + hour * 3600 +
+                                    minute * 60 + second);
+    return true;
+}
+
+bool etag_list_matches(std::string_view if_none_match, std::string_view etag) noexcept {
+    std::string_view own = opaque_tag(etag);
+    if (own.empty())
+        return false;
+    if (trim(if_none_match) == "*")
+        return true;
+    while (!if_none_match.empty()) {
+        // entity tags cannot contain '"' but may contain ','
+        std::size_t open = if_none_match.find('"');
+        if (open == std::string_view::npos)
+            return false;
+        std::size_t close = if_none_match.find('"', open + 1);
+        if (close == std::string_view::npos)
+            return false;
+        if (if_none_match.substr(open, close - open + 1) == own)
+            return true;
+        if_none_match.remove_prefix(close + 1);
+    }
+    return false;
+}
+
+bool not_modified(std::string_view if_none_match, std::string_view if_modified_since,
+                  std::string_view etag, std::string_view last_modified) noexcept {
+    if (!trim(if_none_match).empty())
+        return etag_list_matches(if_none_match, etag);
+    std::time_t since = 0, modified = 0;
+    if (trim(if_modified_since).empty() || !parse_http_date(if_modified_since, since) ||
+        !parse_http_date(last_modified, modified))
+        return false;
+    return modified <= since;
+}
+
+/**
+ * Implementation Notes:
+ * - The tag is weak: size and mtime say the file is unchanged for any
+ *   practical purpose but are not a byte-for-byte guarantee, which a
+ *   strong tag would claim
+ */
+bool file_validators(const std::string& path, std::string& etag, std::string& last_modified) {
+    struct stat info {};
+    if (::stat(path.c_str(), &info) != 0 || (info.st_mode & S_IFMT) != S_IFREG)
+        return false;
+    char tag[48];
+    int length = std::snprintf(tag, sizeof(tag), "W/\"%llx-%llx\"",
+                               static_cast<unsigned long long>(info.st_size),
+                               static_cast<unsigned long long>(info.st_mtime));
+    etag.assign(tag, static_cast<std::size_t>(length));
+    last_modified = format_http_date(info.st_mtime);
+    return true;
+}
+
+}  // namespace cppress::http
@@ -11,14 +11,87 @@ int MAX_FILE_DESCRIPTORS = 1024 * 32;
 /// @brief Maximum timeout for connections (in milliseconds)
 int TIMEOUT_MILLISECONDS = 1000;
 
+/// @brief Number of event loops, 1 keeps the classic single reactor
+std::size_t REACTOR_COUNT = 1;
+
+/// @brief Seconds of work for a busy server; more only grows latency
+std::size_t REQUEST_QUEUE_LIMIT = 4096;
+
+/// @brief Clients and proxies have mostly given up by then
+std::chrono::milliseconds REQUEST_QUEUE_TIMEOUT = std::chrono::milliseconds(10000);
+
+/// @brief Spreads the retries of shed clients without holding them off long
+std::chrono::seconds REQUEST_RETRY_AFTER_SECONDS = std::chrono::seconds(1);
+
+/// @brief Pin reactor threads to CPU cores
+bool PIN_REACTORS = false;
+
+/// @brief Leave placement to the scheduler unless asked
+bool NUMA_PLACEMENT = false;
+
+/// @brief Use the io_uring backend (falls back to epoll if unsupported)
+bool USE_IO_URING = false;
+
+/// @brief No Nagle or delayed-ACK stalls on small responses
+cppress::sockets::socket_options SOCKET_OPTIONS = cppress::sockets::socket_options::low_latency();
+
+/// @brief Accept prior-knowledge HTTP/2 and h2c upgrades
+bool HTTP2_ENABLED = true;
+
+/// @brief Concurrent streams per HTTP/2 connection
+std::uint32_t HTTP2_MAX_CONCURRENT_STREAMS = 100;
+
+/// @brief Room for 1 MB of request body in flight per stream before it is credited
+std::uint32_t HTTP2_INITIAL_WINDOW_SIZE = 1024 * 1024;
+
+/// @brief Enough for media players and download managers, bounds multipart work
+std::size_t MAX_RANGES = 16;
+
+/// @brief Far above any form, bounds the part headers kept per request
+std::size_t MAX_MULTIPART_PARTS = 1000;
+
+/// @brief Room for large JSON documents, bounds what one client can make the server buffer
+std::size_t WEBSOCKET_MAX_MESSAGE_SIZE = 16 * 1024 * 1024;
+
+/// @brief Below the usual 60 s idle cut-off of proxies and NAT tables
+std::chrono::seconds WEBSOCKET_PING_INTERVAL_SECONDS = std::chrono::seconds(30);
+
+/// @brief A live client answers a ping within a round trip
+std::chrono::seconds WEBSOCKET_PONG_TIMEOUT_SECONDS = std::chrono::seconds(10);
+
+/// @brief Do not keep half-closed sockets around for clients that never answer
+std::chrono::seconds WEBSOCKET_CLOSE_TIMEOUT_SECONDS = std::chrono::seconds(5);
+
+/// @brief Text protocols compress well, and the client has to offer it first
+bool WEBSOCKET_DEFLATE = true;
+
+/// @brief Rides out a short stall; a client further behind is better off reconnecting
+std::size_t SSE_MAX_LAGGED_EVENTS = 16;
+
 }  // namespace config
 namespace config {
 /// @brief Maximum idle time for connections before cleanup (in seconds)
 std::chrono::seconds MAX_IDLE_TIME_SECONDS = std::chrono::seconds(5);
+/// @brief Maximum time to receive the request headers (in seconds)
+std::chrono::seconds MAX_HEADER_READ_TIME_SECONDS = std::chrono::seconds(10);
+/// @brief Maximum gap between two body reads (in seconds)
+std::chrono::seconds MAX_BODY_READ_TIME_SECONDS = std::chrono::seconds(30);
+/// @brief Pause reading a connection with more than this many queued response bytes
+size_t WRITE_HIGH_WATERMARK = 4 * 1024 * 1024;
+/// @brief Resume reading once the queued response bytes drop to this
+size_t WRITE_LOW_WATERMARK = 1024 * 1024;
+/// @brief No cap: the descriptor limit bounds connections
+size_t MAX_CONNECTIONS = 0;
+/// @brief Send large responses (multi-MB exports) without copying them into the kernel
+size_t ZEROCOPY_THRESHOLD = 256 * 1024;
 /// @brief Maximum size of HTTP headers (in bytes)
 size_t MAX_HEADER_SIZE = 1024 * 16;
 /// @brief Maximum size of HTTP body (in bytes)
 size_t MAX_BODY_SIZE = 1024 * 1024 * 5;  // 5 MB
+/// @brief Keep every body in memory unless set
+size_t BODY_SPILL_THRESHOLD = 0;
+/// @brief Maximum size of a streamed or spilled HTTP body (in bytes)
+size_t MAX_STREAMED_BODY_SIZE = 1024ull * 1024 * 1024;  // 1 GB
 
 }  // namespace config
 
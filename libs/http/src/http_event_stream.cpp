@@ -0,0 +1,163 @@
+#include "../includes/http_event_stream.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+#include "../includes/http_consts.hpp"
+
+namespace cppress::http {
+
+namespace {
+/// Appends "name: value\n" for every line of value; CR, LF and CRLF all end a line
+void append_lines(std::string& out, const char* name, const std::string& value) {
+    std::size_t start = 0;
+    for (;;) {
+        std::size_t end = value.find_first_of("\r\n", start);
+        out.append(name).append(": ").append(value, start,
+                                               end == std::string::npos ? std::string::npos
+                                                                        : end - start);
+        out.push_back('\n');
+        if (end == std::string::npos)
+            return;
+        start = end + (value.compare(end, 2, "\r\n") == 0 ? 2 : 1);
+    }
+}
+
+cppress::sockets::data_buffer as_chunk(const std::string& body) {
+    char size_line[20];
+    int n = std::snprintf(size_line, sizeof(size_line), "%zx\r\n", body.size());
+    std::string chunk;
+    chunk.reserve(static_cast<std::size_t>(n) + body.size() + 2);
+    chunk.append(size_line, static_cast<std::size_t>(n)).append(body).append("\r\n");
+    return cppress::sockets::data_buffer(std::move(chunk));
+}
+}  // namespace
+
+std::string format_sse_event(const sse_event& event) {
+    std::string out;
+    out.reserve(event.data.size() + event.id.size() + event.event.size() + 32);
+    // an id or event name cannot span lines, only the first one is kept
+    if (!event.id.empty())
+        out.append("id: ").append(event.id.substr(0, event.id.find_first_of("\r\n"))).append("\n");
+    if (!event.event.empty())
+        out.append("event: ")
+            .append(event.event.substr(0, event.event.find_first_of("\r\n")))
+            .append("\n");
+    if (event.retry.count() > 0)
+        out.append("retry: ").append(std::to_string(event.retry.count())).append("\n");
+    append_lines(out, "data", event.data);
+    out.push_back('\n');
+    return out;
+}
+
+cppress::sockets::data_buffer encode_sse_event(const sse_event& event) {
+    return as_chunk(format_sse_event(event));
+}
+
+sse_subscriber::sse_subscriber(send_function send, state_function state,
+                               std::shared_ptr<void> owner)
+    : send_(std::move(send)), state_(std::move(state)), owner_(std::move(owner)) {}
+
+bool sse_subscriber::send(const sse_event& event) { return send(encode_sse_event(event)); }
+
+bool sse_subscriber::send(const cppress::sockets::data_buffer& chunk) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (closed_)
+        return false;
+    if (state_ && state_() == output_state::closed) {
+        closed_ = true;
+        return false;
+    }
+    // the copy shares the chunk's storage
+    std::vector<cppress::sockets::output_segment> segments;
+    segments.emplace_back(cppress::sockets::data_buffer(chunk));
+    send_(std::move(segments), false);
+    return true;
+}
+
+bool sse_subscriber::comment(const std::string& text) {
+    return send(as_chunk(": " + text.substr(0, text.find_first_of("\r\n")) + "\n\n"));
+}
+
+void sse_subscriber::close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (closed_)
+        return;
+    closed_ = true;
+    std::vector<cppress::sockets::output_segment> segments;
+    segments.emplace_back(cppress::sockets::data_buffer(std::string("0\r\n\r\n")));
+    send_(std::move(segments), true);
+}
+
+bool sse_subscriber::is_closed() const { return state() == output_state::closed; }
+
+output_state sse_subscriber::state() const {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (closed_)
+            return output_state::closed;
+    }
+    return state_ ? state_() : output_state::writable;
+}
+
+void sse_channel::subscribe(std::shared_ptr<sse_subscriber> subscriber) {
+    if (!subscriber)
+        return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    subscribers_.push_back(std::move(subscriber));
+}
+
+/**
+ * Implementation Notes:
+ * - The lock is held for the whole fan-out, so concurrent publishers reach
+ *   every subscriber in the same order
+ * - Queuing never blocks: it appends a reference to the shared chunk to the
+ *   connection's output chain and wakes its event loop
+ */
+std::size_t sse_channel::publish(const sse_event& event) {
+    const cppress::sockets::data_buffer chunk = encode_sse_event(event);
+    std::size_t delivered = 0;
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto keep = std::remove_if(
+        subscribers_.begin(), subscribers_.end(),
+        [&](const std::shared_ptr<sse_subscriber>& subscriber) {
+            switch (subscriber->state()) {
+                case output_state::closed:
+                    return true;
+                case output_state::congested:
+                    subscriber->lag_.fetch_add(1, std::memory_order_relaxed);
+                    if (++subscriber->skipped_in_a_row_ > config::SSE_MAX_LAGGED_EVENTS) {
+                        subscriber->close();
+                        dropped_.fetch_add(1, std::memory_order_relaxed);
+                        return true;
+                    }
+                    return false;
+                case output_state::writable:
+                    break;
+            }
+            subscriber->skipped_in_a_row_ = 0;
+            if (!subscriber->send(chunk))
+                return true;
+            ++delivered;
+            return false;
+        });
+    subscribers_.erase(keep, subscribers_.end());
+    return delivered;
+}
+
+std::size_t sse_channel::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return subscribers_.size();
+}
+
+void sse_channel::close_all() {
+    std::vector<std::shared_ptr<sse_subscriber>> subscribers;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        subscribers.swap(subscribers_);
+    }
+    for (auto& subscriber : subscribers)
+        subscriber->close();
+}
+
+}  // namespace cppress::http
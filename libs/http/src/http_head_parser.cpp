@@ -0,0 +1,205 @@
+#include "../includes/http_head_parser.hpp"
+
+#include <cstring>
+
+#include "../includes/http_scan.hpp"
+
+namespace cppress::http {
+
+namespace {
+inline bool is_ws(char ch) noexcept { return ch == ' ' || ch == '\t'; }
+
+inline bool is_eol(char ch) noexcept { return ch == '\r' || ch == '\n'; }
+
+/// First LF at or after from, n if none
+std::size_t find_line_end(const char* p, std::size_t from, std::size_t n) noexcept {
+    const void* lf = std::memchr(p + from, '\n', n - from);
+    return lf ? static_cast<std::size_t>(static_cast<const char*>(lf) - p) : n;
+}
+
+/// First colon or LF at or after from, n if none
+std::size_t find_name_end(const char* p, std::size_t from, std::size_t n) noexcept {
+    while (from < n && p[from] != ':' && p[from] != '\n')
+        ++from;
+    return from;
+}
+}  // namespace
+
+/**
+ * Implementation Notes:
+ * - Each phase consumes a run of bytes with one scan and records the span
+ *   it ends; a run cut by the end of input leaves pos_ at the end and the
+ *   span start in mark_, so the next call carries on from there
+ * - Runs are found with the vectorized scans of http_scan.hpp; bytes no
+ *   element may contain (control characters, non-token method bytes) fail
+ *   the head, while header names that are not tokens are still tolerated
+ * - The size limit counts every byte of the head, request line included
+ */
+http_head_parser::status http_head_parser::parse(std::string_view input,
+                                                 std::size_t max_head_size) {
+    if (phase_ == phase::failed)
+        return status::error;
+    const char* p = input.data();
+    const std::size_t n = input.size();
+
+    while (pos_ < n && phase_ != phase::done) {
+        const char ch = p[pos_];
+        switch (phase_) {
+            case phase::leading_eol:
+                if (is_eol(ch)) {
+                    ++pos_;
+                } else {
+                    mark_ = pos_;
+                    phase_ = phase::method;
+                }
+                break;
+
+            case phase::method:
+            case phase::uri: {
+                bool is_method = phase_ == phase::method;
+                std::size_t end = is_method ? scan::token_end(p, pos_, n)
+                                            : scan::target_end(p, pos_, n);
+                pos_ = end;
+                if (end == n)
+                    break;
+                if (!is_ws(p[end]))
+                    return fail(error_code::bad_request_line);
+                (is_method ? method_ : uri_) = {mark_, end - mark_};
+                phase_ = is_method ? phase::after_method : phase::after_uri;
+                break;
+            }
+
+            case phase::after_method:
+            case phase::after_uri:
+                if (is_ws(ch)) {
+                    ++pos_;
+                } else if (is_eol(ch)) {
+                    return fail(error_code::bad_request_line);
+                } else {
+                    mark_ = pos_;
+                    phase_ = phase_ == phase::after_method ? phase::uri : phase::version;
+                }
+                break;
+
+            case phase::version: {
+                std::size_t end = scan::target_end(p, pos_, n);
+                pos_ = end;
+                if (end == n)
+                    break;
+                if (!is_ws(p[end]) && !is_eol(p[end]))
+                    return fail(error_code::bad_request_line);
+                version_ = {mark_, end - mark_};
+                phase_ = phase::request_line_end;
+                break;
+            }
+
+            case phase::request_line_end:
+            case phase::field_skip: {
+                // Whatever follows the version, or a header line without a colon
+                std::size_t end = find_line_end(p, pos_, n);
+                pos_ = end == n ? n : end + 1;
+                if (end != n)
+                    phase_ = phase::field_start;
+                break;
+            }
+
+            case phase::field_start:
+                ++pos_;
+                if (ch == '\r') {
+                    phase_ = phase::final_lf;
+                } else if (ch == '\n') {
+                    phase_ = phase::done;
+                } else {
+                    mark_ = pos_ - 1;
+                    phase_ = phase::field_name;
+                }
+                break;
+
+            case phase::field_name: {
+                std::size_t end = scan::token_end(p, pos_, n);
+                if (end != n && p[end] != ':')
+                    end = find_name_end(p, end, n);  // not a token: tolerated up to ':' or LF
+                pos_ = end == n ? n : end + 1;
+                if (end == n)
+                    break;
+                if (p[end] == '\n') {
+                    phase_ = phase::field_start;  // no colon: ignored
+                    break;
+                }
+                name_ = {mark_, end - mark_};
+                phase_ = phase::field_ws;
+                break;
+            }
+
+            case phase::field_ws:
+                if (is_ws(ch)) {
+                    ++pos_;
+                } else {
+                    mark_ = pos_;
+                    phase_ = phase::field_value;
+                }
+                break;
+
+            case phase::field_value: {
+                std::size_t end = scan::value_end(p, pos_, n);
+                pos_ = end;
+                if (end == n)
+                    break;
+                if (p[end] == '\r') {
+                    ++pos_;  // trimmed below once the LF is found
+                    break;
+                }
+                if (p[end] != '\n')
+                    return fail(error_code::bad_header);
+                pos_ = end + 1;
+                std::size_t value_end = end;
+                while (value_end > mark_ && (is_ws(p[value_end - 1]) || p[value_end - 1] == '\r'))
+                    --value_end;
+                add_field(name_, {mark_, value_end - mark_});
+                phase_ = phase::field_start;
+                break;
+            }
+
+            case phase::final_lf:
+                if (ch != '\n')
+                    return fail(error_code::bad_header);
+                ++pos_;
+                phase_ = phase::done;
+                break;
+
+            case phase::done:
+            case phase::failed:
+                break;
+        }
+    }
+
+    if (pos_ > max_head_size)
+        return fail(error_code::too_large);
+    return phase_ == phase::done ? status::complete : status::need_more;
+}
+
+void http_head_parser::reset() noexcept {
+    phase_ = phase::leading_eol;
+    error_ = error_code::none;
+    pos_ = 0;
+    mark_ = 0;
+    method_ = uri_ = version_ = name_ = http_span{};
+    overflow_.clear();
+    count_ = 0;
+}
+
+http_head_parser::status http_head_parser::fail(error_code code) noexcept {
+    phase_ = phase::failed;
+    error_ = code;
+    return status::error;
+}
+
+void http_head_parser::add_field(http_span name, http_span value) {
+    if (count_ < INLINE_FIELDS)
+        inline_[count_] = {name, value};
+    else
+        overflow_.push_back({name, value});
+    ++count_;
+}
+
+}  // namespace cppress::http
@@ -0,0 +1,157 @@
+#include "../includes/http_head_writer.hpp"
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+
+#include "shared/includes/perfect_hash.hpp"
+
+namespace cppress::http {
+
+namespace {
+struct status_entry {
+    int code;
+    std::string_view reason;
+    std::string_view line;
+};
+
+#define CPPRESS_STATUS(code, reason) \
+    status_entry { code, reason, "HTTP/1.1 " #code " " reason "\r\n" }
+
+constexpr std::array<status_entry, 22> status_lines = {
+    CPPRESS_STATUS(100, "Continue"),
+    CPPRESS_STATUS(101, "Switching Protocols"),
+    CPPRESS_STATUS(200, "OK"),
+    CPPRESS_STATUS(201, "Created"),
+    CPPRESS_STATUS(202, "Accepted"),
+    CPPRESS_STATUS(204, "No Content"),
+    CPPRESS_STATUS(206, "Partial Content"),
+    CPPRESS_STATUS(301, "Moved Permanently"),
+    CPPRESS_STATUS(302, "Found"),
+    CPPRESS_STATUS(304, "Not Modified"),
+    CPPRESS_STATUS(307, "Temporary Redirect"),
+    CPPRESS_STATUS(308, "Permanent Redirect"),
+    CPPRESS_STATUS(400, "Bad Request"),
+    CPPRESS_STATUS(401, "Unauthorized"),
+    CPPRESS_STATUS(403, "Forbidden"),
+    CPPRESS_STATUS(404, "Not Found"),
+    CPPRESS_STATUS(405, "Method Not Allowed"),
+    CPPRESS_STATUS(413, "Content Too Large"),
+    CPPRESS_STATUS(429, "Too Many Requests"),
+    CPPRESS_STATUS(500, "Internal Server Error"),
+    CPPRESS_STATUS(502, "Bad Gateway"),
+    CPPRESS_STATUS(503, "Service Unavailable"),
+};
+
+#undef CPPRESS_STATUS
+
+constexpr int FIRST_STATUS = 100;
+constexpr int LAST_STATUS = 599;
+
+/// Position in status_lines of each code from 100 to 599, 0xff for codes not in it
+constexpr std::array<std::uint8_t, LAST_STATUS - FIRST_STATUS + 1> make_status_index() {
+    std::array<std::uint8_t, LAST_STATUS - FIRST_STATUS + 1> index{};
+    for (auto& at : index)
+        at = 0xff;
+    for (std::size_t i = 0; i < status_lines.size(); ++i)
+        index[static_cast<std::size_t>(status_lines[i].code - FIRST_STATUS)] =
+            static_cast<std::uint8_t>(i);
+    return index;
+}
+
+constexpr auto status_index = make_status_index();
+
+const status_entry* find_status(int code) noexcept {
+    if (code < FIRST_STATUS || code > LAST_STATUS)
+        return nullptr;
+    const std::uint8_t at = status_index[static_cast<std::size_t>(code - FIRST_STATUS)];
+    return at == 0xff ? nullptr : &status_lines[at];
+}
+
+/// Response header names handlers set most, in their upper-case spelling
+constexpr std::array<std::string_view, 20> well_known_headers = {
+    "ACCEPT-RANGES", "ACCESS-CONTROL-ALLOW-ORIGIN", "CACHE-CONTROL", "CONNECTION",
+    "CONTENT-DISPOSITION", "CONTENT-ENCODING", "CONTENT-LENGTH", "CONTENT-TYPE",
+    "DATE", "ETAG", "EXPIRES", "KEEP-ALIVE",
+    "LAST-MODIFIED", "LOCATION", "SERVER", "SET-COOKIE",
+    "TRAILER", "TRANSFER-ENCODING", "VARY", "WWW-AUTHENTICATE",
+};
+
+constexpr shared::perfect_hash<well_known_headers.size(), true> well_known_table(
+    well_known_headers);
+
+/// The Date line of the second it was formatted in
+struct date_cache {
+    std::time_t second = -1;
+    char line[48] = {};
+    std::size_t length = 0;
+};
+}  // namespace
+
+std::string_view http_status_line(int code, std::string_view reason) noexcept {
+    const status_entry* entry = find_status(code);
+    return entry && entry->reason == reason ? entry->line : std::string_view();
+}
+
+std::string_view http_reason_phrase(int code) noexcept {
+    const status_entry* entry = find_status(code);
+    return entry ? entry->reason : std::string_view();
+}
+
+/**
+ * Implementation Notes:
+ * - One cache per thread: every event loop and worker formats the line
+ *   once per second and never shares it, so no lock is needed
+ */
+std::string_view http_date_line() {
+    thread_local date_cache cache;
+    std::time_t now = std::time(nullptr);
+    if (now != cache.second) {
+        std::tm tm{};
+        gmtime_r(&now, &tm);
+        cache.length = std::strftime(cache.line, sizeof(cache.line),
+                                     "Date: %a, %d %b %Y %H:%M:%S GMT\r\n", &tm);
+        cache.second = now;
+    }
+    return std::string_view(cache.line, cache.length);
+}
+
+std::string_view http_well_known_header(std::string_view name) noexcept {
+    const std::size_t at = well_known_table.find(name);
+    return at == well_known_table.NONE ? std::string_view() : well_known_headers[at];
+}
+
+std::string write_http_head(std::string_view version, int code, std::string_view reason,
+                            const std::multimap<std::string, std::string>& headers) {
+    std::string_view status =
+        version == "HTTP/1.1" ? http_status_line(code, reason) : std::string_view();
+    char code_text[12];
+    int code_length = 0;
+    if (status.empty())
+        code_length = std::snprintf(code_text, sizeof(code_text), "%d", code);
+    std::string_view date = http_date_line();
+
+    std::size_t size = status.empty()
+                           ? version.size() + 1 + static_cast<std::size_t>(code_length) + 1 +
+                                 reason.size() + 2
+                           : status.size();
+    size += date.size() + 2;
+    for (const auto& header : headers)
+        size += header.first.size() + 2 + header.second.size() + 2;
+
+    std::string head;
+    head.reserve(size);
+    if (status.empty()) {
+        head.append(version).append(" ").append(code_text, code_length).append(" ");
+        head.append(reason).append("\r\n");
+    } else {
+        head.append(status);
+    }
+    head.append(date);
+    for (const auto& header : headers)
+        head.append(header.first).append(": ").append(header.second).append("\r\n");
+    head.append("\r\n");
+    return head;
+}
+}  // namespace cppress::http
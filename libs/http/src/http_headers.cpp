@@ -0,0 +1,147 @@
+#include "../includes/http_headers.hpp"
+
+#include <stdexcept>
+
+namespace cppress::http {
+
+namespace {
+/// Canonical names, indexed by header_id
+constexpr std::array<std::string_view, HEADER_ID_COUNT> names = {
+    "",
+    "Accept",
+    "Accept-Encoding",
+    "Accept-Language",
+    "Authorization",
+    "Cache-Control",
+    "Connection",
+    "Content-Length",
+    "Content-Type",
+    "Cookie",
+    "Expect",
+    "Host",
+    "If-Modified-Since",
+    "If-None-Match",
+    "Origin",
+    "Range",
+    "Referer",
+    "traceparent",
+    "Transfer-Encoding",
+    "Upgrade",
+    "User-Agent",
+};
+
+inline char lower(char ch) noexcept { return (ch >= 'A' && ch <= 'Z') ? ch - 'A' + 'a' : ch; }
+
+bool iequals(std::string_view a, std::string_view b) noexcept {
+    if (a.size() != b.size())
+        return false;
+    for (std::size_t i = 0; i < a.size(); ++i)
+        if (lower(a[i]) != lower(b[i]))
+            return false;
+    return true;
+}
+}  // namespace
+
+header_id http_header_id(std::string_view name) noexcept {
+    for (std::size_t i = 1; i < names.size(); ++i)
+        if (iequals(name, names[i]))
+            return static_cast<header_id>(i);
+    return header_id::other;
+}
+
+std::string_view http_header_name(header_id id) noexcept {
+    return names[static_cast<std::size_t>(id)];
+}
+
+/**
+ * Implementation Notes:
+ * - The name is resolved here, once per field; lookups by a known name
+ *   resolve the argument and then only compare ids
+ */
+void http_headers::add(std::string_view name, std::string_view value) {
+    if (text_.size() + name.size() + value.size() >= NONE || count_ >= NONE)
+        throw std::length_error("http_headers: too many header bytes");
+    entry e{http_header_id(name), static_cast<std::uint32_t>(text_.size()),
+            static_cast<std::uint32_t>(name.size()), static_cast<std::uint32_t>(value.size())};
+    text_.append(name);
+    text_.append(value);
+
+    auto& first = first_[index_of(e.id)];
+    if (first == NONE)
+        first = static_cast<std::uint32_t>(count_);
+    if (count_ < INLINE_FIELDS)
+        inline_[count_] = e;
+    else
+        overflow_.push_back(e);
+    ++count_;
+}
+
+void http_headers::clear() noexcept {
+    text_.clear();
+    overflow_.clear();
+    count_ = 0;
+    first_.fill(NONE);
+}
+
+http_header http_headers::operator[](std::size_t i) const noexcept {
+    const entry& e = field(i);
+    std::string_view text(text_);
+    return {text.substr(e.name_offset, e.name_length),
+            text.substr(e.name_offset + e.name_length, e.value_length)};
+}
+
+bool http_headers::contains(std::string_view name) const noexcept {
+    header_id id = http_header_id(name);
+    if (id != header_id::other)
+        return contains(id);
+    for (std::size_t i = 0; i < count_; ++i)
+        if (field(i).id == header_id::other && iequals((*this)[i].name, name))
+            return true;
+    return false;
+}
+
+std::string_view http_headers::get(header_id id) const noexcept {
+    std::uint32_t first = first_[index_of(id)];
+    return first == NONE ? std::string_view() : (*this)[first].value;
+}
+
+std::string_view http_headers::get(std::string_view name) const noexcept {
+    header_id id = http_header_id(name);
+    if (id != header_id::other)
+        return get(id);
+    for (std::size_t i = 0; i < count_; ++i)
+        if (field(i).id == header_id::other && iequals((*this)[i].name, name))
+            return (*this)[i].value;
+    return {};
+}
+
+std::size_t http_headers::count(header_id id) const noexcept {
+    std::size_t n = 0;
+    for_each(id, [&n](std::string_view) { ++n; });
+    return n;
+}
+
+std::size_t http_headers::count(std::string_view name) const noexcept {
+    header_id id = http_header_id(name);
+    if (id != header_id::other)
+        return count(id);
+    std::size_t n = 0;
+    for (std::size_t i = 0; i < count_; ++i)
+        if (field(i).id == header_id::other && iequals((*this)[i].name, name))
+            ++n;
+    return n;
+}
+
+std::vector<std::string> http_headers::values(std::string_view name) const {
+    std::vector<std::string> result;
+    header_id id = http_header_id(name);
+    for (std::size_t i = 0; i < count_; ++i) {
+        if (field(i).id != id)
+            continue;
+        auto header = (*this)[i];
+        if (id != header_id::other || iequals(header.name, name))
+            result.emplace_back(header.value);
+    }
+    return result;
+}
+}  // namespace cppress::http
@@ -0,0 +1,327 @@
+#include "../includes/http_multipart.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+
+#include "../includes/http_consts.hpp"
+
+namespace cppress::http {
+
+namespace {
+std::string_view trim(std::string_view s) noexcept {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t'))
+        s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t'))
+        s.remove_suffix(1);
+    return s;
+}
+
+bool equals_ignore_case(std::string_view a, std::string_view b) noexcept {
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+               return (x | 0x20) == (y | 0x20);
+           });
+}
+
+/**
+ * @brief Value of a parameter of a header like Content-Disposition
+ * @param value Header value; parameters follow the first ';'
+ * @param key Parameter name, compared case-insensitively
+ * @param out Set to the value, a quoted string unquoted
+ */
+bool header_parameter(std::string_view value, std::string_view key, std::string& out) {
+    std::size_t pos = value.find(';');
+    while (pos != std::string_view::npos && pos < value.size()) {
+        ++pos;  // past ';'
+        std::size_t eq = value.find_first_of("=;", pos);
+        if (eq == std::string_view::npos)
+            return false;
+        std::string_view name = trim(value.substr(pos, eq - pos));
+        if (value[eq] == ';') {
+            pos = eq;  // a parameter without value
+            continue;
+        }
+        pos = eq + 1;
+        while (pos < value.size() && (value[pos] == ' ' || value[pos] == '\t'))
+            ++pos;
+        std::string text;
+        if (pos < value.size() && value[pos] == '"') {
+            // quoted-string, a backslash escapes the next character
+            for (++pos; pos < value.size() && value[pos] != '"'; ++pos) {
+                if (value[pos] == '\\' && pos + 1 < value.size())
+                    ++pos;
+                text.push_back(value[pos]);
+            }
+            pos = value.find(';', pos);
+        } else {
+            std::size_t end = value.find(';', pos);
+            text = std::string(trim(value.substr(pos, end - pos)));
+            pos = end;
+        }
+        if (equals_ignore_case(name, key)) {
+            out = std::move(text);
+            return true;
+        }
+    }
+    return false;
+}
+}  // namespace
+
+multipart_sink multipart_file_sink(const std::string& path) {
+    auto file = std::make_shared<std::ofstream>(path, std::ios::binary | std::ios::trunc);
+    if (!*file)
+        throw std::runtime_error("Cannot create multipart file: " + path);
+    return [file](std::string_view piece, bool last) {
+        file->write(piece.data(), static_cast<std::streamsize>(piece.size()));
+        if (last)
+            file->close();
+        if (!*file)
+            throw std::runtime_error("Error writing multipart file");
+    };
+}
+
+bool multipart_boundary(std::string_view content_type, std::string& boundary) {
+    std::string_view type = trim(content_type.substr(0, content_type.find(';')));
+    if (type.size() < 10 || !equals_ignore_case(type.substr(0, 10), "multipart/"))
+        return false;
+    std::string value;
+    if (!header_parameter(content_type, "boundary", value) || value.empty() ||
+        value.size() > 70)
+        return false;
+    boundary = std::move(value);
+    return true;
+}
+
+multipart_parser::multipart_parser(std::string_view boundary, multipart_sink_selector selector)
+    : delimiter_("\r\n--" + std::string(boundary)),
+      searcher_(delimiter_.data(), delimiter_.data() + delimiter_.size()),
+      selector_(std::move(selector)),
+      carry_("\r\n") {}
+
+bool multipart_parser::feed(std::string_view data) {
+    while (!data.empty() && state_ != state::done && state_ != state::failed)
+        data.remove_prefix(consume(data));
+    return state_ != state::failed;
+}
+
+bool multipart_parser::finish() {
+    if (state_ != state::done && state_ != state::failed)
+        fail();  // cut before the closing delimiter
+    return complete();
+}
+
+const multipart_part* multipart_parser::find(std::string_view name) const noexcept {
+    for (const auto& part : parts_)
+        if (part.name == name)
+            return &part;
+    return nullptr;
+}
+
+std::size_t multipart_parser::consume(std::string_view data) {
+    switch (state_) {
+        case state::preamble:
+        case state::content:
+            return consume_until_delimiter(data);
+        case state::delimiter:
+            return consume_after_delimiter(data);
+        case state::headers:
+            return consume_headers(data);
+        default:
+            return data.size();
+    }
+}
+
+/**
+ * Implementation Notes:
+ * - The delimiter is searched with Boyer-Moore-Horspool, which skips up to
+ *   its length per comparison; pieces are passed on as views, never copied
+ * - Only a tail shorter than the delimiter that could start one is kept
+ *   between pieces, and checked against the start of the next piece
+ */
+std::size_t multipart_parser::consume_until_delimiter(std::string_view data) {
+    const std::size_t length = delimiter_.size();
+    const std::string_view delimiter(delimiter_);
+
+    if (!carry_.empty()) {
+        for (std::size_t i = 0; i < carry_.size(); ++i) {
+            std::size_t in_carry = carry_.size() - i;
+            if (std::string_view(carry_).substr(i) != delimiter.substr(0, in_carry))
+                continue;
+            std::size_t wanted = length - in_carry;
+            std::size_t have = std::min(wanted, data.size());
+            if (data.substr(0, have) != delimiter.substr(in_carry, have))
+                continue;
+            if (!emit(std::string_view(carry_).substr(0, i)))
+                return data.size();
+            if (have < wanted) {
+                // still undecided, wait for more
+                carry_.erase(0, i);
+                carry_.append(data);
+                return data.size();
+            }
+            carry_.clear();
+            at_delimiter();
+            return wanted;
+        }
+        if (!emit(carry_))
+            return data.size();
+        carry_.clear();
+    }
+
+    auto found = searcher_(data.data(), data.data() + data.size());
+    if (found.first != data.data() + data.size()) {
+        std::size_t at = static_cast<std::size_t>(found.first - data.data());
+        if (emit(data.substr(0, at)))
+            at_delimiter();
+        return at + length;
+    }
+
+    // the longest tail that is a proper prefix of the delimiter
+    std::size_t keep = 0;
+    for (std::size_t j = data.size() - std::min(length - 1, data.size()); j < data.size(); ++j) {
+        if (data[j] == '\r' && data.substr(j) == delimiter.substr(0, data.size() - j)) {
+            keep = data.size() - j;
+            break;
+        }
+    }
+    if (emit(data.substr(0, data.size() - keep)))
+        carry_.assign(data.substr(data.size() - keep));
+    return data.size();
+}
+
+std::size_t multipart_parser::consume_after_delimiter(std::string_view data) {
+    std::size_t used = 0;
+    while (used < data.size()) {
+        char ch = data[used++];
+        head_.push_back(ch);
+        if (head_[0] == '-') {
+            if (head_.size() == 1)
+                continue;
+            if (ch != '-') {
+                fail();
+                return data.size();
+            }
+            state_ = state::done;  // the close delimiter, the rest is epilogue
+            return data.size();
+        }
+        if (ch == '\n' && head_.size() >= 2 && head_[head_.size() - 2] == '\r') {
+            head_ = "\r\n";  // the CRLF that ends an empty header block can now match
+            state_ = state::headers;
+            return used;
+        }
+        // transport padding before the CRLF
+        if ((ch != ' ' && ch != '\t' && ch != '\r') || head_.size() > 256) {
+            fail();
+            return data.size();
+        }
+    }
+    return used;
+}
+
+std::size_t multipart_parser::consume_headers(std::string_view data) {
+    const std::size_t limit = config::MAX_HEADER_SIZE + 4;
+    std::size_t before = head_.size();
+    std::size_t taken = std::min(data.size(), limit - std::min(limit, before));
+    head_.append(data.data(), taken);
+
+    std::size_t end = head_.find("\r\n\r\n", before < 3 ? 0 : before - 3);
+    if (end == std::string::npos) {
+        if (head_.size() >= limit)
+            fail();
+        return state_ == state::failed ? data.size() : taken;
+    }
+    std::size_t used = end + 4 - before;
+    // head_ starts with the CRLF of the delimiter line, so an empty block matches too
+    std::string block = end > 2 ? head_.substr(2, end - 2) : std::string();
+    head_.clear();
+    if (!begin_part(block))
+        return data.size();
+    state_ = state::content;
+    return used;
+}
+
+bool multipart_parser::at_delimiter() {
+    if (state_ == state::content && !end_part())
+        return false;
+    state_ = state::delimiter;
+    head_.clear();
+    return true;
+}
+
+bool multipart_parser::begin_part(std::string_view block) {
+    if (parts_.size() >= config::MAX_MULTIPART_PARTS)
+        return fail();
+    multipart_part part;
+    while (!block.empty()) {
+        std::size_t eol = block.find("\r\n");
+        std::string_view line = block.substr(0, eol);
+        block = eol == std::string_view::npos ? std::string_view() : block.substr(eol + 2);
+        std::size_t colon = line.find(':');
+        if (colon == std::string_view::npos || colon == 0)
+            return fail();
+        part.headers.add(trim(line.substr(0, colon)), trim(line.substr(colon + 1)));
+    }
+
+    std::string_view disposition = part.headers.get("Content-Disposition");
+    header_parameter(disposition, "name", part.name);
+    header_parameter(disposition, "filename", part.filename);
+    std::string_view type = part.headers.get("Content-Type");
+    if (!type.empty())
+        part.content_type = std::string(type);
+    parts_.push_back(std::move(part));
+
+    if (selector_) {
+        try {
+            sink_ = selector_(parts_.back());
+        } catch (const std::exception&) {
+            return fail();
+        }
+    }
+    return true;
+}
+
+bool multipart_parser::emit(std::string_view piece) {
+    if (state_ != state::content || piece.empty())
+        return state_ != state::failed;
+    auto& part = parts_.back();
+    part.size += piece.size();
+    if (sink_) {
+        try {
+            sink_(piece, false);
+        } catch (const std::exception&) {
+            return fail();
+        }
+        return true;
+    }
+    memory_size_ += piece.size();
+    if (memory_size_ > config::MAX_BODY_SIZE)
+        return fail();
+    part.content.append(piece.data(), piece.size());
+    return true;
+}
+
+bool multipart_parser::end_part() {
+    parts_.back().complete = true;
+    if (!sink_)
+        return true;
+    auto sink = std::move(sink_);
+    sink_ = nullptr;
+    try {
+        sink(std::string_view(), true);
+    } catch (const std::exception&) {
+        return fail();
+    }
+    return true;
+}
+
+bool multipart_parser::fail() {
+    state_ = state::failed;
+    sink_ = nullptr;
+    carry_.clear();
+    head_.clear();
+    return false;
+}
+
+}  // namespace cppress::http
@@ -0,0 +1,127 @@
+#include "../includes/http_range.hpp"
+
+#include <algorithm>
+
+#include "../includes/http_consts.hpp"
+
+namespace cppress::http {
+
+namespace {
+std::string_view trim(std::string_view s) noexcept {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t'))
+        s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t'))
+        s.remove_suffix(1);
+    return s;
+}
+
+/// Parses a non-empty run of digits, false on anything else or overflow
+bool parse_number(std::string_view digits, std::uint64_t& value) noexcept {
+    if (digits.empty() || digits.size() > 19)
+        return false;
+    value = 0;
+    for (char ch : digits) {
+        if (ch < '0' || ch > '9')
+            return false;
+        value = value * 10 + static_cast<std::uint64_t>(ch - '0');
+    }
+    return true;
+}
+
+bool equals_ignore_case(std::string_view a, std::string_view b) noexcept {
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+               return (x | 0x20) == (y | 0x20);
+           });
+}
+}  // namespace
+
+/**
+ * Implementation Notes:
+ * - A syntax error anywhere voids the whole header (full), while ranges
+ *   that merely start past the end are dropped; if none is left the
+ *   request is unsatisfiable
+ * - Merging bounds the work of a multipart answer: a hostile list of
+ *   overlapping ranges collapses into one
+ */
+range_result parse_range_header(std::string_view value, std::uint64_t size,
+                                std::vector<byte_range>& ranges) {
+    ranges.clear();
+    value = trim(value);
+    std::size_t eq = value.find('=');
+    if (eq == std::string_view::npos || !equals_ignore_case(trim(value.substr(0, eq)), "bytes"))
+        return range_result::full;
+
+    std::string_view list = value.substr(eq + 1);
+    std::size_t specs = 0;
+    while (!list.empty()) {
+        std::size_t comma = list.find(',');
+        std::string_view spec = trim(list.substr(0, comma));
+        list = comma == std::string_view::npos ? std::string_view() : list.substr(comma + 1);
+        if (spec.empty())
+            continue;  // empty list elements are allowed
+        if (++specs > config::MAX_RANGES)
+            return range_result::full;
+
+        std::size_t dash = spec.find('-');
+        if (dash == std::string_view::npos)
+            return range_result::full;
+        std::string_view first_text = trim(spec.substr(0, dash));
+        std::string_view last_text = trim(spec.substr(dash + 1));
+        std::uint64_t first = 0, last = 0;
+
+        if (first_text.empty()) {
+            // suffix range: the final N bytes
+            if (!parse_number(last_text, last))
+                return range_result::full;
+            if (last == 0 || size == 0)
+                continue;
+            ranges.push_back({size - std::min(last, size), size - 1});
+            continue;
+        }
+        if (!parse_number(first_text, first))
+            return range_result::full;
+        if (last_text.empty()) {
+            last = UINT64_MAX;
+        } else if (!parse_number(last_text, last) || last < first) {
+            return range_result::full;
+        }
+        if (first >= size)
+            continue;
+        ranges.push_back({first, std::min(last, size - 1)});
+    }
+    if (specs == 0)
+        return range_result::full;
+    if (ranges.empty())
+        return range_result::unsatisfiable;
+
+    std::sort(ranges.begin(), ranges.end(),
+              [](const byte_range& a, const byte_range& b) { return a.first < b.first; });
+    std::size_t merged = 0;
+    for (std::size_t i = 1; i < ranges.size(); ++i) {
+        if (ranges[i].first <= ranges[merged].last + 1)
+            ranges[merged].last = std::max(ranges[merged].last, ranges[i].last);
+        else
+            ranges[++merged] = ranges[i];
+    }
+    ranges.resize(merged + 1);
+    return range_result::partial;
+}
+
+bool if_range_matches(std::string_view if_range, std::string_view etag,
+                      std::string_view last_modified) noexcept {
+    if_range = trim(if_range);
+    if (if_range.empty())
+        return true;
+    if (if_range.front() == '"' || if_range.substr(0, 2) == "W/") {
+        // strong comparison: weak tags never match
+        return if_range.front() == '"' && !etag.empty() && etag.front() == '"' &&
+               trim(etag) == if_range;
+    }
+    return !last_modified.empty() && trim(last_modified) == if_range;
+}
+
+std::string content_range(const byte_range& range, std::uint64_t size) {
+    return "bytes " + std::to_string(range.first) + "-" + std::to_string(range.last) + "/" +
+           std::to_string(size);
+}
+}  // namespace cppress::http
@@ -2,24 +2,18 @@
 
 #include <stdexcept>
 
+#include "shared/includes/alloc_accounting.hpp"
 #include "shared/includes/utils.hpp"
 namespace cppress::http {
 http_request::http_request(const std::string& method, const std::string& uri,
-                           const std::string& version,
-                           const std::multimap<std::string, std::string>& headers,
-                           const std::string& body, std::function<void()> close_connection)
+                           const std::string& version, http_headers headers, std::string body,
+                           std::function<void()> close_connection)
     : method(method),
       uri(uri),
       version(version),
-      headers(headers),
-      body(body),
-      close_connection(close_connection) {
-    std::multimap<std::string, std::string> lower_case_headers;
-    for (const auto& header : headers) {
-        lower_case_headers.insert({shared::to_uppercase(header.first), header.second});
-    }
-    this->headers = std::move(lower_case_headers);
-}
+      headers(std::move(headers)),
+      body(std::move(body)),
+      close_connection(std::move(close_connection)) {}
 
 http_request::http_request(http_request&& other)
     : method(std::move(other.method)),
@@ -27,7 +21,13 @@ http_request::http_request(http_request&& other)
       version(std::move(other.version)),
       headers(std::move(other.headers)),
       body(std::move(other.body)),
-      close_connection(std::move(other.close_connection)) {}
+      body_spool(std::move(other.body_spool)),
+      multipart(std::move(other.multipart)),
+      close_connection(std::move(other.close_connection)),
+      connection_owner(std::move(other.connection_owner)),
+      received_at(other.received_at),
+      remote_address(std::move(other.remote_address)),
+      connection(other.connection) {}
 
 void http_request::destroy(bool Isure) {
     if (!Isure) {
@@ -53,23 +53,22 @@ std::string http_request::get_version() const {
 }
 
 std::vector<std::string> http_request::get_header(const std::string& name) const {
-    std::vector<std::string> values;
-    auto range = headers.equal_range(shared::to_uppercase(name));
-    for (auto it = range.first; it != range.second; ++it) {
-        values.push_back(it->second);
-    }
-    return values;
+    return headers.values(name);
 }
 
 std::vector<std::pair<std::string, std::string>> http_request::get_headers() const {
     std::vector<std::pair<std::string, std::string>> headers_vector;
     for (const auto& header : headers) {
-        headers_vector.emplace_back(shared::to_uppercase(header.first), header.second);
+        headers_vector.emplace_back(shared::to_uppercase(header.name),
+                                    std::string(header.value));
     }
     return headers_vector;
 }
 
 std::string http_request::get_body() const {
+    if (body_spool)
+        return body_spool->to_string();
+    shared::count_copy(body.size());
     return body;
 }
 }  // namespace cppress::http
\ No newline at end of file
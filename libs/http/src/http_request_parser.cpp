@@ -1,236 +1,480 @@
 #include "../includes/http_request_parser.hpp"
 
+#include <algorithm>
 #include <functional>
-#include <map>
 #include <memory>
-#include <mutex>
-#include <sstream>
+#include <stdexcept>
+#include <string_view>
+
+#include "shared/includes/utils.hpp"
 
 namespace cppress::http {
 
-http_parse_result http_request_parser::parse(std::shared_ptr<cppress::sockets::connection> conn,
-                                             const cppress::sockets::data_buffer& data) {
-    std::lock_guard<std::mutex> lock(parser_mutex_);
+namespace {
+/// Result of a read that did not complete the head
+http_parse_result head_pending() {
+    http_parse_result pending(false, "", "", "", {}, "");
+    pending.headers_complete = false;
+    return pending;
+}
 
-    auto connection_id = conn->remote_endpoint().to_string();
+/// Returns a state to idle, dropping any partial request and pipelined bytes
+void restart(http_parse_state& state) {
+    const auto* owner = state.owner;
+    int socket_fd = state.socket_fd;
+    state = http_parse_state();
+    state.owner = owner;
+    state.socket_fd = socket_fd;
+}
+}  // namespace
 
-    if (pending_requests_.find(connection_id) != pending_requests_.end()) {
-        return continue_parsing(pending_requests_[connection_id], data);
+http_request_parser::http_request_parser()
+    : pages_(new std::atomic<std::unique_ptr<http_parse_state>*>[state_page_count]()) {}
+
+http_request_parser::~http_request_parser() {
+    for (std::size_t i = 0; i < state_page_count; ++i)
+        delete[] pages_[i].load(std::memory_order_acquire);
+}
+
+/**
+ * Implementation Notes:
+ * - Two reactors may reach a missing page at once: both allocate one, the
+ *   compare-and-swap keeps the first and the other is freed
+ */
+std::unique_ptr<http_parse_state>* http_request_parser::slot_for(int fd, bool create) {
+    std::size_t index = static_cast<std::size_t>(fd) + 1;
+    std::size_t page = index >> state_page_bits;
+    if (page >= state_page_count)
+        return nullptr;
+    auto* slots = pages_[page].load(std::memory_order_acquire);
+    if (!slots) {
+        if (!create)
+            return nullptr;
+        auto* fresh = new std::unique_ptr<http_parse_state>[std::size_t(1) << state_page_bits];
+        if (pages_[page].compare_exchange_strong(slots, fresh, std::memory_order_acq_rel)) {
+            slots = fresh;
+        } else {
+            delete[] fresh;
+        }
+    }
+    return &slots[index & ((std::size_t(1) << state_page_bits) - 1)];
+}
+
+http_parse_state& http_request_parser::state_for(const cppress::sockets::connection& conn) {
+    auto* slot = slot_for(conn.native_handle(), true);
+    if (!slot)
+        throw std::runtime_error("Descriptor beyond the parser's state table");
+    auto& state = *slot;
+    if (!state)
+        state = std::make_unique<http_parse_state>();
+    if (state->owner != &conn) {
+        // first request of this connection, or a descriptor reused without discard()
+        *state = http_parse_state();
+        state->owner = &conn;
+        state->socket_fd = conn.native_handle();
+    }
+    return *state;
+}
+
+/**
+ * Implementation Notes:
+ * - No lock: a connection's state is used by the event loop thread that
+ *   owns the connection, one read at a time
+ */
+http_parse_result http_request_parser::parse(std::shared_ptr<cppress::sockets::connection> conn,
+                                             const cppress::sockets::data_buffer& data) {
+    auto& state = state_for(*conn);
+    if (!state.backlog.empty()) {
+        // parse_next() was not called for everything (e.g. the server paused)
+        cppress::sockets::data_buffer joined = std::move(state.backlog);
+        joined.append(data);
+        state.backlog.clear();
+        return continue_parsing(state, joined);
     }
+    return continue_parsing(state, data);
+}
 
-    return begin_parsing(connection_id, data, conn->native_handle());
+http_parse_result http_request_parser::parse_next(
+    std::shared_ptr<cppress::sockets::connection> conn) {
+    auto& state = state_for(*conn);
+    cppress::sockets::data_buffer rest = std::move(state.backlog);
+    state.backlog.clear();
+    if (rest.empty())
+        return head_pending();
+    return continue_parsing(state, rest);
 }
 
 http_parse_result http_request_parser::continue_parsing(http_parse_state& state,
                                                         const cppress::sockets::data_buffer& data) {
     state.last_activity = std::chrono::steady_clock::now();
 
-    if (state.strategy != parse_strategy::CONTENT_LENGTH) {
-        return http_parse_result(true, "UNSUPPORTED_PARSE_STRATEGY", state.uri, state.http_version,
-                                 {}, "");
-    } else  // Content-Length handling
-    {
+    if (state.reading_head) {
+        // Resume scanning where the previous read ended
+        state.head_bytes.append(data.data(), data.size());
+        if (state.head.parse(state.head_bytes, config::MAX_HEADER_SIZE) ==
+            http_head_parser::status::need_more)
+            return head_pending();
+        // The head's spans index head_bytes, which the result slices from now on
+        http_head_parser head = std::move(state.head);
+        cppress::sockets::data_buffer input(std::move(state.head_bytes));
+        state.reading_head = false;
+        state.head.reset();
+        state.head_bytes.clear();
+        return finish_head(state, head, input);
+    }
+
+    if (state.reading_body) {
+        if (state.strategy == parse_strategy::CHUNKED_ENCODING)
+            return decode_chunked_body(state, data);
+        if (state.strategy != parse_strategy::CONTENT_LENGTH) {
+            auto unsupported = http_parse_result(true, "UNSUPPORTED_PARSE_STRATEGY", state.uri,
+                                                 state.http_version, {}, "");
+            restart(state);
+            return unsupported;
+        }
         return accumulate_body_data(state, data);
     }
-}
 
-http_parse_result http_request_parser::begin_parsing(const std::string& connection_id,
-                                                     const cppress::sockets::data_buffer& data,
-                                                     int socket_fd) {
-    // Convert raw message to string stream for line-by-line parsing
-    std::istringstream request_stream(data.to_string());
+    return begin_parsing(state, data);
+}
 
-    // HTTP request components to be parsed
-    std::string method, uri, version;
+/**
+ * Implementation Notes:
+ * - A request that arrives whole is scanned straight from the receive
+ *   buffer; only a head cut by the end of the read is copied, so that the
+ *   next read can be appended to it
+ */
+http_parse_result http_request_parser::begin_parsing(http_parse_state& state,
+                                                     const cppress::sockets::data_buffer& data) {
+    http_head_parser head;
+    if (head.parse(data.view(), config::MAX_HEADER_SIZE) != http_head_parser::status::need_more)
+        return finish_head(state, head, data);
+
+    state.reading_head = true;
+    state.head = std::move(head);
+    state.head_bytes.assign(data.data(), data.size());
+    return head_pending();
+}
 
-    // Parse request line
-    auto [request_line_valid, error_message] =
-        parse_request_line(request_stream, method, uri, version);
-    if (!request_line_valid) {
-        return http_parse_result(true, error_message, uri, version, {}, "");
+http_parse_result http_request_parser::finish_head(http_parse_state& state,
+                                                   const http_head_parser& head,
+                                                   const cppress::sockets::data_buffer& input) {
+    std::string_view view = input.view();
+    std::string method(head.method().in(view));
+    std::string uri(head.uri().in(view));
+    std::string version(head.version().in(view));
+
+    if (head.error() != http_head_parser::error_code::none) {
+        // the framing of whatever follows is unknown, drop it with the request
+        restart(state);
+        switch (head.error()) {
+            case http_head_parser::error_code::bad_request_line:
+                return http_parse_result(true, "BAD_METHOD_OR_URI_OR_VERSION", uri, version, {},
+                                         "");
+            case http_head_parser::error_code::bad_header:
+                return http_parse_result(true, "BAD_HEADERS_MALFORMED", uri, version, {}, "");
+            default:
+                return http_parse_result(true, "BAD_HEADERS_TOO_LARGE", uri, version, {}, "");
+        }
     }
 
-    // Parse headers
-    auto [headers_valid, headers] = parse_headers(request_stream, uri, version);
-    if (!headers_valid) {
-        return http_parse_result(true, "BAD_HEADERS_TOO_LARGE", uri, version, {}, "");
+    http_headers headers;
+    headers.reserve(head.consumed());
+    for (std::size_t i = 0; i < head.header_count(); ++i) {
+        const auto& field = head.header(i);
+        headers.add(field.name.in(view), field.value.in(view));
     }
 
-    std::size_t content_length = 0;
-    auto content_length_it = headers.find(cppress::sockets::to_uppercase("content-length"));
-    auto transfer_encoding = headers.find(cppress::sockets::to_uppercase("Transfer-Encoding"));
+    bool has_transfer_encoding = headers.contains(header_id::transfer_encoding);
+    bool has_content_length = headers.contains(header_id::content_length);
 
-    bool has_transfer_encoding = (transfer_encoding != headers.end()) &&
-                                 has_chunked_encoding(headers.equal_range(
-                                     cppress::sockets::to_uppercase("Transfer-Encoding")));
-
-    bool has_content_length = (content_length_it != headers.end());
+    // a body framed by another coding has no length we can find: its bytes would be
+    // read as the next request, so the connection is refused (RFC 9112 6.3)
+    if (has_transfer_encoding && !has_chunked_encoding(headers)) {
+        restart(state);
+        return http_parse_result(true, "BAD_TRANSFER_ENCODING", uri, version, std::move(headers),
+                                 "");
+    }
 
-    if (headers.count(cppress::sockets::to_uppercase("content-length")) > 1 ||
+    if (headers.count(header_id::content_length) > 1 ||
         (has_content_length && has_transfer_encoding)) {
+        restart(state);
         return http_parse_result(true, "BAD_REPEATED_LENGTH_OR_TRANSFER_ENCODING_OR_BOTH", uri,
-                                 version, headers, "");
+                                 version, std::move(headers), "");
     }
 
     if (has_content_length) {
-        content_length = std::stoull(content_length_it->second);
-        return parse_content_length_body(connection_id, request_stream, method, uri, version,
-                                         headers, content_length, socket_fd);
+        std::size_t content_length =
+            std::stoull(std::string(headers.get(header_id::content_length)));
+        return parse_content_length_body(state, input, head.consumed(), method, uri, version,
+                                         std::move(headers), content_length);
     } else if (has_transfer_encoding) {
-        // return parse_chunked_encoding_body(connection_id, request_stream, method, uri, version,
-        //                                    headers, socket_fd);
-        return http_parse_result(true, "UNSUPPORTED_TRANSFER_ENCODING_CHUNKED", uri, version,
-                                 headers, "");
+        state.reading_body = true;
+        state.strategy = parse_strategy::CHUNKED_ENCODING;
+        state.method = method;
+        state.uri = uri;
+        state.http_version = version;
+        state.headers = std::move(headers);
+        select_body_receiver(state, 0);
+        bool expects = expects_continue(state.headers, version);
+        auto result = decode_chunked_body(state, input.slice(head.consumed()));
+        result.expects_continue = expects && !result.is_complete;
+        return result;
     }
 
     // No body to process
-    return http_parse_result(true, method, uri, version, headers, "");
-}
-
-void http_request_parser::cleanup_idle_connections(std::chrono::seconds max_idle_time,
-                                                   std::function<void(int)> close_connection) {
-    std::lock_guard<std::mutex> lock(parser_mutex_);
-    auto now = std::chrono::steady_clock::now();
-    for (auto it = pending_requests_.begin(); it != pending_requests_.end();) {
-        auto duration =
-            std::chrono::duration_cast<std::chrono::seconds>(now - it->second.last_activity);
-        if (duration > max_idle_time) {
-            close_connection(it->second.socket_fd);
-            it = pending_requests_.erase(it);
-        } else {
-            ++it;
-        }
-    }
+    http_parse_result result(true, method, uri, version, std::move(headers), "");
+    keep_rest(state, input.slice(head.consumed()), result);
+    return result;
 }
 
-std::pair<bool, std::string> http_request_parser::parse_request_line(
-    std::istringstream& request_stream, std::string& method, std::string& uri,
-    std::string& version) {
-    std::string line;
-    if (std::getline(request_stream, line) && !line.empty()) {
-        if (!line.empty() && line.back() == '\r') {
-            line.pop_back();
-        }
-
-        std::istringstream request_line(line);
-        request_line >> method >> uri >> version;
-    }
-
-    if (method.empty() || uri.empty() || version.empty()) {
-        return {false, "BAD_METHOD_OR_URI_OR_VERSION"};
-    }
-
-    return {true, ""};
+void http_request_parser::discard(std::shared_ptr<cppress::sockets::connection> conn) {
+    auto* slot = slot_for(conn->native_handle(), false);
+    if (slot && *slot && (*slot)->owner == conn.get())
+        slot->reset();
 }
 
-std::pair<bool, std::multimap<std::string, std::string>> http_request_parser::parse_headers(
-    std::istringstream& request_stream, const std::string& uri, const std::string& version) {
-    std::multimap<std::string, std::string> headers;
-    std::size_t headers_size = 0;
-    std::string line;
+bool http_request_parser::in_request(const cppress::sockets::connection& conn) {
+    auto* slot = slot_for(conn.native_handle(), false);
+    if (!slot || !*slot || (*slot)->owner != &conn)
+        return false;
+    const http_parse_state& state = **slot;
+    return state.reading_head || state.reading_body || !state.backlog.empty();
+}
 
-    while (std::getline(request_stream, line)) {
-        if (!line.empty() && line.back() == '\r') {
-            line.pop_back();
-        }
+bool http_request_parser::expects_continue(const http_headers& headers,
+                                           const std::string& version) {
+    if (version != "HTTP/1.1")
+        return false;  // an HTTP/1.0 client cannot understand a 1xx answer
+    bool expects = false;
+    headers.for_each(header_id::expect, [&expects](std::string_view value) {
+        expects = expects || shared::iequals(shared::trim_view(value), "100-continue");
+    });
+    return expects;
+}
 
-        if (line.empty()) {
-            break;
+/**
+ * Implementation Notes:
+ * - The codings of every Transfer-Encoding line form one list, in order;
+ *   chunked has to be its last element and appear once (RFC 9112 6.1), a
+ *   token merely holding "chunked" does not count
+ */
+bool http_request_parser::has_chunked_encoding(const http_headers& headers) {
+    std::string_view last;
+    int chunked = 0;
+    headers.for_each(header_id::transfer_encoding, [&](std::string_view value) {
+        while (!value.empty()) {
+            const std::size_t comma = value.find(',');
+            const std::string_view coding = shared::trim_view(value.substr(0, comma));
+            if (!coding.empty()) {
+                last = coding;
+                chunked += shared::iequals(coding, "chunked");
+            }
+            if (comma == std::string_view::npos)
+                break;
+            value.remove_prefix(comma + 1);
         }
+    });
+    return chunked == 1 && shared::iequals(last, "chunked");
+}
 
-        size_t colon_pos = line.find(':');
-        if (colon_pos != std::string::npos) {
-            std::string header_name = line.substr(0, colon_pos);
-            std::string header_value = line.substr(colon_pos + 1);
-
-            size_t start = header_value.find_first_not_of(" \t");
-            if (start != std::string::npos) {
-                header_value = header_value.substr(start);
-            }
+http_parse_result http_request_parser::parse_content_length_body(
+    http_parse_state& state, const cppress::sockets::data_buffer& input, std::size_t body_offset,
+    const std::string& method, const std::string& uri, const std::string& version,
+    http_headers headers, size_t content_length) {
+    state.strategy = parse_strategy::CONTENT_LENGTH;
+    state.expected_body_length = content_length;
+    state.method = method;
+    state.uri = uri;
+    state.http_version = version;
+    state.headers = std::move(headers);
+    if (content_length > 0)
+        select_body_receiver(state, content_length);
+
+    bool off_heap = state.stream || state.spool;
+    if (content_length > (off_heap ? config::MAX_STREAMED_BODY_SIZE : config::MAX_BODY_SIZE)) {
+        http_parse_result too_large(true, "BAD_CONTENT_TOO_LARGE", uri, version,
+                                    std::move(state.headers), "");
+        restart(state);
+        return too_large;
+    }
+    if (!off_heap)
+        state.accumulated_body.reserve(content_length);
+
+    state.reading_body = true;
+    auto result = accumulate_body_data(state, input.slice(body_offset));
+    if (!result.is_complete) {
+        // the first result carries the head, for on_headers_received()
+        result.headers = state.headers;
+        result.body = state.accumulated_body;
+        result.expects_continue = expects_continue(state.headers, version);
+    }
+    return result;
+}
 
-            size_t end = header_value.find_last_not_of(" \t");
-            if (end != std::string::npos) {
-                header_value = header_value.substr(0, end + 1);
+http_parse_result http_request_parser::decode_chunked_body(
+    http_parse_state& state, const cppress::sockets::data_buffer& data) {
+    std::string_view view = data.view();
+    std::size_t pos = 0;
+    http_span run;
+    for (;;) {
+        switch (state.chunked.next(view, pos, run, config::MAX_HEADER_SIZE)) {
+            case http_chunked_decoder::status::data:
+                if (!take_body(state, data.slice(run.offset, run.length))) {
+                    http_parse_result too_large(true, "BAD_CONTENT_TOO_LARGE", state.uri,
+                                                state.http_version, std::move(state.headers),
+                                                "");
+                    restart(state);
+                    return too_large;
+                }
+                break;
+
+            case http_chunked_decoder::status::need_more:
+                return http_parse_result(false, state.method, state.uri, state.http_version,
+                                         state.headers, "");
+
+            case http_chunked_decoder::status::error: {
+                http_parse_result bad(true,
+                                      state.chunked.error() ==
+                                              http_chunked_decoder::error_code::too_large
+                                          ? "BAD_CONTENT_TOO_LARGE"
+                                          : "BAD_CHUNKED_ENCODING",
+                                      state.uri, state.http_version, std::move(state.headers),
+                                      "");
+                restart(state);
+                return bad;
             }
-            headers_size += header_name.size() + header_value.size();
 
-            if (headers_size > config::MAX_HEADER_SIZE) {
-                return {false, {}};
-            }
-            headers.emplace(cppress::sockets::to_uppercase(header_name), header_value);
+            case http_chunked_decoder::status::complete:
+                for (const auto& field : state.chunked.trailers())
+                    state.headers.add(field.first, field.second);
+                return finish_body(state, data.slice(pos));
         }
     }
+}
 
-    return {true, headers};
+http_parse_result http_request_parser::accumulate_body_data(
+    http_parse_state& state, const cppress::sockets::data_buffer& data) {
+    std::size_t missing = state.expected_body_length - state.body_size;
+    std::size_t taken = std::min(missing, data.size());
+    if (taken > 0)
+        take_body(state, data.slice(0, taken));  // the length was checked against the limit
+
+    if (state.body_size < state.expected_body_length)
+        return http_parse_result(false, state.method, state.uri, state.http_version, {}, "");
+    return finish_body(state, data.slice(taken));
 }
 
-bool http_request_parser::has_chunked_encoding(
-    const std::pair<std::multimap<std::string, std::string>::iterator,
-                    std::multimap<std::string, std::string>::iterator>& range) {
-    for (auto it = range.first; it != range.second; ++it) {
-        auto tmp = it->second;
-        std::transform(tmp.begin(), tmp.end(), tmp.begin(), ::tolower);
-        if (tmp.find("chunked") != std::string::npos) {
-            return true;
-        }
-    }
-    return false;
+void http_request_parser::set_body_stream_selector(http_body_stream_selector selector) {
+    body_stream_selector_ = std::move(selector);
 }
 
-http_parse_result http_request_parser::parse_content_length_body(
-    const std::string& connection_id, std::istringstream& request_stream, const std::string& method,
-    const std::string& uri, const std::string& version,
-    const std::multimap<std::string, std::string>& headers, size_t content_length, int socket_fd) {
-    // Read the body from the stream
-    std::ostringstream body_stream;
-    body_stream << request_stream.rdbuf();
-    std::string body = body_stream.str();
-
-    // Complete request in one go
-    if (body.size() == content_length) {
-        return http_parse_result(true, method, uri, version, headers, body);
-    } else if (body.size() > content_length || body.size() > config::MAX_BODY_SIZE) {
-        return http_parse_result(true, "BAD_CONTENT_TOO_LARGE", uri, version, headers, "");
-    } else {
-        // Need to continue handling in subsequent calls
-        pending_requests_.insert(
-            {connection_id, http_parse_state(connection_id, parse_strategy::CONTENT_LENGTH)});
-        auto& state_ref = pending_requests_[connection_id];
-        state_ref.expected_body_length = content_length;
-        state_ref.accumulated_body = body;
-        state_ref.method = method;
-        state_ref.uri = uri;
-        state_ref.http_version = version;
-        state_ref.headers = headers;
-        state_ref.last_activity = std::chrono::steady_clock::now();
-        state_ref.socket_fd = socket_fd;
-        return http_parse_result(false, method, uri, version, headers, body);
+void http_request_parser::set_multipart_sink_selector(multipart_sink_selector selector) {
+    multipart_sink_selector_ = std::move(selector);
+}
+
+/**
+ * Implementation Notes:
+ * - A multipart body is streamed into its parser, so only the content
+ *   the sinks leave in memory is held; the parser rides along in the
+ *   result to the handler
+ */
+void http_request_parser::select_body_receiver(http_parse_state& state,
+                                               std::size_t expected_length) {
+    if (body_stream_selector_) {
+        // lent to the selector and taken back, not copied
+        http_parse_result head(false, state.method, state.uri, state.http_version,
+                               std::move(state.headers), "");
+        state.stream = body_stream_selector_(head);
+        state.headers = std::move(head.headers);
+        if (state.stream)
+            return;
+    }
+    std::string boundary;
+    if (multipart_sink_selector_ &&
+        multipart_boundary(state.headers.get(header_id::content_type), boundary)) {
+        auto parser = std::make_shared<multipart_parser>(boundary, multipart_sink_selector_);
+        state.multipart = parser;
+        state.stream = [parser](std::string_view piece, bool last) {
+            parser->feed(piece);
+            if (last)
+                parser->finish();
+        };
+        return;
     }
+    // a body announced above the threshold goes to disk from its first byte
+    if (config::BODY_SPILL_THRESHOLD != 0 && expected_length > config::BODY_SPILL_THRESHOLD)
+        state.spool = std::make_shared<http_body_spool>();
 }
 
-http_parse_result http_request_parser::accumulate_body_data(
-    http_parse_state& state, const cppress::sockets::data_buffer& data) {
-    std::string body = data.to_string();
-    state.accumulated_body += body;
+/**
+ * Implementation Notes:
+ * - A chunked body has no announced length: it starts in memory and moves
+ *   to the spool the moment it crosses the threshold
+ */
+bool http_request_parser::take_body(http_parse_state& state,
+                                    const cppress::sockets::data_buffer& run) {
+    state.body_size += run.size();
+    if (state.stream) {
+        if (state.body_size > config::MAX_STREAMED_BODY_SIZE)
+            return false;
+        state.stream(run.view(), false);
+        return true;
+    }
 
-    if (state.accumulated_body.size() > config::MAX_BODY_SIZE) {
-        return http_parse_result(true, "BAD_CONTENT_TOO_LARGE", state.uri, state.http_version,
-                                 state.headers, "");
+    if (!state.spool && config::BODY_SPILL_THRESHOLD != 0 &&
+        state.body_size > config::BODY_SPILL_THRESHOLD) {
+        state.spool = std::make_shared<http_body_spool>();
+        state.spool->append(state.accumulated_body.data(), state.accumulated_body.size());
+        for (const auto& piece : state.body_runs)
+            state.spool->append(piece.data(), piece.size());
+        state.accumulated_body.clear();
+        state.accumulated_body.shrink_to_fit();
+        state.body_runs.clear();
     }
-    if (state.accumulated_body.size() == state.expected_body_length) {
-        auto return_value = http_parse_result(true, state.method, state.uri, state.http_version,
-                                              state.headers, state.accumulated_body);
-        pending_requests_.erase(state.connection_id);
-        return return_value;
+    if (state.spool) {
+        if (state.body_size > config::MAX_STREAMED_BODY_SIZE)
+            return false;
+        state.spool->append(run.data(), run.size());
+        return true;
     }
 
-    if (state.accumulated_body.size() > state.expected_body_length ||
-        state.accumulated_body.size() > config::MAX_BODY_SIZE) {
-        return http_parse_result(true, "BAD_CONTENT_TOO_LARGE", state.uri, state.http_version,
-                                 state.headers, "");
+    if (state.body_size > config::MAX_BODY_SIZE)
+        return false;
+    if (state.strategy == parse_strategy::CHUNKED_ENCODING)
+        state.body_runs.push_back(run);
+    else
+        state.accumulated_body.append(run.data(), run.size());
+    return true;
+}
+
+http_parse_result http_request_parser::finish_body(http_parse_state& state,
+                                                   cppress::sockets::data_buffer rest) {
+    std::string body;
+    if (state.stream) {
+        state.stream(std::string_view(), true);
+    } else if (!state.body_runs.empty()) {
+        // joined once, with one allocation
+        body.reserve(state.body_size);
+        for (const auto& piece : state.body_runs)
+            body.append(piece.data(), piece.size());
+    } else {
+        body = std::move(state.accumulated_body);
     }
 
-    return http_parse_result(false, state.method, state.uri, state.http_version, {}, "");
+    http_parse_result result(true, state.method, state.uri, state.http_version,
+                             std::move(state.headers), std::move(body));
+    result.body_spool = std::move(state.spool);
+    result.multipart = std::move(state.multipart);
+    restart(state);
+    keep_rest(state, std::move(rest), result);
+    return result;
+}
+
+void http_request_parser::keep_rest(http_parse_state& state, cppress::sockets::data_buffer rest,
+                                    http_parse_result& result) {
+    result.has_next = !rest.empty();
+    state.backlog = std::move(rest);
 }
 
 }  // namespace cppress::http
@@ -1,27 +1,36 @@
 
 #include "includes/http_response.hpp"
 
-#include <ctime>
+#include <cstdio>
 #include <iostream>
 #include <map>
 #include <memory>
+#include <random>
 #include <sstream>
 
+#include "includes/http_conditional.hpp"
+#include "includes/http_head_writer.hpp"
+#include "includes/http_range.hpp"
+#include "shared/includes/alloc_accounting.hpp"
 #include "shared/includes/utils.hpp"
 
 namespace cppress::http {
 http_response::http_response(const std::string& version,
                              const std::multimap<std::string, std::string>& headers,
                              std::function<void()> close_connection,
-                             std::function<void(const std::string&)> send_message)
+                             std::function<void(std::vector<std::string>&&, bool)> send_message,
+                             std::function<void(std::vector<cppress::sockets::output_segment>&&,
+                                                bool)>
+                                 send_segments)
     : version(version),
       headers(headers),
-      close_connection(close_connection),
-      send_message(send_message) {
+      close_connection(std::move(close_connection)),
+      send_message(std::move(send_message)),
+      send_segments(std::move(send_segments)) {
     std::multimap<std::string, std::string> lower_case_headers;
 
     for (const auto& header : headers) {
-        lower_case_headers.insert({shared::to_uppercase(header.first), header.second});
+        lower_case_headers.insert({header_name(header.first), header.second});
     }
     this->headers = std::move(lower_case_headers);
 }
@@ -34,9 +43,20 @@ http_response::http_response(http_response&& other)
       trailers(std::move(other.trailers)),
       body(std::move(other.body)),
       close_connection(std::move(other.close_connection)),
-      send_message(std::move(other.send_message)) {
+      send_message(std::move(other.send_message)),
+      send_segments(std::move(other.send_segments)),
+      connection_owner(std::move(other.connection_owner)),
+      connection_state(std::move(other.connection_state)),
+      streaming(other.streaming),
+      coding(other.coding),
+      compression_level(other.compression_level),
+      compression_min_size(other.compression_min_size),
+      compressor(std::move(other.compressor)),
+      if_none_match(std::move(other.if_none_match)),
+      if_modified_since(std::move(other.if_modified_since)) {
     other.status_code = 0;             // Invalidate the moved-from response
     other.send_message = nullptr;      // Reset the moved-from send_message
+    other.send_segments = nullptr;
     other.close_connection = nullptr;  // Reset the moved-from close_connection
 }
 
@@ -44,30 +64,95 @@ bool http_response::validate() const {
     return true;
 }
 
-std::string get_current_date() {
-    // Get current time
-    std::time_t now = std::time(nullptr);
-    std::tm tm = *std::gmtime(&now);
+void http_response::set_compression(content_coding coding, int level, std::size_t min_size) {
+    this->coding = coding;
+    compression_level = level;
+    compression_min_size = min_size;
+}
 
-    // Format date according to RFC 1123
-    char buffer[30];
-    std::strftime(buffer, sizeof(buffer), "%a, %d %b %Y %H:%M:%S GMT", &tm);
-    return std::string(buffer);
+bool http_response::should_compress(bool stream, std::size_t body_size) const {
+    if (coding == content_coding::identity || !content_coding_available(coding))
+        return false;
+    if (status_code < 200 || status_code == 204 || status_code == 304)
+        return false;
+    if (!stream && (body_size == 0 || body_size < compression_min_size))
+        return false;
+    if (headers.count("CONTENT-ENCODING"))
+        return false;
+    auto type = headers.find("CONTENT-TYPE");
+    return type != headers.end() && compressible_content_type(type->second);
 }
 
-std::string http_response::to_string() const {
-    std::ostringstream response_stream;
-    response_stream << version << " " << status_code << " " << status_message << "\r\n";
-    response_stream << "Date: " << get_current_date() << "\r\n";
-    for (const auto& header : headers) {
-        response_stream << shared::to_uppercase(header.first) << ": " << header.second << "\r\n";
+/**
+ * Implementation Notes:
+ * - Vary is extended, not replaced, and left alone if it already names
+ *   Accept-Encoding or is "*"
+ * - A strong ETag names the identity bytes, so it is weakened rather than
+ *   dropped; conditional requests keep working through weak comparison
+ */
+void http_response::mark_compressed() {
+    headers.erase("CONTENT-ENCODING");
+    headers.emplace("CONTENT-ENCODING", std::string(content_coding_name(coding)));
+
+    auto vary = headers.find("VARY");
+    if (vary == headers.end()) {
+        headers.emplace("VARY", "Accept-Encoding");
+    } else if (vary->second != "*" &&
+               !shared::icontains(vary->second, "ACCEPT-ENCODING")) {
+        vary->second += ", Accept-Encoding";
     }
-    if (body.size())
-        response_stream << "\r\n" << body;
-    else
-        response_stream << "\r\n";
 
-    return response_stream.str();
+    auto etag = headers.find("ETAG");
+    if (etag != headers.end() && !etag->second.empty() && etag->second[0] == '"')
+        etag->second.insert(0, "W/");
+}
+
+void http_response::capture_preconditions(const std::string& method,
+                                          const http_headers& request_headers) {
+    if (method != "GET" && method != "HEAD")
+        return;
+    if_none_match = std::string(request_headers.get(header_id::if_none_match));
+    if_modified_since = std::string(request_headers.get(header_id::if_modified_since));
+}
+
+bool http_response::is_not_modified() const {
+    if (if_none_match.empty() && if_modified_since.empty())
+        return false;
+    auto etag = headers.find("ETAG");
+    auto modified = headers.find("LAST-MODIFIED");
+    return not_modified(if_none_match, if_modified_since,
+                        etag == headers.end() ? std::string_view() : etag->second,
+                        modified == headers.end() ? std::string_view() : modified->second);
+}
+
+/**
+ * Implementation Notes:
+ * - Validators, Cache-Control, Vary and the like stay, as RFC 9110 asks;
+ *   the headers describing the omitted body go
+ */
+bool http_response::apply_not_modified() {
+    if (status_code != 200 || !is_not_modified())
+        return false;
+    set_status(304, "Not Modified");
+    body.clear();
+    for (const char* name : {"CONTENT-LENGTH", "CONTENT-TYPE", "CONTENT-RANGE",
+                             "TRANSFER-ENCODING", "ACCEPT-RANGES"})
+        headers.erase(name);
+    return true;
+}
+
+std::string http_response::head_to_string() const {
+    shared::phase_scope serializing(shared::request_phase::serialize);
+    return write_http_head(version, status_code, status_message, headers);
+}
+
+std::string http_response::header_name(const std::string& name) {
+    std::string_view known = http_well_known_header(name);
+    return known.empty() ? shared::to_uppercase(name) : std::string(known);
+}
+
+std::string http_response::to_string() const {
+    return head_to_string() + body;
 }
 
 void http_response::set_body(const std::string& body) {
@@ -84,11 +169,11 @@ void http_response::set_version(const std::string& version) {
 }
 
 void http_response::add_trailer(const std::string& name, const std::string& value) {
-    trailers.insert({shared::to_uppercase(name), value});
+    trailers.insert({header_name(name), value});
 }
 
 void http_response::add_header(const std::string& name, const std::string& value) {
-    headers.insert({shared::to_uppercase(name), value});
+    headers.insert({header_name(name), value});
 }
 
 std::string http_response::get_body() const {
@@ -109,7 +194,7 @@ int http_response::get_status_code() const {
 
 std::vector<std::string> http_response::get_header(const std::string& name) const {
     std::vector<std::string> values;
-    auto range = headers.equal_range(shared::to_uppercase(name));
+    auto range = headers.equal_range(header_name(name));
     for (auto it = range.first; it != range.second; ++it) {
         values.push_back(it->second);
     }
@@ -118,7 +203,7 @@ std::vector<std::string> http_response::get_header(const std::string& name) cons
 
 std::vector<std::string> http_response::get_trailer(const std::string& name) const {
     std::vector<std::string> values;
-    auto range = trailers.equal_range(shared::to_uppercase(name));
+    auto range = trailers.equal_range(header_name(name));
     for (auto it = range.first; it != range.second; ++it) {
         values.push_back(it->second);
     }
@@ -139,9 +224,25 @@ void http_response::end() {
 }
 
 void http_response::send() {
+    shared::phase_scope serializing(shared::request_phase::serialize);
     try {
         if (validate()) {
-            send_message(to_string());
+            apply_not_modified();
+            if (should_compress(false, body.size())) {
+                body = compress_body(coding, body, compression_level);
+                mark_compressed();
+                if (headers.erase("CONTENT-LENGTH"))
+                    headers.emplace("CONTENT-LENGTH", std::to_string(body.size()));
+            }
+            // head and body are queued as separate segments, no concatenation copy
+            std::vector<std::string> segments;
+            segments.reserve(2);
+            segments.push_back(head_to_string());
+            if (!body.empty()) {
+                shared::count_copy(body.size());
+                segments.push_back(body);
+            }
+            send_message(std::move(segments), true);
         } else {
             throw std::runtime_error(
                 "Invalid HTTP response or client connection may be already closed");
@@ -156,10 +257,12 @@ void http_response::send_trailers() {
         if (validate()) {
             std::ostringstream trailer_stream;
             for (const auto& trailer : trailers) {
-                trailer_stream << shared::to_uppercase(trailer.first) << ": " << trailer.second
+                trailer_stream << trailer.first << ": " << trailer.second
                                << "\r\n";
             }
-            send_message(trailer_stream.str());
+            std::vector<std::string> segments;
+            segments.push_back(trailer_stream.str());
+            send_message(std::move(segments), true);
         } else {
             throw std::runtime_error(
                 "Invalid HTTP response or client connection may be already closed");
@@ -168,4 +271,286 @@ void http_response::send_trailers() {
         throw std::runtime_error("Error sending HTTP response:\n" + std::string(e.what()));
     }
 }
-}  // namespace cppress::http
\ No newline at end of file
+
+void http_response::begin_stream() {
+    if (streaming)
+        throw std::runtime_error("Error starting HTTP stream: already streaming");
+    headers.erase("CONTENT-LENGTH");
+    headers.erase("TRANSFER-ENCODING");
+    headers.erase("TRAILER");
+    headers.emplace("TRANSFER-ENCODING", "chunked");
+    if (!trailers.empty()) {
+        std::string names;
+        for (auto it = trailers.begin(); it != trailers.end();
+             it = trailers.upper_bound(it->first))
+            names += (names.empty() ? "" : ", ") + it->first;
+        headers.emplace("TRAILER", names);
+    }
+    if (should_compress(true, 0)) {
+        compressor = http_compressor::create(coding, compression_level);
+        mark_compressed();
+    }
+    streaming = true;
+
+    std::vector<std::string> segments;
+    segments.push_back(head_to_string());
+    send_message(std::move(segments), false);
+}
+
+void http_response::write_chunk(std::string data) {
+    if (!streaming)
+        throw std::runtime_error("Error writing HTTP chunk: begin_stream() was not called");
+    if (data.empty())
+        return;
+    if (compressor) {
+        data = compressor->compress(data, http_compressor::flush_mode::flush);
+        if (data.empty())
+            return;
+    }
+    char size_line[20];
+    int n = std::snprintf(size_line, sizeof(size_line), "%zx\r\n", data.size());
+
+    // the chunk itself is moved, only its framing is new
+    std::vector<std::string> segments;
+    segments.reserve(3);
+    segments.emplace_back(size_line, static_cast<std::size_t>(n));
+    segments.push_back(std::move(data));
+    segments.emplace_back("\r\n");
+    send_message(std::move(segments), false);
+}
+
+void http_response::write_chunk(cppress::sockets::data_buffer data) {
+    if (!streaming)
+        throw std::runtime_error("Error writing HTTP chunk: begin_stream() was not called");
+    if (compressor) {
+        write_chunk(data.to_string());
+        return;
+    }
+    if (data.empty())
+        return;
+    char size_line[20];
+    int n = std::snprintf(size_line, sizeof(size_line), "%zx\r\n", data.size());
+
+    std::vector<cppress::sockets::output_segment> segments;
+    segments.reserve(3);
+    segments.emplace_back(
+        cppress::sockets::data_buffer(std::string(size_line, static_cast<std::size_t>(n))));
+    segments.emplace_back(std::move(data));
+    segments.emplace_back(cppress::sockets::data_buffer(std::string("\r\n")));
+    send_output(std::move(segments), false);
+}
+
+/**
+ * Implementation Notes:
+ * - The subscriber gets copies of the send functions and the owner that
+ *   keeps them valid; they only hold a pointer and a slot
+ * - Without send_segments (HTTP/2) events are copied into strings, the
+ *   session frames them anyway
+ */
+std::shared_ptr<sse_subscriber> http_response::begin_event_stream() {
+    headers.erase("CONTENT-TYPE");
+    headers.erase("CACHE-CONTROL");
+    headers.emplace("CONTENT-TYPE", "text/event-stream");
+    headers.emplace("CACHE-CONTROL", "no-cache");
+    coding = content_coding::identity;
+    begin_stream();
+    streaming = false;  // the subscriber ends the stream
+
+    sse_subscriber::send_function send;
+    if (send_segments) {
+        send = send_segments;
+    } else {
+        send = [send_message = send_message](
+                   std::vector<cppress::sockets::output_segment>&& segments, bool last) {
+            std::vector<std::string> parts;
+            parts.reserve(segments.size());
+            for (auto& segment : segments)
+                parts.push_back(segment.memory.to_string());
+            send_message(std::move(parts), last);
+        };
+    }
+    return std::make_shared<sse_subscriber>(std::move(send), connection_state, connection_owner);
+}
+
+void http_response::end_stream(const std::multimap<std::string, std::string>& extra_trailers) {
+    if (!streaming)
+        throw std::runtime_error("Error ending HTTP stream: begin_stream() was not called");
+    streaming = false;
+
+    std::string last;
+    if (compressor) {
+        // the encoder's closing bytes go out as one more chunk
+        std::string tail = compressor->compress({}, http_compressor::flush_mode::finish);
+        compressor.reset();
+        if (!tail.empty()) {
+            char size_line[20];
+            int n = std::snprintf(size_line, sizeof(size_line), "%zx\r\n", tail.size());
+            last.append(size_line, static_cast<std::size_t>(n)).append(tail).append("\r\n");
+        }
+    }
+    last += "0\r\n";
+    for (const auto& trailer : trailers)
+        last += trailer.first + ": " + trailer.second + "\r\n";
+    for (const auto& trailer : extra_trailers)
+        last += header_name(trailer.first) + ": " + trailer.second + "\r\n";
+    last += "\r\n";
+    std::vector<std::string> segments;
+    segments.push_back(std::move(last));
+    send_message(std::move(segments), true);
+}
+
+void http_response::send_output(std::vector<cppress::sockets::output_segment>&& segments,
+                                bool last) {
+    if (send_segments) {
+        send_segments(std::move(segments), last);
+        return;
+    }
+    std::vector<std::string> parts;
+    parts.reserve(segments.size());
+    for (auto& segment : segments)
+        parts.push_back(segment.is_file() ? segment.file.read() : segment.memory.to_string());
+    send_message(std::move(parts), last);
+}
+
+/**
+ * Implementation Notes:
+ * - Ranges are resolved only for a 200: an error page or a redirect is
+ *   never sliced
+ * - Multipart framing is built in memory between the file segments; the
+ *   boundary is 64 random bits and the parts are not scanned for it
+ */
+void http_response::send_file(const cppress::sockets::file_region& file,
+                              const http_headers& request_headers) {
+    if (apply_not_modified()) {
+        send();
+        return;
+    }
+    const std::uint64_t size = file.size();
+    std::vector<byte_range> ranges;
+    range_result result = range_result::full;
+    if (status_code == 200 && request_headers.contains(header_id::range)) {
+        auto etag = headers.find("ETAG");
+        auto modified = headers.find("LAST-MODIFIED");
+        if (if_range_matches(request_headers.get("If-Range"),
+                             etag == headers.end() ? std::string_view() : etag->second,
+                             modified == headers.end() ? std::string_view() : modified->second))
+            result = parse_range_header(request_headers.get(header_id::range), size, ranges);
+    }
+
+    for (const char* name : {"ACCEPT-RANGES", "CONTENT-LENGTH", "CONTENT-RANGE",
+                             "TRANSFER-ENCODING"})
+        headers.erase(name);
+    headers.emplace("ACCEPT-RANGES", "bytes");
+
+    std::vector<cppress::sockets::output_segment> segments;
+    std::uint64_t length = 0;
+    if (result == range_result::unsatisfiable) {
+        set_status(416, "Range Not Satisfiable");
+        headers.emplace("CONTENT-RANGE", "bytes */" + std::to_string(size));
+    } else if (result == range_result::full) {
+        length = size;
+        segments.emplace_back(file);
+    } else if (ranges.size() == 1) {
+        set_status(206, "Partial Content");
+        headers.emplace("CONTENT-RANGE", content_range(ranges[0], size));
+        length = ranges[0].size();
+        segments.emplace_back(file.slice(static_cast<std::size_t>(ranges[0].first),
+                                         static_cast<std::size_t>(length)));
+    } else {
+        set_status(206, "Partial Content");
+        thread_local std::mt19937_64 random{std::random_device{}()};
+        char boundary[24];
+        std::snprintf(boundary, sizeof(boundary), "%016llx",
+                      static_cast<unsigned long long>(random()));
+
+        auto type = headers.find("CONTENT-TYPE");
+        std::string part_type =
+            type == headers.end() ? "" : "Content-Type: " + type->second + "\r\n";
+        headers.erase("CONTENT-TYPE");
+        headers.emplace("CONTENT-TYPE", std::string("multipart/byteranges; boundary=") + boundary);
+
+        for (std::size_t i = 0; i < ranges.size(); ++i) {
+            std::string part_head = (i == 0 ? "--" : "\r\n--") + std::string(boundary) + "\r\n" +
+                                    part_type + "Content-Range: " + content_range(ranges[i], size) +
+                                    "\r\n\r\n";
+            length += part_head.size() + ranges[i].size();
+            segments.emplace_back(cppress::sockets::data_buffer(std::move(part_head)));
+            segments.emplace_back(file.slice(static_cast<std::size_t>(ranges[i].first),
+                                             static_cast<std::size_t>(ranges[i].size())));
+        }
+        std::string tail = "\r\n--" + std::string(boundary) + "--\r\n";
+        length += tail.size();
+        segments.emplace_back(cppress::sockets::data_buffer(std::move(tail)));
+    }
+    headers.emplace("CONTENT-LENGTH", std::to_string(length));
+
+    segments.insert(segments.begin(), cppress::sockets::output_segment(
+                                          cppress::sockets::data_buffer(head_to_string())));
+    send_output(std::move(segments), true);
+}
+
+void http_response::send_buffer(const cppress::sockets::data_buffer& body) {
+    shared::phase_scope serializing(shared::request_phase::serialize);
+    if (apply_not_modified()) {
+        send();
+        return;
+    }
+    headers.erase("CONTENT-LENGTH");
+    headers.erase("TRANSFER-ENCODING");
+    headers.emplace("CONTENT-LENGTH", std::to_string(body.size()));
+
+    std::vector<cppress::sockets::output_segment> segments;
+    segments.reserve(2);
+    segments.emplace_back(cppress::sockets::data_buffer(head_to_string()));
+    if (!body.empty())
+        segments.emplace_back(cppress::sockets::data_buffer(body));
+    send_output(std::move(segments), true);
+}
+
+/**
+ * Implementation Notes:
+ * - A compressed body is a new buffer anyway, send() builds it from the
+ *   moved-in body
+ */
+void http_response::send_body(std::string&& body) {
+    shared::phase_scope serializing(shared::request_phase::serialize);
+    if (apply_not_modified()) {
+        send();
+        return;
+    }
+    headers.erase("CONTENT-LENGTH");
+    headers.erase("TRANSFER-ENCODING");
+    headers.emplace("CONTENT-LENGTH", std::to_string(body.size()));
+    if (should_compress(false, body.size())) {
+        this->body = std::move(body);
+        send();
+        return;
+    }
+
+    std::vector<cppress::sockets::output_segment> segments;
+    segments.reserve(2);
+    segments.emplace_back(cppress::sockets::data_buffer(head_to_string()));
+    if (!body.empty())
+        segments.emplace_back(cppress::sockets::data_buffer(std::move(body)));
+    send_output(std::move(segments), true);
+}
+
+void http_response::send_serialized(const cppress::sockets::data_buffer& message) {
+    std::vector<cppress::sockets::output_segment> segments;
+    segments.emplace_back(cppress::sockets::data_buffer(message));
+    send_output(std::move(segments), true);
+}
+
+void http_response::send_serialized(std::vector<cppress::sockets::data_buffer>&& parts) {
+    std::vector<cppress::sockets::output_segment> segments;
+    segments.reserve(parts.size());
+    for (auto& part : parts)
+        segments.emplace_back(std::move(part));
+    send_output(std::move(segments), true);
+}
+
+http_response http_response::detached(std::function<void(std::vector<std::string>&&, bool)> sink,
+                                      std::function<void()> on_end) {
+    return http_response("HTTP/1.1", {}, std::move(on_end), std::move(sink));
+}
+}  // namespace cppress::http
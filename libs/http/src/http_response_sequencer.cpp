@@ -0,0 +1,119 @@
+#include "../includes/http_response_sequencer.hpp"
+
+#include <utility>
+
+namespace cppress::http {
+
+http_response_sequencer::http_response_sequencer(send_function send, close_function close)
+    : send_(std::move(send)), close_(std::move(close)) {}
+
+std::uint64_t http_response_sequencer::open() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return next_slot_++;
+}
+
+void http_response_sequencer::write(std::uint64_t slot, std::vector<std::string>&& parts,
+                                    bool last) {
+    // strings are moved into the output chain, not copied
+    std::vector<cppress::sockets::output_segment> segments;
+    segments.reserve(parts.size());
+    for (auto& part : parts)
+        segments.emplace_back(cppress::sockets::data_buffer(std::move(part)));
+    write(slot, std::move(segments), last);
+}
+
+void http_response_sequencer::write(std::uint64_t slot,
+                                    std::vector<cppress::sockets::output_segment>&& parts,
+                                    bool last) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (closed_)
+        return;
+    if (slot > front_) {
+        auto& waiting = waiting_[slot];
+        for (auto& part : parts)
+            waiting.parts.push_back(std::move(part));
+        waiting.complete = waiting.complete || last;
+        return;
+    }
+    send_(std::move(parts));
+    if (slot < front_)
+        return;
+    if (!last) {
+        front_open_ = true;
+        return;
+    }
+    front_open_ = false;
+    if (close_front_) {
+        close_locked();
+        return;
+    }
+    ++front_;
+    drain_locked();
+}
+
+void http_response_sequencer::close(std::uint64_t slot) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (closed_)
+        return;
+    if (slot > front_) {
+        waiting_[slot].close = true;
+        return;
+    }
+    if (slot == front_ && front_open_) {
+        close_front_ = true;  // after the rest of the streamed response
+        return;
+    }
+    close_locked();
+}
+
+bool http_response_sequencer::idle() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return !closed_ && front_ == next_slot_;
+}
+
+void http_response_sequencer::disconnect() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = true;
+    waiting_.clear();
+}
+
+bool http_response_sequencer::is_closed() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return closed_;
+}
+
+/**
+ * Implementation Notes:
+ * - Waiting slots are complete, closing, or partly written streams; a
+ *   partly written stream stops the drain and its later writes go straight
+ *   out, a closing slot whose response was never written closes at once
+ */
+void http_response_sequencer::drain_locked() {
+    while (!waiting_.empty() && waiting_.begin()->first == front_) {
+        auto node = waiting_.extract(waiting_.begin());
+        auto& response = node.mapped();
+        bool written = !response.parts.empty();
+        if (written)
+            send_(std::move(response.parts));
+        if (!response.complete && written) {
+            front_open_ = true;
+            close_front_ = response.close;
+            return;
+        }
+        if (response.close) {
+            close_locked();
+            return;
+        }
+        if (!response.complete)
+            return;  // nothing written yet, it streams straight out once it is
+        ++front_;
+    }
+}
+
+void http_response_sequencer::close_locked() {
+    closed_ = true;
+    waiting_.clear();
+    close_();
+}
+
+}  // namespace cppress::http
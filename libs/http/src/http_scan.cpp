@@ -0,0 +1,277 @@
+#include "../includes/http_scan.hpp"
+
+#include <array>
+#include <cstdint>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define CPPRESS_SCAN_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define CPPRESS_SCAN_NEON 1
+#endif
+
+namespace cppress::http::scan {
+
+namespace {
+/// Byte classes, one bit each
+enum : std::uint8_t { TOKEN_STOP = 1, TARGET_STOP = 2, VALUE_STOP = 4 };
+
+constexpr std::array<std::uint8_t, 256> make_classes() {
+    std::array<std::uint8_t, 256> t{};
+    for (int c = 0; c < 256; ++c) {
+        bool alnum = (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+        bool tchar = alnum;
+        for (char s : {'!', '#', '$', '%', '&', '\'', '*', '+', '-', '.', '^', '_', '`', '|', '~'})
+            tchar = tchar || c == s;
+        std::uint8_t bits = 0;
+        if (!tchar)
+            bits |= TOKEN_STOP;
+        if (c <= 0x20 || c == 0x7f)
+            bits |= TARGET_STOP;
+        if ((c < 0x20 && c != '\t') || c == 0x7f)
+            bits |= VALUE_STOP;
+        t[static_cast<std::size_t>(c)] = bits;
+    }
+    return t;
+}
+
+constexpr std::array<std::uint8_t, 256> classes = make_classes();
+
+inline bool stops(char ch, std::uint8_t kind) noexcept {
+    return (classes[static_cast<unsigned char>(ch)] & kind) != 0;
+}
+
+inline std::size_t scalar_scan(const char* p, std::size_t from, std::size_t n,
+                               std::uint8_t kind) noexcept {
+    while (from < n && !stops(p[from], kind))
+        ++from;
+    return from;
+}
+
+std::size_t token_scalar(const char* p, std::size_t from, std::size_t n) noexcept {
+    return scalar_scan(p, from, n, TOKEN_STOP);
+}
+
+std::size_t target_scalar(const char* p, std::size_t from, std::size_t n) noexcept {
+    return scalar_scan(p, from, n, TARGET_STOP);
+}
+
+std::size_t value_scalar(const char* p, std::size_t from, std::size_t n) noexcept {
+    return scalar_scan(p, from, n, VALUE_STOP);
+}
+
+#if CPPRESS_SCAN_X86
+/**
+ * SSE4.2 range matching, as in picohttpparser: one PCMPESTRI tests 16
+ * bytes against up to 8 byte ranges. The token ranges are a superset of the
+ * stop bytes ('{' to 0xff also covers '|' and '~'), hits are confirmed
+ * against the table.
+ */
+template <std::uint8_t Kind>
+__attribute__((target("sse4.2"))) std::size_t sse42_scan(const char* p, std::size_t from,
+                                                         std::size_t n, const char* ranges,
+                                                         int ranges_size) noexcept {
+    const __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ranges));
+    while (n - from >= 16) {
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + from));
+        int i = _mm_cmpestri(r, ranges_size, b, 16,
+                             _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES | _SIDD_LEAST_SIGNIFICANT);
+        if (i == 16) {
+            from += 16;
+            continue;
+        }
+        from += static_cast<std::size_t>(i);
+        if (stops(p[from], Kind))
+            return from;
+        ++from;
+    }
+    return scalar_scan(p, from, n, Kind);
+}
+
+alignas(16) const char token_ranges[16] = {'\x00', ' ',  '"', '"', '(', ')', ',', ',',
+                                           '/',    '/',  ':', '@', '[', ']', '{', '\xff'};
+alignas(16) const char target_ranges[16] = {'\x00', ' ', '\x7f', '\x7f'};
+alignas(16) const char value_ranges[16] = {'\x00', '\x08', '\x0a', '\x1f', '\x7f', '\x7f'};
+
+std::size_t token_sse42(const char* p, std::size_t from, std::size_t n) noexcept {
+    return sse42_scan<TOKEN_STOP>(p, from, n, token_ranges, 16);
+}
+
+std::size_t target_sse42(const char* p, std::size_t from, std::size_t n) noexcept {
+    return sse42_scan<TARGET_STOP>(p, from, n, target_ranges, 4);
+}
+
+std::size_t value_sse42(const char* p, std::size_t from, std::size_t n) noexcept {
+    return sse42_scan<VALUE_STOP>(p, from, n, value_ranges, 6);
+}
+
+/// 32 bytes per step: unsigned "b <= limit" is min(b, limit) == b
+__attribute__((target("avx2"))) inline std::uint32_t avx2_ctl_mask(__m256i b, char limit) noexcept {
+    __m256i low = _mm256_cmpeq_epi8(_mm256_min_epu8(b, _mm256_set1_epi8(limit)), b);
+    __m256i del = _mm256_cmpeq_epi8(b, _mm256_set1_epi8('\x7f'));
+    return static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(low, del)));
+}
+
+__attribute__((target("avx2"))) std::size_t target_avx2(const char* p, std::size_t from,
+                                                        std::size_t n) noexcept {
+    while (n - from >= 32) {
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + from));
+        if (std::uint32_t m = avx2_ctl_mask(b, ' '))
+            return from + static_cast<std::size_t>(__builtin_ctz(m));
+        from += 32;
+    }
+    return target_sse42(p, from, n);
+}
+
+__attribute__((target("avx2"))) std::size_t value_avx2(const char* p, std::size_t from,
+                                                       std::size_t n) noexcept {
+    while (n - from >= 32) {
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + from));
+        std::uint32_t tab = static_cast<std::uint32_t>(
+            _mm256_movemask_epi8(_mm256_cmpeq_epi8(b, _mm256_set1_epi8('\t'))));
+        if (std::uint32_t m = avx2_ctl_mask(b, '\x1f') & ~tab)
+            return from + static_cast<std::size_t>(__builtin_ctz(m));
+        from += 32;
+    }
+    return value_sse42(p, from, n);
+}
+#endif
+
+#if CPPRESS_SCAN_NEON
+/// 16 bytes per step; a non-zero lane means a candidate, located by the scalar loop
+template <std::uint8_t Kind, typename Mask>
+std::size_t neon_scan(const char* p, std::size_t from, std::size_t n, Mask mask) noexcept {
+    while (n - from >= 16) {
+        uint8x16_t b = vld1q_u8(reinterpret_cast<const std::uint8_t*>(p + from));
+        if (vmaxvq_u8(mask(b)) != 0) {
+            std::size_t end = scalar_scan(p, from, from + 16, Kind);
+            if (end != from + 16)
+                return end;
+        }
+        from += 16;
+    }
+    return scalar_scan(p, from, n, Kind);
+}
+
+std::size_t token_neon(const char* p, std::size_t from, std::size_t n) noexcept {
+    return neon_scan<TOKEN_STOP>(p, from, n, [](uint8x16_t b) {
+        uint8x16_t m = vorrq_u8(vcleq_u8(b, vdupq_n_u8(0x20)), vcgeq_u8(b, vdupq_n_u8('{')));
+        m = vorrq_u8(m, vceqq_u8(b, vdupq_n_u8('"')));
+        m = vorrq_u8(m, vandq_u8(vcgeq_u8(b, vdupq_n_u8('(')), vcleq_u8(b, vdupq_n_u8(')'))));
+        m = vorrq_u8(m, vceqq_u8(b, vdupq_n_u8(',')));
+        m = vorrq_u8(m, vceqq_u8(b, vdupq_n_u8('/')));
+        m = vorrq_u8(m, vandq_u8(vcgeq_u8(b, vdupq_n_u8(':')), vcleq_u8(b, vdupq_n_u8('@'))));
+        return vorrq_u8(m, vandq_u8(vcgeq_u8(b, vdupq_n_u8('[')), vcleq_u8(b, vdupq_n_u8(']'))));
+    });
+}
+
+std::size_t target_neon(const char* p, std::size_t from, std::size_t n) noexcept {
+    return neon_scan<TARGET_STOP>(p, from, n, [](uint8x16_t b) {
+        return vorrq_u8(vcleq_u8(b, vdupq_n_u8(0x20)), vceqq_u8(b, vdupq_n_u8(0x7f)));
+    });
+}
+
+std::size_t value_neon(const char* p, std::size_t from, std::size_t n) noexcept {
+    return neon_scan<VALUE_STOP>(p, from, n, [](uint8x16_t b) {
+        uint8x16_t ctl = vbicq_u8(vcleq_u8(b, vdupq_n_u8(0x1f)), vceqq_u8(b, vdupq_n_u8('\t')));
+        return vorrq_u8(ctl, vceqq_u8(b, vdupq_n_u8(0x7f)));
+    });
+}
+#endif
+
+using scan_fn = std::size_t (*)(const char*, std::size_t, std::size_t) noexcept;
+
+struct implementation {
+    level which;
+    scan_fn token;
+    scan_fn target;
+    scan_fn value;
+};
+
+implementation pick(level l) noexcept {
+    switch (l) {
+#if CPPRESS_SCAN_X86
+        case level::avx2:
+            return {level::avx2, token_sse42, target_avx2, value_avx2};
+        case level::sse42:
+            return {level::sse42, token_sse42, target_sse42, value_sse42};
+#endif
+#if CPPRESS_SCAN_NEON
+        case level::neon:
+            return {level::neon, token_neon, target_neon, value_neon};
+#endif
+        default:
+            return {level::scalar, token_scalar, target_scalar, value_scalar};
+    }
+}
+
+level detect() noexcept {
+#if CPPRESS_SCAN_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return level::avx2;
+    if (__builtin_cpu_supports("sse4.2"))
+        return level::sse42;
+    return level::scalar;
+#elif CPPRESS_SCAN_NEON
+    return level::neon;
+#else
+    return level::scalar;
+#endif
+}
+
+const level detected = detect();
+implementation current = pick(detected);
+
+bool supported(level l) noexcept {
+    switch (l) {
+        case level::scalar:
+            return true;
+        case level::sse42:
+            return detected == level::sse42 || detected == level::avx2;
+        case level::avx2:
+        case level::neon:
+            return detected == l;
+    }
+    return false;
+}
+}  // namespace
+
+std::size_t token_end(const char* p, std::size_t from, std::size_t n) noexcept {
+    return current.token(p, from, n);
+}
+
+std::size_t target_end(const char* p, std::size_t from, std::size_t n) noexcept {
+    return current.target(p, from, n);
+}
+
+std::size_t value_end(const char* p, std::size_t from, std::size_t n) noexcept {
+    return current.value(p, from, n);
+}
+
+level active() noexcept { return current.which; }
+
+level best() noexcept { return detected; }
+
+bool use(level l) noexcept {
+    if (!supported(l))
+        return false;
+    current = pick(l);
+    return true;
+}
+
+const char* name(level l) noexcept {
+    switch (l) {
+        case level::scalar:
+            return "scalar";
+        case level::sse42:
+            return "sse4.2";
+        case level::avx2:
+            return "avx2";
+        case level::neon:
+            return "neon";
+    }
+    return "unknown";
+}
+}  // namespace cppress::http::scan
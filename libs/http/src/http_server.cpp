@@ -4,83 +4,471 @@
 #include <chrono>
 #include <iostream>
 #include <sstream>
-#include <thread>
+
+#include "shared/includes/alloc_accounting.hpp"
+#include "shared/includes/cpu_topology.hpp"
+#include "shared/includes/utils.hpp"
 namespace cppress::http {
 
-http_server::http_server(const cppress::sockets::socket_address& addr, int timeout_milliseconds)
-    : cppress::sockets::epoll_server(config::MAX_FILE_DESCRIPTORS) {
+namespace {
+/// true if a comma-separated header of this id lists the token, compared case-insensitively
+bool has_token(const http_headers& headers, header_id id, std::string_view token) {
+    bool found = false;
+    headers.for_each(id, [&found, token](std::string_view value) {
+        found = found || shared::has_token(value, token);
+    });
+    return found;
+}
+}  // namespace
+
+http_server::http_server(const cppress::sockets::socket_address& addr, int timeout_milliseconds,
+                         std::size_t reactor_count)
+    : cppress::sockets::epoll_server(config::MAX_FILE_DESCRIPTORS, reactor_count,
+                                     config::PIN_REACTORS,
+                                     config::USE_IO_URING ? cppress::sockets::io_backend::io_uring
+                                                          : cppress::sockets::io_backend::epoll) {
     this->timeout_milliseconds = timeout_milliseconds;
-    this->server_socket = cppress::sockets::make_listener_socket(
-        addr.port().value(), addr.address().string(), config::BACKLOG_SIZE);
+    this->server_socket =
+        cppress::sockets::make_listener_socket(addr.port().value(), addr.address().string(),
+                                               config::BACKLOG_SIZE, config::SOCKET_OPTIONS);
     if (!this->server_socket) {
         throw std::runtime_error("Failed to create listener socket");
     }
 
     this->register_listener_socket(this->server_socket);
 
-    // spin a thread that cleans idle connections each MAX_IDLE_TIME_SECONDS
-    std::function<void(int)> close_connection_for_handler = [this](int fd) -> void {
-        this->close_connection(fd);
-    };
-    std::thread([this, close_connection_for_handler]() {
-        while (true) {
-            std::this_thread::sleep_for(std::chrono::seconds(config::MAX_IDLE_TIME_SECONDS));
-            parser_.cleanup_idle_connections(config::MAX_IDLE_TIME_SECONDS,
-                                             close_connection_for_handler);
-        }
-    }).detach();
+    // one SO_REUSEPORT listener per extra reactor, the kernel balances accepts between them
+    for (std::size_t i = 1; i < this->reactor_count(); ++i) {
+        auto sock = cppress::sockets::make_listener_socket(
+            addr.port().value(), addr.address().string(), config::BACKLOG_SIZE,
+            config::SOCKET_OPTIONS);
+        this->register_listener_socket(sock);
+        reactor_sockets.push_back(sock);
+    }
+
+    // keep-alive connections are reaped by the event loop's timer wheel
+    this->set_idle_timeout(config::MAX_IDLE_TIME_SECONDS);
+    this->set_write_watermarks(config::WRITE_HIGH_WATERMARK, config::WRITE_LOW_WATERMARK);
+    this->set_socket_options(config::SOCKET_OPTIONS);
+    this->set_zerocopy_threshold(config::ZEROCOPY_THRESHOLD);
+    this->set_max_connections(config::MAX_CONNECTIONS);
+    if (config::NUMA_PLACEMENT)
+        this->set_reactor_cpus(
+            cppress::shared::cpu_topology::system().place(this->reactor_count(), 0).reactor_cpus);
 }
 
 void http_server::on_message_received(std::shared_ptr<cppress::sockets::connection> conn,
                                       const cppress::sockets::data_buffer& message) {
-    auto close_connection_for_objects = [this, conn]() { this->close_connection(conn); };
-    auto send_message_for_request = [this, conn](const std::string& message) {
-        this->send_message(conn, cppress::sockets::data_buffer(message));
+    cppress::shared::phase_scope parsing(cppress::shared::request_phase::parse);
+    if (paused_count_.load(std::memory_order_acquire) != 0) {
+        std::lock_guard<std::mutex> lock(paused_mutex_);
+        auto it = paused_.find(conn.get());
+        if (it != paused_.end()) {
+            // responses are not draining, hold the request until they do
+            it->second.push_back(message);
+            return;
+        }
+    }
+
+    if (auto session = session_for(conn.get())) {
+        receive_http2(conn, session, message.view());
+        return;
+    }
+    if (auto ws = websocket_for(conn.get())) {
+        if (!ws->receive(message.view()))
+            this->stop_reading_from_connection(conn);
+        return;
+    }
+    if (config::HTTP2_ENABLED && message.view().substr(0, 14) == HTTP2_PREFACE.substr(0, 14) &&
+        !has_sequencer(conn.get())) {
+        // a client with prior knowledge opens with the preface instead of a request
+        auto session = make_session(conn);
+        session->start();
+        this->clear_deadline(conn, cppress::sockets::connection_deadline::header);
+        receive_http2(conn, session, message.view());
+        return;
+    }
+
+    const auto read_at = timestamp_requests ? std::chrono::steady_clock::now()
+                                            : std::chrono::steady_clock::time_point();
+    bool first = true;
+    for (;;) {
+        http_parse_result result(false, "", "", "", {}, "");
+        try {
+            result = first ? parser_.parse(conn, message) : parser_.parse_next(conn);
+        } catch (const std::exception& e) {
+            reject_request(conn);
+            return;
+        }
+        first = false;
+        if (!dispatch_request(conn, result, read_at) || !result.has_next)
+            return;
+    }
+}
+
+void http_server::reject_request(const std::shared_ptr<cppress::sockets::connection>& conn) {
+    this->stop_reading_from_connection(conn);
+    auto owner = sequencer_for(conn);
+    auto* sequencer = owner.get();
+    auto slot = sequencer->open();
+    auto close = [sequencer, slot]() { sequencer->close(slot); };
+    auto send = [sequencer, slot](std::vector<std::string>&& parts, bool last) {
+        sequencer->write(slot, std::move(parts), last);
     };
 
-    bool is_complete = false;
-    std::string method = "", uri = "", http_version = "", body = "";
-    std::multimap<std::string, std::string> headers;
+    // Create HTTP request object with parsed data
+    http_request request("BAD_REQUEST", "", "", {}, "", close);
+    request.connection_owner = owner;
+
+    // Create HTTP response object with default HTTP/1.1 version
+    http_response response("HTTP/1.1", {}, close, send);
+    response.connection_owner = std::move(owner);
+    this->on_request_received(request, response);
+}
+
+bool http_server::dispatch_request(const std::shared_ptr<cppress::sockets::connection>& conn,
+                                   http_parse_result& result,
+                                   std::chrono::steady_clock::time_point read_at) {
+    if (!result.headers_complete)
+        return false;  // the header deadline keeps bounding the rest of the head
+
     try {
-        auto result = parser_.parse(conn, message);
-        is_complete = result.is_complete;
-        method = result.method;
-        uri = result.uri;
-        http_version = result.http_version;
-        body = result.body;
-        headers = result.headers;
-
-        if (static_cast<int>(headers.size()) >= 0)
-            on_headers_received(conn, headers, method, uri, http_version, body);
-
-        if (!is_complete)
-            return;
+        on_headers_received(conn, result.headers, result.method, result.uri,
+                            result.http_version, result.body);
     } catch (const std::exception& e) {
-        this->stop_reading_from_connection(conn);
+        reject_request(conn);
+        return false;
+    }
 
-        // Create HTTP request object with parsed data
-        http_request request("BAD_REQUEST", uri, http_version, headers, body,
-                             close_connection_for_objects);
+    if (result.expects_continue && !answer_expectation(conn, result))
+        return false;
 
-        // Create HTTP response object with default HTTP/1.1 version
-        http_response response("HTTP/1.1", {}, close_connection_for_objects,
-                               send_message_for_request);
-        this->on_request_received(request, response);
-        return;
+    if (!result.is_complete) {
+        // headers are in, waiting for more body: bound the silence between reads
+        this->clear_deadline(conn, cppress::sockets::connection_deadline::header);
+        this->set_deadline(conn, cppress::sockets::connection_deadline::body,
+                           config::MAX_BODY_READ_TIME_SECONDS);
+        return false;
     }
+    this->clear_deadline(conn, cppress::sockets::connection_deadline::header);
+    this->clear_deadline(conn, cppress::sockets::connection_deadline::body);
 
-    // Shall be removed to support persistent connections
-    // this->stop_reading_from_connection(conn);
+    if (websocket_selector_ && upgrade_to_websocket(conn, result))
+        return false;  // later bytes are WebSocket frames
+    if (config::HTTP2_ENABLED && upgrade_to_http2(conn, result))
+        return false;  // later bytes are HTTP/2 frames
 
-    // Create HTTP request object with parsed data
-    http_request request(method, uri, http_version, headers, body, close_connection_for_objects);
+    // slots are taken in arrival order, responses leave in that order whichever
+    // worker finishes first. The closures hold a plain pointer and the slot, small
+    // enough for std::function to store inline; the request and response keep the
+    // sequencer alive instead
+    auto owner = sequencer_for(conn);
+    auto* sequencer = owner.get();
+    auto slot = sequencer->open();
+    auto close = [sequencer, slot]() { sequencer->close(slot); };
+    auto send = [sequencer, slot](std::vector<std::string>&& parts, bool last) {
+        cppress::shared::phase_scope writing(cppress::shared::request_phase::write);
+        sequencer->write(slot, std::move(parts), last);
+    };
+    auto send_segments = [sequencer, slot](
+                             std::vector<cppress::sockets::output_segment>&& segments, bool last) {
+        cppress::shared::phase_scope writing(cppress::shared::request_phase::write);
+        sequencer->write(slot, std::move(segments), last);
+    };
 
     // Create HTTP response object with default HTTP/1.1 version
-    http_response response("HTTP/1.1", {}, close_connection_for_objects, send_message_for_request);
+    http_response response("HTTP/1.1", {}, close, send, send_segments);
+    response.connection_owner = owner;
+    response.connection_state = [sequencer]() {
+        if (sequencer->is_closed())
+            return output_state::closed;
+        return sequencer->congested() ? output_state::congested : output_state::writable;
+    };
+    response.capture_preconditions(result.method, result.headers);
+
+    // a draining server ends the connection after this response
+    if (this->is_draining())
+        result.headers.add("Connection", "close");
+
+    // Create HTTP request object with parsed data
+    http_request request(result.method, result.uri, result.http_version,
+                         std::move(result.headers), std::move(result.body), close);
+    request.body_spool = result.body_spool;
+    request.multipart = result.multipart;
+    request.connection_owner = std::move(owner);
+    request.received_at = read_at;
+    request.remote_address = conn->remote_endpoint().address().string();
+    request.connection = conn.get();
 
     // Invoke user-defined request handler with parsed request and response objects
     // User callback populates response and optionally closes connection
+    cppress::shared::count_request();
     this->on_request_received(request, response);
+    return true;
+}
+
+/**
+ * Implementation Notes:
+ * - The interim 100 takes a slot of its own, so it leaves after the responses
+ *   of earlier pipelined requests and before the final one
+ * - A refused request is not read any further: the client may already be
+ *   sending the body, so the connection closes after the final response
+ *   instead of skipping the body to keep it
+ */
+bool http_server::answer_expectation(const std::shared_ptr<cppress::sockets::connection>& conn,
+                                     http_parse_result& result) {
+    auto owner = sequencer_for(conn);
+    auto* sequencer = owner.get();
+    auto slot = sequencer->open();
+    auto close = [sequencer, slot]() { sequencer->close(slot); };
+    auto send = [sequencer, slot](std::vector<std::string>&& parts, bool last) {
+        sequencer->write(slot, std::move(parts), last);
+    };
+
+    http_response response("HTTP/1.1", {}, close, send);
+    response.connection_owner = owner;
+    http_request request(result.method, result.uri, result.http_version,
+                         std::move(result.headers), "", close);
+    request.remote_address = conn->remote_endpoint().address().string();
+    request.connection = conn.get();
+
+    bool accepted;
+    try {
+        accepted = on_expect_continue(request, response);
+    } catch (const std::exception& e) {
+        accepted = false;
+    }
+    if (accepted) {
+        sequencer->write(slot, std::vector<std::string>{"HTTP/1.1 100 Continue\r\n\r\n"}, true);
+        return true;
+    }
+
+    this->stop_reading_from_connection(conn);
+    parser_.discard(conn);
+    this->clear_deadline(conn, cppress::sockets::connection_deadline::header);
+    sequencer->close(slot);
+    return false;
+}
+
+std::shared_ptr<http_response_sequencer> http_server::sequencer_for(
+    const std::shared_ptr<cppress::sockets::connection>& conn) {
+    std::lock_guard<std::mutex> lock(sequencers_mutex_);
+    auto& sequencer = sequencers_[conn.get()];
+    if (!sequencer) {
+        // the connection is held weakly: a response outliving it must not keep it open
+        std::weak_ptr<cppress::sockets::connection> weak = conn;
+        sequencer = std::make_shared<http_response_sequencer>(
+            [this, weak](std::vector<cppress::sockets::output_segment>&& segments) {
+                if (auto conn = weak.lock())
+                    this->send_message(conn, std::move(segments));
+            },
+            [this, weak]() {
+                if (auto conn = weak.lock())
+                    this->close_connection(conn);
+            });
+    }
+    return sequencer;
+}
+
+/**
+ * Implementation Notes:
+ * - Only the first request of a connection may upgrade, and only without a
+ *   streamed body: the 101 must be the next bytes written, and the parser's
+ *   buffered input must end with the request
+ * - The upgrade request becomes stream 1 and is answered over HTTP/2
+ */
+bool http_server::upgrade_to_http2(const std::shared_ptr<cppress::sockets::connection>& conn,
+                                   http_parse_result& result) {
+    if (result.has_next || result.body_spool || !result.headers.contains("HTTP2-Settings"))
+        return false;
+    bool h2c = false;
+    result.headers.for_each(header_id::upgrade, [&h2c](std::string_view value) {
+        h2c = h2c || value.find("h2c") != std::string_view::npos;
+    });
+    if (!h2c)
+        return false;
+    if (has_sequencer(conn.get()))
+        return false;
+
+    auto session = make_session(conn);
+    this->send_message(conn, cppress::sockets::data_buffer(std::string(
+                                 "HTTP/1.1 101 Switching Protocols\r\n"
+                                 "Connection: Upgrade\r\nUpgrade: h2c\r\n\r\n")));
+    if (!session->start_upgraded(result.headers.get("HTTP2-Settings"))) {
+        {
+            std::lock_guard<std::mutex> lock(sessions_mutex_);
+            sessions_.erase(conn.get());
+        }
+        this->close_connection(conn);
+        return true;
+    }
+    parser_.discard(conn);
+
+    http2_request request;
+    request.stream_id = 1;
+    request.method = result.method;
+    request.uri = result.uri;
+    request.headers = std::move(result.headers);
+    request.body = std::move(result.body);
+    dispatch_http2(conn, session, request);
+    return true;
+}
+
+/**
+ * Implementation Notes:
+ * - The handshake must be a complete GET with nothing pipelined behind it
+ *   and no response of an earlier request still being written, so the 101
+ *   is the next thing the client reads and every later byte is a frame
+ * - An invalid or unselected handshake is dispatched as plain HTTP
+ * - The connection's body deadline becomes the WebSocket timer; keeping it
+ *   armed also keeps the idle deadline, meant for HTTP keep-alive, suspended
+ */
+bool http_server::upgrade_to_websocket(const std::shared_ptr<cppress::sockets::connection>& conn,
+                                       http_parse_result& result) {
+    if (result.has_next || result.body_spool || result.method != "GET" ||
+        result.http_version != "HTTP/1.1")
+        return false;
+    if (!has_token(result.headers, header_id::upgrade, "websocket") ||
+        !has_token(result.headers, header_id::connection, "upgrade"))
+        return false;
+    std::string_view key = result.headers.get("Sec-WebSocket-Key");
+    if (key.empty() || result.headers.get("Sec-WebSocket-Version") != "13")
+        return false;
+    {
+        std::lock_guard<std::mutex> lock(sequencers_mutex_);
+        auto it = sequencers_.find(conn.get());
+        if (it != sequencers_.end() && !it->second->idle())
+            return false;
+    }
+    auto handler = websocket_selector_(result);
+    if (!handler)
+        return false;
+
+    std::string extensions;
+    auto deflate = negotiate_websocket_deflate(result.headers, extensions);
+    std::string answer =
+        "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+        "Sec-WebSocket-Accept: " +
+        websocket_accept_key(key) + "\r\n";
+    if (!extensions.empty())
+        answer += "Sec-WebSocket-Extensions: " + extensions + "\r\n";
+    answer += "\r\n";
+    this->send_message(conn, cppress::sockets::data_buffer(std::move(answer)));
+    parser_.discard(conn);
+
+    std::weak_ptr<cppress::sockets::connection> weak = conn;
+    auto ws = std::make_shared<websocket_connection>(
+        std::move(handler), deflate,
+        [this, weak](std::vector<cppress::sockets::data_buffer>&& segments) {
+            if (auto conn = weak.lock())
+                this->send_message(conn, std::move(segments));
+        },
+        [this, weak]() {
+            if (auto conn = weak.lock())
+                this->close_connection(conn);
+        },
+        [this, weak](std::chrono::milliseconds after) {
+            if (auto conn = weak.lock())
+                this->set_deadline(conn, cppress::sockets::connection_deadline::body, after);
+        });
+    {
+        std::lock_guard<std::mutex> lock(websockets_mutex_);
+        websockets_[conn.get()] = ws;
+    }
+    ws->open();
+    return true;
+}
+
+std::shared_ptr<websocket_connection> http_server::websocket_for(
+    const cppress::sockets::connection* conn) {
+    std::lock_guard<std::mutex> lock(websockets_mutex_);
+    if (websockets_.empty())
+        return nullptr;
+    auto it = websockets_.find(conn);
+    return it == websockets_.end() ? nullptr : it->second;
+}
+
+bool http_server::has_sequencer(const cppress::sockets::connection* conn) {
+    std::lock_guard<std::mutex> lock(sequencers_mutex_);
+    return sequencers_.count(conn) != 0;
+}
+
+void http_server::start_http2(const std::shared_ptr<cppress::sockets::connection>& conn) {
+    make_session(conn)->start();
+    this->clear_deadline(conn, cppress::sockets::connection_deadline::header);
+}
+
+std::shared_ptr<http2_connection> http_server::session_for(
+    const cppress::sockets::connection* conn) {
+    std::lock_guard<std::mutex> lock(sessions_mutex_);
+    if (sessions_.empty())
+        return nullptr;
+    auto it = sessions_.find(conn);
+    return it == sessions_.end() ? nullptr : it->second;
+}
+
+std::shared_ptr<http2_connection> http_server::make_session(
+    const std::shared_ptr<cppress::sockets::connection>& conn) {
+    std::weak_ptr<cppress::sockets::connection> weak = conn;
+    auto session = std::make_shared<http2_connection>(
+        [this, weak](std::vector<std::string>&& frames) {
+            auto conn = weak.lock();
+            if (!conn)
+                return;
+            std::vector<cppress::sockets::data_buffer> segments;
+            segments.reserve(frames.size());
+            for (auto& frame : frames)
+                segments.emplace_back(std::move(frame));
+            this->send_message(conn, std::move(segments));
+        },
+        [this, weak]() {
+            if (auto conn = weak.lock())
+                this->close_connection(conn);
+        });
+    std::lock_guard<std::mutex> lock(sessions_mutex_);
+    sessions_[conn.get()] = session;
+    return session;
+}
+
+void http_server::receive_http2(const std::shared_ptr<cppress::sockets::connection>& conn,
+                                const std::shared_ptr<http2_connection>& session,
+                                std::string_view data) {
+    std::vector<http2_request> requests;
+    session->receive(data, requests);
+    for (auto& request : requests)
+        dispatch_http2(conn, session, request);
+}
+
+void http_server::dispatch_http2(const std::shared_ptr<cppress::sockets::connection>& conn,
+                                 const std::shared_ptr<http2_connection>& session,
+                                 http2_request& request) {
+    const std::string version = "HTTP/2";
+    std::uint32_t stream_id = request.stream_id;
+    std::weak_ptr<http2_connection> weak = session;
+    auto close = [weak, stream_id]() {
+        if (auto session = weak.lock())
+            session->close_stream(stream_id);
+    };
+    auto send = [weak, stream_id](std::vector<std::string>&& parts, bool last) {
+        if (auto session = weak.lock())
+            session->write(stream_id, std::move(parts), last);
+    };
+
+    try {
+        on_headers_received(conn, request.headers, request.method, request.uri, version,
+                            request.body);
+    } catch (const std::exception& e) {
+        close();
+        return;
+    }
+
+    http_response response(version, {}, close, send);
+    response.capture_preconditions(request.method, request.headers);
+    http_request req(request.method, request.uri, version, std::move(request.headers),
+                     std::move(request.body), close);
+    req.remote_address = conn->remote_endpoint().address().string();
+    req.connection = conn.get();
+    this->on_request_received(req, response);
 }
 
 void http_server::on_request_received(http_request& request, http_response& response) {
@@ -91,6 +479,12 @@ void http_server::on_request_received(http_request& request, http_response& resp
     }
 }
 
+bool http_server::on_expect_continue(http_request& request, http_response& response) {
+    if (expect_continue_callback)
+        return expect_continue_callback(request, response);
+    return true;
+}
+
 void http_server::on_listen_success() {
     if (listen_success_callback)
         listen_success_callback();
@@ -106,12 +500,117 @@ void http_server::on_exception_occurred(const std::exception& e) {
         error_callback(e);
 }
 
+void http_server::on_backpressure(std::shared_ptr<cppress::sockets::connection> conn,
+                                  bool paused) {
+    {
+        // event streams skip their subscriber while it is congested
+        std::lock_guard<std::mutex> lock(sequencers_mutex_);
+        auto it = sequencers_.find(conn.get());
+        if (it != sequencers_.end())
+            it->second->set_congested(paused);
+    }
+    std::vector<cppress::sockets::data_buffer> deferred;
+    {
+        std::lock_guard<std::mutex> lock(paused_mutex_);
+        if (paused) {
+            if (paused_.emplace(conn.get(), deferred).second)
+                paused_count_++;
+            return;
+        }
+        auto it = paused_.find(conn.get());
+        if (it == paused_.end())
+            return;
+        deferred.swap(it->second);
+        paused_.erase(it);
+        paused_count_--;
+    }
+    // dispatching may pause the connection again, later input is then held back anew
+    for (auto& message : deferred)
+        on_message_received(conn, message);
+}
+
 void http_server::on_connection_closed(std::shared_ptr<cppress::sockets::connection> conn) {
+    parser_.discard(conn);
+    {
+        std::lock_guard<std::mutex> lock(sequencers_mutex_);
+        auto it = sequencers_.find(conn.get());
+        if (it != sequencers_.end()) {
+            // responses still held elsewhere, e.g. event stream subscribers, see it closed
+            it->second->disconnect();
+            sequencers_.erase(it);
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(sessions_mutex_);
+        sessions_.erase(conn.get());
+    }
+    std::shared_ptr<websocket_connection> ws;
+    {
+        std::lock_guard<std::mutex> lock(websockets_mutex_);
+        auto it = websockets_.find(conn.get());
+        if (it != websockets_.end()) {
+            ws = std::move(it->second);
+            websockets_.erase(it);
+        }
+    }
+    if (ws)
+        ws->closed();
+    if (paused_count_.load(std::memory_order_acquire) != 0) {
+        std::lock_guard<std::mutex> lock(paused_mutex_);
+        if (paused_.erase(conn.get()) != 0)
+            paused_count_--;
+    }
     if (client_disconnected_callback)
         client_disconnected_callback(conn);
 }
 
+void http_server::on_deadline_expired(std::shared_ptr<cppress::sockets::connection> conn,
+                                      cppress::sockets::connection_deadline which) {
+    if (which == cppress::sockets::connection_deadline::body) {
+        if (auto ws = websocket_for(conn.get())) {
+            auto next = ws->on_timer();
+            if (next.count() > 0) {
+                this->set_deadline(conn, which, next);
+                return;
+            }
+        }
+    }
+    epoll_server::on_deadline_expired(std::move(conn), which);
+}
+
+/**
+ * Implementation Notes:
+ * - Runs on the loop owning the connection, the only thread that parses
+ *   its input, so nothing arrives between the checks
+ * - Connections paused by backpressure hold requests not dispatched yet
+ */
+bool http_server::connection_idle(const std::shared_ptr<cppress::sockets::connection>& conn) {
+    if (websocket_for(conn.get()))
+        return false;
+    if (auto session = session_for(conn.get()))
+        return session->stream_count() == 0;
+    if (parser_.in_request(*conn))
+        return false;
+    if (paused_count_.load(std::memory_order_acquire) != 0) {
+        std::lock_guard<std::mutex> lock(paused_mutex_);
+        if (paused_.count(conn.get()) != 0)
+            return false;
+    }
+    std::shared_ptr<http_response_sequencer> sequencer;
+    {
+        std::lock_guard<std::mutex> lock(sequencers_mutex_);
+        auto it = sequencers_.find(conn.get());
+        if (it != sequencers_.end())
+            sequencer = it->second;
+    }
+    // a connection without a request yet is one the client is about to use; the
+    // header deadline bounds it
+    return sequencer && sequencer->idle();
+}
+
 void http_server::on_connection_opened(std::shared_ptr<cppress::sockets::connection> conn) {
+    this->set_deadline(conn, cppress::sockets::connection_deadline::header,
+                       config::MAX_HEADER_READ_TIME_SECONDS);
     if (client_connected_callback)
         client_connected_callback(conn);
 }
@@ -0,0 +1,794 @@
+#include "../includes/websocket_connection.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <stdexcept>
+
+#include "../includes/http_consts.hpp"
+
+#ifndef CPPRESS_HAS_ZLIB
+#define CPPRESS_HAS_ZLIB 0
+#endif
+
+#if CPPRESS_HAS_ZLIB
+#include <zlib.h>
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define CPPRESS_MASK_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define CPPRESS_MASK_NEON 1
+#endif
+
+namespace cppress::http {
+
+namespace {
+/// Messages shorter than this are sent uncompressed, deflate would not shrink them
+constexpr std::size_t MIN_COMPRESSED_SIZE = 64;
+
+/// Compressed output is produced in blocks of this size
+constexpr std::size_t OUTPUT_BLOCK = 16 * 1024;
+
+/// Largest control frame payload
+constexpr std::size_t MAX_CONTROL_PAYLOAD = 125;
+
+/// What a sync flush ends with; permessage-deflate leaves it off the wire
+constexpr char DEFLATE_TAIL[4] = {'\x00', '\x00', '\xff', '\xff'};
+
+std::uint32_t rotl(std::uint32_t value, int bits) {
+    return (value << bits) | (value >> (32 - bits));
+}
+
+/// SHA-1 (FIPS 180-4), only ever used for the handshake
+std::array<std::uint8_t, 20> sha1(std::string_view input) {
+    std::uint32_t h[5] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0};
+    std::string data(input);
+    std::uint64_t bits = static_cast<std::uint64_t>(input.size()) * 8;
+    data.push_back('\x80');
+    while (data.size() % 64 != 56)
+        data.push_back('\0');
+    for (int shift = 56; shift >= 0; shift -= 8)
+        data.push_back(static_cast<char>(bits >> shift));
+
+    for (std::size_t block = 0; block < data.size(); block += 64) {
+        std::uint32_t w[80];
+        for (int i = 0; i < 16; ++i) {
+            const auto* p = reinterpret_cast<const unsigned char*>(data.data() + block + i * 4);
+            w[i] = (std::uint32_t(p[0]) << 24) | (std::uint32_t(p[1]) << 16) |
+                   (std::uint32_t(p[2]) << 8) | std::uint32_t(p[3]);
+        }
+        for (int i = 16; i < 80; ++i)
+            w[i] = rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+        std::uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; ++i) {
+            std::uint32_t f, k;
+            if (i < 20) {
+                f = (b & c) | (~b & d);
+                k = 0x5a827999;
+            } else if (i < 40) {
+                f = b ^ c ^ d;
+                k = 0x6ed9eba1;
+            } else if (i < 60) {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8f1bbcdc;
+            } else {
+                f = b ^ c ^ d;
+                k = 0xca62c1d6;
+            }
+            std::uint32_t t = rotl(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = rotl(b, 30);
+            b = a;
+            a = t;
+        }
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+    }
+
+    std::array<std::uint8_t, 20> digest{};
+    for (int i = 0; i < 20; ++i)
+        digest[i] = static_cast<std::uint8_t>(h[i / 4] >> (24 - (i % 4) * 8));
+    return digest;
+}
+
+std::string base64(const std::uint8_t* data, std::size_t size) {
+    static const char alphabet[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    out.reserve((size + 2) / 3 * 4);
+    for (std::size_t i = 0; i < size; i += 3) {
+        std::uint32_t n = std::uint32_t(data[i]) << 16;
+        if (i + 1 < size)
+            n |= std::uint32_t(data[i + 1]) << 8;
+        if (i + 2 < size)
+            n |= data[i + 2];
+        out.push_back(alphabet[(n >> 18) & 63]);
+        out.push_back(alphabet[(n >> 12) & 63]);
+        out.push_back(i + 1 < size ? alphabet[(n >> 6) & 63] : '=');
+        out.push_back(i + 2 < size ? alphabet[n & 63] : '=');
+    }
+    return out;
+}
+
+/// Well-formed UTF-8: no overlong forms, surrogates or code points above U+10FFFF
+bool valid_utf8(std::string_view text) {
+    const auto* p = reinterpret_cast<const unsigned char*>(text.data());
+    std::size_t n = text.size(), i = 0;
+    while (i < n) {
+        // ASCII runs are the common case, 8 bytes at a time
+        while (i + 8 <= n) {
+            std::uint64_t word;
+            std::memcpy(&word, p + i, 8);
+            if (word & 0x8080808080808080ull)
+                break;
+            i += 8;
+        }
+        if (i >= n)
+            break;
+        unsigned char c = p[i];
+        if (c < 0x80) {
+            ++i;
+            continue;
+        }
+        std::size_t extra;
+        unsigned char lo = 0x80, hi = 0xbf;
+        if (c >= 0xc2 && c <= 0xdf) {
+            extra = 1;
+        } else if (c >= 0xe0 && c <= 0xef) {
+            extra = 2;
+            if (c == 0xe0)
+                lo = 0xa0;
+            else if (c == 0xed)
+                hi = 0x9f;
+        } else if (c >= 0xf0 && c <= 0xf4) {
+            extra = 3;
+            if (c == 0xf0)
+                lo = 0x90;
+            else if (c == 0xf4)
+                hi = 0x8f;
+        } else {
+            return false;
+        }
+        if (i + extra >= n)
+            return false;
+        if (p[i + 1] < lo || p[i + 1] > hi)
+            return false;
+        for (std::size_t k = 2; k <= extra; ++k) {
+            if (p[i + k] < 0x80 || p[i + k] > 0xbf)
+                return false;
+        }
+        i += extra + 1;
+    }
+    return true;
+}
+
+bool valid_close_code(std::uint16_t code) {
+    if (code >= 3000 && code <= 4999)
+        return true;
+    return (code >= 1000 && code <= 1003) || (code >= 1007 && code <= 1011);
+}
+
+std::string trim(std::string_view value) {
+    std::size_t begin = 0, end = value.size();
+    while (begin < end && (value[begin] == ' ' || value[begin] == '\t'))
+        ++begin;
+    while (end > begin && (value[end - 1] == ' ' || value[end - 1] == '\t'))
+        --end;
+    std::string out(value.substr(begin, end - begin));
+    std::transform(out.begin(), out.end(), out.begin(), ::tolower);
+    return out;
+}
+
+/// Splits on a separator, trimming and lowercasing the pieces
+std::vector<std::string> split(std::string_view value, char separator) {
+    std::vector<std::string> pieces;
+    std::size_t start = 0;
+    for (;;) {
+        std::size_t end = value.find(separator, start);
+        pieces.push_back(trim(value.substr(start, end - start)));
+        if (end == std::string_view::npos)
+            return pieces;
+        start = end + 1;
+    }
+}
+
+/// One permessage-deflate offer; false if it has a parameter we cannot honour
+bool accept_deflate_offer(const std::vector<std::string>& params,
+                          websocket_deflate_options& options, std::string& response) {
+    options = websocket_deflate_options{};
+    options.enabled = true;
+    response = "permessage-deflate";
+    bool seen_server_bits = false, seen_client_bits = false;
+    for (std::size_t i = 1; i < params.size(); ++i) {
+        std::string name = params[i], value;
+        std::size_t eq = name.find('=');
+        if (eq != std::string::npos) {
+            value = trim(name.substr(eq + 1));
+            name = trim(name.substr(0, eq));
+            if (value.size() >= 2 && value.front() == '"' && value.back() == '"')
+                value = value.substr(1, value.size() - 2);
+        }
+        if (name == "server_no_context_takeover" && value.empty() &&
+            !options.server_no_context_takeover) {
+            options.server_no_context_takeover = true;
+            response += "; server_no_context_takeover";
+        } else if (name == "client_no_context_takeover" && value.empty() &&
+                   !options.client_no_context_takeover) {
+            options.client_no_context_takeover = true;
+            response += "; client_no_context_takeover";
+        } else if (name == "server_max_window_bits" && !seen_server_bits) {
+            seen_server_bits = true;
+            if (value.size() != 1 && value.size() != 2)
+                return false;
+            int bits = std::atoi(value.c_str());
+            // zlib's raw deflate cannot use a 256-byte window
+            if (bits < 9 || bits > 15)
+                return false;
+            options.server_max_window_bits = bits;
+            response += "; server_max_window_bits=" + value;
+        } else if (name == "client_max_window_bits" && !seen_client_bits) {
+            // the decompressor always has the full window, any client size is fine
+            seen_client_bits = true;
+            if (!value.empty() && (std::atoi(value.c_str()) < 8 || std::atoi(value.c_str()) > 15))
+                return false;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+#if CPPRESS_MASK_X86
+__attribute__((target("avx2"))) std::size_t mask_avx2(char* dst, const char* src,
+                                                      std::size_t size,
+                                                      std::uint32_t key) noexcept {
+    const __m256i k = _mm256_set1_epi32(static_cast<int>(key));
+    std::size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_xor_si256(b, k));
+    }
+    return i;
+}
+
+__attribute__((target("sse2"))) std::size_t mask_sse2(char* dst, const char* src,
+                                                      std::size_t size,
+                                                      std::uint32_t key) noexcept {
+    const __m128i k = _mm_set1_epi32(static_cast<int>(key));
+    std::size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_xor_si128(b, k));
+    }
+    return i;
+}
+
+bool detect_avx2() noexcept {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+const bool has_avx2 = detect_avx2();
+#endif
+
+#if CPPRESS_MASK_NEON
+std::size_t mask_neon(char* dst, const char* src, std::size_t size, std::uint32_t key) noexcept {
+    const uint8x16_t k = vreinterpretq_u8_u32(vdupq_n_u32(key));
+    std::size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        uint8x16_t b = vld1q_u8(reinterpret_cast<const std::uint8_t*>(src + i));
+        vst1q_u8(reinterpret_cast<std::uint8_t*>(dst + i), veorq_u8(b, k));
+    }
+    return i;
+}
+#endif
+}  // namespace
+
+#if CPPRESS_HAS_ZLIB
+struct websocket_connection::deflate_state {
+    z_stream deflater{};
+    z_stream inflater{};
+    bool reset_deflater;
+    bool reset_inflater;
+
+    explicit deflate_state(const websocket_deflate_options& options)
+        : reset_deflater(options.server_no_context_takeover),
+          reset_inflater(options.client_no_context_takeover) {
+        // negative window bits select raw deflate, without zlib header or trailer
+        if (deflateInit2(&deflater, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                         -options.server_max_window_bits, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+            throw std::runtime_error("permessage-deflate: deflateInit2 failed");
+        if (inflateInit2(&inflater, -15) != Z_OK) {
+            deflateEnd(&deflater);
+            throw std::runtime_error("permessage-deflate: inflateInit2 failed");
+        }
+    }
+    ~deflate_state() {
+        deflateEnd(&deflater);
+        inflateEnd(&inflater);
+    }
+
+    std::string compress(std::string_view input) {
+        std::string out;
+        deflater.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+        deflater.avail_in = static_cast<uInt>(input.size());
+        do {
+            std::size_t used = out.size();
+            out.resize(used + OUTPUT_BLOCK);
+            deflater.next_out = reinterpret_cast<Bytef*>(&out[used]);
+            deflater.avail_out = static_cast<uInt>(OUTPUT_BLOCK);
+            if (deflate(&deflater, Z_SYNC_FLUSH) == Z_STREAM_ERROR)
+                throw std::runtime_error("permessage-deflate: deflate failed");
+            out.resize(used + OUTPUT_BLOCK - deflater.avail_out);
+        } while (deflater.avail_out == 0);
+        if (out.size() >= 4 && std::memcmp(out.data() + out.size() - 4, DEFLATE_TAIL, 4) == 0)
+            out.resize(out.size() - 4);
+        if (reset_deflater)
+            deflateReset(&deflater);
+        return out;
+    }
+
+    /// false if the data is corrupt or inflates past limit
+    bool decompress(std::string& message, std::size_t limit) {
+        message.append(DEFLATE_TAIL, 4);
+        std::string out;
+        inflater.next_in = reinterpret_cast<Bytef*>(message.data());
+        inflater.avail_in = static_cast<uInt>(message.size());
+        do {
+            std::size_t used = out.size();
+            if (used > limit)
+                return false;
+            out.resize(used + OUTPUT_BLOCK);
+            inflater.next_out = reinterpret_cast<Bytef*>(&out[used]);
+            inflater.avail_out = static_cast<uInt>(OUTPUT_BLOCK);
+            int rc = inflate(&inflater, Z_SYNC_FLUSH);
+            if (rc != Z_OK && rc != Z_BUF_ERROR && rc != Z_STREAM_END)
+                return false;
+            out.resize(used + OUTPUT_BLOCK - inflater.avail_out);
+        } while (inflater.avail_out == 0);
+        if (out.size() > limit)
+            return false;
+        if (reset_inflater)
+            inflateReset(&inflater);
+        message.swap(out);
+        return true;
+    }
+};
+#else
+struct websocket_connection::deflate_state {
+    explicit deflate_state(const websocket_deflate_options&) {}
+    std::string compress(std::string_view input) { return std::string(input); }
+    bool decompress(std::string&, std::size_t) { return false; }
+};
+#endif
+
+std::string websocket_accept_key(std::string_view key) {
+    std::string input(key);
+    input.append(WEBSOCKET_GUID);
+    auto digest = sha1(input);
+    return base64(digest.data(), digest.size());
+}
+
+websocket_deflate_options negotiate_websocket_deflate(const http_headers& headers,
+                                                      std::string& response) {
+    response.clear();
+    websocket_deflate_options accepted;
+    if (!CPPRESS_HAS_ZLIB || !config::WEBSOCKET_DEFLATE)
+        return accepted;
+    // offers are in the client's order of preference, take the first we can honour
+    for (const auto& value : headers.values("Sec-WebSocket-Extensions")) {
+        for (const auto& offer : split(value, ',')) {
+            auto params = split(offer, ';');
+            if (params.empty() || params[0] != "permessage-deflate")
+                continue;
+            if (accept_deflate_offer(params, accepted, response))
+                return accepted;
+            accepted = websocket_deflate_options{};
+            response.clear();
+        }
+    }
+    return accepted;
+}
+
+/**
+ * Implementation Notes:
+ * - The key is rotated so its first byte lines up with src[0]; every wide
+ *   step covers a multiple of 4 bytes, so the same 32-bit pattern repeats
+ * - AVX2 is picked at run time, SSE2 is part of x86-64
+ */
+void websocket_mask(char* dst, const char* src, std::size_t size,
+                    const std::array<std::uint8_t, 4>& key, std::size_t offset) noexcept {
+    std::uint8_t k[8];
+    for (std::size_t i = 0; i < 8; ++i)
+        k[i] = key[(offset + i) & 3];
+    std::uint32_t k32;
+    std::memcpy(&k32, k, 4);
+
+    std::size_t i = 0;
+#if CPPRESS_MASK_X86
+    if (has_avx2)
+        i = mask_avx2(dst, src, size, k32);
+    i += mask_sse2(dst + i, src + i, size - i, k32);
+#elif CPPRESS_MASK_NEON
+    i = mask_neon(dst, src, size, k32);
+#endif
+    std::uint64_t k64;
+    std::memcpy(&k64, k, 8);
+    for (; i + 8 <= size; i += 8) {
+        std::uint64_t word;
+        std::memcpy(&word, src + i, 8);
+        word ^= k64;
+        std::memcpy(dst + i, &word, 8);
+    }
+    for (; i < size; ++i)
+        dst[i] = static_cast<char>(src[i] ^ k[i & 3]);
+}
+
+std::string websocket_frame_header(websocket_opcode opcode, std::size_t payload_size, bool fin,
+                                   bool compressed) {
+    std::string header;
+    header.push_back(static_cast<char>((fin ? 0x80 : 0) | (compressed ? 0x40 : 0) |
+                                       static_cast<std::uint8_t>(opcode)));
+    if (payload_size < 126) {
+        header.push_back(static_cast<char>(payload_size));
+    } else if (payload_size <= 0xffff) {
+        header.push_back(126);
+        header.push_back(static_cast<char>(payload_size >> 8));
+        header.push_back(static_cast<char>(payload_size));
+    } else {
+        header.push_back(127);
+        for (int shift = 56; shift >= 0; shift -= 8)
+            header.push_back(static_cast<char>(static_cast<std::uint64_t>(payload_size) >> shift));
+    }
+    return header;
+}
+
+websocket_connection::websocket_connection(std::shared_ptr<websocket_handler> handler,
+                                           websocket_deflate_options deflate, send_function send,
+                                           close_function close, arm_function arm)
+    : handler_(std::move(handler)),
+      deflate_options_(deflate),
+      send_(std::move(send)),
+      close_(std::move(close)),
+      arm_(std::move(arm)) {
+    if (deflate_options_.enabled)
+        deflate_ = std::make_unique<deflate_state>(deflate_options_);
+}
+
+websocket_connection::~websocket_connection() = default;
+
+void websocket_connection::open() {
+    arm_(config::WEBSOCKET_PING_INTERVAL_SECONDS);
+    if (handler_ && handler_->on_open)
+        handler_->on_open(shared_from_this());
+}
+
+/**
+ * Implementation Notes:
+ * - Header bytes are gathered one at a time, a header is at most 14 bytes;
+ *   payload bytes are unmasked straight from the receive buffer into the
+ *   message, so a frame split across reads costs no extra copy
+ */
+bool websocket_connection::receive(std::string_view data) {
+    std::size_t pos = 0;
+    while (pos < data.size()) {
+        if (finished_)
+            return false;
+        if (frame_.reading_head) {
+            frame_.head[frame_.head_size++] = static_cast<std::uint8_t>(data[pos++]);
+            if (frame_.head_size < 2)
+                continue;
+            std::size_t length_bytes = (frame_.head[1] & 0x7f) == 126   ? 2
+                                       : (frame_.head[1] & 0x7f) == 127 ? 8
+                                                                        : 0;
+            std::size_t needed = 2 + length_bytes + ((frame_.head[1] & 0x80) ? 4 : 0);
+            if (frame_.head_size < needed)
+                continue;
+            if (!begin_frame())
+                return false;
+            if (frame_.length == 0 && !finish_frame())
+                return false;
+            continue;
+        }
+
+        bool control = static_cast<std::uint8_t>(frame_.opcode) & 0x8;
+        std::string& target = control ? control_ : message_;
+        std::size_t take = static_cast<std::size_t>(
+            std::min<std::uint64_t>(frame_.length - frame_.received, data.size() - pos));
+        std::size_t at = target.size();
+        target.resize(at + take);
+        websocket_mask(&target[at], data.data() + pos, take, frame_.key,
+                       static_cast<std::size_t>(frame_.received));
+        pos += take;
+        frame_.received += take;
+        if (frame_.received == frame_.length && !finish_frame())
+            return false;
+    }
+    return !finished_;
+}
+
+bool websocket_connection::begin_frame() {
+    std::uint8_t b0 = frame_.head[0], b1 = frame_.head[1];
+    frame_.fin = b0 & 0x80;
+    frame_.rsv1 = b0 & 0x40;
+    frame_.opcode = static_cast<websocket_opcode>(b0 & 0x0f);
+    frame_.reading_head = false;
+    frame_.head_size = 0;
+    frame_.received = 0;
+
+    std::size_t at = 2;
+    frame_.length = b1 & 0x7f;
+    if (frame_.length == 126) {
+        frame_.length = (std::uint64_t(frame_.head[2]) << 8) | frame_.head[3];
+        at = 4;
+    } else if (frame_.length == 127) {
+        frame_.length = 0;
+        for (std::size_t i = 2; i < 10; ++i)
+            frame_.length = (frame_.length << 8) | frame_.head[i];
+        at = 10;
+    }
+    if (!(b1 & 0x80)) {
+        fail(websocket_close::protocol_error, "Client frames must be masked");
+        return false;
+    }
+    std::copy(frame_.head.begin() + at, frame_.head.begin() + at + 4, frame_.key.begin());
+
+    if (b0 & 0x30) {
+        fail(websocket_close::protocol_error, "Reserved bits set");
+        return false;
+    }
+    switch (frame_.opcode) {
+        case websocket_opcode::close:
+        case websocket_opcode::ping:
+        case websocket_opcode::pong:
+            if (!frame_.fin || frame_.rsv1 || frame_.length > MAX_CONTROL_PAYLOAD) {
+                fail(websocket_close::protocol_error, "Invalid control frame");
+                return false;
+            }
+            control_.clear();
+            return true;
+        case websocket_opcode::continuation:
+            if (!in_message_ || frame_.rsv1) {
+                fail(websocket_close::protocol_error, "Unexpected continuation frame");
+                return false;
+            }
+            break;
+        case websocket_opcode::text:
+        case websocket_opcode::binary:
+            if (in_message_ || (frame_.rsv1 && !deflate_)) {
+                fail(websocket_close::protocol_error, "Unexpected data frame");
+                return false;
+            }
+            in_message_ = true;
+            message_opcode_ = frame_.opcode;
+            message_compressed_ = frame_.rsv1;
+            message_.clear();
+            break;
+        default:
+            fail(websocket_close::protocol_error, "Unknown opcode");
+            return false;
+    }
+    if (frame_.length > config::WEBSOCKET_MAX_MESSAGE_SIZE - message_.size()) {
+        fail(websocket_close::message_too_big, "Message too big");
+        return false;
+    }
+    message_.reserve(message_.size() + static_cast<std::size_t>(frame_.length));
+    return true;
+}
+
+bool websocket_connection::finish_frame() {
+    frame_.reading_head = true;
+    switch (frame_.opcode) {
+        case websocket_opcode::ping: {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!close_sent_)
+                send_frame(websocket_opcode::pong, cppress::sockets::data_buffer(control_), false);
+            return true;
+        }
+        case websocket_opcode::pong: {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!awaiting_pong_ || close_sent_)
+                    return true;
+                awaiting_pong_ = false;
+            }
+            arm_(config::WEBSOCKET_PING_INTERVAL_SECONDS);
+            return true;
+        }
+        case websocket_opcode::close:
+            receive_close();
+            return false;
+        default:
+            break;
+    }
+
+    if (!frame_.fin)
+        return true;
+    in_message_ = false;
+    if (message_compressed_ &&
+        !deflate_->decompress(message_, config::WEBSOCKET_MAX_MESSAGE_SIZE)) {
+        fail(websocket_close::message_too_big, "Cannot inflate message");
+        return false;
+    }
+    if (message_opcode_ == websocket_opcode::text && !valid_utf8(message_)) {
+        fail(websocket_close::invalid_payload, "Invalid UTF-8");
+        return false;
+    }
+    // after our close frame the client may still send data, which is dropped
+    if (is_closing()) {
+        message_.clear();
+        return true;
+    }
+    websocket_message message;
+    message.opcode = message_opcode_;
+    message.data.swap(message_);
+    if (handler_ && handler_->on_message)
+        handler_->on_message(shared_from_this(), std::move(message));
+    return !finished_;
+}
+
+void websocket_connection::receive_close() {
+    finished_ = true;
+    std::uint16_t code = websocket_close::no_status;
+    std::string reason;
+    if (control_.size() == 1) {
+        fail(websocket_close::protocol_error, "Invalid close frame");
+        return;
+    }
+    if (control_.size() >= 2) {
+        code = static_cast<std::uint16_t>((static_cast<std::uint8_t>(control_[0]) << 8) |
+                                          static_cast<std::uint8_t>(control_[1]));
+        reason = control_.substr(2);
+        if (!valid_close_code(code)) {
+            fail(websocket_close::protocol_error, "Invalid close code");
+            return;
+        }
+        if (!valid_utf8(reason)) {
+            fail(websocket_close::invalid_payload, "Invalid close reason");
+            return;
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!close_sent_) {
+            // echo the status, as the handshake asks
+            std::string payload =
+                code == websocket_close::no_status ? std::string() : control_.substr(0, 2);
+            send_frame(websocket_opcode::close, cppress::sockets::data_buffer(std::move(payload)),
+                       false);
+            close_sent_ = true;
+            close_code_ = code;
+            close_reason_ = reason;
+        } else if (close_code_ == websocket_close::abnormal) {
+            close_code_ = code;
+        }
+    }
+    // the server closes the TCP connection first once the handshake is done
+    close_();
+    report_close();
+}
+
+void websocket_connection::fail(std::uint16_t code, const std::string& reason) {
+    finished_ = true;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!close_sent_) {
+            std::string payload;
+            payload.push_back(static_cast<char>(code >> 8));
+            payload.push_back(static_cast<char>(code));
+            payload.append(reason, 0, MAX_CONTROL_PAYLOAD - 2);
+            send_frame(websocket_opcode::close, cppress::sockets::data_buffer(std::move(payload)),
+                       false);
+        }
+        close_sent_ = true;
+        failed_ = true;
+        close_code_ = code;
+        close_reason_ = reason;
+    }
+    close_();
+    report_close();
+}
+
+std::chrono::milliseconds websocket_connection::on_timer() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // no answer to the close frame, or to the last ping
+    if (close_sent_ || failed_ || awaiting_pong_)
+        return std::chrono::milliseconds(0);
+    send_frame(websocket_opcode::ping, cppress::sockets::data_buffer(), false);
+    awaiting_pong_ = true;
+    return config::WEBSOCKET_PONG_TIMEOUT_SECONDS;
+}
+
+void websocket_connection::closed() { report_close(); }
+
+void websocket_connection::send_text(std::string text) {
+    send(websocket_opcode::text, cppress::sockets::data_buffer(std::move(text)));
+}
+
+void websocket_connection::send_binary(std::string data) {
+    send(websocket_opcode::binary, cppress::sockets::data_buffer(std::move(data)));
+}
+
+void websocket_connection::send(websocket_opcode opcode, cppress::sockets::data_buffer payload) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (close_sent_)
+        return;
+    bool compress = deflate_ && payload.size() >= MIN_COMPRESSED_SIZE;
+    send_frame(opcode, std::move(payload), compress);
+}
+
+void websocket_connection::ping(std::string payload) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (close_sent_)
+        return;
+    if (payload.size() > MAX_CONTROL_PAYLOAD)
+        payload.resize(MAX_CONTROL_PAYLOAD);
+    send_frame(websocket_opcode::ping, cppress::sockets::data_buffer(std::move(payload)), false);
+}
+
+void websocket_connection::close(std::uint16_t code, const std::string& reason) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (close_sent_)
+            return;
+        std::string payload;
+        payload.push_back(static_cast<char>(code >> 8));
+        payload.push_back(static_cast<char>(code));
+        payload.append(reason, 0, MAX_CONTROL_PAYLOAD - 2);
+        send_frame(websocket_opcode::close, cppress::sockets::data_buffer(std::move(payload)),
+                   false);
+        close_sent_ = true;
+        close_code_ = code;
+        close_reason_ = reason;
+    }
+    arm_(config::WEBSOCKET_CLOSE_TIMEOUT_SECONDS);
+}
+
+bool websocket_connection::is_closing() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return close_sent_ || failed_;
+}
+
+/**
+ * Implementation Notes:
+ * - Called with mutex_ held, so frames leave in the order they were made
+ *   and the compressor sees the messages in that order too
+ * - The header is its own buffer; an uncompressed payload is queued as the
+ *   caller's buffer, never copied into the frame
+ */
+void websocket_connection::send_frame(websocket_opcode opcode,
+                                      cppress::sockets::data_buffer payload, bool compress) {
+    if (compress)
+        payload = cppress::sockets::data_buffer(deflate_->compress(payload.view()));
+    std::vector<cppress::sockets::data_buffer> segments;
+    segments.reserve(2);
+    segments.emplace_back(websocket_frame_header(opcode, payload.size(), true, compress));
+    if (!payload.empty())
+        segments.push_back(std::move(payload));
+    send_(std::move(segments));
+}
+
+void websocket_connection::report_close() {
+    std::uint16_t code;
+    std::string reason;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (close_reported_)
+            return;
+        close_reported_ = true;
+        code = close_code_;
+        reason = close_reason_;
+    }
+    if (handler_ && handler_->on_close)
+        handler_->on_close(shared_from_this(), code, reason);
+}
+
+}  // namespace cppress::http
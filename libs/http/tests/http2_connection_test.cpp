@@ -0,0 +1,267 @@
+#include "../includes/http2_connection.hpp"
+#include "../includes/http_consts.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+using namespace cppress::http;
+
+namespace {
+struct frame {
+    std::uint8_t type;
+    std::uint8_t flags;
+    std::uint32_t stream_id;
+    std::string payload;
+};
+
+std::string make_frame(http2_frame_type type, std::uint8_t flags, std::uint32_t stream_id,
+                       std::string_view payload) {
+    std::string out;
+    auto length = static_cast<std::uint32_t>(payload.size());
+    out.push_back(static_cast<char>(length >> 16));
+    out.push_back(static_cast<char>(length >> 8));
+    out.push_back(static_cast<char>(length));
+    out.push_back(static_cast<char>(type));
+    out.push_back(static_cast<char>(flags));
+    for (int shift = 24; shift >= 0; shift -= 8)
+        out.push_back(static_cast<char>(stream_id >> shift));
+    out.append(payload);
+    return out;
+}
+
+std::string setting(std::uint16_t id, std::uint32_t value) {
+    std::string out{static_cast<char>(id >> 8), static_cast<char>(id)};
+    for (int shift = 24; shift >= 0; shift -= 8)
+        out.push_back(static_cast<char>(value >> shift));
+    return out;
+}
+
+std::string u32(std::uint32_t value) { return setting(0, value).substr(2); }
+
+std::string request_block(hpack_encoder& encoder, std::string_view method, std::string_view path) {
+    std::string block;
+    encoder.begin_block(block);
+    encoder.encode(":method", method, block);
+    encoder.encode(":scheme", "http", block);
+    encoder.encode(":path", path, block);
+    encoder.encode(":authority", "localhost", block);
+    return block;
+}
+
+/// A connection with the client preface and SETTINGS already exchanged
+class Http2ConnectionTest : public ::testing::Test {
+protected:
+    std::string output;
+    bool closed = false;
+    http2_connection connection{[this](std::vector<std::string>&& frames) {
+                                    for (auto& f : frames)
+                                        output += f;
+                                },
+                                [this]() { closed = true; }};
+    hpack_encoder client_encoder;
+    hpack_decoder client_decoder;
+
+    void SetUp() override {
+        connection.start();
+        std::vector<http2_request> requests;
+        ASSERT_TRUE(connection.receive(
+            std::string(HTTP2_PREFACE) + make_frame(http2_frame_type::settings, 0, 0, {}),
+            requests));
+        take_frames();
+    }
+
+    std::vector<frame> take_frames() {
+        std::vector<frame> frames;
+        std::size_t pos = 0;
+        while (output.size() - pos >= 9) {
+            auto byte = [&](std::size_t i) { return static_cast<std::uint8_t>(output[pos + i]); };
+            std::uint32_t length = (byte(0) << 16) | (byte(1) << 8) | byte(2);
+            std::uint32_t id = ((byte(5) & 0x7f) << 24) | (byte(6) << 16) | (byte(7) << 8) | byte(8);
+            frames.push_back({byte(3), byte(4), id, output.substr(pos + 9, length)});
+            pos += 9 + length;
+        }
+        output.clear();
+        return frames;
+    }
+
+    std::vector<http2_request> send(const std::string& bytes) {
+        std::vector<http2_request> requests;
+        connection.receive(bytes, requests);
+        return requests;
+    }
+};
+}  // namespace
+
+TEST(Http2ConnectionStartTest, SendsSettingsAndRaisesTheConnectionWindow) {
+    std::vector<std::string> frames;
+    http2_connection connection(
+        [&frames](std::vector<std::string>&& out) {
+            frames.insert(frames.end(), out.begin(), out.end());
+        },
+        []() {});
+    connection.start();
+    ASSERT_EQ(frames.size(), config::HTTP2_INITIAL_WINDOW_SIZE > 65535 ? 2u : 1u);
+    EXPECT_EQ(frames[0][3], static_cast<char>(http2_frame_type::settings));
+    EXPECT_NE(frames[0].find(setting(4, config::HTTP2_INITIAL_WINDOW_SIZE)), std::string::npos);
+    EXPECT_NE(frames[0].find(setting(2, 0)), std::string::npos);
+}
+
+TEST_F(Http2ConnectionTest, AcknowledgesSettingsAndPings) {
+    send(make_frame(http2_frame_type::settings, 0, 0, setting(4, 1000)) +
+         make_frame(http2_frame_type::ping, 0, 0, "12345678"));
+    auto frames = take_frames();
+    ASSERT_EQ(frames.size(), 2u);
+    EXPECT_EQ(frames[0].type, static_cast<std::uint8_t>(http2_frame_type::settings));
+    EXPECT_EQ(frames[0].flags, 0x1);
+    EXPECT_EQ(frames[1].type, static_cast<std::uint8_t>(http2_frame_type::ping));
+    EXPECT_EQ(frames[1].flags, 0x1);
+    EXPECT_EQ(frames[1].payload, "12345678");
+}
+
+TEST_F(Http2ConnectionTest, AnswersMultiplexedStreamsInAnyOrder) {
+    // blocks are encoded in stream order, the dynamic table depends on it
+    std::string first = request_block(client_encoder, "GET", "/a");
+    std::string second = request_block(client_encoder, "POST", "/b");
+    auto requests = send(make_frame(http2_frame_type::headers, 0x5, 1, first) +
+                         make_frame(http2_frame_type::headers, 0x4, 3, second) +
+                         make_frame(http2_frame_type::data, 0x1, 3, "payload"));
+    ASSERT_EQ(requests.size(), 2u);
+    EXPECT_EQ(requests[0].stream_id, 1u);
+    EXPECT_EQ(requests[0].method, "GET");
+    EXPECT_EQ(requests[0].uri, "/a");
+    EXPECT_EQ(requests[0].headers.get(header_id::host), "localhost");
+    EXPECT_EQ(requests[1].stream_id, 3u);
+    EXPECT_EQ(requests[1].body, "payload");
+    EXPECT_EQ(connection.stream_count(), 2u);
+
+    // the second stream is answered first
+    connection.write(3, {"HTTP/1.1 201 Created\r\nContent-Length: 2\r\nConnection: keep-alive\r\n\r\n",
+                         "ok"},
+                     true);
+    connection.write(1, {"HTTP/1.1 204 No Content\r\n\r\n"}, true);
+    auto frames = take_frames();
+    ASSERT_EQ(frames.size(), 3u);
+
+    EXPECT_EQ(frames[0].type, static_cast<std::uint8_t>(http2_frame_type::headers));
+    EXPECT_EQ(frames[0].stream_id, 3u);
+    std::vector<hpack_field> fields;
+    ASSERT_TRUE(client_decoder.decode(frames[0].payload, fields, 4096));
+    ASSERT_EQ(fields.size(), 2u);  // connection is dropped
+    EXPECT_EQ(fields[0].name, ":status");
+    EXPECT_EQ(fields[0].value, "201");
+    EXPECT_EQ(fields[1].name, "content-length");
+
+    EXPECT_EQ(frames[1].type, static_cast<std::uint8_t>(http2_frame_type::data));
+    EXPECT_EQ(frames[1].flags, 0x1);
+    EXPECT_EQ(frames[1].payload, "ok");
+
+    EXPECT_EQ(frames[2].stream_id, 1u);
+    EXPECT_EQ(frames[2].flags, 0x5);  // END_HEADERS | END_STREAM
+    EXPECT_EQ(connection.stream_count(), 0u);
+}
+
+TEST_F(Http2ConnectionTest, DecodesChunkedResponsesIntoDataAndTrailers) {
+    send(make_frame(http2_frame_type::headers, 0x5, 1, request_block(client_encoder, "GET", "/")));
+    connection.write(1, {"HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\nTrailer: x-sum\r\n\r\n"},
+                     false);
+    connection.write(1, {"5\r\n", "hello", "\r\n"}, false);
+    connection.write(1, {"0\r\nX-Sum: 42\r\n\r\n"}, true);
+    auto frames = take_frames();
+    ASSERT_EQ(frames.size(), 3u);
+    EXPECT_EQ(frames[1].type, static_cast<std::uint8_t>(http2_frame_type::data));
+    EXPECT_EQ(frames[1].payload, "hello");
+    EXPECT_EQ(frames[1].flags, 0x0);
+
+    std::vector<hpack_field> fields;
+    ASSERT_TRUE(client_decoder.decode(frames[0].payload, fields, 4096));
+    fields.clear();
+    EXPECT_EQ(frames[2].type, static_cast<std::uint8_t>(http2_frame_type::headers));
+    EXPECT_EQ(frames[2].flags, 0x5);
+    ASSERT_TRUE(client_decoder.decode(frames[2].payload, fields, 4096));
+    ASSERT_EQ(fields.size(), 1u);
+    EXPECT_EQ(fields[0].name, "x-sum");
+    EXPECT_EQ(fields[0].value, "42");
+}
+
+TEST_F(Http2ConnectionTest, WaitsForWindowUpdatesBeforeSendingMoreData) {
+    send(make_frame(http2_frame_type::settings, 0, 0, setting(4, 4)) +
+         make_frame(http2_frame_type::headers, 0x5, 1, request_block(client_encoder, "GET", "/")));
+    take_frames();
+    connection.write(1, {"HTTP/1.1 200 OK\r\nContent-Length: 10\r\n\r\n", "0123456789"}, true);
+    auto frames = take_frames();
+    ASSERT_EQ(frames.size(), 2u);
+    EXPECT_EQ(frames[1].payload, "0123");
+    EXPECT_EQ(frames[1].flags, 0x0);
+
+    send(make_frame(http2_frame_type::window_update, 0, 1, u32(100)));
+    frames = take_frames();
+    ASSERT_EQ(frames.size(), 1u);
+    EXPECT_EQ(frames[0].payload, "456789");
+    EXPECT_EQ(frames[0].flags, 0x1);
+    EXPECT_EQ(connection.stream_count(), 0u);
+}
+
+TEST_F(Http2ConnectionTest, JoinsContinuationFrames) {
+    std::string block = request_block(client_encoder, "GET", "/split");
+    auto requests = send(make_frame(http2_frame_type::headers, 0x1, 1, block.substr(0, 3)) +
+                         make_frame(http2_frame_type::continuation, 0x4, 1, block.substr(3)));
+    ASSERT_EQ(requests.size(), 1u);
+    EXPECT_EQ(requests[0].uri, "/split");
+}
+
+TEST_F(Http2ConnectionTest, ResetsMalformedStreamsOnly) {
+    std::string block;
+    client_encoder.begin_block(block);
+    client_encoder.encode(":method", "GET", block);
+    client_encoder.encode(":path", "/", block);
+    client_encoder.encode("connection", "keep-alive", block);
+    auto requests = send(make_frame(http2_frame_type::headers, 0x5, 1, block));
+    EXPECT_TRUE(requests.empty());
+    auto frames = take_frames();
+    ASSERT_EQ(frames.size(), 1u);
+    EXPECT_EQ(frames[0].type, static_cast<std::uint8_t>(http2_frame_type::rst_stream));
+    EXPECT_EQ(frames[0].payload, u32(static_cast<std::uint32_t>(http2_error::protocol_error)));
+    EXPECT_FALSE(closed);
+
+    requests = send(
+        make_frame(http2_frame_type::headers, 0x5, 3, request_block(client_encoder, "GET", "/")));
+    EXPECT_EQ(requests.size(), 1u);
+}
+
+TEST_F(Http2ConnectionTest, FailsTheConnectionOnProtocolErrors) {
+    // even stream ids belong to the server
+    send(make_frame(http2_frame_type::headers, 0x5, 2, request_block(client_encoder, "GET", "/")));
+    auto frames = take_frames();
+    ASSERT_EQ(frames.size(), 1u);
+    EXPECT_EQ(frames[0].type, static_cast<std::uint8_t>(http2_frame_type::goaway));
+    EXPECT_EQ(frames[0].payload.substr(4),
+              u32(static_cast<std::uint32_t>(http2_error::protocol_error)));
+    EXPECT_TRUE(closed);
+
+    std::vector<http2_request> requests;
+    EXPECT_FALSE(connection.receive(make_frame(http2_frame_type::ping, 0, 0, "12345678"), requests));
+}
+
+TEST(Http2ConnectionUpgradeTest, AnswersTheUpgradedRequestOnStreamOne) {
+    std::string output;
+    http2_connection connection(
+        [&output](std::vector<std::string>&& frames) {
+            for (auto& f : frames)
+                output += f;
+        },
+        []() {});
+    EXPECT_FALSE(connection.start_upgraded("not*base64"));
+    // SETTINGS_MAX_FRAME_SIZE = 16384, base64url without padding
+    ASSERT_TRUE(connection.start_upgraded("AAUAAEAA"));
+    EXPECT_EQ(connection.stream_count(), 1u);
+    output.clear();
+
+    connection.write(1, {"HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n"}, true);
+    ASSERT_GE(output.size(), 9u);
+    EXPECT_EQ(output[3], static_cast<char>(http2_frame_type::headers));
+    EXPECT_EQ(output[4], static_cast<char>(0x5));
+    EXPECT_EQ(output[8], static_cast<char>(1));
+    EXPECT_EQ(connection.stream_count(), 0u);
+}
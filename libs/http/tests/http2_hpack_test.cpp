@@ -0,0 +1,141 @@
+#include "../includes/http2_hpack.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+using namespace cppress::http;
+
+namespace {
+std::string from_hex(std::string_view hex) {
+    std::string out;
+    for (std::size_t i = 0; i + 1 < hex.size(); i += 2)
+        out.push_back(static_cast<char>(std::stoi(std::string(hex.substr(i, 2)), nullptr, 16)));
+    return out;
+}
+}  // namespace
+
+TEST(HpackTest, IntegersRoundTripAcrossThePrefix) {
+    for (std::uint64_t value : {0ull, 10ull, 30ull, 31ull, 1337ull, 0xffffffffull}) {
+        std::string out;
+        hpack_encode_integer(value, 5, 0xe0, out);
+        EXPECT_EQ(static_cast<std::uint8_t>(out[0]) & 0xe0, 0xe0);
+        std::size_t pos = 0;
+        std::uint64_t decoded = 0;
+        ASSERT_TRUE(hpack_decode_integer(out, pos, 5, decoded));
+        EXPECT_EQ(decoded, value);
+        EXPECT_EQ(pos, out.size());
+    }
+
+    // RFC 7541 C.1.2: 1337 with a 5-bit prefix
+    std::string out;
+    hpack_encode_integer(1337, 5, 0, out);
+    EXPECT_EQ(out, from_hex("1f9a0a"));
+
+    std::size_t pos = 0;
+    std::uint64_t value = 0;
+    EXPECT_FALSE(hpack_decode_integer(from_hex("1f9a"), pos, 5, value));
+
+    // no field needs more than 32 bits, longer integers are rejected
+    out.clear();
+    hpack_encode_integer(1ull << 40, 5, 0, out);
+    pos = 0;
+    EXPECT_FALSE(hpack_decode_integer(out, pos, 5, value));
+}
+
+TEST(HpackTest, HuffmanMatchesTheRfcVectors) {
+    std::string encoded;
+    huffman_encode("www.example.com", encoded);
+    EXPECT_EQ(encoded, from_hex("f1e3c2e5f23a6ba0ab90f4ff"));
+    EXPECT_EQ(huffman_encoded_size("www.example.com"), encoded.size());
+
+    std::string decoded;
+    ASSERT_TRUE(huffman_decode(from_hex("6402"), decoded));
+    EXPECT_EQ(decoded, "302");
+
+    // padding must be at most 7 bits of ones
+    decoded.clear();
+    EXPECT_FALSE(huffman_decode(from_hex("f1e3c2e5f23a6ba0ab90f4ffff"), decoded));
+}
+
+TEST(HpackTest, DecodesRequestsWithHuffmanAndTheDynamicTable) {
+    // RFC 7541 C.4: three requests on one connection
+    hpack_decoder decoder;
+    std::vector<hpack_field> fields;
+    ASSERT_TRUE(decoder.decode(from_hex("828684418cf1e3c2e5f23a6ba0ab90f4ff"), fields, 4096));
+    ASSERT_EQ(fields.size(), 4u);
+    EXPECT_EQ(fields[0].name, ":method");
+    EXPECT_EQ(fields[0].value, "GET");
+    EXPECT_EQ(fields[3].name, ":authority");
+    EXPECT_EQ(fields[3].value, "www.example.com");
+
+    fields.clear();
+    ASSERT_TRUE(decoder.decode(from_hex("828684be5886a8eb10649cbf"), fields, 4096));
+    ASSERT_EQ(fields.size(), 5u);
+    EXPECT_EQ(fields[3].value, "www.example.com");
+    EXPECT_EQ(fields[4].name, "cache-control");
+    EXPECT_EQ(fields[4].value, "no-cache");
+
+    fields.clear();
+    ASSERT_TRUE(decoder.decode(
+        from_hex("828785bf408825a849e95ba97d7f8925a849e95bb8e8b4bf"), fields, 4096));
+    ASSERT_EQ(fields.size(), 5u);
+    EXPECT_EQ(fields[1].value, "https");
+    EXPECT_EQ(fields[2].value, "/index.html");
+    EXPECT_EQ(fields[4].name, "custom-key");
+    EXPECT_EQ(fields[4].value, "custom-value");
+}
+
+TEST(HpackTest, RejectsMalformedBlocks) {
+    hpack_decoder decoder;
+    std::vector<hpack_field> fields;
+    // index 0 and an index past both tables
+    EXPECT_FALSE(decoder.decode(from_hex("80"), fields, 4096));
+    EXPECT_FALSE(hpack_decoder().decode(from_hex("ff00"), fields, 4096));
+    // a table size update above the limit, and one after a field
+    EXPECT_FALSE(hpack_decoder().decode(from_hex("3fe21f"), fields, 4096));
+    EXPECT_FALSE(hpack_decoder().decode(from_hex("8220"), fields, 4096));
+    // a literal cut short
+    EXPECT_FALSE(hpack_decoder().decode(from_hex("400a6b6579"), fields, 4096));
+    // the list limit
+    EXPECT_FALSE(hpack_decoder().decode(from_hex("828684"), fields, 40));
+}
+
+TEST(HpackTest, EncodedBlocksDecodeToTheSameFields) {
+    hpack_encoder encoder;
+    hpack_decoder decoder;
+    std::vector<hpack_field> response = {{":status", "200"},
+                                         {"content-type", "text/html; charset=utf-8"},
+                                         {"content-length", "1234"},
+                                         {"x-request-id", "abc"}};
+    std::size_t first_size = 0;
+    for (int round = 0; round < 2; ++round) {
+        std::string block;
+        encoder.begin_block(block);
+        for (const auto& field : response)
+            encoder.encode(field.name, field.value, block);
+        if (round == 0)
+            first_size = block.size();
+        else
+            EXPECT_LT(block.size(), first_size);  // repeated fields are indexed
+
+        std::vector<hpack_field> fields;
+        ASSERT_TRUE(decoder.decode(block, fields, 4096));
+        ASSERT_EQ(fields.size(), response.size());
+        for (std::size_t i = 0; i < fields.size(); ++i) {
+            EXPECT_EQ(fields[i].name, response[i].name);
+            EXPECT_EQ(fields[i].value, response[i].value);
+        }
+    }
+
+    // a smaller peer table is announced before the next block
+    encoder.set_max_table_size(0);
+    std::string block;
+    encoder.begin_block(block);
+    encoder.encode("x-request-id", "abc", block);
+    std::vector<hpack_field> fields;
+    ASSERT_TRUE(decoder.decode(block, fields, 4096));
+    ASSERT_EQ(fields.size(), 1u);
+    EXPECT_EQ(fields[0].value, "abc");
+}
@@ -0,0 +1,73 @@
+#include "../includes/http_chunked_decoder.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+using namespace cppress::http;
+
+namespace {
+/// Feeds input in pieces of at most step bytes, returns the decoded body or "ERROR"
+std::string decode(http_chunked_decoder& decoder, const std::string& input, std::size_t step,
+                   std::string* rest = nullptr) {
+    std::string body;
+    for (std::size_t off = 0; off < input.size(); off += step) {
+        std::string_view piece = std::string_view(input).substr(off, step);
+        std::size_t pos = 0;
+        http_span run;
+        for (;;) {
+            auto st = decoder.next(piece, pos, run, 1024);
+            if (st == http_chunked_decoder::status::data) {
+                body.append(run.in(piece));
+                continue;
+            }
+            if (st == http_chunked_decoder::status::error)
+                return "ERROR";
+            if (st == http_chunked_decoder::status::complete) {
+                if (rest)
+                    *rest = std::string(piece.substr(pos)) + input.substr(off + piece.size());
+                return body;
+            }
+            break;
+        }
+    }
+    return "INCOMPLETE";
+}
+}  // namespace
+
+TEST(HttpChunkedDecoderTest, DecodesAtEveryChunkBoundary) {
+    std::string input =
+        "4\r\nWiki\r\n"
+        "5;name=\"value\";flag\r\npedia\r\n"
+        "E \r\n in\r\n\r\nchunks.\r\n"
+        "0\r\n"
+        "Expires: never \r\n"
+        "X-Checksum:abc\r\n"
+        "\r\n"
+        "GET /next";
+    for (std::size_t step = 1; step <= input.size(); ++step) {
+        http_chunked_decoder decoder;
+        std::string rest;
+        EXPECT_EQ(decode(decoder, input, step, &rest), "Wikipedia in\r\n\r\nchunks.") << step;
+        EXPECT_EQ(rest, "GET /next") << step;
+        auto trailers = decoder.trailers();
+        ASSERT_EQ(trailers.size(), 2u);
+        EXPECT_EQ(trailers[0].first, "Expires");
+        EXPECT_EQ(trailers[0].second, "never");
+        EXPECT_EQ(trailers[1].second, "abc");
+    }
+}
+
+TEST(HttpChunkedDecoderTest, RejectsMalformedFraming) {
+    for (const std::string& input :
+         {std::string("x\r\n"), std::string("4\r\nWikiX\r\n"), std::string("4 junk\r\n"),
+          std::string("ffffffffffffffffff\r\n")}) {
+        http_chunked_decoder decoder;
+        EXPECT_EQ(decode(decoder, input, input.size()), "ERROR") << input;
+        EXPECT_NE(decoder.error(), http_chunked_decoder::error_code::none);
+    }
+
+    http_chunked_decoder decoder;
+    EXPECT_EQ(decode(decoder, "0\r\n" + std::string(2000, 'a'), 64), "ERROR");
+    EXPECT_EQ(decoder.error(), http_chunked_decoder::error_code::too_large);
+}
@@ -0,0 +1,126 @@
+#include "../includes/http_compression.hpp"
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <string>
+
+#if CPPRESS_HAS_ZLIB
+#include <zlib.h>
+#endif
+
+using namespace cppress::http;
+
+namespace {
+http_headers accepting(std::string_view accept_encoding) {
+    http_headers headers;
+    headers.add("Host", "localhost");
+    headers.add("Accept-Encoding", accept_encoding);
+    return headers;
+}
+
+#if CPPRESS_HAS_ZLIB
+std::string gunzip(const std::string& input) {
+    z_stream stream{};
+    inflateInit2(&stream, 15 + 16);
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+    stream.avail_in = static_cast<uInt>(input.size());
+    std::string out;
+    char block[4096];
+    int rc;
+    do {
+        stream.next_out = reinterpret_cast<Bytef*>(block);
+        stream.avail_out = sizeof(block);
+        rc = inflate(&stream, Z_NO_FLUSH);
+        out.append(block, sizeof(block) - stream.avail_out);
+    } while (rc == Z_OK && stream.avail_out == 0);
+    inflateEnd(&stream);
+    return out;
+}
+#endif
+}  // namespace
+
+TEST(HttpCompressionTest, AcceptEncodingQualities) {
+    EXPECT_EQ(accept_encoding_quality("gzip, br;q=0.8", content_coding::gzip), 1);
+    EXPECT_EQ(accept_encoding_quality("gzip, br;q=0.8", content_coding::br), 0.8);
+    EXPECT_EQ(accept_encoding_quality("gzip", content_coding::zstd), 0);
+    EXPECT_EQ(accept_encoding_quality("X-GZIP", content_coding::gzip), 1);
+    EXPECT_EQ(accept_encoding_quality("*;q=0.5, gzip;q=0", content_coding::gzip), 0);
+    EXPECT_EQ(accept_encoding_quality("*;q=0.5, gzip;q=0", content_coding::br), 0.5);
+
+    // identity stays acceptable unless it is refused outright
+    EXPECT_EQ(accept_encoding_quality("gzip", content_coding::identity), 1);
+    EXPECT_EQ(accept_encoding_quality("identity;q=0", content_coding::identity), 0);
+    EXPECT_EQ(accept_encoding_quality("*;q=0", content_coding::identity), 0);
+}
+
+TEST(HttpCompressionTest, NegotiationPrefersQualityThenCandidateOrder) {
+    auto order = {content_coding::br, content_coding::zstd, content_coding::gzip};
+    EXPECT_EQ(negotiate_content_coding(accepting("gzip, br"), order), content_coding::br);
+    EXPECT_EQ(negotiate_content_coding(accepting("gzip, br;q=0.5"), order), content_coding::gzip);
+    EXPECT_EQ(negotiate_content_coding(accepting("deflate"), order), content_coding::identity);
+    EXPECT_EQ(negotiate_content_coding(http_headers(), order), content_coding::identity);
+
+    // several fields are one list
+    http_headers split = accepting("br;q=0");
+    split.add("accept-encoding", "zstd;q=0.1");
+    EXPECT_EQ(negotiate_content_coding(split, order), content_coding::zstd);
+
+    // only compiled-in codings are negotiated by default
+    content_coding picked = negotiate_content_coding(accepting("gzip, br, zstd"));
+    EXPECT_TRUE(picked == content_coding::identity || content_coding_available(picked));
+}
+
+TEST(HttpCompressionTest, NamesSuffixesAndContentTypes) {
+    EXPECT_EQ(content_coding_name(content_coding::br), "br");
+    EXPECT_EQ(content_coding_suffix(content_coding::gzip), ".gz");
+    EXPECT_TRUE(content_coding_name(content_coding::identity).empty());
+    EXPECT_TRUE(content_coding_available(content_coding::identity));
+
+    EXPECT_TRUE(compressible_content_type("application/json"));
+    EXPECT_TRUE(compressible_content_type("text/html; charset=utf-8"));
+    EXPECT_TRUE(compressible_content_type("application/problem+json"));
+    EXPECT_TRUE(compressible_content_type("image/svg+xml"));
+    EXPECT_FALSE(compressible_content_type("image/png"));
+    EXPECT_FALSE(compressible_content_type("application/zip"));
+    EXPECT_FALSE(compressible_content_type(""));
+}
+
+TEST(HttpCompressionTest, UnavailableCodingsHaveNoCompressor) {
+    EXPECT_EQ(http_compressor::create(content_coding::identity), nullptr);
+    for (auto coding : {content_coding::gzip, content_coding::br, content_coding::zstd}) {
+        if (content_coding_available(coding))
+            EXPECT_NE(http_compressor::create(coding), nullptr);
+        else
+            EXPECT_THROW(compress_body(coding, "body"), std::invalid_argument);
+    }
+}
+
+TEST(HttpCompressionTest, CompressedBodiesAreSmaller) {
+    std::string json;
+    for (int i = 0; i < 200; ++i)
+        json += "{\"id\":" + std::to_string(i) + ",\"name\":\"user\",\"active\":true},";
+    for (auto coding : {content_coding::gzip, content_coding::br, content_coding::zstd}) {
+        if (!content_coding_available(coding))
+            continue;
+        std::string encoded = compress_body(coding, json);
+        EXPECT_LT(encoded.size(), json.size() / 4) << content_coding_name(coding);
+    }
+}
+
+#if CPPRESS_HAS_ZLIB
+TEST(HttpCompressionTest, GzipRoundTripsWholeAndFlushedStreams) {
+    std::string body(10000, 'a');
+    EXPECT_EQ(gunzip(compress_body(content_coding::gzip, body)), body);
+
+    // every flushed part decodes on its own, before the stream ends
+    auto compressor = http_compressor::create(content_coding::gzip);
+    std::string first = compressor->compress("event: one\n", http_compressor::flush_mode::flush);
+    ASSERT_FALSE(first.empty());
+    EXPECT_EQ(gunzip(first), "event: one\n");
+    std::string wire = first;
+    wire += compressor->compress("event: two\n", http_compressor::flush_mode::flush);
+    wire += compressor->compress({}, http_compressor::flush_mode::finish);
+    EXPECT_EQ(gunzip(wire), "event: one\nevent: two\n");
+}
+#endif
@@ -0,0 +1,68 @@
+#include "../includes/http_conditional.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+using namespace cppress::http;
+
+TEST(HttpConditionalTest, ParsesTheThreeDateForms) {
+    std::time_t time = 0;
+    ASSERT_TRUE(parse_http_date("Sun, 06 Nov 1994 08:49:37 GMT", time));
+    EXPECT_EQ(time, 784111777);
+    ASSERT_TRUE(parse_http_date("Sunday, 06-Nov-94 08:49:37 GMT", time));
+    EXPECT_EQ(time, 784111777);
+    ASSERT_TRUE(parse_http_date("Sun Nov  6 08:49:37 1994", time));
+    EXPECT_EQ(time, 784111777);
+
+    EXPECT_EQ(format_http_date(784111777), "Sun, 06 Nov 1994 08:49:37 GMT");
+    ASSERT_TRUE(parse_http_date(format_http_date(1709251199), time));  // 2024-02-29
+    EXPECT_EQ(time, 1709251199);
+
+    EXPECT_FALSE(parse_http_date("", time));
+    EXPECT_FALSE(parse_http_date("yesterday", time));
+    EXPECT_FALSE(parse_http_date("Sun, 06 Nov 1994 08:49:37 CET", time));
+    EXPECT_FALSE(parse_http_date("Sun, 06 Nov 1994 25:49:37 GMT", time));
+    EXPECT_FALSE(parse_http_date("Sun, 06 Nov 1994 08:49:37 GMT extra", time));
+}
+
+TEST(HttpConditionalTest, IfNoneMatchUsesTheWeakComparison) {
+    EXPECT_TRUE(etag_list_matches("\"v1\"", "\"v1\""));
+    EXPECT_TRUE(etag_list_matches("W/\"v1\"", "\"v1\""));
+    EXPECT_TRUE(etag_list_matches("\"v1\"", "W/\"v1\""));
+    EXPECT_TRUE(etag_list_matches("\"a\", W/\"b,c\", \"v1\"", "\"v1\""));
+    EXPECT_TRUE(etag_list_matches("*", "\"v1\""));
+    EXPECT_FALSE(etag_list_matches("\"v2\"", "\"v1\""));
+    EXPECT_FALSE(etag_list_matches("\"b\"", "W/\"b,c\""));
+    EXPECT_FALSE(etag_list_matches("*", ""));
+}
+
+TEST(HttpConditionalTest, IfNoneMatchTakesPrecedenceOverDates) {
+    const char* modified = "Sun, 06 Nov 1994 08:49:37 GMT";
+    EXPECT_TRUE(not_modified("", modified, "", modified));
+    EXPECT_TRUE(not_modified("", "Mon, 07 Nov 1994 00:00:00 GMT", "", modified));
+    EXPECT_FALSE(not_modified("", "Sat, 05 Nov 1994 00:00:00 GMT", "", modified));
+    EXPECT_FALSE(not_modified("", "not a date", "", modified));
+    EXPECT_FALSE(not_modified("", modified, "", ""));
+
+    // a stale tag wins over a current date
+    EXPECT_FALSE(not_modified("\"v0\"", modified, "\"v1\"", modified));
+    EXPECT_TRUE(not_modified("\"v1\"", "", "\"v1\"", ""));
+}
+
+TEST(HttpConditionalTest, FileValidatorsComeFromStat) {
+    std::string path = "/tmp/cppress_conditional_test.txt";
+    std::ofstream(path) << "hello";
+
+    std::string etag, last_modified;
+    ASSERT_TRUE(file_validators(path, etag, last_modified));
+    EXPECT_EQ(etag.rfind("W/\"5-", 0), 0u);
+    std::time_t time = 0;
+    EXPECT_TRUE(parse_http_date(last_modified, time));
+
+    EXPECT_FALSE(file_validators("/tmp", etag, last_modified));
+    EXPECT_FALSE(file_validators("/tmp/cppress_no_such_file", etag, last_modified));
+    std::remove(path.c_str());
+}
@@ -0,0 +1,110 @@
+#include "../includes/http_event_stream.hpp"
+#include "../includes/http_consts.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+using namespace cppress::http;
+
+namespace {
+/// Subscriber writing into a string, with a settable connection state
+struct fake_subscriber {
+    std::string output;
+    std::vector<const char*> payloads;
+    bool complete = false;
+    output_state state = output_state::writable;
+    std::shared_ptr<sse_subscriber> subscriber = std::make_shared<sse_subscriber>(
+        [this](std::vector<cppress::sockets::output_segment>&& segments, bool last) {
+            for (auto& segment : segments) {
+                output.append(segment.memory.view());
+                payloads.push_back(segment.memory.data());
+            }
+            complete = complete || last;
+        },
+        [this]() { return state; }, nullptr);
+};
+}  // namespace
+
+TEST(SseEventTest, FieldsAndMultilineData) {
+    sse_event event;
+    event.id = "7";
+    event.event = "update";
+    event.data = "line one\nline two\r\nline three";
+    event.retry = std::chrono::milliseconds(2500);
+    EXPECT_EQ(format_sse_event(event),
+              "id: 7\nevent: update\nretry: 2500\n"
+              "data: line one\ndata: line two\ndata: line three\n\n");
+
+    EXPECT_EQ(format_sse_event({"", "", "x"}), "data: x\n\n");
+    EXPECT_EQ(format_sse_event({}), "data: \n\n");
+}
+
+TEST(SseEventTest, EncodedEventIsOneChunk) {
+    auto chunk = encode_sse_event({"", "", "hello"});
+    EXPECT_EQ(chunk.to_string(), "d\r\ndata: hello\n\n\r\n");
+}
+
+TEST(SseChannelTest, EveryoneSharesTheSameEncodedBuffer) {
+    fake_subscriber a, b;
+    sse_channel channel;
+    channel.subscribe(a.subscriber);
+    channel.subscribe(b.subscriber);
+
+    EXPECT_EQ(channel.publish({"1", "", "tick"}), 2u);
+    EXPECT_EQ(a.output, b.output);
+    ASSERT_EQ(a.payloads.size(), 1u);
+    ASSERT_EQ(b.payloads.size(), 1u);
+    EXPECT_EQ(a.payloads[0], b.payloads[0]);  // same storage, not a copy
+}
+
+TEST(SseChannelTest, CongestedSubscriberLagsThenIsDropped) {
+    auto saved = config::SSE_MAX_LAGGED_EVENTS;
+    config::SSE_MAX_LAGGED_EVENTS = 2;
+    fake_subscriber fast, slow;
+    sse_channel channel;
+    channel.subscribe(fast.subscriber);
+    channel.subscribe(slow.subscriber);
+
+    slow.state = output_state::congested;
+    EXPECT_EQ(channel.publish({"", "", "1"}), 1u);
+    EXPECT_EQ(channel.publish({"", "", "2"}), 1u);
+    EXPECT_EQ(slow.subscriber->lag(), 2u);
+
+    // draining again resets the streak, the lag count stays
+    slow.state = output_state::writable;
+    EXPECT_EQ(channel.publish({"", "", "3"}), 2u);
+    slow.state = output_state::congested;
+    channel.publish({"", "", "4"});
+    channel.publish({"", "", "5"});
+    EXPECT_EQ(channel.size(), 2u);
+    channel.publish({"", "", "6"});
+    config::SSE_MAX_LAGGED_EVENTS = saved;
+
+    EXPECT_EQ(channel.size(), 1u);
+    EXPECT_EQ(channel.dropped(), 1u);
+    EXPECT_EQ(slow.subscriber->lag(), 5u);
+    EXPECT_TRUE(slow.complete);
+    EXPECT_EQ(slow.output.substr(slow.output.size() - 5), "0\r\n\r\n");
+    EXPECT_FALSE(fast.complete);
+}
+
+TEST(SseChannelTest, ClosedSubscribersAreRemoved) {
+    fake_subscriber gone, open, ended;
+    sse_channel channel;
+    channel.subscribe(gone.subscriber);
+    channel.subscribe(open.subscriber);
+    channel.subscribe(ended.subscriber);
+    gone.state = output_state::closed;
+    ended.subscriber->close();
+
+    EXPECT_EQ(channel.publish({"", "", "x"}), 1u);
+    EXPECT_EQ(channel.size(), 1u);
+    EXPECT_TRUE(gone.output.empty());
+    EXPECT_FALSE(ended.subscriber->send({"", "", "late"}));
+
+    channel.close_all();
+    EXPECT_TRUE(open.complete);
+    EXPECT_EQ(channel.size(), 0u);
+}
@@ -0,0 +1,78 @@
+#include "../includes/http_head_parser.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+using namespace cppress::http;
+
+TEST(HttpHeadParserTest, RecordsOffsetsIntoTheInput) {
+    std::string input =
+        "GET /a?b=c HTTP/1.1\r\n"
+        "Host:  example.com \r\n"
+        "X-Empty:\r\n"
+        "no colon here\r\n"
+        "\r\n"
+        "body";
+    http_head_parser head;
+    ASSERT_EQ(head.parse(input, 1024), http_head_parser::status::complete);
+
+    EXPECT_EQ(head.method().in(input), "GET");
+    EXPECT_EQ(head.uri().in(input), "/a?b=c");
+    EXPECT_EQ(head.version().in(input), "HTTP/1.1");
+    ASSERT_EQ(head.header_count(), 2u);
+    EXPECT_EQ(head.header(0).name.in(input), "Host");
+    EXPECT_EQ(head.header(0).value.in(input), "example.com");
+    EXPECT_EQ(head.header(1).name.in(input), "X-Empty");
+    EXPECT_EQ(head.header(1).value.in(input), "");
+    EXPECT_EQ(input.substr(head.consumed()), "body");
+}
+
+TEST(HttpHeadParserTest, ResumesAtEveryChunkBoundary) {
+    std::string input =
+        "\r\nPOST  /upload HTTP/1.0\n"
+        "Content-Length: 4\n"
+        "X-Long: " +
+        std::string(40, 'v') + "\r\n\r\n";
+    for (std::size_t cut = 0; cut < input.size(); ++cut) {
+        http_head_parser head;
+        EXPECT_EQ(head.parse(std::string_view(input).substr(0, cut), 1024),
+                  http_head_parser::status::need_more)
+            << cut;
+        ASSERT_EQ(head.parse(input, 1024), http_head_parser::status::complete) << cut;
+        EXPECT_EQ(head.method().in(input), "POST");
+        EXPECT_EQ(head.uri().in(input), "/upload");
+        EXPECT_EQ(head.version().in(input), "HTTP/1.0");
+        ASSERT_EQ(head.header_count(), 2u);
+        EXPECT_EQ(head.header(1).value.in(input), std::string(40, 'v'));
+        EXPECT_EQ(head.consumed(), input.size());
+    }
+}
+
+TEST(HttpHeadParserTest, RejectsMalformedAndOversizedHeads) {
+    http_head_parser head;
+    EXPECT_EQ(head.parse("INVALID REQUEST\r\n\r\n", 1024), http_head_parser::status::error);
+    EXPECT_EQ(head.error(), http_head_parser::error_code::bad_request_line);
+
+    head.reset();
+    EXPECT_EQ(head.parse("GET / HTTP/1.1\r\n\rX", 1024), http_head_parser::status::error);
+    EXPECT_EQ(head.error(), http_head_parser::error_code::bad_header);
+
+    // an unterminated head fails as soon as it outgrows the limit
+    head.reset();
+    std::string endless = "GET / HTTP/1.1\r\nX: " + std::string(2000, 'a');
+    EXPECT_EQ(head.parse(endless, 1024), http_head_parser::status::error);
+    EXPECT_EQ(head.error(), http_head_parser::error_code::too_large);
+}
+
+TEST(HttpHeadParserTest, ManyFieldsSpillPastTheInlineStorage) {
+    std::string input = "GET / HTTP/1.1\r\n";
+    for (int i = 0; i < 40; ++i)
+        input += "H" + std::to_string(i) + ": " + std::to_string(i) + "\r\n";
+    input += "\r\n";
+    http_head_parser head;
+    ASSERT_EQ(head.parse(input, 4096), http_head_parser::status::complete);
+    ASSERT_EQ(head.header_count(), 40u);
+    EXPECT_EQ(head.header(39).name.in(input), "H39");
+    EXPECT_EQ(head.header(39).value.in(input), "39");
+}
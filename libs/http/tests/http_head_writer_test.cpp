@@ -0,0 +1,44 @@
+#include "../includes/http_head_writer.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+using namespace cppress::http;
+
+TEST(HttpHeadWriterTest, WritesThePreEncodedOrTheBuiltStatusLine) {
+    std::multimap<std::string, std::string> headers = {{"CONTENT-LENGTH", "2"},
+                                                       {"CONTENT-TYPE", "application/json"}};
+    std::string head = write_http_head("HTTP/1.1", 200, "OK", headers);
+    std::string date(http_date_line());
+    EXPECT_EQ(head, "HTTP/1.1 200 OK\r\n" + date +
+                        "CONTENT-LENGTH: 2\r\nCONTENT-TYPE: application/json\r\n\r\n");
+    EXPECT_LT(head.capacity() - head.size(), 16u);  // sized up front
+
+    // custom reasons, unknown codes and other versions are written as given
+    EXPECT_EQ(write_http_head("HTTP/1.1", 200, "Fine", {}), "HTTP/1.1 200 Fine\r\n" + date + "\r\n");
+    EXPECT_EQ(write_http_head("HTTP/1.0", 418, "I'm a teapot", {}),
+              "HTTP/1.0 418 I'm a teapot\r\n" + date + "\r\n");
+    EXPECT_EQ(http_status_line(404, "Not Found"), "HTTP/1.1 404 Not Found\r\n");
+    EXPECT_TRUE(http_status_line(404, "Gone").empty());
+}
+
+TEST(HttpHeadWriterTest, DateLineAndHeaderNames) {
+    std::string date(http_date_line());
+    ASSERT_EQ(date.size(), std::string("Date: Sun, 06 Nov 1994 08:49:37 GMT\r\n").size());
+    EXPECT_EQ(date.rfind("Date: ", 0), 0u);
+    EXPECT_EQ(date.substr(date.size() - 6), " GMT\r\n");
+
+    EXPECT_EQ(http_well_known_header("content-type"), "CONTENT-TYPE");
+    EXPECT_EQ(http_well_known_header("Set-Cookie"), "SET-COOKIE");
+    EXPECT_TRUE(http_well_known_header("X-Custom").empty());
+}
+
+TEST(HttpHeadWriterTest, ReasonPhrasesAndHeaderNamesAreLookedUpThroughCompileTimeHashes) {
+    EXPECT_EQ(http_reason_phrase(404), "Not Found");
+    EXPECT_EQ(http_reason_phrase(503), "Service Unavailable");
+    EXPECT_TRUE(http_reason_phrase(418).empty());
+    EXPECT_TRUE(http_reason_phrase(99).empty());
+    EXPECT_TRUE(http_reason_phrase(600).empty());
+    EXPECT_TRUE(http_well_known_header("CONTENT-TYP").empty());
+}
@@ -0,0 +1,59 @@
+#include "../includes/http_headers.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+using namespace cppress::http;
+
+TEST(HttpHeadersTest, KnownAndOtherNamesAreFoundCaseInsensitively) {
+    http_headers headers;
+    headers.add("Host", "example.com");
+    headers.add("x-trace-id", "abc");
+    headers.add("connection", "keep-alive");
+    headers.add("X-Trace-Id", "def");
+    headers.add("CONNECTION", "Upgrade");
+
+    EXPECT_EQ(headers.size(), 5u);
+    EXPECT_EQ(headers.id(0), header_id::host);
+    EXPECT_EQ(headers.id(1), header_id::other);
+    EXPECT_EQ(headers.get(header_id::host), "example.com");
+    EXPECT_EQ(headers.get("HOST"), "example.com");
+    EXPECT_EQ(headers.get("X-TRACE-ID"), "abc");
+    EXPECT_EQ(headers.count("x-trace-id"), 2u);
+    EXPECT_EQ(headers.count(header_id::connection), 2u);
+    EXPECT_TRUE(headers.contains(header_id::connection));
+    EXPECT_FALSE(headers.contains(header_id::cookie));
+    EXPECT_FALSE(headers.contains("X-Other"));
+    EXPECT_TRUE(headers.get(header_id::cookie).empty());
+
+    std::vector<std::string> expected = {"keep-alive", "Upgrade"};
+    EXPECT_EQ(headers.values("Connection"), expected);
+
+    // iteration keeps arrival order and the names as sent
+    std::string joined;
+    for (const auto& [name, value] : headers)
+        joined += std::string(name) + "=" + std::string(value) + ";";
+    EXPECT_EQ(joined,
+              "Host=example.com;x-trace-id=abc;connection=keep-alive;X-Trace-Id=def;"
+              "CONNECTION=Upgrade;");
+}
+
+TEST(HttpHeadersTest, FieldsPastTheInlineOnesAndCopies) {
+    http_headers headers;
+    for (std::size_t i = 0; i < http_headers::INLINE_FIELDS + 8; ++i)
+        headers.add("X-Field-" + std::to_string(i), std::to_string(i));
+    headers.add("Cookie", "a=1");
+
+    http_headers copy = headers;
+    headers.clear();
+    EXPECT_TRUE(headers.empty());
+    EXPECT_FALSE(headers.contains(header_id::cookie));
+
+    ASSERT_EQ(copy.size(), http_headers::INLINE_FIELDS + 9);
+    EXPECT_EQ(copy.get("x-field-20"), "20");
+    EXPECT_EQ(copy.get(header_id::cookie), "a=1");
+    EXPECT_EQ(copy[http_headers::INLINE_FIELDS].name, "X-Field-16");
+    EXPECT_EQ(http_header_id("content-LENGTH"), header_id::content_length);
+    EXPECT_EQ(http_header_name(header_id::content_length), "Content-Length");
+}
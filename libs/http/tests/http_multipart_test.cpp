@@ -0,0 +1,129 @@
+#include "../includes/http_multipart.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../includes/http_consts.hpp"
+
+using namespace cppress::http;
+
+namespace {
+const std::string form =
+    "preamble to ignore\r\n"
+    "--XyZ\r\n"
+    "Content-Disposition: form-data; name=\"title\"\r\n"
+    "\r\n"
+    "Holiday\r\n"
+    "--XyZ  \r\n"
+    "Content-Disposition: form-data; name=\"photo\"; filename=\"a;b \\\"c\\\".jpg\"\r\n"
+    "Content-Type: image/jpeg\r\n"
+    "\r\n"
+    "\r\n--XyQ not a delimiter\r\n-\r\n--X\r\n"
+    "--XyZ--\r\n"
+    "epilogue";
+}  // namespace
+
+TEST(HttpMultipartTest, FindsTheBoundaryParameter) {
+    std::string boundary;
+    ASSERT_TRUE(multipart_boundary("multipart/form-data; boundary=----WebKit42", boundary));
+    EXPECT_EQ(boundary, "----WebKit42");
+    ASSERT_TRUE(multipart_boundary("Multipart/Form-Data; charset=utf-8; BOUNDARY=\"a b\"", boundary));
+    EXPECT_EQ(boundary, "a b");
+
+    EXPECT_FALSE(multipart_boundary("application/json; boundary=x", boundary));
+    EXPECT_FALSE(multipart_boundary("multipart/form-data", boundary));
+    EXPECT_FALSE(multipart_boundary("multipart/form-data; boundary=" + std::string(71, 'x'),
+                                    boundary));
+}
+
+TEST(HttpMultipartTest, PartsAreTheSameWhateverThePieceSizes) {
+    for (std::size_t piece : {form.size(), std::size_t(1), std::size_t(2), std::size_t(7)}) {
+        multipart_parser parser("XyZ");
+        for (std::size_t at = 0; at < form.size(); at += piece)
+            ASSERT_TRUE(parser.feed(std::string_view(form).substr(at, piece)));
+        ASSERT_TRUE(parser.finish()) << "pieces of " << piece;
+
+        ASSERT_EQ(parser.parts().size(), 2u);
+        const auto& title = parser.parts()[0];
+        EXPECT_EQ(title.name, "title");
+        EXPECT_TRUE(title.filename.empty());
+        EXPECT_EQ(title.content_type, "text/plain");
+        EXPECT_EQ(title.content, "Holiday");
+        EXPECT_TRUE(title.complete);
+
+        const auto* photo = parser.find("photo");
+        ASSERT_NE(photo, nullptr);
+        EXPECT_EQ(photo->filename, "a;b \"c\".jpg");
+        EXPECT_EQ(photo->content_type, "image/jpeg");
+        EXPECT_EQ(photo->content, "\r\n--XyQ not a delimiter\r\n-\r\n--X");
+        EXPECT_EQ(photo->size, photo->content.size());
+    }
+}
+
+TEST(HttpMultipartTest, SinksReceiveContentWhileItArrives) {
+    std::string path = "/tmp/cppress_multipart_test.bin";
+    std::vector<std::string> pieces;
+    bool ended = false;
+    multipart_parser parser("XyZ", [&](const multipart_part& part) -> multipart_sink {
+        if (part.name == "photo")
+            return multipart_file_sink(path);
+        return [&](std::string_view piece, bool last) {
+            pieces.emplace_back(piece);
+            ended = last;
+        };
+    });
+
+    // the first part's content is handed over before its delimiter arrives
+    std::size_t split = form.find("Holiday") + 4;
+    ASSERT_TRUE(parser.feed(std::string_view(form).substr(0, split)));
+    ASSERT_EQ(pieces.size(), 1u);
+    EXPECT_EQ(pieces[0], "Holi");
+    EXPECT_FALSE(ended);
+
+    ASSERT_TRUE(parser.feed(std::string_view(form).substr(split)));
+    ASSERT_TRUE(parser.finish());
+    EXPECT_TRUE(ended);
+    EXPECT_TRUE(parser.parts()[0].content.empty());
+    EXPECT_EQ(parser.parts()[0].size, 7u);
+
+    std::ifstream file(path, std::ios::binary);
+    std::stringstream written;
+    written << file.rdbuf();
+    EXPECT_EQ(written.str(), "\r\n--XyQ not a delimiter\r\n-\r\n--X");
+    std::remove(path.c_str());
+}
+
+TEST(HttpMultipartTest, MalformedBodiesFail) {
+    multipart_parser cut("XyZ");
+    EXPECT_TRUE(cut.feed(form.substr(0, form.size() - 20)));
+    EXPECT_FALSE(cut.finish());
+    EXPECT_TRUE(cut.failed());
+
+    multipart_parser no_colon("b");
+    EXPECT_FALSE(no_colon.feed("--b\r\nnot a header\r\n\r\nx\r\n--b--"));
+
+    multipart_parser bad_padding("b");
+    EXPECT_FALSE(bad_padding.feed("--b x\r\n\r\nx\r\n--b--"));
+
+    // a header block without fields is a part too
+    multipart_parser empty("b");
+    EXPECT_TRUE(empty.feed("--b\r\n\r\nx\r\n--b--"));
+    ASSERT_TRUE(empty.finish());
+    EXPECT_EQ(empty.parts().at(0).content, "x");
+
+    std::size_t saved = config::MAX_MULTIPART_PARTS;
+    config::MAX_MULTIPART_PARTS = 1;
+    multipart_parser too_many("b");
+    EXPECT_FALSE(too_many.feed("--b\r\n\r\nx\r\n--b\r\n\r\ny\r\n--b--"));
+    config::MAX_MULTIPART_PARTS = saved;
+
+    multipart_parser throwing("b", [](const multipart_part&) -> multipart_sink {
+        return [](std::string_view, bool) { throw std::runtime_error("disk full"); };
+    });
+    EXPECT_FALSE(throwing.feed("--b\r\n\r\nx\r\n--b--"));
+}
@@ -0,0 +1,81 @@
+#include "../includes/http_range.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "../includes/http_consts.hpp"
+
+using namespace cppress::http;
+
+TEST(HttpRangeTest, ResolvesTheThreeRangeForms) {
+    std::vector<byte_range> ranges;
+    ASSERT_EQ(parse_range_header("bytes=0-499", 10000, ranges), range_result::partial);
+    ASSERT_EQ(ranges.size(), 1u);
+    EXPECT_EQ(ranges[0].first, 0u);
+    EXPECT_EQ(ranges[0].last, 499u);
+    EXPECT_EQ(ranges[0].size(), 500u);
+
+    ASSERT_EQ(parse_range_header("bytes=9500-", 10000, ranges), range_result::partial);
+    EXPECT_EQ(ranges[0].first, 9500u);
+    EXPECT_EQ(ranges[0].last, 9999u);
+
+    ASSERT_EQ(parse_range_header("bytes=-500", 10000, ranges), range_result::partial);
+    EXPECT_EQ(ranges[0].first, 9500u);
+    EXPECT_EQ(ranges[0].last, 9999u);
+
+    // ends past the representation are clamped, suffixes longer than it take all of it
+    ASSERT_EQ(parse_range_header("bytes=5-100000", 10, ranges), range_result::partial);
+    EXPECT_EQ(ranges[0].last, 9u);
+    ASSERT_EQ(parse_range_header("Bytes = -50", 10, ranges), range_result::partial);
+    EXPECT_EQ(ranges[0].first, 0u);
+}
+
+TEST(HttpRangeTest, SortsAndMergesMultipleRanges) {
+    std::vector<byte_range> ranges;
+    ASSERT_EQ(parse_range_header("bytes=500-599, 0-99,, 90-199, 200-299, 800-", 1000, ranges),
+              range_result::partial);
+    ASSERT_EQ(ranges.size(), 3u);
+    EXPECT_EQ(ranges[0].first, 0u);
+    EXPECT_EQ(ranges[0].last, 299u);  // overlapping and adjacent ranges become one
+    EXPECT_EQ(ranges[1].first, 500u);
+    EXPECT_EQ(ranges[2].first, 800u);
+    EXPECT_EQ(ranges[2].last, 999u);
+}
+
+TEST(HttpRangeTest, IgnoresInvalidHeadersAndReportsUnsatisfiableOnes) {
+    std::vector<byte_range> ranges;
+    EXPECT_EQ(parse_range_header("", 100, ranges), range_result::full);
+    EXPECT_EQ(parse_range_header("items=0-5", 100, ranges), range_result::full);
+    EXPECT_EQ(parse_range_header("bytes=5-1", 100, ranges), range_result::full);
+    EXPECT_EQ(parse_range_header("bytes=a-b", 100, ranges), range_result::full);
+    EXPECT_EQ(parse_range_header("bytes=0-1,junk", 100, ranges), range_result::full);
+    EXPECT_EQ(parse_range_header("bytes=", 100, ranges), range_result::full);
+
+    std::string many = "bytes=0-0";
+    for (std::size_t i = 1; i <= config::MAX_RANGES; ++i)
+        many += "," + std::to_string(i * 2) + "-" + std::to_string(i * 2);
+    EXPECT_EQ(parse_range_header(many, 1000, ranges), range_result::full);
+
+    EXPECT_EQ(parse_range_header("bytes=100-200", 100, ranges), range_result::unsatisfiable);
+    EXPECT_EQ(parse_range_header("bytes=-0", 100, ranges), range_result::unsatisfiable);
+    EXPECT_EQ(parse_range_header("bytes=0-", 0, ranges), range_result::unsatisfiable);
+    // an unsatisfiable range next to a satisfiable one is dropped
+    ASSERT_EQ(parse_range_header("bytes=200-300,0-9", 100, ranges), range_result::partial);
+    EXPECT_EQ(ranges.size(), 1u);
+}
+
+TEST(HttpRangeTest, IfRangeNeedsAStrongMatch) {
+    const char* date = "Tue, 14 May 2024 09:30:00 GMT";
+    EXPECT_TRUE(if_range_matches("", "", ""));
+    EXPECT_TRUE(if_range_matches("\"v1\"", "\"v1\"", ""));
+    EXPECT_FALSE(if_range_matches("\"v1\"", "\"v2\"", date));
+    EXPECT_FALSE(if_range_matches("W/\"v1\"", "W/\"v1\"", ""));
+    EXPECT_FALSE(if_range_matches("\"v1\"", "W/\"v1\"", ""));
+    EXPECT_TRUE(if_range_matches(date, "\"v1\"", date));
+    EXPECT_FALSE(if_range_matches("Wed, 15 May 2024 09:30:00 GMT", "", date));
+    EXPECT_FALSE(if_range_matches(date, "\"v1\"", ""));
+
+    EXPECT_EQ(content_range({0, 499}, 1234), "bytes 0-499/1234");
+}
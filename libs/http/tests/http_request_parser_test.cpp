@@ -538,15 +538,15 @@ TEST(HttpRequestParserTest, InvalidBodyLarge) {
     http_request_parser parser;
     auto conn = make_mock_connection();
 
-    std::string actualBody(1000, 'A');  // 1000 'A's
-
     std::string request =
         "POST /upload HTTP/1.1\r\n"
         "Host: upload.example.com\r\n"
         "Content-Type: text/plain\r\n"
-        "Content-Length: 500\r\n"
+        "Content-Length: " +
+        std::to_string(config::MAX_BODY_SIZE + 1) +
+        "\r\n"
         "\r\n" +
-        actualBody;
+        std::string(1000, 'A');
 
     auto result = parser.parse(conn, cppress::sockets::data_buffer(request));
     auto str = result.to_string();
@@ -554,6 +554,27 @@ TEST(HttpRequestParserTest, InvalidBodyLarge) {
     EXPECT_TRUE(result.is_complete);
 }
 
+TEST(HttpRequestParserTest, BytesPastContentLengthStartTheNextRequest) {
+    http_request_parser parser;
+    auto conn = make_mock_connection();
+
+    std::string request =
+        "POST /upload HTTP/1.1\r\n"
+        "Content-Length: 500\r\n"
+        "\r\n" +
+        std::string(1000, 'A');
+
+    auto result = parser.parse(conn, cppress::sockets::data_buffer(request));
+    EXPECT_TRUE(result.is_complete);
+    EXPECT_EQ(result.body, std::string(500, 'A'));
+    EXPECT_TRUE(result.has_next);
+
+    // the surplus is an unfinished head, not an error
+    auto next = parser.parse_next(conn);
+    EXPECT_FALSE(next.is_complete);
+    EXPECT_FALSE(next.headers_complete);
+}
+
 TEST(HttpRequestParserTest, InvalidRequestSmall) {
     http_request_parser parser;
     auto conn = make_mock_connection();
@@ -583,3 +604,267 @@ TEST(HttpRequestParserTest, InvalidRequestLarge) {
 
     EXPECT_TRUE(result.is_complete);
 }
+
+TEST(HttpRequestParserTest, HeadSplitAcrossReadsIsResumed) {
+    http_request_parser parser;
+    auto conn = make_mock_connection();
+
+    auto first = parser.parse(conn, cppress::sockets::data_buffer(std::string(
+                                        "POST /data HTTP/1.1\r\nHost: exa")));
+    EXPECT_FALSE(first.is_complete);
+    EXPECT_FALSE(first.headers_complete);
+
+    auto second = parser.parse(
+        conn, cppress::sockets::data_buffer(std::string("mple.com\r\nContent-Length: 4\r\n\r\nab")));
+    EXPECT_FALSE(second.is_complete);
+    EXPECT_TRUE(second.headers_complete);
+    EXPECT_EQ(second.headers.get("HOST"), "example.com");
+
+    auto third = parser.parse(conn, cppress::sockets::data_buffer(std::string("cd")));
+    EXPECT_TRUE(third.is_complete);
+    EXPECT_EQ(third.method, "POST");
+    EXPECT_EQ(third.body, "abcd");
+}
+
+TEST(HttpRequestParserTest, PipelinedRequestsAreExtractedInOrder) {
+    http_request_parser parser;
+    auto conn = make_mock_connection();
+
+    auto first = parser.parse(conn, cppress::sockets::data_buffer(std::string(
+                                        "GET /a HTTP/1.1\r\n\r\n"
+                                        "POST /b HTTP/1.1\r\nContent-Length: 3\r\n\r\nxyz"
+                                        "GET /c HTTP/1.1\r\nHo")));
+    ASSERT_TRUE(first.is_complete);
+    EXPECT_EQ(first.uri, "/a");
+    ASSERT_TRUE(first.has_next);
+
+    auto second = parser.parse_next(conn);
+    ASSERT_TRUE(second.is_complete);
+    EXPECT_EQ(second.uri, "/b");
+    EXPECT_EQ(second.body, "xyz");
+    ASSERT_TRUE(second.has_next);
+
+    auto third = parser.parse_next(conn);
+    EXPECT_FALSE(third.headers_complete);
+    EXPECT_FALSE(third.has_next);
+
+    // the cut head resumes with the next read
+    auto fourth = parser.parse(conn, cppress::sockets::data_buffer(std::string("st: x\r\n\r\n")));
+    ASSERT_TRUE(fourth.is_complete);
+    EXPECT_EQ(fourth.uri, "/c");
+    EXPECT_EQ(fourth.headers.get("HOST"), "x");
+    EXPECT_FALSE(fourth.has_next);
+}
+
+TEST(HttpRequestParserTest, ChunkedBodyIsDecodedAcrossReads) {
+    http_request_parser parser;
+    auto conn = make_mock_connection();
+
+    auto first = parser.parse(conn, cppress::sockets::data_buffer(std::string(
+                                        "POST /upload HTTP/1.1\r\n"
+                                        "Transfer-Encoding: chunked\r\n"
+                                        "\r\n"
+                                        "5\r\nhello\r\n6;ext=1\r\n wor")));
+    EXPECT_FALSE(first.is_complete);
+    EXPECT_TRUE(first.headers_complete);
+
+    auto second = parser.parse(conn, cppress::sockets::data_buffer(std::string(
+                                         "ld\r\n0\r\nX-Digest: 42\r\n\r\n"
+                                         "GET /next HTTP/1.1\r\n\r\n")));
+    ASSERT_TRUE(second.is_complete);
+    EXPECT_EQ(second.method, "POST");
+    EXPECT_EQ(second.body, "hello world");
+    EXPECT_EQ(second.headers.get("X-DIGEST"), "42");
+    ASSERT_TRUE(second.has_next);
+
+    auto next = parser.parse_next(conn);
+    EXPECT_TRUE(next.is_complete);
+    EXPECT_EQ(next.uri, "/next");
+}
+
+TEST(HttpRequestParserTest, OnlyAFinalChunkedCodingFramesTheBody) {
+    auto parse = [](const std::string& coding) {
+        http_request_parser parser;
+        auto conn = make_mock_connection();
+        return parser.parse(
+            conn, cppress::sockets::data_buffer("POST /upload HTTP/1.1\r\nTransfer-Encoding: " +
+                                                coding + "\r\n\r\n3\r\nabc\r\n0\r\n\r\n"
+                                                         "GET /smuggled HTTP/1.1\r\n\r\n"));
+    };
+
+    for (const std::string coding : {"chunked", "Chunked", " gzip , CHUNKED "}) {
+        auto result = parse(coding);
+        EXPECT_EQ(result.method, "POST") << coding;
+        EXPECT_EQ(result.body, "abc") << coding;
+        EXPECT_TRUE(result.has_next) << coding;
+    }
+
+    // codings the parser cannot frame are refused, and nothing after them is read
+    for (const std::string coding : {"gzip", "chunked, gzip", "xchunked", "chunked, chunked", ""}) {
+        auto result = parse(coding);
+        EXPECT_EQ(result.method, "BAD_TRANSFER_ENCODING") << coding;
+        EXPECT_FALSE(result.has_next) << coding;
+    }
+
+    http_request_parser parser;
+    auto conn = make_mock_connection();
+    auto split = parser.parse(conn, cppress::sockets::data_buffer(std::string(
+                                        "POST /upload HTTP/1.1\r\nTransfer-Encoding: gzip\r\n"
+                                        "Transfer-Encoding: chunked\r\n\r\n0\r\n\r\n")));
+    EXPECT_EQ(split.method, "POST") << "lines are one list, chunked last";
+}
+
+TEST(HttpRequestParserTest, SelectedBodiesAreStreamedAsTheyArrive) {
+    http_request_parser parser;
+    auto conn = make_mock_connection();
+    std::vector<std::string> pieces;
+    bool ended = false;
+    parser.set_body_stream_selector([&](const http_parse_result& head) -> http_body_stream {
+        if (head.uri != "/stream")
+            return nullptr;
+        return [&](std::string_view piece, bool last) {
+            if (!piece.empty())
+                pieces.emplace_back(piece);
+            ended = ended || last;
+        };
+    });
+
+    auto first = parser.parse(conn, cppress::sockets::data_buffer(std::string(
+                                        "PUT /stream HTTP/1.1\r\nContent-Length: 6\r\n\r\nab")));
+    EXPECT_FALSE(first.is_complete);
+    ASSERT_EQ(pieces.size(), 1u);
+    EXPECT_EQ(pieces[0], "ab");
+
+    auto second = parser.parse(conn, cppress::sockets::data_buffer(std::string("cdef")));
+    ASSERT_TRUE(second.is_complete);
+    EXPECT_TRUE(second.body.empty());
+    ASSERT_EQ(pieces.size(), 2u);
+    EXPECT_EQ(pieces[1], "cdef");
+    EXPECT_TRUE(ended);
+
+    // other routes keep buffering
+    auto other = parser.parse(conn, cppress::sockets::data_buffer(std::string(
+                                        "PUT /other HTTP/1.1\r\nContent-Length: 2\r\n\r\nxy")));
+    ASSERT_TRUE(other.is_complete);
+    EXPECT_EQ(other.body, "xy");
+}
+
+TEST(HttpRequestParserTest, LargeBodiesSpillToAFile) {
+    auto threshold = config::BODY_SPILL_THRESHOLD;
+    config::BODY_SPILL_THRESHOLD = 8;
+    http_request_parser parser;
+    auto conn = make_mock_connection();
+
+    auto announced = parser.parse(
+        conn, cppress::sockets::data_buffer(std::string(
+                  "POST /a HTTP/1.1\r\nContent-Length: 12\r\n\r\nhello spill!")));
+    ASSERT_TRUE(announced.is_complete);
+    EXPECT_TRUE(announced.body.empty());
+    ASSERT_TRUE(announced.body_spool);
+    EXPECT_EQ(announced.body_spool->to_string(), "hello spill!");
+
+    // a chunked body moves to the file when it crosses the threshold
+    auto chunked = parser.parse(
+        conn, cppress::sockets::data_buffer(std::string(
+                  "POST /b HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+                  "5\r\nsmall\r\n7\r\n, then \r\n5\r\nlarge\r\n0\r\n\r\n")));
+    ASSERT_TRUE(chunked.is_complete);
+    ASSERT_TRUE(chunked.body_spool);
+    EXPECT_EQ(chunked.body_spool->size(), 17u);
+    EXPECT_EQ(chunked.body_spool->read(5, 7), ", then ");
+
+    auto small = parser.parse(conn, cppress::sockets::data_buffer(std::string(
+                                        "POST /c HTTP/1.1\r\nContent-Length: 3\r\n\r\nabc")));
+    EXPECT_FALSE(small.body_spool);
+    EXPECT_EQ(small.body, "abc");
+    config::BODY_SPILL_THRESHOLD = threshold;
+}
+
+TEST(HttpRequestParserTest, MultipartBodiesAreParsedAsTheyArrive) {
+    http_request_parser parser;
+    auto conn = make_mock_connection();
+    std::string uploaded;
+    parser.set_multipart_sink_selector([&](const multipart_part& part) -> multipart_sink {
+        if (part.filename.empty())
+            return nullptr;
+        return [&](std::string_view piece, bool) { uploaded.append(piece); };
+    });
+
+    std::string body =
+        "--b\r\nContent-Disposition: form-data; name=\"note\"\r\n\r\nhi\r\n"
+        "--b\r\nContent-Disposition: form-data; name=\"f\"; filename=\"x.bin\"\r\n\r\n"
+        "0123456789\r\n--b--\r\n";
+    std::string head = "POST /upload HTTP/1.1\r\nContent-Type: multipart/form-data; boundary=b\r\n"
+                       "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n";
+
+    std::size_t split = body.find("0123") + 4;
+    auto first = parser.parse(conn, cppress::sockets::data_buffer(head + body.substr(0, split)));
+    EXPECT_FALSE(first.is_complete);
+    EXPECT_EQ(uploaded, "0123");
+
+    auto done = parser.parse(conn, cppress::sockets::data_buffer(body.substr(split)));
+    ASSERT_TRUE(done.is_complete);
+    EXPECT_TRUE(done.body.empty());
+    ASSERT_NE(done.multipart, nullptr);
+    EXPECT_TRUE(done.multipart->complete());
+    EXPECT_EQ(done.multipart->find("note")->content, "hi");
+    EXPECT_EQ(uploaded, "0123456789");
+
+    // other bodies are buffered as usual
+    auto json = parser.parse(conn, cppress::sockets::data_buffer(std::string(
+                                       "POST /api HTTP/1.1\r\nContent-Length: 2\r\n\r\n{}")));
+    ASSERT_TRUE(json.is_complete);
+    EXPECT_EQ(json.body, "{}");
+    EXPECT_EQ(json.multipart, nullptr);
+}
+
+TEST(HttpRequestParserTest, ExpectContinueIsFlaggedBeforeTheBody) {
+    http_request_parser parser;
+    auto conn = make_mock_connection();
+
+    auto waiting = parser.parse(conn, cppress::sockets::data_buffer(std::string(
+                                          "PUT /f HTTP/1.1\r\nExpect: 100-Continue\r\n"
+                                          "Content-Length: 4\r\n\r\n")));
+    EXPECT_FALSE(waiting.is_complete);
+    EXPECT_TRUE(waiting.expects_continue);
+    EXPECT_EQ(waiting.headers.count("EXPECT"), 1);
+
+    auto done = parser.parse(conn, cppress::sockets::data_buffer(std::string("data")));
+    ASSERT_TRUE(done.is_complete);
+    EXPECT_FALSE(done.expects_continue);
+    EXPECT_EQ(done.body, "data");
+
+    // the client did not wait, nothing is left to answer
+    auto whole = parser.parse(conn, cppress::sockets::data_buffer(std::string(
+                                        "PUT /f HTTP/1.1\r\nExpect: 100-continue\r\n"
+                                        "Content-Length: 2\r\n\r\nok")));
+    ASSERT_TRUE(whole.is_complete);
+    EXPECT_FALSE(whole.expects_continue);
+
+    auto chunked = parser.parse(conn, cppress::sockets::data_buffer(std::string(
+                                          "POST /c HTTP/1.1\r\nExpect: 100-continue\r\n"
+                                          "Transfer-Encoding: chunked\r\n\r\n")));
+    EXPECT_FALSE(chunked.is_complete);
+    EXPECT_TRUE(chunked.expects_continue);
+    parser.discard(conn);
+
+    // HTTP/1.0 clients do not understand interim responses
+    auto old = parser.parse(conn, cppress::sockets::data_buffer(std::string(
+                                      "PUT /f HTTP/1.0\r\nExpect: 100-continue\r\n"
+                                      "Content-Length: 4\r\n\r\n")));
+    EXPECT_FALSE(old.is_complete);
+    EXPECT_FALSE(old.expects_continue);
+    parser.discard(conn);
+
+    // the whole value is the expectation, not a substring of it
+    auto padded = parser.parse(conn, cppress::sockets::data_buffer(std::string(
+                                         "PUT /f HTTP/1.1\r\nExpect:   100-CONTINUE  \r\n"
+                                         "Content-Length: 4\r\n\r\n")));
+    EXPECT_TRUE(padded.expects_continue);
+    parser.discard(conn);
+
+    auto other = parser.parse(conn, cppress::sockets::data_buffer(std::string(
+                                        "PUT /f HTTP/1.1\r\nExpect: 100-continued\r\n"
+                                        "Content-Length: 4\r\n\r\n")));
+    EXPECT_FALSE(other.expects_continue);
+}
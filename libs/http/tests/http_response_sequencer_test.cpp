@@ -0,0 +1,58 @@
+#include "../includes/http_response_sequencer.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+using namespace cppress::http;
+
+namespace {
+struct recording_connection {
+    std::string wire;
+    bool closed = false;
+
+    http_response_sequencer make() {
+        return http_response_sequencer(
+            [this](std::vector<cppress::sockets::output_segment>&& parts) {
+                for (auto& part : parts)
+                    wire += part.is_file() ? part.file.read() : part.memory.to_string();
+            },
+            [this]() { closed = true; });
+    }
+};
+}  // namespace
+
+TEST(HttpResponseSequencerTest, LaterResponsesWaitForEarlierOnes) {
+    recording_connection conn;
+    auto sequencer = conn.make();
+    auto first = sequencer.open();
+    auto second = sequencer.open();
+    auto third = sequencer.open();
+
+    sequencer.write(third, {"C"}, true);
+    sequencer.write(second, {"B1"}, false);
+    EXPECT_EQ(conn.wire, "");
+
+    sequencer.write(first, {"A"}, true);
+    EXPECT_EQ(conn.wire, "AB1");  // the streamed second response is now at the front
+
+    sequencer.write(second, {"B2"}, true);
+    EXPECT_EQ(conn.wire, "AB1B2C");
+}
+
+TEST(HttpResponseSequencerTest, CloseWaitsForTheStreamAndDropsLaterResponses) {
+    recording_connection conn;
+    auto sequencer = conn.make();
+    auto first = sequencer.open();
+    auto second = sequencer.open();
+
+    sequencer.write(first, {"head"}, false);
+    sequencer.close(first);
+    sequencer.write(second, {"never"}, true);
+    EXPECT_FALSE(conn.closed);
+
+    sequencer.write(first, {"-end"}, true);
+    EXPECT_TRUE(conn.closed);
+    EXPECT_EQ(conn.wire, "head-end");
+}
@@ -0,0 +1,58 @@
+#include "../includes/http_scan.hpp"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace cppress::http;
+
+namespace {
+/// Restores the best scan implementation when a test ends
+struct scan_level_guard {
+    ~scan_level_guard() { scan::use(scan::best()); }
+};
+}  // namespace
+
+TEST(HttpScanTest, EveryLevelFindsTheSameStops) {
+    scan_level_guard guard;
+    std::mt19937 rng(42);
+    // mostly header-like printable bytes with sparse delimiters and controls
+    const std::string alphabet =
+        "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789-_.~|!*";
+    std::vector<std::string> inputs;
+    for (int round = 0; round < 300; ++round) {
+        std::string s(1 + rng() % 200, 'x');
+        for (auto& ch : s)
+            ch = alphabet[rng() % alphabet.size()];
+        for (int k = 0; k < 2; ++k)
+            s[rng() % s.size()] = static_cast<char>(rng() % 256);
+        inputs.push_back(s);
+    }
+
+    std::vector<scan::level> levels = {scan::level::scalar, scan::level::sse42, scan::level::avx2,
+                                       scan::level::neon};
+    for (const auto& s : inputs) {
+        for (std::size_t from : {std::size_t(0), s.size() / 3}) {
+            ASSERT_TRUE(scan::use(scan::level::scalar));
+            auto token = scan::token_end(s.data(), from, s.size());
+            auto target = scan::target_end(s.data(), from, s.size());
+            auto value = scan::value_end(s.data(), from, s.size());
+            for (auto l : levels) {
+                if (!scan::use(l))
+                    continue;
+                EXPECT_EQ(scan::token_end(s.data(), from, s.size()), token) << scan::name(l);
+                EXPECT_EQ(scan::target_end(s.data(), from, s.size()), target) << scan::name(l);
+                EXPECT_EQ(scan::value_end(s.data(), from, s.size()), value) << scan::name(l);
+            }
+        }
+    }
+}
+
+TEST(HttpScanTest, StopsAtTheClassBoundaries) {
+    std::string line = "Accept-Language: en-US,en;q=0.9\tx\r\n";
+    EXPECT_EQ(scan::token_end(line.data(), 0, line.size()), line.find(':'));
+    EXPECT_EQ(scan::target_end(line.data(), 0, line.size()), line.find(' '));
+    EXPECT_EQ(scan::value_end(line.data(), 17, line.size()), line.find('\r'));  // tab is allowed
+}
@@ -1,6 +1,9 @@
 #include <gtest/gtest.h>
 
 #include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
 #include <iostream>
 #include <memory>
 #include <string>
@@ -598,4 +601,613 @@ TEST(HttpServerTest, ConnectionReuseForSameRequest) {
 
     server.shutdown();
     server_thread.join();
-}
\ No newline at end of file
+}
+TEST(HttpServerTest, PipelinedResponsesKeepRequestOrder) {
+    cppress::http::http_server server(9982);
+
+    server.set_request_callback(
+        [&](cppress::http::http_request& req, cppress::http::http_response& res) {
+            auto response = std::make_shared<cppress::http::http_response>(std::move(res));
+            response->set_status(200, "OK");
+            response->set_body("body of " + req.get_uri());
+            response->add_header("Content-Length", std::to_string(response->get_body().size()));
+            if (req.get_uri() != "/slow") {
+                response->send();
+                return;
+            }
+            // the first request finishes last
+            std::thread([response]() {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                response->send();
+            }).detach();
+        });
+
+    std::thread server_thread([&server]() { server.listen(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    cppress::sockets::connection conn;
+    conn.connect(cppress::sockets::socket_address(port(9982), ip_address("127.0.0.1")));
+    conn.write(data_buffer("GET /slow HTTP/1.1\r\nHost: localhost\r\n\r\n"
+                           "GET /fast HTTP/1.1\r\nHost: localhost\r\n\r\n"
+                           "GET /last HTTP/1.1\r\nHost: localhost\r\n\r\n"));
+    std::string responses;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(3);
+    while (responses.find("body of /last") == std::string::npos &&
+           std::chrono::steady_clock::now() < deadline)
+        responses += conn.read().to_string();
+
+    auto slow = responses.find("body of /slow");
+    auto fast = responses.find("body of /fast");
+    auto last = responses.find("body of /last");
+    ASSERT_NE(slow, std::string::npos);
+    ASSERT_NE(fast, std::string::npos);
+    ASSERT_NE(last, std::string::npos);
+    EXPECT_LT(slow, fast);
+    EXPECT_LT(fast, last);
+
+    server.shutdown();
+    server_thread.join();
+}
+
+TEST(HttpServerTest, StreamedResponseIsChunkedAndKeepsItsPlace) {
+    cppress::http::http_server server(9981);
+
+    server.set_request_callback(
+        [&](cppress::http::http_request& req, cppress::http::http_response& res) {
+            auto response = std::make_shared<cppress::http::http_response>(std::move(res));
+            if (req.get_uri() != "/report") {
+                response->set_body("after");
+                response->add_header("Content-Length", "5");
+                response->send();
+                return;
+            }
+            // headers now, the rows later from another thread
+            response->add_trailer("X-Rows", "2");
+            response->begin_stream();
+            std::thread([response]() {
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                response->write_chunk("row one\n");
+                response->write_chunk("row two\n");
+                response->end_stream();
+            }).detach();
+        });
+
+    std::thread server_thread([&server]() { server.listen(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    cppress::sockets::connection conn;
+    conn.connect(cppress::sockets::socket_address(port(9981), ip_address("127.0.0.1")));
+    conn.write(data_buffer("GET /report HTTP/1.1\r\nHost: localhost\r\n\r\n"
+                           "GET /next HTTP/1.1\r\nHost: localhost\r\n\r\n"));
+    std::string wire;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(3);
+    while (wire.find("after") == std::string::npos && std::chrono::steady_clock::now() < deadline)
+        wire += conn.read().to_string();
+
+    EXPECT_NE(wire.find("TRANSFER-ENCODING: chunked\r\n"), std::string::npos);
+    EXPECT_NE(wire.find("TRAILER: X-ROWS\r\n"), std::string::npos);
+    auto body = wire.find("8\r\nrow one\n\r\n8\r\nrow two\n\r\n0\r\nX-ROWS: 2\r\n\r\n");
+    ASSERT_NE(body, std::string::npos);
+    EXPECT_LT(body, wire.find("after"));
+
+    server.shutdown();
+    server_thread.join();
+}
+
+TEST(HttpServerTest, StalledHeadersAndBodiesHitTheirDeadlines) {
+    auto saved_header = cppress::http::config::MAX_HEADER_READ_TIME_SECONDS;
+    auto saved_body = cppress::http::config::MAX_BODY_READ_TIME_SECONDS;
+    cppress::http::config::MAX_HEADER_READ_TIME_SECONDS = std::chrono::seconds(1);
+    cppress::http::config::MAX_BODY_READ_TIME_SECONDS = std::chrono::seconds(1);
+
+    int server_port = get_random_free_port().value();
+    cppress::http::http_server server(server_port, "127.0.0.1");
+    std::atomic<int> requests{0};
+    server.set_request_callback(
+        [&requests](cppress::http::http_request&, cppress::http::http_response& res) {
+            requests++;
+            res.end();
+        });
+    std::thread server_thread([&server]() { server.listen(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    auto addr = cppress::sockets::socket_address(port(server_port), ip_address("127.0.0.1"));
+    auto start = std::chrono::steady_clock::now();
+
+    // never sends a byte
+    cppress::sockets::connection silent;
+    silent.connect(addr);
+
+    // sends the headers and part of the body, then stalls
+    cppress::sockets::connection slow_body;
+    slow_body.connect(addr);
+    slow_body.write(data_buffer(
+        "POST /upload HTTP/1.1\r\nHost: localhost\r\nContent-Length: 100\r\n\r\npartial"));
+
+    EXPECT_TRUE(silent.read().empty());
+    EXPECT_TRUE(slow_body.read().empty());
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(4));
+    EXPECT_EQ(requests.load(), 0);
+
+    server.shutdown();
+    server_thread.join();
+    cppress::http::config::MAX_HEADER_READ_TIME_SECONDS = saved_header;
+    cppress::http::config::MAX_BODY_READ_TIME_SECONDS = saved_body;
+}
+
+TEST(HttpServerTest, ExpectContinueIsAnsweredBeforeTheBody) {
+    int server_port = get_random_free_port().value();
+    cppress::http::http_server server(server_port, "127.0.0.1");
+    server.set_expect_continue_callback(
+        [](cppress::http::http_request& req, cppress::http::http_response& res) {
+            if (req.get_uri() == "/upload")
+                return true;
+            res.set_status(401, "Unauthorized");
+            res.add_header("Content-Length", "0");
+            res.add_header("Connection", "close");
+            res.send();
+            return false;
+        });
+    std::atomic<int> requests{0};
+    server.set_request_callback(
+        [&requests](cppress::http::http_request& req, cppress::http::http_response& res) {
+            requests++;
+            res.set_status(200, "OK");
+            res.set_body("got " + req.get_body());
+            res.add_header("Content-Length", std::to_string(res.get_body().size()));
+            res.send();
+        });
+    std::thread server_thread([&server]() { server.listen(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    auto addr = cppress::sockets::socket_address(port(server_port), ip_address("127.0.0.1"));
+
+    auto read_until = [](cppress::sockets::connection& conn, const std::string& marker) {
+        std::string wire;
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(3);
+        while (wire.find(marker) == std::string::npos &&
+               std::chrono::steady_clock::now() < deadline) {
+            auto data = conn.read();
+            if (data.empty())
+                break;
+            wire += data.to_string();
+        }
+        return wire;
+    };
+
+    // accepted: the interim 100 comes before the body is sent
+    cppress::sockets::connection accepted;
+    accepted.connect(addr);
+    accepted.write(data_buffer("POST /upload HTTP/1.1\r\nHost: localhost\r\n"
+                               "Expect: 100-continue\r\nContent-Length: 5\r\n\r\n"));
+    EXPECT_EQ(read_until(accepted, "\r\n\r\n"), "HTTP/1.1 100 Continue\r\n\r\n");
+    accepted.write(data_buffer("hello"));
+    std::string wire = read_until(accepted, "got hello");
+    EXPECT_EQ(wire.rfind("HTTP/1.1 200 OK\r\n", 0), 0u);
+    EXPECT_NE(wire.find("got hello"), std::string::npos);
+
+    // refused: the final answer arrives without the body and the connection closes
+    cppress::sockets::connection refused;
+    refused.connect(addr);
+    refused.write(data_buffer("PUT /private HTTP/1.1\r\nHost: localhost\r\n"
+                              "Expect: 100-continue\r\nContent-Length: 1048576\r\n\r\n"));
+    wire = read_until(refused, "\r\n\r\n");
+    EXPECT_EQ(wire.rfind("HTTP/1.1 401 Unauthorized\r\n", 0), 0u);
+    EXPECT_TRUE(refused.read().empty());
+    EXPECT_EQ(requests.load(), 1);
+
+    server.shutdown();
+    server_thread.join();
+}
+
+TEST(HttpServerTest, EventStreamBroadcastReachesEverySubscriber) {
+    int server_port = get_random_free_port().value();
+    cppress::http::http_server server(server_port, "127.0.0.1");
+    cppress::http::sse_channel channel;
+    server.set_request_callback(
+        [&channel](cppress::http::http_request&, cppress::http::http_response& res) {
+            channel.subscribe(res.begin_event_stream());
+        });
+    std::thread server_thread([&server]() { server.listen(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    auto addr = cppress::sockets::socket_address(port(server_port), ip_address("127.0.0.1"));
+
+    auto read_until = [](cppress::sockets::connection& conn, std::string& wire,
+                         const std::string& marker) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(3);
+        while (wire.find(marker) == std::string::npos &&
+               std::chrono::steady_clock::now() < deadline) {
+            auto data = conn.read();
+            if (data.empty())
+                break;
+            wire += data.to_string();
+        }
+    };
+
+    cppress::sockets::connection first, second;
+    std::string first_wire, second_wire;
+    for (auto* conn : {&first, &second}) {
+        conn->connect(addr);
+        conn->write(data_buffer("GET /events HTTP/1.1\r\nHost: localhost\r\n\r\n"));
+    }
+    read_until(first, first_wire, "\r\n\r\n");
+    read_until(second, second_wire, "\r\n\r\n");
+    EXPECT_NE(first_wire.find("CONTENT-TYPE: text/event-stream"), std::string::npos);
+    EXPECT_NE(first_wire.find("TRANSFER-ENCODING: chunked"), std::string::npos);
+    ASSERT_EQ(channel.size(), 2u);
+
+    EXPECT_EQ(channel.publish({"1", "tick", "42"}), 2u);
+    read_until(first, first_wire, "data: 42\n\n\r\n");
+    read_until(second, second_wire, "data: 42\n\n\r\n");
+    const std::string chunk = "1c\r\nid: 1\nevent: tick\ndata: 42\n\n\r\n";
+    EXPECT_NE(first_wire.find(chunk), std::string::npos);
+    EXPECT_NE(second_wire.find(chunk), std::string::npos);
+
+    // a subscriber that went away is pruned by a later publish
+    second.close();
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(3);
+    while (channel.size() != 1 && std::chrono::steady_clock::now() < deadline) {
+        channel.publish({"", "", "ping"});
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    EXPECT_EQ(channel.size(), 1u);
+
+    channel.close_all();
+    read_until(first, first_wire, "0\r\n\r\n");
+    EXPECT_EQ(first_wire.substr(first_wire.size() - 5), "0\r\n\r\n");
+
+    server.shutdown();
+    server_thread.join();
+}
+
+TEST(HttpServerTest, WebSocketUpgradeEchoesOnTheSameConnection) {
+    int server_port = get_random_free_port().value();
+    cppress::http::http_server server(server_port, "127.0.0.1");
+    auto echo = std::make_shared<cppress::http::websocket_handler>();
+    echo->on_message = [](const std::shared_ptr<cppress::http::websocket_connection>& ws,
+                          cppress::http::websocket_message&& message) {
+        ws->send_text("echo: " + message.data);
+    };
+    server.set_websocket_selector([echo](const cppress::http::http_parse_result& head) {
+        return head.uri == "/ws" ? echo : nullptr;
+    });
+    std::atomic<int> requests{0};
+    server.set_request_callback(
+        [&requests](cppress::http::http_request&, cppress::http::http_response& res) {
+            requests++;
+            res.set_status(404, "Not Found");
+            res.add_header("Content-Length", "0");
+            res.send();
+        });
+    std::thread server_thread([&server]() { server.listen(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    auto addr = cppress::sockets::socket_address(port(server_port), ip_address("127.0.0.1"));
+
+    auto read_until = [](cppress::sockets::connection& conn, std::string& wire,
+                         const std::string& marker) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(3);
+        while (wire.find(marker) == std::string::npos &&
+               std::chrono::steady_clock::now() < deadline) {
+            auto data = conn.read();
+            if (data.empty())
+                break;
+            wire += data.to_string();
+        }
+    };
+    const std::string handshake =
+        " HTTP/1.1\r\nHost: localhost\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+        "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n";
+
+    cppress::sockets::connection client;
+    client.connect(addr);
+    client.write(data_buffer("GET /ws" + handshake));
+    std::string wire;
+    read_until(client, wire, "\r\n\r\n");
+    EXPECT_EQ(wire.rfind("HTTP/1.1 101 Switching Protocols\r\n", 0), 0u);
+    EXPECT_NE(wire.find("Sec-WebSocket-Accept: s3pPLMBiTxaQ9kYGzzhZRbK+xOo=\r\n"),
+              std::string::npos);
+
+    // a masked text frame "hi"
+    const std::array<std::uint8_t, 4> key = {1, 2, 3, 4};
+    std::string frame = "\x81\x82";
+    frame.append(key.begin(), key.end());
+    frame += std::string{static_cast<char>('h' ^ 1), static_cast<char>('i' ^ 2)};
+    client.write(data_buffer(frame));
+    wire.clear();
+    read_until(client, wire, "echo: hi");
+    EXPECT_EQ(wire, std::string("\x81\x08") + "echo: hi");
+
+    // an endpoint the selector does not take is plain HTTP
+    cppress::sockets::connection other;
+    other.connect(addr);
+    other.write(data_buffer("GET /nope" + handshake));
+    wire.clear();
+    read_until(other, wire, "\r\n\r\n");
+    EXPECT_EQ(wire.rfind("HTTP/1.1 404 Not Found\r\n", 0), 0u);
+    EXPECT_EQ(requests.load(), 1);
+
+    server.shutdown();
+    server_thread.join();
+}
+
+#if CPPRESS_HAS_ZLIB
+TEST(HttpServerTest, CompressedResponsesCarryTheirEncoding) {
+    cppress::http::http_server server(9980);
+    const std::string json(4096, '7');
+
+    server.set_request_callback(
+        [&](cppress::http::http_request& req, cppress::http::http_response& res) {
+            res.set_compression(cppress::http::negotiate_content_coding(
+                                    req.get_header_fields(), {cppress::http::content_coding::gzip}),
+                                cppress::http::DEFAULT_COMPRESSION_LEVEL, 1024);
+            res.add_header("Content-Type", "application/json");
+            if (req.get_uri() == "/stream") {
+                res.begin_stream();
+                res.write_chunk(json);
+                res.end_stream();
+                return;
+            }
+            res.add_header("ETag", "\"v1\"");
+            res.add_header("Content-Length", std::to_string(json.size()));
+            res.set_body(json);
+            res.send();
+        });
+
+    std::thread server_thread([&server]() { server.listen(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    auto fetch = [](const std::string& request, const std::string& until) {
+        cppress::sockets::connection conn;
+        conn.connect(cppress::sockets::socket_address(port(9980), ip_address("127.0.0.1")));
+        conn.write(data_buffer(request));
+        std::string wire;
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(3);
+        while (wire.find(until) == std::string::npos && std::chrono::steady_clock::now() < deadline)
+            wire += conn.read().to_string();
+        return wire;
+    };
+
+    std::string whole =
+        fetch("GET /json HTTP/1.1\r\nHost: localhost\r\nAccept-Encoding: gzip\r\n\r\n", "\r\n\r\n");
+    EXPECT_NE(whole.find("CONTENT-ENCODING: gzip\r\n"), std::string::npos);
+    EXPECT_NE(whole.find("VARY: Accept-Encoding\r\n"), std::string::npos);
+    EXPECT_NE(whole.find("ETAG: W/\"v1\"\r\n"), std::string::npos);
+    EXPECT_EQ(whole.find("CONTENT-LENGTH: 4096\r\n"), std::string::npos);
+
+    std::string plain = fetch("GET /json HTTP/1.1\r\nHost: localhost\r\n\r\n", json);
+    EXPECT_EQ(plain.find("CONTENT-ENCODING"), std::string::npos);
+    EXPECT_NE(plain.find(json), std::string::npos);
+
+    std::string streamed = fetch(
+        "GET /stream HTTP/1.1\r\nHost: localhost\r\nAccept-Encoding: gzip\r\n\r\n", "0\r\n\r\n");
+    EXPECT_NE(streamed.find("TRANSFER-ENCODING: chunked\r\n"), std::string::npos);
+    EXPECT_NE(streamed.find("CONTENT-ENCODING: gzip\r\n"), std::string::npos);
+    EXPECT_EQ(streamed.find(json), std::string::npos);
+
+    server.shutdown();
+    server_thread.join();
+}
+#endif
+
+TEST(HttpServerTest, Http2StreamsAreAnsweredOnOneConnection) {
+    using namespace cppress::http;
+    http_server server(9981);
+    server.set_request_callback([](http_request& req, http_response& res) {
+        std::string body = req.get_method() + " " + req.get_uri() + " " + req.get_version();
+        res.set_status(200, "OK");
+        res.add_header("Content-Length", std::to_string(body.size()));
+        res.set_body(body);
+        res.send();
+        res.end();
+    });
+
+    std::thread server_thread([&server]() { server.listen(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    auto frame = [](http2_frame_type type, std::uint8_t flags, std::uint32_t id,
+                    const std::string& payload) {
+        std::string out;
+        for (int shift = 16; shift >= 0; shift -= 8)
+            out.push_back(static_cast<char>(payload.size() >> shift));
+        out.push_back(static_cast<char>(type));
+        out.push_back(static_cast<char>(flags));
+        for (int shift = 24; shift >= 0; shift -= 8)
+            out.push_back(static_cast<char>(id >> shift));
+        return out + payload;
+    };
+    hpack_encoder encoder;
+    auto request = [&encoder](const std::string& path) {
+        std::string block;
+        encoder.begin_block(block);
+        encoder.encode(":method", "GET", block);
+        encoder.encode(":scheme", "http", block);
+        encoder.encode(":path", path, block);
+        encoder.encode(":authority", "localhost", block);
+        return block;
+    };
+    auto read_until = [](cppress::sockets::connection& conn, const std::string& until) {
+        std::string wire;
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(3);
+        while (wire.find(until) == std::string::npos && std::chrono::steady_clock::now() < deadline)
+            wire += conn.read().to_string();
+        return wire;
+    };
+
+    // prior knowledge: two streams in one write
+    {
+        cppress::sockets::connection conn;
+        conn.connect(cppress::sockets::socket_address(port(9981), ip_address("127.0.0.1")));
+        std::string first = request("/a");
+        std::string second = request("/b");
+        conn.write(data_buffer(std::string(HTTP2_PREFACE) +
+                               frame(http2_frame_type::settings, 0, 0, "") +
+                               frame(http2_frame_type::headers, 0x5, 1, first) +
+                               frame(http2_frame_type::headers, 0x5, 3, second)));
+        std::string wire = read_until(conn, "GET /b HTTP/2");
+        EXPECT_NE(wire.find("GET /a HTTP/2"), std::string::npos);
+        EXPECT_NE(wire.find("GET /b HTTP/2"), std::string::npos);
+    }
+
+    // h2c upgrade: the request is answered as stream 1 after the 101
+    {
+        cppress::sockets::connection conn;
+        conn.connect(cppress::sockets::socket_address(port(9981), ip_address("127.0.0.1")));
+        conn.write(data_buffer(std::string(
+            "GET /up HTTP/1.1\r\nHost: localhost\r\nConnection: Upgrade, HTTP2-Settings\r\n"
+            "Upgrade: h2c\r\nHTTP2-Settings: AAMAAABkAAQAAP__\r\n\r\n")));
+        std::string wire = read_until(conn, "GET /up HTTP/2");
+        EXPECT_EQ(wire.rfind("HTTP/1.1 101 Switching Protocols\r\n", 0), 0u);
+        EXPECT_NE(wire.find("GET /up HTTP/2"), std::string::npos);
+    }
+
+    server.shutdown();
+    server_thread.join();
+}
+
+TEST(HttpServerTest, FileRangesAreServedAsPartialContent) {
+    using namespace cppress::http;
+    std::string path = "/tmp/cppress_range_test.bin";
+    std::string content;
+    for (int i = 0; i < 1000; ++i)
+        content += static_cast<char>('a' + i % 26);
+    {
+        std::ofstream file(path, std::ios::binary);
+        file << content;
+    }
+
+    http_server server(9982);
+    server.set_request_callback([&path](http_request& req, http_response& res) {
+        res.add_header("Content-Type", "application/octet-stream");
+        res.add_header("ETag", "\"v1\"");
+        res.send_file(cppress::sockets::file_region::open(path), req.get_header_fields());
+    });
+
+    std::thread server_thread([&server]() { server.listen(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    auto fetch = [](const std::string& headers, const std::string& until) {
+        cppress::sockets::connection conn;
+        conn.connect(cppress::sockets::socket_address(port(9982), ip_address("127.0.0.1")));
+        conn.write(data_buffer("GET /file HTTP/1.1\r\nHost: localhost\r\n" + headers + "\r\n"));
+        std::string wire;
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(3);
+        while (wire.find(until) == std::string::npos && std::chrono::steady_clock::now() < deadline)
+            wire += conn.read().to_string();
+        return wire;
+    };
+
+    std::string single = fetch("Range: bytes=10-19\r\n", content.substr(10, 10));
+    EXPECT_EQ(single.rfind("HTTP/1.1 206 Partial Content\r\n", 0), 0u);
+    EXPECT_NE(single.find("CONTENT-RANGE: bytes 10-19/1000\r\n"), std::string::npos);
+    EXPECT_NE(single.find("CONTENT-LENGTH: 10\r\n"), std::string::npos);
+    EXPECT_EQ(single.substr(single.find("\r\n\r\n") + 4), content.substr(10, 10));
+
+    std::string multi = fetch("Range: bytes=0-4, -5\r\n", "--\r\n");
+    EXPECT_NE(multi.find("CONTENT-TYPE: multipart/byteranges; boundary="), std::string::npos);
+    EXPECT_NE(multi.find("Content-Type: application/octet-stream\r\n"
+                         "Content-Range: bytes 0-4/1000\r\n\r\n" +
+                         content.substr(0, 5)),
+              std::string::npos);
+    EXPECT_NE(multi.find("Content-Range: bytes 995-999/1000\r\n\r\n" + content.substr(995)),
+              std::string::npos);
+
+    std::string stale = fetch("Range: bytes=0-4\r\nIf-Range: \"v0\"\r\n", content.substr(990));
+    EXPECT_EQ(stale.rfind("HTTP/1.1 200 OK\r\n", 0), 0u);
+    EXPECT_NE(stale.find("ACCEPT-RANGES: bytes\r\n"), std::string::npos);
+    EXPECT_NE(stale.find(content), std::string::npos);
+
+    std::string unsatisfiable = fetch("Range: bytes=5000-\r\n", "\r\n\r\n");
+    EXPECT_EQ(unsatisfiable.rfind("HTTP/1.1 416 Range Not Satisfiable\r\n", 0), 0u);
+    EXPECT_NE(unsatisfiable.find("CONTENT-RANGE: bytes */1000\r\n"), std::string::npos);
+
+    server.shutdown();
+    server_thread.join();
+    std::remove(path.c_str());
+}
+
+TEST(HttpServerTest, SharedBufferBodiesAreSentWithTheirLength) {
+    using namespace cppress::http;
+    const data_buffer shared(std::string(5000, 's'));
+    http_server server(9979);
+    server.set_request_callback([&shared](http_request&, http_response& res) {
+        res.add_header("Content-Type", "text/plain");
+        res.add_header("ETag", "\"v1\"");
+        res.send_buffer(shared);
+    });
+
+    std::thread server_thread([&server]() { server.listen(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    auto fetch = [](const std::string& headers, std::size_t bytes) {
+        cppress::sockets::connection conn;
+        conn.connect(cppress::sockets::socket_address(port(9979), ip_address("127.0.0.1")));
+        conn.write(data_buffer("GET / HTTP/1.1\r\nHost: localhost\r\n" + headers + "\r\n"));
+        std::string wire;
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(3);
+        while (wire.size() < bytes && std::chrono::steady_clock::now() < deadline)
+            wire += conn.read().to_string();
+        return wire;
+    };
+
+    std::string full = fetch("", 5000);
+    EXPECT_EQ(full.rfind("HTTP/1.1 200 OK\r\n", 0), 0u);
+    EXPECT_NE(full.find("CONTENT-LENGTH: 5000\r\n"), std::string::npos);
+    EXPECT_EQ(full.substr(full.find("\r\n\r\n") + 4), shared.to_string());
+
+    std::string cached = fetch("If-None-Match: \"v1\"\r\n", 1);
+    EXPECT_EQ(cached.rfind("HTTP/1.1 304 Not Modified\r\n", 0), 0u);
+    EXPECT_EQ(cached.find("CONTENT-LENGTH"), std::string::npos);
+
+    server.shutdown();
+    server_thread.join();
+}
+
+TEST(HttpServerTest, MatchingValidatorsAreAnsweredWithNotModified) {
+    using namespace cppress::http;
+    http_server server(9983);
+    server.set_request_callback([](http_request&, http_response& res) {
+        res.add_header("Content-Type", "text/plain");
+        res.add_header("ETag", "\"v1\"");
+        res.add_header("Last-Modified", "Sun, 06 Nov 1994 08:49:37 GMT");
+        res.set_body("representation");
+        res.add_header("Content-Length", "14");
+        res.send();
+    });
+
+    std::thread server_thread([&server]() { server.listen(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    auto fetch = [](const std::string& request) {
+        cppress::sockets::connection conn;
+        conn.connect(cppress::sockets::socket_address(port(9983), ip_address("127.0.0.1")));
+        conn.write(data_buffer(request));
+        std::string wire;
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(3);
+        while (wire.find("\r\n\r\n") == std::string::npos &&
+               std::chrono::steady_clock::now() < deadline)
+            wire += conn.read().to_string();
+        return wire;
+    };
+
+    std::string cached = fetch("GET / HTTP/1.1\r\nHost: localhost\r\nIf-None-Match: W/\"v1\"\r\n\r\n");
+    EXPECT_EQ(cached.rfind("HTTP/1.1 304 Not Modified\r\n", 0), 0u);
+    EXPECT_NE(cached.find("ETAG: \"v1\"\r\n"), std::string::npos);
+    EXPECT_EQ(cached.find("CONTENT-LENGTH"), std::string::npos);
+    EXPECT_EQ(cached.substr(cached.find("\r\n\r\n") + 4), "");
+
+    std::string dated = fetch(
+        "GET / HTTP/1.1\r\nHost: localhost\r\n"
+        "If-Modified-Since: Sun, 06 Nov 1994 08:49:37 GMT\r\n\r\n");
+    EXPECT_EQ(dated.rfind("HTTP/1.1 304 Not Modified\r\n", 0), 0u);
+
+    std::string stale = fetch("GET / HTTP/1.1\r\nHost: localhost\r\nIf-None-Match: \"v0\"\r\n\r\n");
+    EXPECT_EQ(stale.rfind("HTTP/1.1 200 OK\r\n", 0), 0u);
+
+    // only GET and HEAD are conditional on these headers
+    std::string post = fetch(
+        "POST / HTTP/1.1\r\nHost: localhost\r\nContent-Length: 0\r\n"
+        "If-None-Match: \"v1\"\r\n\r\n");
+    EXPECT_EQ(post.rfind("HTTP/1.1 200 OK\r\n", 0), 0u);
+
+    server.shutdown();
+    server_thread.join();
+}
@@ -0,0 +1,44 @@
+#include <gtest/gtest.h>
+
+#include <array>
+#include <string_view>
+
+#include "shared/includes/perfect_hash.hpp"
+#include "shared/includes/utils.hpp"
+
+using namespace cppress::shared;
+
+TEST(SharedTablesTest, BuiltInTablesAreLookedUpThroughCompileTimeHashes) {
+    static constexpr std::array<std::string_view, 3> names = {"get", "head", "post"};
+    constexpr perfect_hash<3, true> methods(names);
+    static_assert(methods.find("HEAD") == 1);
+    static_assert(methods.find("PUT") == methods.NONE);
+
+    EXPECT_EQ(get_mime_type_from_extension("css"), "text/css");
+    EXPECT_EQ(get_mime_type_from_extension("nope"), "application/octet-stream");
+    EXPECT_EQ(get_file_extension_from_mime("text/html"), "htm");
+    EXPECT_TRUE(is_static_extension("woff2"));
+    EXPECT_FALSE(unknown_method("OPTIONS"));
+    EXPECT_TRUE(unknown_method("get"));
+}
+
+// the overlays cannot be taken back, so only names no other test uses are added
+TEST(SharedTablesTest, RuntimeAdditionsGoOverTheBuiltInTables) {
+    EXPECT_TRUE(unknown_method("XTABLESTEST"));
+    add_method("XTABLESTEST");
+    EXPECT_FALSE(unknown_method("XTABLESTEST"));
+
+    EXPECT_FALSE(is_static_extension("xtablestest"));
+    add_static_extension("xtablestest");
+    EXPECT_TRUE(is_static_extension("xtablestest"));
+
+    add_mime_type("xtablestest", "application/x-tables-test");
+    EXPECT_EQ(get_mime_type_from_extension("xtablestest"), "application/x-tables-test");
+    EXPECT_EQ(get_file_extension_from_mime("application/x-tables-test"), "xtablestest");
+
+    // a built-in extension is mapped anew, then back to its own type
+    add_mime_type("sketch", "application/x-tables-test-sketch");
+    EXPECT_EQ(get_mime_type_from_extension("sketch"), "application/x-tables-test-sketch");
+    add_mime_type("sketch", "application/x-sketch");
+    EXPECT_EQ(get_mime_type_from_extension("sketch"), "application/x-sketch");
+}
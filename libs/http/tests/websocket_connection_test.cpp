@@ -0,0 +1,284 @@
+#include "../includes/websocket_connection.hpp"
+#include "../includes/http_consts.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#ifndef CPPRESS_HAS_ZLIB
+#define CPPRESS_HAS_ZLIB 0
+#endif
+
+using namespace cppress::http;
+
+namespace {
+const std::array<std::uint8_t, 4> KEY = {0x37, 0xfa, 0x21, 0x3d};
+
+/// A frame as a client sends it, masked with KEY
+std::string client_frame(websocket_opcode opcode, std::string_view payload, bool fin = true,
+                         bool compressed = false) {
+    std::string out = websocket_frame_header(opcode, payload.size(), fin, compressed);
+    out[1] = static_cast<char>(out[1] | 0x80);
+    out.append(KEY.begin(), KEY.end());
+    std::string masked(payload.size(), '\0');
+    websocket_mask(masked.data(), payload.data(), payload.size(), KEY);
+    return out + masked;
+}
+
+struct parsed_frame {
+    std::uint8_t first;
+    std::string payload;
+};
+
+/// Splits server output into frames; server frames are never masked
+std::vector<parsed_frame> server_frames(const std::string& wire) {
+    std::vector<parsed_frame> frames;
+    std::size_t pos = 0;
+    while (pos + 2 <= wire.size()) {
+        std::uint8_t first = static_cast<std::uint8_t>(wire[pos]);
+        std::uint64_t length = static_cast<std::uint8_t>(wire[pos + 1]) & 0x7f;
+        pos += 2;
+        if (length == 126) {
+            length = (std::uint64_t(static_cast<std::uint8_t>(wire[pos])) << 8) |
+                     static_cast<std::uint8_t>(wire[pos + 1]);
+            pos += 2;
+        } else if (length == 127) {
+            length = 0;
+            for (int i = 0; i < 8; ++i)
+                length = (length << 8) | static_cast<std::uint8_t>(wire[pos + i]);
+            pos += 8;
+        }
+        frames.push_back({first, wire.substr(pos, static_cast<std::size_t>(length))});
+        pos += static_cast<std::size_t>(length);
+    }
+    return frames;
+}
+
+std::uint16_t close_code(const parsed_frame& frame) {
+    return static_cast<std::uint16_t>((static_cast<std::uint8_t>(frame.payload[0]) << 8) |
+                                      static_cast<std::uint8_t>(frame.payload[1]));
+}
+
+class WebSocketConnectionTest : public ::testing::Test {
+protected:
+    std::string output;
+    std::vector<std::size_t> segment_counts;
+    bool closed = false;
+    std::vector<std::chrono::milliseconds> armed;
+    std::vector<websocket_message> messages;
+    std::vector<std::uint16_t> close_codes;
+    std::shared_ptr<websocket_connection> ws;
+
+    void open(websocket_deflate_options deflate = {}) {
+        auto handler = std::make_shared<websocket_handler>();
+        handler->on_message = [this](const std::shared_ptr<websocket_connection>&,
+                                     websocket_message&& message) {
+            messages.push_back(std::move(message));
+        };
+        handler->on_close = [this](const std::shared_ptr<websocket_connection>&,
+                                   std::uint16_t code, const std::string&) {
+            close_codes.push_back(code);
+        };
+        ws = std::make_shared<websocket_connection>(
+            handler, deflate,
+            [this](std::vector<cppress::sockets::data_buffer>&& segments) {
+                segment_counts.push_back(segments.size());
+                for (auto& s : segments)
+                    output.append(s.view());
+            },
+            [this]() { closed = true; },
+            [this](std::chrono::milliseconds after) { armed.push_back(after); });
+        ws->open();
+    }
+
+    void SetUp() override { open(); }
+};
+}  // namespace
+
+TEST(WebSocketHandshakeTest, AcceptKeyMatchesTheRfcExample) {
+    EXPECT_EQ(websocket_accept_key("dGhlIHNhbXBsZSBub25jZQ=="), "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=");
+}
+
+TEST(WebSocketHandshakeTest, DeflateOfferIsNegotiated) {
+    http_headers headers;
+    headers.add("Sec-WebSocket-Extensions",
+                "x-unknown, permessage-deflate; client_max_window_bits; server_no_context_takeover");
+    std::string response;
+    auto options = negotiate_websocket_deflate(headers, response);
+    EXPECT_EQ(options.enabled, bool(CPPRESS_HAS_ZLIB));
+    if (CPPRESS_HAS_ZLIB) {
+        EXPECT_TRUE(options.server_no_context_takeover);
+        EXPECT_EQ(response, "permessage-deflate; server_no_context_takeover");
+    }
+
+    // a window the compressor cannot honour declines the offer
+    http_headers small;
+    small.add("Sec-WebSocket-Extensions", "permessage-deflate; server_max_window_bits=8");
+    EXPECT_FALSE(negotiate_websocket_deflate(small, response).enabled);
+    EXPECT_TRUE(response.empty());
+}
+
+TEST(WebSocketMaskTest, MatchesBytewiseMaskingAtEveryOffset) {
+    std::string input(300, '\0');
+    for (std::size_t i = 0; i < input.size(); ++i)
+        input[i] = static_cast<char>(i * 7 + 3);
+    for (std::size_t offset = 0; offset < 4; ++offset) {
+        for (std::size_t size : {0u, 1u, 3u, 8u, 15u, 16u, 31u, 32u, 33u, 100u, 300u}) {
+            std::string expected(size, '\0'), actual(size, '\0');
+            for (std::size_t i = 0; i < size; ++i)
+                expected[i] = static_cast<char>(input[i] ^ KEY[(offset + i) & 3]);
+            websocket_mask(actual.data(), input.data(), size, KEY, offset);
+            EXPECT_EQ(actual, expected) << "offset " << offset << " size " << size;
+        }
+    }
+}
+
+TEST(WebSocketFrameHeaderTest, LengthEncodings) {
+    EXPECT_EQ(websocket_frame_header(websocket_opcode::text, 5), std::string("\x81\x05"));
+    EXPECT_EQ(websocket_frame_header(websocket_opcode::binary, 256), std::string("\x82\x7e\x01\x00", 4));
+    auto big = websocket_frame_header(websocket_opcode::binary, 65536, false);
+    EXPECT_EQ(big.size(), 10u);
+    EXPECT_EQ(static_cast<std::uint8_t>(big[0]), 0x02);
+    EXPECT_EQ(static_cast<std::uint8_t>(big[1]), 127);
+    EXPECT_EQ(static_cast<std::uint8_t>(big[7]), 1);
+}
+
+TEST_F(WebSocketConnectionTest, OpenArmsTheHeartbeat) {
+    ASSERT_EQ(armed.size(), 1u);
+    EXPECT_EQ(armed[0], std::chrono::milliseconds(config::WEBSOCKET_PING_INTERVAL_SECONDS));
+}
+
+TEST_F(WebSocketConnectionTest, FrameSplitAcrossReadsIsReassembled) {
+    std::string wire = client_frame(websocket_opcode::text, std::string(1000, 'a') + "end");
+    for (std::size_t i = 0; i < wire.size(); i += 7)
+        ASSERT_TRUE(ws->receive(std::string_view(wire).substr(i, 7)));
+    ASSERT_EQ(messages.size(), 1u);
+    EXPECT_TRUE(messages[0].is_text());
+    EXPECT_EQ(messages[0].data, std::string(1000, 'a') + "end");
+}
+
+TEST_F(WebSocketConnectionTest, FragmentsWithInterleavedPingFormOneMessage) {
+    std::string wire = client_frame(websocket_opcode::binary, "Hel", false) +
+                       client_frame(websocket_opcode::ping, "p") +
+                       client_frame(websocket_opcode::continuation, "lo");
+    ASSERT_TRUE(ws->receive(wire));
+    ASSERT_EQ(messages.size(), 1u);
+    EXPECT_FALSE(messages[0].is_text());
+    EXPECT_EQ(messages[0].data, "Hello");
+
+    auto frames = server_frames(output);
+    ASSERT_EQ(frames.size(), 1u);
+    EXPECT_EQ(frames[0].first, 0x8a);  // FIN | pong
+    EXPECT_EQ(frames[0].payload, "p");
+}
+
+TEST_F(WebSocketConnectionTest, SentPayloadFollowsItsHeaderAsASeparateSegment) {
+    ws->send_text("hello");
+    ASSERT_EQ(segment_counts.size(), 1u);
+    EXPECT_EQ(segment_counts[0], 2u);
+    auto frames = server_frames(output);
+    ASSERT_EQ(frames.size(), 1u);
+    EXPECT_EQ(frames[0].first, 0x81);
+    EXPECT_EQ(frames[0].payload, "hello");
+}
+
+TEST_F(WebSocketConnectionTest, TimerPingsThenGivesUpWithoutPong) {
+    auto next = ws->on_timer();
+    EXPECT_EQ(next, std::chrono::milliseconds(config::WEBSOCKET_PONG_TIMEOUT_SECONDS));
+    auto frames = server_frames(output);
+    ASSERT_EQ(frames.size(), 1u);
+    EXPECT_EQ(frames[0].first, 0x89);  // FIN | ping
+
+    // the pong re-arms the heartbeat
+    ASSERT_TRUE(ws->receive(client_frame(websocket_opcode::pong, "")));
+    EXPECT_EQ(armed.back(), std::chrono::milliseconds(config::WEBSOCKET_PING_INTERVAL_SECONDS));
+
+    ws->on_timer();
+    EXPECT_EQ(ws->on_timer().count(), 0);
+}
+
+TEST_F(WebSocketConnectionTest, CloseFrameIsEchoed) {
+    std::string payload = "\x03\xe8" "bye";
+    EXPECT_FALSE(ws->receive(client_frame(websocket_opcode::close, payload)));
+    auto frames = server_frames(output);
+    ASSERT_EQ(frames.size(), 1u);
+    EXPECT_EQ(frames[0].first, 0x88);
+    EXPECT_EQ(close_code(frames[0]), websocket_close::normal);
+    EXPECT_TRUE(closed);
+    ASSERT_EQ(close_codes.size(), 1u);
+    EXPECT_EQ(close_codes[0], websocket_close::normal);
+
+    // the socket closing afterwards does not report twice
+    ws->closed();
+    EXPECT_EQ(close_codes.size(), 1u);
+}
+
+TEST_F(WebSocketConnectionTest, ServerCloseWaitsForTheClientsAnswer) {
+    ws->close(websocket_close::going_away, "restart");
+    EXPECT_EQ(armed.back(), std::chrono::milliseconds(config::WEBSOCKET_CLOSE_TIMEOUT_SECONDS));
+    EXPECT_FALSE(closed);
+
+    // data still in flight is dropped, the answer completes the handshake
+    ASSERT_TRUE(ws->receive(client_frame(websocket_opcode::text, "late")));
+    EXPECT_TRUE(messages.empty());
+    EXPECT_FALSE(ws->receive(client_frame(websocket_opcode::close, "\x03\xe9")));
+    EXPECT_TRUE(closed);
+    ASSERT_EQ(close_codes.size(), 1u);
+    EXPECT_EQ(close_codes[0], websocket_close::going_away);
+    EXPECT_EQ(server_frames(output).size(), 1u);
+}
+
+TEST_F(WebSocketConnectionTest, UnmaskedFrameIsAProtocolError) {
+    EXPECT_FALSE(ws->receive(websocket_frame_header(websocket_opcode::text, 2) + "hi"));
+    auto frames = server_frames(output);
+    ASSERT_EQ(frames.size(), 1u);
+    EXPECT_EQ(close_code(frames[0]), websocket_close::protocol_error);
+    EXPECT_TRUE(closed);
+    EXPECT_TRUE(messages.empty());
+}
+
+TEST_F(WebSocketConnectionTest, InvalidUtf8TextIsRejected) {
+    EXPECT_FALSE(ws->receive(client_frame(websocket_opcode::text, "abc\xed\xa0\x80")));
+    auto frames = server_frames(output);
+    ASSERT_EQ(frames.size(), 1u);
+    EXPECT_EQ(close_code(frames[0]), websocket_close::invalid_payload);
+}
+
+TEST_F(WebSocketConnectionTest, OversizedMessageIsRejectedFromItsHeader) {
+    auto saved = config::WEBSOCKET_MAX_MESSAGE_SIZE;
+    config::WEBSOCKET_MAX_MESSAGE_SIZE = 16;
+    std::string header = client_frame(websocket_opcode::binary, std::string(17, 'x')).substr(0, 6);
+    EXPECT_FALSE(ws->receive(header));
+    config::WEBSOCKET_MAX_MESSAGE_SIZE = saved;
+    auto frames = server_frames(output);
+    ASSERT_EQ(frames.size(), 1u);
+    EXPECT_EQ(close_code(frames[0]), websocket_close::message_too_big);
+}
+
+#if CPPRESS_HAS_ZLIB
+TEST_F(WebSocketConnectionTest, DeflatedMessagesAreInflatedAndLargeOnesCompressed) {
+    websocket_deflate_options deflate;
+    deflate.enabled = true;
+    open(deflate);
+
+    // RFC 7692 section 7.2.3.1, "Hello" compressed
+    ASSERT_TRUE(ws->receive(client_frame(websocket_opcode::text,
+                                         std::string("\xf2\x48\xcd\xc9\xc9\x07\x00", 7), true,
+                                         true)));
+    ASSERT_EQ(messages.size(), 1u);
+    EXPECT_EQ(messages[0].data, "Hello");
+
+    ws->send_text(std::string(4096, 'z'));
+    auto frames = server_frames(output);
+    ASSERT_EQ(frames.size(), 1u);
+    EXPECT_EQ(frames[0].first, 0xc1);  // FIN | RSV1 | text
+    EXPECT_LT(frames[0].payload.size(), 100u);
+
+    // a client inflates it back with the same context
+    messages.clear();
+    ASSERT_TRUE(ws->receive(client_frame(websocket_opcode::text, frames[0].payload, true, true)));
+    ASSERT_EQ(messages.size(), 1u);
+    EXPECT_EQ(messages[0].data, std::string(4096, 'z'));
+}
+#endif
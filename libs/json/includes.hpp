@@ -15,11 +15,27 @@
  * - Doxygen-documented API
  *
  * @section types JSON Types
- * - json_object: Represents JSON objects with map-like interface
+ * - json_object: Represents JSON objects with map-like interface; members keep
+ *   their insertion order (json_flat_map), so output is deterministic
  * - json_array: Represents JSON arrays with vector-like interface
  * - json_string: Represents JSON strings with string-like interface
  * - json_number: Represents JSON numbers with numeric operations
  * - json_boolean: Represents JSON boolean values
+ * - json_document: A parsed document of compact json_node values in one arena,
+ *   read-only, for large inputs; json_node::to_object() bridges to the types above
+ * - json_lazy_document: a validated structural index, values parsed only where
+ *   they are read, for handlers that read a few fields of a large body
+ * - json_key_table: member names interned once, so that documents parsed with
+ *   the table share them and json_node::find(json_key) compares pointers
+ * - json_lines: JSON Lines (NDJSON) batches split into chunks and parsed on the
+ *   workers of a thread_pool, kept in order or passed record by record to a handler
+ * - json_reader, json_sax_parser: events of input fed in pieces, without building
+ *   anything, for bodies streamed as they arrive
+ * - json_writer: JSON text written in one pass into a string or, in chunks, a sink
+ * - json_query: JSON Pointer (RFC 6901) and simple paths compiled once, run over
+ *   trees, documents, lazy documents and, stopping at the target, json_reader
+ * - CPPRESS_JSON_FIELDS, to_json(), from_json(): structs written and read
+ *   member by member, without a tree (json_bind.hpp)
  *
  * @section namespaces Namespaces
  * - cppress: Main namespace containing all JSON types
@@ -67,8 +83,17 @@
 
 #include "includes/healpers.hpp"
 #include "includes/json_array.hpp"
+#include "includes/json_bind.hpp"
 #include "includes/json_boolean.hpp"
+#include "includes/json_document.hpp"
+#include "includes/json_flat_map.hpp"
+#include "includes/json_key_table.hpp"
+#include "includes/json_lazy.hpp"
+#include "includes/json_lines.hpp"
 #include "includes/json_number.hpp"
 #include "includes/json_object.hpp"
+#include "includes/json_query.hpp"
+#include "includes/json_reader.hpp"
 #include "includes/json_string.hpp"
+#include "includes/json_writer.hpp"
 #include "includes/parser.hpp"
\ No newline at end of file
@@ -95,23 +95,24 @@ public:
     }
 
     /**
-     * @brief Converts this array to a JSON string.
-     * @return A JSON string representation of this array.
-     */
-    std::string stringify() const override {
-        std::string result = "[";
-        for (const auto& element : elements) {
-            if (element) {
-                result += element->stringify() + ",";
-            } else {
-                result += "null,";
-            }
-        }
-        if (result.back() == ',') {
-            result.pop_back();  // Remove trailing comma
-        }
-        result += "]";
-        return result;
+     * @brief Writes this array and its elements with a writer.
+     * @param out Writer to use
+     */
+    void write_to(json_writer& out) const override {
+        out.start_array();
+        for (const auto& element : elements)
+            out.value(element);
+        out.end_array();
+    }
+
+    /**
+     * @brief Exact length of the JSON text of this array.
+     */
+    size_type stringified_size() const override {
+        size_type size = 2 + (elements.empty() ? 0 : elements.size() - 1);
+        for (const auto& element : elements)
+            size += element ? element->stringified_size() : 4;
+        return size;
     }
 
     // STL-like array-specific methods
@@ -0,0 +1,429 @@
+#pragma once
+
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "json_reader.hpp"
+#include "json_writer.hpp"
+
+/**
+ * @brief Binds the members of a struct to JSON members of the same names.
+ *
+ * Place it after the struct, in the struct's namespace (it is found by
+ * argument-dependent lookup). It defines a constexpr table of the members'
+ * names and pointers, from which to_json() and from_json() are compiled.
+ * Up to 32 members; the type name may not contain a comma.
+ *
+ * @code
+ * struct user {
+ *     std::int64_t id = 0;
+ *     std::string name;
+ *     std::vector<std::string> tags;
+ *     std::optional<std::string> email;
+ * };
+ * CPPRESS_JSON_FIELDS(user, id, name, tags, email)
+ *
+ * std::string text = cppress::json::to_json(u);
+ * user back = cppress::json::from_json<user>(text);
+ * @endcode
+ */
+#define CPPRESS_JSON_FIELDS(Type, ...)                                                             \
+    constexpr auto cppress_json_fields(const Type*) noexcept {                                     \
+        using cppress_json_bound = Type;                                                           \
+        return std::make_tuple(CPPRESS_JSON_MAP(CPPRESS_JSON_FIELD, __VA_ARGS__));                 \
+    }
+
+#define CPPRESS_JSON_FIELD(member)                                                                 \
+    ::cppress::json::detail::make_field(#member, &cppress_json_bound::member)
+
+#define CPPRESS_JSON_EXPAND(x) x
+#define CPPRESS_JSON_CAT(a, b) CPPRESS_JSON_CAT_(a, b)
+#define CPPRESS_JSON_CAT_(a, b) a##b
+#define CPPRESS_JSON_COUNT(...)                                                                    \
+    CPPRESS_JSON_EXPAND(CPPRESS_JSON_COUNT_(__VA_ARGS__, 32, 31, 30, 29, 28, 27, 26, 25, 24, 23,   \
+                                            22, 21, 20, 19, 18, 17, 16, 15, 14, 13, 12, 11,        \
+                                            10, 9, 8, 7, 6, 5, 4, 3, 2, 1))
+#define CPPRESS_JSON_COUNT_(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, \
+                            _17, _18, _19, _20, _21, _22, _23, _24, _25, _26, _27, _28,            \
+                            _29, _30, _31, _32, N, ...)                                            \
+    N
+#define CPPRESS_JSON_MAP(f, ...)                                                                   \
+    CPPRESS_JSON_EXPAND(                                                                           \
+        CPPRESS_JSON_CAT(CPPRESS_JSON_MAP_, CPPRESS_JSON_COUNT(__VA_ARGS__))(f, __VA_ARGS__))
+#define CPPRESS_JSON_MAP_1(f, x) f(x)
+#define CPPRESS_JSON_MAP_2(f, x, ...)                                                              \
+    f(x), CPPRESS_JSON_EXPAND(CPPRESS_JSON_MAP_1(f, __VA_ARGS__))
+#define CPPRESS_JSON_MAP_3(f, x, ...)                                                              \
+    f(x), CPPRESS_JSON_EXPAND(CPPRESS_JSON_MAP_2(f, __VA_ARGS__))
+#define CPPRESS_JSON_MAP_4(f, x, ...)                                                              \
+    f(x), CPPRESS_JSON_EXPAND(CPPRESS_JSON_MAP_3(f, __VA_ARGS__))
+#define CPPRESS_JSON_MAP_5(f, x, ...)                                                              \
+    f(x), CPPRESS_JSON_EXPAND(CPPRESS_JSON_MAP_4(f, __VA_ARGS__))
+#define CPPRESS_JSON_MAP_6(f, x, ...)                                                              \
+    f(x), CPPRESS_JSON_EXPAND(CPPRESS_JSON_MAP_5(f, __VA_ARGS__))
+#define CPPRESS_JSON_MAP_7(f, x, ...)                                                              \
+    f(x), CPPRESS_JSON_EXPAND(CPPRESS_JSON_MAP_6(f, __VA_ARGS__))
+#define CPPRESS_JSON_MAP_8(f, x, ...)                                                              \
+    f(x), CPPRESS_JSON_EXPAND(CPPRESS_JSON_MAP_7(f, __VA_ARGS__))
+#define CPPRESS_JSON_MAP_9(f, x, ...)                                                              \
+    f(x), CPPRESS_JSON_EXPAND(CPPRESS_JSON_MAP_8(f, __VA_ARGS__))
+#define CPPRESS_JSON_MAP_10(f, x, ...)                                                             \
+    f(x), CPPRESS_JSON_EXPAND(CPPRESS_JSON_MAP_9(f, __VA_ARGS__))
+#define CPPRESS_JSON_MAP_11(f, x, ...)                                                             \
+    f(x), CPPRESS_JSON_EXPAND(CPPRESS_JSON_MAP_10(f, __VA_ARGS__))
+#define CPPRESS_JSON_MAP_12(f, x, ...)                                                             \
+    f(x), CPPRESS_JSON_EXPAND(CPPRESS_JSON_MAP_11(f, __VA_ARGS__))
+#define CPPRESS_JSON_MAP_13(f, x, ...)                                                             \
+    f(x), CPPRESS_JSON_EXPAND(CPPRESS_JSON_MAP_12(f, __VA_ARGS__))
+#define CPPRESS_JSON_MAP_14(f, x, ...)                                                             \
+    f(x), CPPRESS_JSON_EXPAND(CPPRESS_JSON_MAP_13(f, __VA_ARGS__))
+#define CPPRESS_JSON_MAP_15(f, x, ...)                                                             \
+    f(x), CPPRESS_JSON_EXPAND(CPPRESS_JSON_MAP_14(f, __VA_ARGS__))
+#define CPPRESS_JSON_MAP_16(f, x, ...)                                                             \
+    f(x), CPPRESS_JSON_EXPAND(CPPRESS_JSON_MAP_15(f, __VA_ARGS__))
+#define CPPRESS_JSON_MAP_17(f, x, ...)                                                             \
+    f(x), CPPRESS_JSON_EXPAND(CPPRESS_JSON_MAP_16(f, __VA_ARGS__))
+#define CPPRESS_JSON_MAP_18(f, x, ...)                                                             \
+    f(x), CPPRESS_JSON_EXPAND(CPPRESS_JSON_MAP_17(f, __VA_ARGS__))
+#define CPPRESS_JSON_MAP_19(f, x, ...)                                                             \
+    f(x), CPPRESS_JSON_EXPAND(CPPRESS_JSON_MAP_18(f, __VA_ARGS__))
+#define CPPRESS_JSON_MAP_20(f, x, ...)                                                             \
+    f(x), CPPRESS_JSON_EXPAND(CPPRESS_JSON_MAP_19(f, __VA_ARGS__))
+#define CPPRESS_JSON_MAP_21(f, x, ...)                                                             \
+    f(x), CPPRESS_JSON_EXPAND(CPPRESS_JSON_MAP_20(f, __VA_ARGS__))
+#define CPPRESS_JSON_MAP_22(f, x, ...)                                                             \
+    f(x), CPPRESS_JSON_EXPAND(CPPRESS_JSON_MAP_21(f, __VA_ARGS__))
+#define CPPRESS_JSON_MAP_23(f, x, ...)                                                             \
+    f(x), CPPRESS_JSON_EXPAND(CPPRESS_JSON_MAP_22(f, __VA_ARGS__))
+#define CPPRESS_JSON_MAP_24(f, x, ...)                                                             \
+    f(x), CPPRESS_JSON_EXPAND(CPPRESS_JSON_MAP_23(f, __VA_ARGS__))
+#define CPPRESS_JSON_MAP_25(f, x, ...)                                                             \
+    f(x), CPPRESS_JSON_EXPAND(CPPRESS_JSON_MAP_24(f, __VA_ARGS__))
+#define CPPRESS_JSON_MAP_26(f, x, ...)                                                             \
+    f(x), CPPRESS_JSON_EXPAND(CPPRESS_JSON_MAP_25(f, __VA_ARGS__))
+#define CPPRESS_JSON_MAP_27(f, x, ...)                                                             \
+    f(x), CPPRESS_JSON_EXPAND(CPPRESS_JSON_MAP_26(f, __VA_ARGS__))
+#define CPPRESS_JSON_MAP_28(f, x, ...)                                                             \
+    f(x), CPPRESS_JSON_EXPAND(CPPRESS_JSON_MAP_27(f, __VA_ARGS__))
+#define CPPRESS_JSON_MAP_29(f, x, ...)                                                             \
+    f(x), CPPRESS_JSON_EXPAND(CPPRESS_JSON_MAP_28(f, __VA_ARGS__))
+#define CPPRESS_JSON_MAP_30(f, x, ...)                                                             \
+    f(x), CPPRESS_JSON_EXPAND(CPPRESS_JSON_MAP_29(f, __VA_ARGS__))
+#define CPPRESS_JSON_MAP_31(f, x, ...)                                                             \
+    f(x), CPPRESS_JSON_EXPAND(CPPRESS_JSON_MAP_30(f, __VA_ARGS__))
+#define CPPRESS_JSON_MAP_32(f, x, ...)                                                             \
+    f(x), CPPRESS_JSON_EXPAND(CPPRESS_JSON_MAP_31(f, __VA_ARGS__))
+
+namespace cppress::json {
+
+namespace detail {
+
+/// A bound member: its JSON name and its pointer
+template <typename T, typename M>
+struct field {
+    std::string_view name;
+    M T::*member;
+};
+
+template <typename T, typename M>
+constexpr field<T, M> make_field(std::string_view name, M T::*member) noexcept {
+    return {name, member};
+}
+
+/// FNV-1a of a key, from a basis varied by seed; the high bits are folded
+/// down at the end, the low bits of FNV-1a alone depend on few of the input's
+constexpr std::uint32_t key_hash(std::string_view key, std::uint32_t seed) noexcept {
+    std::uint32_t h = (2166136261u ^ seed) * 16777619u;
+    for (char c : key) {
+        h ^= static_cast<unsigned char>(c);
+        h *= 16777619u;
+    }
+    h ^= h >> 16;
+    h *= 0x45d9f3bu;
+    return h ^ (h >> 16);
+}
+
+/**
+ * @brief Perfect hash of a struct's member names, built at compile time.
+ *
+ * A seed is searched for under which every name lands in its own slot of
+ * a table twice as large as the names, rounded up to a power of two; a
+ * lookup is then one hash, one slot and one comparison.
+ */
+template <std::size_t N>
+struct key_table {
+    static constexpr std::size_t SLOTS = [] {
+        std::size_t size = 1;
+        while (size < 2 * N)
+            size *= 2;
+        return size;
+    }();
+
+    std::array<std::string_view, N> names{};
+    std::uint32_t seed = 0;
+    /// Index of the name in each slot plus one, 0 for an empty slot
+    std::array<std::uint8_t, SLOTS> slots{};
+
+    /// @brief Index of the member named key, N if there is none
+    constexpr std::size_t find(std::string_view key) const noexcept {
+        const std::size_t slot = slots[key_hash(key, seed) & (SLOTS - 1)];
+        return slot && names[slot - 1] == key ? slot - 1 : N;
+    }
+};
+
+template <std::size_t N>
+constexpr key_table<N> make_key_table(const std::array<std::string_view, N>& names) {
+    for (std::size_t i = 0; i < N; ++i)
+        for (std::size_t j = i + 1; j < N; ++j)
+            if (names[i] == names[j])
+                throw std::logic_error("CPPRESS_JSON_FIELDS names a member twice");
+    key_table<N> table;
+    table.names = names;
+    for (std::uint32_t seed = 0; seed < 100000; ++seed) {
+        std::array<std::uint8_t, key_table<N>::SLOTS> slots{};
+        bool placed = true;
+        for (std::size_t i = 0; i < N && placed; ++i) {
+            auto& slot = slots[key_hash(names[i], seed) & (key_table<N>::SLOTS - 1)];
+            placed = slot == 0;
+            slot = static_cast<std::uint8_t>(i + 1);
+        }
+        if (placed) {
+            table.seed = seed;
+            table.slots = slots;
+            return table;
+        }
+    }
+    throw std::logic_error("No perfect hash found for the member names");
+}
+
+template <typename Tuple, std::size_t... I>
+constexpr auto names_of(const Tuple& fields, std::index_sequence<I...>) noexcept {
+    return std::array<std::string_view, sizeof...(I)>{std::get<I>(fields).name...};
+}
+
+template <typename T, typename = void>
+struct is_bound : std::false_type {};
+
+template <typename T>
+struct is_bound<T, std::void_t<decltype(cppress_json_fields(static_cast<const T*>(nullptr)))>>
+    : std::true_type {};
+
+/// Field table and key table of a bound struct
+template <typename T>
+struct binding {
+    static constexpr auto fields = cppress_json_fields(static_cast<const T*>(nullptr));
+    static constexpr std::size_t SIZE = std::tuple_size_v<std::remove_const_t<decltype(fields)>>;
+    static_assert(SIZE < 256, "CPPRESS_JSON_FIELDS binds fewer than 256 members");
+    static constexpr key_table<SIZE> keys =
+        make_key_table<SIZE>(names_of(fields, std::make_index_sequence<SIZE>()));
+};
+
+template <typename T>
+struct is_vector : std::false_type {};
+template <typename T, typename A>
+struct is_vector<std::vector<T, A>> : std::true_type {};
+
+template <typename T>
+struct is_optional : std::false_type {};
+template <typename T>
+struct is_optional<std::optional<T>> : std::true_type {};
+
+template <typename T>
+struct is_string_map : std::false_type {};
+template <typename T, typename C, typename A>
+struct is_string_map<std::map<std::string, T, C, A>> : std::true_type {};
+template <typename T, typename H, typename E, typename A>
+struct is_string_map<std::unordered_map<std::string, T, H, E, A>> : std::true_type {};
+
+template <typename T>
+inline constexpr bool always_false = false;
+
+template <typename T>
+void write_value(json_writer& out, const T& value);
+
+template <typename T, std::size_t... I>
+void write_fields(json_writer& out, const T& value, std::index_sequence<I...>) {
+    constexpr auto& fields = binding<T>::fields;
+    (write_value(out.key(std::get<I>(fields).name), value.*(std::get<I>(fields).member)), ...);
+}
+
+template <typename T>
+void write_value(json_writer& out, const T& value) {
+    if constexpr (std::is_same_v<T, bool>) {
+        out.boolean(value);
+    } else if constexpr (std::is_integral_v<T>) {
+        if constexpr (std::is_unsigned_v<T> && sizeof(T) >= sizeof(std::int64_t)) {
+            if (value > static_cast<T>(std::numeric_limits<std::int64_t>::max())) {
+                char digits[json_writer::NUMBER_CHARS];
+                const char* end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+                out.raw(std::string_view(digits, static_cast<std::size_t>(end - digits)));
+                return;
+            }
+        }
+        out.integer(static_cast<std::int64_t>(value));
+    } else if constexpr (std::is_floating_point_v<T>) {
+        out.number(static_cast<double>(value));
+    } else if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+        out.string(value);
+    } else if constexpr (is_optional<T>::value) {
+        if (value)
+            write_value(out, *value);
+        else
+            out.null();
+    } else if constexpr (is_vector<T>::value) {
+        out.start_array();
+        for (const auto& element : value)
+            write_value(out, element);
+        out.end_array();
+    } else if constexpr (is_string_map<T>::value) {
+        out.start_object();
+        for (const auto& [name, element] : value)
+            write_value(out.key(name), element);
+        out.end_object();
+    } else if constexpr (is_bound<T>::value) {
+        out.start_object();
+        write_fields(out, value, std::make_index_sequence<binding<T>::SIZE>());
+        out.end_object();
+    } else {
+        static_assert(always_false<T>, "type is not bound with CPPRESS_JSON_FIELDS");
+    }
+}
+
+[[noreturn]] inline void mismatch(const json_reader& in, const char* expected) {
+    throw std::runtime_error(std::string("Expected ") + expected + " at position " +
+                             std::to_string(in.offset()));
+}
+
+template <typename T>
+void read_value(json_reader& in, json_event event, T& out);
+
+/// Reads the value of member index, found among the members I
+template <typename T, std::size_t... I>
+void read_field(json_reader& in, T& out, std::size_t index, std::index_sequence<I...>) {
+    constexpr auto& fields = binding<T>::fields;
+    ((index == I ? read_value(in, in.next(), out.*(std::get<I>(fields).member)) : void()), ...);
+}
+
+template <typename T>
+void read_value(json_reader& in, json_event event, T& out) {
+    if constexpr (std::is_same_v<T, bool>) {
+        if (event != json_event::boolean)
+            mismatch(in, "a boolean");
+        out = in.boolean();
+    } else if constexpr (std::is_integral_v<T>) {
+        // from the text, so every value of T is exact and others are refused
+        const std::string_view text = in.text();
+        if (event != json_event::number)
+            mismatch(in, "an integer in range");
+        const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), out);
+        if (error != std::errc() || end != text.data() + text.size())
+            mismatch(in, "an integer in range");
+    } else if constexpr (std::is_floating_point_v<T>) {
+        if (event != json_event::number)
+            mismatch(in, "a number");
+        out = static_cast<T>(in.number());
+    } else if constexpr (std::is_same_v<T, std::string>) {
+        if (event != json_event::string)
+            mismatch(in, "a string");
+        out.assign(in.text());
+    } else if constexpr (is_optional<T>::value) {
+        if (event == json_event::null) {
+            out.reset();
+        } else {
+            read_value(in, event, out.emplace());
+        }
+    } else if constexpr (is_vector<T>::value) {
+        if (event != json_event::start_array)
+            mismatch(in, "an array");
+        out.clear();
+        for (event = in.next(); event != json_event::end_array; event = in.next())
+            read_value(in, event, out.emplace_back());
+    } else if constexpr (is_string_map<T>::value) {
+        if (event != json_event::start_object)
+            mismatch(in, "an object");
+        out.clear();
+        for (event = in.next(); event != json_event::end_object; event = in.next()) {
+            auto& element = out[std::string(in.text())];
+            read_value(in, in.next(), element);
+        }
+    } else if constexpr (is_bound<T>::value) {
+        if (event != json_event::start_object)
+            mismatch(in, "an object");
+        for (event = in.next(); event != json_event::end_object; event = in.next()) {
+            const std::size_t index = binding<T>::keys.find(in.text());
+            if (index == binding<T>::SIZE)
+                in.skip();
+            else
+                read_field(in, out, index, std::make_index_sequence<binding<T>::SIZE>());
+        }
+    } else {
+        static_assert(always_false<T>, "type is not bound with CPPRESS_JSON_FIELDS");
+    }
+}
+}  // namespace detail
+
+/**
+ * @brief Write a value: a bound struct, a scalar, a string, or a vector,
+ *        optional or string-keyed map of those.
+ * @param value Value to write
+ * @param out Writer to write it with
+ *
+ * Members go straight from the struct to the writer, in binding order;
+ * an empty optional is written as null.
+ */
+template <typename T>
+void to_json(const T& value, json_writer& out) {
+    detail::write_value(out, value);
+}
+
+/// @brief The JSON text of a value, see to_json(const T&, json_writer&)
+template <typename T>
+std::string to_json(const T& value) {
+    std::string text;
+    json_writer out(text);
+    detail::write_value(out, value);
+    return text;
+}
+
+/**
+ * @brief Read JSON text into a value, without building a tree.
+ * @param text JSON text
+ * @param[out] out Value to fill
+ * @throws std::runtime_error if text is malformed or a value does not fit
+ *         its member (a fraction or an out-of-range number for an integer)
+ *
+ * The text is tokenized by a json_reader and each value stored straight
+ * into its member. Member names are matched with a perfect hash computed
+ * at compile time; unknown members are skipped, members that are absent
+ * keep their value, and null clears an optional.
+ */
+template <typename T>
+void from_json(std::string_view text, T& out) {
+    json_reader in;
+    in.feed(text);
+    in.finish();
+    detail::read_value(in, in.next(), out);
+    in.next();
+}
+
+/// @brief A value read from JSON text, see from_json(std::string_view, T&)
+template <typename T>
+T from_json(std::string_view text) {
+    T out{};
+    from_json(text, out);
+    return out;
+}
+}  // namespace cppress::json
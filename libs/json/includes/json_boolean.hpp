@@ -77,6 +77,17 @@ public:
      */
     std::string stringify() const override { return value ? "true" : "false"; }
 
+    /**
+     * @brief Writes "true" or "false" with a writer.
+     * @param out Writer to use
+     */
+    void write_to(json_writer& out) const override { out.boolean(value); }
+
+    /**
+     * @brief Length of "true" or "false".
+     */
+    size_type stringified_size() const override { return value ? 4 : 5; }
+
     // Type-safe conversion methods
     /**
      * @brief Gets the boolean value.
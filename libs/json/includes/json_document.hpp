@@ -0,0 +1,250 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "json_key_table.hpp"
+
+namespace cppress::json {
+
+class json_object;
+struct json_member;
+
+/**
+ * @brief Type tag of a json_node.
+ */
+enum class json_type : std::uint8_t { null, boolean, number, string, array, object };
+
+/**
+ * @class json_node
+ * @brief One value of a json_document: a type tag and its payload in 16 bytes.
+ *
+ * Numbers and booleans are held inline; integer text that fits 64 bits is
+ * kept as an exact std::int64_t. Strings are views of the document
+ * (of its copy of the input when the string has no escapes, of decoded
+ * text otherwise). Arrays and objects point to their children, laid out
+ * next to each other in the document's arena; an object's children are
+ * json_member key/value pairs in document order. A member name
+ * interned in a json_key_table points at the table's copy.
+ *
+ * Nodes are trivially copyable and valid as long as their document.
+ */
+class json_node {
+public:
+    json_node() noexcept : tag(json_type::null), key_table(0), length(0), number(0) {}
+
+    /// @brief The type of the value
+    json_type type() const noexcept { return tag; }
+
+    bool is_null() const noexcept { return tag == json_type::null; }
+    bool is_boolean() const noexcept { return tag == json_type::boolean; }
+    bool is_number() const noexcept { return tag == json_type::number; }
+    bool is_string() const noexcept { return tag == json_type::string; }
+    bool is_array() const noexcept { return tag == json_type::array; }
+    bool is_object() const noexcept { return tag == json_type::object; }
+
+    /// @brief The value of a boolean, false for any other type
+    bool as_boolean() const noexcept { return tag == json_type::boolean && boolean; }
+
+    /// @brief The value of a number, 0 for any other type
+    double as_number() const noexcept {
+        if (tag != json_type::number)
+            return 0;
+        return length == INTEGER ? static_cast<double>(integer) : number;
+    }
+
+    /// @brief Whether the value is a number written as an integer that fits 64 bits
+    bool is_integer() const noexcept { return tag == json_type::number && length == INTEGER; }
+
+    /// @brief The exact value of an integer number; other numbers truncated and
+    ///        clamped to 64 bits, 0 for any other type
+    std::int64_t as_int64() const noexcept;
+
+    /// @brief The text of a string, decoded; empty for any other type
+    std::string_view as_string() const noexcept {
+        return tag == json_type::string ? std::string_view(chars, length) : std::string_view();
+    }
+
+    /// @brief Elements of an array or members of an object, 0 for any other type
+    std::size_t size() const noexcept {
+        return tag == json_type::array || tag == json_type::object ? length : 0;
+    }
+
+    /// @brief Elements of an array; empty for any other type
+    const json_node* begin() const noexcept {
+        return tag == json_type::array ? static_cast<const json_node*>(children) : nullptr;
+    }
+    const json_node* end() const noexcept {
+        return begin() + (tag == json_type::array ? length : 0);
+    }
+
+    /**
+     * @brief Element of an array.
+     * @throws std::out_of_range if this is not an array or index is past its end
+     */
+    const json_node& operator[](std::size_t index) const;
+
+    /// @brief Members of an object in document order; empty for any other type
+    const json_member* members_begin() const noexcept;
+    const json_member* members_end() const noexcept;
+
+    /**
+     * @brief Value of an object's member.
+     * @param key Decoded member name
+     * @return The value, the last one for a repeated name (as parse() keeps it);
+     *         nullptr if absent or this is not an object
+     * @note A linear scan of the members, no index is built
+     */
+    const json_node* find(std::string_view key) const noexcept;
+
+    /**
+     * @brief Value of an object's member, by interned name.
+     * @return As find(std::string_view); nullptr for the null key
+     * @note Names interned in the key's table, as those of a document parsed
+     *       with it, are compared by pointer; others by text
+     */
+    const json_node* find(const json_key& key) const noexcept;
+
+    /// @brief Whether this is a string node holding the key's name, e.g. a member's key
+    bool matches(const json_key& key) const noexcept {
+        if (key.table != 0 && key_table == key.table)
+            return chars == key.chars;
+        return tag == json_type::string && key && as_string() == key.view();
+    }
+
+    /**
+     * @brief Copy the value into the json_object hierarchy.
+     * @return A new tree, as json_value() would have parsed it; nullptr for null
+     */
+    std::shared_ptr<json_object> to_object() const;
+
+private:
+    friend class json_document_builder;
+
+    /// length of a number holding integer instead of number
+    static constexpr std::uint32_t INTEGER = 1;
+
+    json_type tag;
+    /// Serial of the json_key_table a string's text was interned in, 0 if none
+    std::uint16_t key_table;
+    std::uint32_t length;
+    union {
+        double number;
+        std::int64_t integer;
+        bool boolean;
+        const char* chars;
+        const void* children;
+    };
+};
+
+/**
+ * @brief A member of an object node: its name (a string node) and its value.
+ */
+struct json_member {
+    json_node key;
+    json_node value;
+};
+
+static_assert(sizeof(json_node) == 16, "json_node is a tag, a length and one 8-byte payload");
+
+inline const json_member* json_node::members_begin() const noexcept {
+    return tag == json_type::object ? static_cast<const json_member*>(children) : nullptr;
+}
+
+inline const json_member* json_node::members_end() const noexcept {
+    return members_begin() + (tag == json_type::object ? length : 0);
+}
+
+/**
+ * @class json_document
+ * @brief A parsed JSON text held as json_node values in one arena.
+ *
+ * The parse makes no allocation per value: nodes and decoded strings come
+ * from one monotonic arena, sized from the input up front, and the whole
+ * document is released at once. Lookups are plain reads, without
+ * reference counts or virtual calls. The input is read once, in place:
+ * whitespace and comments are skipped by the tokenizer, and view() and
+ * parse(std::string&&) do not copy it either.
+ *
+ * Read-only; to_object() copies a document, or part of one, into the
+ * json_object hierarchy for code built on that API.
+ *
+ * @code
+ * auto doc = cppress::json::json_document::parse(R"({"user": {"id": 7, "tags": ["a", "b"]}})");
+ * const cppress::json::json_node* user = doc.root().find("user");
+ * double id = user->find("id")->as_number();
+ * for (const auto& tag : *user->find("tags"))
+ *     std::cout << tag.as_string() << '\n';
+ * @endcode
+ */
+class json_document {
+public:
+    /**
+     * @brief Parse any JSON value.
+     * @param text JSON text; line and block comments are skipped (JSONC)
+     * @param keys Table to intern member names in, nullptr for none
+     * @return The document, which owns a copy of text
+     * @throws std::runtime_error if text is not a single well-formed value
+     *
+     * "\u" escapes are decoded to UTF-8.
+     */
+    static json_document parse(std::string_view text, json_key_table* keys = nullptr);
+
+    /**
+     * @brief Parse any JSON value, taking over the text instead of copying it.
+     * @param text JSON text, moved into the document
+     * @param keys Table to intern member names in, nullptr for none
+     * @throws std::runtime_error if text is not a single well-formed value
+     */
+    static json_document parse(std::string&& text, json_key_table* keys = nullptr);
+
+    /// @brief Parse any JSON value from a C string; see parse(std::string_view)
+    static json_document parse(const char* text, json_key_table* keys = nullptr) {
+        return parse(std::string_view(text), keys);
+    }
+
+    /**
+     * @brief Parse any JSON value in place.
+     * @param text JSON text, e.g. a request body or a received data_buffer's bytes;
+     *        it must outlive the document, whose strings point into it
+     * @param keys Table to intern member names in, nullptr for none
+     * @throws std::runtime_error if text is not a single well-formed value
+     */
+    static json_document view(std::string_view text, json_key_table* keys = nullptr);
+
+    json_document(json_document&&) noexcept = default;
+    json_document& operator=(json_document&&) noexcept = default;
+
+    /// @brief The top-level value
+    const json_node& root() const noexcept { return *top; }
+
+private:
+    friend class json_lines;
+
+    json_document() = default;
+
+    /// Parses text into the arena and sets top
+    void build(std::string_view text, json_key_table* keys);
+
+    /**
+     * @brief Parses text into any arena, e.g. one shared by many documents.
+     * @param index Scratch for the structural index, reused across calls
+     * @param keys Table to intern member names in, nullptr for none
+     * @return The root node, allocated in the arena
+     */
+    static const json_node* build(std::string_view text, std::pmr::memory_resource* arena,
+                                  std::vector<std::uint32_t>& index,
+                                  json_key_table* keys = nullptr);
+
+    /// Text given to parse(std::string&&); behind a pointer so a move keeps its address
+    std::unique_ptr<std::string> owned;
+
+    std::unique_ptr<std::pmr::monotonic_buffer_resource> arena;
+    const json_node* top = nullptr;
+};
+}  // namespace cppress::json
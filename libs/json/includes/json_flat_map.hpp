@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace cppress::json {
+
+class json_object;
+
+/**
+ * @class json_flat_map
+ * @brief The members of a json_object: (key, value) pairs in insertion order.
+ *
+ * Members sit next to each other in one vector, so a small object is one
+ * allocation (keys up to the string's inline capacity need none), iterates
+ * over contiguous memory, and is written out in the order its members were
+ * inserted: the same object always gives the same text, whatever the
+ * process, which keeps content hashes and ETags stable.
+ *
+ * Up to INDEX_THRESHOLD members a key is found by comparing it to each
+ * one, faster at that size than hashing it. Past the threshold the map
+ * also keeps an open-addressing table of member positions by key hash,
+ * rebuilt as the map grows and after an erase.
+ *
+ * The interface is the part of std::unordered_map json_object used.
+ * Keys are mutable through iterators only because the pairs must move
+ * on erase; changing one there breaks lookups.
+ */
+class json_flat_map {
+public:
+    using key_type = std::string;
+    using mapped_type = std::shared_ptr<json_object>;
+    using value_type = std::pair<key_type, mapped_type>;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using iterator = std::vector<value_type>::iterator;
+    using const_iterator = std::vector<value_type>::const_iterator;
+
+    /// Members found by a linear scan; larger maps keep a hash index
+    static constexpr size_type INDEX_THRESHOLD = 16;
+
+    json_flat_map() = default;
+
+    size_type size() const noexcept { return members.size(); }
+    bool empty() const noexcept { return members.empty(); }
+
+    iterator begin() noexcept { return members.begin(); }
+    const_iterator begin() const noexcept { return members.begin(); }
+    const_iterator cbegin() const noexcept { return members.cbegin(); }
+    iterator end() noexcept { return members.end(); }
+    const_iterator end() const noexcept { return members.end(); }
+    const_iterator cend() const noexcept { return members.cend(); }
+
+    /// @brief The member named key, end() if there is none
+    iterator find(std::string_view key) noexcept { return begin() + position(key); }
+    const_iterator find(std::string_view key) const noexcept { return begin() + position(key); }
+
+    size_type count(std::string_view key) const noexcept { return contains(key) ? 1 : 0; }
+    bool contains(std::string_view key) const noexcept { return position(key) != size(); }
+
+    /**
+     * @brief Value of a member.
+     * @throws std::out_of_range if there is no member named key
+     */
+    mapped_type& at(std::string_view key);
+    const mapped_type& at(std::string_view key) const;
+
+    /// @brief Value of a member, appended with a null value if absent
+    mapped_type& operator[](std::string_view key);
+
+    /**
+     * @brief Set a member's value, appending the member if absent.
+     * @return The member, and whether it was appended
+     * @note A member that exists keeps its place
+     */
+    std::pair<iterator, bool> insert_or_assign(std::string key, mapped_type value);
+
+    /// @brief Remove a member, keeping the order of the others
+    /// @return The number of members removed (0 or 1)
+    size_type erase(std::string_view key);
+    iterator erase(const_iterator it);
+
+    void clear() noexcept;
+
+    void reserve(size_type n) { members.reserve(n); }
+
+private:
+    /// Position of the member named key, size() if there is none
+    size_type position(std::string_view key) const noexcept;
+
+    /// Records the member at pos in the index
+    void index_member(size_type pos) noexcept;
+
+    /// Builds the index from scratch, or drops it at or below the threshold
+    void reindex();
+
+    std::vector<value_type> members;
+
+    /// Open-addressing table: position of a member plus one, 0 for an empty
+    /// slot; empty while the map is at or below INDEX_THRESHOLD
+    std::vector<std::uint32_t> slots;
+};
+}  // namespace cppress::json
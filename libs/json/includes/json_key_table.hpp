@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <shared_mutex>
+#include <string_view>
+#include <vector>
+
+namespace cppress::json {
+
+/**
+ * @class json_key
+ * @brief A member name interned in a json_key_table: a handle to its one copy.
+ *
+ * Two keys of the same table are equal exactly when they are the same
+ * name, so comparing them compares pointers. The text stays valid, and
+ * the handle usable, as long as the table.
+ */
+class json_key {
+public:
+    /// @brief The null key, which names nothing
+    json_key() noexcept = default;
+
+    /// @brief The name, empty for the null key
+    std::string_view view() const noexcept { return std::string_view(chars, length); }
+
+    /// @brief Position of the name in its table, from 1 in interning order; 0 for the null key
+    std::size_t id() const noexcept { return number; }
+
+    explicit operator bool() const noexcept { return chars != nullptr; }
+
+    friend bool operator==(const json_key& a, const json_key& b) noexcept {
+        return a.chars == b.chars;
+    }
+    friend bool operator!=(const json_key& a, const json_key& b) noexcept { return !(a == b); }
+
+private:
+    friend class json_key_table;
+    friend class json_node;
+    friend class json_document_builder;
+
+    const char* chars = nullptr;
+    std::uint32_t length = 0;
+    /// Serial of the table, 0 if it has none
+    std::uint16_t table = 0;
+    std::uint16_t number = 0;
+};
+
+static_assert(sizeof(json_key) == 16, "json_key is a pointer, a length and two 16-bit fields");
+
+/**
+ * @class json_key_table
+ * @brief Member names stored once and handed out as json_key handles.
+ *
+ * The same few hundred names ("id", "timestamp", "user_id"...) come back
+ * in every document. Parsed with a table (json_document::parse(text,
+ * &keys)), a document's member names point at the table's copy instead
+ * of the input or the document's arena, and json_node::find(json_key)
+ * compares pointers instead of text: a handler interns the names it
+ * reads once, at startup, and looks them up by handle in every request.
+ *
+ * The table only grows, so it is bounded: names longer than MAX_KEY_SIZE,
+ * and any name once it holds capacity() of them, are not interned and
+ * the parse keeps them as before. Untrusted input cannot grow it past
+ * that, and the first names in, typically those of the handlers, stay.
+ *
+ * A table is used by one thread at a time, as one per event loop is.
+ * global() is the exception: shared by the process, and locked.
+ */
+class json_key_table {
+public:
+    /// Names kept by default
+    static constexpr std::size_t DEFAULT_CAPACITY = 4096;
+    /// Most names a table can keep, as a key's id is 16 bits
+    static constexpr std::size_t MAX_CAPACITY = 65535;
+    /// Longest name interned
+    static constexpr std::size_t MAX_KEY_SIZE = 128;
+
+    /// @param capacity Names kept at most, up to MAX_CAPACITY
+    explicit json_key_table(std::size_t capacity = DEFAULT_CAPACITY);
+
+    json_key_table(const json_key_table&) = delete;
+    json_key_table& operator=(const json_key_table&) = delete;
+
+    /// @brief The table shared by the whole process, safe to use from any thread
+    static json_key_table& global();
+
+    /**
+     * @brief The key of a name, interning it if it is new.
+     * @return The null key if the name is too long or the table is full
+     */
+    json_key intern(std::string_view name);
+
+    /// @brief The key of a name already interned, the null key otherwise
+    json_key find(std::string_view name) const;
+
+    /// @brief Number of names interned
+    std::size_t size() const;
+
+    std::size_t capacity() const noexcept { return limit; }
+
+private:
+    json_key_table(std::size_t capacity, bool shared);
+
+    /// The key of a name, the null key if absent; slot is left on the name or
+    /// on the empty slot where it goes
+    json_key lookup(std::string_view name, std::size_t& slot) const noexcept;
+
+    std::size_t limit;
+    std::uint16_t serial;
+
+    /// Holds the names, which never move
+    std::pmr::monotonic_buffer_resource text;
+
+    /// Keys by id - 1
+    std::vector<json_key> keys;
+
+    /// Open-addressing table of ids by name hash, 0 for an empty slot; at
+    /// most half full
+    std::vector<std::uint16_t> slots;
+
+    /// Only for global()
+    std::unique_ptr<std::shared_mutex> mutex;
+};
+}  // namespace cppress::json
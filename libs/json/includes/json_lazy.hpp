@@ -0,0 +1,275 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "json_document.hpp"
+
+namespace cppress::json {
+
+class json_lazy_iterator;
+class json_lazy_member_iterator;
+
+/**
+ * @class json_lazy_value
+ * @brief A value of a json_lazy_document, parsed when it is read.
+ *
+ * A handle: the document and the position of the value's first token.
+ * The type is known from that token alone; numbers, literals and strings
+ * are read from the text by their accessors, each time they are called,
+ * and containers are walked by jumping from one child to the next.
+ * Accessors mirror json_node's, except that reading a malformed scalar
+ * throws: it was not checked before.
+ *
+ * Handles are trivially copyable and valid as long as their document.
+ */
+class json_lazy_value {
+public:
+    /// @brief The type of the value, from its first byte
+    json_type type() const noexcept;
+
+    bool is_null() const noexcept { return type() == json_type::null; }
+    bool is_boolean() const noexcept { return type() == json_type::boolean; }
+    bool is_number() const noexcept { return type() == json_type::number; }
+    bool is_string() const noexcept { return type() == json_type::string; }
+    bool is_array() const noexcept { return type() == json_type::array; }
+    bool is_object() const noexcept { return type() == json_type::object; }
+
+    /**
+     * @brief The value of a boolean, false for any other type
+     * @throws std::runtime_error if the literal is malformed
+     */
+    bool as_boolean() const;
+
+    /**
+     * @brief The value of a number, 0 for any other type
+     * @throws std::runtime_error if the number is malformed
+     */
+    double as_number() const;
+
+    /**
+     * @brief Whether the value is a number written as an integer that fits 64 bits
+     * @throws std::runtime_error if the number is malformed
+     */
+    bool is_integer() const;
+
+    /**
+     * @brief The exact value of an integer number; other numbers truncated and
+     *        clamped to 64 bits, 0 for any other type
+     * @throws std::runtime_error if the number is malformed
+     */
+    std::int64_t as_int64() const;
+
+    /**
+     * @brief The text of a string, decoded; empty for any other type
+     * @return A view of the input for a string without escapes; otherwise
+     *         of a copy decoded into the document, once per call
+     * @throws std::runtime_error if an escape is malformed
+     */
+    std::string_view as_string() const;
+
+    /// @brief Elements of an array or members of an object, counted by
+    ///        walking them; 0 for any other type
+    std::size_t size() const noexcept;
+
+    /**
+     * @brief Element of an array, reached by walking the ones before it.
+     * @throws std::out_of_range if this is not an array or index is past its end
+     */
+    json_lazy_value operator[](std::size_t index) const;
+
+    /**
+     * @brief Value of an object's member.
+     * @param key Decoded member name
+     * @return The value, the last one for a repeated name (as json_node::find()
+     *         finds it); std::nullopt if absent or this is not an object
+     * @throws std::runtime_error if a member name is malformed
+     * @note Only the names are read; other members' values are jumped over
+     */
+    std::optional<json_lazy_value> find(std::string_view key) const;
+
+    /// @brief Elements of an array; empty for any other type
+    json_lazy_iterator begin() const noexcept;
+    json_lazy_iterator end() const noexcept;
+
+    /// @brief Members of an object in document order; empty for any other type
+    json_lazy_member_iterator members_begin() const noexcept;
+    json_lazy_member_iterator members_end() const noexcept;
+
+    /**
+     * @brief Copy the value into the json_object hierarchy.
+     * @return A new tree, as json_value() would have parsed it; nullptr for null
+     * @throws std::runtime_error if a scalar inside is malformed
+     */
+    std::shared_ptr<json_object> to_object() const;
+
+private:
+    friend class json_lazy_document;
+    friend class json_lazy_iterator;
+    friend class json_lazy_member_iterator;
+
+    struct state;
+
+    json_lazy_value(const state* doc, std::uint32_t at) noexcept : doc(doc), at(at) {}
+
+    /// Entry of the token closing a container, one past the value for others
+    std::uint32_t last() const noexcept;
+
+    const state* doc = nullptr;
+    /// Entry of the value's first token in the structural index
+    std::uint32_t at = 0;
+};
+
+/**
+ * @brief A member of an object value: its name (a string value) and its value.
+ */
+struct json_lazy_member {
+    json_lazy_value key;
+    json_lazy_value value;
+};
+
+/**
+ * @brief Forward iterator over the elements of an array value.
+ */
+class json_lazy_iterator {
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = json_lazy_value;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = json_lazy_value;
+
+    json_lazy_value operator*() const noexcept { return {doc, at}; }
+    json_lazy_iterator& operator++() noexcept;
+    json_lazy_iterator operator++(int) noexcept {
+        json_lazy_iterator before = *this;
+        ++*this;
+        return before;
+    }
+
+    bool operator==(const json_lazy_iterator& other) const noexcept { return at == other.at; }
+    bool operator!=(const json_lazy_iterator& other) const noexcept { return at != other.at; }
+
+private:
+    friend class json_lazy_value;
+
+    json_lazy_iterator(const json_lazy_value::state* doc, std::uint32_t at) noexcept
+        : doc(doc), at(at) {}
+
+    const json_lazy_value::state* doc;
+    std::uint32_t at;
+};
+
+/**
+ * @brief Forward iterator over the members of an object value.
+ */
+class json_lazy_member_iterator {
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = json_lazy_member;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = json_lazy_member;
+
+    /// The key is at the iterator's entry, its value two entries on, past the ':'
+    json_lazy_member operator*() const noexcept { return {{doc, at}, {doc, at + 2}}; }
+    json_lazy_member_iterator& operator++() noexcept;
+    json_lazy_member_iterator operator++(int) noexcept {
+        json_lazy_member_iterator before = *this;
+        ++*this;
+        return before;
+    }
+
+    bool operator==(const json_lazy_member_iterator& other) const noexcept {
+        return at == other.at;
+    }
+    bool operator!=(const json_lazy_member_iterator& other) const noexcept {
+        return at != other.at;
+    }
+
+private:
+    friend class json_lazy_value;
+
+    json_lazy_member_iterator(const json_lazy_value::state* doc, std::uint32_t at) noexcept
+        : doc(doc), at(at) {}
+
+    const json_lazy_value::state* doc;
+    std::uint32_t at;
+};
+
+/**
+ * @class json_lazy_document
+ * @brief A JSON text read on demand: validated up front, parsed where it is read.
+ *
+ * parse() builds only the structural index of json_scan.hpp (the offset of
+ * every token) and checks the grammar over it: brackets balance, commas,
+ * colons and member names are where they belong. For every value it also
+ * records where the next one starts, so a lookup jumps over the members and
+ * elements it passes instead of reading them. No node is built; numbers,
+ * literals and strings are parsed by the accessor that reads them, and a
+ * string without escapes is a view of the input.
+ *
+ * For a handler reading a few fields of a large body this costs one index
+ * pass; json_document builds every value, the json_object tree allocates
+ * for each. Scalars are checked only when read: a malformed number nobody
+ * reads is not reported, whereas json_document::parse() refuses it.
+ *
+ * Decoding an escaped string stores it in the document, so a document
+ * must not be read from several threads at once.
+ *
+ * @code
+ * auto doc = cppress::json::json_lazy_document::view(body);
+ * auto event = doc.root().find("event");
+ * if (event && event->as_string() == "push")
+ *     handle(doc.root().find("repository")->find("id")->as_int64());
+ * @endcode
+ */
+class json_lazy_document {
+public:
+    /**
+     * @brief Index a JSON text.
+     * @param text JSON text; line and block comments are skipped (JSONC)
+     * @return The document, which owns a copy of text
+     * @throws std::runtime_error if the structure of text is not a single
+     *         well-formed value
+     */
+    static json_lazy_document parse(std::string_view text);
+
+    /**
+     * @brief Index a JSON text, taking over the text instead of copying it.
+     * @throws std::runtime_error if the structure is not a single well-formed value
+     */
+    static json_lazy_document parse(std::string&& text);
+
+    /// @brief Index a JSON text from a C string; see parse(std::string_view)
+    static json_lazy_document parse(const char* text) { return parse(std::string_view(text)); }
+
+    /**
+     * @brief Index a JSON text in place.
+     * @param text JSON text, e.g. a request body; it must outlive the document
+     * @throws std::runtime_error if the structure is not a single well-formed value
+     */
+    static json_lazy_document view(std::string_view text);
+
+    json_lazy_document(json_lazy_document&&) noexcept;
+    json_lazy_document& operator=(json_lazy_document&&) noexcept;
+    ~json_lazy_document();
+
+    /// @brief The top-level value
+    json_lazy_value root() const noexcept { return {doc.get(), 0}; }
+
+private:
+    json_lazy_document();
+
+    /// Indexes the text held by doc
+    void build();
+
+    /// Text, index and decoded strings, behind a pointer so values survive a move
+    std::unique_ptr<json_lazy_value::state> doc;
+};
+}  // namespace cppress::json
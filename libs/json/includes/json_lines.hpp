@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <string_view>
+#include <vector>
+
+#include "json_document.hpp"
+
+namespace cppress::shared {
+class thread_pool;
+}
+
+namespace cppress::json {
+
+/**
+ * @brief Receives one record of a JSON Lines batch: its position among the
+ *        records and its root node, valid only during the call.
+ */
+using json_record_handler = std::function<void(std::size_t record, const json_node& root)>;
+
+/**
+ * @class json_lines
+ * @brief A JSON Lines (NDJSON) batch parsed across the cores of a thread_pool.
+ *
+ * The batch is split at every line feed; blank lines are skipped and each
+ * other line is one record. JSON cannot hold a raw line feed inside a
+ * string, so every line feed ends a record, and a malformed record never
+ * moves the boundaries of the ones after it.
+ *
+ * The records are then cut into chunks of about CHUNK_SIZE bytes, claimed
+ * one after the other by the calling thread and by up to one task per
+ * worker of the pool; the caller takes part, so a call made from a worker
+ * of the same pool cannot wait on itself. Each chunk is parsed, record by
+ * record, into an arena of its own with the json_document parser, so
+ * threads never share an allocator.
+ *
+ * parse() keeps the records, in order; for_each() hands each one to a
+ * handler and reuses the chunk's arena for the next, for batches too large
+ * to keep.
+ *
+ * @code
+ * auto batch = cppress::json::json_lines::parse(body, &pool);
+ * for (std::size_t i = 0; i < batch.size(); ++i)
+ *     store(batch[i].find("id")->as_int64());
+ * @endcode
+ */
+class json_lines {
+public:
+    /// Bytes of records each task takes at a time
+    static constexpr std::size_t CHUNK_SIZE = 256 * 1024;
+
+    /**
+     * @brief Parse every record of a batch.
+     * @param text The batch, read in place; it must outlive the result
+     * @param pool Workers to share the work with; nullptr parses on the calling thread
+     * @throws std::runtime_error naming the first malformed record and its line
+     */
+    static json_lines parse(std::string_view text, shared::thread_pool* pool = nullptr);
+
+    /**
+     * @brief Parse every record of a batch and pass each to a handler.
+     * @param text The batch
+     * @param handler Called from the calling thread and the pool's workers at
+     *        once; the records of one chunk in order, chunks in no order
+     * @param pool Workers to share the work with; nullptr parses on the calling thread
+     * @throws std::runtime_error naming the first malformed record and its line,
+     *         or what the handler threw first; records after it may or may not
+     *         have been handled
+     */
+    static void for_each(std::string_view text, const json_record_handler& handler,
+                         shared::thread_pool* pool = nullptr);
+
+    json_lines(json_lines&&) noexcept = default;
+    json_lines& operator=(json_lines&&) noexcept = default;
+
+    /// @brief Number of records
+    std::size_t size() const noexcept { return records.size(); }
+
+    bool empty() const noexcept { return records.empty(); }
+
+    /// @brief Root of a record
+    const json_node& operator[](std::size_t record) const noexcept { return *records[record]; }
+
+private:
+    json_lines() = default;
+
+    /// One arena per chunk, holding the nodes of its records
+    std::vector<std::unique_ptr<std::pmr::monotonic_buffer_resource>> arenas;
+    std::vector<const json_node*> records;
+};
+}  // namespace cppress::json
@@ -1,6 +1,11 @@
 #pragma once
 
+#include <charconv>
 #include <cmath>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
 
 #include "json_object.hpp"
 
@@ -12,7 +17,9 @@ namespace cppress::json {
  *
  * This class provides a JSON number implementation with methods for
  * numeric operations and type conversions. Internally stores numbers
- * as double precision floating point values.
+ * as double precision floating point values; integers built from an
+ * integer type or parsed from integer text also keep their exact 64-bit
+ * value, so IDs past 2^53 survive a round trip.
  *
  * @note Inherits from json_object but represents a primitive numeric value.
  */
@@ -22,7 +29,7 @@ public:
     using value_type = double;
 
     /// The actual numeric value
-    double value;
+    double value = 0;
 
     // Constructors and destructor
     /**
@@ -40,19 +47,20 @@ public:
      * @brief Constructs a JSON number from an integer.
      * @param value The integer value.
      */
-    json_number(int value) : value(static_cast<double>(value)) {}
+    json_number(int value) : json_number(static_cast<long long>(value)) {}
 
     /**
      * @brief Constructs a JSON number from a long.
      * @param value The long value.
      */
-    json_number(long value) : value(static_cast<double>(value)) {}
+    json_number(long value) : json_number(static_cast<long long>(value)) {}
 
     /**
      * @brief Constructs a JSON number from a long long.
      * @param value The long long value.
      */
-    json_number(long long value) : value(static_cast<double>(value)) {}
+    json_number(long long value)
+        : value(static_cast<double>(value)), integer(value), has_integer(true) {}
 
     /**
      * @brief Constructs a JSON number from a float.
@@ -81,37 +89,61 @@ public:
      * @brief Parses a string and sets this number's value.
      * @param jsonString The string representation of the number.
      * @return true if parsing succeeded, false otherwise.
+     * @note Read with std::from_chars, independent of the locale; integer
+     *       text that fits 64 bits is kept exactly
      */
     bool set_json_data(const std::string& jsonString) override {
-        if (jsonString.empty()) {
-            return false;
-        }
-
-        try {
-            size_t pos = 0;
-            double parsed_value = std::stod(jsonString, &pos);
-
-            // Check if the entire string was consumed (no trailing characters)
-            if (pos != jsonString.length()) {
-                return false;
-            }
+        return parse(jsonString);
+    }
 
-            value = parsed_value;
-            return true;
-        } catch (...) {
+    /**
+     * @brief Sets this number from the whole of a piece of text, without copying it.
+     * @param text The number, e.g. "42", "-1.5e3"
+     * @return true if text is a number and nothing else
+     */
+    bool parse(std::string_view text) noexcept {
+        const char* first = text.data();
+        const char* last = first + text.size();
+        if (first == last)
             return false;
+        std::int64_t whole = 0;
+        const auto exact = std::from_chars(first, last, whole);
+        if (exact.ec == std::errc() && exact.ptr == last) {
+            value = static_cast<double>(whole);
+            integer = whole;
+            has_integer = true;
+            return true;
         }
+        double parsed = 0;
+        const auto approximate = std::from_chars(first, last, parsed);
+        if (approximate.ec != std::errc() || approximate.ptr != last)
+            return false;
+        value = parsed;
+        has_integer = false;
+        return true;
+    }
+
+    /**
+     * @brief Writes this number with a writer.
+     * @param out Writer to use
+     * @note Exact integers are written in full, other values as the shortest
+     *       text that reads back to the same double (std::to_chars); NaN and
+     *       infinities, which JSON cannot hold, as null
+     */
+    void write_to(json_writer& out) const override {
+        if (holds_integer())
+            out.integer(integer);
+        else
+            out.number(value);
     }
 
     /**
-     * @brief Converts this number to a JSON string.
-     * @return A string representation of the number.
-     * @note Integers are formatted without decimal points.
+     * @brief Length of the formatted number.
+     * @note Formats it into a stack buffer, nothing is allocated
      */
-    std::string stringify() const override {
-        if ((long long)value == value)
-            return std::to_string((long long)value);
-        return std::to_string(value);
+    size_type stringified_size() const override {
+        char digits[json_writer::NUMBER_CHARS];
+        return format(digits);
     }
 
     // Type-safe conversion methods
@@ -129,9 +161,29 @@ public:
 
     /**
      * @brief Converts to long long.
-     * @return The value as a long long.
+     * @return The exact integer if one is held, otherwise the value truncated
+     *         and clamped to the range of long long (0 for NaN)
+     */
+    long long to_long_long() const noexcept {
+        if (holds_integer())
+            return integer;
+        if (std::isnan(value))
+            return 0;
+        if (value >= TWO_POW_63)
+            return std::numeric_limits<long long>::max();
+        if (value < -TWO_POW_63)
+            return std::numeric_limits<long long>::min();
+        return static_cast<long long>(value);
+    }
+
+    /**
+     * @brief Whether the number is an integer known exactly.
+     * @return true for numbers built from an integer type or parsed from integer
+     *         text that fits 64 bits, as long as value was not changed since
      */
-    long long to_long_long() const noexcept { return static_cast<long long>(value); }
+    bool holds_integer() const noexcept {
+        return has_integer && static_cast<double>(integer) == value;
+    }
 
     /**
      * @brief Converts to float.
@@ -149,7 +201,7 @@ public:
      * @brief Checks if the number is an integer.
      * @return true if the value has no fractional part, false otherwise.
      */
-    bool is_integer() const noexcept { return value == static_cast<long long>(value); }
+    bool is_integer() const noexcept { return std::isfinite(value) && std::trunc(value) == value; }
 
     /**
      * @brief Checks if the number is finite (not infinity or NaN).
@@ -208,6 +260,7 @@ public:
      */
     json_number& operator+=(double rhs) noexcept {
         value += rhs;
+        has_integer = false;
         return *this;
     }
 
@@ -218,6 +271,7 @@ public:
      */
     json_number& operator-=(double rhs) noexcept {
         value -= rhs;
+        has_integer = false;
         return *this;
     }
 
@@ -228,6 +282,7 @@ public:
      */
     json_number& operator*=(double rhs) noexcept {
         value *= rhs;
+        has_integer = false;
         return *this;
     }
 
@@ -238,6 +293,7 @@ public:
      */
     json_number& operator/=(double rhs) noexcept {
         value /= rhs;
+        has_integer = false;
         return *this;
     }
 
@@ -247,6 +303,7 @@ public:
      */
     json_number& operator++() noexcept {
         ++value;
+        has_integer = false;
         return *this;
     }
 
@@ -257,6 +314,7 @@ public:
     json_number operator++(int) noexcept {
         json_number temp = *this;
         ++value;
+        has_integer = false;
         return temp;
     }
 
@@ -266,6 +324,7 @@ public:
      */
     json_number& operator--() noexcept {
         --value;
+        has_integer = false;
         return *this;
     }
 
@@ -276,8 +335,25 @@ public:
     json_number operator--(int) noexcept {
         json_number temp = *this;
         --value;
+        has_integer = false;
         return temp;
     }
+
+private:
+    /// 2^63, the first double past the range of long long
+    static constexpr double TWO_POW_63 = 9223372036854775808.0;
+
+    /// Exact value of an integer number, valid while holds_integer()
+    std::int64_t integer = 0;
+
+    /// integer was set from an integer type or integer text
+    bool has_integer = false;
+
+    /// Writes the number into buf, returns its length
+    std::size_t format(char* buf) const noexcept {
+        return holds_integer() ? json_writer::format_integer(integer, buf)
+                               : json_writer::format_number(value, buf);
+    }
 };
 
 }  // namespace cppress
@@ -3,7 +3,9 @@
 #include <memory>
 #include <stdexcept>
 #include <string>
-#include <unordered_map>
+
+#include "json_flat_map.hpp"
+#include "json_writer.hpp"
 
 namespace cppress::json {
 
@@ -15,24 +17,27 @@ namespace cppress::json {
  * std::unordered_map, offering familiar STL-style operations for working with
  * JSON data. It supports nested objects, arrays, and all JSON value types.
  *
+ * Members keep their insertion order (json_flat_map), in iteration and in
+ * the text stringify() writes.
+ *
  * @note This is the base class for all JSON value types.
  */
 class json_object {
 protected:
-    /// Internal storage for key-value pairs
-    std::unordered_map<std::string, std::shared_ptr<json_object>> data;
+    /// Internal storage for key-value pairs, in insertion order
+    json_flat_map data;
 
 public:
     // STL-like type aliases
     using key_type = std::string;
     using mapped_type = std::shared_ptr<json_object>;
-    using value_type = std::pair<const key_type, mapped_type>;
+    using value_type = json_flat_map::value_type;
     using size_type = std::size_t;
     using difference_type = std::ptrdiff_t;
     using reference = value_type&;
     using const_reference = const value_type&;
-    using iterator = std::unordered_map<key_type, mapped_type>::iterator;
-    using const_iterator = std::unordered_map<key_type, mapped_type>::const_iterator;
+    using iterator = json_flat_map::iterator;
+    using const_iterator = json_flat_map::const_iterator;
 
     // Constructors and destructor
     /**
@@ -41,10 +46,10 @@ public:
     json_object();
 
     /**
-     * @brief Constructs a JSON object from an existing map.
-     * @param initial_data The initial key-value pairs for the object.
+     * @brief Constructs a JSON object from existing members.
+     * @param initial_data The initial key-value pairs for the object, e.g. what parse() returns.
      */
-    json_object(const std::unordered_map<std::string, std::shared_ptr<json_object>>& initial_data);
+    json_object(const json_flat_map& initial_data);
 
     /**
      * @brief Virtual destructor for proper inheritance.
@@ -64,7 +69,8 @@ public:
      * @brief Inserts or updates a key-value pair.
      * @param key The key to insert or update.
      * @param value The value to associate with the key.
-     * @note If the key already exists, its value is overwritten.
+     * @note If the key already exists, its value is overwritten in place;
+     *       otherwise the member is appended.
      */
     virtual void insert(const std::string& key, std::shared_ptr<json_object> value);
 
@@ -93,9 +99,28 @@ public:
     /**
      * @brief Converts this object to a JSON string.
      * @return A JSON string representation of this object.
+     * @note Sized with stringified_size() and written with stringify_to(), in one allocation
      */
     virtual std::string stringify() const;
 
+    /**
+     * @brief Appends the JSON text of this value to a buffer.
+     * @param out Buffer to append to; reserve stringified_size() first to write each byte once
+     * @note A json_writer over out, see write_to()
+     */
+    void stringify_to(std::string& out) const;
+
+    /**
+     * @brief Writes this value, and the values it holds, with a writer.
+     * @param out Writer to use, e.g. one streaming to a sink
+     */
+    virtual void write_to(json_writer& out) const;
+
+    /**
+     * @brief Exact length of the JSON text of this value, computed without producing it.
+     */
+    virtual size_type stringified_size() const;
+
     /**
      * @brief Removes all elements from the object.
      */
@@ -181,10 +206,10 @@ public:
     // Legacy compatibility
     /**
      * @brief Gets the internal data map (for backward compatibility).
-     * @return A const reference to the internal unordered_map.
+     * @return A const reference to the members, in insertion order.
      * @deprecated Use iterators or STL-like methods instead.
      */
-    const std::unordered_map<std::string, std::shared_ptr<json_object>>& get_data() const;
+    const json_flat_map& get_data() const;
 
     /**
      * @brief Checks if a key exists (legacy name).
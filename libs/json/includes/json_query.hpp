@@ -0,0 +1,153 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "json_document.hpp"
+#include "json_lazy.hpp"
+#include "json_reader.hpp"
+
+namespace cppress::json {
+
+class json_object;
+
+/**
+ * @class json_query
+ * @brief A JSON Pointer (RFC 6901) or simple path, compiled once into steps.
+ *
+ * Each step selects a member by name or an array element by index. The
+ * text is parsed (escapes decoded, indexes converted) when the query is
+ * built, so running it is a walk with no parsing of its own; a query can
+ * be kept in a static and run against every request:
+ *
+ * - a json_object tree, reached by raw pointers with no reference count
+ *   touched on the way down;
+ * - a json_document's nodes, or a json_lazy_document's values, where only
+ *   the names on the way are read;
+ * - a json_reader, through a json_query_cursor that stops reading at the
+ *   target and skips every subtree off the path.
+ *
+ * Pointers follow RFC 6901: "" is the whole value, "/a/0" is member "a"
+ * then member or element "0", "~1" and "~0" stand for '/' and '~', "-"
+ * (past the last element) matches nothing. The URI fragment form
+ * ("#/a%20b/0") is accepted as well. Paths are the subset of JSONPath
+ * without wildcards or filters: "$.a.b[0]['c.d']", or "a.b[0]" without the "$".
+ *
+ * @code
+ * static const auto tenant = cppress::json::json_query::pointer("/account/tenant");
+ * if (const auto* node = tenant.find(doc.root()))
+ *     route(node->as_string());
+ * @endcode
+ */
+class json_query {
+public:
+    /**
+     * @brief Compile a JSON Pointer.
+     * @throws std::runtime_error if the text is not a valid pointer
+     */
+    static json_query pointer(std::string_view text);
+
+    /**
+     * @brief Compile a path expression: "$", then ".name", "[index]" or
+     *        "['name']" (or "[\"name\"]") steps; without the "$", a name
+     *        may start the path.
+     * @throws std::runtime_error if the text is not a valid path
+     */
+    static json_query path(std::string_view text);
+
+    /**
+     * @brief The value at the query in a tree.
+     * @return The slot holding it (the root's own for an empty query), whose
+     *         pointer is null for a JSON null; nullptr if there is no such value
+     */
+    const std::shared_ptr<json_object>* find(const std::shared_ptr<json_object>& root) const;
+
+    /// @brief The value at the query in a document, nullptr if there is none
+    const json_node* find(const json_node& root) const noexcept;
+
+    /**
+     * @brief The value at the query in a lazy document, std::nullopt if there is none
+     * @throws std::runtime_error if a member name on the way is malformed
+     */
+    std::optional<json_lazy_value> find(const json_lazy_value& root) const;
+
+    /// @brief The query as an RFC 6901 pointer, e.g. for messages
+    std::string to_pointer() const;
+
+    /// @brief Number of steps
+    std::size_t size() const noexcept { return steps.size(); }
+
+private:
+    friend class json_query_cursor;
+
+    /// Index of a step that selects no element
+    static constexpr std::size_t NO_INDEX = static_cast<std::size_t>(-1);
+
+    /**
+     * @brief A member name, an element index, or both for a pointer token
+     *        such as "0" that selects either.
+     */
+    struct step {
+        std::string name;
+        std::size_t index = NO_INDEX;
+        bool by_name = true;
+    };
+
+    std::vector<step> steps;
+};
+
+/**
+ * @class json_query_cursor
+ * @brief Runs a json_query over a json_reader, piece by piece.
+ *
+ * seek() reads events until the target's first one and returns it; the
+ * reader is then positioned on the target, for text(), number() and so
+ * on, or at the start of its container. Members and elements off the path
+ * are passed over with json_reader::skip(), and nothing after the target
+ * is read: a gateway routing on one field stops reading the body there.
+ * Of repeated names the first is taken, where find() takes the last.
+ *
+ * @code
+ * json_reader reader;
+ * json_query_cursor cursor(tenant_query);
+ * reader.feed(piece);
+ * json_event event = cursor.seek(reader);
+ * if (event == json_event::need_more) { ... feed the next piece and seek() again ... }
+ * else if (event == json_event::string) route(reader.text());
+ * @endcode
+ */
+class json_query_cursor {
+public:
+    /// @param query The query to run, must outlive the cursor
+    explicit json_query_cursor(const json_query& query) noexcept : query(query) {}
+
+    /**
+     * @brief Read up to the target.
+     * @return json_event::need_more if the input fed so far ran out first:
+     *         feed more and call again; the target's first event once found;
+     *         json_event::end if there is no such value, and on every call
+     *         after the target or its absence was returned
+     * @throws std::runtime_error if the reader fails
+     */
+    json_event seek(json_reader& in);
+
+    /// @brief Whether seek() returned the target
+    bool found() const noexcept { return state == where::found; }
+
+private:
+    /// What the next event is
+    enum class where : std::uint8_t { value, members, elements, found, missing };
+
+    const json_query& query;
+    where state = where::value;
+    /// Steps matched so far
+    std::size_t matched = 0;
+    /// Elements passed in the array being searched
+    std::size_t count = 0;
+};
+}  // namespace cppress::json
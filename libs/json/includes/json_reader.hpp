@@ -0,0 +1,291 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace cppress::json {
+
+/**
+ * @brief What json_reader::next() read.
+ */
+enum class json_event : std::uint8_t {
+    /// The input fed so far is used up: feed() more, or finish()
+    need_more,
+    start_object,
+    end_object,
+    start_array,
+    end_array,
+    /// A member name, json_reader::text() is the decoded name
+    key,
+    /// json_reader::text() is the decoded string
+    string,
+    /// json_reader::number(), json_reader::integer() and json_reader::text() (as written)
+    number,
+    /// json_reader::boolean()
+    boolean,
+    null,
+    /// The value is complete and finish() was called
+    end
+};
+
+/**
+ * @class json_reader
+ * @brief Pull parser reading one JSON value from input fed in pieces.
+ *
+ * Each call to next() returns the next event of the value; when the input
+ * fed so far runs out it returns json_event::need_more, and parsing resumes
+ * where it stopped once the next piece is fed. Pieces may split the input
+ * anywhere, even inside a string, a number or an escape. Nothing is built:
+ * memory is the open-container stack and the bytes of the one token a
+ * piece cut in two, so arbitrarily large documents are read in constant
+ * memory. Line and block comments are skipped, as by json_document.
+ *
+ * A piece is read in place: it must stay valid until next() returns
+ * json_event::need_more, and only the unfinished token at its end is
+ * copied. The view returned by text() is valid until the next call to
+ * next() or feed().
+ *
+ * skip() passes over the rest of an object or array, or a member's value,
+ * without reporting it: its bytes are only searched for quotes and brackets.
+ *
+ * @code
+ * cppress::json::json_reader reader;
+ * reader.feed(piece);
+ * for (auto event = reader.next(); event != json_event::need_more; event = reader.next())
+ *     if (event == json_event::key && reader.text() == "attachments")
+ *         reader.skip();
+ * @endcode
+ */
+class json_reader {
+public:
+    /// Nesting past this is refused
+    static constexpr std::size_t MAX_DEPTH = 1024;
+
+    json_reader() = default;
+
+    /**
+     * @brief Give the reader the next piece of the input.
+     * @param piece Bytes following those fed before; read in place, see above
+     */
+    void feed(std::string_view piece);
+
+    /// @brief Mark the end of the input, after the last feed()
+    void finish() noexcept { finished = true; }
+
+    /**
+     * @brief Read the next event.
+     * @return The event; json_event::end once the value is complete and
+     *         finish() was called, and on every later call
+     * @throws std::runtime_error if the input is not a single well-formed
+     *         value; the reader stays failed and throws again on later calls
+     */
+    json_event next();
+
+    /**
+     * @brief Pass over the container just opened, or the value of the key just read.
+     *
+     * After json_event::start_object or json_event::start_array, the next
+     * event is the one following the container's end; after json_event::key,
+     * the one following the member's value. Without effect after other events.
+     * Skipped bytes are only checked for balanced brackets and closed strings.
+     */
+    void skip() noexcept;
+
+    /// @brief Decoded text of a key or string, the text of a number as written
+    std::string_view text() const noexcept { return current; }
+
+    /// @brief Value of a number
+    double number() const noexcept { return value; }
+
+    /// @brief Whether the number was written as an integer that fits 64 bits
+    bool is_integer() const noexcept { return exact_valid; }
+
+    /// @brief The exact value of an integer number, see is_integer()
+    std::int64_t integer() const noexcept { return exact; }
+
+    /// @brief Value of a boolean
+    bool boolean() const noexcept { return flag; }
+
+    /// @brief Containers open around the current position
+    std::size_t depth() const noexcept { return open.size(); }
+
+    /// @brief Bytes of the input read so far
+    std::size_t offset() const noexcept { return consumed + pos; }
+
+private:
+    /// What may come next
+    enum class expect : std::uint8_t {
+        value,
+        value_or_close,
+        key,
+        key_or_close,
+        colon,
+        comma_or_close,
+        done
+    };
+
+    /// Comment the input is inside of
+    enum class comment : std::uint8_t { none, line, block };
+
+    static constexpr std::size_t NO_SKIP = static_cast<std::size_t>(-1);
+
+    /// next() without recording the event for skip()
+    json_event read();
+
+    [[noreturn]] void fail(const std::string& what);
+
+    /// Keeps the unfinished token and asks for more input
+    json_event suspend();
+
+    /// Skips whitespace and comments; false if the input ran out first
+    bool space();
+
+    /// Passes over skipped bytes; false if the input ran out first
+    bool skip_through();
+
+    /// Opens a container after checking the depth
+    void push(char close);
+
+    /// The value ended: the state its container expects next
+    void after_value() noexcept {
+        state = open.empty() ? expect::done : expect::comma_or_close;
+    }
+
+    /// Closes the innermost container at pos
+    json_event close();
+
+    /// Reads the value starting with c; false if the input ran out first
+    bool value_token(char c, json_event& event);
+
+    /// Reads a string token into current; false if the input ran out first
+    bool string();
+
+    /// Decodes the escapes of a string's text into decoded
+    void decode(std::string_view body);
+
+    /// Reads a number token; false if the input ran out first
+    bool number_token();
+
+    /// Reads true, false or null; false if the input ran out first
+    bool literal(std::string_view word);
+
+    /// Current piece: a view of the caller's bytes or of carry
+    std::string_view input;
+    std::size_t pos = 0;
+
+    /// Bytes of input before the current piece
+    std::size_t consumed = 0;
+
+    /// Unfinished token and the pieces fed after it
+    std::string carry;
+    bool owned = false;
+
+    bool finished = false;
+
+    /// Closing bracket of each open container, innermost last
+    std::vector<char> open;
+    expect state = expect::value;
+
+    comment in_comment = comment::none;
+    /// The last byte of a block comment was '*'
+    bool star = false;
+
+    /// Bytes of a cut string already searched, from its opening quote
+    std::size_t scanned = 0;
+    /// The cut string has escapes
+    bool escapes = false;
+
+    /// Last event returned
+    json_event last = json_event::need_more;
+
+    /// depth() at which skipping stops, NO_SKIP when not skipping
+    std::size_t skip_to = NO_SKIP;
+    /// The next value is a skipped member's value
+    bool skip_value = false;
+    bool skip_string = false;
+    bool skip_escape = false;
+
+    std::string_view current;
+    /// Decoded text of an escaped string
+    std::string decoded;
+    double value = 0;
+    std::int64_t exact = 0;
+    bool exact_valid = false;
+    bool flag = false;
+
+    /// Message of the error that failed the reader
+    std::string error;
+};
+
+/**
+ * @class json_handler
+ * @brief Receives the values of a json_sax_parser; override what is needed.
+ *
+ * Returning false from start_object(), start_array() or key() skips the
+ * container or the member's value; its end is not reported either.
+ */
+class json_handler {
+public:
+    virtual ~json_handler() = default;
+
+    virtual bool start_object() { return true; }
+    virtual void end_object() {}
+    virtual bool start_array() { return true; }
+    virtual void end_array() {}
+    virtual bool key(std::string_view /* name */) { return true; }
+    virtual void string(std::string_view /* value */) {}
+    virtual void number(double /* value */) {}
+
+    /// @brief A number written as an integer that fits 64 bits; calls number() by default
+    virtual void integer(std::int64_t value) { number(static_cast<double>(value)); }
+
+    virtual void boolean(bool /* value */) {}
+    virtual void null() {}
+};
+
+/**
+ * @class json_sax_parser
+ * @brief Calls a json_handler for each value of JSON input fed in pieces.
+ *
+ * A json_reader drained into the handler after every piece, so each piece
+ * may be dropped once feed() returns; the pieces of an http_body_stream can
+ * be fed as they arrive, and a large upload is checked and processed
+ * element by element without being held:
+ *
+ * @code
+ * auto parser = std::make_shared<json_sax_parser>(handler);
+ * return [parser](std::string_view piece, bool last) {
+ *     parser->feed(piece);
+ *     if (last)
+ *         parser->finish();
+ * };
+ * @endcode
+ */
+class json_sax_parser {
+public:
+    /// @param handler Receives the values, must outlive the parser
+    explicit json_sax_parser(json_handler& handler) noexcept : handler(handler) {}
+
+    /**
+     * @brief Parse the next piece of the input.
+     * @throws std::runtime_error if the input is not well-formed so far
+     */
+    void feed(std::string_view piece);
+
+    /**
+     * @brief Mark the end of the input.
+     * @throws std::runtime_error if the value is not complete
+     */
+    void finish();
+
+private:
+    /// Passes the events read so far to the handler
+    void drain();
+
+    json_handler& handler;
+    json_reader reader;
+};
+}  // namespace cppress::json
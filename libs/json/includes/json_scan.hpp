@@ -0,0 +1,74 @@
+/**
+ * @file json_scan.hpp
+ * @brief Vectorized structural index used by json_document::parse(), and
+ *        the escape scan used by json_writer
+ *
+ * The first stage of a two-stage parse, after simdjson: 64 bytes at a
+ * time, the input is classified into bitmasks of quotes, backslashes,
+ * structural characters and whitespace. Escaped quotes are removed with
+ * carry arithmetic on the backslash runs, a prefix XOR of the remaining
+ * quotes marks the inside of strings, and the offsets of every token
+ * start outside strings are written to the index: { } [ ] : , the
+ * opening quote of each string, and the first byte of each number or
+ * literal. The second stage walks the index instead of the bytes.
+ *
+ * The writer's scan compares 32 (AVX2) or 16 (NEON) bytes at a time
+ * against the quote, the backslash and the control characters, the bytes
+ * a JSON string cannot hold as they are.
+ *
+ * The implementation is picked once at startup: AVX2 on x86-64, NEON on
+ * AArch64, a table-driven scalar loop otherwise. Every implementation
+ * gives the same results.
+ *
+ * @note This is an internal implementation detail used by json_document and json_writer
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace cppress::json::scan {
+
+/// Instruction set the classification relies on
+enum class level { scalar, avx2, neon };
+
+/**
+ * @brief Offsets of the token starts of a JSON text
+ * @param p The text
+ * @param n Its length
+ * @param[out] index Replaced with the offsets, ascending
+ * @return false if the index cannot stand in for the text: a string is
+ *         not closed, a '/' (a comment) appears outside strings, or the
+ *         text is 4 GiB or more; parse byte by byte then
+ */
+bool structural_index(const char* p, std::size_t n, std::vector<std::uint32_t>& index);
+
+/**
+ * @brief Length of the run of bytes a JSON string holds as they are
+ * @param p The text
+ * @param n Its length
+ * @return Offset of the first quote, backslash or byte below 0x20; n if there is none
+ */
+std::size_t plain_prefix(const char* p, std::size_t n) noexcept;
+
+/// @brief Implementation the index currently uses
+level active() noexcept;
+
+/// @brief Best implementation supported by this CPU
+level best() noexcept;
+
+/**
+ * @brief Switches the index to another implementation
+ * @param l Level to use, ignored unless this CPU supports it
+ * @return true if the level is now active
+ *
+ * Meant for benchmarks and tests comparing implementations; not
+ * thread-safe against concurrent parses.
+ */
+bool use(level l) noexcept;
+
+/// @brief Name of a level, e.g. "avx2"
+const char* name(level l) noexcept;
+}  // namespace cppress::json::scan
@@ -66,60 +66,16 @@ public:
     }
 
     /**
-     * @brief Converts this string to a JSON string (with quotes and escaping).
-     * @return A JSON string representation with proper escaping.
+     * @brief Writes this string, quoted and escaped, with a writer.
+     * @param out Writer to use
+     * @note Backslash, double quote and control characters are escaped
      */
-    std::string stringify() const override {
-        // Handle escape characters properly
-        std::string escaped = value;
-        size_type pos = 0;
-
-        // Escape backslashes first (must be done before other escapes)
-        while ((pos = escaped.find("\\", pos)) != std::string::npos) {
-            escaped.replace(pos, 1, "\\\\");
-            pos += 2;  // Skip the newly inserted characters
-        }
-
-        // Escape double quotes
-        pos = 0;
-        while ((pos = escaped.find("\"", pos)) != std::string::npos) {
-            escaped.replace(pos, 1, "\\\"");
-            pos += 2;  // Skip the newly inserted characters
-        }
-
-        // Escape other common characters
-        pos = 0;
-        while ((pos = escaped.find("\n", pos)) != std::string::npos) {
-            escaped.replace(pos, 1, "\\n");
-            pos += 2;
-        }
-
-        pos = 0;
-        while ((pos = escaped.find("\r", pos)) != std::string::npos) {
-            escaped.replace(pos, 1, "\\r");
-            pos += 2;
-        }
-
-        pos = 0;
-        while ((pos = escaped.find("\t", pos)) != std::string::npos) {
-            escaped.replace(pos, 1, "\\t");
-            pos += 2;
-        }
-
-        pos = 0;
-        while ((pos = escaped.find("\b", pos)) != std::string::npos) {
-            escaped.replace(pos, 1, "\\b");
-            pos += 2;
-        }
-
-        pos = 0;
-        while ((pos = escaped.find("\f", pos)) != std::string::npos) {
-            escaped.replace(pos, 1, "\\f");
-            pos += 2;
-        }
-
-        return "\"" + escaped + "\"";
-    }
+    void write_to(json_writer& out) const override { out.string(value); }
+
+    /**
+     * @brief Length of this string once quoted and escaped.
+     */
+    size_type stringified_size() const override { return json_writer::escaped_size(value); }
 
     // STL-like string methods
     /**
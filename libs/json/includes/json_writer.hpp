@@ -0,0 +1,146 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace cppress::json {
+
+class json_object;
+class json_node;
+
+/**
+ * @brief Receives the text of a json_writer in chunks, each handed over by move.
+ */
+using json_sink = std::function<void(std::string&& chunk)>;
+
+/**
+ * @class json_writer
+ * @brief Writes JSON text in one pass, into a string or through a sink.
+ *
+ * Every value is appended to one buffer: the caller's string, or the
+ * writer's own, handed to a sink whenever it fills up to the chunk size
+ * (e.g. the chunks of a streamed response) so a large value is never held
+ * whole. Commas and colons are placed by the writer; the structure itself
+ * is the caller's to keep.
+ *
+ * Strings are escaped a run at a time: the vectorized scan of json_scan.hpp
+ * finds the next byte to escape and everything before it is copied at once.
+ * Numbers are written with std::to_chars, as json_number writes them.
+ *
+ * json_object::stringify() is this writer over a string reserved to
+ * json_object::stringified_size(), the optional sizing pass.
+ *
+ * @code
+ * std::string out;
+ * cppress::json::json_writer writer(out);
+ * writer.start_object().key("id").integer(7).key("tags").start_array();
+ * for (const auto& tag : tags)
+ *     writer.string(tag);
+ * writer.end_array().key("meta").value(*meta).end_object();
+ * @endcode
+ */
+class json_writer {
+public:
+    /// Default size of the chunks handed to a sink
+    static constexpr std::size_t DEFAULT_CHUNK_SIZE = 16 * 1024;
+
+    /// Buffer size format_number() and format_integer() need
+    static constexpr std::size_t NUMBER_CHARS = 32;
+
+    /**
+     * @brief Write into a string.
+     * @param out String the text is appended to; must outlive the writer
+     */
+    explicit json_writer(std::string& out) noexcept : out(&out) {}
+
+    /**
+     * @brief Write through a sink.
+     * @param sink Receives the text in chunks of about chunk_size bytes
+     * @param chunk_size Bytes buffered before they are handed to the sink
+     * @note Call flush() after the last value to hand over the rest
+     */
+    explicit json_writer(json_sink sink, std::size_t chunk_size = DEFAULT_CHUNK_SIZE);
+
+    json_writer(const json_writer&) = delete;
+    json_writer& operator=(const json_writer&) = delete;
+
+    json_writer& start_object();
+    json_writer& end_object();
+    json_writer& start_array();
+    json_writer& end_array();
+
+    /// @brief Name of the next member, escaped
+    json_writer& key(std::string_view name);
+
+    /// @brief A string value, escaped
+    json_writer& string(std::string_view value);
+
+    /// @brief A number: integral values without an exponent, others as the
+    ///        shortest text that reads back the same; NaN and infinities as null
+    json_writer& number(double value);
+
+    json_writer& integer(std::int64_t value);
+    json_writer& boolean(bool value);
+    json_writer& null();
+
+    /// @brief A json_object tree, written by its write_to()
+    json_writer& value(const json_object& value);
+
+    /// @brief A json_object tree, null for nullptr
+    json_writer& value(const std::shared_ptr<json_object>& value);
+
+    /// @brief A value of a json_document, written from its nodes
+    json_writer& value(const json_node& value);
+
+    /// @brief JSON text written as a value as is, e.g. a cached fragment
+    json_writer& raw(std::string_view json);
+
+    /// @brief Make room for n more bytes, e.g. a stringified_size()
+    void reserve(std::size_t n) { out->reserve(out->size() + n); }
+
+    /// @brief Hand the buffered text to the sink; nothing to do when writing into a string
+    void flush();
+
+    /**
+     * @brief Length of a string once quoted and escaped by the writer.
+     */
+    static std::size_t escaped_size(std::string_view value) noexcept;
+
+    /// @brief Writes a number as number() does into buf (NUMBER_CHARS bytes), returns its length
+    static std::size_t format_number(double value, char* buf) noexcept;
+
+    /// @brief Writes an integer into buf (NUMBER_CHARS bytes), returns its length
+    static std::size_t format_integer(std::int64_t value, char* buf) noexcept;
+
+private:
+    /// Comma before a value or key that follows another
+    void separate() {
+        if (comma)
+            *out += ',';
+        comma = false;
+    }
+
+    /// A value was completed
+    void done() {
+        comma = true;
+        if (sink && out->size() >= chunk_size)
+            flush();
+    }
+
+    void append_escaped(std::string_view value);
+
+    /// Text goes here: the caller's string or buffer
+    std::string* out;
+
+    std::string buffer;
+    json_sink sink;
+    std::size_t chunk_size = 0;
+
+    /// The next value or key is preceded by a comma
+    bool comma = false;
+};
+}  // namespace cppress::json
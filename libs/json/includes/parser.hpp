@@ -3,7 +3,9 @@
 
 #include <memory>
 #include <string>
-#include <unordered_map>
+#include <string_view>
+
+#include "json_flat_map.hpp"
 
 namespace cppress::json {
 
@@ -15,7 +17,7 @@ class json_object;
  * This function can parse any JSON value type including objects, arrays,
  * strings, numbers, booleans, and null values.
  *
- * @param valueString The JSON string to parse.
+ * @param valueString The JSON string to parse, read in place.
  * @return A shared pointer to the parsed json_object, or nullptr if parsing fails.
  *
  * @note This function handles all JSON value types:
@@ -33,23 +35,24 @@ class json_object;
  * auto obj_val = cppress::json_value("{\"key\": \"value\"}");
  * @endcode
  */
-std::shared_ptr<json_object> json_value(const std::string& valueString);
+std::shared_ptr<json_object> json_value(std::string_view valueString);
 
 /**
  * @brief Parses a complete JSON object from a string.
  *
  * This is the main parsing function that expects a JSON object at the root level.
- * It processes the JSON string, removes comments, and normalizes whitespace before
- * parsing.
+ * The text is parsed in place as a json_document (a vectorized structural
+ * index, then one arena) and copied into json_object values; the input
+ * itself is never copied.
  *
- * @param jsonString The JSON object string to parse (must start with '{').
- * @return An unordered_map containing the key-value pairs of the root object.
+ * @param jsonString The JSON object string to parse (must start with '{'); a
+ *        std::string, a request body view or a data_buffer's bytes
+ * @return The key-value pairs of the root object, in document order.
  * @throws std::runtime_error if the JSON is malformed or doesn't start with an object.
  *
  * @note This function:
- *       - Trims leading/trailing whitespace
- *       - Removes C-style comments (//)
- *       - Removes whitespace outside of string literals
+ *       - Skips whitespace and line and block comments (JSONC) between tokens
+ *       - Decodes \u escapes to UTF-8
  *       - Requires the root to be a JSON object
  *
  * @example
@@ -62,6 +65,6 @@ std::shared_ptr<json_object> json_value(const std::string& valueString);
  * auto data = cppress::parse(json);
  * @endcode
  */
-std::unordered_map<std::string, std::shared_ptr<json_object>> parse(const std::string& jsonString);
+json_flat_map parse(std::string_view jsonString);
 
 }  // namespace cppress
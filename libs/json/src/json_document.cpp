@@ -0,0 +1,506 @@
+#include "../includes/json_document.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <vector>
+
+#include "../includes/json_array.hpp"
+#include "../includes/json_boolean.hpp"
+#include "../includes/json_number.hpp"
+#include "../includes/json_object.hpp"
+#include "../includes/json_scan.hpp"
+#include "../includes/json_string.hpp"
+
+namespace cppress::json {
+
+namespace {
+/// Nesting past this is refused rather than recursed into
+constexpr std::size_t MAX_DEPTH = 1024;
+
+void append_utf8(std::string& out, std::uint32_t code) {
+    if (code < 0x80) {
+        out.push_back(static_cast<char>(code));
+    } else if (code < 0x800) {
+        out.push_back(static_cast<char>(0xC0 | (code >> 6)));
+        out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    } else if (code < 0x10000) {
+        out.push_back(static_cast<char>(0xE0 | (code >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    } else {
+        out.push_back(static_cast<char>(0xF0 | (code >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    }
+}
+}  // namespace
+
+/**
+ * @brief Recursive-descent parser writing json_node values into an arena.
+ *
+ * The children of an open array or object are collected on a scratch
+ * stack shared by every level; when the container closes they are copied
+ * to the arena in one block, so each container's children are contiguous
+ * and the stack's memory is reused for the whole parse.
+ *
+ * Given a structural index (scan::structural_index()), the parser jumps
+ * from token to token instead of stepping over whitespace byte by byte.
+ */
+class json_document_builder {
+public:
+    /**
+     * @param text The document's copy of the input
+     * @param arena Where nodes and decoded strings go
+     * @param index Token starts of text, nullptr to scan the bytes
+     * @param keys Table to intern member names in, nullptr for none
+     */
+    json_document_builder(std::string_view text, std::pmr::memory_resource* arena,
+                          const std::vector<std::uint32_t>* index, json_key_table* keys)
+        : text(text), arena(arena), index(index), keys(keys) {}
+
+    const json_node* build() {
+        json_node root;
+        value(root, 0);
+        skip_space();
+        if (pos != text.size())
+            fail("Unexpected character after the value");
+        auto* top = static_cast<json_node*>(arena->allocate(sizeof(json_node), alignof(json_node)));
+        return new (top) json_node(root);
+    }
+
+private:
+    [[noreturn]] void fail(const std::string& what) const {
+        throw std::runtime_error(what + " at position " + std::to_string(pos));
+    }
+
+    /// Whitespace and comments; with an index, everything up to the next token
+    void skip_space() {
+        if (index) {
+            while (next < index->size() && (*index)[next] < pos)
+                ++next;
+            pos = next < index->size() ? (*index)[next] : text.size();
+            return;
+        }
+        while (pos < text.size()) {
+            const char c = text[pos];
+            if (c == ' ' || c == '\n' || c == '\r' || c == '\t') {
+                ++pos;
+            } else if (c == '/' && pos + 1 < text.size() && text[pos + 1] == '/') {
+                const std::size_t end = text.find('\n', pos);
+                pos = end == std::string_view::npos ? text.size() : end;
+            } else if (c == '/' && pos + 1 < text.size() && text[pos + 1] == '*') {
+                const std::size_t end = text.find("*/", pos + 2);
+                if (end == std::string_view::npos)
+                    fail("Unterminated comment");
+                pos = end + 2;
+            } else {
+                break;
+            }
+        }
+    }
+
+    void value(json_node& out, std::size_t depth) {
+        skip_space();
+        if (pos >= text.size())
+            fail("Unexpected end of input");
+        switch (text[pos]) {
+            case '{':
+                container(out, depth, json_type::object);
+                return;
+            case '[':
+                container(out, depth, json_type::array);
+                return;
+            case '"':
+                string(out);
+                return;
+            case 't':
+                literal("true", out, json_type::boolean);
+                out.boolean = true;
+                return;
+            case 'f':
+                literal("false", out, json_type::boolean);
+                out.boolean = false;
+                return;
+            case 'n':
+                literal("null", out, json_type::null);
+                return;
+            default:
+                number(out);
+        }
+    }
+
+    void literal(std::string_view word, json_node& out, json_type type) {
+        if (text.compare(pos, word.size(), word) != 0)
+            fail("Expected '" + std::string(word) + "'");
+        pos += word.size();
+        out.tag = type;
+        end_of_token();
+    }
+
+    /// A number or literal runs up to whitespace, an operator, a quote or a comment
+    void end_of_token() const {
+        if (pos >= text.size())
+            return;
+        switch (text[pos]) {
+            case ' ':
+            case '\t':
+            case '\n':
+            case '\r':
+            case '{':
+            case '}':
+            case '[':
+            case ']':
+            case ':':
+            case ',':
+            case '"':
+            case '/':
+                return;
+            default:
+                fail("Unexpected character");
+        }
+    }
+
+    /**
+     * Implementation Notes:
+     * - Read straight from the text with std::from_chars: exact, and
+     *   independent of the locale
+     * - Integer text is read as std::int64_t first, a double only past its range
+     */
+    void number(json_node& out) {
+        const std::size_t start = pos;
+        if (pos < text.size() && text[pos] == '-')
+            ++pos;
+        auto digits = [this] {
+            const std::size_t from = pos;
+            while (pos < text.size() && text[pos] >= '0' && text[pos] <= '9')
+                ++pos;
+            return pos > from;
+        };
+        if (!digits())
+            fail("Invalid number format");
+        bool integral = true;
+        if (pos < text.size() && text[pos] == '.') {
+            integral = false;
+            ++pos;
+            if (!digits())
+                fail("Invalid number format");
+        }
+        if (pos < text.size() && (text[pos] == 'e' || text[pos] == 'E')) {
+            integral = false;
+            ++pos;
+            if (pos < text.size() && (text[pos] == '+' || text[pos] == '-'))
+                ++pos;
+            if (!digits())
+                fail("Invalid number format");
+        }
+        out.tag = json_type::number;
+        const char* first = text.data() + start;
+        const char* last = text.data() + pos;
+        if (integral) {
+            const auto [end, error] = std::from_chars(first, last, out.integer);
+            if (error == std::errc() && end == last) {
+                out.length = json_node::INTEGER;
+                end_of_token();
+                return;
+            }
+        }
+        const auto [end, error] = std::from_chars(first, last, out.number);
+        if (error != std::errc() || end != last)
+            fail("Invalid number format");
+        end_of_token();
+    }
+
+    /**
+     * Implementation Notes:
+     * - A string without escapes is a view of the document's copy of the
+     *   input; one with escapes is decoded into scratch, then copied to the arena
+     */
+    void string(json_node& out) {
+        const std::size_t start = ++pos;
+        const std::size_t stop = text.find_first_of("\"\\", start);
+        if (stop == std::string_view::npos)
+            fail("Unterminated string");
+        out.tag = json_type::string;
+        if (text[stop] == '"') {
+            pos = stop + 1;
+            set_length(out, stop - start);
+            out.chars = text.data() + start;
+            return;
+        }
+
+        scratch.assign(text.data() + start, stop - start);
+        pos = stop;
+        for (;;) {
+            if (pos >= text.size())
+                fail("Unterminated string");
+            const char c = text[pos++];
+            if (c == '"')
+                break;
+            if (c != '\\') {
+                scratch.push_back(c);
+                continue;
+            }
+            if (pos >= text.size())
+                fail("Unterminated string");
+            const char next = text[pos++];
+            switch (next) {
+                case 'b':
+                    scratch.push_back('\b');
+                    break;
+                case 'f':
+                    scratch.push_back('\f');
+                    break;
+                case 'n':
+                    scratch.push_back('\n');
+                    break;
+                case 'r':
+                    scratch.push_back('\r');
+                    break;
+                case 't':
+                    scratch.push_back('\t');
+                    break;
+                case 'u': {
+                    std::uint32_t code = hex4();
+                    // a high surrogate followed by its low half is one code point
+                    if (code >= 0xD800 && code < 0xDC00 && text.compare(pos, 2, "\\u") == 0) {
+                        pos += 2;
+                        const std::uint32_t low = hex4();
+                        if (low >= 0xDC00 && low < 0xE000) {
+                            code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                        } else {
+                            append_utf8(scratch, code);
+                            code = low;
+                        }
+                    }
+                    append_utf8(scratch, code);
+                    break;
+                }
+                default:
+                    scratch.push_back(next);
+                    break;
+            }
+        }
+        set_length(out, scratch.size());
+        auto* chars = static_cast<char*>(arena->allocate(scratch.size() ? scratch.size() : 1, 1));
+        std::memcpy(chars, scratch.data(), scratch.size());
+        out.chars = chars;
+    }
+
+    /// Points a member name at its interned copy, if the table takes it
+    void intern(json_node& name) {
+        const json_key key = keys->intern(name.as_string());
+        if (!key)
+            return;
+        name.chars = key.chars;
+        name.key_table = key.table;
+    }
+
+    std::uint32_t hex4() {
+        std::uint32_t code = 0;
+        const char* first = text.data() + pos;
+        const char* last = first + std::min<std::size_t>(4, text.size() - pos);
+        const auto [end, error] = std::from_chars(first, last, code, 16);
+        if (error != std::errc() || end != first + 4)
+            fail("Invalid unicode escape");
+        pos += 4;
+        return code;
+    }
+
+    void container(json_node& out, std::size_t depth, json_type type) {
+        if (depth >= MAX_DEPTH)
+            fail("Nesting too deep");
+        const char close = type == json_type::object ? '}' : ']';
+        const std::size_t mark = stack.size();
+        ++pos;
+        skip_space();
+        if (pos < text.size() && text[pos] == close) {
+            ++pos;
+        } else {
+            for (;;) {
+                json_node node;
+                if (type == json_type::object) {
+                    skip_space();
+                    if (pos >= text.size() || text[pos] != '"')
+                        fail("Expected string key");
+                    string(node);
+                    if (keys)
+                        intern(node);
+                    stack.push_back(node);
+                    skip_space();
+                    if (pos >= text.size() || text[pos] != ':')
+                        fail("Expected ':'");
+                    ++pos;
+                }
+                value(node, depth + 1);
+                stack.push_back(node);
+                skip_space();
+                if (pos < text.size() && text[pos] == close) {
+                    ++pos;
+                    break;
+                }
+                if (pos >= text.size() || text[pos] != ',')
+                    fail(std::string("Expected ',' or '") + close + "'");
+                ++pos;
+            }
+        }
+
+        const std::size_t count = stack.size() - mark;
+        out.tag = type;
+        if (type == json_type::array) {
+            set_length(out, count);
+            auto* elements = static_cast<json_node*>(
+                arena->allocate((count ? count : 1) * sizeof(json_node), alignof(json_node)));
+            std::uninitialized_copy(stack.begin() + static_cast<std::ptrdiff_t>(mark),
+                                    stack.end(), elements);
+            out.children = elements;
+        } else {
+            set_length(out, count / 2);
+            auto* members = static_cast<json_member*>(arena->allocate(
+                (count ? count / 2 : 1) * sizeof(json_member), alignof(json_member)));
+            for (std::size_t i = 0; i < count / 2; ++i)
+                new (members + i) json_member{stack[mark + 2 * i], stack[mark + 2 * i + 1]};
+            out.children = members;
+        }
+        stack.resize(mark);
+    }
+
+    void set_length(json_node& out, std::size_t length) const {
+        if (length > std::numeric_limits<std::uint32_t>::max())
+            fail("Value too large");
+        out.length = static_cast<std::uint32_t>(length);
+    }
+
+    std::string_view text;
+    std::pmr::memory_resource* arena;
+    const std::vector<std::uint32_t>* index;
+    json_key_table* keys;
+    std::size_t pos = 0;
+
+    /// First entry of index not consumed yet
+    std::size_t next = 0;
+
+    /// Children of the containers still open, innermost last
+    std::vector<json_node> stack;
+
+    /// Decoded text of the escaped string being read
+    std::string scratch;
+};
+
+json_document json_document::parse(std::string_view text, json_key_table* keys) {
+    json_document doc;
+    doc.arena = std::make_unique<std::pmr::monotonic_buffer_resource>(text.size() * 3 + 256);
+    auto* copy = static_cast<char*>(doc.arena->allocate(text.size() ? text.size() : 1, 1));
+    std::memcpy(copy, text.data(), text.size());
+    doc.build(std::string_view(copy, text.size()), keys);
+    return doc;
+}
+
+json_document json_document::parse(std::string&& text, json_key_table* keys) {
+    json_document doc;
+    doc.owned = std::make_unique<std::string>(std::move(text));
+    doc.arena = std::make_unique<std::pmr::monotonic_buffer_resource>(doc.owned->size() * 2 + 256);
+    doc.build(*doc.owned, keys);
+    return doc;
+}
+
+json_document json_document::view(std::string_view text, json_key_table* keys) {
+    json_document doc;
+    doc.arena = std::make_unique<std::pmr::monotonic_buffer_resource>(text.size() * 2 + 256);
+    doc.build(text, keys);
+    return doc;
+}
+
+/**
+ * Implementation Notes:
+ * - The arena's first block holds, for typical documents, every node;
+ *   later blocks grow geometrically
+ * - Two stages: the vectorized structural index, then the node build
+ *   walking it; texts the index cannot describe (comments, an unclosed
+ *   string) are built from the bytes, which also reports their errors
+ */
+void json_document::build(std::string_view text, json_key_table* keys) {
+    std::vector<std::uint32_t> index;
+    top = build(text, arena.get(), index, keys);
+}
+
+const json_node* json_document::build(std::string_view text, std::pmr::memory_resource* arena,
+                                      std::vector<std::uint32_t>& index, json_key_table* keys) {
+    const bool indexed = scan::structural_index(text.data(), text.size(), index);
+    json_document_builder builder(text, arena, indexed ? &index : nullptr, keys);
+    return builder.build();
+}
+
+const json_node& json_node::operator[](std::size_t index) const {
+    if (tag != json_type::array || index >= length)
+        throw std::out_of_range("json_node index out of range");
+    return begin()[index];
+}
+
+std::int64_t json_node::as_int64() const noexcept {
+    if (tag != json_type::number)
+        return 0;
+    if (length == INTEGER)
+        return integer;
+    // 2^63, the first double past the range
+    constexpr double limit = 9223372036854775808.0;
+    if (number != number)
+        return 0;
+    if (number >= limit)
+        return std::numeric_limits<std::int64_t>::max();
+    if (number < -limit)
+        return std::numeric_limits<std::int64_t>::min();
+    return static_cast<std::int64_t>(number);
+}
+
+const json_node* json_node::find(std::string_view key) const noexcept {
+    for (const json_member* it = members_end(); it != members_begin();) {
+        --it;
+        if (it->key.as_string() == key)
+            return &it->value;
+    }
+    return nullptr;
+}
+
+const json_node* json_node::find(const json_key& key) const noexcept {
+    for (const json_member* it = members_end(); it != members_begin();) {
+        --it;
+        if (it->key.matches(key))
+            return &it->value;
+    }
+    return nullptr;
+}
+
+std::shared_ptr<json_object> json_node::to_object() const {
+    switch (tag) {
+        case json_type::null:
+            return nullptr;
+        case json_type::boolean:
+            return std::make_shared<json_boolean>(boolean);
+        case json_type::number:
+            if (length == INTEGER)
+                return std::make_shared<json_number>(static_cast<long long>(integer));
+            return std::make_shared<json_number>(number);
+        case json_type::string:
+            return std::make_shared<json_string>(std::string(as_string()));
+        case json_type::array: {
+            auto array = std::make_shared<json_array>();
+            for (const json_node& element : *this)
+                array->push_back(element.to_object());
+            return array;
+        }
+        case json_type::object: {
+            auto object = std::make_shared<json_object>();
+            for (const json_member* it = members_begin(); it != members_end(); ++it)
+                object->insert(std::string(it->key.as_string()), it->value.to_object());
+            return object;
+        }
+    }
+    return nullptr;
+}
+}  // namespace cppress::json
@@ -0,0 +1,121 @@
+#include "../includes/json_flat_map.hpp"
+
+#include <functional>
+#include <stdexcept>
+
+namespace cppress::json {
+
+namespace {
+std::size_t hash_key(std::string_view key) noexcept { return std::hash<std::string_view>{}(key); }
+}  // namespace
+
+/**
+ * Implementation Notes:
+ * - Without an index, each key is compared in turn; std::string's
+ *   comparison checks the lengths first, so most mismatches cost one compare
+ * - With one, linear probing from the key's hash up to an empty slot
+ */
+json_flat_map::size_type json_flat_map::position(std::string_view key) const noexcept {
+    if (slots.empty()) {
+        for (size_type i = 0; i < members.size(); ++i)
+            if (members[i].first == key)
+                return i;
+        return members.size();
+    }
+    const std::size_t mask = slots.size() - 1;
+    for (std::size_t slot = hash_key(key) & mask;; slot = (slot + 1) & mask) {
+        const std::uint32_t entry = slots[slot];
+        if (!entry)
+            return members.size();
+        if (members[entry - 1].first == key)
+            return entry - 1;
+    }
+}
+
+void json_flat_map::index_member(size_type pos) noexcept {
+    const std::size_t mask = slots.size() - 1;
+    std::size_t slot = hash_key(members[pos].first) & mask;
+    while (slots[slot])
+        slot = (slot + 1) & mask;
+    slots[slot] = static_cast<std::uint32_t>(pos + 1);
+}
+
+/**
+ * Implementation Notes:
+ * - The table is the power of two at or above twice the members, so it
+ *   stays at most half full until insert_or_assign() rebuilds it, twice as large
+ */
+void json_flat_map::reindex() {
+    slots.clear();
+    if (members.size() <= INDEX_THRESHOLD)
+        return;
+    std::size_t size = 1;
+    while (size < 2 * members.size())
+        size *= 2;
+    slots.assign(size, 0);
+    for (size_type i = 0; i < members.size(); ++i)
+        index_member(i);
+}
+
+json_flat_map::mapped_type& json_flat_map::at(std::string_view key) {
+    const size_type pos = position(key);
+    if (pos == members.size())
+        throw std::out_of_range("Key not found: " + std::string(key));
+    return members[pos].second;
+}
+
+const json_flat_map::mapped_type& json_flat_map::at(std::string_view key) const {
+    const size_type pos = position(key);
+    if (pos == members.size())
+        throw std::out_of_range("Key not found: " + std::string(key));
+    return members[pos].second;
+}
+
+json_flat_map::mapped_type& json_flat_map::operator[](std::string_view key) {
+    const size_type pos = position(key);
+    if (pos != members.size())
+        return members[pos].second;
+    return insert_or_assign(std::string(key), nullptr).first->second;
+}
+
+std::pair<json_flat_map::iterator, bool> json_flat_map::insert_or_assign(std::string key,
+                                                                         mapped_type value) {
+    const size_type pos = position(key);
+    if (pos != members.size()) {
+        members[pos].second = std::move(value);
+        return {members.begin() + static_cast<difference_type>(pos), false};
+    }
+    members.emplace_back(std::move(key), std::move(value));
+    if (members.size() > INDEX_THRESHOLD) {
+        if (slots.size() < 2 * members.size())
+            reindex();
+        else
+            index_member(members.size() - 1);
+    }
+    return {members.end() - 1, true};
+}
+
+json_flat_map::size_type json_flat_map::erase(std::string_view key) {
+    const size_type pos = position(key);
+    if (pos == members.size())
+        return 0;
+    erase(members.begin() + static_cast<difference_type>(pos));
+    return 1;
+}
+
+/**
+ * Implementation Notes:
+ * - The members after it move down one place, so the index is rebuilt
+ */
+json_flat_map::iterator json_flat_map::erase(const_iterator it) {
+    const auto next = members.erase(it);
+    const auto pos = next - members.begin();
+    reindex();
+    return members.begin() + pos;
+}
+
+void json_flat_map::clear() noexcept {
+    members.clear();
+    slots.clear();
+}
+}  // namespace cppress::json
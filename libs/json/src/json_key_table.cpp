@@ -0,0 +1,109 @@
+#include "../includes/json_key_table.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <mutex>
+
+namespace cppress::json {
+
+namespace {
+std::size_t hash_name(std::string_view name) noexcept {
+    return std::hash<std::string_view>{}(name);
+}
+
+/**
+ * Implementation Notes:
+ * - Serials tell tables apart in json_node, which has 16 bits for one;
+ *   past that, tables get 0 and their names are compared as text
+ */
+std::uint16_t next_serial() noexcept {
+    static std::atomic<std::uint32_t> counter{0};
+    const std::uint32_t serial = counter.fetch_add(1, std::memory_order_relaxed) + 1;
+    return serial <= 0xFFFF ? static_cast<std::uint16_t>(serial) : 0;
+}
+}  // namespace
+
+json_key_table::json_key_table(std::size_t capacity) : json_key_table(capacity, false) {}
+
+/**
+ * Implementation Notes:
+ * - The slot table is sized for the capacity up front, a power of two at
+ *   least twice it, so it is never rebuilt and stays at most half full
+ */
+json_key_table::json_key_table(std::size_t capacity, bool shared)
+    : limit(std::min(capacity, MAX_CAPACITY)), serial(next_serial()) {
+    std::size_t size = 2;
+    while (size < 2 * limit)
+        size *= 2;
+    slots.assign(size, 0);
+    if (shared)
+        mutex = std::make_unique<std::shared_mutex>();
+}
+
+json_key_table& json_key_table::global() {
+    static json_key_table table(DEFAULT_CAPACITY, true);
+    return table;
+}
+
+json_key json_key_table::lookup(std::string_view name, std::size_t& slot) const noexcept {
+    const std::size_t mask = slots.size() - 1;
+    for (slot = hash_name(name) & mask;; slot = (slot + 1) & mask) {
+        const std::uint16_t id = slots[slot];
+        if (!id)
+            return json_key();
+        if (keys[id - 1].view() == name)
+            return keys[id - 1];
+    }
+}
+
+/**
+ * Implementation Notes:
+ * - A shared table is searched under a shared lock first: once the names
+ *   in use are in, interning takes no exclusive lock
+ */
+json_key json_key_table::intern(std::string_view name) {
+    if (name.size() > MAX_KEY_SIZE)
+        return json_key();
+    std::size_t slot = 0;
+    if (mutex) {
+        std::shared_lock<std::shared_mutex> lock(*mutex);
+        if (const json_key key = lookup(name, slot))
+            return key;
+    }
+    std::unique_lock<std::shared_mutex> lock;
+    if (mutex)
+        lock = std::unique_lock<std::shared_mutex>(*mutex);
+    if (const json_key key = lookup(name, slot))
+        return key;
+    if (keys.size() >= limit)
+        return json_key();
+
+    json_key key;
+    auto* chars = static_cast<char*>(text.allocate(name.size() ? name.size() : 1, 1));
+    std::memcpy(chars, name.data(), name.size());
+    key.chars = chars;
+    key.length = static_cast<std::uint32_t>(name.size());
+    key.table = serial;
+    key.number = static_cast<std::uint16_t>(keys.size() + 1);
+    keys.push_back(key);
+    slots[slot] = key.number;
+    return key;
+}
+
+json_key json_key_table::find(std::string_view name) const {
+    std::shared_lock<std::shared_mutex> lock;
+    if (mutex)
+        lock = std::shared_lock<std::shared_mutex>(*mutex);
+    std::size_t slot = 0;
+    return lookup(name, slot);
+}
+
+std::size_t json_key_table::size() const {
+    std::shared_lock<std::shared_mutex> lock;
+    if (mutex)
+        lock = std::shared_lock<std::shared_mutex>(*mutex);
+    return keys.size();
+}
+}  // namespace cppress::json
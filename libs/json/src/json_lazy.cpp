@@ -0,0 +1,543 @@
+#include "../includes/json_lazy.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <limits>
+#include <memory_resource>
+#include <stdexcept>
+#include <vector>
+
+#include "../includes/json_array.hpp"
+#include "../includes/json_boolean.hpp"
+#include "../includes/json_number.hpp"
+#include "../includes/json_object.hpp"
+#include "../includes/json_scan.hpp"
+#include "../includes/json_string.hpp"
+
+namespace cppress::json {
+
+namespace {
+/// Nesting past this is refused, as json_document refuses it
+constexpr std::size_t MAX_DEPTH = 1024;
+
+void append_utf8(std::string& out, std::uint32_t code) {
+    if (code < 0x80) {
+        out.push_back(static_cast<char>(code));
+    } else if (code < 0x800) {
+        out.push_back(static_cast<char>(0xC0 | (code >> 6)));
+        out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    } else if (code < 0x10000) {
+        out.push_back(static_cast<char>(0xE0 | (code >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    } else {
+        out.push_back(static_cast<char>(0xF0 | (code >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    }
+}
+
+bool is_space(char c) noexcept { return c == ' ' || c == '\n' || c == '\r' || c == '\t'; }
+
+bool is_operator(char c) noexcept {
+    return c == '{' || c == '}' || c == '[' || c == ']' || c == ':' || c == ',';
+}
+
+/// A number or literal runs up to whitespace, an operator, a quote or a comment
+bool ends_token(char c) noexcept { return is_space(c) || is_operator(c) || c == '"' || c == '/'; }
+
+/// The first byte of a string, number or literal
+bool starts_scalar(char c) noexcept {
+    return c == '"' || c == 't' || c == 'f' || c == 'n' || c == '-' || (c >= '0' && c <= '9');
+}
+
+[[noreturn]] void fail(const std::string& what, std::size_t pos) {
+    throw std::runtime_error(what + " at position " + std::to_string(pos));
+}
+
+/**
+ * @brief Token starts of a text the vectorized index refused, byte by byte
+ *
+ * The same offsets scan::structural_index() gives, with comments skipped;
+ * unterminated strings and comments are reported here.
+ */
+void index_bytes(std::string_view text, std::vector<std::uint32_t>& starts) {
+    if (text.size() >= std::numeric_limits<std::uint32_t>::max())
+        fail("Document too large", 0);
+    starts.clear();
+    std::size_t pos = 0;
+    while (pos < text.size()) {
+        const char c = text[pos];
+        if (is_space(c)) {
+            ++pos;
+        } else if (c == '/' && pos + 1 < text.size() && text[pos + 1] == '/') {
+            const std::size_t end = text.find('\n', pos);
+            pos = end == std::string_view::npos ? text.size() : end;
+        } else if (c == '/' && pos + 1 < text.size() && text[pos + 1] == '*') {
+            const std::size_t end = text.find("*/", pos + 2);
+            if (end == std::string_view::npos)
+                fail("Unterminated comment", pos);
+            pos = end + 2;
+        } else if (is_operator(c)) {
+            starts.push_back(static_cast<std::uint32_t>(pos++));
+        } else if (c == '"') {
+            starts.push_back(static_cast<std::uint32_t>(pos));
+            for (++pos;; pos += 2) {
+                pos = text.find_first_of("\"\\", pos);
+                if (pos == std::string_view::npos)
+                    fail("Unterminated string", starts.back());
+                if (text[pos] == '"')
+                    break;
+            }
+            ++pos;
+        } else {
+            // a lone '/' is a token of its own, refused as a value
+            starts.push_back(static_cast<std::uint32_t>(pos++));
+            while (pos < text.size() && !ends_token(text[pos]))
+                ++pos;
+        }
+    }
+}
+
+/**
+ * @brief Check a number token, as json_document reads numbers
+ * @param[out] integral Set if the number has neither fraction nor exponent
+ */
+bool valid_number(std::string_view token, bool& integral) noexcept {
+    std::size_t i = 0;
+    auto digits = [&] {
+        const std::size_t from = i;
+        while (i < token.size() && token[i] >= '0' && token[i] <= '9')
+            ++i;
+        return i > from;
+    };
+    if (i < token.size() && token[i] == '-')
+        ++i;
+    if (!digits())
+        return false;
+    integral = true;
+    if (i < token.size() && token[i] == '.') {
+        integral = false;
+        ++i;
+        if (!digits())
+            return false;
+    }
+    if (i < token.size() && (token[i] == 'e' || token[i] == 'E')) {
+        integral = false;
+        ++i;
+        if (i < token.size() && (token[i] == '+' || token[i] == '-'))
+            ++i;
+        if (!digits())
+            return false;
+    }
+    return i == token.size();
+}
+
+/// A number read from its token
+struct number_token {
+    bool integer = false;
+    std::int64_t exact = 0;
+    double value = 0;
+};
+}  // namespace
+
+/**
+ * @brief The text of a json_lazy_document and what its index records.
+ */
+struct json_lazy_value::state {
+    /// Text given to parse(), when the document owns it
+    std::string owned;
+    std::string_view text;
+
+    /// Offset of every token in text
+    std::vector<std::uint32_t> starts;
+
+    /// For an entry where a value starts, the entry following the value:
+    /// its ',' or closing bracket, or the end of starts for the root
+    std::vector<std::uint32_t> next;
+
+    /// Escaped strings once decoded; kept until the document goes
+    mutable std::pmr::monotonic_buffer_resource decoded;
+
+    char byte(std::uint32_t entry) const noexcept { return text[starts[entry]]; }
+
+    /// The number or literal starting at entry, up to its delimiter
+    std::string_view token(std::uint32_t entry) const noexcept {
+        const std::size_t from = starts[entry];
+        std::size_t to = from;
+        while (to < text.size() && !ends_token(text[to]))
+            ++to;
+        return text.substr(from, to - from);
+    }
+
+    number_token number(std::uint32_t entry) const;
+
+    /// The decoded text of the string starting at entry: a view of text
+    /// without escapes, of scratch otherwise
+    std::string_view string(std::uint32_t entry, std::string& scratch) const;
+};
+
+/**
+ * Implementation Notes:
+ * - Integer text is read as std::int64_t first, a double only past its
+ *   range, as json_document reads it
+ */
+number_token json_lazy_value::state::number(std::uint32_t entry) const {
+    const std::string_view text = token(entry);
+    number_token out;
+    bool integral = false;
+    if (!valid_number(text, integral))
+        fail("Invalid number format", starts[entry]);
+    const char* first = text.data();
+    const char* last = first + text.size();
+    if (integral) {
+        const auto [end, error] = std::from_chars(first, last, out.exact);
+        if (error == std::errc() && end == last) {
+            out.integer = true;
+            out.value = static_cast<double>(out.exact);
+            return out;
+        }
+    }
+    const auto [end, error] = std::from_chars(first, last, out.value);
+    if (error != std::errc() || end != last)
+        fail("Invalid number format", starts[entry]);
+    return out;
+}
+
+/**
+ * Implementation Notes:
+ * - The index guarantees the string is closed; only its escapes are checked
+ */
+std::string_view json_lazy_value::state::string(std::uint32_t entry, std::string& scratch) const {
+    const std::size_t start = starts[entry] + 1;
+    std::size_t pos = text.find_first_of("\"\\", start);
+    if (text[pos] == '"')
+        return text.substr(start, pos - start);
+
+    scratch.assign(text.data() + start, pos - start);
+    auto hex4 = [&] {
+        std::uint32_t code = 0;
+        const char* first = text.data() + pos;
+        const char* last = first + std::min<std::size_t>(4, text.size() - pos);
+        const auto [end, error] = std::from_chars(first, last, code, 16);
+        if (error != std::errc() || end != first + 4)
+            fail("Invalid unicode escape", pos);
+        pos += 4;
+        return code;
+    };
+    for (;;) {
+        const char c = text[pos++];
+        if (c == '"')
+            return scratch;
+        if (c != '\\') {
+            scratch.push_back(c);
+            continue;
+        }
+        const char next = text[pos++];
+        switch (next) {
+            case 'b':
+                scratch.push_back('\b');
+                break;
+            case 'f':
+                scratch.push_back('\f');
+                break;
+            case 'n':
+                scratch.push_back('\n');
+                break;
+            case 'r':
+                scratch.push_back('\r');
+                break;
+            case 't':
+                scratch.push_back('\t');
+                break;
+            case 'u': {
+                std::uint32_t code = hex4();
+                // a high surrogate followed by its low half is one code point
+                if (code >= 0xD800 && code < 0xDC00 && text.compare(pos, 2, "\\u") == 0) {
+                    pos += 2;
+                    const std::uint32_t low = hex4();
+                    if (low >= 0xDC00 && low < 0xE000) {
+                        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                    } else {
+                        append_utf8(scratch, code);
+                        code = low;
+                    }
+                }
+                append_utf8(scratch, code);
+                break;
+            }
+            default:
+                scratch.push_back(next);
+                break;
+        }
+    }
+}
+
+json_lazy_document::json_lazy_document() : doc(std::make_unique<json_lazy_value::state>()) {}
+json_lazy_document::json_lazy_document(json_lazy_document&&) noexcept = default;
+json_lazy_document& json_lazy_document::operator=(json_lazy_document&&) noexcept = default;
+json_lazy_document::~json_lazy_document() = default;
+
+json_lazy_document json_lazy_document::parse(std::string_view text) {
+    json_lazy_document out;
+    out.doc->owned.assign(text);
+    out.doc->text = out.doc->owned;
+    out.build();
+    return out;
+}
+
+json_lazy_document json_lazy_document::parse(std::string&& text) {
+    json_lazy_document out;
+    out.doc->owned = std::move(text);
+    out.doc->text = out.doc->owned;
+    out.build();
+    return out;
+}
+
+json_lazy_document json_lazy_document::view(std::string_view text) {
+    json_lazy_document out;
+    out.doc->text = text;
+    out.build();
+    return out;
+}
+
+/**
+ * Implementation Notes:
+ * - One pass over the index with a stack of the open containers' entries;
+ *   a container's entry in next is set when it closes
+ * - Texts the vectorized index cannot describe (comments, an unclosed
+ *   string) are indexed byte by byte, which also reports their errors
+ */
+void json_lazy_document::build() {
+    auto& d = *doc;
+    if (!scan::structural_index(d.text.data(), d.text.size(), d.starts))
+        index_bytes(d.text, d.starts);
+    const auto count = static_cast<std::uint32_t>(d.starts.size());
+    d.next.assign(count, count);
+
+    enum class expect { value, value_or_close, key, key_or_close, colon, comma_or_close, done };
+    expect state = expect::value;
+    std::vector<std::uint32_t> open;
+    auto after_value = [&] { state = open.empty() ? expect::done : expect::comma_or_close; };
+
+    for (std::uint32_t i = 0; i < count; ++i) {
+        const char c = d.byte(i);
+        if ((c == '}' || c == ']') &&
+            (state == expect::value_or_close || state == expect::key_or_close ||
+             state == expect::comma_or_close)) {
+            if (d.byte(open.back()) != (c == '}' ? '{' : '['))
+                fail(std::string("Unexpected '") + c + "'", d.starts[i]);
+            d.next[open.back()] = i + 1;
+            open.pop_back();
+            after_value();
+            continue;
+        }
+        switch (state) {
+            case expect::value:
+            case expect::value_or_close:
+                if (c == '{' || c == '[') {
+                    if (open.size() >= MAX_DEPTH)
+                        fail("Nesting too deep", d.starts[i]);
+                    open.push_back(i);
+                    state = c == '{' ? expect::key_or_close : expect::value_or_close;
+                } else if (starts_scalar(c)) {
+                    d.next[i] = i + 1;
+                    after_value();
+                } else {
+                    fail("Unexpected character", d.starts[i]);
+                }
+                break;
+            case expect::key:
+            case expect::key_or_close:
+                if (c != '"')
+                    fail("Expected string key", d.starts[i]);
+                state = expect::colon;
+                break;
+            case expect::colon:
+                if (c != ':')
+                    fail("Expected ':'", d.starts[i]);
+                state = expect::value;
+                break;
+            case expect::comma_or_close:
+                if (c != ',') {
+                    const char close = d.byte(open.back()) == '{' ? '}' : ']';
+                    fail(std::string("Expected ',' or '") + close + "'", d.starts[i]);
+                }
+                state = d.byte(open.back()) == '{' ? expect::key : expect::value;
+                break;
+            case expect::done:
+                fail("Unexpected character after the value", d.starts[i]);
+        }
+    }
+    if (state != expect::done)
+        fail("Unexpected end of input", d.text.size());
+}
+
+json_type json_lazy_value::type() const noexcept {
+    switch (doc->byte(at)) {
+        case '{':
+            return json_type::object;
+        case '[':
+            return json_type::array;
+        case '"':
+            return json_type::string;
+        case 't':
+        case 'f':
+            return json_type::boolean;
+        case 'n':
+            return json_type::null;
+        default:
+            return json_type::number;
+    }
+}
+
+bool json_lazy_value::as_boolean() const {
+    if (!is_boolean())
+        return false;
+    const std::string_view word = doc->token(at);
+    if (word != "true" && word != "false")
+        fail("Expected 'true' or 'false'", doc->starts[at]);
+    return word == "true";
+}
+
+double json_lazy_value::as_number() const {
+    return is_number() ? doc->number(at).value : 0;
+}
+
+bool json_lazy_value::is_integer() const { return is_number() && doc->number(at).integer; }
+
+std::int64_t json_lazy_value::as_int64() const {
+    if (!is_number())
+        return 0;
+    const number_token number = doc->number(at);
+    if (number.integer)
+        return number.exact;
+    // 2^63, the first double past the range
+    constexpr double limit = 9223372036854775808.0;
+    if (number.value >= limit)
+        return std::numeric_limits<std::int64_t>::max();
+    if (number.value < -limit)
+        return std::numeric_limits<std::int64_t>::min();
+    return static_cast<std::int64_t>(number.value);
+}
+
+std::string_view json_lazy_value::as_string() const {
+    if (!is_string())
+        return {};
+    std::string scratch;
+    const std::string_view text = doc->string(at, scratch);
+    if (text.data() != scratch.data())
+        return text;
+    auto* chars = static_cast<char*>(doc->decoded.allocate(scratch.size() ? scratch.size() : 1, 1));
+    std::memcpy(chars, scratch.data(), scratch.size());
+    return {chars, scratch.size()};
+}
+
+std::uint32_t json_lazy_value::last() const noexcept {
+    return is_array() || is_object() ? doc->next[at] - 1 : at + 1;
+}
+
+std::size_t json_lazy_value::size() const noexcept {
+    if (is_array())
+        return static_cast<std::size_t>(std::distance(begin(), end()));
+    if (is_object())
+        return static_cast<std::size_t>(std::distance(members_begin(), members_end()));
+    return 0;
+}
+
+json_lazy_value json_lazy_value::operator[](std::size_t index) const {
+    auto it = begin();
+    for (; it != end() && index; --index)
+        ++it;
+    if (it == end())
+        throw std::out_of_range("json_lazy_value index out of range");
+    return *it;
+}
+
+/**
+ * Implementation Notes:
+ * - Every name is compared, to find the last of repeated ones; a name
+ *   without escapes is compared where it lies
+ */
+std::optional<json_lazy_value> json_lazy_value::find(std::string_view key) const {
+    std::optional<json_lazy_value> found;
+    std::string scratch;
+    for (auto it = members_begin(); it != members_end(); ++it) {
+        const json_lazy_member member = *it;
+        if (doc->string(member.key.at, scratch) == key)
+            found = member.value;
+    }
+    return found;
+}
+
+json_lazy_iterator json_lazy_value::begin() const noexcept {
+    return is_array() ? json_lazy_iterator(doc, at + 1) : end();
+}
+
+json_lazy_iterator json_lazy_value::end() const noexcept {
+    return {doc, is_array() ? last() : at};
+}
+
+json_lazy_member_iterator json_lazy_value::members_begin() const noexcept {
+    return is_object() ? json_lazy_member_iterator(doc, at + 1) : members_end();
+}
+
+json_lazy_member_iterator json_lazy_value::members_end() const noexcept {
+    return {doc, is_object() ? last() : at};
+}
+
+/// Past the value to its ',' or closing bracket, past a ',' to the next value
+json_lazy_iterator& json_lazy_iterator::operator++() noexcept {
+    at = doc->next[at];
+    if (doc->byte(at) == ',')
+        ++at;
+    return *this;
+}
+
+json_lazy_member_iterator& json_lazy_member_iterator::operator++() noexcept {
+    at = doc->next[at + 2];
+    if (doc->byte(at) == ',')
+        ++at;
+    return *this;
+}
+
+std::shared_ptr<json_object> json_lazy_value::to_object() const {
+    switch (type()) {
+        case json_type::null:
+            if (doc->token(at) != "null")
+                fail("Expected 'null'", doc->starts[at]);
+            return nullptr;
+        case json_type::boolean:
+            return std::make_shared<json_boolean>(as_boolean());
+        case json_type::number: {
+            const number_token number = doc->number(at);
+            if (number.integer)
+                return std::make_shared<json_number>(static_cast<long long>(number.exact));
+            return std::make_shared<json_number>(number.value);
+        }
+        case json_type::string: {
+            std::string scratch;
+            return std::make_shared<json_string>(std::string(doc->string(at, scratch)));
+        }
+        case json_type::array: {
+            auto array = std::make_shared<json_array>();
+            for (const json_lazy_value element : *this)
+                array->push_back(element.to_object());
+            return array;
+        }
+        case json_type::object: {
+            auto object = std::make_shared<json_object>();
+            std::string scratch;
+            for (auto it = members_begin(); it != members_end(); ++it) {
+                const json_lazy_member member = *it;
+                object->insert(std::string(doc->string(member.key.at, scratch)),
+                               member.value.to_object());
+            }
+            return object;
+        }
+    }
+    return nullptr;
+}
+}  // namespace cppress::json
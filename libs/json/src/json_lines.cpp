@@ -0,0 +1,210 @@
+#include "../includes/json_lines.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+#include "thread_pool.hpp"
+
+namespace cppress::json {
+
+namespace {
+/// The records of a batch and the chunks they are cut into
+struct batch {
+    std::vector<std::string_view> lines;
+    /// First record of each chunk, then the number of records
+    std::vector<std::size_t> chunks;
+
+    std::size_t chunk_count() const noexcept { return chunks.size() - 1; }
+
+    /// Bytes from the first record of a chunk to the end of its last
+    std::size_t chunk_bytes(std::size_t chunk) const noexcept {
+        const std::string_view first = lines[chunks[chunk]];
+        const std::string_view last = lines[chunks[chunk + 1] - 1];
+        return static_cast<std::size_t>(last.data() + last.size() - first.data());
+    }
+};
+
+/**
+ * Implementation Notes:
+ * - memchr() finds each line feed, vectorized by the C library; a line of
+ *   spaces, tabs and carriage returns only is skipped
+ */
+batch split(std::string_view text) {
+    batch out;
+    out.chunks.push_back(0);
+    std::size_t bytes = 0;
+    for (std::size_t pos = 0; pos < text.size();) {
+        const void* feed = std::memchr(text.data() + pos, '\n', text.size() - pos);
+        const std::size_t end =
+            feed ? static_cast<std::size_t>(static_cast<const char*>(feed) - text.data())
+                 : text.size();
+        const std::string_view line = text.substr(pos, end - pos);
+        pos = end + 1;
+        if (line.find_first_not_of(" \t\r") == std::string_view::npos)
+            continue;
+        out.lines.push_back(line);
+        bytes += line.size();
+        if (bytes >= json_lines::CHUNK_SIZE) {
+            out.chunks.push_back(out.lines.size());
+            bytes = 0;
+        }
+    }
+    if (out.chunks.back() != out.lines.size())
+        out.chunks.push_back(out.lines.size());
+    return out;
+}
+
+/// A parse error, with the record and the line it is on
+std::exception_ptr record_error(std::string_view text, std::string_view line, std::size_t record,
+                                const std::exception& e) {
+    const auto number = 1 + std::count(text.data(), line.data(), '\n');
+    return std::make_exception_ptr(std::runtime_error("Record " + std::to_string(record) +
+                                                      " (line " + std::to_string(number) +
+                                                      "): " + e.what()));
+}
+
+/**
+ * @brief Chunks handed out to the calling thread and the pool's tasks.
+ *
+ * Shared with the tasks, which may start after the call returned: a late
+ * task finds every chunk claimed and touches nothing else.
+ */
+struct chunk_run {
+    using processor = std::function<void(std::size_t chunk, chunk_run& run)>;
+
+    chunk_run(std::size_t count, processor process) : count(count), process(std::move(process)) {}
+
+    /// Claims chunks until none is left
+    void work() {
+        for (;;) {
+            const std::size_t chunk = next.fetch_add(1, std::memory_order_relaxed);
+            if (chunk >= count)
+                return;
+            process(chunk, *this);
+            if (finished.fetch_add(1, std::memory_order_acq_rel) + 1 == count) {
+                std::lock_guard<std::mutex> lock(mutex);
+                done.notify_all();
+            }
+        }
+    }
+
+    /// Keeps the error of the earliest record
+    void fail(std::size_t record, std::exception_ptr e) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (record < first_failed.load(std::memory_order_relaxed)) {
+            error = std::move(e);
+            first_failed.store(record, std::memory_order_relaxed);
+        }
+    }
+
+    /// Whether a record before this one failed; later ones need not be read
+    bool after_failure(std::size_t record) const noexcept {
+        return record > first_failed.load(std::memory_order_relaxed);
+    }
+
+    const std::size_t count;
+    /// Reads one chunk; refers to the caller's state, so is called only for a claimed chunk
+    const processor process;
+    std::atomic<std::size_t> next{0};
+    std::atomic<std::size_t> finished{0};
+    std::atomic<std::size_t> first_failed{std::numeric_limits<std::size_t>::max()};
+    std::mutex mutex;
+    std::condition_variable done;
+    std::exception_ptr error;
+};
+
+/**
+ * Implementation Notes:
+ * - One task per worker at most, each claiming chunks in turn; chunks are
+ *   claimed in order, so those before a failed record are always read and
+ *   the error reported is the earliest one
+ * - The caller waits only for chunks already claimed, which are running
+ */
+void run_chunks(std::size_t count, shared::thread_pool* pool,
+                chunk_run::processor process) {
+    if (count == 0)
+        return;
+    auto run = std::make_shared<chunk_run>(count, std::move(process));
+    const std::size_t helpers = pool ? std::min(pool->size(), count - 1) : 0;
+    for (std::size_t i = 0; i < helpers; ++i)
+        pool->enqueue([run] { run->work(); });
+    run->work();
+    {
+        std::unique_lock<std::mutex> lock(run->mutex);
+        run->done.wait(lock, [&] {
+            return run->finished.load(std::memory_order_acquire) == run->count;
+        });
+    }
+    if (run->error)
+        std::rethrow_exception(run->error);
+}
+}  // namespace
+
+json_lines json_lines::parse(std::string_view text, shared::thread_pool* pool) {
+    json_lines out;
+    const batch work = split(text);
+    out.records.resize(work.lines.size());
+    out.arenas.resize(work.chunk_count());
+    run_chunks(work.chunk_count(), pool, [&](std::size_t chunk, chunk_run& run) {
+        auto arena = std::make_unique<std::pmr::monotonic_buffer_resource>(
+            work.chunk_bytes(chunk) * 2 + 256);
+        std::vector<std::uint32_t> index;
+        for (std::size_t i = work.chunks[chunk]; i < work.chunks[chunk + 1]; ++i) {
+            if (run.after_failure(i))
+                return;
+            try {
+                out.records[i] = json_document::build(work.lines[i], arena.get(), index);
+            } catch (const std::exception& e) {
+                run.fail(i, record_error(text, work.lines[i], i, e));
+                return;
+            }
+        }
+        out.arenas[chunk] = std::move(arena);
+    });
+    return out;
+}
+
+/**
+ * Implementation Notes:
+ * - Each chunk's arena starts on a buffer sized for its longest record and
+ *   is released after every record, back to that buffer: a batch of any
+ *   size is parsed in memory bounded by its chunks
+ */
+void json_lines::for_each(std::string_view text, const json_record_handler& handler,
+                          shared::thread_pool* pool) {
+    const batch work = split(text);
+    run_chunks(work.chunk_count(), pool, [&](std::size_t chunk, chunk_run& run) {
+        std::size_t longest = 0;
+        for (std::size_t i = work.chunks[chunk]; i < work.chunks[chunk + 1]; ++i)
+            longest = std::max(longest, work.lines[i].size());
+        std::vector<std::byte> buffer(longest * 2 + 256);
+        std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size());
+        std::vector<std::uint32_t> index;
+        for (std::size_t i = work.chunks[chunk]; i < work.chunks[chunk + 1]; ++i) {
+            if (run.after_failure(i))
+                return;
+            const json_node* root = nullptr;
+            try {
+                root = json_document::build(work.lines[i], &arena, index);
+            } catch (const std::exception& e) {
+                run.fail(i, record_error(text, work.lines[i], i, e));
+                return;
+            }
+            try {
+                handler(i, *root);
+            } catch (...) {
+                run.fail(i, std::current_exception());
+                return;
+            }
+            arena.release();
+        }
+    });
+}
+}  // namespace cppress::json
@@ -7,9 +7,7 @@ namespace cppress::json {
 
 json_object::json_object() = default;
 json_object::~json_object() = default;
-json_object::json_object(
-    const std::unordered_map<std::string, std::shared_ptr<json_object>>& initial_data)
-    : data(initial_data) {}
+json_object::json_object(const json_flat_map& initial_data) : data(initial_data) {}
 
 bool json_object::set_json_data(const std::string& jsonString) {
     try {
@@ -24,25 +22,39 @@ bool json_object::set_json_data(const std::string& jsonString) {
 }
 
 std::string json_object::stringify() const {
-    std::string result = "{";
-
-    // Add key-value pairs to the JSON object
-    for (const auto& pair : data) {
-        if (!pair.second) {
-            result += "\"" + pair.first + "\":null,";
-        } else {
-            result += "\"" + pair.first + "\":" + pair.second->stringify() + ",";
-        }
-    }
-    if (!data.empty()) {
-        result.pop_back();  // Remove trailing comma
-    }
-    result += "}";
+    std::string result;
+    result.reserve(stringified_size());
+    stringify_to(result);
     return result;
 }
 
+void json_object::stringify_to(std::string& out) const {
+    json_writer writer(out);
+    write_to(writer);
+}
+
+void json_object::write_to(json_writer& out) const {
+    out.start_object();
+    for (const auto& pair : data)
+        out.key(pair.first).value(pair.second);
+    out.end_object();
+}
+
+/**
+ * Implementation Notes:
+ * - Mirrors write_to(): braces, a comma between members, and per member
+ *   the escaped key, the colon and the value (or null)
+ */
+json_object::size_type json_object::stringified_size() const {
+    size_type size = 2 + (data.empty() ? 0 : data.size() - 1);
+    for (const auto& pair : data)
+        size += json_writer::escaped_size(pair.first) + 1 +
+                (pair.second ? pair.second->stringified_size() : 4);
+    return size;
+}
+
 void json_object::insert(const std::string& key, std::shared_ptr<json_object> value) {
-    data[key] = value;  // This will overwrite existing keys
+    data.insert_or_assign(key, std::move(value));  // This will overwrite existing keys
 }
 
 json_object::size_type json_object::erase(const std::string& key) {
@@ -119,15 +131,16 @@ json_object::const_iterator json_object::find(const std::string& key) const {
 }
 
 // Legacy compatibility
-const std::unordered_map<std::string, std::shared_ptr<json_object>>& json_object::get_data() const {
+const json_flat_map& json_object::get_data() const {
     return data;
 }
 
 std::shared_ptr<json_object>& json_object::operator[](const std::string& key) {
-    if (data.find(key) == data.end()) {
-        data[key] = std::make_shared<json_object>();
+    auto it = data.find(key);
+    if (it == data.end()) {
+        it = data.insert_or_assign(key, std::make_shared<json_object>()).first;
     }
-    return data[key];
+    return it->second;
 }
 
 bool json_object::has_key(const std::string& key) const {
@@ -0,0 +1,297 @@
+#include "../includes/json_query.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <stdexcept>
+
+#include "../includes/json_array.hpp"
+#include "../includes/json_object.hpp"
+
+namespace cppress::json {
+
+namespace {
+[[noreturn]] void fail(const std::string& what, std::string_view text, std::size_t pos) {
+    throw std::runtime_error(what + " in '" + std::string(text) + "' at position " +
+                             std::to_string(pos));
+}
+
+/// The array index a token spells: "0" or digits without a leading zero
+std::size_t array_index(std::string_view token, std::size_t none) noexcept {
+    if (token.empty() || (token[0] == '0' && token.size() > 1))
+        return none;
+    std::size_t index = none;
+    const auto [end, error] = std::from_chars(token.data(), token.data() + token.size(), index);
+    return error == std::errc() && end == token.data() + token.size() ? index : none;
+}
+
+/// Decodes the %XX escapes of a URI fragment
+std::string percent_decode(std::string_view text) {
+    std::string out;
+    out.reserve(text.size());
+    for (std::size_t i = 0; i < text.size(); ++i) {
+        if (text[i] != '%') {
+            out.push_back(text[i]);
+            continue;
+        }
+        unsigned code = 0;
+        const char* first = text.data() + i + 1;
+        const char* last = first + std::min<std::size_t>(2, text.size() - i - 1);
+        const auto [end, error] = std::from_chars(first, last, code, 16);
+        if (error != std::errc() || end != first + 2)
+            fail("Invalid percent escape", text, i);
+        out.push_back(static_cast<char>(code));
+        i += 2;
+    }
+    return out;
+}
+}  // namespace
+
+/**
+ * Implementation Notes:
+ * - Each token is unescaped once here; a token that spells an array index
+ *   also records it, as the step selects a member or an element by the
+ *   type of the value it meets
+ */
+json_query json_query::pointer(std::string_view text) {
+    std::string decoded;
+    if (!text.empty() && text[0] == '#') {
+        decoded = percent_decode(text.substr(1));
+        text = decoded;
+    }
+    if (!text.empty() && text[0] != '/')
+        fail("A JSON pointer starts with '/'", text, 0);
+
+    json_query query;
+    for (std::size_t pos = 0; pos < text.size();) {
+        std::size_t end = text.find('/', pos + 1);
+        if (end == std::string_view::npos)
+            end = text.size();
+        step token;
+        for (std::size_t i = pos + 1; i < end; ++i) {
+            if (text[i] != '~') {
+                token.name.push_back(text[i]);
+            } else if (i + 1 < end && (text[i + 1] == '0' || text[i + 1] == '1')) {
+                token.name.push_back(text[++i] == '0' ? '~' : '/');
+            } else {
+                fail("'~' is not followed by '0' or '1'", text, i);
+            }
+        }
+        token.index = array_index(token.name, NO_INDEX);
+        query.steps.push_back(std::move(token));
+        pos = end;
+    }
+    return query;
+}
+
+json_query json_query::path(std::string_view text) {
+    json_query query;
+    std::size_t pos = 0;
+    const bool rooted = !text.empty() && text[0] == '$';
+    if (rooted)
+        ++pos;
+    auto name_until_delimiter = [&] {
+        const std::size_t from = pos;
+        pos = std::min(text.find_first_of(".[", pos), text.size());
+        if (pos == from)
+            fail("Expected a member name", text, pos);
+        query.steps.push_back({std::string(text.substr(from, pos - from)), NO_INDEX, true});
+    };
+    if (!rooted && pos < text.size() && text[pos] != '.' && text[pos] != '[')
+        name_until_delimiter();
+
+    while (pos < text.size()) {
+        if (text[pos] == '.') {
+            ++pos;
+            name_until_delimiter();
+            continue;
+        }
+        if (text[pos] != '[')
+            fail("Expected '.' or '['", text, pos);
+        ++pos;
+        if (pos < text.size() && (text[pos] == '\'' || text[pos] == '"')) {
+            const char quote = text[pos++];
+            step member;
+            for (;; ++pos) {
+                if (pos >= text.size())
+                    fail("Unterminated name", text, pos);
+                if (text[pos] == quote)
+                    break;
+                if (text[pos] == '\\' && pos + 1 < text.size())
+                    ++pos;
+                member.name.push_back(text[pos]);
+            }
+            ++pos;
+            query.steps.push_back(std::move(member));
+        } else {
+            const std::size_t close = std::min(text.find(']', pos), text.size());
+            const std::size_t index = array_index(text.substr(pos, close - pos), NO_INDEX);
+            if (index == NO_INDEX)
+                fail("Expected an index or a quoted name", text, pos);
+            query.steps.push_back({std::string(), index, false});
+            pos = close;
+        }
+        if (pos >= text.size() || text[pos] != ']')
+            fail("Expected ']'", text, pos);
+        ++pos;
+    }
+    return query;
+}
+
+/**
+ * Implementation Notes:
+ * - The walk holds raw pointers; the one slot returned is not copied either
+ */
+const std::shared_ptr<json_object>* json_query::find(
+    const std::shared_ptr<json_object>& root) const {
+    const std::shared_ptr<json_object>* slot = &root;
+    for (const step& s : steps) {
+        const json_object* value = slot->get();
+        if (!value)
+            return nullptr;
+        if (const auto* array = dynamic_cast<const json_array*>(value)) {
+            if (s.index >= array->size())
+                return nullptr;
+            slot = &(*array)[s.index];
+            continue;
+        }
+        // a string, number or boolean has no members, find() fails on it
+        const auto it = value->find(s.name);
+        if (!s.by_name || it == value->end())
+            return nullptr;
+        slot = &it->second;
+    }
+    return slot;
+}
+
+const json_node* json_query::find(const json_node& root) const noexcept {
+    const json_node* node = &root;
+    for (const step& s : steps) {
+        if (node->is_array()) {
+            if (s.index >= node->size())
+                return nullptr;
+            node = node->begin() + s.index;
+        } else if (s.by_name) {
+            node = node->find(s.name);
+            if (!node)
+                return nullptr;
+        } else {
+            return nullptr;
+        }
+    }
+    return node;
+}
+
+std::optional<json_lazy_value> json_query::find(const json_lazy_value& root) const {
+    std::optional<json_lazy_value> value = root;
+    for (const step& s : steps) {
+        if (value->is_array()) {
+            auto it = value->begin();
+            for (std::size_t i = 0; it != value->end() && i < s.index; ++i)
+                ++it;
+            if (it == value->end())
+                return std::nullopt;
+            value = *it;
+        } else if (s.by_name) {
+            value = value->find(s.name);
+            if (!value)
+                return std::nullopt;
+        } else {
+            return std::nullopt;
+        }
+    }
+    return value;
+}
+
+std::string json_query::to_pointer() const {
+    std::string out;
+    for (const step& s : steps) {
+        out += '/';
+        if (!s.by_name) {
+            out += std::to_string(s.index);
+            continue;
+        }
+        for (const char c : s.name) {
+            if (c == '~')
+                out += "~0";
+            else if (c == '/')
+                out += "~1";
+            else
+                out += c;
+        }
+    }
+    return out;
+}
+
+/**
+ * Implementation Notes:
+ * - One level is searched at a time: the members or elements of the value
+ *   the steps matched so far lead to; everything else is skipped unread
+ * - A matching element's first event is also the first event of the value
+ *   the next step looks into, so it is handled again without reading on
+ */
+json_event json_query_cursor::seek(json_reader& in) {
+    const auto& steps = query.steps;
+    json_event event = json_event::need_more;
+    bool held = false;
+    for (;;) {
+        if (state == where::found || state == where::missing)
+            return json_event::end;
+        if (!held) {
+            event = in.next();
+            if (event == json_event::need_more)
+                return event;
+        }
+        held = false;
+        if (event == json_event::end) {
+            state = where::missing;
+            return event;
+        }
+        switch (state) {
+            case where::value:
+                if (matched == steps.size()) {
+                    state = where::found;
+                    return event;
+                }
+                if (event == json_event::start_object && steps[matched].by_name) {
+                    state = where::members;
+                } else if (event == json_event::start_array &&
+                           steps[matched].index != json_query::NO_INDEX) {
+                    state = where::elements;
+                    count = 0;
+                } else {
+                    state = where::missing;
+                    return json_event::end;
+                }
+                break;
+            case where::members:
+                if (event != json_event::key) {
+                    state = where::missing;
+                    return json_event::end;
+                }
+                if (in.text() == steps[matched].name) {
+                    ++matched;
+                    state = where::value;
+                } else {
+                    in.skip();
+                }
+                break;
+            case where::elements:
+                if (event == json_event::end_array) {
+                    state = where::missing;
+                    return json_event::end;
+                }
+                if (count++ == steps[matched].index) {
+                    ++matched;
+                    state = where::value;
+                    held = true;
+                } else if (event == json_event::start_object ||
+                           event == json_event::start_array) {
+                    in.skip();
+                }
+                break;
+            default:
+                break;
+        }
+    }
+}
+}  // namespace cppress::json
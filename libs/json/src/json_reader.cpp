@@ -0,0 +1,552 @@
+#include "../includes/json_reader.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <stdexcept>
+
+namespace cppress::json {
+
+namespace {
+void append_utf8(std::string& out, std::uint32_t code) {
+    if (code < 0x80) {
+        out.push_back(static_cast<char>(code));
+    } else if (code < 0x800) {
+        out.push_back(static_cast<char>(0xC0 | (code >> 6)));
+        out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    } else if (code < 0x10000) {
+        out.push_back(static_cast<char>(0xE0 | (code >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    } else {
+        out.push_back(static_cast<char>(0xF0 | (code >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    }
+}
+
+bool is_space(char c) noexcept { return c == ' ' || c == '\n' || c == '\r' || c == '\t'; }
+
+/// A byte a number may contain
+bool in_number(char c) noexcept {
+    return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+}
+
+/**
+ * @brief Check a number token, as json_document reads numbers
+ * @param[out] integral Set if the number has neither fraction nor exponent
+ */
+bool valid_number(std::string_view token, bool& integral) noexcept {
+    std::size_t i = 0;
+    auto digits = [&] {
+        const std::size_t from = i;
+        while (i < token.size() && token[i] >= '0' && token[i] <= '9')
+            ++i;
+        return i > from;
+    };
+    if (i < token.size() && token[i] == '-')
+        ++i;
+    if (!digits())
+        return false;
+    integral = true;
+    if (i < token.size() && token[i] == '.') {
+        integral = false;
+        ++i;
+        if (!digits())
+            return false;
+    }
+    if (i < token.size() && (token[i] == 'e' || token[i] == 'E')) {
+        integral = false;
+        ++i;
+        if (i < token.size() && (token[i] == '+' || token[i] == '-'))
+            ++i;
+        if (!digits())
+            return false;
+    }
+    return i == token.size();
+}
+}  // namespace
+
+/**
+ * Implementation Notes:
+ * - A piece fed after the last one was used up is read in place; otherwise
+ *   the unread bytes, at most one unfinished token, move to carry first
+ */
+void json_reader::feed(std::string_view piece) {
+    const std::string_view rest = input.substr(pos);
+    consumed += pos;
+    if (rest.empty()) {
+        carry.clear();
+        input = piece;
+        owned = false;
+    } else {
+        if (owned)
+            carry.erase(0, pos);
+        else
+            carry.assign(rest);
+        carry.append(piece);
+        input = carry;
+        owned = true;
+    }
+    pos = 0;
+}
+
+json_event json_reader::next() {
+    if (!error.empty())
+        throw std::runtime_error(error);
+    last = read();
+    return last;
+}
+
+void json_reader::skip() noexcept {
+    if (last == json_event::start_object || last == json_event::start_array)
+        skip_to = open.size() - 1;
+    else if (last == json_event::key)
+        skip_value = true;
+    last = json_event::need_more;
+}
+
+/**
+ * Implementation Notes:
+ * - A token cut by the end of the input is read again from its start once
+ *   more is fed, except a string, whose search resumes where it stopped
+ * - A skipped member's value is read like any other, without being
+ *   reported; a skipped container is handed to skip_through()
+ */
+json_event json_reader::read() {
+    for (;;) {
+        if (skip_to != NO_SKIP) {
+            if (skip_through())
+                continue;
+            if (finished)
+                fail("Unexpected end of input");
+            return suspend();
+        }
+        if (!space()) {
+            if (!finished)
+                return suspend();
+            if (in_comment == comment::block)
+                fail("Unterminated comment");
+            if (state == expect::done)
+                return json_event::end;
+            fail("Unexpected end of input");
+        }
+
+        const char c = input[pos];
+        switch (state) {
+            case expect::done:
+                fail("Unexpected character after the value");
+            case expect::colon:
+                if (c != ':')
+                    fail("Expected ':'");
+                ++pos;
+                state = expect::value;
+                continue;
+            case expect::comma_or_close:
+                if (c == ',') {
+                    ++pos;
+                    state = open.back() == '}' ? expect::key : expect::value;
+                    continue;
+                }
+                if (c != open.back())
+                    fail(std::string("Expected ',' or '") + open.back() + "'");
+                return close();
+            case expect::key_or_close:
+                if (c == '}')
+                    return close();
+                [[fallthrough]];
+            case expect::key:
+                if (c != '"')
+                    fail("Expected string key");
+                if (!string())
+                    return suspend();
+                state = expect::colon;
+                return json_event::key;
+            case expect::value_or_close:
+                if (c == ']')
+                    return close();
+                [[fallthrough]];
+            case expect::value:
+                break;
+        }
+
+        json_event event;
+        if (!value_token(c, event))
+            return suspend();
+        if (!skip_value)
+            return event;
+        skip_value = false;
+        if (event == json_event::start_object || event == json_event::start_array)
+            skip_to = open.size() - 1;
+    }
+}
+
+bool json_reader::value_token(char c, json_event& event) {
+    switch (c) {
+        case '{':
+            push('}');
+            ++pos;
+            state = expect::key_or_close;
+            event = json_event::start_object;
+            return true;
+        case '[':
+            push(']');
+            ++pos;
+            state = expect::value_or_close;
+            event = json_event::start_array;
+            return true;
+        case '"':
+            if (!string())
+                return false;
+            event = json_event::string;
+            break;
+        case 't':
+        case 'f':
+            if (!literal(c == 't' ? "true" : "false"))
+                return false;
+            flag = c == 't';
+            event = json_event::boolean;
+            break;
+        case 'n':
+            if (!literal("null"))
+                return false;
+            event = json_event::null;
+            break;
+        default:
+            if (!number_token())
+                return false;
+            event = json_event::number;
+    }
+    after_value();
+    return true;
+}
+
+json_event json_reader::close() {
+    const char c = input[pos++];
+    open.pop_back();
+    after_value();
+    return c == '}' ? json_event::end_object : json_event::end_array;
+}
+
+void json_reader::push(char close) {
+    if (open.size() >= MAX_DEPTH)
+        fail("Nesting too deep");
+    open.push_back(close);
+}
+
+[[noreturn]] void json_reader::fail(const std::string& what) {
+    error = what + " at position " + std::to_string(offset());
+    throw std::runtime_error(error);
+}
+
+json_event json_reader::suspend() {
+    if (!owned) {
+        carry.assign(input.substr(pos));
+        consumed += pos;
+        input = carry;
+        pos = 0;
+        owned = true;
+    }
+    return json_event::need_more;
+}
+
+bool json_reader::space() {
+    while (pos < input.size()) {
+        if (in_comment == comment::line) {
+            const std::size_t end = input.find('\n', pos);
+            if (end == std::string_view::npos) {
+                pos = input.size();
+                return false;
+            }
+            pos = end + 1;
+            in_comment = comment::none;
+            continue;
+        }
+        if (in_comment == comment::block) {
+            while (pos < input.size() && in_comment == comment::block) {
+                const char c = input[pos++];
+                if (star && c == '/')
+                    in_comment = comment::none;
+                star = c == '*';
+            }
+            continue;
+        }
+        const char c = input[pos];
+        if (is_space(c)) {
+            ++pos;
+            continue;
+        }
+        if (c != '/')
+            return true;
+        // a lone '/' at the very end is left to the caller to refuse
+        if (pos + 1 >= input.size())
+            return finished;
+        if (input[pos + 1] == '/')
+            in_comment = comment::line;
+        else if (input[pos + 1] == '*')
+            in_comment = comment::block;
+        else
+            return true;
+        pos += 2;
+        star = false;
+    }
+    return false;
+}
+
+/**
+ * Implementation Notes:
+ * - Outside strings only quotes, brackets and comments matter, inside only
+ *   quotes and backslashes; both are found with find_first_of() rather
+ *   than a loop over every byte
+ */
+bool json_reader::skip_through() {
+    while (pos < input.size()) {
+        if (skip_string) {
+            if (skip_escape) {
+                skip_escape = false;
+                ++pos;
+                continue;
+            }
+            const std::size_t stop = input.find_first_of("\"\\", pos);
+            if (stop == std::string_view::npos) {
+                pos = input.size();
+                return false;
+            }
+            pos = stop + 1;
+            if (input[stop] == '\\')
+                skip_escape = true;
+            else
+                skip_string = false;
+            continue;
+        }
+        if (in_comment != comment::none) {
+            if (!space())
+                return false;
+            continue;
+        }
+
+        const std::size_t stop = input.find_first_of("\"{}[]/", pos);
+        if (stop == std::string_view::npos) {
+            pos = input.size();
+            return false;
+        }
+        pos = stop;
+        const char c = input[pos];
+        switch (c) {
+            case '"':
+                skip_string = true;
+                ++pos;
+                break;
+            case '{':
+                push('}');
+                ++pos;
+                break;
+            case '[':
+                push(']');
+                ++pos;
+                break;
+            case '/':
+                if (!space())
+                    return false;
+                if (input[pos] == '/')
+                    fail("Unexpected character '/'");
+                break;
+            default:
+                if (c != open.back())
+                    fail(std::string("Expected '") + open.back() + "'");
+                ++pos;
+                open.pop_back();
+                if (open.size() == skip_to) {
+                    skip_to = NO_SKIP;
+                    after_value();
+                    return true;
+                }
+        }
+    }
+    return false;
+}
+
+bool json_reader::string() {
+    std::size_t i = pos + 1 + scanned;
+    for (;;) {
+        const std::size_t stop = input.find_first_of("\"\\", i);
+        if (stop == std::string_view::npos || (input[stop] == '\\' && stop + 1 >= input.size())) {
+            if (finished)
+                fail("Unterminated string");
+            // a cut escape is searched again
+            scanned = (stop == std::string_view::npos ? input.size() : stop) - pos - 1;
+            return false;
+        }
+        if (input[stop] == '"') {
+            i = stop;
+            break;
+        }
+        escapes = true;
+        i = stop + 2;
+    }
+
+    const std::string_view body = input.substr(pos + 1, i - pos - 1);
+    if (escapes) {
+        decode(body);
+        current = decoded;
+    } else {
+        current = body;
+    }
+    pos = i + 1;
+    scanned = 0;
+    escapes = false;
+    return true;
+}
+
+void json_reader::decode(std::string_view body) {
+    decoded.clear();
+    auto hex4 = [&](std::size_t& i) {
+        std::uint32_t code = 0;
+        const char* first = body.data() + i;
+        const char* last = first + std::min<std::size_t>(4, body.size() - i);
+        const auto [end, error] = std::from_chars(first, last, code, 16);
+        if (error != std::errc() || end != first + 4)
+            fail("Invalid unicode escape");
+        i += 4;
+        return code;
+    };
+    for (std::size_t i = 0; i < body.size();) {
+        const char c = body[i++];
+        if (c != '\\') {
+            decoded.push_back(c);
+            continue;
+        }
+        const char next = body[i++];
+        switch (next) {
+            case 'b':
+                decoded.push_back('\b');
+                break;
+            case 'f':
+                decoded.push_back('\f');
+                break;
+            case 'n':
+                decoded.push_back('\n');
+                break;
+            case 'r':
+                decoded.push_back('\r');
+                break;
+            case 't':
+                decoded.push_back('\t');
+                break;
+            case 'u': {
+                std::uint32_t code = hex4(i);
+                // a high surrogate followed by its low half is one code point
+                if (code >= 0xD800 && code < 0xDC00 && body.compare(i, 2, "\\u") == 0) {
+                    i += 2;
+                    const std::uint32_t low = hex4(i);
+                    if (low >= 0xDC00 && low < 0xE000) {
+                        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                    } else {
+                        append_utf8(decoded, code);
+                        code = low;
+                    }
+                }
+                append_utf8(decoded, code);
+                break;
+            }
+            default:
+                decoded.push_back(next);
+                break;
+        }
+    }
+}
+
+bool json_reader::number_token() {
+    std::size_t end = pos;
+    while (end < input.size() && in_number(input[end]))
+        ++end;
+    if (end == input.size() && !finished)
+        return false;
+
+    const std::string_view token = input.substr(pos, end - pos);
+    bool integral = false;
+    if (!valid_number(token, integral))
+        fail("Invalid number format");
+    const char* first = token.data();
+    const char* last = first + token.size();
+    exact_valid = false;
+    if (integral) {
+        const auto [stop, error] = std::from_chars(first, last, exact);
+        exact_valid = error == std::errc() && stop == last;
+    }
+    if (exact_valid) {
+        value = static_cast<double>(exact);
+    } else {
+        const auto [stop, error] = std::from_chars(first, last, value);
+        if (error != std::errc() || stop != last)
+            fail("Invalid number format");
+    }
+    current = token;
+    pos = end;
+    return true;
+}
+
+bool json_reader::literal(std::string_view word) {
+    if (input.compare(pos, word.size(), word) != 0) {
+        const std::string_view rest = input.substr(pos);
+        if (!finished && rest.size() < word.size() && word.compare(0, rest.size(), rest) == 0)
+            return false;
+        fail("Expected '" + std::string(word) + "'");
+    }
+    pos += word.size();
+    return true;
+}
+
+void json_sax_parser::feed(std::string_view piece) {
+    reader.feed(piece);
+    drain();
+}
+
+void json_sax_parser::finish() {
+    reader.finish();
+    drain();
+}
+
+void json_sax_parser::drain() {
+    for (;;) {
+        switch (reader.next()) {
+            case json_event::need_more:
+            case json_event::end:
+                return;
+            case json_event::start_object:
+                if (!handler.start_object())
+                    reader.skip();
+                break;
+            case json_event::end_object:
+                handler.end_object();
+                break;
+            case json_event::start_array:
+                if (!handler.start_array())
+                    reader.skip();
+                break;
+            case json_event::end_array:
+                handler.end_array();
+                break;
+            case json_event::key:
+                if (!handler.key(reader.text()))
+                    reader.skip();
+                break;
+            case json_event::string:
+                handler.string(reader.text());
+                break;
+            case json_event::number:
+                if (reader.is_integer())
+                    handler.integer(reader.integer());
+                else
+                    handler.number(reader.number());
+                break;
+            case json_event::boolean:
+                handler.boolean(reader.boolean());
+                break;
+            case json_event::null:
+                handler.null();
+                break;
+        }
+    }
+}
+}  // namespace cppress::json
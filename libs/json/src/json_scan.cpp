@@ -0,0 +1,310 @@
+#include "../includes/json_scan.hpp"
+
+#include <array>
+#include <cstring>
+#include <limits>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define CPPRESS_JSON_SCAN_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define CPPRESS_JSON_SCAN_NEON 1
+#endif
+
+namespace cppress::json::scan {
+
+namespace {
+/// One bit per byte of a 64-byte block, for each class of byte
+struct block_masks {
+    std::uint64_t quote;
+    std::uint64_t backslash;
+    /// { } [ ] : ,
+    std::uint64_t op;
+    /// Space, tab, line feed, carriage return
+    std::uint64_t space;
+    std::uint64_t slash;
+};
+
+/// Byte classes, one bit each
+enum : std::uint8_t { QUOTE = 1, BACKSLASH = 2, OP = 4, SPACE = 8, SLASH = 16, CONTROL = 32 };
+
+constexpr std::array<std::uint8_t, 256> make_classes() {
+    std::array<std::uint8_t, 256> t{};
+    for (unsigned c = 0; c < 0x20; ++c)
+        t[c] = CONTROL;
+    t['"'] = QUOTE;
+    t['\\'] = BACKSLASH;
+    for (unsigned char c : {'{', '}', '[', ']', ':', ','})
+        t[c] = OP;
+    for (unsigned char c : {' ', '\t', '\n', '\r'})
+        t[c] |= SPACE;
+    t['/'] = SLASH;
+    return t;
+}
+
+constexpr std::array<std::uint8_t, 256> classes = make_classes();
+
+block_masks classify_scalar(const char* p) noexcept {
+    block_masks m{};
+    for (unsigned i = 0; i < 64; ++i) {
+        const std::uint8_t c = classes[static_cast<unsigned char>(p[i])];
+        const std::uint64_t bit = std::uint64_t(1) << i;
+        m.quote |= (c & QUOTE) ? bit : 0;
+        m.backslash |= (c & BACKSLASH) ? bit : 0;
+        m.op |= (c & OP) ? bit : 0;
+        m.space |= (c & SPACE) ? bit : 0;
+        m.slash |= (c & SLASH) ? bit : 0;
+    }
+    return m;
+}
+
+std::size_t plain_scalar(const char* p, std::size_t n) noexcept {
+    std::size_t i = 0;
+    while (i < n && !(classes[static_cast<unsigned char>(p[i])] & (QUOTE | BACKSLASH | CONTROL)))
+        ++i;
+    return i;
+}
+
+#if CPPRESS_JSON_SCAN_X86
+__attribute__((target("avx2"))) inline std::uint64_t avx2_eq(__m256i lo, __m256i hi,
+                                                            char c) noexcept {
+    const __m256i v = _mm256_set1_epi8(c);
+    const auto a = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, v)));
+    const auto b = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, v)));
+    return std::uint64_t(a) | std::uint64_t(b) << 32;
+}
+
+/**
+ * Two 32-byte loads, one compare per byte class; '[' and '{' (and ']'
+ * and '}') differ only in bit 0x20, so setting that bit folds each pair
+ * into one compare.
+ */
+__attribute__((target("avx2"))) block_masks classify_avx2(const char* p) noexcept {
+    const __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    const __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32));
+    const __m256i case_bit = _mm256_set1_epi8(0x20);
+    const __m256i lo_folded = _mm256_or_si256(lo, case_bit);
+    const __m256i hi_folded = _mm256_or_si256(hi, case_bit);
+    block_masks m;
+    m.quote = avx2_eq(lo, hi, '"');
+    m.backslash = avx2_eq(lo, hi, '\\');
+    m.op = avx2_eq(lo_folded, hi_folded, '{') | avx2_eq(lo_folded, hi_folded, '}') |
+           avx2_eq(lo, hi, ':') | avx2_eq(lo, hi, ',');
+    m.space = avx2_eq(lo, hi, ' ') | avx2_eq(lo, hi, '\t') | avx2_eq(lo, hi, '\n') |
+              avx2_eq(lo, hi, '\r');
+    m.slash = avx2_eq(lo, hi, '/');
+    return m;
+}
+
+/// A byte is below 0x20 when the unsigned maximum with 0x1F leaves 0x1F
+__attribute__((target("avx2"))) std::size_t plain_avx2(const char* p, std::size_t n) noexcept {
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i control = _mm256_set1_epi8(0x1F);
+    std::size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        const __m256i hit = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, backslash)),
+            _mm256_cmpeq_epi8(_mm256_max_epu8(v, control), control));
+        const auto mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(hit));
+        if (mask)
+            return i + static_cast<std::size_t>(__builtin_ctz(mask));
+    }
+    return i + plain_scalar(p + i, n - i);
+}
+#endif
+
+#if CPPRESS_JSON_SCAN_NEON
+/// Compare results of 64 bytes to one bit each: weight the lanes, then add pairwise
+inline std::uint64_t neon_bits(uint8x16_t m0, uint8x16_t m1, uint8x16_t m2,
+                               uint8x16_t m3) noexcept {
+    const uint8x16_t weights = {0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80,
+                                0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80};
+    uint8x16_t sum0 = vpaddq_u8(vandq_u8(m0, weights), vandq_u8(m1, weights));
+    uint8x16_t sum1 = vpaddq_u8(vandq_u8(m2, weights), vandq_u8(m3, weights));
+    sum0 = vpaddq_u8(sum0, sum1);
+    sum0 = vpaddq_u8(sum0, sum0);
+    return vgetq_lane_u64(vreinterpretq_u64_u8(sum0), 0);
+}
+
+inline std::uint64_t neon_eq(const uint8x16_t* b, std::uint8_t c) noexcept {
+    const uint8x16_t v = vdupq_n_u8(c);
+    return neon_bits(vceqq_u8(b[0], v), vceqq_u8(b[1], v), vceqq_u8(b[2], v), vceqq_u8(b[3], v));
+}
+
+block_masks classify_neon(const char* p) noexcept {
+    const auto* u = reinterpret_cast<const std::uint8_t*>(p);
+    const uint8x16_t b[4] = {vld1q_u8(u), vld1q_u8(u + 16), vld1q_u8(u + 32), vld1q_u8(u + 48)};
+    const uint8x16_t case_bit = vdupq_n_u8(0x20);
+    const uint8x16_t folded[4] = {vorrq_u8(b[0], case_bit), vorrq_u8(b[1], case_bit),
+                                  vorrq_u8(b[2], case_bit), vorrq_u8(b[3], case_bit)};
+    block_masks m;
+    m.quote = neon_eq(b, '"');
+    m.backslash = neon_eq(b, '\\');
+    m.op = neon_eq(folded, '{') | neon_eq(folded, '}') | neon_eq(b, ':') | neon_eq(b, ',');
+    m.space = neon_eq(b, ' ') | neon_eq(b, '\t') | neon_eq(b, '\n') | neon_eq(b, '\r');
+    m.slash = neon_eq(b, '/');
+    return m;
+}
+
+/// 16 bytes are tested at once, the one to escape is then found among them
+std::size_t plain_neon(const char* p, std::size_t n) noexcept {
+    const auto* u = reinterpret_cast<const std::uint8_t*>(p);
+    const uint8x16_t quote = vdupq_n_u8('"');
+    const uint8x16_t backslash = vdupq_n_u8('\\');
+    const uint8x16_t control = vdupq_n_u8(0x20);
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const uint8x16_t v = vld1q_u8(u + i);
+        const uint8x16_t hit = vorrq_u8(vorrq_u8(vceqq_u8(v, quote), vceqq_u8(v, backslash)),
+                                        vcltq_u8(v, control));
+        if (vmaxvq_u8(hit))
+            return i + plain_scalar(p + i, 16);
+    }
+    return i + plain_scalar(p + i, n - i);
+}
+#endif
+
+/**
+ * Bytes escaped by a backslash, as simdjson finds them: a subtraction
+ * separates backslash runs starting on even and on odd bytes, so each
+ * run's last escape is known without looping over the run.
+ * @param backslash Backslashes of the block
+ * @param[in,out] carried 1 if the block's first byte is escaped by the previous block
+ */
+inline std::uint64_t escaped_bytes(std::uint64_t backslash, std::uint64_t& carried) noexcept {
+    constexpr std::uint64_t ODD_BITS = 0xAAAAAAAAAAAAAAAAULL;
+    const std::uint64_t potential = backslash & ~carried;
+    const std::uint64_t escape_and_code = (((potential << 1) | ODD_BITS) - potential) ^ ODD_BITS;
+    const std::uint64_t escaped = escape_and_code ^ (backslash | carried);
+    carried = (escape_and_code & backslash) >> 63;
+    return escaped;
+}
+
+/// Bit i is the XOR of bits 0 to i: 1 from an opening quote up to its closing one
+inline std::uint64_t prefix_xor(std::uint64_t x) noexcept {
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+using classify_fn = block_masks (*)(const char*) noexcept;
+using plain_fn = std::size_t (*)(const char*, std::size_t) noexcept;
+
+struct implementation {
+    level which;
+    classify_fn classify;
+    plain_fn plain;
+};
+
+implementation pick(level l) noexcept {
+    switch (l) {
+#if CPPRESS_JSON_SCAN_X86
+        case level::avx2:
+            return {level::avx2, classify_avx2, plain_avx2};
+#endif
+#if CPPRESS_JSON_SCAN_NEON
+        case level::neon:
+            return {level::neon, classify_neon, plain_neon};
+#endif
+        default:
+            return {level::scalar, classify_scalar, plain_scalar};
+    }
+}
+
+level detect() noexcept {
+#if CPPRESS_JSON_SCAN_X86
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? level::avx2 : level::scalar;
+#elif CPPRESS_JSON_SCAN_NEON
+    return level::neon;
+#else
+    return level::scalar;
+#endif
+}
+
+const level detected = detect();
+implementation current = pick(detected);
+}  // namespace
+
+/**
+ * Implementation Notes:
+ * - A token starts outside strings at an operator, at an opening quote,
+ *   or at a byte that is none of those nor whitespace and follows an
+ *   operator, whitespace or a quote; the rest of a number or literal is
+ *   not indexed, the second stage checks that the token ends at a delimiter
+ * - Quote, escape and boundary state carry from block to block; the last
+ *   partial block is padded with spaces
+ */
+bool structural_index(const char* p, std::size_t n, std::vector<std::uint32_t>& index) {
+    index.clear();
+    if (n >= std::numeric_limits<std::uint32_t>::max())
+        return false;
+    index.reserve(n / 4 + 1);
+
+    std::uint64_t escape_carry = 0;
+    std::uint64_t string_carry = 0;
+    // the start of the text counts as following whitespace
+    std::uint64_t boundary_carry = 1;
+    char tail[64];
+    for (std::size_t base = 0; base < n; base += 64) {
+        const char* block = p + base;
+        if (n - base < 64) {
+            std::memset(tail, ' ', sizeof(tail));
+            std::memcpy(tail, block, n - base);
+            block = tail;
+        }
+        const block_masks m = current.classify(block);
+
+        const std::uint64_t quote = m.quote & ~escaped_bytes(m.backslash, escape_carry);
+        const std::uint64_t in_string = prefix_xor(quote) ^ string_carry;
+        string_carry = static_cast<std::uint64_t>(static_cast<std::int64_t>(in_string) >> 63);
+        const std::uint64_t outside = ~in_string;
+        if (m.slash & outside)
+            return false;
+
+        const std::uint64_t op = m.op & outside;
+        const std::uint64_t boundary = op | m.space | quote;
+        const std::uint64_t follows_boundary = boundary << 1 | boundary_carry;
+        boundary_carry = boundary >> 63;
+
+        std::uint64_t starts = op | (quote & in_string) | (follows_boundary & ~boundary & outside);
+        while (starts) {
+            index.push_back(static_cast<std::uint32_t>(base + __builtin_ctzll(starts)));
+            starts &= starts - 1;
+        }
+    }
+    return string_carry == 0;
+}
+
+std::size_t plain_prefix(const char* p, std::size_t n) noexcept { return current.plain(p, n); }
+
+level active() noexcept { return current.which; }
+
+level best() noexcept { return detected; }
+
+bool use(level l) noexcept {
+    if (l != level::scalar && l != detected)
+        return false;
+    current = pick(l);
+    return true;
+}
+
+const char* name(level l) noexcept {
+    switch (l) {
+        case level::scalar:
+            return "scalar";
+        case level::avx2:
+            return "avx2";
+        case level::neon:
+            return "neon";
+    }
+    return "unknown";
+}
+}  // namespace cppress::json::scan
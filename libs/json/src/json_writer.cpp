@@ -0,0 +1,214 @@
+#include "../includes/json_writer.hpp"
+
+#include <charconv>
+#include <cmath>
+
+#include "../includes/json_document.hpp"
+#include "../includes/json_object.hpp"
+#include "../includes/json_scan.hpp"
+
+namespace cppress::json {
+
+namespace {
+/// 2^63, the first double past the range of long long
+constexpr double TWO_POW_63 = 9223372036854775808.0;
+
+/// Letter following the backslash that escapes c, 0 if c takes a \u escape
+char short_escape(char c) noexcept {
+    switch (c) {
+        case '\\':
+            return '\\';
+        case '"':
+            return '"';
+        case '\n':
+            return 'n';
+        case '\r':
+            return 'r';
+        case '\t':
+            return 't';
+        case '\b':
+            return 'b';
+        case '\f':
+            return 'f';
+        default:
+            return 0;
+    }
+}
+}  // namespace
+
+json_writer::json_writer(json_sink sink, std::size_t chunk_size)
+    : out(&buffer), sink(std::move(sink)), chunk_size(chunk_size ? chunk_size : 1) {
+    // room for the value that crosses the chunk size
+    buffer.reserve(2 * this->chunk_size);
+}
+
+json_writer& json_writer::start_object() {
+    separate();
+    *out += '{';
+    return *this;
+}
+
+json_writer& json_writer::end_object() {
+    *out += '}';
+    done();
+    return *this;
+}
+
+json_writer& json_writer::start_array() {
+    separate();
+    *out += '[';
+    return *this;
+}
+
+json_writer& json_writer::end_array() {
+    *out += ']';
+    done();
+    return *this;
+}
+
+json_writer& json_writer::key(std::string_view name) {
+    separate();
+    append_escaped(name);
+    *out += ':';
+    return *this;
+}
+
+json_writer& json_writer::string(std::string_view value) {
+    separate();
+    append_escaped(value);
+    done();
+    return *this;
+}
+
+json_writer& json_writer::number(double value) {
+    separate();
+    char digits[NUMBER_CHARS];
+    out->append(digits, format_number(value, digits));
+    done();
+    return *this;
+}
+
+json_writer& json_writer::integer(std::int64_t value) {
+    separate();
+    char digits[NUMBER_CHARS];
+    out->append(digits, format_integer(value, digits));
+    done();
+    return *this;
+}
+
+json_writer& json_writer::boolean(bool value) {
+    separate();
+    *out += value ? "true" : "false";
+    done();
+    return *this;
+}
+
+json_writer& json_writer::null() {
+    separate();
+    *out += "null";
+    done();
+    return *this;
+}
+
+json_writer& json_writer::value(const json_object& value) {
+    value.write_to(*this);
+    return *this;
+}
+
+json_writer& json_writer::value(const std::shared_ptr<json_object>& value) {
+    return value ? this->value(*value) : null();
+}
+
+json_writer& json_writer::value(const json_node& value) {
+    switch (value.type()) {
+        case json_type::null:
+            return null();
+        case json_type::boolean:
+            return boolean(value.as_boolean());
+        case json_type::number:
+            return value.is_integer() ? integer(value.as_int64()) : number(value.as_number());
+        case json_type::string:
+            return string(value.as_string());
+        case json_type::array:
+            start_array();
+            for (const json_node& element : value)
+                this->value(element);
+            return end_array();
+        case json_type::object:
+            start_object();
+            for (const json_member* it = value.members_begin(); it != value.members_end(); ++it)
+                key(it->key.as_string()).value(it->value);
+            return end_object();
+    }
+    return *this;
+}
+
+json_writer& json_writer::raw(std::string_view json) {
+    separate();
+    out->append(json);
+    done();
+    return *this;
+}
+
+void json_writer::flush() {
+    if (!sink || buffer.empty())
+        return;
+    sink(std::move(buffer));
+    buffer = std::string();
+    buffer.reserve(2 * chunk_size);
+}
+
+/**
+ * Implementation Notes:
+ * - scan::plain_prefix() finds the next byte to escape; the run before it
+ *   is appended with one copy
+ * - Control characters without a short escape are written as \u00XX
+ */
+void json_writer::append_escaped(std::string_view value) {
+    static constexpr char HEX[] = "0123456789abcdef";
+    *out += '"';
+    for (;;) {
+        const std::size_t plain = scan::plain_prefix(value.data(), value.size());
+        out->append(value.data(), plain);
+        if (plain == value.size())
+            break;
+        const char c = value[plain];
+        if (const char letter = short_escape(c)) {
+            const char escape[2] = {'\\', letter};
+            out->append(escape, 2);
+        } else {
+            const auto code = static_cast<unsigned char>(c);
+            const char escape[6] = {'\\', 'u', '0', '0', HEX[code >> 4], HEX[code & 0xF]};
+            out->append(escape, 6);
+        }
+        value.remove_prefix(plain + 1);
+    }
+    *out += '"';
+}
+
+std::size_t json_writer::escaped_size(std::string_view value) noexcept {
+    std::size_t size = value.size() + 2;
+    for (;;) {
+        const std::size_t plain = scan::plain_prefix(value.data(), value.size());
+        if (plain == value.size())
+            return size;
+        size += short_escape(value[plain]) ? 1 : 5;
+        value.remove_prefix(plain + 1);
+    }
+}
+
+std::size_t json_writer::format_number(double value, char* buf) noexcept {
+    if (!std::isfinite(value)) {
+        std::char_traits<char>::copy(buf, "null", 4);
+        return 4;
+    }
+    // integral doubles in range print without an exponent
+    if (std::trunc(value) == value && value >= -TWO_POW_63 && value < TWO_POW_63)
+        return format_integer(static_cast<std::int64_t>(value), buf);
+    return static_cast<std::size_t>(std::to_chars(buf, buf + NUMBER_CHARS, value).ptr - buf);
+}
+
+std::size_t json_writer::format_integer(std::int64_t value, char* buf) noexcept {
+    return static_cast<std::size_t>(std::to_chars(buf, buf + NUMBER_CHARS, value).ptr - buf);
+}
+}  // namespace cppress::json
@@ -0,0 +1,99 @@
+#include "../includes/json_bind.hpp"
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "../includes.hpp"
+
+using namespace cppress::json;
+
+namespace shop {
+struct line_item {
+    std::string sku;
+    int quantity = 0;
+    double price = 0;
+};
+CPPRESS_JSON_FIELDS(line_item, sku, quantity, price)
+
+struct order {
+    std::int64_t id = 0;
+    std::uint64_t checksum = 0;
+    bool paid = false;
+    std::string note = "none";
+    std::vector<line_item> items;
+    std::optional<std::string> coupon;
+    std::map<std::string, std::vector<int>> tags;
+    std::int8_t priority = 0;
+};
+CPPRESS_JSON_FIELDS(order, id, checksum, paid, note, items, coupon, tags, priority)
+}  // namespace shop
+
+// names are found by a perfect hash built at compile time
+static_assert(detail::binding<shop::order>::keys.find("coupon") == 5);
+static_assert(detail::binding<shop::order>::keys.find("id") == 0);
+static_assert(detail::binding<shop::order>::keys.find("unknown") == 8);
+
+TEST(JsonBind, StructsRoundTripWithoutATree) {
+    shop::order o;
+    o.id = 9007199254740993;  // past 2^53
+    o.checksum = 18446744073709551615u;
+    o.paid = true;
+    o.note = "\"rush\"\n";
+    o.items = {{"A-1", 2, 9.99}, {"B-2", 1, 0.5}};
+    o.tags = {{"x", {1, 2}}, {"y", {}}};
+    o.priority = -3;
+
+    const std::string text = to_json(o);
+    EXPECT_EQ(text,
+              "{\"id\":9007199254740993,\"checksum\":18446744073709551615,\"paid\":true,"
+              "\"note\":\"\\\"rush\\\"\\n\",\"items\":[{\"sku\":\"A-1\",\"quantity\":2,"
+              "\"price\":9.99},{\"sku\":\"B-2\",\"quantity\":1,\"price\":0.5}],"
+              "\"coupon\":null,\"tags\":{\"x\":[1,2],\"y\":[]},\"priority\":-3}");
+
+    const auto back = from_json<shop::order>(text);
+    EXPECT_EQ(back.id, o.id);
+    EXPECT_EQ(back.checksum, o.checksum);
+    EXPECT_TRUE(back.paid);
+    EXPECT_EQ(back.note, o.note);
+    ASSERT_EQ(back.items.size(), 2u);
+    EXPECT_EQ(back.items[1].sku, "B-2");
+    EXPECT_DOUBLE_EQ(back.items[0].price, 9.99);
+    EXPECT_FALSE(back.coupon);
+    EXPECT_EQ(back.tags, o.tags);
+    EXPECT_EQ(back.priority, -3);
+
+    std::vector<shop::line_item> list;
+    from_json("[{\"sku\": \"c\"}]", list);
+    ASSERT_EQ(list.size(), 1u);
+    EXPECT_EQ(list[0].sku, "c");
+}
+
+TEST(JsonBind, UnknownMembersAreSkippedAndAbsentOnesKept) {
+    shop::order o;
+    o.coupon = "OLD";
+    from_json(R"({"extra": {"id": 5, "items": [1, {"sku": 2}]}, "id": 7, "coupon": "NEW",
+                  "more": [[]], "items": [{"sku": "s", "weight": 3.5}]})",
+              o);
+    EXPECT_EQ(o.id, 7);
+    EXPECT_EQ(o.note, "none");
+    EXPECT_EQ(o.coupon, "NEW");
+    ASSERT_EQ(o.items.size(), 1u);
+    EXPECT_EQ(o.items[0].quantity, 0);
+
+    from_json(R"({"coupon": null})", o);
+    EXPECT_FALSE(o.coupon);
+}
+
+TEST(JsonBind, ValuesThatDoNotFitAreRefused) {
+    for (const char* bad :
+         {R"({"id": 1.5})", R"({"id": "7"})", R"({"priority": 300})", R"({"checksum": -1})",
+          R"({"paid": 1})", R"({"items": {}})", R"({"note": null})", R"([])", R"({"id": 1)",
+          R"({"id": 1} x)"}) {
+        shop::order o;
+        EXPECT_THROW(from_json(bad, o), std::runtime_error) << bad;
+    }
+}
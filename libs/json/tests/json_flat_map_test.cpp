@@ -0,0 +1,71 @@
+#include "../includes/json_flat_map.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "../includes.hpp"
+
+using namespace cppress::json;
+using namespace cppress::json::getter;
+using namespace cppress::json::maker;
+
+TEST(JsonFlatMap, KeepsInsertionOrderAcrossTheIndexThreshold) {
+    json_flat_map map;
+    const std::size_t count = 3 * json_flat_map::INDEX_THRESHOLD;
+    for (std::size_t i = count; i > 0; --i)
+        map.insert_or_assign("k" + std::to_string(i), make_number(static_cast<double>(i)));
+    ASSERT_EQ(map.size(), count);
+    for (std::size_t i = 1; i <= count; ++i)
+        ASSERT_EQ(get_number(map.at("k" + std::to_string(i))), static_cast<double>(i)) << i;
+    EXPECT_FALSE(map.contains("k0"));
+    EXPECT_THROW(map.at("k0"), std::out_of_range);
+
+    // replacing keeps the place, erasing keeps the others' order
+    EXPECT_FALSE(map.insert_or_assign("k7", make_string("seven")).second);
+    EXPECT_EQ(map.erase("k9"), 1u);
+    EXPECT_EQ(map.erase("k9"), 0u);
+    std::string order;
+    for (const auto& [key, value] : map)
+        order += key + " ";
+    std::string expected;
+    for (std::size_t i = count; i > 0; --i)
+        if (i != 9)
+            expected += "k" + std::to_string(i) + " ";
+    EXPECT_EQ(order, expected);
+    EXPECT_EQ(get_string(map.find("k7")->second), "seven");
+    EXPECT_EQ(map.find("k9"), map.end());
+
+    // back under the threshold, found by the linear scan
+    while (map.size() > 2)
+        map.erase(map.begin());
+    EXPECT_EQ(map.begin()->first, "k2");
+    EXPECT_EQ(map.count("k1"), 1u);
+    EXPECT_EQ(map["k100"], nullptr);
+    EXPECT_EQ(map.size(), 3u);
+}
+
+TEST(JsonFlatMap, ObjectsWriteTheSameTextWhateverTheirHistory) {
+    auto build = [](bool detour) {
+        auto object = make_object();
+        if (detour)
+            for (int i = 0; i < 40; ++i)
+                object->insert("tmp" + std::to_string(i), make_null());
+        object->insert("id", make_number(7));
+        object->insert("name", make_string("Ada"));
+        object->insert("tags", make_array());
+        if (detour)
+            for (int i = 0; i < 40; ++i)
+                object->erase("tmp" + std::to_string(i));
+        return object->stringify();
+    };
+    EXPECT_EQ(build(false), R"({"id":7,"name":"Ada","tags":[]})");
+    EXPECT_EQ(build(true), build(false));
+
+    const auto parsed = parse(R"({"z": 1, "a": 2, "m": {"y": 3, "b": 4}, "z": 5})");
+    std::string keys;
+    for (const auto& [key, value] : parsed)
+        keys += key;
+    EXPECT_EQ(keys, "zam");
+    EXPECT_EQ(json_object(parsed).stringify(), R"({"z":5,"a":2,"m":{"y":3,"b":4}})");
+}
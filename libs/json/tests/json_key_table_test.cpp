@@ -0,0 +1,75 @@
+#include "../includes/json_key_table.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../includes.hpp"
+
+using namespace cppress::json;
+
+TEST(JsonKeyTable, InternsEachNameOnce) {
+    json_key_table keys(3);
+    const json_key id = keys.intern("id");
+    const json_key user = keys.intern("user_id");
+    EXPECT_EQ(keys.intern(std::string("id")), id);
+    EXPECT_NE(id, user);
+    EXPECT_EQ(id.view(), "id");
+    EXPECT_EQ(id.id(), 1u);
+    EXPECT_EQ(user.id(), 2u);
+    EXPECT_EQ(keys.find("user_id"), user);
+    EXPECT_FALSE(keys.find("missing"));
+    EXPECT_EQ(keys.size(), 2u);
+
+    // bounded: too long a name, or any past the capacity, is not interned
+    EXPECT_FALSE(keys.intern(std::string(json_key_table::MAX_KEY_SIZE + 1, 'k')));
+    EXPECT_TRUE(keys.intern("timestamp"));
+    EXPECT_FALSE(keys.intern("extra"));
+    EXPECT_EQ(keys.intern("timestamp").id(), 3u);
+    EXPECT_EQ(keys.size(), 3u);
+
+    // the shared table hands out one key per name to every thread
+    std::vector<std::thread> threads;
+    std::vector<json_key> seen(4);
+    for (std::size_t i = 0; i < seen.size(); ++i)
+        threads.emplace_back([&seen, i] {
+            for (int n = 0; n < 1000; ++n)
+                json_key_table::global().intern("name" + std::to_string(n));
+            seen[i] = json_key_table::global().intern("name500");
+        });
+    for (auto& thread : threads)
+        thread.join();
+    for (const json_key& key : seen)
+        EXPECT_EQ(key, seen[0]);
+    EXPECT_EQ(json_key_table::global().find("name500"), seen[0]);
+}
+
+TEST(JsonKeyTable, DocumentsShareInternedNames) {
+    json_key_table keys;
+    const json_key id = keys.intern("id");
+    const json_key tags = keys.intern("tags");
+
+    const std::string first = R"({"id": 1, "tags": ["a"], "\u0069d": 2})";
+    const auto a = json_document::view(first, &keys);
+    const auto b = json_document::parse(R"({"tags": [], "id": 3, "other": null})", &keys);
+
+    // names point at the table's copy, in both documents, escaped or not
+    for (const json_member* it = a.root().members_begin(); it != a.root().members_end(); ++it)
+        EXPECT_EQ(it->key.as_string().data(), keys.find(it->key.as_string()).view().data());
+    EXPECT_EQ(a.root().find(id)->as_int64(), 2);
+    EXPECT_EQ(b.root().find(id)->as_int64(), 3);
+    EXPECT_EQ(b.root().find(tags)->size(), 0u);
+    EXPECT_FALSE(a.root().find(keys.find("other")));
+    EXPECT_TRUE(b.root().find(keys.find("other"))->is_null());
+    EXPECT_FALSE(a.root().find(json_key()));
+    EXPECT_TRUE(b.root().members_begin()->key.matches(tags));
+
+    // a document parsed without the table, or keys of another, match by text
+    json_key_table other;
+    const auto plain = json_document::parse(R"({"id": 4})");
+    EXPECT_EQ(plain.root().find(id)->as_int64(), 4);
+    EXPECT_EQ(a.root().find(other.intern("id"))->as_int64(), 2);
+    EXPECT_EQ(a.root().find("tags")->size(), 1u);
+}
@@ -0,0 +1,85 @@
+#include "../includes/json_lazy.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "../includes.hpp"
+
+using namespace cppress::json;
+
+TEST(JsonLazyDocument, ReadsOnlyWhatIsLookedUp) {
+    const std::string text =
+        R"({"event": "push", "payload": {"commits": [{"id": 1}, {"id": 2, "x": [[], {}]}],
+            "size": 18446744073709551616, "ratio": -2.5e-1, "ok": true, "none": null},
+            "name": "café \"x\"", "event": "pull", "tags": ["a", "b", "c"]})";
+    const auto doc = json_lazy_document::view(text);
+    const json_lazy_value root = doc.root();
+    ASSERT_TRUE(root.is_object());
+    EXPECT_EQ(root.size(), 5u);
+
+    // the last of repeated names, as json_document finds it
+    const std::string_view event = root.find("event")->as_string();
+    EXPECT_EQ(event, "pull");
+    // a string without escapes is a view of the input
+    EXPECT_TRUE(event.data() > text.data() && event.data() < text.data() + text.size());
+    EXPECT_EQ(root.find("name")->as_string(), "caf\xC3\xA9 \"x\"");
+    EXPECT_FALSE(root.find("missing"));
+    EXPECT_FALSE(root.find("tags")->find("a"));
+
+    const json_lazy_value payload = *root.find("payload");
+    const json_lazy_value commits = *payload.find("commits");
+    ASSERT_EQ(commits.size(), 2u);
+    EXPECT_EQ(commits[1].find("id")->as_int64(), 2);
+    EXPECT_EQ(commits[1].find("x")->size(), 2u);
+    EXPECT_THROW(commits[2], std::out_of_range);
+    EXPECT_FALSE(payload.find("size")->is_integer());
+    EXPECT_DOUBLE_EQ(payload.find("size")->as_number(), 18446744073709551616.0);
+    EXPECT_EQ(payload.find("size")->as_int64(), INT64_MAX);
+    EXPECT_DOUBLE_EQ(payload.find("ratio")->as_number(), -0.25);
+    EXPECT_TRUE(payload.find("ok")->as_boolean());
+    EXPECT_TRUE(payload.find("none")->is_null());
+
+    std::string tags;
+    for (const json_lazy_value tag : *root.find("tags"))
+        tags += tag.as_string();
+    EXPECT_EQ(tags, "abc");
+
+    std::string names;
+    for (auto it = payload.members_begin(); it != payload.members_end(); ++it)
+        names += std::string((*it).key.as_string()) + ":" + std::to_string((*it).value.size());
+    EXPECT_EQ(names, "commits:2size:0ratio:0ok:0none:0");
+
+    // the same values as the full parse, with or without comments
+    const std::string expected = json_document::parse(text).root().to_object()->stringify();
+    EXPECT_EQ(root.to_object()->stringify(), expected);
+    const std::string commented = "/* hook */ " + text + " // end";
+    EXPECT_EQ(json_lazy_document::parse(commented).root().to_object()->stringify(), expected);
+
+    EXPECT_EQ(json_lazy_document::parse("-12").root().as_int64(), -12);
+    EXPECT_EQ(json_lazy_document::parse("\"\"").root().as_string(), "");
+    EXPECT_EQ(json_lazy_document::parse(" [ ] ").root().size(), 0u);
+    EXPECT_EQ(json_lazy_document::parse("{}").root().members_begin(),
+              json_lazy_document::parse("{}").root().members_begin());
+}
+
+TEST(JsonLazyDocument, RefusesBadStructureUpFrontAndBadValuesWhenRead) {
+    for (const char* bad : {"", "[1 2]", "{\"a\" 1}", "{\"a\":1,}", "[1,]", "[1]x", "{1:2}",
+                            "[1}", "{\"a\":1]", "[/ 1]", "[1", "\"abc", "/* x", "[] // c\n]",
+                            "{\"a\" /* c */ 1}", "[\"a\"x]", "}"}) {
+        EXPECT_THROW(json_lazy_document::parse(bad), std::runtime_error) << bad;
+    }
+    EXPECT_THROW(json_lazy_document::parse(std::string(1025, '[') + std::string(1025, ']')),
+                 std::runtime_error);
+    EXPECT_NO_THROW(json_lazy_document::parse(std::string(1024, '[') + std::string(1024, ']')));
+
+    // scalars are checked when they are read
+    const auto doc =
+        json_lazy_document::parse(R"({"a": tru, "b": 1., "c": 1x, "d": "\u12", "e": 3})");
+    EXPECT_EQ(doc.root().find("e")->as_int64(), 3);
+    EXPECT_THROW(doc.root().find("a")->as_boolean(), std::runtime_error);
+    EXPECT_THROW(doc.root().find("b")->as_number(), std::runtime_error);
+    EXPECT_THROW(doc.root().find("c")->as_int64(), std::runtime_error);
+    EXPECT_THROW(doc.root().find("d")->as_string(), std::runtime_error);
+    EXPECT_THROW(doc.root().to_object(), std::runtime_error);
+}
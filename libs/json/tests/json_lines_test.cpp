@@ -0,0 +1,90 @@
+#include "../includes/json_lines.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <stdexcept>
+#include <string>
+
+#include "../includes.hpp"
+#include "thread_pool.hpp"
+
+using namespace cppress::json;
+
+namespace {
+/// Enough records for several chunks, with blank lines and CRLF endings among them
+std::string make_batch(std::size_t records) {
+    std::string text;
+    const std::string padding(200, 'x');
+    for (std::size_t i = 0; i < records; ++i) {
+        text += R"({"id": )" + std::to_string(i) + R"(, "pad": ")" + padding;
+        text += R"(", "tags": [1, 2]})";
+        text += i % 7 == 0 ? "\r\n" : "\n";
+        if (i % 100 == 0)
+            text += "  \n";
+    }
+    return text;
+}
+}  // namespace
+
+TEST(JsonLines, ParsesEveryRecordInOrder) {
+    const std::string text = make_batch(5000);
+    ASSERT_GT(text.size(), 3 * json_lines::CHUNK_SIZE);
+
+    const auto serial = json_lines::parse(text);
+    cppress::shared::thread_pool pool(4);
+    const auto parallel = json_lines::parse(text, &pool);
+    for (const json_lines* batch : {&serial, &parallel}) {
+        ASSERT_EQ(batch->size(), 5000u);
+        for (std::size_t i = 0; i < batch->size(); ++i) {
+            ASSERT_EQ((*batch)[i].find("id")->as_int64(), static_cast<std::int64_t>(i));
+            ASSERT_EQ((*batch)[i].find("tags")->size(), 2u);
+        }
+    }
+    EXPECT_TRUE(json_lines::parse("\n \r\n").empty());
+    EXPECT_EQ(json_lines::parse(R"([1] )")[0].size(), 1u);
+
+    std::atomic<std::size_t> count{0};
+    std::atomic<std::int64_t> sum{0};
+    json_lines::for_each(
+        text,
+        [&](std::size_t record, const json_node& root) {
+            EXPECT_EQ(root.find("id")->as_int64(), static_cast<std::int64_t>(record));
+            count.fetch_add(1);
+            sum.fetch_add(root.find("id")->as_int64());
+        },
+        &pool);
+    EXPECT_EQ(count.load(), 5000u);
+    EXPECT_EQ(sum.load(), 4999 * 5000 / 2);
+}
+
+TEST(JsonLines, ReportsTheFirstBadRecord) {
+    std::string text = make_batch(3000);
+    // records 1500 and 2500 are both broken; the report always names the first
+    for (const std::string id : {"1500", "2500"}) {
+        const auto at = text.find(R"({"id": )" + id + ",");
+        text.replace(at, 1, "[");
+    }
+    cppress::shared::thread_pool pool(4);
+    for (int run = 0; run < 3; ++run) {
+        try {
+            json_lines::parse(text, &pool);
+            FAIL() << "a malformed record was accepted";
+        } catch (const std::runtime_error& e) {
+            // record 1500 follows 15 blank lines
+            EXPECT_EQ(std::string(e.what()).rfind("Record 1500 (line 1516): ", 0), 0u) << e.what();
+        }
+    }
+    EXPECT_THROW(json_lines::for_each(text, [](std::size_t, const json_node&) {}, &pool),
+                 std::runtime_error);
+
+    // what the handler throws reaches the caller
+    EXPECT_THROW(json_lines::for_each(
+                     make_batch(3000),
+                     [](std::size_t record, const json_node&) {
+                         if (record == 42)
+                             throw std::logic_error("stop");
+                     },
+                     &pool),
+                 std::logic_error);
+}
@@ -0,0 +1,119 @@
+#include "../includes/json_query.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "../includes.hpp"
+
+using namespace cppress::json;
+
+namespace {
+const std::string TEXT = R"({"a/b": {"m~n": [10, {"": "empty"}]}, "0": "zero",
+    "list": [{"id": 1}, {"id": 2, "tags": ["x", "y"]}], "list": [{"id": 3}],
+    "nothing": null, "s": "str"})";
+
+/// The target's text as each walk finds it, "-" when there is none
+std::string over_tree(const json_query& query) {
+    static const auto root = json_value(TEXT);
+    const auto* slot = query.find(root);
+    return !slot ? "-" : *slot ? (*slot)->stringify() : "null";
+}
+
+std::string over_document(const json_query& query) {
+    static const auto doc = json_document::parse(TEXT);
+    const json_node* node = query.find(doc.root());
+    return node ? (node->is_null() ? "null" : node->to_object()->stringify()) : "-";
+}
+
+std::string over_lazy(const json_query& query) {
+    static const auto doc = json_lazy_document::parse(TEXT);
+    const auto value = query.find(doc.root());
+    return value ? (value->is_null() ? "null" : value->to_object()->stringify()) : "-";
+}
+
+/// Seeks in pieces of a given size; the first event of the target, "-" if there is none
+std::string over_reader(const json_query& query, const std::string& text, std::size_t size) {
+    json_reader reader;
+    json_query_cursor cursor(query);
+    for (std::size_t at = 0;; at += size) {
+        if (at >= text.size())
+            reader.finish();
+        else
+            reader.feed(std::string_view(text).substr(at, size));
+        const json_event event = cursor.seek(reader);
+        if (event == json_event::need_more)
+            continue;
+        if (!cursor.found())
+            return "-";
+        switch (event) {
+            case json_event::string:
+            case json_event::number:
+                return std::string(reader.text());
+            case json_event::start_object:
+                return "{";
+            case json_event::start_array:
+                return "[";
+            case json_event::null:
+                return "null";
+            default:
+                return "?";
+        }
+    }
+}
+}  // namespace
+
+TEST(JsonQuery, CompilesPointersAndPaths) {
+    EXPECT_EQ(json_query::pointer("").size(), 0u);
+    EXPECT_EQ(json_query::pointer("/a~1b/m~0n/1/").to_pointer(), "/a~1b/m~0n/1/");
+    EXPECT_EQ(json_query::pointer("#/a~1b/m~0n/%31").to_pointer(), "/a~1b/m~0n/1");
+    EXPECT_EQ(json_query::path("$['a/b'][\"m~n\"][1]").to_pointer(), "/a~1b/m~0n/1");
+    EXPECT_EQ(json_query::path("list[0].id").to_pointer(), "/list/0/id");
+    EXPECT_EQ(json_query::path("$").size(), 0u);
+    for (const char* bad : {"a", "/a~2", "/a~", "#/%4"})
+        EXPECT_THROW(json_query::pointer(bad), std::runtime_error) << bad;
+    for (const char* bad : {"$.", "$[", "$[01]", "$[-1]", "$['a'", "$['a'x", "$a", "x..y"})
+        EXPECT_THROW(json_query::path(bad), std::runtime_error) << bad;
+}
+
+TEST(JsonQuery, FindsTheSameValueInEveryRepresentation) {
+    const std::pair<const char*, const char*> cases[] = {
+        {"/a~1b/m~0n/0", "10"},
+        {"/a~1b/m~0n/1/", "\"empty\""},
+        {"/0", "\"zero\""},
+        {"/list/0/id", "3"},
+        {"/nothing", "null"},
+        {"/a~1b/m~0n/2", "-"},
+        {"/a~1b/m~0n/-", "-"},
+        {"/s/0", "-"},
+        {"/list/x", "-"},
+        {"/missing/0", "-"},
+    };
+    for (const auto& [pointer, expected] : cases) {
+        const auto query = json_query::pointer(pointer);
+        EXPECT_EQ(over_tree(query), expected) << pointer;
+        EXPECT_EQ(over_document(query), expected) << pointer;
+        EXPECT_EQ(over_lazy(query), expected) << pointer;
+    }
+    EXPECT_EQ(over_tree(json_query::path("$['list'][0]['id']")), "3");
+    // an index step does not select a member named by its digits
+    EXPECT_EQ(over_document(json_query::path("$[0]")), "-");
+    EXPECT_EQ(over_lazy(json_query::path("$['0']")), "\"zero\"");
+    EXPECT_EQ(over_tree(json_query::pointer(""))[0], '{');
+}
+
+TEST(JsonQuery, CursorStopsReadingAtTheTarget) {
+    for (std::size_t size = 1; size <= TEXT.size(); ++size) {
+        // the first of repeated names, unlike find()
+        ASSERT_EQ(over_reader(json_query::pointer("/list/1/tags/1"), TEXT, size), "y") << size;
+        ASSERT_EQ(over_reader(json_query::pointer("/a~1b/m~0n/1/"), TEXT, size), "empty");
+        ASSERT_EQ(over_reader(json_query::pointer("/a~1b/m~0n"), TEXT, size), "[");
+        ASSERT_EQ(over_reader(json_query::pointer("/nothing"), TEXT, size), "null");
+        ASSERT_EQ(over_reader(json_query::pointer("/list/2"), TEXT, size), "-");
+        ASSERT_EQ(over_reader(json_query::pointer("/s/0"), TEXT, size), "-");
+    }
+    // what follows the target is never read, malformed or not
+    const auto route = json_query::path("route");
+    EXPECT_EQ(over_reader(route, R"({"skip": [1, {"x": "]"}], "route": 42, ,,)", 7), "42");
+    EXPECT_THROW(over_reader(route, R"({"skip" 1, "route": 1})", 4), std::runtime_error);
+}
@@ -0,0 +1,165 @@
+#include "../includes/json_reader.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "../includes.hpp"
+
+using namespace cppress::json;
+
+namespace {
+/// Events of a reader as text, one word each
+std::string describe(json_reader& reader, json_event event) {
+    switch (event) {
+        case json_event::start_object:
+            return "{ ";
+        case json_event::end_object:
+            return "} ";
+        case json_event::start_array:
+            return "[ ";
+        case json_event::end_array:
+            return "] ";
+        case json_event::key:
+            return "k:" + std::string(reader.text()) + " ";
+        case json_event::string:
+            return "s:" + std::string(reader.text()) + " ";
+        case json_event::number:
+            return (reader.is_integer() ? "i:" : "n:") + std::string(reader.text()) + " ";
+        case json_event::boolean:
+            return reader.boolean() ? "true " : "false ";
+        case json_event::null:
+            return "null ";
+        default:
+            return "";
+    }
+}
+
+/// Feeds text in pieces of a given size, each a copy released once drained
+std::string read_in_pieces(const std::string& text, std::size_t size,
+                           std::string_view skipped_key = {}) {
+    json_reader reader;
+    std::string events;
+    for (std::size_t at = 0;; at += size) {
+        const bool last = at >= text.size();
+        std::string piece;
+        if (last) {
+            reader.finish();
+        } else {
+            piece = text.substr(at, size);
+            reader.feed(piece);
+        }
+        for (json_event event = reader.next(); event != json_event::need_more;
+             event = reader.next()) {
+            if (event == json_event::end)
+                return events;
+            if (event == json_event::key && reader.text() == skipped_key)
+                reader.skip();
+            else if (event == json_event::start_object && reader.depth() == 4 &&
+                     !skipped_key.empty())
+                reader.skip();
+            else
+                events += describe(reader, event);
+        }
+        if (last)
+            return events + "(no end)";
+    }
+}
+
+struct counter : json_handler {
+    bool start_object() override {
+        ++objects;
+        return true;
+    }
+    bool key(std::string_view name) override { return name != "payload"; }
+    void integer(std::int64_t value) override { sum += value; }
+    void number(double) override { ++fractions; }
+
+    int objects = 0;
+    std::int64_t sum = 0;
+    int fractions = 0;
+};
+}  // namespace
+
+TEST(JsonReader, EventsDoNotDependOnWhereThePiecesSplit) {
+    const std::string text =
+        "{\"name\": \"caf\\u00e9 \\\"x\\\"\", // comment\n"
+        " \"n\": [-12, 3.5e2, 9223372036854775807, 18446744073709551616],"
+        " /* a } block */ \"ok\": true, \"no\": false, \"nothing\": null,"
+        " \"nested\": {\"a\": [[], {}], \"\\ud83d\\ude00\": \"plain\"}}";
+    const std::string expected =
+        "{ k:name s:caf\xC3\xA9 \"x\" k:n [ i:-12 n:3.5e2 i:9223372036854775807 "
+        "n:18446744073709551616 ] k:ok true k:no false k:nothing null "
+        "k:nested { k:a [ [ ] { } ] k:\xF0\x9F\x98\x80 s:plain } } ";
+    for (std::size_t size = 1; size <= text.size(); ++size)
+        ASSERT_EQ(read_in_pieces(text, size), expected) << size;
+
+    json_reader top;
+    top.feed("42");
+    EXPECT_EQ(top.next(), json_event::need_more);  // more digits may follow
+    top.feed("7");
+    top.finish();
+    EXPECT_EQ(top.next(), json_event::number);
+    EXPECT_EQ(top.integer(), 427);
+    EXPECT_EQ(top.next(), json_event::end);
+    EXPECT_EQ(top.offset(), 3u);
+}
+
+TEST(JsonReader, SkipsSubtreesWithoutReportingThem) {
+    const std::string text =
+        "[{\"id\": 1, \"blob\": {\"x\": \"]}\\\"[{\", \"y\": [1, /* ] */ {\"z\": []}]}, \"keep\": 2},"
+        " {\"id\": 2, \"blob\": \"a \\\\\", \"deep\": [{\"gone\": \"}\"}], \"keep\": 3}]";
+    const std::string expected =
+        "[ { k:id i:1 k:keep i:2 } { k:id i:2 k:deep [ ] k:keep i:3 } ] ";
+    for (std::size_t size = 1; size <= text.size(); ++size)
+        ASSERT_EQ(read_in_pieces(text, size, "blob"), expected) << size;
+}
+
+TEST(JsonReader, RefusesMalformedInputWherePiecesSplitIt) {
+    for (const char* bad : {"[1 2]", "{\"a\" 1}", "{\"a\":1,}", "[1]x", "[truex]", "{1:2}",
+                            "[\"a\\u12\"]", "[01.]", "[1}", "[/ 1]", "[1", "\"abc", "/* x",
+                            ""}) {
+        for (std::size_t size = 1; size <= std::string(bad).size() + 1; ++size)
+            EXPECT_THROW(read_in_pieces(bad, size), std::runtime_error) << bad << " " << size;
+    }
+
+    json_reader reader;
+    reader.feed("[1,");
+    reader.feed("]");
+    EXPECT_EQ(reader.next(), json_event::start_array);
+    EXPECT_EQ(reader.next(), json_event::number);
+    EXPECT_THROW(reader.next(), std::runtime_error);
+    // the reader stays failed
+    EXPECT_THROW(reader.next(), std::runtime_error);
+
+    std::string deep(json_reader::MAX_DEPTH + 1, '[');
+    EXPECT_THROW(read_in_pieces(deep, 64), std::runtime_error);
+}
+
+TEST(JsonSaxParser, CountsALargeArrayElementByElement) {
+    counter handler;
+    json_sax_parser parser(handler);
+    constexpr int ELEMENTS = 100000;
+    std::string piece;
+    parser.feed("[");
+    for (int i = 0; i < ELEMENTS; ++i) {
+        piece += std::string(i ? "," : "") + "{\"id\":" + std::to_string(i) +
+                 ",\"w\":0.5,\"payload\":{\"ids\":[7,7,7],\"s\":\"[[[\"}}";
+        if (piece.size() >= 4096) {
+            parser.feed(piece);
+            piece.clear();
+        }
+    }
+    parser.feed(piece + "]");
+    parser.finish();
+
+    EXPECT_EQ(handler.objects, ELEMENTS);
+    EXPECT_EQ(handler.sum, std::int64_t(ELEMENTS) * (ELEMENTS - 1) / 2);
+    EXPECT_EQ(handler.fractions, ELEMENTS);
+
+    counter unfinished;
+    json_sax_parser cut(unfinished);
+    cut.feed("[{\"id\": 1}, {\"id\"");
+    EXPECT_EQ(unfinished.sum, 1);
+    EXPECT_THROW(cut.finish(), std::runtime_error);
+}
@@ -0,0 +1,115 @@
+#include "../includes/json_scan.hpp"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../includes.hpp"
+
+using namespace cppress::json;
+
+namespace {
+/// Restores the best scan implementation when a test ends
+struct scan_level_guard {
+    ~scan_level_guard() { scan::use(scan::best()); }
+};
+
+/// The index computed one byte at a time
+bool reference_index(const std::string& s, std::vector<std::uint32_t>& index) {
+    index.clear();
+    bool in_string = false, pending_escape = false, after_boundary = true;
+    for (std::size_t i = 0; i < s.size(); ++i) {
+        const char c = s[i];
+        const bool escaped = pending_escape;
+        pending_escape = !escaped && c == '\\';
+        const bool quote = c == '"' && !escaped;
+        if (quote)
+            in_string = !in_string;
+        const bool outside = !in_string;
+        if (c == '/' && outside && !quote)
+            return false;
+        const bool op = outside && std::string_view("{}[]:,").find(c) != std::string_view::npos;
+        const bool boundary = op || quote || c == ' ' || c == '\t' || c == '\n' || c == '\r';
+        if (op || (quote && in_string) || (after_boundary && !boundary && outside))
+            index.push_back(static_cast<std::uint32_t>(i));
+        after_boundary = boundary;
+    }
+    return !in_string;
+}
+}  // namespace
+
+TEST(JsonScanTest, EveryLevelWritesTheReferenceIndex) {
+    scan_level_guard guard;
+    std::mt19937 rng(7);
+    // dense in quotes and backslashes so escape runs cross the 64-byte blocks
+    const std::string alphabet = "\"\"\\\\\\{}[]:, \n\tab1-./";
+    std::vector<scan::level> levels = {scan::level::scalar, scan::level::avx2, scan::level::neon};
+    for (int round = 0; round < 2000; ++round) {
+        std::string s(rng() % 300, 'x');
+        for (auto& ch : s)
+            ch = alphabet[rng() % (round % 2 ? alphabet.size() - 1 : alphabet.size())];
+
+        std::vector<std::uint32_t> expected;
+        const bool usable = reference_index(s, expected);
+        for (auto l : levels) {
+            if (!scan::use(l))
+                continue;
+            std::vector<std::uint32_t> index;
+            ASSERT_EQ(scan::structural_index(s.data(), s.size(), index), usable)
+                << scan::name(l) << ": " << s;
+            if (usable) {
+                ASSERT_EQ(index, expected) << scan::name(l) << ": " << s;
+            }
+        }
+    }
+}
+
+TEST(JsonScanTest, DocumentsParseAlikeWithAndWithoutVectors) {
+    scan_level_guard guard;
+    std::string text = "{\"items\": [";
+    for (int i = 0; i < 200; ++i)
+        text += std::string(i ? "," : "") + "{\"id\":" + std::to_string(i) +
+                ",\"name\":\"item \\\"" + std::to_string(i) + "\\\"\\\\\",\"on\":" +
+                (i % 2 ? "true" : "false") + ",\"x\":null}";
+    text += "]}";
+
+    std::vector<std::string> names;
+    for (auto l : {scan::level::scalar, scan::best()}) {
+        ASSERT_TRUE(scan::use(l));
+        auto doc = json_document::parse(text);
+        const json_node& items = *doc.root().find("items");
+        ASSERT_EQ(items.size(), 200u) << scan::name(l);
+        EXPECT_EQ(items[137].find("id")->as_number(), 137);
+        EXPECT_TRUE(items[137].find("on")->as_boolean());
+        names.emplace_back(items[137].find("name")->as_string());
+    }
+    EXPECT_EQ(names[0], "item \"137\"\\");
+    EXPECT_EQ(names[0], names[1]);
+
+    // tokens the index does not delimit are still checked
+    for (const char* bad : {"[1 2]", "[\"a\"\"b\"]", "[\"a\"x]", "[truex]", "{\"a\":1}}", "[1]x"})
+        EXPECT_THROW(json_document::parse(bad), std::runtime_error) << bad;
+}
+
+TEST(JsonScanTest, EveryLevelFindsTheFirstByteToEscape) {
+    scan_level_guard guard;
+    std::mt19937 rng(11);
+    for (int round = 0; round < 2000; ++round) {
+        // mostly plain text, so runs cross the vector width
+        std::string s(rng() % 200, 'a');
+        for (auto& ch : s)
+            if (rng() % 40 == 0)
+                ch = "\"\\\x01\n\x1f\x7f\xe9 "[rng() % 8];
+        std::size_t expected = 0;
+        while (expected < s.size() && s[expected] != '"' && s[expected] != '\\' &&
+               static_cast<unsigned char>(s[expected]) >= 0x20)
+            ++expected;
+        for (auto l : {scan::level::scalar, scan::level::avx2, scan::level::neon}) {
+            if (!scan::use(l))
+                continue;
+            ASSERT_EQ(scan::plain_prefix(s.data(), s.size()), expected) << scan::name(l);
+        }
+    }
+}
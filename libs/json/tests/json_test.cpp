@@ -109,6 +109,115 @@ TEST(JsonArray, Stringify) {
     EXPECT_EQ(json, R"([1,"hello",false])");
 }
 
+TEST(JsonStringify, SizeIsKnownBeforeWriting) {
+    auto inner = make_array();
+    inner->push_back(make_number(3.25));
+    inner->push_back(make_number(-42));
+    inner->push_back(make_string("tab\tquote\"slash\\"));
+    inner->push_back(nullptr);
+    auto obj = make_object();
+    obj->insert("list", inner);
+    obj->insert("flag", make_boolean(true));
+    obj->insert("empty", make_object());
+    obj->insert("none", nullptr);
+
+    for (const std::shared_ptr<json_object>& value :
+         std::vector<std::shared_ptr<json_object>>{obj, inner, make_array(), make_string("")}) {
+        const std::string text = value->stringify();
+        EXPECT_EQ(value->stringified_size(), text.size()) << text;
+        std::string appended = "prefix";
+        value->stringify_to(appended);
+        EXPECT_EQ(appended, "prefix" + text);
+    }
+    EXPECT_EQ(inner->stringify(), R"([3.25,-42,"tab\tquote\"slash\\",null])");
+}
+
+TEST(JsonDocument, NodesReadTheParsedValues) {
+    auto doc = json_document::parse(R"({
+        // comments are skipped, as parse() does
+        "user": {"id": 7, "score": -2.5e2, "admin": false, "manager": null},
+        "tags": ["a", "b\n\"c\"", "\u00e9\ud83d\ude00"],
+        "user": {"id": 8}
+    })");
+    const json_node& root = doc.root();
+    ASSERT_TRUE(root.is_object());
+    EXPECT_EQ(root.size(), 3u);
+
+    const json_node* user = root.find("user");
+    ASSERT_NE(user, nullptr);
+    EXPECT_EQ(user->find("id")->as_number(), 8) << "the last of a repeated name wins";
+    const json_node& first = root.members_begin()->value;
+    EXPECT_EQ(first.find("score")->as_number(), -250);
+    EXPECT_TRUE(first.find("admin")->is_boolean());
+    EXPECT_FALSE(first.find("admin")->as_boolean());
+    EXPECT_TRUE(first.find("manager")->is_null());
+    EXPECT_EQ(first.find("missing"), nullptr);
+
+    const json_node& tags = *root.find("tags");
+    ASSERT_EQ(tags.size(), 3u);
+    EXPECT_EQ(tags[0].as_string(), "a");
+    EXPECT_EQ(tags[1].as_string(), "b\n\"c\"");
+    EXPECT_EQ(tags[2].as_string(), "\xC3\xA9\xF0\x9F\x98\x80");
+    std::string joined;
+    for (const json_node& tag : tags)
+        joined += tag.as_string().substr(0, 1);
+    EXPECT_EQ(joined, "ab\xC3");
+    EXPECT_THROW(tags[3], std::out_of_range);
+
+    auto moved = std::move(doc);
+    EXPECT_EQ(moved.root().find("tags")->size(), 3u) << "nodes survive a move of the document";
+}
+
+TEST(JsonDocument, ConvertsToTheObjectHierarchy) {
+    const std::string text = R"({"name":"Ada","langs":["en",{"level":3}],"ok":true,"none":null})";
+    auto doc = json_document::parse(text);
+    auto object = doc.root().to_object();
+    // members keep the document's order
+    EXPECT_EQ(object->size(), 4u);
+    EXPECT_EQ(object->stringify(), text);
+    EXPECT_EQ(object->stringified_size(), json_value(text)->stringified_size());
+    EXPECT_EQ(get_string(object->get("name")), "Ada");
+    EXPECT_TRUE(get_boolean(object->get("ok")));
+    EXPECT_TRUE(object->contains("none") && is_null(object->get("none")));
+    auto langs = std::dynamic_pointer_cast<json_array>(doc.root().find("langs")->to_object());
+    ASSERT_TRUE(langs);
+    EXPECT_EQ(get_string(langs->at(0)), "en");
+    EXPECT_EQ(get_number(langs->at(1)->get("level")), 3);
+    EXPECT_EQ(json_document::parse("42").root().to_object()->stringify(), "42");
+    EXPECT_EQ(json_document::parse("null").root().to_object(), nullptr);
+}
+
+TEST(JsonDocument, ReadsTheInputOnceInPlace) {
+    // a string ending in an escaped backslash closes at the quote after it
+    const std::string text = "/* JSONC */ {\"path\": \"C:\\\\\", // to the end of the line\n"
+                             "  \"n\": /* inline */ 1}";
+    auto data = parse(text);
+    EXPECT_EQ(get_string(data["path"]), "C:\\");
+    EXPECT_EQ(get_number(data["n"]), 1);
+
+    auto in_place = json_document::view(text);
+    EXPECT_EQ(in_place.root().find("n")->as_number(), 1);
+    std::string_view name = in_place.root().members_begin()->key.as_string();
+    EXPECT_TRUE(name.data() > text.data() && name.data() < text.data() + text.size())
+        << "strings without escapes point into the caller's text";
+
+    std::string owned = R"({"key": "a longer value than any small-string buffer holds"})";
+    const char* bytes = owned.data();
+    auto taken = json_document::parse(std::move(owned));
+    auto moved = std::move(taken);
+    EXPECT_EQ(moved.root().find("key")->as_string().data(), bytes + 9) << "taken over, not copied";
+
+    EXPECT_THROW(json_document::parse("{} /* open"), std::runtime_error);
+}
+
+TEST(JsonDocument, MalformedTextThrows) {
+    for (const char* text : {"", "{", "[1,]", "{\"a\" 1}", "{\"a\":1,}", "\"open", "01x", "-",
+                             "1.", "tru", "[1] 2", "\"\\u12\""})
+        EXPECT_THROW(json_document::parse(text), std::runtime_error) << text;
+    EXPECT_THROW(json_document::parse(std::string(2000, '[') + std::string(2000, ']')),
+                 std::runtime_error);
+}
+
 TEST(JsonString, BasicOperations) {
     auto str = make_string("Hello World");
     auto json_str = std::dynamic_pointer_cast<json_string>(str);
@@ -170,6 +279,44 @@ TEST(JsonNumber, ArithmeticOperators) {
     EXPECT_EQ(num->value, 5.0);
 }
 
+TEST(JsonNumber, RoundTripsExactly) {
+    // shortest text that reads back to the same double
+    for (double d : {0.1, -2.5, 1e300, 1.7976931348623157e308, 5e-324, 123456.789, 1e21}) {
+        const std::string text = json_number(d).stringify();
+        json_number back;
+        ASSERT_TRUE(back.set_json_data(text)) << text;
+        EXPECT_EQ(back.value, d) << text;
+    }
+    EXPECT_EQ(json_number(0.1).stringify(), "0.1");
+    EXPECT_EQ(json_number(3.0).stringify(), "3");
+    EXPECT_EQ(json_number(std::nan("")).stringify(), "null");
+
+    // integers keep all 64 bits, through the parsers too
+    const std::string id = "9007199254740993";  // 2^53 + 1, not a double
+    json_number parsed;
+    ASSERT_TRUE(parsed.set_json_data(id));
+    EXPECT_TRUE(parsed.holds_integer());
+    EXPECT_EQ(parsed.to_long_long(), 9007199254740993LL);
+    EXPECT_EQ(parsed.stringify(), id);
+    EXPECT_EQ(json_number(std::numeric_limits<long long>::min()).stringify(), "-9223372036854775808");
+    auto data = parse(R"({"id": 9223372036854775807, "big": 18446744073709551616})");
+    EXPECT_EQ(data["id"]->stringify(), "9223372036854775807");
+    EXPECT_EQ(data["big"]->stringify(), "18446744073709551616");
+    auto doc = json_document::parse(R"([9007199254740993, 1.5, 1e2])");
+    EXPECT_TRUE(doc.root()[0].is_integer());
+    EXPECT_EQ(doc.root()[0].as_int64(), 9007199254740993LL);
+    EXPECT_FALSE(doc.root()[1].is_integer());
+    EXPECT_FALSE(doc.root()[2].is_integer());
+    EXPECT_EQ(doc.root()[2].as_int64(), 100);
+
+    // changing the value drops the exact integer, conversions stay defined
+    ++parsed;
+    EXPECT_FALSE(parsed.holds_integer());
+    EXPECT_EQ(json_number(1e30).to_long_long(), std::numeric_limits<long long>::max());
+    EXPECT_FALSE(parsed.set_json_data("12abc"));
+    EXPECT_FALSE(parsed.set_json_data(""));
+}
+
 TEST(JsonBoolean, BasicOperations) {
     auto bool_true = std::make_shared<json_boolean>(true);
     auto bool_false = std::make_shared<json_boolean>(false);
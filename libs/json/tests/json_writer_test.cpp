@@ -0,0 +1,103 @@
+#include "../includes/json_writer.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "../includes.hpp"
+
+using namespace cppress::json;
+
+TEST(JsonWriter, PlacesSeparatorsAndEscapes) {
+    std::string out = "prefix ";
+    json_writer writer(out);
+    writer.start_object()
+        .key("a\"b")
+        .string("tab\there \\ \x01 \x1f end")
+        .key("n")
+        .start_array()
+        .integer(-7)
+        .number(0.1)
+        .number(1e21)
+        .number(2.0)
+        .number(std::numeric_limits<double>::infinity())
+        .boolean(true)
+        .null()
+        .start_object()
+        .end_object()
+        .start_array()
+        .end_array()
+        .raw("{\"cached\":1}")
+        .end_array()
+        .key("last")
+        .string("")
+        .end_object();
+    EXPECT_EQ(out,
+              "prefix {\"a\\\"b\":\"tab\\there \\\\ \\u0001 \\u001f end\","
+              "\"n\":[-7,0.1,1e+21,2,null,true,null,{},[],{\"cached\":1}],\"last\":\"\"}");
+
+    // escaped text reads back, and its length is known before writing it
+    std::string text(300, 'x');
+    for (std::size_t i = 0; i < text.size(); i += 7)
+        text[i] = static_cast<char>(i % 40);
+    std::string quoted;
+    json_writer(quoted).string(text);
+    EXPECT_EQ(quoted.size(), json_writer::escaped_size(text));
+    EXPECT_EQ(json_document::parse(quoted).root().as_string(), text);
+}
+
+TEST(JsonWriter, StringifyIsOnePassOverTheSizedBuffer) {
+    auto root = maker::make_object();
+    auto rows = maker::make_array();
+    for (int i = 0; i < 50; ++i) {
+        auto row = maker::make_object();
+        row->insert("id\n" + std::to_string(i), maker::make_number(i));
+        row->insert("name", maker::make_string("row \"" + std::to_string(i) + "\"\x02"));
+        row->insert("on", maker::make_boolean(i % 2 == 0));
+        row->insert("none", nullptr);
+        rows->push_back(row);
+    }
+    root->insert("rows", rows);
+
+    const std::string text = root->stringify();
+    EXPECT_EQ(text.size(), root->stringified_size());
+    EXPECT_EQ(text.capacity(), root->stringified_size());
+
+    // the same text through a writer, and through the document API
+    std::string written;
+    json_writer(written).value(root);
+    EXPECT_EQ(written, text);
+    auto doc = json_document::parse(text);
+    std::string from_nodes;
+    json_writer(from_nodes).value(doc.root());
+    EXPECT_EQ(json_document::parse(from_nodes).root().find("rows")->size(), 50u);
+    EXPECT_EQ(from_nodes.size(), text.size());
+}
+
+TEST(JsonWriter, SinkReceivesChunksOfTheText) {
+    std::vector<std::string> chunks;
+    json_writer streamed([&chunks](std::string&& chunk) { chunks.push_back(std::move(chunk)); },
+                         256);
+    std::string whole;
+    json_writer direct(whole);
+    for (json_writer* writer : {&streamed, &direct}) {
+        writer->start_array();
+        for (int i = 0; i < 2000; ++i)
+            writer->start_object().key("i").integer(i).key("s").string("value").end_object();
+        writer->end_array();
+    }
+    EXPECT_TRUE(chunks.size() > 100);
+    streamed.flush();
+    streamed.flush();
+
+    std::string joined;
+    for (std::size_t i = 0; i < chunks.size(); ++i) {
+        if (i + 1 < chunks.size()) {
+            EXPECT_GE(chunks[i].size(), 256u);
+            EXPECT_LT(chunks[i].size(), 512u);
+        }
+        joined += chunks[i];
+    }
+    EXPECT_EQ(joined, whole);
+}
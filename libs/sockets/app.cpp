@@ -10,7 +10,7 @@
 
 class EchoServer : public cppress::sockets::epoll_server {
 public:
-    EchoServer() : cppress::sockets::epoll_server(1000) {}
+    explicit EchoServer(std::size_t reactors) : cppress::sockets::epoll_server(1000, reactors) {}
 
 protected:
     void on_connection_opened(std::shared_ptr<cppress::sockets::connection> conn) override {
@@ -51,23 +51,17 @@ int main() {
             std::cerr << "Failed to initialize socket library." << std::endl;
             return 1;
         }
-        std::vector<std::thread> server_threads;
-
-        // Create TCP listening socket
-        for (int i = 0; i < 4; ++i) {
-            server_threads.emplace_back([]() {
-                auto listener = cppress::sockets::make_listener_socket(8080);
-                EchoServer server;
-                if (server.register_listener_socket(listener)) {
-                    server.listen(1000);  // Start the server event loop
-                }
-            });
-        }
-
-        for (auto& t : server_threads) {
-            if (t.joinable())
-                t.join();
+        // One reactor per listener, all bound to the same port via SO_REUSEPORT
+        const std::size_t reactors = 4;
+        EchoServer server(reactors);
+        for (std::size_t i = 0; i < reactors; ++i) {
+            auto listener = cppress::sockets::make_listener_socket(8080);
+            if (!server.register_listener_socket(listener)) {
+                std::cerr << "Failed to register listener " << i << std::endl;
+                return 1;
+            }
         }
+        server.listen(1000);  // Start the server event loops
 
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;
@@ -21,9 +21,14 @@
  * - socket: Main socket class for TCP/UDP operations with close(), is_open()
  * - connection: Represents an established TCP connection with write(), read()
  * - socket_address: Complete socket address with IP, port, and family
- * - data_buffer: Dynamic buffer for binary data with STL-like interface
+ * - data_buffer: Reference-counted view over binary data with STL-like interface
+ * - datagram_batch: Reusable datagram slots for batched UDP receive and send
+ * - buffer_pool: Pooled receive chunks that data_buffer slices point into
+ * - file_region: File byte range queued for sendfile-based output
  * - tcp_server: Multi-threaded TCP server
  * - epoll_server: High-performance epoll-based server (Linux)
+ * - loop_stats: Snapshot of an event loop's activity counters
+ * - tls_handshaker: Pluggable TLS handshake, records then handled by kernel TLS
  *
  * @section components Basic Components
  * - file_descriptor: Cross-platform file descriptor wrapper with native_handle()
@@ -168,15 +173,26 @@
 #endif
 #endif
 
+#include "includes/buffer_pool.hpp"
 #include "includes/connection.hpp"
+#include "includes/connection_table.hpp"
 #include "includes/data_buffer.hpp"
+#include "includes/datagram_batch.hpp"
 #include "includes/epoll_server.hpp"
 #include "includes/exceptions.hpp"
 #include "includes/family.hpp"
 #include "includes/file_descriptor.hpp"
+#include "includes/file_region.hpp"
+#include "includes/io_uring_ring.hpp"
 #include "includes/ip_address.hpp"
+#include "includes/loop_stats.hpp"
+#include "includes/mpsc_queue.hpp"
+#include "includes/output_chain.hpp"
 #include "includes/port.hpp"
 #include "includes/socket.hpp"
 #include "includes/socket_address.hpp"
+#include "includes/socket_options.hpp"
 #include "includes/tcp_server.hpp"
+#include "includes/timer_wheel.hpp"
+#include "includes/tls.hpp"
 #include "includes/utilities.hpp"
\ No newline at end of file
@@ -0,0 +1,133 @@
+#pragma once
+
+/**
+ * @file buffer_pool.hpp
+ * @brief Pooled, reference-counted receive chunks
+ *
+ * The event loop receives straight into fixed-size chunks taken from a
+ * buffer_pool and hands out data_buffer slices of them, so received bytes
+ * are never copied on their way to on_message_received(). A chunk goes back
+ * to the pool's free list once the last slice referencing it is dropped,
+ * which may happen on any thread.
+ *
+ * Chunks come in a few size classes: a read is sized for what the connection
+ * usually sends, so a small request pins a small chunk, and grows into the
+ * larger classes only while a connection keeps filling its reads.
+ */
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "data_buffer.hpp"
+
+namespace cppress::sockets {
+
+/**
+ * @brief Thread-safe free lists of byte chunks, one per size class
+ *
+ * Chunks are handed out as shared_ptrs whose deleter returns the memory to
+ * the pool. The pool state is itself reference counted, so chunks may
+ * outlive the buffer_pool object that produced them.
+ */
+class buffer_pool {
+private:
+    struct size_class {
+        std::size_t size;
+        std::vector<std::unique_ptr<char[]>> free_chunks;
+    };
+
+    struct state {
+        std::mutex mutex;
+        std::vector<size_class> classes;
+        std::size_t max_free;
+    };
+
+    std::size_t class_index(std::size_t min_size) const noexcept;
+
+    std::shared_ptr<state> shared;
+
+public:
+    /**
+     * @brief Creates a pool
+     * @param chunk_size Size in bytes of every chunk
+     * @param max_free Maximum number of idle chunks kept for reuse
+     */
+    explicit buffer_pool(std::size_t chunk_size = 64 * 1024, std::size_t max_free = 64);
+
+    /**
+     * @brief Creates a pool with several chunk sizes
+     * @param class_sizes Chunk sizes in bytes, in any order
+     * @param max_free Maximum number of idle chunks kept per size class
+     * @throws std::invalid_argument if class_sizes is empty or holds a zero
+     */
+    buffer_pool(std::vector<std::size_t> class_sizes, std::size_t max_free);
+
+    /**
+     * @brief Takes a chunk from the free list, allocating one if it is empty
+     * @param min_size Bytes the chunk must hold, capped at the largest class
+     * @return Chunk of chunk_size(min_size) bytes, recycled when the last reference drops
+     */
+    std::shared_ptr<char> acquire(std::size_t min_size = 0);
+
+    /// @brief Size of the chunks acquire(min_size) hands out
+    std::size_t chunk_size(std::size_t min_size = 0) const noexcept {
+        return shared->classes[class_index(min_size)].size;
+    }
+
+    /// @brief Size of the smallest class
+    std::size_t min_chunk_size() const noexcept { return shared->classes.front().size; }
+
+    /// @brief Size of the largest class
+    std::size_t max_chunk_size() const noexcept { return shared->classes.back().size; }
+
+    /// @brief Number of idle chunks currently held, across all classes
+    std::size_t free_count() const;
+};
+
+/**
+ * @brief Append-only receive window over the current pool chunk
+ *
+ * Owned by one event loop. prepare() exposes the unused tail of the current
+ * chunk, commit() turns the bytes just received into a data_buffer slice.
+ * A fresh chunk is taken once the tail is smaller than the requested read
+ * size; the old one stays alive only as long as slices of it do.
+ */
+class receive_buffer {
+private:
+    buffer_pool* pool;
+    std::shared_ptr<char> chunk;
+    std::size_t capacity = 0;
+    std::size_t used = 0;
+    std::size_t min_read;
+
+public:
+    /**
+     * @brief Creates a receive window
+     * @param pool Pool chunks are taken from, must outlive this object
+     * @param min_read Smallest tail worth passing to recv()
+     */
+    explicit receive_buffer(buffer_pool& pool, std::size_t min_read = 4 * 1024)
+        : pool(&pool), min_read(min_read) {}
+
+    /**
+     * @brief Returns writable space for the next read
+     * @param need Minimum space required, on top of the configured minimum read
+     * @return Start of the free tail; its length is available()
+     *
+     * A new chunk is taken from the smallest class that holds the read.
+     */
+    char* prepare(std::size_t need = 0);
+
+    /// @brief Bytes writable at the pointer returned by prepare()
+    std::size_t available() const noexcept { return chunk ? capacity - used : 0; }
+
+    /**
+     * @brief Marks n bytes at the tail as received
+     * @param n Bytes written since prepare(), at most available()
+     * @return Slice of the chunk viewing exactly those bytes
+     */
+    data_buffer commit(std::size_t n);
+};
+}  // namespace cppress::sockets
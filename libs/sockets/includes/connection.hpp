@@ -288,7 +288,7 @@ public:
      *
      *
      */
-    socket_address remote_endpoint() const { return remote_addr; }
+    const socket_address& remote_endpoint() const { return remote_addr; }
 
     /**
      * @brief Get the local endpoint address ().
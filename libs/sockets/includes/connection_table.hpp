@@ -0,0 +1,144 @@
+#pragma once
+
+/**
+ * @file connection_table.hpp
+ * @brief Flat, fd-indexed table of per-connection state
+ *
+ * File descriptors are small dense integers, so the reactor keeps its
+ * connection state in slots indexed directly by fd instead of a hash map:
+ * a lookup is two array indexings, opening and closing a connection
+ * allocate nothing once the page holding its fd exists.
+ *
+ * Slots live in fixed-size pages that never move, so references to an entry
+ * (and intrusive timers embedded in it) stay valid while the table grows.
+ * Each slot carries a generation counter bumped on every open, which lets
+ * asynchronous work recorded against an fd detect that the fd was closed
+ * and reused.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace cppress::sockets {
+
+/**
+ * @brief fd-indexed slab of T with generation counters
+ * @tparam T Per-connection state, default constructible and assignable
+ * @tparam PageBits log2 of the number of slots per page
+ *
+ * @note Not thread-safe, owned by a single event loop
+ */
+template <typename T, std::size_t PageBits = 10>
+class connection_table {
+public:
+    /// Number of slots allocated at once
+    static constexpr std::size_t page_size = std::size_t(1) << PageBits;
+
+private:
+    struct slot {
+        T value;
+        std::uint32_t generation = 0;
+        bool live = false;
+    };
+
+    std::vector<std::unique_ptr<slot[]>> pages;
+    std::size_t count = 0;
+
+    slot* at(int fd) const noexcept {
+        if (fd < 0)
+            return nullptr;
+        std::size_t index = static_cast<std::size_t>(fd);
+        std::size_t page = index >> PageBits;
+        if (page >= pages.size() || !pages[page])
+            return nullptr;
+        return &pages[page][index & (page_size - 1)];
+    }
+
+public:
+    connection_table() = default;
+    connection_table(const connection_table&) = delete;
+    connection_table& operator=(const connection_table&) = delete;
+
+    /**
+     * @brief Opens the slot of fd with a fresh T
+     * @param fd Non-negative descriptor, must not be open in this table
+     * @return The new entry, valid until erase(fd)
+     */
+    T& emplace(int fd) {
+        std::size_t index = static_cast<std::size_t>(fd);
+        std::size_t page = index >> PageBits;
+        if (page >= pages.size())
+            pages.resize(page + 1);
+        if (!pages[page])
+            pages[page].reset(new slot[page_size]);
+        slot& s = pages[page][index & (page_size - 1)];
+        s.value = T();
+        ++s.generation;
+        s.live = true;
+        ++count;
+        return s.value;
+    }
+
+    /**
+     * @brief Looks up the entry of an open fd
+     * @return The entry, or nullptr if fd is not open
+     */
+    T* find(int fd) noexcept {
+        slot* s = at(fd);
+        return s && s->live ? &s->value : nullptr;
+    }
+
+    /**
+     * @brief Looks up an entry opened at a known generation
+     * @return The entry, or nullptr if fd is closed or was reopened since
+     */
+    T* find(int fd, std::uint32_t generation) noexcept {
+        slot* s = at(fd);
+        return s && s->live && s->generation == generation ? &s->value : nullptr;
+    }
+
+    /// @brief Generation of the current (or last) connection on fd, 0 if never opened
+    std::uint32_t generation(int fd) const noexcept {
+        slot* s = at(fd);
+        return s ? s->generation : 0;
+    }
+
+    /**
+     * @brief Closes the slot of fd, releasing what its entry holds
+     * @note No-op if fd is not open
+     */
+    void erase(int fd) {
+        slot* s = at(fd);
+        if (!s || !s->live)
+            return;
+        s->live = false;
+        s->value = T();
+        --count;
+    }
+
+    /// @brief Number of open entries
+    std::size_t size() const noexcept { return count; }
+
+    /// @brief True if no entry is open
+    bool empty() const noexcept { return count == 0; }
+
+    /**
+     * @brief Invokes fn(fd, entry) on every open entry, in fd order
+     * @note fn must not open or close entries
+     */
+    template <typename F>
+    void for_each(F&& fn) {
+        for (std::size_t page = 0; page < pages.size(); ++page) {
+            if (!pages[page])
+                continue;
+            for (std::size_t i = 0; i < page_size; ++i) {
+                slot& s = pages[page][i];
+                if (s.live)
+                    fn(static_cast<int>((page << PageBits) | i), s.value);
+            }
+        }
+    }
+};
+}  // namespace cppress::sockets
@@ -3,8 +3,8 @@
  * @brief Dynamic buffer for binary data management in the cppress sockets library.
  *
  * This file provides the data_buffer class, a STL-compliant container for storing
- * and managing binary data in network and file I/O operations. It wraps std::vector<char>
- * with a convenient interface designed for accumulating data from multiple sources.
+ * and managing binary data in network and file I/O operations. It is a reference-counted
+ * view over shared storage, so copies and slices of received data cost no byte copies.
  *
  * @section usage Common Usage Patterns
  *
@@ -75,11 +75,12 @@
  * - Used in streaming protocols for data accumulation
  *
  * @section performance Performance Characteristics
- * - Append operations: Amortized O(1) time complexity
- * - Copy construction/assignment: O(n) where n is buffer size
+ * - Append operations: Amortized O(1) when the storage is not shared
+ * - Copy construction/assignment and slice(): O(1), storage is shared
  * - Move operations: O(1) constant time
- * - Memory: Single contiguous allocation via std::vector
- * - Clear operation: Deallocates memory with shrink_to_fit()
+ * - Memory: Single contiguous allocation, a std::string or a pooled read chunk
+ * - Strings can be moved in and out without copying (see release())
+ * - Clear operation: Drops the reference to the storage
  *
  * @author Hamza Moahmmed Hassanain
  * @version 1.0
@@ -87,29 +88,69 @@
 
 #pragma once
 
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
+#include "alloc_accounting.hpp"
 #include "utilities.hpp"
 
 namespace cppress::sockets {
 /**
- * @brief A dynamic buffer for storing and managing binary data.
+ * @brief A reference-counted view over binary data.
  *
- * This class provides a convenient wrapper around std::vector<char> for handling
- * binary data, strings, and character arrays. It offers efficient memory management
- * with automatic resizing and supports both string and raw data operations.
+ * A data_buffer points at a contiguous byte range inside some shared storage:
+ * either a std::string it owns, or one of the pooled chunks the event loop
+ * receives into (see buffer_pool.hpp). Copies and slices share that storage
+ * instead of duplicating it, so a request parsed from a read chunk can keep
+ * referencing the bytes it came from.
  *
- * The class is designed for scenarios where you need to accumulate data from
- * multiple sources (like network I/O, file reading, or HTTP parsing) and provides
- * seamless conversion between different data representations.
+ * Appending to a buffer that is the sole owner of its string grows it in
+ * place; appending to shared storage first detaches into a private copy, so
+ * no other buffer ever observes the change.
  *
  * @note Uses explicit constructors to prevent implicit conversions for type safety.
  */
 class data_buffer {
 private:
-    /// Internal storage for the buffer data
-    std::vector<char> buffer;
+    /// Start of the viewed range; the control block keeps the storage alive
+    std::shared_ptr<const char> bytes;
+
+    /// Number of bytes in the view
+    std::size_t length = 0;
+
+    /// Backing string when this buffer views all of a string it created, else nullptr
+    std::string* owned = nullptr;
+
+    /// Take ownership of a string as the backing storage
+    void adopt(std::string&& str) {
+        if (str.empty()) {
+            reset();
+            return;
+        }
+        auto storage = std::make_shared<std::string>(std::move(str));
+        owned = storage.get();
+        length = storage->size();
+        bytes = std::shared_ptr<const char>(storage, storage->data());
+    }
+
+    /// Make this buffer the sole owner of a growable copy of its bytes
+    void detach() {
+        if (owned && bytes.use_count() == 1)
+            return;
+        cppress::shared::count_copy(length);
+        adopt(std::string(data(), length));
+    }
+
+    void reset() noexcept {
+        bytes.reset();
+        length = 0;
+        owned = nullptr;
+    }
 
 public:
     /**
@@ -128,7 +169,19 @@ public:
      * Creates a data_buffer containing a copy of the string's characters.
      * The resulting buffer will have the same content as the string.
      */
-    explicit data_buffer(const std::string& str) : buffer(str.begin(), str.end()) {}
+    explicit data_buffer(const std::string& str) {
+        cppress::shared::count_copy(str.size());
+        adopt(std::string(str));
+    }
+
+    /**
+     * @brief Construct buffer by taking ownership of a string.
+     * @param str String whose storage becomes the buffer (left empty)
+     *
+     * No bytes are copied, which lets response bodies and headers reach the
+     * socket output queue without an extra allocation.
+     */
+    explicit data_buffer(std::string&& str) { adopt(std::move(str)); }
 
     /**
      * @brief Construct buffer from raw character data.
@@ -147,15 +200,32 @@ public:
      * data_buffer buf(raw_data, 7);  // Includes the null byte
      * @endcode
      */
-    explicit data_buffer(const char* data, std::size_t size) : buffer(data, data + size) {}
+    explicit data_buffer(const char* data, std::size_t size) {
+        cppress::shared::count_copy(size);
+        adopt(std::string(data, size));
+    }
+
+    /**
+     * @brief Construct a view over shared storage without copying.
+     * @param storage Pointer to the first viewed byte; its control block owns the storage
+     * @param size Number of bytes viewed
+     *
+     * Use the shared_ptr aliasing constructor to point into a larger
+     * allocation, e.g. a pooled receive chunk:
+     * @code
+     * std::shared_ptr<char> chunk = pool.acquire();
+     * data_buffer view(std::shared_ptr<const char>(chunk, chunk.get() + offset), n);
+     * @endcode
+     */
+    data_buffer(std::shared_ptr<const char> storage, std::size_t size) noexcept
+        : bytes(size ? std::move(storage) : nullptr), length(size) {}
 
     // Copy operations
     /**
      * @brief Copy constructor.
      * @param other Buffer to copy from
      *
-     * Creates a deep copy of another data_buffer. The new buffer will contain
-     * a complete copy of the source buffer's data.
+     * Shares the other buffer's storage; no bytes are copied.
      */
     data_buffer(const data_buffer& other) = default;
 
@@ -164,7 +234,7 @@ public:
      * @param other Buffer to copy from
      * @return Reference to this buffer after assignment
      *
-     * Replaces this buffer's content with a copy of the other buffer's data.
+     * Releases this buffer's storage and shares the other buffer's storage.
      */
     data_buffer& operator=(const data_buffer& other) = default;
 
@@ -173,18 +243,28 @@ public:
      * @brief Move constructor.
      * @param other Buffer to move from
      *
-     * Efficiently transfers ownership of the buffer data from another data_buffer.
-     * The source buffer becomes empty after the move. This operation is O(1)
-     * and doesn't copy the actual data.
+     * Transfers the view from another data_buffer in O(1).
+     * The source buffer becomes empty after the move.
      */
-    data_buffer(data_buffer&& other) = default;
+    data_buffer(data_buffer&& other) noexcept
+        : bytes(std::move(other.bytes)), length(other.length), owned(other.owned) {
+        other.reset();
+    }
 
     /**
      * @brief Move assignment operator.
      * @param other Buffer to move from
      * @return Reference to this buffer after assignment
      */
-    data_buffer& operator=(data_buffer&& other) = default;
+    data_buffer& operator=(data_buffer&& other) noexcept {
+        if (this != &other) {
+            bytes = std::move(other.bytes);
+            length = other.length;
+            owned = other.owned;
+            other.reset();
+        }
+        return *this;
+    }
 
     /**
      * @brief Append raw character data to the buffer.
@@ -192,13 +272,23 @@ public:
      * @param size Number of bytes to append from data
      *
      * Adds the specified number of bytes from the character array to the end
-     * of the buffer. The buffer will automatically resize to accommodate the
-     * new data.
+     * of the buffer. Grows in place when this buffer owns its storage
+     * exclusively, otherwise detaches into a private copy first.
      *
      * @warning The caller must ensure that 'data' points to at least 'size' bytes
      */
     void append(const char* data, std::size_t size) {
-        buffer.insert(buffer.end(), data, data + size);
+        if (size == 0)
+            return;
+        cppress::shared::count_copy(size);
+        if (length == 0) {
+            adopt(std::string(data, size));
+            return;
+        }
+        detach();
+        owned->append(data, size);
+        length = owned->size();
+        bytes = std::shared_ptr<const char>(bytes, owned->data());
     }
 
     /**
@@ -208,27 +298,52 @@ public:
      * Adds all characters from the string to the end of the buffer.
      * This is equivalent to calling append(str.data(), str.size()).
      */
-    void append(const std::string& str) { buffer.insert(buffer.end(), str.begin(), str.end()); }
+    void append(const std::string& str) { append(str.data(), str.size()); }
 
     /**
      * @brief Append another data_buffer to this buffer.
      * @param other Buffer to append
      *
      * Adds all bytes from the other buffer to the end of this buffer.
+     * Appending to an empty buffer just shares the other buffer's storage.
      */
     void append(const data_buffer& other) {
-        buffer.insert(buffer.end(), other.buffer.begin(), other.buffer.end());
+        if (length == 0) {
+            *this = other;
+            return;
+        }
+        append(other.data(), other.size());
     }
 
+    /**
+     * @brief Create a view over part of this buffer.
+     * @param pos Offset of the first byte
+     * @param len Maximum number of bytes, clamped to the end of the buffer
+     * @return Buffer sharing this buffer's storage
+     * @throws std::out_of_range if pos > size()
+     */
+    data_buffer slice(std::size_t pos, std::size_t len = std::string::npos) const {
+        if (pos > length)
+            throw std::out_of_range("data_buffer::slice position out of range");
+        std::size_t n = std::min(len, length - pos);
+        return data_buffer(std::shared_ptr<const char>(bytes, bytes.get() + pos), n);
+    }
+
+    /**
+     * @brief Get a non-owning view of the bytes.
+     * @return string_view valid while this buffer (or any buffer sharing its storage) lives
+     */
+    std::string_view view() const noexcept { return std::string_view(data(), length); }
+
     /**
      * @brief Get a pointer to the buffer's data.
      * @return Const pointer to the first byte of the buffer
      *
-     * Returns a pointer to the internal character array. The pointer is valid
+     * Returns a pointer to the viewed bytes. The pointer is valid
      * until the next non-const operation on the buffer. For empty buffers,
-     * the returned pointer may or may not be null, but should not be dereferenced.
+     * the returned pointer should not be dereferenced.
      */
-    const char* data() const { return buffer.data(); }
+    const char* data() const noexcept { return bytes ? bytes.get() : ""; }
 
     /**
      * @brief Get the size of the buffer in bytes.
@@ -237,7 +352,7 @@ public:
      * Returns the total number of bytes contained in the buffer.
      * For empty buffers, this returns 0.
      */
-    std::size_t size() const { return buffer.size(); }
+    std::size_t size() const noexcept { return length; }
 
     /**
      * @brief Check if the buffer is empty.
@@ -245,17 +360,15 @@ public:
      *
      * This is equivalent to checking if size() == 0, but may be more efficient.
      */
-    bool empty() const { return buffer.empty(); }
+    bool empty() const noexcept { return length == 0; }
 
     /**
      * @brief Clear all data from the buffer.
      *
-     * Removes all data from the buffer, making it empty. size() will return 0 after this call.
+     * Drops this buffer's reference to its storage, making it empty.
+     * size() will return 0 after this call.
      */
-    void clear() {
-        buffer.clear();
-        buffer.shrink_to_fit();
-    }
+    void clear() noexcept { reset(); }
 
     /**
      * @brief Convert the buffer contents to a string.
@@ -267,9 +380,25 @@ public:
      *
      * @note If the buffer contains null bytes, they will be included in the string
      */
-    std::string to_string() const { return std::string(buffer.begin(), buffer.end()); }
+    std::string to_string() const {
+        cppress::shared::count_copy(length);
+        return std::string(data(), length);
+    }
+
+    /**
+     * @brief Move the buffer contents out as a string.
+     * @return The buffered bytes; the buffer is left empty
+     *
+     * Counterpart of data_buffer(std::string&&): no copy is made when this
+     * buffer is the sole owner of its string, otherwise the bytes are copied.
+     */
+    std::string release() {
+        std::string out = (owned && bytes.use_count() == 1) ? std::move(*owned) : to_string();
+        reset();
+        return out;
+    }
 
     /// Default destructor
     ~data_buffer() = default;
 };
-}  // namespace cppress::sockets
\ No newline at end of file
+}  // namespace cppress::sockets
@@ -0,0 +1,127 @@
+#pragma once
+
+/**
+ * @file datagram_batch.hpp
+ * @brief Fixed set of datagram slots for batched UDP I/O
+ *
+ * socket::receive() and socket::send_to() move one datagram per system call
+ * and allocate a data_buffer for each. A datagram_batch owns one buffer cut
+ * into equal slots plus the per-datagram headers, and is reused across
+ * socket::receive_batch() / socket::send_batch() calls, which move up to
+ * capacity() datagrams with a single recvmmsg / sendmmsg on Linux.
+ *
+ * Segmentation offload:
+ * - Sending: a slot pushed with a segment size is split into datagrams of
+ *   that size by the kernel (UDP_SEGMENT), one header for many packets
+ * - Receiving: with socket::set_udp_gro() the kernel may coalesce datagrams
+ *   of one flow into a single slot; segment_size() tells how to split it
+ */
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#if defined(_WIN32) || defined(_WIN64) || defined(__CYGWIN__)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <sys/socket.h>
+#include <sys/uio.h>
+#endif
+
+#include "socket_address.hpp"
+
+namespace cppress::sockets {
+
+/**
+ * @brief Reusable datagram slots with their payloads and peer addresses
+ *
+ * Payload views returned by payload() stay valid until the batch is filled
+ * again.
+ *
+ * @note Not thread-safe
+ */
+class datagram_batch {
+public:
+    /**
+     * @brief Allocates the slots
+     * @param capacity Datagrams moved per call at most
+     * @param slot_size Largest datagram (or coalesced GRO run) a slot holds
+     * @throws std::invalid_argument if capacity or slot_size is 0
+     */
+    explicit datagram_batch(std::size_t capacity = 64, std::size_t slot_size = 2048);
+
+    datagram_batch(const datagram_batch&) = delete;
+    datagram_batch& operator=(const datagram_batch&) = delete;
+
+    /// @brief Number of slots
+    std::size_t capacity() const noexcept { return slots; }
+
+    /// @brief Bytes per slot
+    std::size_t slot_size() const noexcept { return slot_bytes; }
+
+    /// @brief Datagrams currently held (received, or queued for sending)
+    std::size_t size() const noexcept { return count; }
+
+    /// @brief True if no datagram is held
+    bool empty() const noexcept { return count == 0; }
+
+    /// @brief True if every slot is used
+    bool full() const noexcept { return count == slots; }
+
+    /// @brief Forgets the datagrams held, the slots are reused
+    void clear() noexcept { count = 0; }
+
+    /// @brief Bytes of datagram i, i below size()
+    std::string_view payload(std::size_t i) const noexcept {
+        return std::string_view(buffer.get() + i * slot_bytes, lengths[i]);
+    }
+
+    /**
+     * @brief Segment size of datagram i
+     * @return Size of the datagrams coalesced (GRO) or to be split (GSO) in
+     *         slot i, 0 if the slot is a single datagram
+     */
+    std::size_t segment_size(std::size_t i) const noexcept { return segments[i]; }
+
+    /// @brief Sender (after receive) or destination (before send) of datagram i
+    socket_address peer(std::size_t i) const;
+
+    /// @brief Raw address of datagram i, avoids building a socket_address per packet
+    const sockaddr_storage& peer_storage(std::size_t i) const noexcept { return addresses[i]; }
+
+    /**
+     * @brief Queues a datagram for socket::send_batch()
+     * @param to Destination address
+     * @param data Payload, copied into the next slot
+     * @param n Payload size
+     * @param segment_size Non-zero to have the kernel split the payload into
+     *        datagrams of this size (UDP GSO, Linux)
+     * @return false if the batch is full or the payload exceeds slot_size()
+     */
+    bool push(const socket_address& to, const void* data, std::size_t n,
+              std::size_t segment_size = 0);
+
+private:
+    friend class socket;
+
+    std::size_t slots;
+    std::size_t slot_bytes;
+    std::unique_ptr<char[]> buffer;
+    std::vector<std::size_t> lengths;
+    std::vector<std::size_t> segments;
+    std::vector<sockaddr_storage> addresses;
+    std::vector<socklen_t> address_lengths;
+    std::size_t count = 0;
+
+#if defined(__linux__) || defined(__linux)
+    std::vector<mmsghdr> headers;
+    std::vector<iovec> iov;
+    std::vector<char> control;
+
+    /// Points the headers of slots [first, first + n) at their slot, address and control space
+    void prepare_headers(std::size_t first, std::size_t n, bool receiving) noexcept;
+#endif
+};
+}  // namespace cppress::sockets
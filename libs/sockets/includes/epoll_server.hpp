@@ -21,17 +21,23 @@
  * - Configurable file descriptor limits
  * - Thread-safe connection handling
  * - Graceful shutdown support
+ * - Optional multi-reactor mode (one event loop per core over SO_REUSEPORT listeners)
  *
  * @note This implementation is Linux-specific and will not compile on other platforms
  */
 
 #include <signal.h>
 
+#include <array>
+#include <atomic>
 #include <chrono>
 #include <deque>
+#include <functional>
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 // check if we are on linux and platform that supports epoll
 #if (defined(__linux__) || defined(__linux))
@@ -41,15 +47,80 @@
 #include "wepoll.hpp"
 #endif
 
+#include "buffer_pool.hpp"
 #include "connection.hpp"
+#include "connection_table.hpp"
 #include "data_buffer.hpp"
+#include "io_uring_ring.hpp"
+#include "loop_stats.hpp"
+#include "mpsc_queue.hpp"
+#include "output_chain.hpp"
 #include "socket.hpp"
+#include "socket_options.hpp"
 #include "tcp_server.hpp"
+#include "timer_wheel.hpp"
+#include "tls.hpp"
 
-/// Custom epoll event used to signal connection closure
+/// Custom epoll event formerly used to signal connection closure
+/// @deprecated Closure requests now travel through the reactor command queue
 const unsigned int HAMZA_CUSTOM_CLOSE_EVENT = 3545940;
 
 namespace cppress::sockets {
+/**
+ * @brief I/O mechanism driving the reactors of an epoll_server
+ *
+ * io_uring uses multishot accept, multishot receive into provided buffers
+ * and asynchronous sendmsg, and falls back to epoll when the kernel (or the
+ * build's kernel headers) lack any of them.
+ *
+ * On Windows the epoll backend runs on the wepoll emulation (readiness via
+ * AFD polling, then synchronous send/recv). There is no completion-port
+ * backend yet; one would follow the io_uring model: per-connection
+ * operations checked against the connection table generation on completion,
+ * one send in flight per connection.
+ */
+enum class io_backend { epoll, io_uring };
+
+/**
+ * @brief Per-connection deadlines driven by the reactor's timer wheel
+ *
+ * idle is armed by the server itself (see epoll_server::set_idle_timeout) and
+ * only runs while neither header nor body is armed; those two are set and
+ * cleared by the protocol layer around the phases it wants to bound.
+ * connect bounds the handshake of outbound connections (see
+ * epoll_server::connect_async).
+ */
+enum class connection_deadline { idle = 0, header = 1, body = 2, connect = 3 };
+
+/**
+ * @brief Callback scheduled with epoll_server::run_after, linked into its loop's wheel
+ *
+ * Told apart from connection deadlines by its tag.
+ */
+struct loop_timer : timer_node {
+    static constexpr int TAG = 4;
+
+    loop_timer() : timer_node(-1, TAG) {}
+
+    std::function<void()> callback;
+};
+
+/**
+ * @brief Callbacks of an outbound connection opened by epoll_server::connect_async
+ *
+ * Invoked on the event loop owning the connection; they must not block.
+ */
+struct client_handlers {
+    /// Connected (error 0), or failed with conn nullptr and an errno value (ETIMEDOUT on timeout)
+    std::function<void(std::shared_ptr<connection> conn, int error)> on_connect;
+
+    /// Bytes received on the connection
+    std::function<void(std::shared_ptr<connection> conn, const data_buffer& db)> on_data;
+
+    /// Connection closed while in use (not called for idle pooled connections)
+    std::function<void(std::shared_ptr<connection> conn)> on_close;
+};
+
 /**
  * @brief Connection state structure for epoll-managed connections
  *
@@ -61,14 +132,175 @@ struct epoll_connection {
     /// Shared pointer to the connection object
     std::shared_ptr<connection> conn;
 
-    /// Queue of pending outbound messages waiting to be sent
-    std::deque<std::string> outq;  // queued writes
+    /// Chain of pending outbound buffers, flushed with writev
+    output_chain outq;  // queued writes
 
     /// Flag indicating if the connection wants to write (EPOLLOUT enabled)
     bool want_write = false;
 
     /// Flag indicating if the connection wants to close, meant to be set by user
     bool want_close = false;
+
+    /// Close the connection once the output queue has been fully flushed
+    bool close_after_flush = false;
+
+    /// Connection is already listed in its reactor's pending flush list
+    bool pending_flush = false;
+
+    /// Reads are paused because outq grew past the high watermark
+    bool reads_paused = false;
+
+    /// Expected size of the next read, 0 until the first one; picks the chunk size class
+    std::size_t read_size = 0;
+
+    /// One timer per connection_deadline, linked into the reactor's timer wheel
+    std::array<timer_node, 4> deadlines;
+
+    /// Outbound connection: pool key (upstream address), empty for accepted connections
+    std::string upstream;
+
+    /// Outbound connection: callbacks of its current user, nullptr while idle in the pool
+    std::shared_ptr<client_handlers> client;
+
+    /// Outbound connection: the TCP handshake has not completed yet
+    bool connecting = false;
+
+    /// TLS handshake in progress, nullptr for plaintext and once records moved into the kernel
+    std::unique_ptr<tls_handshaker> tls;
+
+    /// io_uring backend: the send (or POLLOUT wait) in flight, if any
+    uring_op* send_op = nullptr;
+
+    /// io_uring backend: the multishot receive armed for this connection
+    uring_op* recv_op = nullptr;
+};
+
+/**
+ * @brief Request handed from an application thread to the owning event loop
+ *
+ * Commands carry the connection they target so that the loop can ignore
+ * them if the file descriptor was closed and reused in the meantime.
+ */
+struct reactor_command {
+    enum class kind {
+        send,
+        close,
+        stop_reading,
+        arm_deadline,
+        cancel_deadline,
+        connect,
+        release,
+        timer
+    };
+
+    kind type = kind::send;
+
+    /// Target file descriptor
+    int fd = -1;
+
+    /// Target connection, nullptr to match whatever connection holds fd
+    std::shared_ptr<connection> conn;
+
+    /// Segments to queue for kind::send, written back to back without concatenation
+    std::vector<output_segment> payload;
+
+    /// Deadline targeted by kind::arm_deadline and kind::cancel_deadline
+    connection_deadline deadline = connection_deadline::idle;
+
+    /// Delay for kind::arm_deadline and kind::timer, connect timeout for kind::connect
+    std::chrono::milliseconds delay{0};
+
+    /// Address to connect to for kind::connect
+    socket_address upstream;
+
+    /// Callbacks of the outbound connection for kind::connect
+    std::shared_ptr<client_handlers> client;
+
+    /// Callback to run for kind::timer
+    std::function<void()> callback;
+};
+
+/**
+ * @brief State owned by a single event loop (reactor)
+ *
+ * Each reactor has its own epoll instance, event buffer, listener and
+ * connection table, so reactors never share mutable I/O state. In
+ * multi-reactor mode every reactor is driven by its own thread.
+ */
+struct epoll_reactor {
+    /// Index of this reactor inside the server (also used for CPU pinning)
+    std::size_t index = 0;
+
+#if defined(_WIN32) || defined(_WIN64) || defined(__CYGWIN__)
+    HANDLE epoll_fd = INVALID_HANDLE_VALUE;
+#else
+    /// Epoll file descriptor for event monitoring
+    int epoll_fd = -1;
+#endif
+
+    /// Listening socket accepted from by this reactor
+    std::shared_ptr<socket> listener_socket;
+
+    /// True if the listener was registered for this reactor alone (SO_REUSEPORT),
+    /// false if it is shared with another reactor through EPOLLEXCLUSIVE
+    bool owns_listener = false;
+
+    /// The accept budget ran out with connections possibly left in the backlog
+    bool accept_pending = false;
+
+    /// Accepting is suspended, the connection cap was reached
+    bool accept_paused = false;
+
+    /// Spare descriptor given up to accept and drop a connection on EMFILE (-1 if none)
+    int reserve_fd = -1;
+
+    /// Vector of epoll events for batch event processing
+    std::vector<epoll_event> events;
+
+    /// Connection state indexed by file descriptor
+    connection_table<epoll_connection> conns;
+
+    /// Commands pushed by non-loop threads, drained between epoll_wait calls
+    mpsc_queue<reactor_command> commands;
+
+    /// eventfd used to wake the loop when commands arrive (Linux only, -1 otherwise)
+    int wake_fd = -1;
+
+    /// Connections whose output queue or close state changed since the last flush pass
+    std::vector<int> pending_flush;
+
+    /// Receive chunks of this reactor, recycled when the last slice is dropped
+    buffer_pool pool{std::vector<std::size_t>{4 * 1024, 16 * 1024, 64 * 1024}, 64};
+
+    /// Current receive chunk, try_read() hands out slices of it
+    receive_buffer rx{pool, pool.min_chunk_size()};
+
+    /// Deadlines of this reactor's connections, bounds the epoll_wait timeout
+    timer_wheel timers;
+
+    /// Armed run_after() callbacks, keyed by their node in timers
+    std::unordered_map<const timer_node*, std::unique_ptr<loop_timer>> loop_timers;
+
+    /// Activity counters, written by this reactor's thread only
+    loop_counters counters;
+
+#if CPPRESS_HAS_IO_URING
+    /// Ring driving this reactor with the io_uring backend, nullptr with epoll
+    std::unique_ptr<io_uring_ring> ring;
+#endif
+
+    /// Operations submitted to the ring and not completed yet
+    std::unordered_set<uring_op*> uring_ops;
+
+    /// Idle outbound connections by upstream address, as (fd, generation), oldest first;
+    /// entries of connections closed meanwhile are skipped when popped
+    std::unordered_map<std::string, std::deque<std::pair<int, std::uint32_t>>> idle_upstreams;
+
+    /// io_uring backend: the multishot accept on the listener, nullptr without one
+    uring_op* accept_op = nullptr;
+
+    /// io_uring backend: accept_op is submitted and has not reported its last completion
+    bool accept_armed = false;
 };
 
 /**
@@ -87,7 +319,8 @@ struct epoll_connection {
  * - Thread-safe connection management
  *
  * Architecture:
- * - Single-threaded event loop (epoll_wait)
+ * - One event loop (epoll_wait) per reactor, a single reactor by default
+ * - Multi-reactor mode: one SO_REUSEPORT listener and connection table per reactor
  * - Non-blocking I/O operations throughout
  * - Connection state tracking via epoll_connection struct
  * - Automatic cleanup of closed connections
@@ -103,34 +336,179 @@ struct epoll_connection {
  */
 class epoll_server : public tcp_server {
 private:
-#if defined(_WIN32) || defined(_WIN64) || defined(__CYGWIN__)
-    HANDLE epoll_fd = INVALID_HANDLE_VALUE;
-#else
-    /// Epoll file descriptor for event monitoring
-    int epoll_fd = -1;
-#endif
+    /// Event loops owned by this server, reactor 0 runs on the thread calling listen()
+    std::vector<std::unique_ptr<epoll_reactor>> reactors;
 
-    /// Shared pointer to the listening socket
-    std::shared_ptr<socket> listener_socket;
+    /// Reactor driven by the calling thread, nullptr on non-loop threads
+    static thread_local epoll_reactor* current_reactor;
 
-    /// Vector of epoll events for batch event processing
-    std::vector<epoll_event> events;
+    /// Pin each reactor thread to the CPU matching its index (Linux only)
+    bool pin_reactors = false;
+
+    /// CPUs of each reactor thread, see set_reactor_cpus(); takes precedence over pin_reactors
+    std::vector<std::vector<int>> reactor_cpus;
+
+    /// Backend the reactors actually run (io_uring only if every ring was set up)
+    io_backend backend = io_backend::epoll;
+
+    /// Owner reactor index + 1 of each connection fd (0: none), indexed by fd.
+    /// Only maintained with more than one reactor; written by the owning reactor,
+    /// read by any thread without locking
+    std::unique_ptr<std::atomic<std::uint32_t>[]> fd_owner;
+
+    /// Number of entries in fd_owner, the process descriptor limit
+    std::size_t fd_owner_size = 0;
+
+    /// Flag for graceful shutdown signaling, observed by every reactor
+    std::atomic<bool> g_stop{false};
 
-    /// Atomic flag for graceful shutdown signaling
-    volatile sig_atomic_t g_stop = 0;
+    /// drain() was called, listeners are not watched again
+    std::atomic<bool> draining{false};
+
+    /// Reactors still holding accepted connections while draining
+    std::atomic<std::size_t> draining_reactors{0};
 
     /// Current number of open connections
-    std::size_t current_open_connections = 10;
+    std::atomic<std::size_t> current_open_connections{0};
 
     /// Maximum number of file descriptors, if failed setting to the specified max
     std::size_t max_fds = 1024;
 
+    /// Open connections at which reactors stop accepting, 0 for no cap
+    std::size_t max_connections = 0;
+
+    /// Connections accepted per listener readiness before other events are served
+    std::size_t accept_budget = 64;
+
+    /// Idle outbound connections kept per upstream and reactor
+    std::size_t upstream_max_idle = 8;
+
+    /// Idle outbound connections are closed after this long in the pool
+    std::chrono::milliseconds upstream_idle_timeout{30000};
+
+    /// Round-robin cursor spreading connect_async and run_after calls from non-loop threads
+    std::atomic<std::size_t> next_client_reactor{0};
+
+    /// Idle deadline armed on every connection, 0 disables it
+    std::chrono::milliseconds idle_timeout{0};
+
+    /// Queued output above which a connection stops being read, 0 disables backpressure
+    std::size_t write_high_watermark = 0;
+
+    /// Queued output at or below which a paused connection is read again
+    std::size_t write_low_watermark = 0;
+
+    /// Batches of at least this many bytes are sent with MSG_ZEROCOPY, 0 disables
+    std::size_t zerocopy_threshold = 0;
+
+    /// Creates the TLS handshaker of each accepted connection, empty for plaintext
+    tls_handshaker_factory tls_factory;
+
+    /// Option profile of accepted connections
+    socket_options accepted_options;
+
+    /// accepted_options has settings accepted sockets do not inherit from the listener
+    bool per_connection_options = false;
+
     /// @brief  tries to accept connections
-    void try_accept();
+    /// @param r Reactor whose listener is drained
+    void try_accept(epoll_reactor& r);
+
+    /**
+     * @brief Registers an accepted connection with a reactor
+     * @param r Reactor that accepted it
+     * @param cfd Non-blocking connection descriptor
+     * @param client_addr Peer address
+     * @return Connection state, owned by r.conns
+     */
+    epoll_connection& open_conn(epoll_reactor& r, int cfd, sockaddr_storage client_addr);
+
+    /// @brief Picks the chunk class of the connection's next read from the last one
+    static void adapt_read_size(epoll_reactor& r, epoll_connection& c, std::size_t want,
+                                std::size_t got) noexcept;
+
+    /// @brief Nanoseconds between two clock readings
+    static std::uint64_t elapsed_ns(std::chrono::steady_clock::time_point from,
+                                    std::chrono::steady_clock::time_point to) noexcept;
+
+    /**
+     * @brief Registers a socket whose connection object exists with the reactor
+     *
+     * Shared by accepted and outbound connections: arms the idle deadline and
+     * records the owner for cross-thread commands.
+     */
+    epoll_connection& register_conn(epoll_reactor& r, int fd, std::shared_ptr<connection> conn);
+
+    /// @brief Hands received bytes to on_message_received or the outbound connection's handler
+    void deliver(epoll_reactor& r, int fd, epoll_connection& c, const data_buffer& db);
+
+    /// @brief Takes a pooled connection to the upstream or starts a non-blocking connect
+    void start_connect(epoll_reactor& r, reactor_command& cmd);
+
+    /// @brief Completes the handshake of an outbound connection once its socket is writable
+    void finish_connect(epoll_reactor& r, int fd, epoll_connection& c);
+
+    /// @brief Reports a failed handshake and closes the connection
+    void fail_connect(epoll_reactor& r, int fd, epoll_connection& c, int error);
+
+    /// @brief Returns an outbound connection to its upstream's idle pool
+    void release_to_pool(epoll_reactor& r, int fd, epoll_connection& c);
+
+    /// @brief Creates the handshaker of an accepted connection and takes its first step
+    void start_tls(epoll_reactor& r, int fd, epoll_connection& c);
+
+    /**
+     * @brief Advances a TLS handshake on socket readiness
+     *
+     * On completion the record layer moves into the kernel, output queued
+     * meanwhile is flushed and the connection is read like a plaintext one.
+     */
+    void advance_tls(epoll_reactor& r, int fd, epoll_connection& c);
+
+    /// @brief Closes the connection once its output is flushed, from inside the loop
+    static void close_later(epoll_reactor& r, int fd, epoll_connection& c);
+
+    /// @brief Hands a command to a reactor, in place on its own thread
+    void deliver_command(epoll_reactor& r, reactor_command cmd);
+
+    /// @brief True if the connection cap is set and reached
+    bool at_connection_cap() const noexcept {
+        return max_connections != 0 && current_open_connections.load() >= max_connections;
+    }
+
+    /// @brief Stops watching the listener until resume_accept()
+    void pause_accept(epoll_reactor& r);
+
+    /// @brief Watches the listener again once the server is back under its connection cap
+    void resume_accept(epoll_reactor& r);
+
+    /// @brief Accepts what the listener has queued, then shuts it down for good
+    void stop_accepting(epoll_reactor& r);
+
+    /**
+     * @brief One round of drain(): closes the reactor's idle connections
+     * @param r Reactor whose accepted connections are checked
+     * @param deadline Time at which the server stops whatever is still open
+     */
+    void drain_step(epoll_reactor& r, std::chrono::steady_clock::time_point deadline);
+
+    /**
+     * @brief Accepts and drops one pending connection after EMFILE
+     * @return true if a connection was removed from the backlog
+     */
+    bool shed_connection(epoll_reactor& r);
 
     /// @brief  Tries to read data from a connection
+    /// @param r Reactor owning the connection
     /// @param c Reference to the epoll_connection to read from
-    void try_read(epoll_connection& c);
+    void try_read(epoll_reactor& r, epoll_connection& c);
+
+    /**
+     * @brief Finds the reactor owning a connection file descriptor
+     * @param fd Connection file descriptor
+     * @return Owning reactor, or nullptr if the fd is not tracked
+     */
+    epoll_reactor* reactor_for(int fd);
 
 #if (defined(__linux__) || defined(__linux))
     /**
@@ -153,7 +531,7 @@ private:
      * Registers a file descriptor with the epoll instance for event monitoring.
      * Uses edge-triggered mode (EPOLLET) for maximum performance.
      */
-    int add_epoll(int fd, uint32_t ev);
+    int add_epoll(epoll_reactor& r, int fd, uint32_t ev);
 
     /**
      * @brief Modifies epoll monitoring events for a file descriptor
@@ -164,7 +542,7 @@ private:
      * Updates the events being monitored for an existing file descriptor.
      * Used to enable/disable write monitoring based on output queue state.
      */
-    int mod_epoll(int fd, uint32_t ev);
+    int mod_epoll(epoll_reactor& r, int fd, uint32_t ev);
 
     /**
      * @brief Removes file descriptor from epoll monitoring
@@ -174,7 +552,7 @@ private:
      * Unregisters a file descriptor from epoll monitoring.
      * Called during connection cleanup.
      */
-    int del_epoll(int fd);
+    int del_epoll(epoll_reactor& r, int fd);
 
     /**
      * @brief Closes and cleans up a connection
@@ -186,21 +564,93 @@ private:
      * - Closes the socket
      * - Removes from connection map
      */
-    void close_conn(int fd);
+    void close_conn(epoll_reactor& r, int fd);
 
     /**
      * @brief Attempts to flush pending writes for a connection
+     * @param r Reactor owning the connection, its counters record the flush
      * @param c Reference to the epoll_connection to flush
-     * @return true if all data was sent, false if more data remains
+     * @return complete if all data was sent, would_block if more data remains,
+     *         error if the connection failed
      *
-     * Tries to send all queued data for a connection. Handles partial sends
-     * gracefully by updating the queue. Returns false if EAGAIN/EWOULDBLOCK
-     * is encountered, indicating the socket buffer is full.
+     * Hands the queued segments to the kernel with writev, up to IOV_MAX
+     * segments per call. Partial sends only advance an offset into the front
+     * segment.
+     */
+    output_chain::flush_result flush_writes(epoll_reactor& r, epoll_connection& c);
+
+    /**
+     * @brief Applies a command on the loop thread owning the connection
+     * @param r Reactor owning the connection
+     * @param cmd Command to apply
+     *
+     * Only mutates connection state and schedules the connection for the
+     * next flush pass, so it is safe to call from inside event callbacks.
+     */
+    void apply_command(epoll_reactor& r, reactor_command& cmd);
+
+    /**
+     * @brief Routes a command to its reactor
+     * @param cmd Command to deliver
+     *
+     * Applied immediately when called from the owning loop thread, otherwise
+     * pushed onto the reactor queue and the loop is woken through its eventfd
+     * (only when the queue was empty, so a burst costs a single wakeup).
+     */
+    void dispatch_command(reactor_command cmd);
+
+    /**
+     * @brief Drains the reactor command queue and flushes touched connections
+     * @param r Reactor to service
      */
-    bool flush_writes(epoll_connection& c);
+    void drain_commands(epoll_reactor& r);
+
+    /**
+     * @brief Flushes a connection and updates its EPOLLOUT interest
+     * @param r Reactor owning the connection
+     * @param fd File descriptor of the connection
+     * @param c Connection state
+     * @return false if the connection was closed
+     */
+    bool service_writes(epoll_reactor& r, int fd, epoll_connection& c);
+
+    /**
+     * @brief Re-arms the idle deadline after activity on a connection
+     * @param r Reactor owning the connection
+     * @param c Connection state
+     *
+     * Does nothing while a header or body deadline is armed, those bound the
+     * connection instead.
+     */
+    void touch_idle(epoll_reactor& r, epoll_connection& c);
+
+    /**
+     * @brief Epoll interest set matching a connection's state
+     * @return EPOLLET plus EPOLLIN unless reads are paused, EPOLLOUT while output is pending
+     */
+    static uint32_t interest(const epoll_connection& c) noexcept;
+
+    /**
+     * @brief Pauses or resumes reading a connection against the write watermarks
+     * @param r Reactor owning the connection
+     * @param fd Connection file descriptor
+     * @param c Connection state
+     *
+     * Called whenever outq grows or drains. Crossing either watermark flips
+     * reads_paused, updates the read interest (EPOLLIN, or the multishot
+     * receive with io_uring) and fires on_backpressure().
+     */
+    void update_backpressure(epoll_reactor& r, int fd, epoll_connection& c);
+
+    /**
+     * @brief Fires every expired deadline and run_after() callback of a reactor
+     * @param r Reactor to service
+     */
+    void expire_deadlines(epoll_reactor& r);
 
     /**
      * @brief Main event loop using epoll_wait
+     * @param r Reactor driven by this loop
      * @param timeout Timeout in milliseconds for epoll_wait (-1 for blocking)
      *
      * The core of the server - runs the event loop that:
@@ -211,20 +661,69 @@ private:
      * - Handles connection closures
      * - Manages epoll event buffer resizing
      */
-    void epoll_loop(int timeout = 1000);
+    void epoll_loop(epoll_reactor& r, int timeout = 1000);
+
+#if CPPRESS_HAS_IO_URING
+    /**
+     * @brief Event loop of the io_uring backend
+     * @param r Reactor driven by this loop
+     * @param timeout Upper bound in milliseconds for one wait (-1 for none)
+     *
+     * Same contract as epoll_loop(): one io_uring_enter submits every queued
+     * operation and waits for completions; commands and deadlines are
+     * serviced between waits.
+     */
+    void uring_loop(epoll_reactor& r, int timeout);
+
+    /// @brief Handles one completion of the io_uring backend
+    void uring_complete(epoll_reactor& r, const io_uring_cqe& cqe);
+
+    /// @brief Queues a new operation on the reactor's ring
+    uring_op* uring_submit(epoll_reactor& r, uring_op::kind type, int fd,
+                           std::uint32_t generation);
+
+    /// @brief (Re)arms the multishot submission of an operation
+    void uring_arm(epoll_reactor& r, uring_op* op);
+
+    /// @brief Forgets a completed operation
+    void uring_release(epoll_reactor& r, uring_op* op);
+
+    /**
+     * @brief io_uring counterpart of service_writes()
+     * @return false if the connection was closed
+     */
+    bool uring_service_writes(epoll_reactor& r, int fd, epoll_connection& c);
+#endif
+
+    /**
+     * @brief Pins the calling thread to the CPUs of a reactor
+     * @param index Reactor index; without set_reactor_cpus() the CPU of the
+     *        same index, wrapped around the number of online CPUs
+     */
+    void pin_current_thread(std::size_t index);
+
+    /// @brief Steers each reactor's own listener to its CPU's receive queue (SO_INCOMING_CPU)
+    void steer_listeners();
 
 protected:
-    /// Map of file descriptors to their connection state
-    std::unordered_map<int, epoll_connection> conns;
+    /// Returned by current_reactor_index() on threads that run no event loop
+    static constexpr std::size_t NO_REACTOR = static_cast<std::size_t>(-1);
+
+    /**
+     * @brief Index of the reactor driven by the calling thread
+     * @return Reactor index, NO_REACTOR on any other thread
+     */
+    static std::size_t current_reactor_index() noexcept;
 
     /**
      * @brief Interface for derived classes to close a connection
      * @param conn Shared pointer to the connection to close
      *
      * Provides a clean interface for derived classes to request connection closure.
-     * Uses custom epoll event to signal the main loop to close the connection
-     * during the next event processing cycle.
+     * The request is handed to the owning loop, which closes the connection once
+     * its pending output has been flushed.
      *
+     * @note Safe to call from any thread
      * @note Never close the connection directly from outside, nor use conn->close()
      * @note Overrides tcp_server::close_connection
      */
@@ -244,21 +743,119 @@ protected:
      */
     void close_connection(int fd);
 
+    /**
+     * @brief Arms (or re-arms) a deadline of a connection
+     * @param conn Connection to bound
+     * @param which Deadline to arm
+     * @param after Delay from now; on expiry on_deadline_expired() is called
+     *
+     * Arming header or body suspends the idle deadline until both are cleared.
+     *
+     * @note Safe to call from any thread, O(1) on the owning loop
+     */
+    void set_deadline(std::shared_ptr<connection> conn, connection_deadline which,
+                      std::chrono::milliseconds after);
+
+    /**
+     * @brief Cancels a deadline of a connection
+     * @param conn Connection to update
+     * @param which Deadline to cancel
+     *
+     * @note Safe to call from any thread, O(1) on the owning loop
+     */
+    void clear_deadline(std::shared_ptr<connection> conn, connection_deadline which);
+
+    /**
+     * @brief Called on the loop thread when a connection deadline passes
+     * @param conn Connection whose deadline expired
+     * @param which Deadline that expired
+     *
+     * Default implementation closes the connection once its pending output
+     * has been flushed.
+     *
+     * @note Virtual function - can be overridden by derived classes
+     */
+    virtual void on_deadline_expired(std::shared_ptr<connection> conn,
+                                     connection_deadline which);
+
+    /**
+     * @brief Called on the loop thread when reading a connection pauses or resumes
+     * @param conn Connection whose queued output crossed a watermark
+     * @param paused true above the high watermark, false once drained to the low one
+     *
+     * Default implementation does nothing. Data already read when the pause
+     * starts is still delivered through on_message_received().
+     *
+     * @note Virtual function - can be overridden by derived classes
+     */
+    virtual void on_backpressure(std::shared_ptr<connection> conn, bool paused);
+
+    /**
+     * @brief Called on the loop thread while draining, decides which connections to close
+     * @param conn Accepted connection still open
+     * @return true if closing the connection now loses no work, e.g. an idle keep-alive
+     *
+     * Default implementation returns true: the connection is closed once its
+     * pending output has been flushed.
+     *
+     * @note Virtual function - can be overridden by derived classes
+     */
+    virtual bool connection_idle(const std::shared_ptr<connection>& conn);
+
     /**
      * @brief Interface for derived classes to send messages
      * @param conn Shared pointer to the target connection
      * @param db Data buffer containing the message to send
      *
-     * Queues a message for sending to the specified connection. The message
-     * is added to the connection's output queue and epoll is notified to
-     * monitor for write availability.
+     * Queues a message for sending to the specified connection. From the loop
+     * thread the message goes straight to the output queue; from any other
+     * thread it is pushed onto the owning reactor's MPSC queue and the loop
+     * is woken through an eventfd. The loop drains the queue in batches and
+     * flushes each touched connection once.
      *
+     * @note Safe to call from any thread
      * @note Never Use conn->send(), always use send_message()
      * @note Overrides tcp_server::send_message
      * @note Messages are sent asynchronously when the socket is ready
      */
     void send_message(std::shared_ptr<connection> conn, const data_buffer& db) override;
 
+    /**
+     * @brief Queues a message, taking ownership of its storage
+     * @param conn Shared pointer to the target connection
+     * @param db Data buffer to move into the connection's output chain
+     *
+     * Same as send_message(conn, const data_buffer&) without copying the bytes.
+     */
+    void send_message(std::shared_ptr<connection> conn, data_buffer&& db);
+
+    /**
+     * @brief Queues several buffers to be written back to back
+     * @param conn Shared pointer to the target connection
+     * @param segments Buffers (e.g. headers, body, trailers) moved into the output chain
+     *
+     * The segments are queued atomically with respect to other sends and are
+     * usually written with a single writev call, without concatenating them.
+     */
+    void send_message(std::shared_ptr<connection> conn, std::vector<data_buffer>&& segments);
+
+    /**
+     * @brief Queues memory and file segments to be written in order
+     * @param conn Shared pointer to the target connection
+     * @param segments Buffers and file regions, e.g. headers followed by a file body
+     *
+     * File regions are sent with sendfile(2) on Linux, so their bytes never
+     * enter user space. Memory segments around them keep their relative order.
+     */
+    void send_message(std::shared_ptr<connection> conn, std::vector<output_segment>&& segments);
+
+    /**
+     * @brief Queues a file region
+     * @param conn Shared pointer to the target connection
+     * @param file Region to send after everything already queued
+     */
+    void send_file(std::shared_ptr<connection> conn, file_region file);
+
     /**
      * @brief Called when an exception occurs during server operation
      * @param e The exception that occurred
@@ -344,17 +941,23 @@ public:
     /**
      * @brief Constructs an epoll server with specified file descriptor limit
      * @param max_fds Maximum number of file descriptors the server can handle
+     * @param reactor_count Number of event loops, each with its own epoll instance (min 1)
+     * @param pin_reactors Pin each reactor thread to one CPU core (Linux only)
+     * @param backend Requested I/O backend, see active_backend() for the one in use
      *
      * Initializes the epoll server by:
      * - Setting process file descriptor limits via setrlimit
-     * - Creating epoll instance with EPOLL_CLOEXEC flag
-     * - Allocating initial event buffer (4096 events)
+     * - Creating one epoll instance per reactor with EPOLL_CLOEXEC flag
+     * - Allocating initial event buffer (4096 events) per reactor
      * - Validating epoll creation success
      *
      * @throws std::runtime_error if epoll creation fails
      * @note Higher max_fds allows more concurrent connections but uses more memory
+     * @note With reactor_count > 1 the callbacks are invoked concurrently from
+     *       several reactor threads, derived classes must be thread-safe
      */
-    epoll_server(int max_fds);
+    epoll_server(int max_fds, std::size_t reactor_count = 1, bool pin_reactors = false,
+                 io_backend backend = io_backend::epoll);
 
     /**
      * @brief Virtual destructor for proper cleanup
@@ -378,7 +981,8 @@ public:
      * - Graceful shutdown signals
      *
      * This method blocks until the server is stopped via shutdown()
-     * or a signal is received.
+     * or a signal is received. With several reactors, reactor 0 runs on the
+     * calling thread and the others on dedicated threads joined before returning.
      *
      * @note Overrides tcp_server::listen
      * @note This method blocks until server shutdown
@@ -400,11 +1004,207 @@ public:
      * - Should be configured with desired socket options
      *
      * @note The socket should be configured as non-blocking for optimal performance
-     * @note Only one listening socket is supported per server instance
+     * @note Each call assigns the socket to the next reactor without a listener, so
+     *       call it once per reactor with SO_REUSEPORT sockets bound to the same address.
+     *       Reactors left without a listener share the first one via EPOLLEXCLUSIVE.
      * @note use make_listener_socket(....) to create a properly configured listening socket
      */
     virtual bool register_listener_socket(std::shared_ptr<socket> sock_ptr);
 
+    /**
+     * @brief Number of event loops driven by this server
+     * @return Reactor count (at least 1)
+     */
+    std::size_t reactor_count() const noexcept { return reactors.size(); }
+
+    /**
+     * @brief Backend the reactors run
+     * @return io_uring if it was requested and the kernel supports it, epoll otherwise
+     */
+    io_backend active_backend() const noexcept { return backend; }
+
+    /**
+     * @brief Pins the reactor threads to CPUs, e.g. a cpu_placement's reactor_cpus
+     * @param cpus CPUs of each reactor, reactor i taking cpus[i % cpus.size()];
+     *        empty falls back to the pin_reactors constructor flag
+     *
+     * A reactor pinned to a single CPU also sets SO_INCOMING_CPU on its own
+     * SO_REUSEPORT listener, so the kernel hands it the connections whose
+     * packets that CPU's receive queue takes (with RSS, or RPS steering
+     * flows to that CPU): packets, loop and handler stay on one cache.
+     * Receive chunks are allocated by the reactor thread itself and thus
+     * land on its NUMA node. Call before listen().
+     */
+    void set_reactor_cpus(std::vector<std::vector<int>> cpus) { reactor_cpus = std::move(cpus); }
+
+    /**
+     * @brief Activity counters of every event loop, summed
+     * @return Totals since construction, read without locking from any thread
+     */
+    loop_stats stats() const noexcept;
+
+    /**
+     * @brief Activity counters of one event loop
+     * @param reactor Reactor index, below reactor_count()
+     * @throws std::out_of_range if reactor is out of range
+     */
+    loop_stats stats(std::size_t reactor) const;
+
+    /**
+     * @brief Closes connections that see no traffic for a while
+     * @param timeout Allowed silence between reads/writes, 0 disables
+     *
+     * Re-armed in O(1) on every read and write. Takes effect for connections
+     * accepted after the call, so set it before listen().
+     */
+    void set_idle_timeout(std::chrono::milliseconds timeout) noexcept { idle_timeout = timeout; }
+
+    /**
+     * @brief Bounds the output queued per connection
+     * @param high Queued bytes above which the connection stops being read, 0 disables
+     * @param low Queued bytes at or below which reading resumes
+     * @throws std::invalid_argument if low is greater than high
+     *
+     * A client that sends requests faster than it reads responses is no
+     * longer read from until its responses drain. Set it before listen().
+     */
+    void set_write_watermarks(std::size_t high, std::size_t low);
+
+    /**
+     * @brief Opens an outbound connection driven by an event loop
+     * @param upstream Address to connect to
+     * @param handlers Callbacks of the connection, invoked on its loop
+     * @param timeout Time allowed for the TCP handshake
+     *
+     * An idle connection to the same upstream is reused when the chosen loop
+     * has one, so on_connect may run before this returns when called from a
+     * loop thread. Called from a loop thread the connection stays on that
+     * loop; from other threads loops are picked round-robin. Requests made
+     * before listen() start once the loops run. Data is sent with
+     * send_message() (send_outbound() from outside a derived server) and the
+     * connection closed with close_connection() (close_outbound()) or
+     * handed back with release_connection().
+     */
+    void connect_async(const socket_address& upstream, client_handlers handlers,
+                       std::chrono::milliseconds timeout = std::chrono::seconds(5));
+
+    /**
+     * @brief Runs a callback on an event loop once a delay has passed
+     * @param delay Time to wait, rounded up to the timer wheel's tick
+     * @param callback Invoked on the loop; must not block
+     *
+     * Called from a loop thread the callback runs on that loop; from other
+     * threads loops are picked round-robin. Callbacks still pending when the
+     * server stops are dropped without running.
+     */
+    void run_after(std::chrono::milliseconds delay, std::function<void()> callback);
+
+    /**
+     * @brief Hands an outbound connection back for reuse by later connect_async calls
+     * @param conn Connection from on_connect, no response may still be expected on it
+     *
+     * Its handlers are dropped; the connection stays open in its loop's pool
+     * for the same upstream until reused, closed by the peer, or idle for the
+     * pool's timeout. Accepted connections are ignored.
+     */
+    void release_connection(std::shared_ptr<connection> conn);
+
+    /**
+     * @brief Queues data on an outbound connection, for callers outside a derived server
+     * @param conn Connection from on_connect
+     * @param segments Buffers and file regions, as for send_message()
+     * @note Safe to call from any thread
+     */
+    void send_outbound(std::shared_ptr<connection> conn, std::vector<output_segment>&& segments) {
+        send_message(std::move(conn), std::move(segments));
+    }
+
+    /**
+     * @brief Closes an outbound connection once its output is flushed, instead of pooling it
+     * @param conn Connection from on_connect
+     * @note Safe to call from any thread
+     */
+    void close_outbound(std::shared_ptr<connection> conn) { close_connection(std::move(conn)); }
+
+    /**
+     * @brief Sizes the pools of idle outbound connections
+     * @param max_idle Idle connections kept per upstream and event loop, 0 disables pooling
+     * @param idle_timeout Time an idle connection is kept
+     */
+    void set_upstream_pool(std::size_t max_idle, std::chrono::milliseconds idle_timeout) noexcept {
+        upstream_max_idle = max_idle;
+        upstream_idle_timeout = idle_timeout;
+    }
+
+    /**
+     * @brief Caps the number of open connections
+     * @param max Connections at which reactors stop accepting, 0 removes the cap
+     *
+     * New connections wait in the listen backlog (and are refused by the
+     * kernel once it is full) until a connection closes. Set it before listen().
+     */
+    void set_max_connections(std::size_t max) noexcept { max_connections = max; }
+
+    /**
+     * @brief Bounds the connections accepted in one go
+     * @param budget Accepts per listener readiness, read and write events of the
+     *        connections already open are served in between; at least 1
+     */
+    void set_accept_budget(std::size_t budget) noexcept {
+        accept_budget = budget == 0 ? 1 : budget;
+    }
+
+    /**
+     * @brief Sets the receive chunk size classes of every reactor
+     * @param class_sizes Chunk sizes in bytes; reads start at the smallest
+     * @throws std::invalid_argument if class_sizes is empty or holds a zero
+     *
+     * A connection's reads move up one class each time a read fills the size
+     * it asked for and back down when reads come in well under it, so small
+     * requests on many keep-alive connections pin small chunks only. Set it
+     * before listen().
+     */
+    void set_read_buffer_sizes(const std::vector<std::size_t>& class_sizes);
+
+    /**
+     * @brief Sends large responses without copying them into the socket buffer
+     * @param min_bytes Smallest write batch sent with MSG_ZEROCOPY, 0 disables
+     *
+     * Linux epoll backend only. Buffers stay referenced until the kernel
+     * reports on the socket error queue that it no longer needs them; the
+     * loop reaps those notifications when the socket signals EPOLLERR.
+     * Zero-copy has a per-send setup cost and pays off for writes of tens
+     * of kilobytes and more.
+     */
+    void set_zerocopy_threshold(std::size_t min_bytes) noexcept { zerocopy_threshold = min_bytes; }
+
+    /**
+     * @brief Terminates TLS on accepted connections
+     * @param factory Creates the handshaker of each accepted connection; it may
+     *        return nullptr to keep that connection in plaintext. Empty disables TLS
+     * @throws std::logic_error with the io_uring backend, whose multishot
+     *         receive would consume the handshake
+     *
+     * on_connection_opened() runs before the handshake, so deadlines armed
+     * there bound it too. Messages sent before it completes wait in the
+     * output queue. After it, kernel TLS encrypts everything the loop writes,
+     * sendfile() included; MSG_ZEROCOPY is not used on these connections.
+     * Set it before listen().
+     */
+    void set_tls(tls_handshaker_factory factory);
+
+    /**
+     * @brief Sets the option profile of accepted connections
+     * @param options Profile, normally the one the listeners were created with
+     *
+     * Only settings that are not inherited from the listener cost a system
+     * call per accepted connection. Set it before listen().
+     */
+    void set_socket_options(const socket_options& options) noexcept {
+        accepted_options = options;
+        per_connection_options = options.needs_per_connection_setup();
+    }
+
     /**
      * @brief Signals the server to stop gracefully
      *
@@ -412,8 +1212,28 @@ public:
      * after processing current events.
      *
      * @note Overrides tcp_server::stop_server
-     * @note The server will stop after the current epoll_wait timeout expires
+     * @note Reactors are woken through their eventfd; without one (non-Linux) the
+     *       server stops after the current epoll_wait timeout expires
      */
     virtual void shutdown() override;
+
+    /**
+     * @brief Stops accepting and shuts down once the open connections are done
+     * @param timeout Time after which the server stops with connections still open
+     *
+     * Every reactor accepts the connections its listener has already queued
+     * and shuts the listener down, which takes it out of its SO_REUSEPORT
+     * group: the kernel hands new connections to the other processes
+     * listening on the port. Connections for which connection_idle() holds
+     * are then closed, checked again every 50 ms, and the server shuts down
+     * when none is left or the timeout passes.
+     *
+     * @note Safe to call from any thread, later calls do nothing
+     * @note Outbound connections are not counted, they end with the requests they serve
+     */
+    void drain(std::chrono::milliseconds timeout);
+
+    /// @brief true once drain() was called
+    bool is_draining() const noexcept { return draining.load(std::memory_order_relaxed); }
 };
 }  // namespace cppress::sockets
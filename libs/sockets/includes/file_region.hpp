@@ -0,0 +1,95 @@
+#pragma once
+
+/**
+ * @file file_region.hpp
+ * @brief Reference to a byte range of an open file, queued for zero-copy output
+ *
+ * A file_region can be queued on a connection next to ordinary data_buffer
+ * segments. epoll_server flushes it with sendfile(2) on Linux, so the file
+ * bytes go from the page cache to the socket without entering user space.
+ * Other platforms fall back to reading the range in bounded blocks and
+ * sending them.
+ *
+ * @code
+ * auto body = file_region::open("assets/video.mp4");
+ * std::vector<output_segment> out;
+ * out.emplace_back(data_buffer(std::move(headers)));
+ * out.emplace_back(std::move(body));
+ * server.send_message(conn, std::move(out));
+ * @endcode
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace cppress::sockets {
+
+/**
+ * @brief Shared, read-only view of [offset, offset + size) in a file
+ *
+ * Copies and slices share the descriptor, which is closed once the last
+ * region referencing it is destroyed.
+ */
+class file_region {
+private:
+    /// Descriptor shared by all regions of the same file (closed by the deleter when owned)
+    std::shared_ptr<const int> fd;
+
+    /// Offset of the first byte inside the file
+    std::uint64_t first = 0;
+
+    /// Number of bytes in the region
+    std::size_t length = 0;
+
+public:
+    /// Creates an empty region that refers to no file
+    file_region() = default;
+
+    /**
+     * @brief Wraps an already open file descriptor
+     * @param native_fd Readable file descriptor
+     * @param offset Offset of the first byte
+     * @param size Number of bytes
+     * @param take_ownership Close native_fd when the last region is destroyed
+     */
+    file_region(int native_fd, std::uint64_t offset, std::size_t size, bool take_ownership = true);
+
+    /**
+     * @brief Opens a file and refers to all of it
+     * @param path Path of the file
+     * @return Region covering the whole file
+     * @throws socket_exception if the file can not be opened or inspected
+     */
+    static file_region open(const std::string& path);
+
+    /**
+     * @brief Narrows the region
+     * @param pos Offset relative to this region
+     * @param len Maximum number of bytes, clamped to the end of this region
+     * @return Region sharing the same descriptor
+     * @throws std::out_of_range if pos > size()
+     */
+    file_region slice(std::size_t pos, std::size_t len = std::string::npos) const;
+
+    /// @brief Underlying descriptor, -1 for an empty region
+    int native_handle() const noexcept { return fd ? *fd : -1; }
+
+    /// @brief Offset of the first byte inside the file
+    std::uint64_t offset() const noexcept { return first; }
+
+    /// @brief Number of bytes in the region
+    std::size_t size() const noexcept { return length; }
+
+    /// @brief Checks whether the region holds no bytes
+    bool empty() const noexcept { return length == 0; }
+
+    /**
+     * @brief Copies the bytes of the region into memory
+     * @return The region's bytes, for consumers that can not queue a file
+     * @throws socket_exception if the file can not be read or ends early
+     */
+    std::string read() const;
+};
+}  // namespace cppress::sockets
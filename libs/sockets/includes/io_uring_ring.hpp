@@ -0,0 +1,176 @@
+#pragma once
+
+/**
+ * @file io_uring_ring.hpp
+ * @brief Minimal io_uring submission/completion ring over the raw system calls
+ *
+ * epoll_server can drive its reactors with io_uring instead of epoll. This
+ * header wraps just what that loop needs, without a liburing dependency:
+ * ring setup and mapping, SQE allocation, a combined submit-and-wait with a
+ * timeout, CQE iteration and one ring of provided receive buffers.
+ *
+ * Support is compiled in when the kernel headers know multishot receive
+ * (Linux 6.0+); CPPRESS_HAS_IO_URING is defined to 1 in that case. Whether
+ * the running kernel supports it is decided at runtime by create().
+ */
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#if defined(IORING_RECV_MULTISHOT) && defined(IORING_ACCEPT_MULTISHOT) && \
+    defined(IORING_FEAT_EXT_ARG)
+#define CPPRESS_HAS_IO_URING 1
+#endif
+#endif
+#endif
+
+#ifndef CPPRESS_HAS_IO_URING
+#define CPPRESS_HAS_IO_URING 0
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "data_buffer.hpp"
+
+#if CPPRESS_HAS_IO_URING
+#include <sys/socket.h>
+#include <sys/uio.h>
+#endif
+
+namespace cppress::sockets {
+
+/**
+ * @brief One in-flight io_uring operation, its address is the SQE user_data
+ *
+ * Operations own everything the kernel may still touch (iovecs and pinned
+ * buffers for sends), so a connection can be closed while they are pending.
+ */
+struct uring_op {
+    enum class kind { accept, recv, send, poll_out, wake };
+
+    kind type = kind::recv;
+
+    /// Target descriptor
+    int fd = -1;
+
+    /// Connection table generation of fd when issued, stale completions are ignored
+    std::uint32_t generation = 0;
+
+#if CPPRESS_HAS_IO_URING
+    /// Scatter list of a send
+    std::vector<iovec> iov;
+
+    /// Message header of a send, points at iov
+    msghdr msg{};
+#endif
+
+    /// Buffers referenced by iov, kept alive until the send completes
+    std::vector<data_buffer> pinned;
+};
+
+#if CPPRESS_HAS_IO_URING
+/**
+ * @brief Owner of one io_uring instance
+ *
+ * @note Not thread-safe, used by the reactor that owns it
+ */
+class io_uring_ring {
+private:
+    int ring_fd = -1;
+    unsigned features = 0;
+
+    void* sq_ptr = nullptr;
+    std::size_t sq_len = 0;
+    void* cq_ptr = nullptr;
+    std::size_t cq_len = 0;
+    io_uring_sqe* sqes = nullptr;
+    std::size_t sqes_len = 0;
+
+    unsigned* sq_head = nullptr;
+    unsigned* sq_tail = nullptr;
+    unsigned* sq_array = nullptr;
+    unsigned sq_mask = 0;
+    unsigned sq_entries = 0;
+    /// SQEs handed out but not yet published to the kernel
+    unsigned sqe_tail = 0;
+
+    unsigned* cq_head = nullptr;
+    unsigned* cq_tail = nullptr;
+    io_uring_cqe* cqes = nullptr;
+    unsigned cq_mask = 0;
+
+    io_uring_buf_ring* buf_ring = nullptr;
+    std::size_t buf_ring_len = 0;
+    std::unique_ptr<char[]> buf_memory;
+    unsigned buf_count = 0;
+    unsigned buf_size = 0;
+    unsigned short buf_tail = 0;
+
+    io_uring_ring() = default;
+
+    /// Publishes SQEs and enters the kernel
+    int enter(unsigned wait_nr, int timeout_ms);
+
+public:
+    /// Buffer group id of the provided receive buffers
+    static constexpr unsigned short buffer_group = 0;
+
+    /**
+     * @brief Sets up a ring and its provided buffers
+     * @param entries Submission queue size
+     * @param buffers Number of provided receive buffers (power of two)
+     * @param buffer_size Size of each provided buffer
+     * @return The ring, or nullptr if the kernel lacks a required feature
+     */
+    static std::unique_ptr<io_uring_ring> create(unsigned entries, unsigned buffers,
+                                                 unsigned buffer_size);
+
+    io_uring_ring(const io_uring_ring&) = delete;
+    io_uring_ring& operator=(const io_uring_ring&) = delete;
+    ~io_uring_ring();
+
+    /**
+     * @brief Returns a zeroed SQE, submitting pending ones if the queue is full
+     * @param op Operation to complete, stored as user_data (nullptr for none)
+     */
+    io_uring_sqe* get_sqe(uring_op* op);
+
+    /**
+     * @brief Submits pending SQEs and waits for at least one completion
+     * @param timeout_ms Maximum wait, -1 for none
+     * @return Negative errno on failure, ETIME and EINTR count as success
+     */
+    int submit_and_wait(int timeout_ms);
+
+    /**
+     * @brief Invokes fn on every available CQE and releases them
+     * @param fn Callable taking const io_uring_cqe&
+     * @return Number of CQEs processed
+     */
+    template <typename F>
+    unsigned for_each_cqe(F&& fn) {
+        unsigned head = *cq_head;
+        unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+        unsigned count = 0;
+        for (; head != tail; ++head, ++count)
+            fn(cqes[head & cq_mask]);
+        __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+        return count;
+    }
+
+    /// @brief Start of a provided buffer
+    const char* buffer(unsigned short id) const noexcept {
+        return buf_memory.get() + std::size_t(id) * buf_size;
+    }
+
+    /// @brief Size of each provided buffer
+    unsigned buffer_size() const noexcept { return buf_size; }
+
+    /// @brief Gives a provided buffer back to the kernel
+    void recycle_buffer(unsigned short id) noexcept;
+};
+#endif
+}  // namespace cppress::sockets
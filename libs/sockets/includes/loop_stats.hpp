@@ -0,0 +1,132 @@
+#pragma once
+
+/**
+ * @file loop_stats.hpp
+ * @brief Per-event-loop activity counters
+ *
+ * Every reactor counts what its loop does: how often it wakes up, how much
+ * work each wakeup brings, and where the time goes (blocked in the kernel
+ * or running handlers). The counters are written by the reactor thread only
+ * and read by any thread without locking, so a latency regression can be
+ * attributed to the reactor or to the handlers on a live server.
+ */
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace cppress::sockets {
+
+/**
+ * @brief Point-in-time copy of the counters of one or more event loops
+ *
+ * All counters are totals since the server was created; subtract two
+ * snapshots to get rates.
+ */
+struct loop_stats {
+    /// Upper bounds (exclusive) of the output queue depth buckets, the last bucket is open
+    static constexpr std::array<std::size_t, 5> outq_depth_bounds = {1,         4 * 1024,
+                                                                     64 * 1024, 1024 * 1024,
+                                                                     16 * 1024 * 1024};
+
+    /// Returns from epoll_wait / io_uring_enter
+    std::uint64_t wakeups = 0;
+
+    /// Events (epoll) or completions (io_uring) handled
+    std::uint64_t events = 0;
+
+    /// Nanoseconds spent blocked waiting for events
+    std::uint64_t wait_ns = 0;
+
+    /// Nanoseconds spent handling events, commands and deadlines
+    std::uint64_t handler_ns = 0;
+
+    /// Bytes received from connections
+    std::uint64_t bytes_read = 0;
+
+    /// Bytes written to connections
+    std::uint64_t bytes_written = 0;
+
+    /// Flushes that stopped on a full socket buffer (EAGAIN)
+    std::uint64_t send_eagain = 0;
+
+    /// Connections accepted
+    std::uint64_t accepts = 0;
+
+    /// accept() calls that failed for another reason than an empty backlog
+    std::uint64_t accept_failures = 0;
+
+    /// Times the epoll event buffer was saturated and doubled
+    std::uint64_t events_resizes = 0;
+
+    /// Flushes by bytes queued when they started, bucketed by outq_depth_bounds
+    std::array<std::uint64_t, outq_depth_bounds.size() + 1> outq_depth{};
+
+    /// @brief Average events handled per wakeup
+    double events_per_wakeup() const noexcept {
+        return wakeups == 0 ? 0.0 : static_cast<double>(events) / static_cast<double>(wakeups);
+    }
+
+    /// @brief Adds the counters of another snapshot, to total several loops
+    loop_stats& operator+=(const loop_stats& other) noexcept;
+};
+
+/**
+ * @brief Live counters of one event loop
+ *
+ * Single writer: only the loop thread updates them, so an update is a
+ * relaxed load and store rather than an atomic read-modify-write. Readers
+ * on other threads see each counter tear-free, possibly a few events behind.
+ */
+class loop_counters {
+private:
+    std::atomic<std::uint64_t> wakeups{0};
+    std::atomic<std::uint64_t> events{0};
+    std::atomic<std::uint64_t> wait_ns{0};
+    std::atomic<std::uint64_t> handler_ns{0};
+    std::atomic<std::uint64_t> bytes_read{0};
+    std::atomic<std::uint64_t> bytes_written{0};
+    std::atomic<std::uint64_t> send_eagain{0};
+    std::atomic<std::uint64_t> accepts{0};
+    std::atomic<std::uint64_t> accept_failures{0};
+    std::atomic<std::uint64_t> events_resizes{0};
+    std::array<std::atomic<std::uint64_t>, loop_stats::outq_depth_bounds.size() + 1> outq_depth{};
+
+    static void bump(std::atomic<std::uint64_t>& counter, std::uint64_t n = 1) noexcept {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+public:
+    /// @brief Records one return from the wait, with the events it brought
+    void on_wakeup(std::size_t n, std::uint64_t waited_ns) noexcept {
+        bump(wakeups);
+        bump(events, n);
+        bump(wait_ns, waited_ns);
+    }
+
+    /// @brief Records time spent outside the wait
+    void on_handlers(std::uint64_t ns) noexcept { bump(handler_ns, ns); }
+
+    /// @brief Records received bytes
+    void on_read(std::size_t n) noexcept { bump(bytes_read, n); }
+
+    /// @brief Records a flush that started with queued bytes and wrote written of them
+    void on_flush(std::size_t queued, std::size_t written, bool would_block) noexcept;
+
+    /// @brief Records bytes written outside a flush (io_uring send completions)
+    void on_written(std::size_t n) noexcept { bump(bytes_written, n); }
+
+    /// @brief Records an accepted connection
+    void on_accept() noexcept { bump(accepts); }
+
+    /// @brief Records a failed accept()
+    void on_accept_failure() noexcept { bump(accept_failures); }
+
+    /// @brief Records a doubling of the epoll event buffer
+    void on_events_resize() noexcept { bump(events_resizes); }
+
+    /// @brief Copies the counters
+    loop_stats snapshot() const noexcept;
+};
+}  // namespace cppress::sockets
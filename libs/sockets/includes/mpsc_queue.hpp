@@ -0,0 +1,96 @@
+#pragma once
+
+/**
+ * @file mpsc_queue.hpp
+ * @brief Lock-free multi-producer single-consumer queue
+ *
+ * Producers push with a single compare-and-swap on an intrusive list head.
+ * The consumer detaches the whole list with one atomic exchange and replays
+ * it in FIFO order, so a batch of N items costs one atomic operation on the
+ * consumer side.
+ *
+ * Used by epoll_server to hand work from application threads to the event
+ * loop that owns a connection.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+namespace cppress::sockets {
+
+/**
+ * @brief Lock-free MPSC queue with batch draining
+ * @tparam T Element type, must be move constructible
+ *
+ * @note push() may be called from any thread, drain() from one thread only
+ */
+template <typename T>
+class mpsc_queue {
+private:
+    struct node {
+        T value;
+        node* next;
+    };
+
+    /// Most recently pushed node (LIFO order until drained)
+    std::atomic<node*> head{nullptr};
+
+public:
+    mpsc_queue() = default;
+    mpsc_queue(const mpsc_queue&) = delete;
+    mpsc_queue& operator=(const mpsc_queue&) = delete;
+
+    ~mpsc_queue() {
+        drain([](T&) {});
+    }
+
+    /**
+     * @brief Pushes an element
+     * @param value Element to enqueue
+     * @return true if the queue was empty before this push, i.e. the consumer
+     *         may be sleeping and should be woken up
+     */
+    bool push(T value) {
+        node* n = new node{std::move(value), nullptr};
+        node* old = head.load(std::memory_order_relaxed);
+        do {
+            n->next = old;
+        } while (!head.compare_exchange_weak(old, n, std::memory_order_release,
+                                             std::memory_order_relaxed));
+        return old == nullptr;
+    }
+
+    /**
+     * @brief Takes every pending element and invokes fn on each in push order
+     * @param fn Callable taking T&
+     * @return Number of elements drained
+     */
+    template <typename F>
+    std::size_t drain(F&& fn) {
+        node* list = head.exchange(nullptr, std::memory_order_acquire);
+
+        // Reverse the LIFO list to restore FIFO order
+        node* ordered = nullptr;
+        while (list) {
+            node* next = list->next;
+            list->next = ordered;
+            ordered = list;
+            list = next;
+        }
+
+        std::size_t count = 0;
+        while (ordered) {
+            node* next = ordered->next;
+            fn(ordered->value);
+            delete ordered;
+            ordered = next;
+            ++count;
+        }
+        return count;
+    }
+
+    /// @brief Checks whether any element is pending
+    bool empty() const noexcept { return head.load(std::memory_order_acquire) == nullptr; }
+};
+}  // namespace cppress::sockets
@@ -0,0 +1,213 @@
+#pragma once
+
+/**
+ * @file output_chain.hpp
+ * @brief Scatter-gather output queue for non-blocking sockets
+ *
+ * An output_chain holds the pending outbound segments of one connection.
+ * Segments are owned data_buffers moved in by the caller, so response
+ * headers, body and trailers are queued without being concatenated, and
+ * flush() hands up to IOV_MAX of them to the kernel in one writev() call.
+ *
+ * Partial writes only advance an offset into the front segment, so a large
+ * payload drained over many writes costs O(n) in total instead of the
+ * O(n^2) of repeatedly erasing the front of a string.
+ *
+ * Segments may also be file regions. They keep their place in the queue, so
+ * headers written before a file body always precede it on the wire, and are
+ * written with sendfile(2) where available.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "data_buffer.hpp"
+#include "file_region.hpp"
+#include "utilities.hpp"
+
+#if !defined(_WIN32) && !defined(_WIN64) && !defined(__CYGWIN__)
+#include <sys/uio.h>
+#endif
+
+namespace cppress::sockets {
+
+/**
+ * @brief One queued output entry: either a memory buffer or a file region
+ */
+struct output_segment {
+    /// Bytes to send when this is a memory segment
+    data_buffer memory;
+
+    /// Range to send when this is a file segment
+    file_region file;
+
+    explicit output_segment(data_buffer&& db) noexcept : memory(std::move(db)) {}
+    explicit output_segment(file_region fr) noexcept : file(std::move(fr)) {}
+
+    /// @brief True if the bytes come from a file
+    bool is_file() const noexcept { return !file.empty(); }
+
+    /// @brief Number of bytes in the segment
+    std::size_t size() const noexcept { return is_file() ? file.size() : memory.size(); }
+};
+
+/**
+ * @brief Per-connection queue of outbound buffers flushed with writev
+ */
+class output_chain {
+private:
+    /// Pending segments, front is the next to be written
+    std::deque<output_segment> segments;
+
+    /// Bytes of the front segment already written
+    std::size_t head_offset = 0;
+
+    /// Total unwritten bytes across all segments
+    std::size_t pending_bytes = 0;
+
+    /// Buffers of one MSG_ZEROCOPY send, referenced by the kernel until notified
+    struct zerocopy_batch {
+        std::uint32_t seq;
+        std::vector<data_buffer> pinned;
+    };
+
+    /// Zero-copy sends not yet acknowledged on the error queue, oldest first
+    std::deque<zerocopy_batch> zerocopy_inflight;
+
+    /// Sequence number the kernel assigns to the next zero-copy send
+    std::uint32_t zerocopy_next = 0;
+
+    /// SO_ZEROCOPY state of the socket
+    enum class zerocopy_mode : unsigned char { unknown, enabled, unavailable };
+    zerocopy_mode zerocopy = zerocopy_mode::unknown;
+
+public:
+    /// Outcome of a flush attempt
+    enum class flush_result {
+        /// Every queued byte was written
+        complete,
+        /// The socket buffer is full, wait for EPOLLOUT
+        would_block,
+        /// The write failed, the connection should be closed
+        error
+    };
+
+    output_chain() = default;
+
+    /**
+     * @brief Appends a segment, taking ownership of its storage
+     * @param db Buffer to queue (empty buffers are ignored)
+     */
+    void push(data_buffer&& db) {
+        if (db.empty())
+            return;
+        pending_bytes += db.size();
+        segments.emplace_back(std::move(db));
+    }
+
+    /**
+     * @brief Appends a file segment, sent after everything queued so far
+     * @param fr Region to queue (empty regions are ignored)
+     */
+    void push(file_region fr) {
+        if (fr.empty())
+            return;
+        pending_bytes += fr.size();
+        segments.emplace_back(std::move(fr));
+    }
+
+    /**
+     * @brief Appends a segment of either kind
+     * @param seg Segment to queue (empty segments are ignored)
+     */
+    void push(output_segment&& seg) {
+        if (seg.is_file())
+            push(std::move(seg.file));
+        else
+            push(std::move(seg.memory));
+    }
+
+    /// @brief Checks whether any byte is still pending
+    bool empty() const noexcept { return pending_bytes == 0; }
+
+    /// @brief Number of queued segments
+    std::size_t segment_count() const noexcept { return segments.size(); }
+
+    /// @brief Number of unwritten bytes
+    std::size_t size() const noexcept { return pending_bytes; }
+
+    /// @brief True if the next byte to write comes from a file segment
+    bool front_is_file() const noexcept { return !segments.empty() && segments.front().is_file(); }
+
+#if !defined(_WIN32) && !defined(_WIN64) && !defined(__CYGWIN__)
+    /**
+     * @brief Describes the leading memory segments for an asynchronous send
+     * @param iov Receives one entry per segment, starting at the unwritten offset
+     * @param pin Receives shared references keeping the bytes alive
+     * @param max Maximum number of segments
+     *
+     * Stops at the first file segment. Nothing is consumed, call consume()
+     * with the number of bytes the send reports.
+     */
+    void gather(std::vector<iovec>& iov, std::vector<data_buffer>& pin, std::size_t max) const;
+#endif
+
+    /// @brief Drops every pending segment
+    void clear() noexcept {
+        segments.clear();
+        head_offset = 0;
+        pending_bytes = 0;
+    }
+
+    /**
+     * @brief Marks n bytes as written, releasing finished segments
+     * @param n Number of bytes accepted by the kernel
+     */
+    void consume(std::size_t n);
+
+    /**
+     * @brief Writes as much as the socket accepts
+     * @param fd Non-blocking socket to write to
+     * @param zerocopy_min Send batches of at least this many bytes with
+     *        MSG_ZEROCOPY (Linux), 0 disables
+     * @return complete, would_block or error
+     *
+     * Uses writev() with up to IOV_MAX segments per call on POSIX systems and
+     * one send() per segment elsewhere. File segments go through sendfile()
+     * on Linux and a bounded read + send loop on other platforms.
+     *
+     * Zero-copy sends count as written once the kernel accepts them, but
+     * their buffers stay referenced until reap_zerocopy() sees the kernel's
+     * notification. Sockets that reject SO_ZEROCOPY, or whose zero-copy sends
+     * the kernel had to copy anyway (e.g. loopback), fall back to copying.
+     */
+    flush_result flush(socket_t fd, std::size_t zerocopy_min = 0);
+
+    /// @brief True while zero-copy sends wait for their completion notification
+    bool zerocopy_pending() const noexcept { return !zerocopy_inflight.empty(); }
+
+    /**
+     * @brief Releases the buffers of acknowledged zero-copy sends
+     * @param fd Socket the sends were made on
+     * @return Number of notifications read from the socket error queue
+     *
+     * Call it when the socket reports EPOLLERR while zerocopy_pending().
+     */
+    std::size_t reap_zerocopy(socket_t fd);
+
+    /// @brief Never uses MSG_ZEROCOPY on this socket, e.g. kernel TLS copies into records anyway
+    void disable_zerocopy() noexcept { zerocopy = zerocopy_mode::unavailable; }
+
+private:
+    /// Writes the file segment at the front of the queue
+    flush_result flush_file(socket_t fd);
+
+    /// Enables SO_ZEROCOPY on first use, false if the socket does not support it
+    bool enable_zerocopy(socket_t fd);
+
+    /// Keeps the first n unwritten bytes alive until their zero-copy send is acknowledged
+    void pin_zerocopy(std::size_t n);
+};
+}  // namespace cppress::sockets
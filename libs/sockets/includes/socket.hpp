@@ -219,6 +219,7 @@
 
 #include "connection.hpp"
 #include "data_buffer.hpp"
+#include "datagram_batch.hpp"
 #include "exceptions.hpp"
 #include "file_descriptor.hpp"
 #include "socket_address.hpp"
@@ -421,6 +422,45 @@ public:
      */
     void send_to(const socket_address& addr, const data_buffer& data);
 
+    /**
+     * @brief Receive several datagrams with one system call (UDP only).
+     * @param batch Slots to fill, previous contents are replaced
+     * @param wait Block until at least one datagram arrives; if false, return 0 when none is queued
+     * @return Number of datagrams received, also batch.size()
+     * @throws socket_exception with type "ProtocolMismatch" if called on non-UDP socket
+     * @throws socket_exception with type "SocketReceive" if receive operation fails
+     *
+     * Uses recvmmsg on Linux: after the first datagram only those already
+     * queued are taken. Elsewhere one datagram is received per call.
+     * Datagrams longer than batch.slot_size() are truncated.
+     */
+    std::size_t receive_batch(datagram_batch& batch, bool wait = true);
+
+    /**
+     * @brief Send the datagrams queued in a batch (UDP only).
+     * @param batch Datagrams queued with datagram_batch::push()
+     * @return Number of datagrams sent, less than batch.size() only if a
+     *         non-blocking socket ran out of buffer space
+     * @throws socket_exception with type "ProtocolMismatch" if called on non-UDP socket
+     * @throws socket_exception with type "SocketSend" if send operation fails
+     *
+     * Uses sendmmsg on Linux, one sendto per datagram elsewhere. Slots pushed
+     * with a segment size are split by the kernel (UDP GSO); the call fails
+     * with EIO if the device cannot segment.
+     */
+    std::size_t send_batch(datagram_batch& batch);
+
+    /**
+     * @brief Enable UDP receive offload (GRO) (UDP only, Linux).
+     * @param enable Whether the kernel may coalesce datagrams of one flow into one slot
+     * @return true if the option was applied, false where unsupported
+     *
+     * Coalesced slots report their segment size through
+     * datagram_batch::segment_size(); use a slot size of 64 KB to take a
+     * full run.
+     */
+    bool set_udp_gro(bool enable) noexcept;
+
     /**
      * @brief Get remote endpoint address.
      * @return Socket address of remote endpoint
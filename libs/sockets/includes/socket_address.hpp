@@ -180,7 +180,7 @@ public:
      * @brief Get the IP address component ().
      * @return IP address object
      */
-    cppress::sockets::ip_address address() const { return address_; }
+    const cppress::sockets::ip_address& address() const { return address_; }
 
     /**
      * @brief Get the port component ().
@@ -0,0 +1,89 @@
+#pragma once
+
+/**
+ * @file socket_options.hpp
+ * @brief Latency and buffering profile for listener and accepted sockets
+ *
+ * A socket_options profile is applied to a listener by make_listener_socket()
+ * and to every accepted connection by epoll_server. Everything a Linux
+ * accepted socket inherits from its listener (buffer sizes, busy polling,
+ * TCP_NODELAY) is set once on the listener; only settings the kernel resets
+ * per connection are applied to each accepted fd, so a default profile costs
+ * no system call per connection.
+ *
+ * @code
+ * auto options = socket_options::low_latency();
+ * options.fastopen_queue = 256;
+ * auto listener = make_listener_socket(8080, "0.0.0.0", SOMAXCONN, options);
+ * server.set_socket_options(options);
+ * @endcode
+ */
+
+#include "utilities.hpp"
+
+namespace cppress::sockets {
+
+class socket;
+
+/**
+ * @brief Socket option profile, every member defaults to the kernel's behavior
+ *
+ * Options the running platform does not know are skipped.
+ */
+struct socket_options {
+    /// Disable Nagle's algorithm (TCP_NODELAY), small responses leave immediately
+    bool tcp_nodelay = false;
+
+    /// Acknowledge received segments immediately (TCP_QUICKACK, Linux)
+    bool tcp_quickack = false;
+
+    /// Seconds the kernel holds a connection until its first data arrives
+    /// before waking accept (TCP_DEFER_ACCEPT, Linux), 0 disables
+    int defer_accept_seconds = 0;
+
+    /// TCP Fast Open queue length on the listener (TCP_FASTOPEN), 0 disables
+    int fastopen_queue = 0;
+
+    /// Microseconds to busy poll the device queue on blocking reads (SO_BUSY_POLL), 0 disables
+    int busy_poll_usec = 0;
+
+    /// Receive buffer size in bytes (SO_RCVBUF), 0 keeps kernel autotuning
+    int receive_buffer = 0;
+
+    /// Send buffer size in bytes (SO_SNDBUF), 0 keeps kernel autotuning
+    int send_buffer = 0;
+
+    /// CPU whose receive queue should serve the listener (SO_INCOMING_CPU), -1 disables
+    int incoming_cpu = -1;
+
+    /**
+     * @brief Profile for small request/response traffic
+     * @return Options with TCP_NODELAY and TCP_QUICKACK enabled
+     *
+     * Removes the 40ms stall of Nagle's algorithm meeting delayed ACKs.
+     */
+    static socket_options low_latency() noexcept {
+        socket_options options;
+        options.tcp_nodelay = true;
+        options.tcp_quickack = true;
+        return options;
+    }
+
+    /**
+     * @brief Applies the profile to a listener, before it starts listening
+     * @param listener Bound socket
+     * @throws socket_exception with type "SocketOption" if an option is rejected
+     */
+    void apply_to_listener(socket& listener) const;
+
+    /**
+     * @brief Applies the settings accepted sockets do not inherit from the listener
+     * @param fd Accepted connection descriptor
+     * @return false if an option was rejected, the connection stays usable
+     */
+    bool apply_to_accepted(socket_t fd) const noexcept;
+
+    /// @brief True if apply_to_accepted() has anything to do
+    bool needs_per_connection_setup() const noexcept;
+};
+}  // namespace cppress::sockets
@@ -0,0 +1,173 @@
+#pragma once
+
+/**
+ * @file timer_wheel.hpp
+ * @brief Hierarchical timing wheel for per-connection deadlines
+ *
+ * Timers are intrusive nodes linked into one of 256 + 3 * 64 slot lists, so
+ * arming, re-arming and cancelling are O(1) and need no allocation. The next
+ * expiry is cheap to compute, which lets the event loop sleep in epoll_wait
+ * exactly until the next deadline instead of polling or sweeping.
+ *
+ * The layout follows the classic cascading wheel: the first level has one
+ * slot per tick, each further level covers 64 slots of the level below and
+ * is redistributed ("cascaded") when the lower level wraps around.
+ */
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace cppress::sockets {
+
+/**
+ * @brief Intrusive timer, embedded in the object it times out
+ *
+ * Copying produces an unarmed timer with the same fd and tag, so structures
+ * holding timers stay copyable. A timer must be cancelled before it is
+ * destroyed while armed.
+ */
+struct timer_node {
+    timer_node* prev = nullptr;
+    timer_node* next = nullptr;
+
+    /// Tick at which the timer fires
+    std::uint64_t expires = 0;
+
+    /// Descriptor of the owner, for the expiry callback
+    int fd = -1;
+
+    /// Owner-defined discriminator, for the expiry callback
+    int tag = 0;
+
+    timer_node() = default;
+    timer_node(int fd, int tag) : fd(fd), tag(tag) {}
+    timer_node(const timer_node& other) : fd(other.fd), tag(other.tag) {}
+    timer_node& operator=(const timer_node& other) {
+        fd = other.fd;
+        tag = other.tag;
+        return *this;
+    }
+
+    /// @brief True while the timer is linked into a wheel
+    bool armed() const noexcept { return next != nullptr; }
+};
+
+/**
+ * @brief Timing wheel owned by a single event loop
+ *
+ * @note Not thread-safe, arm/cancel/advance must be called from the owning loop
+ */
+class timer_wheel {
+public:
+    using clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Creates a wheel
+     * @param tick Resolution of the wheel; deadlines are rounded up to it
+     */
+    explicit timer_wheel(std::chrono::milliseconds tick = std::chrono::milliseconds(10));
+
+    timer_wheel(const timer_wheel&) = delete;
+    timer_wheel& operator=(const timer_wheel&) = delete;
+
+    /**
+     * @brief Arms (or re-arms) a timer
+     * @param node Timer to schedule, unlinked first if already armed
+     * @param after Delay relative to the last advance() call
+     */
+    void arm(timer_node& node, std::chrono::milliseconds after);
+
+    /**
+     * @brief Arms (or re-arms) a timer to fire no earlier than a point in time
+     * @param node Timer to schedule, unlinked first if already armed
+     * @param when Earliest time it may fire, rounded up to the next tick
+     *
+     * Unlike arm(), the deadline does not depend on how long ago the wheel
+     * was last advanced.
+     */
+    void arm_at(timer_node& node, clock::time_point when);
+
+    /// @brief Disarms a timer, no-op if it is not armed
+    void cancel(timer_node& node) noexcept;
+
+    /// @brief Number of armed timers
+    std::size_t size() const noexcept { return count; }
+
+    /**
+     * @brief Fires every timer whose deadline is not after now
+     * @param now Current time
+     * @param on_expired Callable taking timer_node&, invoked after the node is
+     *        unlinked; it may arm or cancel any timer, including this one
+     * @return Number of timers fired
+     */
+    template <typename F>
+    std::size_t advance(clock::time_point now, F&& on_expired) {
+        std::uint64_t target = tick_of(now);
+        std::size_t fired = 0;
+        if (count == 0) {
+            current = target > current ? target : current;
+            return 0;
+        }
+        while (current < target) {
+            ++current;
+            std::size_t index = current & root_mask;
+            if (index == 0)
+                cascade_all();
+
+            timer_node& head = slots[index];
+            while (head.next != &head) {
+                timer_node& node = *head.next;
+                cancel(node);
+                on_expired(node);
+                ++fired;
+            }
+            if (count == 0) {
+                current = target;
+                break;
+            }
+        }
+        return fired;
+    }
+
+    /**
+     * @brief Time epoll_wait may sleep before the next timer could fire
+     * @param now Current time
+     * @param cap Upper bound in milliseconds, -1 for none
+     * @return Milliseconds to wait, never more than cap (if cap >= 0)
+     */
+    int next_timeout(clock::time_point now, int cap) const;
+
+private:
+    static constexpr unsigned root_bits = 8;
+    static constexpr unsigned level_bits = 6;
+    static constexpr unsigned levels = 4;
+    static constexpr std::size_t root_size = std::size_t(1) << root_bits;
+    static constexpr std::size_t level_size = std::size_t(1) << level_bits;
+    static constexpr std::uint64_t root_mask = root_size - 1;
+    static constexpr std::uint64_t level_mask = level_size - 1;
+    static constexpr std::uint64_t max_delta =
+        (std::uint64_t(1) << (root_bits + (levels - 1) * level_bits)) - 1;
+
+    /// Slot list heads: [0, root_size) is the first level, then levels 1..3
+    std::array<timer_node, root_size + (levels - 1) * level_size> slots;
+
+    /// Origin of the tick count
+    clock::time_point origin;
+
+    /// Wheel resolution
+    std::chrono::milliseconds tick;
+
+    /// Last processed tick
+    std::uint64_t current = 0;
+
+    /// Armed timers
+    std::size_t count = 0;
+
+    std::uint64_t tick_of(clock::time_point t) const noexcept;
+    timer_node& slot_for(std::uint64_t expires) noexcept;
+    void link(timer_node& node) noexcept;
+    void cascade_all() noexcept;
+};
+}  // namespace cppress::sockets
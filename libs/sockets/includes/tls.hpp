@@ -0,0 +1,111 @@
+#pragma once
+
+/**
+ * @file tls.hpp
+ * @brief TLS termination hooks: user-space handshake, kernel TLS records
+ *
+ * The handshake needs a TLS library; the records after it do not. A
+ * tls_handshaker wraps whatever library the application links (OpenSSL,
+ * BoringSSL, s2n, ...) and drives the handshake on the non-blocking socket.
+ * Once it completes, the session keys move into the kernel (kTLS, Linux
+ * TCP_ULP "tls"), so the event loop keeps using plain recv, writev and
+ * sendfile on the socket: the kernel encrypts and decrypts the records.
+ *
+ * The library itself is not a dependency of cppress: a handshaker either
+ * lets its library install kTLS (e.g. OpenSSL's SSL_OP_ENABLE_KTLS) or
+ * exports the traffic secrets as ktls_crypto and calls install_ktls().
+ *
+ * @note Kernel TLS needs the "tls" module (CONFIG_TLS); see ktls_available()
+ */
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "utilities.hpp"
+
+namespace cppress::sockets {
+
+/**
+ * @brief Record protection state of one direction, as the kernel expects it
+ *
+ * Field sizes per cipher (bytes): key 16 / 32 / 32, iv 8 / 8 / 12, salt
+ * 4 / 4 / 0, rec_seq 8, for aes_gcm_128 / aes_gcm_256 / chacha20_poly1305.
+ */
+struct ktls_crypto {
+    enum class cipher { aes_gcm_128, aes_gcm_256, chacha20_poly1305 };
+
+    /// TLS version, 0x0303 (1.2) or 0x0304 (1.3)
+    std::uint16_t version = 0x0304;
+
+    cipher suite = cipher::aes_gcm_128;
+
+    std::string key;
+    std::string iv;
+    std::string salt;
+
+    /// Big-endian sequence number of the next record
+    std::string rec_seq = std::string(8, '\0');
+};
+
+/**
+ * @brief Hands a session to kernel TLS
+ * @param fd Connected TCP socket, no TLS records left unread in user space
+ * @param tx Keys protecting records we send
+ * @param rx Keys protecting records we receive
+ * @return 0 on success, otherwise an errno value: ENOENT or ENOPROTOOPT
+ *         without kernel TLS, EINVAL for malformed keys, ENOTSUP off Linux
+ */
+int install_ktls(socket_t fd, const ktls_crypto& tx, const ktls_crypto& rx) noexcept;
+
+/**
+ * @brief True if the running kernel accepts TCP_ULP "tls"
+ *
+ * Probed once on a loopback connection and cached.
+ */
+bool ktls_available() noexcept;
+
+/**
+ * @brief One server-side TLS handshake, driven by epoll_server
+ *
+ * step() is called on the event loop whenever the socket is ready in the
+ * direction it last asked for. Implementations read and write fd
+ * themselves and must not block.
+ */
+class tls_handshaker {
+public:
+    enum class status {
+        /// Waiting for bytes from the peer
+        want_read,
+        /// Waiting for room in the socket send buffer
+        want_write,
+        /// Handshake complete, enable_kernel_tls() is called next
+        done,
+        /// Handshake failed, the connection is closed
+        failed
+    };
+
+    virtual ~tls_handshaker() = default;
+
+    /// @brief Advances the handshake on the non-blocking socket
+    virtual status step(socket_t fd) = 0;
+
+    /**
+     * @brief Moves the record layer into the kernel after done
+     * @return 0 on success or an errno value (see install_ktls()); the connection
+     *         is closed on failure
+     */
+    virtual int enable_kernel_tls(socket_t fd) = 0;
+
+    /**
+     * @brief Application data the library already decrypted during the handshake
+     *
+     * Delivered before anything read from the socket afterwards.
+     */
+    virtual std::string take_pending_plaintext() { return {}; }
+};
+
+/// Creates the handshaker of an accepted connection
+using tls_handshaker_factory = std::function<std::unique_ptr<tls_handshaker>(socket_t fd)>;
+}  // namespace cppress::sockets
@@ -127,6 +127,7 @@ class port;
 class family;
 class socket;
 class socket_address;
+struct socket_options;
 
 // Network address family constants
 const int IPV4 = AF_INET;   ///< IPv4 address family identifier
@@ -308,4 +309,17 @@ std::shared_ptr<cppress::sockets::socket> make_listener_socket(uint16_t port,
                                                                const std::string& ip = "0.0.0.0",
                                                                int backlog = SOMAXCONN);
 
+/**
+ * @brief Create a listener socket with a socket option profile.
+ * @param port Port number to listen on
+ * @param ip IP address to bind to
+ * @param backlog Maximum number of pending connections
+ * @param options Options applied after bind and before listen
+ * @return std::shared_ptr<cppress::sockets::socket>
+ */
+std::shared_ptr<cppress::sockets::socket> make_listener_socket(uint16_t port,
+                                                               const std::string& ip,
+                                                               int backlog,
+                                                               const socket_options& options);
+
 }  // namespace cppress::sockets
\ No newline at end of file
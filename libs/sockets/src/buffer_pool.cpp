@@ -0,0 +1,96 @@
+/**
+ * @file buffer_pool.cpp
+ * @brief Implementation of pooled receive chunks
+ */
+
+#include "../includes/buffer_pool.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace cppress::sockets {
+
+buffer_pool::buffer_pool(std::size_t chunk_size, std::size_t max_free)
+    : buffer_pool(std::vector<std::size_t>{chunk_size}, max_free) {}
+
+buffer_pool::buffer_pool(std::vector<std::size_t> class_sizes, std::size_t max_free)
+    : shared(std::make_shared<state>()) {
+    if (class_sizes.empty())
+        throw std::invalid_argument("buffer_pool needs at least one size class");
+    std::sort(class_sizes.begin(), class_sizes.end());
+    class_sizes.erase(std::unique(class_sizes.begin(), class_sizes.end()), class_sizes.end());
+    if (class_sizes.front() == 0)
+        throw std::invalid_argument("buffer_pool size classes must not be empty");
+    for (auto size : class_sizes)
+        shared->classes.push_back(size_class{size, {}});
+    shared->max_free = max_free;
+}
+
+std::size_t buffer_pool::class_index(std::size_t min_size) const noexcept {
+    const auto& classes = shared->classes;
+    std::size_t i = 0;
+    while (i + 1 < classes.size() && classes[i].size < min_size)
+        ++i;
+    return i;
+}
+
+/**
+ * Implementation Notes:
+ * - The deleter holds the pool state, not the pool, so late releases are safe
+ * - Class sizes never change after construction, only the free lists are locked
+ * - Chunks beyond max_free are freed instead of cached
+ */
+std::shared_ptr<char> buffer_pool::acquire(std::size_t min_size) {
+    std::size_t index = class_index(min_size);
+    std::unique_ptr<char[]> bytes;
+    {
+        std::lock_guard<std::mutex> lock(shared->mutex);
+        auto& free_chunks = shared->classes[index].free_chunks;
+        if (!free_chunks.empty()) {
+            bytes = std::move(free_chunks.back());
+            free_chunks.pop_back();
+        }
+    }
+    if (!bytes)
+        bytes.reset(new char[shared->classes[index].size]);
+
+    auto owner = shared;
+    return std::shared_ptr<char>(bytes.release(), [owner, index](char* p) {
+        std::unique_ptr<char[]> chunk(p);
+        std::lock_guard<std::mutex> lock(owner->mutex);
+        auto& free_chunks = owner->classes[index].free_chunks;
+        if (free_chunks.size() < owner->max_free)
+            free_chunks.push_back(std::move(chunk));
+    });
+}
+
+std::size_t buffer_pool::free_count() const {
+    std::lock_guard<std::mutex> lock(shared->mutex);
+    std::size_t count = 0;
+    for (const auto& c : shared->classes)
+        count += c.free_chunks.size();
+    return count;
+}
+
+/**
+ * Implementation Notes:
+ * - A chunk no slice references any more is rewound instead of replaced
+ */
+char* receive_buffer::prepare(std::size_t need) {
+    need = std::max(need, min_read);
+    if (chunk && chunk.use_count() == 1)
+        used = 0;
+    if (!chunk || capacity - used < std::min(need, pool->max_chunk_size())) {
+        chunk = pool->acquire(need);
+        capacity = pool->chunk_size(need);
+        used = 0;
+    }
+    return chunk.get() + used;
+}
+
+data_buffer receive_buffer::commit(std::size_t n) {
+    data_buffer slice(std::shared_ptr<const char>(chunk, chunk.get() + used), n);
+    used += n;
+    return slice;
+}
+}  // namespace cppress::sockets
@@ -0,0 +1,100 @@
+/**
+ * @file datagram_batch.cpp
+ * @brief Implementation of reusable datagram slots
+ */
+
+#include "../includes/datagram_batch.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__linux__) || defined(__linux)
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#endif
+
+namespace cppress::sockets {
+
+namespace {
+#if defined(__linux__) || defined(__linux)
+/// Control space per slot, fits one UDP_SEGMENT / UDP_GRO value
+constexpr std::size_t control_bytes = CMSG_SPACE(sizeof(int));
+#endif
+}  // namespace
+
+datagram_batch::datagram_batch(std::size_t capacity, std::size_t slot_size)
+    : slots(capacity), slot_bytes(slot_size) {
+    if (capacity == 0 || slot_size == 0)
+        throw std::invalid_argument("datagram_batch needs at least one non-empty slot");
+    buffer.reset(new char[capacity * slot_size]);
+    lengths.resize(capacity);
+    segments.resize(capacity);
+    addresses.resize(capacity);
+    address_lengths.resize(capacity);
+#if defined(__linux__) || defined(__linux)
+    headers.resize(capacity);
+    iov.resize(capacity);
+    control.resize(capacity * control_bytes);
+#endif
+}
+
+socket_address datagram_batch::peer(std::size_t i) const {
+    sockaddr_storage copy = addresses[i];
+    return socket_address(copy);
+}
+
+bool datagram_batch::push(const socket_address& to, const void* data, std::size_t n,
+                          std::size_t segment_size) {
+    if (count == slots || n > slot_bytes)
+        return false;
+    std::memcpy(buffer.get() + count * slot_bytes, data, n);
+    lengths[count] = n;
+    segments[count] = segment_size < n ? segment_size : 0;
+    std::memset(&addresses[count], 0, sizeof(sockaddr_storage));
+    std::memcpy(&addresses[count], to.data(), to.size());
+    address_lengths[count] = to.size();
+    ++count;
+    return true;
+}
+
+#if defined(__linux__) || defined(__linux)
+/**
+ * Implementation Notes:
+ * - Receiving: every slot offers its full size and control space, the
+ *   kernel reports lengths back in the headers
+ * - Sending: control data is attached only to slots with a segment size
+ */
+void datagram_batch::prepare_headers(std::size_t first, std::size_t n, bool receiving) noexcept {
+    for (std::size_t i = first; i < first + n; ++i) {
+        iov[i].iov_base = buffer.get() + i * slot_bytes;
+        iov[i].iov_len = receiving ? slot_bytes : lengths[i];
+        msghdr& msg = headers[i].msg_hdr;
+        msg = msghdr{};
+        msg.msg_name = &addresses[i];
+        msg.msg_namelen = receiving ? sizeof(sockaddr_storage) : address_lengths[i];
+        msg.msg_iov = &iov[i];
+        msg.msg_iovlen = 1;
+        headers[i].msg_len = 0;
+        char* space = control.data() + i * control_bytes;
+        if (receiving) {
+            msg.msg_control = space;
+            msg.msg_controllen = control_bytes;
+        }
+#ifdef UDP_SEGMENT
+        else if (segments[i] != 0) {
+            std::memset(space, 0, control_bytes);
+            msg.msg_control = space;
+            msg.msg_controllen = CMSG_SPACE(sizeof(std::uint16_t));
+            cmsghdr* cm = CMSG_FIRSTHDR(&msg);
+            cm->cmsg_level = SOL_UDP;
+            cm->cmsg_type = UDP_SEGMENT;
+            cm->cmsg_len = CMSG_LEN(sizeof(std::uint16_t));
+            auto size = static_cast<std::uint16_t>(segments[i]);
+            std::memcpy(CMSG_DATA(cm), &size, sizeof(size));
+        }
+#endif
+    }
+}
+#endif
+}  // namespace cppress::sockets
@@ -29,7 +29,10 @@
 #include <arpa/inet.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
+#include <pthread.h>
+#include <sched.h>
 #include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/resource.h>
 #include <sys/socket.h>
 #include <unistd.h>
@@ -39,6 +42,7 @@
 #define EPOLLWAKEUP 0
 #endif
 
+#include <algorithm>
 #include <cstdlib>
 #include <functional>
 #include <iostream>
@@ -49,30 +53,73 @@
 #include "../includes/port.hpp"
 #include "../includes/socket_address.hpp"
 #include "../includes/utilities.hpp"
+#include "alloc_accounting.hpp"
 
 namespace cppress::sockets {
-void epoll_server::try_accept() {
-    // Accept as many connections as possible (edge-triggered)
-    while (true) {
+thread_local epoll_reactor* epoll_server::current_reactor = nullptr;
+
+namespace {
+/// Pending error of a socket (SO_ERROR), reading it clears it
+int pending_socket_error(int fd) {
+    int err = 0;
+    socklen_t len = sizeof(err);
+    if (::getsockopt(fd, SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&err), &len) != 0)
+        return errno;
+    return err;
+}
+}  // namespace
+
+std::uint64_t epoll_server::elapsed_ns(std::chrono::steady_clock::time_point from,
+                                       std::chrono::steady_clock::time_point to) noexcept {
+    return static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count());
+}
+
+/**
+ * Accept Policy:
+ * - At most accept_budget connections per call; leftovers are picked up at
+ *   the end of the loop iteration, after the events already collected
+ * - At the connection cap the listener is paused instead of accepting
+ * - EMFILE/ENFILE: the reserve descriptor is given up to accept and drop one
+ *   connection, so a full descriptor table does not leave the listener
+ *   permanently readable
+ * - ECONNABORTED and friends only concern the connection being accepted
+ */
+void epoll_server::try_accept(epoll_reactor& r) {
+    r.accept_pending = false;
+    for (std::size_t accepted = 0;; ++accepted) {
+        if (at_connection_cap()) {
+            pause_accept(r);
+            return;
+        }
+        if (accepted == accept_budget) {
+            r.accept_pending = true;
+            return;
+        }
         try {
             sockaddr_storage client_addr;
             socklen_t client_addr_len = sizeof(client_addr);
 
 #if defined(__linux__) || defined(__linux)
             // Use accept4 for efficiency (sets NONBLOCK + CLOEXEC atomically)
-            auto cfd = ::accept4(listener_socket->native_handle(),
+            auto cfd = ::accept4(r.listener_socket->native_handle(),
                                  reinterpret_cast<sockaddr*>(&client_addr), &client_addr_len,
                                  SOCK_NONBLOCK | SOCK_CLOEXEC);
             if (cfd < 0) {
                 if (errno == EAGAIN || errno == EWOULDBLOCK)
-                    break;  // No more connections to accept
-                break;      // Max File Descriptors reached, no need to raise exception
+                    break;  // Backlog drained
+                r.counters.on_accept_failure();
+                if (errno == EINTR || errno == ECONNABORTED || errno == EPROTO)
+                    continue;
+                if ((errno == EMFILE || errno == ENFILE) && shed_connection(r))
+                    continue;
+                break;  // Out of memory or descriptors: retried on the next readiness
             }
 #else
             // Fallback windows implementation
 
             // Fallback Unix implementation
-            int cfd = ::accept(listener_socket->native_handle(),
+            int cfd = ::accept(r.listener_socket->native_handle(),
                                reinterpret_cast<sockaddr*>(&client_addr), &client_addr_len);
             if (cfd < 0) {
                 if (errno == EAGAIN || errno == EWOULDBLOCK)
@@ -88,25 +135,18 @@ void epoll_server::try_accept() {
             }
 #endif
 
-            // Optional: disable Nagle for latency-sensitive workloads.
-            // int one = 1; setsockopt(cfd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
-
             // Add new connection to epoll monitoring
-            if (add_epoll(cfd, EPOLLIN | EPOLLET) < 0) {
+            if (add_epoll(r, cfd, EPOLLIN | EPOLLET) < 0) {
                 close_socket(cfd);
                 throw std::runtime_error("epoll_ctl ADD conn error: " +
                                          std::string(strerror(errno)));
-                continue;
             }
 
-            // Create connection object and add to tracking
-            auto connptr = std::make_shared<connection>(file_descriptor(cfd),
-                                                        listener_socket->get_bound_address(),
-                                                        socket_address(client_addr));
-            current_open_connections++;
-            conns.emplace(cfd, epoll_connection{connptr, {}, false});
-
-            on_connection_opened(connptr);
+            r.counters.on_accept();
+            epoll_connection& c = open_conn(r, cfd, client_addr);
+            on_connection_opened(c.conn);
+            if (tls_factory)
+                start_tls(r, cfd, c);
         } catch (const std::exception& e) {
             on_exception_occurred(e);
             // Continue accepting other connections despite individual failures
@@ -114,26 +154,198 @@ void epoll_server::try_accept() {
     }
 }
 
-void epoll_server::try_read(epoll_connection& c) {
+/**
+ * Implementation Notes:
+ * - epoll: the listener is removed from the interest list, a level-triggered
+ *   shared listener would otherwise wake the loop for every pending connection
+ * - io_uring: the multishot accept is cancelled; its final completion is
+ *   not re-armed while paused
+ */
+void epoll_server::pause_accept(epoll_reactor& r) {
+    if (r.accept_paused || !r.listener_socket)
+        return;
+    r.accept_paused = true;
+    r.accept_pending = false;
+#if CPPRESS_HAS_IO_URING
+    if (r.ring) {
+        io_uring_sqe* sqe = r.accept_armed ? r.ring->get_sqe(nullptr) : nullptr;
+        if (sqe) {
+            sqe->opcode = IORING_OP_ASYNC_CANCEL;
+            sqe->fd = -1;
+            sqe->addr = reinterpret_cast<std::uint64_t>(r.accept_op);
+        }
+        return;
+    }
+#endif
+    del_epoll(r, r.listener_socket->native_handle());
+}
+
+/**
+ * Implementation Notes:
+ * - Re-registering a listener with a non-empty backlog reports it readable
+ *   right away, edge-triggered or not
+ * - io_uring: re-armed unless the cancelled accept has not completed yet,
+ *   in which case its completion re-arms it
+ */
+void epoll_server::resume_accept(epoll_reactor& r) {
+    if (!r.accept_paused || at_connection_cap() || draining.load(std::memory_order_relaxed))
+        return;
+    r.accept_paused = false;
+#if CPPRESS_HAS_IO_URING
+    if (r.ring) {
+        if (r.accept_op && !r.accept_armed) {
+            uring_arm(r, r.accept_op);
+            r.accept_armed = true;
+        }
+        return;
+    }
+#endif
+    add_epoll(r, r.listener_socket->native_handle(),
+              r.owns_listener ? EPOLLIN | EPOLLET : EPOLLIN | EPOLLEXCLUSIVE);
+}
+
+/**
+ * Implementation Notes:
+ * - Connections still in the accept queue when a listener shuts down are
+ *   reset, so the queue is emptied first; one completing in between is lost
+ *   (unless net.ipv4.tcp_migrate_req moves it to another listener)
+ * - shutdown(SHUT_RD) stops a listening socket without closing it: the
+ *   descriptor stays valid for the socket objects that hold it. A listener
+ *   shared by several reactors is shut down by the first of them
+ */
+void epoll_server::stop_accepting(epoll_reactor& r) {
+    if (!r.listener_socket)
+        return;
+    if (!r.accept_paused) {
+        do
+            try_accept(r);
+        while (r.accept_pending && !r.accept_paused);
+    }
+    pause_accept(r);
+#if defined(__linux__) || defined(__linux)
+    ::shutdown(r.listener_socket->native_handle(), SHUT_RD);
+#endif
+}
+
+bool epoll_server::shed_connection(epoll_reactor& r) {
+#if defined(__linux__) || defined(__linux)
+    if (r.reserve_fd == -1)
+        return false;
+    ::close(r.reserve_fd);
+    int cfd = ::accept4(r.listener_socket->native_handle(), nullptr, nullptr, SOCK_CLOEXEC);
+    if (cfd >= 0)
+        ::close(cfd);
+    r.reserve_fd = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+    return cfd >= 0;
+#else
+    (void)r;
+    return false;
+#endif
+}
+
+/**
+ * Implementation Notes:
+ * - Shared by the epoll and io_uring accept paths
+ */
+epoll_connection& epoll_server::open_conn(epoll_reactor& r, int cfd,
+                                          sockaddr_storage client_addr) {
+    auto connptr = std::make_shared<connection>(
+        file_descriptor(cfd), r.listener_socket->get_bound_address(), socket_address(client_addr));
+    if (per_connection_options)
+        accepted_options.apply_to_accepted(cfd);  // best effort, the connection stays usable
+    return register_conn(r, cfd, std::move(connptr));
+}
+
+epoll_connection& epoll_server::register_conn(epoll_reactor& r, int fd,
+                                              std::shared_ptr<connection> conn) {
+    if (reactors.size() > 1 && static_cast<std::size_t>(fd) >= fd_owner_size)
+        throw std::runtime_error("Connection fd " + std::to_string(fd) +
+                                 " exceeds the descriptor limit");
+    current_open_connections++;
+    auto& state = r.conns.emplace(fd);
+    state.conn = std::move(conn);
+    for (int k = 0; k < (int)state.deadlines.size(); ++k)
+        state.deadlines[k] = timer_node(fd, k);
+    touch_idle(r, state);
+    if (reactors.size() > 1)
+        fd_owner[fd].store(static_cast<std::uint32_t>(r.index + 1), std::memory_order_release);
+    return state;
+}
+
+/**
+ * Implementation Notes:
+ * - Bytes arriving on an idle pooled connection belong to no request, the
+ *   connection can no longer be reused and is closed
+ */
+void epoll_server::deliver(epoll_reactor& r, int fd, epoll_connection& c, const data_buffer& db) {
+    cppress::shared::phase_scope reading(cppress::shared::request_phase::read);
+    if (c.upstream.empty()) {
+        on_message_received(c.conn, db);
+        return;
+    }
+    if (!c.client) {
+        close_later(r, fd, c);
+        return;
+    }
+    if (c.client->on_data) {
+        auto client = c.client;  // the handler may release the connection
+        client->on_data(c.conn, db);
+    }
+}
+
+void epoll_server::close_later(epoll_reactor& r, int fd, epoll_connection& c) {
+    c.want_close = true;
+    c.close_after_flush = true;
+    if (!c.pending_flush) {
+        c.pending_flush = true;
+        r.pending_flush.push_back(fd);
+    }
+}
+
+/**
+ * Sizing Policy:
+ * - A read that fills what was asked for doubles the next request, up to
+ *   the largest chunk class
+ * - A read under a quarter of it halves the next request, down to the
+ *   smallest class
+ */
+void epoll_server::adapt_read_size(epoll_reactor& r, epoll_connection& c, std::size_t want,
+                                   std::size_t got) noexcept {
+    if (got >= want)
+        c.read_size = std::min(want * 2, r.pool.max_chunk_size());
+    else if (got < want / 4)
+        c.read_size = std::max(want / 2, r.pool.min_chunk_size());
+    else
+        c.read_size = want;
+}
+
+void epoll_server::try_read(epoll_reactor& r, epoll_connection& c) {
+    cppress::shared::phase_scope reading(cppress::shared::request_phase::read);
     try {
-        char buf[64 * 1024];  // 64KB buffer for high throughput
-        std::size_t sz = 64 * 1024;
         int fd = c.conn->native_handle();
         // Read as much data as possible (edge-triggered)
-        while (!c.want_close) {
-            std::size_t m = ::recv(fd, buf, sz, 0);
+        while (!c.want_close && !c.reads_paused) {
+            // Receive straight into the pooled chunk, the callback gets a slice of it
+            std::size_t want = c.read_size ? c.read_size : r.pool.min_chunk_size();
+            char* buf = r.rx.prepare(want);
+            auto m = ::recv(fd, buf, r.rx.available(), 0);
             if (m > 0) {
-                on_message_received(c.conn, data_buffer(buf, m));
+                r.counters.on_read(static_cast<std::size_t>(m));
+                adapt_read_size(r, c, want, static_cast<std::size_t>(m));
+                touch_idle(r, c);
+                deliver(r, fd, c, r.rx.commit(static_cast<std::size_t>(m)));
             } else if (m == 0) {
                 // Peer closed connection gracefully
-                close_conn(fd);
+                close_conn(r, fd);
                 return;
             } else {
                 // Error or would block
+                if (errno == EINTR)
+                    continue;
                 if (errno == EAGAIN || errno == EWOULDBLOCK)
                     break;  // No more data available
                 // Connection error, close it
-                close_conn(fd);
+                close_conn(r, fd);
                 return;
             }
         }
@@ -141,6 +353,22 @@ void epoll_server::try_read(epoll_connection& c) {
         on_exception_occurred(e);
     }
 }
+
+/**
+ * Implementation Notes:
+ * - With a single reactor every fd belongs to it, no lookup or locking
+ * - With several reactors the owner is resolved through fd_owner, which is
+ *   filled on accept and cleared before the socket is closed; one atomic
+ *   load, no lock
+ */
+epoll_reactor* epoll_server::reactor_for(int fd) {
+    if (reactors.size() == 1)
+        return reactors.front().get();
+    if (fd < 0 || static_cast<std::size_t>(fd) >= fd_owner_size)
+        return nullptr;
+    std::uint32_t owner = fd_owner[fd].load(std::memory_order_acquire);
+    return owner == 0 ? nullptr : reactors[owner - 1].get();
+}
 #if defined(__linux__) || defined(__linux)
 
 /**
@@ -160,12 +388,12 @@ int epoll_server::set_rlimit_nofile(rlim_t soft, rlim_t hard) {
  * - Stores file descriptor in event data for easy retrieval
  * - Edge-triggered mode requires careful handling of partial I/O
  */
-int epoll_server::add_epoll(int fd, uint32_t ev) {
+int epoll_server::add_epoll(epoll_reactor& r, int fd, uint32_t ev) {
     epoll_event e{};
     e.events = ev;
     e.data.fd = fd;
 
-    return ::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &e);
+    return ::epoll_ctl(r.epoll_fd, EPOLL_CTL_ADD, fd, &e);
 }
 
 /**
@@ -173,12 +401,12 @@ int epoll_server::add_epoll(int fd, uint32_t ev) {
  * - Enable write monitoring: mod_epoll(fd, EPOLLIN | EPOLLOUT | EPOLLET)
  * - Disable write monitoring: mod_epoll(fd, EPOLLIN | EPOLLET)
  */
-int epoll_server::mod_epoll(int fd, uint32_t ev) {
+int epoll_server::mod_epoll(epoll_reactor& r, int fd, uint32_t ev) {
     epoll_event e{};
     e.events = ev;
     e.data.fd = fd;
     // std::cout << fd << " " << ev << std::endl;
-    return epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &e);
+    return epoll_ctl(r.epoll_fd, EPOLL_CTL_MOD, fd, &e);
 }
 
 /**
@@ -187,8 +415,8 @@ int epoll_server::mod_epoll(int fd, uint32_t ev) {
  * - Third parameter can be NULL for delete operations
  * - Should be called before closing the file descriptor
  */
-int epoll_server::del_epoll(int fd) {
-    return epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+int epoll_server::del_epoll(epoll_reactor& r, int fd) {
+    return epoll_ctl(r.epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
 }
 
 /**
@@ -197,55 +425,81 @@ int epoll_server::del_epoll(int fd) {
  * Implementation Notes:
  * - Order of operations is important for proper cleanup
  * - Callbacks are called before resource deallocation
- * - Uses utility function close_socket() for cross-platform compatibility
+ * - Closes through connection::close() so the fd is closed exactly once
+ * - io_uring: operations still queued for the connection are cancelled,
+ *   their completions are recognized as stale and only release the operation
  */
-void epoll_server::close_conn(int fd) {
+void epoll_server::close_conn(epoll_reactor& r, int fd) {
     current_open_connections--;
-    del_epoll(fd);
-    on_connection_closed(conns[fd].conn);
-    close_socket(fd);
-    conns.erase(fd);
+    auto& state = *r.conns.find(fd);
+#if CPPRESS_HAS_IO_URING
+    if (r.ring) {
+        for (uring_op* op : {state.recv_op, state.send_op}) {
+            if (!op)
+                continue;
+            io_uring_sqe* sqe = r.ring->get_sqe(nullptr);
+            if (sqe) {
+                sqe->opcode = IORING_OP_ASYNC_CANCEL;
+                sqe->fd = -1;
+                sqe->addr = reinterpret_cast<std::uint64_t>(op);
+            }
+        }
+    } else
+#endif
+        del_epoll(r, fd);
+    // Unlink before the entry (and its timers) is destroyed
+    for (auto& timer : state.deadlines)
+        r.timers.cancel(timer);
+    auto conn = state.conn;
+    if (state.upstream.empty()) {
+        on_connection_closed(conn);
+    } else if (state.client && state.client->on_close && !state.connecting) {
+        auto client = std::move(state.client);
+        try {
+            client->on_close(conn);
+        } catch (const std::exception& e) {
+            on_exception_occurred(e);
+        }
+    }
+    if (reactors.size() > 1) {
+        // Drop ownership before the fd number can be reused by another reactor's accept
+        fd_owner[fd].store(0, std::memory_order_release);
+    }
+    // Close through the connection so that references still held elsewhere (pending
+    // commands, application threads) see it closed and never close a reused fd number
+    if (conn)
+        conn->close();
+    else
+        close_socket(fd);
+    r.conns.erase(fd);
 }
 
 /**
  * Algorithm:
- * 1. Process each queued message in order
- * 2. Skip empty messages (cleanup)
- * 3. Attempt to send data using ::send()
- * 4. Handle partial sends by updating message content
- * 5. Stop on EAGAIN/EWOULDBLOCK (socket buffer full)
- * 6. Return false on any other error
+ * 1. Delegate to output_chain::flush(), which batches segments into writev
+ * 2. Partial sends only advance the chain's head offset
+ * 3. Stop on EAGAIN/EWOULDBLOCK (socket buffer full)
+ * 4. Report any other error to the caller
  *
  * Edge Cases Handled:
- * - Empty messages in queue
+ * - Empty segments are never queued
  * - Partial sends (socket buffer full)
  * - Connection errors during send
  * - Exception safety with try-catch
  */
-bool epoll_server::flush_writes(epoll_connection& c) {
+output_chain::flush_result epoll_server::flush_writes(epoll_reactor& r, epoll_connection& c) {
+    cppress::shared::phase_scope writing(cppress::shared::request_phase::write);
     try {
-        while (!c.outq.empty()) {
-            std::string& front = c.outq.front();
-            if (front.empty()) {
-                c.outq.pop_front();
-                continue;
-            }
-            int n = ::send(c.conn->native_handle(), front.data(), front.size(), 0);
-            if (n > 0) {
-                front.erase(0, (size_t)n);
-                continue;
-            }
-            if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
-                // Cannot write more now - socket buffer is full
-                return false;
-            }
-            // Error occurred during send operation
-            return false;
-        }
-        return true;
+        // Completions of io_uring sends are not tied to the error queue, no zero-copy there
+        std::size_t zerocopy_min = backend == io_backend::epoll ? zerocopy_threshold : 0;
+        std::size_t queued = c.outq.size();
+        auto result = c.outq.flush(c.conn->native_handle(), zerocopy_min);
+        r.counters.on_flush(queued, queued - c.outq.size(),
+                            result == output_chain::flush_result::would_block);
+        return result;
     } catch (const std::exception& e) {
         on_exception_occurred(e);
-        return false;
+        return output_chain::flush_result::error;
     }
 }
 
@@ -264,7 +518,7 @@ bool epoll_server::flush_writes(epoll_connection& c) {
  * Performance Features:
  * - Edge-triggered epoll for minimal syscalls
  * - Batch event processing
- * - Non-blocking accept loop for connection bursts
+ * - Budgeted accept loop for connection bursts, paused at the connection cap
  * - Intelligent write flow control
  * - Dynamic event buffer sizing
  *
@@ -273,13 +527,26 @@ bool epoll_server::flush_writes(epoll_connection& c) {
  * - Exception isolation prevents server crashes
  * - Automatic cleanup of failed connections
  */
-void epoll_server::epoll_loop(int timeout) {
-    on_listen_success();
+void epoll_server::epoll_loop(epoll_reactor& r, int timeout) {
+    auto& events = r.events;
+    current_reactor = &r;
     while (!g_stop)
         try {
             on_waiting_for_activity();
             // Wait for events with specified timeout
-            int n = epoll_wait(epoll_fd, events.data(), (int)events.size(), timeout);
+            // Sleep no longer than the next connection deadline
+            int wait = r.timers.next_timeout(timer_wheel::clock::now(), timeout);
+            if (r.accept_pending)
+                wait = 0;  // The backlog will not signal again (edge-triggered)
+            else if (r.accept_paused && (wait < 0 || wait > 100))
+                wait = 100;  // Closes on other reactors do not wake this one
+            auto waiting = std::chrono::steady_clock::now();
+            int n = epoll_wait(r.epoll_fd, events.data(), (int)events.size(), wait);
+            auto woke = std::chrono::steady_clock::now();
+            r.counters.on_wakeup(n > 0 ? static_cast<std::size_t>(n) : 0,
+                                 elapsed_ns(waiting, woke));
+            // Expire first so deadlines armed while handling events start from now
+            expire_deadlines(r);
             if (n < 0) {
                 if (errno == EINTR)
                     continue;  // Interrupted by signal, continue
@@ -293,6 +560,7 @@ void epoll_server::epoll_loop(int timeout) {
             if (n == (int)events.size()) {
                 // grow event buffer if saturated
                 events.resize(events.size() * 2);
+                r.counters.on_events_resize();
             }
             // Process each ready event
             for (int i = 0; i < n; ++i) {
@@ -300,77 +568,377 @@ void epoll_server::epoll_loop(int timeout) {
                 int fd = events[i].data.fd;
 
                 // Handle new connections on listener socket
-                if (listener_socket && fd == listener_socket->native_handle()) {
-                    try_accept();
+                if (r.listener_socket && fd == r.listener_socket->native_handle()) {
+                    try_accept(r);
+                    continue;
+                }
+
+                // Commands from other threads are pending, drained after this batch
+                if (fd == r.wake_fd) {
+#if defined(__linux__) || defined(__linux)
+                    uint64_t counter;
+                    while (::read(r.wake_fd, &counter, sizeof(counter)) > 0) {
+                    }
+#endif
                     continue;
                 }
 
                 // Find connection state for this file descriptor
-                auto it = conns.find(fd);
-                if (it == conns.end()) {
+                epoll_connection* state = r.conns.find(fd);
+                if (!state) {
                     continue;  // Connection not found, skip
                 }
-                epoll_connection& c = it->second;
-
-                // Handle write flow control and output queue management
-                if (!c.outq.empty()) {
-                    // Try to flush immediately to avoid extra EPOLLOUT wakeup
-                    if (flush_writes(c)) {
-                        // All data sent, disable write monitoring if enabled
-                        if (c.want_write) {
-                            c.want_write = false;
-                            mod_epoll(fd, EPOLLIN | EPOLLET);
-                        }
-                    } else {
-                        // Data remains, ensure write monitoring is enabled
-                        if (!c.want_write) {
-                            c.want_write = true;
-                            mod_epoll(fd, EPOLLIN | EPOLLOUT | EPOLLET);
-                        }
-                    }
-                }
+                epoll_connection& c = *state;
 
-                // Handle socket ready for writing (EPOLLOUT)
-                if (ev & EPOLLOUT) {
-                    if (flush_writes(c)) {
-                        // All data sent, disable write monitoring
-                        c.want_write = false;
-                        mod_epoll(fd, EPOLLIN | EPOLLET);
-                    }
-                    // If flush_writes returns false, keep EPOLLOUT enabled
+                // Outbound connection still connecting: writable (or failed) means done
+                if (c.connecting) {
+                    if (ev & (EPOLLOUT | EPOLLERR | EPOLLHUP))
+                        finish_connect(r, fd, c);
+                    continue;
                 }
 
-                // Handle connection errors and closures
-                if (ev & (EPOLLERR | EPOLLHUP)) {
-                    if (!c.want_write)
-                        close_conn(fd);
+                // TLS handshake in progress: the handshaker does the socket I/O
+                if (c.tls) {
+                    if (ev & (EPOLLERR | EPOLLHUP))
+                        close_conn(r, fd);
+                    else
+                        advance_tls(r, fd, c);
                     continue;
                 }
 
-                // Handle custom close events (requested by application)
-                if (ev & HAMZA_CUSTOM_CLOSE_EVENT) {
+                // Zero-copy completion notifications raise EPOLLERR without a socket error
+                if ((ev & EPOLLERR) && c.outq.zerocopy_pending() && c.outq.reap_zerocopy(fd) > 0 &&
+                    pending_socket_error(fd) == 0)
+                    ev &= ~uint32_t(EPOLLERR);
+
+                // Flush queued output when data is pending or the socket became writable
+                if (!c.outq.empty() || (ev & EPOLLOUT)) {
+                    if (!service_writes(r, fd, c))
+                        continue;  // Closed after its final flush
+                }
+
+                // Handle connection errors and closures
+                if (ev & (EPOLLERR | EPOLLHUP)) {
                     if (!c.want_write)
-                        close_conn(fd);
+                        close_conn(r, fd);
                     continue;
                 }
 
                 // Handle incoming data (EPOLLIN)
                 if (ev & EPOLLIN) {
-                    try_read(c);
+                    try_read(r, c);
                 }
+            }
+            // Apply cross-thread commands and flush everything touched by this batch
+            drain_commands(r);
+
+            // Connections left over by the accept budget, or closes that brought
+            // the server back under its cap
+            if (r.accept_paused)
+                resume_accept(r);
+            else if (r.accept_pending)
+                try_accept(r);
+            r.counters.on_handlers(elapsed_ns(woke, std::chrono::steady_clock::now()));
+        } catch (const std::exception& e) {
+            std::cerr << "UNKNOWN ERROR CAUGHT BY EVENT LOOP: " << e.what() << std::endl;
+            on_exception_occurred(e);
+        }
+    current_reactor = nullptr;
+}
+
+/**
+ * Implementation Notes:
+ * - Commands are matched against the connection they were created for, a
+ *   command for a closed (and possibly reused) fd is dropped
+ * - Nothing is written or closed here, the connection is only added to the
+ *   pending flush list, which keeps references held by callers valid
+ */
+void epoll_server::apply_command(epoll_reactor& r, reactor_command& cmd) {
+    if (cmd.type == reactor_command::kind::connect) {
+        start_connect(r, cmd);
+        return;
+    }
+    if (cmd.type == reactor_command::kind::timer) {
+        auto timer = std::make_unique<loop_timer>();
+        timer->callback = std::move(cmd.callback);
+        // arm() counts from the last wheel advance, which may be a sleep ago
+        r.timers.arm_at(*timer, timer_wheel::clock::now() + cmd.delay);
+        r.loop_timers.emplace(timer.get(), std::move(timer));
+        return;
+    }
+    epoll_connection* state = r.conns.find(cmd.fd);
+    if (!state)
+        return;  // Connection already closed
+    epoll_connection& c = *state;
+    if (cmd.conn && c.conn != cmd.conn)
+        return;  // fd was reused by a newer connection
+
+    switch (cmd.type) {
+        case reactor_command::kind::send:
+            for (auto& segment : cmd.payload)
+                c.outq.push(std::move(segment));
+            // Pause right away, a read loop in progress stops at its next iteration
+            update_backpressure(r, cmd.fd, c);
+            break;
+        case reactor_command::kind::close:
+            c.want_close = true;
+            c.close_after_flush = true;
+            break;
+        case reactor_command::kind::stop_reading:
+            c.want_close = true;
+            return;
+        case reactor_command::kind::arm_deadline:
+            r.timers.arm(c.deadlines[static_cast<int>(cmd.deadline)], cmd.delay);
+            if (cmd.deadline != connection_deadline::idle)
+                r.timers.cancel(c.deadlines[static_cast<int>(connection_deadline::idle)]);
+            return;
+        case reactor_command::kind::cancel_deadline:
+            r.timers.cancel(c.deadlines[static_cast<int>(cmd.deadline)]);
+            if (cmd.deadline != connection_deadline::idle)
+                touch_idle(r, c);
+            return;
+        case reactor_command::kind::release:
+            release_to_pool(r, cmd.fd, c);
+            return;
+        case reactor_command::kind::connect:
+        case reactor_command::kind::timer:
+            return;  // Handled above, targets no connection
+    }
+    if (!c.pending_flush) {
+        c.pending_flush = true;
+        r.pending_flush.push_back(cmd.fd);
+    }
+}
+
+/**
+ * Delivery Rules:
+ * - Owning loop thread: applied in place, flushed at the end of the batch
+ * - Other threads: pushed on the reactor's MPSC queue; the eventfd is only
+ *   written when the push found the queue empty
+ * - Without eventfd (non-Linux) the loop picks commands up after its next
+ *   epoll_wait timeout
+ */
+void epoll_server::dispatch_command(reactor_command cmd) {
+    epoll_reactor* r = reactor_for(cmd.fd);
+    if (!r)
+        return;  // Connection not found
+    deliver_command(*r, std::move(cmd));
+}
+
+void epoll_server::run_after(std::chrono::milliseconds delay, std::function<void()> callback) {
+    reactor_command cmd;
+    cmd.type = reactor_command::kind::timer;
+    cmd.delay = delay;
+    cmd.callback = std::move(callback);
+    for (auto& r : reactors) {
+        if (r.get() == current_reactor) {
+            deliver_command(*r, std::move(cmd));
+            return;
+        }
+    }
+    std::size_t next = next_client_reactor.fetch_add(1, std::memory_order_relaxed);
+    deliver_command(*reactors[next % reactors.size()], std::move(cmd));
+}
+
+void epoll_server::deliver_command(epoll_reactor& r, reactor_command cmd) {
+    if (current_reactor == &r) {
+        apply_command(r, cmd);
+        return;
+    }
+    if (r.commands.push(std::move(cmd)) && r.wake_fd != -1) {
+#if defined(__linux__) || defined(__linux)
+        uint64_t one = 1;
+        [[maybe_unused]] auto written = ::write(r.wake_fd, &one, sizeof(one));
+#endif
+    }
+}
+
+/**
+ * Algorithm:
+ * 1. Detach the whole command queue with one atomic exchange
+ * 2. Apply every command in FIFO order (queue output, mark closes)
+ * 3. Flush each touched connection once, closing those whose close was
+ *    requested and whose output queue is now empty
+ */
+void epoll_server::drain_commands(epoll_reactor& r) {
+    r.commands.drain([this, &r](reactor_command& cmd) {
+        try {
+            apply_command(r, cmd);
+        } catch (const std::exception& e) {
+            on_exception_occurred(e);
+        }
+    });
 
-            next_event:
+    // Callbacks fired while flushing (e.g. on_connection_closed) may touch more connections
+    std::vector<int> touched;
+    while (!r.pending_flush.empty()) {
+        touched.clear();
+        touched.swap(r.pending_flush);
+        for (int fd : touched) {
+            epoll_connection* c = r.conns.find(fd);
+            if (!c)
                 continue;
+            c->pending_flush = false;
+            service_writes(r, fd, *c);
+        }
+    }
+    // Keep the allocation for the next batch
+    touched.clear();
+    r.pending_flush.swap(touched);
+}
+
+/**
+ * Flow Control:
+ * - Everything flushed: drop EPOLLOUT interest, close if a close is pending
+ * - Data remains: enable EPOLLOUT interest until the socket drains
+ * - Write error: close the connection
+ * - TLS handshake pending: output waits, a pending close happens at once
+ */
+bool epoll_server::service_writes(epoll_reactor& r, int fd, epoll_connection& c) {
+#if CPPRESS_HAS_IO_URING
+    if (r.ring)
+        return uring_service_writes(r, fd, c);
+#endif
+    if (c.tls) {
+        // Plaintext must not reach the socket before the kernel protects it
+        if (c.close_after_flush) {
+            close_conn(r, fd);
+            return false;
+        }
+        return true;
+    }
+    if (!c.outq.empty())
+        touch_idle(r, c);
+    auto result = flush_writes(r, c);
+    if (result == output_chain::flush_result::error) {
+        close_conn(r, fd);
+        return false;
+    }
+    if (result == output_chain::flush_result::complete) {
+        if (c.close_after_flush) {
+            close_conn(r, fd);
+            return false;
+        }
+        // All data sent, disable write monitoring if enabled
+        if (c.want_write) {
+            c.want_write = false;
+            mod_epoll(r, fd, interest(c));
+        }
+    } else {
+        // Data remains, ensure write monitoring is enabled
+        if (!c.want_write) {
+            c.want_write = true;
+            mod_epoll(r, fd, interest(c));
+        }
+    }
+    update_backpressure(r, fd, c);
+    return true;
+}
+
+uint32_t epoll_server::interest(const epoll_connection& c) noexcept {
+    return (c.reads_paused ? 0u : uint32_t(EPOLLIN)) | (c.want_write ? uint32_t(EPOLLOUT) : 0u) |
+           uint32_t(EPOLLET);
+}
+
+/**
+ * Implementation Notes:
+ * - epoll: EPOLLIN is dropped from the interest set; EPOLL_CTL_MOD re-reports
+ *   readiness on resume, so input that arrived meanwhile is not lost to
+ *   edge triggering
+ * - io_uring: the multishot receive is cancelled and re-armed on resume
+ * - Errors and hang-ups are still reported while paused
+ */
+void epoll_server::update_backpressure(epoll_reactor& r, int fd, epoll_connection& c) {
+    if (write_high_watermark == 0)
+        return;
+    std::size_t queued = c.outq.size();
+    if (!c.reads_paused && queued > write_high_watermark)
+        c.reads_paused = true;
+    else if (c.reads_paused && queued <= write_low_watermark)
+        c.reads_paused = false;
+    else
+        return;
+
+#if CPPRESS_HAS_IO_URING
+    if (r.ring) {
+        if (c.reads_paused && c.recv_op) {
+            io_uring_sqe* sqe = r.ring->get_sqe(nullptr);
+            if (sqe) {
+                sqe->opcode = IORING_OP_ASYNC_CANCEL;
+                sqe->fd = -1;
+                sqe->addr = reinterpret_cast<std::uint64_t>(c.recv_op);
             }
-            // After processing all events, you try to accept the connections that failed
-            if (listener_socket)
-                try_accept();
+        } else if (!c.reads_paused && !c.recv_op) {
+            c.recv_op = uring_submit(r, uring_op::kind::recv, fd, r.conns.generation(fd));
+        }
+    } else
+#endif
+        mod_epoll(r, fd, interest(c));
+
+    try {
+        on_backpressure(c.conn, c.reads_paused);
+    } catch (const std::exception& e) {
+        on_exception_occurred(e);
+    }
+}
+
+/**
+ * Implementation Notes:
+ * - Uses pthread_setaffinity_np on the calling thread
+ * - Failures are reported through on_exception_occurred, the loop still runs unpinned
+ * - No-op on platforms without thread affinity support
+ */
+void epoll_server::pin_current_thread(std::size_t index) {
+#if defined(__linux__) || defined(__linux)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (!reactor_cpus.empty()) {
+        for (const int cpu : reactor_cpus[index % reactor_cpus.size()])
+            if (cpu >= 0 && cpu < CPU_SETSIZE)
+                CPU_SET(cpu, &set);
+        if (CPU_COUNT(&set) == 0)
+            return;
+    } else {
+        unsigned int cpus = std::thread::hardware_concurrency();
+        if (cpus == 0)
+            return;
+        CPU_SET(index % cpus, &set);
+    }
+    int rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (rc != 0) {
+        on_exception_occurred(
+            std::runtime_error("Failed to pin reactor thread: " + std::string(strerror(rc))));
+    }
+#else
+    (void)index;
+#endif
+}
+
+/**
+ * Implementation Notes:
+ * - Only listeners a reactor owns: one shared through EPOLLEXCLUSIVE
+ *   serves several CPUs
+ * - A rejected option is reported, the listener keeps accepting from any queue
+ */
+void epoll_server::steer_listeners() {
+#ifdef SO_INCOMING_CPU
+    if (reactor_cpus.empty())
+        return;
+    for (auto& r : reactors) {
+        const std::vector<int>& cpus = reactor_cpus[r->index % reactor_cpus.size()];
+        if (!r->owns_listener || !r->listener_socket || cpus.size() != 1)
+            continue;
+        try {
+            r->listener_socket->set_option(SOL_SOCKET, SO_INCOMING_CPU, cpus.front());
         } catch (const std::exception& e) {
-            std::cerr << "UNKNOWN ERROR CAUGHT BY EVENT LOOP: " << e.what() << std::endl;
             on_exception_occurred(e);
         }
+    }
+#endif
+}
 
-    on_shutdown_success();
+std::size_t epoll_server::current_reactor_index() noexcept {
+    return current_reactor ? current_reactor->index : NO_REACTOR;
 }
 
 // ============================================================================
@@ -379,64 +947,159 @@ void epoll_server::epoll_loop(int timeout) {
 
 /**
  * Implementation Details:
- * - Uses custom epoll event (HAMZA_CUSTOM_CLOSE_EVENT) for signaling
- * - Defers actual closure to the main event loop
- * - Handles case where connection might already be closed
- * - Thread-safe approach via epoll signaling mechanism
+ * - Sends a close command to the owning loop
+ * - The loop closes the connection after its pending output is flushed
+ * - Ignored if the connection was already closed, even if its fd was reused
+ * - Thread-safe via the reactor command queue
  */
 void epoll_server::close_connection(std::shared_ptr<connection> conn) {
-    auto c = conns.find(conn->native_handle());
-    int fd = conn->native_handle();
-    if (c == conns.end())
-        return;  // Connection already closed
-    conns[fd].want_close = true;
-    mod_epoll(fd, HAMZA_CUSTOM_CLOSE_EVENT);
+    reactor_command cmd;
+    cmd.type = reactor_command::kind::close;
+    cmd.fd = conn->native_handle();
+    cmd.conn = std::move(conn);
+    dispatch_command(std::move(cmd));
 }
 
 void epoll_server::stop_reading_from_connection(std::shared_ptr<connection> conn) {
-    auto c = conns.find(conn->native_handle());
-    if (c != conns.end()) {
-        c->second.want_close = true;
-    }
+    reactor_command cmd;
+    cmd.type = reactor_command::kind::stop_reading;
+    cmd.fd = conn->native_handle();
+    cmd.conn = std::move(conn);
+    dispatch_command(std::move(cmd));
 }
 
 void epoll_server::close_connection(int fd) {
-    auto c = conns.find(fd);
-    if (c == conns.end())
-        return;  // Connection already closed
-    conns[fd].want_close = true;
-    mod_epoll(fd, HAMZA_CUSTOM_CLOSE_EVENT);
+    reactor_command cmd;
+    cmd.type = reactor_command::kind::close;
+    cmd.fd = fd;
+    dispatch_command(std::move(cmd));
+}
+
+void epoll_server::set_deadline(std::shared_ptr<connection> conn, connection_deadline which,
+                                std::chrono::milliseconds after) {
+    reactor_command cmd;
+    cmd.type = reactor_command::kind::arm_deadline;
+    cmd.fd = conn->native_handle();
+    cmd.conn = std::move(conn);
+    cmd.deadline = which;
+    cmd.delay = after;
+    dispatch_command(std::move(cmd));
+}
+
+void epoll_server::clear_deadline(std::shared_ptr<connection> conn, connection_deadline which) {
+    reactor_command cmd;
+    cmd.type = reactor_command::kind::cancel_deadline;
+    cmd.fd = conn->native_handle();
+    cmd.conn = std::move(conn);
+    cmd.deadline = which;
+    dispatch_command(std::move(cmd));
+}
+
+/**
+ * Implementation Notes:
+ * - idle only runs between phases bounded by the protocol layer, so it is
+ *   left alone while a header or body deadline is armed
+ */
+void epoll_server::touch_idle(epoll_reactor& r, epoll_connection& c) {
+    if (idle_timeout.count() <= 0)
+        return;
+    if (c.deadlines[static_cast<int>(connection_deadline::header)].armed() ||
+        c.deadlines[static_cast<int>(connection_deadline::body)].armed())
+        return;
+    r.timers.arm(c.deadlines[static_cast<int>(connection_deadline::idle)], idle_timeout);
+}
+
+void epoll_server::expire_deadlines(epoll_reactor& r) {
+    r.timers.advance(timer_wheel::clock::now(), [this, &r](timer_node& timer) {
+        if (timer.tag == loop_timer::TAG) {
+            auto it = r.loop_timers.find(&timer);
+            if (it == r.loop_timers.end())
+                return;
+            auto callback = std::move(it->second->callback);
+            r.loop_timers.erase(it);
+            try {
+                callback();
+            } catch (const std::exception& e) {
+                on_exception_occurred(e);
+            }
+            return;
+        }
+        epoll_connection* c = r.conns.find(timer.fd);
+        if (!c)
+            return;
+        if (c->close_after_flush) {
+            // Already closing but the peer stopped draining its output
+            close_conn(r, timer.fd);
+            return;
+        }
+        if (!c->upstream.empty()) {
+            // Outbound connections are not the protocol layer's to handle
+            if (c->connecting)
+                fail_connect(r, timer.fd, *c, ETIMEDOUT);
+            else
+                close_conn(r, timer.fd);
+            return;
+        }
+        try {
+            on_deadline_expired(c->conn, static_cast<connection_deadline>(timer.tag));
+        } catch (const std::exception& e) {
+            on_exception_occurred(e);
+        }
+    });
 }
 
 /**
  * @brief Queues a message for asynchronous sending
  *
- * Adds a message to the connection's output queue and ensures the connection
- * is monitored for write availability. Messages are sent asynchronously
- * when the socket becomes writable, providing efficient flow control.
+ * Hands the message to the loop owning the connection. Messages are sent
+ * when the loop services its pending flush list, and EPOLLOUT is only
+ * enabled if the socket buffer fills up.
  * Algorithm:
- * 1. Find connection in internal map
- * 2. Add message to connection's output queue
- * 3. Enable write monitoring via epoll
- * 4. Actual sending happens in main event loop
+ * 1. Wrap the message in a send command
+ * 2. Deliver it to the owning reactor (in place or through its queue)
+ * 3. The loop appends it to the connection's output queue
+ * 4. Actual sending happens in the loop's flush pass
  *
  * Benefits:
- * - Non-blocking message queuing
- * - Automatic flow control via epoll
+ * - Non-blocking message queuing from any thread
+ * - One eventfd wakeup for a burst of responses
  * - Prevents blocking on full socket buffers
  * - Maintains message ordering per connection
  */
 void epoll_server::send_message(std::shared_ptr<connection> conn, const data_buffer& db) {
-    int fd = conn->native_handle();
-    auto it = conns.find(fd);
-    if (it == conns.end()) {
-        return;  // Connection not found
-    }
-    epoll_connection& c = it->second;
-    c.outq.emplace_back(db.to_string());
+    send_message(std::move(conn), data_buffer(db));
+}
+
+void epoll_server::send_message(std::shared_ptr<connection> conn, data_buffer&& db) {
+    std::vector<output_segment> segments;
+    segments.emplace_back(std::move(db));
+    send_message(std::move(conn), std::move(segments));
+}
+
+void epoll_server::send_message(std::shared_ptr<connection> conn,
+                                std::vector<data_buffer>&& segments) {
+    std::vector<output_segment> out;
+    out.reserve(segments.size());
+    for (auto& segment : segments)
+        out.emplace_back(std::move(segment));
+    send_message(std::move(conn), std::move(out));
+}
+
+void epoll_server::send_file(std::shared_ptr<connection> conn, file_region file) {
+    std::vector<output_segment> out;
+    out.emplace_back(std::move(file));
+    send_message(std::move(conn), std::move(out));
+}
 
-    // Enable write monitoring to flush the queue
-    mod_epoll(fd, EPOLLOUT);
+void epoll_server::send_message(std::shared_ptr<connection> conn,
+                                std::vector<output_segment>&& segments) {
+    cppress::shared::phase_scope writing(cppress::shared::request_phase::write);
+    reactor_command cmd;
+    cmd.type = reactor_command::kind::send;
+    cmd.fd = conn->native_handle();
+    cmd.conn = std::move(conn);
+    cmd.payload = std::move(segments);
+    dispatch_command(std::move(cmd));
 }
 
 // ============================================================================
@@ -454,6 +1117,39 @@ void epoll_server::on_exception_occurred(const std::exception& e) {
     std::cerr << "Exception: " << e.what() << std::endl;
 }
 
+void epoll_server::on_deadline_expired(std::shared_ptr<connection> conn, connection_deadline) {
+    close_connection(std::move(conn));
+}
+
+void epoll_server::on_backpressure(std::shared_ptr<connection>, bool) {}
+
+bool epoll_server::connection_idle(const std::shared_ptr<connection>&) { return true; }
+
+loop_stats epoll_server::stats() const noexcept {
+    loop_stats total;
+    for (const auto& r : reactors)
+        total += r->counters.snapshot();
+    return total;
+}
+
+loop_stats epoll_server::stats(std::size_t reactor) const {
+    return reactors.at(reactor)->counters.snapshot();
+}
+
+void epoll_server::set_read_buffer_sizes(const std::vector<std::size_t>& class_sizes) {
+    for (auto& r : reactors) {
+        r->pool = buffer_pool(class_sizes, 64);
+        r->rx = receive_buffer(r->pool, r->pool.min_chunk_size());
+    }
+}
+
+void epoll_server::set_write_watermarks(std::size_t high, std::size_t low) {
+    if (low > high)
+        throw std::invalid_argument("Low write watermark exceeds the high watermark");
+    write_high_watermark = high;
+    write_low_watermark = low;
+}
+
 void epoll_server::on_connection_opened(std::shared_ptr<connection> conn) {
     std::cout << "Client Connected:\n";
     std::cout << "\t Client " << conn->native_handle() << " connected." << std::endl;
@@ -495,7 +1191,11 @@ void epoll_server::on_message_received(std::shared_ptr<connection> conn, const d
  * - Initializing background tasks
  */
 void epoll_server::on_listen_success() {
-    std::cout << "Listening on " << listener_socket->native_handle() << std::endl;
+    for (const auto& r : reactors) {
+        if (r->listener_socket)
+            std::cout << "Listening on " << r->listener_socket->native_handle() << " (reactor "
+                      << r->index << ")" << std::endl;
+    }
 }
 
 /**
@@ -516,35 +1216,140 @@ void epoll_server::on_shutdown_success() {
 /**
  * Initialization Steps:
  * 1. Configure process file descriptor limits
- * 2. Allocate initial event buffer (4096 events)
- * 3. Create epoll instance with EPOLL_CLOEXEC flag
- * 4. Validate epoll creation success
+ * 2. Create one reactor per requested event loop (at least one)
+ * 3. Allocate initial event buffer (4096 events) per reactor
+ * 4. Create epoll instance with EPOLL_CLOEXEC flag per reactor
+ * 5. Validate epoll creation success
+ * 6. With several reactors, size the fd owner table to the descriptor limit
  */
-epoll_server::epoll_server(int max_fds) {
+epoll_server::epoll_server(int max_fds, std::size_t reactor_count, bool pin_reactors,
+                           io_backend backend)
+    : pin_reactors(pin_reactors) {
 #if defined(__linux__) || defined(__linux)
     if (set_rlimit_nofile(max_fds, max_fds) != 0) {
         std::cerr << "Failed to set file descriptor limits: " << strerror(errno) << std::endl;
     } else
 
         this->max_fds = max_fds;
-    events = std::vector<epoll_event>(4096);
-    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
-    if (epoll_fd == -1) {
-        std::cerr << "Failed to create epoll instance: " << strerror(errno) << std::endl;
-        throw std::runtime_error("Failed to create epoll instance");
-    }
+#endif
+    if (reactor_count == 0)
+        reactor_count = 1;
+    reactors.reserve(reactor_count);
+    for (std::size_t i = 0; i < reactor_count; ++i) {
+        auto r = std::make_unique<epoll_reactor>();
+        r->index = i;
+        r->events = std::vector<epoll_event>(4096);
+#if defined(__linux__) || defined(__linux)
+        r->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (r->epoll_fd == -1) {
+            std::cerr << "Failed to create epoll instance: " << strerror(errno) << std::endl;
+            throw std::runtime_error("Failed to create epoll instance");
+        }
+        r->reserve_fd = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+        r->wake_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (r->wake_fd == -1 || add_epoll(*r, r->wake_fd, EPOLLIN) != 0) {
+            std::cerr << "Failed to create reactor eventfd: " << strerror(errno) << std::endl;
+            throw std::runtime_error("Failed to create reactor eventfd");
+        }
 #else
-    events = std::vector<epoll_event>(4096);
-    epoll_fd = epoll_create1(0);
-    if (epoll_fd == INVALID_HANDLE_VALUE) {
-        std::cerr << "Failed to create epoll instance: " << strerror(errno) << std::endl;
-        throw std::runtime_error("Failed to create epoll instance");
+        r->epoll_fd = epoll_create1(0);
+        if (r->epoll_fd == INVALID_HANDLE_VALUE) {
+            std::cerr << "Failed to create epoll instance: " << strerror(errno) << std::endl;
+            throw std::runtime_error("Failed to create epoll instance");
+        }
+#endif
+        reactors.push_back(std::move(r));
     }
+
+    if (reactors.size() > 1) {
+        // Descriptors are always below the soft limit, one owner slot per possible fd
+        fd_owner_size = this->max_fds;
+#if defined(__linux__) || defined(__linux)
+        struct rlimit rl;
+        if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur != RLIM_INFINITY)
+            fd_owner_size = static_cast<std::size_t>(rl.rlim_cur);
 #endif
+        fd_owner.reset(new std::atomic<std::uint32_t>[fd_owner_size]);
+        for (std::size_t fd = 0; fd < fd_owner_size; ++fd)
+            fd_owner[fd].store(0, std::memory_order_relaxed);
+    }
+
+    if (backend == io_backend::io_uring) {
+#if CPPRESS_HAS_IO_URING
+        // All reactors or none, so each connection is served the same way
+        bool ready = true;
+        for (auto& r : reactors) {
+            r->ring = io_uring_ring::create(4096, 256, 16 * 1024);
+            ready = ready && r->ring;
+        }
+        if (ready) {
+            this->backend = io_backend::io_uring;
+        } else {
+            for (auto& r : reactors)
+                r->ring.reset();
+        }
+#endif
+        if (this->backend != io_backend::io_uring)
+            std::cerr << "io_uring is not available, falling back to epoll" << std::endl;
+    }
 }
 
+/**
+ * Startup Steps:
+ * 1. Reactors without their own listener share the first registered one
+ *    with EPOLLEXCLUSIVE, so a wakeup reaches a single reactor (io_uring:
+ *    each reactor queues its own multishot accept on it)
+ * 2. Reactors 1..N-1 run on dedicated threads, reactor 0 on the caller
+ * 3. All reactor threads are joined before on_shutdown_success()
+ */
 void epoll_server::listen(int timeout) {
-    epoll_loop(timeout);
+    std::shared_ptr<socket> shared_listener;
+    for (const auto& r : reactors) {
+        if (r->listener_socket) {
+            shared_listener = r->listener_socket;
+            break;
+        }
+    }
+    if (shared_listener) {
+        for (auto& r : reactors) {
+            if (r->listener_socket)
+                continue;
+            r->listener_socket = shared_listener;
+            r->owns_listener = false;
+            if (backend == io_backend::epoll)
+                add_epoll(*r, shared_listener->native_handle(), EPOLLIN | EPOLLEXCLUSIVE);
+        }
+    }
+
+    steer_listeners();
+    on_listen_success();
+
+    auto run = [this, timeout](epoll_reactor& r) {
+#if CPPRESS_HAS_IO_URING
+        if (r.ring) {
+            uring_loop(r, timeout);
+            return;
+        }
+#endif
+        epoll_loop(r, timeout);
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(reactors.size() - 1);
+    for (std::size_t i = 1; i < reactors.size(); ++i) {
+        threads.emplace_back([this, i, run]() {
+            if (pin_reactors || !reactor_cpus.empty())
+                pin_current_thread(i);
+            run(*reactors[i]);
+        });
+    }
+    if (pin_reactors || !reactor_cpus.empty())
+        pin_current_thread(0);
+    run(*reactors[0]);
+    for (auto& t : threads)
+        t.join();
+
+    on_shutdown_success();
 }
 
 /**
@@ -554,52 +1359,135 @@ void epoll_server::listen(int timeout) {
  * - Socket should be configured with desired options
  *
  * Registration Process:
- * 1. Store socket reference internally
- * 2. Extract socket file descriptor
- * 3. Add socket to epoll monitoring with EPOLLIN | EPOLLET
+ * 1. Pick the first reactor that has no listener yet
+ * 2. Store socket reference in that reactor
+ * 3. Add socket to its epoll monitoring with EPOLLIN | EPOLLET
  * 4. Return success/failure status
  *
  * @note Uses edge-triggered mode for maximum performance
- * @note Only one listening socket supported per server instance
+ * @note Returns false once every reactor already has a listener
  */
 bool epoll_server::register_listener_socket(std::shared_ptr<socket> sock_ptr) {
-    listener_socket = sock_ptr;
-    int lfd = sock_ptr->native_handle();
-    if (add_epoll(lfd, EPOLLIN | EPOLLET) != 0) {
-        return false;
+    for (auto& r : reactors) {
+        if (r->listener_socket)
+            continue;
+        int lfd = sock_ptr->native_handle();
+        if (add_epoll(*r, lfd, EPOLLIN | EPOLLET) != 0) {
+            return false;
+        }
+        r->listener_socket = sock_ptr;
+        r->owns_listener = true;
+        return true;
     }
-    return true;
+    return false;
 }
 
 /**
 
- * Sets the stop flag that will cause the main event loop to exit cleanly.
+ * Sets the stop flag that will cause every reactor loop to exit cleanly.
  * The server will finish processing current events before shutting down,
  * ensuring graceful closure of all connections.
 
  */
 void epoll_server::shutdown() {
-    g_stop = 1;
+    g_stop = true;
+    // Loops may sleep until their next deadline, wake them up to observe g_stop
+    for (auto& r : reactors) {
+        if (r->wake_fd != -1) {
+#if defined(__linux__) || defined(__linux)
+            uint64_t one = 1;
+            [[maybe_unused]] auto written = ::write(r->wake_fd, &one, sizeof(one));
+#endif
+        }
+    }
 }
 
 /**
+ * Implementation Notes:
+ * - Each reactor runs its own rounds as loop timers, the connection tables
+ *   are only walked by their owning threads
+ * - The last reactor left without accepted connections shuts the server
+ *   down; past the deadline, any of them does
+ */
+void epoll_server::drain(std::chrono::milliseconds timeout) {
+    if (draining.exchange(true))
+        return;
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    draining_reactors.store(reactors.size());
+    for (auto& r : reactors) {
+        epoll_reactor* loop = r.get();
+        reactor_command cmd;
+        cmd.type = reactor_command::kind::timer;
+        cmd.callback = [this, loop, deadline]() {
+            stop_accepting(*loop);
+            drain_step(*loop, deadline);
+        };
+        deliver_command(*loop, std::move(cmd));
+    }
+}
 
- * Cleanup Order:
+void epoll_server::drain_step(epoll_reactor& r, std::chrono::steady_clock::time_point deadline) {
+    std::size_t open = 0;
+    r.conns.for_each([this, &r, &open](int fd, epoll_connection& c) {
+        if (!c.upstream.empty() || !c.conn)
+            return;
+        ++open;
+        if (c.close_after_flush || !connection_idle(c.conn))
+            return;
+        c.want_close = true;
+        c.close_after_flush = true;
+        if (!c.pending_flush) {
+            c.pending_flush = true;
+            r.pending_flush.push_back(fd);
+        }
+    });
+    if (std::chrono::steady_clock::now() >= deadline) {
+        shutdown();
+        return;
+    }
+    if (open == 0) {
+        if (draining_reactors.fetch_sub(1) == 1)
+            shutdown();
+        return;
+    }
+    run_after(std::chrono::milliseconds(50), [this, &r, deadline]() { drain_step(r, deadline); });
+}
+
+/**
+
+ * Cleanup Order (per reactor):
  * 1. Close all active client connections
- * 2. Close listener socket if present
+ * 2. Close listener socket if owned by the reactor
  * 3. Close epoll file descriptor
+ * 4. io_uring: tear the ring down, then free the operations it still held
  */
 epoll_server::~epoll_server() {
-    for (auto& [fd, _] : conns)
-        close_socket(fd);
-    if (listener_socket)
-        close_socket(listener_socket->native_handle());
+    for (auto& r : reactors) {
+#if CPPRESS_HAS_IO_URING
+        r->ring.reset();
+#endif
+        for (uring_op* op : r->uring_ops)
+            delete op;
+        r->uring_ops.clear();
+        r->conns.for_each([](int fd, epoll_connection& c) {
+            if (c.conn)
+                c.conn->close();
+            else
+                close_socket(fd);
+        });
+        if (r->listener_socket && r->owns_listener)
+            close_socket(r->listener_socket->native_handle());
 #if defined(_WIN32) || defined(_WIN64) || defined(__CYGWIN__)
-    // hell nothing;
+        // hell nothing;
 #else
-    if (epoll_fd != -1)
-        close_socket(epoll_fd);
+        if (r->wake_fd != -1)
+            ::close(r->wake_fd);
+        if (r->reserve_fd != -1)
+            ::close(r->reserve_fd);
+        if (r->epoll_fd != -1)
+            close_socket(r->epoll_fd);
 #endif
+    }
 }
 }  // namespace cppress::sockets
 
@@ -0,0 +1,216 @@
+/**
+ * @file epoll_server_client.cpp
+ * @brief Outbound connections of epoll_server
+ *
+ * Connections opened with connect_async() live in the same connection table
+ * and event loop as accepted ones, so they share the output chain, the
+ * backpressure and the timer wheel. They differ in three ways:
+ * - Their events go to the client_handlers given at connect time, never to
+ *   the server's on_message_received() / on_connection_closed()
+ * - The handshake is bounded by the connect deadline
+ * - Released connections wait in a per-reactor pool keyed by upstream
+ *   address, and are handed to the next connect_async() to that upstream
+ */
+
+#include "../includes/epoll_server.hpp"
+
+#include <errno.h>
+
+#if defined(__linux__) || defined(__linux)
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace cppress::sockets {
+
+namespace {
+/// Reports the outcome of a connect to its handlers, exceptions included
+template <typename OnError>
+void notify_connect(const std::shared_ptr<client_handlers>& client,
+                    std::shared_ptr<connection> conn, int error, OnError&& on_error) {
+    if (!client || !client->on_connect)
+        return;
+    try {
+        client->on_connect(std::move(conn), error);
+    } catch (const std::exception& e) {
+        on_error(e);
+    }
+}
+}  // namespace
+
+void epoll_server::connect_async(const socket_address& upstream, client_handlers handlers,
+                                 std::chrono::milliseconds timeout) {
+    reactor_command cmd;
+    cmd.type = reactor_command::kind::connect;
+    cmd.upstream = upstream;
+    cmd.client = std::make_shared<client_handlers>(std::move(handlers));
+    cmd.delay = timeout;
+    // Stay on the calling loop if it is one of ours
+    for (auto& r : reactors) {
+        if (r.get() == current_reactor) {
+            deliver_command(*r, std::move(cmd));
+            return;
+        }
+    }
+    std::size_t next = next_client_reactor.fetch_add(1, std::memory_order_relaxed);
+    deliver_command(*reactors[next % reactors.size()], std::move(cmd));
+}
+
+void epoll_server::release_connection(std::shared_ptr<connection> conn) {
+    reactor_command cmd;
+    cmd.type = reactor_command::kind::release;
+    cmd.fd = conn->native_handle();
+    cmd.conn = std::move(conn);
+    dispatch_command(std::move(cmd));
+}
+
+/**
+ * Connect Steps:
+ * 1. Reuse the most recently released idle connection to the upstream,
+ *    skipping entries whose connection closed meanwhile
+ * 2. Otherwise open a non-blocking socket and start connect(); the
+ *    handshake completes when the socket reports writable
+ * 3. Arm the connect deadline
+ */
+void epoll_server::start_connect(epoll_reactor& r, reactor_command& cmd) {
+    auto on_error = [this](const std::exception& e) { on_exception_occurred(e); };
+    std::string key = cmd.upstream.to_string();
+
+    auto pooled = r.idle_upstreams.find(key);
+    while (pooled != r.idle_upstreams.end() && !pooled->second.empty()) {
+        auto entry = pooled->second.back();
+        pooled->second.pop_back();
+        epoll_connection* c = r.conns.find(entry.first, entry.second);
+        if (!c || c->client || c->want_close)
+            continue;
+        c->client = cmd.client;
+        r.timers.cancel(c->deadlines[static_cast<int>(connection_deadline::idle)]);
+        touch_idle(r, *c);
+        notify_connect(c->client, c->conn, 0, on_error);
+        return;
+    }
+
+#if defined(__linux__) || defined(__linux)
+    int fd = ::socket(cmd.upstream.family().value(), SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        notify_connect(cmd.client, nullptr, errno, on_error);
+        return;
+    }
+    if (accepted_options.tcp_nodelay) {
+        int one = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    if (::connect(fd, cmd.upstream.data(), cmd.upstream.size()) != 0 && errno != EINPROGRESS) {
+        int error = errno;
+        ::close(fd);
+        notify_connect(cmd.client, nullptr, error, on_error);
+        return;
+    }
+
+    epoll_connection* c = nullptr;
+    try {
+        sockaddr_storage local{};
+        socklen_t len = sizeof(local);
+        ::getsockname(fd, reinterpret_cast<sockaddr*>(&local), &len);
+        c = &register_conn(
+            r, fd,
+            std::make_shared<connection>(file_descriptor(fd), socket_address(local), cmd.upstream));
+    } catch (const std::exception& e) {
+        ::close(fd);
+        on_exception_occurred(e);
+        notify_connect(cmd.client, nullptr, EMFILE, on_error);
+        return;
+    }
+    c->upstream = std::move(key);
+    c->client = cmd.client;
+    c->connecting = true;
+    r.timers.arm(c->deadlines[static_cast<int>(connection_deadline::connect)], cmd.delay);
+
+#if CPPRESS_HAS_IO_URING
+    if (r.ring) {
+        c->send_op = uring_submit(r, uring_op::kind::poll_out, fd, r.conns.generation(fd));
+        return;
+    }
+#endif
+    if (add_epoll(r, fd, EPOLLIN | EPOLLOUT | EPOLLET) != 0)
+        fail_connect(r, fd, *c, errno);
+#else
+    notify_connect(cmd.client, nullptr, ENOTSUP, on_error);
+#endif
+}
+
+/**
+ * Implementation Notes:
+ * - SO_ERROR tells a completed handshake from a refused or unreachable one;
+ *   a hang-up without an error is reported as a reset
+ * - Interest drops EPOLLOUT again, output is flushed on demand as for
+ *   accepted connections (io_uring: the multishot receive is armed now)
+ */
+void epoll_server::finish_connect(epoll_reactor& r, int fd, epoll_connection& c) {
+    int error = 0;
+    socklen_t len = sizeof(error);
+    if (::getsockopt(fd, SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&error), &len) != 0)
+        error = errno;
+    if (error == 0) {
+        // Writable without error but the peer already hung up
+        char probe;
+        if (::recv(fd, &probe, 1, MSG_PEEK | MSG_DONTWAIT) == 0)
+            error = ECONNRESET;
+    }
+    if (error != 0) {
+        fail_connect(r, fd, c, error);
+        return;
+    }
+
+    c.connecting = false;
+    r.timers.cancel(c.deadlines[static_cast<int>(connection_deadline::connect)]);
+#if CPPRESS_HAS_IO_URING
+    if (r.ring)
+        c.recv_op = uring_submit(r, uring_op::kind::recv, fd, r.conns.generation(fd));
+    else
+#endif
+        mod_epoll(r, fd, interest(c));
+    touch_idle(r, c);
+
+    auto client = c.client;
+    notify_connect(client, c.conn, 0,
+                   [this](const std::exception& e) { on_exception_occurred(e); });
+}
+
+void epoll_server::fail_connect(epoll_reactor& r, int fd, epoll_connection& c, int error) {
+    auto client = std::move(c.client);
+    close_conn(r, fd);
+    notify_connect(client, nullptr, error,
+                   [this](const std::exception& e) { on_exception_occurred(e); });
+}
+
+/**
+ * Pooling Rules:
+ * - Connections still connecting, closing, or released twice are not pooled
+ * - Beyond the per-upstream limit the oldest idle connection is closed
+ * - Pooled connections are closed after the pool's idle timeout
+ */
+void epoll_server::release_to_pool(epoll_reactor& r, int fd, epoll_connection& c) {
+    if (c.upstream.empty() || !c.client || c.connecting || c.want_close)
+        return;
+    c.client.reset();
+    if (upstream_max_idle == 0) {
+        close_later(r, fd, c);
+        return;
+    }
+    auto& idle = r.idle_upstreams[c.upstream];
+    idle.emplace_back(fd, r.conns.generation(fd));
+    while (idle.size() > upstream_max_idle) {
+        auto oldest = idle.front();
+        idle.pop_front();
+        if (epoll_connection* old = r.conns.find(oldest.first, oldest.second))
+            if (!old->client)
+                close_later(r, oldest.first, *old);
+    }
+    for (auto& timer : c.deadlines)
+        r.timers.cancel(timer);
+    r.timers.arm(c.deadlines[static_cast<int>(connection_deadline::idle)], upstream_idle_timeout);
+}
+}  // namespace cppress::sockets
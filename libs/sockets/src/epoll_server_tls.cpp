@@ -0,0 +1,89 @@
+/**
+ * @file epoll_server_tls.cpp
+ * @brief TLS termination of epoll_server
+ *
+ * An accepted connection with a handshaker is owned by it until the
+ * handshake completes: the loop only waits for the readiness it asks for
+ * and calls step(). Afterwards the handshaker moves the session keys into
+ * the kernel and is dropped, and the connection joins the plaintext paths
+ * (recv into pooled chunks, writev, sendfile) unchanged.
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include <stdexcept>
+
+#include "../includes/epoll_server.hpp"
+
+namespace cppress::sockets {
+
+void epoll_server::set_tls(tls_handshaker_factory factory) {
+    if (factory && backend == io_backend::io_uring)
+        throw std::logic_error("TLS termination requires the epoll backend");
+    tls_factory = std::move(factory);
+}
+
+void epoll_server::start_tls(epoll_reactor& r, int fd, epoll_connection& c) {
+    try {
+        c.tls = tls_factory(fd);
+    } catch (const std::exception& e) {
+        on_exception_occurred(e);
+        close_conn(r, fd);
+        return;
+    }
+    if (c.tls)
+        advance_tls(r, fd, c);  // the ClientHello may already be waiting
+}
+
+/**
+ * Implementation Notes:
+ * - Interest follows the direction the handshaker waits for, edge-triggered
+ *   like every connection, so step() must drain until EAGAIN
+ * - Records that arrived along with the final flight sit in the socket and
+ *   are decrypted by the kernel on the first read
+ * - Output queued during the handshake is flushed by the next pass
+ */
+void epoll_server::advance_tls(epoll_reactor& r, int fd, epoll_connection& c) {
+    tls_handshaker::status step = tls_handshaker::status::failed;
+    try {
+        step = c.tls->step(fd);
+    } catch (const std::exception& e) {
+        on_exception_occurred(e);
+    }
+    switch (step) {
+        case tls_handshaker::status::want_read:
+            mod_epoll(r, fd, EPOLLIN | EPOLLET);
+            return;
+        case tls_handshaker::status::want_write:
+            mod_epoll(r, fd, EPOLLIN | EPOLLOUT | EPOLLET);
+            return;
+        case tls_handshaker::status::failed:
+            close_conn(r, fd);
+            return;
+        case tls_handshaker::status::done:
+            break;
+    }
+
+    if (int error = c.tls->enable_kernel_tls(fd)) {
+        on_exception_occurred(
+            std::runtime_error("Kernel TLS setup failed: " + std::string(strerror(error))));
+        close_conn(r, fd);
+        return;
+    }
+    std::string early = c.tls->take_pending_plaintext();
+    c.tls.reset();
+    c.outq.disable_zerocopy();
+    mod_epoll(r, fd, interest(c));
+    touch_idle(r, c);
+    if (!c.outq.empty() || c.close_after_flush) {
+        if (!c.pending_flush) {
+            c.pending_flush = true;
+            r.pending_flush.push_back(fd);
+        }
+    }
+    if (!early.empty())
+        deliver(r, fd, c, data_buffer(std::move(early)));
+    try_read(r, c);
+}
+}  // namespace cppress::sockets
@@ -0,0 +1,319 @@
+/**
+ * @file epoll_server_uring.cpp
+ * @brief io_uring backend of epoll_server
+ *
+ * Completion-based counterpart of epoll_loop(). Connection state, commands,
+ * deadlines and callbacks are shared with the epoll backend; only the way
+ * bytes move differs:
+ * - One multishot accept per reactor listener, cancelled while the server
+ *   is at its connection cap
+ * - One multishot receive per connection, into the ring's provided buffers
+ * - Memory segments are sent with asynchronous sendmsg, one op in flight per
+ *   connection; file segments reuse the synchronous sendfile path
+ */
+
+#include "../includes/epoll_server.hpp"
+
+#if CPPRESS_HAS_IO_URING
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <iostream>
+
+namespace cppress::sockets {
+
+uring_op* epoll_server::uring_submit(epoll_reactor& r, uring_op::kind type, int fd,
+                                     std::uint32_t generation) {
+    auto* op = new uring_op();
+    op->type = type;
+    op->fd = fd;
+    op->generation = generation;
+    r.uring_ops.insert(op);
+    uring_arm(r, op);
+    return op;
+}
+
+/**
+ * Operation Setup:
+ * - accept: multishot, accepted sockets are non-blocking and close-on-exec
+ * - wake: multishot POLLIN on the reactor eventfd
+ * - recv: multishot, the kernel picks a buffer from the provided ring
+ * - send: sendmsg over op->iov, MSG_NOSIGNAL so a closed peer yields EPIPE
+ * - poll_out: one-shot POLLOUT, waits for room before a synchronous flush
+ */
+void epoll_server::uring_arm(epoll_reactor& r, uring_op* op) {
+    io_uring_sqe* sqe = r.ring->get_sqe(op);
+    if (!sqe)
+        throw std::runtime_error("io_uring submission queue is full");
+    sqe->fd = op->fd;
+    switch (op->type) {
+        case uring_op::kind::accept:
+            sqe->opcode = IORING_OP_ACCEPT;
+            sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+            sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+            break;
+        case uring_op::kind::wake:
+            sqe->opcode = IORING_OP_POLL_ADD;
+            sqe->poll32_events = POLLIN;
+            sqe->len = IORING_POLL_ADD_MULTI;
+            break;
+        case uring_op::kind::recv:
+            sqe->opcode = IORING_OP_RECV;
+            sqe->ioprio = IORING_RECV_MULTISHOT;
+            sqe->flags = IOSQE_BUFFER_SELECT;
+            sqe->buf_group = io_uring_ring::buffer_group;
+            break;
+        case uring_op::kind::send:
+            op->msg = msghdr{};
+            op->msg.msg_iov = op->iov.data();
+            op->msg.msg_iovlen = op->iov.size();
+            sqe->opcode = IORING_OP_SENDMSG;
+            sqe->addr = reinterpret_cast<std::uint64_t>(&op->msg);
+            sqe->len = 1;
+            sqe->msg_flags = MSG_NOSIGNAL;
+            break;
+        case uring_op::kind::poll_out:
+            sqe->opcode = IORING_OP_POLL_ADD;
+            sqe->poll32_events = POLLOUT;
+            break;
+    }
+}
+
+void epoll_server::uring_release(epoll_reactor& r, uring_op* op) {
+    r.uring_ops.erase(op);
+    delete op;
+}
+
+/**
+ * Flow Control:
+ * - At most one send per connection is in flight, output queued meanwhile
+ *   goes out with the next one
+ * - Everything flushed: close if a close is pending
+ * - A file segment at the front is flushed synchronously; when the socket
+ *   buffer is full a POLLOUT wait resumes it
+ */
+bool epoll_server::uring_service_writes(epoll_reactor& r, int fd, epoll_connection& c) {
+    update_backpressure(r, fd, c);
+    if (c.send_op)
+        return true;  // Resumed by the completion
+    if (!c.outq.empty())
+        touch_idle(r, c);
+    if (c.outq.empty()) {
+        if (c.close_after_flush) {
+            close_conn(r, fd);
+            return false;
+        }
+        return true;
+    }
+
+    if (c.outq.front_is_file()) {
+        auto result = flush_writes(r, c);
+        if (result == output_chain::flush_result::error) {
+            close_conn(r, fd);
+            return false;
+        }
+        if (result == output_chain::flush_result::would_block) {
+            c.send_op = uring_submit(r, uring_op::kind::poll_out, fd, r.conns.generation(fd));
+            return true;
+        }
+        if (c.close_after_flush) {
+            close_conn(r, fd);
+            return false;
+        }
+        return true;
+    }
+
+#ifdef IOV_MAX
+    constexpr std::size_t max_iov = IOV_MAX;
+#else
+    constexpr std::size_t max_iov = 1024;
+#endif
+    auto* op = new uring_op();
+    op->type = uring_op::kind::send;
+    op->fd = fd;
+    op->generation = r.conns.generation(fd);
+    c.outq.gather(op->iov, op->pinned, max_iov);
+    r.uring_ops.insert(op);
+    uring_arm(r, op);
+    c.send_op = op;
+    return true;
+}
+
+/**
+ * Completion Handling:
+ * - Operations whose connection was closed (or whose fd was reused) are
+ *   stale: provided buffers are recycled and the op is freed once the
+ *   kernel reports no further completions for it (no IORING_CQE_F_MORE)
+ * - Multishot operations that terminate without an error are re-armed
+ * - Received bytes are copied from the provided buffer into the reactor's
+ *   receive chunk, so the callback gets the same refcounted slice as with
+ *   epoll and the provided buffer goes straight back to the kernel
+ */
+void epoll_server::uring_complete(epoll_reactor& r, const io_uring_cqe& cqe) {
+    auto* op = reinterpret_cast<uring_op*>(cqe.user_data);
+    if (!op)
+        return;  // Cancellation request
+    bool more = (cqe.flags & IORING_CQE_F_MORE) != 0;
+
+    try {
+        if (op->type == uring_op::kind::accept) {
+            if (!more)
+                r.accept_armed = false;
+            if (cqe.res >= 0 && r.accept_paused) {
+                close_socket(cqe.res);  // Accepted before the cancellation took effect
+            } else if (cqe.res >= 0) {
+                r.counters.on_accept();
+                sockaddr_storage client_addr{};
+                socklen_t len = sizeof(client_addr);
+                ::getpeername(cqe.res, reinterpret_cast<sockaddr*>(&client_addr), &len);
+                auto& c = open_conn(r, cqe.res, client_addr);
+                c.recv_op =
+                    uring_submit(r, uring_op::kind::recv, cqe.res, r.conns.generation(cqe.res));
+                on_connection_opened(c.conn);
+                if (at_connection_cap())
+                    pause_accept(r);
+            } else if (cqe.res != -ECANCELED) {
+                r.counters.on_accept_failure();
+                if (cqe.res == -EMFILE || cqe.res == -ENFILE)
+                    shed_connection(r);
+            }
+            if (!more && !g_stop && !r.accept_paused) {
+                uring_arm(r, op);
+                r.accept_armed = true;
+            }
+            return;
+        }
+
+        if (op->type == uring_op::kind::wake) {
+            uint64_t counter;
+            while (::read(r.wake_fd, &counter, sizeof(counter)) > 0) {
+            }
+            if (!more)
+                uring_arm(r, op);
+            return;
+        }
+
+        epoll_connection* c = r.conns.find(op->fd, op->generation);
+
+        if (op->type == uring_op::kind::recv) {
+            if (cqe.res > 0 && (cqe.flags & IORING_CQE_F_BUFFER)) {
+                auto id = static_cast<unsigned short>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+                if (c && !c->want_close) {
+                    auto n = static_cast<std::size_t>(cqe.res);
+                    r.counters.on_read(n);
+                    std::memcpy(r.rx.prepare(n), r.ring->buffer(id), n);
+                    r.ring->recycle_buffer(id);
+                    touch_idle(r, *c);
+                    deliver(r, op->fd, *c, r.rx.commit(n));
+                } else {
+                    r.ring->recycle_buffer(id);
+                }
+            }
+            if (more)
+                return;
+            // Buffers ran out, the kernel ended the multishot, or reads resumed
+            // before a backpressure cancellation completed
+            bool ended = cqe.res > 0 || cqe.res == -ENOBUFS || cqe.res == -ECANCELED;
+            if (c && ended && !c->reads_paused) {
+                uring_arm(r, op);
+                return;
+            }
+            if (c) {
+                c->recv_op = nullptr;
+                if (!ended)
+                    close_conn(r, op->fd);  // Peer closed (0) or receive error
+            }
+            uring_release(r, op);
+            return;
+        }
+
+        // send or poll_out
+        if (c)
+            c->send_op = nullptr;
+        int fd = op->fd;
+        int res = cqe.res;
+        bool was_send = op->type == uring_op::kind::send;
+        uring_release(r, op);
+        if (!c)
+            return;
+        if (c->connecting) {
+            finish_connect(r, fd, *c);
+            return;
+        }
+        if (res < 0) {
+            close_conn(r, fd);
+            return;
+        }
+        if (was_send) {
+            c->outq.consume(static_cast<std::size_t>(res));
+            r.counters.on_written(static_cast<std::size_t>(res));
+        }
+        uring_service_writes(r, fd, *c);
+    } catch (const std::exception& e) {
+        on_exception_occurred(e);
+    }
+}
+
+/**
+ * Event Loop Algorithm:
+ * 1. Queue the multishot accept and the eventfd poll
+ * 2. Submit everything queued and wait for completions in one io_uring_enter,
+ *    bounded by the next connection deadline
+ * 3. Expire deadlines, then handle every completion
+ * 4. Apply cross-thread commands and flush touched connections
+ * 5. Repeat until stop signal
+ */
+void epoll_server::uring_loop(epoll_reactor& r, int timeout) {
+    current_reactor = &r;
+    try {
+        if (r.listener_socket) {
+            r.accept_op =
+                uring_submit(r, uring_op::kind::accept, r.listener_socket->native_handle(), 0);
+            r.accept_armed = true;
+        }
+        uring_submit(r, uring_op::kind::wake, r.wake_fd, 0);
+    } catch (const std::exception& e) {
+        on_exception_occurred(e);
+        current_reactor = nullptr;
+        return;
+    }
+
+    while (!g_stop)
+        try {
+            on_waiting_for_activity();
+            int wait = r.timers.next_timeout(timer_wheel::clock::now(), timeout);
+            if (r.accept_paused && (wait < 0 || wait > 100))
+                wait = 100;  // Closes on other reactors do not wake this one
+            auto waiting = std::chrono::steady_clock::now();
+            int rc = r.ring->submit_and_wait(wait);
+            auto woke = std::chrono::steady_clock::now();
+            expire_deadlines(r);
+            if (rc < 0) {
+                on_exception_occurred(
+                    std::runtime_error("io_uring_enter failed: " + std::string(strerror(-rc))));
+                break;
+            }
+            std::size_t completions = 0;
+            r.ring->for_each_cqe([this, &r, &completions](const io_uring_cqe& cqe) {
+                ++completions;
+                uring_complete(r, cqe);
+            });
+            r.counters.on_wakeup(completions, elapsed_ns(waiting, woke));
+            drain_commands(r);
+            if (r.accept_paused)
+                resume_accept(r);
+            r.counters.on_handlers(elapsed_ns(woke, std::chrono::steady_clock::now()));
+        } catch (const std::exception& e) {
+            std::cerr << "UNKNOWN ERROR CAUGHT BY EVENT LOOP: " << e.what() << std::endl;
+            on_exception_occurred(e);
+        }
+    current_reactor = nullptr;
+}
+}  // namespace cppress::sockets
+
+#endif
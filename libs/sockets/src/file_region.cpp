@@ -0,0 +1,98 @@
+/**
+ * @file file_region.cpp
+ * @brief Implementation of file_region
+ */
+
+#include "../includes/file_region.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <stdexcept>
+
+#include "../includes/exceptions.hpp"
+#include "../includes/utilities.hpp"
+
+#if defined(_WIN32) || defined(_WIN64) || defined(__CYGWIN__)
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace cppress::sockets {
+
+namespace {
+void close_file(const int* fd) {
+#if defined(_WIN32) || defined(_WIN64) || defined(__CYGWIN__)
+    ::_close(*fd);
+#else
+    ::close(*fd);
+#endif
+    delete fd;
+}
+}  // namespace
+
+file_region::file_region(int native_fd, std::uint64_t offset, std::size_t size,
+                         bool take_ownership)
+    : first(offset), length(size) {
+    if (take_ownership)
+        fd = std::shared_ptr<const int>(new int(native_fd), close_file);
+    else
+        fd = std::make_shared<const int>(native_fd);
+}
+
+file_region file_region::open(const std::string& path) {
+#if defined(_WIN32) || defined(_WIN64) || defined(__CYGWIN__)
+    int native_fd = ::_open(path.c_str(), _O_RDONLY | _O_BINARY);
+    struct _stati64 st;
+    bool ok = native_fd >= 0 && ::_fstati64(native_fd, &st) == 0;
+#else
+    int native_fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    bool ok = native_fd >= 0 && ::fstat(native_fd, &st) == 0 && S_ISREG(st.st_mode);
+#endif
+    if (!ok) {
+        std::string reason = get_error_message();
+        if (native_fd >= 0)
+            close_file(new int(native_fd));
+        throw socket_exception("Failed to open file region '" + path + "': " + reason,
+                               "FileRegion", __func__);
+    }
+    return file_region(native_fd, 0, static_cast<std::size_t>(st.st_size));
+}
+
+file_region file_region::slice(std::size_t pos, std::size_t len) const {
+    if (pos > length)
+        throw std::out_of_range("file_region::slice position out of range");
+    file_region out = *this;
+    out.first += pos;
+    out.length = std::min(len, length - pos);
+    return out;
+}
+std::string file_region::read() const {
+    std::string out(length, '\0');
+    std::size_t done = 0;
+    while (done < length) {
+        std::size_t want = std::min<std::size_t>(length - done, 1u << 30);
+#if defined(_WIN32) || defined(_WIN64) || defined(__CYGWIN__)
+        int got = -1;
+        if (::_lseeki64(native_handle(), (long long)(first + done), SEEK_SET) >= 0)
+            got = ::_read(native_handle(), &out[done], (unsigned)want);
+#else
+        ssize_t got = ::pread(native_handle(), &out[done], want, static_cast<off_t>(first + done));
+        if (got < 0 && errno == EINTR)
+            continue;
+#endif
+        if (got <= 0)
+            throw socket_exception("Failed to read file region: " +
+                                       (got == 0 ? std::string("unexpected end of file")
+                                                 : get_error_message()),
+                                   "FileRegion", __func__);
+        done += static_cast<std::size_t>(got);
+    }
+    return out;
+}
+}  // namespace cppress::sockets
@@ -0,0 +1,210 @@
+/**
+ * @file io_uring_ring.cpp
+ * @brief Raw system call implementation of io_uring_ring
+ */
+
+#include "../includes/io_uring_ring.hpp"
+
+#if CPPRESS_HAS_IO_URING
+
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace cppress::sockets {
+
+namespace {
+int sys_setup(unsigned entries, io_uring_params* p) {
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, p));
+}
+
+int sys_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags, void* arg,
+              std::size_t arg_len) {
+    return static_cast<int>(
+        ::syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, arg_len));
+}
+
+int sys_register(int fd, unsigned opcode, void* arg, unsigned nr_args) {
+    return static_cast<int>(::syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+}  // namespace
+
+/**
+ * Setup Steps:
+ * 1. io_uring_setup, with cooperative task running when the kernel has it
+ * 2. Map the SQ/CQ rings (one mapping with IORING_FEAT_SINGLE_MMAP) and the SQE array
+ * 3. Register a ring of provided buffers for multishot receive
+ *
+ * Any failure, including a missing feature, yields nullptr so the caller
+ * can fall back to epoll.
+ */
+std::unique_ptr<io_uring_ring> io_uring_ring::create(unsigned entries, unsigned buffers,
+                                                     unsigned buffer_size) {
+    std::unique_ptr<io_uring_ring> ring(new io_uring_ring());
+
+    io_uring_params p;
+    std::memset(&p, 0, sizeof(p));
+    p.flags = IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN;
+    ring->ring_fd = sys_setup(entries, &p);
+    if (ring->ring_fd < 0) {
+        std::memset(&p, 0, sizeof(p));
+        ring->ring_fd = sys_setup(entries, &p);
+    }
+    if (ring->ring_fd < 0)
+        return nullptr;
+    ring->features = p.features;
+    if (!(p.features & IORING_FEAT_EXT_ARG) || !(p.features & IORING_FEAT_NODROP))
+        return nullptr;
+
+    ring->sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    ring->cq_len = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+        ring->sq_len = ring->cq_len = std::max(ring->sq_len, ring->cq_len);
+
+    ring->sq_ptr = ::mmap(nullptr, ring->sq_len, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, ring->ring_fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ptr == MAP_FAILED) {
+        ring->sq_ptr = nullptr;
+        return nullptr;
+    }
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cq_ptr = ring->sq_ptr;
+    } else {
+        ring->cq_ptr = ::mmap(nullptr, ring->cq_len, PROT_READ | PROT_WRITE,
+                              MAP_SHARED | MAP_POPULATE, ring->ring_fd, IORING_OFF_CQ_RING);
+        if (ring->cq_ptr == MAP_FAILED) {
+            ring->cq_ptr = nullptr;
+            return nullptr;
+        }
+    }
+    ring->sqes_len = p.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = ::mmap(nullptr, ring->sqes_len, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, ring->ring_fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED)
+        return nullptr;
+    ring->sqes = static_cast<io_uring_sqe*>(sqes);
+
+    char* sq = static_cast<char*>(ring->sq_ptr);
+    ring->sq_head = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+    ring->sq_tail = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+    ring->sq_array = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+    ring->sq_mask = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+    ring->sq_entries = p.sq_entries;
+    ring->sqe_tail = *ring->sq_tail;
+
+    char* cq = static_cast<char*>(ring->cq_ptr);
+    ring->cq_head = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+    ring->cq_tail = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+    ring->cqes = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+    ring->cq_mask = *reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+
+    // Provided buffer ring (Linux 5.19+)
+    ring->buf_count = buffers;
+    ring->buf_size = buffer_size;
+    ring->buf_ring_len = buffers * sizeof(io_uring_buf);
+    void* br = ::mmap(nullptr, ring->buf_ring_len, PROT_READ | PROT_WRITE,
+                      MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    if (br == MAP_FAILED)
+        return nullptr;
+    ring->buf_ring = static_cast<io_uring_buf_ring*>(br);
+    io_uring_buf_reg reg;
+    std::memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = reinterpret_cast<std::uint64_t>(br);
+    reg.ring_entries = buffers;
+    reg.bgid = buffer_group;
+    if (sys_register(ring->ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) != 0)
+        return nullptr;
+
+    ring->buf_memory.reset(new char[std::size_t(buffers) * buffer_size]);
+    for (unsigned i = 0; i < buffers; ++i)
+        ring->recycle_buffer(static_cast<unsigned short>(i));
+    return ring;
+}
+
+io_uring_ring::~io_uring_ring() {
+    if (buf_ring)
+        ::munmap(buf_ring, buf_ring_len);
+    if (sqes)
+        ::munmap(sqes, sqes_len);
+    if (cq_ptr && cq_ptr != sq_ptr)
+        ::munmap(cq_ptr, cq_len);
+    if (sq_ptr)
+        ::munmap(sq_ptr, sq_len);
+    if (ring_fd >= 0)
+        ::close(ring_fd);
+}
+
+io_uring_sqe* io_uring_ring::get_sqe(uring_op* op) {
+    unsigned head = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+    if (sqe_tail - head >= sq_entries) {
+        enter(0, -1);
+        head = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+        if (sqe_tail - head >= sq_entries)
+            return nullptr;
+    }
+    unsigned index = sqe_tail & sq_mask;
+    io_uring_sqe* sqe = &sqes[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqe->user_data = reinterpret_cast<std::uint64_t>(op);
+    sq_array[index] = index;
+    ++sqe_tail;
+    return sqe;
+}
+
+/**
+ * Implementation Notes:
+ * - One io_uring_enter both submits everything queued since the last call
+ *   and waits, with the timeout passed through IORING_ENTER_EXT_ARG
+ */
+int io_uring_ring::enter(unsigned wait_nr, int timeout_ms) {
+    unsigned submitted = *sq_tail;
+    unsigned to_submit = sqe_tail - submitted;
+    __atomic_store_n(sq_tail, sqe_tail, __ATOMIC_RELEASE);
+
+    unsigned flags = 0;
+    io_uring_getevents_arg arg;
+    __kernel_timespec ts;
+    std::memset(&arg, 0, sizeof(arg));
+    void* argp = nullptr;
+    std::size_t arg_len = 0;
+    if (wait_nr > 0) {
+        flags |= IORING_ENTER_GETEVENTS;
+        if (timeout_ms >= 0) {
+            ts.tv_sec = timeout_ms / 1000;
+            ts.tv_nsec = (timeout_ms % 1000) * 1000000LL;
+            arg.ts = reinterpret_cast<std::uint64_t>(&ts);
+            flags |= IORING_ENTER_EXT_ARG;
+            argp = &arg;
+            arg_len = sizeof(arg);
+        }
+    }
+    if (to_submit == 0 && wait_nr == 0)
+        return 0;
+    int rc = sys_enter(ring_fd, to_submit, wait_nr, flags, argp, arg_len);
+    if (rc < 0 && (errno == ETIME || errno == EINTR || errno == EBUSY))
+        return 0;
+    return rc < 0 ? -errno : rc;
+}
+
+int io_uring_ring::submit_and_wait(int timeout_ms) {
+    return enter(1, timeout_ms);
+}
+
+void io_uring_ring::recycle_buffer(unsigned short id) noexcept {
+    // Index from the ring start: in C++ __DECLARE_FLEX_ARRAY offsets bufs by its
+    // empty placeholder struct, while the kernel's entries start at offset 0
+    io_uring_buf& buf = reinterpret_cast<io_uring_buf*>(buf_ring)[buf_tail & (buf_count - 1)];
+    buf.addr = reinterpret_cast<std::uint64_t>(buffer(id));
+    buf.len = buf_size;
+    buf.bid = id;
+    ++buf_tail;
+    __atomic_store_n(&buf_ring->tail, buf_tail, __ATOMIC_RELEASE);
+}
+}  // namespace cppress::sockets
+
+#endif
@@ -0,0 +1,55 @@
+/**
+ * @file loop_stats.cpp
+ * @brief Implementation of event loop counters
+ */
+
+#include "../includes/loop_stats.hpp"
+
+namespace cppress::sockets {
+
+constexpr std::array<std::size_t, 5> loop_stats::outq_depth_bounds;
+
+loop_stats& loop_stats::operator+=(const loop_stats& other) noexcept {
+    wakeups += other.wakeups;
+    events += other.events;
+    wait_ns += other.wait_ns;
+    handler_ns += other.handler_ns;
+    bytes_read += other.bytes_read;
+    bytes_written += other.bytes_written;
+    send_eagain += other.send_eagain;
+    accepts += other.accepts;
+    accept_failures += other.accept_failures;
+    events_resizes += other.events_resizes;
+    for (std::size_t i = 0; i < outq_depth.size(); ++i)
+        outq_depth[i] += other.outq_depth[i];
+    return *this;
+}
+
+void loop_counters::on_flush(std::size_t queued, std::size_t written, bool would_block) noexcept {
+    std::size_t bucket = 0;
+    while (bucket < loop_stats::outq_depth_bounds.size() &&
+           queued >= loop_stats::outq_depth_bounds[bucket])
+        ++bucket;
+    bump(outq_depth[bucket]);
+    bump(bytes_written, written);
+    if (would_block)
+        bump(send_eagain);
+}
+
+loop_stats loop_counters::snapshot() const noexcept {
+    loop_stats s;
+    s.wakeups = wakeups.load(std::memory_order_relaxed);
+    s.events = events.load(std::memory_order_relaxed);
+    s.wait_ns = wait_ns.load(std::memory_order_relaxed);
+    s.handler_ns = handler_ns.load(std::memory_order_relaxed);
+    s.bytes_read = bytes_read.load(std::memory_order_relaxed);
+    s.bytes_written = bytes_written.load(std::memory_order_relaxed);
+    s.send_eagain = send_eagain.load(std::memory_order_relaxed);
+    s.accepts = accepts.load(std::memory_order_relaxed);
+    s.accept_failures = accept_failures.load(std::memory_order_relaxed);
+    s.events_resizes = events_resizes.load(std::memory_order_relaxed);
+    for (std::size_t i = 0; i < outq_depth.size(); ++i)
+        s.outq_depth[i] = outq_depth[i].load(std::memory_order_relaxed);
+    return s;
+}
+}  // namespace cppress::sockets
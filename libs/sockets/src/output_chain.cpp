@@ -0,0 +1,323 @@
+/**
+ * @file output_chain.cpp
+ * @brief Implementation of the scatter-gather output queue
+ */
+
+#include "../includes/output_chain.hpp"
+
+#include <errno.h>
+
+#include <algorithm>
+
+#if defined(_WIN32) || defined(_WIN64) || defined(__CYGWIN__)
+#include <io.h>
+#include <winsock2.h>
+#else
+#include <limits.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#if defined(__linux__) || defined(__linux)
+#include <linux/errqueue.h>
+#include <netinet/in.h>
+#include <sys/sendfile.h>
+#endif
+#endif
+
+namespace cppress::sockets {
+
+/**
+ * Implementation Notes:
+ * - Whole segments are popped, the remainder only moves head_offset
+ * - Never copies or shifts segment contents
+ */
+void output_chain::consume(std::size_t n) {
+    pending_bytes -= std::min(n, pending_bytes);
+    while (n > 0 && !segments.empty()) {
+        std::size_t left = segments.front().size() - head_offset;
+        if (n < left) {
+            head_offset += n;
+            return;
+        }
+        n -= left;
+        segments.pop_front();
+        head_offset = 0;
+    }
+}
+
+namespace {
+#ifdef MSG_NOSIGNAL
+constexpr int send_flags = MSG_NOSIGNAL;
+#else
+constexpr int send_flags = 0;
+#endif
+
+/// Block size of the read + send fallback for file segments
+constexpr std::size_t file_block_size = 64 * 1024;
+}  // namespace
+
+#if !defined(_WIN32) && !defined(_WIN64) && !defined(__CYGWIN__)
+void output_chain::gather(std::vector<iovec>& iov, std::vector<data_buffer>& pin,
+                          std::size_t max) const {
+    std::size_t count = 0;
+    for (auto it = segments.begin(); it != segments.end() && !it->is_file() && count < max;
+         ++it, ++count) {
+        std::size_t skip = count == 0 ? head_offset : 0;
+        iov.push_back({const_cast<char*>(it->memory.data() + skip), it->memory.size() - skip});
+        pin.push_back(it->memory);
+    }
+}
+#endif
+
+/**
+ * Algorithm:
+ * 1. Linux: sendfile() from offset + head_offset until done or EAGAIN
+ * 2. Otherwise (or if sendfile is unsupported for this file): read one block
+ *    at the current offset and send it; unsent bytes are simply re-read on
+ *    the next call, so no user-space copy is kept between calls
+ *
+ * Error Handling:
+ * - A file shorter than the region (truncated while queued) is an error
+ */
+output_chain::flush_result output_chain::flush_file(socket_t fd) {
+    // copy: the segment is popped by consume() once it is fully sent
+    const file_region file = segments.front().file;
+#if defined(__linux__) || defined(__linux)
+    bool use_sendfile = true;
+#endif
+    while (true) {
+        std::size_t left = file.size() - head_offset;
+        std::uint64_t at = file.offset() + head_offset;
+#if defined(__linux__) || defined(__linux)
+        if (use_sendfile) {
+            off_t off = static_cast<off_t>(at);
+            ssize_t n = ::sendfile(fd, file.native_handle(), &off,
+                                   std::min<std::size_t>(left, 1u << 30));
+            if (n > 0) {
+                consume((std::size_t)n);
+                if ((std::size_t)n == left)
+                    return flush_result::complete;
+                continue;
+            }
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                return flush_result::would_block;
+            if (n < 0 && (errno == EINVAL || errno == ENOSYS)) {
+                // e.g. a file system without splice support
+                use_sendfile = false;
+                continue;
+            }
+            return flush_result::error;
+        }
+#endif
+        char block[file_block_size];
+        std::size_t want = std::min(left, sizeof(block));
+#if defined(_WIN32) || defined(_WIN64) || defined(__CYGWIN__)
+        if (::_lseeki64(file.native_handle(), (long long)at, SEEK_SET) < 0)
+            return flush_result::error;
+        int got = ::_read(file.native_handle(), block, (unsigned)want);
+        if (got <= 0)
+            return flush_result::error;
+        int n = ::send(fd, block, got, 0);
+        if (n > 0) {
+            consume((std::size_t)n);
+            if ((std::size_t)n == left)
+                return flush_result::complete;
+            continue;
+        }
+        if (WSAGetLastError() == WSAEWOULDBLOCK)
+            return flush_result::would_block;
+        return flush_result::error;
+#else
+        ssize_t got = ::pread(file.native_handle(), block, want, static_cast<off_t>(at));
+        if (got < 0 && errno == EINTR)
+            continue;
+        if (got <= 0)
+            return flush_result::error;
+        ssize_t n = ::send(fd, block, (std::size_t)got, send_flags);
+        if (n > 0) {
+            consume((std::size_t)n);
+            if ((std::size_t)n == left)
+                return flush_result::complete;
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return flush_result::would_block;
+        return flush_result::error;
+#endif
+    }
+}
+
+/**
+ * Algorithm:
+ * 1. Hand a file segment at the front to flush_file()
+ * 2. Otherwise gather up to IOV_MAX memory segments into an iovec array,
+ *    starting at head_offset and stopping at the next file segment
+ * 3. writev() them in one system call
+ * 4. Consume what the kernel accepted and repeat until empty or EAGAIN
+ *
+ * Error Handling:
+ * - EINTR retries the call
+ * - EAGAIN/EWOULDBLOCK leaves the remainder queued
+ * - Any other error is reported so the caller can close the connection
+ */
+output_chain::flush_result output_chain::flush(socket_t fd, std::size_t zerocopy_min) {
+#if defined(_WIN32) || defined(_WIN64) || defined(__CYGWIN__)
+    (void)zerocopy_min;
+    while (!segments.empty()) {
+        if (segments.front().is_file()) {
+            auto result = flush_file(fd);
+            if (result != flush_result::complete)
+                return result;
+            continue;
+        }
+        const data_buffer& front = segments.front().memory;
+        int n = ::send(fd, front.data() + head_offset, (int)(front.size() - head_offset), 0);
+        if (n > 0) {
+            consume((std::size_t)n);
+            continue;
+        }
+        int err = WSAGetLastError();
+        if (err == WSAEWOULDBLOCK)
+            return flush_result::would_block;
+        return flush_result::error;
+    }
+    return flush_result::complete;
+#else
+#ifdef IOV_MAX
+    constexpr std::size_t max_iov = IOV_MAX;
+#else
+    constexpr std::size_t max_iov = 1024;
+#endif
+    iovec iov[max_iov];
+
+    while (!segments.empty()) {
+        if (segments.front().is_file()) {
+            auto result = flush_file(fd);
+            if (result != flush_result::complete)
+                return result;
+            continue;
+        }
+
+        std::size_t count = 0;
+        std::size_t batch = 0;
+        for (auto it = segments.begin();
+             it != segments.end() && !it->is_file() && count < max_iov; ++it, ++count) {
+            std::size_t skip = count == 0 ? head_offset : 0;
+            iov[count].iov_base = const_cast<char*>(it->memory.data() + skip);
+            iov[count].iov_len = it->memory.size() - skip;
+            batch += iov[count].iov_len;
+        }
+
+        msghdr msg{};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = count;
+        int flags = send_flags;
+#ifdef MSG_ZEROCOPY
+        bool zerocopy = zerocopy_min > 0 && batch >= zerocopy_min && enable_zerocopy(fd);
+        if (zerocopy)
+            flags |= MSG_ZEROCOPY;
+#else
+        (void)zerocopy_min;
+        (void)batch;
+        constexpr bool zerocopy = false;
+#endif
+        // sendmsg instead of writev so a closed peer yields EPIPE instead of SIGPIPE
+        ssize_t n = ::sendmsg(fd, &msg, flags);
+        if (n < 0 && zerocopy && errno == ENOBUFS) {
+            // Out of option memory for notifications, copy this batch
+            n = ::sendmsg(fd, &msg, send_flags);
+        } else if (n > 0 && zerocopy) {
+            pin_zerocopy((std::size_t)n);
+        }
+        if (n > 0) {
+            consume((std::size_t)n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return flush_result::would_block;
+        return flush_result::error;
+    }
+    return flush_result::complete;
+#endif
+}
+bool output_chain::enable_zerocopy(socket_t fd) {
+#if defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+    if (zerocopy == zerocopy_mode::unknown) {
+        int one = 1;
+        zerocopy = ::setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) == 0
+                       ? zerocopy_mode::enabled
+                       : zerocopy_mode::unavailable;
+    }
+    return zerocopy == zerocopy_mode::enabled;
+#else
+    (void)fd;
+    return false;
+#endif
+}
+
+/**
+ * Implementation Notes:
+ * - Each successful MSG_ZEROCOPY send gets the next 32-bit sequence number
+ * - Only shared references are taken, the segments themselves are consumed
+ *   as usual right after
+ */
+void output_chain::pin_zerocopy(std::size_t n) {
+    zerocopy_batch batch{zerocopy_next++, {}};
+    std::size_t offset = head_offset;
+    for (auto it = segments.begin(); n > 0 && it != segments.end(); ++it) {
+        batch.pinned.push_back(it->memory);
+        std::size_t left = it->memory.size() - offset;
+        n -= std::min(n, left);
+        offset = 0;
+    }
+    zerocopy_inflight.push_back(std::move(batch));
+}
+
+/**
+ * Algorithm:
+ * 1. Read every notification from the error queue (MSG_ERRQUEUE)
+ * 2. Each notification acknowledges the sequence range [ee_info, ee_data];
+ *    TCP acknowledges in order, so batches up to ee_data are released
+ * 3. SO_EE_CODE_ZEROCOPY_COPIED means the kernel copied the data anyway,
+ *    further sends on this socket skip zero-copy
+ */
+std::size_t output_chain::reap_zerocopy(socket_t fd) {
+    std::size_t reaped = 0;
+#if defined(SO_EE_ORIGIN_ZEROCOPY) && defined(MSG_ZEROCOPY)
+    while (!zerocopy_inflight.empty()) {
+        char control[128];
+        msghdr msg{};
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        if (::recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+            break;
+        for (cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+            bool recverr = (cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) ||
+                           (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR);
+            if (!recverr)
+                continue;
+            const auto* ee = reinterpret_cast<const sock_extended_err*>(CMSG_DATA(cm));
+            if (ee->ee_errno != 0 || ee->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+                continue;
+            ++reaped;
+            if (ee->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+                zerocopy = zerocopy_mode::unavailable;
+            std::uint32_t last = ee->ee_data;
+            // Serial number arithmetic, sequence numbers wrap around
+            while (!zerocopy_inflight.empty() &&
+                   static_cast<std::int32_t>(zerocopy_inflight.front().seq - last) <= 0)
+                zerocopy_inflight.pop_front();
+        }
+    }
+#else
+    (void)fd;
+#endif
+    return reaped;
+}
+}  // namespace cppress::sockets
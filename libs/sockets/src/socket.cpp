@@ -18,6 +18,7 @@
 #include <fcntl.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
+#include <netinet/udp.h>
 #include <sys/socket.h>
 #include <unistd.h>
 #define socket_errno() errno
@@ -227,6 +228,114 @@ void socket::send_to(const socket_address& addr, const data_buffer& data) {
     }
 }
 
+/**
+ * Implementation Notes:
+ * - MSG_WAITFORONE blocks for the first datagram only, the rest of the
+ *   batch is what is already queued
+ * - GRO segment sizes are read back from the UDP_GRO control message
+ */
+std::size_t socket::receive_batch(datagram_batch& batch, bool wait) {
+    if (socket_type != type::datagram) {
+        throw socket_exception("receive_batch is only supported for UDP sockets",
+                               "socket::typeMismatch", __func__);
+    }
+    batch.clear();
+
+#if defined(__linux__) || defined(__linux)
+    batch.prepare_headers(0, batch.capacity(), true);
+    int n;
+    do {
+        n = ::recvmmsg(fd.native_handle(), batch.headers.data(),
+                       static_cast<unsigned int>(batch.capacity()),
+                       wait ? MSG_WAITFORONE : MSG_DONTWAIT, nullptr);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+            return 0;
+        throw socket_exception("Failed to receive data: " + std::string(get_error_message()),
+                               "SocketReceive", __func__);
+    }
+    for (int i = 0; i < n; ++i) {
+        msghdr& msg = batch.headers[i].msg_hdr;
+        batch.lengths[i] = batch.headers[i].msg_len;
+        batch.address_lengths[i] = msg.msg_namelen;
+        batch.segments[i] = 0;
+#ifdef UDP_GRO
+        for (cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+            if (cm->cmsg_level == SOL_UDP && cm->cmsg_type == UDP_GRO) {
+                int size = 0;
+                std::memcpy(&size, CMSG_DATA(cm), sizeof(size));
+                if (size > 0 && static_cast<std::size_t>(size) < batch.lengths[i])
+                    batch.segments[i] = static_cast<std::size_t>(size);
+            }
+        }
+#endif
+    }
+    batch.count = static_cast<std::size_t>(n);
+#else
+    (void)wait;
+    socklen_t len = sizeof(sockaddr_storage);
+    int n = ::recvfrom(fd.native_handle(), batch.buffer.get(), static_cast<int>(batch.slot_size()),
+                       0, reinterpret_cast<sockaddr*>(&batch.addresses[0]), &len);
+    if (n == SOCKET_ERROR_VALUE) {
+        throw socket_exception("Failed to receive data: " + std::string(get_error_message()),
+                               "SocketReceive", __func__);
+    }
+    batch.lengths[0] = static_cast<std::size_t>(n);
+    batch.segments[0] = 0;
+    batch.address_lengths[0] = len;
+    batch.count = 1;
+#endif
+    return batch.count;
+}
+
+std::size_t socket::send_batch(datagram_batch& batch) {
+    if (socket_type != type::datagram) {
+        throw socket_exception("send_batch is only supported for UDP sockets",
+                               "socket::typeMismatch", __func__);
+    }
+    std::size_t sent = 0;
+
+#if defined(__linux__) || defined(__linux)
+    batch.prepare_headers(0, batch.size(), false);
+    while (sent < batch.size()) {
+        int n = ::sendmmsg(fd.native_handle(), batch.headers.data() + sent,
+                           static_cast<unsigned int>(batch.size() - sent), 0);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            throw socket_exception("Failed to send data: " + std::string(get_error_message()),
+                                   "SocketSend", __func__);
+        }
+        sent += static_cast<std::size_t>(n);
+    }
+#else
+    for (; sent < batch.size(); ++sent) {
+        auto payload = batch.payload(sent);
+        int n = ::sendto(fd.native_handle(), payload.data(), static_cast<int>(payload.size()), 0,
+                         reinterpret_cast<const sockaddr*>(&batch.addresses[sent]),
+                         batch.address_lengths[sent]);
+        if (n == SOCKET_ERROR_VALUE) {
+            throw socket_exception("Failed to send data: " + std::string(get_error_message()),
+                                   "SocketSend", __func__);
+        }
+    }
+#endif
+    return sent;
+}
+
+bool socket::set_udp_gro(bool enable) noexcept {
+#if (defined(__linux__) || defined(__linux)) && defined(UDP_GRO)
+    int value = enable ? 1 : 0;
+    return ::setsockopt(fd.native_handle(), SOL_UDP, UDP_GRO, &value, sizeof(value)) == 0;
+#else
+    (void)enable;
+    return false;
+#endif
+}
+
 socket_address socket::get_bound_address() const {
     return addr;
 }
@@ -0,0 +1,89 @@
+/**
+ * @file socket_options.cpp
+ * @brief Implementation of socket_options
+ */
+
+#include "../includes/socket_options.hpp"
+
+#include "../includes/socket.hpp"
+
+#if defined(_WIN32) || defined(_WIN64) || defined(__CYGWIN__)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#endif
+
+namespace cppress::sockets {
+
+/**
+ * Implementation Notes:
+ * - Buffer sizes are set before listen() so the window scale offered in the
+ *   handshake matches them
+ * - Linux copies the listener's socket state into accepted sockets, so
+ *   nothing here has to be repeated per connection
+ */
+void socket_options::apply_to_listener(socket& listener) const {
+    if (tcp_nodelay)
+        listener.set_option(IPPROTO_TCP, TCP_NODELAY, 1);
+    if (receive_buffer > 0)
+        listener.set_option(SOL_SOCKET, SO_RCVBUF, receive_buffer);
+    if (send_buffer > 0)
+        listener.set_option(SOL_SOCKET, SO_SNDBUF, send_buffer);
+#ifdef TCP_DEFER_ACCEPT
+    if (defer_accept_seconds > 0)
+        listener.set_option(IPPROTO_TCP, TCP_DEFER_ACCEPT, defer_accept_seconds);
+#endif
+#ifdef TCP_FASTOPEN
+    if (fastopen_queue > 0)
+        listener.set_option(IPPROTO_TCP, TCP_FASTOPEN, fastopen_queue);
+#endif
+#ifdef SO_BUSY_POLL
+    if (busy_poll_usec > 0)
+        listener.set_option(SOL_SOCKET, SO_BUSY_POLL, busy_poll_usec);
+#endif
+#ifdef SO_INCOMING_CPU
+    if (incoming_cpu >= 0)
+        listener.set_option(SOL_SOCKET, SO_INCOMING_CPU, incoming_cpu);
+#endif
+}
+
+bool socket_options::needs_per_connection_setup() const noexcept {
+#if defined(__linux__) || defined(__linux)
+    return tcp_quickack;
+#else
+    // Accepted sockets do not reliably inherit options elsewhere
+    return tcp_nodelay || receive_buffer > 0 || send_buffer > 0;
+#endif
+}
+
+/**
+ * Implementation Notes:
+ * - TCP_QUICKACK is not sticky, the kernel may re-enter delayed ACK mode,
+ *   so it is set once per connection to cover the first request/response
+ */
+bool socket_options::apply_to_accepted(socket_t fd) const noexcept {
+    bool ok = true;
+    auto set = [&](int level, int name, int value) {
+        const char* ptr = reinterpret_cast<const char*>(&value);
+        if (::setsockopt(fd, level, name, ptr, sizeof(value)) != 0)
+            ok = false;
+    };
+#if defined(__linux__) || defined(__linux)
+#ifdef TCP_QUICKACK
+    if (tcp_quickack)
+        set(IPPROTO_TCP, TCP_QUICKACK, 1);
+#endif
+#else
+    if (tcp_nodelay)
+        set(IPPROTO_TCP, TCP_NODELAY, 1);
+    if (receive_buffer > 0)
+        set(SOL_SOCKET, SO_RCVBUF, receive_buffer);
+    if (send_buffer > 0)
+        set(SOL_SOCKET, SO_SNDBUF, send_buffer);
+#endif
+    return ok;
+}
+}  // namespace cppress::sockets
@@ -0,0 +1,133 @@
+/**
+ * @file timer_wheel.cpp
+ * @brief Implementation of the hierarchical timing wheel
+ */
+
+#include "../includes/timer_wheel.hpp"
+
+#include <algorithm>
+
+namespace cppress::sockets {
+
+timer_wheel::timer_wheel(std::chrono::milliseconds tick)
+    : origin(clock::now()), tick(std::max(tick, std::chrono::milliseconds(1))) {
+    for (auto& head : slots)
+        head.prev = head.next = &head;
+}
+
+std::uint64_t timer_wheel::tick_of(clock::time_point t) const noexcept {
+    if (t <= origin)
+        return 0;
+    return static_cast<std::uint64_t>((t - origin) / tick);
+}
+
+/**
+ * Slot Selection:
+ * - Deadlines less than 256 ticks away go to the first level, indexed by expiry
+ * - Further ones go to the level whose span covers the distance, indexed by
+ *   the matching bits of the expiry, and are cascaded down as the wheel turns
+ */
+timer_node& timer_wheel::slot_for(std::uint64_t expires) noexcept {
+    std::uint64_t delta = expires - current;
+    if (delta < root_size)
+        return slots[expires & root_mask];
+    std::size_t base = root_size;
+    unsigned shift = root_bits;
+    for (unsigned level = 1; level < levels; ++level) {
+        if (delta < (std::uint64_t(1) << (shift + level_bits)) || level == levels - 1)
+            return slots[base + ((expires >> shift) & level_mask)];
+        base += level_size;
+        shift += level_bits;
+    }
+    return slots[base - level_size];  // unreachable
+}
+
+void timer_wheel::link(timer_node& node) noexcept {
+    timer_node& head = slot_for(node.expires);
+    node.prev = head.prev;
+    node.next = &head;
+    head.prev->next = &node;
+    head.prev = &node;
+}
+
+void timer_wheel::arm(timer_node& node, std::chrono::milliseconds after) {
+    cancel(node);
+    auto ticks = static_cast<std::uint64_t>((std::max(after, std::chrono::milliseconds(0)) +
+                                             tick - std::chrono::milliseconds(1)) /
+                                            tick);
+    node.expires = current + std::min(std::max<std::uint64_t>(ticks, 1), max_delta);
+    link(node);
+    ++count;
+}
+
+void timer_wheel::arm_at(timer_node& node, clock::time_point when) {
+    cancel(node);
+    std::uint64_t ticks = 0;
+    if (when > origin)
+        ticks = static_cast<std::uint64_t>((when - origin + tick - clock::duration(1)) / tick);
+    std::uint64_t earliest = current + 1;
+    node.expires = std::min(std::max(ticks, earliest), current + max_delta);
+    link(node);
+    ++count;
+}
+
+void timer_wheel::cancel(timer_node& node) noexcept {
+    if (!node.armed())
+        return;
+    node.prev->next = node.next;
+    node.next->prev = node.prev;
+    node.prev = node.next = nullptr;
+    --count;
+}
+
+/**
+ * Algorithm:
+ * Runs when the first level wraps. The slot of level 1 that covers the next
+ * 256 ticks is emptied and its timers re-linked relative to the current
+ * tick; if that slot was level 1's first, level 2 is cascaded the same way,
+ * and so on.
+ */
+void timer_wheel::cascade_all() noexcept {
+    std::size_t base = root_size;
+    unsigned shift = root_bits;
+    for (unsigned level = 1; level < levels; ++level) {
+        std::size_t index = (current >> shift) & level_mask;
+        timer_node& head = slots[base + index];
+        timer_node* node = head.next;
+        head.prev = head.next = &head;
+        while (node != &head) {
+            timer_node* next = node->next;
+            link(*node);
+            node = next;
+        }
+        if (index != 0)
+            break;
+        base += level_size;
+        shift += level_bits;
+    }
+}
+
+/**
+ * Implementation Notes:
+ * - Scans the first level up to its next wrap; if nothing is there the loop
+ *   wakes at the wrap, where higher levels cascade down
+ */
+int timer_wheel::next_timeout(clock::time_point now, int cap) const {
+    if (count == 0)
+        return cap;
+    std::uint64_t ticks = root_size - (current & root_mask);
+    for (std::uint64_t k = 1; k < ticks; ++k) {
+        const timer_node& head = slots[(current + k) & root_mask];
+        if (head.next != &head) {
+            ticks = k;
+            break;
+        }
+    }
+    auto deadline = origin + tick * static_cast<std::int64_t>(current + ticks);
+    auto wait = std::chrono::ceil<std::chrono::milliseconds>(deadline - now).count();
+    wait = std::max<decltype(wait)>(wait, 0);
+    if (cap >= 0)
+        wait = std::min<decltype(wait)>(wait, cap);
+    return static_cast<int>(wait);
+}
+}  // namespace cppress::sockets
@@ -0,0 +1,117 @@
+/**
+ * @file tls.cpp
+ * @brief Kernel TLS installation
+ */
+
+#include "../includes/tls.hpp"
+
+#include <errno.h>
+
+#include <cstring>
+
+#if defined(__linux__) || defined(__linux)
+#if defined(__has_include)
+#if __has_include(<linux/tls.h>)
+#include <linux/tls.h>
+#define CPPRESS_HAS_KTLS 1
+#endif
+#endif
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#ifndef CPPRESS_HAS_KTLS
+#define CPPRESS_HAS_KTLS 0
+#endif
+
+namespace cppress::sockets {
+
+#if CPPRESS_HAS_KTLS
+namespace {
+/// Copies one direction's keys into the kernel structure, false on a size mismatch
+template <typename Info>
+bool fill(const ktls_crypto& k, unsigned short cipher, Info& info) {
+    if (k.key.size() != sizeof(info.key) || k.iv.size() != sizeof(info.iv) ||
+        k.salt.size() != sizeof(info.salt) || k.rec_seq.size() != sizeof(info.rec_seq))
+        return false;
+    std::memset(&info, 0, sizeof(info));
+    info.info.version = k.version;
+    info.info.cipher_type = cipher;
+    std::memcpy(info.key, k.key.data(), k.key.size());
+    std::memcpy(info.iv, k.iv.data(), k.iv.size());
+    std::memcpy(info.salt, k.salt.data(), k.salt.size());
+    std::memcpy(info.rec_seq, k.rec_seq.data(), k.rec_seq.size());
+    return true;
+}
+
+template <typename Info>
+int set_direction(int fd, int direction, const ktls_crypto& k, unsigned short cipher) {
+    Info info;
+    if (!fill(k, cipher, info))
+        return EINVAL;
+    return ::setsockopt(fd, SOL_TLS, direction, &info, sizeof(info)) == 0 ? 0 : errno;
+}
+
+int install_direction(int fd, int direction, const ktls_crypto& k) {
+    switch (k.suite) {
+        case ktls_crypto::cipher::aes_gcm_128:
+            return set_direction<tls12_crypto_info_aes_gcm_128>(fd, direction, k,
+                                                                TLS_CIPHER_AES_GCM_128);
+        case ktls_crypto::cipher::aes_gcm_256:
+            return set_direction<tls12_crypto_info_aes_gcm_256>(fd, direction, k,
+                                                                TLS_CIPHER_AES_GCM_256);
+        case ktls_crypto::cipher::chacha20_poly1305:
+            return set_direction<tls12_crypto_info_chacha20_poly1305>(
+                fd, direction, k, TLS_CIPHER_CHACHA20_POLY1305);
+    }
+    return EINVAL;
+}
+
+/// Attaches the ULP to a connected loopback pair, the only way to ask the kernel
+bool probe_ktls() {
+    int server = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    int client = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    bool ok = false;
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    if (server >= 0 && client >= 0 &&
+        ::bind(server, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0 &&
+        ::listen(server, 1) == 0 &&
+        ::getsockname(server, reinterpret_cast<sockaddr*>(&addr), &len) == 0 &&
+        ::connect(client, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0)
+        ok = ::setsockopt(client, IPPROTO_TCP, TCP_ULP, "tls", sizeof("tls")) == 0;
+    if (client >= 0)
+        ::close(client);
+    if (server >= 0)
+        ::close(server);
+    return ok;
+}
+}  // namespace
+
+/**
+ * Implementation Notes:
+ * - The ULP is attached first, then TX before RX; a failure part way
+ *   leaves the socket unusable for plaintext, callers close it
+ */
+int install_ktls(socket_t fd, const ktls_crypto& tx, const ktls_crypto& rx) noexcept {
+    if (::setsockopt(fd, IPPROTO_TCP, TCP_ULP, "tls", sizeof("tls")) != 0)
+        return errno;
+    if (int error = install_direction(fd, TLS_TX, tx))
+        return error;
+    return install_direction(fd, TLS_RX, rx);
+}
+
+bool ktls_available() noexcept {
+    static const bool available = probe_ktls();
+    return available;
+}
+#else
+int install_ktls(socket_t, const ktls_crypto&, const ktls_crypto&) noexcept { return ENOTSUP; }
+
+bool ktls_available() noexcept { return false; }
+#endif
+}  // namespace cppress::sockets
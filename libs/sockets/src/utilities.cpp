@@ -23,6 +23,7 @@
 #include "../includes/port.hpp"
 #include "../includes/socket.hpp"
 #include "../includes/socket_address.hpp"
+#include "../includes/socket_options.hpp"
 #include "../includes/utilities.hpp"
 
 // Global mutex for thread-safe random port generation
@@ -409,6 +410,12 @@ std::string to_uppercase(const std::string& input) {
 
 std::shared_ptr<cppress::sockets::socket> make_listener_socket(uint16_t port, const std::string& ip,
                                                                int backlog) {
+    return make_listener_socket(port, ip, backlog, socket_options());
+}
+
+std::shared_ptr<cppress::sockets::socket> make_listener_socket(uint16_t port, const std::string& ip,
+                                                               int backlog,
+                                                               const socket_options& options) {
     try {
         auto sock_ptr =
             std::make_shared<cppress::sockets::socket>(cppress::sockets::socket::type::stream);
@@ -418,12 +425,9 @@ std::shared_ptr<cppress::sockets::socket> make_listener_socket(uint16_t port, co
         sock_ptr->set_non_blocking(true);
         sock_ptr->bind(cppress::sockets::socket_address(cppress::sockets::port(port),
                                                         cppress::sockets::ip_address(ip)));
+        options.apply_to_listener(*sock_ptr);
         sock_ptr->listen(backlog);
 
-        // Optional: reduce wakeups by notifying only when data arrives (Linux-specific).
-        // int defer_secs = 1;
-        // sock_ptr->set_option(IPPROTO_TCP, TCP_DEFER_ACCEPT, defer_secs);
-
         return sock_ptr;
     } catch (socket_exception& e) {
         throw std::runtime_error("Failed to create listener socket: " + e.what());
@@ -0,0 +1,100 @@
+/**
+ * @file buffer_pool_test.cpp
+ * @brief Unit tests for buffer_pool and receive_buffer
+ */
+
+#include "includes/buffer_pool.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <thread>
+
+using namespace cppress::sockets;
+
+TEST(BufferPoolTest, ChunksAreRecycled) {
+    buffer_pool pool(1024, 2);
+    EXPECT_EQ(pool.free_count(), 0);
+
+    char* first = nullptr;
+    {
+        auto chunk = pool.acquire();
+        first = chunk.get();
+    }
+    EXPECT_EQ(pool.free_count(), 1);
+    EXPECT_EQ(pool.acquire().get(), first);
+
+    // releases from another thread return to the pool as well
+    auto chunk = pool.acquire();
+    std::thread([c = std::move(chunk)]() mutable { c.reset(); }).join();
+    EXPECT_EQ(pool.free_count(), 1);
+
+    // idle chunks beyond max_free are freed
+    {
+        auto a = pool.acquire(), b = pool.acquire(), c = pool.acquire();
+    }
+    EXPECT_EQ(pool.free_count(), 2);
+}
+
+TEST(BufferPoolTest, ReceiveBufferHandsOutSlices) {
+    buffer_pool pool(64, 4);
+    data_buffer first, second;
+    {
+        receive_buffer rx(pool, 16);
+
+        char* p = rx.prepare();
+        EXPECT_EQ(rx.available(), 64);
+        std::memcpy(p, "hello", 5);
+        first = rx.commit(5);
+
+        // the next read continues in the same chunk
+        p = rx.prepare();
+        EXPECT_EQ(p, first.data() + 5);
+        std::memcpy(p, "world", 5);
+        second = rx.commit(5);
+
+        // a tail smaller than min_read moves on to a fresh chunk
+        rx.prepare();
+        rx.commit(40);
+        p = rx.prepare();
+        EXPECT_EQ(rx.available(), 64);
+        EXPECT_NE(p, first.data());
+    }
+    EXPECT_EQ(first.view(), "hello");
+    EXPECT_EQ(second.view(), "world");
+
+    // the chunk returns to the pool once its last slice is gone
+    std::size_t before = pool.free_count();
+    first.clear();
+    EXPECT_EQ(pool.free_count(), before);
+    second.clear();
+    EXPECT_EQ(pool.free_count(), before + 1);
+}
+
+TEST(BufferPoolTest, SizeClassesServeTheSmallestFittingChunk) {
+    buffer_pool pool({4096, 256, 1024}, 4);
+    EXPECT_EQ(pool.min_chunk_size(), 256);
+    EXPECT_EQ(pool.max_chunk_size(), 4096);
+    EXPECT_EQ(pool.chunk_size(100), 256);
+    EXPECT_EQ(pool.chunk_size(257), 1024);
+    EXPECT_EQ(pool.chunk_size(1 << 20), 4096);  // capped at the largest class
+    EXPECT_THROW(buffer_pool(std::vector<std::size_t>{}, 4), std::invalid_argument);
+
+    // chunks return to the free list of their own class
+    char* large = nullptr;
+    {
+        auto chunk = pool.acquire(2000);
+        large = chunk.get();
+    }
+    EXPECT_EQ(pool.free_count(), 1);
+    EXPECT_NE(pool.acquire(10).get(), large);
+    EXPECT_EQ(pool.acquire(4096).get(), large);
+
+    // small reads stay in small chunks, larger ones move up a class
+    receive_buffer rx(pool, 256);
+    rx.prepare();
+    EXPECT_EQ(rx.available(), 256);
+    rx.commit(200);
+    rx.prepare(1024);
+    EXPECT_EQ(rx.available(), 1024);
+}
@@ -0,0 +1,53 @@
+/**
+ * @file connection_table_test.cpp
+ * @brief Unit tests for the fd-indexed connection table
+ */
+
+#include "includes/connection_table.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+using namespace cppress::sockets;
+
+TEST(ConnectionTableTest, FindEraseAndGenerations) {
+    connection_table<std::string, 2> table;
+    EXPECT_EQ(table.find(3), nullptr);
+    EXPECT_EQ(table.find(-1), nullptr);
+    EXPECT_EQ(table.generation(3), 0u);
+
+    table.emplace(3) = "first";
+    std::uint32_t first = table.generation(3);
+    ASSERT_NE(table.find(3), nullptr);
+    EXPECT_EQ(*table.find(3), "first");
+    EXPECT_EQ(table.size(), 1u);
+
+    table.erase(3);
+    table.erase(3);  // erasing twice is a no-op
+    EXPECT_EQ(table.find(3), nullptr);
+    EXPECT_TRUE(table.empty());
+
+    // a reused fd starts from a fresh entry under a new generation
+    EXPECT_EQ(table.emplace(3), "");
+    EXPECT_NE(table.generation(3), first);
+    EXPECT_EQ(table.find(3, first), nullptr);
+    EXPECT_NE(table.find(3, table.generation(3)), nullptr);
+}
+
+TEST(ConnectionTableTest, EntriesDoNotMoveWhenTheTableGrows) {
+    connection_table<int, 2> table;
+    int& low = table.emplace(1);
+    low = 7;
+    for (int fd = 2; fd < 100; fd += 3)
+        table.emplace(fd) = fd;
+    EXPECT_EQ(&low, table.find(1));
+    EXPECT_EQ(low, 7);
+
+    std::vector<int> fds;
+    table.for_each([&](int fd, int&) { fds.push_back(fd); });
+    ASSERT_EQ(fds.size(), table.size());
+    EXPECT_EQ(fds.front(), 1);
+    EXPECT_EQ(fds.back(), 98);
+}
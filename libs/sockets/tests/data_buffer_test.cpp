@@ -137,3 +137,50 @@ TEST(DataBufferTest, BinaryDataHandling) {
         EXPECT_EQ(buf2.data()[i], binary_data[i]);
     }
 }
+
+/**
+ * @test Test slices and copies share storage
+ * Verifies that slice() and copies view the same bytes instead of copying them
+ */
+TEST(DataBufferTest, SlicesShareStorage) {
+    data_buffer buf("GET /index.html HTTP/1.1");
+
+    data_buffer uri = buf.slice(4, 11);
+    EXPECT_EQ(uri.view(), "/index.html");
+    EXPECT_EQ(uri.data(), buf.data() + 4);
+
+    data_buffer copy(buf);
+    EXPECT_EQ(copy.data(), buf.data());
+
+    // len is clamped to the end of the buffer
+    EXPECT_EQ(buf.slice(16).to_string(), "HTTP/1.1");
+    EXPECT_TRUE(buf.slice(buf.size()).empty());
+    EXPECT_THROW(buf.slice(buf.size() + 1), std::out_of_range);
+}
+
+/**
+ * @test Test appending to shared storage
+ * Appending must detach from shared storage and leave other views untouched
+ */
+TEST(DataBufferTest, AppendDetachesSharedStorage) {
+    data_buffer buf("Hello");
+    data_buffer head = buf.slice(0, 4);
+
+    buf.append(" World");
+    EXPECT_EQ(buf.to_string(), "Hello World");
+    EXPECT_EQ(head.to_string(), "Hell");
+
+    head.append("o!");
+    EXPECT_EQ(head.to_string(), "Hello!");
+    EXPECT_EQ(buf.to_string(), "Hello World");
+
+    // sole owner of its string: grows and releases without copying
+    std::string payload(1024, 'a');
+    data_buffer owner(std::move(payload));
+    owner.append("def");
+    const char* p = owner.data();
+    std::string out = owner.release();
+    EXPECT_EQ(out.size(), 1027);
+    EXPECT_EQ(out.data(), p);
+    EXPECT_TRUE(owner.empty());
+}
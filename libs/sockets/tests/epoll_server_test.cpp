@@ -0,0 +1,534 @@
+/**
+ * @file epoll_server_test.cpp
+ * @brief Unit tests for the epoll_server event loops
+ */
+
+#include "includes/epoll_server.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "includes/connection.hpp"
+#include "includes/data_buffer.hpp"
+#include "includes/socket_address.hpp"
+#include "includes/tls.hpp"
+#include "includes/utilities.hpp"
+
+#include <sys/socket.h>
+
+using namespace cppress::sockets;
+
+namespace {
+class echo_server : public epoll_server {
+public:
+    explicit echo_server(std::size_t reactors, bool reply_from_worker = false,
+                         io_backend backend = io_backend::epoll)
+        : epoll_server(1024, reactors, false, backend), reply_from_worker(reply_from_worker) {}
+
+    std::atomic<int> opened{0};
+    std::atomic<int> expired{0};
+    bool reply_from_worker;
+
+    void send(std::shared_ptr<connection> conn, const std::string& msg) {
+        send_message(std::move(conn), data_buffer(msg));
+    }
+
+protected:
+    void on_connection_opened(std::shared_ptr<connection>) override { opened++; }
+    void on_connection_closed(std::shared_ptr<connection>) override {}
+    void on_listen_success() override {}
+    void on_deadline_expired(std::shared_ptr<connection> conn, connection_deadline which) override {
+        expired++;
+        epoll_server::on_deadline_expired(conn, which);
+    }
+    void on_shutdown_success() override {}
+    void on_message_received(std::shared_ptr<connection> conn, const data_buffer& db) override {
+        if (!reply_from_worker) {
+            send_message(conn, db);
+            return;
+        }
+        // Reply and close from another thread, as web::server workers do
+        std::thread([this, conn, msg = db.to_string()]() {
+            send_message(conn, data_buffer(msg));
+            close_connection(conn);
+        }).detach();
+    }
+};
+
+/// Answers every message with a reply larger than the socket buffers
+class flood_server : public epoll_server {
+public:
+    static constexpr std::size_t REPLY = 8 << 20;
+
+    explicit flood_server(io_backend backend) : epoll_server(1024, 1, false, backend) {
+        set_write_watermarks(1 << 20, 256 << 10);
+    }
+
+    std::atomic<int> paused{0};
+    std::atomic<int> resumed{0};
+    std::atomic<int> messages{0};
+
+protected:
+    void on_connection_opened(std::shared_ptr<connection>) override {}
+    void on_connection_closed(std::shared_ptr<connection>) override {}
+    void on_listen_success() override {}
+    void on_shutdown_success() override {}
+    void on_backpressure(std::shared_ptr<connection>, bool is_paused) override {
+        (is_paused ? paused : resumed)++;
+    }
+    void on_message_received(std::shared_ptr<connection> conn, const data_buffer& db) override {
+        for (std::size_t i = 0; i < db.size(); ++i) {
+            messages++;
+            send_message(conn, data_buffer(std::string(REPLY, 'r')));
+        }
+    }
+};
+/// Stand-in for a TLS library: "HELLO\n" from the client, "WELCOME\n" back
+class scripted_handshaker : public tls_handshaker {
+public:
+    explicit scripted_handshaker(int kernel_error) : kernel_error(kernel_error) {}
+
+    status step(socket_t fd) override {
+        char buf[256];
+        ssize_t n;
+        while ((n = ::recv(fd, buf, sizeof(buf), 0)) > 0)
+            received.append(buf, static_cast<std::size_t>(n));
+        if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+            return status::failed;
+        auto end = received.find("HELLO\n");
+        if (end == std::string::npos)
+            return status::want_read;
+        pending = received.substr(end + 6);
+        const char reply[] = "WELCOME\n";
+        ::send(fd, reply, sizeof(reply) - 1, MSG_NOSIGNAL);
+        return status::done;
+    }
+
+    int enable_kernel_tls(socket_t) override { return kernel_error; }
+
+    std::string take_pending_plaintext() override { return std::move(pending); }
+
+private:
+    int kernel_error;
+    std::string received;
+    std::string pending;
+};
+
+/// Greets every connection from on_connection_opened, before its handshake ends
+class greeting_server : public echo_server {
+public:
+    greeting_server() : echo_server(1) {}
+
+protected:
+    void on_connection_opened(std::shared_ptr<connection> conn) override {
+        send(std::move(conn), "banner;");
+    }
+    void on_exception_occurred(const std::exception&) override {}
+};
+}  // namespace
+
+TEST(EpollServerTest, MultiReactorEchoOverReusePort) {
+    initialize_socket_library();
+
+    const std::size_t REACTORS = 2;
+    const int NUM_CLIENTS = 16;
+    uint16_t port = static_cast<uint16_t>(get_random_free_port().value());
+
+    echo_server server(REACTORS);
+    EXPECT_EQ(server.reactor_count(), REACTORS);
+    for (std::size_t i = 0; i < REACTORS; ++i) {
+        EXPECT_TRUE(server.register_listener_socket(make_listener_socket(port, "127.0.0.1")));
+    }
+    // every reactor already owns a listener
+    EXPECT_FALSE(server.register_listener_socket(make_listener_socket(port, "127.0.0.1")));
+
+    std::thread loop([&]() { server.listen(50); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    socket_address addr(ip_address("127.0.0.1"), cppress::sockets::port(port), family::ipv4());
+    int echoed = 0;
+    for (int i = 0; i < NUM_CLIENTS; ++i) {
+        connection client(addr);
+        std::string msg = "ping " + std::to_string(i);
+        client.write(data_buffer(msg));
+        if (client.read().to_string() == msg)
+            echoed++;
+    }
+
+    server.shutdown();
+    loop.join();
+
+    EXPECT_EQ(echoed, NUM_CLIENTS);
+    EXPECT_EQ(server.opened.load(), NUM_CLIENTS);
+
+    loop_stats stats = server.stats();
+    EXPECT_EQ(stats.accepts, static_cast<std::uint64_t>(NUM_CLIENTS));
+    EXPECT_GT(stats.bytes_read, 0u);
+    EXPECT_EQ(stats.bytes_written, stats.bytes_read);  // everything was echoed
+    EXPECT_GE(stats.wakeups, 1u);
+    EXPECT_GE(stats.events, stats.accepts);
+    EXPECT_EQ(server.stats(0).accepts + server.stats(1).accepts, stats.accepts);
+    EXPECT_THROW(server.stats(REACTORS), std::out_of_range);
+    cleanup_socket_library();
+}
+
+TEST(EpollServerTest, ReactorsShareSingleListener) {
+    initialize_socket_library();
+
+    uint16_t port = static_cast<uint16_t>(get_random_free_port().value());
+    echo_server server(3);
+    EXPECT_TRUE(server.register_listener_socket(make_listener_socket(port, "127.0.0.1")));
+
+    std::thread loop([&]() { server.listen(50); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    socket_address addr(ip_address("127.0.0.1"), cppress::sockets::port(port), family::ipv4());
+    connection client(addr);
+    client.write(data_buffer("hello"));
+    EXPECT_EQ(client.read().to_string(), "hello");
+
+    server.shutdown();
+    loop.join();
+    cleanup_socket_library();
+}
+
+TEST(EpollServerTest, CrossThreadSendAndCloseAreDeliveredInOrder) {
+    initialize_socket_library();
+
+    uint16_t port = static_cast<uint16_t>(get_random_free_port().value());
+    echo_server server(1, true);
+    EXPECT_TRUE(server.register_listener_socket(make_listener_socket(port, "127.0.0.1")));
+
+    std::thread loop([&]() { server.listen(1000); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    socket_address addr(ip_address("127.0.0.1"), cppress::sockets::port(port), family::ipv4());
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 8; ++i) {
+        connection client(addr);
+        std::string msg = "worker " + std::to_string(i);
+        client.write(data_buffer(msg));
+        EXPECT_EQ(client.read().to_string(), msg);
+    }
+    // the eventfd wakes the loop, replies must not wait for the 1s epoll timeout
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(4));
+
+    server.shutdown();
+    loop.join();
+    cleanup_socket_library();
+}
+
+TEST(EpollServerTest, IdleConnectionsAreClosedByTheTimerWheel) {
+    initialize_socket_library();
+
+    uint16_t port = static_cast<uint16_t>(get_random_free_port().value());
+    echo_server server(1);
+    server.set_idle_timeout(std::chrono::milliseconds(200));
+    EXPECT_TRUE(server.register_listener_socket(make_listener_socket(port, "127.0.0.1")));
+
+    // a long epoll timeout: only the wheel can wake the loop in time
+    std::thread loop([&]() { server.listen(5000); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    socket_address addr(ip_address("127.0.0.1"), cppress::sockets::port(port), family::ipv4());
+    connection client(addr);
+    client.write(data_buffer("ping"));
+    EXPECT_EQ(client.read().to_string(), "ping");
+
+    // traffic re-arms the deadline; silence lets it expire
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_TRUE(client.read().empty());
+    auto waited = std::chrono::steady_clock::now() - start;
+    EXPECT_GE(waited, std::chrono::milliseconds(150));
+    EXPECT_LT(waited, std::chrono::seconds(2));
+    EXPECT_EQ(server.expired.load(), 1);
+
+    server.shutdown();
+    loop.join();
+    cleanup_socket_library();
+}
+
+TEST(EpollServerTest, IoUringBackendEchoesLargeAndCrossThreadReplies) {
+    initialize_socket_library();
+
+    uint16_t port = static_cast<uint16_t>(get_random_free_port().value());
+    echo_server server(2, false, io_backend::io_uring);
+    if (server.active_backend() != io_backend::io_uring)
+        GTEST_SKIP() << "io_uring is not supported by this kernel";
+    echo_server worker_server(1, true, io_backend::io_uring);
+    uint16_t worker_port = static_cast<uint16_t>(get_random_free_port().value());
+    EXPECT_TRUE(server.register_listener_socket(make_listener_socket(port, "127.0.0.1")));
+    EXPECT_TRUE(
+        worker_server.register_listener_socket(make_listener_socket(worker_port, "127.0.0.1")));
+
+    std::thread loop([&]() { server.listen(1000); });
+    std::thread worker_loop([&]() { worker_server.listen(1000); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    socket_address addr(ip_address("127.0.0.1"), cppress::sockets::port(port), family::ipv4());
+    for (int i = 0; i < 8; ++i) {
+        connection client(addr);
+        std::string msg = "uring " + std::to_string(i);
+        client.write(data_buffer(msg));
+        EXPECT_EQ(client.read().to_string(), msg);
+    }
+
+    // larger than a provided buffer and than the socket buffers
+    {
+        connection client(addr);
+        std::string big(1 << 20, 'x');
+        std::thread writer([&]() { client.write(data_buffer(big)); });
+        std::size_t received = 0;
+        while (received < big.size()) {
+            auto chunk = client.read();
+            if (chunk.empty())
+                break;
+            received += chunk.size();
+        }
+        writer.join();
+        EXPECT_EQ(received, big.size());
+    }
+
+    socket_address worker_addr(ip_address("127.0.0.1"), cppress::sockets::port(worker_port),
+                               family::ipv4());
+    connection client(worker_addr);
+    client.write(data_buffer("from worker"));
+    EXPECT_EQ(client.read().to_string(), "from worker");
+    // closed by the worker after the reply
+    EXPECT_TRUE(client.read().empty());
+
+    server.shutdown();
+    worker_server.shutdown();
+    loop.join();
+    worker_loop.join();
+    EXPECT_EQ(server.opened.load(), 9);
+    cleanup_socket_library();
+}
+
+TEST(EpollServerTest, WriteWatermarksPauseAndResumeReads) {
+    initialize_socket_library();
+
+    for (auto backend : {io_backend::epoll, io_backend::io_uring}) {
+        uint16_t port = static_cast<uint16_t>(get_random_free_port().value());
+        flood_server server(backend);
+        EXPECT_TRUE(server.register_listener_socket(make_listener_socket(port, "127.0.0.1")));
+        std::thread loop([&]() { server.listen(1000); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+        socket_address addr(ip_address("127.0.0.1"), cppress::sockets::port(port), family::ipv4());
+        connection client(addr);
+        client.write(data_buffer("a"));
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        // queued output is over the high mark, this request waits in the socket
+        client.write(data_buffer("b"));
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        EXPECT_EQ(server.paused.load(), 1);
+        EXPECT_EQ(server.messages.load(), 1);
+
+        std::size_t received = 0;
+        while (received < 2 * flood_server::REPLY) {
+            auto chunk = client.read();
+            if (chunk.empty())
+                break;
+            received += chunk.size();
+        }
+        EXPECT_EQ(received, 2 * flood_server::REPLY);
+        EXPECT_EQ(server.messages.load(), 2);
+        EXPECT_GE(server.resumed.load(), 1);
+
+        server.shutdown();
+        loop.join();
+    }
+    cleanup_socket_library();
+}
+
+TEST(EpollServerTest, ConnectionCapPausesAcceptingUntilAConnectionCloses) {
+    initialize_socket_library();
+
+    for (auto backend : {io_backend::epoll, io_backend::io_uring}) {
+        uint16_t port = static_cast<uint16_t>(get_random_free_port().value());
+        echo_server server(1, false, backend);
+        server.set_max_connections(2);
+        server.set_accept_budget(1);
+        EXPECT_TRUE(server.register_listener_socket(make_listener_socket(port, "127.0.0.1")));
+        std::thread loop([&]() { server.listen(1000); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+        socket_address addr(ip_address("127.0.0.1"), cppress::sockets::port(port), family::ipv4());
+        auto first = std::make_unique<connection>(addr);
+        connection second(addr);
+        first->write(data_buffer("one"));
+        EXPECT_EQ(first->read().to_string(), "one");
+        second.write(data_buffer("two"));
+        EXPECT_EQ(second.read().to_string(), "two");
+
+        // completes the handshake but waits in the backlog
+        connection third(addr);
+        third.write(data_buffer("three"));
+        std::this_thread::sleep_for(std::chrono::milliseconds(150));
+        EXPECT_EQ(server.opened.load(), 2);
+
+        first.reset();
+        EXPECT_EQ(third.read().to_string(), "three");
+        EXPECT_EQ(server.opened.load(), 3);
+
+        server.shutdown();
+        loop.join();
+    }
+    cleanup_socket_library();
+}
+
+TEST(EpollServerTest, OutboundConnectionsRunOnTheLoopAndArePooled) {
+    initialize_socket_library();
+
+    for (auto backend : {io_backend::epoll, io_backend::io_uring}) {
+        uint16_t port = static_cast<uint16_t>(get_random_free_port().value());
+        echo_server upstream(1);
+        EXPECT_TRUE(upstream.register_listener_socket(make_listener_socket(port, "127.0.0.1")));
+        std::thread upstream_loop([&]() { upstream.listen(1000); });
+
+        // a server without listener, only driving outbound connections
+        echo_server client(1, false, backend);
+        std::thread client_loop([&]() { client.listen(1000); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+        socket_address addr(ip_address("127.0.0.1"), cppress::sockets::port(port), family::ipv4());
+        auto round_trip = [&](const std::string& msg) {
+            std::promise<std::pair<connection*, std::string>> done;
+            client_handlers handlers;
+            handlers.on_connect = [&](std::shared_ptr<connection> conn, int error) {
+                if (error != 0) {
+                    done.set_value({nullptr, "error " + std::to_string(error)});
+                    return;
+                }
+                client.send(conn, msg);
+            };
+            handlers.on_data = [&](std::shared_ptr<connection> conn, const data_buffer& db) {
+                client.release_connection(conn);
+                done.set_value({conn.get(), db.to_string()});
+            };
+            client.connect_async(addr, std::move(handlers));
+            auto result = done.get_future();
+            EXPECT_EQ(result.wait_for(std::chrono::seconds(2)), std::future_status::ready);
+            return result.get();
+        };
+
+        auto first = round_trip("first");
+        EXPECT_EQ(first.second, "first");
+        auto second = round_trip("second");
+        EXPECT_EQ(second.second, "second");
+        // the released connection was reused
+        EXPECT_EQ(first.first, second.first);
+        EXPECT_EQ(upstream.opened.load(), 1);
+
+        // a refused connect reports its error
+        uint16_t closed_port = static_cast<uint16_t>(get_random_free_port().value());
+        std::promise<int> refused;
+        client_handlers handlers;
+        handlers.on_connect = [&](std::shared_ptr<connection> conn, int error) {
+            refused.set_value(conn ? 0 : error);
+        };
+        client.connect_async(socket_address(ip_address("127.0.0.1"),
+                                            cppress::sockets::port(closed_port), family::ipv4()),
+                             std::move(handlers));
+        auto error = refused.get_future();
+        ASSERT_EQ(error.wait_for(std::chrono::seconds(2)), std::future_status::ready);
+        EXPECT_EQ(error.get(), ECONNREFUSED);
+
+        client.shutdown();
+        upstream.shutdown();
+        client_loop.join();
+        upstream_loop.join();
+    }
+    cleanup_socket_library();
+}
+
+TEST(EpollServerTest, RunAfterCallbacksFireOnTheLoop) {
+    initialize_socket_library();
+
+    for (auto backend : {io_backend::epoll, io_backend::io_uring}) {
+        echo_server server(1, false, backend);
+        std::thread loop([&]() { server.listen(1000); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+        std::promise<std::thread::id> outer, inner;
+        auto scheduled = std::chrono::steady_clock::now();
+        std::chrono::steady_clock::duration waited{};
+        server.run_after(std::chrono::milliseconds(50), [&]() {
+            waited = std::chrono::steady_clock::now() - scheduled;
+            outer.set_value(std::this_thread::get_id());
+            // scheduled from the loop, runs on the same loop
+            server.run_after(std::chrono::milliseconds(0),
+                             [&]() { inner.set_value(std::this_thread::get_id()); });
+        });
+
+        auto outer_id = outer.get_future();
+        auto inner_id = inner.get_future();
+        ASSERT_EQ(inner_id.wait_for(std::chrono::seconds(2)), std::future_status::ready);
+        auto first = outer_id.get();
+        EXPECT_NE(first, std::this_thread::get_id());
+        EXPECT_EQ(inner_id.get(), first);
+        EXPECT_GE(waited, std::chrono::milliseconds(50));
+
+        // pending callbacks are dropped with the server
+        server.run_after(std::chrono::seconds(60), []() {});
+        server.shutdown();
+        loop.join();
+    }
+    cleanup_socket_library();
+}
+
+TEST(EpollServerTest, TlsHandshakeRunsBeforeAnyOutput) {
+    initialize_socket_library();
+
+    uint16_t port = static_cast<uint16_t>(get_random_free_port().value());
+    greeting_server server;
+    std::atomic<int> kernel_error{0};
+    server.set_tls([&](socket_t) {
+        return std::unique_ptr<tls_handshaker>(new scripted_handshaker(kernel_error.load()));
+    });
+    EXPECT_TRUE(server.register_listener_socket(make_listener_socket(port, "127.0.0.1")));
+    std::thread loop([&]() { server.listen(50); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    socket_address addr(ip_address("127.0.0.1"), cppress::sockets::port(port), family::ipv4());
+    auto read_all = [](connection& conn, std::size_t n) {
+        std::string got;
+        while (got.size() < n) {
+            auto chunk = conn.read();
+            if (chunk.empty())
+                break;
+            got += chunk.to_string();
+        }
+        return got;
+    };
+    {
+        // the banner waits for the handshake, data sent with the last flight is delivered
+        connection client(addr);
+        client.write(data_buffer("HEL"));
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        client.write(data_buffer("LO\nping"));
+        EXPECT_EQ(read_all(client, 19), "WELCOME\nbanner;ping");
+        client.write(data_buffer("pong"));
+        EXPECT_EQ(read_all(client, 4), "pong");
+    }
+    {
+        // without kernel TLS the connection is dropped after the handshake
+        kernel_error = ENOPROTOOPT;
+        connection client(addr);
+        client.write(data_buffer("HELLO\nping"));
+        EXPECT_EQ(read_all(client, 64), "WELCOME\n");
+    }
+
+    server.shutdown();
+    loop.join();
+    cleanup_socket_library();
+}
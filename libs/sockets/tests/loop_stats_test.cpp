@@ -0,0 +1,59 @@
+/**
+ * @file loop_stats_test.cpp
+ * @brief Unit tests for event loop counters
+ */
+
+#include "includes/loop_stats.hpp"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+
+using namespace cppress::sockets;
+
+TEST(LoopStatsTest, CountersAccumulateAndBucketFlushes) {
+    loop_counters counters;
+    counters.on_wakeup(3, 1000);
+    counters.on_wakeup(1, 500);
+    counters.on_handlers(200);
+    counters.on_read(10);
+    counters.on_flush(0, 0, false);
+    counters.on_flush(100, 100, false);
+    counters.on_flush(5 * 1024 * 1024, 1024, true);
+    counters.on_flush(64 << 20, 0, true);
+
+    loop_stats s = counters.snapshot();
+    EXPECT_EQ(s.wakeups, 2u);
+    EXPECT_EQ(s.events, 4u);
+    EXPECT_DOUBLE_EQ(s.events_per_wakeup(), 2.0);
+    EXPECT_EQ(s.wait_ns, 1500u);
+    EXPECT_EQ(s.handler_ns, 200u);
+    EXPECT_EQ(s.bytes_written, 1124u);
+    EXPECT_EQ(s.send_eagain, 2u);
+    EXPECT_EQ(s.outq_depth[0], 1u);  // empty queue
+    EXPECT_EQ(s.outq_depth[1], 1u);  // below 4 KiB
+    EXPECT_EQ(s.outq_depth[4], 1u);  // 1 to 16 MiB
+    EXPECT_EQ(s.outq_depth[5], 1u);  // 16 MiB and more
+
+    loop_stats total = s;
+    total += s;
+    EXPECT_EQ(total.events, 8u);
+    EXPECT_EQ(total.outq_depth[5], 2u);
+    EXPECT_DOUBLE_EQ(loop_stats{}.events_per_wakeup(), 0.0);
+}
+
+TEST(LoopStatsTest, SnapshotsAreReadableFromOtherThreads) {
+    loop_counters counters;
+    std::thread writer([&]() {
+        for (int i = 0; i < 100000; ++i)
+            counters.on_read(1);
+    });
+    std::uint64_t last = 0;
+    while (last < 100000) {
+        std::uint64_t now = counters.snapshot().bytes_read;
+        EXPECT_GE(now, last);  // a single writer's counter never goes backwards
+        last = now;
+    }
+    writer.join();
+    EXPECT_EQ(counters.snapshot().bytes_read, 100000u);
+}
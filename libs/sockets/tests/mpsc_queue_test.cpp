@@ -0,0 +1,60 @@
+/**
+ * @file mpsc_queue_test.cpp
+ * @brief Unit tests for the lock-free MPSC queue
+ */
+
+#include "includes/mpsc_queue.hpp"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+using namespace cppress::sockets;
+
+TEST(MpscQueueTest, DrainsInPushOrder) {
+    mpsc_queue<int> q;
+    EXPECT_TRUE(q.empty());
+    EXPECT_TRUE(q.push(1));   // first push reports a wakeup is needed
+    EXPECT_FALSE(q.push(2));  // consumer already has pending work
+    EXPECT_FALSE(q.push(3));
+
+    std::vector<int> seen;
+    EXPECT_EQ(q.drain([&](int& v) { seen.push_back(v); }), 3u);
+    EXPECT_EQ(seen, (std::vector<int>{1, 2, 3}));
+    EXPECT_TRUE(q.empty());
+    EXPECT_TRUE(q.push(4));
+}
+
+TEST(MpscQueueTest, ConcurrentProducersKeepPerProducerOrder) {
+    const int PRODUCERS = 4;
+    const int PER_PRODUCER = 5000;
+    mpsc_queue<std::pair<int, int>> q;
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < PRODUCERS; ++p) {
+        producers.emplace_back([&q, p]() {
+            for (int i = 0; i < PER_PRODUCER; ++i)
+                q.push({p, i});
+        });
+    }
+
+    std::vector<int> next(PRODUCERS, 0);
+    int total = 0;
+    bool ordered = true;
+    auto consume = [&](std::pair<int, int>& item) {
+        if (item.second != next[item.first])
+            ordered = false;
+        next[item.first] = item.second + 1;
+        ++total;
+    };
+    while (total < PRODUCERS * PER_PRODUCER) {
+        q.drain(consume);
+    }
+    for (auto& t : producers)
+        t.join();
+    q.drain(consume);
+
+    EXPECT_TRUE(ordered);
+    EXPECT_EQ(total, PRODUCERS * PER_PRODUCER);
+}
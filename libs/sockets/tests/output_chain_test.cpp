@@ -0,0 +1,217 @@
+/**
+ * @file output_chain_test.cpp
+ * @brief Unit tests for the scatter-gather output chain
+ */
+
+#include "includes/output_chain.hpp"
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <string>
+
+#include "includes/exceptions.hpp"
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+using namespace cppress::sockets;
+
+TEST(OutputChainTest, ConsumeAcrossSegments) {
+    output_chain chain;
+    chain.push(data_buffer(std::string("head")));
+    chain.push(data_buffer());  // empty segments are dropped
+    chain.push(data_buffer(std::string("body")));
+    EXPECT_EQ(chain.segment_count(), 2u);
+    EXPECT_EQ(chain.size(), 8u);
+
+    chain.consume(2);
+    EXPECT_EQ(chain.segment_count(), 2u);
+    EXPECT_EQ(chain.size(), 6u);
+
+    chain.consume(3);  // finishes "head", one byte into "body"
+    EXPECT_EQ(chain.segment_count(), 1u);
+    EXPECT_EQ(chain.size(), 3u);
+
+    chain.consume(3);
+    EXPECT_TRUE(chain.empty());
+    EXPECT_EQ(chain.segment_count(), 0u);
+}
+
+TEST(OutputChainTest, RvalueDataBufferIsNotCopied) {
+    std::string payload(1024, 'x');
+    const char* storage = payload.data();
+    data_buffer db(std::move(payload));
+    EXPECT_EQ(db.data(), storage);
+    EXPECT_EQ(db.release().data(), storage);
+    EXPECT_TRUE(db.empty());
+}
+
+#if !defined(_WIN32)
+TEST(OutputChainTest, FlushResumesAfterPartialWrites) {
+    int sv[2];
+    ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+    ::fcntl(sv[0], F_SETFL, ::fcntl(sv[0], F_GETFL) | O_NONBLOCK);
+    int small = 4096;
+    ::setsockopt(sv[0], SOL_SOCKET, SO_SNDBUF, &small, sizeof(small));
+
+    // more segments than one writev can take and more bytes than the socket buffer
+    output_chain chain;
+    std::string expected;
+    for (int i = 0; i < 3000; ++i) {
+        std::string part = std::to_string(i) + ",";
+        expected += part;
+        chain.push(data_buffer(std::move(part)));
+    }
+    expected += std::string(256 * 1024, 'z');
+    chain.push(data_buffer(std::string(256 * 1024, 'z')));
+
+    std::string received;
+    char buf[8192];
+    while (true) {
+        auto result = chain.flush(sv[0]);
+        ASSERT_NE(result, output_chain::flush_result::error);
+        ssize_t n;
+        while ((n = ::recv(sv[1], buf, sizeof(buf), MSG_DONTWAIT)) > 0)
+            received.append(buf, (size_t)n);
+        if (result == output_chain::flush_result::complete)
+            break;
+    }
+    ssize_t n;
+    while ((n = ::recv(sv[1], buf, sizeof(buf), MSG_DONTWAIT)) > 0)
+        received.append(buf, (size_t)n);
+
+    EXPECT_TRUE(chain.empty());
+    EXPECT_EQ(received, expected);
+    ::close(sv[0]);
+    ::close(sv[1]);
+}
+
+TEST(OutputChainTest, FileRegionsInterleaveWithMemorySegments) {
+    char path[] = "/tmp/output_chain_testXXXXXX";
+    int tmp = ::mkstemp(path);
+    ASSERT_GE(tmp, 0);
+    std::string contents;
+    for (int i = 0; i < 100000; ++i)
+        contents += static_cast<char>('a' + i % 26);
+    ASSERT_EQ(::write(tmp, contents.data(), contents.size()), (ssize_t)contents.size());
+    ::close(tmp);
+
+    file_region whole = file_region::open(path);
+    ::unlink(path);
+    EXPECT_EQ(whole.size(), contents.size());
+    file_region middle = whole.slice(10, 20);
+    EXPECT_EQ(middle.offset(), 10u);
+    EXPECT_EQ(middle.size(), 20u);
+    EXPECT_THROW(whole.slice(whole.size() + 1), std::out_of_range);
+    EXPECT_THROW(file_region::open("/nonexistent/output_chain_test"), socket_exception);
+
+    int sv[2];
+    ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+    ::fcntl(sv[0], F_SETFL, ::fcntl(sv[0], F_GETFL) | O_NONBLOCK);
+    int small = 4096;
+    ::setsockopt(sv[0], SOL_SOCKET, SO_SNDBUF, &small, sizeof(small));
+
+    output_chain chain;
+    chain.push(data_buffer(std::string("head|")));
+    chain.push(whole);
+    chain.push(data_buffer(std::string("|mid|")));
+    chain.push(middle);
+    chain.push(file_region());  // empty regions are dropped
+    chain.push(data_buffer(std::string("|tail")));
+    EXPECT_EQ(chain.segment_count(), 5u);
+    std::string expected =
+        "head|" + contents + "|mid|" + contents.substr(10, 20) + "|tail";
+    EXPECT_EQ(chain.size(), expected.size());
+
+    std::string received;
+    char buf[8192];
+    while (true) {
+        auto result = chain.flush(sv[0]);
+        ASSERT_NE(result, output_chain::flush_result::error);
+        ssize_t n;
+        while ((n = ::recv(sv[1], buf, sizeof(buf), MSG_DONTWAIT)) > 0)
+            received.append(buf, (size_t)n);
+        if (result == output_chain::flush_result::complete)
+            break;
+    }
+    ssize_t n;
+    while ((n = ::recv(sv[1], buf, sizeof(buf), MSG_DONTWAIT)) > 0)
+        received.append(buf, (size_t)n);
+
+    EXPECT_TRUE(chain.empty());
+    EXPECT_EQ(received, expected);
+    ::close(sv[0]);
+    ::close(sv[1]);
+}
+#endif
+
+#if defined(__linux__) && defined(MSG_ZEROCOPY)
+TEST(OutputChainTest, ZerocopySendsKeepBuffersUntilNotified) {
+    // zero-copy needs a TCP socket, AF_UNIX rejects SO_ZEROCOPY
+    int listener = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    ASSERT_EQ(::bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+    ASSERT_EQ(::getsockname(listener, reinterpret_cast<sockaddr*>(&addr), &len), 0);
+    ASSERT_EQ(::listen(listener, 1), 0);
+    int sender = ::socket(AF_INET, SOCK_STREAM, 0);
+    ASSERT_EQ(::connect(sender, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+    int receiver = ::accept(listener, nullptr, nullptr);
+    ASSERT_GE(receiver, 0);
+    ::fcntl(sender, F_SETFL, ::fcntl(sender, F_GETFL) | O_NONBLOCK);
+
+    std::string expected;
+    for (int i = 0; i < 512 * 1024; ++i)
+        expected += static_cast<char>('a' + i % 26);
+    output_chain chain;
+    chain.push(data_buffer(std::string("small|")));  // below the threshold with the rest
+    chain.push(data_buffer(std::string(expected)));
+    expected = "small|" + expected;
+
+    std::string received;
+    char buf[65536];
+    bool used_zerocopy = false;
+    while (true) {
+        auto result = chain.flush(sender, 64 * 1024);
+        ASSERT_NE(result, output_chain::flush_result::error);
+        used_zerocopy = used_zerocopy || chain.zerocopy_pending();
+        ssize_t n;
+        while ((n = ::recv(receiver, buf, sizeof(buf), MSG_DONTWAIT)) > 0)
+            received.append(buf, (size_t)n);
+        if (result == output_chain::flush_result::complete)
+            break;
+    }
+    ssize_t n;
+    while ((n = ::recv(receiver, buf, sizeof(buf), MSG_DONTWAIT)) > 0)
+        received.append(buf, (size_t)n);
+    EXPECT_TRUE(chain.empty());
+    EXPECT_EQ(received, expected);
+
+    if (!used_zerocopy) {
+        ::close(sender);
+        ::close(receiver);
+        ::close(listener);
+        GTEST_SKIP() << "SO_ZEROCOPY is not supported here";
+    }
+    // notifications arrive on the error queue and release the pinned buffers
+    for (int i = 0; i < 50 && chain.zerocopy_pending(); ++i) {
+        pollfd p{sender, 0, 0};
+        ::poll(&p, 1, 100);
+        if (p.revents & POLLERR)
+            chain.reap_zerocopy(sender);
+    }
+    EXPECT_FALSE(chain.zerocopy_pending());
+    ::close(sender);
+    ::close(receiver);
+    ::close(listener);
+}
+#endif
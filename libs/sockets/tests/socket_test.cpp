@@ -236,3 +236,64 @@ TEST(SocketTest, MultithreadedSocketOperationsThreadSafety) {
 
     cleanup_socket_library();
 }
+
+#if defined(__linux__) || defined(__linux)
+TEST(SocketTest, DatagramBatchesMoveManyPacketsPerCall) {
+    initialize_socket_library();
+
+    uint16_t port = static_cast<uint16_t>(get_random_free_port().value());
+    socket_address receiver_addr(ip_address("127.0.0.1"), cppress::sockets::port(port),
+                                 family::ipv4());
+    cppress::sockets::socket receiver(receiver_addr, cppress::sockets::socket::type::datagram);
+    cppress::sockets::socket sender(family::ipv4(), cppress::sockets::socket::type::datagram);
+
+    datagram_batch out(16, 256);
+    for (int i = 0; i < 10; ++i) {
+        std::string msg = "packet " + std::to_string(i);
+        EXPECT_TRUE(out.push(receiver_addr, msg.data(), msg.size()));
+    }
+    EXPECT_FALSE(out.push(receiver_addr, std::string(300, 'x').data(), 300));  // exceeds a slot
+    EXPECT_EQ(sender.send_batch(out), 10u);
+
+    datagram_batch in(16, 256);
+    std::size_t received = 0;
+    std::vector<std::string> payloads;
+    while (received < 10) {
+        std::size_t n = receiver.receive_batch(in);
+        ASSERT_GT(n, 0u);
+        for (std::size_t i = 0; i < n; ++i)
+            payloads.emplace_back(in.payload(i));
+        received += n;
+    }
+    ASSERT_EQ(payloads.size(), 10u);
+    for (int i = 0; i < 10; ++i)
+        EXPECT_EQ(payloads[i], "packet " + std::to_string(i));
+    EXPECT_EQ(in.peer(0).address().string(), "127.0.0.1");
+
+    // nothing queued: a non-waiting receive returns at once
+    EXPECT_EQ(receiver.receive_batch(in, false), 0u);
+    EXPECT_TRUE(in.empty());
+
+    // one 3000 byte slot split into 1000 byte datagrams by the kernel
+    datagram_batch big(1, 4096);
+    std::string payload(3000, 'g');
+    ASSERT_TRUE(big.push(receiver_addr, payload.data(), payload.size(), 1000));
+    datagram_batch segments_in(8, 2048);
+    std::size_t segments = 0;
+    try {
+        sender.send_batch(big);
+        for (std::size_t got = 0; got < 3000;) {
+            receiver.receive_batch(segments_in);
+            for (std::size_t i = 0; i < segments_in.size(); ++i, ++segments) {
+                EXPECT_EQ(segments_in.payload(i).size(), 1000u);
+                got += segments_in.payload(i).size();
+            }
+        }
+    } catch (const socket_exception&) {
+        cleanup_socket_library();
+        GTEST_SKIP() << "UDP GSO is not supported here";
+    }
+    EXPECT_EQ(segments, 3u);
+    cleanup_socket_library();
+}
+#endif
@@ -0,0 +1,113 @@
+/**
+ * @file timer_wheel_test.cpp
+ * @brief Unit tests for the hierarchical timer wheel
+ */
+
+#include "includes/timer_wheel.hpp"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <vector>
+
+using namespace cppress::sockets;
+using namespace std::chrono_literals;
+
+TEST(TimerWheelTest, FiresInDeadlineOrderAndCancels) {
+    timer_wheel wheel(10ms);
+    auto start = timer_wheel::clock::now();
+
+    timer_node a(1, 0), b(2, 0), c(3, 0);
+    wheel.arm(a, 50ms);
+    wheel.arm(b, 20ms);
+    wheel.arm(c, 30ms);
+    EXPECT_EQ(wheel.size(), 3u);
+
+    wheel.cancel(c);
+    wheel.cancel(c);  // cancelling twice is a no-op
+    EXPECT_FALSE(c.armed());
+    EXPECT_EQ(wheel.size(), 2u);
+
+    std::vector<int> fired;
+    auto collect = [&](timer_node& n) { fired.push_back(n.fd); };
+    EXPECT_EQ(wheel.advance(start + 15ms, collect), 0u);
+    EXPECT_EQ(wheel.advance(start + 100ms, collect), 2u);
+    EXPECT_EQ(fired, (std::vector<int>{2, 1}));
+    EXPECT_EQ(wheel.size(), 0u);
+    EXPECT_FALSE(a.armed());
+}
+
+TEST(TimerWheelTest, LongDeadlinesCascadeDown) {
+    timer_wheel wheel(1ms);
+    auto start = timer_wheel::clock::now();
+
+    // spread over every level: 256 ticks, 64 * 256 ticks, 64 * 64 * 256 ticks
+    timer_node near(1, 0), mid(2, 0), far(3, 0), rearmed(4, 0);
+    wheel.arm(near, 100ms);
+    wheel.arm(mid, 5000ms);
+    wheel.arm(far, 200000ms);
+    wheel.arm(rearmed, 1000ms);
+    wheel.arm(rearmed, 300000ms);  // re-arming replaces the old deadline
+    EXPECT_EQ(wheel.size(), 4u);
+
+    std::vector<int> fired;
+    auto collect = [&](timer_node& n) { fired.push_back(n.fd); };
+    wheel.advance(start + 4999ms, collect);
+    EXPECT_EQ(fired, (std::vector<int>{1}));
+    wheel.advance(start + 5001ms, collect);
+    EXPECT_EQ(fired, (std::vector<int>{1, 2}));
+    wheel.advance(start + 199990ms, collect);
+    EXPECT_EQ(fired.size(), 2u);
+    wheel.advance(start + 200010ms, collect);
+    EXPECT_EQ(fired, (std::vector<int>{1, 2, 3}));
+    wheel.advance(start + 300010ms, collect);
+    EXPECT_EQ(fired, (std::vector<int>{1, 2, 3, 4}));
+}
+
+TEST(TimerWheelTest, NextTimeoutTracksEarliestDeadline) {
+    timer_wheel wheel(10ms);
+    auto now = timer_wheel::clock::now();
+    EXPECT_EQ(wheel.next_timeout(now, 1000), 1000);
+    EXPECT_EQ(wheel.next_timeout(now, -1), -1);
+
+    timer_node t(1, 0);
+    wheel.arm(t, 100ms);
+    int wait = wheel.next_timeout(now, 1000);
+    EXPECT_GT(wait, 80);
+    EXPECT_LE(wait, 110);
+    EXPECT_EQ(wheel.next_timeout(now, 50), 50);
+
+    // callbacks may re-arm the timer that fired
+    int fired = 0;
+    wheel.advance(now + 200ms, [&](timer_node& n) {
+        if (++fired == 1)
+            wheel.arm(n, 500ms);
+    });
+    EXPECT_EQ(fired, 1);
+    EXPECT_TRUE(t.armed());
+    wheel.cancel(t);
+}
+
+TEST(TimerWheelTest, ArmAtIsIndependentOfTheLastAdvance) {
+    timer_wheel wheel(10ms);
+    auto start = timer_wheel::clock::now();
+
+    // both armed "at" start + 100ms without an advance since start
+    timer_node relative(1, 0), absolute(2, 0);
+    wheel.arm(relative, 50ms);
+    wheel.arm_at(absolute, start + 100ms + 50ms);
+
+    std::vector<int> fired;
+    auto collect = [&](timer_node& n) { fired.push_back(n.fd); };
+    wheel.advance(start + 60ms, collect);
+    EXPECT_EQ(fired, (std::vector<int>{1})) << "arm() counts from the last advance";
+    wheel.advance(start + 145ms, collect);
+    EXPECT_EQ(fired.size(), 1u);
+    // rounded up to the tick after start + 150ms, as the wheel started just before start
+    wheel.advance(start + 160ms, collect);
+    EXPECT_EQ(fired, (std::vector<int>{1, 2}));
+
+    // a time already past fires on the next tick
+    wheel.arm_at(absolute, start);
+    EXPECT_EQ(wheel.advance(start + 170ms, collect), 1u);
+}
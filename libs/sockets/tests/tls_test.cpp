@@ -0,0 +1,65 @@
+/**
+ * @file tls_test.cpp
+ * @brief Unit tests for kernel TLS installation
+ */
+
+#include "includes/tls.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cerrno>
+
+#if !defined(_WIN32)
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+using namespace cppress::sockets;
+
+#if !defined(_WIN32)
+namespace {
+/// Connected loopback TCP socket, the listener is closed right away
+int connected_socket() {
+    int server = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    ::bind(server, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    ::listen(server, 1);
+    ::getsockname(server, reinterpret_cast<sockaddr*>(&addr), &len);
+    int client = ::socket(AF_INET, SOCK_STREAM, 0);
+    ::connect(client, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    ::close(server);
+    return client;
+}
+
+ktls_crypto aes128() {
+    ktls_crypto k;
+    k.key = std::string(16, 'k');
+    k.iv = std::string(8, 'i');
+    k.salt = std::string(4, 's');
+    return k;
+}
+}  // namespace
+
+TEST(TlsTest, InstallReportsMissingKernelSupportOrBadKeys) {
+    int fd = connected_socket();
+    ASSERT_GE(fd, 0);
+    int error = install_ktls(fd, aes128(), aes128());
+    ::close(fd);
+    if (!ktls_available()) {
+        EXPECT_TRUE(error == ENOENT || error == ENOPROTOOPT || error == ENOTSUP) << error;
+        GTEST_SKIP() << "kernel TLS is not available";
+    }
+    EXPECT_EQ(error, 0);
+
+    // sizes that do not match the cipher are refused before reaching the kernel
+    fd = connected_socket();
+    ktls_crypto bad = aes128();
+    bad.key.resize(15);
+    EXPECT_EQ(install_ktls(fd, bad, aes128()), EINVAL);
+    ::close(fd);
+}
+#endif
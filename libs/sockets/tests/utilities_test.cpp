@@ -6,16 +6,20 @@
 #include "includes/utilities.hpp"
 
 #include <gtest/gtest.h>
+#include <netinet/tcp.h>
 
+#include <chrono>
 #include <cstring>
 #include <memory>
 #include <thread>
 
+#include "includes/connection.hpp"
 #include "includes/family.hpp"
 #include "includes/ip_address.hpp"
 #include "includes/port.hpp"
 #include "includes/socket.hpp"
 #include "includes/socket_address.hpp"
+#include "includes/socket_options.hpp"
 
 using namespace cppress::sockets;
 
@@ -317,3 +321,32 @@ TEST(UtilitiesTest, MakeListenerSocket_ValidParameters) {
         EXPECT_TRUE(listener->is_open());
     }
 }
+
+TEST(UtilitiesTest, MakeListenerSocket_AppliesOptionsInheritedByAcceptedSockets) {
+    initialize_socket_library();
+    port p = get_random_free_port();
+
+    auto options = socket_options::low_latency();
+    options.receive_buffer = 256 * 1024;
+    auto listener = make_listener_socket(p.to_int(), "127.0.0.1", SOMAXCONN, options);
+    ASSERT_TRUE(listener->is_open());
+
+    connection client(socket_address(ip_address("127.0.0.1"), p, family::ipv4()));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    int accepted = -1;
+    for (int i = 0; i < 20 && accepted < 0; ++i) {
+        accepted = ::accept(listener->native_handle(), nullptr, nullptr);
+        if (accepted < 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_GE(accepted, 0);
+    EXPECT_TRUE(options.apply_to_accepted(accepted));
+
+    int value = 0;
+    socklen_t len = sizeof(value);
+    ASSERT_EQ(::getsockopt(accepted, IPPROTO_TCP, TCP_NODELAY, &value, &len), 0);
+    EXPECT_NE(value, 0);
+    ASSERT_EQ(::getsockopt(accepted, SOL_SOCKET, SO_RCVBUF, &value, &len), 0);
+    EXPECT_GE(value, options.receive_buffer);
+    close_socket(accepted);
+}
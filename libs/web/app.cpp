@@ -306,8 +306,10 @@ cppress::web::exit_code index_handler(std::shared_ptr<cppress::web::request> req
                 <ul>
                     <li><strong>GET /api/items</strong> - Retrieve all items</li>
                     <li><strong>GET /api/items/:id</strong> - Retrieve a specific item by ID</li>
-                    <li><strong>POST /api/items</strong> - Create a new item (JSON body required)</li>
-                    <li><strong>PUT /api/items/:id</strong> - Update an existing item by ID (JSON body required)</li>
+                    <li><strong>POST /api/items</strong> - Create a new item
+                        (JSON body required)</li>
+                    <li><strong>PUT /api/items/:id</strong> - Update an existing item by ID
+                        (JSON body required)</li>
                     <li><strong>DELETE /api/items/:id</strong> - Delete an item by ID</li>
                 </ul>
                 <h2>Example JSON Body for POST/PUT:</h2>
@@ -470,7 +472,8 @@ int main() {
             cppress::shared::logger::info("Headers received");
             cppress::shared::logger::info(method + " " + uri + " " + version);
             for (const auto& [key, value] : headers) {
-                cppress::shared::logger::info("Header: " + key + " = " + value);
+                cppress::shared::logger::info("Header: " + std::string(key) + " = " +
+                                              std::string(value));
             }
         });
 
@@ -183,6 +183,7 @@
  * @li Each request is queued to worker pool (non-blocking)
  * @li Static file serving reads from disk (consider caching)
  * @li Keep-alive connections reduce overhead for multiple requests
+ * @li Request/response objects are allocated from recycled blocks (object_pool.hpp)
  * @li Route matching is O(n)
  where n is number of routes** @author cppress team* @version 1.0
 
@@ -190,11 +191,22 @@
 
 #pragma once
 
+#include "includes/cluster.hpp"
+#include "includes/compression.hpp"
 #include "includes/exceptions.hpp"
+#include "includes/object_pool.hpp"
+#include "includes/proxy.hpp"
+#include "includes/rate_limiter.hpp"
 #include "includes/request.hpp"
+#include "includes/request_arena.hpp"
 #include "includes/response.hpp"
+#include "includes/response_cache.hpp"
 #include "includes/route.hpp"
+#include "includes/route_metrics.hpp"
 #include "includes/router.hpp"
 #include "includes/server.hpp"
+#include "includes/static_file_cache.hpp"
+#include "includes/static_manifest.hpp"
+#include "includes/tracing.hpp"
 #include "includes/types.hpp"
 #include "includes/utilities.hpp"
@@ -0,0 +1,294 @@
+/**
+ * @file cluster.hpp
+ * @brief Prefork worker processes behind one port, with rolling reloads
+ *
+ * A cluster runs as a supervisor that forks a number of worker processes.
+ * Each worker builds its own server after the fork, so processes share no
+ * heap and no allocator locks; their listeners join one SO_REUSEPORT group
+ * and the kernel spreads connections over them. The supervisor restarts
+ * workers that crash or exit. What workers do share, they share through
+ * a shared_memory_cache the supervisor maps before forking
+ * (cluster_options::shared_cache_bytes): serve() connects a web::server's
+ * response caches to it, so a response one worker cached is a hit for
+ * all. Static files are not put in it: the segment hands out copies, so
+ * every worker would still hold each file, and the page cache already
+ * keeps one copy for all of them. Each worker's static_file_cache stays
+ * its own.
+ *
+ * On SIGHUP the workers are replaced one at a time: a new worker starts,
+ * and once its listener is open the worker it replaces is sent SIGTERM.
+ * That worker drains (epoll_server::drain()): its listener leaves the
+ * group, keep-alive connections are closed as soon as their responses are
+ * out, requests arriving meanwhile are answered with Connection: close, and
+ * it exits when no connection is left or the drain timeout passes. The
+ * port is never without a listener, so clients see neither refused
+ * connections nor a cold pool of processes.
+ *
+ * SIGTERM or SIGINT to the supervisor drains every worker and returns from
+ * run() once they have exited.
+ *
+ * @section cluster_usage Usage Example
+ * @code{.cpp}
+ * int main() {
+ *     cppress::web::cluster_options options;
+ *     options.workers = 4;
+ *     options.drain_timeout = std::chrono::seconds(20);
+ *
+ *     cppress::web::cluster cluster(
+ *         [](cppress::web::cluster_worker& worker) {
+ *             cppress::web::server<> app(8080, "0.0.0.0");
+ *             app.get("/", {[](auto req, auto res) {
+ *                 res->send_text("hello");
+ *                 return cppress::web::exit_code::EXIT;
+ *             }});
+ *             worker.serve(app);  // returns once drained
+ *             return 0;
+ *         },
+ *         options);
+ *     return cluster.run();  // kill -HUP <pid> reloads, kill -TERM <pid> stops
+ * }
+ * @endcode
+ *
+ * @note run() forks: call it before anything in the process starts threads
+ * @note Linux only (signalfd, SO_REUSEPORT load balancing)
+ *
+ * @author cppress team
+ * @version 1.0
+ */
+
+#pragma once
+
+#include <sys/types.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "shared/includes/shared_memory_cache.hpp"
+
+namespace cppress::web {
+
+/**
+ * @brief Size and timing of a cluster
+ */
+struct cluster_options {
+    /// Worker processes, one per hardware thread when 0
+    std::size_t workers = 0;
+
+    /// Time a worker told to stop has to finish its connections
+    std::chrono::milliseconds drain_timeout = std::chrono::seconds(30);
+
+    /// Time a new worker has to open its listener before the reload is given up
+    std::chrono::milliseconds ready_timeout = std::chrono::seconds(10);
+
+    /// Time before a crashed worker is started again
+    std::chrono::milliseconds restart_delay = std::chrono::seconds(1);
+
+    /**
+     * Size of a shared_memory_cache the supervisor maps before the first
+     * fork, see cluster_worker::shared_cache(); 0 for none. serve() shares
+     * a web::server's cached responses through it.
+     */
+    std::size_t shared_cache_bytes = 0;
+};
+
+/// Whether a server can share its cached responses, see cluster_worker::serve()
+template <typename S, typename = void>
+struct shares_responses : std::false_type {};
+
+template <typename S>
+struct shares_responses<S, std::void_t<decltype(std::declval<S&>().share_response_cache(
+                               static_cast<shared::shared_memory_cache*>(nullptr)))>>
+    : std::true_type {};
+
+/**
+ * @class cluster_worker
+ * @brief What a worker process knows about its place in the cluster
+ *
+ * Passed to the worker function in the child process after the fork.
+ */
+class cluster_worker {
+public:
+    cluster_worker(const cluster_worker&) = delete;
+    cluster_worker& operator=(const cluster_worker&) = delete;
+    ~cluster_worker();
+
+    /// @brief Slot of the worker, from 0 to workers - 1; a replacement takes over the slot
+    std::size_t index() const noexcept { return slot; }
+
+    /// @brief Increases with every worker the supervisor starts
+    std::uint64_t generation() const noexcept { return serial; }
+
+    /// @brief Time the worker has to drain once told to stop
+    std::chrono::milliseconds drain_timeout() const noexcept { return drain; }
+
+    /**
+     * @brief The cache every worker of the cluster maps
+     * @return nullptr unless cluster_options::shared_cache_bytes was set
+     *
+     * The supervisor holds the mapping, so entries outlive the workers
+     * that stored them, across crashes and reloads.
+     */
+    shared::shared_memory_cache* shared_cache() const noexcept { return cache; }
+
+    /**
+     * @brief Tell the supervisor the worker accepts connections
+     *
+     * During a reload the worker being replaced is only stopped after
+     * this. Called by serve(); later calls do nothing.
+     */
+    void ready() noexcept;
+
+    /**
+     * @brief Run a server until the supervisor stops this worker
+     * @param server A server whose listeners are open, e.g. a web::server
+     *
+     * Reports the worker ready and calls server.listen(). SIGTERM or SIGINT
+     * drains the server with drain_timeout(); serve() then calls
+     * server.stop() and returns. A server with share_response_cache(), as a
+     * web::server, is given shared_cache() first when the cluster has one.
+     */
+    template <typename S>
+    void serve(S& server) {
+        if constexpr (shares_responses<S>::value)
+            if (cache)
+                server.share_response_cache(cache);
+        watch([&server, timeout = drain]() { server.drain(timeout); });
+        ready();
+        try {
+            server.listen();
+        } catch (...) {
+            unwatch();
+            throw;
+        }
+        unwatch();
+        server.stop();
+    }
+
+private:
+    friend class cluster;
+
+    cluster_worker(std::size_t slot, std::uint64_t serial, int ready_fd,
+                   std::chrono::milliseconds drain, shared::shared_memory_cache* cache)
+        : slot(slot), serial(serial), ready_fd(ready_fd), drain(drain), cache(cache) {}
+
+    /// Starts a thread waiting for SIGTERM or SIGINT, which calls on_stop
+    void watch(std::function<void()> on_stop);
+
+    /// Ends the thread started by watch()
+    void unwatch();
+
+    std::size_t slot;
+    std::uint64_t serial;
+
+    /// Write end of the pipe the supervisor waits on, -1 once ready
+    int ready_fd;
+
+    std::chrono::milliseconds drain;
+    shared::shared_memory_cache* cache;
+    std::thread watcher;
+
+    /// unwatch() woke the watcher, it returns without calling on_stop
+    std::atomic<bool> unwatching{false};
+};
+
+/**
+ * @class cluster
+ * @brief Supervisor of prefork worker processes
+ */
+class cluster {
+public:
+    /// Body of a worker process; its return value is the process's exit status
+    using worker_function = std::function<int(cluster_worker&)>;
+
+    /**
+     * @param worker Run in every worker process after the fork
+     * @param options Worker count and timing
+     */
+    explicit cluster(worker_function worker, cluster_options options = {});
+
+    cluster(const cluster&) = delete;
+    cluster& operator=(const cluster&) = delete;
+
+    /**
+     * @brief Start the workers and supervise them until SIGTERM or SIGINT
+     * @return 0 once every worker has exited
+     * @throws std::runtime_error if the signal descriptor or the shared cache cannot be created
+     *
+     * A worker that cannot be forked is retried like a crashed one.
+     * SIGCHLD, SIGHUP, SIGTERM and SIGINT are blocked while it runs and
+     * read through a signalfd. Workers inherit the mask; serve() waits for
+     * the stop signals on a thread of its own.
+     */
+    int run();
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    /// One worker process
+    struct process {
+        pid_t pid = -1;
+        std::size_t slot = 0;
+        std::uint64_t serial = 0;
+
+        /// Read end of the readiness pipe, -1 once it was read or closed
+        int ready_fd = -1;
+
+        /// The worker reported its listener open
+        bool ready = false;
+
+        /// SIGTERM was sent, the process is draining
+        bool retiring = false;
+
+        /// Until ready: when starting is given up; retiring: when SIGKILL follows
+        clock::time_point deadline;
+    };
+
+    /// Forks a worker for a slot, nullptr if that failed
+    process* spawn(std::size_t slot);
+
+    /// Whether a worker other than pid serves a slot and is not retiring
+    bool slot_served(std::size_t slot, pid_t except) const;
+
+    /// Collects exited workers and schedules restarts
+    void reap(clock::time_point now);
+
+    /// Sends SIGTERM, and SIGKILL if the process is still there after the drain timeout
+    void retire(process& p, clock::time_point now);
+
+    /// Starts the next replacement of a reload, or retires the worker one has replaced
+    void advance_reload(clock::time_point now);
+
+    /// Abandons the reload in progress, the remaining workers keep serving
+    void abort_reload(const char* why);
+
+    worker_function worker;
+    cluster_options options;
+
+    std::deque<process> processes;
+
+    /// Per slot: when a crashed worker is started again, clock::time_point::max() if not due
+    std::vector<clock::time_point> restart_at;
+
+    /// Slots still to replace in the reload in progress
+    std::deque<std::size_t> reload_queue;
+
+    /// Worker started by the reload and not ready yet, -1 if none
+    pid_t replacement = -1;
+
+    /// Made by the first run() when shared_cache_bytes is set, mapped by every worker
+    std::unique_ptr<shared::shared_memory_cache> cache;
+
+    std::uint64_t next_serial = 0;
+    int signal_fd = -1;
+    bool stopping = false;
+};
+}  // namespace cppress::web
@@ -0,0 +1,143 @@
+/**
+ * @file compression.hpp
+ * @brief Response compression for routes and static files
+ *
+ * Dynamic responses are compressed by the compression() middleware, which
+ * negotiates a coding from Accept-Encoding and hands it to the response;
+ * register it on the server, on a router, or on a single route. Static
+ * files are compressed through a static_variant_cache, enabled with
+ * server::use_static_compression(), so a file is encoded at most once.
+ *
+ * @section compression_usage Usage Example
+ * @code{.cpp}
+ * // every dynamic response of the base router
+ * server->use(cppress::web::compression());
+ *
+ * // one route, with its own threshold
+ * router->get("/api/report", {cppress::web::compression({6, 512}), report_handler});
+ *
+ * // static files: .br / .gz siblings, or variants generated on first use
+ * server->use_static_compression();
+ * @endcode
+ *
+ * @author cppress team
+ * @version 1.0
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include "http/includes.hpp"
+#include "types.hpp"
+
+namespace cppress::web {
+
+/**
+ * @brief Settings of the compression() middleware and of static compression
+ */
+struct compression_options {
+    /// Encoder level, DEFAULT_COMPRESSION_LEVEL for the coding's default
+    int level = cppress::http::DEFAULT_COMPRESSION_LEVEL;
+
+    /// Bodies (or files) smaller than this are sent as they are
+    std::size_t min_size = 1024;
+};
+
+/**
+ * @brief Middleware that compresses the response of the routes it runs for
+ * @param options Level and size threshold
+ * @return A handler that negotiates a coding and continues
+ *
+ * The coding is the client's most preferred of the compiled-in ones (br,
+ * zstd, gzip); the body is encoded when it is sent, so handlers are unchanged.
+ */
+template <typename T = request, typename G = response>
+request_handler_t<T, G> compression(const compression_options& options = {}) {
+    return [options](const std::shared_ptr<T>& req, const std::shared_ptr<G>& res) -> exit_code {
+        res->set_compression(cppress::http::negotiate_content_coding(req->get_header_fields()),
+                             options.level, options.min_size);
+        return exit_code::CONTINUE;
+    };
+}
+
+/**
+ * @class static_variant_cache
+ * @brief Encoded variants of static files, kept in memory
+ *
+ * A variant comes from a precompressed sibling (style.css.br, style.css.gz,
+ * style.css.zst) when one exists and is not older than the file, otherwise
+ * from compressing the file once. Either way it is cached until the file's
+ * modification time or size changes. Thread-safe.
+ */
+class static_variant_cache {
+public:
+    /// An encoded file; body is null when no coding applies
+    struct variant {
+        cppress::http::content_coding coding = cppress::http::content_coding::identity;
+        std::shared_ptr<const std::string> body;
+    };
+
+    /**
+     * @param options Level for generated variants; files below min_size are never encoded
+     * @param max_bytes Memory budget, the oldest variants are dropped past it
+     */
+    explicit static_variant_cache(const compression_options& options = {},
+                                  std::size_t max_bytes = 64 * 1024 * 1024);
+
+    /**
+     * @brief The variant of a file to answer a request with
+     * @param file_path Path of the identity file
+     * @param request_headers Headers whose Accept-Encoding fields are honoured
+     * @return The best accepted variant that exists or could be generated
+     */
+    variant find(const std::string& file_path, const cppress::http::http_headers& request_headers);
+
+    /**
+     * @brief The variant of a file whose modification time and size are already known
+     * @param modified Modification time of the identity file
+     * @param file_size Size of the identity file
+     *
+     * Lets a caller that keeps its own copy of the file's metadata (see
+     * static_file_cache) skip the stat find() does.
+     */
+    variant find(const std::string& file_path, const cppress::http::http_headers& request_headers,
+                 std::filesystem::file_time_type modified, std::uintmax_t file_size);
+
+    /// @brief Bytes of encoded bodies currently held
+    std::size_t size() const;
+
+private:
+    struct entry {
+        std::filesystem::file_time_type modified;
+        std::uintmax_t file_size;
+        std::shared_ptr<const std::string> body;
+    };
+
+    using key = std::pair<std::string, cppress::http::content_coding>;
+
+    /// Sibling or freshly encoded body, null if neither is possible
+    std::shared_ptr<const std::string> load(const std::string& file_path,
+                                            cppress::http::content_coding coding,
+                                            std::filesystem::file_time_type modified) const;
+
+    void insert(const key& k, entry e);
+
+    compression_options options;
+    std::size_t max_bytes;
+
+    mutable std::mutex mutex;
+    std::map<key, entry> entries;
+    /// Keys in insertion order, for eviction
+    std::list<key> order;
+    std::size_t bytes = 0;
+};
+}  // namespace cppress::web
@@ -0,0 +1,147 @@
+#pragma once
+
+/**
+ * @file object_pool.hpp
+ * @brief Recycled storage for the per-request request and response objects
+ *
+ * Every request builds a request and a response object that live until the
+ * worker answering it lets go of them. With std::allocate_shared and a
+ * pool_allocator, the block holding the object and its reference counts is
+ * taken from a free list and returned to it instead of going through the
+ * heap, so a keep-alive connection reuses the same few blocks request after
+ * request:
+ *
+ * @code
+ * auto req = std::allocate_shared<T>(pool_allocator<T>(), std::move(request));
+ * @endcode
+ *
+ * Only the storage is recycled; each object is still constructed and
+ * destroyed as usual.
+ */
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace cppress::web {
+
+/**
+ * @brief Thread-safe free list of equally sized blocks
+ *
+ * Blocks are usually taken on the event loop and given back on a worker
+ * thread, which defeats the allocator's per-thread caches; the free list
+ * serves both sides.
+ */
+class block_pool {
+private:
+    mutable std::mutex mutex;
+    std::vector<void*> free_blocks;
+    std::size_t size;
+    std::size_t max_free;
+
+public:
+    /**
+     * @brief Creates a pool
+     * @param size Size in bytes of every block
+     * @param max_free Maximum number of idle blocks kept for reuse
+     */
+    block_pool(std::size_t size, std::size_t max_free) : size(size), max_free(max_free) {}
+
+    block_pool(const block_pool&) = delete;
+    block_pool& operator=(const block_pool&) = delete;
+
+    ~block_pool() {
+        for (void* block : free_blocks)
+            ::operator delete(block);
+    }
+
+    /// @brief Takes a block from the free list, allocating one if it is empty
+    void* acquire() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!free_blocks.empty()) {
+                void* block = free_blocks.back();
+                free_blocks.pop_back();
+                return block;
+            }
+        }
+        return ::operator new(size);
+    }
+
+    /// @brief Returns a block; blocks beyond max_free are freed instead
+    void release(void* block) noexcept {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (free_blocks.size() < max_free) {
+                try {
+                    free_blocks.push_back(block);
+                    return;
+                } catch (const std::bad_alloc&) {
+                }
+            }
+        }
+        ::operator delete(block);
+    }
+
+    /// @brief Number of idle blocks currently held
+    std::size_t free_count() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return free_blocks.size();
+    }
+};
+
+/**
+ * @brief Allocator drawing single objects from a block_pool per type
+ *
+ * Meant for std::allocate_shared, which allocates exactly one block per
+ * object; arrays fall back to the heap. The pool of a type is never
+ * destroyed, so objects released during static destruction are still safe.
+ */
+template <typename T>
+class pool_allocator {
+public:
+    using value_type = T;
+
+    /// Idle blocks kept per type, enough for a burst of pipelined requests
+    static constexpr std::size_t max_free = 1024;
+
+    pool_allocator() noexcept = default;
+
+    template <typename U>
+    pool_allocator(const pool_allocator<U>&) noexcept {}
+
+    /// @brief The free list shared by every allocator of T
+    static block_pool& pool() {
+        static block_pool* blocks = new block_pool(sizeof(T), max_free);
+        return *blocks;
+    }
+
+    T* allocate(std::size_t n) {
+        static_assert(alignof(T) <= alignof(std::max_align_t),
+                      "pool_allocator does not support over-aligned types");
+        if (n != 1)
+            return std::allocator<T>().allocate(n);
+        return static_cast<T*>(pool().acquire());
+    }
+
+    void deallocate(T* p, std::size_t n) noexcept {
+        if (n != 1)
+            std::allocator<T>().deallocate(p, n);
+        else
+            pool().release(p);
+    }
+
+    template <typename U>
+    bool operator==(const pool_allocator<U>&) const noexcept {
+        return true;
+    }
+
+    template <typename U>
+    bool operator!=(const pool_allocator<U>&) const noexcept {
+        return false;
+    }
+};
+
+}  // namespace cppress::web
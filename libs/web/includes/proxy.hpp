@@ -0,0 +1,266 @@
+/**
+ * @file proxy.hpp
+ * @brief Reverse proxy routes balancing requests over pooled upstreams
+ *
+ * A reverse_proxy forwards the requests of a route to one of several
+ * upstream servers. The forwarding runs on the event loops with
+ * epoll_server::connect_async(): the handler returns at once with the
+ * response deferred, and connections are handed back to the loops' keyed
+ * idle pools when the upstream keeps them alive, so a busy route reuses
+ * a handful of warm connections per upstream.
+ *
+ * Upstreams are picked round-robin, by the fewest requests in flight, or
+ * by a consistent hash of a request key (the client address by default)
+ * over a ring of virtual nodes, so each key sticks to one upstream and
+ * losing an upstream only moves its own keys. Upstreams that fail are
+ * left out for a while (passive checks); with a health path set, they are
+ * also probed periodically and left out until a probe passes.
+ *
+ * Response bodies are passed through chunk by chunk as the upstream sends
+ * them and never held whole. Request bodies go out as the server received
+ * them: from memory, or with sendfile() straight from the file a large
+ * body was spilled to (config::BODY_SPILL_THRESHOLD). Hop-by-hop headers
+ * are dropped both ways, X-Forwarded-For, -Proto and -Host are added, and
+ * further headers can be set or removed in either direction.
+ *
+ * @section proxy_usage Usage Example
+ * @code{.cpp}
+ * cppress::web::proxy_options options;
+ * options.policy = cppress::web::balance_policy::least_connections;
+ * options.strip_prefix = "/api";
+ * options.health_path = "/healthz";
+ * options.request_headers = {{"X-Gateway", "edge-1"}};
+ *
+ * auto api = std::make_shared<cppress::web::reverse_proxy>(
+ *     *server, std::vector<cppress::web::proxy_upstream>{{"10.0.0.5", 8000}, {"10.0.0.6", 8000}},
+ *     options);
+ * api->start_health_checks();
+ *
+ * // every path under /api ("/api/" followed by the wildcard)
+ * server->get("/api/" "*", {cppress::web::proxy_pass(api)});
+ * server->post("/api/" "*", {cppress::web::proxy_pass(api)});
+ * @endcode
+ *
+ * @author cppress team
+ * @version 1.0
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "request.hpp"
+#include "response.hpp"
+#include "sockets/includes.hpp"
+#include "types.hpp"
+
+namespace cppress::web {
+
+/// @brief How a reverse_proxy picks the upstream of a request
+enum class balance_policy {
+    /// Each upstream in turn
+    round_robin,
+    /// The upstream with the fewest requests in flight
+    least_connections,
+    /// The upstream owning the request key's point on a hash ring
+    consistent_hash
+};
+
+/**
+ * @brief Address of one upstream server
+ */
+struct proxy_upstream {
+    /// IPv4 or IPv6 address literal; names are not resolved
+    std::string address;
+
+    std::uint16_t port = 80;
+};
+
+/**
+ * @brief Balancing, health and header rules of a reverse_proxy
+ */
+struct proxy_options {
+    balance_policy policy = balance_policy::round_robin;
+
+    /// Key of balance_policy::consistent_hash, the client address when empty
+    std::function<std::string_view(const request&)> hash_key;
+
+    /// Points each upstream has on the hash ring
+    std::size_t virtual_nodes = 100;
+
+    /// Removed from the front of the target before forwarding, e.g. "/api"
+    std::string strip_prefix;
+
+    /// Headers set on forwarded requests, replacing the client's
+    std::vector<std::pair<std::string, std::string>> request_headers;
+
+    /// Headers of the client's request not forwarded
+    std::vector<std::string> remove_request_headers;
+
+    /// Headers set on responses, replacing the upstream's
+    std::vector<std::pair<std::string, std::string>> response_headers;
+
+    /// Headers of the upstream's response not passed on
+    std::vector<std::string> remove_response_headers;
+
+    /// Failures in a row after which an upstream is left out
+    std::size_t max_fails = 1;
+
+    /// Time an upstream is left out after failing
+    std::chrono::milliseconds fail_timeout = std::chrono::seconds(10);
+
+    /// Time allowed to connect to an upstream
+    std::chrono::milliseconds connect_timeout = std::chrono::seconds(2);
+
+    /// Upstreams tried for one request; idempotent requests are also retried
+    /// when a pooled connection closes before answering
+    std::size_t attempts = 2;
+
+    /// Path probed by the health checks, empty for passive checks only
+    std::string health_path;
+
+    /// Time between two rounds of health checks
+    std::chrono::milliseconds health_interval = std::chrono::seconds(5);
+
+    /// Largest upstream response head accepted, in bytes
+    std::size_t max_response_head = 16384;
+};
+
+/**
+ * @class reverse_proxy
+ * @brief Forwards requests to a balanced set of upstream servers
+ *
+ * Thread-safe; keep it in a std::shared_ptr, in-flight requests hold a
+ * reference. The server passed in drives the upstream connections and
+ * must outlive the requests being forwarded.
+ */
+class reverse_proxy : public std::enable_shared_from_this<reverse_proxy> {
+public:
+    /**
+     * @param loops The server whose event loops run the upstream connections
+     * @param upstreams Servers to balance over
+     * @param options Balancing, health and header rules
+     * @throws std::invalid_argument if upstreams is empty
+     */
+    reverse_proxy(cppress::sockets::epoll_server& loops, std::vector<proxy_upstream> upstreams,
+                  proxy_options options = {});
+
+    reverse_proxy(const reverse_proxy&) = delete;
+    reverse_proxy& operator=(const reverse_proxy&) = delete;
+
+    /**
+     * @brief Forward a request and stream the upstream's response back
+     * @param req The client's request
+     * @param res Its response, deferred here and finished from the upstream's loop
+     *
+     * Answers 502 when no upstream could be reached or the upstream's
+     * response was malformed; a response that breaks off mid-body ends the
+     * client's connection.
+     */
+    void forward(const std::shared_ptr<request>& req, const std::shared_ptr<response>& res);
+
+    /**
+     * @brief Pick an upstream and count a request in flight on it
+     * @param key Request key, used by balance_policy::consistent_hash
+     * @return Index of the upstream; if all are left out, the one the policy prefers
+     */
+    std::size_t acquire(std::string_view key);
+
+    /**
+     * @brief Count a request on an upstream as done
+     * @param upstream Index returned by acquire()
+     * @param ok false if the upstream failed it
+     */
+    void release(std::size_t upstream, bool ok) noexcept;
+
+    /// @brief Probe every upstream's health path once, answers arrive on the loops
+    void check_health();
+
+    /// @brief Probe the upstreams now and every health_interval while the proxy lives
+    void start_health_checks();
+
+    /// @brief Whether an upstream is currently picked
+    bool healthy(std::size_t upstream) const noexcept;
+
+    /// @brief Requests in flight on an upstream
+    std::size_t in_flight(std::size_t upstream) const noexcept {
+        return states[upstream].active.load(std::memory_order_relaxed);
+    }
+
+    /// @brief Number of upstreams
+    std::size_t size() const noexcept { return upstreams.size(); }
+
+private:
+    struct upstream_state {
+        cppress::sockets::socket_address address;
+        std::atomic<std::size_t> active{0};
+        std::atomic<std::size_t> fails{0};
+
+        /// Steady-clock nanoseconds until which the upstream is left out
+        std::atomic<std::int64_t> down_until{0};
+    };
+
+    /// One forwarded request, driven on its upstream connection's loop
+    struct exchange;
+
+    /// Picks an upstream for the exchange and connects to it
+    void attempt(const std::shared_ptr<exchange>& ex);
+
+    /// Parses and passes on response bytes
+    void on_upstream_data(const std::shared_ptr<exchange>& ex, std::string_view data);
+
+    /// Handles the upstream connection closing before the exchange is done
+    void on_upstream_close(const std::shared_ptr<exchange>& ex);
+
+    /// Copies the upstream's status and headers to the response and picks the body framing
+    bool start_response(const std::shared_ptr<exchange>& ex, std::string_view head);
+
+    /// Passes body bytes on, true once the body is complete
+    bool pass_body(const std::shared_ptr<exchange>& ex, std::string_view data);
+
+    /// Ends the exchange and hands its connection back or closes it
+    void finish(const std::shared_ptr<exchange>& ex, bool ok, bool reuse);
+
+    /// Answers 502 Bad Gateway, before any of the response was sent
+    void fail(const std::shared_ptr<exchange>& ex);
+
+    /// Ends the client's connection, after part of the response was sent
+    void abort(const std::shared_ptr<exchange>& ex);
+
+    /// Records a health probe's outcome
+    void mark(std::size_t upstream, bool ok) noexcept;
+
+    cppress::sockets::epoll_server& loops;
+    std::vector<proxy_upstream> upstreams;
+    proxy_options options;
+    std::unique_ptr<upstream_state[]> states;
+
+    /// Points of the hash ring, sorted: hash and upstream index
+    std::vector<std::pair<std::uint64_t, std::size_t>> ring;
+
+    std::atomic<std::size_t> cursor{0};
+};
+
+/**
+ * @brief Handler forwarding a route's requests through a reverse_proxy
+ * @param proxy The upstreams and their rules, may be shared by several routes
+ * @return A handler that defers the response and exits
+ */
+template <typename T = request, typename G = response>
+request_handler_t<T, G> proxy_pass(std::shared_ptr<reverse_proxy> proxy) {
+    return [proxy = std::move(proxy)](const std::shared_ptr<T>& req,
+                                      const std::shared_ptr<G>& res) -> exit_code {
+        proxy->forward(req, res);
+        return exit_code::EXIT;
+    };
+}
+}  // namespace cppress::web
@@ -0,0 +1,183 @@
+/**
+ * @file rate_limiter.hpp
+ * @brief Per-client request rate limits, checked without a lock
+ *
+ * A rate_limiter applies the generic cell rate algorithm (GCRA) to keys: a
+ * key may make burst requests at once, and then one every 1/rate seconds.
+ * Its state is one timestamp per key (the theoretical arrival time), kept
+ * in a sharded open-addressing table of atomics; a request costs a hash,
+ * a short probe and one compare-and-swap. Keys are never removed: a slot
+ * whose key has been idle long enough to have its full burst back is
+ * simply taken over by the next new key that probes it.
+ *
+ * Refused requests get a 429 serialized once per limiter, which closes
+ * the connection as the 503 of a shed request does. Limits are
+ * applied either as middleware, on a router or a route, or by the server
+ * itself with server::use_rate_limit(), which answers on the event loop
+ * before the request reaches the worker pool.
+ *
+ * @section rate_limiter_usage Usage Example
+ * @code{.cpp}
+ * // 20 requests at once, then 10 a second, per client address, on the loop
+ * server->use_rate_limit({10, 20});
+ *
+ * // one API key's calls to a router
+ * auto per_key =
+ *     std::make_shared<cppress::web::rate_limiter>(cppress::web::rate_limit_options{5, 5});
+ * api->use(cppress::web::rate_limit(per_key, cppress::web::rate_limit_by_header("X-Api-Key")));
+ *
+ * // one shared budget for an expensive route
+ * auto reports =
+ *     std::make_shared<cppress::web::rate_limiter>(cppress::web::rate_limit_options{1, 3});
+ * router->get("/report",
+ *             {cppress::web::rate_limit(reports, cppress::web::rate_limit_by_route("report")),
+ *              report_handler});
+ * @endcode
+ *
+ * @author cppress team
+ * @version 1.0
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "request.hpp"
+#include "sockets/includes.hpp"
+#include "types.hpp"
+
+namespace cppress::web {
+
+/**
+ * @brief Limits of a rate_limiter and the size of its table
+ */
+struct rate_limit_options {
+    /// Requests per second each key is allowed over time
+    double rate = 10;
+
+    /// Requests a key may make at once after being idle
+    std::size_t burst = 20;
+
+    /// Independent tables the keys are spread over
+    std::size_t shards = 16;
+
+    /// Keys each shard tracks at once, rounded up to a power of two
+    std::size_t slots_per_shard = 4096;
+};
+
+/**
+ * @class rate_limiter
+ * @brief GCRA limits per key in a lock-free table
+ *
+ * Thread-safe. Keys are compared by a 64-bit hash; two keys sharing one
+ * share a budget. When every slot a key may use holds a key still being
+ * limited, the request is let through and counted in untracked(): the
+ * table is sized for the clients expected at once, and an attacker
+ * cycling through addresses cannot evict the ones being limited.
+ */
+class rate_limiter {
+public:
+    explicit rate_limiter(const rate_limit_options& options = {});
+
+    rate_limiter(const rate_limiter&) = delete;
+    rate_limiter& operator=(const rate_limiter&) = delete;
+
+    /**
+     * @brief Take one request from a key's budget
+     * @param key Who the request counts against, e.g. the client address
+     * @param now The request's time
+     * @return false if the key is over its limit
+     */
+    bool allow(
+        std::string_view key,
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now()) noexcept;
+
+    /// @brief The 429 for refused requests, with one interval as Retry-After; it closes
+    /// the connection
+    const cppress::sockets::data_buffer& rejection() const noexcept { return refusal; }
+
+    /// @brief Requests refused so far
+    std::uint64_t rejected() const noexcept { return refused.load(std::memory_order_relaxed); }
+
+    /// @brief Requests let through for want of a free slot
+    std::uint64_t untracked() const noexcept { return overflowed.load(std::memory_order_relaxed); }
+
+private:
+    struct slot {
+        /// Hash of the key, 0 while the slot was never used
+        std::atomic<std::uint64_t> key{0};
+
+        /// Theoretical arrival time: the key has its full burst back from then on
+        std::atomic<std::int64_t> tat{0};
+    };
+
+    struct shard {
+        std::unique_ptr<slot[]> slots;
+    };
+
+    /// Slots probed for a key before giving up
+    static constexpr std::size_t PROBES = 8;
+
+    /// Takes one request off a slot's budget
+    bool take(slot& s, std::int64_t now) noexcept;
+
+    std::vector<shard> shards;
+    std::size_t slot_mask;
+
+    /// Nanoseconds between requests at the sustained rate
+    std::int64_t interval;
+
+    /// How far ahead of now the arrival time may run: burst - 1 intervals
+    std::int64_t tolerance;
+
+    cppress::sockets::data_buffer refusal;
+    std::atomic<std::uint64_t> refused{0};
+    std::atomic<std::uint64_t> overflowed{0};
+};
+
+/// Picks the key a request counts against; the view must point into the request or outlive it
+using rate_limit_key = std::function<std::string_view(const request&)>;
+
+/// @brief Key requests by the IP address of the client's connection
+rate_limit_key rate_limit_by_client_address();
+
+/**
+ * @brief Key requests by a header, e.g. an API key
+ * @param name Header name; requests without it share the empty key
+ */
+rate_limit_key rate_limit_by_header(std::string name);
+
+/**
+ * @brief Count every request against one budget, for a route or router as a whole
+ * @param name Name of the budget; limiters are separate anyway, it shows up nowhere
+ */
+rate_limit_key rate_limit_by_route(std::string name);
+
+/**
+ * @brief Middleware refusing requests over a limiter's limit
+ * @param limiter The limits and their state, may be shared by several middleware
+ * @param key What requests are counted against (default: the client address)
+ * @return A handler that continues, or answers the limiter's 429 and exits
+ */
+template <typename T = request, typename G = response>
+request_handler_t<T, G> rate_limit(std::shared_ptr<rate_limiter> limiter,
+                                   rate_limit_key key = rate_limit_by_client_address()) {
+    return [limiter = std::move(limiter), key = std::move(key)](
+               const std::shared_ptr<T>& req, const std::shared_ptr<G>& res) -> exit_code {
+        if (limiter->allow(key(*req)))
+            return exit_code::CONTINUE;
+        // the server ends a response that does not keep its connection
+        res->set_keep_alive(false);
+        res->send_serialized(limiter->rejection());
+        return exit_code::EXIT;
+    };
+}
+}  // namespace cppress::web
@@ -10,6 +10,7 @@
  * @li Query parameter parsing and retrieval
  * @li Convenient header access methods
  * @li Cookie and authorization header helpers
+ * @li Cookie and form field lookups, each parsed once per request
  * @li Thread-safe parameter management
  * @li Keep-alive connection detection
  * @li Custom request parameter storage
@@ -18,17 +19,24 @@
  * @code{.cpp}
  * void handler(std::shared_ptr<request> req, std::shared_ptr<response> res) {
  *     // Get path parameters
- *     auto params = req->get_path_params();
- *     std::string userId = params["id"];
+ *     std::string userId = req->get_path_param("id");
  *
  *     // Get query parameters
  *     std::string page = req->get_query_parameter("page");
  *
+ *     // Cookies and url-encoded form fields, split on first use
+ *     std::string_view session = req->get_cookie("session");
+ *     std::string_view email = req->get_form_value("email");
+ *
  *     // Access headers
  *     auto auth = req->get_authorization();
  *
  *     // Get request body
  *     std::string body = req->get_body();
+ *
+ *     // Or parse a JSON body where it lies
+ *     auto doc = req->get_json();
+ *     double id = doc.root().find("id")->as_number();
  * }
  * @endcode
  *
@@ -43,13 +51,25 @@
 #pragma once
 
 #include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <memory_resource>
 #include <mutex>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
 #include "exceptions.hpp"
 #include "http/includes.hpp"
+#include "libs/json/includes/json_bind.hpp"
+#include "libs/json/includes/json_document.hpp"
+#include "libs/json/includes/json_lazy.hpp"
+#include "route_trie.hpp"
+#include "tracing.hpp"
+#include "shared/includes/utils.hpp"
 #include "utilities.hpp"
 
 namespace cppress::web {
@@ -59,6 +79,9 @@ class router;
 template <typename T, typename G, typename R>
 class server;
 
+template <typename T, typename G>
+struct request_exchange;
+
 /**
  * @brief High-level web request wrapper with enhanced functionality.
  *
@@ -88,19 +111,96 @@ protected:
     /// http://localhost/users/:id/posts/:postID
     /// http://localhost/users/123/posts/456
     /// map holds => {"id", "123"}, {"postID", "456"}
+    /// Only filled by set_path_params(); the router sets path_captures instead
     std::map<std::string, std::string> path_params;
 
+    /// Path parameters as the router found them: views of the route's names and
+    /// of the URI, decoded only when read
+    cppress::web::path_captures path_captures;
+
     /// Modify path_params mutex
     mutable std::mutex path_params_mutex;
 
+    /// Query fields as views of the URI, split on first use
+    mutable std::vector<std::pair<std::string_view, std::string_view>> query_fields;
+
+    /// Guards the one parse of query_fields
+    mutable std::once_flag query_parsed;
+
+    /// @brief query_fields, split from the URI by the first caller
+    const std::vector<std::pair<std::string_view, std::string_view>>& parsed_query() const {
+        std::call_once(query_parsed,
+                       [this] { parse_query_fields(request_.get_uri_view(), query_fields); });
+        return query_fields;
+    }
+
+    /// Cookies as views of the Cookie headers, split on first use
+    mutable std::vector<std::pair<std::string_view, std::string_view>> cookie_fields;
+
+    /// Guards the one parse of cookie_fields
+    mutable std::once_flag cookies_parsed;
+
+    /// @brief cookie_fields, split from every Cookie header by the first caller
+    const std::vector<std::pair<std::string_view, std::string_view>>& parsed_cookies() const {
+        std::call_once(cookies_parsed, [this] {
+            request_.get_header_fields().for_each(
+                cppress::http::header_id::cookie,
+                [this](std::string_view header) { parse_cookie_fields(header, cookie_fields); });
+        });
+        return cookie_fields;
+    }
+
+    /// Form fields as views of the body (or of spilled_form), split on first use
+    mutable std::vector<std::pair<std::string_view, std::string_view>> form_fields;
+
+    /// A spilled url-encoded body, read back for form_fields to point into
+    mutable std::string spilled_form;
+
+    /// Guards the one parse of form_fields
+    mutable std::once_flag form_parsed;
+
+    /// @brief form_fields, split from an application/x-www-form-urlencoded body by the first caller
+    const std::vector<std::pair<std::string_view, std::string_view>>& parsed_form() const {
+        std::call_once(form_parsed, [this] {
+            std::string_view type =
+                request_.get_header_value(cppress::http::header_id::content_type);
+            type = type.substr(0, type.find(';'));
+            while (!type.empty() && (type.back() == ' ' || type.back() == '\t'))
+                type.remove_suffix(1);
+            constexpr std::string_view form = "application/x-www-form-urlencoded";
+            if (type.size() != form.size() ||
+                !std::equal(type.begin(), type.end(), form.begin(), [](char a, char b) {
+                    return std::tolower(static_cast<unsigned char>(a)) == b;
+                }))
+                return;
+            std::string_view body = request_.get_body_view();
+            if (auto spool = request_.get_body_spool()) {
+                spilled_form = spool->to_string();
+                body = spilled_form;
+            }
+            parse_form_fields(body, form_fields);
+        });
+        return form_fields;
+    }
+
     /// Custom request parameters (e.g., from query string)
     std::map<std::string, std::string> request_params;
 
+    /// Trace of a sampled request, null otherwise; see server::use_tracing()
+    std::unique_ptr<request_trace> trace;
+
+    /// Arena of the request's block, null for a request not made by the server
+    std::pmr::memory_resource* scratch_resource = nullptr;
+
 public:
     /// Allow server to access private members
     template <typename T, typename G, typename R>
     friend class server;
 
+    /// Points the request at the arena of its block
+    template <typename, typename>
+    friend struct request_exchange;
+
     /**
      * @brief Construct web request from HTTP request.
      * @param req HTTP request object to wrap (moved)
@@ -130,8 +230,33 @@ public:
      *
      * Example: For URI "/users/123/posts/456", this might return:
      * [{"userId", "123"}, {"postId", "456"}]
+     *
+     * @note Builds and decodes the whole map; get_path_param() reads one parameter
+     */
+    virtual std::map<std::string, std::string> get_path_params() const {
+        std::lock_guard<std::mutex> lock(path_params_mutex);
+        if (path_captures.empty())
+            return path_params;
+        std::map<std::string, std::string> params;
+        for (std::size_t i = 0; i < path_captures.size(); ++i)
+            params.emplace(std::string(path_captures[i].name),
+                           shared::url_decode(path_captures[i].value));
+        return params;
+    }
+
+    /**
+     * @brief Get one path parameter by name.
+     * @param name Parameter name as written in the route, without the ':'; "*" for the wildcard
+     * @return URL-decoded value, empty if the route has no such parameter
      */
-    virtual std::map<std::string, std::string> get_path_params() const { return path_params; }
+    virtual std::string get_path_param(std::string_view name) const {
+        std::lock_guard<std::mutex> lock(path_params_mutex);
+        for (std::size_t i = 0; i < path_captures.size(); ++i)
+            if (path_captures[i].name == name)
+                return shared::url_decode(path_captures[i].value);
+        auto it = path_params.find(std::string(name));
+        return it == path_params.end() ? std::string() : it->second;
+    }
 
     /**
      * @brief Set the path params object
@@ -141,9 +266,21 @@ public:
      */
     virtual void set_path_params(const std::map<std::string, std::string>& params) {
         std::lock_guard<std::mutex> lock(path_params_mutex);
+        path_captures.clear();
         path_params = params;
     }
 
+    /**
+     * @brief Set the path parameters the router captured.
+     * @param captures Values must be views of this request's URI (see get_path_view()),
+     *        names must outlive the request
+     */
+    void set_path_captures(const cppress::web::path_captures& captures) {
+        std::lock_guard<std::mutex> lock(path_params_mutex);
+        path_params.clear();
+        path_captures = captures;
+    }
+
     /**
      * @brief Get the HTTP method of the request.
      * @return String containing the HTTP method (GET, POST, PUT, DELETE, etc.)
@@ -166,6 +303,15 @@ public:
      */
     virtual std::string get_path() const { return cppress::web::get_path(request_.get_uri()); }
 
+    /**
+     * @brief Get the path component of the request URI without copying it.
+     * @return View of the URI up to the query; valid while the request lives
+     */
+    std::string_view get_path_view() const {
+        std::string_view uri = request_.get_uri_view();
+        return uri.substr(0, uri.find('?'));
+    }
+
     /**
      * @brief Get the complete request URI.
      * @return String containing the full URI including query parameters
@@ -187,20 +333,33 @@ public:
      * [{"q", "example"}, {"category", "news"}, {"page", "2"}]
      */
     virtual std::map<std::string, std::string> get_query_parameters() const {
-        return cppress::web::get_query_parameters(request_.get_uri());
+        std::map<std::string, std::string> params;
+        for (const auto& [name, value] : parsed_query())
+            params.emplace(std::string(name), std::string(value));
+        return params;
     }
 
     /// @brief Get a specific query parameter by name.
     /// @param key Name of the query parameter to retrieve
     /// @return Value of the query parameter or an empty string if not found
     virtual std::string get_query_parameter(const std::string& key) const {
-        auto params = get_query_parameters();
-        for (const auto& param : params) {
-            if (param.first == key) {
-                return param.second;
-            }
-        }
-        return "";
+        return std::string(get_query_value(key));
+    }
+
+    /**
+     * @brief Get a query parameter without copying it.
+     * @param key Name of the query parameter
+     * @return First value given for key, trimmed and not decoded, empty if absent;
+     *         valid while the request lives
+     *
+     * The query string is split once, on the first call, however many
+     * parameters are read.
+     */
+    std::string_view get_query_value(std::string_view key) const {
+        for (const auto& [name, value] : parsed_query())
+            if (name == key)
+                return value;
+        return {};
     }
 
     /**
@@ -229,6 +388,89 @@ public:
         return request_.get_header(name);
     }
 
+    /**
+     * @brief Get the first value of a header without copying it.
+     * @param name Header name to search for (case-insensitive)
+     * @return The value, empty if the header is absent; valid while the request lives
+     *
+     * Well-known names (Host, Content-Type, Cookie, ...) are found by an
+     * array index, use this over get_header() on hot paths.
+     */
+    std::string_view get_header_value(std::string_view name) const {
+        return request_.get_header_value(name);
+    }
+
+    /**
+     * @brief Stamp a point of the request's trace
+     * @param point Point reached now; nothing happens unless the request is traced
+     */
+    void trace_mark(trace_point point) noexcept {
+        if (trace)
+            trace->mark(point);
+    }
+
+    /**
+     * @brief Memory that lives as long as the request
+     * @return The arena of the request's block, the heap for a request the server did not make
+     *
+     * For strings, vectors and the like a handler builds and drops while
+     * answering: allocations are bumped off a buffer the request already
+     * owns and are all released with it, deallocate() does nothing. Not
+     * for anything kept past the response, nor shared with other threads
+     * while the handler runs.
+     */
+    std::pmr::memory_resource* scratch() const noexcept {
+        return scratch_resource ? scratch_resource : std::pmr::new_delete_resource();
+    }
+
+    /// @brief true if the request was sampled for tracing
+    bool is_traced() const noexcept { return trace != nullptr; }
+
+    /**
+     * @brief Open a span around a call to another service
+     * @param name Name of the span, e.g. the service called
+     * @return A span whose traceparent() goes on the outgoing request
+     *
+     * The span is a child of this request's span and is recorded when it
+     * ends, if the request is traced. An untraced request still passes on
+     * the context it received, marked not sampled; one that received none
+     * returns a span with an empty traceparent().
+     */
+    upstream_span begin_span(std::string name) const {
+        if (trace)
+            return upstream_span(trace->owner, trace->context.child(), trace->context.span_id,
+                                 std::move(name));
+        trace_context incoming;
+        std::string_view received =
+            request_.get_header_fields().get(cppress::http::header_id::traceparent);
+        if (trace_context::parse(received, incoming))
+            return upstream_span(nullptr, incoming.child(), incoming.span_id, std::move(name));
+        return upstream_span();
+    }
+
+    /**
+     * @brief Get the header fields as they were parsed.
+     * @return The fields, in arrival order; valid while the request lives
+     *
+     * What cppress::http::negotiate_content_coding() and other per-id
+     * lookups take.
+     */
+    const cppress::http::http_headers& get_header_fields() const {
+        return request_.get_header_fields();
+    }
+
+    /**
+     * @brief Get the IP address of the client's end of the connection.
+     * @return The peer's address, e.g. "203.0.113.7"; behind a proxy, the proxy's
+     */
+    const std::string& get_remote_address() const { return request_.get_remote_address(); }
+
+    /**
+     * @brief Identity of the connection the request came on.
+     * @return Equal for the requests of one open connection, nullptr if there is none
+     */
+    const void* connection_id() const noexcept { return request_.connection_id(); }
+
     /**
      * @brief Get all headers as name-value pairs.
      * @return Vector of name-value pairs representing all HTTP headers
@@ -251,6 +493,69 @@ public:
      */
     virtual std::string get_body() const { return request_.get_body(); }
 
+    /**
+     * @brief Parse the body as JSON without copying it.
+     * @return The document; it points into the body, keep it no longer than the request
+     * @throws std::runtime_error if the body is not well-formed JSON
+     *
+     * The body is read in place (cppress::json::json_document::view()); a
+     * body spilled to a file is read back once and handed to the document.
+     */
+    cppress::json::json_document get_json() const {
+        if (auto spool = request_.get_body_spool())
+            return cppress::json::json_document::parse(spool->to_string());
+        return cppress::json::json_document::view(request_.get_body_view());
+    }
+
+    /**
+     * @brief Index the body as JSON without parsing its values.
+     * @return The document; it points into the body, keep it no longer than the request
+     * @throws std::runtime_error if the structure of the body is not well-formed JSON
+     *
+     * For a handler that reads a few fields of a large body: only what is
+     * looked up is parsed (cppress::json::json_lazy_document::view()).
+     */
+    cppress::json::json_lazy_document get_json_lazy() const {
+        if (auto spool = request_.get_body_spool())
+            return cppress::json::json_lazy_document::parse(spool->to_string());
+        return cppress::json::json_lazy_document::view(request_.get_body_view());
+    }
+
+    /**
+     * @brief Read a JSON body straight into a struct.
+     * @tparam T A type bound with CPPRESS_JSON_FIELDS, or a vector, map or optional of one
+     * @throws std::runtime_error if the body is malformed or does not fit T
+     *
+     * The body is tokenized in place and each value stored into its member
+     * (cppress::json::from_json()); no document or tree is built.
+     */
+    template <typename T>
+    T get_json_as() const {
+        if (auto spool = request_.get_body_spool())
+            return cppress::json::from_json<T>(spool->to_string());
+        return cppress::json::from_json<T>(request_.get_body_view());
+    }
+
+    /**
+     * @brief Get the file a large body was spilled to.
+     * @return The spool, nullptr if the body is in memory (see http_body.hpp)
+     */
+    std::shared_ptr<const cppress::http::http_body_spool> get_body_spool() const {
+        return request_.get_body_spool();
+    }
+
+    /**
+     * @brief Get the parts of a multipart/form-data body.
+     * @return The parser that read the body as it arrived, nullptr if none did
+     *
+     * Set when the server has a multipart sink selector (see
+     * cppress::http::http_server::set_multipart_sink_selector()); uploads are
+     * then already in their sinks and get_body() is empty.
+     */
+    virtual std::shared_ptr<const cppress::http::multipart_parser> get_multipart() const {
+        return request_.get_multipart();
+    }
+
     /**
      * @brief Get the Content-Type header values.
      * @return Vector of strings containing Content-Type header values
@@ -263,6 +568,23 @@ public:
         return request_.get_header(cppress::http::consts::HEADER_CONTENT_TYPE);
     }
 
+    /**
+     * @brief Get the length of the request body.
+     * @return The Content-Length the client declared, otherwise the size of the body read
+     *
+     * Before the body is read, as for requests that sent Expect: 100-continue,
+     * a chunked body is reported as 0.
+     */
+    virtual std::size_t get_content_length() const {
+        std::string_view declared =
+            request_.get_header_value(cppress::http::header_id::content_length);
+        if (!declared.empty())
+            return static_cast<std::size_t>(std::stoull(std::string(declared)));
+        if (auto spool = request_.get_body_spool())
+            return spool->size();
+        return request_.get_body().size();
+    }
+
     /**
      * @brief Get the Cookie header values.
      * @return Vector of strings containing Cookie header values
@@ -276,6 +598,48 @@ public:
         return request_.get_header(cppress::http::consts::HEADER_COOKIE);
     }
 
+    /**
+     * @brief Get a cookie without copying it.
+     * @param name Name of the cookie
+     * @return First value sent for name, without surrounding quotes, empty if absent;
+     *         valid while the request lives
+     *
+     * The Cookie headers are split once, on the first call, however many
+     * cookies are read and by however many middlewares.
+     */
+    std::string_view get_cookie(std::string_view name) const {
+        for (const auto& [key, value] : parsed_cookies())
+            if (key == name)
+                return value;
+        return {};
+    }
+
+    /// @brief Every cookie sent, in order, as views valid while the request lives
+    const std::vector<std::pair<std::string_view, std::string_view>>& get_cookie_fields() const {
+        return parsed_cookies();
+    }
+
+    /**
+     * @brief Get a field of an application/x-www-form-urlencoded body without copying it.
+     * @param name Name of the field
+     * @return First value given for name, trimmed and not decoded (shared::url_decode(),
+     *         with '+' standing for a space), empty if absent or the body is not
+     *         url-encoded; valid while the request lives
+     *
+     * The body is split once, on the first call.
+     */
+    std::string_view get_form_value(std::string_view name) const {
+        for (const auto& [key, value] : parsed_form())
+            if (key == name)
+                return value;
+        return {};
+    }
+
+    /// @brief Every field of a url-encoded body, in order, as views valid while the request lives
+    const std::vector<std::pair<std::string_view, std::string_view>>& get_form_fields() const {
+        return parsed_form();
+    }
+
     /**
      * @brief Get the Authorization header values.
      * @return Vector of strings containing Authorization header values
@@ -289,22 +653,31 @@ public:
         return request_.get_header(cppress::http::consts::HEADER_AUTHORIZATION);
     }
 
+    /**
+     * @brief Whether the client wants the connection kept open after the response.
+     * @return true for HTTP/1.1 unless Connection lists "close", and for HTTP/1.0
+     * only if Connection lists "keep-alive"
+     */
     virtual bool keep_alive() const {
-        auto req_connection_values = get_header(cppress::http::consts::HEADER_CONNECTION);
-
-        // transform all the values to upper case
-        for (auto& s : req_connection_values) {
-            std::transform(s.begin(), s.end(), s.begin(),
-                           [](unsigned char c) { return std::toupper(c); });
-        }
-
-        std::string keep_alive = "KEEP-ALIVE";
-        if (std::find(req_connection_values.begin(), req_connection_values.end(), keep_alive) !=
-            req_connection_values.end()) {
+        bool close = false, keep_alive = false;
+        auto is = [](std::string_view value, std::string_view option) {
+            return value.size() == option.size() &&
+                   std::equal(value.begin(), value.end(), option.begin(), [](char a, char b) {
+                       return std::tolower(static_cast<unsigned char>(a)) == b;
+                   });
+        };
+        request_.get_header_fields().for_each(
+            cppress::http::header_id::connection, [&](std::string_view value) {
+                close = close || is(value, "close");
+                keep_alive = keep_alive || is(value, "keep-alive");
+            });
+        if (close)
+            return false;
+        if (keep_alive)
             return true;
-        }
 
-        return false;
+        // persistent by default from HTTP/1.1 on
+        return get_version() != "HTTP/1.0";
     }
     /**
      * @brief Add a custom request parameter.
@@ -0,0 +1,93 @@
+#pragma once
+
+/**
+ * @file request_arena.hpp
+ * @brief One block per request for the request, the response and scratch memory
+ *
+ * A request used to cost two pooled blocks, one for the request object and
+ * one for the response, each with its own reference counts. A
+ * request_exchange holds both objects and a request_arena in a single
+ * pooled block; the request and response pointers handed to the handlers
+ * alias it and share one set of counts, and all of it goes back to the
+ * pool in one piece when the last of them is let go:
+ *
+ * @code
+ * auto exchange = request_exchange<T, G>::make(std::move(request), std::move(response));
+ * std::shared_ptr<T> req(exchange, &exchange->request);
+ * std::shared_ptr<G> res(exchange, &exchange->response);
+ * @endcode
+ *
+ * Handlers get the arena through request::scratch() for memory that need
+ * not outlive the request:
+ *
+ * @code
+ * server->get("/report", {[](auto req, auto res) {
+ *     std::pmr::vector<std::string_view> rows(req->scratch());
+ *     ...
+ * }});
+ * @endcode
+ *
+ * @author cppress team
+ * @version 1.0
+ */
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+
+#include "http/includes.hpp"
+#include "object_pool.hpp"
+
+namespace cppress::web {
+
+/**
+ * @brief Monotonic memory for the lifetime of one request
+ *
+ * Allocations are carved from a buffer inside the request's block and only
+ * given back when the request ends; past the buffer they go to the heap in
+ * growing chunks. Used by one thread at a time, as the request is.
+ */
+class request_arena {
+public:
+    /// Bytes served before the heap is touched
+    static constexpr std::size_t inline_bytes = 2048;
+
+    request_arena() : buffer(), resource(buffer, sizeof(buffer)) {}
+
+    request_arena(const request_arena&) = delete;
+    request_arena& operator=(const request_arena&) = delete;
+
+    /// @brief The memory resource to allocate from
+    std::pmr::memory_resource* get() noexcept { return &resource; }
+
+private:
+    alignas(std::max_align_t) std::byte buffer[inline_bytes];
+    std::pmr::monotonic_buffer_resource resource;
+};
+
+/**
+ * @brief The request, the response and the arena of one request, in one block
+ *
+ * The arena is declared first, so it outlives anything the two objects
+ * allocated from it.
+ */
+template <typename T, typename G>
+struct request_exchange {
+    request_arena arena;
+    T request;
+    G response;
+
+    request_exchange(cppress::http::http_request&& req, cppress::http::http_response&& res)
+        : request(std::move(req)), response(std::move(res)) {
+        request.scratch_resource = arena.get();
+    }
+
+    /// @brief Builds an exchange in a pooled block
+    static std::shared_ptr<request_exchange> make(cppress::http::http_request&& req,
+                                                  cppress::http::http_response&& res) {
+        return std::allocate_shared<request_exchange>(pool_allocator<request_exchange>(),
+                                                      std::move(req), std::move(res));
+    }
+};
+
+}  // namespace cppress::web
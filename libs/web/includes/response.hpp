@@ -20,9 +20,19 @@
  *     // Send JSON response
  *     res->send_json("{\"message\": \"Hello World\"}");
  *
+ *     // Or serialize a JSON value straight into the body
+ *     res->json(*payload);
+ *
+ *     // Or stream a large one in chunks as it is written
+ *     res->stream_json([&](cppress::json::json_writer& out) { out.value(*report); });
+ *
  *     // Or send HTML
  *     res->send_html("<h1>Hello World</h1>");
  *
+ *     // Or render an element tree straight into the body, or stream it
+ *     res->html(page);
+ *     res->stream_html([&](cppress::html::html_writer& out) { page.render(out); });
+ *
  *     // Or send plain text
  *     res->send_text("Hello World");
  *
@@ -45,12 +55,19 @@
 #pragma once
 
 #include <atomic>
+#include <functional>
 #include <iostream>
+#include <map>
 #include <mutex>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 #include "http/includes.hpp"
+#include "libs/html/includes/document.hpp"
+#include "libs/html/includes/html_writer.hpp"
+#include "libs/json/includes/json_bind.hpp"
+#include "libs/json/includes/json_object.hpp"
 #include "shared/includes/logger.hpp"
 namespace cppress::web {
 template <typename T, typename G>
@@ -92,6 +109,9 @@ protected:
     /// Flag to prevent double-sending of response
     std::atomic<bool> did_send = false;
 
+    /// The handler finishes the response after returning, see defer()
+    std::atomic<bool> deferred = false;
+
     /// Mutex for modifying headers
     mutable std::mutex modify_headers_mutex;
 
@@ -122,11 +142,76 @@ protected:
         }
     }
 
+    /// Whether the response told the client the connection stays open
+    bool keeps_connection() noexcept {
+        std::lock_guard<std::mutex> lock(modify_headers_mutex);
+        const auto connection = response_.get_header(cppress::http::consts::HEADER_CONNECTION);
+        return !connection.empty() && connection.front() == "keep-alive";
+    }
+
+    /// Ends a deferred response once it was sent, unless it keeps the connection open
+    void finish_deferred() noexcept {
+        if (deferred.load() && !keeps_connection())
+            end();
+    }
+
+    /**
+     * @brief Adds the Connection, Content-Type and (optionally) Content-Length
+     * headers the handler did not set.
+     * @param content_length false for streamed responses, which have no length
+     */
+    void fill_default_headers(bool content_length) {
+        /// Get the lock of the modify_headers_mutex, to ensure that another thread hasn't
+        /// modified the headers
+        std::lock_guard<std::mutex> lock(modify_headers_mutex);
+        if (response_.get_header(cppress::http::consts::HEADER_CONNECTION).empty()) {
+            response_.add_header(cppress::http::consts::HEADER_CONNECTION, "close");
+        }
+        if (response_.get_header(cppress::http::consts::HEADER_CONTENT_TYPE).empty()) {
+            response_.add_header(cppress::http::consts::HEADER_CONTENT_TYPE, "text/plain");
+        }
+        if (content_length &&
+            response_.get_header(cppress::http::consts::HEADER_CONTENT_LENGTH).empty()) {
+            response_.add_header(cppress::http::consts::HEADER_CONTENT_LENGTH,
+                                 std::to_string(response_.get_body().size()));
+        }
+    }
+
+    /**
+     * @brief Send the body a writing function fills.
+     * @param content_type Content-Type set unless one is set
+     * @param write Called with the empty body to append the text to
+     */
+    template <typename Write>
+    void send_written_body(const char* content_type, Write&& write) noexcept {
+        if (did_send.exchange(true) || did_end.load())
+            return;
+        {
+            std::lock_guard<std::mutex> lock(modify_headers_mutex);
+            if (response_.get_header(cppress::http::consts::HEADER_CONTENT_TYPE).empty())
+                response_.add_header(cppress::http::consts::HEADER_CONTENT_TYPE, content_type);
+        }
+        fill_default_headers(false);
+        try {
+            std::string body;
+            write(body);
+            std::lock_guard<std::mutex> lock(send_response_mutex);
+            response_.send_body(std::move(body));
+        } catch (const std::exception& e) {
+            shared::logger::error("Error sending response: " + std::string(e.what()));
+            end();
+        }
+        finish_deferred();
+    }
+
 public:
     /// Allow server to access private members
     template <typename T, typename G, typename R>
     friend class server;
 
+    /// Ends the client's connection when its upstream fails mid-body
+    friend class reverse_proxy;
+
     /**
      * @brief Private constructor for internal use by server.
      * @param response HTTP response object to wrap (moved)
@@ -201,6 +286,73 @@ public:
         send();
     }
 
+    /**
+     * @brief Send a JSON value, serialized straight into the response body.
+     * @param value Object, array or scalar to send
+     *
+     * The text is sized with stringified_size() and written once into a
+     * buffer of that size, which is queued on the connection as is: no
+     * intermediate strings, no body copy and no concatenation with the head
+     * (see cppress::http::http_response::send_body()). Sets Content-Type
+     * to "application/json" unless one is set; used in place of send().
+     */
+    virtual void json(const cppress::json::json_object& value) noexcept {
+        send_written_body("application/json", [&value](std::string& body) {
+            body.reserve(value.stringified_size());
+            value.stringify_to(body);
+        });
+    }
+
+    /**
+     * @brief Send a struct, or a container of structs, as JSON.
+     * @param value A type bound with CPPRESS_JSON_FIELDS, or a vector, map or optional of one
+     *
+     * Written straight from the members into the body by
+     * cppress::json::to_json(), without a json_object tree; otherwise as
+     * json(const cppress::json::json_object&).
+     */
+    template <typename T,
+              typename = std::enable_if_t<!std::is_base_of_v<cppress::json::json_object, T>>>
+    void json(const T& value) noexcept {
+        send_written_body("application/json", [&value](std::string& body) {
+            cppress::json::json_writer out(body);
+            cppress::json::to_json(value, out);
+        });
+    }
+
+    /**
+     * @brief Stream JSON as it is written, in chunks of a streamed response.
+     * @param write Writes the value, e.g. writer.value(*tree) or an array
+     *        filled row by row; called before stream_json() returns
+     * @param chunk_size Bytes written per chunk
+     *
+     * The writer hands each chunk_size bytes to write_chunk() as they are
+     * written, so a large value is never held whole; sizes need not be
+     * known up front. Sets Content-Type to "application/json" unless one is
+     * set; used in place of send().
+     */
+    virtual void stream_json(const std::function<void(cppress::json::json_writer&)>& write,
+                             std::size_t chunk_size =
+                                 cppress::json::json_writer::DEFAULT_CHUNK_SIZE) noexcept {
+        {
+            std::lock_guard<std::mutex> lock(modify_headers_mutex);
+            if (response_.get_header(cppress::http::consts::HEADER_CONTENT_TYPE).empty())
+                response_.add_header(cppress::http::consts::HEADER_CONTENT_TYPE,
+                                     "application/json");
+        }
+        if (!begin_stream())
+            return;
+        try {
+            cppress::json::json_writer writer(
+                [this](std::string&& chunk) { write_chunk(std::move(chunk)); }, chunk_size);
+            write(writer);
+            writer.flush();
+        } catch (const std::exception& e) {
+            shared::logger::error("Error streaming JSON: " + std::string(e.what()));
+        }
+        end_stream();
+    }
+
     /**
      * @brief Send an HTML response with appropriate content type.
      * @param html_data String containing valid HTML content
@@ -221,6 +373,72 @@ public:
         send();
     }
 
+    /**
+     * @brief Send an element tree as HTML, rendered straight into the response body.
+     * @param root Element to render with its children
+     *
+     * The tree is walked once by render(), each element appending to the
+     * body, which is queued on the connection as is (see
+     * cppress::http::http_response::send_body()). Sets Content-Type to
+     * "text/html" unless one is set; used in place of send().
+     */
+    virtual void html(const cppress::html::element& root) noexcept {
+        send_written_body("text/html", [&root](std::string& body) {
+            cppress::html::html_writer out(body);
+            root.render(out);
+        });
+    }
+
+    /**
+     * @brief Send a document, its DOCTYPE then its tree, as html(const cppress::html::element&).
+     * @param doc Document to render
+     */
+    virtual void html(const cppress::html::document& doc) noexcept {
+        send_written_body("text/html", [&doc](std::string& body) {
+            cppress::html::html_writer out(body);
+            doc.render(out);
+        });
+    }
+
+    /**
+     * @brief Stream HTML as it is rendered, in chunks of a streamed response.
+     * @param write Renders into the writer, e.g. page.render(writer); called
+     *        before stream_html() returns
+     * @param chunk_size Bytes written per chunk
+     *
+     * As stream_json(): the first chunk leaves once chunk_size bytes are
+     * rendered, so the browser can start on the head of a large page while
+     * the rest is written. Fragments written with html_writer::fragment(),
+     * e.g. from a fragment_cache, are queued as chunks of their own by
+     * reference. Sets Content-Type to "text/html" unless one is set; used
+     * in place of send().
+     */
+    virtual void stream_html(const std::function<void(cppress::html::html_writer&)>& write,
+                             std::size_t chunk_size =
+                                 cppress::html::html_writer::DEFAULT_CHUNK_SIZE) noexcept {
+        {
+            std::lock_guard<std::mutex> lock(modify_headers_mutex);
+            if (response_.get_header(cppress::http::consts::HEADER_CONTENT_TYPE).empty())
+                response_.add_header(cppress::http::consts::HEADER_CONTENT_TYPE, "text/html");
+        }
+        if (!begin_stream())
+            return;
+        try {
+            cppress::html::html_writer writer(
+                [this](std::string&& chunk) { write_chunk(std::move(chunk)); },
+                [this](const cppress::html::html_fragment& fragment) {
+                    write_chunk(cppress::sockets::data_buffer(
+                        std::shared_ptr<const char>(fragment, fragment->data()), fragment->size()));
+                },
+                chunk_size);
+            write(writer);
+            writer.flush();
+        } catch (const std::exception& e) {
+            shared::logger::error("Error streaming HTML: " + std::string(e.what()));
+        }
+        end_stream();
+    }
+
     /**
      * @brief Send a plain text response with appropriate content type.
      * @param text_data String containing plain text content
@@ -332,8 +550,8 @@ public:
      * @brief Send the response to the client.
      *
      * Finalizes and sends the HTTP response with all configured headers,
-     * status, and body content. Automatically adds a "Connection: close"
-     * header to properly terminate the HTTP connection.
+     * status, and body content. Adds a "Connection: close" header unless
+     * one is set; the server sets it from the request's keep_alive().
      *
      * This method should be called after setting all desired headers,
      * status, and body content. Once called, the response cannot be
@@ -366,21 +584,7 @@ public:
             set_body(body);
         }
 
-        {
-            /// Get the lock of the modify_headers_mutex, to ensure that another thread hasn't
-            /// modified the headers
-            std::lock_guard<std::mutex> lock(modify_headers_mutex);
-            if (response_.get_header(cppress::http::consts::HEADER_CONNECTION).empty()) {
-                response_.add_header(cppress::http::consts::HEADER_CONNECTION, "close");
-            }
-            if (response_.get_header(cppress::http::consts::HEADER_CONTENT_TYPE).empty()) {
-                response_.add_header(cppress::http::consts::HEADER_CONTENT_TYPE, "text/plain");
-            }
-            if (response_.get_header(cppress::http::consts::HEADER_CONTENT_LENGTH).empty()) {
-                response_.add_header(cppress::http::consts::HEADER_CONTENT_LENGTH,
-                                     std::to_string(response_.get_body().size()));
-            }
-        }
+        fill_default_headers(true);
 
         try {
             std::lock_guard<std::mutex> lock(send_response_mutex);
@@ -389,7 +593,218 @@ public:
             shared::logger::error("Error sending response: " + std::string(e.what()));
             end();
         }
+        finish_deferred();
+    }
+    /**
+     * @brief Send a file, or the byte ranges of it the request asked for.
+     * @param file Region to send, usually cppress::sockets::file_region::open(path)
+     * @param request_headers Headers of the request; Range and If-Range are honoured
+     *
+     * Used in place of send(); see cppress::http::http_response::send_file()
+     * for the 206/416 rules. Set Content-Type, and ETag or Last-Modified for
+     * If-Range, beforehand.
+     */
+    virtual void send_file(const cppress::sockets::file_region& file,
+                           const cppress::http::http_headers& request_headers) noexcept {
+        if (did_send.exchange(true) || did_end.load())
+            return;
+        fill_default_headers(false);
+        try {
+            std::lock_guard<std::mutex> lock(send_response_mutex);
+            response_.send_file(file, request_headers);
+        } catch (const std::exception& e) {
+            shared::logger::error("Error sending file: " + std::string(e.what()));
+            end();
+        }
+        finish_deferred();
+    }
+
+    /**
+     * @brief Send the response with a body held in a shared buffer.
+     * @param body Bytes of the body, queued by reference and never copied
+     *
+     * Used in place of send(); see cppress::http::http_response::send_buffer().
+     */
+    virtual void send_buffer(const cppress::sockets::data_buffer& body) noexcept {
+        if (did_send.exchange(true) || did_end.load())
+            return;
+        fill_default_headers(false);
+        try {
+            std::lock_guard<std::mutex> lock(send_response_mutex);
+            response_.send_buffer(body);
+        } catch (const std::exception& e) {
+            shared::logger::error("Error sending response: " + std::string(e.what()));
+            end();
+        }
+        finish_deferred();
+    }
+
+    /**
+     * @brief Finish the response after the handler returned
+     *
+     * For handlers waiting on an upstream (server::connect_async()) or a
+     * timer (server::run_after()) without holding a worker: call defer()
+     * before returning, then send from the callback, on whatever thread it
+     * runs. The server neither sends nor ends a deferred response itself;
+     * sending it ends the connection unless it is kept alive.
+     */
+    void defer() noexcept { deferred.store(true); }
+
+    /// @brief true once defer() was called
+    bool is_deferred() const noexcept { return deferred.load(); }
+
+    /**
+     * @brief Send a complete response serialized ahead of time.
+     * @param message Status line, headers, blank line and body
+     *
+     * Used in place of send(); no default headers are added, see
+     * cppress::http::http_response::send_serialized().
+     */
+    virtual void send_serialized(const cppress::sockets::data_buffer& message) noexcept {
+        if (did_send.exchange(true) || did_end.load())
+            return;
+        try {
+            std::lock_guard<std::mutex> lock(send_response_mutex);
+            response_.send_serialized(message);
+        } catch (const std::exception& e) {
+            shared::logger::error("Error sending response: " + std::string(e.what()));
+            end();
+        }
+    }
+
+    /// @brief As send_serialized(), with the message in pieces written back to back
+    virtual void send_serialized(std::vector<cppress::sockets::data_buffer>&& parts) noexcept {
+        if (did_send.exchange(true) || did_end.load())
+            return;
+        try {
+            std::lock_guard<std::mutex> lock(send_response_mutex);
+            response_.send_serialized(std::move(parts));
+        } catch (const std::exception& e) {
+            shared::logger::error("Error sending response: " + std::string(e.what()));
+            end();
+        }
+    }
+
+    /**
+     * @brief Whether the client's cached copy is still current
+     *
+     * True for a GET or HEAD whose If-None-Match or If-Modified-Since
+     * matches the ETag or Last-Modified header set so far. send() then
+     * answers 304 without the body, so a handler can check this before
+     * doing the work of building one.
+     */
+    virtual bool is_not_modified() const noexcept {
+        std::lock_guard<std::mutex> lock(send_response_mutex);
+        return response_.is_not_modified();
     }
+
+    /**
+     * @brief Start a streamed response: headers now, body in chunks afterwards.
+     *
+     * Sends the status line and headers with Transfer-Encoding: chunked, in
+     * place of send(); the server's automatic send() after the handler is
+     * then skipped. Follow with write_chunk() calls, possibly from another
+     * thread after the handler returned, and finish with end_stream().
+     * Closing the connection waits until the stream is finished.
+     *
+     * @return false if the response was already sent or ended
+     */
+    virtual bool begin_stream() noexcept {
+        if (did_send.exchange(true) || did_end.load())
+            return false;
+        fill_default_headers(false);
+        try {
+            std::lock_guard<std::mutex> lock(send_response_mutex);
+            response_.begin_stream();
+            return true;
+        } catch (const std::exception& e) {
+            shared::logger::error("Error starting response stream: " + std::string(e.what()));
+            end();
+            return false;
+        }
+    }
+
+    /**
+     * @brief Start a Server-Sent Events stream, in place of send().
+     *
+     * Like begin_stream(), with Content-Type: text/event-stream. Hand the
+     * result to a cppress::http::sse_channel, or write events to it from
+     * any thread; closing it finishes the response.
+     *
+     * @return The stream's writing end, nullptr if the response was already sent or ended
+     */
+    virtual std::shared_ptr<cppress::http::sse_subscriber> begin_event_stream() noexcept {
+        if (did_send.exchange(true) || did_end.load())
+            return nullptr;
+        fill_default_headers(false);
+        try {
+            std::lock_guard<std::mutex> lock(send_response_mutex);
+            return response_.begin_event_stream();
+        } catch (const std::exception& e) {
+            shared::logger::error("Error starting event stream: " + std::string(e.what()));
+            end();
+            return nullptr;
+        }
+    }
+
+    /**
+     * @brief Send one chunk of a streamed response.
+     * @param data Chunk bytes, queued on the connection without another copy
+     */
+    virtual void write_chunk(std::string data) noexcept {
+        try {
+            std::lock_guard<std::mutex> lock(send_response_mutex);
+            response_.write_chunk(std::move(data));
+        } catch (const std::exception& e) {
+            shared::logger::error("Error writing response chunk: " + std::string(e.what()));
+        }
+    }
+
+    /**
+     * @brief Send one chunk of a streamed response, sharing its bytes.
+     * @param data Chunk bytes, e.g. a cached fragment, queued by reference
+     */
+    virtual void write_chunk(cppress::sockets::data_buffer data) noexcept {
+        try {
+            std::lock_guard<std::mutex> lock(send_response_mutex);
+            response_.write_chunk(std::move(data));
+        } catch (const std::exception& e) {
+            shared::logger::error("Error writing response chunk: " + std::string(e.what()));
+        }
+    }
+
+    /**
+     * @brief Finish a streamed response.
+     * @param trailers Trailers to send besides those added with add_trailer()
+     */
+    virtual void end_stream(
+        const std::multimap<std::string, std::string>& trailers = {}) noexcept {
+        try {
+            std::lock_guard<std::mutex> lock(send_response_mutex);
+            response_.end_stream(trailers);
+        } catch (const std::exception& e) {
+            shared::logger::error("Error ending response stream: " + std::string(e.what()));
+        }
+        finish_deferred();
+    }
+
+    /**
+     * @brief Compress the body with a content coding when it is sent.
+     * @param coding Coding, usually negotiated from the request; identity turns it off
+     * @param level Encoder level, DEFAULT_COMPRESSION_LEVEL for the coding's default
+     * @param min_size Bodies smaller than this are sent as they are
+     *
+     * Applies to send() and to streamed responses alike; see
+     * cppress::http::http_response::set_compression() for when a body is
+     * left alone. The compression() middleware calls this for a route.
+     */
+    virtual void set_compression(cppress::http::content_coding coding,
+                                 int level = cppress::http::DEFAULT_COMPRESSION_LEVEL,
+                                 std::size_t min_size = 0) {
+        std::lock_guard<std::mutex> lock(modify_headers_mutex);
+        response_.set_compression(coding, level, min_size);
+    }
+
     /**
      * @brief Set the keep alive object
      *  @note This will add the appropriate headers to the response
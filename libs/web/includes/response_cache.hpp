@@ -0,0 +1,184 @@
+/**
+ * @file response_cache.hpp
+ * @brief Serialized responses of GET routes, reused for a while
+ *
+ * route::set_cache() makes a GET route cacheable. The first request for a
+ * key runs the middleware and handlers as usual, on a worker, with the
+ * output captured; the serialized head and body are kept, and later
+ * requests for the key are answered with them on the event loop: no
+ * middleware, no handler, no worker. Requests for a key being computed
+ * wait for that result rather than running the handlers again. Past its
+ * time to live an entry is still served for the stale-while-revalidate
+ * window, while one request refreshes it in the background.
+ *
+ * The key is the method, the path, the query fields in sorted order and
+ * the values of the policy's Vary headers. Only 200 responses with a
+ * Content-Length, without Set-Cookie and not marked Cache-Control
+ * no-store or private are kept.
+ *
+ * Prefork workers share their responses through a shared_memory_cache,
+ * see share_with(): a response one worker computed is a hit for all of
+ * them, and a worker missing a key, or holding it stale, looks there
+ * before running the handlers. Waiting for a key being computed stays
+ * within a process, so two workers can compute the same key at once.
+ *
+ * @warning Hits skip middleware. Authentication, rate limits and anything
+ * else a router's middleware enforces only run on misses, so a cached route
+ * behind them must vary on the headers they check (Authorization, Cookie),
+ * or the response one client was allowed is served to all.
+ *
+ * @section response_cache_usage Usage Example
+ * @code{.cpp}
+ * // one second fresh, then served stale for up to ten while it is refreshed
+ * server->get("/api/prices", {list_prices})
+ *     ->set_cache({std::chrono::seconds(1), std::chrono::seconds(10), {"Accept-Encoding"}});
+ * @endcode
+ *
+ * @author cppress team
+ * @version 1.0
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "shared/includes/shared_memory_cache.hpp"
+#include "sockets/includes/data_buffer.hpp"
+
+namespace cppress::web {
+
+/**
+ * @brief How long a route's responses are reused, and what they vary on
+ */
+struct cache_policy {
+    /// How long a response is served as it is
+    std::chrono::milliseconds ttl{1000};
+
+    /// How much longer it is served while a request refreshes it
+    std::chrono::milliseconds stale_while_revalidate{0};
+
+    /// Request headers whose values select different responses, e.g. Accept-Encoding
+    std::vector<std::string> vary;
+};
+
+/**
+ * @class response_cache
+ * @brief Serialized responses keyed by request, with coalesced computation
+ *
+ * Thread-safe; waiters are called outside the lock, on the thread that
+ * completes the key.
+ */
+class response_cache {
+public:
+    /// A response as clients receive it, less its Connection header
+    struct entry {
+        /// Status line and headers, without the line break ending the last header
+        cppress::sockets::data_buffer head;
+        cppress::sockets::data_buffer body;
+        std::chrono::steady_clock::time_point fresh_until;
+        std::chrono::steady_clock::time_point stale_until;
+    };
+
+    /// Receives the computed response, nullptr if the handlers produced none
+    using waiter = std::function<void(const std::shared_ptr<const entry>&)>;
+
+    /// Outcome of find()
+    struct lookup {
+        /// The entry to answer with, nullptr on a miss
+        std::shared_ptr<const entry> found;
+
+        /// The caller has to compute the key and complete() it: a miss not
+        /// already being computed, or a stale entry not already refreshed
+        bool fill = false;
+    };
+
+    /**
+     * @param max_bytes Bytes of heads and bodies held; the least recently used are dropped past it
+     */
+    explicit response_cache(std::size_t max_bytes = 16 * 1024 * 1024);
+
+    /**
+     * @brief Look a key up
+     * @param key Request key, see make_key()
+     * @param wait Called with the result when this is a miss; not kept otherwise
+     */
+    lookup find(const std::string& key, waiter wait);
+
+    /**
+     * @brief Hand over what the handlers sent for a key being computed
+     * @param key Key find() asked to fill
+     * @param output Bytes of the response, empty if nothing was sent
+     * @param policy Policy of the route, sets the entry's lifetime
+     *
+     * Every waiter of the key is called, whether the response is kept or not.
+     */
+    void complete(const std::string& key, const std::string& output, const cache_policy& policy);
+
+    /**
+     * @brief Build a request key
+     * @param method Request method
+     * @param path Request path, without the query
+     * @param query Query fields as they appear; sorted here
+     * @param vary Values of the policy's Vary headers, in the policy's order
+     */
+    static std::string make_key(
+        std::string_view method, std::string_view path,
+        std::vector<std::pair<std::string_view, std::string_view>> query,
+        const std::vector<std::string>& vary);
+
+    /// @brief Bytes of heads and bodies currently held
+    std::size_t size() const;
+
+    /// @brief Drop every entry; keys being computed are not affected
+    void clear();
+
+    /**
+     * @brief Keep responses in a segment other processes map too, as well as here
+     * @param segment E.g. cluster_worker::shared_cache(); nullptr to stop sharing
+     *
+     * The segment must outlive the cache. Call before serving requests.
+     */
+    void share_with(shared::shared_memory_cache* segment) noexcept { shared = segment; }
+
+    /// @brief The segment responses are shared through, nullptr if none
+    shared::shared_memory_cache* shared_segment() const noexcept { return shared; }
+
+private:
+    struct slot {
+        std::shared_ptr<const entry> value;
+        std::list<std::string>::iterator recent;
+    };
+
+    void erase(std::unordered_map<std::string, slot>::iterator it);
+
+    /// Holds an entry under its key, replacing the key's; end() if it is over max_bytes
+    std::unordered_map<std::string, slot>::iterator store(const std::string& key,
+                                                          std::shared_ptr<const entry> value);
+
+    /// The segment's entry for a key, nullptr if it has none not yet expired
+    std::shared_ptr<const entry> load_shared(const std::string& key) const;
+
+    std::size_t max_bytes;
+
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, slot> entries;
+    /// Keys, most recently used first
+    std::list<std::string> recent;
+    std::size_t bytes = 0;
+
+    /// Keys being computed, with the requests waiting for them
+    std::unordered_map<std::string, std::vector<waiter>> pending;
+
+    shared::shared_memory_cache* shared = nullptr;
+};
+}  // namespace cppress::web
@@ -12,6 +12,8 @@
  * @li Multiple handler support for middleware chains
  * @li Automatic path parameter population in request objects
  * @li Handler execution with exit code control flow
+ * @li Optional inline handling on the event loop for non-blocking handlers
+ * @li Optional caching of serialized responses, see response_cache.hpp
  *
  * @section route_usage Usage Example
  * @code{.cpp}
@@ -46,12 +48,15 @@
  */
 
 #pragma once
+#include <cstddef>
 #include <iostream>
+#include <optional>
 #include <string>
 #include <type_traits>
 #include <vector>
 
 #include "exceptions.hpp"
+#include "response_cache.hpp"
 #include "types.hpp"
 #include "utilities.hpp"
 
@@ -92,6 +97,28 @@ protected:
     /// Collection of request handlers executed in sequence for this route
     std::vector<request_handler_t<T, G>> handlers;
 
+    /// Largest request body this route accepts, 0 for no limit of its own
+    std::size_t max_body_size = 0;
+
+    /// Handled on the event loop thread instead of the worker pool
+    bool run_inline = false;
+
+    /// Set when the route's responses are cached, see set_cache()
+    std::optional<cache_policy> caching;
+
+    /// The middleware ahead of the route followed by its handlers, see router::freeze()
+    std::vector<request_handler_t<T, G>> chain;
+
+    /// Index of the route's first handler in chain
+    std::size_t handlers_at = 0;
+
+    /// Revisions of the routers chain was built from; it is stale once either moved on
+    std::size_t frozen_outer = 0;
+    std::size_t frozen_own = 0;
+
+    /// chain was built at all
+    bool frozen = false;
+
 public:
     /// Allow router to access private members
     friend class router<T, G>;
@@ -141,6 +168,71 @@ public:
      */
     virtual std::string get_method() const { return method; }
 
+    /**
+     * @brief Limit the size of the request bodies this route accepts.
+     * @param size Largest body in bytes, 0 to lift the limit
+     * @return This route, for chaining
+     *
+     * Larger requests are answered with 413 Payload Too Large without running the
+     * handlers. Clients that send Expect: 100-continue are refused before they upload
+     * the body; for the others the limit is checked once it was read, within
+     * cppress::http::config::MAX_BODY_SIZE.
+     */
+    route& set_max_body_size(std::size_t size) {
+        max_body_size = size;
+        return *this;
+    }
+
+    /// @brief Largest request body this route accepts, 0 if it sets no limit
+    std::size_t get_max_body_size() const { return max_body_size; }
+
+    /// @brief true if a body of this many bytes is within the route's limit
+    bool accepts_body(std::size_t length) const {
+        return max_body_size == 0 || length <= max_body_size;
+    }
+
+    /**
+     * @brief Handle this route's requests on the event loop thread.
+     * @param value true to run inline, false to go back to the worker pool
+     * @return This route, for chaining
+     *
+     * Saves the two thread handoffs of the worker pool, for handlers that
+     * finish in microseconds: health checks, lookups in memory. The
+     * middleware of its router and of the base router runs there too.
+     * Nothing on that path may block, as the loop's other connections wait
+     * meanwhile.
+     */
+    route& set_inline(bool value = true) {
+        run_inline = value;
+        return *this;
+    }
+
+    /// @brief true if the route's requests are handled on the event loop thread
+    bool is_inline() const { return run_inline; }
+
+    /**
+     * @brief Reuse this route's responses for a while.
+     * @param policy Time to live, stale-while-revalidate window and Vary headers
+     * @return This route, for chaining
+     *
+     * For GET routes whose answer depends only on the path, the query and
+     * the listed headers. See response_cache.hpp.
+     *
+     * @warning Cache hits are answered before any middleware runs, the
+     * router's authentication included: a response computed for one
+     * client is served to every other sending the same key. A route
+     * behind authentication has to list the headers the middleware checks,
+     * e.g. Authorization or Cookie, in policy.vary, so that a client
+     * without them misses and is refused by the middleware.
+     */
+    route& set_cache(const cache_policy& policy) {
+        caching = policy;
+        return *this;
+    }
+
+    /// @brief The route's cache policy, nullptr if its responses are not cached
+    const cache_policy* get_cache_policy() const { return caching ? &*caching : nullptr; }
+
     /**
      * @brief Check if this route matches the given method and path.
      * @param request Shared pointer to the request object
@@ -153,7 +245,7 @@ public:
      * @note This function is called by the router class to determine
      * if a request matches this route.
      */
-    virtual bool match(std::shared_ptr<T> request) const {
+    virtual bool match(const std::shared_ptr<T>& request) const {
         auto [matched, path_params] = match_path(this->expression, request->get_path());
         if (matched) {
             request->set_path_params(path_params);
@@ -177,8 +269,8 @@ public:
      *@note This is a const member function, meaning it does not modify the state of the route
      * instance.
      */
-    virtual exit_code handle_request(std::shared_ptr<T> request,
-                                     std::shared_ptr<G> response) const {
+    virtual exit_code handle_request(const std::shared_ptr<T>& request,
+                                     const std::shared_ptr<G>& response) const {
         for (const auto& handler : handlers) {
             auto resp = handler(request, response);
             if (resp == exit_code::EXIT) {
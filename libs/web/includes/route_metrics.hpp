@@ -0,0 +1,171 @@
+/**
+ * @file route_metrics.hpp
+ * @brief Request counters and latency histograms per route
+ *
+ * server::use_metrics() turns recording on. Every request is counted under
+ * its method and route pattern (not its path, so /users/:id is one series),
+ * with three latency histograms: the wait for a worker, the time in the
+ * middleware and handlers, and the total from the request being parsed to
+ * the handlers returning.
+ *
+ * Each thread records into a shard of its own, which only a scrape reads as
+ * well: the hot path takes a lock no other thread holds and bumps plain
+ * counters. A scrape merges the shards, and prometheus() renders them in
+ * the Prometheus text format together with the event loop counters.
+ *
+ * Histograms are log-linear: each power of two of microseconds is split in
+ * four, so a recorded latency is known within 25%.
+ *
+ * @section route_metrics_usage Usage Example
+ * @code{.cpp}
+ * server->use_metrics();  // GET /metrics on the base router
+ * ...
+ * auto snapshot = server->get_metrics()->snapshot();
+ * auto p99 = snapshot.at({"GET", "/api/users/:id"}).total.quantile(0.99);
+ * @endcode
+ *
+ * @author cppress team
+ * @version 1.0
+ */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "sockets/includes/loop_stats.hpp"
+
+namespace cppress::shared {
+struct pool_stats;
+}
+
+namespace cppress::web {
+
+/**
+ * @brief Log-linear histogram of durations
+ *
+ * Bucket b covers [lower_bound_us(b), upper_bound_us(b)) microseconds; the
+ * last one is open.
+ */
+struct latency_histogram {
+    /// Linear buckets per power of two
+    static constexpr std::size_t SUB_BUCKETS = 4;
+
+    /// Powers of two covered, up to about 268 seconds
+    static constexpr std::size_t OCTAVES = 27;
+
+    static constexpr std::size_t BUCKETS = OCTAVES * SUB_BUCKETS + 1;
+
+    std::array<std::uint64_t, BUCKETS> counts{};
+    std::uint64_t count = 0;
+    std::uint64_t sum_ns = 0;
+
+    /// @brief Bucket a duration falls in
+    static std::size_t bucket_of(std::uint64_t ns) noexcept;
+
+    /// @brief Exclusive upper bound of a bucket in microseconds, 0 for the open one
+    static std::uint64_t upper_bound_us(std::size_t bucket) noexcept;
+
+    /// @brief Records one duration
+    void record(std::uint64_t ns) noexcept {
+        ++counts[bucket_of(ns)];
+        ++count;
+        sum_ns += ns;
+    }
+
+    /**
+     * @brief Duration below which a fraction of the recorded ones fall
+     * @param q Fraction in [0, 1]
+     * @return Upper bound of the bucket holding it, zero if nothing was recorded
+     */
+    std::chrono::microseconds quantile(double q) const noexcept;
+
+    /// @brief Adds the counts of another histogram
+    latency_histogram& operator+=(const latency_histogram& other) noexcept;
+};
+
+/**
+ * @class route_metrics
+ * @brief Per-route request metrics, recorded in per-thread shards
+ *
+ * Thread-safe. A thread's first observation allocates its shard; shards
+ * live as long as the registry.
+ */
+class route_metrics {
+public:
+    /// What was recorded for one method and route
+    struct series {
+        std::uint64_t requests = 0;
+
+        /// Between the request being queued and a worker picking it up
+        latency_histogram queue_wait;
+
+        /// Middleware and handlers
+        latency_histogram handler;
+
+        /// From the request being parsed to its handlers returning
+        latency_histogram total;
+
+        series& operator+=(const series& other) noexcept;
+    };
+
+    /// Series by method and route pattern
+    using snapshot_t = std::map<std::pair<std::string, std::string>, series>;
+
+    route_metrics();
+    route_metrics(const route_metrics&) = delete;
+    route_metrics& operator=(const route_metrics&) = delete;
+
+    /**
+     * @brief Record one request
+     * @param method Request method
+     * @param route Route pattern, or a placeholder for static files and unmatched paths
+     * @param queue_wait Time waiting for a worker, zero when handled on the event loop
+     * @param handler Time in middleware and handlers
+     * @param total Time since the request was parsed
+     */
+    void observe(std::string_view method, std::string_view route,
+                 std::chrono::nanoseconds queue_wait, std::chrono::nanoseconds handler,
+                 std::chrono::nanoseconds total);
+
+    /// @brief Every shard merged
+    snapshot_t snapshot() const;
+
+    /**
+     * @brief Render the metrics in the Prometheus text exposition format
+     * @param loops Event loop counters to include, e.g. epoll_server::stats()
+     * @param workers Worker pool size and sizing measurements to include, if any
+     *
+     * Histogram buckets are given at each power of two of microseconds.
+     * Builds with CPPRESS_ALLOC_ACCOUNTING add the heap allocations and
+     * bytes copied per request phase, see alloc_accounting.hpp.
+     */
+    std::string prometheus(const cppress::sockets::loop_stats& loops,
+                           const cppress::shared::pool_stats* workers = nullptr) const;
+
+private:
+    struct shard {
+        std::mutex mutex;
+        std::unordered_map<std::string, series> series_by_key;
+    };
+
+    /// The calling thread's shard, made on its first call
+    shard& local_shard();
+
+    /// Distinguishes registries in the threads' shard caches, addresses may be reused
+    const std::uint64_t id;
+
+    mutable std::mutex shards_mutex;
+    std::vector<std::unique_ptr<shard>> shards;
+};
+}  // namespace cppress::web
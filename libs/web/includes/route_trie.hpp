@@ -0,0 +1,138 @@
+/**
+ * @file route_trie.hpp
+ * @brief Route expressions compiled into one segment trie per HTTP method
+ *
+ * router compiles every route into this trie when it is registered, so a
+ * request is routed with one walk over its path instead of one match_path()
+ * call per route. Each node has static children keyed by segment, at most
+ * one ":param" child and the "*" wildcards that end there.
+ *
+ * The outcome is the one match_path() gives when routes are tried in
+ * registration order: where several routes match, the earliest registered
+ * wins, whichever kind of segment it used. Every node knows the earliest
+ * route below it, so branches that cannot beat the best match so far are
+ * never entered and the walk stays proportional to the path's length.
+ *
+ * @note This is an internal implementation detail used by router
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace cppress::web {
+
+/**
+ * @struct path_capture
+ * @brief One path parameter of a matched route, as it appears in the path
+ */
+struct path_capture {
+    /// Parameter name from the route expression, "*" for the wildcard
+    std::string_view name;
+
+    /// Raw value, still URL-encoded; a view of the path that was looked up
+    std::string_view value;
+};
+
+/**
+ * @class path_captures
+ * @brief The path parameters of one lookup, held inline up to INLINE of them
+ *
+ * Routes rarely have more than a few parameters, so filling this never
+ * touches the heap; more than INLINE spill to a vector.
+ */
+class path_captures {
+public:
+    static constexpr std::size_t INLINE = 8;
+
+    void push_back(path_capture capture) {
+        if (count_ < INLINE)
+            inline_[count_] = capture;
+        else
+            overflow_.push_back(capture);
+        ++count_;
+    }
+
+    const path_capture& operator[](std::size_t i) const {
+        return i < INLINE ? inline_[i] : overflow_[i - INLINE];
+    }
+
+    std::size_t size() const { return count_; }
+    bool empty() const { return count_ == 0; }
+
+    void clear() {
+        count_ = 0;
+        overflow_.clear();
+    }
+
+private:
+    std::array<path_capture, INLINE> inline_{};
+    std::vector<path_capture> overflow_;
+    std::size_t count_ = 0;
+};
+
+/**
+ * @class route_trie
+ * @brief Maps (method, path) to the index of the first route that matches
+ *
+ * Not synchronized: routes are added before the server starts, lookups
+ * may then run concurrently.
+ */
+class route_trie {
+public:
+    /// Returned by find() when no route matches
+    static constexpr std::size_t NONE = static_cast<std::size_t>(-1);
+
+    route_trie();
+    ~route_trie();
+    route_trie(route_trie&&) noexcept;
+    route_trie& operator=(route_trie&&) noexcept;
+
+    /**
+     * @brief Compile a route expression
+     * @param method HTTP method the route answers
+     * @param expression Path pattern, as accepted by match_path()
+     * @param index Registration order of the route; lower indexes win
+     */
+    void insert(const std::string& method, const std::string& expression, std::size_t index);
+
+    /**
+     * @brief Find the first registered route matching a request
+     * @param method Request method
+     * @param path Request path, without the query
+     * @param[out] captures Path parameters of the route found, not decoded; names are
+     *             views of this trie and values views of path
+     * @return Index of the route, NONE if none matches
+     */
+    std::size_t find(const std::string& method, std::string_view path,
+                     path_captures& captures) const;
+
+    /**
+     * @brief Find the first registered route matching a request
+     * @param[out] params Path parameters of the route found, URL-decoded
+     * @return Index of the route, NONE if none matches
+     */
+    std::size_t find(const std::string& method, std::string_view path,
+                     std::map<std::string, std::string>& params) const;
+
+    /// @brief Drop every route
+    void clear();
+
+private:
+    struct node;
+    struct method_routes;
+    struct search;
+
+    /// One trie per method, and the parameter names of every route by index
+    std::unordered_map<std::string, std::unique_ptr<method_routes>> methods_;
+    std::vector<std::vector<std::string>> param_names_;
+};
+
+}  // namespace cppress::web
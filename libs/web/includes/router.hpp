@@ -12,6 +12,8 @@
  * @li Comprehensive error handling
  * @li Support for GET, POST, PUT, DELETE shortcuts
  * @li Ordered route matching (first match wins)
+ * @li Routes compiled into a per-method segment trie, one walk over the path per request
+ * @li Cached GET routes answered from serialized responses, see route::set_cache()
  *
  * @section router_usage Usage Example
  * @code{.cpp}
@@ -61,6 +63,7 @@
 #pragma once
 
 #include <iostream>
+#include <map>
 #include <memory>
 #include <string>
 #include <type_traits>
@@ -69,6 +72,8 @@
 #include "exceptions.hpp"
 #include "request.hpp"
 #include "response.hpp"
+#include "response_cache.hpp"
+#include "route_trie.hpp"
 #include "types.hpp"
 
 namespace cppress::web {
@@ -105,9 +110,24 @@ protected:
     /// Collection of registered routes for handling specific path patterns
     std::vector<std::shared_ptr<route<T, G>>> routes;
 
+    /// The routes' methods and expressions, compiled; maps to indexes into routes
+    route_trie compiled_routes;
+
     /// Collection of middleware handlers executed before route processing
     std::vector<request_handler_t<T, G>> middlewares;
 
+    /// Middleware that only needs the headers, also run before a body is read
+    std::vector<request_handler_t<T, G>> before_body_middlewares;
+
+    /// Every route of this router is handled on the event loop thread
+    bool run_inline = false;
+
+    /// Responses of the routes marked with route::set_cache()
+    std::shared_ptr<response_cache> cached_responses = std::make_shared<response_cache>();
+
+    /// Bumped by every route or middleware added, tells frozen chains they are stale
+    std::size_t revision = 0;
+
     /**
      * @brief Execute all registered middleware handlers in sequence.
      * @param request Shared pointer to the request object
@@ -131,9 +151,16 @@ protected:
      * - Rate limiting
      * - Request body parsing and validation
      */
-    virtual exit_code middleware_handle_request(std::shared_ptr<T> request,
-                                                std::shared_ptr<G> response) {
-        for (const auto& middleware : middlewares) {
+    virtual exit_code middleware_handle_request(const std::shared_ptr<T>& request,
+                                                const std::shared_ptr<G>& response) {
+        return run_middlewares(middlewares, request, response);
+    }
+
+    /// Runs one middleware chain, see middleware_handle_request()
+    exit_code run_middlewares(const std::vector<request_handler_t<T, G>>& chain,
+                              const std::shared_ptr<T>& request,
+                              const std::shared_ptr<G>& response) {
+        for (const auto& middleware : chain) {
             auto result = middleware(request, response);
             if (result == exit_code::EXIT) {
                 return exit_code::EXIT;
@@ -154,6 +181,28 @@ protected:
         return exit_code::CONTINUE;
     }
 
+    /// Walks a frozen chain: middleware, then the body limit, then the route's handlers
+    static void run_chain(const route<T, G>& matched, const std::shared_ptr<T>& request,
+                          const std::shared_ptr<G>& response) {
+        const auto& chain = matched.chain;
+        for (std::size_t i = 0; i < chain.size(); ++i) {
+            if (i == matched.handlers_at) {
+                if (!matched.accepts_body(request->get_content_length())) {
+                    refuse_too_large(response);
+                    return;
+                }
+                request->trace_mark(trace_point::routed);
+            }
+            const exit_code result = chain[i](request, response);
+            if (result == exit_code::CONTINUE)
+                continue;
+            if (result != exit_code::EXIT && result != exit_code::_ERROR)
+                throw std::runtime_error(
+                    "Invalid handler, return value must be a cppress::web::exit_code\n");
+            return;
+        }
+    }
+
 public:
     /// Allow server to access protected members
     template <typename, typename, typename>
@@ -202,34 +251,181 @@ public:
      *
      * @note This method is typically called by the server for each incoming request
      */
-    virtual bool handle_request(std::shared_ptr<T> request, std::shared_ptr<G> response) {
+    virtual bool handle_request(const std::shared_ptr<T>& request,
+                                const std::shared_ptr<G>& response) {
         try {
+            if (before_body_handle_request(request, response) != exit_code::CONTINUE)
+                return true;
             exit_code middleware_result = middleware_handle_request(request, response);
             if (middleware_result != exit_code::CONTINUE) {
                 return true;
             }
             // If middleware allows, try to match routes
-            for (const auto& route : routes) {
-                if (route->match(request)) {
-                    route->handle_request(request, response);
+            if (auto route = find_route(request)) {
+                if (!route->accepts_body(request->get_content_length())) {
+                    refuse_too_large(response);
                     return true;
                 }
+                request->trace_mark(trace_point::routed);
+                route->handle_request(request, response);
+                return true;
             }
 
             return false;
         } catch (exception& e)  // Unhandled exception thrown from middleware/route handler
         {
-            shared::logger::error("Web error in router: " + std::string(e.what()));
-            shared::logger::error("Status code: " + std::to_string(e.get_status_code()) +
-                                  " Message: " + e.get_status_message());
+            shared::logger::error("Web error in router: ", e.what());
+            shared::logger::error("Status code: ", e.get_status_code(),
+                                  " Message: ", e.get_status_message());
             throw;
         } catch (const std::exception& e)  // Unhandled exception
         {
-            shared::logger::error("Unhandled exception in router: " + std::string(e.what()));
+            shared::logger::error("Unhandled exception in router: ", e.what());
             throw;
         }
     }
 
+    /**
+     * @brief Flatten each route's middleware and handlers into one sequence.
+     * @param outer Router whose middleware runs ahead of this one's, null for none
+     *
+     * Every route gets the use_before_body() and use() middleware of outer,
+     * then those of this router, then its own handlers, copied into one
+     * array that handle_route() walks in a single loop. Call once all
+     * routes and middleware are registered; the server does on listen().
+     * Adding any later leaves the chains stale, and handle_route() goes back
+     * to running the lists one by one until freeze() is called again.
+     *
+     * @note Overrides of middleware_handle_request() and
+     *       before_body_handle_request() are bypassed by frozen chains
+     */
+    void freeze(const router* outer = nullptr) {
+        std::vector<request_handler_t<T, G>> ahead;
+        auto append = [&ahead](const std::vector<request_handler_t<T, G>>& from) {
+            ahead.insert(ahead.end(), from.begin(), from.end());
+        };
+        if (outer) {
+            append(outer->before_body_middlewares);
+            append(outer->middlewares);
+        }
+        append(before_body_middlewares);
+        append(middlewares);
+        for (const auto& r : routes) {
+            r->chain = ahead;
+            r->chain.insert(r->chain.end(), r->handlers.begin(), r->handlers.end());
+            r->handlers_at = ahead.size();
+            r->frozen_outer = outer ? outer->revision : 0;
+            r->frozen_own = revision;
+            r->frozen = true;
+        }
+    }
+
+    /**
+     * @brief Run a route this router matched, with the middleware ahead of it.
+     * @param matched The route, as find_route() returned it for this request
+     * @param outer Router whose middleware runs first, as given to freeze()
+     * @param request Shared pointer to the request object
+     * @param response Shared pointer to the response object
+     *
+     * What handle_request() does for a matched request, less the routing,
+     * plus outer's middleware: one pass over the frozen chain if it is
+     * current, the middleware lists and the route otherwise.
+     */
+    void handle_route(route<T, G>& matched, router* outer, const std::shared_ptr<T>& request,
+                      const std::shared_ptr<G>& response) {
+        try {
+            if (matched.frozen && matched.frozen_own == revision &&
+                matched.frozen_outer == (outer ? outer->revision : 0)) {
+                run_chain(matched, request, response);
+                return;
+            }
+            for (router* r : {outer, this}) {
+                if (r && (r->before_body_handle_request(request, response) != exit_code::CONTINUE ||
+                          r->middleware_handle_request(request, response) != exit_code::CONTINUE))
+                    return;
+            }
+            if (!matched.accepts_body(request->get_content_length())) {
+                refuse_too_large(response);
+                return;
+            }
+            request->trace_mark(trace_point::routed);
+            matched.handle_request(request, response);
+        } catch (exception& e) {
+            shared::logger::error("Web error in router: ", e.what());
+            shared::logger::error("Status code: ", e.get_status_code(),
+                                  " Message: ", e.get_status_message());
+            throw;
+        } catch (const std::exception& e) {
+            shared::logger::error("Unhandled exception in router: ", e.what());
+            throw;
+        }
+    }
+
+    /**
+     * @brief Execute the middleware registered with use_before_body().
+     * @param request Shared pointer to the request object, its body may not be read yet
+     * @param response Shared pointer to the response object
+     * @return exit_code indicating the result, as for middleware_handle_request()
+     */
+    virtual exit_code before_body_handle_request(const std::shared_ptr<T>& request,
+                                                 const std::shared_ptr<G>& response) {
+        return run_middlewares(before_body_middlewares, request, response);
+    }
+
+    /**
+     * @brief Find the route of a request.
+     * @param request Shared pointer to the request object, gets the route's path parameters
+     * @return The first matching route, nullptr if none matches
+     *
+     * Looks the method and path up in the compiled trie rather than calling
+     * route::match() on each route; the result is the same, in time
+     * proportional to the path's length instead of the number of routes.
+     * Parameters are handed over as views of the URI, decoded when read.
+     */
+    std::shared_ptr<route<T, G>> find_route(const std::shared_ptr<T>& request) const {
+        path_captures captures;
+        std::size_t index =
+            compiled_routes.find(request->get_method(), request->get_path_view(), captures);
+        if (index == route_trie::NONE)
+            return nullptr;
+        request->set_path_captures(captures);
+        return routes[index];
+    }
+
+    /**
+     * @brief Handle all of this router's requests on the event loop thread.
+     * @param value true to run inline, false to leave it to each route
+     *
+     * As route::set_inline() for every route, present and future; its
+     * middleware runs there as well, so none of it may block.
+     */
+    void set_inline(bool value = true) { run_inline = value; }
+
+    /// @brief true if all of this router's requests are handled on the event loop thread
+    bool is_inline() const { return run_inline; }
+
+    /**
+     * @brief Bound the memory of the router's response cache
+     * @param max_bytes Bytes of cached responses held (default 16 MB)
+     *
+     * Drops what was cached so far, and keeps sharing through the same
+     * segment if the cache did. Call before serving requests.
+     */
+    void use_response_cache(std::size_t max_bytes) {
+        auto* segment = cached_responses->shared_segment();
+        cached_responses = std::make_shared<response_cache>(max_bytes);
+        cached_responses->share_with(segment);
+    }
+
+    /// @brief The cache holding responses of this router's cached routes
+    const std::shared_ptr<response_cache>& get_response_cache() const { return cached_responses; }
+
+    /// @brief Answer 413 for a body over the route's limit
+    static void refuse_too_large(const std::shared_ptr<G>& response) {
+        response->set_status(413, "Payload Too Large");
+        response->send_text("413 Payload Too Large");
+    }
+
     /**
      * @brief Register a new route with the router.
      * @param route Shared pointer to the route object to register
@@ -239,7 +435,8 @@ public:
      * overlapping patterns. The first matching route will be executed.
      *
      * The route must have a non-empty path expression, or an invalid_argument
-     * exception will be thrown.
+     * exception will be thrown. Its method and expression are compiled into
+     * the router's trie here, routes must not be added once requests are served.
      *
      * @throws std::invalid_argument if the route path is empty
      */
@@ -247,7 +444,9 @@ public:
         if (route->get_path().empty()) {
             throw std::invalid_argument("Route path cannot be empty");
         }
+        compiled_routes.insert(route->get_method(), route->get_path(), routes.size());
         routes.push_back(route);
+        ++revision;
     }
 
     /**
@@ -259,34 +458,65 @@ public:
      */
     virtual void use(const request_handler_t<T, G>& middleware) {
         middlewares.push_back(middleware);
+        ++revision;
+    }
+
+    /**
+     * @brief Register a middleware handler that only needs the request headers.
+     * @param middleware Function object that implements middleware logic
+     *
+     * Runs ahead of the use() middleware. For clients that send
+     * Expect: 100-continue it also runs before the body is uploaded, so that
+     * authentication, say, can refuse the request without reading it; such
+     * requests go through it twice, once without and once with their body.
+     */
+    virtual void use_before_body(const request_handler_t<T, G>& middleware) {
+        before_body_middlewares.push_back(middleware);
+        ++revision;
     }
 
     /// @brief Register a GET route with the router.
     /// @param path The path for the route
     /// @param handlers The request handlers for the route
-    void get(const std::string& path, std::vector<request_handler_t<T, G>> handlers) {
-        add_route(std::make_shared<route<T, G>>("GET", path, handlers));
+    /// @return The route, e.g. to set its body size limit
+    std::shared_ptr<route<T, G>> get(const std::string& path,
+                                     std::vector<request_handler_t<T, G>> handlers) {
+        auto added = std::make_shared<route<T, G>>("GET", path, handlers);
+        add_route(added);
+        return added;
     }
 
     /// @brief Register a POST route with the router.
     /// @param path The path for the route
     /// @param handlers The request handlers for the route
-    void post(const std::string& path, std::vector<request_handler_t<T, G>> handlers) {
-        add_route(std::make_shared<route<T, G>>("POST", path, handlers));
+    /// @return The route, e.g. to set its body size limit
+    std::shared_ptr<route<T, G>> post(const std::string& path,
+                                     std::vector<request_handler_t<T, G>> handlers) {
+        auto added = std::make_shared<route<T, G>>("POST", path, handlers);
+        add_route(added);
+        return added;
     }
 
     /// @brief Register a PUT route with the router.
     /// @param path The path for the route
     /// @param handlers The request handlers for the route
-    void put(const std::string& path, std::vector<request_handler_t<T, G>> handlers) {
-        add_route(std::make_shared<route<T, G>>("PUT", path, handlers));
+    /// @return The route, e.g. to set its body size limit
+    std::shared_ptr<route<T, G>> put(const std::string& path,
+                                     std::vector<request_handler_t<T, G>> handlers) {
+        auto added = std::make_shared<route<T, G>>("PUT", path, handlers);
+        add_route(added);
+        return added;
     }
 
     /// @brief Register a DELETE route with the router.
     /// @param path The path for the route
     /// @param handlers The request handlers for the route
-    void delete_(const std::string& path, std::vector<request_handler_t<T, G>> handlers) {
-        add_route(std::make_shared<route<T, G>>("DELETE", path, handlers));
+    /// @return The route, e.g. to set its body size limit
+    std::shared_ptr<route<T, G>> delete_(const std::string& path,
+                                     std::vector<request_handler_t<T, G>> handlers) {
+        auto added = std::make_shared<route<T, G>>("DELETE", path, handlers);
+        add_route(added);
+        return added;
     }
 };
 }  // namespace cppress::web
@@ -15,6 +15,8 @@
  * @li HTTP keep-alive connection support
  * @li Custom error and 404 handlers
  * @li Header processing callbacks
+ * @li Per-route latency metrics with a Prometheus endpoint
+ * @li Sampled request tracing with W3C traceparent propagation
  *
  * @section server_usage Usage Example
  * @code{.cpp}
@@ -37,6 +39,7 @@
  *
  * // Serve static files from ./public directory
  * server->use_static("./public");
+ * server->use_static_compression();  // .br/.gz siblings, or cached encodings
  *
  * // Custom 404 handler
  * server->use_default([](auto req, auto res) {
@@ -70,8 +73,9 @@
  * @section server_request_flow Request Processing Flow
  * -# Request received by HTTP server layer
  * -# Request/response converted to web objects
- * -# Request queued to worker thread pool
- * -# Worker executes request_handler():
+ * -# Request queued to worker thread pool, or answered 503 when the queue is full;
+ *    requests for inline routes are handled on the event loop instead
+ * -# Worker executes request_handler(), or answers 503 if the request waited too long:
  *    - Check if URI is static file
  *    - If static, serve file and return
  *    - If dynamic, try each router in order
@@ -93,18 +97,36 @@
 
 #pragma once
 
+#include <chrono>
+#include <cstdint>
+#include <fstream>
 #include <iostream>
+#include <sstream>
 #include <thread>
+#include <unordered_map>
 
 #include "../includes.hpp"
+#include "compression.hpp"
 #include "exceptions.hpp"
+#include "object_pool.hpp"
+#include "rate_limiter.hpp"
+#include "request_arena.hpp"
+#include "route_metrics.hpp"
+#include "tracing.hpp"
+#include "static_file_cache.hpp"
+#include "static_manifest.hpp"
 #include "http/includes.hpp"
+#include "libs/html/includes/document_parser.hpp"
+#include "libs/html/includes/html_template.hpp"
+#include "shared/includes/alloc_accounting.hpp"
+#include "shared/includes/cpu_topology.hpp"
+#include "shared/includes/startup_snapshot.hpp"
 #include "shared/includes/thread_pool.hpp"
 #include "shared/includes/utils.hpp"
 
 #define HEADER_RECEIVED_PARAMS                                                            \
     std::shared_ptr<cppress::sockets::connection> conn,                                   \
-        const std::multimap<std::string, std::string>&headers, const std::string &method, \
+        const cppress::http::http_headers &headers, const std::string &method,            \
         const std::string &uri, const std::string &version, const std::string &body
 namespace cppress::web {
 /**
@@ -137,15 +159,232 @@ protected:
     /// Server host/IP address
     std::string host;
 
+    /// Where reactors and workers run, empty unless http::config::NUMA_PLACEMENT
+    shared::cpu_placement placement;
+
     /// Thread pool for handling requests concurrently
     shared::thread_pool worker_pool;
 
+    /// Requests let wait for a worker, see limit_request_queue()
+    std::size_t queue_limit = cppress::http::config::REQUEST_QUEUE_LIMIT;
+
+    /// Longest a request waits for a worker before it is shed
+    std::chrono::milliseconds queue_timeout = cppress::http::config::REQUEST_QUEUE_TIMEOUT;
+
+    /// Requests of one connection go to one worker, see use_worker_affinity()
+    bool worker_affinity = false;
+
+    /// The 503 shed requests get, serialized once
+    cppress::sockets::data_buffer overloaded =
+        serialize_overloaded(cppress::http::config::REQUEST_RETRY_AFTER_SECONDS);
+
     /// Directories to serve static files from
     std::vector<std::string> static_directories;
 
+    /// Encoded static files, null until use_static_compression()
+    std::shared_ptr<static_variant_cache> static_variants;
+
+    /// Resolved static files and the content of small ones, see use_static_cache()
+    std::shared_ptr<static_file_cache> static_files = std::make_shared<static_file_cache>();
+
+    /// Index of the directories registered with a manifest, null if none was
+    std::shared_ptr<static_manifest> static_index;
+
+    /// Some directory was registered without a manifest and has to be probed
+    bool static_probing = false;
+
+    /// Snapshot file of use_startup_snapshot(), empty if none
+    std::string startup_path;
+
+    /// The snapshot as it was when the server started, null if there was no usable one
+    std::shared_ptr<const shared::startup_snapshot> startup;
+
+    /// Everything the next snapshot holds, loaded or built
+    shared::snapshot_writer startup_sections;
+
+    /// Something was built rather than loaded, so listen() writes the snapshot
+    bool startup_stale = false;
+
+    /// Templates of load_template() by file
+    std::unordered_map<std::string, std::shared_ptr<const html::html_template>> templates;
+
+    /// Per-route request metrics, null until use_metrics()
+    std::shared_ptr<route_metrics> metrics;
+
+    /// Request tracing, null until use_tracing()
+    std::shared_ptr<tracer> tracing;
+
+    /// Limits checked on the event loop, null until use_rate_limit()
+    std::shared_ptr<rate_limiter> limiter;
+
+    /// What use_rate_limit() counts requests against
+    rate_limit_key limit_key;
+
+    static cppress::sockets::data_buffer serialize_overloaded(std::chrono::seconds retry_after) {
+        static const std::string body = "503 Service Unavailable";
+        return cppress::sockets::data_buffer(
+            "HTTP/1.1 503 Service Unavailable\r\n"
+            "Content-Type: text/plain\r\n"
+            "Content-Length: " +
+            std::to_string(body.size()) + "\r\nRetry-After: " +
+            std::to_string(retry_after.count()) + "\r\nConnection: close\r\n\r\n" + body);
+    }
+
+    /// The router and route a request resolves to, nulls for static files and unmatched paths
+    std::pair<R*, std::shared_ptr<route<T, G>>> resolve(const std::shared_ptr<T>& req) const {
+        if (is_uri_static(req->get_uri()))
+            return {nullptr, nullptr};
+        for (const auto& router : routers)
+            if (auto matched = router->find_route(req))
+                return {router.get(), matched};
+        return {nullptr, nullptr};
+    }
+
+    /// The series a request is recorded under: its route's pattern, or a placeholder
+    std::string metrics_route(const std::shared_ptr<T>& req,
+                              const std::shared_ptr<route<T, G>>& matched) const {
+        if (matched)
+            return matched->get_path();
+        return is_uri_static(req->get_uri()) ? "<static>" : "<unmatched>";
+    }
+
+    /// Hands a traced request's spans to its tracer
+    static void finish_trace(const std::shared_ptr<T>& req) {
+        if (req->trace)
+            req->trace->owner->finish(*req->trace);
+    }
+
+    /// Flushes the traces on a worker every flush interval, for as long as the loops run
+    void schedule_trace_flush() {
+        this->run_after(tracing->options().flush_interval, [this, traces = tracing]() {
+            worker_pool.enqueue([traces]() { traces->flush(); });
+            schedule_trace_flush();
+        });
+    }
+
+    /// Writes a cached response, with the Connection header of this request
+    static void send_cached(const std::shared_ptr<G>& res, const response_cache::entry& cached,
+                            bool keep_alive) {
+        static const cppress::sockets::data_buffer keep(
+            std::string("\r\nConnection: keep-alive\r\n\r\n"));
+        static const cppress::sockets::data_buffer close(
+            std::string("\r\nConnection: close\r\n\r\n"));
+        std::vector<cppress::sockets::data_buffer> parts{cached.head, keep_alive ? keep : close};
+        if (!cached.body.empty())
+            parts.push_back(cached.body);
+        res->send_serialized(std::move(parts));
+        if (!keep_alive)
+            res->end();
+    }
+
+    /**
+     * @brief Answer a request for a cached route, or have its response computed
+     *
+     * Runs on the event loop. Hits are written from the cache; a miss waits
+     * for the key's response, computed by fill() unless it already is.
+     */
+    void answer_from_cache(R& router, const cache_policy& policy, const std::shared_ptr<T>& req,
+                           const std::shared_ptr<G>& res) {
+        std::vector<std::string> vary;
+        vary.reserve(policy.vary.size());
+        for (const auto& name : policy.vary) {
+            std::string joined;
+            for (const auto& value : req->get_header(name))
+                joined.append(value).append(",");
+            vary.push_back(std::move(joined));
+        }
+        std::string key = response_cache::make_key(req->get_method(), req->get_path_view(),
+                                                   req->parsed_query(), vary);
+
+        const bool keep_alive = req->keep_alive();
+        const auto& cache = router.get_response_cache();
+        auto found = cache->find(key, [this, res, keep_alive](
+                                          const std::shared_ptr<const response_cache::entry>& e) {
+            if (e)
+                send_cached(res, *e, keep_alive);
+            else
+                shed(res);
+        });
+        if (found.found)
+            send_cached(res, *found.found, keep_alive);
+        if (found.fill)
+            fill(cache, std::move(key), policy, req);
+    }
+
+    /**
+     * @brief Run the handlers of a cached route for the cache alone
+     *
+     * The request goes through request_handler() on a worker as any other,
+     * with a response that writes into a string instead of a connection;
+     * what it sent completes the key. A handler that defers completes it
+     * when it sends, or ends, the response later.
+     */
+    void fill(std::shared_ptr<response_cache> cache, std::string key, const cache_policy& policy,
+              const std::shared_ptr<T>& req) {
+        struct capture {
+            std::shared_ptr<response_cache> cache;
+            std::string key;
+            cache_policy policy;
+            std::string output;
+            std::atomic<bool> done{false};
+
+            void finish() {
+                if (!done.exchange(true))
+                    cache->complete(key, output, policy);
+            }
+        };
+        auto state = std::make_shared<capture>();
+        state->cache = std::move(cache);
+        state->key = std::move(key);
+        state->policy = policy;
+
+        bool queued = worker_pool.try_enqueue(
+            [this, req, state]() {
+                auto output = cppress::http::http_response::detached(
+                    [state](std::vector<std::string>&& parts, bool last) {
+                        for (const auto& part : parts)
+                            state->output.append(part);
+                        if (last)
+                            state->finish();
+                    },
+                    [state]() { state->finish(); });
+                auto res = std::allocate_shared<G>(pool_allocator<G>(), std::move(output));
+                request_handler(req, res);
+                // a deferred response completes the key from its sink once it is sent
+                if (!res->is_deferred())
+                    state->finish();
+            },
+            queue_limit);
+        if (!queued)
+            state->finish();
+    }
+
+    /// Worker of a connection; its address is mixed first, allocations share their low bits.
+    /// With a placement, one of the workers on the cache of the reactor serving it
+    std::size_t worker_for(const void* connection) const noexcept {
+        const auto bits = static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(connection));
+        const auto mixed = static_cast<std::size_t>((bits * 0x9E3779B97F4A7C15ull) >> 32);
+        const std::size_t reactor = this->current_reactor_index();
+        if (reactor < placement.reactor_workers.size() &&
+            !placement.reactor_workers[reactor].empty()) {
+            const std::vector<std::size_t>& local = placement.reactor_workers[reactor];
+            return local[mixed % local.size()];
+        }
+        return mixed % worker_pool.size();
+    }
+
+    /// Answers a request the server has no room for, without running anything of it
+    void shed(const std::shared_ptr<G>& res) {
+        res->send_serialized(overloaded);
+        res->end();
+    }
+
     /// Registered routers for handling dynamic requests
     std::vector<std::shared_ptr<R>> routers;
 
+    /// Segment the routers' response caches share, see share_response_cache()
+    shared::shared_memory_cache* shared_responses = nullptr;
+
     /**
      * @brief Callback executed when server starts listening
      *
@@ -183,8 +422,9 @@ protected:
      * Default implementation returns 404 Not Found with plain text message.
      * Can be customized via use_default() method.
      */
-    request_handler_t<T, G> handle_default_route = []([[maybe_unused]] std::shared_ptr<T> req,
-                                                      std::shared_ptr<G> res) -> exit_code {
+    request_handler_t<T, G> handle_default_route =
+        []([[maybe_unused]] const std::shared_ptr<T>& req,
+           const std::shared_ptr<G>& res) -> exit_code {
         res->set_status(404, "Not Found");
         res->send_text("404 Not Found");
         return exit_code::EXIT;
@@ -210,6 +450,7 @@ public:
      * @param port Port number to listen on (1-65535)
      * @param host Host address to bind to (default: "0.0.0.0" for all interfaces)
      * @param worker_threads Number of worker threads in the pool (default: hardware concurrency)
+     * @param reactor_count Number of network event loops (default: http::config::REACTOR_COUNT)
      *
      * @throws std::invalid_argument if port is invalid or worker_threads is 0
      *
@@ -217,11 +458,17 @@ public:
      * @note Base router is created automatically and accessible via index 0
      */
     explicit server(int port, const std::string& host = "0.0.0.0",
-                    std::size_t worker_threads = std::thread::hardware_concurrency())
-        : cppress::http::http_server(port, host),
+                    std::size_t worker_threads = std::thread::hardware_concurrency(),
+                    std::size_t reactor_count = cppress::http::config::REACTOR_COUNT)
+        : cppress::http::http_server(port, host, cppress::http::config::TIMEOUT_MILLISECONDS,
+                                     reactor_count),
           port(port),
           host(host),
-          worker_pool(worker_threads) {
+          placement(cppress::http::config::NUMA_PLACEMENT
+                        ? shared::cpu_topology::system().place(this->reactor_count(),
+                                                               worker_threads)
+                        : shared::cpu_placement()),
+          worker_pool(worker_threads, placement.worker_cpus) {
         static_assert(std::is_base_of<request, T>::value, "T must derive from request");
         static_assert(std::is_base_of<response, G>::value, "G must derive from response");
         static_assert(std::is_base_of<router<T, G>, R>::value, "R must derive from router<T, G>");
@@ -271,9 +518,25 @@ public:
      * @note Multiple routers can be registered for organizing routes by feature/module
      */
     virtual void use_router(std::shared_ptr<router<T, G>> router) {
+        if (shared_responses)
+            router->get_response_cache()->share_with(shared_responses);
         this->routers.push_back(router);
     }
 
+    /**
+     * @brief Share the responses of cached routes with other processes
+     * @param segment Segment every process maps, e.g. cluster_worker::shared_cache()
+     *
+     * Every router's response cache, and those of routers registered later,
+     * keeps its responses in the segment as well, see response_cache::share_with().
+     * cluster_worker::serve() calls this when the cluster has a segment.
+     */
+    void share_response_cache(shared::shared_memory_cache* segment) {
+        shared_responses = segment;
+        for (const auto& router : routers)
+            router->get_response_cache()->share_with(segment);
+    }
+
     /**
      * @brief Register a directory for serving static files
      *
@@ -281,7 +544,14 @@ public:
      * matches a static file extension. Multiple directories can be registered,
      * and they are checked in registration order.
      *
+     * With manifest set the directory is walked now and its files indexed
+     * (see static_manifest). When every directory has a manifest, a
+     * static-looking path that is not listed gets 404 from one hash lookup,
+     * without touching the file system. Files added or removed later are
+     * picked up within a second.
+     *
      * @param directory Path to the static files directory (absolute or relative)
+     * @param manifest Index the directory up front instead of probing it per request
      *
      * @note Directory path is used as-is; ensure it ends without trailing slash
      * @note Files are served with automatic MIME type detection
@@ -291,10 +561,272 @@ public:
      * @code{.cpp}
      * server->use_static("./public");     // Serves ./public/index.html for /index.html
      * server->use_static("/var/www");     // Serves /var/www/style.css for /style.css
+     * server->use_static("./assets", true);  // Indexed once, unknown paths never stat'ed
      * @endcode
      */
-    virtual void use_static(const std::string& directory) {
+    virtual void use_static(const std::string& directory, bool manifest = false) {
         static_directories.push_back(directory);
+        if (!manifest) {
+            static_probing = true;
+            return;
+        }
+        if (!static_index)
+            static_index = std::make_shared<static_manifest>();
+        if (!startup || !static_index->load_directory(directory, *startup)) {
+            static_index->add_directory(directory);
+            startup_stale = !startup_path.empty();
+        }
+        if (!startup_path.empty())
+            static_index->save_directory(directory, startup_sections);
+    }
+
+    /**
+     * @brief Keep startup work in a snapshot file, and start from it when it is current
+     *
+     * Directories registered afterwards with use_static(directory, true)
+     * and templates loaded with load_template() are taken from the
+     * snapshot when the files they were made from did not change, so a new
+     * worker lists its static files and has its templates compiled without
+     * walking or parsing anything. When something had to be built, listen()
+     * writes the snapshot again for the next process. Routes are compiled
+     * from the handlers registered in code, which a file cannot hold; they
+     * are built by listen() as before.
+     *
+     * Call before use_static() and load_template(). A missing, damaged or
+     * outdated snapshot is ignored and replaced.
+     *
+     * @param path Snapshot file, e.g. "/var/cache/app/startup.snapshot"
+     *
+     * Example:
+     * @code{.cpp}
+     * server->use_startup_snapshot("./build/startup.snapshot");
+     * server->use_static("./public", true);
+     * auto home = server->load_template("./views/home.html");
+     * @endcode
+     */
+    virtual void use_startup_snapshot(const std::string& path) {
+        startup_path = path;
+        startup = shared::startup_snapshot::open(path);
+        startup_stale = !startup;
+    }
+
+    /**
+     * @brief Compile an HTML template file, or take it compiled from the startup snapshot
+     *
+     * The template is kept: loading the same file again returns it without
+     * reading anything. Call before listen().
+     *
+     * @param file Path of the page, with {{slot}} placeholders (see html::html_template)
+     * @return The compiled template, shareable between worker threads
+     * @throws std::runtime_error if the file cannot be read
+     */
+    virtual std::shared_ptr<const html::html_template> load_template(const std::string& file) {
+        auto known = templates.find(file);
+        if (known != templates.end())
+            return known->second;
+
+        std::shared_ptr<const html::html_template> compiled;
+        if (startup) {
+            if (auto bytes = startup->section("html_template:" + file)) {
+                try {
+                    compiled = std::make_shared<const html::html_template>(
+                        html::html_template::deserialize(*bytes));
+                } catch (const std::runtime_error&) {
+                    compiled = nullptr;
+                }
+            }
+        }
+        // stat'ed before it is read, so a change while reading makes the snapshot stale
+        std::vector<shared::snapshot_source> sources;
+        if (!startup_path.empty())
+            sources.push_back(shared::snapshot_source::of(file));
+        if (!compiled) {
+            std::ifstream in(file, std::ios::binary);
+            if (!in)
+                throw std::runtime_error("Cannot read template " + file);
+            std::ostringstream page;
+            page << in.rdbuf();
+            compiled = std::make_shared<const html::html_template>(
+                html::html_template::compile(html::parse(std::string_view(page.str()))));
+            startup_stale = !startup_path.empty();
+        }
+        if (!startup_path.empty())
+            startup_sections.add("html_template:" + file, compiled->serialize(),
+                                 std::move(sources));
+        templates.emplace(file, compiled);
+        return compiled;
+    }
+
+    /**
+     * @brief Bound how many requests wait for a worker, and for how long
+     *
+     * A request arriving while max_queued others wait is answered 503
+     * Service Unavailable on the event loop, and one that waited longer than
+     * max_wait is answered 503 by the worker that picks it up, without
+     * running its middleware or handler. The 503 carries Retry-After and
+     * closes the connection. Call before listen().
+     *
+     * @param max_queued Requests that may wait at once (default: http::config::REQUEST_QUEUE_LIMIT)
+     * @param max_wait Longest wait (default: http::config::REQUEST_QUEUE_TIMEOUT)
+     * @param retry_after Retry-After of the 503
+     *        (default: http::config::REQUEST_RETRY_AFTER_SECONDS)
+     */
+    virtual void limit_request_queue(
+        std::size_t max_queued, std::chrono::milliseconds max_wait,
+        std::chrono::seconds retry_after = cppress::http::config::REQUEST_RETRY_AFTER_SECONDS) {
+        queue_limit = max_queued;
+        queue_timeout = max_wait;
+        overloaded = serialize_overloaded(retry_after);
+    }
+
+    /**
+     * @brief Run the requests of each connection on one worker
+     *
+     * By default any idle worker takes the next request, so two pipelined
+     * requests of one connection may run at once, in either order, on two
+     * cores. With affinity on, each connection is hashed to one worker
+     * that takes its requests in the order they arrived, one after the
+     * other, and its per-connection state stays in that core's cache. The
+     * price is balance: a slow request holds up the other connections
+     * hashed to its worker, which no idle worker can take over. Requests
+     * of routes marked inline never reach a worker either way. With
+     * http::config::NUMA_PLACEMENT the worker is one sharing the cache of
+     * the connection's event loop. Call before listen().
+     *
+     * @param on Whether to pin connections to workers
+     */
+    virtual void use_worker_affinity(bool on = true) { worker_affinity = on; }
+
+    /**
+     * @brief Let the worker pool grow and shrink with the load
+     *
+     * The pool starts with worker_threads workers. From then on it adds
+     * workers while requests wait longer than sizing.grow_wait and the CPU
+     * has room, as when handlers block on I/O, and retires them while they
+     * sit idle or while CPU-bound handlers already keep every core busy;
+     * see shared::thread_pool::adapt(). The current size and the
+     * measurements behind it are served with the metrics. Call before
+     * listen(), and after use_worker_affinity(): pinned connections are
+     * spread over the first sizing.min_threads workers.
+     *
+     * @param sizing Bounds and thresholds (default: 1 to 4 workers per core)
+     * @throws std::invalid_argument if sizing.min_threads is 0 or above max_threads
+     */
+    virtual void use_adaptive_workers(const shared::pool_sizing& sizing = {}) {
+        worker_pool.adapt(sizing);
+    }
+
+    /// @brief Size of the worker pool and its last sizing decision
+    shared::pool_stats get_worker_stats() const { return worker_pool.stats(); }
+
+    /**
+     * @brief Limit the request rate of each client, on the event loop
+     *
+     * Every request is counted against its key before anything else runs;
+     * one over the limit is answered the limiter's 429 right away, without
+     * being routed or queued for a worker, and its connection is closed as
+     * a shed request's is. For limits on some routes only,
+     * use the rate_limit() middleware instead. Call before listen().
+     *
+     * @param options Rate, burst and table size
+     * @param key What requests are counted against (default: the client address)
+     * @return The limiter, for its counters
+     */
+    virtual std::shared_ptr<const rate_limiter> use_rate_limit(
+        const rate_limit_options& options, rate_limit_key key = rate_limit_by_client_address()) {
+        limiter = std::make_shared<rate_limiter>(options);
+        limit_key = std::move(key);
+        return limiter;
+    }
+
+    /**
+     * @brief Record per-route request metrics, and serve them
+     *
+     * Every request from now on is counted under its method and route
+     * pattern, with histograms of its wait for a worker, of its middleware
+     * and handlers, and of the whole. Static files and unmatched paths are
+     * recorded as the routes <static> and <unmatched>. For routes answered
+     * from the cache, only the time to answer on the event loop is recorded.
+     *
+     * @param path Route on the base router that serves the metrics and the
+     *             event loop counters in the Prometheus text format; empty for none
+     *
+     * Example:
+     * @code{.cpp}
+     * server->use_metrics();         // GET /metrics
+     * server->use_metrics("");       // recorded only, read with get_metrics()
+     * @endcode
+     */
+    virtual void use_metrics(const std::string& path = "/metrics") {
+        if (!metrics)
+            metrics = std::make_shared<route_metrics>();
+        if (path.empty())
+            return;
+        get(path, {[this](const std::shared_ptr<T>&, const std::shared_ptr<G>& res) -> exit_code {
+                res->set_content_type("text/plain; version=0.0.4; charset=utf-8");
+                const shared::pool_stats workers = worker_pool.stats();
+                res->send(metrics->prometheus(this->stats(), &workers));
+                return exit_code::EXIT;
+            }});
+    }
+
+    /// @brief Recorded request metrics, null unless use_metrics() was called
+    std::shared_ptr<const route_metrics> get_metrics() const { return metrics; }
+
+    /**
+     * @brief Trace a sample of the requests
+     *
+     * A request with a sampled traceparent header is traced, others at
+     * options.sample_rate. Each traced request gives a span named after its
+     * method and route, with child spans for parsing, waiting for a worker,
+     * middleware, handlers and sending; see tracing.hpp. The spans reach
+     * the sink in batches, on a worker, every options.flush_interval, and
+     * once more on stop(). Call before listen().
+     *
+     * @param sink Receives the finished spans
+     * @param options Sample rate, spans buffered per thread and flush interval
+     *
+     * Example:
+     * @code{.cpp}
+     * server->use_tracing([](const auto& spans) { exporter.send(spans); }, {0.01});
+     * @endcode
+     */
+    virtual void use_tracing(trace_sink sink, const tracing_options& options = {}) {
+        tracing = std::make_shared<tracer>(std::move(sink), options);
+        this->timestamp_requests = true;
+    }
+
+    /// @brief The request tracer, null unless use_tracing() was called
+    std::shared_ptr<tracer> get_tracer() const { return tracing; }
+
+    /**
+     * @brief Configure the cache of static files
+     *
+     * Static files are cached with the default options unless this is
+     * called. A hit is answered without touching the file system: files up
+     * to options.max_file_size are sent from memory, larger ones with
+     * sendfile. Changes on disk are noticed within options.revalidate_interval.
+     *
+     * @param options Memory budget, largest file held and revalidation interval
+     */
+    virtual void use_static_cache(const static_cache_options& options) {
+        static_files = std::make_shared<static_file_cache>(options);
+    }
+
+    /**
+     * @brief Compress static files of compressible types
+     *
+     * A client that accepts br, zstd or gzip gets a precompressed sibling
+     * (app.js.br, app.js.gz, app.js.zst) when it is not older than the file,
+     * or else a variant encoded on first use. Variants are kept in memory, so
+     * repeated requests never compress a file again.
+     *
+     * @param options Level for encoded variants and the smallest file worth encoding
+     * @param max_bytes Memory the cached variants may take
+     */
+    virtual void use_static_compression(const compression_options& options = {},
+                                        std::size_t max_bytes = 64 * 1024 * 1024) {
+        static_variants = std::make_shared<static_variant_cache>(options, max_bytes);
     }
 
     /**
@@ -375,6 +907,7 @@ public:
      * @param error_callback Optional callback invoked when an error occurs
      *
      * @note If callbacks are provided, they replace the default callbacks
+     * @note The routers' chains are frozen first, see freeze()
      * @note This method blocks until server shutdown
      * @note Worker threads are already started before this call
      *
@@ -394,9 +927,32 @@ public:
         if (error_callback) {
             this->error_callback = error_callback;
         }
+        freeze();
         cppress::http::http_server::listen();
     }
 
+    /**
+     * @brief Flatten the middleware and handlers of every route
+     *
+     * Each route gets one array holding the base router's middleware, its
+     * own router's middleware and its handlers, see router::freeze().
+     * listen() does this; call it again after adding routes or middleware
+     * to a running server, which otherwise runs the lists one by one.
+     */
+    virtual void freeze() {
+        for (std::size_t i = 0; i < routers.size(); ++i)
+            routers[i]->freeze(i == 0 ? nullptr : routers[0].get());
+        if (startup_stale) {
+            // a snapshot that cannot be written costs the next start time, not this one
+            try {
+                startup_sections.save(startup_path);
+                startup_stale = false;
+            } catch (const std::exception& e) {
+                shared::logger::error("Cannot write startup snapshot: " + std::string(e.what()));
+            }
+        }
+    }
+
     /**
      * @brief Stop the server and shutdown worker threads
      *
@@ -409,6 +965,8 @@ public:
     virtual void stop() {
         cppress::http::http_server::shutdown();
         worker_pool.stop_workers();
+        if (tracing)
+            tracing->flush();
     }
 
     /**
@@ -418,6 +976,7 @@ public:
      *
      * @param path The path pattern for the route (e.g., "/users/:id")
      * @param handlers Vector of request handlers to execute for this route
+     * @return The route, e.g. to set its body size limit with set_max_body_size()
      *
      * Example:
      * @code{.cpp}
@@ -429,8 +988,9 @@ public:
      * });
      * @endcode
      */
-    void get(const std::string& path, std::vector<request_handler_t<T, G>> handlers) {
-        routers[0]->add_route(std::make_shared<route<T, G>>("GET", path, handlers));
+    std::shared_ptr<route<T, G>> get(const std::string& path,
+                                     std::vector<request_handler_t<T, G>> handlers) {
+        return routers[0]->get(path, std::move(handlers));
     }
 
     /**
@@ -440,9 +1000,16 @@ public:
      *
      * @param path The path pattern for the route
      * @param handlers Vector of request handlers to execute for this route
+     * @return The route, e.g. to set its body size limit with set_max_body_size()
+     *
+     * Example:
+     * @code{.cpp}
+     * server->post("/upload", {save_upload})->set_max_body_size(16 * 1024 * 1024);
+     * @endcode
      */
-    void post(const std::string& path, std::vector<request_handler_t<T, G>> handlers) {
-        routers[0]->add_route(std::make_shared<route<T, G>>("POST", path, handlers));
+    std::shared_ptr<route<T, G>> post(const std::string& path,
+                                     std::vector<request_handler_t<T, G>> handlers) {
+        return routers[0]->post(path, std::move(handlers));
     }
 
     /**
@@ -452,9 +1019,11 @@ public:
      *
      * @param path The path pattern for the route
      * @param handlers Vector of request handlers to execute for this route
+     * @return The route, e.g. to set its body size limit with set_max_body_size()
      */
-    void put(const std::string& path, std::vector<request_handler_t<T, G>> handlers) {
-        routers[0]->add_route(std::make_shared<route<T, G>>("PUT", path, handlers));
+    std::shared_ptr<route<T, G>> put(const std::string& path,
+                                     std::vector<request_handler_t<T, G>> handlers) {
+        return routers[0]->put(path, std::move(handlers));
     }
 
     /**
@@ -465,10 +1034,12 @@ public:
      * @param path The path pattern for the route
      * @param handlers Vector of request handlers to execute for this route
      *
+     * @return The route
      * @note Method named delete_ (with underscore) to avoid C++ keyword conflict
      */
-    void delete_(const std::string& path, std::vector<request_handler_t<T, G>> handlers) {
-        routers[0]->add_route(std::make_shared<route<T, G>>("DELETE", path, handlers));
+    std::shared_ptr<route<T, G>> delete_(const std::string& path,
+                                     std::vector<request_handler_t<T, G>> handlers) {
+        return routers[0]->delete_(path, std::move(handlers));
     }
 
     /**
@@ -490,6 +1061,30 @@ public:
      */
     void use(const request_handler_t<T, G>& middleware) { routers[0]->use(middleware); }
 
+    /**
+     * @brief Register middleware that only needs the request headers for the base router
+     *
+     * Runs before the use() middleware, and for clients that send
+     * Expect: 100-continue before their body is uploaded: a middleware that
+     * answers and returns EXIT refuses the upload. See router::use_before_body().
+     *
+     * @param middleware The middleware function to register
+     *
+     * Example:
+     * @code{.cpp}
+     * server->use_before_body([](auto req, auto res) {
+     *     if (req->get_authorization().empty()) {
+     *         res->set_status(401, "Unauthorized");
+     *         return cppress::web::exit_code::EXIT;
+     *     }
+     *     return cppress::web::exit_code::CONTINUE;
+     * });
+     * @endcode
+     */
+    void use_before_body(const request_handler_t<T, G>& middleware) {
+        routers[0]->use_before_body(middleware);
+    }
+
 protected:
     /**
      * @brief Serve static files from registered directories
@@ -505,36 +1100,64 @@ protected:
      * @note Returns 404 if file not found in any directory
      * @note Exceptions are caught and handled via on_unhandled_exception
      */
-    virtual void serve_static(std::shared_ptr<T> req, std::shared_ptr<G> res) {
+    virtual void serve_static(const std::shared_ptr<T>& req, const std::shared_ptr<G>& res) {
         try {
-            std::string uri = req->get_uri();
-            std::string sanitized_path = shared::sanitize_path(uri);
-            std::string file_path;
-
-            /// If the file found in the registered static directories
-            for (const auto& dir : static_directories) {
-                file_path = dir + sanitized_path;
-                if (std::ifstream(file_path)) {
-                    break;
-                }
-            }
+            std::string sanitized_path = shared::sanitize_path(req->get_uri());
+
+            /// The file from the registered static directories, as the cache last saw it;
+            /// the directories are probed only on a miss or once the entry is due a check.
+            /// When all of them are indexed, a path the manifest lacks is not looked for
+            std::shared_ptr<const static_file_cache::file> file;
+            if (static_probing || !static_index || static_index->find(sanitized_path))
+                file = static_files->find(sanitized_path, static_directories);
             /// No file, bad, return 404
-            if (file_path.empty() || !std::ifstream(file_path)) {
+            if (!file) {
                 res->set_status(404, "Not Found");
                 res->send_text("404 Not Found");
                 return;
             }
 
-            std::ifstream file(file_path);
-            std::stringstream buffer;
-            buffer << file.rdbuf();
-            res->set_body(buffer.str());
+            const auto& request_headers = req->get_header_fields();
+            bool encodable =
+                static_variants && cppress::http::compressible_content_type(file->content_type);
+            if (encodable)
+                res->add_header("Vary", "Accept-Encoding");
 
-            /// send the file to the browser
-            res->set_content_type(
-                shared::get_mime_type_from_extension(shared::get_file_extension_from_uri(uri)));
+            res->set_content_type(file->content_type);
             res->set_status(200, "OK");
-            res->send();
+            res->set_header("ETag", file->etag);
+            res->set_header("Last-Modified", file->last_modified);
+            /// revalidation of a cached copy: 304 without reading the file
+            if (res->is_not_modified()) {
+                res->send();
+                return;
+            }
+
+            bool ranged = request_headers.contains(cppress::http::header_id::range);
+            static_variant_cache::variant variant;
+            // a Range addresses the identity bytes, encoded variants are not sliced
+            if (encodable && !ranged)
+                variant =
+                    static_variants->find(file->path, request_headers, file->modified, file->size);
+            if (variant.body) {
+                res->set_header("Content-Encoding",
+                                std::string(cppress::http::content_coding_name(variant.coding)));
+                res->send_buffer(cppress::sockets::data_buffer(
+                    std::shared_ptr<const char>(variant.body, variant.body->data()),
+                    variant.body->size()));
+                return;
+            }
+
+            /// a held file goes out from the cache's buffer, shared with every other hit
+            if (!file->content.empty() && !ranged) {
+                res->set_header("Accept-Ranges", "bytes");
+                res->send_buffer(file->content);
+                return;
+            }
+
+            /// send the file to the browser, or the ranges it asked for, straight from the
+            /// page cache; If-Range is checked against Last-Modified, the ETag being weak
+            res->send_file(cppress::sockets::file_region::open(file->path), request_headers);
         } catch (const std::exception& e) {
             shared::logger::error("Error serving static file: " + std::string(e.what()));
             exception exp("Error serving static file", "INTERNAL_ERROR", "serve_static", 500,
@@ -550,7 +1173,8 @@ protected:
      * request handling flow:
      * -# Check if URI is for a static file
      * -# If static, serve the file
-     * -# If dynamic, try each registered router
+     * -# If a route matched, run it with the middleware of its router and of the base router
+     * -# Otherwise, try each registered router, whose middleware may still answer
      * -# If no match found, call default handler (404)
      * -# Send response and manage connection (keep-alive or close)
      *
@@ -562,7 +1186,20 @@ protected:
      * @note Response is sent automatically at the end
      * @note Connection handling respects HTTP keep-alive headers
      */
-    virtual void request_handler(std::shared_ptr<T> req, std::shared_ptr<G> res) {
+    virtual void request_handler(const std::shared_ptr<T>& req, const std::shared_ptr<G>& res) {
+        auto resolved = resolve(req);
+        request_handler(req, res, resolved.first, resolved.second.get());
+    }
+
+    /**
+     * @brief request_handler() for a request already resolved
+     * @param req Request object containing all request data
+     * @param res Response object for building the response
+     * @param router The router of the matched route, null if none matched
+     * @param matched The route resolve() found, null if none matched
+     */
+    virtual void request_handler(const std::shared_ptr<T>& req, const std::shared_ptr<G>& res,
+                                 R* router, route<T, G>* matched) {
         try {
             bool handled =
                 false;  // check if the route got matched with any of the registered routers
@@ -570,6 +1207,11 @@ protected:
             {
                 serve_static(req, res);
                 handled = true;
+            } else if (matched) {
+                // routers before the matching one cannot match, their middleware is skipped
+                R* base = routers[0].get();
+                router->handle_route(*matched, router == base ? nullptr : base, req, res);
+                handled = true;
             } else {
                 // check the routers if they can handle the request
                 for (const auto& router : routers) {
@@ -582,9 +1224,15 @@ protected:
 
             if (!handled)
                 handle_default_route(req, res);
+            req->trace_mark(trace_point::handled);
+
+            // the handler sends it later, from a callback
+            if (res->is_deferred())
+                return;
 
             res->send();
-            if (!req->keep_alive())
+            req->trace_mark(trace_point::sent);
+            if (!req->keep_alive() || !res->keeps_connection())
                 res->end();
 
         } catch (const std::exception& e) {
@@ -597,7 +1245,7 @@ protected:
         }
 
         res->send();
-        if (!req->keep_alive())
+        if (!req->keep_alive() || !res->keeps_connection())
             res->end();
     };
 
@@ -614,12 +1262,22 @@ protected:
      * @note Validates HTTP method before processing
      * @note Returns 400 Bad Request for unknown HTTP methods
      * @note Enqueues request to worker pool for concurrent handling
+     * @note Requests for routes marked with route::set_inline() are handled right here
+     * @note GET requests for routes marked with route::set_cache() are answered from the cache
      * @note Handles exceptions during enqueue operation
+     * @note Requests are timed into the metrics once use_metrics() was called
+     * @note Requests over the use_rate_limit() limit are refused here, on the loop
      */
     virtual void on_request_received(cppress::http::http_request& request,
                                      cppress::http::http_response& response) override {
-        auto req = std::make_shared<T>(std::move(request));
-        auto res = std::make_shared<G>(std::move(response));
+        shared::phase_scope routing(shared::request_phase::route);
+        const auto received = std::chrono::steady_clock::now();
+        const auto read_at = request.get_received_at();
+        // one pooled block for the pair and its arena: on keep-alive traffic the storage
+        // of the last request is reused, and all of it is released at once
+        auto exchange = request_exchange<T, G>::make(std::move(request), std::move(response));
+        std::shared_ptr<T> req(exchange, &exchange->request);
+        std::shared_ptr<G> res(exchange, &exchange->response);
 
         // If the pointers somehow was not created
         if (!res || !req) {
@@ -627,6 +1285,14 @@ protected:
             return;
         }
 
+        // the parser refused a body over config::MAX_BODY_SIZE without reading it
+        if (req->get_method() == "BAD_CONTENT_TOO_LARGE") {
+            res->set_status(413, "Payload Too Large");
+            res->send_text("413 Payload Too Large");
+            res->end();
+            return;
+        }
+
         // If an invalid HTTP method is received
         if (shared::unknown_method(req->get_method())) {
             shared::logger::error("Unknown HTTP method: " + req->get_method());
@@ -637,9 +1303,84 @@ protected:
             res->end();
             return;
         }
+
+        // answer in kind, handlers may still override it with set_keep_alive()
+        res->set_keep_alive(req->keep_alive());
+        if (limiter && !limiter->allow(limit_key(*req))) {
+            res->send_serialized(limiter->rejection());
+            res->end();
+            return;
+        }
         try {
-            // Enqueue the request handler for processing
-            worker_pool.enqueue([this, req, res]() { request_handler(req, res); });
+            auto [router, matched] = resolve(req);
+            std::string series = metrics ? metrics_route(req, matched) : std::string();
+            if (tracing) {
+                req->trace = tracing->start(
+                    req->get_header_fields().get(cppress::http::header_id::traceparent));
+                if (req->trace) {
+                    req->trace->name = req->get_method() + " " + metrics_route(req, matched);
+                    req->trace->mark(trace_point::received, read_at);
+                    req->trace->mark(trace_point::dispatched, received);
+                }
+            }
+            auto on_loop = [&](auto&& handle) {
+                req->trace_mark(trace_point::dequeued);
+                {
+                    shared::phase_scope handling(shared::request_phase::handle);
+                    handle();
+                }
+                finish_trace(req);
+                if (metrics) {
+                    const auto now = std::chrono::steady_clock::now();
+                    metrics->observe(req->get_method(), series, {}, now - received,
+                                     now - received);
+                }
+            };
+            // cached routes are answered from serialized responses
+            if (matched && matched->get_cache_policy() && req->get_method() == "GET") {
+                on_loop([&]() {
+                    req->trace_mark(trace_point::routed);
+                    answer_from_cache(*router, *matched->get_cache_policy(), req, res);
+                    req->trace_mark(trace_point::handled);
+                });
+                return;
+            }
+            // non-blocking routes skip the two handoffs through the pool
+            if (matched && (router->is_inline() || matched->is_inline())) {
+                on_loop([&]() { request_handler(req, res, router, matched.get()); });
+                return;
+            }
+
+            // Enqueue the request handler for processing; a full queue is answered right here
+            const auto queued_at = std::chrono::steady_clock::now();
+            // the job holds the registry: it records after the response is out, and may
+            // finish while the server is being torn down
+            auto job = [this, req, res, queued_at, received, recorder = metrics,
+                        series = std::move(series), router = router, matched = matched.get()]() {
+                const auto started = std::chrono::steady_clock::now();
+                if (started - queued_at > queue_timeout) {
+                    shed(res);
+                    return;
+                }
+                if (req->trace)
+                    req->trace->mark(trace_point::dequeued, started);
+                {
+                    shared::phase_scope handling(shared::request_phase::handle);
+                    request_handler(req, res, router, matched);
+                }
+                finish_trace(req);
+                if (recorder) {
+                    const auto now = std::chrono::steady_clock::now();
+                    recorder->observe(req->get_method(), series, started - queued_at,
+                                      now - started, now - received);
+                }
+            };
+            const void* connection = worker_affinity ? req->connection_id() : nullptr;
+            bool queued = connection ? worker_pool.try_enqueue_to(worker_for(connection),
+                                                                  std::move(job), queue_limit)
+                                     : worker_pool.try_enqueue(std::move(job), queue_limit);
+            if (!queued)
+                shed(res);
         } catch (web::exception& e)  // Unhandled exception
         {
             shared::logger::error("Error in request handler thread: " + std::string(e.what()));
@@ -661,13 +1402,67 @@ protected:
         }
     };
 
+    /**
+     * @brief HTTP server callback for requests sent with Expect: 100-continue
+     *
+     * Decides before the body is uploaded, on the reactor thread: the
+     * use_before_body() middleware of the routers runs, then the matching
+     * route's body size limit is checked against Content-Length. Requests
+     * for static files and for no route are let through.
+     *
+     * @param request Low-level HTTP request, without its body
+     * @param response Low-level HTTP response, sent if the request is refused
+     * @return true to send 100 Continue, false once a final response was sent
+     */
+    virtual bool on_expect_continue(cppress::http::http_request& request,
+                                    cppress::http::http_response& response) override {
+        auto exchange = request_exchange<T, G>::make(std::move(request), std::move(response));
+        std::shared_ptr<T> req(exchange, &exchange->request);
+        std::shared_ptr<G> res(exchange, &exchange->response);
+        // the connection closes after a refusal, the body may already be on its way
+        res->set_keep_alive(false);
+        try {
+            if (is_uri_static(req->get_uri()))
+                return true;
+            for (const auto& router : routers) {
+                if (router->before_body_handle_request(req, res) != exit_code::CONTINUE) {
+                    res->send();
+                    return false;
+                }
+                auto matched = router->find_route(req);
+                if (!matched)
+                    continue;
+                if (matched->accepts_body(req->get_content_length()))
+                    return true;
+                R::refuse_too_large(res);
+                return false;
+            }
+            return true;
+        } catch (web::exception& e) {
+            on_unhandled_exception(req, res, e);
+        } catch (const std::exception& e) {
+            shared::logger::error("Error deciding on Expect: 100-continue: " +
+                                  std::string(e.what()));
+            web::exception exp("Error deciding on Expect: 100-continue", "INTERNAL_ERROR",
+                               "on_expect_continue", 500, "Internal Server Error");
+            on_unhandled_exception(req, res, exp);
+        }
+        res->send();
+        return false;
+    }
+
     /**
      * @brief HTTP server callback for successful listen
      *
      * Called when the server successfully starts listening on the configured port.
-     * Invokes the registered listen callback.
+     * Starts flushing traces if use_tracing() was called, then invokes the
+     * registered listen callback.
      */
-    virtual void on_listen_success() override { this->listen_callback(); }
+    virtual void on_listen_success() override {
+        if (tracing)
+            schedule_trace_flush();
+        this->listen_callback();
+    }
 
     /**
      * @brief HTTP server callback for exceptions
@@ -689,7 +1484,7 @@ protected:
      * connection termination based on header content.
      *
      * @param conn The connection object
-     * @param headers The headers received as a multimap
+     * @param headers The headers received, as sent by the client
      * @param method The HTTP method
      * @param uri The request URI
      * @param version The HTTP version
@@ -718,8 +1513,8 @@ protected:
      * @note Custom callback can be set via use_error() method
      * @note Always closes the connection after error response
      */
-    virtual void on_unhandled_exception(std::shared_ptr<T> req, std::shared_ptr<G> res,
-                                        exception& e) {
+    virtual void on_unhandled_exception(const std::shared_ptr<T>& req,
+                                        const std::shared_ptr<G>& res, exception& e) {
         if (unhandled_exception_callback) {
             unhandled_exception_callback(req, res, e);
             return;
@@ -0,0 +1,122 @@
+/**
+ * @file static_file_cache.hpp
+ * @brief Static files kept in memory between requests
+ *
+ * server::serve_static() looks every static request up here first. A hit
+ * gives the file's resolved path, MIME type and validators without probing
+ * the static directories, and for small files the content itself: an
+ * immutable buffer that is queued on the connection by reference, so a hit
+ * neither opens nor copies the file.
+ *
+ * Entries are checked against the file system at most once per
+ * revalidation interval; a file whose size or modification time changed is
+ * read again, one that disappeared is dropped.
+ *
+ * @section static_cache_usage Usage Example
+ * @code{.cpp}
+ * server->use_static("./public");
+ * // 128 MB of content, files up to 4 MB, changes picked up within 5 seconds
+ * server->use_static_cache({128 * 1024 * 1024, 4 * 1024 * 1024, std::chrono::seconds(5)});
+ * @endcode
+ *
+ * @author cppress team
+ * @version 1.0
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "sockets/includes/data_buffer.hpp"
+
+namespace cppress::web {
+
+/**
+ * @brief Limits of a static_file_cache
+ */
+struct static_cache_options {
+    /// Bytes of file content held; the least recently used files are dropped past it
+    std::size_t max_bytes = 64 * 1024 * 1024;
+
+    /// Larger files are not held, only their metadata; they are sent with sendfile
+    std::size_t max_file_size = 1024 * 1024;
+
+    /// How long an entry is trusted before the file is stat'ed again
+    std::chrono::milliseconds revalidate_interval{1000};
+};
+
+/**
+ * @class static_file_cache
+ * @brief Metadata and content of static files, keyed by sanitized request path
+ *
+ * Thread-safe. Requests that find no file are not remembered, so unknown
+ * paths cannot fill the cache.
+ */
+class static_file_cache {
+public:
+    /// A static file as it was when last checked; never modified once shared
+    struct file {
+        /// Where the file was found, directory included
+        std::string path;
+        std::string content_type;
+        std::string etag;
+        std::string last_modified;
+        std::filesystem::file_time_type modified;
+        std::uintmax_t size = 0;
+
+        /// The whole file, empty when it is over max_file_size
+        cppress::sockets::data_buffer content;
+    };
+
+    explicit static_file_cache(const static_cache_options& options = {});
+
+    /**
+     * @brief The file a static request resolves to
+     * @param sanitized_path Request path, as shared::sanitize_path() returns it
+     * @param directories Static directories, searched in order
+     * @return The file, nullptr if no directory has it
+     */
+    std::shared_ptr<const file> find(const std::string& sanitized_path,
+                                     const std::vector<std::string>& directories);
+
+    /// @brief Bytes of file content currently held
+    std::size_t size() const;
+
+    /// @brief Drop every entry
+    void clear();
+
+private:
+    struct entry {
+        std::shared_ptr<const file> value;
+        std::chrono::steady_clock::time_point checked;
+        std::list<std::string>::iterator recent;
+    };
+
+    /**
+     * @brief Probe the directories for a file
+     * @param previous What the cache held, its content is reused if the file is unchanged
+     */
+    std::shared_ptr<const file> load(const std::string& sanitized_path,
+                                     const std::vector<std::string>& directories,
+                                     const std::shared_ptr<const file>& previous) const;
+
+    void erase(std::unordered_map<std::string, entry>::iterator it);
+
+    static_cache_options options;
+
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, entry> entries;
+    /// Keys, most recently used first
+    std::list<std::string> recent;
+    std::size_t bytes = 0;
+};
+}  // namespace cppress::web
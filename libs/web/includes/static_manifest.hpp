@@ -0,0 +1,146 @@
+/**
+ * @file static_manifest.hpp
+ * @brief Index of static directories built once, for routing without the file system
+ *
+ * server::use_static(directory, true) walks the directory when it is
+ * registered and records every file with a static extension under its URL
+ * path, with MIME type, size and ETag. Whether a static-looking path names
+ * a file is then one hash lookup, and one that is not listed is answered
+ * 404 without a stat; scanners probing for /.env or /wp-login.php never
+ * reach the disk.
+ *
+ * The walked directories' modification times are checked at most once per
+ * refresh interval; when a file was added, removed or renamed in any of
+ * them the index is rebuilt. Changes to a file's content are picked up by
+ * static_file_cache, which serves the bytes.
+ *
+ * A directory's listing can be kept in a startup snapshot
+ * (save_directory()) and taken from it by the next process
+ * (load_directory()), which then stats the directories instead of
+ * walking them and every file in them.
+ *
+ * @author cppress team
+ * @version 1.0
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "shared/includes/startup_snapshot.hpp"
+
+namespace cppress::web {
+
+/**
+ * @class static_manifest
+ * @brief URL path to file index of static directories
+ *
+ * Thread-safe: lookups read an immutable snapshot, a refresh builds a new
+ * one and swaps it in while other threads keep using the old.
+ */
+class static_manifest {
+public:
+    /// A listed file, as it was when the manifest was built
+    struct asset {
+        /// Where the file is, directory included
+        std::string path;
+        std::string content_type;
+        std::string etag;
+        std::uintmax_t size = 0;
+    };
+
+    /**
+     * @param refresh_interval How often the directories are checked for added or removed files
+     */
+    explicit static_manifest(
+        std::chrono::milliseconds refresh_interval = std::chrono::milliseconds(1000));
+
+    /**
+     * @brief Add a directory and index it
+     *
+     * Files already listed from an earlier directory keep that entry, as
+     * the earlier directory is searched first when serving.
+     */
+    void add_directory(const std::string& directory);
+
+    /**
+     * @brief Look a request path up
+     * @param sanitized_path Request path, as shared::sanitize_path() returns it
+     * @return The file, nullptr if no indexed directory has it
+     */
+    std::shared_ptr<const asset> find(const std::string& sanitized_path);
+
+    /// @brief Number of files listed
+    std::size_t size() const;
+
+    /// @brief Walk the directories again now
+    void rebuild();
+
+    /**
+     * @brief Add a directory's listing to a startup snapshot
+     *
+     * The section is valid while none of the directory's subdirectories,
+     * itself included, was modified.
+     *
+     * @throws std::invalid_argument if the directory was not added
+     */
+    void save_directory(const std::string& directory, shared::snapshot_writer& out) const;
+
+    /**
+     * @brief Add a directory from a startup snapshot instead of walking it
+     * @return false, adding nothing, if the snapshot has no valid listing of it
+     */
+    bool load_directory(const std::string& directory, const shared::startup_snapshot& in);
+
+private:
+    using index = std::unordered_map<std::string, std::shared_ptr<const asset>>;
+    using directory_times = std::vector<std::pair<std::string, std::filesystem::file_time_type>>;
+
+    /// Every file under one root by URL path, shadowed or not, and the times of its directories
+    struct listing {
+        std::string root;
+        std::vector<std::pair<std::string, std::shared_ptr<const asset>>> files;
+        directory_times directories;
+    };
+
+    /// The index and the modification time of every directory it was built from
+    struct snapshot {
+        index files;
+        directory_times directories;
+        std::vector<listing> listings;
+    };
+
+    /// Rebuilds when a directory changed; one thread at a time, the others carry on
+    void refresh_if_due();
+
+    std::shared_ptr<const snapshot> build() const;
+
+    static listing walk(const std::string& root);
+
+    /// Index of listings, earlier roots first
+    static std::shared_ptr<const snapshot> merge(std::vector<listing> listings);
+
+    static std::string section_name(const std::string& directory);
+
+    std::chrono::milliseconds refresh_interval;
+
+    /// Guards roots and serializes rebuilds
+    mutable std::mutex mutex;
+    std::vector<std::string> roots;
+
+    /// Read with std::atomic_load, replaced with std::atomic_store
+    std::shared_ptr<const snapshot> current;
+
+    /// steady_clock ticks of the next directory check
+    std::atomic<std::int64_t> next_check{0};
+};
+}  // namespace cppress::web
@@ -0,0 +1,275 @@
+/**
+ * @file tracing.hpp
+ * @brief Sampled request tracing with W3C traceparent propagation
+ *
+ * server::use_tracing() samples requests: one carrying a sampled
+ * traceparent header is always traced, any other at the configured rate.
+ * A traced request is stamped as it moves along (read off the socket,
+ * handed to the server, picked up by a worker, through the middleware,
+ * through the handlers, written out) and, when done, turned into a span
+ * for the request with a child span per phase:
+ *
+ * @li parse: from the read completing the request to the server receiving it
+ * @li queue: waiting for a worker
+ * @li middleware: the middleware of the routers
+ * @li handler: the route's handlers
+ * @li send: serializing the response and queuing it on the connection
+ *
+ * Handlers wrap their calls to other services in request::begin_span(); the
+ * span's traceparent() goes on the outgoing request, so the other service's
+ * spans join the same trace.
+ *
+ * Spans are kept in a ring per thread and handed to the sink in batches by
+ * flush(), which the server calls on a worker every flush interval. A
+ * request that is not sampled costs a header lookup and a random number;
+ * with tracing off, a null check.
+ *
+ * @section tracing_usage Usage Example
+ * @code{.cpp}
+ * server->use_tracing([](const std::vector<cppress::web::trace_span>& spans) {
+ *     exporter.send(spans);
+ * }, {0.01});
+ *
+ * server->get("/orders/:id", {[](auto req, auto res) {
+ *     auto span = req->begin_span("inventory");
+ *     auto stock = inventory.get(id, {{"traceparent", span.traceparent()}});
+ *     span.end();
+ *     ...
+ * }});
+ * @endcode
+ *
+ * @author cppress team
+ * @version 1.0
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace cppress::web {
+
+/**
+ * @brief Identity of a span as a traceparent header carries it
+ */
+struct trace_context {
+    std::array<std::uint8_t, 16> trace_id{};
+    std::array<std::uint8_t, 8> span_id{};
+    bool sampled = false;
+
+    /// @brief false for the all-zero context parse() leaves on failure
+    bool valid() const noexcept;
+
+    /**
+     * @brief Read a traceparent header
+     * @param header Value as received, e.g. 00-0af7651916cd43dd8448eb211c80319c-b7ad6b7169203331-01
+     * @param out Set on success
+     * @return false if the value is malformed, out is left alone then
+     */
+    static bool parse(std::string_view header, trace_context& out) noexcept;
+
+    /// @brief The traceparent header value, empty if not valid()
+    std::string traceparent() const;
+
+    /// @brief A new span of the same trace, with a random id
+    trace_context child() const noexcept;
+
+    /// @brief A new trace with random ids
+    static trace_context make_root(bool sampled) noexcept;
+};
+
+/**
+ * @brief A finished span, as handed to the sink
+ */
+struct trace_span {
+    std::array<std::uint8_t, 16> trace_id{};
+    std::array<std::uint8_t, 8> span_id{};
+
+    /// All zero for a root span
+    std::array<std::uint8_t, 8> parent_id{};
+
+    /// "GET /orders/:id" for requests, the phase or the begin_span() name for the rest
+    std::string name;
+
+    std::chrono::system_clock::time_point start;
+    std::chrono::system_clock::time_point end;
+};
+
+/// Receives finished spans, on the thread calling tracer::flush()
+using trace_sink = std::function<void(const std::vector<trace_span>&)>;
+
+/**
+ * @brief Sampling and buffering of a tracer
+ */
+struct tracing_options {
+    /// Fraction of requests without a sampled traceparent that are traced
+    double sample_rate = 0.01;
+
+    /// Spans each thread buffers between flushes; more are dropped
+    std::size_t ring_capacity = 1024;
+
+    /// How often the server hands buffered spans to the sink
+    std::chrono::milliseconds flush_interval{1000};
+};
+
+/// Points a traced request is stamped at, in the order it passes them
+enum class trace_point : std::uint8_t {
+    received,    ///< the read completing the request
+    dispatched,  ///< handed to the server
+    dequeued,    ///< picked up by a worker
+    routed,      ///< past the middleware, into the route's handlers
+    handled,     ///< handlers returned
+    sent,        ///< response queued on the connection
+    count
+};
+
+class tracer;
+
+/**
+ * @brief What is recorded of one traced request while it runs
+ */
+struct request_trace {
+    /// The tracer the spans go to
+    std::shared_ptr<tracer> owner;
+
+    /// The request's own span
+    trace_context context;
+
+    /// Span of the caller, all zero if the request started the trace
+    std::array<std::uint8_t, 8> parent_id{};
+
+    /// Name of the request's span, e.g. "GET /orders/:id"
+    std::string name;
+
+    /// Stamps by trace_point, unset (epoch) where not reached
+    std::array<std::chrono::steady_clock::time_point, static_cast<std::size_t>(trace_point::count)>
+        marks{};
+
+    /// @brief Stamps a point with the current time
+    void mark(trace_point point) noexcept {
+        marks[static_cast<std::size_t>(point)] = std::chrono::steady_clock::now();
+    }
+
+    /// @brief Stamps a point with a time taken already
+    void mark(trace_point point, std::chrono::steady_clock::time_point when) noexcept {
+        marks[static_cast<std::size_t>(point)] = when;
+    }
+};
+
+/**
+ * @brief A span around a call to another service, see request::begin_span()
+ *
+ * Recorded when end() is called or the span is destroyed, if the request is
+ * traced; otherwise it only carries the context to propagate.
+ */
+class upstream_span {
+public:
+    upstream_span() = default;
+    upstream_span(std::shared_ptr<tracer> owner, trace_context context,
+                  std::array<std::uint8_t, 8> parent_id, std::string name);
+    upstream_span(upstream_span&& other) noexcept;
+    upstream_span& operator=(upstream_span&& other) noexcept;
+    upstream_span(const upstream_span&) = delete;
+    upstream_span& operator=(const upstream_span&) = delete;
+    ~upstream_span();
+
+    /// @brief Header to send on the outgoing request, empty if the request has no trace context
+    std::string traceparent() const { return context.traceparent(); }
+
+    /// @brief Records the span; later calls do nothing
+    void end();
+
+private:
+    std::shared_ptr<tracer> owner;
+    trace_context context;
+    std::array<std::uint8_t, 8> parent_id{};
+    std::string name;
+    std::chrono::steady_clock::time_point start{};
+};
+
+/**
+ * @class tracer
+ * @brief Samples requests and buffers their spans per thread
+ *
+ * Thread-safe. Each thread records into a ring of its own, which flush()
+ * drains; spans that find their ring full are counted in dropped().
+ */
+class tracer : public std::enable_shared_from_this<tracer> {
+public:
+    tracer(trace_sink sink, const tracing_options& options);
+    ~tracer();
+    tracer(const tracer&) = delete;
+    tracer& operator=(const tracer&) = delete;
+
+    /**
+     * @brief Decide whether to trace a request
+     * @param traceparent The request's traceparent header, empty if none
+     * @return The request's trace, null if it is not sampled
+     */
+    std::unique_ptr<request_trace> start(std::string_view traceparent);
+
+    /**
+     * @brief Turn a finished request into spans, buffered on this thread
+     * @param trace The request's trace
+     */
+    void finish(const request_trace& trace);
+
+    /// @brief Buffer one span on this thread
+    void record(trace_span&& span);
+
+    /**
+     * @brief Hand every buffered span to the sink
+     * @return Spans handed over
+     */
+    std::size_t flush();
+
+    /// @brief Spans dropped on full rings so far
+    std::uint64_t dropped() const noexcept { return dropped_spans.load(std::memory_order_relaxed); }
+
+    /// @brief The options the tracer was made with
+    const tracing_options& options() const noexcept { return settings; }
+
+    /// @brief Converts a steady clock stamp to wall clock time, for spans
+    std::chrono::system_clock::time_point wall_time(
+        std::chrono::steady_clock::time_point when) const noexcept {
+        return wall_origin + std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                                 when - steady_origin);
+    }
+
+private:
+    struct ring;
+
+    /// The calling thread's ring, made on its first call
+    ring& local_ring();
+
+    trace_sink sink;
+    tracing_options settings;
+
+    /// sample_rate scaled to the range of a 64-bit random number
+    std::uint64_t sample_below;
+
+    /// The two clocks read together, to put steady stamps on the wall clock
+    std::chrono::steady_clock::time_point steady_origin;
+    std::chrono::system_clock::time_point wall_origin;
+
+    /// Distinguishes tracers in the threads' ring caches, addresses may be reused
+    const std::uint64_t id;
+
+    std::mutex rings_mutex;
+    std::vector<std::unique_ptr<ring>> rings;
+
+    /// One flush at a time: each ring has a single reader
+    std::mutex flush_mutex;
+
+    std::atomic<std::uint64_t> dropped_spans{0};
+};
+}  // namespace cppress::web
@@ -19,6 +19,7 @@
  * @li listen_callback_t: Callback when server starts listening
  * @li error_callback_t: Callback for server errors
  * @li http_request_callback_t: Low-level HTTP request callback
+ * @li compose(): Several handlers as one, without type erasure between them
  *
  * @section types_usage Usage Example
  * @code{.cpp}
@@ -61,9 +62,35 @@ using error_callback_t = std::function<void(const std::exception&)>;
 
 template <typename T = request, typename G = response>
 using unhandled_exception_callback_t =
-    std::function<void(std::shared_ptr<T>, std::shared_ptr<G>, const exception&)>;
+    std::function<void(const std::shared_ptr<T>&, const std::shared_ptr<G>&, const exception&)>;
 
+/// Arguments are passed by reference: a handler that takes them as const auto& runs
+/// without touching the reference counts; one that keeps them copies them
 template <typename T = request, typename G = response>
-using request_handler_t = std::function<exit_code(std::shared_ptr<T>, std::shared_ptr<G>)>;
+using request_handler_t =
+    std::function<exit_code(const std::shared_ptr<T>&, const std::shared_ptr<G>&)>;
+
+/**
+ * @brief Chain handlers into one, without type erasure between them
+ * @param handlers Callables taking the request and response, returning exit_code
+ * @return A handler that runs them in order while they return CONTINUE, and
+ *         returns the first other result, or CONTINUE
+ *
+ * Registered as a single handler or middleware, the chain costs one call
+ * through request_handler_t, and the compiler sees the whole of it:
+ *
+ * @code{.cpp}
+ * router->get("/orders/:id", {compose(authenticate, load_order, render_order)});
+ * @endcode
+ */
+template <typename... Handlers>
+auto compose(Handlers... handlers) {
+    return [handlers...](const auto& req, const auto& res) -> exit_code {
+        exit_code result = exit_code::CONTINUE;
+        // stops at the first handler that does not continue
+        (void)((result = handlers(req, res), result == exit_code::CONTINUE) && ...);
+        return result;
+    };
+}
 
 };  // namespace cppress::web
\ No newline at end of file
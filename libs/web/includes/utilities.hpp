@@ -11,6 +11,7 @@
  * @li get_path() - Extract path from URI (without query string)
  * @li get_query_parameters() - Parse query string into key-value pairs
  * @li get_path_params() - Extract parameter names from route expressions
+ * @li parse_form_fields(), parse_cookie_fields() - Split form bodies and Cookie headers
  *
  * @subsection route_matching Route Matching
  * @li match_path() - Match route patterns against request paths
@@ -19,6 +20,7 @@
  *
  * @subsection security Security
  * @li body_has_malicious_content() - Detect XSS, SQL injection, command injection
+ * @li malicious_content_scanner - The same check over a body arriving in pieces
  *
  * @section utilities_usage Usage Example
  * @code{.cpp}
@@ -37,7 +39,8 @@
  * @endcode
  *
  * @note These utilities are used internally by request, route, and router classes
- * @note All functions are thread-safe and stateless
+ * @note All functions are thread-safe and stateless; a malicious_content_scanner
+ *       holds the state of one body
  *
  * @author cppress team
  * @version 1.0
@@ -45,8 +48,10 @@
 
 #pragma once
 
+#include <cstdint>
 #include <map>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
@@ -63,6 +68,38 @@ namespace cppress::web {
  */
 std::map<std::string, std::string> get_query_parameters(const std::string& uri);
 
+/**
+ * @brief Split the query string of a URI into name-value views.
+ * @param uri Full request URI
+ * @param[out] fields Appended with one pair per "name=value", trimmed, not decoded
+ *
+ * The views point into uri. Pairs are kept in order, duplicates included;
+ * get_query_parameters() keeps the first of each name.
+ */
+void parse_query_fields(std::string_view uri,
+                        std::vector<std::pair<std::string_view, std::string_view>>& fields);
+
+/**
+ * @brief Split an application/x-www-form-urlencoded body into name-value views.
+ * @param body The whole body, "a=1&b=2"
+ * @param[out] fields Appended with one pair per "name=value", trimmed, not decoded
+ *
+ * The same rules as parse_query_fields(), without looking for a '?'.
+ */
+void parse_form_fields(std::string_view body,
+                       std::vector<std::pair<std::string_view, std::string_view>>& fields);
+
+/**
+ * @brief Split a Cookie header into name-value views.
+ * @param header One Cookie header value, "a=1; b=2"
+ * @param[out] fields Appended with one pair per cookie, trimmed, without the quotes
+ *        of a quoted value
+ *
+ * The views point into header. Pieces without '=' are skipped.
+ */
+void parse_cookie_fields(std::string_view header,
+                         std::vector<std::pair<std::string_view, std::string_view>>& fields);
+
 /**
  * @brief Check whether a URI points to a static resource by extension.
  * @param uri Request URI
@@ -106,10 +143,66 @@ std::pair<bool, std::map<std::string, std::string>> match_path(const std::string
  * @brief Check if the request body contains malicious content.
  *
  * @param body The request body as a string
+ * @param XSS Look for script injection, anywhere in the body
+ * @param SQL Look for SQL keywords and idioms, as whole words
+ * @param CMD Look for shell metacharacters and commands, as whole words
  * @return true if malicious content is detected
  * @return false if the body is clean
+ *
+ * Matching ignores ASCII case. Words are separated by whitespace; a run of
+ * more than five quote, escape or operator characters counts as malicious
+ * whatever the flags. One pass of a malicious_content_scanner.
  */
-
 bool body_has_malicious_content(const std::string& body, bool XSS = true, bool SQL = true,
                                 bool CMD = true);
+
+/**
+ * @class malicious_content_scanner
+ * @brief body_has_malicious_content() over a body fed in pieces
+ *
+ * All patterns are compiled once, for every scanner, into one automaton
+ * that reads each byte once: the cost is linear in the body and does not
+ * grow with the number of patterns. Pieces may split a pattern anywhere,
+ * so the pieces of an http_body_stream can be fed as they arrive:
+ *
+ * @code
+ * auto scanner = std::make_shared<malicious_content_scanner>();
+ * return [scanner](std::string_view piece, bool last) {
+ *     if (scanner->feed(piece) || (last && scanner->finish()))
+ *         reject();
+ * };
+ * @endcode
+ */
+class malicious_content_scanner {
+public:
+    /// @brief A scanner for the pattern groups enabled, see body_has_malicious_content()
+    explicit malicious_content_scanner(bool XSS = true, bool SQL = true, bool CMD = true);
+
+    /**
+     * @brief Scan the next piece of the body
+     * @return true once malicious content was found, the rest need not be fed
+     */
+    bool feed(std::string_view piece) noexcept;
+
+    /**
+     * @brief Mark the end of the body
+     * @return true if malicious content was found, including a word ending the body
+     */
+    bool finish() noexcept;
+
+    /// @brief true once malicious content was found
+    bool detected() const noexcept { return found; }
+
+private:
+    /// Groups enabled, as bits of the automaton's match masks
+    std::uint8_t enabled;
+
+    /// Automaton state after the bytes fed so far
+    std::uint32_t state;
+
+    /// Suspicious characters in a row up to here
+    int special_run = 0;
+
+    bool found = false;
+};
 }  // namespace cppress::web
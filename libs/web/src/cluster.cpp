@@ -0,0 +1,347 @@
+#include "../includes/cluster.hpp"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/signalfd.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "shared/includes/logger.hpp"
+
+namespace cppress::web {
+
+namespace {
+/// Signals the supervisor reads from its signalfd
+sigset_t supervisor_signals() {
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGCHLD);
+    sigaddset(&set, SIGHUP);
+    sigaddset(&set, SIGTERM);
+    sigaddset(&set, SIGINT);
+    return set;
+}
+
+std::string describe(int status) {
+    if (WIFSIGNALED(status))
+        return "signal " + std::to_string(WTERMSIG(status));
+    return "status " + std::to_string(WEXITSTATUS(status));
+}
+}  // namespace
+
+cluster_worker::~cluster_worker() {
+    unwatch();
+    if (ready_fd != -1)
+        ::close(ready_fd);
+}
+
+void cluster_worker::ready() noexcept {
+    if (ready_fd == -1)
+        return;
+    const char byte = 1;
+    [[maybe_unused]] auto written = ::write(ready_fd, &byte, 1);
+    ::close(ready_fd);
+    ready_fd = -1;
+}
+
+/**
+ * Implementation Notes:
+ * - The stop signals are blocked in every thread of the worker (the mask
+ *   is inherited from the supervisor), sigwait() takes them here
+ */
+void cluster_worker::watch(std::function<void()> on_stop) {
+    unwatch();
+    unwatching.store(false);
+    watcher = std::thread([this, on_stop = std::move(on_stop)]() {
+        sigset_t set;
+        sigemptyset(&set);
+        sigaddset(&set, SIGTERM);
+        sigaddset(&set, SIGINT);
+        int signal = 0;
+        if (sigwait(&set, &signal) == 0 && !unwatching.load())
+            on_stop();
+    });
+}
+
+void cluster_worker::unwatch() {
+    if (!watcher.joinable())
+        return;
+    unwatching.store(true);
+    // directed at the watcher, and pending there until its sigwait() takes it
+    pthread_kill(watcher.native_handle(), SIGTERM);
+    watcher.join();
+}
+
+cluster::cluster(worker_function worker, cluster_options options)
+    : worker(std::move(worker)), options(options) {
+    if (this->options.workers == 0)
+        this->options.workers = std::max(1u, std::thread::hardware_concurrency());
+}
+
+/**
+ * Supervision Loop:
+ * 1. Wait up to 100 ms for a signal or a worker reporting ready
+ * 2. SIGHUP queues every slot for replacement, SIGTERM and SIGINT retire
+ *    every worker, SIGCHLD reaps
+ * 3. SIGKILL retiring workers past their drain timeout, start crashed
+ *    workers whose restart delay passed, move the reload along
+ * 4. Once stopping, return when the last worker has exited
+ */
+int cluster::run() {
+    if (options.shared_cache_bytes != 0 && !cache)
+        cache = std::make_unique<shared::shared_memory_cache>(options.shared_cache_bytes);
+    const sigset_t signals = supervisor_signals();
+    sigset_t previous;
+    pthread_sigmask(SIG_BLOCK, &signals, &previous);
+    signal_fd = ::signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (signal_fd < 0) {
+        pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+        throw std::runtime_error("signalfd failed: " + std::string(strerror(errno)));
+    }
+    stopping = false;
+    restart_at.assign(options.workers, clock::time_point::max());
+    for (std::size_t slot = 0; slot < options.workers; ++slot)
+        if (!spawn(slot))
+            restart_at[slot] = clock::now() + options.restart_delay;
+
+    std::vector<pollfd> watched;
+    while (!stopping || !processes.empty()) {
+        watched.clear();
+        watched.push_back({signal_fd, POLLIN, 0});
+        for (const auto& p : processes)
+            if (p.ready_fd != -1)
+                watched.push_back({p.ready_fd, POLLIN, 0});
+        ::poll(watched.data(), watched.size(), 100);
+        const auto now = clock::now();
+
+        bool exited = false;
+        signalfd_siginfo info;
+        while (::read(signal_fd, &info, sizeof(info)) == sizeof(info)) {
+            if (info.ssi_signo == SIGCHLD) {
+                exited = true;
+            } else if (info.ssi_signo == SIGHUP) {
+                if (stopping)
+                    continue;
+                shared::logger::info("cluster: reloading " + std::to_string(options.workers) +
+                                     " workers");
+                reload_queue.clear();
+                for (std::size_t slot = 0; slot < options.workers; ++slot)
+                    reload_queue.push_back(slot);
+            } else if (!stopping) {
+                shared::logger::info("cluster: stopping");
+                stopping = true;
+                reload_queue.clear();
+                replacement = -1;
+                for (auto& p : processes)
+                    if (!p.retiring)
+                        retire(p, now);
+            }
+        }
+
+        for (std::size_t i = 1; i < watched.size(); ++i) {
+            if (!watched[i].revents)
+                continue;
+            auto it = std::find_if(processes.begin(), processes.end(), [&](const process& p) {
+                return p.ready_fd == watched[i].fd;
+            });
+            if (it == processes.end())
+                continue;
+            char byte;
+            // end of file: the worker exited before it was ready, reaped below
+            it->ready = ::read(it->ready_fd, &byte, 1) == 1;
+            ::close(it->ready_fd);
+            it->ready_fd = -1;
+        }
+
+        if (exited)
+            reap(now);
+        for (auto& p : processes) {
+            if (p.retiring && now >= p.deadline) {
+                ::kill(p.pid, SIGKILL);
+                p.deadline = clock::time_point::max();
+            }
+        }
+        for (std::size_t slot = 0; slot < restart_at.size() && !stopping; ++slot) {
+            if (restart_at[slot] > now)
+                continue;
+            restart_at[slot] = clock::time_point::max();
+            if (!spawn(slot))
+                restart_at[slot] = now + options.restart_delay;
+        }
+        advance_reload(now);
+    }
+
+    // consume what is still pending, SIGHUP would end the process once unblocked
+    signalfd_siginfo info;
+    while (::read(signal_fd, &info, sizeof(info)) == sizeof(info)) {
+    }
+    ::close(signal_fd);
+    signal_fd = -1;
+    pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+    shared::logger::info("cluster: stopped");
+    return 0;
+}
+
+/**
+ * Implementation Notes:
+ * - The child keeps SIGHUP, SIGTERM and SIGINT blocked, serve() waits for
+ *   the last two; SIGCHLD is unblocked for the worker's own children
+ * - The child leaves through _exit(): the supervisor's static objects and
+ *   atexit handlers are not the worker's to run
+ */
+cluster::process* cluster::spawn(std::size_t slot) {
+    int ready_pipe[2];
+    if (::pipe2(ready_pipe, O_CLOEXEC) != 0) {
+        shared::logger::error("cluster: pipe failed: " + std::string(strerror(errno)));
+        return nullptr;
+    }
+    const std::uint64_t serial = next_serial++;
+    const pid_t pid = ::fork();
+    if (pid < 0) {
+        shared::logger::error("cluster: fork failed: " + std::string(strerror(errno)));
+        ::close(ready_pipe[0]);
+        ::close(ready_pipe[1]);
+        return nullptr;
+    }
+    if (pid == 0) {
+        ::close(ready_pipe[0]);
+        ::close(signal_fd);
+        for (const auto& p : processes)
+            if (p.ready_fd != -1)
+                ::close(p.ready_fd);
+        sigset_t child;
+        sigemptyset(&child);
+        sigaddset(&child, SIGCHLD);
+        pthread_sigmask(SIG_UNBLOCK, &child, nullptr);
+
+        int status = 1;
+        {
+            cluster_worker self(slot, serial, ready_pipe[1], options.drain_timeout,
+                                cache.get());
+            try {
+                status = worker(self);
+            } catch (const std::exception& e) {
+                shared::logger::error("cluster: worker failed: " + std::string(e.what()));
+            }
+        }
+        std::cout.flush();
+        std::fflush(nullptr);
+        ::_exit(status);
+    }
+    ::close(ready_pipe[1]);
+
+    process p;
+    p.pid = pid;
+    p.slot = slot;
+    p.serial = serial;
+    p.ready_fd = ready_pipe[0];
+    processes.push_back(p);
+    return &processes.back();
+}
+
+bool cluster::slot_served(std::size_t slot, pid_t except) const {
+    return std::any_of(processes.begin(), processes.end(), [&](const process& p) {
+        return p.slot == slot && p.pid != except && !p.retiring;
+    });
+}
+
+/**
+ * Implementation Notes:
+ * - A worker that exits while retiring was told to; any other exit is a
+ *   crash, restarted after restart_delay unless another worker already
+ *   serves the slot (e.g. its replacement in a reload)
+ * - A replacement exiting before it was ready ends the reload
+ */
+void cluster::reap(clock::time_point now) {
+    int status = 0;
+    pid_t pid;
+    while ((pid = ::waitpid(-1, &status, WNOHANG)) > 0) {
+        auto it = std::find_if(processes.begin(), processes.end(),
+                               [pid](const process& p) { return p.pid == pid; });
+        if (it == processes.end())
+            continue;
+        const process gone = *it;
+        processes.erase(it);
+        if (gone.ready_fd != -1)
+            ::close(gone.ready_fd);
+        if (gone.pid == replacement && !gone.retiring)
+            abort_reload("the new worker exited before it was ready");
+        if (gone.retiring || stopping)
+            continue;
+        shared::logger::error("cluster: worker " + std::to_string(pid) + " exited with " +
+                              describe(status));
+        if (!slot_served(gone.slot, pid))
+            restart_at[gone.slot] = now + options.restart_delay;
+    }
+}
+
+void cluster::retire(process& p, clock::time_point now) {
+    ::kill(p.pid, SIGTERM);
+    p.retiring = true;
+    // a second on top of the drain for the worker to stop its threads
+    p.deadline = now + options.drain_timeout + std::chrono::seconds(1);
+}
+
+/**
+ * Implementation Notes:
+ * - One slot at a time: the replacement must report ready before the
+ *   worker it replaces is retired and the next slot is started, so the
+ *   number of workers accepting never drops
+ * - Retired workers drain in the background while the reload moves on
+ */
+void cluster::advance_reload(clock::time_point now) {
+    if (replacement != -1) {
+        auto it = std::find_if(processes.begin(), processes.end(),
+                               [this](const process& p) { return p.pid == replacement; });
+        if (it == processes.end()) {
+            replacement = -1;
+        } else if (!it->ready) {
+            if (now < it->deadline)
+                return;
+            it->retiring = true;
+            ::kill(it->pid, SIGKILL);
+            it->deadline = clock::time_point::max();
+            if (!slot_served(it->slot, it->pid))
+                restart_at[it->slot] = now + options.restart_delay;
+            abort_reload("the new worker did not report ready in time");
+            return;
+        } else {
+            for (auto& p : processes)
+                if (p.slot == it->slot && p.serial < it->serial && !p.retiring)
+                    retire(p, now);
+            replacement = -1;
+        }
+    }
+    if (stopping || reload_queue.empty())
+        return;
+    const std::size_t slot = reload_queue.front();
+    reload_queue.pop_front();
+    // the replacement also stands in for a pending restart of the slot
+    restart_at[slot] = clock::time_point::max();
+    process* fresh = spawn(slot);
+    if (!fresh) {
+        if (!slot_served(slot, -1))
+            restart_at[slot] = now + options.restart_delay;
+        abort_reload("fork failed");
+        return;
+    }
+    fresh->deadline = now + options.ready_timeout;
+    replacement = fresh->pid;
+}
+
+void cluster::abort_reload(const char* why) {
+    shared::logger::error(std::string("cluster: reload abandoned, ") + why);
+    reload_queue.clear();
+    replacement = -1;
+}
+}  // namespace cppress::web
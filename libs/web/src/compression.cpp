@@ -0,0 +1,135 @@
+#include "../includes/compression.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <system_error>
+
+namespace cppress::web {
+
+namespace {
+bool read_file(const std::string& path, std::string& out) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+    std::ostringstream buffer;
+    buffer << file.rdbuf();
+    out = buffer.str();
+    return true;
+}
+}  // namespace
+
+static_variant_cache::static_variant_cache(const compression_options& options,
+                                           std::size_t max_bytes)
+    : options(options), max_bytes(max_bytes) {}
+
+std::size_t static_variant_cache::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return bytes;
+}
+
+/**
+ * Implementation Notes:
+ * - The file is stat'ed on every call; a changed file replaces its
+ *   variants on the next request
+ */
+static_variant_cache::variant static_variant_cache::find(
+    const std::string& file_path, const cppress::http::http_headers& request_headers) {
+    std::error_code ec;
+    auto modified = std::filesystem::last_write_time(file_path, ec);
+    if (ec)
+        return {};
+    std::uintmax_t file_size = std::filesystem::file_size(file_path, ec);
+    if (ec)
+        return {};
+    return find(file_path, request_headers, modified, file_size);
+}
+
+/**
+ * Implementation Notes:
+ * - Codings are tried from the client's highest q down, ties in br, zstd,
+ *   gzip order, so a missing br variant falls back to gzip
+ */
+static_variant_cache::variant static_variant_cache::find(
+    const std::string& file_path, const cppress::http::http_headers& request_headers,
+    std::filesystem::file_time_type modified, std::uintmax_t file_size) {
+    using cppress::http::content_coding;
+    if (file_size < options.min_size)
+        return {};
+
+    std::string accept_encoding;
+    request_headers.for_each(cppress::http::header_id::accept_encoding,
+                             [&accept_encoding](std::string_view value) {
+                                 if (!accept_encoding.empty())
+                                     accept_encoding += ',';
+                                 accept_encoding.append(value);
+                             });
+    if (accept_encoding.empty())
+        return {};
+
+    std::pair<double, content_coding> ranked[3];
+    std::size_t n = 0;
+    for (auto coding : {content_coding::br, content_coding::zstd, content_coding::gzip}) {
+        double q = cppress::http::accept_encoding_quality(accept_encoding, coding);
+        if (q > 0)
+            ranked[n++] = {q, coding};
+    }
+    std::stable_sort(ranked, ranked + n,
+                     [](const auto& a, const auto& b) { return a.first > b.first; });
+
+    for (std::size_t i = 0; i < n; ++i) {
+        key k{file_path, ranked[i].second};
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = entries.find(k);
+            if (it != entries.end() && it->second.modified == modified &&
+                it->second.file_size == file_size)
+                return {k.second, it->second.body};
+        }
+        // encoded outside the lock; two racing requests may both do it once
+        auto body = load(file_path, k.second, modified);
+        if (!body)
+            continue;
+        insert(k, {modified, file_size, body});
+        return {k.second, body};
+    }
+    return {};
+}
+
+std::shared_ptr<const std::string> static_variant_cache::load(
+    const std::string& file_path, cppress::http::content_coding coding,
+    std::filesystem::file_time_type modified) const {
+    std::string sibling = file_path + std::string(cppress::http::content_coding_suffix(coding));
+    std::error_code ec;
+    auto sibling_modified = std::filesystem::last_write_time(sibling, ec);
+    std::string body;
+    if (!ec && sibling_modified >= modified && read_file(sibling, body))
+        return std::make_shared<const std::string>(std::move(body));
+
+    if (!cppress::http::content_coding_available(coding) || !read_file(file_path, body))
+        return nullptr;
+    return std::make_shared<const std::string>(
+        cppress::http::compress_body(coding, body, options.level));
+}
+
+void static_variant_cache::insert(const key& k, entry e) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (e.body->size() > max_bytes)
+        return;
+    auto it = entries.find(k);
+    if (it != entries.end()) {
+        bytes -= it->second.body->size();
+        entries.erase(it);
+        order.remove(k);
+    }
+    while (bytes + e.body->size() > max_bytes && !order.empty()) {
+        auto oldest = entries.find(order.front());
+        bytes -= oldest->second.body->size();
+        entries.erase(oldest);
+        order.pop_front();
+    }
+    bytes += e.body->size();
+    order.push_back(k);
+    entries.emplace(k, std::move(e));
+}
+}  // namespace cppress::web
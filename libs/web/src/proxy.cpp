@@ -0,0 +1,631 @@
+#include "../includes/proxy.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <limits>
+#include <stdexcept>
+
+#include "http/includes.hpp"
+#include "shared/includes/utils.hpp"
+
+namespace cppress::web {
+
+namespace {
+bool iequals(std::string_view a, std::string_view b) noexcept {
+    return a.size() == b.size() &&
+           std::equal(a.begin(), a.end(), b.begin(), [](unsigned char x, unsigned char y) {
+               return std::tolower(x) == std::tolower(y);
+           });
+}
+
+std::string_view trim(std::string_view s) noexcept {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t'))
+        s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t'))
+        s.remove_suffix(1);
+    return s;
+}
+
+using shared::has_token;
+
+bool listed(std::string_view name, const std::vector<std::string>& names) noexcept {
+    return std::any_of(names.begin(), names.end(),
+                       [name](const std::string& n) { return iequals(n, name); });
+}
+
+bool listed(std::string_view name,
+            const std::vector<std::pair<std::string, std::string>>& fields) noexcept {
+    return std::any_of(fields.begin(), fields.end(),
+                       [name](const auto& field) { return iequals(field.first, name); });
+}
+
+/// Headers describing one connection, never forwarded (RFC 9110 7.6.1)
+bool is_hop_by_hop(std::string_view name, std::string_view connection) noexcept {
+    static const char* const names[] = {"connection", "keep-alive", "proxy-connection",
+                                        "te",         "trailer",    "transfer-encoding",
+                                        "upgrade"};
+    for (const char* n : names)
+        if (iequals(name, n))
+            return true;
+    return has_token(connection, name);
+}
+
+std::int64_t now_ns() noexcept {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+bool is_idempotent(std::string_view method) noexcept {
+    return method == "GET" || method == "HEAD" || method == "PUT" || method == "DELETE" ||
+           method == "OPTIONS" || method == "TRACE";
+}
+
+void bad_gateway(response& res) {
+    res.set_status(502, "Bad Gateway");
+    res.send_text("502 Bad Gateway");
+}
+
+/// Status code of a status line, 0 if it is not one
+int parse_status(std::string_view line) noexcept {
+    if (line.size() < 12 || line.substr(0, 7) != "HTTP/1." || line[8] != ' ')
+        return 0;
+    int status = 0;
+    for (std::size_t i = 9; i < 12; ++i) {
+        if (!std::isdigit(static_cast<unsigned char>(line[i])))
+            return 0;
+        status = status * 10 + (line[i] - '0');
+    }
+    return status;
+}
+}  // namespace
+
+struct reverse_proxy::exchange {
+    enum class phase {
+        head,         ///< waiting for the response head
+        length,       ///< remaining bytes of a Content-Length body
+        chunked,      ///< chunked body, through decoder
+        until_close,  ///< body ends when the upstream closes
+        done
+    };
+
+    std::shared_ptr<request> req;
+    std::shared_ptr<response> res;
+
+    /// Balancing key, kept for retries
+    std::string key;
+
+    /// Serialized head of the forwarded request
+    std::string head;
+
+    std::size_t upstream = std::numeric_limits<std::size_t>::max();
+    std::size_t attempts = 0;
+    std::shared_ptr<cppress::sockets::connection> conn;
+
+    phase state = phase::head;
+
+    /// Response head bytes received so far
+    std::string pending;
+
+    /// Any response byte arrived on the current connection
+    bool received = false;
+
+    /// The upstream lets the connection be reused after this response
+    bool keep_alive = true;
+
+    std::uint64_t remaining = 0;
+    cppress::http::http_chunked_decoder decoder;
+};
+
+reverse_proxy::reverse_proxy(cppress::sockets::epoll_server& loops,
+                             std::vector<proxy_upstream> upstreams, proxy_options options)
+    : loops(loops), upstreams(std::move(upstreams)), options(std::move(options)) {
+    if (this->upstreams.empty())
+        throw std::invalid_argument("reverse_proxy needs at least one upstream");
+
+    states = std::make_unique<upstream_state[]>(this->upstreams.size());
+    for (std::size_t i = 0; i < this->upstreams.size(); ++i) {
+        const proxy_upstream& up = this->upstreams[i];
+        const bool v6 = up.address.find(':') != std::string::npos;
+        states[i].address = cppress::sockets::socket_address(
+            cppress::sockets::ip_address(up.address), cppress::sockets::port(up.port),
+            cppress::sockets::family(v6 ? cppress::sockets::IPV6 : cppress::sockets::IPV4));
+
+        const std::string node = up.address + ":" + std::to_string(up.port) + "#";
+        for (std::size_t v = 0; v < std::max<std::size_t>(1, this->options.virtual_nodes); ++v)
+            ring.emplace_back(std::hash<std::string>()(node + std::to_string(v)), i);
+    }
+    std::sort(ring.begin(), ring.end());
+}
+
+/**
+ * Implementation Notes:
+ * - Round-robin and least-connections skip upstreams left out; the hash
+ *   ring is walked on from the key's point to the first upstream not left
+ *   out, so only the keys of a failed upstream move
+ * - With every upstream left out, the policy's first choice is used anyway
+ *   rather than refusing outright
+ */
+std::size_t reverse_proxy::acquire(std::string_view key) {
+    const std::size_t n = upstreams.size();
+    const std::int64_t now = now_ns();
+    auto up = [&](std::size_t i) {
+        return states[i].down_until.load(std::memory_order_relaxed) <= now;
+    };
+
+    std::size_t chosen = 0;
+    switch (options.policy) {
+        case balance_policy::round_robin: {
+            const std::size_t start = cursor.fetch_add(1, std::memory_order_relaxed);
+            chosen = start % n;
+            for (std::size_t k = 0; k < n; ++k)
+                if (up((start + k) % n)) {
+                    chosen = (start + k) % n;
+                    break;
+                }
+            break;
+        }
+        case balance_policy::least_connections: {
+            // ties are broken in turn, so idle upstreams share the load
+            const std::size_t start = cursor.fetch_add(1, std::memory_order_relaxed);
+            std::size_t best = std::numeric_limits<std::size_t>::max();
+            chosen = start % n;
+            for (std::size_t k = 0; k < n; ++k) {
+                const std::size_t i = (start + k) % n;
+                const std::size_t active = states[i].active.load(std::memory_order_relaxed);
+                if (up(i) && active < best) {
+                    best = active;
+                    chosen = i;
+                }
+            }
+            break;
+        }
+        case balance_policy::consistent_hash: {
+            const std::uint64_t point = std::hash<std::string_view>()(key);
+            auto it = std::lower_bound(ring.begin(), ring.end(),
+                                       std::make_pair(point, std::size_t(0)));
+            const std::size_t first = it == ring.end() ? 0 : it - ring.begin();
+            chosen = ring[first].second;
+            for (std::size_t k = 0; k < ring.size(); ++k) {
+                const std::size_t i = ring[(first + k) % ring.size()].second;
+                if (up(i)) {
+                    chosen = i;
+                    break;
+                }
+            }
+            break;
+        }
+    }
+    states[chosen].active.fetch_add(1, std::memory_order_relaxed);
+    return chosen;
+}
+
+void reverse_proxy::release(std::size_t upstream, bool ok) noexcept {
+    upstream_state& s = states[upstream];
+    s.active.fetch_sub(1, std::memory_order_relaxed);
+    if (ok) {
+        s.fails.store(0, std::memory_order_relaxed);
+        return;
+    }
+    if (s.fails.fetch_add(1, std::memory_order_relaxed) + 1 >= options.max_fails) {
+        s.fails.store(0, std::memory_order_relaxed);
+        const std::int64_t until =
+            now_ns() +
+            std::chrono::duration_cast<std::chrono::nanoseconds>(options.fail_timeout).count();
+        // an upstream a health probe left out stays out until a probe passes
+        std::int64_t current = s.down_until.load(std::memory_order_relaxed);
+        while (current < until &&
+               !s.down_until.compare_exchange_weak(current, until, std::memory_order_relaxed)) {
+        }
+    }
+}
+
+bool reverse_proxy::healthy(std::size_t upstream) const noexcept {
+    return states[upstream].down_until.load(std::memory_order_relaxed) <= now_ns();
+}
+
+void reverse_proxy::mark(std::size_t upstream, bool ok) noexcept {
+    upstream_state& s = states[upstream];
+    s.fails.store(0, std::memory_order_relaxed);
+    s.down_until.store(ok ? 0 : std::numeric_limits<std::int64_t>::max(),
+                       std::memory_order_relaxed);
+}
+
+/**
+ * Implementation Notes:
+ * - The head is built once and kept for retries: request line with the
+ *   prefix stripped, the client's end-to-end headers minus those removed
+ *   or replaced, the X-Forwarded-* headers, the headers set, and the
+ *   Content-Length of the body as received
+ * - The upstream connection is always asked to stay open; whether it is
+ *   pooled afterwards is the upstream's call
+ */
+void reverse_proxy::forward(const std::shared_ptr<request>& req,
+                            const std::shared_ptr<response>& res) {
+    auto ex = std::make_shared<exchange>();
+    ex->req = req;
+    ex->res = res;
+    ex->key = std::string(options.hash_key ? options.hash_key(*req)
+                                           : std::string_view(req->get_remote_address()));
+
+    std::string target = req->get_uri();
+    if (!options.strip_prefix.empty() && target.compare(0, options.strip_prefix.size(),
+                                                        options.strip_prefix) == 0) {
+        target.erase(0, options.strip_prefix.size());
+        if (target.empty() || target.front() != '/')
+            target.insert(target.begin(), '/');
+    }
+
+    std::string& head = ex->head;
+    head = req->get_method() + " " + target + " HTTP/1.1\r\n";
+
+    const std::string_view connection = req->get_header_value("Connection");
+    std::string forwarded_for;
+    for (const auto& [name, value] : req->get_headers()) {
+        if (iequals(name, "X-Forwarded-For")) {
+            forwarded_for = value;
+            continue;
+        }
+        if (is_hop_by_hop(name, connection) || iequals(name, "Content-Length") ||
+            iequals(name, "Expect") || listed(name, options.remove_request_headers) ||
+            listed(name, options.request_headers))
+            continue;
+        head += name + ": " + value + "\r\n";
+    }
+
+    const std::string& client = req->get_remote_address();
+    if (!client.empty())
+        forwarded_for += (forwarded_for.empty() ? "" : ", ") + client;
+    if (!forwarded_for.empty())
+        head += "X-Forwarded-For: " + forwarded_for + "\r\n";
+    if (req->get_header_value("X-Forwarded-Proto").empty())
+        head += "X-Forwarded-Proto: http\r\n";
+    const std::string_view host = req->get_header_value("Host");
+    if (!host.empty() && req->get_header_value("X-Forwarded-Host").empty())
+        head += "X-Forwarded-Host: " + std::string(host) + "\r\n";
+    for (const auto& [name, value] : options.request_headers)
+        head += name + ": " + value + "\r\n";
+
+    const auto spool = req->get_body_spool();
+    const std::size_t length = spool ? spool->size() : req->get_body().size();
+    if (length > 0 || req->get_method() == "POST" || req->get_method() == "PUT" ||
+        req->get_method() == "PATCH")
+        head += "Content-Length: " + std::to_string(length) + "\r\n";
+    head += "Connection: keep-alive\r\n\r\n";
+
+    res->defer();
+    attempt(ex);
+}
+
+/**
+ * Implementation Notes:
+ * - All callbacks of one attempt run on the loop owning its connection,
+ *   so the exchange is never touched by two threads at once
+ * - The handlers hold the exchange; the loop drops them when the
+ *   connection is released or closed, which breaks the cycle through conn
+ */
+void reverse_proxy::attempt(const std::shared_ptr<exchange>& ex) {
+    ++ex->attempts;
+    ex->upstream = acquire(ex->key);
+    ex->received = false;
+    ex->pending.clear();
+
+    auto self = shared_from_this();
+    cppress::sockets::client_handlers handlers;
+    handlers.on_connect = [self, ex](std::shared_ptr<cppress::sockets::connection> conn,
+                                     int error) {
+        if (error != 0) {
+            self->release(ex->upstream, false);
+            if (ex->attempts < self->options.attempts) {
+                self->attempt(ex);
+                return;
+            }
+            ex->state = exchange::phase::done;
+            bad_gateway(*ex->res);
+            return;
+        }
+        ex->conn = conn;
+
+        std::vector<cppress::sockets::output_segment> segments;
+        if (const auto spool = ex->req->get_body_spool()) {
+            segments.emplace_back(cppress::sockets::data_buffer(ex->head));
+            segments.emplace_back(
+                cppress::sockets::file_region(spool->fd(), 0, spool->size(), false));
+        } else {
+            segments.emplace_back(cppress::sockets::data_buffer(ex->head + ex->req->get_body()));
+        }
+        self->loops.send_outbound(conn, std::move(segments));
+    };
+    handlers.on_data = [self, ex](std::shared_ptr<cppress::sockets::connection>,
+                                  const cppress::sockets::data_buffer& db) {
+        self->on_upstream_data(ex, std::string_view(db.data(), db.size()));
+    };
+    handlers.on_close = [self, ex](std::shared_ptr<cppress::sockets::connection>) {
+        self->on_upstream_close(ex);
+    };
+    loops.connect_async(states[ex->upstream].address, std::move(handlers),
+                        options.connect_timeout);
+}
+
+void reverse_proxy::on_upstream_data(const std::shared_ptr<exchange>& ex, std::string_view data) {
+    if (ex->state == exchange::phase::done)
+        return;
+    ex->received = true;
+    if (ex->state != exchange::phase::head) {
+        if (pass_body(ex, data))
+            finish(ex, true, ex->keep_alive);
+        return;
+    }
+
+    ex->pending.append(data);
+    std::size_t end;
+    for (;;) {
+        end = ex->pending.find("\r\n\r\n");
+        if (end == std::string::npos) {
+            if (ex->pending.size() > options.max_response_head)
+                fail(ex);
+            return;
+        }
+        const int status = parse_status(ex->pending);
+        if (status >= 100 && status < 200 && status != 101) {
+            // interim responses are dropped, the client's body was sent whole
+            ex->pending.erase(0, end + 4);
+            continue;
+        }
+        if (!start_response(ex, std::string_view(ex->pending).substr(0, end + 2))) {
+            fail(ex);
+            return;
+        }
+        break;
+    }
+
+    const std::string rest = ex->pending.substr(end + 4);
+    ex->pending.clear();
+    ex->pending.shrink_to_fit();
+    if (ex->state == exchange::phase::done)
+        return;
+    if (pass_body(ex, rest))
+        finish(ex, true, ex->keep_alive);
+}
+
+/**
+ * Implementation Notes:
+ * - The body's framing is the upstream's business: Content-Length and
+ *   Transfer-Encoding are dropped and the body is streamed chunked, so
+ *   nothing is held back waiting for its end
+ * - Responses without a body (to HEAD, 204, 304) are sent whole at once;
+ *   a HEAD keeps the upstream's Content-Length
+ */
+bool reverse_proxy::start_response(const std::shared_ptr<exchange>& ex, std::string_view head) {
+    const std::size_t line_end = head.find("\r\n");
+    const std::string_view status_line = head.substr(0, line_end);
+    const int status = parse_status(status_line);
+    if (status < 200)
+        return false;
+
+    std::vector<std::pair<std::string_view, std::string_view>> fields;
+    std::string_view connection, transfer_encoding, content_length;
+    for (std::size_t pos = line_end + 2; pos < head.size();) {
+        const std::size_t eol = head.find("\r\n", pos);
+        const std::string_view line = head.substr(pos, eol - pos);
+        pos = eol + 2;
+        const std::size_t colon = line.find(':');
+        if (colon == std::string_view::npos || colon == 0)
+            return false;
+        const std::string_view name = line.substr(0, colon);
+        const std::string_view value = trim(line.substr(colon + 1));
+        if (iequals(name, "Connection"))
+            connection = value;
+        else if (iequals(name, "Transfer-Encoding"))
+            transfer_encoding = value;
+        else if (iequals(name, "Content-Length"))
+            content_length = value;
+        fields.emplace_back(name, value);
+    }
+
+    ex->keep_alive = status_line.substr(0, 8) == "HTTP/1.1" ? !has_token(connection, "close")
+                                                            : has_token(connection, "keep-alive");
+
+    const bool head_request = ex->req->get_method() == "HEAD";
+    const bool no_body = head_request || status == 204 || status == 304;
+    if (!no_body) {
+        if (!transfer_encoding.empty()) {
+            if (!has_token(transfer_encoding, "chunked"))
+                return false;
+            ex->state = exchange::phase::chunked;
+        } else if (!content_length.empty()) {
+            ex->remaining = 0;
+            for (char c : content_length) {
+                if (!std::isdigit(static_cast<unsigned char>(c)))
+                    return false;
+                ex->remaining = ex->remaining * 10 + static_cast<std::uint64_t>(c - '0');
+            }
+            ex->state = exchange::phase::length;
+        } else {
+            ex->state = exchange::phase::until_close;
+            ex->keep_alive = false;
+        }
+    }
+
+    const std::string_view reason = status_line.size() > 13 ? status_line.substr(13) : "";
+    response& res = *ex->res;
+    res.set_status(status, std::string(reason));
+    for (const auto& [name, value] : fields) {
+        if (is_hop_by_hop(name, connection) || listed(name, options.remove_response_headers) ||
+            listed(name, options.response_headers))
+            continue;
+        if ((iequals(name, "Content-Length") && !head_request) || iequals(name, "Date"))
+            continue;
+        res.add_header(std::string(name), std::string(value));
+    }
+    for (const auto& [name, value] : options.response_headers)
+        res.set_header(name, value);
+
+    if (no_body) {
+        res.send();
+        finish(ex, true, ex->keep_alive);
+        return true;
+    }
+    if (!res.begin_stream()) {
+        finish(ex, true, false);
+        return true;
+    }
+    return true;
+}
+
+bool reverse_proxy::pass_body(const std::shared_ptr<exchange>& ex, std::string_view data) {
+    response& res = *ex->res;
+    switch (ex->state) {
+        case exchange::phase::length: {
+            const std::size_t n =
+                static_cast<std::size_t>(std::min<std::uint64_t>(ex->remaining, data.size()));
+            if (n > 0)
+                res.write_chunk(std::string(data.substr(0, n)));
+            ex->remaining -= n;
+            if (ex->remaining > 0)
+                return false;
+            res.end_stream();
+            return true;
+        }
+        case exchange::phase::chunked: {
+            std::size_t pos = 0;
+            cppress::http::http_span run;
+            for (;;) {
+                switch (ex->decoder.next(data, pos, run, options.max_response_head)) {
+                    case cppress::http::http_chunked_decoder::status::data:
+                        if (run.length > 0)
+                            res.write_chunk(std::string(run.in(data)));
+                        continue;
+                    case cppress::http::http_chunked_decoder::status::need_more:
+                        return false;
+                    case cppress::http::http_chunked_decoder::status::complete:
+                        res.end_stream();
+                        return true;
+                    case cppress::http::http_chunked_decoder::status::error:
+                        abort(ex);
+                        return false;
+                }
+            }
+        }
+        case exchange::phase::until_close:
+            if (!data.empty())
+                res.write_chunk(std::string(data));
+            return false;
+        default:
+            return false;
+    }
+}
+
+void reverse_proxy::on_upstream_close(const std::shared_ptr<exchange>& ex) {
+    switch (ex->state) {
+        case exchange::phase::done:
+            return;
+        case exchange::phase::until_close:
+            ex->conn.reset();
+            ex->res->end_stream();
+            finish(ex, true, false);
+            return;
+        case exchange::phase::head:
+            release(ex->upstream, false);
+            ex->conn.reset();
+            // a pooled connection the upstream closed meanwhile: nothing was processed
+            if (!ex->received && ex->attempts < options.attempts &&
+                is_idempotent(ex->req->get_method())) {
+                attempt(ex);
+                return;
+            }
+            ex->state = exchange::phase::done;
+            bad_gateway(*ex->res);
+            return;
+        default:
+            abort(ex);
+            return;
+    }
+}
+
+void reverse_proxy::finish(const std::shared_ptr<exchange>& ex, bool ok, bool reuse) {
+    if (ex->state == exchange::phase::done && !ex->conn)
+        return;
+    ex->state = exchange::phase::done;
+    release(ex->upstream, ok);
+    if (auto conn = std::move(ex->conn)) {
+        if (reuse)
+            loops.release_connection(conn);
+        else
+            loops.close_outbound(conn);
+    }
+}
+
+void reverse_proxy::fail(const std::shared_ptr<exchange>& ex) {
+    finish(ex, false, false);
+    bad_gateway(*ex->res);
+}
+
+void reverse_proxy::abort(const std::shared_ptr<exchange>& ex) {
+    finish(ex, false, false);
+    ex->res->end();
+}
+
+/**
+ * Implementation Notes:
+ * - A probe passes on a 2xx or 3xx status line; a refused connection, an
+ *   error status or a close before the status line leaves the upstream out
+ *   until a later probe passes
+ */
+void reverse_proxy::check_health() {
+    if (options.health_path.empty())
+        return;
+    auto self = shared_from_this();
+    for (std::size_t i = 0; i < upstreams.size(); ++i) {
+        struct probe {
+            std::string received;
+            bool done = false;
+        };
+        auto state = std::make_shared<probe>();
+        const std::string request = "GET " + options.health_path + " HTTP/1.1\r\nHost: " +
+                                    upstreams[i].address + "\r\nConnection: close\r\n\r\n";
+
+        cppress::sockets::client_handlers handlers;
+        handlers.on_connect = [self, i, request, state](
+                                  std::shared_ptr<cppress::sockets::connection> conn, int error) {
+            if (error != 0) {
+                state->done = true;
+                self->mark(i, false);
+                return;
+            }
+            std::vector<cppress::sockets::output_segment> segments;
+            segments.emplace_back(cppress::sockets::data_buffer(request));
+            self->loops.send_outbound(conn, std::move(segments));
+        };
+        handlers.on_data = [self, i, state](std::shared_ptr<cppress::sockets::connection> conn,
+                                            const cppress::sockets::data_buffer& db) {
+            if (state->done)
+                return;
+            state->received.append(db.data(), db.size());
+            const std::size_t eol = state->received.find("\r\n");
+            if (eol == std::string::npos && state->received.size() < 1024)
+                return;
+            state->done = true;
+            const int status = parse_status(std::string_view(state->received).substr(0, eol));
+            self->mark(i, status >= 200 && status < 400);
+            self->loops.close_outbound(conn);
+        };
+        handlers.on_close = [self, i, state](std::shared_ptr<cppress::sockets::connection>) {
+            if (!state->done) {
+                state->done = true;
+                self->mark(i, false);
+            }
+        };
+        loops.connect_async(states[i].address, std::move(handlers), options.connect_timeout);
+    }
+}
+
+void reverse_proxy::start_health_checks() {
+    check_health();
+    std::weak_ptr<reverse_proxy> weak = weak_from_this();
+    loops.run_after(options.health_interval, [weak]() {
+        if (auto self = weak.lock())
+            self->start_health_checks();
+    });
+}
+}  // namespace cppress::web
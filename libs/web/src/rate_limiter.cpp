@@ -0,0 +1,114 @@
+#include "../includes/rate_limiter.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace cppress::web {
+
+namespace {
+std::size_t round_up_pow2(std::size_t n) {
+    std::size_t p = 1;
+    while (p < n)
+        p <<= 1;
+    return p;
+}
+
+cppress::sockets::data_buffer serialize_refusal(std::int64_t interval_ns) {
+    static const std::string body = "429 Too Many Requests";
+    // whole seconds, rounded up: the next request is allowed by then
+    const std::int64_t retry_after =
+        std::max<std::int64_t>(1, (interval_ns + 999999999) / 1000000000);
+    return cppress::sockets::data_buffer(
+        "HTTP/1.1 429 Too Many Requests\r\n"
+        "Content-Type: text/plain\r\n"
+        "Content-Length: " +
+        std::to_string(body.size()) + "\r\nRetry-After: " + std::to_string(retry_after) +
+        "\r\nConnection: close\r\n\r\n" + body);
+}
+}  // namespace
+
+constexpr std::size_t rate_limiter::PROBES;
+
+rate_limiter::rate_limiter(const rate_limit_options& options)
+    : shards(std::max<std::size_t>(1, options.shards)),
+      slot_mask(round_up_pow2(std::max(options.slots_per_shard, PROBES)) - 1) {
+    const double rate = options.rate > 0 ? options.rate : 1e-9;
+    interval = static_cast<std::int64_t>(std::llround(1e9 / rate));
+    if (interval < 1)
+        interval = 1;
+    tolerance = interval * static_cast<std::int64_t>(options.burst > 0 ? options.burst - 1 : 0);
+    for (auto& s : shards)
+        s.slots = std::make_unique<slot[]>(slot_mask + 1);
+    refusal = serialize_refusal(interval);
+}
+
+/**
+ * Implementation Notes:
+ * - The high bits of the hash pick the shard, the low bits the first slot
+ * - The probe stops at the key or at the first unused slot; past the window,
+ *   the first slot whose key is back to its full burst is taken over. Two
+ *   threads adding one key at once may both take a slot, the key then
+ *   spreads its budget over the two until one of them is taken over
+ */
+bool rate_limiter::allow(std::string_view key, std::chrono::steady_clock::time_point now) noexcept {
+    std::uint64_t hash = std::hash<std::string_view>()(key);
+    hash = hash == 0 ? 1 : hash;
+    const std::int64_t at =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
+
+    shard& table = shards[(hash >> 40) % shards.size()];
+    slot* expired = nullptr;
+    for (std::size_t probe = 0; probe < PROBES; ++probe) {
+        slot& s = table.slots[(hash + probe) & slot_mask];
+        std::uint64_t held = s.key.load(std::memory_order_acquire);
+        if (held == 0 && s.key.compare_exchange_strong(held, hash, std::memory_order_acq_rel))
+            return take(s, at);
+        if (held == hash)
+            return take(s, at);
+        if (!expired && s.tat.load(std::memory_order_relaxed) <= at)
+            expired = &s;
+    }
+    if (expired) {
+        std::uint64_t held = expired->key.load(std::memory_order_relaxed);
+        if (held == hash ||
+            (expired->tat.load(std::memory_order_relaxed) <= at &&
+             expired->key.compare_exchange_strong(held, hash, std::memory_order_acq_rel)))
+            return take(*expired, at);
+    }
+    overflowed.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+/**
+ * Implementation Notes:
+ * - GCRA: a request is allowed while the arrival time runs no more than the
+ *   tolerance ahead of now, and pushes it one interval further; an arrival
+ *   time in the past counts from now, which is how idle keys refill
+ */
+bool rate_limiter::take(slot& s, std::int64_t now) noexcept {
+    std::int64_t tat = s.tat.load(std::memory_order_relaxed);
+    for (;;) {
+        const std::int64_t from = tat > now ? tat : now;
+        if (from - now > tolerance) {
+            refused.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        if (s.tat.compare_exchange_weak(tat, from + interval, std::memory_order_relaxed))
+            return true;
+    }
+}
+
+rate_limit_key rate_limit_by_client_address() {
+    return [](const request& req) -> std::string_view { return req.get_remote_address(); };
+}
+
+rate_limit_key rate_limit_by_header(std::string name) {
+    return [name = std::move(name)](const request& req) {
+        return req.get_header_fields().get(name);
+    };
+}
+
+rate_limit_key rate_limit_by_route(std::string name) {
+    return [name = std::move(name)](const request&) -> std::string_view { return name; };
+}
+}  // namespace cppress::web
@@ -0,0 +1,240 @@
+#include "../includes/response_cache.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+
+namespace cppress::web {
+
+namespace {
+/// Bytes an entry is charged: its head and body, and a share for the key and bookkeeping
+std::size_t footprint(const std::string& key, const response_cache::entry& e) {
+    return e.head.size() + e.body.size() + key.size() + 128;
+}
+
+/// line starts with name followed by a colon, in any case
+bool is_field(std::string_view line, std::string_view name) {
+    if (line.size() <= name.size() || line[name.size()] != ':')
+        return false;
+    for (std::size_t i = 0; i < name.size(); ++i)
+        if (std::tolower(static_cast<unsigned char>(line[i])) != name[i])
+            return false;
+    return true;
+}
+
+bool contains_lowercase(std::string_view value, std::string_view word) {
+    std::string lower(value);
+    std::transform(lower.begin(), lower.end(), lower.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return lower.find(word) != std::string::npos;
+}
+
+/// Fresh and stale deadlines in steady_clock ticks, and the head's length, before the head
+constexpr std::size_t SHARED_HEADER = 3 * sizeof(std::int64_t);
+
+/**
+ * An entry as a shared_memory_cache holds it. steady_clock is CLOCK_MONOTONIC,
+ * the same in every process, so the deadlines mean the same in all of them.
+ */
+std::string encode(const response_cache::entry& e) {
+    const std::int64_t fields[3] = {e.fresh_until.time_since_epoch().count(),
+                                    e.stale_until.time_since_epoch().count(),
+                                    static_cast<std::int64_t>(e.head.size())};
+    std::string out;
+    out.reserve(SHARED_HEADER + e.head.size() + e.body.size());
+    out.append(reinterpret_cast<const char*>(fields), SHARED_HEADER);
+    out.append(e.head.view());
+    out.append(e.body.view());
+    return out;
+}
+}  // namespace
+
+response_cache::response_cache(std::size_t max_bytes) : max_bytes(max_bytes) {}
+
+/**
+ * Implementation Notes:
+ * - An expired entry is dropped on lookup and the key is a miss
+ * - A missing or stale key not being computed here is looked up in the
+ *   shared segment, outside the lock; a fresher entry found there is held
+ *   here too, as if this process had computed it
+ * - A stale entry is answered with; only the first request to see it stale
+ *   is asked to refresh it, the key then counts as being computed
+ */
+response_cache::lookup response_cache::find(const std::string& key, waiter wait) {
+    const auto now = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(mutex);
+    auto it = entries.find(key);
+    if (it != entries.end() && now >= it->second.value->stale_until) {
+        erase(it);
+        it = entries.end();
+    }
+    if (shared && (it == entries.end() || now >= it->second.value->fresh_until) &&
+        pending.count(key) == 0) {
+        lock.unlock();
+        auto from_segment = load_shared(key);
+        lock.lock();
+        it = entries.find(key);
+        if (from_segment && now < from_segment->stale_until &&
+            (it == entries.end() || it->second.value->fresh_until < from_segment->fresh_until))
+            it = store(key, std::move(from_segment));
+    }
+    if (it != entries.end() && now < it->second.value->stale_until) {
+        const entry& e = *it->second.value;
+        if (now < e.fresh_until) {
+            recent.splice(recent.begin(), recent, it->second.recent);
+            return {it->second.value, false};
+        }
+        recent.splice(recent.begin(), recent, it->second.recent);
+        bool fill = pending.emplace(key, std::vector<waiter>()).second;
+        return {it->second.value, fill};
+    }
+    auto [waiting, first] = pending.emplace(key, std::vector<waiter>());
+    waiting->second.push_back(std::move(wait));
+    return {nullptr, first};
+}
+
+/**
+ * Implementation Notes:
+ * - The Connection and Keep-Alive headers are dropped, each client gets
+ *   its own; everything else is kept byte for byte
+ * - Output that is not a whole HTTP/1.1 response still reaches the
+ *   waiters as nullptr, and a refresh that fails keeps the stale entry
+ * - A kept response is put in the shared segment before the lock is
+ *   taken, expiring there with its stale window
+ */
+void response_cache::complete(const std::string& key, const std::string& output,
+                              const cache_policy& policy) {
+    std::shared_ptr<entry> result;
+    bool storable = false;
+    std::size_t head_end = output.find("\r\n\r\n");
+    if (head_end != std::string::npos) {
+        std::string_view head(output.data(), head_end);
+        std::string kept;
+        kept.reserve(head.size());
+        bool has_length = false, chunked = false, private_data = false;
+        std::size_t pos = 0;
+        while (pos <= head.size()) {
+            std::size_t end = head.find("\r\n", pos);
+            if (end == std::string_view::npos)
+                end = head.size();
+            std::string_view line = head.substr(pos, end - pos);
+            pos = end + 2;
+            if (is_field(line, "connection") || is_field(line, "keep-alive"))
+                continue;
+            has_length = has_length || is_field(line, "content-length");
+            chunked = chunked || is_field(line, "transfer-encoding");
+            private_data = private_data || is_field(line, "set-cookie") ||
+                           (is_field(line, "cache-control") &&
+                            (contains_lowercase(line, "no-store") ||
+                             contains_lowercase(line, "private")));
+            if (!kept.empty())
+                kept += "\r\n";
+            kept.append(line);
+        }
+        storable = head.substr(0, 13) == "HTTP/1.1 200 " && has_length && !chunked &&
+                   !private_data;
+
+        result = std::make_shared<entry>();
+        result->head = cppress::sockets::data_buffer(std::move(kept));
+        result->body = cppress::sockets::data_buffer(output.substr(head_end + 4));
+        const auto now = std::chrono::steady_clock::now();
+        result->fresh_until = now + policy.ttl;
+        result->stale_until = result->fresh_until + policy.stale_while_revalidate;
+    }
+
+    const bool kept = storable && policy.ttl.count() > 0;
+    if (kept && shared)
+        shared->put(key, encode(*result), policy.ttl + policy.stale_while_revalidate);
+
+    std::vector<waiter> waiters;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto waiting = pending.find(key);
+        if (waiting != pending.end()) {
+            waiters = std::move(waiting->second);
+            pending.erase(waiting);
+        }
+        if (kept)
+            store(key, result);
+    }
+    for (auto& wait : waiters)
+        if (wait)
+            wait(result);
+}
+
+std::string response_cache::make_key(
+    std::string_view method, std::string_view path,
+    std::vector<std::pair<std::string_view, std::string_view>> query,
+    const std::vector<std::string>& vary) {
+    std::sort(query.begin(), query.end());
+    std::string key;
+    key.reserve(method.size() + path.size() + 64);
+    key.append(method).append(" ").append(path);
+    // fields and values cannot hold a raw line break, so it cannot be forged
+    for (const auto& [name, value] : query)
+        key.append("\n?").append(name).append("=").append(value);
+    for (const auto& value : vary)
+        key.append("\n:").append(value);
+    return key;
+}
+
+std::size_t response_cache::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return bytes;
+}
+
+void response_cache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+    recent.clear();
+    bytes = 0;
+}
+
+std::unordered_map<std::string, response_cache::slot>::iterator response_cache::store(
+    const std::string& key, std::shared_ptr<const entry> value) {
+    const std::size_t charge = footprint(key, *value);
+    auto it = entries.find(key);
+    if (it != entries.end())
+        erase(it);
+    if (charge > max_bytes)
+        return entries.end();
+    while (bytes + charge > max_bytes && !recent.empty())
+        erase(entries.find(recent.back()));
+    recent.push_front(key);
+    bytes += charge;
+    return entries.emplace(key, slot{std::move(value), recent.begin()}).first;
+}
+
+/**
+ * Implementation Notes:
+ * - The head and body point into the copy the segment handed out, which
+ *   they keep alive, so nothing is copied again
+ */
+std::shared_ptr<const response_cache::entry> response_cache::load_shared(
+    const std::string& key) const {
+    const auto value = shared->get(key);
+    if (!value || value->size() < SHARED_HEADER)
+        return nullptr;
+    std::int64_t fields[3];
+    std::memcpy(fields, value->data(), SHARED_HEADER);
+    const std::size_t head = static_cast<std::size_t>(fields[2]);
+    if (head > value->size() - SHARED_HEADER)
+        return nullptr;
+    using clock = std::chrono::steady_clock;
+    auto e = std::make_shared<entry>();
+    e->fresh_until = clock::time_point(clock::duration(fields[0]));
+    e->stale_until = clock::time_point(clock::duration(fields[1]));
+    const char* bytes = value->data() + SHARED_HEADER;
+    e->head = cppress::sockets::data_buffer(std::shared_ptr<const char>(value, bytes), head);
+    e->body = cppress::sockets::data_buffer(std::shared_ptr<const char>(value, bytes + head),
+                                            value->size() - SHARED_HEADER - head);
+    return e;
+}
+
+void response_cache::erase(std::unordered_map<std::string, slot>::iterator it) {
+    bytes -= footprint(it->first, *it->second.value);
+    recent.erase(it->second.recent);
+    entries.erase(it);
+}
+}  // namespace cppress::web
@@ -0,0 +1,305 @@
+#include "../includes/route_metrics.hpp"
+
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+
+#include "shared/includes/alloc_accounting.hpp"
+#include "shared/includes/thread_pool.hpp"
+
+namespace cppress::web {
+
+namespace {
+std::atomic<std::uint64_t> next_registry_id{1};
+
+/// The shards of this thread, by registry id
+struct shard_cache {
+    std::uint64_t last_id = 0;
+    void* last = nullptr;
+    std::unordered_map<std::uint64_t, void*> by_id;
+};
+thread_local shard_cache local_shards;
+
+std::string escape_label(std::string_view value) {
+    std::string escaped;
+    escaped.reserve(value.size());
+    for (char c : value) {
+        if (c == '\\' || c == '"')
+            escaped += '\\';
+        if (c == '\n') {
+            escaped += "\\n";
+            continue;
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+
+std::string seconds(double value) {
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.9g", value);
+    return text;
+}
+
+void write_histogram(std::string& out, const std::string& name, const std::string& labels,
+                     const latency_histogram& h) {
+    std::uint64_t cumulative = 0;
+    for (std::size_t b = 0; b + 1 < latency_histogram::BUCKETS; ++b) {
+        cumulative += h.counts[b];
+        const std::uint64_t bound = latency_histogram::upper_bound_us(b);
+        // powers of two close a bucket, so their cumulative counts are exact
+        if ((bound & (bound - 1)) != 0)
+            continue;
+        out += name + "_bucket{" + labels + ",le=\"" + seconds(bound / 1e6) + "\"} " +
+               std::to_string(cumulative) + "\n";
+    }
+    out += name + "_bucket{" + labels + ",le=\"+Inf\"} " + std::to_string(h.count) + "\n";
+    out += name + "_sum{" + labels + "} " + seconds(h.sum_ns / 1e9) + "\n";
+    out += name + "_count{" + labels + "} " + std::to_string(h.count) + "\n";
+}
+
+void write_counter(std::string& out, const char* name, const char* help, const std::string& value) {
+    out += std::string("# HELP ") + name + " " + help + "\n# TYPE " + name + " counter\n" + name +
+           " " + value + "\n";
+}
+
+void write_gauge(std::string& out, const char* name, const char* help, const std::string& value) {
+    out += std::string("# HELP ") + name + " " + help + "\n# TYPE " + name + " gauge\n" + name +
+           " " + value + "\n";
+}
+}  // namespace
+
+constexpr std::size_t latency_histogram::SUB_BUCKETS;
+constexpr std::size_t latency_histogram::OCTAVES;
+constexpr std::size_t latency_histogram::BUCKETS;
+
+/**
+ * Implementation Notes:
+ * - Below 4 us a bucket is 1 us wide; from there, the two bits below the
+ *   highest set bit of the microseconds pick one of four buckets of the octave
+ */
+std::size_t latency_histogram::bucket_of(std::uint64_t ns) noexcept {
+    const std::uint64_t us = ns / 1000;
+    if (us < SUB_BUCKETS)
+        return static_cast<std::size_t>(us);
+    const unsigned msb = 63u - static_cast<unsigned>(__builtin_clzll(us));
+    const std::size_t octave = msb - 1;
+    const std::size_t sub = static_cast<std::size_t>(us >> (msb - 2)) & (SUB_BUCKETS - 1);
+    const std::size_t bucket = octave * SUB_BUCKETS + sub;
+    return bucket < BUCKETS - 1 ? bucket : BUCKETS - 1;
+}
+
+std::uint64_t latency_histogram::upper_bound_us(std::size_t bucket) noexcept {
+    if (bucket >= BUCKETS - 1)
+        return 0;
+    const std::size_t octave = bucket / SUB_BUCKETS;
+    const std::uint64_t sub = bucket % SUB_BUCKETS;
+    if (octave == 0)
+        return sub + 1;
+    return (SUB_BUCKETS + sub + 1) << (octave - 1);
+}
+
+std::chrono::microseconds latency_histogram::quantile(double q) const noexcept {
+    if (count == 0)
+        return std::chrono::microseconds(0);
+    std::uint64_t rank = static_cast<std::uint64_t>(std::ceil(q * static_cast<double>(count)));
+    rank = rank == 0 ? 1 : (rank > count ? count : rank);
+    std::uint64_t cumulative = 0;
+    for (std::size_t b = 0; b + 1 < BUCKETS; ++b) {
+        cumulative += counts[b];
+        if (cumulative >= rank)
+            return std::chrono::microseconds(upper_bound_us(b));
+    }
+    // the open bucket: its lower bound is all that is known
+    return std::chrono::microseconds(upper_bound_us(BUCKETS - 2));
+}
+
+latency_histogram& latency_histogram::operator+=(const latency_histogram& other) noexcept {
+    for (std::size_t b = 0; b < BUCKETS; ++b)
+        counts[b] += other.counts[b];
+    count += other.count;
+    sum_ns += other.sum_ns;
+    return *this;
+}
+
+route_metrics::series& route_metrics::series::operator+=(const series& other) noexcept {
+    requests += other.requests;
+    queue_wait += other.queue_wait;
+    handler += other.handler;
+    total += other.total;
+    return *this;
+}
+
+route_metrics::route_metrics() : id(next_registry_id.fetch_add(1)) {}
+
+route_metrics::shard& route_metrics::local_shard() {
+    if (local_shards.last_id == id)
+        return *static_cast<shard*>(local_shards.last);
+    void*& found = local_shards.by_id[id];
+    if (!found) {
+        std::lock_guard<std::mutex> lock(shards_mutex);
+        shards.push_back(std::make_unique<shard>());
+        found = shards.back().get();
+    }
+    local_shards.last_id = id;
+    local_shards.last = found;
+    return *static_cast<shard*>(found);
+}
+
+/**
+ * Implementation Notes:
+ * - The shard's lock is only ever contended by a scrape
+ * - The key is built in a per-thread buffer, so a known series allocates nothing
+ */
+void route_metrics::observe(std::string_view method, std::string_view route,
+                            std::chrono::nanoseconds queue_wait, std::chrono::nanoseconds handler,
+                            std::chrono::nanoseconds total) {
+    thread_local std::string key;
+    key.assign(method).append(" ").append(route);
+    auto to_ns = [](std::chrono::nanoseconds d) {
+        return static_cast<std::uint64_t>(d.count() < 0 ? 0 : d.count());
+    };
+
+    shard& local = local_shard();
+    std::lock_guard<std::mutex> lock(local.mutex);
+    auto it = local.series_by_key.find(key);
+    if (it == local.series_by_key.end())
+        it = local.series_by_key.emplace(key, series()).first;
+    series& s = it->second;
+    ++s.requests;
+    s.queue_wait.record(to_ns(queue_wait));
+    s.handler.record(to_ns(handler));
+    s.total.record(to_ns(total));
+}
+
+route_metrics::snapshot_t route_metrics::snapshot() const {
+    snapshot_t merged;
+    std::lock_guard<std::mutex> lock(shards_mutex);
+    for (const auto& s : shards) {
+        std::lock_guard<std::mutex> shard_lock(s->mutex);
+        for (const auto& [key, recorded] : s->series_by_key) {
+            // methods hold no space, the route may
+            const std::size_t split = key.find(' ');
+            merged[{key.substr(0, split), key.substr(split + 1)}] += recorded;
+        }
+    }
+    return merged;
+}
+
+std::string route_metrics::prometheus(const cppress::sockets::loop_stats& loops,
+                                      const cppress::shared::pool_stats* workers) const {
+    const snapshot_t all = snapshot();
+    std::string out;
+    out.reserve(1024 + all.size() * 12 * 1024);
+
+    out += "# HELP cppress_http_requests_total Requests handled, by method and route\n"
+           "# TYPE cppress_http_requests_total counter\n";
+    for (const auto& [key, s] : all)
+        out += "cppress_http_requests_total{method=\"" + escape_label(key.first) +
+               "\",route=\"" + escape_label(key.second) + "\"} " + std::to_string(s.requests) +
+               "\n";
+
+    struct histogram_family {
+        const char* name;
+        const char* help;
+        latency_histogram series::*member;
+    };
+    const histogram_family families[] = {
+        {"cppress_http_queue_wait_seconds", "Time requests waited for a worker",
+         &series::queue_wait},
+        {"cppress_http_handler_seconds", "Time in middleware and handlers", &series::handler},
+        {"cppress_http_request_duration_seconds",
+         "Time from the request being parsed to its handlers returning", &series::total}};
+    for (const auto& family : families) {
+        out += std::string("# HELP ") + family.name + " " + family.help + "\n# TYPE " +
+               family.name + " histogram\n";
+        for (const auto& [key, s] : all)
+            write_histogram(out, family.name,
+                            "method=\"" + escape_label(key.first) + "\",route=\"" +
+                                escape_label(key.second) + "\"",
+                            s.*(family.member));
+    }
+
+    write_counter(out, "cppress_loop_wakeups_total", "Returns from the event loop wait",
+                  std::to_string(loops.wakeups));
+    write_counter(out, "cppress_loop_events_total", "Events handled by the event loops",
+                  std::to_string(loops.events));
+    write_counter(out, "cppress_loop_wait_seconds_total", "Time the event loops spent waiting",
+                  seconds(loops.wait_ns / 1e9));
+    write_counter(out, "cppress_loop_handler_seconds_total",
+                  "Time the event loops spent handling events", seconds(loops.handler_ns / 1e9));
+    write_counter(out, "cppress_loop_read_bytes_total", "Bytes received from connections",
+                  std::to_string(loops.bytes_read));
+    write_counter(out, "cppress_loop_written_bytes_total", "Bytes written to connections",
+                  std::to_string(loops.bytes_written));
+    write_counter(out, "cppress_loop_send_eagain_total", "Flushes stopped by a full socket buffer",
+                  std::to_string(loops.send_eagain));
+    write_counter(out, "cppress_loop_accepts_total", "Connections accepted",
+                  std::to_string(loops.accepts));
+    write_counter(out, "cppress_loop_accept_failures_total", "Failed accept() calls",
+                  std::to_string(loops.accept_failures));
+    write_counter(out, "cppress_loop_events_resizes_total", "Growths of the epoll event buffer",
+                  std::to_string(loops.events_resizes));
+
+    out += "# HELP cppress_loop_flushes_total Flushes, by the bytes queued on the connection "
+           "when they started\n# TYPE cppress_loop_flushes_total counter\n";
+    const auto& bounds = cppress::sockets::loop_stats::outq_depth_bounds;
+    for (std::size_t i = 0; i < loops.outq_depth.size(); ++i) {
+        const std::string below = i < bounds.size() ? std::to_string(bounds[i]) : "+Inf";
+        out += "cppress_loop_flushes_total{queued_below=\"" + below + "\"} " +
+               std::to_string(loops.outq_depth[i]) + "\n";
+    }
+
+    if (workers) {
+        write_gauge(out, "cppress_workers", "Workers taking requests",
+                    std::to_string(workers->threads));
+        write_gauge(out, "cppress_workers_min", "Fewest workers the pool shrinks to",
+                    std::to_string(workers->min_threads));
+        write_gauge(out, "cppress_workers_max", "Most workers the pool grows to",
+                    std::to_string(workers->max_threads));
+        write_counter(out, "cppress_workers_grown_total", "Times the worker pool grew",
+                      std::to_string(workers->grown));
+        write_counter(out, "cppress_workers_shrunk_total", "Times the worker pool shrank",
+                      std::to_string(workers->shrunk));
+        write_gauge(out, "cppress_workers_queue_wait_seconds",
+                    "Estimated wait for a worker at the last sizing decision",
+                    seconds(workers->queue_wait.count() / 1e6));
+        write_gauge(out, "cppress_workers_utilization",
+                    "Share of time workers ran requests at the last sizing decision",
+                    seconds(workers->utilization));
+        write_gauge(out, "cppress_workers_cpu",
+                    "Share of all cores the process used at the last sizing decision",
+                    seconds(workers->cpu));
+    }
+
+    if (cppress::shared::alloc_accounting) {
+        const auto usage = cppress::shared::allocation_snapshot();
+        write_counter(out, "cppress_accounted_requests_total",
+                      "Requests parsed since allocations are counted",
+                      std::to_string(usage.requests));
+        struct usage_family {
+            const char* name;
+            const char* help;
+            std::uint64_t cppress::shared::phase_usage::*member;
+        };
+        const usage_family usages[] = {
+            {"cppress_request_phase_allocations_total", "Heap allocations, by request phase",
+             &cppress::shared::phase_usage::allocations},
+            {"cppress_request_phase_allocated_bytes_total", "Bytes allocated, by request phase",
+             &cppress::shared::phase_usage::allocated_bytes},
+            {"cppress_request_phase_copies_total", "Buffer copies, by request phase",
+             &cppress::shared::phase_usage::copies},
+            {"cppress_request_phase_copied_bytes_total", "Bytes copied, by request phase",
+             &cppress::shared::phase_usage::copied_bytes}};
+        for (const auto& family : usages) {
+            out += std::string("# HELP ") + family.name + " " + family.help + "\n# TYPE " +
+                   family.name + " counter\n";
+            for (std::size_t p = 0; p < cppress::shared::REQUEST_PHASES; ++p)
+                out += std::string(family.name) + "{phase=\"" +
+                       cppress::shared::phase_name(static_cast<cppress::shared::request_phase>(p)) +
+                       "\"} " + std::to_string(usage.phases[p].*(family.member)) + "\n";
+        }
+    }
+    return out;
+}
+}  // namespace cppress::web
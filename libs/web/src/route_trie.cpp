@@ -0,0 +1,219 @@
+#include "../includes/route_trie.hpp"
+
+#include <algorithm>
+
+#include "shared/includes/utils.hpp"
+
+namespace cppress::web {
+
+namespace {
+/**
+ * Splits a path into segments the way match_path() normalizes it: leading
+ * and trailing slashes are dropped, "/" alone is one empty segment
+ */
+void split_segments(std::string_view s, std::vector<std::string_view>& out) {
+    if (s.empty())
+        return;
+    if (s == "/") {
+        out.push_back(s.substr(0, 0));
+        return;
+    }
+    std::size_t start = 0, end = s.size();
+    while (start < end && s[start] == '/')
+        ++start;
+    while (end > start + 1 && s[end - 1] == '/')
+        --end;
+    if (start >= end)
+        return;
+    s = s.substr(start, end - start);
+    for (std::size_t pos = 0;;) {
+        std::size_t next = s.find('/', pos);
+        if (next == std::string_view::npos) {
+            out.push_back(s.substr(pos));
+            return;
+        }
+        out.push_back(s.substr(pos, next - pos));
+        pos = next + 1;
+    }
+}
+}  // namespace
+
+struct route_trie::node {
+    /// Children for literal segments
+    std::map<std::string, std::unique_ptr<node>, std::less<>> statics;
+
+    /// Child for a ":param" segment, whatever the parameter's name
+    std::unique_ptr<node> param;
+
+    /// Route whose expression ends here
+    std::size_t route = NONE;
+
+    /// Route with "*" here, matches when at least one segment is left
+    std::size_t wildcard = NONE;
+
+    /// Route ending in "*" here, also matches when no segment is left
+    std::size_t wildcard_end = NONE;
+
+    /// Lowest route index in this subtree, bounds the search
+    std::size_t min_index = NONE;
+};
+
+struct route_trie::method_routes {
+    node root;
+
+    /// Expressions equal to the whole path match without parameters, as in match_path()
+    std::map<std::string, std::size_t, std::less<>> exact;
+};
+
+/// Depth-first walk keeping the lowest route index that matches
+struct route_trie::search {
+    const std::vector<std::string_view>& segments;
+    std::vector<std::string_view>& captures;
+    std::vector<std::string_view>& best_captures;
+
+    std::size_t best = NONE;
+    bool best_wildcard = false;
+    std::string_view best_rest;
+
+    search(const std::vector<std::string_view>& segments, std::vector<std::string_view>& captures,
+           std::vector<std::string_view>& best_captures)
+        : segments(segments), captures(captures), best_captures(best_captures) {}
+
+    void take(std::size_t index, bool wildcard, std::string_view rest) {
+        best = index;
+        best_captures.assign(captures.begin(), captures.end());
+        best_wildcard = wildcard;
+        best_rest = rest;
+    }
+
+    void walk(const node& n, std::size_t i) {
+        if (n.min_index >= best)
+            return;
+        if (i == segments.size()) {
+            if (n.route < best)
+                take(n.route, false, {});
+            if (n.wildcard_end < best)
+                take(n.wildcard_end, true, {});
+            return;
+        }
+        if (n.wildcard < best) {
+            // the segments are views of one string, the rest runs to the end of the last
+            const char* from = segments[i].data();
+            const char* to = segments.back().data() + segments.back().size();
+            take(n.wildcard, true, std::string_view(from, static_cast<std::size_t>(to - from)));
+        }
+        auto it = n.statics.find(segments[i]);
+        if (it != n.statics.end())
+            walk(*it->second, i + 1);
+        if (n.param) {
+            captures.push_back(segments[i]);
+            walk(*n.param, i + 1);
+            captures.pop_back();
+        }
+    }
+};
+
+route_trie::route_trie() = default;
+route_trie::~route_trie() = default;
+route_trie::route_trie(route_trie&&) noexcept = default;
+route_trie& route_trie::operator=(route_trie&&) noexcept = default;
+
+/**
+ * Implementation Notes:
+ * - Segments after a "*" are never compared: match_path() accepts once it
+ *   reaches the wildcard, so they are dropped here too
+ */
+void route_trie::insert(const std::string& method, const std::string& expression,
+                        std::size_t index) {
+    auto& routes = methods_[method];
+    if (!routes)
+        routes = std::make_unique<method_routes>();
+    auto exact = routes->exact.emplace(expression, index).first;
+    exact->second = std::min(exact->second, index);
+
+    if (param_names_.size() <= index)
+        param_names_.resize(index + 1);
+    auto& names = param_names_[index];
+    names.clear();
+
+    std::vector<std::string_view> segments;
+    split_segments(expression, segments);
+    node* n = &routes->root;
+    for (std::size_t i = 0; i < segments.size(); ++i) {
+        n->min_index = std::min(n->min_index, index);
+        std::string_view segment = segments[i];
+        if (segment == "*") {
+            n->wildcard = std::min(n->wildcard, index);
+            if (i + 1 == segments.size())
+                n->wildcard_end = std::min(n->wildcard_end, index);
+            return;
+        }
+        std::unique_ptr<node>* child;
+        if (!segment.empty() && segment[0] == ':') {
+            names.emplace_back(segment.substr(1));
+            child = &n->param;
+        } else {
+            auto it = n->statics.find(segment);
+            if (it == n->statics.end())
+                it = n->statics.emplace(std::string(segment), nullptr).first;
+            child = &it->second;
+        }
+        if (!*child)
+            *child = std::make_unique<node>();
+        n = child->get();
+    }
+    n->min_index = std::min(n->min_index, index);
+    n->route = std::min(n->route, index);
+}
+
+/**
+ * Implementation Notes:
+ * - The segment and capture vectors are per thread and reused, so once they
+ *   have grown to the longest path seen a lookup does not allocate
+ */
+std::size_t route_trie::find(const std::string& method, std::string_view path,
+                             path_captures& captures) const {
+    captures.clear();
+    auto routes = methods_.find(method);
+    if (routes == methods_.end())
+        return NONE;
+
+    thread_local std::vector<std::string_view> segments, walked, best_captures;
+    segments.clear();
+    walked.clear();
+    best_captures.clear();
+    split_segments(path, segments);
+    search walk(segments, walked, best_captures);
+
+    auto exact = routes->second->exact.find(path);
+    if (exact != routes->second->exact.end())
+        walk.best = exact->second;
+    std::size_t exact_index = walk.best;
+    walk.walk(routes->second->root, 0);
+    if (walk.best == NONE || walk.best == exact_index)
+        return walk.best;
+
+    const auto& names = param_names_[walk.best];
+    for (std::size_t i = 0; i < names.size() && i < best_captures.size(); ++i)
+        captures.push_back({names[i], best_captures[i]});
+    if (walk.best_wildcard && !walk.best_rest.empty())
+        captures.push_back({"*", walk.best_rest});
+    return walk.best;
+}
+
+std::size_t route_trie::find(const std::string& method, std::string_view path,
+                             std::map<std::string, std::string>& params) const {
+    path_captures captures;
+    std::size_t index = find(method, path, captures);
+    for (std::size_t i = 0; i < captures.size(); ++i)
+        params.emplace(std::string(captures[i].name),
+                       shared::url_decode(captures[i].value));
+    return index;
+}
+
+void route_trie::clear() {
+    methods_.clear();
+    param_names_.clear();
+}
+
+}  // namespace cppress::web
@@ -0,0 +1,128 @@
+#include "../includes/static_file_cache.hpp"
+
+#include <fstream>
+#include <system_error>
+
+#include "http/includes.hpp"
+#include "shared/includes/utils.hpp"
+
+namespace cppress::web {
+
+namespace {
+/// Bytes an entry is charged: its content, and a share for the metadata
+std::size_t footprint(const static_file_cache::file& f) {
+    return f.content.size() + f.path.size() + f.etag.size() + 256;
+}
+
+bool read_whole(const std::string& path, std::uintmax_t size, std::string& out) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        return false;
+    out.resize(static_cast<std::size_t>(size));
+    in.read(out.data(), static_cast<std::streamsize>(size));
+    // a file that grew or shrank while being read is not trusted
+    return in.gcount() == static_cast<std::streamsize>(size) &&
+           in.peek() == std::ifstream::traits_type::eof();
+}
+}  // namespace
+
+static_file_cache::static_file_cache(const static_cache_options& options) : options(options) {}
+
+std::size_t static_file_cache::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return bytes;
+}
+
+void static_file_cache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+    recent.clear();
+    bytes = 0;
+}
+
+/**
+ * Implementation Notes:
+ * - The file system is touched outside the lock; two requests revalidating
+ *   the same entry at once both stat it, and the later result is kept
+ * - A revalidation that finds the file unchanged keeps the cached content,
+ *   so the file is read only when it is new or changed
+ */
+std::shared_ptr<const static_file_cache::file> static_file_cache::find(
+    const std::string& sanitized_path, const std::vector<std::string>& directories) {
+    const auto now = std::chrono::steady_clock::now();
+    std::shared_ptr<const file> previous;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(sanitized_path);
+        if (it != entries.end()) {
+            if (now - it->second.checked < options.revalidate_interval) {
+                recent.splice(recent.begin(), recent, it->second.recent);
+                return it->second.value;
+            }
+            previous = it->second.value;
+        }
+    }
+
+    auto loaded = load(sanitized_path, directories, previous);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(sanitized_path);
+    if (it != entries.end())
+        erase(it);
+    if (!loaded)
+        return nullptr;
+
+    const std::size_t charge = footprint(*loaded);
+    if (charge > options.max_bytes)
+        return loaded;
+    while (bytes + charge > options.max_bytes && !recent.empty())
+        erase(entries.find(recent.back()));
+    recent.push_front(sanitized_path);
+    entries.emplace(sanitized_path, entry{loaded, now, recent.begin()});
+    bytes += charge;
+    return loaded;
+}
+
+std::shared_ptr<const static_file_cache::file> static_file_cache::load(
+    const std::string& sanitized_path, const std::vector<std::string>& directories,
+    const std::shared_ptr<const file>& previous) const {
+    for (const auto& dir : directories) {
+        std::string path = dir + sanitized_path;
+        std::string etag, last_modified;
+        // a stat that also rules out directories and other non-regular files
+        if (!cppress::http::file_validators(path, etag, last_modified))
+            continue;
+        std::error_code ec;
+        auto modified = std::filesystem::last_write_time(path, ec);
+        if (ec)
+            continue;
+        std::uintmax_t size = std::filesystem::file_size(path, ec);
+        if (ec)
+            continue;
+
+        if (previous && previous->path == path && previous->modified == modified &&
+            previous->size == size)
+            return previous;
+
+        auto f = std::make_shared<file>();
+        f->path = std::move(path);
+        f->content_type = shared::get_mime_type_from_extension(
+            shared::get_file_extension_from_uri(sanitized_path));
+        f->etag = std::move(etag);
+        f->last_modified = std::move(last_modified);
+        f->modified = modified;
+        f->size = size;
+        std::string content;
+        if (size > 0 && size <= options.max_file_size && read_whole(f->path, size, content))
+            f->content = cppress::sockets::data_buffer(std::move(content));
+        return f;
+    }
+    return nullptr;
+}
+
+void static_file_cache::erase(std::unordered_map<std::string, entry>::iterator it) {
+    bytes -= footprint(*it->second.value);
+    recent.erase(it->second.recent);
+    entries.erase(it);
+}
+}  // namespace cppress::web
@@ -0,0 +1,223 @@
+#include "../includes/static_manifest.hpp"
+
+#include <stdexcept>
+#include <system_error>
+
+#include "../includes/utilities.hpp"
+#include "http/includes.hpp"
+#include "shared/includes/utils.hpp"
+
+namespace cppress::web {
+
+static_manifest::static_manifest(std::chrono::milliseconds refresh_interval)
+    : refresh_interval(refresh_interval), current(std::make_shared<const snapshot>()) {}
+
+void static_manifest::add_directory(const std::string& directory) {
+    std::lock_guard<std::mutex> lock(mutex);
+    roots.push_back(directory);
+    std::atomic_store(&current, build());
+}
+
+void static_manifest::rebuild() {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::atomic_store(&current, build());
+}
+
+std::shared_ptr<const static_manifest::asset> static_manifest::find(
+    const std::string& sanitized_path) {
+    refresh_if_due();
+    auto files = std::atomic_load(&current);
+    auto it = files->files.find(sanitized_path);
+    return it == files->files.end() ? nullptr : it->second;
+}
+
+std::size_t static_manifest::size() const { return std::atomic_load(&current)->files.size(); }
+
+/**
+ * Implementation Notes:
+ * - Adding, removing or renaming an entry updates its directory's
+ *   modification time, so comparing the directories' times is enough to
+ *   know the listing is stale; rewriting a file in place is not, and
+ *   needs no rebuild
+ * - The check is a stat per directory, once per interval, by whichever
+ *   request claims it first
+ */
+void static_manifest::refresh_if_due() {
+    const std::int64_t now = std::chrono::steady_clock::now().time_since_epoch().count();
+    std::int64_t due = next_check.load(std::memory_order_relaxed);
+    if (now < due)
+        return;
+    const std::int64_t next =
+        now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(refresh_interval)
+                  .count();
+    if (!next_check.compare_exchange_strong(due, next, std::memory_order_relaxed))
+        return;
+
+    std::unique_lock<std::mutex> lock(mutex, std::try_to_lock);
+    if (!lock.owns_lock())
+        return;
+    auto files = std::atomic_load(&current);
+    for (const auto& [directory, modified] : files->directories) {
+        std::error_code ec;
+        if (std::filesystem::last_write_time(directory, ec) != modified || ec) {
+            std::atomic_store(&current, build());
+            return;
+        }
+    }
+}
+
+std::shared_ptr<const static_manifest::snapshot> static_manifest::build() const {
+    std::vector<listing> listings;
+    for (const auto& root : roots)
+        listings.push_back(walk(root));
+    return merge(std::move(listings));
+}
+
+/**
+ * Implementation Notes:
+ * - Only files whose extension is_uri_static() accepts are listed, the
+ *   others were never served as static files
+ * - Unreadable subdirectories are skipped rather than failing the walk; a
+ *   root that cannot be stat'ed gives an empty listing with no directories
+ */
+static_manifest::listing static_manifest::walk(const std::string& root) {
+    namespace fs = std::filesystem;
+    listing walked{root, {}, {}};
+    std::error_code ec;
+    auto modified = fs::last_write_time(root, ec);
+    if (ec)
+        return walked;
+    walked.directories.emplace_back(root, modified);
+
+    fs::recursive_directory_iterator it(root, fs::directory_options::skip_permission_denied, ec);
+    for (; !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+        std::error_code entry_ec;
+        if (it->is_directory(entry_ec)) {
+            auto dir_modified = fs::last_write_time(it->path(), entry_ec);
+            if (!entry_ec)
+                walked.directories.emplace_back(it->path().string(), dir_modified);
+            continue;
+        }
+        if (!it->is_regular_file(entry_ec))
+            continue;
+        std::string url = "/" + it->path().lexically_relative(root).generic_string();
+        if (!is_uri_static(url))
+            continue;
+
+        auto file = std::make_shared<asset>();
+        file->path = it->path().string();
+        std::string last_modified;
+        if (!cppress::http::file_validators(file->path, file->etag, last_modified))
+            continue;
+        file->content_type =
+            shared::get_mime_type_from_extension(shared::get_file_extension_from_uri(url));
+        file->size = it->file_size(entry_ec);
+        walked.files.emplace_back(std::move(url), std::move(file));
+    }
+    return walked;
+}
+
+/**
+ * Implementation Notes:
+ * - A path listed under several roots keeps the earliest root's file, as
+ *   the earliest directory is searched first when serving
+ */
+std::shared_ptr<const static_manifest::snapshot> static_manifest::merge(
+    std::vector<listing> listings) {
+    auto merged = std::make_shared<snapshot>();
+    for (const auto& l : listings) {
+        for (const auto& [url, file] : l.files)
+            merged->files.emplace(url, file);
+        merged->directories.insert(merged->directories.end(), l.directories.begin(),
+                                   l.directories.end());
+    }
+    merged->listings = std::move(listings);
+    return merged;
+}
+
+std::string static_manifest::section_name(const std::string& directory) {
+    return "static_manifest:" + directory;
+}
+
+/**
+ * Implementation Notes:
+ * - The section's sources are the directories with the times recorded by
+ *   the walk, not their times now: a file added since then makes the
+ *   section stale as it made the index stale
+ */
+void static_manifest::save_directory(const std::string& directory,
+                                     shared::snapshot_writer& out) const {
+    auto files = std::atomic_load(&current);
+    for (const auto& l : files->listings) {
+        if (l.root != directory)
+            continue;
+        shared::snapshot_encoder bytes;
+        bytes.string(l.root);
+        bytes.u64(l.files.size());
+        for (const auto& [url, file] : l.files) {
+            bytes.string(url);
+            bytes.string(file->path);
+            bytes.string(file->content_type);
+            bytes.string(file->etag);
+            bytes.u64(file->size);
+        }
+        std::vector<shared::snapshot_source> sources;
+        bytes.u64(l.directories.size());
+        for (const auto& [path, modified] : l.directories) {
+            const auto ticks = static_cast<std::int64_t>(modified.time_since_epoch().count());
+            bytes.string(path);
+            bytes.u64(static_cast<std::uint64_t>(ticks));
+            sources.push_back({path, ticks, 0});
+        }
+        out.add(section_name(directory), bytes.take(), std::move(sources));
+        return;
+    }
+    throw std::invalid_argument("Directory not in the static manifest: " + directory);
+}
+
+/**
+ * Implementation Notes:
+ * - A listing saved with no directories is refused: its root could not
+ *   be stat'ed, and walking it again costs nothing
+ */
+bool static_manifest::load_directory(const std::string& directory,
+                                     const shared::startup_snapshot& in) {
+    const auto bytes = in.section(section_name(directory));
+    if (!bytes)
+        return false;
+
+    listing loaded{directory, {}, {}};
+    try {
+        shared::snapshot_decoder decoder(*bytes);
+        if (decoder.string() != directory)
+            return false;
+        loaded.files.resize(decoder.count(5 * 8));
+        for (auto& [url, file] : loaded.files) {
+            url = std::string(decoder.string());
+            auto listed = std::make_shared<asset>();
+            listed->path = std::string(decoder.string());
+            listed->content_type = std::string(decoder.string());
+            listed->etag = std::string(decoder.string());
+            listed->size = decoder.u64();
+            file = std::move(listed);
+        }
+        loaded.directories.resize(decoder.count(2 * 8));
+        for (auto& [path, modified] : loaded.directories) {
+            path = std::string(decoder.string());
+            modified = std::filesystem::file_time_type(std::filesystem::file_time_type::duration(
+                static_cast<std::int64_t>(decoder.u64())));
+        }
+        if (!decoder.done() || loaded.directories.empty())
+            return false;
+    } catch (const std::runtime_error&) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    roots.push_back(directory);
+    std::vector<listing> listings = std::atomic_load(&current)->listings;
+    listings.push_back(std::move(loaded));
+    std::atomic_store(&current, merge(std::move(listings)));
+    return true;
+}
+}  // namespace cppress::web
@@ -0,0 +1,334 @@
+#include "../includes/tracing.hpp"
+
+#include <random>
+#include <unordered_map>
+
+namespace cppress::web {
+
+namespace {
+std::atomic<std::uint64_t> next_tracer_id{1};
+
+/// The rings of this thread, by tracer id
+struct ring_cache {
+    std::uint64_t last_id = 0;
+    void* last = nullptr;
+    std::unordered_map<std::uint64_t, void*> by_id;
+};
+thread_local ring_cache local_rings;
+
+/// splitmix64 over a per-thread state seeded once
+std::uint64_t random64() noexcept {
+    thread_local std::uint64_t state = [] {
+        std::random_device device;
+        return (static_cast<std::uint64_t>(device()) << 32) ^ device() ^
+               reinterpret_cast<std::uintptr_t>(&state);
+    }();
+    std::uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+template <std::size_t N>
+void fill_random(std::array<std::uint8_t, N>& bytes) noexcept {
+    for (std::size_t i = 0; i < N; i += 8) {
+        std::uint64_t r = random64();
+        for (std::size_t j = 0; j < 8 && i + j < N; ++j, r >>= 8)
+            bytes[i + j] = static_cast<std::uint8_t>(r);
+    }
+}
+
+template <std::size_t N>
+bool all_zero(const std::array<std::uint8_t, N>& bytes) noexcept {
+    for (auto b : bytes)
+        if (b != 0)
+            return false;
+    return true;
+}
+
+/// lowercase hex only, as the specification requires
+int hex_value(char c) noexcept {
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    return -1;
+}
+
+template <std::size_t N>
+bool parse_hex(std::string_view text, std::array<std::uint8_t, N>& out) noexcept {
+    if (text.size() != N * 2)
+        return false;
+    for (std::size_t i = 0; i < N; ++i) {
+        int high = hex_value(text[2 * i]), low = hex_value(text[2 * i + 1]);
+        if (high < 0 || low < 0)
+            return false;
+        out[i] = static_cast<std::uint8_t>(high << 4 | low);
+    }
+    return true;
+}
+
+template <std::size_t N>
+void append_hex(std::string& out, const std::array<std::uint8_t, N>& bytes) {
+    static const char digits[] = "0123456789abcdef";
+    for (auto b : bytes) {
+        out += digits[b >> 4];
+        out += digits[b & 0xf];
+    }
+}
+
+/// Name of the span from a point to the next one reached
+const char* phase_name(std::size_t point) noexcept {
+    static const char* const names[] = {"parse", "queue", "middleware", "handler", "send"};
+    return point < sizeof(names) / sizeof(names[0]) ? names[point] : "";
+}
+}  // namespace
+
+bool trace_context::valid() const noexcept {
+    return !all_zero(trace_id) && !all_zero(span_id);
+}
+
+/**
+ * Implementation Notes:
+ * - version-traceid-parentid-flags; versions above 00 may append fields,
+ *   version ff is invalid
+ * - An all-zero trace or parent id is invalid
+ */
+bool trace_context::parse(std::string_view header, trace_context& out) noexcept {
+    while (!header.empty() && (header.front() == ' ' || header.front() == '\t'))
+        header.remove_prefix(1);
+    while (!header.empty() && (header.back() == ' ' || header.back() == '\t'))
+        header.remove_suffix(1);
+    if (header.size() < 55 || header[2] != '-' || header[35] != '-' || header[52] != '-')
+        return false;
+    std::array<std::uint8_t, 1> version{}, flags{};
+    trace_context parsed;
+    if (!parse_hex(header.substr(0, 2), version) || version[0] == 0xff ||
+        !parse_hex(header.substr(3, 32), parsed.trace_id) ||
+        !parse_hex(header.substr(36, 16), parsed.span_id) ||
+        !parse_hex(header.substr(53, 2), flags))
+        return false;
+    if (header.size() > 55 && (version[0] == 0 || header[55] != '-'))
+        return false;
+    if (!parsed.valid())
+        return false;
+    parsed.sampled = (flags[0] & 0x01) != 0;
+    out = parsed;
+    return true;
+}
+
+std::string trace_context::traceparent() const {
+    if (!valid())
+        return std::string();
+    std::string header;
+    header.reserve(55);
+    header += "00-";
+    append_hex(header, trace_id);
+    header += '-';
+    append_hex(header, span_id);
+    header += sampled ? "-01" : "-00";
+    return header;
+}
+
+trace_context trace_context::child() const noexcept {
+    trace_context next = *this;
+    do
+        fill_random(next.span_id);
+    while (all_zero(next.span_id));
+    return next;
+}
+
+trace_context trace_context::make_root(bool sampled) noexcept {
+    trace_context root;
+    do
+        fill_random(root.trace_id);
+    while (all_zero(root.trace_id));
+    root.sampled = sampled;
+    return root.child();
+}
+
+upstream_span::upstream_span(std::shared_ptr<tracer> owner, trace_context context,
+                             std::array<std::uint8_t, 8> parent_id, std::string name)
+    : owner(std::move(owner)),
+      context(context),
+      parent_id(parent_id),
+      name(std::move(name)),
+      start(std::chrono::steady_clock::now()) {}
+
+upstream_span::upstream_span(upstream_span&& other) noexcept
+    : owner(std::move(other.owner)),
+      context(other.context),
+      parent_id(other.parent_id),
+      name(std::move(other.name)),
+      start(other.start) {}
+
+upstream_span& upstream_span::operator=(upstream_span&& other) noexcept {
+    if (this != &other) {
+        end();
+        owner = std::move(other.owner);
+        context = other.context;
+        parent_id = other.parent_id;
+        name = std::move(other.name);
+        start = other.start;
+    }
+    return *this;
+}
+
+upstream_span::~upstream_span() {
+    end();
+}
+
+void upstream_span::end() {
+    if (!owner)
+        return;
+    trace_span span;
+    span.trace_id = context.trace_id;
+    span.span_id = context.span_id;
+    span.parent_id = parent_id;
+    span.name = std::move(name);
+    span.start = owner->wall_time(start);
+    span.end = owner->wall_time(std::chrono::steady_clock::now());
+    auto recorder = std::move(owner);
+    recorder->record(std::move(span));
+}
+
+/**
+ * Single producer, single consumer: the owning thread pushes, flush() pops.
+ * head and tail only grow; slot i is i modulo the capacity.
+ */
+struct tracer::ring {
+    explicit ring(std::size_t capacity) : slots(capacity) {}
+
+    std::vector<trace_span> slots;
+    alignas(64) std::atomic<std::size_t> head{0};
+    alignas(64) std::atomic<std::size_t> tail{0};
+};
+
+tracer::tracer(trace_sink sink, const tracing_options& options)
+    : sink(std::move(sink)),
+      settings(options),
+      steady_origin(std::chrono::steady_clock::now()),
+      wall_origin(std::chrono::system_clock::now()),
+      id(next_tracer_id.fetch_add(1)) {
+    if (settings.ring_capacity == 0)
+        settings.ring_capacity = 1;
+    const double rate = settings.sample_rate < 0 ? 0 : settings.sample_rate;
+    sample_below = rate >= 1.0 ? UINT64_MAX
+                               : static_cast<std::uint64_t>(rate * 18446744073709551616.0);
+}
+
+tracer::~tracer() = default;
+
+tracer::ring& tracer::local_ring() {
+    if (local_rings.last_id == id)
+        return *static_cast<ring*>(local_rings.last);
+    void*& found = local_rings.by_id[id];
+    if (!found) {
+        std::lock_guard<std::mutex> lock(rings_mutex);
+        rings.push_back(std::make_unique<ring>(settings.ring_capacity));
+        found = rings.back().get();
+    }
+    local_rings.last_id = id;
+    local_rings.last = found;
+    return *static_cast<ring*>(found);
+}
+
+/**
+ * Implementation Notes:
+ * - A valid incoming context decides for the request (parent-based sampling),
+ *   and the request's span becomes its child
+ * - Otherwise a random number against sample_below; ids are only drawn for
+ *   the requests that are traced
+ */
+std::unique_ptr<request_trace> tracer::start(std::string_view traceparent) {
+    trace_context incoming;
+    const bool joined = !traceparent.empty() && trace_context::parse(traceparent, incoming);
+    if (joined ? !incoming.sampled : random64() >= sample_below)
+        return nullptr;
+    auto trace = std::make_unique<request_trace>();
+    trace->owner = shared_from_this();
+    if (joined) {
+        trace->context = incoming.child();
+        trace->parent_id = incoming.span_id;
+    } else {
+        trace->context = trace_context::make_root(true);
+    }
+    return trace;
+}
+
+/**
+ * Implementation Notes:
+ * - The request's span runs from its first stamp to its last; each stamp
+ *   opens the phase named after it, up to the next stamp reached
+ */
+void tracer::finish(const request_trace& trace) {
+    constexpr std::size_t points = static_cast<std::size_t>(trace_point::count);
+    const std::chrono::steady_clock::time_point unset{};
+    std::size_t first = points, last = points;
+    for (std::size_t i = 0; i < points; ++i) {
+        if (trace.marks[i] == unset)
+            continue;
+        if (first == points)
+            first = i;
+        last = i;
+    }
+    if (first == points)
+        return;
+
+    trace_span root;
+    root.trace_id = trace.context.trace_id;
+    root.span_id = trace.context.span_id;
+    root.parent_id = trace.parent_id;
+    root.name = trace.name;
+    root.start = wall_time(trace.marks[first]);
+    root.end = wall_time(trace.marks[last]);
+
+    for (std::size_t i = first; i < last;) {
+        std::size_t next = i + 1;
+        while (trace.marks[next] == unset)
+            ++next;
+        trace_span phase;
+        phase.trace_id = root.trace_id;
+        phase.parent_id = root.span_id;
+        phase.span_id = trace.context.child().span_id;
+        phase.name = phase_name(i);
+        phase.start = wall_time(trace.marks[i]);
+        phase.end = wall_time(trace.marks[next]);
+        record(std::move(phase));
+        i = next;
+    }
+    record(std::move(root));
+}
+
+void tracer::record(trace_span&& span) {
+    ring& local = local_ring();
+    const std::size_t head = local.head.load(std::memory_order_relaxed);
+    if (head - local.tail.load(std::memory_order_acquire) >= local.slots.size()) {
+        dropped_spans.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    local.slots[head % local.slots.size()] = std::move(span);
+    local.head.store(head + 1, std::memory_order_release);
+}
+
+std::size_t tracer::flush() {
+    std::lock_guard<std::mutex> flushing(flush_mutex);
+    std::vector<ring*> current;
+    {
+        std::lock_guard<std::mutex> lock(rings_mutex);
+        for (const auto& r : rings)
+            current.push_back(r.get());
+    }
+    std::vector<trace_span> batch;
+    for (ring* r : current) {
+        const std::size_t head = r->head.load(std::memory_order_acquire);
+        std::size_t tail = r->tail.load(std::memory_order_relaxed);
+        for (; tail != head; ++tail)
+            batch.push_back(std::move(r->slots[tail % r->slots.size()]));
+        r->tail.store(tail, std::memory_order_release);
+    }
+    if (!batch.empty() && sink)
+        sink(batch);
+    return batch.size();
+}
+}  // namespace cppress::web
@@ -1,11 +1,15 @@
 #include "../includes/utilities.hpp"
 
 #include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstdint>
 #include <iomanip>
 #include <iostream>
 #include <map>
 #include <sstream>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
 #include "http/includes.hpp"
@@ -19,14 +23,11 @@ namespace cppress::web {
  * static
  *
  * @note
- * - Extracts the extension and performs a simple membership check in static_extensions
+ * - Extracts the extension and looks it up with shared::is_static_extension()
  * - Case-sensitive; callers should normalize extensions if needed
  */
 bool is_uri_static(const std::string& uri) {
-    // Check if the URI has a static file extension
-    std::string extension = shared::get_file_extension_from_uri(uri);
-    return std::find(shared::static_extensions.begin(), shared::static_extensions.end(),
-                     extension) != shared::static_extensions.end();
+    return shared::is_static_extension(shared::get_file_extension_view(uri));
 }
 
 /**
@@ -60,33 +61,82 @@ std::string get_path(const std::string& uri) {
     return uri.substr(0, pos);
 }
 
+namespace {
+std::string_view trim_view(std::string_view s) {
+    std::size_t first = s.find_first_not_of(" \t\n\r");
+    if (first == std::string_view::npos)
+        return s.substr(0, 0);
+    return s.substr(first, s.find_last_not_of(" \t\n\r") - first + 1);
+}
+
+/// Appends the trimmed name=value pairs of text split on separator
+void split_fields(std::string_view text, char separator,
+                  std::vector<std::pair<std::string_view, std::string_view>>& fields) {
+    while (!text.empty()) {
+        std::size_t end = text.find(separator);
+        std::string_view pair = text.substr(0, end);
+        std::size_t equal_pos = pair.find('=');
+        if (equal_pos != std::string_view::npos)
+            fields.emplace_back(trim_view(pair.substr(0, equal_pos)),
+                                trim_view(pair.substr(equal_pos + 1)));
+        if (end == std::string_view::npos)
+            break;
+        text.remove_prefix(end + 1);
+    }
+}
+}  // namespace
+
 /**
- * @brief Parse query string into key/value pairs.
+ * @brief Split the query string into name/value views.
  *
  * @note
  * - Finds the query portion after '?'
- * - Splits on '&' then '=' to extract name/value
+ * - Splits on '&' then '=' to extract name/value; pieces without '=' are skipped
  * - Trims whitespace from name/value but does not URL-decode
  */
+void parse_query_fields(std::string_view uri,
+                        std::vector<std::pair<std::string_view, std::string_view>>& fields) {
+    std::size_t pos = uri.find('?');
+    if (pos == std::string_view::npos)
+        return;
+    split_fields(uri.substr(pos + 1), '&', fields);
+}
+
+void parse_form_fields(std::string_view body,
+                       std::vector<std::pair<std::string_view, std::string_view>>& fields) {
+    split_fields(body, '&', fields);
+}
+
+/**
+ * @brief Split a Cookie header into name/value views.
+ *
+ * @note
+ * - Cookies are separated by ';' (RFC 6265 section 5.4), the space after it is trimmed
+ * - A value in double quotes is returned without them
+ */
+void parse_cookie_fields(std::string_view header,
+                         std::vector<std::pair<std::string_view, std::string_view>>& fields) {
+    const std::size_t first = fields.size();
+    split_fields(header, ';', fields);
+    for (std::size_t i = first; i < fields.size(); ++i) {
+        std::string_view& value = fields[i].second;
+        if (value.size() >= 2 && value.front() == '"' && value.back() == '"')
+            value = value.substr(1, value.size() - 2);
+    }
+}
+
+/**
+ * @brief Parse query string into key/value pairs.
+ *
+ * @note
+ * - Built on parse_query_fields(); the first value of a repeated name is kept
+ */
 std::map<std::string, std::string> get_query_parameters(const std::string& uri) {
     std::map<std::string, std::string> result;
-    size_t pos = uri.find('?');
-    if (pos == std::string::npos)
-        return result;
-
-    std::string query = uri.substr(pos + 1);
-
-    // split the query string into key-value pairs
-    std::istringstream query_stream(query);
-    std::string pair;
-    while (std::getline(query_stream, pair, '&')) {
-        size_t equal_pos = pair.find('=');
-        if (equal_pos != std::string::npos) {
-            std::string name = cppress::shared::trim(pair.substr(0, equal_pos));
-            std::string value = cppress::shared::trim(pair.substr(equal_pos + 1));
-            result.emplace(name, value);
-        }
-    }
+    std::vector<std::pair<std::string_view, std::string_view>> fields;
+    parse_query_fields(uri, fields);
+    for (const auto& [name, value] : fields)
+        result.emplace(std::string(name), std::string(value));
     return result;
 }
 
@@ -204,85 +254,168 @@ std::pair<bool, std::map<std::string, std::string>> match_path(const std::string
     return {true, path_params};
 }
 
-bool body_has_malicious_content(const std::string& body, bool XSS, bool SQL, bool CMD) {
-    // Empty bodies are not malicious
-    if (body.empty())
-        return false;
+namespace {
+enum pattern_group : std::uint8_t { XSS_GROUP = 1, SQL_GROUP = 2, CMD_GROUP = 4 };
 
-    // Check for common XSS attack patterns
-    const std::vector<std::string> xss_patterns = {
-        "<script>", "</script>",       "javascript:",  "javascript%3A",
-        "onerror=", "onload=",         "onclick=",     "onmouseover=",
-        "eval(",    "document.cookie", "fromCharCode", "String.fromCharCode",
-        "alert(",   "prompt(",         "confirm("};
-
-    // Check for SQL injection patterns
-    const std::vector<std::string> sql_patterns = {"SELECT",
-                                                   "UPDATE",
-                                                   "DELETE",
-                                                   "INSERT",
-                                                   "DROP",
-                                                   "UNION",
-                                                   "JOIN",
-                                                   "WHERE",
-                                                   "--",
-                                                   "/*",
-                                                   "*/",
-                                                   "1=1",
-                                                   "OR 1=1",
-                                                   "' OR '1'='1",
-                                                   "SLEEP(",
-                                                   "BENCHMARK(",
-                                                   "information_schema"};
-
-    // Check for command injection patterns
-    const std::vector<std::string> cmd_patterns = {
-        "`",           "&&",      "||",        ";",    "|",    "$(",  ">${",
-        "/etc/passwd", "/bin/sh", "/bin/bash", "curl", "wget", "nc ", "netcat"};
-
-    // tokenize the lowercase body
-    std::istringstream iss(body);
-    std::vector<std::string> tokens;
-    std::string token;
-    while (std::getline(iss, token, ' ')) {
-        tokens.push_back(token);
-    }
-    for (auto& t : tokens) {
-        std::transform(t.begin(), t.end(), t.begin(),
-                       [](unsigned char c) { return std::tolower(c); });
+/// Whitespace is one symbol, the rest is compared without ASCII case
+unsigned char fold(unsigned char c) {
+    if (c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f' || c == '\v')
+        return ' ';
+    return static_cast<unsigned char>(std::tolower(c));
+}
+
+/**
+ * Aho-Corasick automaton of every pattern, with its goto function
+ * completed into a DFA: one table lookup per byte, no failure links
+ * followed at scan time. Bytes are mapped to classes first, all bytes no
+ * pattern uses sharing one, which keeps the table a few tens of KB.
+ */
+struct pattern_automaton {
+    std::array<std::uint8_t, 256> class_of{};
+    std::array<bool, 256> special{};
+    std::size_t classes = 1;
+
+    /// next[state * classes + class]
+    std::vector<std::uint32_t> next;
+
+    /// Groups with a pattern ending in each state, along its suffixes
+    std::vector<std::uint8_t> mask;
+
+    /// State after the whitespace that precedes the body
+    std::uint32_t start = 0;
+
+    std::uint32_t step(std::uint32_t state, unsigned char c) const {
+        return next[state * classes + class_of[c]];
     }
 
-    for (auto& t : tokens) {
-        if (XSS)
-            for (const auto& pattern : xss_patterns) {
-                if (t.find(pattern) != std::string::npos)
-                    return true;
+    pattern_automaton() {
+        // whole-word patterns are matched with the whitespace around them; the
+        // scanner feeds one before the body and one after it
+        const std::vector<std::pair<std::string, std::uint8_t>> patterns = {
+            {"<script>", XSS_GROUP},       {"</script>", XSS_GROUP},
+            {"javascript:", XSS_GROUP},    {"javascript%3a", XSS_GROUP},
+            {"onerror=", XSS_GROUP},       {"onload=", XSS_GROUP},
+            {"onclick=", XSS_GROUP},       {"onmouseover=", XSS_GROUP},
+            {"eval(", XSS_GROUP},          {"document.cookie", XSS_GROUP},
+            {"fromcharcode", XSS_GROUP},   {"alert(", XSS_GROUP},
+            {"prompt(", XSS_GROUP},        {"confirm(", XSS_GROUP},
+
+            {" select ", SQL_GROUP},       {" update ", SQL_GROUP},
+            {" delete ", SQL_GROUP},       {" insert ", SQL_GROUP},
+            {" drop ", SQL_GROUP},         {" union ", SQL_GROUP},
+            {" join ", SQL_GROUP},         {" where ", SQL_GROUP},
+            {" -- ", SQL_GROUP},           {" /* ", SQL_GROUP},
+            {" */ ", SQL_GROUP},           {" 1=1 ", SQL_GROUP},
+            {" or 1=1 ", SQL_GROUP},       {" ' or '1'='1 ", SQL_GROUP},
+            {" sleep( ", SQL_GROUP},       {" benchmark( ", SQL_GROUP},
+            {" information_schema ", SQL_GROUP},
+
+            {" ` ", CMD_GROUP},            {" && ", CMD_GROUP},
+            {" || ", CMD_GROUP},           {" ; ", CMD_GROUP},
+            {" | ", CMD_GROUP},            {" $( ", CMD_GROUP},
+            {" >${ ", CMD_GROUP},          {" /etc/passwd ", CMD_GROUP},
+            {" /bin/sh ", CMD_GROUP},      {" /bin/bash ", CMD_GROUP},
+            {" curl ", CMD_GROUP},         {" wget ", CMD_GROUP},
+            {" nc ", CMD_GROUP},           {" netcat ", CMD_GROUP}};
+
+        for (unsigned char c : std::string_view("%\\+&<>=\"'"))
+            special[c] = true;
+
+        for (const auto& [pattern, group] : patterns)
+            for (unsigned char c : pattern)
+                if (class_of[c] == 0)
+                    class_of[c] = static_cast<std::uint8_t>(classes++);
+        for (unsigned c = 0; c < 256; ++c)
+            class_of[c] = class_of[fold(static_cast<unsigned char>(c))];
+
+        // the trie, NONE where it has no edge
+        const std::uint32_t NONE = UINT32_MAX;
+        next.assign(classes, NONE);
+        mask.assign(1, 0);
+        for (const auto& [pattern, group] : patterns) {
+            std::uint32_t node = 0;
+            for (unsigned char c : pattern) {
+                std::uint32_t& edge = next[node * classes + class_of[c]];
+                if (edge == NONE) {
+                    edge = static_cast<std::uint32_t>(mask.size());
+                    mask.push_back(0);
+                    next.resize(next.size() + classes, NONE);
+                }
+                node = next[node * classes + class_of[c]];
             }
-        if (SQL)
-            for (const auto& pattern : sql_patterns) {
-                if (t == pattern)
-                    return true;
-            }
-        if (CMD)
-            for (const auto& pattern : cmd_patterns) {
-                if (t == pattern)
-                    return true;
+            mask[node] |= group;
+        }
+
+        // breadth first, every state's failure state is complete before it is needed
+        std::vector<std::uint32_t> fail(mask.size(), 0), queue;
+        for (std::size_t k = 0; k < classes; ++k) {
+            std::uint32_t& edge = next[k];
+            if (edge == NONE)
+                edge = 0;
+            else
+                queue.push_back(edge);
+        }
+        for (std::size_t head = 0; head < queue.size(); ++head) {
+            const std::uint32_t node = queue[head];
+            mask[node] |= mask[fail[node]];
+            for (std::size_t k = 0; k < classes; ++k) {
+                std::uint32_t& edge = next[node * classes + k];
+                const std::uint32_t fallback = next[fail[node] * classes + k];
+                if (edge == NONE) {
+                    edge = fallback;
+                } else {
+                    fail[edge] = fallback;
+                    queue.push_back(edge);
+                }
             }
+        }
+        start = step(0, ' ');
     }
+};
 
-    // Check for unusual character sequences that might be encoded attacks
-    int consecutive_special_chars = 0;
-    for (char c : body) {
-        if (c == '%' || c == '\\' || c == '+' || c == '&' || c == '<' || c == '>' || c == '=' ||
-            c == '"' || c == '\'') {
-            consecutive_special_chars++;
-            if (consecutive_special_chars > 5)
-                return true;
-        } else {
-            consecutive_special_chars = 0;
+const pattern_automaton& malicious_patterns() {
+    static const pattern_automaton automaton;
+    return automaton;
+}
+}  // namespace
+
+malicious_content_scanner::malicious_content_scanner(bool XSS, bool SQL, bool CMD)
+    : enabled(static_cast<std::uint8_t>((XSS ? XSS_GROUP : 0) | (SQL ? SQL_GROUP : 0) |
+                                        (CMD ? CMD_GROUP : 0))),
+      state(malicious_patterns().start) {}
+
+/**
+ * Implementation Notes:
+ * - One transition per byte; a state whose mask meets an enabled group has
+ *   a pattern ending at that byte
+ * - The run of suspicious characters carries over from the previous piece
+ */
+bool malicious_content_scanner::feed(std::string_view piece) noexcept {
+    if (found)
+        return true;
+    const pattern_automaton& automaton = malicious_patterns();
+    for (unsigned char c : piece) {
+        state = automaton.step(state, c);
+        if (automaton.mask[state] & enabled)
+            return found = true;
+        if (!automaton.special[c]) {
+            special_run = 0;
+        } else if (++special_run > 5) {
+            return found = true;
         }
     }
-
     return false;
 }
+
+bool malicious_content_scanner::finish() noexcept {
+    return feed(" ");
+}
+
+bool body_has_malicious_content(const std::string& body, bool XSS, bool SQL, bool CMD) {
+    // Empty bodies are not malicious
+    if (body.empty())
+        return false;
+    malicious_content_scanner scanner(XSS, SQL, CMD);
+    return scanner.feed(body) || scanner.finish();
+}
 };  // namespace cppress::web
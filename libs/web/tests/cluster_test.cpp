@@ -0,0 +1,195 @@
+#include <gtest/gtest.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <set>
+#include <string>
+#include <thread>
+
+#include "../includes/cluster.hpp"
+#include "../includes/server.hpp"
+
+using namespace cppress::web;
+using std::chrono::milliseconds;
+
+namespace {
+constexpr std::uint16_t PORT = 8096;
+
+/// Connected socket to the cluster, -1 if refused
+int open_connection() {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(PORT);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/// Whole response to a request sent on fd, empty if the connection ended first
+std::string exchange(int fd, const std::string& path) {
+    const std::string message = "GET " + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    if (::send(fd, message.data(), message.size(), MSG_NOSIGNAL) < 0)
+        return "";
+    std::string response;
+    for (;;) {
+        const std::size_t head_end = response.find("\r\n\r\n");
+        const std::size_t length = response.find("CONTENT-LENGTH: ");
+        if (head_end != std::string::npos && length != std::string::npos &&
+            response.size() >= head_end + 4 + std::stoul(response.substr(length + 16)))
+            return response;
+        pollfd p{fd, POLLIN, 0};
+        char buffer[4096];
+        const ssize_t n = ::poll(&p, 1, 5000) == 1 ? ::recv(fd, buffer, sizeof(buffer), 0) : -1;
+        if (n <= 0)
+            return "";
+        response.append(buffer, static_cast<std::size_t>(n));
+    }
+}
+
+/// Pid of the worker that answered, -1 without an answer
+long worker_pid(const std::string& response) {
+    const std::size_t body = response.find("\r\n\r\n");
+    return body == std::string::npos ? -1 : std::stol(response.substr(body + 4));
+}
+
+/// Pid of the worker answering a new connection, -1 if refused or unanswered
+long ask_new_connection() {
+    const int fd = open_connection();
+    if (fd == -1)
+        return -1;
+    const long pid = worker_pid(exchange(fd, "/pid"));
+    ::close(fd);
+    return pid;
+}
+
+bool peer_closed(int fd) {
+    pollfd p{fd, POLLIN, 0};
+    char byte;
+    return ::poll(&p, 1, 5000) == 1 && ::recv(fd, &byte, 1, 0) <= 0;
+}
+}  // namespace
+
+// serve() gives a web::server the cluster's segment for its cached responses
+static_assert(shares_responses<server<>>::value);
+static_assert(!shares_responses<cppress::http::http_server>::value);
+
+TEST(ClusterTest, ReloadsWithoutRefusingConnectionsAndRestartsCrashedWorkers) {
+    const pid_t supervisor = ::fork();
+    ASSERT_NE(supervisor, -1);
+    if (supervisor == 0) {
+        cluster_options options;
+        options.workers = 2;
+        options.drain_timeout = milliseconds(3000);
+        options.restart_delay = milliseconds(100);
+        cluster workers(
+            [](cluster_worker& worker) {
+                server<> app(PORT, "127.0.0.1", 2);
+                auto answer = [](std::shared_ptr<request>, std::shared_ptr<response> res) {
+                    res->send_text(std::to_string(::getpid()));
+                    return exit_code::EXIT;
+                };
+                app.get("/pid", {answer});
+                app.get("/slow", {[answer](std::shared_ptr<request> req,
+                                           std::shared_ptr<response> res) {
+                                std::this_thread::sleep_for(milliseconds(1500));
+                                return answer(req, res);
+                            }});
+                worker.serve(app);
+                return 0;
+            },
+            options);
+        ::_exit(workers.run());
+    }
+
+    std::set<long> before;
+    const auto started = std::chrono::steady_clock::now();
+    while (before.size() < 2 && std::chrono::steady_clock::now() - started < milliseconds(5000)) {
+        const long pid = ask_new_connection();
+        if (pid > 0)
+            before.insert(pid);
+        else
+            std::this_thread::sleep_for(milliseconds(20));
+    }
+    EXPECT_FALSE(before.empty());
+
+    // an idle keep-alive connection and one with a request in flight
+    const int idle = open_connection();
+    ASSERT_NE(idle, -1);
+    EXPECT_TRUE(before.count(worker_pid(exchange(idle, "/pid"))));
+    const int busy = open_connection();
+    ASSERT_NE(busy, -1);
+    const std::string slow = "GET /slow HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    ASSERT_GT(::send(busy, slow.data(), slow.size(), 0), 0);
+    std::this_thread::sleep_for(milliseconds(100));
+
+    ASSERT_EQ(::kill(supervisor, SIGHUP), 0);
+    int unanswered = 0;
+    int fresh_in_a_row = 0;
+    std::set<long> after;
+    const auto reloading = std::chrono::steady_clock::now();
+    while (fresh_in_a_row < 20 && std::chrono::steady_clock::now() - reloading < milliseconds(8000)) {
+        const long pid = ask_new_connection();
+        if (pid <= 0) {
+            ++unanswered;
+            continue;
+        }
+        fresh_in_a_row = before.count(pid) ? 0 : fresh_in_a_row + 1;
+        if (!before.count(pid))
+            after.insert(pid);
+    }
+    EXPECT_EQ(unanswered, 0) << "the port always has a listener";
+    EXPECT_EQ(fresh_in_a_row, 20) << "new connections reach the new workers only";
+
+    // the request in flight was answered, then its connection closed
+    std::string response;
+    char buffer[4096];
+    bool ended = false;
+    for (pollfd p{busy, POLLIN, 0}; !ended && ::poll(&p, 1, 5000) == 1;) {
+        const ssize_t n = ::recv(busy, buffer, sizeof(buffer), 0);
+        ended = n <= 0;
+        if (n > 0)
+            response.append(buffer, static_cast<std::size_t>(n));
+    }
+    EXPECT_TRUE(ended);
+    EXPECT_TRUE(before.count(worker_pid(response))) << response;
+    EXPECT_TRUE(peer_closed(idle)) << "idle keep-alive connections are closed by the drain";
+    ::close(idle);
+    ::close(busy);
+
+    // a crashed worker is replaced
+    ASSERT_FALSE(after.empty());
+    const long crashed = *after.begin();
+    ASSERT_EQ(::kill(static_cast<pid_t>(crashed), SIGKILL), 0);
+    bool restarted = false;
+    const auto crashing = std::chrono::steady_clock::now();
+    while (!restarted && std::chrono::steady_clock::now() - crashing < milliseconds(5000)) {
+        const long pid = ask_new_connection();
+        restarted = pid > 0 && pid != crashed && !before.count(pid) && !after.count(pid);
+    }
+    EXPECT_TRUE(restarted);
+
+    ASSERT_EQ(::kill(supervisor, SIGTERM), 0);
+    int status = -1;
+    const auto stopping = std::chrono::steady_clock::now();
+    while (::waitpid(supervisor, &status, WNOHANG) == 0) {
+        if (std::chrono::steady_clock::now() - stopping > milliseconds(10000)) {
+            ::kill(supervisor, SIGKILL);
+            ::waitpid(supervisor, &status, 0);
+            break;
+        }
+        std::this_thread::sleep_for(milliseconds(20));
+    }
+    EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    EXPECT_EQ(open_connection(), -1) << "every worker exited";
+}
@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "shared/includes/cpu_topology.hpp"
+#include "shared/includes/thread_pool.hpp"
+
+TEST(CpuTopologyTest, PlacesReactorsAndWorkersByCacheDomain) {
+    using cppress::shared::cpu_topology;
+    EXPECT_EQ(cpu_topology::parse_cpu_list("8-9,0-2, 4\n"), (std::vector<int>{0, 1, 2, 4, 8, 9}));
+    EXPECT_TRUE(cpu_topology::parse_cpu_list("x,3-1").empty());
+
+    // two nodes of eight CPUs, each with two L3 domains of four
+    namespace fs = std::filesystem;
+    const fs::path root = fs::temp_directory_path() / "cppress_sysfs_test";
+    fs::remove_all(root);
+    auto write = [](const fs::path& path, const std::string& text) {
+        fs::create_directories(path.parent_path());
+        std::ofstream(path) << text << "\n";
+    };
+    write(root / "cpu/online", "0-15");
+    write(root / "node/node0/cpulist", "0-7");
+    write(root / "node/node1/cpulist", "8-15");
+    for (int cpu = 0; cpu < 16; ++cpu) {
+        const fs::path cache = root / ("cpu/cpu" + std::to_string(cpu)) / "cache";
+        const int first = cpu / 4 * 4;
+        write(cache / "index0/level", "1");
+        write(cache / "index0/shared_cpu_list", std::to_string(cpu));
+        write(cache / "index1/level", "3");
+        write(cache / "index1/shared_cpu_list",
+              std::to_string(first) + "-" + std::to_string(first + 3));
+    }
+    const cpu_topology topology = cpu_topology::from_sysfs(root.string());
+    fs::remove_all(root);
+    ASSERT_EQ(topology.domains().size(), 4u);
+    EXPECT_EQ(topology.node_count(), 2u);
+    EXPECT_EQ(topology.cpu_count(), 16u);
+    EXPECT_EQ(topology.domains()[3].node, 1);
+    EXPECT_EQ(topology.domains()[3].cpus, (std::vector<int>{12, 13, 14, 15}));
+
+    // reactors alternate nodes, workers share their reactor's domain but not its CPU
+    const auto plan = topology.place(2, 4);
+    EXPECT_EQ(plan.reactor_cpus, (std::vector<std::vector<int>>{{0}, {8}}));
+    ASSERT_EQ(plan.worker_cpus.size(), 4u);
+    EXPECT_EQ(plan.worker_cpus[0], (std::vector<int>{1, 2, 3}));
+    EXPECT_EQ(plan.worker_cpus[1], (std::vector<int>{9, 10, 11}));
+    EXPECT_EQ(plan.reactor_workers[0], (std::vector<std::size_t>{0, 2}));
+    EXPECT_EQ(plan.reactor_workers[1], (std::vector<std::size_t>{1, 3}));
+
+    // more reactors than domains: the second round takes the next CPU of each domain
+    EXPECT_EQ(topology.place(5, 0).reactor_cpus[4], std::vector<int>{1});
+
+    // pinned workers still run their tasks
+    const auto& here = cpu_topology::system();
+    ASSERT_GE(here.cpu_count(), 1u);
+    std::atomic<int> ran{0};
+    {
+        cppress::shared::thread_pool pool(2, here.place(1, 2).worker_cpus);
+        for (int i = 0; i < 100; ++i)
+            pool.enqueue([&ran] { ran.fetch_add(1); });
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (ran.load() < 100 && std::chrono::steady_clock::now() < deadline)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(ran.load(), 100);
+}
@@ -0,0 +1,81 @@
+// Built with CPPRESS_ALLOC_ACCOUNTING defined, see the alloc-accounting-tests target
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <new>
+#include <thread>
+
+#include "shared/includes/alloc_accounting.hpp"
+
+using namespace cppress::shared;
+
+static_assert(alloc_accounting, "alloc-accounting-tests must define CPPRESS_ALLOC_ACCOUNTING");
+
+namespace {
+/// Keeps allocations observable, so the compiler cannot drop a new paired with its delete
+void* volatile kept = nullptr;
+
+void allocate_and_free(std::size_t bytes) {
+    kept = ::operator new(bytes);
+    ::operator delete(kept);
+}
+
+phase_usage usage_since(const allocation_report& before, request_phase phase) {
+    const allocation_report now = allocation_snapshot();
+    return {now[phase].allocations - before[phase].allocations,
+            now[phase].allocated_bytes - before[phase].allocated_bytes,
+            now[phase].copies - before[phase].copies,
+            now[phase].copied_bytes - before[phase].copied_bytes};
+}
+}  // namespace
+
+TEST(AllocAccountingTest, AllocationsAndCopiesGoToTheInnermostPhase) {
+    const allocation_report before = allocation_snapshot();
+    {
+        phase_scope handling(request_phase::handle);
+        allocate_and_free(100);
+        count_copy(40);
+        count_copy(0);
+        {
+            phase_scope serializing(request_phase::serialize);
+            allocate_and_free(300);
+            count_copy(7);
+        }
+        // back in handle once the inner scope ends
+        allocate_and_free(20);
+    }
+
+    const phase_usage handle = usage_since(before, request_phase::handle);
+    EXPECT_EQ(handle.allocations, 2u);
+    EXPECT_EQ(handle.allocated_bytes, 120u);
+    EXPECT_EQ(handle.copies, 1u) << "empty copies are not counted";
+    EXPECT_EQ(handle.copied_bytes, 40u);
+
+    const phase_usage serialize = usage_since(before, request_phase::serialize);
+    EXPECT_EQ(serialize.allocations, 1u);
+    EXPECT_EQ(serialize.allocated_bytes, 300u);
+    EXPECT_EQ(serialize.copies, 1u);
+    EXPECT_EQ(serialize.copied_bytes, 7u);
+
+    const phase_usage parse = usage_since(before, request_phase::parse);
+    EXPECT_EQ(parse.allocations, 0u);
+    EXPECT_EQ(parse.copies, 0u);
+}
+
+TEST(AllocAccountingTest, ExitedThreadsAndRequestsStayInTheSnapshot) {
+    const allocation_report before = allocation_snapshot();
+    std::thread parser([] {
+        phase_scope parsing(request_phase::parse);
+        allocate_and_free(64);
+        count_copy(16);
+        count_request();
+    });
+    parser.join();
+    count_request();
+
+    const phase_usage parse = usage_since(before, request_phase::parse);
+    EXPECT_EQ(parse.allocations, 1u);
+    EXPECT_EQ(parse.allocated_bytes, 64u);
+    EXPECT_EQ(parse.copied_bytes, 16u);
+    EXPECT_EQ(allocation_snapshot().requests - before.requests, 2u);
+}
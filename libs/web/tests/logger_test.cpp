@@ -0,0 +1,157 @@
+#include <gtest/gtest.h>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "shared/includes/logger.hpp"
+
+namespace logger = cppress::shared::logger;
+
+namespace {
+/**
+ * Logs to a directory of its own for one test, and turns logging off again after it.
+ */
+class LoggerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        directory = std::filesystem::temp_directory_path() /
+                    ("cppress_logger_test_" + std::to_string(::getpid()));
+        std::filesystem::remove_all(directory);
+        std::filesystem::create_directories(directory);
+        logger::absolute_path_to_logs = directory.string() + "/";
+        logger::enabled_logging = true;
+        logger::set_min_level(logger::level::trace);
+        logger::set_overflow_policy(logger::overflow_policy::count);
+        logger::clear();
+    }
+
+    void TearDown() override {
+        logger::flush();
+        logger::set_min_level(logger::level::trace);
+        logger::set_overflow_policy(logger::overflow_policy::count);
+        logger::enabled_logging = false;
+        std::filesystem::remove_all(directory);
+    }
+
+    std::string contents(const std::string& file) const {
+        std::ifstream in(directory / file);
+        std::stringstream text;
+        text << in.rdbuf();
+        return text.str();
+    }
+
+    static std::size_t occurrences(const std::string& text, const std::string& part) {
+        std::size_t n = 0;
+        for (auto at = text.find(part); at != std::string::npos; at = text.find(part, at + 1))
+            ++n;
+        return n;
+    }
+
+    /// Runs body in a child process and returns its exit status
+    static int in_child(void (*body)()) {
+        const pid_t pid = ::fork();
+        if (pid == 0)
+            body();
+        int status = 0;
+        ::waitpid(pid, &status, 0);
+        return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+    }
+
+    std::filesystem::path directory;
+};
+}  // namespace
+
+TEST_F(LoggerTest, FullRingsDropLinesAndCountThem) {
+    // the background thread cannot drain while log_mutex is held, so the ring fills;
+    // records of 1024 bytes, header included, fill a 64 KiB ring after 64
+    const std::string line(1024 - sizeof(std::uint32_t) - 1, 'x');
+    const std::uint64_t before = logger::dropped();
+    {
+        std::lock_guard<std::mutex> hold(logger::log_mutex);
+        for (int i = 0; i < 100; ++i)
+            logger::info(line);
+    }
+    EXPECT_EQ(logger::dropped() - before, 36u);
+    logger::flush();
+    const std::string info = contents("info.log");
+    EXPECT_EQ(occurrences(info, line), 64u);
+    EXPECT_NE(info.find("[INFO] 36 log messages dropped, the thread's buffer was full\n"),
+              std::string::npos);
+
+    // dropped silently, still counted
+    logger::set_overflow_policy(logger::overflow_policy::drop);
+    {
+        std::lock_guard<std::mutex> hold(logger::log_mutex);
+        for (int i = 0; i < 65; ++i)
+            logger::error(line);
+    }
+    EXPECT_EQ(logger::dropped() - before, 37u);
+    logger::flush();
+    const std::string error = contents("error.log");
+    EXPECT_EQ(occurrences(error, line), 64u);
+    EXPECT_EQ(error.find("dropped"), std::string::npos);
+}
+
+TEST_F(LoggerTest, LinesBelowTheMinimumLevelAreNotWritten) {
+    logger::set_min_level(logger::level::error);
+    EXPECT_FALSE(logger::enabled(logger::level::info));
+    EXPECT_TRUE(logger::enabled(logger::level::error));
+    logger::trace("hidden trace");
+    logger::info("hidden ", 1);
+    logger::error("shown ", 2, ' ', true);
+    logger::fatal("shown fatal");
+
+    EXPECT_EQ(contents("trace.log"), "");
+    EXPECT_EQ(contents("info.log"), "");
+    EXPECT_EQ(contents("error.log"), "[ERROR] shown 2 true\n");
+    // fatal() returns once its line is written
+    EXPECT_EQ(contents("fatal.log"), "[FATAL] shown fatal\n");
+
+    logger::enabled_logging = false;
+    EXPECT_FALSE(logger::enabled(logger::level::fatal));
+}
+
+TEST_F(LoggerTest, LinesTooLongForTheRingAreWrittenAfterTheQueuedOnes) {
+    const std::string longer(40 * 1024, 'y');
+    logger::debug("first");
+    logger::debug(longer);
+    logger::debug("last");
+    logger::flush();
+    EXPECT_EQ(contents("debug.log"), "[DEBUG] first\n[DEBUG] " + longer + "\n[DEBUG] last\n");
+}
+
+TEST_F(LoggerTest, ForkedChildrenWriteTheirLinesAndNotTheParents) {
+    // queued before the fork: written once, by the parent, not again by a child
+    logger::info("parent");
+
+    // no flush: only the child's own background thread can write the line
+    EXPECT_EQ(in_child([] {
+                  logger::info("child thread");
+                  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+                  ::_exit(EXIT_SUCCESS);
+              }),
+              EXIT_SUCCESS);
+
+    // no flush either: the line is written as the child's logger shuts down
+    EXPECT_EQ(in_child([] {
+                  logger::info("child exit");
+                  std::exit(EXIT_SUCCESS);
+              }),
+              EXIT_SUCCESS);
+
+    logger::flush();
+    const std::string info = contents("info.log");
+    EXPECT_EQ(occurrences(info, "[INFO] parent\n"), 1u);
+    EXPECT_EQ(occurrences(info, "[INFO] child thread\n"), 1u);
+    EXPECT_EQ(occurrences(info, "[INFO] child exit\n"), 1u);
+}
@@ -0,0 +1,53 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "../includes/utilities.hpp"
+
+using namespace cppress::web;
+
+TEST(MaliciousContentTest, PatternsMatchWithoutCase) {
+    EXPECT_FALSE(body_has_malicious_content(""));
+    EXPECT_FALSE(body_has_malicious_content("{\"name\": \"Ada\", \"age\": 36}"));
+    EXPECT_TRUE(body_has_malicious_content("hello<SCRIPT>x</script>"));
+    EXPECT_TRUE(body_has_malicious_content("x=String.fromCharCode(65)"));
+    EXPECT_TRUE(body_has_malicious_content("' OR '1'='1"));
+    EXPECT_TRUE(body_has_malicious_content("SELECT * from users"));
+    EXPECT_TRUE(body_has_malicious_content("q=1\tUnion\nselect"));
+    EXPECT_TRUE(body_has_malicious_content("ping example.com ; cat /etc/passwd"));
+}
+
+TEST(MaliciousContentTest, WordPatternsNeedWholeWords) {
+    EXPECT_FALSE(body_has_malicious_content("selected reselect dropdown"));
+    EXPECT_FALSE(body_has_malicious_content("a;b a|b"));
+    EXPECT_TRUE(body_has_malicious_content("drop"));
+    EXPECT_TRUE(body_has_malicious_content("items; drop"));
+    EXPECT_FALSE(body_has_malicious_content("items; drop", true, false, true));
+    EXPECT_FALSE(body_has_malicious_content("<script>", false, true, true));
+}
+
+TEST(MaliciousContentTest, SuspiciousCharacterRunsCountWhateverTheFlags) {
+    EXPECT_FALSE(body_has_malicious_content("a=%22%3C", false, false, false));
+    EXPECT_TRUE(body_has_malicious_content("a=\"'<>%%", false, false, false));
+}
+
+TEST(MaliciousContentTest, PiecesMaySplitAPatternAnywhere) {
+    const std::string body = "name=x&bio=nothing to see; then DROP table";
+    for (std::size_t split = 0; split <= body.size(); ++split) {
+        malicious_content_scanner scanner;
+        bool found = scanner.feed(std::string_view(body).substr(0, split));
+        found = scanner.feed(std::string_view(body).substr(split)) || found;
+        EXPECT_TRUE(found || scanner.finish()) << split;
+    }
+
+    malicious_content_scanner clean;
+    EXPECT_FALSE(clean.feed("java"));
+    EXPECT_FALSE(clean.feed("scrip"));
+    EXPECT_FALSE(clean.finish());
+    EXPECT_FALSE(clean.detected());
+
+    malicious_content_scanner last_word;
+    EXPECT_FALSE(last_word.feed("wget"));
+    EXPECT_TRUE(last_word.finish());
+    EXPECT_TRUE(last_word.detected());
+}
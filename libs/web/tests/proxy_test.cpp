@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../includes/proxy.hpp"
+#include "../includes/server.hpp"
+
+using namespace cppress::web;
+
+namespace {
+std::vector<proxy_upstream> three_upstreams() {
+    return {{"127.0.0.1", 9101}, {"127.0.0.1", 9102}, {"127.0.0.1", 9103}};
+}
+}  // namespace
+
+TEST(ReverseProxyTest, RoundRobinSkipsUpstreamsLeftOut) {
+    server<> loops(8094, "127.0.0.1", 1);
+    auto proxy = std::make_shared<reverse_proxy>(loops, three_upstreams());
+    std::vector<std::size_t> picked;
+    for (int i = 0; i < 6; ++i) {
+        picked.push_back(proxy->acquire(""));
+        proxy->release(picked.back(), true);
+    }
+    EXPECT_EQ(picked, (std::vector<std::size_t>{0, 1, 2, 0, 1, 2}));
+
+    // one failure leaves an upstream out for fail_timeout
+    proxy->release(proxy->acquire(""), false);
+    EXPECT_FALSE(proxy->healthy(0));
+    for (int i = 0; i < 4; ++i) {
+        const std::size_t up = proxy->acquire("");
+        EXPECT_NE(up, 0u);
+        proxy->release(up, true);
+    }
+    EXPECT_THROW(reverse_proxy(loops, {}), std::invalid_argument);
+}
+
+TEST(ReverseProxyTest, LeastConnectionsPicksTheLeastBusy) {
+    server<> loops(8094, "127.0.0.1", 1);
+    proxy_options options;
+    options.policy = balance_policy::least_connections;
+    auto proxy = std::make_shared<reverse_proxy>(loops, three_upstreams(), options);
+
+    const std::size_t a = proxy->acquire("");
+    const std::size_t b = proxy->acquire("");
+    const std::size_t c = proxy->acquire("");
+    EXPECT_TRUE(a != b && b != c && a != c) << "idle upstreams are used first";
+    proxy->acquire("");
+    proxy->release(b, true);
+    EXPECT_EQ(proxy->acquire(""), b);
+    EXPECT_EQ(proxy->in_flight(b), 1u);
+}
+
+TEST(ReverseProxyTest, ConsistentHashMovesOnlyTheKeysOfALostUpstream) {
+    server<> loops(8094, "127.0.0.1", 1);
+    proxy_options options;
+    options.policy = balance_policy::consistent_hash;
+    auto proxy = std::make_shared<reverse_proxy>(loops, three_upstreams(), options);
+
+    std::map<std::string, std::size_t> owner;
+    std::vector<std::size_t> keys_per_upstream(3);
+    for (int i = 0; i < 300; ++i) {
+        const std::string key = "client-" + std::to_string(i);
+        owner[key] = proxy->acquire(key);
+        proxy->release(owner[key], true);
+        ++keys_per_upstream[owner[key]];
+        EXPECT_EQ(proxy->acquire(key), owner[key]) << "a key sticks to its upstream";
+        proxy->release(owner[key], true);
+    }
+    for (std::size_t n : keys_per_upstream)
+        EXPECT_GT(n, 50u) << "virtual nodes spread the keys";
+
+    proxy->release(proxy->acquire("client-0"), false);
+    const std::size_t lost = owner["client-0"];
+    for (const auto& [key, up] : owner) {
+        const std::size_t now = proxy->acquire(key);
+        proxy->release(now, true);
+        if (up == lost)
+            EXPECT_NE(now, lost);
+        else
+            EXPECT_EQ(now, up) << key;
+    }
+}
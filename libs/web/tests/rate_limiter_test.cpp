@@ -0,0 +1,79 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../includes/rate_limiter.hpp"
+
+using namespace cppress::web;
+using std::chrono::milliseconds;
+
+TEST(RateLimiterTest, BurstThenSustainedRate) {
+    rate_limiter limiter({10, 3});
+    const auto t0 = std::chrono::steady_clock::now();
+    EXPECT_TRUE(limiter.allow("10.0.0.1", t0));
+    EXPECT_TRUE(limiter.allow("10.0.0.1", t0));
+    EXPECT_TRUE(limiter.allow("10.0.0.1", t0));
+    EXPECT_FALSE(limiter.allow("10.0.0.1", t0));
+    EXPECT_TRUE(limiter.allow("10.0.0.2", t0)) << "keys have budgets of their own";
+
+    // one request per 100 ms from there on
+    EXPECT_FALSE(limiter.allow("10.0.0.1", t0 + milliseconds(99)));
+    EXPECT_TRUE(limiter.allow("10.0.0.1", t0 + milliseconds(100)));
+    EXPECT_FALSE(limiter.allow("10.0.0.1", t0 + milliseconds(150)));
+
+    // idle long enough, the whole burst is back
+    const auto later = t0 + milliseconds(1000);
+    for (int i = 0; i < 3; ++i)
+        EXPECT_TRUE(limiter.allow("10.0.0.1", later));
+    EXPECT_FALSE(limiter.allow("10.0.0.1", later));
+    EXPECT_EQ(limiter.rejected(), 4u);
+}
+
+TEST(RateLimiterTest, RefusalIsSerializedOnce) {
+    rate_limiter limiter({0.25, 1});
+    const std::string refusal = limiter.rejection().to_string();
+    EXPECT_EQ(refusal.rfind("HTTP/1.1 429 Too Many Requests\r\n", 0), 0u);
+    EXPECT_NE(refusal.find("Retry-After: 4\r\n"), std::string::npos);
+    EXPECT_NE(refusal.find("Connection: close\r\n"), std::string::npos);
+    EXPECT_EQ(refusal.substr(refusal.size() - 21), "429 Too Many Requests");
+}
+
+TEST(RateLimiterTest, ConcurrentCallersShareOneBudget) {
+    rate_limiter limiter({1, 100});
+    const auto t0 = std::chrono::steady_clock::now();
+    std::atomic<int> allowed{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t)
+        threads.emplace_back([&]() {
+            for (int i = 0; i < 50; ++i)
+                if (limiter.allow("shared", t0))
+                    ++allowed;
+        });
+    for (auto& thread : threads)
+        thread.join();
+    EXPECT_EQ(allowed.load(), 100);
+    EXPECT_EQ(limiter.rejected(), 300u);
+}
+
+TEST(RateLimiterTest, IdleKeysGiveUpTheirSlots) {
+    // one shard of eight slots: every key probes all of them
+    rate_limiter limiter({1, 1, 1, 8});
+    const auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < 8; ++i)
+        EXPECT_TRUE(limiter.allow("client" + std::to_string(i), t0));
+
+    // all of them still limited, a ninth key goes untracked
+    EXPECT_TRUE(limiter.allow("client8", t0));
+    EXPECT_TRUE(limiter.allow("client8", t0));
+    EXPECT_EQ(limiter.untracked(), 2u);
+
+    // a second on, their slots are free to take
+    const auto later = t0 + std::chrono::seconds(1);
+    EXPECT_TRUE(limiter.allow("client8", later));
+    EXPECT_FALSE(limiter.allow("client8", later));
+    EXPECT_EQ(limiter.untracked(), 2u);
+}
@@ -0,0 +1,155 @@
+#include <gtest/gtest.h>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../includes/response_cache.hpp"
+
+using namespace cppress::web;
+
+namespace {
+const std::string OK = "HTTP/1.1 200 OK\r\nCONTENT-TYPE: text/plain\r\nConnection: keep-alive\r\n"
+                       "CONTENT-LENGTH: 5\r\n\r\nhello";
+}
+
+TEST(ResponseCacheTest, ConcurrentMissesWaitForOneComputation) {
+    response_cache cache;
+    const cache_policy policy{std::chrono::hours(1), std::chrono::milliseconds(0), {}};
+    std::vector<std::shared_ptr<const response_cache::entry>> answered;
+    auto collect = [&](const std::shared_ptr<const response_cache::entry>& e) {
+        answered.push_back(e);
+    };
+
+    auto first = cache.find("GET /a", collect);
+    EXPECT_EQ(first.found, nullptr);
+    EXPECT_TRUE(first.fill);
+    auto second = cache.find("GET /a", collect);
+    EXPECT_EQ(second.found, nullptr);
+    EXPECT_FALSE(second.fill) << "already being computed";
+
+    cache.complete("GET /a", OK, policy);
+    ASSERT_EQ(answered.size(), 2u);
+    ASSERT_NE(answered[0], nullptr);
+    EXPECT_EQ(answered[0], answered[1]);
+    // the Connection header is left to each request
+    EXPECT_EQ(answered[0]->head.to_string(),
+              "HTTP/1.1 200 OK\r\nCONTENT-TYPE: text/plain\r\nCONTENT-LENGTH: 5");
+    EXPECT_EQ(answered[0]->body.to_string(), "hello");
+
+    auto hit = cache.find("GET /a", collect);
+    EXPECT_EQ(hit.found, answered[0]);
+    EXPECT_FALSE(hit.fill);
+    EXPECT_EQ(answered.size(), 2u);
+    EXPECT_GT(cache.size(), 0u);
+}
+
+TEST(ResponseCacheTest, StaleEntriesAreServedWhileOneRequestRefreshes) {
+    response_cache cache;
+    const cache_policy policy{std::chrono::milliseconds(20), std::chrono::hours(1), {}};
+    cache.find("GET /s", nullptr);
+    cache.complete("GET /s", OK, policy);
+    std::this_thread::sleep_for(std::chrono::milliseconds(40));
+
+    auto stale = cache.find("GET /s", nullptr);
+    ASSERT_NE(stale.found, nullptr);
+    EXPECT_TRUE(stale.fill);
+    auto meanwhile = cache.find("GET /s", nullptr);
+    EXPECT_EQ(meanwhile.found, stale.found);
+    EXPECT_FALSE(meanwhile.fill);
+
+    // a failed refresh keeps the stale entry
+    cache.complete("GET /s", "", policy);
+    EXPECT_EQ(cache.find("GET /s", nullptr).found, stale.found);
+}
+
+TEST(ResponseCacheTest, PrivateAndUnframedResponsesReachWaitersButAreNotKept) {
+    response_cache cache;
+    const cache_policy policy{std::chrono::hours(1), std::chrono::milliseconds(0), {}};
+    const std::vector<std::string> outputs = {
+        "HTTP/1.1 200 OK\r\nSet-Cookie: id=1\r\nContent-Length: 2\r\n\r\nhi",
+        "HTTP/1.1 200 OK\r\nCache-Control: Private\r\nContent-Length: 2\r\n\r\nhi",
+        "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n2\r\nhi\r\n0\r\n\r\n",
+        "HTTP/1.1 404 Not Found\r\nContent-Length: 2\r\n\r\nno"};
+    for (const auto& output : outputs) {
+        std::shared_ptr<const response_cache::entry> answered;
+        cache.find("GET /p", [&](const std::shared_ptr<const response_cache::entry>& e) {
+            answered = e;
+        });
+        cache.complete("GET /p", output, policy);
+        ASSERT_NE(answered, nullptr) << output;
+        EXPECT_TRUE(cache.find("GET /p", nullptr).fill) << output;
+        cache.complete("GET /p", "", policy);
+    }
+    EXPECT_EQ(cache.size(), 0u);
+
+    std::shared_ptr<const response_cache::entry> nothing = std::make_shared<response_cache::entry>();
+    cache.find("GET /e", [&](const std::shared_ptr<const response_cache::entry>& e) { nothing = e; });
+    cache.complete("GET /e", "", policy);
+    EXPECT_EQ(nothing, nullptr);
+}
+
+TEST(ResponseCacheTest, KeysSortTheQueryAndKeepVaryValuesApart) {
+    auto key = [](std::vector<std::pair<std::string_view, std::string_view>> query,
+                  std::vector<std::string> vary) {
+        return response_cache::make_key("GET", "/list", std::move(query), vary);
+    };
+    EXPECT_EQ(key({{"b", "2"}, {"a", "1"}}, {}), key({{"a", "1"}, {"b", "2"}}, {}));
+    EXPECT_NE(key({{"a", "1"}}, {}), key({{"a", "2"}}, {}));
+    EXPECT_NE(key({}, {"gzip"}), key({}, {"br"}));
+    EXPECT_NE(key({}, {}), response_cache::make_key("GET", "/other", {}, {}));
+}
+
+TEST(ResponseCacheTest, ResponsesAreSharedThroughASegmentAcrossProcesses) {
+    using cppress::shared::shared_memory_cache;
+    shared_memory_cache segment(8 * shared_memory_cache::PAGE_SIZE);
+    const cache_policy policy{std::chrono::milliseconds(100), std::chrono::milliseconds(300), {}};
+    response_cache computed, elsewhere;
+    computed.share_with(&segment);
+    elsewhere.share_with(&segment);
+
+    EXPECT_TRUE(computed.find("GET /a", nullptr).fill);
+    computed.complete("GET /a", OK, policy);
+
+    // another process's cache finds it without computing it
+    const pid_t pid = ::fork();
+    if (pid == 0) {
+        response_cache child;
+        child.share_with(&segment);
+        auto hit = child.find("GET /a", nullptr);
+        ::_exit(hit.found && !hit.fill && hit.found->body.to_string() == "hello" ? 0 : 1);
+    }
+    int status = 0;
+    ::waitpid(pid, &status, 0);
+    EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    auto hit = elsewhere.find("GET /a", nullptr);
+    ASSERT_NE(hit.found, nullptr);
+    EXPECT_FALSE(hit.fill);
+    EXPECT_EQ(hit.found->head.to_string(),
+              "HTTP/1.1 200 OK\r\nCONTENT-TYPE: text/plain\r\nCONTENT-LENGTH: 5");
+    EXPECT_EQ(hit.found->body.to_string(), "hello");
+
+    // stale in both: one refreshes, and the other then finds the fresher copy
+    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+    auto stale = elsewhere.find("GET /a", nullptr);
+    ASSERT_NE(stale.found, nullptr);
+    EXPECT_TRUE(stale.fill);
+    elsewhere.complete("GET /a", OK, policy);
+    auto refreshed = computed.find("GET /a", nullptr);
+    ASSERT_NE(refreshed.found, nullptr);
+    EXPECT_FALSE(refreshed.fill);
+
+    // past the stale window the segment drops it too
+    std::this_thread::sleep_for(std::chrono::milliseconds(450));
+    response_cache late;
+    late.share_with(&segment);
+    auto gone = late.find("GET /a", nullptr);
+    EXPECT_EQ(gone.found, nullptr);
+    EXPECT_TRUE(gone.fill);
+}
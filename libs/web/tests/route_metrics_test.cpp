@@ -0,0 +1,100 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../includes/route_metrics.hpp"
+#include "shared/includes/thread_pool.hpp"
+
+using namespace cppress::web;
+using std::chrono::microseconds;
+using std::chrono::milliseconds;
+
+TEST(RouteMetricsTest, HistogramBucketsAreLogLinear) {
+    // every duration lies below its bucket's bound and at or above the previous one
+    for (std::uint64_t us : {0ull, 1ull, 3ull, 4ull, 5ull, 7ull, 8ull, 9ull, 1000ull, 1023ull,
+                             1024ull, 123456ull, 99999999ull}) {
+        const std::size_t b = latency_histogram::bucket_of(us * 1000);
+        EXPECT_LT(us, latency_histogram::upper_bound_us(b)) << us;
+        if (b > 0) {
+            EXPECT_GE(us, latency_histogram::upper_bound_us(b - 1)) << us;
+        }
+    }
+    // a quarter of the octave wide
+    EXPECT_EQ(latency_histogram::upper_bound_us(latency_histogram::bucket_of(1024000)), 1280u);
+    EXPECT_EQ(latency_histogram::bucket_of(1000ull * 1000 * 1000 * 1000),
+              latency_histogram::BUCKETS - 1);
+}
+
+TEST(RouteMetricsTest, QuantilesComeFromTheBucketBounds) {
+    latency_histogram h;
+    EXPECT_EQ(h.quantile(0.5), microseconds(0));
+    for (int i = 0; i < 99; ++i)
+        h.record(100 * 1000);
+    h.record(50 * 1000 * 1000);
+    EXPECT_EQ(h.count, 100u);
+    EXPECT_EQ(h.quantile(0.5), microseconds(112));
+    EXPECT_EQ(h.quantile(0.99), microseconds(112));
+    EXPECT_EQ(h.quantile(1.0), microseconds(57344));
+}
+
+TEST(RouteMetricsTest, ShardsOfEveryThreadAreMerged) {
+    route_metrics metrics;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+        threads.emplace_back([&metrics]() {
+            for (int i = 0; i < 1000; ++i)
+                metrics.observe("GET", "/users/:id", microseconds(10), microseconds(20),
+                                microseconds(30));
+            metrics.observe("POST", "/users", {}, milliseconds(1), milliseconds(1));
+        });
+    for (auto& thread : threads)
+        thread.join();
+
+    auto snapshot = metrics.snapshot();
+    ASSERT_EQ(snapshot.size(), 2u);
+    const auto& get = snapshot.at({"GET", "/users/:id"});
+    EXPECT_EQ(get.requests, 4000u);
+    EXPECT_EQ(get.total.count, 4000u);
+    EXPECT_EQ(get.handler.sum_ns, 4000u * 20000u);
+    EXPECT_EQ(snapshot.at({"POST", "/users"}).requests, 4u);
+}
+
+TEST(RouteMetricsTest, PrometheusTextHasRoutesAndLoops) {
+    route_metrics metrics;
+    metrics.observe("GET", "/say \"hi\"", microseconds(3), microseconds(500), microseconds(600));
+    cppress::sockets::loop_stats loops;
+    loops.wakeups = 7;
+    loops.outq_depth[1] = 2;
+
+    const std::string text = metrics.prometheus(loops);
+    EXPECT_NE(text.find("# TYPE cppress_http_request_duration_seconds histogram\n"),
+              std::string::npos);
+    EXPECT_NE(text.find("cppress_http_requests_total{method=\"GET\",route=\"/say \\\"hi\\\"\"} 1\n"),
+              std::string::npos);
+    EXPECT_NE(text.find("cppress_http_handler_seconds_bucket{method=\"GET\",route=\"/say "
+                        "\\\"hi\\\"\",le=\"0.000256\"} 0\n"),
+              std::string::npos);
+    EXPECT_NE(text.find("cppress_http_handler_seconds_bucket{method=\"GET\",route=\"/say "
+                        "\\\"hi\\\"\",le=\"0.000512\"} 1\n"),
+              std::string::npos);
+    EXPECT_NE(text.find("cppress_http_handler_seconds_count{method=\"GET\",route=\"/say "
+                        "\\\"hi\\\"\"} 1\n"),
+              std::string::npos);
+    EXPECT_NE(text.find("cppress_loop_wakeups_total 7\n"), std::string::npos);
+    EXPECT_NE(text.find("cppress_loop_flushes_total{queued_below=\"4096\"} 2\n"),
+              std::string::npos);
+    EXPECT_EQ(text.find("cppress_workers"), std::string::npos);
+
+    cppress::shared::pool_stats workers;
+    workers.threads = 12;
+    workers.grown = 3;
+    workers.queue_wait = microseconds(2500);
+    const std::string with_pool = metrics.prometheus(loops, &workers);
+    EXPECT_NE(with_pool.find("# TYPE cppress_workers gauge\ncppress_workers 12\n"),
+              std::string::npos);
+    EXPECT_NE(with_pool.find("cppress_workers_grown_total 3\n"), std::string::npos);
+    EXPECT_NE(with_pool.find("cppress_workers_queue_wait_seconds 0.0025\n"), std::string::npos);
+}
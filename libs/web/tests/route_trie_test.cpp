@@ -0,0 +1,135 @@
+#include <gtest/gtest.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "../includes/route_trie.hpp"
+#include "../includes/utilities.hpp"
+
+using namespace cppress::web;
+
+namespace {
+struct route_spec {
+    std::string method;
+    std::string expression;
+};
+
+/// What the router did before routes were compiled: first route whose match_path() succeeds
+std::size_t linear_find(const std::vector<route_spec>& routes, const std::string& method,
+                        const std::string& path, std::map<std::string, std::string>& params) {
+    for (std::size_t i = 0; i < routes.size(); ++i) {
+        auto [matched, found] = match_path(routes[i].expression, path);
+        if (matched && routes[i].method == method) {
+            params = found;
+            return i;
+        }
+    }
+    return route_trie::NONE;
+}
+}  // namespace
+
+TEST(RouteTrieTest, AgreesWithLinearMatching) {
+    const std::vector<route_spec> routes = {
+        {"GET", "/"},
+        {"GET", "/users/:id"},
+        {"GET", "/users/me"},
+        {"POST", "/users"},
+        {"GET", "/users/:id/posts/:post"},
+        {"GET", "/files/*"},
+        {"GET", "/files/readme"},
+        {"GET", "/a/*/b"},
+        {"GET", "/api/v1/items/"},
+        {"GET", "/api/:version/items/:id"},
+        {"DELETE", "/users/:id"},
+        {"GET", "/users/:name/profile"},
+        {"GET", "*"},
+    };
+    route_trie trie;
+    for (std::size_t i = 0; i < routes.size(); ++i)
+        trie.insert(routes[i].method, routes[i].expression, i);
+
+    const std::vector<std::pair<std::string, std::string>> requests = {
+        {"GET", "/"},
+        {"GET", ""},
+        {"GET", "/users/42"},
+        {"GET", "/users/me"},
+        {"GET", "/users/me/"},
+        {"POST", "/users"},
+        {"POST", "/users/42"},
+        {"GET", "/users/42/posts/7"},
+        {"GET", "/users/a%20b/profile"},
+        {"GET", "/files"},
+        {"GET", "/files/readme"},
+        {"GET", "/files/docs/guide%2Emd"},
+        {"GET", "/a/x/y/z"},
+        {"GET", "/a"},
+        {"GET", "/api/v1/items"},
+        {"GET", "/api/v2/items/9"},
+        {"GET", "//users//42"},
+        {"DELETE", "/users/42"},
+        {"PUT", "/users/42"},
+        {"GET", "/nothing/here"},
+    };
+    for (const auto& [method, path] : requests) {
+        std::map<std::string, std::string> expected_params, params;
+        std::size_t expected = linear_find(routes, method, path, expected_params);
+        std::size_t found = trie.find(method, path, params);
+        EXPECT_EQ(found, expected) << method << " " << path;
+        EXPECT_EQ(params, expected_params) << method << " " << path;
+    }
+}
+
+TEST(RouteTrieTest, EarlierRouteWinsOverMoreSpecificOne) {
+    route_trie trie;
+    trie.insert("GET", "/users/:id", 0);
+    trie.insert("GET", "/users/me", 1);
+    std::map<std::string, std::string> params;
+    EXPECT_EQ(trie.find("GET", "/users/me", params), 0u);
+    EXPECT_EQ(params.at("id"), "me");
+
+    route_trie reversed;
+    reversed.insert("GET", "/users/me", 0);
+    reversed.insert("GET", "/users/:id", 1);
+    params.clear();
+    EXPECT_EQ(reversed.find("GET", "/users/me", params), 0u);
+    EXPECT_TRUE(params.empty());
+}
+
+TEST(RouteTrieTest, ManyRoutesStillFindTheRightOne) {
+    route_trie trie;
+    for (std::size_t i = 0; i < 400; ++i)
+        trie.insert("GET", "/api/resource" + std::to_string(i) + "/:id", i);
+    std::map<std::string, std::string> params;
+    EXPECT_EQ(trie.find("GET", "/api/resource399/abc", params), 399u);
+    EXPECT_EQ(params.at("id"), "abc");
+    EXPECT_EQ(trie.find("GET", "/api/resource400/abc", params), route_trie::NONE);
+}
+
+TEST(RouteTrieTest, CapturesAreUndecodedViewsOfThePath) {
+    route_trie trie;
+    trie.insert("GET", "/users/:id/files/*", 0);
+
+    const std::string path = "/users/a%20b/files/docs/guide%2Emd";
+    path_captures captures;
+    ASSERT_EQ(trie.find("GET", path, captures), 0u);
+    ASSERT_EQ(captures.size(), 2u);
+    EXPECT_EQ(captures[0].name, "id");
+    EXPECT_EQ(captures[0].value, "a%20b");
+    EXPECT_EQ(captures[1].name, "*");
+    EXPECT_EQ(captures[1].value, "docs/guide%2Emd");
+    EXPECT_GE(captures[0].value.data(), path.data());
+    EXPECT_LE(captures[1].value.data() + captures[1].value.size(), path.data() + path.size());
+
+    std::string many = "/";
+    std::string expression = "/";
+    for (int i = 0; i < 12; ++i) {
+        many += std::to_string(i) + "/";
+        expression += ":p" + std::to_string(i) + "/";
+    }
+    trie.insert("GET", expression, 1);
+    ASSERT_EQ(trie.find("GET", many, captures), 1u);
+    ASSERT_EQ(captures.size(), 12u);
+    EXPECT_EQ(captures[11].name, "p11");
+    EXPECT_EQ(captures[11].value, "11");
+}
@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "shared/includes/cache.hpp"
+#include "shared/includes/thread_pool.hpp"
+
+TEST(SharedCacheTest, AdmitsFrequentKeysOverAScan) {
+    cppress::shared::cache<int, std::string> cache(100);
+    EXPECT_TRUE(cache.put(1, "one"));
+    ASSERT_NE(cache.get(1), nullptr);
+    EXPECT_EQ(*cache.get(1), "one");
+    EXPECT_EQ(cache.get(2), nullptr);
+
+    // a hot set used again and again keeps its place through a scan of one-off keys
+    for (int round = 0; round < 20; ++round)
+        for (int key = 0; key < 50; ++key)
+            if (!cache.get(key))
+                cache.put(key, std::to_string(key));
+    for (int key = 1000; key < 5000; ++key)
+        if (!cache.get(key))
+            cache.put(key, "scan");
+    int kept = 0;
+    for (int key = 0; key < 50; ++key)
+        kept += cache.get(key) != nullptr;
+    EXPECT_GE(kept, 40);
+    EXPECT_LE(cache.cost(), 100u);
+    EXPECT_GT(cache.stats().evictions, 0u);
+
+    cache.put(7, "seven");
+    EXPECT_TRUE(cache.erase(7));
+    EXPECT_FALSE(cache.erase(7));
+    cache.clear();
+    EXPECT_EQ(cache.size(), 0u);
+}
+
+TEST(SharedCacheTest, WeighsExpiresAndCoalescesLoads) {
+    using text_cache = cppress::shared::cache<std::string, std::string>;
+    text_cache::options options;
+    options.capacity = 1000;
+    options.shards = 1;
+    options.ttl = std::chrono::milliseconds(30);
+    options.weigh = [](const std::string&, const std::string& value) { return value.size(); };
+    text_cache cache(options);
+
+    EXPECT_TRUE(cache.put("a", std::string(100, 'a')));
+    EXPECT_FALSE(cache.put("big", std::string(2000, 'b')));
+    EXPECT_EQ(cache.cost(), 100u);
+    EXPECT_EQ(cache.stats().rejections, 1u);
+    std::this_thread::sleep_for(std::chrono::milliseconds(40));
+    EXPECT_EQ(cache.get("a"), nullptr);
+    EXPECT_EQ(cache.purge_expired(), 1u);
+
+    // callers asking for a key while it loads wait for that one load
+    std::atomic<int> loads{0};
+    std::vector<std::thread> callers;
+    std::vector<std::string> results(8);
+    for (int i = 0; i < 8; ++i)
+        callers.emplace_back([&, i] {
+            results[i] = *cache.get_or_load("page", [&loads] {
+                loads.fetch_add(1);
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                return std::string("rendered");
+            });
+        });
+    for (auto& caller : callers)
+        caller.join();
+    EXPECT_EQ(loads.load(), 1);
+    EXPECT_TRUE(std::all_of(results.begin(), results.end(),
+                            [](const std::string& r) { return r == "rendered"; }));
+
+    auto broken = []() -> std::string { throw std::runtime_error("no"); };
+    EXPECT_THROW(cache.get_or_load("broken", broken), std::runtime_error);
+    EXPECT_EQ(cache.get("broken"), nullptr);
+
+    cppress::shared::thread_pool pool(1);
+    auto later = cache.get_async(
+        "async", [] { return std::string("loaded"); },
+        [&pool](std::function<void()> job) { pool.enqueue(std::move(job)); });
+    EXPECT_EQ(*later.get(), "loaded");
+    EXPECT_EQ(cache.stats().loads, 3u);
+}
@@ -0,0 +1,106 @@
+#include <gtest/gtest.h>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "shared/includes/shared_memory_cache.hpp"
+
+using cppress::shared::shared_memory_cache;
+using std::chrono::milliseconds;
+
+TEST(SharedMemoryCacheTest, EntriesAreSharedWithForkedProcessesAndOutliveThem) {
+    shared_memory_cache cache(16 * 1024 * 1024);
+    ASSERT_TRUE(cache.put("before", "fork"));
+
+    const pid_t child = ::fork();
+    ASSERT_NE(child, -1);
+    if (child == 0) {
+        auto seen = cache.get("before");
+        bool stored = seen && *seen == "fork";
+        for (int i = 0; i < 100; ++i)
+            stored = cache.put("key" + std::to_string(i), std::string(100 + i, 'a' + i % 26)) &&
+                     stored;
+        ::_exit(stored ? 0 : 1);
+    }
+    int status = -1;
+    ASSERT_EQ(::waitpid(child, &status, 0), child);
+    ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    // stored by a process that has exited
+    for (int i = 0; i < 100; ++i) {
+        auto value = cache.get("key" + std::to_string(i));
+        ASSERT_TRUE(value) << i;
+        EXPECT_EQ(*value, std::string(100 + i, 'a' + i % 26));
+    }
+    EXPECT_EQ(cache.size(), 101u);
+    EXPECT_TRUE(cache.erase("key0"));
+    EXPECT_FALSE(cache.get("key0"));
+    EXPECT_TRUE(cache.put("key1", "replaced"));
+    EXPECT_EQ(*cache.get("key1"), "replaced");
+    EXPECT_EQ(cache.size(), 100u);
+
+    EXPECT_FALSE(cache.put("huge", std::string(shared_memory_cache::PAGE_SIZE, 'x')));
+    EXPECT_TRUE(cache.put("brief", "value", milliseconds(20)));
+    std::this_thread::sleep_for(milliseconds(40));
+    EXPECT_FALSE(cache.get("brief"));
+    EXPECT_EQ(cache.purge_expired(), 1u);
+
+    int loads = 0;
+    EXPECT_EQ(*cache.get_or_load("loaded", [&] { return std::string(std::to_string(++loads)); }),
+              "1");
+    EXPECT_EQ(*cache.get_or_load("loaded", [&] { return std::string(std::to_string(++loads)); }),
+              "1");
+    EXPECT_EQ(loads, 1);
+    EXPECT_EQ(cache.stats().rejections, 1u);
+}
+
+TEST(SharedMemoryCacheTest, FullClassesEvictAndTakePagesFromOthers) {
+    shared_memory_cache cache(8 * 1024 * 1024);
+    const std::string small(200, 's');
+    const std::string large(300 * 1024, 'l');
+
+    // readers in other processes while one process fills the segment
+    std::vector<pid_t> readers;
+    for (int r = 0; r < 2; ++r) {
+        const pid_t reader = ::fork();
+        ASSERT_NE(reader, -1);
+        if (reader == 0) {
+            bool intact = true;
+            for (int round = 0; round < 2000; ++round) {
+                auto value = cache.get("small" + std::to_string(round % 500));
+                intact = intact && (!value || *value == small);
+            }
+            ::_exit(intact ? 0 : 1);
+        }
+        readers.push_back(reader);
+    }
+    for (int i = 0; i < 100000; ++i)
+        ASSERT_TRUE(cache.put("small" + std::to_string(i % 50000), small)) << i;
+    for (const pid_t reader : readers) {
+        int status = -1;
+        ASSERT_EQ(::waitpid(reader, &status, 0), reader);
+        EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0) << "no torn value was read";
+    }
+    EXPECT_GT(cache.stats().evictions, 0u);
+    EXPECT_LE(cache.cost(), cache.capacity());
+
+    // a frequently read key survives the CLOCK
+    ASSERT_TRUE(cache.put("hot", small));
+    for (int i = 0; i < 50000; ++i) {
+        EXPECT_TRUE(cache.get("hot")) << i;
+        ASSERT_TRUE(cache.put("other" + std::to_string(i), small));
+    }
+
+    // every page belongs to the small class now; a large entry takes one of them
+    for (int i = 0; i < 8; ++i)
+        ASSERT_TRUE(cache.put("large" + std::to_string(i), large)) << i;
+    EXPECT_EQ(*cache.get("large7"), large);
+    cache.clear();
+    EXPECT_EQ(cache.size(), 0u);
+    EXPECT_EQ(cache.cost(), 0u);
+}
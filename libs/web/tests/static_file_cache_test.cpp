@@ -0,0 +1,82 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include "../includes/static_file_cache.hpp"
+
+using namespace cppress::web;
+
+namespace {
+std::filesystem::path fresh_directory(const char* name) {
+    auto dir = std::filesystem::temp_directory_path() / name;
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    return dir;
+}
+}  // namespace
+
+TEST(StaticFileCacheTest, HitsShareOneBufferUntilTheFileChanges) {
+    auto dir = fresh_directory("cppress_static_cache");
+    std::ofstream(dir / "app.js") << "first";
+    const std::vector<std::string> directories = {(dir / "missing").string(), dir.string()};
+
+    static_file_cache cache({1024 * 1024, 1024, std::chrono::milliseconds(0)});
+    auto first = cache.find("/app.js", directories);
+    ASSERT_NE(first, nullptr);
+    EXPECT_EQ(first->path, (dir / "app.js").string());
+    EXPECT_EQ(first->content_type, "application/javascript");
+    EXPECT_EQ(first->content.to_string(), "first");
+    EXPECT_FALSE(first->etag.empty());
+
+    // unchanged: revalidated, the same buffer comes back
+    auto again = cache.find("/app.js", directories);
+    EXPECT_EQ(again, first);
+
+    std::ofstream(dir / "app.js") << "second, longer";
+    auto changed = cache.find("/app.js", directories);
+    ASSERT_NE(changed, nullptr);
+    EXPECT_EQ(changed->content.to_string(), "second, longer");
+    EXPECT_EQ(first->content.to_string(), "first");  // a response still sending it is unaffected
+
+    std::filesystem::remove(dir / "app.js");
+    EXPECT_EQ(cache.find("/app.js", directories), nullptr);
+    EXPECT_EQ(cache.find("/nothing.js", directories), nullptr);
+    EXPECT_EQ(cache.size(), 0u);
+}
+
+TEST(StaticFileCacheTest, EntriesAreTrustedForTheRevalidationInterval) {
+    auto dir = fresh_directory("cppress_static_cache_interval");
+    std::ofstream(dir / "page.html") << "old";
+    const std::vector<std::string> directories = {dir.string()};
+
+    static_file_cache cache({1024 * 1024, 1024, std::chrono::hours(1)});
+    auto first = cache.find("/page.html", directories);
+    ASSERT_NE(first, nullptr);
+    std::filesystem::remove(dir / "page.html");
+    EXPECT_EQ(cache.find("/page.html", directories), first);
+}
+
+TEST(StaticFileCacheTest, LargeFilesKeepOnlyMetadataAndTheBudgetHolds) {
+    auto dir = fresh_directory("cppress_static_cache_budget");
+    std::ofstream(dir / "big.bin") << std::string(4096, 'b');
+    for (int i = 0; i < 8; ++i)
+        std::ofstream(dir / ("f" + std::to_string(i) + ".css")) << std::string(512, 'c');
+    const std::vector<std::string> directories = {dir.string()};
+
+    static_file_cache cache({2048, 1024, std::chrono::hours(1)});
+    auto big = cache.find("/big.bin", directories);
+    ASSERT_NE(big, nullptr);
+    EXPECT_EQ(big->size, 4096u);
+    EXPECT_TRUE(big->content.empty());
+
+    for (int i = 0; i < 8; ++i) {
+        auto f = cache.find("/f" + std::to_string(i) + ".css", directories);
+        ASSERT_NE(f, nullptr);
+        EXPECT_EQ(f->content.size(), 512u);
+        EXPECT_LE(cache.size(), 2048u);
+    }
+}
@@ -0,0 +1,92 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include "../includes/static_manifest.hpp"
+
+using namespace cppress::web;
+
+TEST(StaticManifestTest, ListsStaticFilesOfEveryDirectoryOnce) {
+    auto root = std::filesystem::temp_directory_path() / "cppress_static_manifest";
+    std::filesystem::remove_all(root);
+    std::filesystem::create_directories(root / "first" / "css");
+    std::filesystem::create_directories(root / "second");
+    std::ofstream(root / "first" / "css" / "site.css") << "body{}";
+    std::ofstream(root / "first" / "index.html") << "<html></html>";
+    std::ofstream(root / "first" / "notes") << "no extension, not static";
+    std::ofstream(root / "second" / "index.html") << "shadowed";
+    std::ofstream(root / "second" / "logo.png") << "png";
+
+    static_manifest manifest(std::chrono::milliseconds(0));
+    manifest.add_directory((root / "first").string());
+    manifest.add_directory((root / "second").string());
+    EXPECT_EQ(manifest.size(), 3u);
+
+    auto css = manifest.find("/css/site.css");
+    ASSERT_NE(css, nullptr);
+    EXPECT_EQ(css->content_type, "text/css");
+    EXPECT_EQ(css->size, 6u);
+    EXPECT_FALSE(css->etag.empty());
+
+    auto index = manifest.find("/index.html");
+    ASSERT_NE(index, nullptr);
+    EXPECT_EQ(index->path, (root / "first" / "index.html").string());
+    EXPECT_NE(manifest.find("/logo.png"), nullptr);
+    EXPECT_EQ(manifest.find("/notes"), nullptr);
+    EXPECT_EQ(manifest.find("/.env"), nullptr);
+    EXPECT_EQ(manifest.find("/wp-login.php"), nullptr);
+
+    // a file added later shows up once its directory's time moved
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    std::ofstream(root / "first" / "css" / "print.css") << "@media print{}";
+    EXPECT_NE(manifest.find("/css/print.css"), nullptr);
+    std::filesystem::remove(root / "second" / "logo.png");
+    EXPECT_EQ(manifest.find("/logo.png"), nullptr);
+}
+
+TEST(StaticManifestTest, DirectoriesAreLoadedFromAStartupSnapshotUntilOneChanges) {
+    auto root = std::filesystem::temp_directory_path() / "cppress_static_manifest_snapshot";
+    std::filesystem::remove_all(root);
+    std::filesystem::create_directories(root / "public" / "js");
+    std::ofstream(root / "public" / "js" / "app.js") << "run()";
+    std::ofstream(root / "public" / "index.html") << "<html></html>";
+    const std::string directory = (root / "public").string();
+    const std::string file = (root / "startup.snapshot").string();
+
+    static_manifest built(std::chrono::milliseconds(0));
+    built.add_directory(directory);
+    cppress::shared::snapshot_writer out;
+    built.save_directory(directory, out);
+    EXPECT_THROW(built.save_directory((root / "other").string(), out), std::invalid_argument);
+    out.save(file);
+
+    auto snapshot = cppress::shared::startup_snapshot::open(file);
+    ASSERT_NE(snapshot, nullptr);
+    static_manifest loaded(std::chrono::milliseconds(0));
+    EXPECT_FALSE(loaded.load_directory((root / "other").string(), *snapshot));
+    ASSERT_TRUE(loaded.load_directory(directory, *snapshot));
+    EXPECT_EQ(loaded.size(), 2u);
+    auto js = loaded.find("/js/app.js");
+    ASSERT_NE(js, nullptr);
+    EXPECT_EQ(js->path, (root / "public" / "js" / "app.js").string());
+    EXPECT_EQ(js->etag, built.find("/js/app.js")->etag);
+    EXPECT_EQ(js->size, 5u);
+
+    // the loaded listing is refreshed like a walked one
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    std::ofstream(root / "public" / "js" / "vendor.js") << "lib()";
+    EXPECT_NE(loaded.find("/js/vendor.js"), nullptr);
+
+    // and the snapshot no longer offers it
+    static_manifest again(std::chrono::milliseconds(0));
+    EXPECT_FALSE(again.load_directory(directory, *snapshot));
+    EXPECT_EQ(again.size(), 0u);
+
+    // a damaged file is not opened at all
+    std::filesystem::resize_file(file, std::filesystem::file_size(file) - 8);
+    EXPECT_EQ(cppress::shared::startup_snapshot::open(file), nullptr);
+}
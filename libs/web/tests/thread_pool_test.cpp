@@ -0,0 +1,176 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "shared/includes/thread_pool.hpp"
+
+TEST(ThreadPoolTest, RunsEveryTaskSubmittedFromManyThreads) {
+    std::atomic<int> done{0};
+    {
+        cppress::shared::thread_pool pool(4);
+        std::vector<std::thread> producers;
+        // more than the injection queue holds, so some go through the overflow
+        for (int p = 0; p < 4; ++p)
+            producers.emplace_back([&pool, &done] {
+                for (int i = 0; i < 5000; ++i)
+                    pool.enqueue([&done] { done.fetch_add(1); });
+            });
+        for (auto& producer : producers)
+            producer.join();
+
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (done.load() < 20000 && std::chrono::steady_clock::now() < deadline)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(done.load(), 20000);
+}
+
+TEST(ThreadPoolTest, TasksSpawnedByAWorkerAreStolenByIdleOnes) {
+    std::mutex mutex;
+    std::vector<std::thread::id> ran_on;
+    std::atomic<int> done{0};
+    cppress::shared::thread_pool pool(4);
+    pool.enqueue([&] {
+        // pushed onto this worker's deque, which the others steal from while it sleeps
+        for (int i = 0; i < 64; ++i)
+            pool.enqueue([&] {
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                std::lock_guard<std::mutex> lock(mutex);
+                ran_on.push_back(std::this_thread::get_id());
+                done.fetch_add(1);
+            });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    });
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (done.load() < 64 && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    ASSERT_EQ(done.load(), 64);
+    std::sort(ran_on.begin(), ran_on.end());
+    EXPECT_GT(std::unique(ran_on.begin(), ran_on.end()) - ran_on.begin(), 1);
+}
+
+TEST(ThreadPoolTest, LargeCallablesAreHeldOnTheHeap) {
+    std::array<char, 256> big{};
+    big[255] = 'x';
+    std::atomic<char> seen{0};
+    {
+        cppress::shared::thread_pool pool(1);
+        pool.enqueue([big, &seen] { seen.store(big[255]); });
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (seen.load() == 0 && std::chrono::steady_clock::now() < deadline)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(seen.load(), 'x');
+
+    auto counter = std::make_shared<int>(0);
+    {
+        cppress::shared::task t([counter] { ++*counter; });
+        cppress::shared::task moved(std::move(t));
+        EXPECT_FALSE(t);
+        moved();
+    }
+    EXPECT_EQ(*counter, 1);
+    EXPECT_EQ(counter.use_count(), 1) << "the moved-from and the moved-to task both released it";
+}
+
+TEST(ThreadPoolTest, TryEnqueueRefusesPastTheLimit) {
+    std::atomic<bool> release{false};
+    std::atomic<int> done{0};
+    cppress::shared::thread_pool pool(1);
+    pool.enqueue([&] {
+        while (!release.load())
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    });
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (pool.pending() != 0 && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    // the blocker is running, not waiting: two more fit
+    EXPECT_TRUE(pool.try_enqueue([&done] { done.fetch_add(1); }, 2));
+    EXPECT_TRUE(pool.try_enqueue([&done] { done.fetch_add(1); }, 2));
+    EXPECT_FALSE(pool.try_enqueue([&done] { done.fetch_add(1); }, 2));
+    EXPECT_EQ(pool.pending(), 2u);
+
+    release.store(true);
+    deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (done.load() < 2 && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    EXPECT_EQ(done.load(), 2);
+    EXPECT_EQ(pool.pending(), 0u);
+}
+
+TEST(ThreadPoolTest, PinnedTasksRunInOrderOnTheirWorker) {
+    std::mutex mutex;
+    std::vector<int> order;
+    std::vector<std::thread::id> ran_on;
+    {
+        cppress::shared::thread_pool pool(4);
+        EXPECT_EQ(pool.size(), 4u);
+        // more than an inbox holds, so some wait in its overflow
+        for (int i = 0; i < 1000; ++i)
+            pool.enqueue_to(6, [&, i] {
+                std::lock_guard<std::mutex> lock(mutex);
+                order.push_back(i);
+                ran_on.push_back(std::this_thread::get_id());
+            });
+        EXPECT_FALSE(pool.try_enqueue_to(2, [] {}, 0));
+
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (pool.pending() != 0 && std::chrono::steady_clock::now() < deadline)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    ASSERT_EQ(order.size(), 1000u);
+    EXPECT_TRUE(std::is_sorted(order.begin(), order.end()));
+    EXPECT_TRUE(std::all_of(ran_on.begin(), ran_on.end(),
+                            [&](std::thread::id id) { return id == ran_on.front(); }));
+}
+
+TEST(ThreadPoolTest, AdaptsItsSizeToTheQueueWait) {
+    cppress::shared::thread_pool pool(1);
+    cppress::shared::pool_sizing sizing;
+    sizing.min_threads = 1;
+    sizing.max_threads = 8;
+    sizing.interval = std::chrono::milliseconds(10);
+    sizing.shrink_after = 2;
+    EXPECT_THROW(pool.adapt({0, 4}), std::invalid_argument);
+    pool.adapt(sizing);
+    EXPECT_EQ(pool.stats().max_threads, 8u);
+
+    // blocking tasks leave the CPU idle while they queue up: the pool grows
+    std::atomic<int> done{0};
+    for (int i = 0; i < 200; ++i)
+        pool.enqueue([&done] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            done.fetch_add(1);
+        });
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (done.load() < 200 && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    EXPECT_EQ(done.load(), 200);
+    EXPECT_GT(pool.stats().grown, 0u);
+
+    // idle workers retire one by one, down to the minimum
+    deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (pool.size() > 1 && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    EXPECT_EQ(pool.size(), 1u);
+    EXPECT_GT(pool.stats().shrunk, 0u);
+
+    // pinned tasks still run, on the worker that never retires
+    for (int i = 0; i < 10; ++i)
+        pool.enqueue_to(i, [&done] { done.fetch_add(1); });
+    deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (done.load() < 210 && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    EXPECT_EQ(done.load(), 210);
+}
@@ -0,0 +1,150 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../includes/tracing.hpp"
+
+using namespace cppress::web;
+
+namespace {
+const std::string PARENT = "00-0af7651916cd43dd8448eb211c80319c-b7ad6b7169203331-01";
+
+std::shared_ptr<tracer> collecting(std::vector<trace_span>& into, tracing_options options) {
+    return std::make_shared<tracer>(
+        [&into](const std::vector<trace_span>& spans) {
+            into.insert(into.end(), spans.begin(), spans.end());
+        },
+        options);
+}
+}  // namespace
+
+TEST(TracingTest, TraceparentRoundTrips) {
+    trace_context context;
+    ASSERT_TRUE(trace_context::parse(PARENT, context));
+    EXPECT_TRUE(context.sampled);
+    EXPECT_EQ(context.trace_id[0], 0x0a);
+    EXPECT_EQ(context.span_id[7], 0x31);
+    EXPECT_EQ(context.traceparent(), PARENT);
+
+    trace_context child = context.child();
+    EXPECT_EQ(child.trace_id, context.trace_id);
+    EXPECT_NE(child.span_id, context.span_id);
+    EXPECT_EQ(child.traceparent().substr(0, 36), PARENT.substr(0, 36));
+
+    // a later version may append fields
+    EXPECT_TRUE(trace_context::parse(
+        "cc-0af7651916cd43dd8448eb211c80319c-b7ad6b7169203331-00-extra", context));
+    EXPECT_FALSE(context.sampled);
+}
+
+TEST(TracingTest, MalformedTraceparentsAreIgnored) {
+    const std::vector<std::string> malformed = {
+        "",
+        "00-0af7651916cd43dd8448eb211c80319c-b7ad6b7169203331",
+        "00-0AF7651916CD43DD8448EB211C80319C-b7ad6b7169203331-01",
+        "00-00000000000000000000000000000000-b7ad6b7169203331-01",
+        "00-0af7651916cd43dd8448eb211c80319c-0000000000000000-01",
+        "ff-0af7651916cd43dd8448eb211c80319c-b7ad6b7169203331-01",
+        "00-0af7651916cd43dd8448eb211c80319c-b7ad6b7169203331-01-extra",
+        "00_0af7651916cd43dd8448eb211c80319c-b7ad6b7169203331-01"};
+    for (const auto& header : malformed) {
+        trace_context context;
+        EXPECT_FALSE(trace_context::parse(header, context)) << header;
+        EXPECT_FALSE(context.valid());
+        EXPECT_EQ(context.traceparent(), "");
+    }
+}
+
+TEST(TracingTest, IncomingContextDecidesSampling) {
+    std::vector<trace_span> spans;
+    auto never = collecting(spans, {0.0});
+    EXPECT_EQ(never->start(""), nullptr);
+    EXPECT_EQ(never->start("00-0af7651916cd43dd8448eb211c80319c-b7ad6b7169203331-00"), nullptr);
+
+    auto joined = never->start(PARENT);
+    ASSERT_NE(joined, nullptr);
+    trace_context parent;
+    trace_context::parse(PARENT, parent);
+    EXPECT_EQ(joined->context.trace_id, parent.trace_id);
+    EXPECT_EQ(joined->parent_id, parent.span_id);
+
+    auto always = collecting(spans, {1.0});
+    auto root = always->start("");
+    ASSERT_NE(root, nullptr);
+    EXPECT_TRUE(root->context.valid());
+    EXPECT_TRUE(root->context.sampled);
+}
+
+TEST(TracingTest, FinishedRequestsBecomeAPhaseSpanPerStamp) {
+    std::vector<trace_span> spans;
+    auto traces = collecting(spans, {1.0});
+    auto trace = traces->start(PARENT);
+    ASSERT_NE(trace, nullptr);
+    trace->name = "GET /orders/:id";
+    const auto t0 = std::chrono::steady_clock::now();
+    trace->mark(trace_point::received, t0);
+    trace->mark(trace_point::dispatched, t0 + std::chrono::microseconds(10));
+    // handled on the loop: no dequeued stamp, dispatched runs to routed
+    trace->mark(trace_point::routed, t0 + std::chrono::microseconds(30));
+    trace->mark(trace_point::handled, t0 + std::chrono::microseconds(70));
+    traces->finish(*trace);
+    EXPECT_EQ(traces->flush(), 4u);
+
+    ASSERT_EQ(spans.size(), 4u);
+    const trace_span& root = spans.back();
+    EXPECT_EQ(root.name, "GET /orders/:id");
+    EXPECT_EQ(root.span_id, trace->context.span_id);
+    EXPECT_EQ(root.parent_id, trace->parent_id);
+    EXPECT_EQ(root.end - root.start, std::chrono::microseconds(70));
+    EXPECT_EQ(spans[0].name, "parse");
+    EXPECT_EQ(spans[1].name, "queue");
+    EXPECT_EQ(spans[1].end - spans[1].start, std::chrono::microseconds(20));
+    EXPECT_EQ(spans[2].name, "handler");
+    for (std::size_t i = 0; i + 1 < spans.size(); ++i) {
+        EXPECT_EQ(spans[i].trace_id, root.trace_id);
+        EXPECT_EQ(spans[i].parent_id, root.span_id);
+    }
+}
+
+TEST(TracingTest, UpstreamSpansAreRecordedWhenTheyEnd) {
+    std::vector<trace_span> spans;
+    auto traces = collecting(spans, {1.0});
+    auto trace = traces->start("");
+    {
+        upstream_span call(trace->owner, trace->context.child(), trace->context.span_id, "db");
+        EXPECT_EQ(call.traceparent().size(), 55u);
+        EXPECT_EQ(traces->flush(), 0u);
+    }
+    EXPECT_EQ(traces->flush(), 1u);
+    ASSERT_EQ(spans.size(), 1u);
+    EXPECT_EQ(spans[0].name, "db");
+    EXPECT_EQ(spans[0].parent_id, trace->context.span_id);
+
+    upstream_span untraced;
+    EXPECT_EQ(untraced.traceparent(), "");
+    untraced.end();
+    EXPECT_EQ(traces->flush(), 0u);
+}
+
+TEST(TracingTest, EveryThreadsRingIsDrainedAndOverflowIsCounted) {
+    std::vector<trace_span> spans;
+    auto traces = collecting(spans, {1.0, 8});
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 3; ++t)
+        threads.emplace_back([&traces]() {
+            for (int i = 0; i < 10; ++i) {
+                trace_span span;
+                span.name = "work";
+                traces->record(std::move(span));
+            }
+        });
+    for (auto& thread : threads)
+        thread.join();
+    EXPECT_EQ(traces->flush(), 24u);
+    EXPECT_EQ(traces->dropped(), 6u);
+    EXPECT_EQ(traces->flush(), 0u);
+}
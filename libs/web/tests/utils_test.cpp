@@ -0,0 +1,162 @@
+#include <gtest/gtest.h>
+
+#include <cctype>
+#include <string>
+#include <string_view>
+
+#include "shared/includes/utils.hpp"
+
+TEST(SharedUtilsTest, HasTokenComparesWholeListElements) {
+    using cppress::shared::has_token;
+    EXPECT_TRUE(has_token("close", "close"));
+    EXPECT_TRUE(has_token("keep-alive, Upgrade", "upgrade"));
+    EXPECT_TRUE(has_token(" gzip ,\tCHUNKED ", "chunked"));
+    EXPECT_TRUE(has_token(",,close,", "close"));
+
+    EXPECT_FALSE(has_token("", "close"));
+    EXPECT_FALSE(has_token("closed", "close"));
+    EXPECT_FALSE(has_token("keep-alive, enclose", "close"));
+    EXPECT_FALSE(has_token("upgrade-insecure", "upgrade"));
+    EXPECT_FALSE(has_token("web socket", "websocket"));
+}
+
+namespace {
+/// Byte-at-a-time ASCII case folding, to check the eight-bytes-at-a-time paths against
+char fold(char c, char first) {
+    return c >= first && c <= first + 25 ? static_cast<char>(c ^ 0x20) : c;
+}
+
+std::string fold(std::string_view s, char first) {
+    std::string out(s);
+    for (char& c : out)
+        c = fold(c, first);
+    return out;
+}
+
+/// Every byte value at every position of strings of 1 to 19 bytes, around the 8-byte words
+template <typename Check>
+void for_each_placed_byte(Check check) {
+    for (std::size_t length = 1; length < 20; ++length)
+        for (std::size_t at = 0; at < length; ++at)
+            for (int byte = 0; byte < 256; ++byte) {
+                std::string s(length, 'q');
+                s[at] = static_cast<char>(byte);
+                check(s);
+            }
+}
+}  // namespace
+
+TEST(SharedUtilsTest, CaseFoldingIntoABufferMatchesByteAtATimeFolding) {
+    using cppress::shared::to_lowercase;
+    using cppress::shared::to_uppercase;
+    std::string out = "left over from before, longer than the input";
+    for_each_placed_byte([&out](const std::string& s) {
+        to_lowercase(s, out);
+        ASSERT_EQ(out, fold(s, 'A')) << "byte " << s;
+        to_uppercase(s, out);
+        ASSERT_EQ(out, fold(s, 'a')) << "byte " << s;
+    });
+    to_lowercase("", out);
+    EXPECT_EQ(out, "");
+    to_uppercase("Content-Type: Text/HTML; charset=\xC3\xA9t\xC3\xA9", out);
+    EXPECT_EQ(out, "CONTENT-TYPE: TEXT/HTML; CHARSET=\xC3\xA9T\xC3\xA9");
+    EXPECT_EQ(to_lowercase("X-Forwarded-\xC3\x89"), "x-forwarded-\xC3\x89");
+}
+
+TEST(SharedUtilsTest, CaseInsensitiveComparisonsFoldOnlyAsciiLetters) {
+    using cppress::shared::iequals;
+    for_each_placed_byte([](const std::string& s) {
+        const std::string other = fold(fold(s, 'A'), 'a');
+        ASSERT_TRUE(iequals(s, fold(s, 'A'))) << s;
+        ASSERT_TRUE(iequals(fold(s, 'a'), s)) << s;
+        // a byte that is not a letter only equals itself
+        for (std::size_t i = 0; i < s.size(); ++i) {
+            const unsigned char c = static_cast<unsigned char>(s[i]);
+            if (!std::isalpha(c) || c >= 0x80) {
+                std::string flipped = s;
+                flipped[i] = static_cast<char>(c ^ 0x20);
+                ASSERT_FALSE(iequals(s, flipped)) << static_cast<int>(c);
+            }
+        }
+        ASSERT_TRUE(iequals(s, other));
+    });
+    EXPECT_TRUE(iequals("", ""));
+    EXPECT_FALSE(iequals("content-length", "content-lengt"));
+    EXPECT_TRUE(iequals("ACCEPT-ENCODING", "accept-encoding"));
+    EXPECT_FALSE(iequals("\xC3\xA9t\xC3\xA9", "\xC3\x89T\xC3\x89"));
+    EXPECT_FALSE(iequals("@[\\]^_", "`{|}~\x7f"));
+}
+
+TEST(SharedUtilsTest, CaseInsensitiveSearchAndOrder) {
+    using cppress::shared::icontains;
+    using cppress::shared::iless;
+    EXPECT_TRUE(icontains("text/html; charset=UTF-8", "CHARSET=utf-8"));
+    EXPECT_TRUE(icontains("abcdefghijklmnopq", "HIJKLMNOP"));
+    EXPECT_TRUE(icontains("anything", ""));
+    EXPECT_FALSE(icontains("gzip", "gzip, br"));
+    EXPECT_FALSE(icontains("caf\xC3\xA9", "CAF\xC3\x89"));
+    EXPECT_TRUE(icontains("caf\xC3\xA9!", "CAF\xC3\xA9"));
+
+    const iless less;
+    EXPECT_TRUE(less("apple", "BANANA"));
+    EXPECT_FALSE(less("ABC", "abc"));
+    EXPECT_FALSE(less("abc", "ABC"));
+    EXPECT_TRUE(less("Accept", "accept-encoding"));
+    // letters order as lower case, and bytes above 0x7f after all of ASCII
+    EXPECT_TRUE(less("_", "Z"));
+    EXPECT_TRUE(less("z", "\x80"));
+    EXPECT_FALSE(less("\xC3\xA9", "\xC3\x89"));
+    EXPECT_TRUE(less("\xC3\x89", "\xC3\xA9"));
+}
+
+TEST(SharedUtilsTest, TrimViewPointsIntoItsInput) {
+    using cppress::shared::trim_view;
+    const std::string padded = " \t\r\n value with spaces \r\n\t ";
+    const std::string_view trimmed = trim_view(padded);
+    EXPECT_EQ(trimmed, "value with spaces");
+    EXPECT_EQ(trimmed.data(), padded.data() + 5);
+    EXPECT_EQ(trim_view("x"), "x");
+    EXPECT_EQ(trim_view(" \t\r\n "), "");
+    EXPECT_EQ(trim_view(""), "");
+    EXPECT_EQ(trim_view("\xC2\xA0nbsp\xC2\xA0"), "\xC2\xA0nbsp\xC2\xA0");
+}
+
+TEST(SharedUtilsTest, UrlDecodeIntoABufferCopiesOnlyWhenThereIsAnEscape) {
+    using cppress::shared::url_decode;
+    std::string buffer = "left over";
+    const std::string plain = "/files/report.pdf";
+    const std::string_view same = url_decode(plain, buffer);
+    EXPECT_EQ(same.data(), plain.data());
+    EXPECT_EQ(buffer, "left over");
+
+    EXPECT_EQ(url_decode("a%20b%2Fc", buffer), "a b/c");
+    EXPECT_EQ(url_decode("%C3%a9t%C3%A9", buffer), "\xC3\xA9t\xC3\xA9");
+    EXPECT_EQ(url_decode("%00", buffer), std::string(1, '\0'));
+    // a % without two hex digits after it stays as it is
+    EXPECT_EQ(url_decode("100%", buffer), "100%");
+    EXPECT_EQ(url_decode("%4", buffer), "%4");
+    EXPECT_EQ(url_decode("%zz%4g%%41", buffer), "%zz%4g%A");
+    EXPECT_EQ(url_decode("%\xC3\xA9", buffer), "%\xC3\xA9");
+    EXPECT_EQ(url_decode("a%2", buffer), "a%2");
+    EXPECT_EQ(url_decode(std::string_view("%41%42%43")), "ABC");
+}
+
+TEST(SharedUtilsTest, SanitizePathIntoABufferRemovesDotDotAsRepeatedErasing) {
+    using cppress::shared::sanitize_path;
+    // what erasing ".." until none is left gives
+    auto erased = [](std::string path) {
+        for (std::size_t at; (at = path.find("..")) != std::string::npos;)
+            path.erase(at, 2);
+        return path;
+    };
+    std::string out = "left over from before";
+    for (const std::string path :
+         {"/a/b.html", "/../etc/passwd", "/a/..../b/.../c", "....//....//x", ".", "..", "...",
+          "/caf\xC3\xA9/../\xC3\xA9t\xC3\xA9", "", "/a.b..c...d....e"}) {
+        sanitize_path(path, out);
+        EXPECT_EQ(out, erased(path)) << path;
+        EXPECT_EQ(sanitize_path(path), out);
+    }
+    sanitize_path("/../x", out);
+    EXPECT_EQ(out, "//x");
+}
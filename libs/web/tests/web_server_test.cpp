@@ -1,11 +1,15 @@
 #include <gtest/gtest.h>
 
 #include <algorithm>
+#include <array>
 #include <atomic>
 #include <chrono>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <map>
 #include <memory>
+#include <memory_resource>
 #include <mutex>
 #include <string>
 #include <thread>
@@ -14,7 +18,8 @@
 #include "../includes.hpp"
 #include "libs/html/includes.hpp"
 #include "libs/json/includes.hpp"
-#include "shared/includes/thread_pool.hpp"
+#include "shared/includes/alloc_accounting.hpp"
+#include "shared/includes/startup_snapshot.hpp"
 #include "shared/includes/utils.hpp"
 #include "sockets/includes.hpp"
 
@@ -25,6 +30,26 @@ using namespace cppress::sockets;
 
 #define REQ_RES [[maybe_unused]] std::shared_ptr<request> req, std::shared_ptr<response> res
 
+namespace {
+struct cart_line {
+    std::string sku;
+    int quantity = 0;
+};
+CPPRESS_JSON_FIELDS(cart_line, sku, quantity)
+
+struct cart {
+    std::string customer;
+    std::vector<cart_line> lines;
+};
+CPPRESS_JSON_FIELDS(cart, customer, lines)
+
+struct cart_total {
+    std::string customer;
+    int items = 0;
+};
+CPPRESS_JSON_FIELDS(cart_total, customer, items)
+}  // namespace
+
 /**
  * @brief Test fixture for web server tests
  *
@@ -120,6 +145,12 @@ TEST_F(WebServerTest, BasicServerSetupAndRouting) {
                         user_id = params["id"];
                     if (params.find("postId") != params.end())
                         post_id = params["postId"];
+                    if (req->get_path_param("id") != user_id ||
+                        req->get_path_param("postId") != post_id) {
+                        res->set_status(500, "Internal Server Error");
+                        res->send_text("get_path_param disagrees with get_path_params");
+                        return exit_code::EXIT;
+                    }
 
                     res->set_status(200, "OK");
                     res->send_text("User: " + user_id + ", Post: " + post_id);
@@ -135,6 +166,12 @@ TEST_F(WebServerTest, BasicServerSetupAndRouting) {
                         query = query_params["q"];
                     if (query_params.find("page") != query_params.end())
                         page = query_params["page"];
+                    if (req->get_query_parameter("q") != query ||
+                        req->get_query_value("page") != page) {
+                        res->set_status(500, "Internal Server Error");
+                        res->send_text("get_query_parameter disagrees with get_query_parameters");
+                        return exit_code::EXIT;
+                    }
 
                     res->set_status(200, "OK");
                     res->send_text("Search: " + query + ", Page: " + page);
@@ -1125,3 +1162,1273 @@ TEST_F(WebServerTest, HtmlGenerationWithCppressHtmlLibrary) {
     server->stop();
     server_thread.join();
 }
+
+/**
+ * @brief Test 4: Static variant cache
+ *
+ * This test verifies:
+ * - A fresh .br/.gz sibling is served as it is
+ * - Without a sibling, a variant is encoded once and then reused
+ * - Small files and clients without Accept-Encoding get no variant
+ */
+TEST_F(WebServerTest, StaticVariantsAreEncodedOnce) {
+    auto dir = std::filesystem::temp_directory_path() / "cppress_static_variants";
+    std::filesystem::create_directories(dir);
+    std::string css = (dir / "style.css").string();
+    std::string js = (dir / "app.js").string();
+    std::ofstream(css) << std::string(4096, 'c');
+    std::ofstream(js) << std::string(4096, 'j');
+    std::ofstream(css + ".gz") << "precompressed";
+
+    cppress::http::http_headers gzip_only, none;
+    gzip_only.add("Accept-Encoding", "gzip");
+    static_variant_cache cache;
+
+    auto sibling = cache.find(css, gzip_only);
+    EXPECT_EQ(sibling.coding, cppress::http::content_coding::gzip);
+    ASSERT_NE(sibling.body, nullptr);
+    EXPECT_EQ(*sibling.body, "precompressed");
+    EXPECT_EQ(cache.find(css, none).body, nullptr);
+
+    if (cppress::http::content_coding_available(cppress::http::content_coding::gzip)) {
+        auto first = cache.find(js, gzip_only);
+        ASSERT_NE(first.body, nullptr);
+        EXPECT_LT(first.body->size(), 4096u);
+        EXPECT_EQ(cache.find(js, gzip_only).body, first.body);  // the cached one, not a new one
+    }
+
+    static_variant_cache strict({cppress::http::DEFAULT_COMPRESSION_LEVEL, 8192});
+    EXPECT_EQ(strict.find(js, gzip_only).body, nullptr);
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST_F(WebServerTest, UploadsAreRefusedBeforeTheirBody) {
+    auto server = std::make_shared<cppress::web::server<>>(8083, "127.0.0.1");
+    std::atomic<int> uploads{0};
+
+    server->use_before_body([](REQ_RES) -> exit_code {
+        if (req->get_path() == "/private/upload" && req->get_authorization().empty()) {
+            res->set_status(401, "Unauthorized");
+            return exit_code::EXIT;
+        }
+        return exit_code::CONTINUE;
+    });
+    auto handler = [&uploads](REQ_RES) -> exit_code {
+        uploads++;
+        res->send_text("stored " + std::to_string(req->get_body().size()));
+        return exit_code::EXIT;
+    };
+    server->post("/upload", {handler})->set_max_body_size(16);
+    server->post("/private/upload", {handler});
+
+    std::thread server_thread([&server]() { server->listen([]() {}, [](const std::exception&) {}); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    auto addr = cppress::sockets::socket_address(port(8083), ip_address("127.0.0.1"));
+
+    auto head_of = [&addr](const std::string& head) {
+        cppress::sockets::connection conn;
+        conn.connect(addr);
+        conn.write(data_buffer(head));
+        return conn.read().to_string();
+    };
+
+    // over the route's limit: 413 without the body being sent
+    auto too_large = head_of("POST /upload HTTP/1.1\r\nHost: localhost\r\n"
+                             "Expect: 100-continue\r\nContent-Length: 1000000\r\n\r\n");
+    EXPECT_EQ(too_large.rfind("HTTP/1.1 413", 0), 0u);
+
+    // the before-body middleware refuses it
+    auto unauthorized = head_of("POST /private/upload HTTP/1.1\r\nHost: localhost\r\n"
+                                "Expect: 100-continue\r\nContent-Length: 4\r\n\r\n");
+    EXPECT_EQ(unauthorized.rfind("HTTP/1.1 401", 0), 0u);
+
+    // within the limit: told to continue, then answered
+    cppress::sockets::connection conn;
+    conn.connect(addr);
+    conn.write(data_buffer("POST /upload HTTP/1.1\r\nHost: localhost\r\n"
+                           "Expect: 100-continue\r\nContent-Length: 4\r\n\r\n"));
+    EXPECT_EQ(conn.read().to_string(), "HTTP/1.1 100 Continue\r\n\r\n");
+    conn.write(data_buffer("data"));
+    EXPECT_NE(conn.read().to_string().find("stored 4"), std::string::npos);
+
+    // without Expect the limit is checked once the body is in
+    auto late = head_of("POST /upload HTTP/1.1\r\nHost: localhost\r\nContent-Length: 20\r\n\r\n" +
+                        std::string(20, 'x'));
+    EXPECT_EQ(late.rfind("HTTP/1.1 413", 0), 0u);
+    EXPECT_EQ(uploads.load(), 1);
+
+    server->stop();
+    server_thread.join();
+}
+
+TEST_F(WebServerTest, RequestsPastTheQueueLimitsAreShed) {
+    // one worker, one request may wait, for at most 100 ms
+    auto server = std::make_shared<cppress::web::server<>>(8084, "127.0.0.1", 1);
+    server->limit_request_queue(1, std::chrono::milliseconds(100), std::chrono::seconds(7));
+    std::atomic<int> handled{0};
+    server->get("/slow", {[](REQ_RES) -> exit_code {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(400));
+                    res->send_text("slow");
+                    return exit_code::EXIT;
+                }});
+    server->get("/fast", {[&handled](REQ_RES) -> exit_code {
+                    handled++;
+                    res->send_text("fast");
+                    return exit_code::EXIT;
+                }});
+
+    std::thread server_thread([&server]() { server->listen([]() {}, [](const std::exception&) {}); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    auto addr = cppress::sockets::socket_address(port(8084), ip_address("127.0.0.1"));
+    auto get = [](const std::string& path) {
+        return data_buffer("GET " + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n");
+    };
+
+    // the worker is busy with the first, the second waits, the third finds the queue full
+    cppress::sockets::connection busy, waiting, refused;
+    busy.connect(addr);
+    busy.write(get("/slow"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    waiting.connect(addr);
+    waiting.write(get("/fast"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    refused.connect(addr);
+    refused.write(get("/fast"));
+
+    auto full = refused.read().to_string();
+    EXPECT_EQ(full.rfind("HTTP/1.1 503", 0), 0u);
+    EXPECT_NE(full.find("Retry-After: 7\r\n"), std::string::npos);
+    EXPECT_NE(busy.read().to_string().find("slow"), std::string::npos);
+    // picked up after 400 ms, past its deadline: answered without running the handler
+    EXPECT_EQ(waiting.read().to_string().rfind("HTTP/1.1 503", 0), 0u);
+    EXPECT_EQ(handled.load(), 0);
+
+    cppress::sockets::connection later;
+    later.connect(addr);
+    later.write(get("/fast"));
+    EXPECT_NE(later.read().to_string().find("fast"), std::string::npos);
+    EXPECT_EQ(handled.load(), 1);
+
+    server->stop();
+    server_thread.join();
+}
+
+TEST_F(WebServerTest, InlineRoutesSkipTheWorkerPool) {
+    auto server = std::make_shared<cppress::web::server<>>(8085, "127.0.0.1", 1);
+    std::atomic<bool> slow_running{false};
+    server->get("/slow", {[&slow_running](REQ_RES) -> exit_code {
+                    slow_running = true;
+                    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+                    slow_running = false;
+                    res->send_text("slow");
+                    return exit_code::EXIT;
+                }});
+    server->get("/health/:probe", {[&slow_running](REQ_RES) -> exit_code {
+                    res->send_text(req->get_path_param("probe") +
+                                   (slow_running ? " while busy" : " idle"));
+                    return exit_code::EXIT;
+                }})
+        ->set_inline();
+    auto inline_router = std::make_shared<router<>>();
+    inline_router->get("/cached", {[](REQ_RES) -> exit_code {
+                           res->send_text("cached");
+                           return exit_code::EXIT;
+                       }});
+    inline_router->set_inline();
+    server->use_router(inline_router);
+
+    std::thread server_thread([&server]() { server->listen([]() {}, [](const std::exception&) {}); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    auto addr = cppress::sockets::socket_address(port(8085), ip_address("127.0.0.1"));
+    auto get = [](const std::string& path) {
+        return data_buffer("GET " + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n");
+    };
+
+    // the only worker is asleep in /slow, the inline routes are answered anyway
+    cppress::sockets::connection busy;
+    busy.connect(addr);
+    busy.write(get("/slow"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    cppress::sockets::connection conn;
+    conn.connect(addr);
+    conn.write(get("/health/db"));
+    EXPECT_NE(conn.read().to_string().find("db while busy"), std::string::npos);
+    conn.write(get("/cached"));
+    EXPECT_NE(conn.read().to_string().find("cached"), std::string::npos);
+    EXPECT_NE(busy.read().to_string().find("slow"), std::string::npos);
+
+    server->stop();
+    server_thread.join();
+}
+
+TEST_F(WebServerTest, JsonValuesAreSerializedIntoTheBody) {
+    auto server = std::make_shared<cppress::web::server<>>(8097, "127.0.0.1", 1);
+    server->get("/user", {[](REQ_RES) -> exit_code {
+                    json::json_object user;
+                    user.insert("name", json::maker::make_string("Ada \"Countess\""));
+                    user.insert("id", json::maker::make_number(7));
+                    res->json(user);
+                    return exit_code::EXIT;
+                }});
+    server->post("/echo", {[](REQ_RES) -> exit_code {
+                     auto doc = req->get_json();
+                     res->json(*doc.root().find("user")->to_object());
+                     return exit_code::EXIT;
+                 }});
+
+    std::thread server_thread([&server]() { server->listen([]() {}, [](const std::exception&) {}); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    cppress::sockets::connection conn;
+    conn.connect(cppress::sockets::socket_address(port(8097), ip_address("127.0.0.1")));
+    conn.write(data_buffer("GET /user HTTP/1.1\r\nHost: localhost\r\n\r\n"));
+    std::string response = conn.read().to_string();
+    while (response.find("\r\n\r\n") == std::string::npos ||
+           response.back() != '}')
+        response += conn.read().to_string();
+
+    EXPECT_NE(response.find("CONTENT-TYPE: application/json"), std::string::npos) << response;
+    const std::string body = response.substr(response.find("\r\n\r\n") + 4);
+    EXPECT_NE(response.find("CONTENT-LENGTH: " + std::to_string(body.size())), std::string::npos);
+    auto parsed = json::parse(body);
+    EXPECT_EQ(json::getter::get_string(parsed["name"]), "Ada \"Countess\"");
+    EXPECT_EQ(json::getter::get_number(parsed["id"]), 7);
+
+    const std::string posted = R"({"user": {"name": "Grace"}, "padding": [1, 2, 3]})";
+    conn.write(data_buffer("POST /echo HTTP/1.1\r\nHost: localhost\r\nContent-Type: "
+                           "application/json\r\nContent-Length: " +
+                           std::to_string(posted.size()) + "\r\n\r\n" + posted));
+    response = conn.read().to_string();
+    while (response.find("\r\n\r\n") == std::string::npos || response.back() != '}')
+        response += conn.read().to_string();
+    EXPECT_NE(response.find("\r\n\r\n{\"name\":\"Grace\"}"), std::string::npos) << response;
+
+    server->stop();
+    server_thread.join();
+}
+
+TEST_F(WebServerTest, CookiesAndFormFieldsAreParsedOncePerRequest) {
+    auto server = std::make_shared<cppress::web::server<>>(8098, "127.0.0.1", 1);
+    std::atomic<const void*> split_by_middleware{nullptr};
+    server->use([&split_by_middleware](REQ_RES) -> exit_code {
+        if (req->get_cookie("session").empty()) {
+            res->set_status(401, "Unauthorized");
+            res->send_text("no session");
+            return exit_code::EXIT;
+        }
+        split_by_middleware = req->get_cookie_fields().data();
+        return exit_code::CONTINUE;
+    });
+    server->post("/profile", {[&split_by_middleware](REQ_RES) -> exit_code {
+                     const bool reused = req->get_cookie_fields().data() == split_by_middleware;
+                     res->send_text(std::string(req->get_cookie("session")) + "|" +
+                                    std::string(req->get_cookie("theme")) + "|" +
+                                    std::string(req->get_cookie("ab")) + "|" +
+                                    std::string(req->get_form_value("email")) + "|" +
+                                    std::string(req->get_form_value("name")) + "|" +
+                                    std::to_string(req->get_form_fields().size()) +
+                                    (reused ? "|once" : "|twice"));
+                     return exit_code::EXIT;
+                 }});
+
+    std::thread server_thread([&server]() { server->listen([]() {}, [](const std::exception&) {}); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    auto addr = cppress::sockets::socket_address(port(8098), ip_address("127.0.0.1"));
+    const std::string form = "email=ada%40example.com&name= Ada+L &flag";
+    cppress::sockets::connection conn;
+    conn.connect(addr);
+    conn.write(data_buffer("POST /profile HTTP/1.1\r\nHost: localhost\r\n"
+                           "Cookie: theme=\"dark\"; session=abc123\r\n"
+                           "Cookie: ab=B; session=ignored\r\n"
+                           "Content-Type: Application/X-WWW-Form-Urlencoded; charset=utf-8\r\n"
+                           "Content-Length: " +
+                           std::to_string(form.size()) + "\r\n\r\n" + form));
+    EXPECT_NE(conn.read().to_string().find("abc123|dark|B|ada%40example.com|Ada+L|2|once"),
+              std::string::npos);
+
+    // a body that is not url-encoded has no form fields
+    conn.write(data_buffer("POST /profile HTTP/1.1\r\nHost: localhost\r\n"
+                           "Cookie: session=s2\r\nContent-Type: text/plain\r\n"
+                           "Content-Length: 7\r\n\r\nemail=x"));
+    EXPECT_NE(conn.read().to_string().find("s2|||||0|once"), std::string::npos);
+
+    conn.write(data_buffer("POST /profile HTTP/1.1\r\nHost: localhost\r\nContent-Length: 0\r\n\r\n"));
+    EXPECT_NE(conn.read().to_string().find("401"), std::string::npos);
+
+    server->stop();
+    server_thread.join();
+}
+
+TEST_F(WebServerTest, StreamedJsonBodiesAreReadElementByElement) {
+    /// Sums the ids of an array of records, skipping their payloads
+    struct id_sum : json_handler {
+        bool key(std::string_view name) override {
+            in_id = name == "id";
+            return name != "payload";
+        }
+        void integer(std::int64_t value) override {
+            if (in_id)
+                sum += value;
+        }
+
+        bool in_id = false;
+        std::int64_t sum = 0;
+    };
+    struct import_state {
+        id_sum handler;
+        json_sax_parser parser{handler};
+    };
+
+    auto server = std::make_shared<cppress::web::server<>>(8099, "127.0.0.1", 1);
+    std::atomic<std::int64_t> imported{-1};
+    server->set_body_stream_selector(
+        [&imported](const cppress::http::http_parse_result& head) -> cppress::http::http_body_stream {
+            if (head.uri != "/import")
+                return nullptr;
+            auto state = std::make_shared<import_state>();
+            return [state, &imported](std::string_view piece, bool last) {
+                try {
+                    state->parser.feed(piece);
+                    if (last) {
+                        state->parser.finish();
+                        imported = state->handler.sum;
+                    }
+                } catch (const std::runtime_error&) {
+                    imported = -2;
+                }
+            };
+        });
+    server->post("/import", {[&imported](REQ_RES) -> exit_code {
+                     res->send_text(imported == -2 ? "malformed"
+                                                   : "sum " + std::to_string(imported.load()));
+                     return exit_code::EXIT;
+                 }});
+
+    std::thread server_thread([&server]() { server->listen([]() {}, [](const std::exception&) {}); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    auto addr = cppress::sockets::socket_address(port(8099), ip_address("127.0.0.1"));
+
+    // larger than MAX_BODY_SIZE, never held whole
+    std::string body = "[";
+    std::int64_t expected = 0;
+    for (int i = 0; i < 3000; ++i) {
+        body += std::string(i ? "," : "") + "{\"id\": " + std::to_string(i) +
+                ", \"payload\": {\"id\": 1000000, \"text\": \"" + std::string(40, 'x') + "\"}}";
+        expected += i;
+    }
+    body += "]";
+    ASSERT_GT(body.size(), cppress::http::config::MAX_BODY_SIZE);
+
+    cppress::sockets::connection conn;
+    conn.connect(addr);
+    conn.write(data_buffer("POST /import HTTP/1.1\r\nHost: localhost\r\nContent-Length: " +
+                           std::to_string(body.size()) + "\r\n\r\n" + body));
+    EXPECT_NE(conn.read().to_string().find("sum " + std::to_string(expected)), std::string::npos);
+
+    conn.write(data_buffer("POST /import HTTP/1.1\r\nHost: localhost\r\n"
+                           "Content-Length: 12\r\n\r\n[{\"id\": 1}}]"));
+    EXPECT_NE(conn.read().to_string().find("malformed"), std::string::npos);
+
+    server->stop();
+    server_thread.join();
+}
+
+TEST_F(WebServerTest, LargeJsonIsStreamedInChunksAsItIsWritten) {
+    auto server = std::make_shared<cppress::web::server<>>(8100, "127.0.0.1", 1);
+    server->get("/report", {[](REQ_RES) -> exit_code {
+                    res->stream_json(
+                        [](json_writer& out) {
+                            out.start_array();
+                            for (int i = 0; i < 5000; ++i)
+                                out.start_object().key("row").integer(i).key("label").string(
+                                    "r\"" + std::to_string(i)).end_object();
+                            out.end_array();
+                        },
+                        4096);
+                    return exit_code::EXIT;
+                }});
+
+    std::thread server_thread([&server]() { server->listen([]() {}, [](const std::exception&) {}); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    cppress::sockets::connection conn;
+    conn.connect(cppress::sockets::socket_address(port(8100), ip_address("127.0.0.1")));
+    conn.write(data_buffer("GET /report HTTP/1.1\r\nHost: localhost\r\n\r\n"));
+    std::string response;
+    while (response.find("\r\n0\r\n\r\n") == std::string::npos) {
+        auto piece = conn.read();
+        if (piece.empty())
+            break;
+        response += piece.to_string();
+    }
+    EXPECT_EQ(response.rfind("HTTP/1.1 200", 0), 0u);
+    EXPECT_NE(response.find("application/json"), std::string::npos);
+    EXPECT_NE(response.find("chunked"), std::string::npos);
+
+    // join the chunks and read the value back
+    std::string body;
+    std::size_t at = response.find("\r\n\r\n") + 4;
+    std::size_t chunks = 0;
+    for (;;) {
+        const std::size_t size = std::stoul(response.substr(at), nullptr, 16);
+        at = response.find("\r\n", at) + 2;
+        if (size == 0)
+            break;
+        body.append(response, at, size);
+        at += size + 2;
+        ++chunks;
+    }
+    EXPECT_GT(chunks, 10u);
+    auto doc = json_document::parse(body);
+    ASSERT_EQ(doc.root().size(), 5000u);
+    EXPECT_EQ(doc.root()[4321].find("label")->as_string(), "r\"4321");
+
+    server->stop();
+    server_thread.join();
+}
+
+TEST_F(WebServerTest, TypedHandlersReadAndWriteBoundStructs) {
+    auto server = std::make_shared<cppress::web::server<>>(8101, "127.0.0.1", 1);
+    server->post("/cart", {[](REQ_RES) -> exit_code {
+                     try {
+                         const auto in = req->get_json_as<cart>();
+                         cart_total total{in.customer, 0};
+                         for (const auto& line : in.lines)
+                             total.items += line.quantity;
+                         res->json(total);
+                     } catch (const std::runtime_error&) {
+                         res->set_status(400, "Bad Request");
+                         res->send_text("bad cart");
+                     }
+                     return exit_code::EXIT;
+                 }});
+
+    std::thread server_thread([&server]() { server->listen([]() {}, [](const std::exception&) {}); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    cppress::sockets::connection conn;
+    conn.connect(cppress::sockets::socket_address(port(8101), ip_address("127.0.0.1")));
+    const std::string body =
+        R"({"customer": "ada", "lines": [{"sku": "a", "quantity": 2}, {"sku": "b", "quantity": 3}]})";
+    conn.write(data_buffer("POST /cart HTTP/1.1\r\nHost: localhost\r\nContent-Length: " +
+                           std::to_string(body.size()) + "\r\n\r\n" + body));
+    auto response = conn.read().to_string();
+    EXPECT_NE(response.find("application/json"), std::string::npos);
+    EXPECT_NE(response.find(R"({"customer":"ada","items":5})"), std::string::npos) << response;
+
+    conn.write(data_buffer("POST /cart HTTP/1.1\r\nHost: localhost\r\nContent-Length: 13\r\n\r\n"
+                           R"({"lines": 1})"
+                           " "));
+    EXPECT_NE(conn.read().to_string().find("400"), std::string::npos);
+
+    server->stop();
+    server_thread.join();
+}
+
+TEST_F(WebServerTest, HtmlTreesAreRenderedIntoTheBodyOrStreamed) {
+    auto server = std::make_shared<cppress::web::server<>>(8102, "127.0.0.1", 1);
+    cppress::html::element page("ul");
+    for (int i = 0; i < 2000; ++i)
+        page.add_child(cppress::html::maker::make_element("li", "item " + std::to_string(i)));
+    server->get("/page", {[&page](REQ_RES) -> exit_code {
+                    res->html(page);
+                    return exit_code::EXIT;
+                }});
+    server->get("/stream", {[&page](REQ_RES) -> exit_code {
+                    res->stream_html([&page](cppress::html::html_writer& out) { page.render(out); },
+                                     4096);
+                    return exit_code::EXIT;
+                }});
+
+    std::thread server_thread([&server]() { server->listen([]() {}, [](const std::exception&) {}); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    cppress::sockets::connection conn;
+    conn.connect(cppress::sockets::socket_address(port(8102), ip_address("127.0.0.1")));
+    const std::string expected = page.to_string();
+
+    conn.write(data_buffer("GET /page HTTP/1.1\r\nHost: localhost\r\n\r\n"));
+    std::string response;
+    while (response.size() < expected.size() ||
+           response.compare(response.size() - 5, 5, "</ul>") != 0) {
+        auto piece = conn.read();
+        if (piece.empty())
+            break;
+        response += piece.to_string();
+    }
+    EXPECT_NE(response.find("text/html"), std::string::npos);
+    EXPECT_NE(response.find("CONTENT-LENGTH: " + std::to_string(expected.size())),
+              std::string::npos);
+    EXPECT_EQ(response.substr(response.find("\r\n\r\n") + 4), expected);
+
+    conn.write(data_buffer("GET /stream HTTP/1.1\r\nHost: localhost\r\n\r\n"));
+    response.clear();
+    while (response.find("\r\n0\r\n\r\n") == std::string::npos) {
+        auto piece = conn.read();
+        if (piece.empty())
+            break;
+        response += piece.to_string();
+    }
+    EXPECT_NE(response.find("text/html"), std::string::npos);
+    EXPECT_NE(response.find("chunked"), std::string::npos);
+    std::string body;
+    std::size_t at = response.find("\r\n\r\n") + 4;
+    std::size_t chunks = 0;
+    for (;;) {
+        const std::size_t size = std::stoul(response.substr(at), nullptr, 16);
+        at = response.find("\r\n", at) + 2;
+        if (size == 0)
+            break;
+        body.append(response, at, size);
+        at += size + 2;
+        ++chunks;
+    }
+    EXPECT_GT(chunks, 5u);
+    EXPECT_EQ(body, expected);
+
+    server->stop();
+    server_thread.join();
+}
+
+TEST_F(WebServerTest, CachedFragmentsAreStreamedAsChunksOfTheirOwn) {
+    auto server = std::make_shared<cppress::web::server<>>(8103, "127.0.0.1", 1);
+    cppress::html::fragment_cache fragments;
+    std::atomic<int> renders{0};
+    server->get("/page", {[&](REQ_RES) -> exit_code {
+                    const auto footer = fragments.cache_fragment(
+                        "footer", std::chrono::seconds(10),
+                        [&renders](cppress::html::html_writer& out) {
+                            ++renders;
+                            out.raw("<footer>").raw(std::string(2000, 'f')).raw("</footer>");
+                        });
+                    res->stream_html([&](cppress::html::html_writer& out) {
+                        out.raw("<main>").text(req->get_path()).raw("</main>").fragment(footer);
+                    });
+                    return exit_code::EXIT;
+                }});
+
+    std::thread server_thread([&server]() { server->listen([]() {}, [](const std::exception&) {}); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    cppress::sockets::connection conn;
+    conn.connect(cppress::sockets::socket_address(port(8103), ip_address("127.0.0.1")));
+    for (int i = 0; i < 2; ++i) {
+        conn.write(data_buffer("GET /page HTTP/1.1\r\nHost: localhost\r\n\r\n"));
+        std::string response;
+        while (response.find("\r\n0\r\n\r\n") == std::string::npos) {
+            auto piece = conn.read();
+            if (piece.empty())
+                break;
+            response += piece.to_string();
+        }
+        const std::string body = response.substr(response.find("\r\n\r\n") + 4);
+        EXPECT_EQ(body, "12\r\n<main>/page</main>\r\n7e1\r\n<footer>" + std::string(2000, 'f') +
+                            "</footer>\r\n0\r\n\r\n");
+    }
+    EXPECT_EQ(renders.load(), 1);
+
+    server->stop();
+    server_thread.join();
+}
+
+TEST_F(WebServerTest, DeferredResponsesFreeTheWorker) {
+    auto server = std::make_shared<cppress::web::server<>>(8086, "127.0.0.1", 1);
+    cppress::web::server<>* loops = server.get();
+    server->get("/later", {[loops](REQ_RES) -> exit_code {
+                    res->defer();
+                    loops->run_after(std::chrono::milliseconds(300),
+                                     [res]() { res->send_text("later"); });
+                    return exit_code::EXIT;
+                }});
+    server->get("/now", {[](REQ_RES) -> exit_code {
+                    res->send_text("now");
+                    return exit_code::EXIT;
+                }});
+
+    std::thread server_thread([&server]() { server->listen([]() {}, [](const std::exception&) {}); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    auto addr = cppress::sockets::socket_address(port(8086), ip_address("127.0.0.1"));
+
+    cppress::sockets::connection waiting;
+    waiting.connect(addr);
+    waiting.write(data_buffer("GET /later HTTP/1.1\r\nHost: localhost\r\n\r\n"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    // the only worker is free again while /later waits on its timer
+    cppress::sockets::connection conn;
+    conn.connect(addr);
+    auto asked = std::chrono::steady_clock::now();
+    conn.write(data_buffer("GET /now HTTP/1.1\r\nHost: localhost\r\n\r\n"));
+    EXPECT_NE(conn.read().to_string().find("now"), std::string::npos);
+    EXPECT_LT(std::chrono::steady_clock::now() - asked, std::chrono::milliseconds(200));
+
+    auto later = waiting.read().to_string();
+    EXPECT_EQ(later.rfind("HTTP/1.1 200", 0), 0u);
+    EXPECT_NE(later.find("later"), std::string::npos);
+
+    // a deferred response that does not keep the connection ends it once sent
+    cppress::sockets::connection closing;
+    closing.connect(addr);
+    closing.write(
+        data_buffer("GET /later HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n"));
+    EXPECT_NE(closing.read().to_string().find("later"), std::string::npos);
+    EXPECT_TRUE(closing.read().empty());
+
+    server->stop();
+    server_thread.join();
+}
+
+TEST_F(WebServerTest, CachedRoutesRunTheirHandlerOnce) {
+    auto server = std::make_shared<cppress::web::server<>>(8087, "127.0.0.1", 2);
+    std::atomic<int> runs{0};
+    server->get("/prices", {[&runs](REQ_RES) -> exit_code {
+                    ++runs;
+                    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+                    res->send_text("prices " + req->get_query_parameter("q"));
+                    return exit_code::EXIT;
+                }})
+        ->set_cache({std::chrono::hours(1), std::chrono::milliseconds(0), {"Accept-Encoding"}});
+
+    std::thread server_thread([&server]() { server->listen([]() {}, [](const std::exception&) {}); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    auto addr = cppress::sockets::socket_address(port(8087), ip_address("127.0.0.1"));
+    auto get = [](const std::string& path, const std::string& encoding) {
+        return data_buffer("GET " + path + " HTTP/1.1\r\nHost: localhost\r\nAccept-Encoding: " +
+                           encoding + "\r\n\r\n");
+    };
+
+    // both arrive while the first is computed, the second waits for it
+    cppress::sockets::connection first, second;
+    first.connect(addr);
+    second.connect(addr);
+    first.write(get("/prices?q=1&r=2", "gzip"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    second.write(get("/prices?r=2&q=1", "gzip"));
+    auto computed = first.read().to_string();
+    auto waited = second.read().to_string();
+    EXPECT_NE(computed.find("prices 1"), std::string::npos);
+    EXPECT_NE(waited.find("prices 1"), std::string::npos);
+    EXPECT_NE(waited.find("Connection: keep-alive"), std::string::npos);
+    EXPECT_EQ(runs.load(), 1);
+
+    // the same connection is answered from the cache again, without the handler
+    second.write(get("/prices?q=1&r=2", "gzip"));
+    EXPECT_NE(second.read().to_string().find("prices 1"), std::string::npos);
+    EXPECT_EQ(runs.load(), 1);
+
+    second.write(get("/prices?q=2", "gzip"));
+    EXPECT_NE(second.read().to_string().find("prices 2"), std::string::npos);
+    second.write(get("/prices?q=1&r=2", "br"));
+    EXPECT_NE(second.read().to_string().find("prices 1"), std::string::npos);
+    EXPECT_EQ(runs.load(), 3);
+
+    server->stop();
+    server_thread.join();
+}
+
+TEST_F(WebServerTest, CacheHitsSkipMiddlewareUnlessTheyVaryOnWhatItChecks) {
+    auto server = std::make_shared<cppress::web::server<>>(8107, "127.0.0.1", 1);
+    std::atomic<int> checks{0};
+    server->use([&checks](REQ_RES) -> exit_code {
+        ++checks;
+        if (req->get_authorization() != std::vector<std::string>{"Bearer ok"}) {
+            res->set_status(401, "Unauthorized");
+            return exit_code::EXIT;
+        }
+        return exit_code::CONTINUE;
+    });
+    auto hello = [](REQ_RES) -> exit_code {
+        res->send_text("hello " + req->get_path());
+        return exit_code::EXIT;
+    };
+    server->get("/varied", {hello})
+        ->set_cache({std::chrono::hours(1), std::chrono::milliseconds(0), {"Authorization"}});
+    server->get("/shared", {hello})
+        ->set_cache({std::chrono::hours(1), std::chrono::milliseconds(0), {}});
+
+    std::thread server_thread([&server]() { server->listen([]() {}, [](const std::exception&) {}); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    auto addr = cppress::sockets::socket_address(port(8107), ip_address("127.0.0.1"));
+    cppress::sockets::connection conn;
+    conn.connect(addr);
+    auto get = [&conn](const std::string& path, const std::string& authorization) {
+        conn.write(data_buffer("GET " + path + " HTTP/1.1\r\nHost: localhost\r\n" +
+                               authorization + "\r\n"));
+        return conn.read().to_string();
+    };
+
+    // varying on Authorization, a client without it misses and meets the middleware
+    EXPECT_NE(get("/varied", "Authorization: Bearer ok\r\n").find("200 OK"), std::string::npos);
+    EXPECT_NE(get("/varied", "").find("401"), std::string::npos);
+    EXPECT_EQ(checks.load(), 2);
+
+    // without it the hit is answered before the middleware, to anyone
+    EXPECT_NE(get("/shared", "Authorization: Bearer ok\r\n").find("200 OK"), std::string::npos);
+    EXPECT_NE(get("/shared", "").find("hello /shared"), std::string::npos);
+    EXPECT_EQ(checks.load(), 3);
+
+    server->stop();
+    server_thread.join();
+}
+
+TEST_F(WebServerTest, CachedDeferredRoutesCacheTheBodySentLater) {
+    auto server = std::make_shared<cppress::web::server<>>(8106, "127.0.0.1", 1);
+    cppress::web::server<>* loops = server.get();
+    std::atomic<int> runs{0};
+    server->get("/report", {[loops, &runs](REQ_RES) -> exit_code {
+                    ++runs;
+                    res->defer();
+                    loops->run_after(std::chrono::milliseconds(200),
+                                     [res]() { res->send_text("report ready"); });
+                    return exit_code::EXIT;
+                }})
+        ->set_cache({std::chrono::hours(1), std::chrono::milliseconds(0), {}});
+
+    std::thread server_thread([&server]() { server->listen([]() {}, [](const std::exception&) {}); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    auto addr = cppress::sockets::socket_address(port(8106), ip_address("127.0.0.1"));
+    const data_buffer get("GET /report HTTP/1.1\r\nHost: localhost\r\n\r\n");
+
+    // the waiter gets what the timer sent, not what the handler left on returning
+    cppress::sockets::connection first, second;
+    first.connect(addr);
+    second.connect(addr);
+    first.write(get);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    second.write(get);
+    EXPECT_NE(first.read().to_string().find("report ready"), std::string::npos);
+    EXPECT_NE(second.read().to_string().find("report ready"), std::string::npos);
+
+    // and so does a later hit, from the cache
+    cppress::sockets::connection later;
+    later.connect(addr);
+    later.write(get);
+    const std::string cached = later.read().to_string();
+    EXPECT_EQ(cached.rfind("HTTP/1.1 200", 0), 0u);
+    EXPECT_NE(cached.find("report ready"), std::string::npos);
+    EXPECT_EQ(runs.load(), 1);
+
+    server->stop();
+    server_thread.join();
+}
+
+TEST_F(WebServerTest, MetricsAreRecordedPerRoute) {
+    auto server = std::make_shared<cppress::web::server<>>(8088, "127.0.0.1", 2);
+    server->get("/users/:id", {[](REQ_RES) -> exit_code {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                    res->send_text("user " + req->get_path_param("id"));
+                    return exit_code::EXIT;
+                }});
+    server->use_metrics();
+
+    std::thread server_thread([&server]() { server->listen([]() {}, [](const std::exception&) {}); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    cppress::sockets::connection conn;
+    conn.connect(cppress::sockets::socket_address(port(8088), ip_address("127.0.0.1")));
+    auto get = [&conn](const std::string& path) {
+        conn.write(data_buffer("GET " + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n"));
+        return conn.read().to_string();
+    };
+    get("/users/1");
+    get("/users/2");
+    get("/nothing");
+    // a request is recorded once its handlers returned, which is after its response went out
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    auto snapshot = server->get_metrics()->snapshot();
+    const auto& users = snapshot[std::make_pair("GET", "/users/:id")];
+    EXPECT_EQ(users.requests, 2u);
+    EXPECT_GE(users.handler.quantile(0.5), std::chrono::milliseconds(20));
+    EXPECT_EQ(snapshot[std::make_pair("GET", "<unmatched>")].requests, 1u);
+
+    auto scraped = get("/metrics");
+    EXPECT_NE(scraped.find("text/plain; version=0.0.4"), std::string::npos);
+    EXPECT_NE(scraped.find("cppress_http_requests_total{method=\"GET\",route=\"/users/:id\"} 2"),
+              std::string::npos);
+    EXPECT_NE(scraped.find("cppress_loop_accepts_total 1"), std::string::npos);
+
+    server->stop();
+    server_thread.join();
+}
+
+TEST_F(WebServerTest, AllocationsAreCountedPerRequestPhaseWhenInstrumented) {
+    using cppress::shared::request_phase;
+    auto server = std::make_shared<cppress::web::server<>>(8104, "127.0.0.1", 2);
+    server->get("/items/:id", {[](REQ_RES) -> exit_code {
+                    res->send_text("item " + req->get_path_param("id") + " " + req->get_body());
+                    return exit_code::EXIT;
+                }});
+    server->use_metrics();
+
+    std::thread server_thread([&server]() { server->listen([]() {}, [](const std::exception&) {}); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    cppress::sockets::connection conn;
+    conn.connect(cppress::sockets::socket_address(port(8104), ip_address("127.0.0.1")));
+    auto get = [&conn](const std::string& path) {
+        conn.write(data_buffer("GET " + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n"));
+        return conn.read().to_string();
+    };
+    const auto before = cppress::shared::allocation_snapshot();
+    EXPECT_NE(get("/items/1").find("item 1"), std::string::npos);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    const auto after = cppress::shared::allocation_snapshot();
+    const auto scraped = get("/metrics");
+
+    if (!cppress::shared::alloc_accounting) {
+        EXPECT_EQ(after.requests, 0u);
+        EXPECT_EQ(after[request_phase::handle].allocations, 0u);
+        EXPECT_EQ(scraped.find("cppress_request_phase_"), std::string::npos);
+    } else {
+        EXPECT_EQ(after.requests, before.requests + 1);
+        for (const auto phase : {request_phase::parse, request_phase::route, request_phase::handle,
+                                 request_phase::serialize})
+            EXPECT_GT(after[phase].allocations, before[phase].allocations)
+                << cppress::shared::phase_name(phase);
+        EXPECT_NE(scraped.find("cppress_request_phase_allocations_total{phase=\"handle\"}"),
+                  std::string::npos);
+        EXPECT_NE(scraped.find("cppress_accounted_requests_total"), std::string::npos);
+    }
+
+    server->stop();
+    server_thread.join();
+}
+
+TEST_F(WebServerTest, TracedRequestsJoinTheCallersTrace) {
+    auto server = std::make_shared<cppress::web::server<>>(8089, "127.0.0.1", 2);
+    std::mutex spans_mutex;
+    std::vector<trace_span> spans;
+    server->use_tracing(
+        [&](const std::vector<trace_span>& batch) {
+            std::lock_guard<std::mutex> lock(spans_mutex);
+            spans.insert(spans.end(), batch.begin(), batch.end());
+        },
+        {0.0, 1024, std::chrono::milliseconds(50)});
+    server->use([](std::shared_ptr<request>, std::shared_ptr<response>) -> exit_code {
+        return exit_code::CONTINUE;
+    });
+    server->get("/orders/:id", {[](REQ_RES) -> exit_code {
+                    auto upstream = req->begin_span("inventory");
+                    res->send_text(upstream.traceparent());
+                    return exit_code::EXIT;
+                }});
+
+    std::thread server_thread([&server]() { server->listen([]() {}, [](const std::exception&) {}); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    cppress::sockets::connection conn;
+    conn.connect(cppress::sockets::socket_address(port(8089), ip_address("127.0.0.1")));
+    auto get = [&conn](const std::string& headers) {
+        conn.write(data_buffer("GET /orders/7 HTTP/1.1\r\nHost: localhost\r\n" + headers + "\r\n"));
+        return conn.read().to_string();
+    };
+
+    // not sampled: the caller's context is passed on all the same
+    auto passed = get("traceparent: 00-0af7651916cd43dd8448eb211c80319c-b7ad6b7169203331-00\r\n");
+    EXPECT_NE(passed.find("00-0af7651916cd43dd8448eb211c80319c-"), std::string::npos);
+    EXPECT_NE(passed.find("-00"), std::string::npos);
+    EXPECT_EQ(get("").find("00-"), std::string::npos);
+
+    auto traced = get("traceparent: 00-0af7651916cd43dd8448eb211c80319c-b7ad6b7169203331-01\r\n");
+    EXPECT_NE(traced.find("00-0af7651916cd43dd8448eb211c80319c-"), std::string::npos);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    std::vector<std::string> names;
+    std::array<std::uint8_t, 8> request_span{}, upstream_parent{};
+    {
+        std::lock_guard<std::mutex> lock(spans_mutex);
+        for (const auto& span : spans) {
+            names.push_back(span.name);
+            EXPECT_EQ(span.trace_id[0], 0x0a);
+            if (span.name == "GET /orders/:id") {
+                request_span = span.span_id;
+                EXPECT_EQ(span.parent_id[0], 0xb7);
+            }
+            if (span.name == "inventory")
+                upstream_parent = span.parent_id;
+        }
+    }
+    for (const char* name :
+         {"parse", "queue", "middleware", "handler", "send", "inventory", "GET /orders/:id"})
+        EXPECT_NE(std::find(names.begin(), names.end(), name), names.end()) << name;
+    EXPECT_EQ(names.size(), 7u);
+    EXPECT_EQ(upstream_parent, request_span);
+
+    server->stop();
+    server_thread.join();
+}
+
+TEST_F(WebServerTest, RequestAndResponseShareOneBlockWithItsArena) {
+    auto server = std::make_shared<cppress::web::server<>>(8090, "127.0.0.1", 2);
+    std::atomic<bool> one_block{false}, from_arena{false};
+    server->get("/scratch", {[&](const auto& req, const auto& res) -> exit_code {
+                    one_block = !req.owner_before(res) && !res.owner_before(req);
+                    // the arena sits in front of the request in the block
+                    const char* arena_end = reinterpret_cast<const char*>(req.get());
+                    std::pmr::string text("longer than any small string buffer holds",
+                                          req->scratch());
+                    from_arena = text.data() >= arena_end - sizeof(request_arena) &&
+                                 text.data() < arena_end;
+                    res->send_text(std::string(text));
+                    return exit_code::EXIT;
+                }});
+
+    std::thread server_thread([&server]() { server->listen([]() {}, [](const std::exception&) {}); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    cppress::sockets::connection conn;
+    conn.connect(cppress::sockets::socket_address(port(8090), ip_address("127.0.0.1")));
+    conn.write(data_buffer("GET /scratch HTTP/1.1\r\nHost: localhost\r\n\r\n"));
+    auto reply = conn.read().to_string();
+    EXPECT_NE(reply.find("longer than any small string buffer holds"), std::string::npos);
+    EXPECT_TRUE(one_block);
+    EXPECT_TRUE(from_arena);
+
+    server->stop();
+    server_thread.join();
+}
+
+TEST_F(WebServerTest, RateLimitsRefuseOnTheLoopAndPerRoute) {
+    auto server = std::make_shared<cppress::web::server<>>(8091, "127.0.0.1", 2);
+    auto limits = server->use_rate_limit({0.5, 3});
+    auto reports = std::make_shared<rate_limiter>(rate_limit_options{0.5, 1});
+    std::atomic<int> handled{0};
+    server->get("/hello", {[&](REQ_RES) -> exit_code {
+                    ++handled;
+                    res->send_text(req->get_remote_address());
+                    return exit_code::EXIT;
+                }});
+    server->get("/report", {rate_limit(reports, rate_limit_by_route("report")),
+                            [&](REQ_RES) -> exit_code {
+                                ++handled;
+                                res->send_text("report");
+                                return exit_code::EXIT;
+                            }});
+
+    std::thread server_thread([&server]() { server->listen([]() {}, [](const std::exception&) {}); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    const auto addr = cppress::sockets::socket_address(port(8091), ip_address("127.0.0.1"));
+    cppress::sockets::connection conn;
+    conn.connect(addr);
+    auto get = [&conn](const std::string& path) {
+        conn.write(data_buffer("GET " + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n"));
+        return conn.read().to_string();
+    };
+
+    EXPECT_NE(get("/hello").find("127.0.0.1"), std::string::npos);
+    EXPECT_NE(get("/report").find("report"), std::string::npos);
+    auto refused = get("/report");
+    EXPECT_EQ(refused.rfind("HTTP/1.1 429", 0), 0u) << "the route's own budget is spent";
+    EXPECT_NE(refused.find("Connection: close\r\n"), std::string::npos);
+    EXPECT_TRUE(conn.read().empty()) << "a refusal closes the connection, kept alive or not";
+    EXPECT_EQ(reports->rejected(), 1u);
+
+    // the fourth request of the client is refused before any route runs
+    cppress::sockets::connection again;
+    again.connect(addr);
+    again.write(data_buffer("GET /hello HTTP/1.1\r\nHost: localhost\r\n\r\n"));
+    auto limited = again.read().to_string();
+    EXPECT_EQ(limited.rfind("HTTP/1.1 429", 0), 0u);
+    EXPECT_NE(limited.find("Retry-After: 2\r\n"), std::string::npos);
+    EXPECT_NE(limited.find("Connection: close\r\n"), std::string::npos);
+    EXPECT_TRUE(again.read().empty());
+    EXPECT_EQ(limits->rejected(), 1u);
+    EXPECT_EQ(handled.load(), 2);
+
+    server->stop();
+    server_thread.join();
+}
+
+TEST_F(WebServerTest, FrozenChainsSkipRoutersThatCannotMatch) {
+    auto server = std::make_shared<cppress::web::server<>>(8092, "127.0.0.1", 2);
+    std::atomic<int> base_runs{0}, users_runs{0}, admin_runs{0};
+    server->use([&](const auto&, const auto&) -> exit_code {
+        ++base_runs;
+        return exit_code::CONTINUE;
+    });
+    auto users = std::make_shared<router<>>();
+    users->use([&](const auto&, const auto&) -> exit_code {
+        ++users_runs;
+        return exit_code::CONTINUE;
+    });
+    users->get("/users", {[](REQ_RES) -> exit_code {
+                   res->send_text("users");
+                   return exit_code::EXIT;
+               }});
+    auto admin = std::make_shared<router<>>();
+    admin->use_before_body([&](REQ_RES) -> exit_code {
+        ++admin_runs;
+        res->set_status(401, "Unauthorized");
+        res->send_text("admin only");
+        return exit_code::EXIT;
+    });
+    admin->get("/admin", {[](REQ_RES) -> exit_code {
+                   res->send_text("admin");
+                   return exit_code::EXIT;
+               }});
+    server->use_router(users);
+    server->use_router(admin);
+
+    std::thread server_thread([&server]() { server->listen([]() {}, [](const std::exception&) {}); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    cppress::sockets::connection conn;
+    conn.connect(cppress::sockets::socket_address(port(8092), ip_address("127.0.0.1")));
+    auto get = [&conn](const std::string& path) {
+        conn.write(data_buffer("GET " + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n"));
+        return conn.read().to_string();
+    };
+
+    EXPECT_NE(get("/admin").find("401"), std::string::npos);
+    EXPECT_EQ(users_runs.load(), 0) << "the users router cannot match /admin";
+    EXPECT_NE(get("/users").find("users"), std::string::npos);
+    EXPECT_EQ(admin_runs.load(), 1);
+    EXPECT_EQ(users_runs.load(), 1);
+    EXPECT_EQ(base_runs.load(), 2) << "the base router's middleware runs for every route";
+
+    // unmatched requests still pass every router's middleware, which may answer them
+    EXPECT_NE(get("/admin/unknown").find("401"), std::string::npos);
+    EXPECT_EQ(users_runs.load(), 2);
+
+    // added while serving: run from the lists until frozen again
+    users->get("/late", {compose(
+                            [](const auto&, const auto& res) {
+                                res->add_header("X-Composed", "1");
+                                return exit_code::CONTINUE;
+                            },
+                            [](const auto&, const auto& res) {
+                                res->send_text("late");
+                                return exit_code::EXIT;
+                            })});
+    auto late = get("/late");
+    EXPECT_NE(late.find("X-COMPOSED: 1"), std::string::npos);
+    EXPECT_NE(late.find("late"), std::string::npos);
+    server->freeze();
+    EXPECT_NE(get("/late").find("late"), std::string::npos);
+    EXPECT_EQ(users_runs.load(), 4);
+    EXPECT_EQ(admin_runs.load(), 2);
+
+    server->stop();
+    server_thread.join();
+}
+
+TEST(ComposeTest, StopsAtTheFirstHandlerThatDoesNotContinue) {
+    int ran = 0;
+    auto counting = [&ran](exit_code result) {
+        return [&ran, result](const auto&, const auto&) {
+            ++ran;
+            return result;
+        };
+    };
+    std::shared_ptr<request> req;
+    std::shared_ptr<response> res;
+    request_handler_t<> chain = compose(counting(exit_code::CONTINUE), counting(exit_code::EXIT),
+                                        counting(exit_code::CONTINUE));
+    EXPECT_EQ(chain(req, res), exit_code::EXIT);
+    EXPECT_EQ(ran, 2);
+    EXPECT_EQ(compose(counting(exit_code::CONTINUE))(req, res), exit_code::CONTINUE);
+}
+
+TEST(ObjectPoolTest, ReleasedBlocksAreReused) {
+    struct pooled {
+        std::string text;
+        explicit pooled(std::string text) : text(std::move(text)) {}
+    };
+    pool_allocator<pooled> allocator;
+
+    auto first = std::allocate_shared<pooled>(allocator, "first");
+    const void* block = first.get();
+    first.reset();
+
+    // the control block and the object share one pooled block, handed out again
+    auto second = std::allocate_shared<pooled>(allocator, "second");
+    EXPECT_EQ(second.get(), block);
+    EXPECT_EQ(second->text, "second");
+
+    std::weak_ptr<pooled> weak = second;
+    second.reset();
+    auto third = std::allocate_shared<pooled>(allocator, "third");
+    EXPECT_NE(third.get(), block) << "the block stays taken while a weak_ptr holds it";
+    weak.reset();
+    auto fourth = std::allocate_shared<pooled>(allocator, "fourth");
+    EXPECT_EQ(fourth.get(), block);
+}
+
+TEST_F(WebServerTest, PinnedConnectionsRunTheirRequestsInOrder) {
+    auto server = std::make_shared<cppress::web::server<>>(8093, "127.0.0.1", 4);
+    server->use_worker_affinity();
+    std::mutex mutex;
+    std::vector<std::string> order;
+    std::vector<std::thread::id> ran_on;
+    server->get("/step/:n", {[&](REQ_RES) -> exit_code {
+                    // the first step is the slowest: unpinned, later ones would overtake it
+                    const std::string n = req->get_path_param("n");
+                    if (n == "0")
+                        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        order.push_back(n);
+                        ran_on.push_back(std::this_thread::get_id());
+                    }
+                    res->send_text(n);
+                    return exit_code::EXIT;
+                }});
+
+    std::thread server_thread([&server]() { server->listen([]() {}, [](const std::exception&) {}); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    cppress::sockets::connection conn;
+    conn.connect(cppress::sockets::socket_address(port(8093), ip_address("127.0.0.1")));
+    std::string pipelined;
+    for (int n = 0; n < 4; ++n)
+        pipelined += "GET /step/" + std::to_string(n) + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    conn.write(data_buffer(pipelined));
+
+    std::string responses;
+    auto answered = [&responses]() {
+        std::size_t count = 0;
+        for (auto at = responses.find("HTTP/1.1 200"); at != std::string::npos;
+             at = responses.find("HTTP/1.1 200", at + 1))
+            ++count;
+        return count;
+    };
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (answered() < 4 && std::chrono::steady_clock::now() < deadline)
+        responses += conn.read().to_string();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    EXPECT_EQ(order, (std::vector<std::string>{"0", "1", "2", "3"}));
+    EXPECT_TRUE(std::all_of(ran_on.begin(), ran_on.end(),
+                            [&](std::thread::id id) { return id == ran_on.front(); }));
+
+    server->stop();
+    server_thread.join();
+}
+
+TEST_F(WebServerTest, ProxiedResponsesStreamThroughPooledUpstreams) {
+    auto upstream = std::make_shared<cppress::web::server<>>(8094, "127.0.0.1", 2);
+    upstream->get("/echo/*", {[](REQ_RES) -> exit_code {
+                      res->add_header("X-Internal", "1");
+                      res->add_header("X-Upstream", "a");
+                      res->send_text(req->get_path() +
+                                     " xff=" + std::string(req->get_header_value("X-Forwarded-For")) +
+                                     " gw=" + std::string(req->get_header_value("X-Gateway")) +
+                                     " secret=" + std::string(req->get_header_value("X-Secret")));
+                      return exit_code::EXIT;
+                  }});
+    upstream->post("/echo/*", {[](REQ_RES) -> exit_code {
+                       res->send_text("got " + req->get_body());
+                       return exit_code::EXIT;
+                   }});
+    upstream->get("/stream", {[](REQ_RES) -> exit_code {
+                      res->begin_stream();
+                      res->write_chunk("one ");
+                      res->write_chunk("two");
+                      res->end_stream();
+                      return exit_code::EXIT;
+                  }});
+
+    auto front = std::make_shared<cppress::web::server<>>(8093, "127.0.0.1", 2);
+    proxy_options options;
+    options.strip_prefix = "/api";
+    options.request_headers = {{"X-Gateway", "edge"}};
+    options.remove_request_headers = {"X-Secret"};
+    options.remove_response_headers = {"X-Internal"};
+    auto proxy = std::make_shared<reverse_proxy>(
+        *front, std::vector<proxy_upstream>{{"127.0.0.1", 8094}}, options);
+    front->get("/api/*", {proxy_pass(proxy)});
+    front->post("/api/*", {proxy_pass(proxy)});
+    auto down = std::make_shared<reverse_proxy>(
+        *front, std::vector<proxy_upstream>{{"127.0.0.1", 8095}});
+    front->get("/down", {proxy_pass(down)});
+
+    std::thread upstream_thread([&upstream]() { upstream->listen([]() {}, [](const std::exception&) {}); });
+    std::thread front_thread([&front]() { front->listen([]() {}, [](const std::exception&) {}); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+
+    cppress::sockets::connection conn;
+    conn.connect(cppress::sockets::socket_address(port(8093), ip_address("127.0.0.1")));
+    // reads until the end of the response, chunked or with a Content-Length
+    auto exchange = [&conn](const std::string& message) {
+        conn.write(data_buffer(message));
+        std::string response;
+        for (;;) {
+            const std::size_t head_end = response.find("\r\n\r\n");
+            if (head_end != std::string::npos) {
+                const std::size_t length = response.find("CONTENT-LENGTH: ");
+                if (length != std::string::npos && length < head_end &&
+                    response.size() >= head_end + 4 + std::stoul(response.substr(length + 16)))
+                    break;
+                if (response.find("\r\n0\r\n\r\n", head_end) != std::string::npos)
+                    break;
+            }
+            auto piece = conn.read();
+            if (piece.empty())
+                break;
+            response += piece.to_string();
+        }
+        return response;
+    };
+
+    auto echoed = exchange(
+        "GET /api/echo/x HTTP/1.1\r\nHost: localhost\r\nX-Secret: s\r\nX-Gateway: spoofed\r\n\r\n");
+    EXPECT_EQ(echoed.rfind("HTTP/1.1 200", 0), 0u);
+    EXPECT_NE(echoed.find("/echo/x xff=127.0.0.1 gw=edge secret="), std::string::npos) << echoed;
+    EXPECT_NE(echoed.find("X-UPSTREAM: a"), std::string::npos);
+    EXPECT_EQ(echoed.find("X-INTERNAL"), std::string::npos);
+
+    auto posted = exchange(
+        "POST /api/echo/y HTTP/1.1\r\nHost: localhost\r\nContent-Length: 5\r\n\r\nhello");
+    EXPECT_NE(posted.find("got hello"), std::string::npos) << posted;
+
+    auto streamed = exchange("GET /api/stream HTTP/1.1\r\nHost: localhost\r\n\r\n");
+    EXPECT_NE(streamed.find("TRANSFER-ENCODING: chunked"), std::string::npos) << streamed;
+    EXPECT_EQ(streamed.find("DATE:"), std::string::npos) << "the front server dates it";
+    EXPECT_NE(streamed.find("one "), std::string::npos);
+    EXPECT_NE(streamed.find("two"), std::string::npos);
+
+    auto refused = exchange("GET /down HTTP/1.1\r\nHost: localhost\r\n\r\n");
+    EXPECT_EQ(refused.rfind("HTTP/1.1 502", 0), 0u) << refused;
+    EXPECT_FALSE(down->healthy(0));
+    EXPECT_EQ(proxy->in_flight(0), 0u);
+
+    front->stop();
+    upstream->stop();
+    front_thread.join();
+    upstream_thread.join();
+}
+
+TEST_F(WebServerTest, StartupSnapshotIsWrittenOnceAndReplacedWhenATemplateChanges) {
+    namespace fs = std::filesystem;
+    const fs::path root = fs::temp_directory_path() / "cppress_startup_snapshot";
+    fs::remove_all(root);
+    fs::create_directories(root / "public");
+    std::ofstream(root / "public" / "site.css") << "body{}";
+    std::ofstream(root / "home.html") << "<h1>{{title}}</h1>";
+    const std::string snapshot = (root / "startup.snapshot").string();
+    const std::string page = (root / "home.html").string();
+
+    auto start = [&](int port) {
+        auto server = std::make_shared<cppress::web::server<>>(port, "127.0.0.1", 1);
+        server->use_startup_snapshot(snapshot);
+        server->use_static((root / "public").string(), true);
+        auto home = server->load_template(page);
+        EXPECT_EQ(server->load_template(page), home);
+        server->freeze();
+        return home->render({{"title", "A & B"}});
+    };
+
+    EXPECT_EQ(start(8105), "<h1>A &amp; B</h1>");
+    ASSERT_TRUE(fs::exists(snapshot));
+    auto written = cppress::shared::startup_snapshot::open(snapshot);
+    ASSERT_NE(written, nullptr);
+    EXPECT_EQ(written->size(), 2u);
+    EXPECT_TRUE(written->section("html_template:" + page).has_value());
+
+    // everything current: nothing is built, so the file is left as it is
+    const auto first_write = fs::last_write_time(snapshot);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_EQ(start(8105), "<h1>A &amp; B</h1>");
+    EXPECT_EQ(fs::last_write_time(snapshot), first_write);
+
+    std::ofstream(page) << "<h2>{{title}}!</h2>";
+    EXPECT_FALSE(written->section("html_template:" + page).has_value());
+    EXPECT_EQ(start(8105), "<h2>A &amp; B!</h2>");
+    EXPECT_NE(fs::last_write_time(snapshot), first_write);
+    auto rewritten = cppress::shared::startup_snapshot::open(snapshot);
+    ASSERT_NE(rewritten, nullptr);
+    EXPECT_TRUE(rewritten->section("html_template:" + page).has_value());
+    EXPECT_TRUE(rewritten->section("static_manifest:" + (root / "public").string()).has_value());
+}
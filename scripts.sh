@@ -23,6 +23,10 @@ if [ "$1" = "help" ] || [ "$1" = "-h" ] || [ "$1" = "--help" ]; then
     echo "  test-verbose       - Run tests with verbose output"
     echo "  test-integration   - Run only integration tests"
     echo ""
+    echo "Benchmarks:"
+    echo "  bench [FILTER]     - Build and run cppress-bench, results in build-bench/cppress-bench.json"
+    echo "  bench-alloc [FILTER] - Same, counting allocations and copies per iteration"
+    echo ""
     echo "Code Quality:"
     echo "  format             - Format all source files with clang-format"
     echo "  format-check       - Check formatting without modifying files"
@@ -124,6 +128,38 @@ if [ "$1" = "build" ] || [ -z "$1" ]; then
 fi
 
 
+# ==================== BENCHMARKS ====================
+if [ "$1" = "bench-alloc" ]; then
+    echo "Building microbenchmarks with allocation accounting (Release)..."
+
+    # operator new is replaced in this build, its timings are not comparable to bench's
+    cmake -S . -B build-bench-alloc -DCMAKE_BUILD_TYPE=Release -DBUILD_BENCHMARKS=ON \
+        -DCPPRESS_ALLOC_ACCOUNTING=ON
+    cmake --build build-bench-alloc --target cppress-bench -j$(nproc)
+
+    ./build-bench-alloc/benchmark/cppress-bench \
+        --benchmark_filter="${2:-.}" \
+        --benchmark_counters_tabular=true
+    exit $?
+fi
+
+if [ "$1" = "bench" ]; then
+    echo "Building microbenchmarks (Release)..."
+
+    # a separate tree, benchmarks are only meaningful optimized
+    cmake -S . -B build-bench -DCMAKE_BUILD_TYPE=Release -DBUILD_BENCHMARKS=ON
+    cmake --build build-bench --target cppress-bench -j$(nproc)
+
+    ./build-bench/benchmark/cppress-bench \
+        --benchmark_filter="${2:-.}" \
+        --benchmark_out=build-bench/cppress-bench.json \
+        --benchmark_out_format=json
+    EXIT_CODE=$?
+
+    echo "Results written to build-bench/cppress-bench.json"
+    exit $EXIT_CODE
+fi
+
 # ==================== FORMAT ====================
 if [ "$1" = "format" ]; then
     echo "Formatting code with clang-format (Google style)..."
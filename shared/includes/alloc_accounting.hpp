@@ -0,0 +1,223 @@
+/**
+ * @file alloc_accounting.hpp
+ * @brief Heap allocations and byte copies, counted per request phase in instrumented builds
+ *
+ * Built with -DCPPRESS_ALLOC_ACCOUNTING=ON, cppress counts every heap
+ * allocation (operator new is replaced in cppress_shared_utils) and every
+ * byte copied at the copy points of the request path (data_buffer copies
+ * and string conversions, request bodies returned by value, response
+ * bodies queued by copy). Each count goes to the phase the calling thread
+ * is in: the event loop reads, parses and routes, a worker handles, the
+ * response serializes and writes. A phase_scope sets the phase of its
+ * thread until it ends; the innermost scope wins, so the serialization a
+ * handler starts is counted as serialize, not handle.
+ *
+ * Totals are read with allocation_snapshot() and served with the route
+ * metrics (cppress_request_phase_*); divided by the requests counted,
+ * they give the allocations and copies of an average request, which is
+ * what a zero-copy change should lower. The benchmarks report the same
+ * counters per iteration.
+ *
+ * In a normal build every function here is empty and the counters stay
+ * zero; alloc_accounting tells which build this is.
+ *
+ * @note A sanitizer that replaces operator new cannot be combined with it
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+namespace cppress::shared {
+
+/// Stage of a request a thread is working on
+enum class request_phase : std::uint8_t {
+    none,  ///< Outside any request, e.g. startup or timers
+    read,
+    parse,
+    route,
+    handle,
+    serialize,
+    write
+};
+
+constexpr std::size_t REQUEST_PHASES = 7;
+
+/// @brief Label of a phase in metrics, e.g. "parse"
+constexpr const char* phase_name(request_phase phase) noexcept {
+    constexpr const char* names[REQUEST_PHASES] = {"none",   "read",      "parse", "route",
+                                                   "handle", "serialize", "write"};
+    return names[static_cast<std::size_t>(phase)];
+}
+
+/// Whether this build counts, see CPPRESS_ALLOC_ACCOUNTING
+#if defined(CPPRESS_ALLOC_ACCOUNTING)
+inline constexpr bool alloc_accounting = true;
+#else
+inline constexpr bool alloc_accounting = false;
+#endif
+
+/// What one phase cost since the process started
+struct phase_usage {
+    std::uint64_t allocations = 0;
+    std::uint64_t allocated_bytes = 0;
+    std::uint64_t copies = 0;
+    std::uint64_t copied_bytes = 0;
+};
+
+/// Totals of all threads, living and exited
+struct allocation_report {
+    /// Requests parsed, the divisor for a per-request figure
+    std::uint64_t requests = 0;
+    std::array<phase_usage, REQUEST_PHASES> phases{};
+
+    const phase_usage& operator[](request_phase phase) const noexcept {
+        return phases[static_cast<std::size_t>(phase)];
+    }
+};
+
+namespace accounting {
+/**
+ * @brief Counters of one thread
+ *
+ * Written only by its thread, with plain load and store, so counting
+ * costs no locked instruction; allocation_snapshot() reads them.
+ */
+struct thread_usage {
+    std::array<std::array<std::atomic<std::uint64_t>, 4>, REQUEST_PHASES> counts{};
+    request_phase phase = request_phase::none;
+    thread_usage* next = nullptr;
+
+    thread_usage();
+    ~thread_usage();
+
+    void add(std::size_t field, std::uint64_t amount) noexcept {
+        auto& counter = counts[static_cast<std::size_t>(phase)][field];
+        counter.store(counter.load(std::memory_order_relaxed) + amount,
+                      std::memory_order_relaxed);
+    }
+};
+
+/// Every thread that counted; the counts of exited threads are folded into retired
+struct usage_registry {
+    std::mutex lock;
+    thread_usage* threads = nullptr;
+    std::array<std::array<std::uint64_t, 4>, REQUEST_PHASES> retired{};
+    std::atomic<std::uint64_t> requests{0};
+};
+
+/// Constant-initialized, usable from operator new before main()
+inline usage_registry registry;
+
+/// Set once the thread's counters are destroyed, allocations after that go uncounted
+inline thread_local bool thread_gone = false;
+
+inline thread_local thread_usage this_thread;
+
+inline thread_usage::thread_usage() {
+    std::lock_guard<std::mutex> guard(registry.lock);
+    next = registry.threads;
+    registry.threads = this;
+}
+
+inline thread_usage::~thread_usage() {
+    thread_gone = true;
+    std::lock_guard<std::mutex> guard(registry.lock);
+    for (thread_usage** link = &registry.threads; *link; link = &(*link)->next) {
+        if (*link == this) {
+            *link = next;
+            break;
+        }
+    }
+    for (std::size_t p = 0; p < REQUEST_PHASES; ++p)
+        for (std::size_t f = 0; f < 4; ++f)
+            registry.retired[p][f] += counts[p][f].load(std::memory_order_relaxed);
+}
+
+enum field : std::size_t { ALLOCATIONS, ALLOCATED_BYTES, COPIES, COPIED_BYTES };
+}  // namespace accounting
+
+/// @brief Counts a heap allocation of the calling thread; called by the replaced operator new
+inline void count_allocation([[maybe_unused]] std::size_t bytes) noexcept {
+#if defined(CPPRESS_ALLOC_ACCOUNTING)
+    if (accounting::thread_gone)
+        return;
+    accounting::this_thread.add(accounting::ALLOCATIONS, 1);
+    accounting::this_thread.add(accounting::ALLOCATED_BYTES, bytes);
+#endif
+}
+
+/// @brief Counts bytes copied from one buffer into another
+inline void count_copy([[maybe_unused]] std::size_t bytes) noexcept {
+#if defined(CPPRESS_ALLOC_ACCOUNTING)
+    if (accounting::thread_gone || bytes == 0)
+        return;
+    accounting::this_thread.add(accounting::COPIES, 1);
+    accounting::this_thread.add(accounting::COPIED_BYTES, bytes);
+#endif
+}
+
+/// @brief Counts a request whose head was parsed
+inline void count_request() noexcept {
+#if defined(CPPRESS_ALLOC_ACCOUNTING)
+    accounting::registry.requests.fetch_add(1, std::memory_order_relaxed);
+#endif
+}
+
+/**
+ * @class phase_scope
+ * @brief Puts the calling thread in a phase until the scope ends
+ */
+class phase_scope {
+public:
+    explicit phase_scope([[maybe_unused]] request_phase phase) noexcept {
+#if defined(CPPRESS_ALLOC_ACCOUNTING)
+        if (accounting::thread_gone)
+            return;
+        previous = accounting::this_thread.phase;
+        accounting::this_thread.phase = phase;
+        entered = true;
+#endif
+    }
+
+    phase_scope(const phase_scope&) = delete;
+    phase_scope& operator=(const phase_scope&) = delete;
+
+    ~phase_scope() {
+#if defined(CPPRESS_ALLOC_ACCOUNTING)
+        if (entered && !accounting::thread_gone)
+            accounting::this_thread.phase = previous;
+#endif
+    }
+
+#if defined(CPPRESS_ALLOC_ACCOUNTING)
+private:
+    request_phase previous = request_phase::none;
+    bool entered = false;
+#endif
+};
+
+/**
+ * @brief The counts of every thread so far
+ * @return All zero unless alloc_accounting
+ */
+inline allocation_report allocation_snapshot() {
+    allocation_report report;
+#if defined(CPPRESS_ALLOC_ACCOUNTING)
+    std::lock_guard<std::mutex> guard(accounting::registry.lock);
+    std::array<std::array<std::uint64_t, 4>, REQUEST_PHASES> sums = accounting::registry.retired;
+    for (auto* t = accounting::registry.threads; t; t = t->next)
+        for (std::size_t p = 0; p < REQUEST_PHASES; ++p)
+            for (std::size_t f = 0; f < 4; ++f)
+                sums[p][f] += t->counts[p][f].load(std::memory_order_relaxed);
+    for (std::size_t p = 0; p < REQUEST_PHASES; ++p)
+        report.phases[p] = {sums[p][0], sums[p][1], sums[p][2], sums[p][3]};
+    report.requests = accounting::registry.requests.load(std::memory_order_relaxed);
+#endif
+    return report;
+}
+}  // namespace cppress::shared
@@ -0,0 +1,658 @@
+/**
+ * @file cache.hpp
+ * @brief Bounded concurrent cache with W-TinyLFU admission
+ *
+ * Keys are spread over lock-striped shards, each an independent cache
+ * with its own lock, so threads working on different keys rarely meet.
+ * A hit takes its shard's lock shared, copies the value's shared_ptr and
+ * notes the access in a small buffer; the bookkeeping of the eviction
+ * policy is replayed from that buffer by the next thread that holds the
+ * lock exclusively. Reads of one shard therefore run side by side, and a
+ * value, immutable once stored, is used without any lock at all.
+ *
+ * Eviction follows W-TinyLFU (Einziger, Friedman and Manes): new entries
+ * enter a small LRU window; an entry leaving the window replaces the
+ * least recently used entry of the main space only if its keys were asked
+ * for more often, as counted by a compact frequency sketch that also
+ * counts misses and halves itself now and then to forget old popularity.
+ * A scan of one-off keys thus goes through the window without flushing
+ * the entries that keep being used. The main space is a segmented LRU: an
+ * entry hit again moves from probation to the protected segment.
+ *
+ * Capacity is a cost budget, e.g. bytes with a weigher returning a value's
+ * size; entries may also expire after a time to live.
+ *
+ * get_or_load() and get_async() coalesce loads: while a key is being
+ * loaded, other callers asking for it wait for that load instead of
+ * starting their own.
+ *
+ * Example usage:
+ * ```cpp
+ * cache<std::string, std::string>::options options;
+ * options.capacity = 64 * 1024 * 1024;
+ * options.weigh = [](const std::string&, const std::string& body) { return body.size(); };
+ * options.ttl = std::chrono::seconds(30);
+ * cache<std::string, std::string> pages(options);
+ * auto page = pages.get_or_load(path, [&] { return render(path); });
+ * ```
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace cppress::shared {
+
+/**
+ * @class cache
+ * @brief Maps keys to shared immutable values within a cost budget
+ *
+ * Thread-safe. Values are handed out as shared_ptr<const V>, so one the
+ * cache drops stays valid for the callers still holding it.
+ */
+template <typename K, typename V, typename Hash = std::hash<K>,
+          typename KeyEqual = std::equal_to<K>>
+class cache {
+public:
+    using value_ptr = std::shared_ptr<const V>;
+    using clock = std::chrono::steady_clock;
+
+    /// Cost of an entry, e.g. its size in bytes
+    using weigher = std::function<std::size_t(const K&, const V&)>;
+
+    struct options {
+        /// Total cost of the entries held
+        std::size_t capacity = 1024;
+
+        /// Number of shards, rounded up to a power of two; 0 picks four per core, at most 64
+        std::size_t shards = 0;
+
+        /// How long an entry is returned after it was stored, 0 for ever
+        std::chrono::milliseconds ttl{0};
+
+        /// Cost of each entry; unset, every entry costs 1
+        weigher weigh;
+    };
+
+    /// Counters since construction, summed over the shards
+    struct statistics {
+        std::uint64_t hits = 0;
+        std::uint64_t misses = 0;
+        /// Loads run by get_or_load() and get_async(), not those they waited for
+        std::uint64_t loads = 0;
+        /// Entries dropped to make room, including candidates refused by admission
+        std::uint64_t evictions = 0;
+        /// Entries refused because they cost more than a shard holds
+        std::uint64_t rejections = 0;
+        std::size_t cost = 0;
+        std::size_t entries = 0;
+    };
+
+    /// @param capacity Entries held, each costing 1
+    explicit cache(std::size_t capacity) : cache(with_capacity(capacity)) {}
+
+    explicit cache(options o) : weigh(std::move(o.weigh)), ttl(o.ttl) {
+        const std::size_t cores = std::max(1u, std::thread::hardware_concurrency());
+        std::size_t count = o.shards != 0 ? o.shards : std::min<std::size_t>(64, 4 * cores);
+        std::size_t rounded = 1;
+        while (rounded < count)
+            rounded *= 2;
+        // shards too small to hold a window and a main space are merged
+        while (rounded > 1 && o.capacity / rounded < 16)
+            rounded /= 2;
+        shard_mask = rounded - 1;
+        shards.reset(new shard[rounded]);
+        const std::size_t per_shard = std::max<std::size_t>(1, o.capacity / rounded);
+        for (std::size_t i = 0; i < rounded; ++i)
+            shards[i].configure(per_shard);
+    }
+
+    cache(const cache&) = delete;
+    cache& operator=(const cache&) = delete;
+
+    /**
+     * @brief The value of a key
+     * @return The value, nullptr if the key is missing or expired
+     */
+    value_ptr get(const K& key) {
+        const std::size_t h = Hash{}(key);
+        shard& s = shard_of(h);
+        value_ptr found;
+        bool full;
+        {
+            std::shared_lock<std::shared_mutex> lock(s.mutex);
+            auto it = s.map.find(key);
+            node* n = it != s.map.end() && !expired(it->second, clock::now()) ? &it->second
+                                                                              : nullptr;
+            if (n)
+                found = n->value;
+            full = !s.record(h, n);
+        }
+        (found ? s.hits : s.misses).fetch_add(1, std::memory_order_relaxed);
+        if (full && s.mutex.try_lock()) {
+            s.drain();
+            s.mutex.unlock();
+        }
+        return found;
+    }
+
+    /**
+     * @brief Stores a value, replacing the key's current one
+     * @param cost Cost of the entry; by default the weigher's, or 1
+     * @param time_to_live Expiry of the entry; by default the cache's ttl
+     * @return false if the entry costs more than a shard holds and was not stored
+     */
+    bool put(const K& key, V value) {
+        const std::size_t cost = weigh ? weigh(key, value) : 1;
+        return put(key, std::make_shared<const V>(std::move(value)), cost, ttl);
+    }
+
+    /// @brief Stores a shared value with an explicit cost and time to live, see put()
+    bool put(const K& key, value_ptr value, std::size_t cost,
+             std::chrono::milliseconds time_to_live) {
+        const std::size_t h = Hash{}(key);
+        shard& s = shard_of(h);
+        std::unique_lock<std::shared_mutex> lock(s.mutex);
+        s.drain();
+        return s.insert(key, h, std::move(value), cost, expiry(time_to_live));
+    }
+
+    /**
+     * @brief The value of a key, loaded and stored if it is missing
+     * @param load Callable returning a V; runs on this thread, outside any lock
+     * @return The value, shared with the cache
+     * @throws Whatever load throws, also to the callers waiting for that load
+     *
+     * Callers asking for a key while it loads wait for that load.
+     */
+    template <typename Loader>
+    value_ptr get_or_load(const K& key, Loader&& load) {
+        if (value_ptr hit = get(key))
+            return hit;
+        std::shared_ptr<std::promise<value_ptr>> mine;
+        std::uint64_t id = 0;
+        std::shared_future<value_ptr> result = begin_load(key, mine, id);
+        if (mine)
+            run_load(key, id, *mine, load);
+        return result.get();
+    }
+
+    /**
+     * @brief The value of a key, loaded in the background if it is missing
+     * @param load Callable returning a V
+     * @param execute Callable taking a std::function<void()> and running it,
+     *        e.g. by submitting it to a thread_pool; called at most once, and
+     *        only when no load of the key is in progress
+     * @return A future of the value, ready at once on a hit
+     */
+    template <typename Loader, typename Executor>
+    std::shared_future<value_ptr> get_async(const K& key, Loader load, Executor&& execute) {
+        if (value_ptr hit = get(key)) {
+            std::promise<value_ptr> ready;
+            ready.set_value(std::move(hit));
+            return ready.get_future().share();
+        }
+        std::shared_ptr<std::promise<value_ptr>> mine;
+        std::uint64_t id = 0;
+        std::shared_future<value_ptr> result = begin_load(key, mine, id);
+        if (mine) {
+            std::function<void()> job = [this, key, id, mine, load = std::move(load)]() mutable {
+                run_load(key, id, *mine, load);
+            };
+            execute(std::move(job));
+        }
+        return result;
+    }
+
+    /**
+     * @brief Drops a key
+     * @return true if an entry was dropped
+     *
+     * A load of the key in progress still completes for its callers, but
+     * its value is not stored: it may predate the change.
+     */
+    bool erase(const K& key) {
+        shard& s = shard_of(Hash{}(key));
+        std::unique_lock<std::shared_mutex> lock(s.mutex);
+        s.drain();
+        s.loading.erase(key);
+        auto it = s.map.find(key);
+        if (it == s.map.end())
+            return false;
+        s.remove(it);
+        return true;
+    }
+
+    /// @brief Drops every entry, and what loads in progress produce, as erase()
+    void clear() {
+        for (std::size_t i = 0; i <= shard_mask; ++i) {
+            shard& s = shards[i];
+            std::unique_lock<std::shared_mutex> lock(s.mutex);
+            s.drain();
+            s.loading.clear();
+            while (!s.map.empty())
+                s.remove(s.map.begin());
+        }
+    }
+
+    /**
+     * @brief Drops the expired entries now rather than as they are reached
+     * @return Number of entries dropped
+     */
+    std::size_t purge_expired() {
+        std::size_t purged = 0;
+        const auto now = clock::now();
+        for (std::size_t i = 0; i <= shard_mask; ++i) {
+            shard& s = shards[i];
+            std::unique_lock<std::shared_mutex> lock(s.mutex);
+            s.drain();
+            for (auto it = s.map.begin(); it != s.map.end();) {
+                auto next = std::next(it);
+                if (expired(it->second, now)) {
+                    s.remove(it);
+                    ++purged;
+                }
+                it = next;
+            }
+        }
+        return purged;
+    }
+
+    /// @brief Total cost of the entries held
+    std::size_t cost() const {
+        std::size_t total = 0;
+        for (std::size_t i = 0; i <= shard_mask; ++i) {
+            std::shared_lock<std::shared_mutex> lock(shards[i].mutex);
+            total += shards[i].cost;
+        }
+        return total;
+    }
+
+    /// @brief Number of entries held, expired ones not yet dropped included
+    std::size_t size() const {
+        std::size_t total = 0;
+        for (std::size_t i = 0; i <= shard_mask; ++i) {
+            std::shared_lock<std::shared_mutex> lock(shards[i].mutex);
+            total += shards[i].map.size();
+        }
+        return total;
+    }
+
+    statistics stats() const {
+        statistics out;
+        for (std::size_t i = 0; i <= shard_mask; ++i) {
+            const shard& s = shards[i];
+            out.hits += s.hits.load(std::memory_order_relaxed);
+            out.misses += s.misses.load(std::memory_order_relaxed);
+            out.loads += s.loads.load(std::memory_order_relaxed);
+            std::shared_lock<std::shared_mutex> lock(s.mutex);
+            out.evictions += s.evictions;
+            out.rejections += s.rejections;
+            out.cost += s.cost;
+            out.entries += s.map.size();
+        }
+        return out;
+    }
+
+private:
+    enum class segment : std::uint8_t { window, probation, protect };
+
+    struct node {
+        value_ptr value;
+        std::size_t cost = 0;
+        std::size_t hash = 0;
+        clock::time_point expires = clock::time_point::max();
+        segment where = segment::window;
+        const K* key = nullptr;
+        node* prev = nullptr;
+        node* next = nullptr;
+    };
+
+    /// Circular list with a sentinel, most recently used at the front
+    struct lru {
+        node head;
+        std::size_t cost = 0;
+
+        lru() { head.prev = head.next = &head; }
+        bool empty() const { return head.next == &head; }
+        node* back() const { return head.prev; }
+
+        void push_front(node* n) {
+            n->prev = &head;
+            n->next = head.next;
+            head.next->prev = n;
+            head.next = n;
+            cost += n->cost;
+        }
+        void unlink(node* n) {
+            n->prev->next = n->next;
+            n->next->prev = n->prev;
+            cost -= n->cost;
+        }
+    };
+
+    /**
+     * Count-min sketch of 4-bit counters, four rows; every counter is
+     * halved once ten times as many accesses as there are counters per
+     * row were counted
+     */
+    class frequency_sketch {
+    public:
+        void resize(std::size_t entries) {
+            std::size_t words = 1;
+            while (words * 16 < entries && words < (1u << 9))
+                words *= 2;
+            table.assign(words * 4, 0);
+            mask = words * 16 - 1;
+            sample = words * 16 * 10;
+            additions = 0;
+        }
+
+        void increment(std::size_t hash) {
+            bool added = false;
+            for (unsigned row = 0; row < 4; ++row) {
+                std::uint64_t& word = table[row * (table.size() / 4) + (index(hash, row) >> 4)];
+                const unsigned shift = (index(hash, row) & 15) * 4;
+                if (((word >> shift) & 0xf) != 0xf) {
+                    word += std::uint64_t(1) << shift;
+                    added = true;
+                }
+            }
+            if (added && ++additions >= sample) {
+                for (std::uint64_t& word : table)
+                    word = (word >> 1) & 0x7777777777777777ull;
+                additions /= 2;
+            }
+        }
+
+        unsigned frequency(std::size_t hash) const {
+            unsigned least = 15;
+            for (unsigned row = 0; row < 4; ++row) {
+                const std::uint64_t word =
+                    table[row * (table.size() / 4) + (index(hash, row) >> 4)];
+                least = std::min(least, unsigned((word >> ((index(hash, row) & 15) * 4)) & 0xf));
+            }
+            return least;
+        }
+
+    private:
+        std::size_t index(std::size_t hash, unsigned row) const {
+            static constexpr std::uint64_t seeds[4] = {
+                0x9e3779b97f4a7c15ull, 0xc2b2ae3d27d4eb4full, 0x165667b19e3779f9ull,
+                0x27d4eb2f165667c5ull};
+            std::uint64_t h = static_cast<std::uint64_t>(hash) + seeds[row];
+            h *= seeds[(row + 1) & 3];
+            h ^= h >> 32;
+            return static_cast<std::size_t>(h) & mask;
+        }
+
+        std::vector<std::uint64_t> table;
+        std::size_t mask = 0;
+        std::size_t sample = 0;
+        std::size_t additions = 0;
+    };
+
+    /// A load in progress; id tells it from a later one of the same key
+    struct pending_load {
+        std::shared_future<value_ptr> result;
+        std::uint64_t id;
+    };
+
+    struct shard {
+        /// Accesses noted by readers between two drains; more are not replayed
+        static constexpr std::size_t READ_BUFFER = 64;
+
+        mutable std::shared_mutex mutex;
+        std::unordered_map<K, node, Hash, KeyEqual> map;
+        lru window;
+        lru probation;
+        lru protect;
+        frequency_sketch sketch;
+        std::size_t capacity = 0;
+        std::size_t window_capacity = 0;
+        std::size_t protect_capacity = 0;
+        std::size_t cost = 0;
+        std::uint64_t evictions = 0;
+        std::uint64_t rejections = 0;
+
+        /// Written by readers holding the lock shared, each in the slot it claimed
+        std::atomic<std::size_t> reads{0};
+        std::array<std::pair<std::size_t, node*>, READ_BUFFER> read_buffer;
+
+        std::unordered_map<K, pending_load, Hash, KeyEqual> loading;
+        std::uint64_t next_load = 0;
+
+        alignas(64) std::atomic<std::uint64_t> hits{0};
+        std::atomic<std::uint64_t> misses{0};
+        std::atomic<std::uint64_t> loads{0};
+
+        void configure(std::size_t cost_capacity) {
+            capacity = cost_capacity;
+            window_capacity = std::max<std::size_t>(1, capacity / 100);
+            protect_capacity = (capacity - std::min(capacity, window_capacity)) * 4 / 5;
+            sketch.resize(std::min<std::size_t>(capacity, 1u << 16));
+        }
+
+        /// Notes an access, node null for a miss; false once the buffer is full. Lock held shared
+        bool record(std::size_t hash, node* n) {
+            const std::size_t slot = reads.fetch_add(1, std::memory_order_relaxed);
+            if (slot >= READ_BUFFER)
+                return false;
+            read_buffer[slot] = {hash, n};
+            return slot + 1 < READ_BUFFER;
+        }
+
+        /// Replays the noted accesses; lock held exclusively, so no reader writes the buffer
+        void drain() {
+            const std::size_t count =
+                std::min(reads.load(std::memory_order_relaxed), READ_BUFFER);
+            for (std::size_t i = 0; i < count; ++i) {
+                sketch.increment(read_buffer[i].first);
+                if (node* n = read_buffer[i].second)
+                    touch(n);
+            }
+            reads.store(0, std::memory_order_relaxed);
+        }
+
+        /// Moves a hit entry up its segment, promoting it out of probation
+        void touch(node* n) {
+            list_of(n->where).unlink(n);
+            if (n->where == segment::probation) {
+                n->where = segment::protect;
+                protect.push_front(n);
+                // the protected segment overflows into probation
+                while (protect.cost > protect_capacity && protect.back() != n) {
+                    node* demoted = protect.back();
+                    protect.unlink(demoted);
+                    demoted->where = segment::probation;
+                    probation.push_front(demoted);
+                }
+            } else {
+                list_of(n->where).push_front(n);
+            }
+        }
+
+        lru& list_of(segment where) {
+            return where == segment::window ? window
+                                            : where == segment::probation ? probation : protect;
+        }
+
+        bool insert(const K& key, std::size_t hash, value_ptr value, std::size_t entry_cost,
+                    clock::time_point expires) {
+            sketch.increment(hash);
+            auto it = map.find(key);
+            if (entry_cost > capacity) {
+                ++rejections;
+                if (it != map.end())
+                    remove(it);
+                return false;
+            }
+            if (it != map.end()) {
+                node& n = it->second;
+                list_of(n.where).unlink(&n);
+                cost -= n.cost;
+                n.value = std::move(value);
+                n.cost = entry_cost;
+                n.expires = expires;
+                list_of(n.where).push_front(&n);
+                cost += n.cost;
+            } else {
+                it = map.emplace(key, node()).first;
+                node& n = it->second;
+                n.key = &it->first;
+                n.value = std::move(value);
+                n.cost = entry_cost;
+                n.hash = hash;
+                n.expires = expires;
+                n.where = segment::window;
+                window.push_front(&n);
+                cost += n.cost;
+            }
+            evict();
+            return true;
+        }
+
+        /**
+         * Moves the window's overflow into the main space, each candidate
+         * admitted over the probation victims only if it is more frequent
+         */
+        void evict() {
+            while (window.cost > window_capacity && !window.empty()) {
+                node* candidate = window.back();
+                window.unlink(candidate);
+                candidate->where = segment::probation;
+                probation.push_front(candidate);
+                const unsigned wanted = sketch.frequency(candidate->hash);
+                while (cost > capacity) {
+                    node* victim = !probation.empty() && probation.back() != candidate
+                                       ? probation.back()
+                                       : !protect.empty() ? protect.back() : nullptr;
+                    if (!victim || (!expired_now(victim) &&
+                                    sketch.frequency(victim->hash) >= wanted)) {
+                        drop(candidate);
+                        break;
+                    }
+                    drop(victim);
+                }
+            }
+            // a window larger than the budget, e.g. after one costly entry
+            while (cost > capacity && !window.empty())
+                drop(window.back());
+        }
+
+        static bool expired_now(const node* n) {
+            return n->expires != clock::time_point::max() && clock::now() >= n->expires;
+        }
+
+        void drop(node* n) {
+            ++evictions;
+            remove(map.find(*n->key));
+        }
+
+        void remove(typename std::unordered_map<K, node, Hash, KeyEqual>::iterator it) {
+            node& n = it->second;
+            list_of(n.where).unlink(&n);
+            cost -= n.cost;
+            map.erase(it);
+        }
+    };
+
+    static options with_capacity(std::size_t capacity) {
+        options o;
+        o.capacity = capacity;
+        return o;
+    }
+
+    shard& shard_of(std::size_t hash) const {
+        // the high bits, std::hash of an integer is the integer itself
+        const std::uint64_t mixed = static_cast<std::uint64_t>(hash) * 0x9e3779b97f4a7c15ull;
+        return shards[static_cast<std::size_t>(mixed >> 40) & shard_mask];
+    }
+
+    static bool expired(const node& n, clock::time_point now) {
+        return n.expires != clock::time_point::max() && now >= n.expires;
+    }
+
+    static clock::time_point expiry(std::chrono::milliseconds time_to_live) {
+        return time_to_live.count() > 0 ? clock::now() + time_to_live : clock::time_point::max();
+    }
+
+    /// Joins the key's load in progress, or registers the caller's (mine set) if there is none
+    std::shared_future<value_ptr> begin_load(const K& key,
+                                             std::shared_ptr<std::promise<value_ptr>>& mine,
+                                             std::uint64_t& id) {
+        shard& s = shard_of(Hash{}(key));
+        std::unique_lock<std::shared_mutex> lock(s.mutex);
+        s.drain();
+        auto hit = s.map.find(key);
+        if (hit != s.map.end() && !expired(hit->second, clock::now())) {
+            std::promise<value_ptr> ready;
+            ready.set_value(hit->second.value);
+            return ready.get_future().share();
+        }
+        auto running = s.loading.find(key);
+        if (running != s.loading.end())
+            return running->second.result;
+        mine = std::make_shared<std::promise<value_ptr>>();
+        id = ++s.next_load;
+        std::shared_future<value_ptr> result = mine->get_future().share();
+        s.loading.emplace(key, pending_load{result, id});
+        return result;
+    }
+
+    /// Runs a registered load, stores its value unless the key was erased meanwhile
+    template <typename Loader>
+    void run_load(const K& key, std::uint64_t id, std::promise<value_ptr>& promise,
+                  Loader& load) {
+        const std::size_t h = Hash{}(key);
+        shard& s = shard_of(h);
+        s.loads.fetch_add(1, std::memory_order_relaxed);
+        value_ptr value;
+        std::size_t entry_cost = 1;
+        try {
+            V loaded = load();
+            entry_cost = weigh ? weigh(key, loaded) : 1;
+            value = std::make_shared<const V>(std::move(loaded));
+        } catch (...) {
+            {
+                std::unique_lock<std::shared_mutex> lock(s.mutex);
+                auto it = s.loading.find(key);
+                if (it != s.loading.end() && it->second.id == id)
+                    s.loading.erase(it);
+            }
+            promise.set_exception(std::current_exception());
+            return;
+        }
+        {
+            std::unique_lock<std::shared_mutex> lock(s.mutex);
+            s.drain();
+            auto it = s.loading.find(key);
+            if (it != s.loading.end() && it->second.id == id) {
+                s.loading.erase(it);
+                s.insert(key, h, value, entry_cost, expiry(ttl));
+            }
+        }
+        promise.set_value(std::move(value));
+    }
+
+    std::unique_ptr<shard[]> shards;
+    std::size_t shard_mask = 0;
+    const weigher weigh;
+    const std::chrono::milliseconds ttl;
+};
+}  // namespace cppress::shared
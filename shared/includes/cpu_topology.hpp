@@ -0,0 +1,134 @@
+/**
+ * @file cpu_topology.hpp
+ * @brief NUMA nodes and cache domains of the machine, and thread placement over them
+ *
+ * On a multi-socket host the scheduler moves threads between sockets, and
+ * memory allocated by a thread on one node is then read across the
+ * interconnect. A cpu_placement keeps each event loop, the workers it
+ * hands requests to, and the buffers it receives into on one last-level
+ * cache domain: the loop is pinned to one CPU of the domain, its workers
+ * to the domain's other CPUs, and buffers allocated by pinned threads land
+ * on the local node (Linux places a page on the node of the thread that
+ * first touches it).
+ *
+ * @code
+ * auto plan = cpu_topology::system().place(4, 16);
+ * server.set_reactor_cpus(plan.reactor_cpus);
+ * thread_pool workers(16, plan.worker_cpus);
+ * @endcode
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__linux__) || defined(__linux)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace cppress::shared {
+
+/**
+ * @brief Where each event loop and worker thread runs
+ *
+ * Produced by cpu_topology::place(); every list is empty when nothing is pinned.
+ */
+struct cpu_placement {
+    /// CPU of each reactor, one per reactor
+    std::vector<std::vector<int>> reactor_cpus;
+
+    /// CPUs of each worker: the CPUs of its cache domain not taken by a reactor
+    std::vector<std::vector<int>> worker_cpus;
+
+    /// Workers sharing each reactor's cache domain, empty if none does
+    std::vector<std::vector<std::size_t>> reactor_workers;
+
+    bool empty() const noexcept { return reactor_cpus.empty() && worker_cpus.empty(); }
+};
+
+/**
+ * @class cpu_topology
+ * @brief The usable CPUs, grouped by NUMA node and last-level cache
+ */
+class cpu_topology {
+public:
+    /// CPUs of one node sharing a last-level cache (an L3, or a CCX on AMD parts)
+    struct domain {
+        int node = 0;
+        std::vector<int> cpus;
+    };
+
+    /**
+     * @brief The topology of this machine, read once
+     *
+     * Only CPUs the process may run on (its affinity mask, e.g. from
+     * taskset or a cgroup) are listed. Without sysfs every CPU forms a
+     * single domain on node 0.
+     */
+    static const cpu_topology& system();
+
+    /**
+     * @brief Reads a topology from a sysfs tree
+     * @param root Directory holding cpu/ and node/, normally "/sys/devices/system"
+     * @return The online CPUs grouped into domains, one domain of CPU 0 if nothing is readable
+     */
+    static cpu_topology from_sysfs(const std::string& root);
+
+    /**
+     * @brief Parses a kernel CPU list such as "0-3,8,10-11"
+     * @return The CPUs in ascending order; malformed parts are skipped
+     */
+    static std::vector<int> parse_cpu_list(std::string_view list);
+
+    /// @param domains Cache domains, each with at least one CPU
+    explicit cpu_topology(std::vector<domain> domains);
+
+    const std::vector<domain>& domains() const noexcept { return groups; }
+
+    /// @brief Number of distinct NUMA nodes
+    std::size_t node_count() const noexcept;
+
+    /// @brief Number of CPUs across all domains
+    std::size_t cpu_count() const noexcept;
+
+    /**
+     * @brief Spreads reactors and workers over the domains
+     * @param reactors Event loops to place
+     * @param workers Worker threads to place, 0 if there is no pool
+     *
+     * Reactors go round-robin over the domains, alternating nodes first, and
+     * each takes one CPU of its domain. Workers go round-robin over the
+     * domains holding a reactor, so every reactor has workers on its own
+     * cache when there are enough of them; a worker may run on any CPU of
+     * its domain that no reactor holds.
+     */
+    cpu_placement place(std::size_t reactors, std::size_t workers) const;
+
+private:
+    std::vector<domain> groups;
+};
+
+/**
+ * @brief Restricts the calling thread to a set of CPUs
+ * @param cpus CPUs the thread may run on; empty leaves it unpinned
+ * @return false if the kernel refused or the platform has no thread affinity
+ */
+inline bool pin_current_thread(const std::vector<int>& cpus) noexcept {
+#if defined(__linux__) || defined(__linux)
+    if (cpus.empty())
+        return true;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (const int cpu : cpus)
+        if (cpu >= 0 && cpu < CPU_SETSIZE)
+            CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    return cpus.empty();
+#endif
+}
+}  // namespace cppress::shared
@@ -1,9 +1,13 @@
-
 #pragma once
 
-#include <fstream>
+#include <atomic>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
 #include <mutex>
 #include <string>
+#include <string_view>
+#include <type_traits>
 
 /**
  * @brief Logger for Web server events and errors.
@@ -11,6 +15,21 @@
  * This logger provides a simple interface for logging messages related to
  * the Web server's operation, including request handling, error reporting,
  * and other important events.
+ *
+ * Logging does not wait for the disk. Each thread appends its lines to a
+ * lock-free ring of its own; a background thread drains the rings every
+ * few milliseconds, or sooner when one fills up, and writes each file's
+ * lines with one writev() on a descriptor it keeps open. Messages below
+ * the minimum level are dropped before anything is formatted, and messages
+ * given in parts are joined straight into the ring:
+ *
+ * ```cpp
+ * logger::error("Status code: ", e.get_status_code(), " Message: ", e.get_status_message());
+ * ```
+ *
+ * A line that does not fit in its thread's ring is dropped; see
+ * overflow_policy. fatal() and flush() return once the lines logged
+ * before them are written.
  */
 
 namespace cppress::shared::logger {
@@ -25,28 +44,136 @@ extern std::string absolute_path_to_logs;
 
 /// @brief Flag to enable or disable logging, default is false
 extern bool enabled_logging;
+
+/// @brief Held while lines are written to the files, and while they are cleared
 extern std::mutex log_mutex;
 
+/// @brief Severity of a message, each written to a file of its own
+enum class level : std::uint8_t { trace, debug, info, error, fatal };
+
+/// @brief What becomes of a line that does not fit in its thread's ring
+enum class overflow_policy : std::uint8_t {
+    /// Drop it silently; dropped() still counts it
+    drop,
+    /// Drop it, and note how many were dropped in the level's file once lines fit again
+    count
+};
+
+/// @brief Messages below this level are dropped before they are formatted, default is trace
+void set_min_level(level min) noexcept;
+
+/// @brief Set what becomes of lines that do not fit, default is overflow_policy::count
+void set_overflow_policy(overflow_policy policy) noexcept;
+
+/// @brief Lines dropped since the start because their ring was full
+std::uint64_t dropped() noexcept;
+
+/// @brief Write every line logged so far before returning
+void flush();
+
+namespace detail {
+extern std::atomic<level> min_level;
+
+/**
+ * @brief A part of a message: a string as it is, or a number written in place.
+ */
+class piece {
+public:
+    piece(std::string_view text) noexcept : text(text) {}  // NOLINT: implicit
+    piece(const std::string& text) noexcept : text(text) {}  // NOLINT: implicit
+    piece(const char* text) noexcept : text(text) {}  // NOLINT: implicit
+    piece(char c) noexcept : text(buffer, 1) { buffer[0] = c; }  // NOLINT: implicit
+    piece(bool b) noexcept : text(b ? "true" : "false") {}  // NOLINT: implicit
+
+    template <typename T, typename = std::enable_if_t<std::is_arithmetic_v<T>>>
+    piece(T number) noexcept {  // NOLINT: implicit
+        const auto written = std::to_chars(buffer, buffer + sizeof(buffer), number);
+        text = std::string_view(buffer, static_cast<std::size_t>(written.ptr - buffer));
+    }
+
+    piece(const piece&) = delete;
+    piece& operator=(const piece&) = delete;
+
+    std::string_view view() const noexcept { return text; }
+
+private:
+    char buffer[32];
+    std::string_view text;
+};
+
+/// Queues the line made of the pieces
+void write(level l, const piece* pieces, std::size_t count);
+}  // namespace detail
+
+/// @brief Whether messages of a level are logged at all
+inline bool enabled(level l) noexcept {
+    return enabled_logging && l >= detail::min_level.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Log a message made of parts, formatted only if its level is enabled.
+ * @param parts Strings, characters and numbers, joined without separators
+ */
+template <typename... Parts>
+void log(level l, const Parts&... parts) {
+    if (!enabled(l))
+        return;
+    const detail::piece pieces[] = {parts...};
+    detail::write(l, pieces, sizeof...(Parts));
+    if (l == level::fatal)
+        flush();
+}
+
 /// @brief Log an informational message to a file called "info.log"
 /// @param message The message to log
-void info(const std::string& message);
+void info(std::string_view message);
 
 /// @brief Log an error message to a file called "error.log"
 /// @param message The message to log
-void error(const std::string& message);
+void error(std::string_view message);
 
 /// @brief Log a debug message to a file called "debug.log"
 /// @param message The message to log
-void debug(const std::string& message);
+void debug(std::string_view message);
 
 /// @brief Log a trace message to a file called "trace.log"
 /// @param message The message to log
-void trace(const std::string& message);
+void trace(std::string_view message);
 
-/// @brief Log a fatal message to a file called "fatal.log"
+/// @brief Log a fatal message to a file called "fatal.log", and wait until it is written
 /// @param message The message to log
-void fatal(const std::string& message);
+void fatal(std::string_view message);
+
+/// @brief Log an informational message made of parts, see log()
+template <typename First, typename... Rest>
+void info(const First& first, const Rest&... rest) {
+    log(level::info, first, rest...);
+}
+
+/// @brief Log an error message made of parts, see log()
+template <typename First, typename... Rest>
+void error(const First& first, const Rest&... rest) {
+    log(level::error, first, rest...);
+}
+
+/// @brief Log a debug message made of parts, see log()
+template <typename First, typename... Rest>
+void debug(const First& first, const Rest&... rest) {
+    log(level::debug, first, rest...);
+}
+
+/// @brief Log a trace message made of parts, see log()
+template <typename First, typename... Rest>
+void trace(const First& first, const Rest&... rest) {
+    log(level::trace, first, rest...);
+}
+
+/// @brief Log a fatal message made of parts, see log()
+template <typename First, typename... Rest>
+void fatal(const First& first, const Rest&... rest) {
+    log(level::fatal, first, rest...);
+}
 
 /// @brief Clear all log files
 void clear();
-}  // namespace cppress::shared::logger
\ No newline at end of file
+}  // namespace cppress::shared::logger
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace cppress::shared {
+
+/**
+ * @class perfect_hash
+ * @brief A fixed set of strings, each mapped to its position by a hash without collisions.
+ *
+ * The seed is searched for when the table is constructed, and a table
+ * declared constexpr is constructed by the compiler: lookups cost one hash
+ * of the key, one load and one comparison, and the program does nothing
+ * at startup. The slot array is sized so that a seed is found within a few
+ * tries (about N * N / 4 bytes, rounded up to a power of two); this is for
+ * small sets such as methods, header names or file extensions.
+ *
+ * With IgnoreCase, ASCII letters hash and compare without their case; the
+ * keys are then written in one case.
+ *
+ * Example usage:
+ * ```cpp
+ * constexpr std::array<std::string_view, 3> names = {"GET", "HEAD", "POST"};
+ * constexpr perfect_hash<3> methods(names);
+ * static_assert(methods.find("HEAD") == 1);
+ * ```
+ */
+template <std::size_t N, bool IgnoreCase = false>
+class perfect_hash {
+    static_assert(N > 0 && N < 255, "perfect_hash holds 1 to 254 keys");
+
+public:
+    /// Returned by find() for a string that is not a key
+    static constexpr std::size_t NONE = N;
+
+    /**
+     * @param keys Distinct keys; a key's position is what find() returns for it
+     */
+    constexpr explicit perfect_hash(const std::array<std::string_view, N>& keys) : keys(keys) {
+        search();
+    }
+
+    /// @param keys Distinct keys, as a built-in array
+    constexpr explicit perfect_hash(const std::string_view (&keys)[N]) {
+        for (std::size_t i = 0; i < N; ++i)
+            this->keys[i] = keys[i];
+        search();
+    }
+
+    /// @brief Position of a key, NONE if key is not one of them
+    constexpr std::size_t find(std::string_view key) const noexcept {
+        const std::uint8_t at = slots[hash(key, seed) & (SLOTS - 1)];
+        return at != EMPTY && equals(keys[at], key) ? at : NONE;
+    }
+
+    /// @brief Whether key is one of the keys
+    constexpr bool contains(std::string_view key) const noexcept { return find(key) != NONE; }
+
+    /// @brief The key at a position
+    constexpr std::string_view operator[](std::size_t i) const noexcept { return keys[i]; }
+
+    static constexpr std::size_t size() noexcept { return N; }
+
+private:
+    static constexpr std::uint8_t EMPTY = 0xff;
+
+    static constexpr std::size_t slot_count() noexcept {
+        std::size_t n = 16;
+        while (n < N * N / 4)
+            n *= 2;
+        return n;
+    }
+
+    static constexpr std::size_t SLOTS = slot_count();
+
+    static constexpr char fold(char c) noexcept {
+        return IgnoreCase && c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+    }
+
+    /// FNV-1a over the (folded) bytes, then a finalizer so the low bits depend on all of them
+    static constexpr std::uint32_t hash(std::string_view key, std::uint32_t seed) noexcept {
+        std::uint32_t h = 2166136261u ^ (seed * 0x9e3779b1u);
+        for (const char c : key) {
+            h ^= static_cast<unsigned char>(fold(c));
+            h *= 16777619u;
+        }
+        h ^= h >> 16;
+        h *= 0x85ebca6bu;
+        h ^= h >> 13;
+        return h;
+    }
+
+    static constexpr bool equals(std::string_view a, std::string_view b) noexcept {
+        if (a.size() != b.size())
+            return false;
+        for (std::size_t i = 0; i < a.size(); ++i)
+            if (fold(a[i]) != fold(b[i]))
+                return false;
+        return true;
+    }
+
+    constexpr void search() noexcept {
+        for (seed = 1;; ++seed)
+            if (place())
+                return;
+    }
+
+    /// Places every key with the current seed; false on a collision
+    constexpr bool place() noexcept {
+        for (auto& slot : slots)
+            slot = EMPTY;
+        for (std::size_t i = 0; i < N; ++i) {
+            std::uint8_t& slot = slots[hash(keys[i], seed) & (SLOTS - 1)];
+            if (slot != EMPTY)
+                return false;
+            slot = static_cast<std::uint8_t>(i);
+        }
+        return true;
+    }
+
+    std::array<std::string_view, N> keys{};
+    std::array<std::uint8_t, SLOTS> slots{};
+    std::uint32_t seed = 0;
+};
+}  // namespace cppress::shared
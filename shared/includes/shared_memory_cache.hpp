@@ -0,0 +1,221 @@
+/**
+ * @file shared_memory_cache.hpp
+ * @brief Byte cache in a shared memory segment, one for all processes of a cluster
+ *
+ * Prefork workers share no heap, so a shared::cache in each of them holds
+ * its own copy of every entry and loads it once per process. A
+ * shared_memory_cache keeps its entries in one segment mapped by every
+ * worker: an entry stored by one worker is a hit for all of them, the
+ * memory is spent once, and entries outlive the worker that stored them
+ * (the supervisor keeps the mapping across restarts and reloads).
+ *
+ * The segment holds a hash index and a slab allocator. Pages of 1 MiB
+ * are cut into chunks of one size class each; an entry, its key and its
+ * value take one chunk of the smallest class it fits. A full class
+ * evicts by CLOCK: a hit sets the entry's reference bit, the hand clears
+ * set bits and takes the first chunk whose bit is clear. A class without
+ * pages takes one from another class, evicting what the page held.
+ *
+ * Lookups take no lock. Each entry carries a sequence number, odd while
+ * it is written; a reader copies the entry and keeps the copy only if the
+ * number was even and unchanged across it, otherwise it starts over. A
+ * writer holds a robust process-shared mutex in the segment: if a process
+ * dies holding it, the next one to lock rebuilds the index and the free
+ * lists from the chunks that were complete.
+ *
+ * The interface is shared::cache's for string keys and values: get() and
+ * get_or_load() hand out shared_ptr<const std::string>, here a copy taken
+ * out of the segment.
+ *
+ * Example usage:
+ * ```cpp
+ * shared_memory_cache::options options;
+ * options.capacity = 256 * 1024 * 1024;
+ * shared_memory_cache pages(options);  // before fork()
+ * // in any worker
+ * auto page = pages.get_or_load(path, [&] { return render(path); });
+ * ```
+ *
+ * @note Linux only (mmap, robust process-shared mutexes)
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+namespace cppress::shared {
+
+/**
+ * @class shared_memory_cache
+ * @brief Maps string keys to string values in memory shared between processes
+ *
+ * Thread-safe and process-safe. Hits, misses and loads are counted per
+ * process; entries, cost, evictions and rejections are the segment's.
+ */
+class shared_memory_cache {
+public:
+    using value_ptr = std::shared_ptr<const std::string>;
+    using clock = std::chrono::steady_clock;
+
+    /// Size of a slab page; an entry with its key and value takes at most one page
+    static constexpr std::size_t PAGE_SIZE = 1024 * 1024;
+
+    struct options {
+        /// Size of the segment, index and pages included; at least 4 pages
+        std::size_t capacity = 64 * 1024 * 1024;
+
+        /**
+         * Name of a POSIX shared memory object (e.g. "/cppress-pages") to
+         * create or attach, so unrelated processes and later runs share
+         * the entries; empty for an anonymous segment shared with the
+         * processes forked after the cache was made
+         */
+        std::string name;
+
+        /// How long an entry is returned after it was stored, 0 for ever
+        std::chrono::milliseconds ttl{0};
+    };
+
+    struct statistics {
+        std::uint64_t hits = 0;
+        std::uint64_t misses = 0;
+        /// Loads run by get_or_load() in this process, not those it waited for
+        std::uint64_t loads = 0;
+        /// Entries dropped to make room
+        std::uint64_t evictions = 0;
+        /// Entries refused because they do not fit a page, or no chunk could be freed
+        std::uint64_t rejections = 0;
+        /// Bytes of the chunks holding entries
+        std::size_t cost = 0;
+        std::size_t entries = 0;
+    };
+
+    /// @param capacity Size of an anonymous segment, see options::capacity
+    explicit shared_memory_cache(std::size_t capacity);
+
+    /**
+     * @throws std::invalid_argument if the capacity holds fewer than 4 pages
+     * @throws std::runtime_error if the segment cannot be created or mapped,
+     *         or a named one was made by an incompatible version
+     */
+    explicit shared_memory_cache(options o);
+
+    shared_memory_cache(const shared_memory_cache&) = delete;
+    shared_memory_cache& operator=(const shared_memory_cache&) = delete;
+
+    /// Unmaps the segment; a named one stays until remove()
+    ~shared_memory_cache();
+
+    /**
+     * @brief The value of a key
+     * @return A copy of the value, nullptr if the key is missing or expired
+     */
+    value_ptr get(std::string_view key);
+
+    /**
+     * @brief Stores a value, replacing the key's current one
+     * @param time_to_live Expiry of the entry; by default the cache's ttl
+     * @return false if the entry does not fit a page or no chunk could be freed
+     */
+    bool put(std::string_view key, std::string_view value) { return put(key, value, ttl); }
+
+    /// @brief Stores a value with an explicit time to live, see put()
+    bool put(std::string_view key, std::string_view value, std::chrono::milliseconds time_to_live);
+
+    /**
+     * @brief The value of a key, loaded and stored if it is missing
+     * @param load Callable returning a std::string; runs on this thread, outside any lock
+     * @return The value, shared with the callers waiting for the same load
+     *
+     * Loads of a key are coalesced within the process; processes loading
+     * the same key at once each run their load, the last put() wins.
+     */
+    template <typename Loader>
+    value_ptr get_or_load(const std::string& key, Loader&& load) {
+        if (auto hit = get(key))
+            return hit;
+        std::promise<value_ptr> promise;
+        std::unique_lock<std::mutex> guard(loading_lock);
+        const auto pending = loading.find(key);
+        if (pending != loading.end()) {
+            const std::shared_future<value_ptr> result = pending->second;
+            guard.unlock();
+            return result.get();
+        }
+        loading.emplace(key, promise.get_future().share());
+        guard.unlock();
+        try {
+            value_ptr value = std::make_shared<const std::string>(load());
+            loads.fetch_add(1, std::memory_order_relaxed);
+            put(key, *value);
+            end_load(key);
+            promise.set_value(value);
+            return value;
+        } catch (...) {
+            end_load(key);
+            promise.set_exception(std::current_exception());
+            throw;
+        }
+    }
+
+    /**
+     * @brief Drops a key
+     * @return true if an entry was dropped
+     */
+    bool erase(std::string_view key);
+
+    /// @brief Drops every entry
+    void clear();
+
+    /**
+     * @brief Drops the expired entries now rather than as their chunks are reused
+     * @return Number of entries dropped
+     */
+    std::size_t purge_expired();
+
+    /// @brief Bytes of the chunks holding entries
+    std::size_t cost() const noexcept;
+
+    /// @brief Number of entries held, expired ones not yet dropped included
+    std::size_t size() const noexcept;
+
+    statistics stats() const noexcept;
+
+    /// @brief Size of the mapped segment
+    std::size_t capacity() const noexcept { return bytes; }
+
+    /**
+     * @brief Removes a named segment; processes that mapped it keep their mapping
+     * @return false if there was no such segment
+     */
+    static bool remove(const std::string& name);
+
+private:
+    struct segment;
+    class writer;
+
+    void end_load(const std::string& key);
+
+    segment* base = nullptr;
+    std::size_t bytes = 0;
+    std::chrono::milliseconds ttl;
+
+    std::atomic<std::uint64_t> hits{0};
+    std::atomic<std::uint64_t> misses{0};
+    std::atomic<std::uint64_t> loads{0};
+
+    std::mutex loading_lock;
+    std::unordered_map<std::string, std::shared_future<value_ptr>> loading;
+};
+}  // namespace cppress::shared
@@ -0,0 +1,234 @@
+/**
+ * @file startup_snapshot.hpp
+ * @brief Startup work saved to a file once, mapped and reused by the next process
+ *
+ * A starting server walks its static directories and a page compiles its
+ * templates; a worker that restarts, or one of many forked at once, does
+ * the same work again for the same result. A startup snapshot keeps that
+ * result: the first process writes each piece of it as a named section of
+ * one file, the next maps the file and reads the sections back, which is
+ * a copy out of the page cache instead of a directory walk or a parse.
+ *
+ * Each section lists the files and directories it was made from, with
+ * their modification times and sizes. section() checks them when it is
+ * asked for one and refuses the section if any changed, so a stale
+ * section is rebuilt and the others are still used. A file written by
+ * another version, or cut short, is refused as a whole.
+ *
+ * The file is written to a temporary name and renamed over the old one,
+ * so a process opening it sees either snapshot, never half of one.
+ *
+ * Example usage:
+ * ```cpp
+ * auto snapshot = startup_snapshot::open("/var/cache/app.snapshot");
+ * std::optional<std::string_view> page;
+ * if (snapshot)
+ *     page = snapshot->section("template:views/home.html");
+ * if (!page) {
+ *     snapshot_writer out;
+ *     out.add("template:views/home.html", compile("views/home.html"),
+ *             {snapshot_source::of("views/home.html")});
+ *     out.save("/var/cache/app.snapshot");
+ * }
+ * ```
+ *
+ * @note Sections hold native-endian integers: a snapshot is for the machine that wrote it
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace cppress::shared {
+
+/**
+ * @struct snapshot_source
+ * @brief A file or directory a section was made from, as it was then
+ */
+struct snapshot_source {
+    std::string path;
+    /// file_time_type ticks of its modification time
+    std::int64_t modified = 0;
+    /// Size of a regular file, 0 for a directory
+    std::uint64_t size = 0;
+
+    /**
+     * @brief A path as it is now
+     * @throws std::runtime_error if it does not exist
+     */
+    static snapshot_source of(const std::string& path);
+
+    /// @brief Whether the path still has the recorded time and size
+    bool unchanged() const;
+};
+
+/**
+ * @class snapshot_encoder
+ * @brief Appends integers and strings to a section's bytes
+ */
+class snapshot_encoder {
+public:
+    void u32(std::uint32_t value) { raw(&value, sizeof value); }
+    void u64(std::uint64_t value) { raw(&value, sizeof value); }
+
+    /// @brief A length and the bytes
+    void string(std::string_view value) {
+        u64(value.size());
+        out.append(value.data(), value.size());
+    }
+
+    const std::string& bytes() const noexcept { return out; }
+    std::string take() { return std::move(out); }
+
+private:
+    void raw(const void* data, std::size_t size) {
+        out.append(static_cast<const char*>(data), size);
+    }
+
+    std::string out;
+};
+
+/**
+ * @class snapshot_decoder
+ * @brief Reads back what a snapshot_encoder appended
+ *
+ * Every read is checked against the end of the bytes and throws
+ * std::runtime_error past it, so a damaged section fails to load rather
+ * than being read out of bounds.
+ */
+class snapshot_decoder {
+public:
+    explicit snapshot_decoder(std::string_view bytes) : in(bytes) {}
+
+    std::uint32_t u32() {
+        std::uint32_t value;
+        raw(&value, sizeof value);
+        return value;
+    }
+
+    std::uint64_t u64() {
+        std::uint64_t value;
+        raw(&value, sizeof value);
+        return value;
+    }
+
+    /// @return A view of the bytes being decoded
+    std::string_view string() {
+        const std::uint64_t size = u64();
+        if (size > in.size())
+            throw std::runtime_error("Truncated snapshot");
+        std::string_view value = in.substr(0, size);
+        in.remove_prefix(size);
+        return value;
+    }
+
+    /**
+     * @brief A count of items that take at least item_size bytes each
+     * @throws std::runtime_error if that many cannot fit in what is left
+     */
+    std::size_t count(std::size_t item_size = 1) {
+        const std::uint64_t n = u64();
+        if (item_size != 0 && n > in.size() / item_size)
+            throw std::runtime_error("Truncated snapshot");
+        return static_cast<std::size_t>(n);
+    }
+
+    /// @brief Whether every byte was read
+    bool done() const noexcept { return in.empty(); }
+
+private:
+    void raw(void* data, std::size_t size) {
+        if (in.size() < size)
+            throw std::runtime_error("Truncated snapshot");
+        std::memcpy(data, in.data(), size);
+        in.remove_prefix(size);
+    }
+
+    std::string_view in;
+};
+
+/**
+ * @class snapshot_writer
+ * @brief Collects sections and writes them as a snapshot file
+ */
+class snapshot_writer {
+public:
+    /**
+     * @brief Add a section, replacing one of the same name
+     * @param sources What the bytes were made from, taken before it was read
+     */
+    void add(std::string name, std::string bytes, std::vector<snapshot_source> sources);
+
+    /// @brief Number of sections added
+    std::size_t size() const noexcept { return sections.size(); }
+
+    /**
+     * @brief Write the snapshot, replacing the file at path
+     * @throws std::runtime_error if it cannot be written
+     */
+    void save(const std::string& path) const;
+
+private:
+    struct section {
+        std::string name;
+        std::string bytes;
+        std::vector<snapshot_source> sources;
+    };
+
+    std::vector<section> sections;
+};
+
+/**
+ * @class startup_snapshot
+ * @brief A snapshot file mapped read-only
+ *
+ * Immutable once opened and safe to share between threads; the views
+ * section() returns point into the mapping and live as long as it does.
+ */
+class startup_snapshot {
+public:
+    /// Layout of the file and of every section cppress writes; bumped when one changes
+    static constexpr std::uint32_t VERSION = 1;
+
+    /**
+     * @brief Map a snapshot file
+     * @return nullptr if there is none, or it is unreadable, damaged or of another VERSION
+     */
+    static std::shared_ptr<const startup_snapshot> open(const std::string& path);
+
+    startup_snapshot(const startup_snapshot&) = delete;
+    startup_snapshot& operator=(const startup_snapshot&) = delete;
+    ~startup_snapshot();
+
+    /**
+     * @brief The bytes of a section, if its sources did not change since it was written
+     * @return std::nullopt if there is no such section or it is stale
+     */
+    std::optional<std::string_view> section(std::string_view name) const;
+
+    /// @brief Number of sections, stale ones included
+    std::size_t size() const noexcept { return sections.size(); }
+
+private:
+    struct entry {
+        std::string_view name;
+        std::string_view bytes;
+        std::vector<snapshot_source> sources;
+    };
+
+    startup_snapshot() = default;
+
+    void* map = nullptr;
+    std::size_t length = 0;
+    std::vector<entry> sections;
+};
+}  // namespace cppress::shared
@@ -1,69 +1,914 @@
+/**
+ * @file thread_pool.hpp
+ * @brief Work-stealing pool of worker threads
+ *
+ * Tasks submitted from outside the pool, such as requests handed over by
+ * the event loops, go through a bounded lock-free injection queue that
+ * stores them in place. A task submitted by a worker goes onto that
+ * worker's own Chase-Lev deque; idle workers take from the injection queue
+ * first and then steal from the other deques. No lock is taken to submit
+ * or take a task while workers are busy.
+ *
+ * Tasks may also be pinned to one worker with enqueue_to(): each worker
+ * has an inbox of its own that nobody steals from, so tasks pinned to one
+ * worker by one thread run one after the other, in the order submitted,
+ * on the same core's cache.
+ *
+ * A worker that finds nothing spins briefly and then parks. Submitting
+ * only touches the park mutex when some worker is parked.
+ *
+ * Tasks are held in a move-only type with inline storage for small
+ * callables, so a lambda capturing a couple of shared_ptrs is never
+ * heap-allocated.
+ *
+ * Workers may be pinned to CPUs, e.g. those of a cpu_placement, so they
+ * stay on the cache and the NUMA node of the event loop feeding them.
+ *
+ * A pool starts with a fixed number of workers; adapt() lets it grow and
+ * shrink between bounds as tasks wait longer or workers sit idle.
+ */
+
 #pragma once
 
+#if !defined(_WIN32) && !defined(_WIN64)
+#include <sys/resource.h>
+#endif
+
+#include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
-#include <functional>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
 #include <iostream>
 #include <memory>
 #include <mutex>
-#include <queue>
+#include <new>
+#include <stdexcept>
 #include <thread>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+#include "cpu_topology.hpp"
+
 namespace cppress::shared {
 
+/**
+ * @class task
+ * @brief Move-only callable with inline storage for small callables
+ */
+class task {
+public:
+    /// Callables up to this size (and alignment of max_align_t) are stored inline
+    static constexpr std::size_t INLINE = 48;
+
+    task() noexcept = default;
+
+    template <typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, task>>>
+    task(F&& f) {  // NOLINT: implicit, as std::function's
+        using callable = std::decay_t<F>;
+        if constexpr (sizeof(callable) <= INLINE &&
+                      alignof(callable) <= alignof(std::max_align_t) &&
+                      std::is_nothrow_move_constructible_v<callable>) {
+            ::new (static_cast<void*>(storage)) callable(std::forward<F>(f));
+            ops = &inline_ops<callable>;
+        } else {
+            *reinterpret_cast<callable**>(storage) = new callable(std::forward<F>(f));
+            ops = &heap_ops<callable>;
+        }
+    }
+
+    task(task&& other) noexcept : ops(other.ops) {
+        if (ops)
+            ops->move(storage, other.storage);
+        other.ops = nullptr;
+    }
+
+    task& operator=(task&& other) noexcept {
+        if (this != &other) {
+            reset();
+            ops = other.ops;
+            if (ops)
+                ops->move(storage, other.storage);
+            other.ops = nullptr;
+        }
+        return *this;
+    }
+
+    task(const task&) = delete;
+    task& operator=(const task&) = delete;
+
+    ~task() { reset(); }
+
+    void operator()() { ops->invoke(storage); }
+
+    explicit operator bool() const noexcept { return ops != nullptr; }
+
+    void reset() noexcept {
+        if (ops) {
+            ops->destroy(storage);
+            ops = nullptr;
+        }
+    }
+
+private:
+    struct operations {
+        void (*invoke)(void*);
+        /// Move-constructs into dst and destroys src
+        void (*move)(void* dst, void* src) noexcept;
+        void (*destroy)(void*) noexcept;
+    };
+
+    template <typename F>
+    static constexpr operations inline_ops = {
+        [](void* p) { (*static_cast<F*>(p))(); },
+        [](void* dst, void* src) noexcept {
+            ::new (dst) F(std::move(*static_cast<F*>(src)));
+            static_cast<F*>(src)->~F();
+        },
+        [](void* p) noexcept { static_cast<F*>(p)->~F(); }};
+
+    template <typename F>
+    static constexpr operations heap_ops = {
+        [](void* p) { (**static_cast<F**>(p))(); },
+        [](void* dst, void* src) noexcept { *static_cast<F**>(dst) = *static_cast<F**>(src); },
+        [](void* p) noexcept { delete *static_cast<F**>(p); }};
+
+    alignas(std::max_align_t) unsigned char storage[INLINE];
+    const operations* ops = nullptr;
+};
+
+/**
+ * @brief Bounds and thresholds of a pool adapting its size, see thread_pool::adapt()
+ */
+struct pool_sizing {
+    /// Workers kept however idle the pool is, at least 1
+    std::size_t min_threads = 1;
+
+    /// Workers the pool may grow to, capped at thread_pool::MAX_WORKERS
+    std::size_t max_threads = 4 * std::max(1u, std::thread::hardware_concurrency());
+
+    /// Time between two sizing decisions
+    std::chrono::milliseconds interval{100};
+
+    /// Estimated queue wait above which the pool grows
+    std::chrono::microseconds grow_wait{2000};
+
+    /// Share of time workers were busy below which the pool shrinks
+    double shrink_utilization = 0.5;
+
+    /// Intervals in a row a shrinking condition must hold before a worker retires
+    unsigned shrink_after = 20;
+
+    /// Share of all cores used by the process from which the pool no longer grows
+    double cpu_saturation = 0.9;
+};
+
+/**
+ * @brief A pool's size and the measurements of its last sizing decision
+ */
+struct pool_stats {
+    /// Workers taking tasks
+    std::size_t threads = 0;
+    std::size_t min_threads = 0;
+    std::size_t max_threads = 0;
+
+    /// Times the pool grew, and shrank, since adapt()
+    std::uint64_t grown = 0;
+    std::uint64_t shrunk = 0;
+
+    /// Estimated wait of a task for a worker over the last interval
+    std::chrono::microseconds queue_wait{0};
+
+    /// Share of the last interval the workers spent running tasks
+    double utilization = 0;
+
+    /// Share of all cores the process used over the last interval
+    double cpu = 0;
+};
+
+/**
+ * @class thread_pool
+ * @brief Runs submitted tasks on a set of worker threads
+ *
+ * enqueue() may be called from any thread. Tasks run in no particular
+ * order; those submitted from one outside thread start roughly in order.
+ */
 class thread_pool {
 private:
+    /// Slots of the injection queue, a power of two
+    static constexpr std::size_t INJECTION_CAPACITY = 4096;
+
+    /// Slots of each worker's inbox, a power of two
+    static constexpr std::size_t INBOX_CAPACITY = 256;
+
+    /// Empty polls of all queues before a worker parks
+    static constexpr int SPIN_LIMIT = 64;
+
+    /**
+     * Bounded multi-producer multi-consumer queue, each slot stamped with a
+     * sequence number (D. Vyukov's design); tasks are stored in the slots
+     */
+    class injection_queue {
+    public:
+        explicit injection_queue(std::size_t capacity = INJECTION_CAPACITY)
+            : capacity(capacity), slots(new slot[capacity]) {
+            for (std::size_t i = 0; i < capacity; ++i)
+                slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        /// false when full; t is then left untouched
+        bool push(task& t) {
+            std::size_t pos = tail.load(std::memory_order_relaxed);
+            for (;;) {
+                slot& s = slots[pos & (capacity - 1)];
+                std::size_t seq = s.sequence.load(std::memory_order_acquire);
+                auto diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+                if (diff == 0) {
+                    if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        s.value = std::move(t);
+                        s.sequence.store(pos + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (diff < 0) {
+                    return false;
+                } else {
+                    pos = tail.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        bool pop(task& out) {
+            std::size_t pos = head.load(std::memory_order_relaxed);
+            for (;;) {
+                slot& s = slots[pos & (capacity - 1)];
+                std::size_t seq = s.sequence.load(std::memory_order_acquire);
+                auto diff =
+                    static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos + 1);
+                if (diff == 0) {
+                    if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        out = std::move(s.value);
+                        s.sequence.store(pos + capacity, std::memory_order_release);
+                        return true;
+                    }
+                } else if (diff < 0) {
+                    return false;
+                } else {
+                    pos = head.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        bool empty() const {
+            return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+        }
+
+    private:
+        struct slot {
+            std::atomic<std::size_t> sequence{0};
+            task value;
+        };
+        std::size_t capacity;
+        std::unique_ptr<slot[]> slots;
+        alignas(64) std::atomic<std::size_t> head{0};
+        alignas(64) std::atomic<std::size_t> tail{0};
+    };
+
+    /**
+     * Chase-Lev work-stealing deque of heap tasks (Lê, Pop, Cohen and
+     * Zappa Nardelli's C11 formulation). The owner pushes and pops at the
+     * bottom, thieves take from the top. Outgrown arrays are kept until
+     * the deque is destroyed, a thief may still be reading one.
+     */
+    class work_deque {
+    public:
+        work_deque() : array(new ring(64)) { rings.emplace_back(array.load()); }
+
+        /// Owner only
+        void push(task* t) {
+            std::int64_t b = bottom.load(std::memory_order_relaxed);
+            std::int64_t top_now = top.load(std::memory_order_acquire);
+            ring* a = array.load(std::memory_order_relaxed);
+            if (b - top_now > a->capacity - 1) {
+                a = a->grow(top_now, b);
+                rings.emplace_back(a);
+                array.store(a, std::memory_order_release);
+            }
+            a->put(b, t);
+            // publishes the task to thieves, which read bottom with acquire
+            bottom.store(b + 1, std::memory_order_release);
+        }
+
+        /// Owner only
+        task* pop() {
+            std::int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+            ring* a = array.load(std::memory_order_relaxed);
+            bottom.store(b, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            std::int64_t t = top.load(std::memory_order_relaxed);
+            if (t > b) {
+                bottom.store(b + 1, std::memory_order_relaxed);
+                return nullptr;
+            }
+            task* x = a->get(b);
+            if (t == b) {
+                // the last one, a thief may be taking it too
+                if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                                 std::memory_order_relaxed))
+                    x = nullptr;
+                bottom.store(b + 1, std::memory_order_relaxed);
+            }
+            return x;
+        }
+
+        /// Any thread
+        task* steal() {
+            std::int64_t t = top.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            std::int64_t b = bottom.load(std::memory_order_acquire);
+            if (t >= b)
+                return nullptr;
+            ring* a = array.load(std::memory_order_acquire);
+            task* x = a->get(t);
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                             std::memory_order_relaxed))
+                return nullptr;
+            return x;
+        }
+
+        bool empty() const {
+            return top.load(std::memory_order_acquire) >= bottom.load(std::memory_order_acquire);
+        }
+
+    private:
+        struct ring {
+            explicit ring(std::int64_t capacity)
+                : capacity(capacity), slots(new std::atomic<task*>[capacity]) {}
+
+            void put(std::int64_t i, task* t) {
+                slots[i & (capacity - 1)].store(t, std::memory_order_relaxed);
+            }
+            task* get(std::int64_t i) const {
+                return slots[i & (capacity - 1)].load(std::memory_order_relaxed);
+            }
+            ring* grow(std::int64_t t, std::int64_t b) const {
+                auto* bigger = new ring(capacity * 2);
+                for (std::int64_t i = t; i < b; ++i)
+                    bigger->put(i, get(i));
+                return bigger;
+            }
+
+            std::int64_t capacity;
+            std::unique_ptr<std::atomic<task*>[]> slots;
+        };
+
+        alignas(64) std::atomic<std::int64_t> top{0};
+        alignas(64) std::atomic<std::int64_t> bottom{0};
+        std::atomic<ring*> array;
+        std::vector<std::unique_ptr<ring>> rings;
+    };
+
+    struct worker_state {
+        work_deque deque;
+
+        /// Tasks pinned to this worker, never stolen
+        injection_queue inbox{INBOX_CAPACITY};
+
+        /// Pinned tasks that found the inbox full; while any wait here, new ones
+        /// follow them so the order is kept
+        std::mutex overflow_mutex;
+        std::deque<task> overflow;
+        std::atomic<std::size_t> overflow_size{0};
+
+        /// Tasks run and time spent running them, counted while the pool adapts its size
+        alignas(64) std::atomic<std::uint64_t> done{0};
+        std::atomic<std::uint64_t> busy_ns{0};
+    };
+
+    /// The pool and worker index of the calling thread, if it is a worker
+    struct current_worker {
+        const thread_pool* pool = nullptr;
+        std::size_t index = 0;
+    };
+    static current_worker& current() {
+        thread_local current_worker self;
+        return self;
+    }
+
+    /// States of the workers started so far; slots are filled once, before started grows
+    std::unique_ptr<std::unique_ptr<worker_state>[]> states{
+        new std::unique_ptr<worker_state>[MAX_WORKERS]};
+    std::atomic<std::size_t> started{0};
+
+    /// Workers below this index take tasks, the others are retired until the pool grows
+    std::atomic<std::size_t> target{0};
+
+    /// Workers enqueue_to() spreads over; never retired
+    std::atomic<std::size_t> pinnable{1};
+
+    /// CPUs of each worker, see the constructor
+    std::vector<std::vector<int>> worker_cpus;
+
+    /// Guards workers, sizing and last, and serializes resizes
+    mutable std::mutex sizing_mutex;
     std::vector<std::thread> workers;
-    std::queue<std::function<void()>> tasks;
-    std::mutex queue_mutex;
-    std::condition_variable condition;
+    pool_sizing sizing;
+    pool_stats last;
+
+    /// Adapts the size every sizing.interval once adapt() was called
+    std::thread controller;
+    std::condition_variable controller_wake;
+
+    /// Workers time their tasks for the controller
+    std::atomic<bool> timed{false};
+
+    injection_queue injection;
+
+    /// Tasks that found the injection queue full
+    std::mutex overflow_mutex;
+    std::deque<task> overflow;
+    std::atomic<std::size_t> overflow_size{0};
+
+    /// Tasks submitted and not yet taken by a worker
+    std::atomic<std::size_t> queued{0};
+
+    /// Parking: sleepers is read by submitters without the lock, epoch wakes parked workers
+    std::mutex park_mutex;
+    std::condition_variable park;
+    std::atomic<std::size_t> sleepers{0};
+    std::uint64_t epoch = 0;
+
+    /// Retired workers wait here, under park_mutex, until the pool grows or stops
+    std::condition_variable retired;
+
     std::atomic<bool> stop;
 
-public:
-    thread_pool(size_t num_threads) {
-        stop.store(false);
+    static void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#else
+        std::this_thread::yield();
+#endif
+    }
 
-        for (size_t i = 0; i < num_threads; ++i) {
-            workers.emplace_back([this]() {
-                while (!stop.load()) {
-                    std::function<void()> task;
-                    {
-                        std::unique_lock<std::mutex> lock(queue_mutex);
-                        condition.wait(lock, [this] { return stop.load() || !tasks.empty(); });
-                        if (stop.load() && tasks.empty())
-                            return;
-                        task = std::move(tasks.front());
-                        tasks.pop();
-                    }
-                    task();
+    bool has_work(std::size_t self) const {
+        const worker_state& mine = *states[self];
+        if (!mine.inbox.empty() || mine.overflow_size.load(std::memory_order_acquire) != 0)
+            return true;
+        if (!injection.empty() || overflow_size.load(std::memory_order_acquire) != 0)
+            return true;
+        const std::size_t count = started.load(std::memory_order_acquire);
+        for (std::size_t i = 0; i < count; ++i)
+            if (!states[i]->deque.empty())
+                return true;
+        return false;
+    }
+
+    /// Takes one task from the worker's inbox, its deque, the shared queues or another worker
+    bool take(std::size_t self, task& out) {
+        worker_state& state = *states[self];
+        if (state.inbox.pop(out))
+            return true;
+        if (state.overflow_size.load(std::memory_order_acquire) != 0) {
+            std::lock_guard<std::mutex> lock(state.overflow_mutex);
+            if (!state.overflow.empty()) {
+                out = std::move(state.overflow.front());
+                state.overflow.pop_front();
+                state.overflow_size.fetch_sub(1, std::memory_order_release);
+                return true;
+            }
+        }
+        if (task* mine = state.deque.pop()) {
+            out = std::move(*mine);
+            delete mine;
+            return true;
+        }
+        if (injection.pop(out))
+            return true;
+        if (overflow_size.load(std::memory_order_acquire) != 0) {
+            std::lock_guard<std::mutex> lock(overflow_mutex);
+            if (!overflow.empty()) {
+                out = std::move(overflow.front());
+                overflow.pop_front();
+                overflow_size.fetch_sub(1, std::memory_order_release);
+                return true;
+            }
+        }
+        const std::size_t count = started.load(std::memory_order_acquire);
+        for (std::size_t i = 1; i < count; ++i) {
+            if (task* stolen = states[(self + i) % count]->deque.steal()) {
+                out = std::move(*stolen);
+                delete stolen;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// Parks the worker until a task is submitted or the pool stops
+    void wait_for_work(std::size_t self) {
+        std::unique_lock<std::mutex> lock(park_mutex);
+        std::uint64_t seen = epoch;
+        sleepers.fetch_add(1, std::memory_order_seq_cst);
+        // pairs with the fence in wake_one(): a task pushed before that fence is seen here,
+        // or the submitter sees this worker asleep
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!has_work(self) && !stop.load() && self < target.load())
+            park.wait(lock, [&] { return epoch != seen || stop.load(); });
+        sleepers.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    /// Runs what is left on the worker's deque, then waits until the pool grows back over it
+    void retire(std::size_t self) {
+        worker_state& state = *states[self];
+        while (task* mine = state.deque.pop()) {
+            queued.fetch_sub(1, std::memory_order_relaxed);
+            (*mine)();
+            delete mine;
+        }
+        // the wakeup that reached this worker was meant for one that takes tasks
+        if (queued.load(std::memory_order_relaxed) != 0)
+            wake_one();
+        std::unique_lock<std::mutex> lock(park_mutex);
+        retired.wait(lock, [&] { return self < target.load() || stop.load(); });
+    }
+
+    void wake_one() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleepers.load(std::memory_order_seq_cst) == 0)
+            return;
+        {
+            std::lock_guard<std::mutex> lock(park_mutex);
+            ++epoch;
+        }
+        park.notify_one();
+    }
+
+    /// As wake_one(), for a task only one worker may take: every parked worker looks
+    void wake_all() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleepers.load(std::memory_order_seq_cst) == 0)
+            return;
+        {
+            std::lock_guard<std::mutex> lock(park_mutex);
+            ++epoch;
+        }
+        park.notify_all();
+    }
+
+    void run(std::size_t self, const std::vector<int>& cpus) {
+        current() = {this, self};
+        pin_current_thread(cpus);
+        worker_state& state = *states[self];
+        int idle = 0;
+        task t;
+        while (!stop.load(std::memory_order_acquire)) {
+            if (self >= target.load(std::memory_order_relaxed)) {
+                retire(self);
+                continue;
+            }
+            if (take(self, t)) {
+                queued.fetch_sub(1, std::memory_order_relaxed);
+                idle = 0;
+                if (timed.load(std::memory_order_relaxed)) {
+                    const auto begin = std::chrono::steady_clock::now();
+                    t();
+                    const auto spent = std::chrono::steady_clock::now() - begin;
+                    state.busy_ns.fetch_add(
+                        static_cast<std::uint64_t>(
+                            std::chrono::duration_cast<std::chrono::nanoseconds>(spent).count()),
+                        std::memory_order_relaxed);
+                    state.done.fetch_add(1, std::memory_order_relaxed);
+                } else {
+                    t();
                 }
-            });
+                t.reset();
+                continue;
+            }
+            if (++idle < SPIN_LIMIT) {
+                cpu_relax();
+                continue;
+            }
+            idle = 0;
+            wait_for_work(self);
         }
     }
+
+    /// Sets the number of workers taking tasks, starting threads as needed; sizing_mutex held
+    void resize(std::size_t count) {
+        const std::size_t previous = target.load();
+        for (std::size_t i = started.load(); i < count; ++i) {
+            states[i] = std::make_unique<worker_state>();
+            started.store(i + 1, std::memory_order_release);
+        }
+        {
+            std::lock_guard<std::mutex> lock(park_mutex);
+            target.store(count);
+        }
+        while (workers.size() < count) {
+            const std::size_t i = workers.size();
+            std::vector<int> mine =
+                worker_cpus.empty() ? std::vector<int>() : worker_cpus[i % worker_cpus.size()];
+            workers.emplace_back([this, i, mine = std::move(mine)]() { run(i, mine); });
+        }
+        if (count > previous)
+            retired.notify_all();
+        else if (count < previous)
+            wake_all();  // parked workers past the new size retire
+    }
+
+    /// Measures the last interval and resizes the pool; sizing_mutex held
+    void adjust(std::chrono::steady_clock::time_point now, std::uint64_t& done_before,
+                std::uint64_t& busy_before, std::chrono::nanoseconds& cpu_before,
+                std::chrono::steady_clock::time_point& measured, unsigned& calm) {
+        std::uint64_t done = 0;
+        std::uint64_t busy = 0;
+        const std::size_t count = started.load();
+        for (std::size_t i = 0; i < count; ++i) {
+            done += states[i]->done.load(std::memory_order_relaxed);
+            busy += states[i]->busy_ns.load(std::memory_order_relaxed);
+        }
+        const std::chrono::nanoseconds cpu = process_cpu_time();
+        const double elapsed_ns = static_cast<double>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(now - measured).count());
+        const std::size_t size = target.load();
+        const double waiting = static_cast<double>(queued.load(std::memory_order_relaxed));
+        const std::uint64_t finished = done - done_before;
+        const unsigned int cores = std::max(1u, std::thread::hardware_concurrency());
+
+        // Little's law: the tasks waiting now, at the rate tasks were taken
+        double wait_ns = finished == 0 ? (waiting > 0 ? elapsed_ns : 0.0)
+                                       : waiting * elapsed_ns / static_cast<double>(finished);
+        last.queue_wait = std::chrono::microseconds(static_cast<std::int64_t>(wait_ns / 1000));
+        last.utilization = elapsed_ns > 0 ? static_cast<double>(busy - busy_before) /
+                                                (elapsed_ns * static_cast<double>(size))
+                                          : 0.0;
+        last.cpu = elapsed_ns > 0 ? static_cast<double>((cpu - cpu_before).count()) /
+                                        (elapsed_ns * cores)
+                                  : 0.0;
+        done_before = done;
+        busy_before = busy;
+        cpu_before = cpu;
+        measured = now;
+
+        const bool backlog = last.queue_wait > sizing.grow_wait;
+        const bool saturated = last.cpu >= sizing.cpu_saturation;
+        if (backlog && !saturated && size < sizing.max_threads) {
+            // blocked workers leave cores idle: add a quarter at once
+            resize(std::min(sizing.max_threads, size + std::max<std::size_t>(1, size / 4)));
+            ++last.grown;
+            calm = 0;
+        } else if (size > sizing.min_threads &&
+                   ((!backlog && last.utilization < sizing.shrink_utilization) ||
+                    (saturated && size > cores))) {
+            // idle workers, or more runnable threads than cores: one less, once it lasts
+            if (++calm >= sizing.shrink_after) {
+                resize(size - 1);
+                ++last.shrunk;
+                calm = 0;
+            }
+        } else {
+            calm = 0;
+        }
+        last.threads = target.load();
+    }
+
+    /// CPU time of the whole process so far, zero where it cannot be read
+    static std::chrono::nanoseconds process_cpu_time() noexcept {
+#if defined(_WIN32) || defined(_WIN64)
+        return std::chrono::nanoseconds(0);
+#else
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) != 0)
+            return std::chrono::nanoseconds(0);
+        return std::chrono::seconds(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+               std::chrono::microseconds(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+#endif
+    }
+
+    void control() {
+        std::uint64_t done_before = 0;
+        std::uint64_t busy_before = 0;
+        std::chrono::nanoseconds cpu_before = process_cpu_time();
+        auto measured = std::chrono::steady_clock::now();
+        unsigned calm = 0;
+        std::unique_lock<std::mutex> lock(sizing_mutex);
+        while (!stop.load()) {
+            controller_wake.wait_for(lock, sizing.interval);
+            if (stop.load())
+                break;
+            adjust(std::chrono::steady_clock::now(), done_before, busy_before, cpu_before,
+                   measured, calm);
+        }
+    }
+
+    /// Queues a task already counted in queued
+    template <typename F>
+    void submit(F&& f) {
+        const current_worker& self = current();
+        if (self.pool == this) {
+            states[self.index]->deque.push(new task(std::forward<F>(f)));
+        } else {
+            task t(std::forward<F>(f));
+            if (!injection.push(t)) {
+                std::lock_guard<std::mutex> lock(overflow_mutex);
+                overflow.push_back(std::move(t));
+                overflow_size.fetch_add(1, std::memory_order_release);
+            }
+        }
+        wake_one();
+    }
+
+    /// Queues a task already counted in queued on one worker's inbox
+    template <typename F>
+    void submit_to(std::size_t worker, F&& f) {
+        worker_state& state = *states[worker % pinnable.load(std::memory_order_relaxed)];
+        task t(std::forward<F>(f));
+        // behind tasks already in the overflow, the inbox would overtake them
+        if (state.overflow_size.load(std::memory_order_acquire) != 0 || !state.inbox.push(t)) {
+            std::lock_guard<std::mutex> lock(state.overflow_mutex);
+            if (!state.overflow.empty() || !state.inbox.push(t)) {
+                state.overflow.push_back(std::move(t));
+                state.overflow_size.fetch_add(1, std::memory_order_release);
+            }
+        }
+        wake_all();
+    }
+
+public:
+    /// Most workers a pool may grow to
+    static constexpr std::size_t MAX_WORKERS = 1024;
+
+    thread_pool(size_t num_threads) : thread_pool(num_threads, {}) {}
+
+    /**
+     * @brief Starts workers pinned to CPUs
+     * @param num_threads Number of workers, capped at MAX_WORKERS
+     * @param cpus CPUs of each worker, worker i taking cpus[i % cpus.size()];
+     *        empty leaves every worker unpinned
+     *
+     * A worker the kernel refuses to pin runs unpinned. Workers started
+     * later by adapt() are pinned the same way.
+     */
+    thread_pool(size_t num_threads, std::vector<std::vector<int>> cpus)
+        : worker_cpus(std::move(cpus)) {
+        stop.store(false);
+        num_threads = std::min(std::max<std::size_t>(num_threads, 1), MAX_WORKERS);
+        pinnable.store(num_threads);
+        sizing.min_threads = sizing.max_threads = num_threads;
+        std::lock_guard<std::mutex> lock(sizing_mutex);
+        resize(num_threads);
+        last.threads = last.min_threads = last.max_threads = num_threads;
+    }
+
     ~thread_pool() {
         std::cout << "Stopping thread pool..." << std::endl;
-        stop.store(true);
-        condition.notify_all();
+        stop_workers();
+        if (controller.joinable())
+            controller.join();
         for (std::thread& worker : workers) {
             if (worker.joinable())
                 worker.join();
         }
+        // tasks never run are destroyed with the pool
+        for (std::size_t i = 0; i < started.load(); ++i)
+            while (task* left = states[i]->deque.steal())
+                delete left;
+    }
+
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    /**
+     * @brief Lets the pool grow and shrink between bounds with its load
+     * @param bounds Bounds and thresholds, see pool_sizing
+     * @throws std::invalid_argument if min_threads is 0 or above max_threads
+     *
+     * Every bounds.interval the pool estimates how long tasks wait for a
+     * worker (by Little's law, from the tasks waiting and the rate they
+     * were taken), how busy its workers were, and how much of the machine's
+     * CPU the process used. A queue wait over grow_wait adds a quarter more
+     * workers, unless the CPU is saturated: then the tasks are CPU-bound and
+     * more threads would only switch contexts. Workers idle below
+     * shrink_utilization, or more workers than cores on a saturated CPU,
+     * retire one at a time once the condition held for shrink_after
+     * intervals in a row. A retired worker finishes the tasks it spawned and
+     * sleeps until the pool grows back, so growing again is cheap.
+     *
+     * Tasks pinned with enqueue_to() are spread over the first min_threads
+     * workers from then on, which never retire: call it before pinning any.
+     */
+    void adapt(const pool_sizing& bounds) {
+        if (bounds.min_threads == 0 || bounds.min_threads > bounds.max_threads)
+            throw std::invalid_argument("thread_pool: min_threads must be in [1, max_threads]");
+        std::unique_lock<std::mutex> lock(sizing_mutex);
+        sizing = bounds;
+        sizing.max_threads = std::min(sizing.max_threads, MAX_WORKERS);
+        sizing.min_threads = std::min(sizing.min_threads, sizing.max_threads);
+        last.min_threads = sizing.min_threads;
+        last.max_threads = sizing.max_threads;
+        pinnable.store(sizing.min_threads);
+        resize(std::clamp(target.load(), sizing.min_threads, sizing.max_threads));
+        last.threads = target.load();
+        timed.store(true, std::memory_order_relaxed);
+        if (!controller.joinable())
+            controller = std::thread([this]() { control(); });
+        lock.unlock();
+        controller_wake.notify_all();
+    }
+
+    /**
+     * @brief The pool's size and what its last sizing decision was based on
+     * @return A snapshot; the measurements stay zero unless adapt() was called
+     */
+    pool_stats stats() const {
+        std::lock_guard<std::mutex> lock(sizing_mutex);
+        return last;
     }
 
+    /**
+     * @brief Submit a task
+     * @param f Callable taking no arguments; moved into the pool
+     *
+     * From a worker of this pool the task goes onto that worker's deque,
+     * from any other thread onto the injection queue.
+     */
     template <typename F>
     void enqueue(F&& f) {
-        {
-            std::unique_lock<std::mutex> lock(queue_mutex);
-            tasks.emplace(std::forward<F>(f));
+        queued.fetch_add(1, std::memory_order_relaxed);
+        submit(std::forward<F>(f));
+    }
+
+    /**
+     * @brief Submit a task unless limit tasks are already waiting
+     * @param f Callable taking no arguments; left untouched when refused
+     * @param limit Tasks that may wait at once, this one included
+     * @return false if the task was refused
+     */
+    template <typename F>
+    bool try_enqueue(F&& f, std::size_t limit) {
+        if (queued.fetch_add(1, std::memory_order_relaxed) >= limit) {
+            queued.fetch_sub(1, std::memory_order_relaxed);
+            return false;
         }
-        condition.notify_one();
+        submit(std::forward<F>(f));
+        return true;
+    }
+
+    /**
+     * @brief Submit a task to run on one worker only
+     * @param worker Index of the worker, taken modulo size() (modulo
+     *        min_threads once the pool adapts its size)
+     * @param f Callable taking no arguments; moved into the pool
+     *
+     * Tasks one thread pins to a worker run in the order submitted. Meant
+     * for work that should stay on one core, e.g. the requests of one
+     * connection; a long task holds up everything pinned behind it.
+     */
+    template <typename F>
+    void enqueue_to(std::size_t worker, F&& f) {
+        queued.fetch_add(1, std::memory_order_relaxed);
+        submit_to(worker, std::forward<F>(f));
     }
 
+    /**
+     * @brief Submit a task to one worker unless limit tasks are already waiting
+     * @param worker Index of the worker, see enqueue_to()
+     * @param f Callable taking no arguments; left untouched when refused
+     * @param limit Tasks that may wait at once in the whole pool, this one included
+     * @return false if the task was refused
+     */
+    template <typename F>
+    bool try_enqueue_to(std::size_t worker, F&& f, std::size_t limit) {
+        if (queued.fetch_add(1, std::memory_order_relaxed) >= limit) {
+            queued.fetch_sub(1, std::memory_order_relaxed);
+            return false;
+        }
+        submit_to(worker, std::forward<F>(f));
+        return true;
+    }
+
+    /// @brief Number of workers taking tasks
+    std::size_t size() const noexcept { return target.load(std::memory_order_relaxed); }
+
+    /// @brief Tasks submitted and not yet started; a snapshot
+    std::size_t pending() const { return queued.load(std::memory_order_relaxed); }
+
     void stop_workers() {
         stop.store(true);
-        condition.notify_all();
+        {
+            std::lock_guard<std::mutex> lock(park_mutex);
+            ++epoch;
+        }
+        park.notify_all();
+        retired.notify_all();
+        {
+            std::lock_guard<std::mutex> lock(sizing_mutex);
+        }
+        controller_wake.notify_all();
     }
 };
 
-};  // namespace cppress::shared
\ No newline at end of file
+};  // namespace cppress::shared
@@ -2,6 +2,7 @@
 
 #include <map>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
@@ -18,22 +19,35 @@ constexpr const char* PATCH = "PATCH";
 };  // namespace methods
 
 /**
- * @brief List of known static file extensions that should be treated as static resources.
+ * @brief Whether files with an extension are static resources.
+ * @param extension File extension without the leading dot (e.g., "css", "png")
  *
- * This list is used by is_uri_static() to determine whether a request URI refers
- * to a static asset (CSS, JS, images, fonts, etc.) and therefore should be
- * served from the static file directories instead of being routed to handlers.
+ * Used by is_uri_static() to determine whether a request URI refers to a
+ * static asset (CSS, JS, images, fonts, etc.) and therefore should be
+ * served from the static file directories instead of being routed to
+ * handlers. The built-in extensions are a perfect-hash table built at
+ * compile time; add_static_extension() adds more.
  */
-extern const std::vector<std::string> static_extensions;
+bool is_static_extension(std::string_view extension);
 
 /**
- * @brief Mapping from file extension to MIME type.
- *
- * This map is used to convert file extensions to the appropriate Content-Type
- * header when serving static files. If an extension is not found the default
- * MIME type "application/octet-stream" should be used.
+ * @brief Treat files with an extension as static resources too.
+ * @param extension File extension without the leading dot
+ */
+void add_static_extension(std::string_view extension);
+
+/**
+ * @brief Map an extension to a MIME type, over the built-in table.
+ * @param extension File extension without the leading dot
+ * @param mime_type Type get_mime_type_from_extension() returns for it, a built-in one included
  */
-extern const std::map<std::string, std::string> mime_types;
+void add_mime_type(std::string_view extension, std::string_view mime_type);
+
+/**
+ * @brief Accept a method beyond the standard ones, e.g. a WebDAV method.
+ * @param method Method name as requests spell it (e.g., "PROPFIND")
+ */
+void add_method(std::string_view method);
 
 /**
  * @brief URL-encode a string according to RFC 3986.
@@ -45,30 +59,48 @@ std::string url_encode(const std::string& value);
 /**
  * @brief Decode a percent-encoded URL string.
  * @param value Percent-encoded input string
- * @return Decoded string
+ * @return Decoded string; a % not followed by two hex digits is kept as it is
+ */
+std::string url_decode(std::string_view value);
+
+/**
+ * @brief Decode a percent-encoded URL string without allocating when there is nothing to decode.
+ * @param value Percent-encoded input string
+ * @param buffer Receives the decoded string if value holds a %; its capacity is reused
+ * @return value itself when it holds no %, else a view of buffer
  */
-std::string url_decode(const std::string& value);
+std::string_view url_decode(std::string_view value, std::string& buffer);
 
 /**
  * @brief Get MIME type for a given file extension.
  * @param extension File extension without the leading dot (e.g., "js", "html")
  * @return MIME type string or "application/octet-stream" if unknown
+ *
+ * Types added with add_mime_type() come first; the built-in ones are a
+ * perfect-hash table built at compile time, one hash and one comparison.
  */
-std::string get_mime_type_from_extension(const std::string& extension);
+std::string get_mime_type_from_extension(std::string_view extension);
 
 /**
  * @brief Find a file extension associated with a MIME type.
  * @param mime_type MIME type string (e.g., "application/json")
  * @return Extension string without dot or empty string if not found
  */
-std::string get_file_extension_from_mime(const std::string& mime_type);
+std::string get_file_extension_from_mime(std::string_view mime_type);
 
 /**
  * @brief Extract file extension from a URI or filename.
  * @param uri URI or path string
  * @return Extension without the dot, or empty string if none found
  */
-std::string get_file_extension_from_uri(const std::string& uri);
+std::string get_file_extension_from_uri(std::string_view uri);
+
+/**
+ * @brief Extract file extension from a URI or filename, as a view of it.
+ * @param uri URI or path string
+ * @return Extension without the dot, or an empty view if none found
+ */
+std::string_view get_file_extension_view(std::string_view uri) noexcept;
 
 /**
  * @brief Sanitize a requested path to mitigate directory traversal.
@@ -80,35 +112,90 @@ std::string get_file_extension_from_uri(const std::string& uri);
  * callers that need full security should canonicalize on the server side before
  * opening files.
  */
-std::string sanitize_path(const std::string& path);
+std::string sanitize_path(std::string_view path);
+
+/**
+ * @brief Sanitize a requested path into a caller's buffer, as sanitize_path(std::string_view).
+ * @param path Raw path from the request URI
+ * @param out Replaced by the sanitized path; its capacity is reused
+ */
+void sanitize_path(std::string_view path, std::string& out);
 
 /**
  * @brief Trim leading and trailing whitespace from a string.
  * @param str Input string
  * @return Trimmed string
  */
-std::string trim(const std::string& str);
+std::string trim(std::string_view str);
+
+/**
+ * @brief Trim leading and trailing whitespace, as a view of the input.
+ * @param str Input string
+ * @return The part of str between the whitespace
+ */
+std::string_view trim_view(std::string_view str) noexcept;
 
 /**
  * @brief Check if an HTTP method is unknown.
  * @param method HTTP method string (e.g., "GET", "POST")
  * @return true if the method is unknown, false otherwise
  */
-bool unknown_method(const std::string& method);
+bool unknown_method(std::string_view method);
 
 /**
  * @brief Convert a string to lowercase.
  * @param str Input string
  * @return Lowercase version of the input string
  */
-std::string to_lowercase(const std::string& str);
+std::string to_lowercase(std::string_view str);
 
 /**
  * @brief Convert a string to uppercase.
  * @param str Input string
  * @return Uppercase version of the input string
  */
-std::string to_uppercase(const std::string& str);
+std::string to_uppercase(std::string_view str);
+
+/**
+ * @brief Convert ASCII letters to lowercase into a caller's buffer.
+ * @param str Input string
+ * @param out Replaced by the lowercase string; its capacity is reused
+ *
+ * Letters are folded eight bytes at a time; bytes outside ASCII are kept
+ * as they are.
+ */
+void to_lowercase(std::string_view str, std::string& out);
+
+/// @brief Convert ASCII letters to uppercase into a caller's buffer, as to_lowercase()
+void to_uppercase(std::string_view str, std::string& out);
+
+/**
+ * @brief Compare two strings ignoring the case of ASCII letters.
+ *
+ * Header names, methods and tokens compare with this instead of being
+ * upper-cased first.
+ */
+bool iequals(std::string_view a, std::string_view b) noexcept;
+
+/// @brief Whether haystack holds needle, ignoring the case of ASCII letters
+bool icontains(std::string_view haystack, std::string_view needle) noexcept;
+
+/**
+ * @brief Whether a comma-separated list, such as a Connection header, holds a token
+ *
+ * Each element is trimmed and compared whole with iequals, so "keep-alive"
+ * does not match "close" in "keep-alive, closed".
+ */
+bool has_token(std::string_view list, std::string_view token) noexcept;
+
+/**
+ * @brief Orders strings ignoring the case of ASCII letters, e.g. for a map of header names.
+ */
+struct iless {
+    using is_transparent = void;
+
+    bool operator()(std::string_view a, std::string_view b) const noexcept;
+};
 
 /**
  * @brief Get the current working directory object
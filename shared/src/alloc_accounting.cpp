@@ -0,0 +1,83 @@
+#include "includes/alloc_accounting.hpp"
+
+#if defined(CPPRESS_ALLOC_ACCOUNTING)
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+/**
+ * Replaced global allocation functions, counting into the caller's phase
+ *
+ * Implementation Notes:
+ * - They are linked into every program using cppress_shared_utils: the
+ *   linker takes this object from the archive to resolve operator new,
+ *   which every other object refers to
+ * - The other forms of new (array, nothrow, aligned) count here too; the
+ *   deallocation functions only match them
+ */
+namespace {
+void* allocate(std::size_t size) noexcept {
+    cppress::shared::count_allocation(size);
+    return std::malloc(size != 0 ? size : 1);
+}
+
+void* allocate_aligned(std::size_t size, std::align_val_t alignment) noexcept {
+    cppress::shared::count_allocation(size);
+    const std::size_t align = std::max(static_cast<std::size_t>(alignment), sizeof(void*));
+    void* p = nullptr;
+    return ::posix_memalign(&p, align, size != 0 ? size : 1) == 0 ? p : nullptr;
+}
+}  // namespace
+
+void* operator new(std::size_t size) {
+    if (void* p = allocate(size))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    if (void* p = allocate(size))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    if (void* p = allocate_aligned(size, alignment))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    if (void* p = allocate_aligned(size, alignment))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return allocate_aligned(size, alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment,
+                     const std::nothrow_t&) noexcept {
+    return allocate_aligned(size, alignment);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { std::free(p); }
+
+#endif
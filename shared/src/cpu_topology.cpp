@@ -0,0 +1,220 @@
+#include "includes/cpu_topology.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <set>
+#include <thread>
+#include <utility>
+
+namespace cppress::shared {
+
+namespace {
+/// First line of a sysfs attribute, empty if it cannot be read
+std::string read_line(const std::string& path) {
+    std::ifstream in(path);
+    std::string line;
+    std::getline(in, line);
+    return line;
+}
+
+bool is_number(std::string_view s) {
+    return !s.empty() &&
+           std::all_of(s.begin(), s.end(), [](unsigned char c) { return std::isdigit(c); });
+}
+
+int to_int(std::string_view s) {
+    int value = 0;
+    for (const char c : s)
+        value = value * 10 + (c - '0');
+    return value;
+}
+}  // namespace
+
+/**
+ * Implementation Notes:
+ * - Ranges may be given in any order and may overlap, the result is
+ *   sorted and free of duplicates
+ * - A part that is not "N" or "N-M" with N <= M is skipped
+ */
+std::vector<int> cpu_topology::parse_cpu_list(std::string_view list) {
+    std::set<int> cpus;
+    while (!list.empty()) {
+        const std::size_t comma = list.find(',');
+        std::string_view part = list.substr(0, comma);
+        list = comma == std::string_view::npos ? std::string_view() : list.substr(comma + 1);
+        while (!part.empty() && std::isspace(static_cast<unsigned char>(part.front())))
+            part.remove_prefix(1);
+        while (!part.empty() && std::isspace(static_cast<unsigned char>(part.back())))
+            part.remove_suffix(1);
+        const std::size_t dash = part.find('-');
+        const std::string_view first = part.substr(0, dash);
+        const std::string_view last =
+            dash == std::string_view::npos ? first : part.substr(dash + 1);
+        if (!is_number(first) || !is_number(last) || first.size() > 6 || last.size() > 6)
+            continue;
+        for (int cpu = to_int(first); cpu <= to_int(last); ++cpu)
+            cpus.insert(cpu);
+    }
+    return std::vector<int>(cpus.begin(), cpus.end());
+}
+
+/**
+ * Implementation Notes:
+ * - The node of a CPU comes from node/nodeN/cpulist, node 0 when the
+ *   kernel has no NUMA support
+ * - The domain of a CPU is the shared_cpu_list of its highest cache
+ *   level; CPUs without cache information share one domain per node
+ */
+cpu_topology cpu_topology::from_sysfs(const std::string& root) {
+    std::vector<int> online = parse_cpu_list(read_line(root + "/cpu/online"));
+    if (online.empty()) {
+        const unsigned int count = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned int cpu = 0; cpu < count; ++cpu)
+            online.push_back(static_cast<int>(cpu));
+    }
+
+    std::map<int, int> node_of;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(root + "/node", ec)) {
+        const std::string name = entry.path().filename().string();
+        if (name.rfind("node", 0) != 0 || !is_number(std::string_view(name).substr(4)))
+            continue;
+        const int node = to_int(std::string_view(name).substr(4));
+        for (const int cpu : parse_cpu_list(read_line(entry.path().string() + "/cpulist")))
+            node_of[cpu] = node;
+    }
+
+    std::map<std::pair<int, std::string>, std::vector<int>> by_cache;
+    for (const int cpu : online) {
+        const std::string cache = root + "/cpu/cpu" + std::to_string(cpu) + "/cache/index";
+        std::string shared_with;
+        int deepest = -1;
+        for (int index = 0;; ++index) {
+            const std::string level = read_line(cache + std::to_string(index) + "/level");
+            if (!is_number(level))
+                break;
+            if (to_int(level) > deepest) {
+                deepest = to_int(level);
+                shared_with = read_line(cache + std::to_string(index) + "/shared_cpu_list");
+            }
+        }
+        const auto node = node_of.find(cpu);
+        by_cache[{node == node_of.end() ? 0 : node->second, shared_with}].push_back(cpu);
+    }
+
+    std::vector<domain> domains;
+    for (auto& [key, cpus] : by_cache)
+        domains.push_back({key.first, std::move(cpus)});
+    return cpu_topology(std::move(domains));
+}
+
+/**
+ * Implementation Notes:
+ * - Read once on first use; the affinity mask is the process's at that time
+ */
+const cpu_topology& cpu_topology::system() {
+    static const cpu_topology detected = [] {
+        cpu_topology all = from_sysfs("/sys/devices/system");
+#if defined(__linux__) || defined(__linux)
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+            std::vector<domain> kept;
+            for (const domain& d : all.groups) {
+                domain mine{d.node, {}};
+                for (const int cpu : d.cpus)
+                    if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed))
+                        mine.cpus.push_back(cpu);
+                if (!mine.cpus.empty())
+                    kept.push_back(std::move(mine));
+            }
+            if (!kept.empty())
+                return cpu_topology(std::move(kept));
+        }
+#endif
+        return all;
+    }();
+    return detected;
+}
+
+/**
+ * Implementation Notes:
+ * - Empty domains are dropped, a topology without CPUs holds CPU 0
+ * - Domains are kept sorted by node, then by their first CPU
+ */
+cpu_topology::cpu_topology(std::vector<domain> domains) {
+    for (domain& d : domains) {
+        std::sort(d.cpus.begin(), d.cpus.end());
+        if (!d.cpus.empty())
+            groups.push_back(std::move(d));
+    }
+    if (groups.empty())
+        groups.push_back({0, {0}});
+    std::sort(groups.begin(), groups.end(), [](const domain& a, const domain& b) {
+        return a.node != b.node ? a.node < b.node : a.cpus.front() < b.cpus.front();
+    });
+}
+
+std::size_t cpu_topology::node_count() const noexcept {
+    std::size_t count = 0;
+    for (std::size_t i = 0; i < groups.size(); ++i)
+        if (i == 0 || groups[i].node != groups[i - 1].node)
+            ++count;
+    return count;
+}
+
+std::size_t cpu_topology::cpu_count() const noexcept {
+    std::size_t count = 0;
+    for (const domain& d : groups)
+        count += d.cpus.size();
+    return count;
+}
+
+/**
+ * Implementation Notes:
+ * - The k-th reactor on a domain takes its k-th CPU, wrapping around once
+ *   every CPU holds one
+ * - A domain whose every CPU holds a reactor lends all of them to its workers
+ */
+cpu_placement cpu_topology::place(std::size_t reactors, std::size_t workers) const {
+    // the first domain of every node, then the second of every node, ...
+    std::map<int, std::vector<const domain*>> per_node;
+    for (const domain& d : groups)
+        per_node[d.node].push_back(&d);
+    std::vector<const domain*> order;
+    for (std::size_t round = 0; order.size() < groups.size(); ++round)
+        for (const auto& [node, list] : per_node)
+            if (round < list.size())
+                order.push_back(list[round]);
+
+    cpu_placement plan;
+    std::vector<std::size_t> domain_of(reactors);
+    std::vector<std::set<int>> taken(order.size());
+    for (std::size_t r = 0; r < reactors; ++r) {
+        domain_of[r] = r % order.size();
+        const std::vector<int>& cpus = order[domain_of[r]]->cpus;
+        const int cpu = cpus[(r / order.size()) % cpus.size()];
+        plan.reactor_cpus.push_back({cpu});
+        taken[domain_of[r]].insert(cpu);
+    }
+
+    const std::size_t used = reactors == 0 ? order.size() : std::min(reactors, order.size());
+    plan.reactor_workers.resize(reactors);
+    for (std::size_t w = 0; w < workers; ++w) {
+        const std::size_t d = w % used;
+        std::vector<int> cpus;
+        for (const int cpu : order[d]->cpus)
+            if (taken[d].count(cpu) == 0)
+                cpus.push_back(cpu);
+        plan.worker_cpus.push_back(cpus.empty() ? order[d]->cpus : std::move(cpus));
+        for (std::size_t r = 0; r < reactors; ++r)
+            if (domain_of[r] == d)
+                plan.reactor_workers[r].push_back(w);
+    }
+    return plan;
+}
+}  // namespace cppress::shared
@@ -1,9 +1,23 @@
-
 #include "../includes/logger.hpp"
 
-#include <fstream>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <memory>
 #include <mutex>
+#include <new>
 #include <string>
+#include <thread>
+#include <vector>
 
 namespace cppress::shared::logger {
 std::string absolute_path_to_logs = "/path-you-want-to-your-logs/";
@@ -11,63 +25,390 @@ std::string absolute_path_to_logs = "/path-you-want-to-your-logs/";
 bool enabled_logging = false;
 std::mutex log_mutex;
 
-void info(const std::string& message) {
-    if (!enabled_logging)
-        return;
+namespace detail {
+std::atomic<level> min_level{level::trace};
+}  // namespace detail
 
-    std::lock_guard<std::mutex> lock(log_mutex);
-    const std::string INFO_LOGS_PATH = absolute_path_to_logs + "info.log";
-    std::ofstream log_file(INFO_LOGS_PATH, std::ios::app);
-    log_file << "[INFO] " << message << std::endl;
+namespace {
+constexpr std::size_t LEVELS = 5;
+
+const std::string_view PREFIXES[LEVELS] = {"[TRACE] ", "[DEBUG] ", "[INFO] ", "[ERROR] ",
+                                           "[FATAL] "};
+const char* const FILES[LEVELS] = {"trace.log", "debug.log", "info.log", "error.log",
+                                   "fatal.log"};
+
+/// Bytes of each thread's ring; a power of two
+constexpr std::size_t RING_SIZE = 64 * 1024;
+
+/// How long queued lines may wait for the background thread
+constexpr auto FLUSH_INTERVAL = std::chrono::milliseconds(20);
+
+/// Record header in a ring: the line's length, then its level
+constexpr std::size_t HEADER = sizeof(std::uint32_t) + 1;
+
+std::atomic<overflow_policy> policy{overflow_policy::count};
+std::atomic<std::uint64_t> dropped_total{0};
+
+/**
+ * @brief Bytes of log records written by one thread and read by the background thread.
+ *
+ * head and tail count bytes ever written and read; a record may wrap
+ * around the end of the buffer.
+ */
+struct ring {
+    std::unique_ptr<char[]> data{new char[RING_SIZE]};
+    alignas(64) std::atomic<std::size_t> head{0};
+    alignas(64) std::atomic<std::size_t> tail{0};
+    /// Lines dropped per level since the background thread last looked
+    std::atomic<std::uint32_t> dropped[LEVELS] = {};
+    /// Set when the owning thread exits; the ring goes once it is drained
+    std::atomic<bool> retired{false};
+
+    void copy_in(std::size_t at, const char* from, std::size_t n) noexcept {
+        const std::size_t offset = at & (RING_SIZE - 1);
+        const std::size_t first = std::min(n, RING_SIZE - offset);
+        std::memcpy(data.get() + offset, from, first);
+        std::memcpy(data.get(), from + first, n - first);
+    }
+
+    void copy_out(std::size_t at, char* to, std::size_t n) const noexcept {
+        const std::size_t offset = at & (RING_SIZE - 1);
+        const std::size_t first = std::min(n, RING_SIZE - offset);
+        std::memcpy(to, data.get() + offset, first);
+        std::memcpy(to + first, data.get(), n - first);
+    }
+};
+
+/// Writes every iovec, resuming after short writes
+void write_all(int fd, std::vector<iovec>& iov) {
+    std::size_t at = 0;
+    while (at < iov.size()) {
+        const int count = static_cast<int>(std::min<std::size_t>(iov.size() - at, IOV_MAX));
+        ssize_t written = ::writev(fd, iov.data() + at, count);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            return;
+        }
+        while (at < iov.size() && static_cast<std::size_t>(written) >= iov[at].iov_len) {
+            written -= static_cast<ssize_t>(iov[at].iov_len);
+            ++at;
+        }
+        if (at < iov.size()) {
+            iov[at].iov_base = static_cast<char*>(iov[at].iov_base) + written;
+            iov[at].iov_len -= static_cast<std::size_t>(written);
+        }
+    }
 }
 
-void error(const std::string& message) {
-    if (!enabled_logging)
-        return;
-    std::lock_guard<std::mutex> lock(log_mutex);
-    const std::string ERROR_LOGS_PATH = absolute_path_to_logs + "error.log";
-    std::ofstream log_file(ERROR_LOGS_PATH, std::ios::app);
-    log_file << "[ERROR] " << message << std::endl;
+/// This thread's ring, given up when the thread exits
+struct producer {
+    std::shared_ptr<ring> own;
+
+    ~producer() {
+        if (own)
+            own->retired.store(true);
+    }
+};
+
+thread_local producer local;
+
+class sink;
+sink& the_sink();
+
+/**
+ * @brief The rings of every thread, and the thread writing them to the files.
+ */
+class sink {
+public:
+    sink() : writer(std::make_unique<std::thread>([this] { run(); })) {
+        pthread_atfork([] { the_sink().before_fork(); }, [] { the_sink().after_fork(false); },
+                       [] { the_sink().after_fork(true); });
+    }
+
+    ~sink() {
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex);
+            stopping = true;
+        }
+        wake.notify_one();
+        writer->join();
+        drain();
+        for (int fd : fds)
+            if (fd >= 0)
+                ::close(fd);
+    }
+
+    std::shared_ptr<ring> add_ring() {
+        auto added = std::make_shared<ring>();
+        std::lock_guard<std::mutex> lock(rings_mutex);
+        rings.push_back(added);
+        return added;
+    }
+
+    void notify() { wake.notify_one(); }
+
+    /**
+     * Implementation Notes:
+     * - Lines are pointed at where they sit in the rings, a record wrapped
+     *   around the end of its ring as two iovecs; tails move on only after
+     *   the lines are written
+     */
+    void drain() {
+        std::lock_guard<std::mutex> lock(log_mutex);
+        std::vector<std::shared_ptr<ring>> current;
+        {
+            std::lock_guard<std::mutex> guard(rings_mutex);
+            current = rings;
+        }
+        open_files();
+
+        std::vector<iovec> lines[LEVELS];
+        std::deque<std::string> notes;
+        std::vector<std::size_t> heads(current.size());
+        const auto add = [&lines](level l, const char* p, std::size_t n) {
+            if (n)
+                lines[static_cast<std::size_t>(l)].push_back({const_cast<char*>(p), n});
+        };
+        for (std::size_t i = 0; i < current.size(); ++i) {
+            ring& r = *current[i];
+            const std::size_t tail = r.tail.load(std::memory_order_relaxed);
+            const std::size_t head = r.head.load(std::memory_order_acquire);
+            for (std::size_t at = tail; at < head;) {
+                char header[HEADER];
+                r.copy_out(at, header, HEADER);
+                std::uint32_t length;
+                std::memcpy(&length, header, sizeof(length));
+                const auto l = static_cast<level>(header[sizeof(length)]);
+                const std::string_view prefix = PREFIXES[static_cast<std::size_t>(l)];
+                add(l, prefix.data(), prefix.size());
+                const std::size_t offset = (at + HEADER) & (RING_SIZE - 1);
+                const std::size_t first = std::min<std::size_t>(length, RING_SIZE - offset);
+                add(l, r.data.get() + offset, first);
+                add(l, r.data.get(), length - first);
+                add(l, "\n", 1);
+                at += HEADER + length;
+            }
+            heads[i] = head;
+
+            for (std::size_t l = 0; l < LEVELS; ++l) {
+                const std::uint32_t count = r.dropped[l].exchange(0, std::memory_order_relaxed);
+                if (count && policy.load(std::memory_order_relaxed) == overflow_policy::count) {
+                    notes.push_back(std::string(PREFIXES[l]) + std::to_string(count) +
+                                    " log messages dropped, the thread's buffer was full\n");
+                    lines[l].push_back({notes.back().data(), notes.back().size()});
+                }
+            }
+        }
+
+        for (std::size_t l = 0; l < LEVELS; ++l)
+            if (!lines[l].empty() && fds[l] >= 0)
+                write_all(fds[l], lines[l]);
+        for (std::size_t i = 0; i < current.size(); ++i)
+            current[i]->tail.store(heads[i], std::memory_order_release);
+
+        std::lock_guard<std::mutex> guard(rings_mutex);
+        rings.erase(std::remove_if(rings.begin(), rings.end(),
+                                   [](const std::shared_ptr<ring>& r) {
+                                       return r->retired.load() &&
+                                              r->tail.load() == r->head.load();
+                                   }),
+                    rings.end());
+    }
+
+    /// Empties the files; log_mutex is held
+    void truncate() { open_files(O_TRUNC); }
+
+    /**
+     * @brief Writes a line too long for any ring at once, after what is queued.
+     */
+    void write_now(level l, const detail::piece* pieces, std::size_t count) {
+        drain();
+        std::lock_guard<std::mutex> lock(log_mutex);
+        std::vector<iovec> line;
+        const std::string_view prefix = PREFIXES[static_cast<std::size_t>(l)];
+        line.push_back({const_cast<char*>(prefix.data()), prefix.size()});
+        for (std::size_t i = 0; i < count; ++i)
+            line.push_back({const_cast<char*>(pieces[i].view().data()), pieces[i].view().size()});
+        line.push_back({const_cast<char*>("\n"), 1});
+        if (fds[static_cast<std::size_t>(l)] >= 0)
+            write_all(fds[static_cast<std::size_t>(l)], line);
+    }
+
+private:
+    void run() {
+        std::unique_lock<std::mutex> lock(wake_mutex);
+        while (!stopping) {
+            wake.wait_for(lock, FLUSH_INTERVAL);
+            lock.unlock();
+            drain();
+            lock.lock();
+        }
+    }
+
+    /**
+     * Implementation Notes:
+     * - Queued lines are written first, so neither process writes them
+     *   again; the locks are then held across fork() so the child gets
+     *   them in a known state
+     */
+    void before_fork() {
+        drain();
+        wake_mutex.lock();
+        log_mutex.lock();
+        rings_mutex.lock();
+    }
+
+    /**
+     * Implementation Notes:
+     * - The child has only the forking thread: the other threads' rings
+     *   hold lines the parent writes, and the background thread is started
+     *   again. The old thread's handle is left alone: it names a thread of
+     *   the parent
+     * - wake is made again in the child: it still counts the parent's
+     *   background thread as waiting, and destroying it at exit would wait
+     *   for that thread forever
+     */
+    void after_fork(bool child) {
+        if (child) {
+            rings.clear();
+            if (local.own)
+                rings.push_back(local.own);
+            writer.release();
+            new (&wake) std::condition_variable();
+            stopping = false;
+        }
+        rings_mutex.unlock();
+        log_mutex.unlock();
+        wake_mutex.unlock();
+        if (child)
+            writer = std::make_unique<std::thread>([this] { run(); });
+    }
+
+    /**
+     * @brief Opens the files in absolute_path_to_logs, again if it changed; log_mutex is held
+     * @param flags O_TRUNC to empty them, opening them again either way
+     */
+    void open_files(int flags = 0) {
+        if (!flags && opened_in == absolute_path_to_logs)
+            return;
+        for (std::size_t l = 0; l < LEVELS; ++l) {
+            if (fds[l] >= 0)
+                ::close(fds[l]);
+            fds[l] = ::open((absolute_path_to_logs + FILES[l]).c_str(),
+                            O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC | flags, 0644);
+        }
+        opened_in = absolute_path_to_logs;
+    }
+
+    std::mutex rings_mutex;
+    std::vector<std::shared_ptr<ring>> rings;
+
+    int fds[LEVELS] = {-1, -1, -1, -1, -1};
+    /// Directory the files were opened in
+    std::string opened_in;
+
+    std::mutex wake_mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+
+    std::unique_ptr<std::thread> writer;
+};
+
+sink& the_sink() {
+    static sink instance;
+    return instance;
 }
+}  // namespace
 
-void debug(const std::string& message) {
-    if (!enabled_logging)
+namespace detail {
+/**
+ * Implementation Notes:
+ * - Single producer: only this thread moves head, only the background
+ *   thread moves tail, so a line is queued with two atomic loads and a
+ *   release store
+ * - The background thread is woken early once the ring is half full
+ */
+void write(level l, const piece* pieces, std::size_t count) {
+    std::size_t length = 0;
+    for (std::size_t i = 0; i < count; ++i)
+        length += pieces[i].view().size();
+    sink& out = the_sink();
+    if (HEADER + length > RING_SIZE / 2) {
+        out.write_now(l, pieces, count);
         return;
-    std::lock_guard<std::mutex> lock(log_mutex);
-    const std::string DEBUG_LOGS_PATH = absolute_path_to_logs + "debug.log";
-    std::ofstream log_file(DEBUG_LOGS_PATH, std::ios::app);
-    log_file << "[DEBUG] " << message << std::endl;
-}
+    }
+    if (!local.own)
+        local.own = out.add_ring();
+    ring& r = *local.own;
 
-void trace(const std::string& message) {
-    if (!enabled_logging)
+    const std::size_t head = r.head.load(std::memory_order_relaxed);
+    const std::size_t used = head - r.tail.load(std::memory_order_acquire);
+    if (used + HEADER + length > RING_SIZE) {
+        r.dropped[static_cast<std::size_t>(l)].fetch_add(1, std::memory_order_relaxed);
+        dropped_total.fetch_add(1, std::memory_order_relaxed);
+        out.notify();
         return;
-    std::lock_guard<std::mutex> lock(log_mutex);
-    const std::string TRACE_LOGS_PATH = absolute_path_to_logs + "trace.log";
-    std::ofstream log_file(TRACE_LOGS_PATH, std::ios::app);
-    log_file << "[TRACE] " << message << std::endl;
+    }
+    char header[HEADER];
+    const auto size = static_cast<std::uint32_t>(length);
+    std::memcpy(header, &size, sizeof(size));
+    header[sizeof(size)] = static_cast<char>(l);
+    r.copy_in(head, header, HEADER);
+    std::size_t at = head + HEADER;
+    for (std::size_t i = 0; i < count; ++i) {
+        r.copy_in(at, pieces[i].view().data(), pieces[i].view().size());
+        at += pieces[i].view().size();
+    }
+    r.head.store(at, std::memory_order_release);
+    if (used + HEADER + length > RING_SIZE / 2)
+        out.notify();
 }
+}  // namespace detail
 
-void fatal(const std::string& message) {
-    if (!enabled_logging)
-        return;
-    std::lock_guard<std::mutex> lock(log_mutex);
-    const std::string FATAL_LOGS_PATH = absolute_path_to_logs + "fatal.log";
-    std::ofstream log_file(FATAL_LOGS_PATH, std::ios::app);
-    log_file << "[FATAL] " << message << std::endl;
+void set_min_level(level min) noexcept {
+    detail::min_level.store(min, std::memory_order_relaxed);
+}
+
+void set_overflow_policy(overflow_policy next) noexcept {
+    policy.store(next, std::memory_order_relaxed);
+}
+
+std::uint64_t dropped() noexcept {
+    return dropped_total.load(std::memory_order_relaxed);
+}
+
+void flush() {
+    the_sink().drain();
+}
+
+void info(std::string_view message) {
+    log(level::info, message);
+}
+
+void error(std::string_view message) {
+    log(level::error, message);
+}
+
+void debug(std::string_view message) {
+    log(level::debug, message);
+}
+
+void trace(std::string_view message) {
+    log(level::trace, message);
+}
+
+void fatal(std::string_view message) {
+    log(level::fatal, message);
 }
 
 void clear() {
     if (!enabled_logging)
         return;
-
+    sink& out = the_sink();
+    out.drain();
     std::lock_guard<std::mutex> lock(log_mutex);
-
-    std::ofstream(absolute_path_to_logs + "info.log", std::ios::trunc).close();
-    std::ofstream(absolute_path_to_logs + "error.log", std::ios::trunc).close();
-    std::ofstream(absolute_path_to_logs + "debug.log", std::ios::trunc).close();
-    std::ofstream(absolute_path_to_logs + "trace.log", std::ios::trunc).close();
-    std::ofstream(absolute_path_to_logs + "fatal.log", std::ios::trunc).close();
+    out.truncate();
 }
 
-}  // namespace cppress::shared::logger
\ No newline at end of file
+}  // namespace cppress::shared::logger
@@ -0,0 +1,731 @@
+#include "includes/shared_memory_cache.hpp"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+namespace cppress::shared {
+
+namespace {
+constexpr std::uint64_t MAGIC = 0x63707265'73736d63;
+constexpr std::uint64_t VERSION = 1;
+constexpr std::size_t MAX_CLASSES = 64;
+constexpr std::uint8_t NO_CLASS = 0xff;
+constexpr std::size_t SMALLEST_CHUNK = 64;
+
+/// Times a lookup starts over after meeting a writer before it counts as a miss
+constexpr int READ_ATTEMPTS = 8;
+
+/// Entries a lookup follows in one chain; more means it followed a chunk being reused
+constexpr std::size_t MAX_CHAIN = 4096;
+
+/// Head of a chunk, followed by the key and the value
+struct entry {
+    /// Odd while a writer changes the entry
+    std::atomic<std::uint32_t> seq;
+    std::atomic<std::uint8_t> live;
+    /// Set by hits, cleared by the CLOCK hand
+    std::atomic<std::uint8_t> referenced;
+    /// Next entry of the bucket, or next free chunk of the class; 0 ends either
+    std::atomic<std::uint64_t> next;
+    std::atomic<std::uint64_t> hash;
+    /// steady_clock nanoseconds, 0 for never
+    std::atomic<std::int64_t> expires;
+    std::atomic<std::uint32_t> key_size;
+    std::atomic<std::uint32_t> value_size;
+
+    char* data() noexcept { return reinterpret_cast<char*>(this + 1); }
+};
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free &&
+                  std::atomic<std::uint32_t>::is_always_lock_free &&
+                  std::atomic<std::uint8_t>::is_always_lock_free,
+              "entries are shared between processes, their atomics cannot use locks");
+
+struct slab_class {
+    std::uint64_t chunk;
+    /// First free chunk, 0 if none
+    std::uint64_t free;
+    std::uint64_t pages;
+    /// CLOCK hand: page, and chunk within it
+    std::uint64_t hand_page;
+    std::uint64_t hand_chunk;
+};
+
+/// FNV-1a, the same in every process and every build
+std::uint64_t hash_of(std::string_view key) noexcept {
+    std::uint64_t h = 14695981039346656037ull;
+    for (const char c : key) {
+        h ^= static_cast<unsigned char>(c);
+        h *= 1099511628211ull;
+    }
+    return h ^ (h >> 29);
+}
+
+std::int64_t now() noexcept {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+std::size_t round_up(std::size_t n, std::size_t to) noexcept { return (n + to - 1) / to * to; }
+
+std::string error_text(int error) { return std::string(strerror(error)); }
+}  // namespace
+
+struct shared_memory_cache::segment {
+    /// Written last when the segment is made, attaching processes wait for it
+    std::atomic<std::uint64_t> magic;
+    std::uint64_t version;
+    std::uint64_t bytes;
+    std::uint64_t bucket_mask;
+    std::uint64_t buckets_at;
+    std::uint64_t page_class_at;
+    std::uint64_t pages_at;
+    std::uint64_t page_count;
+    std::uint64_t class_count;
+
+    pthread_mutex_t lock;
+
+    // guarded by lock
+    std::uint64_t pages_used;
+    std::uint64_t page_hand;
+    std::uint32_t epoch;
+    slab_class classes[MAX_CLASSES];
+
+    // written under lock, read without it
+    std::atomic<std::uint64_t> entries;
+    std::atomic<std::uint64_t> cost;
+    std::atomic<std::uint64_t> evictions;
+    std::atomic<std::uint64_t> rejections;
+
+    char* raw() noexcept { return reinterpret_cast<char*>(this); }
+
+    entry& at(std::uint64_t offset) noexcept {
+        return *reinterpret_cast<entry*>(raw() + offset);
+    }
+
+    std::atomic<std::uint64_t>& bucket(std::uint64_t hash) noexcept {
+        auto* buckets = reinterpret_cast<std::atomic<std::uint64_t>*>(raw() + buckets_at);
+        return buckets[hash & bucket_mask];
+    }
+
+    std::uint8_t& page_class(std::uint64_t page) noexcept {
+        return reinterpret_cast<std::uint8_t*>(raw() + page_class_at)[page];
+    }
+
+    std::uint64_t page_at(std::uint64_t page) const noexcept { return pages_at + page * PAGE_SIZE; }
+
+    std::uint64_t page_of(std::uint64_t offset) const noexcept {
+        return (offset - pages_at) / PAGE_SIZE;
+    }
+
+    /// End of the page holding a chunk at offset, 0 if no chunk can start there
+    std::uint64_t page_end(std::uint64_t offset) const noexcept {
+        if (offset < pages_at || offset % alignof(entry) != 0 || page_of(offset) >= page_count)
+            return 0;
+        const std::uint64_t end = page_at(page_of(offset) + 1);
+        return offset + sizeof(entry) <= end ? end : 0;
+    }
+
+    bool expired(entry& e, std::int64_t time) noexcept {
+        const std::int64_t expires = e.expires.load(std::memory_order_relaxed);
+        return expires != 0 && expires <= time;
+    }
+};
+
+/**
+ * @class shared_memory_cache::writer
+ * @brief Holds the segment's lock; every change to the index and the slabs goes through it
+ */
+class shared_memory_cache::writer {
+public:
+    /// @throws std::runtime_error if the lock cannot be taken
+    explicit writer(segment& s) : s(s) {
+        const int result = pthread_mutex_lock(&s.lock);
+        if (result == EOWNERDEAD) {
+            // marked consistent only once repaired, a crash while rebuilding rebuilds again
+            rebuild();
+            pthread_mutex_consistent(&s.lock);
+        } else if (result != 0) {
+            throw std::runtime_error("shared_memory_cache: lock failed: " + error_text(result));
+        }
+    }
+
+    writer(const writer&) = delete;
+    writer& operator=(const writer&) = delete;
+
+    ~writer() { pthread_mutex_unlock(&s.lock); }
+
+    /// Smallest class whose chunks hold size bytes; size is at most PAGE_SIZE
+    std::size_t class_for(std::size_t size) const noexcept {
+        std::size_t c = 0;
+        while (s.classes[c].chunk < size)
+            ++c;
+        return c;
+    }
+
+    std::uint64_t chunk_of(std::uint64_t offset) noexcept {
+        return s.classes[s.page_class(s.page_of(offset))].chunk;
+    }
+
+    /// Live entry holding key, 0 if none
+    std::uint64_t find(std::string_view key, std::uint64_t hash) noexcept {
+        for (std::uint64_t at = s.bucket(hash).load(std::memory_order_relaxed); at != 0;) {
+            entry& e = s.at(at);
+            if (e.live.load(std::memory_order_relaxed) &&
+                e.hash.load(std::memory_order_relaxed) == hash &&
+                e.key_size.load(std::memory_order_relaxed) == key.size() &&
+                std::memcmp(e.data(), key.data(), key.size()) == 0)
+                return at;
+            at = e.next.load(std::memory_order_relaxed);
+        }
+        return 0;
+    }
+
+    /// Starts a change readers must not see half done
+    void begin(entry& e) noexcept {
+        e.seq.store(e.seq.load(std::memory_order_relaxed) | 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    void end(entry& e) noexcept {
+        e.seq.store(e.seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /// Writes a new entry into a chunk taken by allocate() and makes it the head of its bucket
+    void link(std::uint64_t at, std::uint64_t hash, std::string_view key, std::string_view value,
+              std::int64_t expires) noexcept {
+        entry& e = s.at(at);
+        std::atomic<std::uint64_t>& head = s.bucket(hash);
+        begin(e);
+        e.hash.store(hash, std::memory_order_relaxed);
+        e.key_size.store(static_cast<std::uint32_t>(key.size()), std::memory_order_relaxed);
+        e.value_size.store(static_cast<std::uint32_t>(value.size()), std::memory_order_relaxed);
+        e.expires.store(expires, std::memory_order_relaxed);
+        std::memcpy(e.data(), key.data(), key.size());
+        std::memcpy(e.data() + key.size(), value.data(), value.size());
+        e.next.store(head.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        e.referenced.store(0, std::memory_order_relaxed);
+        e.live.store(1, std::memory_order_relaxed);
+        end(e);
+        head.store(at, std::memory_order_release);
+        s.entries.fetch_add(1, std::memory_order_relaxed);
+        s.cost.fetch_add(chunk_of(at), std::memory_order_relaxed);
+    }
+
+    /// Takes a live entry out of its bucket; readers on it start over, the chunk is not freed
+    void drop(std::uint64_t at) noexcept {
+        entry& e = s.at(at);
+        std::atomic<std::uint64_t>& head = s.bucket(e.hash.load(std::memory_order_relaxed));
+        const std::uint64_t next = e.next.load(std::memory_order_relaxed);
+        if (head.load(std::memory_order_relaxed) == at) {
+            head.store(next, std::memory_order_release);
+        } else {
+            for (std::uint64_t p = head.load(std::memory_order_relaxed); p != 0;) {
+                entry& before = s.at(p);
+                const std::uint64_t after = before.next.load(std::memory_order_relaxed);
+                if (after == at) {
+                    before.next.store(next, std::memory_order_release);
+                    break;
+                }
+                p = after;
+            }
+        }
+        begin(e);
+        e.live.store(0, std::memory_order_relaxed);
+        e.referenced.store(0, std::memory_order_relaxed);
+        end(e);
+        s.entries.fetch_sub(1, std::memory_order_relaxed);
+        s.cost.fetch_sub(chunk_of(at), std::memory_order_relaxed);
+    }
+
+    /// Returns a chunk that is not live to its class
+    void release(std::uint64_t at) noexcept {
+        slab_class& k = s.classes[s.page_class(s.page_of(at))];
+        entry& e = s.at(at);
+        e.next.store(k.free, std::memory_order_relaxed);
+        k.free = at;
+    }
+
+    /**
+     * @brief A chunk of a class for a new entry
+     * @return Its offset, 0 if none could be had
+     *
+     * A free chunk first, then a page never used, then the CLOCK victim of
+     * the class, then a page taken from another class.
+     */
+    std::uint64_t allocate(std::size_t c) noexcept {
+        slab_class& k = s.classes[c];
+        if (k.free == 0 && s.pages_used < s.page_count) {
+            carve(s.pages_used, c);
+            ++s.pages_used;
+        }
+        if (k.free == 0 && k.pages > 0) {
+            if (const std::uint64_t victim = evict(c))
+                return victim;
+        }
+        if (k.free == 0)
+            take_page(c);
+        const std::uint64_t at = k.free;
+        if (at != 0)
+            k.free = s.at(at).next.load(std::memory_order_relaxed);
+        return at;
+    }
+
+    /// Drops every entry matching a predicate, returns how many
+    template <typename Predicate>
+    std::size_t drop_if(Predicate&& matches) noexcept {
+        std::size_t dropped = 0;
+        for (std::uint64_t b = 0; b <= s.bucket_mask; ++b) {
+            std::uint64_t at = s.bucket(b).load(std::memory_order_relaxed);
+            while (at != 0) {
+                const std::uint64_t next = s.at(at).next.load(std::memory_order_relaxed);
+                if (matches(s.at(at))) {
+                    drop(at);
+                    release(at);
+                    ++dropped;
+                }
+                at = next;
+            }
+        }
+        return dropped;
+    }
+
+private:
+    /// Cuts a page into chunks of a class and frees them, lowest offset first
+    void carve(std::uint64_t page, std::size_t c) noexcept {
+        slab_class& k = s.classes[c];
+        s.page_class(page) = static_cast<std::uint8_t>(c);
+        ++k.pages;
+        const std::uint64_t per_page = PAGE_SIZE / k.chunk;
+        for (std::uint64_t i = per_page; i-- > 0;) {
+            const std::uint64_t at = s.page_at(page) + i * k.chunk;
+            entry& e = s.at(at);
+            e.seq.store(s.epoch, std::memory_order_relaxed);
+            e.live.store(0, std::memory_order_relaxed);
+            e.next.store(k.free, std::memory_order_relaxed);
+            k.free = at;
+        }
+    }
+
+    /**
+     * Implementation Notes:
+     * - A chunk that is not live while the class has no free chunk was lost
+     *   by a process that died mid-change, and is taken as it is
+     * - Two passes clear every reference bit, so the hand ends on a victim
+     */
+    std::uint64_t evict(std::size_t c) noexcept {
+        slab_class& k = s.classes[c];
+        const std::uint64_t per_page = PAGE_SIZE / k.chunk;
+        const std::int64_t time = now();
+        for (std::uint64_t step = 0; step < 2 * k.pages * per_page + 1; ++step) {
+            if (k.hand_chunk >= per_page || k.hand_page >= s.pages_used ||
+                s.page_class(k.hand_page) != c) {
+                std::uint64_t j = 1;
+                while (j <= s.pages_used && s.page_class((k.hand_page + j) % s.pages_used) != c)
+                    ++j;
+                if (j > s.pages_used)
+                    return 0;
+                k.hand_page = (k.hand_page + j) % s.pages_used;
+                k.hand_chunk = 0;
+            }
+            const std::uint64_t at = s.page_at(k.hand_page) + k.hand_chunk++ * k.chunk;
+            entry& e = s.at(at);
+            if (!e.live.load(std::memory_order_relaxed))
+                return at;
+            if (e.referenced.load(std::memory_order_relaxed) && !s.expired(e, time)) {
+                e.referenced.store(0, std::memory_order_relaxed);
+                continue;
+            }
+            drop(at);
+            s.evictions.fetch_add(1, std::memory_order_relaxed);
+            return at;
+        }
+        return 0;
+    }
+
+    /**
+     * Implementation Notes:
+     * - Pages are taken round-robin from classes holding more than one, or
+     *   from any class when c holds none
+     * - The page is zeroed before it is cut again, and its new chunks start
+     *   from a sequence number no chunk had since the last page moved
+     */
+    bool take_page(std::size_t c) noexcept {
+        for (std::uint64_t i = 0; i < s.pages_used; ++i) {
+            const std::uint64_t page = (s.page_hand + i) % s.pages_used;
+            const std::uint8_t from = s.page_class(page);
+            if (from == c || from >= s.class_count ||
+                (s.classes[from].pages < 2 && s.classes[c].pages > 0))
+                continue;
+            s.page_hand = page + 1;
+            slab_class& old = s.classes[from];
+            const std::uint64_t first = s.page_at(page);
+            const std::uint64_t last = s.page_at(page + 1);
+            for (std::uint64_t at = first; at + old.chunk <= last; at += old.chunk) {
+                if (s.at(at).live.load(std::memory_order_relaxed)) {
+                    drop(at);
+                    s.evictions.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+            std::uint64_t* link = &old.free;
+            while (*link != 0) {
+                entry& e = s.at(*link);
+                if (*link >= first && *link < last) {
+                    *link = e.next.load(std::memory_order_relaxed);
+                } else {
+                    // next is an atomic in the chunk, read and written only under the lock
+                    link = reinterpret_cast<std::uint64_t*>(&e.next);
+                }
+            }
+            --old.pages;
+            s.epoch += 2;
+            std::memset(s.raw() + first, 0, PAGE_SIZE);
+            carve(page, c);
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     * Implementation Notes:
+     * - Run when the previous holder of the lock died: live chunks whose
+     *   sequence number is even are relinked, every other chunk is freed
+     * - A key found twice (a replacement cut short) keeps one entry
+     * - A page whose class is unknown (a move cut short) is cut again
+     */
+    void rebuild() noexcept {
+        for (std::uint64_t b = 0; b <= s.bucket_mask; ++b)
+            s.bucket(b).store(0, std::memory_order_release);
+        for (std::uint64_t c = 0; c < s.class_count; ++c) {
+            s.classes[c].free = 0;
+            s.classes[c].pages = 0;
+            s.classes[c].hand_page = 0;
+            s.classes[c].hand_chunk = 0;
+        }
+        s.entries.store(0, std::memory_order_relaxed);
+        s.cost.store(0, std::memory_order_relaxed);
+        for (std::uint64_t page = 0; page < s.pages_used; ++page) {
+            const std::uint8_t c = s.page_class(page);
+            if (c >= s.class_count) {
+                s.epoch += 2;
+                std::memset(s.raw() + s.page_at(page), 0, PAGE_SIZE);
+                carve(page, 0);
+                continue;
+            }
+            slab_class& k = s.classes[c];
+            ++k.pages;
+            for (std::uint64_t i = 0; i < PAGE_SIZE / k.chunk; ++i) {
+                const std::uint64_t at = s.page_at(page) + i * k.chunk;
+                entry& e = s.at(at);
+                const std::uint32_t seq = e.seq.load(std::memory_order_relaxed);
+                const std::uint64_t key_size = e.key_size.load(std::memory_order_relaxed);
+                const std::uint64_t size =
+                    sizeof(entry) + key_size + e.value_size.load(std::memory_order_relaxed);
+                const std::uint64_t hash = e.hash.load(std::memory_order_relaxed);
+                if (e.live.load(std::memory_order_relaxed) && seq % 2 == 0 && size <= k.chunk &&
+                    find(std::string_view(e.data(), key_size), hash) == 0) {
+                    e.next.store(s.bucket(hash).load(std::memory_order_relaxed),
+                                 std::memory_order_relaxed);
+                    s.bucket(hash).store(at, std::memory_order_release);
+                    s.entries.fetch_add(1, std::memory_order_relaxed);
+                    s.cost.fetch_add(k.chunk, std::memory_order_relaxed);
+                    continue;
+                }
+                e.seq.store(seq + seq % 2, std::memory_order_relaxed);
+                e.live.store(0, std::memory_order_relaxed);
+                release(at);
+            }
+        }
+    }
+
+    segment& s;
+};
+
+namespace {
+/// Where the parts of a segment of a given size go
+struct layout {
+    std::uint64_t buckets;
+    std::uint64_t buckets_at;
+    std::uint64_t page_class_at;
+    std::uint64_t pages_at;
+    std::uint64_t page_count;
+};
+
+template <typename Segment>
+layout plan(std::size_t bytes) {
+    layout l{};
+    l.buckets = 64;
+    while (l.buckets < bytes / 1024)
+        l.buckets *= 2;
+    l.buckets_at = round_up(sizeof(Segment), 64);
+    l.page_class_at = l.buckets_at + l.buckets * sizeof(std::uint64_t);
+    l.pages_at = round_up(l.page_class_at + bytes / shared_memory_cache::PAGE_SIZE, 4096);
+    l.page_count = bytes > l.pages_at ? (bytes - l.pages_at) / shared_memory_cache::PAGE_SIZE : 0;
+    if (l.page_count < 4)
+        throw std::invalid_argument("shared_memory_cache: " + std::to_string(bytes) +
+                                    " bytes hold fewer than 4 pages");
+    return l;
+}
+}  // namespace
+
+shared_memory_cache::shared_memory_cache(std::size_t capacity)
+    : shared_memory_cache([capacity] {
+          options o;
+          o.capacity = capacity;
+          return o;
+      }()) {}
+
+/**
+ * Implementation Notes:
+ * - A named segment is created with O_EXCL: the process that creates it
+ *   sizes and initializes it, the others wait up to two seconds for its
+ *   size and then its magic number, and map it at the size it has
+ * - Memory of a new segment is zero, which is an empty index and pages
+ *   nobody holds
+ */
+shared_memory_cache::shared_memory_cache(options o) : bytes(o.capacity), ttl(o.ttl) {
+    bool create = true;
+    int fd = -1;
+    if (!o.name.empty()) {
+        fd = ::shm_open(o.name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+        if (fd == -1 && errno == EEXIST) {
+            create = false;
+            fd = ::shm_open(o.name.c_str(), O_RDWR | O_CLOEXEC, 0);
+        }
+        if (fd == -1)
+            throw std::runtime_error("shared_memory_cache: shm_open " + o.name +
+                                     " failed: " + error_text(errno));
+    }
+    const auto deadline = clock::now() + std::chrono::seconds(2);
+    layout l{};
+    try {
+        if (create) {
+            l = plan<segment>(bytes);
+            if (fd != -1 && ::ftruncate(fd, static_cast<off_t>(bytes)) != 0)
+                throw std::runtime_error("shared_memory_cache: ftruncate failed: " +
+                                         error_text(errno));
+        } else {
+            struct stat st{};
+            while (::fstat(fd, &st) == 0 && st.st_size == 0 && clock::now() < deadline)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            if (st.st_size == 0)
+                throw std::runtime_error("shared_memory_cache: " + o.name + " was never sized");
+            bytes = static_cast<std::size_t>(st.st_size);
+        }
+    } catch (...) {
+        if (fd != -1) {
+            ::close(fd);
+            if (create)
+                ::shm_unlink(o.name.c_str());
+        }
+        throw;
+    }
+
+    void* mapped = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                          fd == -1 ? MAP_SHARED | MAP_ANONYMOUS : MAP_SHARED, fd, 0);
+    const int map_error = errno;
+    if (fd != -1)
+        ::close(fd);
+    if (mapped == MAP_FAILED) {
+        if (create && !o.name.empty())
+            ::shm_unlink(o.name.c_str());
+        throw std::runtime_error("shared_memory_cache: mmap failed: " + error_text(map_error));
+    }
+    base = static_cast<segment*>(mapped);
+
+    if (!create) {
+        while (base->magic.load(std::memory_order_acquire) != MAGIC && clock::now() < deadline)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        if (base->magic.load(std::memory_order_acquire) != MAGIC || base->version != VERSION ||
+            base->bytes != bytes) {
+            ::munmap(mapped, bytes);
+            throw std::runtime_error("shared_memory_cache: " + o.name +
+                                     " is not a segment of this version");
+        }
+        return;
+    }
+
+    base->version = VERSION;
+    base->bytes = bytes;
+    base->bucket_mask = l.buckets - 1;
+    base->buckets_at = l.buckets_at;
+    base->page_class_at = l.page_class_at;
+    base->pages_at = l.pages_at;
+    base->page_count = l.page_count;
+    std::memset(base->raw() + l.page_class_at, NO_CLASS, l.page_count);
+    std::size_t count = 0;
+    for (std::size_t chunk = SMALLEST_CHUNK; chunk < PAGE_SIZE;
+         chunk = round_up(chunk + chunk / 4, alignof(entry)))
+        base->classes[count++].chunk = chunk;
+    base->classes[count++].chunk = PAGE_SIZE;
+    base->class_count = count;
+
+    pthread_mutexattr_t attributes;
+    pthread_mutexattr_init(&attributes);
+    pthread_mutexattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&attributes, PTHREAD_MUTEX_ROBUST);
+    pthread_mutex_init(&base->lock, &attributes);
+    pthread_mutexattr_destroy(&attributes);
+    base->magic.store(MAGIC, std::memory_order_release);
+}
+
+shared_memory_cache::~shared_memory_cache() {
+    if (base)
+        ::munmap(base, bytes);
+}
+
+/**
+ * Lookup Steps:
+ * 1. Read the entry's sequence number; odd means a writer is at it
+ * 2. Copy what the entry holds: its link, hash, sizes, and the key and
+ *    value if the hash and key size match
+ * 3. Read the sequence number again; if it changed, the copy may be torn
+ *    or the entry was moved, and the lookup starts over from the bucket
+ * 4. A live entry with the key is a hit unless expired; a dead entry was
+ *    unlinked after the lookup reached it, so it also starts over
+ */
+shared_memory_cache::value_ptr shared_memory_cache::get(std::string_view key) {
+    const std::uint64_t hash = hash_of(key);
+    const std::int64_t time = now();
+    for (int attempt = 0; attempt < READ_ATTEMPTS; ++attempt) {
+        std::uint64_t at = base->bucket(hash).load(std::memory_order_acquire);
+        bool again = false;
+        for (std::size_t steps = 0; at != 0 && !again; ++steps) {
+            const std::uint64_t end = base->page_end(at);
+            if (end == 0 || steps == MAX_CHAIN) {
+                again = true;
+                break;
+            }
+            entry& e = base->at(at);
+            const std::uint32_t seq = e.seq.load(std::memory_order_acquire);
+            if (seq % 2 != 0) {
+                again = true;
+                break;
+            }
+            const bool live = e.live.load(std::memory_order_relaxed);
+            const std::uint64_t next = e.next.load(std::memory_order_relaxed);
+            const std::uint64_t key_size = e.key_size.load(std::memory_order_relaxed);
+            const std::uint64_t value_size = e.value_size.load(std::memory_order_relaxed);
+            const bool found = e.hash.load(std::memory_order_relaxed) == hash &&
+                               key_size == key.size() &&
+                               at + sizeof(entry) + key_size + value_size <= end &&
+                               std::memcmp(e.data(), key.data(), key_size) == 0;
+            std::string value;
+            if (found)
+                value.assign(e.data() + key_size, value_size);
+            const bool stale = base->expired(e, time);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (e.seq.load(std::memory_order_relaxed) != seq || !live) {
+                again = true;
+                break;
+            }
+            if (found) {
+                if (stale)
+                    break;
+                if (!e.referenced.load(std::memory_order_relaxed))
+                    e.referenced.store(1, std::memory_order_relaxed);
+                hits.fetch_add(1, std::memory_order_relaxed);
+                return std::make_shared<const std::string>(std::move(value));
+            }
+            at = next;
+        }
+        if (!again)
+            break;
+    }
+    misses.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+}
+
+/**
+ * Implementation Notes:
+ * - The new entry is linked before the one it replaces is dropped, so a
+ *   lookup meanwhile finds one of them
+ */
+bool shared_memory_cache::put(std::string_view key, std::string_view value,
+                              std::chrono::milliseconds time_to_live) {
+    const std::size_t size = sizeof(entry) + key.size() + value.size();
+    if (size > PAGE_SIZE) {
+        base->rejections.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    const std::int64_t expires =
+        time_to_live.count() > 0
+            ? now() + std::chrono::duration_cast<std::chrono::nanoseconds>(time_to_live).count()
+            : 0;
+    const std::uint64_t hash = hash_of(key);
+    writer w(*base);
+    const std::uint64_t at = w.allocate(w.class_for(size));
+    if (at == 0) {
+        base->rejections.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    const std::uint64_t old = w.find(key, hash);
+    w.link(at, hash, key, value, expires);
+    if (old != 0) {
+        w.drop(old);
+        w.release(old);
+    }
+    return true;
+}
+
+bool shared_memory_cache::erase(std::string_view key) {
+    const std::uint64_t hash = hash_of(key);
+    writer w(*base);
+    const std::uint64_t at = w.find(key, hash);
+    if (at == 0)
+        return false;
+    w.drop(at);
+    w.release(at);
+    return true;
+}
+
+void shared_memory_cache::clear() {
+    writer w(*base);
+    w.drop_if([](entry&) { return true; });
+}
+
+std::size_t shared_memory_cache::purge_expired() {
+    const std::int64_t time = now();
+    writer w(*base);
+    return w.drop_if([this, time](entry& e) { return base->expired(e, time); });
+}
+
+std::size_t shared_memory_cache::cost() const noexcept {
+    return base->cost.load(std::memory_order_relaxed);
+}
+
+std::size_t shared_memory_cache::size() const noexcept {
+    return base->entries.load(std::memory_order_relaxed);
+}
+
+shared_memory_cache::statistics shared_memory_cache::stats() const noexcept {
+    statistics s;
+    s.hits = hits.load(std::memory_order_relaxed);
+    s.misses = misses.load(std::memory_order_relaxed);
+    s.loads = loads.load(std::memory_order_relaxed);
+    s.evictions = base->evictions.load(std::memory_order_relaxed);
+    s.rejections = base->rejections.load(std::memory_order_relaxed);
+    s.cost = cost();
+    s.entries = size();
+    return s;
+}
+
+bool shared_memory_cache::remove(const std::string& name) {
+    return ::shm_unlink(name.c_str()) == 0;
+}
+
+void shared_memory_cache::end_load(const std::string& key) {
+    std::lock_guard<std::mutex> guard(loading_lock);
+    loading.erase(key);
+}
+}  // namespace cppress::shared
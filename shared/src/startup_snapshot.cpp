@@ -0,0 +1,198 @@
+#include "includes/startup_snapshot.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+
+namespace cppress::shared {
+
+namespace {
+constexpr std::uint64_t MAGIC = 0x63707265'73736e70;
+
+/// Magic, version, section count, file length and table length
+constexpr std::size_t HEADER_SIZE = 8 + 4 + 4 + 8 + 8;
+
+/// Sections start on this boundary, so one holding integers can be read in place
+constexpr std::size_t ALIGNMENT = 8;
+
+std::size_t aligned(std::size_t offset) { return (offset + ALIGNMENT - 1) & ~(ALIGNMENT - 1); }
+}  // namespace
+
+snapshot_source snapshot_source::of(const std::string& path) {
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    const auto modified = fs::last_write_time(path, ec);
+    if (ec)
+        throw std::runtime_error("Cannot stat snapshot source " + path + ": " + ec.message());
+    snapshot_source source{path, static_cast<std::int64_t>(modified.time_since_epoch().count()), 0};
+    if (fs::is_regular_file(path, ec))
+        source.size = fs::file_size(path, ec);
+    return source;
+}
+
+bool snapshot_source::unchanged() const {
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    const auto now = fs::last_write_time(path, ec);
+    if (ec || static_cast<std::int64_t>(now.time_since_epoch().count()) != modified)
+        return false;
+    const std::uint64_t current = fs::is_regular_file(path, ec) ? fs::file_size(path, ec) : 0;
+    return !ec && current == size;
+}
+
+void snapshot_writer::add(std::string name, std::string bytes,
+                          std::vector<snapshot_source> sources) {
+    auto same = std::find_if(sections.begin(), sections.end(),
+                             [&](const section& s) { return s.name == name; });
+    if (same != sections.end()) {
+        same->bytes = std::move(bytes);
+        same->sources = std::move(sources);
+        return;
+    }
+    sections.push_back({std::move(name), std::move(bytes), std::move(sources)});
+}
+
+/**
+ * Implementation Notes:
+ * - The table lists each section's name, sources, and offset and length
+ *   from the start of the data, which follows the table aligned
+ * - Written to path.<pid>.tmp and renamed, so concurrent writers each
+ *   replace the file whole and readers never see a partial one
+ */
+void snapshot_writer::save(const std::string& path) const {
+    snapshot_encoder table;
+    std::size_t offset = 0;
+    for (const auto& s : sections) {
+        table.string(s.name);
+        table.u64(s.sources.size());
+        for (const auto& source : s.sources) {
+            table.string(source.path);
+            table.u64(static_cast<std::uint64_t>(source.modified));
+            table.u64(source.size);
+        }
+        table.u64(offset);
+        table.u64(s.bytes.size());
+        offset = aligned(offset + s.bytes.size());
+    }
+    const std::size_t data_start = aligned(HEADER_SIZE + table.bytes().size());
+
+    snapshot_encoder header;
+    header.u64(MAGIC);
+    header.u32(startup_snapshot::VERSION);
+    header.u32(static_cast<std::uint32_t>(sections.size()));
+    header.u64(data_start + offset);
+    header.u64(table.bytes().size());
+
+    std::string file = header.take() + table.bytes();
+    file.resize(data_start, '\0');
+    for (const auto& s : sections) {
+        file += s.bytes;
+        file.resize(aligned(file.size()), '\0');
+    }
+
+    const std::string temporary = path + "." + std::to_string(::getpid()) + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        out.write(file.data(), static_cast<std::streamsize>(file.size()));
+        if (!out.flush())
+            throw std::runtime_error("Cannot write snapshot " + temporary);
+    }
+    std::error_code ec;
+    std::filesystem::rename(temporary, path, ec);
+    if (ec) {
+        std::filesystem::remove(temporary, ec);
+        throw std::runtime_error("Cannot replace snapshot " + path);
+    }
+}
+
+/**
+ * Implementation Notes:
+ * - The file is mapped, not read: the sections are paged in as they are
+ *   asked for, and the bytes a loader copies out come from the page cache
+ * - The header's length must match the file's, which catches a file cut
+ *   short; every read of the table is bounds-checked by snapshot_decoder
+ */
+std::shared_ptr<const startup_snapshot> startup_snapshot::open(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return nullptr;
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < HEADER_SIZE) {
+        ::close(fd);
+        return nullptr;
+    }
+    const std::size_t length = static_cast<std::size_t>(st.st_size);
+    void* map = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED)
+        return nullptr;
+
+    std::shared_ptr<startup_snapshot> snapshot(new startup_snapshot());
+    snapshot->map = map;
+    snapshot->length = length;
+    const std::string_view file(static_cast<const char*>(map), length);
+    try {
+        snapshot_decoder header(file.substr(0, HEADER_SIZE));
+        if (header.u64() != MAGIC || header.u32() != VERSION)
+            return nullptr;
+        const std::uint32_t count = header.u32();
+        if (header.u64() != length)
+            return nullptr;
+        const std::uint64_t table_size = header.u64();
+        if (table_size > length - HEADER_SIZE)
+            return nullptr;
+        const std::size_t data_start = aligned(HEADER_SIZE + table_size);
+        if (data_start > length)
+            return nullptr;
+
+        snapshot_decoder table(file.substr(HEADER_SIZE, table_size));
+        snapshot->sections.reserve(count);
+        for (std::uint32_t i = 0; i < count; ++i) {
+            entry e;
+            e.name = table.string();
+            const std::size_t sources = table.count(8 + 8 + 8);
+            for (std::size_t j = 0; j < sources; ++j) {
+                snapshot_source source;
+                source.path = std::string(table.string());
+                source.modified = static_cast<std::int64_t>(table.u64());
+                source.size = table.u64();
+                e.sources.push_back(std::move(source));
+            }
+            const std::uint64_t offset = table.u64();
+            const std::uint64_t size = table.u64();
+            if (offset > length - data_start || size > length - data_start - offset)
+                return nullptr;
+            e.bytes = file.substr(data_start + offset, size);
+            snapshot->sections.push_back(std::move(e));
+        }
+        if (!table.done())
+            return nullptr;
+    } catch (const std::runtime_error&) {
+        return nullptr;
+    }
+    return snapshot;
+}
+
+startup_snapshot::~startup_snapshot() {
+    if (map)
+        ::munmap(map, length);
+}
+
+std::optional<std::string_view> startup_snapshot::section(std::string_view name) const {
+    for (const auto& e : sections) {
+        if (e.name != name)
+            continue;
+        for (const auto& source : e.sources)
+            if (!source.unchanged())
+                return std::nullopt;
+        return e.bytes;
+    }
+    return std::nullopt;
+}
+}  // namespace cppress::shared
@@ -6,15 +6,81 @@
 #endif
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
 #include <iomanip>
 #include <iostream>
 #include <map>
+#include <mutex>
+#include <set>
+#include <shared_mutex>
 #include <sstream>
 #include <string>
 #include <vector>
 
+#include "includes/perfect_hash.hpp"
+
 namespace cppress::shared {
 
+namespace {
+constexpr std::uint64_t ONES = 0x0101010101010101ULL;
+constexpr std::uint64_t HIGH = 0x8080808080808080ULL;
+
+/**
+ * SWAR: bit 5 (the ASCII case bit) of each byte of x that is a letter in
+ * [first, first + 25]. The low seven bits of each byte are offset so the
+ * byte's high bit tells "at least first" and "above the last letter"
+ * without carrying into the next byte; bytes outside ASCII are left out.
+ */
+inline std::uint64_t case_bits(std::uint64_t x, char first) noexcept {
+    const std::uint64_t low = x & ~HIGH;
+    const std::uint64_t at_least = low + ONES * static_cast<std::uint64_t>(0x80 - first);
+    const std::uint64_t above = low + ONES * static_cast<std::uint64_t>(0x7f - (first + 25));
+    return (at_least & ~above & ~x & HIGH) >> 2;
+}
+
+inline std::uint64_t load8(const char* p) noexcept {
+    std::uint64_t x;
+    std::memcpy(&x, p, sizeof(x));
+    return x;
+}
+
+inline char fold_byte(char c, char first) noexcept {
+    return c >= first && c <= first + 25 ? static_cast<char>(c ^ 0x20) : c;
+}
+
+/// Copies str into out with the letters from first to first + 25 switched to the other case
+void fold(std::string_view str, std::string& out, char first) {
+    out.resize(str.size());
+    const char* src = str.data();
+    char* dst = &out[0];
+    std::size_t i = 0;
+    for (; i + 8 <= str.size(); i += 8) {
+        const std::uint64_t x = load8(src + i);
+        const std::uint64_t folded = x ^ case_bits(x, first);
+        std::memcpy(dst + i, &folded, sizeof(folded));
+    }
+    for (; i < str.size(); ++i)
+        dst[i] = fold_byte(src[i], first);
+}
+
+inline char lower_byte(char c) noexcept {
+    return fold_byte(c, 'A');
+}
+
+int hex_value(char c) noexcept {
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+}  // namespace
+
 // Helper functions for web-related tasks
 
 std::string url_encode(const std::string& value) {
@@ -34,24 +100,43 @@ std::string url_encode(const std::string& value) {
     return escaped.str();
 }
 
-std::string url_decode(const std::string& value) {
-    std::string decoded;
-    for (size_t i = 0; i < value.length(); ++i) {
-        if (value[i] == '%') {
-            if (i + 2 < value.length()) {
-                std::string hex = value.substr(i + 1, 2);
-                char decoded_char = static_cast<char>(std::stoi(hex, nullptr, 16));
-                decoded += decoded_char;
-                i += 2;
-            }
-        } else {
-            decoded += value[i];
+std::string url_decode(std::string_view value) {
+    std::string buffer;
+    const std::string_view decoded = url_decode(value, buffer);
+    return decoded.data() == value.data() ? std::string(value) : buffer;
+}
+
+/**
+ * Implementation Notes:
+ * - The bytes before the first % are copied at once, and so is each run
+ *   between two escapes
+ */
+std::string_view url_decode(std::string_view value, std::string& buffer) {
+    std::size_t pos = value.find('%');
+    if (pos == std::string_view::npos)
+        return value;
+    buffer.clear();
+    buffer.reserve(value.size());
+    std::size_t copied = 0;
+    for (; pos != std::string_view::npos; pos = value.find('%', pos)) {
+        const int high = pos + 2 < value.size() ? hex_value(value[pos + 1]) : -1;
+        const int low = high < 0 ? -1 : hex_value(value[pos + 2]);
+        if (low < 0) {
+            ++pos;
+            continue;
         }
+        buffer.append(value, copied, pos - copied);
+        buffer.push_back(static_cast<char>(high * 16 + low));
+        pos += 3;
+        copied = pos;
     }
-    return decoded;
+    buffer.append(value, copied);
+    return buffer;
 }
 
-const std::vector<std::string> static_extensions = {
+namespace {
+/// Extensions is_static_extension() knows without add_static_extension()
+constexpr std::string_view STATIC_EXTENSIONS[] = {
     // Web Documents
     "html", "htm", "xhtml", "xml",
     // Stylesheets
@@ -77,7 +162,13 @@ const std::vector<std::string> static_extensions = {
     // Other common formats
     "swf", "eps", "ai", "psd", "sketch"};
 
-const std::map<std::string, std::string> mime_types = {
+struct mime_entry {
+    std::string_view extension;
+    std::string_view type;
+};
+
+/// Types get_mime_type_from_extension() knows without add_mime_type()
+constexpr mime_entry MIME_TYPES[] = {
     // Web Documents
     {"html", "text/html"},
     {"htm", "text/html"},
@@ -177,69 +268,241 @@ const std::map<std::string, std::string> mime_types = {
     {"psd", "image/vnd.adobe.photoshop"},
     {"sketch", "application/x-sketch"}};
 
-std::string get_mime_type_from_extension(const std::string& extension) {
-    auto it = mime_types.find(extension);
-    if (it != mime_types.end()) {
-        return it->second;
-    }
-    return "application/octet-stream";
+constexpr std::string_view METHODS[] = {methods::GET,   methods::POST, methods::PUT,
+                                         methods::DELETE_, methods::PATCH, methods::HEAD,
+                                         methods::OPTIONS};
+
+template <std::size_t N>
+constexpr std::array<std::string_view, N> extensions_of(const mime_entry (&entries)[N]) {
+    std::array<std::string_view, N> keys{};
+    for (std::size_t i = 0; i < N; ++i)
+        keys[i] = entries[i].extension;
+    return keys;
 }
 
-std::string get_file_extension_from_mime(const std::string& mime_type) {
-    for (const auto& pair : mime_types) {
-        if (pair.second == mime_type) {
-            return pair.first;
-        }
-    }
-    return "";
+constexpr perfect_hash static_extension_table(STATIC_EXTENSIONS);
+constexpr perfect_hash mime_table(extensions_of(MIME_TYPES));
+constexpr perfect_hash method_table(METHODS);
+
+/**
+ * @brief Entries added at runtime, looked at before the tables.
+ *
+ * Until something is added, lookups only test the flag.
+ */
+struct overlay {
+    std::shared_mutex mutex;
+    std::map<std::string, std::string, std::less<>> mime_types;
+    std::set<std::string, std::less<>> static_extensions;
+    std::set<std::string, std::less<>> methods;
+};
+
+std::atomic<bool> overlaid{false};
+
+overlay& overlays() {
+    static overlay instance;
+    return instance;
+}
+}  // namespace
+
+bool is_static_extension(std::string_view extension) {
+    if (static_extension_table.contains(extension))
+        return true;
+    if (!overlaid.load(std::memory_order_acquire))
+        return false;
+    overlay& added = overlays();
+    std::shared_lock<std::shared_mutex> lock(added.mutex);
+    return added.static_extensions.count(extension) != 0;
 }
 
-std::string get_file_extension_from_uri(const std::string& uri) {
-    size_t dot_pos = uri.find_last_of('.');
-    if (dot_pos != std::string::npos) {
-        return uri.substr(dot_pos + 1);
+std::string get_mime_type_from_extension(std::string_view extension) {
+    if (overlaid.load(std::memory_order_acquire)) {
+        overlay& added = overlays();
+        std::shared_lock<std::shared_mutex> lock(added.mutex);
+        const auto it = added.mime_types.find(extension);
+        if (it != added.mime_types.end())
+            return it->second;
     }
-    return "";
+    const std::size_t at = mime_table.find(extension);
+    return std::string(at == mime_table.NONE ? "application/octet-stream" : MIME_TYPES[at].type);
 }
 
-std::string sanitize_path(const std::string& path) {
-    std::string sanitized = path;
-    size_t pos;
-    while ((pos = sanitized.find("..")) != std::string::npos) {
-        sanitized.erase(pos, 2);
+/**
+ * Implementation Notes:
+ * - Of several extensions of a type, the first in alphabetical order is
+ *   returned, as when the types were kept in an ordered map
+ */
+std::string get_file_extension_from_mime(std::string_view mime_type) {
+    if (overlaid.load(std::memory_order_acquire)) {
+        overlay& added = overlays();
+        std::shared_lock<std::shared_mutex> lock(added.mutex);
+        for (const auto& [extension, type] : added.mime_types)
+            if (type == mime_type)
+                return extension;
     }
+    std::string_view found;
+    for (const mime_entry& entry : MIME_TYPES)
+        if (entry.type == mime_type && (found.empty() || entry.extension < found))
+            found = entry.extension;
+    return std::string(found);
+}
+
+void add_mime_type(std::string_view extension, std::string_view mime_type) {
+    overlay& added = overlays();
+    std::unique_lock<std::shared_mutex> lock(added.mutex);
+    added.mime_types.insert_or_assign(std::string(extension), std::string(mime_type));
+    overlaid.store(true, std::memory_order_release);
+}
+
+void add_static_extension(std::string_view extension) {
+    overlay& added = overlays();
+    std::unique_lock<std::shared_mutex> lock(added.mutex);
+    added.static_extensions.emplace(extension);
+    overlaid.store(true, std::memory_order_release);
+}
+
+void add_method(std::string_view method) {
+    overlay& added = overlays();
+    std::unique_lock<std::shared_mutex> lock(added.mutex);
+    added.methods.emplace(method);
+    overlaid.store(true, std::memory_order_release);
+}
+
+std::string get_file_extension_from_uri(std::string_view uri) {
+    return std::string(get_file_extension_view(uri));
+}
+
+std::string_view get_file_extension_view(std::string_view uri) noexcept {
+    const std::size_t dot_pos = uri.find_last_of('.');
+    return dot_pos == std::string_view::npos ? std::string_view() : uri.substr(dot_pos + 1);
+}
+
+std::string sanitize_path(std::string_view path) {
+    std::string sanitized;
+    sanitize_path(path, sanitized);
     return sanitized;
 }
 
-std::string trim(const std::string& str) {
-    size_t first = str.find_first_not_of(" \t\n\r");
-    size_t last = str.find_last_not_of(" \t\n\r");
-    return (first == std::string::npos || last == std::string::npos)
-               ? ""
-               : str.substr(first, last - first + 1);
+/**
+ * Implementation Notes:
+ * - Erasing ".." until none is left leaves one dot of each odd run of dots
+ *   and none of an even one; that is computed in one pass
+ */
+void sanitize_path(std::string_view path, std::string& out) {
+    if (path.find("..") == std::string_view::npos) {
+        out.assign(path.data(), path.size());
+        return;
+    }
+    out.clear();
+    for (std::size_t i = 0; i < path.size();) {
+        if (path[i] != '.') {
+            out.push_back(path[i++]);
+            continue;
+        }
+        const std::size_t run = path.find_first_not_of('.', i);
+        const std::size_t dots = (run == std::string_view::npos ? path.size() : run) - i;
+        if (dots % 2)
+            out.push_back('.');
+        i += dots;
+    }
+}
+
+std::string trim(std::string_view str) {
+    return std::string(trim_view(str));
+}
+
+std::string_view trim_view(std::string_view str) noexcept {
+    const std::size_t first = str.find_first_not_of(" \t\n\r");
+    if (first == std::string_view::npos)
+        return std::string_view();
+    const std::size_t last = str.find_last_not_of(" \t\n\r");
+    return str.substr(first, last - first + 1);
 }
 
-bool unknown_method(const std::string& method) {
-    static const std::vector<std::string> known_methods = {
-        methods::GET,   methods::POST, methods::PUT,    methods::DELETE_,
-        methods::PATCH, methods::HEAD, methods::OPTIONS};
-    return std::find(known_methods.begin(), known_methods.end(), method) == known_methods.end();
+bool unknown_method(std::string_view method) {
+    if (method_table.contains(method))
+        return false;
+    if (!overlaid.load(std::memory_order_acquire))
+        return true;
+    overlay& added = overlays();
+    std::shared_lock<std::shared_mutex> lock(added.mutex);
+    return added.methods.count(method) == 0;
 }
 
-std::string to_lowercase(const std::string& str) {
-    std::string lower_case_str = str;
-    std::transform(lower_case_str.begin(), lower_case_str.end(), lower_case_str.begin(),
-                   [](unsigned char c) { return std::tolower(c); });
+std::string to_lowercase(std::string_view str) {
+    std::string lower_case_str;
+    fold(str, lower_case_str, 'A');
     return lower_case_str;
 }
 
-std::string to_uppercase(const std::string& str) {
-    std::string upper_case_str = str;
-    std::transform(upper_case_str.begin(), upper_case_str.end(), upper_case_str.begin(),
-                   [](unsigned char c) { return std::toupper(c); });
+std::string to_uppercase(std::string_view str) {
+    std::string upper_case_str;
+    fold(str, upper_case_str, 'a');
     return upper_case_str;
 }
 
+void to_lowercase(std::string_view str, std::string& out) {
+    fold(str, out, 'A');
+}
+
+void to_uppercase(std::string_view str, std::string& out) {
+    fold(str, out, 'a');
+}
+
+/**
+ * Implementation Notes:
+ * - Eight bytes at a time: both sides are lower-cased with case_bits()
+ *   and compared as one word
+ */
+bool iequals(std::string_view a, std::string_view b) noexcept {
+    if (a.size() != b.size())
+        return false;
+    std::size_t i = 0;
+    for (; i + 8 <= a.size(); i += 8) {
+        const std::uint64_t x = load8(a.data() + i);
+        const std::uint64_t y = load8(b.data() + i);
+        if (x != y && (x | case_bits(x, 'A')) != (y | case_bits(y, 'A')))
+            return false;
+    }
+    for (; i < a.size(); ++i)
+        if (lower_byte(a[i]) != lower_byte(b[i]))
+            return false;
+    return true;
+}
+
+bool icontains(std::string_view haystack, std::string_view needle) noexcept {
+    if (needle.empty())
+        return true;
+    const char first = lower_byte(needle[0]);
+    for (std::size_t i = 0; i + needle.size() <= haystack.size(); ++i)
+        if (lower_byte(haystack[i]) == first &&
+            iequals(haystack.substr(i, needle.size()), needle))
+            return true;
+    return false;
+}
+
+bool has_token(std::string_view list, std::string_view token) noexcept {
+    while (!list.empty()) {
+        const std::size_t comma = list.find(',');
+        if (iequals(trim_view(list.substr(0, comma)), token))
+            return true;
+        if (comma == std::string_view::npos)
+            break;
+        list.remove_prefix(comma + 1);
+    }
+    return false;
+}
+
+bool iless::operator()(std::string_view a, std::string_view b) const noexcept {
+    const std::size_t n = std::min(a.size(), b.size());
+    for (std::size_t i = 0; i < n; ++i) {
+        const auto x = static_cast<unsigned char>(lower_byte(a[i]));
+        const auto y = static_cast<unsigned char>(lower_byte(b[i]));
+        if (x != y)
+            return x < y;
+    }
+    return a.size() < b.size();
+}
+
 std::string get_current_working_directory() {
     const int PATH_MAX = 4096;
     char buffer[PATH_MAX];